@@ -86,6 +86,7 @@ include $(art_path)/runtime/Android.mk
 include $(art_path)/compiler/Android.mk
 include $(art_path)/dex2oat/Android.mk
 include $(art_path)/oatdump/Android.mk
+include $(art_path)/hprofexpand/Android.mk
 include $(art_path)/dalvikvm/Android.mk
 include $(art_path)/jdwpspy/Android.mk
 include $(art_build_path)/Android.oat.mk
@@ -338,6 +339,33 @@ dump-oat-Calculator: $(TARGET_OUT_APPS)/Calculator.odex $(TARGET_BOOT_IMG_OUT) $
 	@echo Output in /tmp/Calculator.oatdump.txt
 endif
 
+########################################################################
+# benchmark targets
+
+# "mm bench-art-host-dex2oat" to time the release dex2oat compiling the host core jars with each
+# backend and thread count. Keep /tmp/dex2oat.benchmark.txt of a known good build and pass it as
+# ART_DEX2OAT_BENCHMARK_BASELINE to see the changes since.
+ART_DEX2OAT_BENCHMARK_BASELINE ?=
+.PHONY: bench-art-host-dex2oat
+ifeq ($(ART_BUILD_HOST_NDEBUG),true)
+bench-art-host-dex2oat: $(HOST_CORE_DEX_FILES) $(HOST_OUT_EXECUTABLES)/dex2oat$(HOST_EXECUTABLE_SUFFIX) $(HOST_OUT_SHARED_LIBRARIES)/libart-compiler$(HOST_SHLIB_SUFFIX)
+	$(art_path)/tools/dex2oat-benchmark --dex2oat=$(HOST_OUT_EXECUTABLES)/dex2oat$(HOST_EXECUTABLE_SUFFIX) --android-root=$(HOST_OUT) --instruction-set=$(HOST_ARCH) --base=$(IMG_HOST_BASE_ADDRESS) --image-classes=$(PRELOADED_CLASSES) --output=/tmp/dex2oat.benchmark.txt $(addprefix --baseline=,$(ART_DEX2OAT_BENCHMARK_BASELINE)) $(HOST_CORE_DEX_FILES)
+	@echo Report in /tmp/dex2oat.benchmark.txt
+endif
+
+# "mm bench-art-host-startup" to time the release runtime starting the HelloWorld and
+# CoreLibraryStartup oat tests with cold and warm page caches. Dropping the caches needs root, add
+# --warm-only to ART_STARTUP_BENCHMARK_FLAGS otherwise. Keep /tmp/startup.benchmark.txt of a known
+# good build and pass it as ART_STARTUP_BENCHMARK_BASELINE to see the changes since.
+ART_STARTUP_BENCHMARK_BASELINE ?=
+ART_STARTUP_BENCHMARK_FLAGS ?=
+.PHONY: bench-art-host-startup
+ifeq ($(ART_BUILD_HOST_NDEBUG),true)
+bench-art-host-startup: $(HOST_OUT_JAVA_LIBRARIES)/oat-test-dex-HelloWorld.odex $(HOST_OUT_JAVA_LIBRARIES)/oat-test-dex-CoreLibraryStartup.odex $(HOST_CORE_IMG_OUT) $(HOST_OUT_EXECUTABLES)/dalvikvm$(HOST_EXECUTABLE_SUFFIX) $(HOST_OUT_SHARED_LIBRARIES)/libart$(HOST_SHLIB_SUFFIX)
+	$(art_path)/tools/startup-benchmark --android-root=$(HOST_OUT) --output=/tmp/startup.benchmark.txt $(addprefix --baseline=,$(ART_STARTUP_BENCHMARK_BASELINE)) $(ART_STARTUP_BENCHMARK_FLAGS)
+	@echo Report in /tmp/startup.benchmark.txt
+endif
+
 ########################################################################
 # cpplint targets to style check art source files
 
@@ -68,6 +68,18 @@ ifeq ($(WITH_ART_SEA_IR_MODE), true)
 ART_SEA_IR_MODE := true
 endif
 
+#
+# Used to select the switch based interpreter rather than the computed goto one
+#
+ART_INTERPRETER_SWITCH_IMPL := false
+ifneq ($(wildcard art/INTERPRETER_SWITCH_IMPL),)
+$(info Enabling ART_INTERPRETER_SWITCH_IMPL because of existence of art/INTERPRETER_SWITCH_IMPL)
+ART_INTERPRETER_SWITCH_IMPL := true
+endif
+ifeq ($(WITH_ART_INTERPRETER_SWITCH_IMPL), true)
+ART_INTERPRETER_SWITCH_IMPL := true
+endif
+
 #
 # Used to enable portable mode
 #
@@ -125,6 +137,10 @@ ifeq ($(ART_SEA_IR_MODE),true)
   art_cflags += -DART_SEA_IR_MODE=1
 endif
 
+ifeq ($(ART_INTERPRETER_SWITCH_IMPL),true)
+  art_cflags += -DART_INTERPRETER_SWITCH_IMPL=1
+endif
+
 ifeq ($(HOST_OS),linux)
   art_non_debug_cflags := \
 	-Wframe-larger-than=1728
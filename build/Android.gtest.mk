@@ -21,12 +21,16 @@ TEST_COMMON_SRC_FILES := \
 	compiler/elf_writer_test.cc \
 	compiler/image_test.cc \
 	compiler/jni/jni_compiler_test.cc \
+	compiler/leb128_encoder_test.cc \
 	compiler/oat_test.cc \
 	compiler/output_stream_test.cc \
 	compiler/utils/dedupe_set_test.cc \
+	compiler/utils/swap_space_test.cc \
 	compiler/utils/arm/managed_register_arm_test.cc \
 	compiler/utils/x86/managed_register_x86_test.cc \
+	runtime/arch/memcmp16_test.cc \
 	runtime/barrier_test.cc \
+	runtime/base/concurrent_histogram_test.cc \
 	runtime/base/histogram_test.cc \
 	runtime/base/mutex_test.cc \
 	runtime/base/timing_logger_test.cc \
@@ -36,6 +40,7 @@ TEST_COMMON_SRC_FILES := \
 	runtime/base/unix_file/random_access_file_utils_test.cc \
 	runtime/base/unix_file/string_file_test.cc \
 	runtime/class_linker_test.cc \
+	runtime/class_table_test.cc \
 	runtime/dex_file_test.cc \
 	runtime/dex_instruction_visitor_test.cc \
 	runtime/dex_method_iterator_test.cc \
@@ -48,13 +53,17 @@ TEST_COMMON_SRC_FILES := \
 	runtime/indenter_test.cc \
 	runtime/indirect_reference_table_test.cc \
 	runtime/intern_table_test.cc \
+	runtime/interpreter/inline_cache_test.cc \
 	runtime/jni_internal_test.cc \
 	runtime/mem_map_test.cc \
 	runtime/mirror/dex_cache_test.cc \
 	runtime/mirror/object_test.cc \
+	runtime/profile_file_test.cc \
 	runtime/reference_table_test.cc \
 	runtime/runtime_test.cc \
 	runtime/thread_pool_test.cc \
+	runtime/transaction_test.cc \
+	runtime/utf_test.cc \
 	runtime/utils_test.cc \
 	runtime/verifier/method_verifier_test.cc \
 	runtime/verifier/reg_type_test.cc \
@@ -59,6 +59,8 @@ LIBART_COMPILER_SRC_FILES := \
 	dex/ssa_transformation.cc \
 	driver/compiler_driver.cc \
 	driver/dex_compilation_unit.cc \
+	driver/oat_code_reuse.cc \
+	jit/jit_compiler.cc \
 	jni/portable/jni_compiler.cc \
 	jni/quick/arm/calling_convention_arm.cc \
 	jni/quick/mips/calling_convention_mips.cc \
@@ -82,6 +84,7 @@ LIBART_COMPILER_SRC_FILES := \
 	utils/assembler.cc \
 	utils/mips/assembler_mips.cc \
 	utils/mips/managed_register_mips.cc \
+	utils/swap_space.cc \
 	utils/x86/assembler_x86.cc \
 	utils/x86/managed_register_x86.cc \
 	buffered_output_stream.cc \
@@ -99,6 +102,9 @@ LIBART_COMPILER_SRC_FILES += \
 	sea_ir/frontend.cc \
 	sea_ir/ir/instruction_tools.cc \
 	sea_ir/ir/sea.cc \
+	sea_ir/opt/dce.cc \
+	sea_ir/opt/scalar_replacement.cc \
+	sea_ir/opt/sccp.cc \
 	sea_ir/code_gen/code_gen.cc \
 	sea_ir/code_gen/code_gen_data.cc \
 	sea_ir/types/type_inference.cc \
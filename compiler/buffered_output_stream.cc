@@ -21,12 +21,21 @@
 namespace art {
 
 BufferedOutputStream::BufferedOutputStream(OutputStream* out)
-    : OutputStream(out->GetLocation()), out_(out), used_(0) {}
+    : OutputStream(out->GetLocation()), out_(out), used_(0),
+      position_(out->Seek(0, kSeekCurrent)) {}
+
+BufferedOutputStream::~BufferedOutputStream() {
+  Flush();
+  delete out_;
+}
 
 bool BufferedOutputStream::WriteFully(const void* buffer, int64_t byte_count) {
   if (byte_count > kBufferSize) {
-    Flush();
-    return out_->WriteFully(buffer, byte_count);
+    if (!Flush() || !out_->WriteFully(buffer, byte_count)) {
+      return false;
+    }
+    position_ += byte_count;
+    return true;
   }
   if (used_ + byte_count > kBufferSize) {
     bool success = Flush();
@@ -37,6 +46,7 @@ bool BufferedOutputStream::WriteFully(const void* buffer, int64_t byte_count) {
   const uint8_t* src = reinterpret_cast<const uint8_t*>(buffer);
   memcpy(&buffer_[used_], src, byte_count);
   used_ += byte_count;
+  position_ += byte_count;
   return true;
 }
 
@@ -50,10 +60,26 @@ bool BufferedOutputStream::Flush() {
 }
 
 off_t BufferedOutputStream::Seek(off_t offset, Whence whence) {
+  off_t forward = -1;
+  if (whence == kSeekCurrent) {
+    forward = offset;
+  } else if (whence == kSeekSet && position_ >= 0) {
+    forward = offset - position_;
+  }
+  if (forward >= 0 && static_cast<size_t>(forward) <= kBufferSize) {
+    if (used_ + forward > kBufferSize && !Flush()) {
+      return -1;
+    }
+    memset(&buffer_[used_], 0, forward);
+    used_ += forward;
+    position_ += forward;
+    return position_;
+  }
   if (!Flush()) {
     return -1;
   }
-  return out_->Seek(offset, whence);
+  position_ = out_->Seek(offset, whence);
+  return position_;
 }
 
 }  // namespace art
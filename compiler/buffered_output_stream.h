@@ -23,29 +23,34 @@
 
 namespace art {
 
+// Buffers the writes to another stream. Short forward seeks are taken to skip padding, which is
+// written as zeros into the buffer rather than flushing it, so that aligning each method's code
+// does not cost a system call.
 class BufferedOutputStream : public OutputStream {
  public:
   explicit BufferedOutputStream(OutputStream* out);
 
-  virtual ~BufferedOutputStream() {
-    delete out_;
-  }
+  virtual ~BufferedOutputStream();
 
   virtual bool WriteFully(const void* buffer, int64_t byte_count);
 
   virtual off_t Seek(off_t offset, Whence whence);
 
- private:
-  static const size_t kBufferSize = 8 * KB;
-
+  // Writes out the buffered data. Must be called before the underlying file is used directly.
   bool Flush();
 
+ private:
+  static const size_t kBufferSize = 64 * KB;
+
   OutputStream* const out_;
 
   uint8_t buffer_[kBufferSize];
 
   size_t used_;
 
+  // The position in the output, including the buffered data.
+  off_t position_;
+
   DISALLOW_COPY_AND_ASSIGN(BufferedOutputStream);
 };
 
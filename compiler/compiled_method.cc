@@ -58,6 +58,7 @@ uint32_t CompiledCode::AlignCode(uint32_t offset, InstructionSet instruction_set
     case kMips:
       return RoundUp(offset, kMipsAlignment);
     case kX86:
+    case kX86_64:
       return RoundUp(offset, kX86Alignment);
     default:
       LOG(FATAL) << "Unknown InstructionSet: " << instruction_set;
@@ -70,6 +71,7 @@ size_t CompiledCode::CodeDelta() const {
     case kArm:
     case kMips:
     case kX86:
+    case kX86_64:
       return 0;
     case kThumb2: {
       // +1 to set the low-order bit so a BLX will switch to Thumb mode
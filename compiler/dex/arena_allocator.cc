@@ -22,9 +22,14 @@
 
 namespace art {
 
-// Memmap is a bit slower than malloc according to my measurements.
-static constexpr bool kUseMemMap = false;
-static constexpr bool kUseMemSet = true && kUseMemMap;
+// Arenas are mapped, which is a bit slower than malloc, but the pool keeps them across
+// compilations so the cost is only paid while it grows, and the pages of a mapped arena can be
+// given back to the kernel when it is freed.
+static constexpr bool kUseMemMap = true;
+// Arenas freed with more bytes allocated than this are cleared with madvise, which releases their
+// pages and that way keeps the resident size of the pool down to what a typical method uses.
+// Smaller arenas are cleared with memset, which is cheaper than faulting their pages in again.
+static constexpr size_t kMadviseThreshold = 64 * KB;
 
 static const char* alloc_names[ArenaAllocator::kNumAllocKinds] = {
   "Misc       ",
@@ -40,6 +45,7 @@ static const char* alloc_names[ArenaAllocator::kNumAllocKinds] = {
   "RegAlloc   ",
   "Data       ",
   "Preds      ",
+  "STL        ",
 };
 
 Arena::Arena(size_t size)
@@ -48,6 +54,7 @@ Arena::Arena(size_t size)
       next_(nullptr) {
   if (kUseMemMap) {
     map_ = MemMap::MapAnonymous("dalvik-arena", NULL, size, PROT_READ | PROT_WRITE);
+    CHECK(map_ != nullptr) << "Failed to map an arena of " << size << " bytes";
     memory_ = map_->Begin();
     size_ = map_->Size();
   } else {
@@ -66,10 +73,11 @@ Arena::~Arena() {
 
 void Arena::Reset() {
   if (bytes_allocated_) {
-    if (kUseMemSet || !kUseMemMap) {
-      memset(Begin(), 0, bytes_allocated_);
-    } else {
+    if (kUseMemMap && bytes_allocated_ > kMadviseThreshold) {
+      // Mapped memory reads as zero after MADV_DONTNEED.
       madvise(Begin(), bytes_allocated_, MADV_DONTNEED);
+    } else {
+      memset(Begin(), 0, bytes_allocated_);
     }
     bytes_allocated_ = 0;
   }
@@ -93,20 +101,28 @@ Arena* ArenaPool::AllocArena(size_t size) {
   Arena* ret = nullptr;
   {
     MutexLock lock(self, lock_);
-    if (free_arenas_ != nullptr && LIKELY(free_arenas_->Size() >= size)) {
-      ret = free_arenas_;
-      free_arenas_ = free_arenas_->next_;
+    // Take the first arena that is large enough, only allocations larger than the default size
+    // can skip some.
+    for (Arena** link = &free_arenas_; *link != nullptr; link = &(*link)->next_) {
+      if (LIKELY((*link)->Size() >= size)) {
+        ret = *link;
+        *link = ret->next_;
+        break;
+      }
     }
   }
   if (ret == nullptr) {
     ret = new Arena(size);
   }
-  ret->Reset();
+  DCHECK_EQ(ret->bytes_allocated_, 0U);
   return ret;
 }
 
 void ArenaPool::FreeArena(Arena* arena) {
   Thread* self = Thread::Current();
+  // Clear the arena before it goes back to the pool, outside of the lock, so that the pages that
+  // madvise releases don't stay resident while the arena is unused.
+  arena->Reset();
   {
     MutexLock lock(self, lock_);
     arena->next_ = free_arenas_;
@@ -116,8 +132,18 @@ void ArenaPool::FreeArena(Arena* arena) {
 
 size_t ArenaAllocator::BytesAllocated() const {
   size_t total = 0;
-  for (int i = 0; i < kNumAllocKinds; i++) {
-    total += alloc_stats_[i];
+  if (kCountAllocations) {
+    for (int i = 0; i < kNumAllocKinds; i++) {
+      total += alloc_stats_[i];
+    }
+  } else {
+    // The arenas after the head had their bytes allocated updated when they were replaced.
+    total = ptr_ - begin_;
+    for (Arena* arena = arena_head_; arena != nullptr; arena = arena->next_) {
+      if (arena != arena_head_) {
+        total += arena->bytes_allocated_;
+      }
+    }
   }
   return total;
 }
@@ -176,13 +202,17 @@ void ArenaAllocator::DumpMemStats(std::ostream& os) const {
   const size_t bytes_allocated = BytesAllocated();
   os << " MEM: used: " << bytes_allocated << ", allocated: " << malloc_bytes
      << ", lost: " << lost_bytes << "\n";
+  os << "Number of arenas allocated: " << num_arenas;
   if (num_allocations_ != 0) {
-    os << "Number of arenas allocated: " << num_arenas << ", Number of allocations: "
-       << num_allocations_ << ", avg size: " << bytes_allocated / num_allocations_ << "\n";
+    os << ", Number of allocations: " << num_allocations_
+       << ", avg size: " << bytes_allocated / num_allocations_;
   }
-  os << "===== Allocation by kind\n";
-  for (int i = 0; i < kNumAllocKinds; i++) {
-      os << alloc_names[i] << std::setw(10) << alloc_stats_[i] << "\n";
+  os << "\n";
+  if (kCountAllocations) {
+    os << "===== Allocation by kind\n";
+    for (int i = 0; i < kNumAllocKinds; i++) {
+        os << alloc_names[i] << std::setw(10) << alloc_stats_[i] << "\n";
+    }
   }
 }
 
@@ -20,15 +20,23 @@
 #include <stdint.h>
 #include <stddef.h>
 
+#include <functional>
+#include <new>
+#include <set>
+#include <utility>
+#include <vector>
+
 #include "base/mutex.h"
 #include "compiler_enums.h"
 #include "mem_map.h"
+#include "safe_map.h"
 
 namespace art {
 
 class Arena;
 class ArenaPool;
 class ArenaAllocator;
+template <typename T> class ArenaAllocatorAdapter;
 
 class Arena {
  public:
@@ -93,6 +101,7 @@ class ArenaAllocator {
     kAllocRegAlloc,
     kAllocData,
     kAllocPredecessors,
+    kAllocSTL,
     kNumAllocKinds
   };
 
@@ -120,6 +129,9 @@ class ArenaAllocator {
     return ret;
   }
 
+  // An allocator for the containers below, it converts to the adapter of any element type.
+  ArenaAllocatorAdapter<uint8_t> Adapter();
+
   void ObtainNewArenaForAllocation(size_t allocation_size);
   size_t BytesAllocated() const;
   void DumpMemStats(std::ostream& os) const;
@@ -140,6 +152,86 @@ class ArenaAllocator {
   DISALLOW_COPY_AND_ASSIGN(ArenaAllocator);
 };  // ArenaAllocator
 
+// An STL allocator that takes its memory from an arena, for example
+// std::vector<uint32_t, ArenaAllocatorAdapter<uint32_t> >. Memory is only reclaimed with the
+// arena, so this suits containers that live as long as the compilation of the method and don't
+// shrink and grow again repeatedly.
+template <typename T>
+class ArenaAllocatorAdapter {
+ public:
+  typedef T value_type;
+  typedef T* pointer;
+  typedef const T* const_pointer;
+  typedef T& reference;
+  typedef const T& const_reference;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+
+  template <typename U>
+  struct rebind {
+    typedef ArenaAllocatorAdapter<U> other;
+  };
+
+  explicit ArenaAllocatorAdapter(ArenaAllocator* arena) : arena_(arena) {}
+
+  template <typename U>
+  ArenaAllocatorAdapter(const ArenaAllocatorAdapter<U>& other)  // NOLINT, implicit as required.
+      : arena_(other.arena_) {}
+
+  pointer address(reference x) const {
+    return &x;
+  }
+
+  const_pointer address(const_reference x) const {
+    return &x;
+  }
+
+  pointer allocate(size_type n, const void* /* hint */ = 0) {
+    return static_cast<pointer>(arena_->Alloc(n * sizeof(T), ArenaAllocator::kAllocSTL));
+  }
+
+  void deallocate(pointer, size_type) {}
+
+  size_type max_size() const {
+    return static_cast<size_type>(-1) / sizeof(T);
+  }
+
+  void construct(pointer p, const T& val) {
+    new (static_cast<void*>(p)) T(val);
+  }
+
+  void destroy(pointer p) {
+    p->~T();
+  }
+
+  bool operator==(const ArenaAllocatorAdapter& other) const {
+    return arena_ == other.arena_;
+  }
+
+  bool operator!=(const ArenaAllocatorAdapter& other) const {
+    return arena_ != other.arena_;
+  }
+
+ private:
+  ArenaAllocator* arena_;
+
+  template <typename U> friend class ArenaAllocatorAdapter;
+};
+
+inline ArenaAllocatorAdapter<uint8_t> ArenaAllocator::Adapter() {
+  return ArenaAllocatorAdapter<uint8_t>(this);
+}
+
+// Containers allocating from the arena, constructed with ArenaAllocator::Adapter().
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocatorAdapter<T> >;
+
+template <typename T, typename Comparator = std::less<T> >
+using ArenaSet = std::set<T, Comparator, ArenaAllocatorAdapter<T> >;
+
+template <typename K, typename V, typename Comparator = std::less<K> >
+using ArenaSafeMap = SafeMap<K, V, Comparator, ArenaAllocatorAdapter<std::pair<const K, V> > >;
+
 struct MemStats {
    public:
      void Dump(std::ostream& os) const {
@@ -27,6 +27,8 @@ class Backend {
     virtual ~Backend() {}
     virtual void Materialize() = 0;
     virtual CompiledMethod* GetCompiledMethod() = 0;
+    // The number of low-level instructions of the method, for statistics.
+    virtual size_t GetNumLIRs() const { return 0; }
 
   protected:
     explicit Backend(ArenaAllocator* arena) : arena_(arena) {}
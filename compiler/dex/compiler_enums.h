@@ -126,6 +126,7 @@ enum MIROptimizationFlagPositons {
   kMIRInlinedPred,                    // Invoke is inlined via prediction.
   kMIRCallee,                         // Instruction is inlined from callee.
   kMIRIgnoreSuspendCheck,
+  kMIRIgnoreClInitCheck,             // Class already initialized on every path.
   kMIRDup,
   kMIRMark,                           // Temporary node mark.
 };
@@ -405,6 +406,7 @@ enum OatBitMapKind {
   kBitMapRegisterV,
   kBitMapTempSSARegisterV,
   kBitMapNullCheck,
+  kBitMapClInitCheck,
   kBitMapTmpBlockV,
   kBitMapPredecessors,
   kNumBitMapKinds
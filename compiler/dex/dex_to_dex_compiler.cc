@@ -88,6 +88,19 @@ class DexCompiler {
   void CompileInvokeVirtual(Instruction* inst, uint32_t dex_pc,
                             Instruction::Code new_opcode, bool is_range);
 
+  // Compiles a static field access into a quick static field access when the field's class is
+  // known to be initialized at runtime. The field index is kept, the interpreter then takes the
+  // field from the dex cache without checking access or class initialization again.
+  void CompileStaticFieldAccess(Instruction* inst, uint32_t dex_pc,
+                                Instruction::Code new_opcode, bool is_put);
+
+  // Compiles a direct or static method invocation into a quick one when the method resolves and
+  // is accessible. The method index is kept, the interpreter then takes the method from the dex
+  // cache without checking access again.
+  void CompileInvokeDirectOrStatic(Instruction* inst, uint32_t dex_pc,
+                                   Instruction::Code new_opcode, InvokeType invoke_type,
+                                   bool is_range);
+
   CompilerDriver& driver_;
   const DexCompilationUnit& unit_;
   const DexToDexCompilationLevel dex_to_dex_compilation_level_;
@@ -151,6 +164,48 @@ void DexCompiler::Compile() {
         CompileInvokeVirtual(inst, dex_pc, Instruction::INVOKE_VIRTUAL_RANGE_QUICK, true);
         break;
 
+      case Instruction::SGET:
+        CompileStaticFieldAccess(inst, dex_pc, Instruction::SGET_QUICK, false);
+        break;
+
+      case Instruction::SGET_WIDE:
+        CompileStaticFieldAccess(inst, dex_pc, Instruction::SGET_WIDE_QUICK, false);
+        break;
+
+      case Instruction::SGET_OBJECT:
+        CompileStaticFieldAccess(inst, dex_pc, Instruction::SGET_OBJECT_QUICK, false);
+        break;
+
+      case Instruction::SPUT:
+        CompileStaticFieldAccess(inst, dex_pc, Instruction::SPUT_QUICK, true);
+        break;
+
+      case Instruction::SPUT_WIDE:
+        CompileStaticFieldAccess(inst, dex_pc, Instruction::SPUT_WIDE_QUICK, true);
+        break;
+
+      case Instruction::SPUT_OBJECT:
+        CompileStaticFieldAccess(inst, dex_pc, Instruction::SPUT_OBJECT_QUICK, true);
+        break;
+
+      case Instruction::INVOKE_DIRECT:
+        CompileInvokeDirectOrStatic(inst, dex_pc, Instruction::INVOKE_DIRECT_QUICK, kDirect, false);
+        break;
+
+      case Instruction::INVOKE_DIRECT_RANGE:
+        CompileInvokeDirectOrStatic(inst, dex_pc, Instruction::INVOKE_DIRECT_RANGE_QUICK, kDirect,
+                                    true);
+        break;
+
+      case Instruction::INVOKE_STATIC:
+        CompileInvokeDirectOrStatic(inst, dex_pc, Instruction::INVOKE_STATIC_QUICK, kStatic, false);
+        break;
+
+      case Instruction::INVOKE_STATIC_RANGE:
+        CompileInvokeDirectOrStatic(inst, dex_pc, Instruction::INVOKE_STATIC_RANGE_QUICK, kStatic,
+                                    true);
+        break;
+
       default:
         // Nothing to do.
         break;
@@ -272,6 +327,63 @@ void DexCompiler::CompileInvokeVirtual(Instruction* inst,
   }
 }
 
+void DexCompiler::CompileStaticFieldAccess(Instruction* inst,
+                                           uint32_t dex_pc,
+                                           Instruction::Code new_opcode,
+                                           bool is_put) {
+  if (!kEnableQuickening || !PerformOptimizations()) {
+    return;
+  }
+  uint32_t field_idx = inst->VRegB_21c();
+  int field_offset;
+  int ssb_index;
+  bool is_referrers_class;
+  bool is_volatile;
+  bool fast_path = driver_.ComputeStaticFieldInfo(field_idx, &unit_, field_offset, ssb_index,
+                                                  is_referrers_class, is_volatile, is_put);
+  // The referrer's class is initialized, or being initialized by the current thread, whenever
+  // one of its methods runs.
+  if (fast_path && !is_volatile &&
+      (is_referrers_class || driver_.IsStaticFieldsClassInitializedInImage(field_idx, &unit_))) {
+    VLOG(compiler) << "Quickening " << Instruction::Name(inst->Opcode())
+                   << " to " << Instruction::Name(new_opcode)
+                   << " for field index " << field_idx
+                   << " at dex pc " << StringPrintf("0x%x", dex_pc) << " in method "
+                   << PrettyMethod(unit_.GetDexMethodIndex(), GetDexFile(), true);
+    inst->SetOpcode(new_opcode);
+  }
+}
+
+void DexCompiler::CompileInvokeDirectOrStatic(Instruction* inst,
+                                              uint32_t dex_pc,
+                                              Instruction::Code new_opcode,
+                                              InvokeType invoke_type,
+                                              bool is_range) {
+  if (!kEnableQuickening || !PerformOptimizations()) {
+    return;
+  }
+  uint32_t method_idx = is_range ? inst->VRegB_3rc() : inst->VRegB_35c();
+  MethodReference target_method(&GetDexFile(), method_idx);
+  InvokeType original_invoke_type = invoke_type;
+  int vtable_idx;
+  uintptr_t direct_code;
+  uintptr_t direct_method;
+  bool fast_path = driver_.ComputeInvokeInfo(&unit_, dex_pc, invoke_type,
+                                             target_method, vtable_idx,
+                                             direct_code, direct_method,
+                                             false);
+  // The interpreter bridges initialize the class of a static method, so unlike static field
+  // accesses static invokes don't depend on the class being initialized.
+  if (fast_path && original_invoke_type == invoke_type) {
+    VLOG(compiler) << "Quickening " << Instruction::Name(inst->Opcode())
+                   << "(" << PrettyMethod(method_idx, GetDexFile(), true) << ")"
+                   << " to " << Instruction::Name(new_opcode)
+                   << " at dex pc " << StringPrintf("0x%x", dex_pc) << " in method "
+                   << PrettyMethod(unit_.GetDexMethodIndex(), GetDexFile(), true);
+    inst->SetOpcode(new_opcode);
+  }
+}
+
 }  // namespace optimizer
 }  // namespace art
 
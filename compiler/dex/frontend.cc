@@ -77,12 +77,21 @@ static uint32_t kCompilerOptimizerDisableFlags = 0 |  // Disable specific optimi
   // (1 << kLoadHoisting) |
   // (1 << kSuppressLoads) |
   // (1 << kNullCheckElimination) |
+  // (1 << kClassInitCheckElimination) |
   // (1 << kPromoteRegs) |
   // (1 << kTrackLiveTemps) |
   // (1 << kSafeOptimizations) |
   // (1 << kBBOpt) |
   // (1 << kMatch) |
   // (1 << kPromoteCompilerTemps) |
+  // (1 << kGlobalValueNumbering) |
+  // (1 << kRangeCheckElimination) |
+  // (1 << kLoopInvariantCodeMotion) |
+  // (1 << kInlineCalls) |
+  // (1 << kInstructionScheduling) |
+  // (1 << kDevirtualization) |
+  // (1 << kConstantFolding) |
+  // (1 << kPeepholeOptimizations) |
   0;
 
 static uint32_t kCompilerDebugFlags = 0 |     // Enable debug/testing modes
@@ -106,6 +115,21 @@ static uint32_t kCompilerDebugFlags = 0 |     // Enable debug/testing modes
   // (1 << kDebugShowFilterStats) |
   0;
 
+// Records what was built for the method for the compiler driver's method report.
+static void RecordMethodCompileStats(CompilerDriver& compiler, CompilationUnit& cu) {
+  MethodCompileStats* stats = compiler.GetTls()->GetMethodCompileStats();
+  stats->arena_bytes = cu.arena.BytesAllocated();
+  stats->num_blocks = cu.mir_graph->GetNumBlocks();
+  stats->num_mirs = 0;
+  GrowableArray<BasicBlock*>::Iterator iterator(cu.mir_graph->GetBlockList());
+  for (BasicBlock* bb = iterator.Next(); bb != NULL; bb = iterator.Next()) {
+    for (MIR* mir = bb->first_mir_insn; mir != NULL; mir = mir->next) {
+      stats->num_mirs++;
+    }
+  }
+  stats->num_lirs = (cu.cg.get() != NULL) ? cu.cg->GetNumLIRs() : 0;
+}
+
 static CompiledMethod* CompileMethod(CompilerDriver& compiler,
                                      const CompilerBackend compiler_backend,
                                      const DexFile::CodeItem* code_item,
@@ -162,12 +186,25 @@ static CompiledMethod* CompileMethod(CompilerDriver& compiler,
         (1 << kLoadHoisting) |
         (1 << kSuppressLoads) |
         (1 << kNullCheckElimination) |
+        (1 << kClassInitCheckElimination) |
         (1 << kPromoteRegs) |
         (1 << kTrackLiveTemps) |
         (1 << kSafeOptimizations) |
         (1 << kBBOpt) |
         (1 << kMatch) |
-        (1 << kPromoteCompilerTemps));
+        (1 << kPromoteCompilerTemps) |
+        (1 << kGlobalValueNumbering) |
+        (1 << kRangeCheckElimination) |
+        (1 << kLoopInvariantCodeMotion) |
+        (1 << kInlineCalls) |
+        (1 << kInstructionScheduling) |
+        (1 << kConstantFolding) |
+        (1 << kPeepholeOptimizations));
+  }
+
+  if (cu.instruction_set == kX86) {
+    // Only the Thumb2 instruction latencies are known.
+    cu.disable_opt |= (1 << kInstructionScheduling);
   }
 
   cu.mir_graph.reset(new MIRGraph(&cu, &cu.arena));
@@ -182,11 +219,15 @@ static CompiledMethod* CompileMethod(CompilerDriver& compiler,
                               class_loader, dex_file);
 
 #if !defined(ART_USE_PORTABLE_COMPILER)
-  if (cu.mir_graph->SkipCompilation(Runtime::Current()->GetCompilerFilter())) {
+  if (cu.mir_graph->SkipCompilation(compiler.GetCompilerFilter(method_idx, dex_file))) {
+    RecordMethodCompileStats(compiler, cu);
     return NULL;
   }
 #endif
 
+  /* Replace calls to trivial methods by their code */
+  cu.mir_graph->InlineCalls();
+
   /* Do a code layout pass */
   cu.mir_graph->CodeLayout();
 
@@ -196,12 +237,27 @@ static CompiledMethod* CompileMethod(CompilerDriver& compiler,
   /* Do constant propagation */
   cu.mir_graph->PropagateConstants();
 
+  /* Fold constant arithmetic and branches, and reduce the strength of the rest */
+  cu.mir_graph->ConstantFolding();
+
   /* Count uses */
   cu.mir_graph->MethodUseCount();
 
   /* Perform null check elimination */
   cu.mir_graph->NullCheckElimination();
 
+  /* Perform class initialization check elimination */
+  cu.mir_graph->ClassInitCheckElimination();
+
+  /* Remove checks dominated by the same check */
+  cu.mir_graph->GlobalValueNumbering();
+
+  /* Remove range checks of counted loops */
+  cu.mir_graph->RangeCheckElimination();
+
+  /* Hoist loop invariant computations into pre-headers */
+  cu.mir_graph->LoopInvariantCodeMotion();
+
   /* Combine basic blocks where possible */
   cu.mir_graph->BasicBlockCombine();
 
@@ -246,6 +302,7 @@ static CompiledMethod* CompileMethod(CompilerDriver& compiler,
   cu.cg->Materialize();
 
   result = cu.cg->GetCompiledMethod();
+  RecordMethodCompileStats(compiler, cu);
 
   if (result) {
     VLOG(compiler) << "Compiled " << PrettyMethod(method_idx, dex_file);
@@ -49,6 +49,7 @@ enum opt_control_vector {
   kLoadHoisting,
   kSuppressLoads,
   kNullCheckElimination,
+  kClassInitCheckElimination,
   kPromoteRegs,
   kTrackLiveTemps,
   kSafeOptimizations,
@@ -56,6 +57,14 @@ enum opt_control_vector {
   kMatch,
   kPromoteCompilerTemps,
   kBranchFusing,
+  kGlobalValueNumbering,
+  kRangeCheckElimination,
+  kLoopInvariantCodeMotion,
+  kInlineCalls,
+  kInstructionScheduling,
+  kDevirtualization,
+  kConstantFolding,
+  kPeepholeOptimizations,
 };
 
 // Force code generation paths for testing.
@@ -18,6 +18,43 @@
 
 namespace art {
 
+uint64_t LocalValueNumbering::FieldLocation(uint32_t field_idx, bool is_static) const {
+  // A field referenced through a subclass has another field index, so stores version all the
+  // fields of a kind with the same name.
+  const DexFile::FieldId& field_id = cu_->dex_file->GetFieldId(field_idx);
+  MemoryKind kind = is_static ? kStaticFieldMemory : kInstanceFieldMemory;
+  return (static_cast<uint64_t>(kind) << 32) | field_id.name_idx_;
+}
+
+bool LocalValueNumbering::IsVolatileOrUnresolvedInstanceField(uint32_t field_idx,
+                                                              bool is_put) const {
+  int field_offset;
+  bool is_volatile;
+  bool fast_path = cu_->compiler_driver->ComputeInstanceFieldInfo(
+      field_idx, cu_->mir_graph->GetCurrentDexCompilationUnit(), field_offset, is_volatile,
+      is_put);
+  return !fast_path || is_volatile;
+}
+
+/*
+ * Accessing a static field of another class may run its class initializer, which can store
+ * anywhere. Returns true if the access itself can't be value numbered.
+ */
+bool LocalValueNumbering::PrepareStaticFieldAccess(MIR* mir, bool is_put) {
+  int field_offset;
+  int ssb_index;
+  bool is_referrers_class;
+  bool is_volatile;
+  bool fast_path = cu_->compiler_driver->ComputeStaticFieldInfo(
+      mir->dalvikInsn.vB, cu_->mir_graph->GetCurrentDexCompilationUnit(), field_offset,
+      ssb_index, is_referrers_class, is_volatile, is_put);
+  bool may_initialize = !is_referrers_class &&
+      ((mir->optimization_flags & MIR_IGNORE_CLINIT_CHECK) == 0);
+  if (!fast_path || may_initialize || is_volatile) {
+    ClobberMemory();
+  }
+  return !fast_path || is_volatile;
+}
 
 uint16_t LocalValueNumbering::GetValueNumber(MIR* mir) {
   uint16_t res = NO_VALUE;
@@ -28,14 +65,11 @@ uint16_t LocalValueNumbering::GetValueNumber(MIR* mir) {
     case Instruction::RETURN:
     case Instruction::RETURN_OBJECT:
     case Instruction::RETURN_WIDE:
-    case Instruction::MONITOR_ENTER:
-    case Instruction::MONITOR_EXIT:
     case Instruction::GOTO:
     case Instruction::GOTO_16:
     case Instruction::GOTO_32:
     case Instruction::CHECK_CAST:
     case Instruction::THROW:
-    case Instruction::FILL_ARRAY_DATA:
     case Instruction::FILLED_NEW_ARRAY:
     case Instruction::FILLED_NEW_ARRAY_RANGE:
     case Instruction::PACKED_SWITCH:
@@ -52,6 +86,14 @@ uint16_t LocalValueNumbering::GetValueNumber(MIR* mir) {
     case Instruction::IF_GEZ:
     case Instruction::IF_GTZ:
     case Instruction::IF_LEZ:
+    case kMirOpFusedCmplFloat:
+    case kMirOpFusedCmpgFloat:
+    case kMirOpFusedCmplDouble:
+    case kMirOpFusedCmpgDouble:
+    case kMirOpFusedCmpLong:
+      // Nothing defined - take no action.
+      break;
+
     case Instruction::INVOKE_STATIC_RANGE:
     case Instruction::INVOKE_STATIC:
     case Instruction::INVOKE_DIRECT:
@@ -62,19 +104,26 @@ uint16_t LocalValueNumbering::GetValueNumber(MIR* mir) {
     case Instruction::INVOKE_SUPER_RANGE:
     case Instruction::INVOKE_INTERFACE:
     case Instruction::INVOKE_INTERFACE_RANGE:
-    case kMirOpFusedCmplFloat:
-    case kMirOpFusedCmpgFloat:
-    case kMirOpFusedCmplDouble:
-    case kMirOpFusedCmpgDouble:
-    case kMirOpFusedCmpLong:
-      // Nothing defined - take no action.
+    case Instruction::MONITOR_ENTER:
+    case Instruction::MONITOR_EXIT:
+      // Callees and other threads may store anywhere.
+      ClobberMemory();
+      break;
+
+    case Instruction::FILL_ARRAY_DATA:
+      AdvanceMemoryVersion(ArrayLocation());
+      break;
+
+    case Instruction::NEW_INSTANCE:
+      // May run the class initializer.
+      ClobberMemory();
+      SetOperandValue(mir->ssa_rep->defs[0], GetOperandValue(mir->ssa_rep->defs[0]));
       break;
 
     case Instruction::MOVE_EXCEPTION:
     case Instruction::MOVE_RESULT:
     case Instruction::MOVE_RESULT_OBJECT:
     case Instruction::INSTANCE_OF:
-    case Instruction::NEW_INSTANCE:
     case Instruction::CONST_STRING:
     case Instruction::CONST_STRING_JUMBO:
     case Instruction::CONST_CLASS:
@@ -93,8 +142,9 @@ uint16_t LocalValueNumbering::GetValueNumber(MIR* mir) {
 
     case kMirOpPhi:
       /*
-       * Because we'll only see phi nodes at the beginning of an extended basic block,
-       * we can ignore them.  Revisit if we shift to global value numbering.
+       * Phi nodes are only at the beginning of a block with several predecessors and merge
+       * different values, their definitions get a new value on first use like any other
+       * unknown value.
        */
       break;
 
@@ -124,7 +174,7 @@ uint16_t LocalValueNumbering::GetValueNumber(MIR* mir) {
     case Instruction::CONST_4:
     case Instruction::CONST_16: {
         uint16_t res = LookupValue(Instruction::CONST, Low16Bits(mir->dalvikInsn.vB),
-                                   High16Bits(mir->dalvikInsn.vB >> 16), 0);
+                                   High16Bits(mir->dalvikInsn.vB), 0);
         SetOperandValue(mir->ssa_rep->defs[0], res);
       }
       break;
@@ -138,7 +188,7 @@ uint16_t LocalValueNumbering::GetValueNumber(MIR* mir) {
     case Instruction::CONST_WIDE_16:
     case Instruction::CONST_WIDE_32: {
         uint16_t low_res = LookupValue(Instruction::CONST, Low16Bits(mir->dalvikInsn.vB),
-                                       High16Bits(mir->dalvikInsn.vB >> 16), 1);
+                                       High16Bits(mir->dalvikInsn.vB), 1);
         uint16_t high_res;
         if (mir->dalvikInsn.vB & 0x80000000) {
           high_res = LookupValue(Instruction::CONST, 0xffff, 0xffff, 2);
@@ -349,9 +399,10 @@ uint16_t LocalValueNumbering::GetValueNumber(MIR* mir) {
     case Instruction::SHL_INT_LIT8:
     case Instruction::SHR_INT_LIT8:
     case Instruction::USHR_INT_LIT8: {
-        // Same as res = op + 2 operands, except use vB as operand 2
+        // Same as res = op + 2 operands, except use the literal vC as operand 2
         uint16_t operand1 = GetOperandValue(mir->ssa_rep->uses[0]);
-        uint16_t operand2 = LookupValue(Instruction::CONST, mir->dalvikInsn.vB, 0, 0);
+        uint16_t operand2 = LookupValue(Instruction::CONST, Low16Bits(mir->dalvikInsn.vC),
+                                        High16Bits(mir->dalvikInsn.vC), 0);
         uint16_t res = LookupValue(opcode, operand1, operand2, NO_VALUE);
         SetOperandValue(mir->ssa_rep->defs[0], res);
       }
@@ -384,7 +435,7 @@ uint16_t LocalValueNumbering::GetValueNumber(MIR* mir) {
         // Use side effect to note range check completed.
         (void)LookupValue(ARRAY_REF, array, index, NO_VALUE);
         // Establish value number for loaded register. Note use of memory version.
-        uint16_t memory_version = GetMemoryVersion(array, NO_VALUE);
+        uint16_t memory_version = GetMemoryVersion(ArrayLocation());
         uint16_t res = LookupValue(ARRAY_REF, array, index, memory_version);
         if (opcode == Instruction::AGET_WIDE) {
           SetOperandValueWide(mir->ssa_rep->defs[0], res);
@@ -422,8 +473,8 @@ uint16_t LocalValueNumbering::GetValueNumber(MIR* mir) {
         mir->meta.throw_insn->optimization_flags |= mir->optimization_flags;
         // Use side effect to note range check completed.
         (void)LookupValue(ARRAY_REF, array, index, NO_VALUE);
-        // Rev the memory version
-        AdvanceMemoryVersion(array, NO_VALUE);
+        // Rev the memory version, the array may be aliased.
+        AdvanceMemoryVersion(ArrayLocation());
       }
       break;
 
@@ -445,7 +496,18 @@ uint16_t LocalValueNumbering::GetValueNumber(MIR* mir) {
         }
         mir->meta.throw_insn->optimization_flags |= mir->optimization_flags;
         uint16_t field_ref = mir->dalvikInsn.vC;
-        uint16_t memory_version = GetMemoryVersion(base, field_ref);
+        if (IsVolatileOrUnresolvedInstanceField(field_ref, false)) {
+          // Treat as unique each time and forget what was loaded before.
+          ClobberMemory();
+          if (opcode == Instruction::IGET_WIDE) {
+            SetOperandValueWide(mir->ssa_rep->defs[0],
+                                GetOperandValueWide(mir->ssa_rep->defs[0]));
+          } else {
+            SetOperandValue(mir->ssa_rep->defs[0], GetOperandValue(mir->ssa_rep->defs[0]));
+          }
+          break;
+        }
+        uint16_t memory_version = GetMemoryVersion(FieldLocation(field_ref, false));
         if (opcode == Instruction::IGET_WIDE) {
           uint16_t res = LookupValue(Instruction::IGET_WIDE, base, field_ref, memory_version);
           SetOperandValueWide(mir->ssa_rep->defs[0], res);
@@ -475,7 +537,11 @@ uint16_t LocalValueNumbering::GetValueNumber(MIR* mir) {
         }
         mir->meta.throw_insn->optimization_flags |= mir->optimization_flags;
         uint16_t field_ref = mir->dalvikInsn.vC;
-        AdvanceMemoryVersion(base, field_ref);
+        if (IsVolatileOrUnresolvedInstanceField(field_ref, true)) {
+          ClobberMemory();
+        } else {
+          AdvanceMemoryVersion(FieldLocation(field_ref, false));
+        }
       }
       break;
 
@@ -487,7 +553,17 @@ uint16_t LocalValueNumbering::GetValueNumber(MIR* mir) {
     case Instruction::SGET_SHORT:
     case Instruction::SGET_WIDE: {
         uint16_t field_ref = mir->dalvikInsn.vB;
-        uint16_t memory_version = GetMemoryVersion(NO_VALUE, field_ref);
+        if (PrepareStaticFieldAccess(mir, false)) {
+          // Treat as unique each time.
+          if (opcode == Instruction::SGET_WIDE) {
+            SetOperandValueWide(mir->ssa_rep->defs[0],
+                                GetOperandValueWide(mir->ssa_rep->defs[0]));
+          } else {
+            SetOperandValue(mir->ssa_rep->defs[0], GetOperandValue(mir->ssa_rep->defs[0]));
+          }
+          break;
+        }
+        uint16_t memory_version = GetMemoryVersion(FieldLocation(field_ref, true));
         if (opcode == Instruction::SGET_WIDE) {
           uint16_t res = LookupValue(Instruction::SGET_WIDE, NO_VALUE, field_ref, memory_version);
           SetOperandValueWide(mir->ssa_rep->defs[0], res);
@@ -506,7 +582,8 @@ uint16_t LocalValueNumbering::GetValueNumber(MIR* mir) {
     case Instruction::SPUT_SHORT:
     case Instruction::SPUT_WIDE: {
         uint16_t field_ref = mir->dalvikInsn.vB;
-        AdvanceMemoryVersion(NO_VALUE, field_ref);
+        PrepareStaticFieldAccess(mir, true);
+        AdvanceMemoryVersion(FieldLocation(field_ref, true));
       }
       break;
   }
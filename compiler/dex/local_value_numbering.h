@@ -28,12 +28,18 @@ namespace art {
 typedef SafeMap<uint16_t, uint16_t> SregValueMap;
 // Key is concatenation of quad, value is value name.
 typedef SafeMap<uint64_t, uint16_t> ValueMap;
-// Key represents a memory address, value is generation.
-typedef SafeMap<uint32_t, uint16_t> MemoryVersionMap;
+// Key represents a memory location stores may alias, value is generation.
+typedef SafeMap<uint64_t, uint16_t> MemoryVersionMap;
 
+/*
+ * Value numbers and the null and range checks already done. Used on a single extended basic
+ * block, or copied from the immediate dominator to continue the numbering in a dominated block
+ * for global value numbering.
+ */
 class LocalValueNumbering {
  public:
-  explicit LocalValueNumbering(CompilationUnit* cu) : cu_(cu) {}
+  explicit LocalValueNumbering(CompilationUnit* cu)
+      : cu_(cu), last_memory_version_(0), clobbered_memory_version_(0) {}
 
   static uint64_t BuildKey(uint16_t op, uint16_t operand1, uint16_t operand2, uint16_t modifier) {
     return (static_cast<uint64_t>(op) << 48 | static_cast<uint64_t>(operand1) << 32 |
@@ -59,27 +65,19 @@ class LocalValueNumbering {
     return (it != value_map_.end());
   };
 
-  uint16_t GetMemoryVersion(uint16_t base, uint16_t field) {
-    uint32_t key = (base << 16) | field;
-    uint16_t res;
-    MemoryVersionMap::iterator it = memory_version_map_.find(key);
-    if (it == memory_version_map_.end()) {
-      res = 0;
-      memory_version_map_.Put(key, res);
-    } else {
-      res = it->second;
-    }
-    return res;
+  uint16_t GetMemoryVersion(uint64_t location) const {
+    MemoryVersionMap::const_iterator it = memory_version_map_.find(location);
+    return (it != memory_version_map_.end()) ? it->second : clobbered_memory_version_;
   };
 
-  void AdvanceMemoryVersion(uint16_t base, uint16_t field) {
-    uint32_t key = (base << 16) | field;
-    MemoryVersionMap::iterator it = memory_version_map_.find(key);
-    if (it == memory_version_map_.end()) {
-      memory_version_map_.Put(key, 0);
-    } else {
-      it->second++;
-    }
+  void AdvanceMemoryVersion(uint64_t location) {
+    memory_version_map_.Overwrite(location, ++last_memory_version_);
+  };
+
+  // Forget everything known about memory, anything may have been stored.
+  void ClobberMemory() {
+    memory_version_map_.clear();
+    clobbered_memory_version_ = ++last_memory_version_;
   };
 
   void SetOperandValue(uint16_t s_reg, uint16_t value) {
@@ -129,11 +127,28 @@ class LocalValueNumbering {
   uint16_t GetValueNumber(MIR* mir);
 
  private:
+  enum MemoryKind {
+    kArrayMemory,
+    kInstanceFieldMemory,
+    kStaticFieldMemory,
+  };
+
+  static uint64_t ArrayLocation() {
+    return static_cast<uint64_t>(kArrayMemory) << 32;
+  }
+
+  uint64_t FieldLocation(uint32_t field_idx, bool is_static) const;
+  bool IsVolatileOrUnresolvedInstanceField(uint32_t field_idx, bool is_put) const;
+  bool PrepareStaticFieldAccess(MIR* mir, bool is_put);
+
   CompilationUnit* const cu_;
   SregValueMap sreg_value_map_;
   SregValueMap sreg_wide_value_map_;
   ValueMap value_map_;
   MemoryVersionMap memory_version_map_;
+  uint16_t last_memory_version_;
+  // Version of the locations not stored to since memory was last clobbered.
+  uint16_t clobbered_memory_version_;
   std::set<uint16_t> null_checked_;
 };
 
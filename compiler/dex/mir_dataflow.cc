@@ -1287,6 +1287,7 @@ void MIRGraph::MethodUseCount() {
   if (cu_->disable_opt & (1 << kPromoteRegs)) {
     return;
   }
+  ComputeLoopNesting();
   AllNodesIterator iter(this, false /* not iterative */);
   for (BasicBlock* bb = iter.Next(); bb != NULL; bb = iter.Next()) {
     CountUses(bb);
@@ -179,6 +179,7 @@ enum OatMethodAttributes {
 #define MIR_INLINED_PRED                (1 << kMIRInlinedPred)
 #define MIR_CALLEE                      (1 << kMIRCallee)
 #define MIR_IGNORE_SUSPEND_CHECK        (1 << kMIRIgnoreSuspendCheck)
+#define MIR_IGNORE_CLINIT_CHECK         (1 << kMIRIgnoreClInitCheck)
 #define MIR_DUP                         (1 << kMIRDup)
 
 #define BLOCK_NAME_LEN 80
@@ -209,6 +210,7 @@ struct BasicBlockDataFlow {
   ArenaBitVector* phi_v;
   int* vreg_to_ssa_map;
   ArenaBitVector* ending_null_check_v;
+  ArenaBitVector* ending_clinit_check_v;  // Indexed by the dense static field index.
 };
 
 /*
@@ -573,6 +575,7 @@ class MIRGraph {
   void CodeLayout();
   void DumpCheckStats();
   void PropagateConstants();
+  void ConstantFolding();
   MIR* FindMoveResult(BasicBlock* bb, MIR* mir);
   int SRegToVReg(int ssa_reg) const;
   void VerifyDataflow();
@@ -580,6 +583,11 @@ class MIRGraph {
   void SSATransformation();
   void CheckForDominanceFrontier(BasicBlock* dom_bb, const BasicBlock* succ_bb);
   void NullCheckElimination();
+  void ClassInitCheckElimination();
+  void GlobalValueNumbering();
+  void RangeCheckElimination();
+  void LoopInvariantCodeMotion();
+  void InlineCalls();
   bool SetFp(int index, bool is_fp);
   bool SetCore(int index, bool is_core);
   bool SetRef(int index, bool is_ref);
@@ -602,12 +610,12 @@ class MIRGraph {
    * IsDebugBuild sanity check: keep track of the Dex PCs for catch entries so that later on
    * we can verify that all catch entries have native PC entries.
    */
-  std::set<uint32_t> catches_;
+  ArenaSet<uint32_t> catches_;
 
   // TODO: make these private.
   RegLocation* reg_location_;                         // Map SSA names to location.
   GrowableArray<CompilerTemp*> compiler_temps_;
-  SafeMap<unsigned int, unsigned int> block_id_map_;  // Block collapse lookup cache.
+  ArenaSafeMap<unsigned int, unsigned int> block_id_map_;  // Block collapse lookup cache.
 
   static const int oat_data_flow_attributes_[kMirOpLast];
   static const char* extended_mir_op_names_[kMirOpLast - kMirOpFirst];
@@ -662,6 +670,12 @@ class MIRGraph {
   bool BasicBlockOpt(BasicBlock* bb);
   bool EliminateNullChecks(BasicBlock* bb);
   void NullCheckEliminationInit(BasicBlock* bb);
+  bool EliminateClassInitChecks(BasicBlock* bb);
+  bool IsNonNegativeIndex(int s_reg, BasicBlock* bounded_bb, MIR** defs,
+                          BasicBlock** def_blocks);
+  ArenaBitVector* FindNaturalLoop(BasicBlock* header);
+  void ComputeLoopNesting();
+  bool InlineCall(BasicBlock* bb, MIR* invoke);
   bool BuildExtendedBBList(struct BasicBlock* bb);
   bool FillDefBlockMatrix(BasicBlock* bb);
   void InitializeDominationInfo(BasicBlock* bb);
@@ -672,6 +686,10 @@ class MIRGraph {
   bool InsertPhiNodeOperands(BasicBlock* bb);
   bool ComputeDominanceFrontier(BasicBlock* bb);
   void DoConstantPropogation(BasicBlock* bb);
+  void RewriteArithmetic(MIR* mir, Instruction::Code opcode, int src_sreg, int32_t lit);
+  void ReduceArithmetic(MIR* mir);
+  bool FoldBranch(BasicBlock* bb, MIR* mir);
+  void RemoveUnreachableBlocks();
   void CountChecks(BasicBlock* bb);
   bool CombineBlocks(BasicBlock* bb);
   void AnalyzeBlock(BasicBlock* bb, struct MethodStats* stats);
@@ -697,6 +715,10 @@ class MIRGraph {
   ArenaBitVector* temp_block_v_;
   ArenaBitVector* temp_dalvik_register_v_;
   ArenaBitVector* temp_ssa_register_v_;  // num_ssa_regs.
+  // Dense index of each field accessed by SGET/SPUT, used by the class init check elimination.
+  ArenaSafeMap<uint32_t, uint32_t> static_field_index_map_;
+  ArenaBitVector* temp_clinit_check_v_;  // static_field_index_map_.size().
+  bool global_value_numbered_;  // The checks were already value numbered over the whole method.
   static const int kInvalidEntry = -1;
   GrowableArray<BasicBlock*> block_list_;
   ArenaBitVector* try_block_addr_;
@@ -705,7 +727,7 @@ class MIRGraph {
   BasicBlock* cur_block_;
   int num_blocks_;
   const DexFile::CodeItem* current_code_item_;
-  SafeMap<unsigned int, BasicBlock*> block_map_;  // FindBlock lookup cache.
+  ArenaSafeMap<unsigned int, BasicBlock*> block_map_;  // FindBlock lookup cache.
   std::vector<DexCompilationUnit*> m_units_;     // List of methods included in this graph
   typedef std::pair<int, int> MIRLocation;       // Insert point, (m_unit_ index, offset)
   std::vector<MIRLocation> method_stack_;        // Include stack
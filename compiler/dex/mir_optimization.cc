@@ -36,6 +36,110 @@ void MIRGraph::SetConstantWide(int ssa_reg, int64_t value) {
   constant_values_[ssa_reg + 1] = High32Bits(value);
 }
 
+/*
+ * Evaluate the int operation opcode on constant operands with the semantics of Java. src2 is the
+ * second register or the literal, unary operations ignore it. Returns false if the operation
+ * isn't folded, like a division by zero which has to throw.
+ */
+static bool FoldIntOperation(Instruction::Code opcode, int32_t src1, int32_t src2,
+                             int32_t* result) {
+  // Wrap around on overflow like Java does.
+  uint32_t a = static_cast<uint32_t>(src1);
+  uint32_t b = static_cast<uint32_t>(src2);
+  switch (opcode) {
+    case Instruction::NEG_INT:
+      *result = static_cast<int32_t>(0U - a);
+      break;
+    case Instruction::NOT_INT:
+      *result = static_cast<int32_t>(~a);
+      break;
+    case Instruction::INT_TO_BYTE:
+      *result = static_cast<int8_t>(src1);
+      break;
+    case Instruction::INT_TO_CHAR:
+      *result = static_cast<uint16_t>(src1);
+      break;
+    case Instruction::INT_TO_SHORT:
+      *result = static_cast<int16_t>(src1);
+      break;
+    case Instruction::ADD_INT:
+    case Instruction::ADD_INT_2ADDR:
+    case Instruction::ADD_INT_LIT16:
+    case Instruction::ADD_INT_LIT8:
+      *result = static_cast<int32_t>(a + b);
+      break;
+    case Instruction::SUB_INT:
+    case Instruction::SUB_INT_2ADDR:
+      *result = static_cast<int32_t>(a - b);
+      break;
+    case Instruction::RSUB_INT:
+    case Instruction::RSUB_INT_LIT8:
+      *result = static_cast<int32_t>(b - a);
+      break;
+    case Instruction::MUL_INT:
+    case Instruction::MUL_INT_2ADDR:
+    case Instruction::MUL_INT_LIT16:
+    case Instruction::MUL_INT_LIT8:
+      *result = static_cast<int32_t>(a * b);
+      break;
+    case Instruction::DIV_INT:
+    case Instruction::DIV_INT_2ADDR:
+    case Instruction::DIV_INT_LIT16:
+    case Instruction::DIV_INT_LIT8:
+      if (src2 == 0) {
+        return false;
+      }
+      // Dividing the minimum int by -1 overflows back to the minimum int.
+      *result = (src2 == -1) ? static_cast<int32_t>(0U - a) : src1 / src2;
+      break;
+    case Instruction::REM_INT:
+    case Instruction::REM_INT_2ADDR:
+    case Instruction::REM_INT_LIT16:
+    case Instruction::REM_INT_LIT8:
+      if (src2 == 0) {
+        return false;
+      }
+      *result = (src2 == -1) ? 0 : src1 % src2;
+      break;
+    case Instruction::AND_INT:
+    case Instruction::AND_INT_2ADDR:
+    case Instruction::AND_INT_LIT16:
+    case Instruction::AND_INT_LIT8:
+      *result = static_cast<int32_t>(a & b);
+      break;
+    case Instruction::OR_INT:
+    case Instruction::OR_INT_2ADDR:
+    case Instruction::OR_INT_LIT16:
+    case Instruction::OR_INT_LIT8:
+      *result = static_cast<int32_t>(a | b);
+      break;
+    case Instruction::XOR_INT:
+    case Instruction::XOR_INT_2ADDR:
+    case Instruction::XOR_INT_LIT16:
+    case Instruction::XOR_INT_LIT8:
+      *result = static_cast<int32_t>(a ^ b);
+      break;
+    case Instruction::SHL_INT:
+    case Instruction::SHL_INT_2ADDR:
+    case Instruction::SHL_INT_LIT8:
+      *result = static_cast<int32_t>(a << (b & 31));
+      break;
+    case Instruction::SHR_INT:
+    case Instruction::SHR_INT_2ADDR:
+    case Instruction::SHR_INT_LIT8:
+      *result = src1 >> (b & 31);
+      break;
+    case Instruction::USHR_INT:
+    case Instruction::USHR_INT_2ADDR:
+    case Instruction::USHR_INT_LIT8:
+      *result = static_cast<int32_t>(a >> (b & 31));
+      break;
+    default:
+      return false;
+  }
+  return true;
+}
+
 void MIRGraph::DoConstantPropogation(BasicBlock* bb) {
   MIR* mir;
 
@@ -87,21 +191,414 @@ void MIRGraph::DoConstantPropogation(BasicBlock* bb) {
           SetConstant(mir->ssa_rep->defs[1], constant_values_[mir->ssa_rep->uses[1]]);
         }
       }
+    } else if (d_insn->opcode == Instruction::CMP_LONG) {
+      /* Compare wide constants, the high words follow the low words */
+      int src1 = mir->ssa_rep->uses[0];
+      int src2 = mir->ssa_rep->uses[2];
+      if (is_constant_v_->IsBitSet(src1) && (mir->ssa_rep->uses[1] == src1 + 1) &&
+          is_constant_v_->IsBitSet(src2) && (mir->ssa_rep->uses[3] == src2 + 1)) {
+        int64_t value1 = (static_cast<int64_t>(constant_values_[src1 + 1]) << 32) |
+            Low32Bits(static_cast<int64_t>(constant_values_[src1]));
+        int64_t value2 = (static_cast<int64_t>(constant_values_[src2 + 1]) << 32) |
+            Low32Bits(static_cast<int64_t>(constant_values_[src2]));
+        SetConstant(mir->ssa_rep->defs[0], (value1 == value2) ? 0 : ((value1 < value2) ? -1 : 1));
+      }
+    } else if (!(df_attributes & DF_A_WIDE) && (mir->ssa_rep->num_uses > 0) &&
+               (mir->ssa_rep->num_uses <= 2)) {
+      /* Fold int arithmetic on constants */
+      int i;
+      for (i = 0; i < mir->ssa_rep->num_uses; i++) {
+        if (!is_constant_v_->IsBitSet(mir->ssa_rep->uses[i])) break;
+      }
+      if (i == mir->ssa_rep->num_uses) {
+        int32_t src2 = (mir->ssa_rep->num_uses == 2) ?
+            constant_values_[mir->ssa_rep->uses[1]] : static_cast<int32_t>(d_insn->vC);
+        int32_t result;
+        if (FoldIntOperation(d_insn->opcode, constant_values_[mir->ssa_rep->uses[0]], src2,
+                             &result)) {
+          SetConstant(mir->ssa_rep->defs[0], result);
+        }
+      }
     }
   }
-  /* TODO: implement code to handle arithmetic operations */
 }
 
 void MIRGraph::PropagateConstants() {
   is_constant_v_ = new (arena_) ArenaBitVector(arena_, GetNumSSARegs(), false);
   constant_values_ = static_cast<int*>(arena_->Alloc(sizeof(int) * GetNumSSARegs(),
                                                      ArenaAllocator::kAllocDFInfo));
-  AllNodesIterator iter(this, false /* not iterative */);
+  // In pre-order the definitions of the operands outside of loops are visited first.
+  PreOrderDfsIterator iter(this, false /* not iterative */);
   for (BasicBlock* bb = iter.Next(); bb != NULL; bb = iter.Next()) {
     DoConstantPropogation(bb);
   }
 }
 
+/*
+ * Rewrite mir, defining an int, as opcode applied to src_sreg and the literal lit, or as the
+ * constant lit if src_sreg is INVALID_SREG.
+ */
+void MIRGraph::RewriteArithmetic(MIR* mir, Instruction::Code opcode, int src_sreg, int32_t lit) {
+  if (cu_->verbose) {
+    LOG(INFO) << "Rewriting " << Instruction::Name(mir->dalvikInsn.opcode) << " at 0x"
+              << std::hex << mir->offset << " as " << Instruction::Name(opcode);
+  }
+  mir->dalvikInsn.opcode = opcode;
+  if (src_sreg == INVALID_SREG) {
+    mir->dalvikInsn.vB = lit;
+    mir->ssa_rep->num_uses = 0;
+    SetConstant(mir->ssa_rep->defs[0], lit);
+  } else {
+    mir->dalvikInsn.vB = SRegToVReg(src_sreg);
+    mir->dalvikInsn.vC = lit;
+    mir->ssa_rep->uses[0] = src_sreg;
+    mir->ssa_rep->fp_use[0] = false;
+    mir->ssa_rep->num_uses = 1;
+  }
+}
+
+/*
+ * Replace int arithmetic on constants by the constant result, and arithmetic with one constant
+ * operand by something cheaper when there is: identities by moves, multiplications by powers of
+ * two by shifts, and divisions by the literal forms, which need no zero check and which every
+ * backend lowers to shifts or multiplications where it can.
+ */
+void MIRGraph::ReduceArithmetic(MIR* mir) {
+  Instruction::Code opcode = mir->dalvikInsn.opcode;
+  if (static_cast<int>(opcode) >= kNumPackedOpcodes) {
+    return;
+  }
+  int df_attributes = oat_data_flow_attributes_[opcode];
+  SSARepresentation* ssa_rep = mir->ssa_rep;
+  if (!(df_attributes & DF_DA) || (df_attributes & (DF_A_WIDE | DF_SETS_CONST | DF_IS_MOVE)) ||
+      (ssa_rep->num_defs != 1) || (ssa_rep->num_uses == 0)) {
+    return;
+  }
+  if (IsConst(ssa_rep->defs[0])) {
+    RewriteArithmetic(mir, Instruction::CONST, INVALID_SREG, ConstantValue(ssa_rep->defs[0]));
+    return;
+  }
+  // Find the operand and the constant, and whether the literal form is already used.
+  int src;
+  int32_t lit;
+  bool literal_form = false;
+  switch (opcode) {
+    case Instruction::ADD_INT:
+    case Instruction::ADD_INT_2ADDR:
+    case Instruction::MUL_INT:
+    case Instruction::MUL_INT_2ADDR:
+    case Instruction::AND_INT:
+    case Instruction::AND_INT_2ADDR:
+    case Instruction::OR_INT:
+    case Instruction::OR_INT_2ADDR:
+    case Instruction::XOR_INT:
+    case Instruction::XOR_INT_2ADDR:
+      if (IsConst(ssa_rep->uses[0])) {
+        src = ssa_rep->uses[1];
+        lit = ConstantValue(ssa_rep->uses[0]);
+        break;
+      }
+      // Intended fallthrough
+    case Instruction::SUB_INT:
+    case Instruction::SUB_INT_2ADDR:
+    case Instruction::DIV_INT:
+    case Instruction::DIV_INT_2ADDR:
+    case Instruction::REM_INT:
+    case Instruction::REM_INT_2ADDR:
+    case Instruction::SHL_INT:
+    case Instruction::SHL_INT_2ADDR:
+    case Instruction::SHR_INT:
+    case Instruction::SHR_INT_2ADDR:
+    case Instruction::USHR_INT:
+    case Instruction::USHR_INT_2ADDR:
+      if (!IsConst(ssa_rep->uses[1])) {
+        return;
+      }
+      src = ssa_rep->uses[0];
+      lit = ConstantValue(ssa_rep->uses[1]);
+      break;
+    case Instruction::ADD_INT_LIT16:
+    case Instruction::ADD_INT_LIT8:
+    case Instruction::MUL_INT_LIT16:
+    case Instruction::MUL_INT_LIT8:
+    case Instruction::DIV_INT_LIT16:
+    case Instruction::DIV_INT_LIT8:
+    case Instruction::REM_INT_LIT16:
+    case Instruction::REM_INT_LIT8:
+    case Instruction::AND_INT_LIT16:
+    case Instruction::AND_INT_LIT8:
+    case Instruction::OR_INT_LIT16:
+    case Instruction::OR_INT_LIT8:
+    case Instruction::XOR_INT_LIT16:
+    case Instruction::XOR_INT_LIT8:
+    case Instruction::SHL_INT_LIT8:
+    case Instruction::SHR_INT_LIT8:
+    case Instruction::USHR_INT_LIT8:
+      src = ssa_rep->uses[0];
+      lit = static_cast<int32_t>(mir->dalvikInsn.vC);
+      literal_form = true;
+      break;
+    default:
+      return;
+  }
+  bool fits_literal = (lit >= -32768) && (lit <= 32767);
+  switch (opcode) {
+    case Instruction::MUL_INT:
+    case Instruction::MUL_INT_2ADDR:
+    case Instruction::MUL_INT_LIT16:
+    case Instruction::MUL_INT_LIT8:
+      if (lit == 0) {
+        RewriteArithmetic(mir, Instruction::CONST, INVALID_SREG, 0);
+      } else if (lit == 1) {
+        RewriteArithmetic(mir, Instruction::MOVE, src, 0);
+      } else if (lit == -1) {
+        RewriteArithmetic(mir, Instruction::NEG_INT, src, 0);
+      } else if ((lit > 0) && IsPowerOfTwo(lit)) {
+        RewriteArithmetic(mir, Instruction::SHL_INT_LIT8, src, CTZ(lit));
+      }
+      break;
+    case Instruction::DIV_INT:
+    case Instruction::DIV_INT_2ADDR:
+    case Instruction::DIV_INT_LIT16:
+    case Instruction::DIV_INT_LIT8:
+      if (lit == 1) {
+        RewriteArithmetic(mir, Instruction::MOVE, src, 0);
+      } else if (lit == -1) {
+        RewriteArithmetic(mir, Instruction::NEG_INT, src, 0);
+      } else if ((lit != 0) && fits_literal && !literal_form) {
+        RewriteArithmetic(mir, Instruction::DIV_INT_LIT16, src, lit);
+      }
+      break;
+    case Instruction::REM_INT:
+    case Instruction::REM_INT_2ADDR:
+    case Instruction::REM_INT_LIT16:
+    case Instruction::REM_INT_LIT8:
+      if ((lit == 1) || (lit == -1)) {
+        RewriteArithmetic(mir, Instruction::CONST, INVALID_SREG, 0);
+      } else if ((lit != 0) && fits_literal && !literal_form) {
+        RewriteArithmetic(mir, Instruction::REM_INT_LIT16, src, lit);
+      }
+      break;
+    case Instruction::AND_INT:
+    case Instruction::AND_INT_2ADDR:
+    case Instruction::AND_INT_LIT16:
+    case Instruction::AND_INT_LIT8:
+      if (lit == 0) {
+        RewriteArithmetic(mir, Instruction::CONST, INVALID_SREG, 0);
+      } else if (lit == -1) {
+        RewriteArithmetic(mir, Instruction::MOVE, src, 0);
+      }
+      break;
+    case Instruction::OR_INT:
+    case Instruction::OR_INT_2ADDR:
+    case Instruction::OR_INT_LIT16:
+    case Instruction::OR_INT_LIT8:
+      if (lit == -1) {
+        RewriteArithmetic(mir, Instruction::CONST, INVALID_SREG, -1);
+      } else if (lit == 0) {
+        RewriteArithmetic(mir, Instruction::MOVE, src, 0);
+      }
+      break;
+    case Instruction::SHL_INT:
+    case Instruction::SHL_INT_2ADDR:
+    case Instruction::SHL_INT_LIT8:
+    case Instruction::SHR_INT:
+    case Instruction::SHR_INT_2ADDR:
+    case Instruction::SHR_INT_LIT8:
+    case Instruction::USHR_INT:
+    case Instruction::USHR_INT_2ADDR:
+    case Instruction::USHR_INT_LIT8:
+      // Only the low five bits of the shift count count.
+      if ((lit & 31) == 0) {
+        RewriteArithmetic(mir, Instruction::MOVE, src, 0);
+      }
+      break;
+    default:
+      // Addition, subtraction and exclusive or.
+      if (lit == 0) {
+        RewriteArithmetic(mir, Instruction::MOVE, src, 0);
+      }
+      break;
+  }
+}
+
+// Returns whether the conditional branch opcode is taken for the operands src1 and src2.
+static bool IsBranchTaken(Instruction::Code opcode, int32_t src1, int32_t src2) {
+  switch (opcode) {
+    case Instruction::IF_EQ:
+    case Instruction::IF_EQZ:
+      return src1 == src2;
+    case Instruction::IF_NE:
+    case Instruction::IF_NEZ:
+      return src1 != src2;
+    case Instruction::IF_LT:
+    case Instruction::IF_LTZ:
+      return src1 < src2;
+    case Instruction::IF_GE:
+    case Instruction::IF_GEZ:
+      return src1 >= src2;
+    case Instruction::IF_GT:
+    case Instruction::IF_GTZ:
+      return src1 > src2;
+    case Instruction::IF_LE:
+    case Instruction::IF_LEZ:
+      return src1 <= src2;
+    default:
+      LOG(FATAL) << "Unexpected opcode " << opcode;
+      return false;
+  }
+}
+
+// Remove pred from the predecessors of bb, with the Phi operands coming from it.
+static void RemovePredecessor(BasicBlock* bb, BasicBlock* pred) {
+  bool found = false;
+  GrowableArray<BasicBlock*>::Iterator iter(bb->predecessors);
+  for (BasicBlock* other = iter.Next(); other != NULL; other = iter.Next()) {
+    found |= (other == pred);
+  }
+  if (!found) {
+    return;
+  }
+  bb->predecessors->Delete(pred);
+  for (MIR* mir = bb->first_mir_insn; mir != NULL; mir = mir->next) {
+    if (static_cast<int>(mir->dalvikInsn.opcode) != kMirOpPhi) {
+      continue;
+    }
+    int* incoming = reinterpret_cast<int*>(mir->dalvikInsn.vB);
+    for (int i = 0; i < mir->ssa_rep->num_uses; i++) {
+      if (incoming[i] == pred->id) {
+        int last_slot = mir->ssa_rep->num_uses - 1;
+        mir->ssa_rep->uses[i] = mir->ssa_rep->uses[last_slot];
+        mir->ssa_rep->fp_use[i] = mir->ssa_rep->fp_use[last_slot];
+        incoming[i] = incoming[last_slot];
+        mir->ssa_rep->num_uses--;
+        break;
+      }
+    }
+  }
+}
+
+/*
+ * Replace a conditional branch on constants by a goto to the successor it always takes, or by a
+ * nop falling through. Returns true if the branch was folded.
+ */
+bool MIRGraph::FoldBranch(BasicBlock* bb, MIR* mir) {
+  Instruction::Code opcode = mir->dalvikInsn.opcode;
+  if ((opcode < Instruction::IF_EQ) || (opcode > Instruction::IF_LEZ) || (bb->taken == NULL) ||
+      (bb->fall_through == NULL) || (bb->taken == bb->fall_through) ||
+      !IsConst(mir->ssa_rep->uses[0])) {
+    return false;
+  }
+  int32_t src2 = 0;
+  if (opcode <= Instruction::IF_LE) {
+    if (!IsConst(mir->ssa_rep->uses[1])) {
+      return false;
+    }
+    src2 = ConstantValue(mir->ssa_rep->uses[1]);
+  }
+  bool taken = IsBranchTaken(opcode, ConstantValue(mir->ssa_rep->uses[0]), src2);
+  if (cu_->verbose) {
+    LOG(INFO) << "Folding branch at 0x" << std::hex << mir->offset << " to "
+              << (taken ? "taken" : "fall-through");
+  }
+  BasicBlock* dead_succ;
+  if (taken) {
+    mir->dalvikInsn.opcode = Instruction::GOTO;
+    dead_succ = bb->fall_through;
+    bb->fall_through = NULL;
+  } else {
+    mir->dalvikInsn.opcode = static_cast<Instruction::Code>(kMirOpNop);
+    dead_succ = bb->taken;
+    bb->taken = NULL;
+  }
+  mir->ssa_rep->num_uses = 0;
+  bb->conditional_branch = false;
+  RemovePredecessor(dead_succ, bb);
+  return true;
+}
+
+/*
+ * Kill the blocks no longer reachable from the entry, and update the DFS orders and dominators
+ * of the rest.
+ */
+void MIRGraph::RemoveUnreachableBlocks() {
+  ArenaBitVector* unreachable = new (arena_) ArenaBitVector(arena_, GetNumBlocks(), false);
+  ReachableNodesIterator iter(this, false /* not iterative */);
+  for (BasicBlock* bb = iter.Next(); bb != NULL; bb = iter.Next()) {
+    unreachable->SetBit(bb->id);
+  }
+  ComputeDFSOrders();
+  ReachableNodesIterator iter2(this, false /* not iterative */);
+  for (BasicBlock* bb = iter2.Next(); bb != NULL; bb = iter2.Next()) {
+    unreachable->ClearBit(bb->id);
+  }
+  ArenaBitVector::Iterator dead_iter(unreachable);
+  for (int idx = dead_iter.Next(); idx != -1; idx = dead_iter.Next()) {
+    BasicBlock* bb = GetBasicBlock(idx);
+    if (bb->block_type == kExitBlock) {
+      continue;
+    }
+    if (cu_->verbose) {
+      LOG(INFO) << "Removing unreachable block at 0x" << std::hex << bb->start_offset;
+    }
+    if (bb->taken != NULL) {
+      RemovePredecessor(bb->taken, bb);
+    }
+    if (bb->fall_through != NULL) {
+      RemovePredecessor(bb->fall_through, bb);
+    }
+    if (bb->successor_block_list.block_list_type != kNotUsed) {
+      GrowableArray<SuccessorBlockInfo*>::Iterator succ_iter(bb->successor_block_list.blocks);
+      for (SuccessorBlockInfo* sbi = succ_iter.Next(); sbi != NULL; sbi = succ_iter.Next()) {
+        RemovePredecessor(sbi->block, bb);
+      }
+    }
+    for (MIR* mir = bb->first_mir_insn; mir != NULL; mir = mir->next) {
+      mir->dalvikInsn.opcode = static_cast<Instruction::Code>(kMirOpNop);
+      if (mir->ssa_rep != NULL) {
+        mir->ssa_rep->num_uses = 0;
+        mir->ssa_rep->num_defs = 0;
+      }
+    }
+    // No native code for the handler, so no catch entry.
+    if (bb->catch_entry) {
+      catches_.erase(bb->start_offset);
+    }
+    bb->block_type = kDead;
+  }
+  ComputeDominators();
+}
+
+/*
+ * Fold the arithmetic and the branches on constants and reduce the strength of the arithmetic
+ * with a constant operand, for all backends alike. Constant propagation must have run.
+ */
+void MIRGraph::ConstantFolding() {
+  if (cu_->disable_opt & (1 << kConstantFolding)) {
+    return;
+  }
+  bool branch_folded = false;
+  PreOrderDfsIterator iter(this, false /* not iterative */);
+  for (BasicBlock* bb = iter.Next(); bb != NULL; bb = iter.Next()) {
+    if (bb->data_flow_info == NULL) {
+      continue;
+    }
+    for (MIR* mir = bb->first_mir_insn; mir != NULL; mir = mir->next) {
+      if (mir->ssa_rep == NULL) {
+        continue;
+      }
+      if (FoldBranch(bb, mir)) {
+        branch_folded = true;
+      } else {
+        ReduceArithmetic(mir);
+      }
+    }
+  }
+  if (branch_folded) {
+    RemoveUnreachableBlocks();
+  }
+}
+
 /* Advance to next strictly dominated MIR node in an extended basic block */
 static MIR* AdvanceMIR(BasicBlock** p_bb, MIR* mir) {
   BasicBlock* bb = *p_bb;
@@ -218,7 +715,9 @@ bool MIRGraph::BasicBlockOpt(BasicBlock* bb) {
   while (bb != NULL) {
     for (MIR* mir = bb->first_mir_insn; mir != NULL; mir = mir->next) {
       // TUNING: use the returned value number for CSE.
-      local_valnum.GetValueNumber(mir);
+      if (!global_value_numbered_) {
+        local_valnum.GetValueNumber(mir);
+      }
       // Look for interesting opcodes, skip otherwise
       Instruction::Code opcode = mir->dalvikInsn.opcode;
       switch (opcode) {
@@ -777,6 +1276,712 @@ void MIRGraph::NullCheckElimination() {
   }
 }
 
+static bool IsStaticFieldAccess(Instruction::Code opcode) {
+  return (opcode >= Instruction::SGET && opcode <= Instruction::SPUT_SHORT);
+}
+
+/*
+ * Eliminate class initialization checks for a basic block.  The checks are
+ * keyed by field rather than by class: the static storage a field access
+ * checks is that of the class which declares the resolved field, and two
+ * fields named through the same class may be declared in different ones.
+ */
+bool MIRGraph::EliminateClassInitChecks(struct BasicBlock* bb) {
+  if (bb->data_flow_info == NULL) return false;
+
+  /*
+   * Set initial state.  Nothing is known to be initialized on entry or when
+   * an exception was thrown, otherwise it is what was initialized on every
+   * incoming arc.
+   */
+  if ((bb->block_type == kEntryBlock) | bb->catch_entry) {
+    temp_clinit_check_v_->ClearAllBits();
+  } else {
+    GrowableArray<BasicBlock*>::Iterator iter(bb->predecessors);
+    BasicBlock* pred_bb = iter.Next();
+    DCHECK(pred_bb != NULL);
+    temp_clinit_check_v_->Copy(pred_bb->data_flow_info->ending_clinit_check_v);
+    while (true) {
+      pred_bb = iter.Next();
+      if (!pred_bb) break;
+      if ((pred_bb->data_flow_info == NULL) ||
+          (pred_bb->data_flow_info->ending_clinit_check_v == NULL)) {
+        continue;
+      }
+      temp_clinit_check_v_->Intersect(pred_bb->data_flow_info->ending_clinit_check_v);
+    }
+  }
+
+  for (MIR* mir = bb->first_mir_insn; mir != NULL; mir = mir->next) {
+    if (!IsStaticFieldAccess(mir->dalvikInsn.opcode)) {
+      continue;
+    }
+    uint32_t index = static_field_index_map_.Get(mir->dalvikInsn.vB);
+    if (temp_clinit_check_v_->IsBitSet(index)) {
+      // An earlier access to the same field already initialized the class
+      mir->optimization_flags |= MIR_IGNORE_CLINIT_CHECK;
+    } else {
+      temp_clinit_check_v_->SetBit(index);
+    }
+  }
+
+  // Did anything change?
+  bool changed = !temp_clinit_check_v_->Equal(bb->data_flow_info->ending_clinit_check_v);
+  if (changed) {
+    bb->data_flow_info->ending_clinit_check_v->Copy(temp_clinit_check_v_);
+  }
+  return changed;
+}
+
+void MIRGraph::ClassInitCheckElimination() {
+  if (cu_->disable_opt & (1 << kClassInitCheckElimination)) {
+    return;
+  }
+  // Give each accessed static field a dense index so that the vectors stay small.
+  AllNodesIterator iter(this, false /* not iterative */);
+  for (BasicBlock* bb = iter.Next(); bb != NULL; bb = iter.Next()) {
+    for (MIR* mir = bb->first_mir_insn; mir != NULL; mir = mir->next) {
+      if (IsStaticFieldAccess(mir->dalvikInsn.opcode) &&
+          static_field_index_map_.find(mir->dalvikInsn.vB) == static_field_index_map_.end()) {
+        uint32_t index = static_field_index_map_.size();
+        static_field_index_map_.Put(mir->dalvikInsn.vB, index);
+      }
+    }
+  }
+  if (static_field_index_map_.empty()) {
+    return;
+  }
+  size_t num_fields = static_field_index_map_.size();
+  temp_clinit_check_v_ =
+      new (arena_) ArenaBitVector(arena_, num_fields, false, kBitMapClInitCheck);
+  AllNodesIterator iter2(this, false /* not iterative */);
+  for (BasicBlock* bb = iter2.Next(); bb != NULL; bb = iter2.Next()) {
+    if (bb->data_flow_info != NULL) {
+      bb->data_flow_info->ending_clinit_check_v =
+          new (arena_) ArenaBitVector(arena_, num_fields, false, kBitMapClInitCheck);
+    }
+  }
+  PreOrderDfsIterator iter3(this, true /* iterative */);
+  bool change = false;
+  for (BasicBlock* bb = iter3.Next(change); bb != NULL; bb = iter3.Next(change)) {
+    change = EliminateClassInitChecks(bb);
+  }
+}
+
+/*
+ * Value number the method in a pre-order walk of the dominator tree, so that a check is dropped
+ * when a dominating block already did it. SSA names are only defined once, so what is known at
+ * the end of the immediate dominator holds on entry to a block. Other paths may store in between
+ * though, so memory is clobbered at merges. A catch block may be entered from the middle of its
+ * dominator and starts from scratch.
+ */
+void MIRGraph::GlobalValueNumbering() {
+  if (cu_->disable_opt & (1 << kGlobalValueNumbering)) {
+    return;
+  }
+  // Value names and memory versions are 16 bits. Give up on methods that may run out of them
+  // and leave them to the per extended basic block value numbering.
+  if (2 * GetNumSSARegs() + 4 * GetNumDalvikInsns() >= ARRAY_REF) {
+    return;
+  }
+  std::vector<std::pair<BasicBlock*, ArenaBitVector::Iterator*> > work_stack;
+  std::vector<LocalValueNumbering*> valnum_stack;
+  BasicBlock* bb = GetEntryBlock();
+  while (true) {
+    if (bb != NULL) {
+      LocalValueNumbering* valnum;
+      if (valnum_stack.empty() || bb->catch_entry) {
+        valnum = new LocalValueNumbering(cu_);
+      } else {
+        valnum = new LocalValueNumbering(*valnum_stack.back());
+        if (Predecessors(bb) != 1) {
+          valnum->ClobberMemory();
+        }
+      }
+      if (bb->data_flow_info != NULL) {
+        for (MIR* mir = bb->first_mir_insn; mir != NULL; mir = mir->next) {
+          valnum->GetValueNumber(mir);
+        }
+      }
+      work_stack.push_back(
+          std::make_pair(bb, new (arena_) ArenaBitVector::Iterator(bb->i_dominated)));
+      valnum_stack.push_back(valnum);
+    }
+    if (work_stack.empty()) {
+      break;
+    }
+    int bb_idx = work_stack.back().second->Next();
+    if (bb_idx != -1) {
+      bb = GetBasicBlock(bb_idx);
+    } else {
+      // Done with all the blocks dominated by this one.
+      bb = NULL;
+      delete valnum_stack.back();
+      valnum_stack.pop_back();
+      work_stack.pop_back();
+    }
+  }
+  global_value_numbered_ = true;
+}
+
+/*
+ * If bb ends in a signed compare and branch, returns the successor that is only entered from bb
+ * when *lesser < *greater. Returns NULL otherwise.
+ */
+static BasicBlock* LessThanSuccessor(BasicBlock* bb, int* lesser, int* greater) {
+  MIR* mir = bb->last_mir_insn;
+  if ((mir == NULL) || (bb->taken == NULL) || (bb->fall_through == NULL) ||
+      (bb->taken == bb->fall_through)) {
+    return NULL;
+  }
+  BasicBlock* succ;
+  bool swap;
+  switch (mir->dalvikInsn.opcode) {
+    case Instruction::IF_LT:
+      succ = bb->taken;
+      swap = false;
+      break;
+    case Instruction::IF_GE:
+      succ = bb->fall_through;
+      swap = false;
+      break;
+    case Instruction::IF_GT:
+      succ = bb->taken;
+      swap = true;
+      break;
+    case Instruction::IF_LE:
+      succ = bb->fall_through;
+      swap = true;
+      break;
+    default:
+      return NULL;
+  }
+  if (Predecessors(succ) != 1) {
+    return NULL;
+  }
+  *lesser = mir->ssa_rep->uses[swap ? 1 : 0];
+  *greater = mir->ssa_rep->uses[swap ? 0 : 1];
+  return succ;
+}
+
+/*
+ * Returns true if the index is never negative: a non-negative constant, or the induction
+ * variable of a loop starting at non-negative constants and only incremented by one in blocks
+ * dominated by bounded_bb. The index is less than an array length there, so it can't overflow.
+ */
+bool MIRGraph::IsNonNegativeIndex(int s_reg, BasicBlock* bounded_bb, MIR** defs,
+                                  BasicBlock** def_blocks) {
+  if (IsConst(s_reg)) {
+    return ConstantValue(s_reg) >= 0;
+  }
+  MIR* phi = defs[s_reg];
+  if ((phi == NULL) || (static_cast<int>(phi->dalvikInsn.opcode) != kMirOpPhi)) {
+    return false;
+  }
+  for (int i = 0; i < phi->ssa_rep->num_uses; i++) {
+    int input = phi->ssa_rep->uses[i];
+    if (IsConst(input)) {
+      if (ConstantValue(input) < 0) {
+        return false;
+      }
+      continue;
+    }
+    MIR* increment = defs[input];
+    if ((increment == NULL) ||
+        ((increment->dalvikInsn.opcode != Instruction::ADD_INT_LIT8) &&
+         (increment->dalvikInsn.opcode != Instruction::ADD_INT_LIT16)) ||
+        (increment->ssa_rep->uses[0] != s_reg) || (increment->dalvikInsn.vC != 1) ||
+        !def_blocks[input]->dominators->IsBitSet(bounded_bb->id)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Eliminate the range checks of counted loops. A block only entered when an index is less
+ * than the length of an array, like the body of "for (int i = 0; i < a.length; i++)", and the
+ * blocks it dominates don't need to check that index into that array if it is never negative.
+ */
+void MIRGraph::RangeCheckElimination() {
+  if (cu_->disable_opt & (1 << kRangeCheckElimination)) {
+    return;
+  }
+  // Find the instruction and block defining each SSA name.
+  int num_ssa_regs = GetNumSSARegs();
+  MIR** defs = static_cast<MIR**>(
+      arena_->Alloc(sizeof(MIR*) * num_ssa_regs, ArenaAllocator::kAllocDFInfo));
+  BasicBlock** def_blocks = static_cast<BasicBlock**>(
+      arena_->Alloc(sizeof(BasicBlock*) * num_ssa_regs, ArenaAllocator::kAllocDFInfo));
+  AllNodesIterator iter(this, false /* not iterative */);
+  for (BasicBlock* bb = iter.Next(); bb != NULL; bb = iter.Next()) {
+    if (bb->data_flow_info == NULL) {
+      continue;
+    }
+    for (MIR* mir = bb->first_mir_insn; mir != NULL; mir = mir->next) {
+      for (int i = 0; (mir->ssa_rep != NULL) && (i < mir->ssa_rep->num_defs); i++) {
+        defs[mir->ssa_rep->defs[i]] = mir;
+        def_blocks[mir->ssa_rep->defs[i]] = bb;
+      }
+    }
+  }
+  // Find the blocks where an index is known to be within an array.
+  struct IndexBound {
+    BasicBlock* bb;
+    int index;
+    int array;
+  };
+  std::vector<IndexBound> bounds;
+  AllNodesIterator iter2(this, false /* not iterative */);
+  for (BasicBlock* bb = iter2.Next(); bb != NULL; bb = iter2.Next()) {
+    if (bb->data_flow_info == NULL) {
+      continue;
+    }
+    int index;
+    int length;
+    BasicBlock* succ = LessThanSuccessor(bb, &index, &length);
+    if ((succ == NULL) || (succ->dominators == NULL) || (defs[length] == NULL) ||
+        (defs[length]->dalvikInsn.opcode != Instruction::ARRAY_LENGTH) ||
+        !IsNonNegativeIndex(index, succ, defs, def_blocks)) {
+      continue;
+    }
+    IndexBound bound = { succ, index, defs[length]->ssa_rep->uses[0] };
+    bounds.push_back(bound);
+  }
+  if (bounds.empty()) {
+    return;
+  }
+  AllNodesIterator iter3(this, false /* not iterative */);
+  for (BasicBlock* bb = iter3.Next(); bb != NULL; bb = iter3.Next()) {
+    if ((bb->data_flow_info == NULL) || (bb->dominators == NULL)) {
+      continue;
+    }
+    for (MIR* mir = bb->first_mir_insn; mir != NULL; mir = mir->next) {
+      Instruction::Code opcode = mir->dalvikInsn.opcode;
+      int array_idx;
+      if ((opcode >= Instruction::AGET) && (opcode <= Instruction::AGET_SHORT)) {
+        array_idx = 0;
+      } else if ((opcode >= Instruction::APUT) && (opcode <= Instruction::APUT_SHORT)) {
+        array_idx = (opcode == Instruction::APUT_WIDE) ? 2 : 1;
+      } else {
+        continue;
+      }
+      int array = mir->ssa_rep->uses[array_idx];
+      int index = mir->ssa_rep->uses[array_idx + 1];
+      for (size_t i = 0; i < bounds.size(); i++) {
+        if ((bounds[i].array == array) && (bounds[i].index == index) &&
+            bb->dominators->IsBitSet(bounds[i].bb->id)) {
+          if (cu_->verbose) {
+            LOG(INFO) << "Removing range check for 0x" << std::hex << mir->offset;
+          }
+          mir->optimization_flags |= MIR_IGNORE_RANGE_CHECK;
+          mir->meta.throw_insn->optimization_flags |= mir->optimization_flags;
+          break;
+        }
+      }
+    }
+  }
+}
+
+/*
+ * Returns the blocks of the natural loop headed by header, the header and the blocks that reach
+ * a back edge to it without going through it. Returns NULL if no back edge goes to header.
+ */
+ArenaBitVector* MIRGraph::FindNaturalLoop(BasicBlock* header) {
+  ArenaBitVector* loop_blocks = NULL;
+  std::vector<BasicBlock*> work_list;
+  GrowableArray<BasicBlock*>::Iterator iter(header->predecessors);
+  for (BasicBlock* pred = iter.Next(); pred != NULL; pred = iter.Next()) {
+    if ((pred->dominators == NULL) || !pred->dominators->IsBitSet(header->id)) {
+      continue;
+    }
+    if (loop_blocks == NULL) {
+      loop_blocks = new (arena_) ArenaBitVector(arena_, GetNumBlocks(), false);
+      loop_blocks->SetBit(header->id);
+    }
+    if (!loop_blocks->IsBitSet(pred->id)) {
+      loop_blocks->SetBit(pred->id);
+      work_list.push_back(pred);
+    }
+  }
+  while (!work_list.empty()) {
+    BasicBlock* bb = work_list.back();
+    work_list.pop_back();
+    GrowableArray<BasicBlock*>::Iterator pred_iter(bb->predecessors);
+    for (BasicBlock* pred = pred_iter.Next(); pred != NULL; pred = pred_iter.Next()) {
+      if (!loop_blocks->IsBitSet(pred->id)) {
+        loop_blocks->SetBit(pred->id);
+        work_list.push_back(pred);
+      }
+    }
+  }
+  return loop_blocks;
+}
+
+/*
+ * Set the nesting depth of every block to the number of natural loops containing it, so that
+ * the uses in inner loops weigh more when choosing the registers to promote.
+ */
+void MIRGraph::ComputeLoopNesting() {
+  AllNodesIterator iter(this, false /* not iterative */);
+  for (BasicBlock* bb = iter.Next(); bb != NULL; bb = iter.Next()) {
+    bb->nesting_depth = 0;
+  }
+  AllNodesIterator header_iter(this, false /* not iterative */);
+  for (BasicBlock* header = header_iter.Next(); header != NULL; header = header_iter.Next()) {
+    if ((header->block_type != kDalvikByteCode) || (header->data_flow_info == NULL)) {
+      continue;
+    }
+    ArenaBitVector* loop_blocks = FindNaturalLoop(header);
+    if (loop_blocks == NULL) {
+      continue;
+    }
+    ArenaBitVector::Iterator loop_iter(loop_blocks);
+    for (int idx = loop_iter.Next(); idx != -1; idx = loop_iter.Next()) {
+      BasicBlock* bb = GetBasicBlock(idx);
+      if (bb->nesting_depth != 0xffff) {
+        bb->nesting_depth++;
+      }
+    }
+  }
+}
+
+/*
+ * Returns the only block entering the loop from outside if it always goes on to the header, so
+ * that instructions can be hoisted into it. Returns NULL otherwise.
+ */
+static BasicBlock* FindPreHeader(BasicBlock* header, ArenaBitVector* loop_blocks) {
+  BasicBlock* pre_header = NULL;
+  GrowableArray<BasicBlock*>::Iterator iter(header->predecessors);
+  for (BasicBlock* pred = iter.Next(); pred != NULL; pred = iter.Next()) {
+    if (!loop_blocks->IsBitSet(pred->id)) {
+      if (pre_header != NULL) {
+        return NULL;
+      }
+      pre_header = pred;
+    }
+  }
+  if ((pre_header == NULL) || (pre_header->block_type != kDalvikByteCode) ||
+      (pre_header->data_flow_info == NULL) ||
+      (pre_header->successor_block_list.block_list_type != kNotUsed) ||
+      ((pre_header->taken != NULL) && (pre_header->fall_through != NULL))) {
+    return NULL;
+  }
+  return pre_header;
+}
+
+/*
+ * Instructions that can be executed early without a visible difference: they can't throw and
+ * only depend on their operands. Compares are left next to the branches they may be fused with.
+ */
+static bool IsHoistable(Instruction::Code opcode) {
+  switch (opcode) {
+    case Instruction::DIV_INT:
+    case Instruction::REM_INT:
+    case Instruction::DIV_LONG:
+    case Instruction::REM_LONG:
+    case Instruction::DIV_INT_2ADDR:
+    case Instruction::REM_INT_2ADDR:
+    case Instruction::DIV_LONG_2ADDR:
+    case Instruction::REM_LONG_2ADDR:
+    case Instruction::DIV_INT_LIT16:
+    case Instruction::REM_INT_LIT16:
+    case Instruction::DIV_INT_LIT8:
+    case Instruction::REM_INT_LIT8:
+      return false;
+    default:
+      break;
+  }
+  return ((opcode >= Instruction::CONST_4) && (opcode <= Instruction::CONST_WIDE_HIGH16)) ||
+      ((opcode >= Instruction::NEG_INT) && (opcode <= Instruction::USHR_INT_LIT8));
+}
+
+/*
+ * Hoist loop invariant constants and arithmetic into the loop pre-headers. Values live in their
+ * Dalvik registers, and the GC maps describe those registers as the verifier saw them, so only
+ * the definitions of registers that are never defined elsewhere and aren't ins are moved: the
+ * register then can't hold anything else, before the original definition it was undefined.
+ */
+void MIRGraph::LoopInvariantCodeMotion() {
+  if (cu_->disable_opt & (1 << kLoopInvariantCodeMotion)) {
+    return;
+  }
+  // Count the definitions of each Dalvik register and find the block defining each SSA name.
+  int num_vregs = cu_->num_dalvik_registers;
+  int* vreg_def_counts = static_cast<int*>(
+      arena_->Alloc(sizeof(int) * num_vregs, ArenaAllocator::kAllocDFInfo));
+  for (int i = num_vregs - cu_->num_ins; i < num_vregs; i++) {
+    vreg_def_counts[i]++;
+  }
+  BasicBlock** def_blocks = static_cast<BasicBlock**>(
+      arena_->Alloc(sizeof(BasicBlock*) * GetNumSSARegs(), ArenaAllocator::kAllocDFInfo));
+  AllNodesIterator iter(this, false /* not iterative */);
+  for (BasicBlock* bb = iter.Next(); bb != NULL; bb = iter.Next()) {
+    if (bb->data_flow_info == NULL) {
+      continue;
+    }
+    for (MIR* mir = bb->first_mir_insn; mir != NULL; mir = mir->next) {
+      for (int i = 0; (mir->ssa_rep != NULL) && (i < mir->ssa_rep->num_defs); i++) {
+        vreg_def_counts[SRegToVReg(mir->ssa_rep->defs[i])]++;
+        def_blocks[mir->ssa_rep->defs[i]] = bb;
+      }
+    }
+  }
+  // Hoisting from an inner loop may make an instruction invariant in the outer one, so repeat
+  // until nothing moves.
+  bool change = true;
+  while (change) {
+    change = false;
+    AllNodesIterator iter2(this, false /* not iterative */);
+    for (BasicBlock* header = iter2.Next(); header != NULL; header = iter2.Next()) {
+      if ((header->block_type != kDalvikByteCode) || (header->data_flow_info == NULL)) {
+        continue;
+      }
+      ArenaBitVector* loop_blocks = FindNaturalLoop(header);
+      if (loop_blocks == NULL) {
+        continue;
+      }
+      BasicBlock* pre_header = FindPreHeader(header, loop_blocks);
+      if (pre_header == NULL) {
+        continue;
+      }
+      ArenaBitVector::Iterator loop_iter(loop_blocks);
+      for (int idx = loop_iter.Next(); idx != -1; idx = loop_iter.Next()) {
+        BasicBlock* bb = GetBasicBlock(idx);
+        if ((bb->block_type == kDead) || (bb->data_flow_info == NULL)) {
+          continue;
+        }
+        MIR* next_mir;
+        for (MIR* mir = bb->first_mir_insn; mir != NULL; mir = next_mir) {
+          next_mir = mir->next;
+          SSARepresentation* ssa_rep = mir->ssa_rep;
+          if (!IsHoistable(mir->dalvikInsn.opcode) || (ssa_rep == NULL) ||
+              (ssa_rep->num_defs == 0)) {
+            continue;
+          }
+          bool invariant = true;
+          for (int i = 0; invariant && (i < ssa_rep->num_defs); i++) {
+            invariant = (vreg_def_counts[SRegToVReg(ssa_rep->defs[i])] == 1);
+          }
+          for (int i = 0; invariant && (i < ssa_rep->num_uses); i++) {
+            BasicBlock* def_bb = def_blocks[ssa_rep->uses[i]];
+            invariant = (def_bb == NULL) || !loop_blocks->IsBitSet(def_bb->id);
+          }
+          if (!invariant) {
+            continue;
+          }
+          if (cu_->verbose) {
+            LOG(INFO) << "Hoisting 0x" << std::hex << mir->offset << " out of the loop at 0x"
+                      << header->start_offset;
+          }
+          // Unlink from the loop block and insert before the pre-header's goto, if any.
+          if (mir->prev != NULL) {
+            mir->prev->next = mir->next;
+          } else {
+            bb->first_mir_insn = mir->next;
+          }
+          if (mir->next != NULL) {
+            mir->next->prev = mir->prev;
+          } else {
+            bb->last_mir_insn = mir->prev;
+          }
+          MIR* last_mir = pre_header->last_mir_insn;
+          if ((last_mir != NULL) && (pre_header->taken != NULL)) {
+            if (last_mir->prev != NULL) {
+              InsertMIRAfter(pre_header, last_mir->prev, mir);
+            } else {
+              PrependMIR(pre_header, mir);
+            }
+          } else {
+            AppendMIR(pre_header, mir);
+          }
+          for (int i = 0; i < ssa_rep->num_defs; i++) {
+            def_blocks[ssa_rep->defs[i]] = pre_header;
+          }
+          change = true;
+        }
+      }
+    }
+  }
+}
+
+// Returns the Dalvik register holding word i of the arguments of an invoke.
+static uint32_t InvokeArg(MIR* invoke, bool is_range, int i) {
+  return is_range ? invoke->dalvikInsn.vC + i : invoke->dalvikInsn.arg[i];
+}
+
+/*
+ * Replace the invoke by the callee's only instruction if the callee is a getter or a setter
+ * of an argument, or a static method of the compiling method's class returning a constant or
+ * an argument. The only exception any of them can throw is the null pointer exception for the
+ * receiver, which the invoke threw at the same dex pc, and they aren't safepoints, so the stack
+ * traces and GC maps stay the same. Returns true if the invoke was replaced.
+ */
+bool MIRGraph::InlineCall(BasicBlock* bb, MIR* invoke) {
+  InvokeType type;
+  bool is_range = false;
+  switch (invoke->dalvikInsn.opcode) {
+    case Instruction::INVOKE_STATIC_RANGE:
+      is_range = true;
+      // Fall-through.
+    case Instruction::INVOKE_STATIC:
+      type = kStatic;
+      break;
+    case Instruction::INVOKE_DIRECT_RANGE:
+      is_range = true;
+      // Fall-through.
+    case Instruction::INVOKE_DIRECT:
+      type = kDirect;
+      break;
+    case Instruction::INVOKE_VIRTUAL_RANGE:
+      is_range = true;
+      // Fall-through.
+    case Instruction::INVOKE_VIRTUAL:
+      type = kVirtual;
+      break;
+    case Instruction::INVOKE_SUPER_RANGE:
+      is_range = true;
+      // Fall-through.
+    case Instruction::INVOKE_SUPER:
+      type = kSuper;
+      break;
+    default:
+      return false;
+  }
+  // Only calls that always go to the same method can be inlined.
+  DexCompilationUnit m_unit(cu_);
+  MethodReference target_method(cu_->dex_file, invoke->dalvikInsn.vB);
+  InvokeType sharp_type = type;
+  int vtable_idx;
+  uintptr_t direct_code;
+  uintptr_t direct_method;
+  if (!cu_->compiler_driver->ComputeInvokeInfo(&m_unit, invoke->offset, sharp_type,
+                                               target_method, vtable_idx, direct_code,
+                                               direct_method, false) ||
+      ((sharp_type != kDirect) && (sharp_type != kStatic))) {
+    return false;
+  }
+  bool is_referrers_class;
+  const DexFile::CodeItem* code_item =
+      cu_->compiler_driver->GetInlinableCodeItem(&m_unit, target_method, type,
+                                                 is_referrers_class);
+  if (code_item == NULL) {
+    return false;
+  }
+  // A static method of another class may need its class initialized first.
+  if ((type == kStatic) && !is_referrers_class) {
+    return false;
+  }
+  MIR* move_result = FindMoveResult(bb, invoke);
+  const uint32_t first_in = code_item->registers_size_ - code_item->ins_size_;
+  const Instruction* first = Instruction::At(code_item->insns_);
+  DecodedInstruction insn(first);
+  uint32_t first_size = first->SizeInCodeUnits();
+  if ((type == kStatic) && (first_size == code_item->insns_size_in_code_units_)) {
+    // Returns an argument.
+    if ((move_result == NULL) || (insn.vA < first_in)) {
+      return false;
+    }
+    uint32_t arg = insn.vA - first_in;
+    switch (insn.opcode) {
+      case Instruction::RETURN:
+        insn.opcode = Instruction::MOVE;
+        break;
+      case Instruction::RETURN_OBJECT:
+        insn.opcode = Instruction::MOVE_OBJECT;
+        break;
+      case Instruction::RETURN_WIDE:
+        if (InvokeArg(invoke, is_range, arg + 1) != InvokeArg(invoke, is_range, arg) + 1) {
+          return false;
+        }
+        insn.opcode = Instruction::MOVE_WIDE;
+        break;
+      default:
+        return false;
+    }
+    insn.vB = InvokeArg(invoke, is_range, arg);
+    insn.vA = move_result->dalvikInsn.vA;
+  } else {
+    if (first_size >= code_item->insns_size_in_code_units_) {
+      return false;
+    }
+    const Instruction* second = first->Next();
+    if (first_size + second->SizeInCodeUnits() != code_item->insns_size_in_code_units_) {
+      return false;
+    }
+    DecodedInstruction ret(second);
+    if ((type != kStatic) && (insn.opcode >= Instruction::IGET) &&
+        (insn.opcode <= Instruction::IGET_SHORT)) {
+      // Getter.
+      if ((move_result == NULL) || (insn.vB != first_in) ||
+          (ret.opcode < Instruction::RETURN) || (ret.opcode > Instruction::RETURN_OBJECT) ||
+          (ret.vA != insn.vA)) {
+        return false;
+      }
+      insn.vA = move_result->dalvikInsn.vA;
+    } else if ((type != kStatic) && (insn.opcode >= Instruction::IPUT) &&
+               (insn.opcode <= Instruction::IPUT_SHORT)) {
+      // Setter of the first argument.
+      if ((insn.vB != first_in) || (insn.vA != first_in + 1) ||
+          (ret.opcode != Instruction::RETURN_VOID)) {
+        return false;
+      }
+      if ((insn.opcode == Instruction::IPUT_WIDE) &&
+          (InvokeArg(invoke, is_range, 2) != InvokeArg(invoke, is_range, 1) + 1)) {
+        return false;
+      }
+      insn.vA = InvokeArg(invoke, is_range, 1);
+    } else if ((type == kStatic) && (insn.opcode >= Instruction::CONST_4) &&
+               (insn.opcode <= Instruction::CONST_HIGH16)) {
+      // Returns a constant.
+      if ((move_result == NULL) || ((ret.opcode != Instruction::RETURN) &&
+                                    (ret.opcode != Instruction::RETURN_OBJECT)) ||
+          (ret.vA != insn.vA)) {
+        return false;
+      }
+      insn.vA = move_result->dalvikInsn.vA;
+    } else {
+      return false;
+    }
+    if (type != kStatic) {
+      // The caller must be able to access the field itself.
+      int field_offset;
+      bool is_volatile;
+      bool is_put = (insn.opcode >= Instruction::IPUT);
+      if (!cu_->compiler_driver->ComputeInstanceFieldInfo(insn.vC, &m_unit, field_offset,
+                                                          is_volatile, is_put)) {
+        return false;
+      }
+      insn.vB = InvokeArg(invoke, is_range, 0);
+    }
+  }
+  if (cu_->verbose) {
+    LOG(INFO) << "Inlining " << PrettyMethod(target_method.dex_method_index, *cu_->dex_file)
+              << " at 0x" << std::hex << invoke->offset;
+  }
+  invoke->dalvikInsn = insn;
+  if (move_result != NULL) {
+    move_result->dalvikInsn.opcode = static_cast<Instruction::Code>(kMirOpNop);
+  }
+  return true;
+}
+
+void MIRGraph::InlineCalls() {
+  if ((cu_->disable_opt & (1 << kInlineCalls)) ||
+      (cu_->enable_debug & (1 << kDebugSlowInvokePath))) {
+    return;
+  }
+  AllNodesIterator iter(this, false /* not iterative */);
+  for (BasicBlock* bb = iter.Next(); bb != NULL; bb = iter.Next()) {
+    if (bb->block_type != kDalvikByteCode) {
+      continue;
+    }
+    for (MIR* mir = bb->first_mir_insn; mir != NULL; mir = mir->next) {
+      InlineCall(bb, mir);
+    }
+  }
+}
+
 void MIRGraph::BasicBlockCombine() {
   PreOrderDfsIterator iter(this, false /* not iterative */);
   for (BasicBlock* bb = iter.Next(); bb != NULL; bb = iter.Next()) {
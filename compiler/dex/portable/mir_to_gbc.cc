@@ -1565,7 +1565,7 @@ void MirConverter::HandlePhiNodes(BasicBlock* bb, ::llvm::BasicBlock* llvm_bb) {
       DCHECK_EQ(rl_dest.fp, loc.fp);
       DCHECK_EQ(rl_dest.core, loc.core);
       DCHECK_EQ(rl_dest.ref, loc.ref);
-      SafeMap<unsigned int, unsigned int>::iterator it;
+      ArenaSafeMap<unsigned int, unsigned int>::iterator it;
       it = mir_graph_->block_id_map_.find(incoming[i]);
       DCHECK(it != mir_graph_->block_id_map_.end());
       DCHECK(GetLLVMValue(loc.orig_sreg) != NULL);
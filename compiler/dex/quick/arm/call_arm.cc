@@ -131,7 +131,9 @@ MIR* ArmMir2Lir::SpecialIGet(BasicBlock** bb, MIR* mir,
   bool is_volatile;
   uint32_t field_idx = mir->dalvikInsn.vC;
   bool fast_path = FastInstance(field_idx, field_offset, is_volatile, false);
-  if (!fast_path || !(mir->optimization_flags & MIR_IGNORE_NULL_CHECK)) {
+  // The exclusive accesses of volatile wide fields need more temps than the locked args leave.
+  if (!fast_path || !(mir->optimization_flags & MIR_IGNORE_NULL_CHECK) ||
+      (long_or_double && is_volatile)) {
     return NULL;
   }
   RegLocation rl_obj = mir_graph_->GetSrc(mir, 0);
@@ -156,7 +158,9 @@ MIR* ArmMir2Lir::SpecialIPut(BasicBlock** bb, MIR* mir,
   bool is_volatile;
   uint32_t field_idx = mir->dalvikInsn.vC;
   bool fast_path = FastInstance(field_idx, field_offset, is_volatile, false);
-  if (!fast_path || !(mir->optimization_flags & MIR_IGNORE_NULL_CHECK)) {
+  // The exclusive accesses of volatile wide fields need more temps than the locked args leave.
+  if (!fast_path || !(mir->optimization_flags & MIR_IGNORE_NULL_CHECK) ||
+      (long_or_double && is_volatile)) {
     return NULL;
   }
   RegLocation rl_src;
@@ -314,6 +318,10 @@ void ArmMir2Lir::GenSparseSwitch(MIR* mir, uint32_t table_offset,
   if (cu_->verbose) {
     DumpSparseSwitchTable(table);
   }
+  if (table[1] <= kSmallSparseSwitchEntries) {
+    GenSparseSwitchSearch(table, rl_src);
+    return;
+  }
   // Add the table to the list - we'll process it later
   SwitchTable *tab_rec =
       static_cast<SwitchTable*>(arena_->Alloc(sizeof(SwitchTable), ArenaAllocator::kAllocData));
@@ -540,13 +548,18 @@ void ArmMir2Lir::GenMoveException(RegLocation rl_dest) {
 void ArmMir2Lir::MarkGCCard(int val_reg, int tgt_addr_reg) {
   int reg_card_base = AllocTemp();
   int reg_card_no = AllocTemp();
-  LIR* branch_over = OpCmpImmBranch(kCondEq, val_reg, 0, NULL);
+  LIR* branch_over = NULL;
+  if (val_reg != INVALID_REG) {
+    branch_over = OpCmpImmBranch(kCondEq, val_reg, 0, NULL);
+  }
   LoadWordDisp(rARM_SELF, Thread::CardTableOffset().Int32Value(), reg_card_base);
   OpRegRegImm(kOpLsr, reg_card_no, tgt_addr_reg, gc::accounting::CardTable::kCardShift);
   StoreBaseIndexed(reg_card_base, reg_card_no, reg_card_base, 0,
                    kUnsignedByte);
-  LIR* target = NewLIR0(kPseudoTargetLabel);
-  branch_over->target = target;
+  if (branch_over != NULL) {
+    LIR* target = NewLIR0(kPseudoTargetLabel);
+    branch_over->target = target;
+  }
   FreeTemp(reg_card_base);
   FreeTemp(reg_card_no);
 }
@@ -569,10 +582,24 @@ void ArmMir2Lir::GenEntrySequence(RegLocation* ArgLocs, RegLocation rl_method) {
    * a leaf *and* our frame size < fudge factor.
    */
   bool skip_overflow_check = (mir_graph_->MethodIsLeaf() &&
+                            !cu_->compiler_driver->GetMethodHooks() &&
                             (static_cast<size_t>(frame_size_) <
                             Thread::kStackOverflowReservedBytes));
+  /*
+   * An implicit check probes below the new frame before anything is pushed, so that the fault
+   * handler can throw as if from the caller. The probe lands in the stack guard as long as the
+   * frame and any runtime frames since the last check fit in it.
+   */
+  bool implicit_overflow_check = (!skip_overflow_check &&
+                                  cu_->compiler_driver->GetImplicitStackOverflowChecks() &&
+                                  (static_cast<size_t>(frame_size_) <
+                                  Thread::kStackOverflowProtectedSize / 2));
   NewLIR0(kPseudoMethodEntry);
-  if (!skip_overflow_check) {
+  if (implicit_overflow_check) {
+    OpRegRegImm(kOpSub, r12, rARM_SP, frame_size_ + Thread::kStackOverflowReservedBytes);
+    LIR* probe = NewLIR3(kThumb2LdrRRI12, r12, r12, 0);
+    probe->def_mask = ENCODE_ALL;  // Keep it before the pushes.
+  } else if (!skip_overflow_check) {
     /* Load stack limit */
     LoadWordDisp(rARM_SELF, Thread::StackEndOffset().Int32Value(), r12);
   }
@@ -587,7 +614,7 @@ void ArmMir2Lir::GenEntrySequence(RegLocation* ArgLocs, RegLocation rl_method) {
      */
     NewLIR1(kThumb2VPushCS, num_fp_spills_);
   }
-  if (!skip_overflow_check) {
+  if (!skip_overflow_check && !implicit_overflow_check) {
     OpRegRegImm(kOpSub, rARM_LR, rARM_SP, frame_size_ - (spill_count * 4));
     GenRegRegCheck(kCondCc, rARM_LR, r12, kThrowStackOverflow);
     OpRegCopy(rARM_SP, rARM_LR);     // Establish stack
@@ -597,6 +624,10 @@ void ArmMir2Lir::GenEntrySequence(RegLocation* ArgLocs, RegLocation rl_method) {
 
   FlushIns(ArgLocs, rl_method);
 
+  if (cu_->compiler_driver->GetMethodHooks()) {
+    GenMethodEntryHook();
+  }
+
   FreeTemp(r0);
   FreeTemp(r1);
   FreeTemp(r2);
@@ -612,6 +643,10 @@ void ArmMir2Lir::GenExitSequence() {
   LockTemp(r0);
   LockTemp(r1);
 
+  if (cu_->compiler_driver->GetMethodHooks()) {
+    GenMethodExitHook();
+  }
+
   NewLIR0(kPseudoMethodExit);
   OpRegImm(kOpAdd, rARM_SP, frame_size_ - (spill_count * 4));
   /* Need to restore any FP callee saves? */
@@ -630,4 +665,33 @@ void ArmMir2Lir::GenExitSequence() {
   }
 }
 
+/*
+ * The method hooks are only set in the entrypoints of a thread while method tracing wants them,
+ * so the hook pointer doubles as the enable flag. The hooks don't suspend and the stack isn't
+ * walked while they run, so the calls aren't safepoints.
+ */
+void ArmMir2Lir::GenMethodEntryHook() {
+  // The ins are in their home locations or in callee saves, and the Method* is at sp[0].
+  FlushAllRegs();
+  LoadWordDisp(rARM_SELF, QUICK_ENTRYPOINT_OFFSET(pMethodEntryHook).Int32Value(), rARM_LR);
+  LIR* branch = OpCmpImmBranch(kCondEq, rARM_LR, 0, NULL);
+  LoadWordDisp(rARM_SP, 0, r0);
+  OpRegCopy(r1, rARM_SELF);
+  ClobberCalleeSave();
+  OpReg(kOpBlx, rARM_LR);
+  branch->target = NewLIR0(kPseudoTargetLabel);
+}
+
+void ArmMir2Lir::GenMethodExitHook() {
+  // The exit hook takes the result in r2/r3 and gives it back in r0/r1.
+  LoadWordDisp(rARM_SELF, QUICK_ENTRYPOINT_OFFSET(pMethodExitHook).Int32Value(), rARM_LR);
+  LIR* branch = OpCmpImmBranch(kCondEq, rARM_LR, 0, NULL);
+  OpRegCopy(r2, r0);
+  OpRegCopy(r3, r1);
+  LoadWordDisp(rARM_SP, 0, r0);
+  OpRegCopy(r1, rARM_SELF);
+  OpReg(kOpBlx, rARM_LR);
+  branch->target = NewLIR0(kPseudoTargetLabel);
+}
+
 }  // namespace art
@@ -327,6 +327,7 @@ LIR* ArmMir2Lir::OpCmpImmBranch(ConditionCode cond, int reg, int check_value,
       int t_reg = AllocTemp();
       LoadConstant(t_reg, check_value);
       OpRegReg(kOpCmp, reg, t_reg);
+      FreeTemp(t_reg);
     }
     branch = NewLIR2(kThumbBCond, 0, arm_cond);
   }
@@ -561,10 +562,44 @@ bool ArmMir2Lir::GenInlinedCas32(CallInfo* info, bool need_write_barrier) {
   return true;
 }
 
+bool ArmMir2Lir::SupportsAtomicWide() {
+  return true;
+}
+
+RegLocation ArmMir2Lir::GenAtomicWideLoad(int r_ptr, RegLocation rl_dest) {
+  // Without LPAE only the exclusive load is single-copy atomic, ldrd and vldr may tear.
+  RegLocation rl_result = EvalLoc(rl_dest, kCoreReg, true);
+  NewLIR3(kThumb2Ldrexd, rl_result.low_reg, rl_result.high_reg, r_ptr);
+  return rl_result;
+}
+
+void ArmMir2Lir::GenAtomicWideStore(int r_ptr, RegLocation rl_src) {
+  // As in QuasiAtomic::Write64, an exclusive store that only succeeds after an exclusive load
+  // of the same address.
+  rl_src = LoadValueWide(rl_src, kCoreReg);
+  int r_temp_lo = AllocTemp();
+  int r_temp_hi = AllocTemp();
+  LIR* retry = NewLIR0(kPseudoTargetLabel);
+  NewLIR3(kThumb2Ldrexd, r_temp_lo, r_temp_hi, r_ptr);
+  // The loaded value isn't needed, r_temp_lo receives the status.
+  NewLIR4(kThumb2Strexd, r_temp_lo, rl_src.low_reg, rl_src.high_reg, r_ptr);
+  OpCmpImmBranch(kCondNe, r_temp_lo, 0, retry);
+  FreeTemp(r_temp_lo);
+  FreeTemp(r_temp_hi);
+}
+
 LIR* ArmMir2Lir::OpPcRelLoad(int reg, LIR* target) {
   return RawLIR(current_dalvik_offset_, kThumb2LdrPcRel12, reg, 0, 0, 0, 0, target);
 }
 
+LIR* ArmMir2Lir::OpRelativeCall(const MethodReference& target_method, InvokeType type) {
+  // A bl to the next instruction, the OatWriter fills in the displacement to the callee's code.
+  LIR* call = RawLIR(current_dalvik_offset_, kThumbBl1, 0, target_method.dex_method_index, type);
+  AppendLIR(call);
+  relative_calls_.Insert(call);
+  return NewLIR1(kThumbBl2, 0);
+}
+
 LIR* ArmMir2Lir::OpVldm(int rBase, int count) {
   return NewLIR3(kThumb2Vldms, rBase, fr0, count);
 }
@@ -596,6 +631,18 @@ LIR* ArmMir2Lir::OpTestSuspend(LIR* target) {
   return OpCondBranch((target == NULL) ? kCondEq : kCondNe, target);
 }
 
+// Load the suspend trigger and load through it. Always the 32-bit encodings, the fault handler
+// recognizes the pair by their bit patterns.
+LIR* ArmMir2Lir::CheckSuspendUsingLoad() {
+  int offset = Thread::SuspendTriggerOffset().Int32Value();
+  CHECK_LT(offset, 4096);
+  int t_reg = AllocTemp();
+  NewLIR3(kThumb2LdrRRI12, t_reg, rARM_SELF, offset);
+  LIR* load = NewLIR3(kThumb2LdrRRI12, t_reg, t_reg, 0);
+  FreeTemp(t_reg);
+  return load;
+}
+
 // Decrement register and branch on condition
 LIR* ArmMir2Lir::OpDecAndBranch(ConditionCode c_code, int reg, LIR* target) {
   // Combine sub & test using sub setflags encoding here
@@ -777,15 +824,21 @@ void ArmMir2Lir::GenArrayGet(int opt_flags, OpSize size, RegLocation rl_array,
     data_offset += mir_graph_->ConstantValue(rl_index) << scale;
   }
 
-  /* null object? */
-  GenNullCheck(rl_array.s_reg_low, rl_array.low_reg, opt_flags);
-
+  /* null object? The length load checks it when there is one. */
   bool needs_range_check = (!(opt_flags & MIR_IGNORE_RANGE_CHECK));
+  bool implicit_null_check = needs_range_check && ImplicitNullCheck(len_offset);
+  if (!implicit_null_check) {
+    GenNullCheck(rl_array.s_reg_low, rl_array.low_reg, opt_flags);
+  }
+
   int reg_len = INVALID_REG;
   if (needs_range_check) {
     reg_len = AllocTemp();
     /* Get len */
-    LoadWordDisp(rl_array.low_reg, len_offset, reg_len);
+    LIR* load = LoadWordDisp(rl_array.low_reg, len_offset, reg_len);
+    if (implicit_null_check) {
+      MarkPossibleNullPointerException(load, opt_flags);
+    }
   }
   if (rl_dest.wide || rl_dest.fp || constant_index) {
     int reg_ptr;
@@ -877,16 +930,22 @@ void ArmMir2Lir::GenArrayPut(int opt_flags, OpSize size, RegLocation rl_array,
     reg_ptr = AllocTemp();
   }
 
-  /* null object? */
-  GenNullCheck(rl_array.s_reg_low, rl_array.low_reg, opt_flags);
-
+  /* null object? The length load checks it when there is one. */
   bool needs_range_check = (!(opt_flags & MIR_IGNORE_RANGE_CHECK));
+  bool implicit_null_check = needs_range_check && ImplicitNullCheck(len_offset);
+  if (!implicit_null_check) {
+    GenNullCheck(rl_array.s_reg_low, rl_array.low_reg, opt_flags);
+  }
+
   int reg_len = INVALID_REG;
   if (needs_range_check) {
     reg_len = AllocTemp();
     // NOTE: max live temps(4) here.
     /* Get len */
-    LoadWordDisp(rl_array.low_reg, len_offset, reg_len);
+    LIR* load = LoadWordDisp(rl_array.low_reg, len_offset, reg_len);
+    if (implicit_null_check) {
+      MarkPossibleNullPointerException(load, opt_flags);
+    }
   }
   /* at this point, reg_ptr points to array, 2 live temps */
   if (rl_src.wide || rl_src.fp || constant_index) {
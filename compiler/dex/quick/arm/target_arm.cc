@@ -160,6 +160,19 @@ void ArmMir2Lir::SetupTargetResourceMasks(LIR* lir) {
     lir->def_mask = ENCODE_ALL;
   }
 
+  /* Nothing may be reordered around the exclusive accesses */
+  if ((opcode == kThumb2Ldrex) || (opcode == kThumb2Strex) || (opcode == kThumb2Clrex) ||
+      (opcode == kThumb2Ldrexd) || (opcode == kThumb2Strexd)) {
+    lir->def_mask = ENCODE_ALL;
+  }
+
+  /* The floating point compare result is only moved to the flags by fmstat */
+  if ((opcode == kThumb2Vcmps) || (opcode == kThumb2Vcmpd)) {
+    lir->def_mask |= ENCODE_FP_STATUS;
+  } else if (opcode == kThumb2Fmstat) {
+    lir->use_mask |= ENCODE_FP_STATUS;
+  }
+
   if (flags & REG_USE_LIST0) {
     lir->use_mask |= ENCODE_ARM_REG_LIST(lir->operands[0]);
   }
@@ -489,6 +502,112 @@ bool ArmMir2Lir::IsUnconditionalBranch(LIR* lir) {
   return ((lir->opcode == kThumbBUncond) || (lir->opcode == kThumb2BUncond));
 }
 
+bool ArmMir2Lir::IsRegCopy(LIR* lir) {
+  switch (lir->opcode) {
+    case kThumbMovRR:
+    case kThumbMovRR_H2H:
+    case kThumbMovRR_H2L:
+    case kThumbMovRR_L2H:
+    case kThumb2MovRR:
+    case kThumb2Vmovs:
+    case kThumb2Vmovd:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Whether the instruction sets the N and Z flags from the value it writes to operands[0].
+static bool SetsNZFromResult(int opcode) {
+  switch (opcode) {
+    case kThumbAddRRI3:
+    case kThumbAddRI8:
+    case kThumbAddRRR:
+    case kThumbAndRR:
+    case kThumbAsrRRI5:
+    case kThumbBicRR:
+    case kThumbEorRR:
+    case kThumbLslRRI5:
+    case kThumbLsrRRI5:
+    case kThumbMul:
+    case kThumbMvn:
+    case kThumbNeg:
+    case kThumbOrr:
+    case kThumbSubRRI3:
+    case kThumbSubRI8:
+    case kThumbSubRRR:
+    case kThumb2AddRRR:
+    case kThumb2SubRRR:
+    case kThumb2AddRRI8:
+    case kThumb2SubRRI8:
+    case kThumb2SubsRRI12:
+    case kThumb2OrrRRRs:
+    case kThumb2RsubRRI8:
+    case kThumb2NegRR:
+      return true;
+    default:
+      return false;
+  }
+}
+
+/*
+ * Drop a compare of a register with zero that follows the flag setting instruction defining
+ * the register, when the branch after it only tests the N or Z flags. The instruction sets
+ * those from its result just as the compare would. As the compare clears V, a signed test
+ * against zero only tests N, so blt and bge become bmi and bpl.
+ */
+void ArmMir2Lir::ApplyTargetPeepholeOptimizations() {
+  LIR* prev_lir = NULL;
+  int it_insns = 0;
+  for (LIR* this_lir = first_lir_insn_; this_lir != NULL; this_lir = NEXT_LIR(this_lir)) {
+    if (is_pseudo_opcode(this_lir->opcode)) {
+      if (this_lir->opcode != kPseudoDalvikByteCodeBoundary) {
+        prev_lir = NULL;
+      }
+      continue;
+    }
+    if (this_lir->flags.is_nop) {
+      continue;
+    }
+    // The 16 bit instructions don't set the flags inside an IT block.
+    if (it_insns > 0) {
+      it_insns--;
+      prev_lir = NULL;
+      continue;
+    }
+    it_insns = ITShadowSize(this_lir);
+    bool compare_with_zero =
+        ((this_lir->opcode == kThumbCmpRI8) || (this_lir->opcode == kThumb2CmpRI12)) &&
+        (this_lir->operands[1] == 0);
+    if (compare_with_zero && (prev_lir != NULL) && SetsNZFromResult(prev_lir->opcode) &&
+        (prev_lir->operands[0] == this_lir->operands[0])) {
+      LIR* branch = NEXT_LIR(this_lir);
+      while ((branch != NULL) && (branch->flags.is_nop ||
+             (branch->opcode == kPseudoDalvikByteCodeBoundary))) {
+        branch = NEXT_LIR(branch);
+      }
+      if ((branch != NULL) &&
+          ((branch->opcode == kThumbBCond) || (branch->opcode == kThumb2BCond)) &&
+          !CCodesUsedAfter(branch)) {
+        int cond = branch->operands[1];
+        if (cond == kArmCondLt) {
+          cond = kArmCondMi;
+        } else if (cond == kArmCondGe) {
+          cond = kArmCondPl;
+        }
+        if ((cond == kArmCondEq) || (cond == kArmCondNe) ||
+            (cond == kArmCondMi) || (cond == kArmCondPl)) {
+          branch->operands[1] = cond;
+          this_lir->flags.is_nop = true;
+          prev_lir = NULL;
+          continue;
+        }
+      }
+    }
+    prev_lir = this_lir;
+  }
+}
+
 ArmMir2Lir::ArmMir2Lir(CompilationUnit* cu, MIRGraph* mir_graph, ArenaAllocator* arena)
     : Mir2Lir(cu, mir_graph, arena) {
   // Sanity check - make sure encoding map lines up.
@@ -717,10 +836,59 @@ int ArmMir2Lir::LoadHelper(ThreadOffset offset) {
   return rARM_LR;
 }
 
+LIR* ArmMir2Lir::LoadWordThreadMem(int r_dest, ThreadOffset thread_offset) {
+  return LoadWordDisp(rARM_SELF, thread_offset.Int32Value(), r_dest);
+}
+
+LIR* ArmMir2Lir::StoreWordThreadMem(ThreadOffset thread_offset, int r_src) {
+  return StoreWordDisp(rARM_SELF, thread_offset.Int32Value(), r_src);
+}
+
 uint64_t ArmMir2Lir::GetTargetInstFlags(int opcode) {
   return ArmMir2Lir::EncodingMap[opcode].flags;
 }
 
+/*
+ * Cycles until the result of the instruction can be used, for the in-order Cortex-A9 pipeline.
+ * The Cortex-A15 has similar or longer latencies for these classes, so the same order suits it.
+ */
+int ArmMir2Lir::GetInsnLatency(LIR* lir) {
+  switch (lir->opcode) {
+    case kThumbMul:
+    case kThumb2MulRRR:
+    case kThumb2Mla:
+      return 3;
+    case kThumb2Umull:
+    case kThumb2Smull:
+      return 4;
+    case kThumb2Vadds:
+    case kThumb2Vaddd:
+    case kThumb2Vsubs:
+    case kThumb2Vsubd:
+    case kThumb2Vmuls:
+    case kThumb2VcvtIF:
+    case kThumb2VcvtID:
+    case kThumb2VcvtFI:
+    case kThumb2VcvtDI:
+    case kThumb2VcvtFd:
+    case kThumb2VcvtDF:
+      return 4;
+    case kThumb2Vmuld:
+      return 5;
+    case kThumb2Vdivs:
+    case kThumb2Vsqrts:
+      return 15;
+    case kThumb2Vdivd:
+    case kThumb2Vsqrtd:
+      return 25;
+    case kThumb2Fmrs:
+    case kThumb2Fmrrd:
+      return 2;
+    default:
+      return (EncodingMap[lir->opcode].flags & IS_LOAD) ? 3 : 1;
+  }
+}
+
 const char* ArmMir2Lir::GetTargetInstName(int opcode) {
   return ArmMir2Lir::EncodingMap[opcode].name;
 }
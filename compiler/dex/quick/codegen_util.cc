@@ -227,7 +227,7 @@ void Mir2Lir::DumpPromotionMap() {
 /* Dump a mapping table */
 void Mir2Lir::DumpMappingTable(const char* table_name, const std::string& descriptor,
                                const std::string& name, const std::string& signature,
-                               const std::vector<uint32_t>& v) {
+                               const ArenaVector<uint32_t>& v) {
   if (v.size() > 0) {
     std::string line(StringPrintf("\n  %s %s%s_%s_table[%zu] = {", table_name,
                      descriptor.c_str(), name.c_str(), signature.c_str(), v.size()));
@@ -463,6 +463,23 @@ void Mir2Lir::InstallFillArrayData() {
   }
 }
 
+/* Record the offsets of the relative calls for the compiler to patch */
+void Mir2Lir::InstallRelativeCalls() {
+  GrowableArray<LIR*>::Iterator iterator(&relative_calls_);
+  while (true) {
+    LIR* call_lir = iterator.Next();
+    if (call_lir == NULL) break;
+    DCHECK(!call_lir->flags.is_nop);
+    cu_->compiler_driver->AddRelativeCallPatch(cu_->dex_file,
+                                               cu_->class_def_idx,
+                                               cu_->method_idx,
+                                               cu_->invoke_type,
+                                               call_lir->operands[1],
+                                               static_cast<InvokeType>(call_lir->operands[2]),
+                                               call_lir->offset);
+  }
+}
+
 static int AssignLiteralOffsetCommon(LIR* lir, int offset) {
   for (; lir != NULL; lir = lir->next) {
     lir->offset = offset;
@@ -474,7 +491,7 @@ static int AssignLiteralOffsetCommon(LIR* lir, int offset) {
 // Make sure we have a code address for every declared catch entry
 bool Mir2Lir::VerifyCatchEntries() {
   bool success = true;
-  for (std::set<uint32_t>::const_iterator it = mir_graph_->catches_.begin();
+  for (ArenaSet<uint32_t>::const_iterator it = mir_graph_->catches_.begin();
        it != mir_graph_->catches_.end(); ++it) {
     uint32_t dex_pc = *it;
     bool found = false;
@@ -506,6 +523,18 @@ bool Mir2Lir::VerifyCatchEntries() {
 }
 
 
+void Mir2Lir::EncodeMappingTableDeltas(const ArenaVector<uint32_t>& table) {
+  uint32_t native_offset = 0;
+  uint32_t dex_offset = 0;
+  for (size_t i = 0; i < table.size(); i += 2) {
+    DCHECK_GE(table[i], native_offset);
+    encoded_mapping_table_.PushBack(table[i] - native_offset);
+    encoded_mapping_table_.PushBackSigned(static_cast<int32_t>(table[i + 1] - dex_offset));
+    native_offset = table[i];
+    dex_offset = table[i + 1];
+  }
+}
+
 void Mir2Lir::CreateMappingTables() {
   for (LIR* tgt_lir = first_lir_insn_; tgt_lir != NULL; tgt_lir = NEXT_LIR(tgt_lir)) {
     if (!tgt_lir->flags.is_nop && (tgt_lir->opcode == kPseudoSafepointPC)) {
@@ -526,8 +555,8 @@ void Mir2Lir::CreateMappingTables() {
   uint32_t pc2dex_entries = pc2dex_mapping_table_.size() / 2;
   encoded_mapping_table_.PushBack(total_entries);
   encoded_mapping_table_.PushBack(pc2dex_entries);
-  encoded_mapping_table_.InsertBack(pc2dex_mapping_table_.begin(), pc2dex_mapping_table_.end());
-  encoded_mapping_table_.InsertBack(dex2pc_mapping_table_.begin(), dex2pc_mapping_table_.end());
+  EncodeMappingTableDeltas(pc2dex_mapping_table_);
+  EncodeMappingTableDeltas(dex2pc_mapping_table_);
   if (kIsDebugBuild) {
     // Verify the encoded table holds the expected data.
     MappingTable table(&encoded_mapping_table_.GetData()[0]);
@@ -554,7 +583,7 @@ class NativePcToReferenceMapBuilder {
   NativePcToReferenceMapBuilder(std::vector<uint8_t>* table,
                                 size_t entries, uint32_t max_native_offset,
                                 size_t references_width) : entries_(entries),
-                                references_width_(references_width), in_use_(entries),
+                                references_width_(references_width), next_index_(0),
                                 table_(table) {
     // Compute width in bytes needed to hold max_native_offset.
     native_offset_width_ = 0;
@@ -574,22 +603,17 @@ class NativePcToReferenceMapBuilder {
     (*table)[3] = (entries >> 8) & 0xFF;
   }
 
+  // Entries must be added in native offset order, the runtime finds them by binary search.
   void AddEntry(uint32_t native_offset, const uint8_t* references) {
-    size_t table_index = TableIndex(native_offset);
-    while (in_use_[table_index]) {
-      table_index = (table_index + 1) % entries_;
-    }
-    in_use_[table_index] = true;
-    SetNativeOffset(table_index, native_offset);
-    DCHECK_EQ(native_offset, GetNativeOffset(table_index));
-    SetReferences(table_index, references);
+    DCHECK_LT(next_index_, entries_);
+    DCHECK(next_index_ == 0 || GetNativeOffset(next_index_ - 1) <= native_offset);
+    SetNativeOffset(next_index_, native_offset);
+    DCHECK_EQ(native_offset, GetNativeOffset(next_index_));
+    SetReferences(next_index_, references);
+    next_index_++;
   }
 
  private:
-  size_t TableIndex(uint32_t native_offset) {
-    return NativePcOffsetToReferenceMap::Hash(native_offset) % entries_;
-  }
-
   uint32_t GetNativeOffset(size_t table_index) {
     uint32_t native_offset = 0;
     size_t table_offset = (table_index * EntryWidth()) + sizeof(uint32_t);
@@ -621,14 +645,14 @@ class NativePcToReferenceMapBuilder {
   const size_t references_width_;
   // Number of bytes used to encode a native offset.
   size_t native_offset_width_;
-  // Entries that are in use.
-  std::vector<bool> in_use_;
+  // The index of the next entry to add.
+  size_t next_index_;
   // The table we're building.
   std::vector<uint8_t>* const table_;
 };
 
 void Mir2Lir::CreateNativeGcMap() {
-  const std::vector<uint32_t>& mapping_table = pc2dex_mapping_table_;
+  const ArenaVector<uint32_t>& mapping_table = pc2dex_mapping_table_;
   uint32_t max_native_offset = 0;
   for (size_t i = 0; i < mapping_table.size(); i += 2) {
     uint32_t native_offset = mapping_table[i + 0];
@@ -776,6 +800,9 @@ void Mir2Lir::AssembleLIR() {
   // Install fill array data
   InstallFillArrayData();
 
+  // Record relative calls for the compiler to patch
+  InstallRelativeCalls();
+
   // Create the mapping table and native offset to reference map.
   CreateMappingTables();
 
@@ -790,7 +817,7 @@ void Mir2Lir::AssembleLIR() {
  * target boundaries.  KeyVal is just there for debugging.
  */
 LIR* Mir2Lir::InsertCaseLabel(int vaddr, int keyVal) {
-  SafeMap<unsigned int, LIR*>::iterator it;
+  ArenaSafeMap<unsigned int, LIR*>::iterator it;
   it = boundary_map_.find(vaddr);
   if (it == boundary_map_.end()) {
     LOG(FATAL) << "Error: didn't find vaddr 0x" << std::hex << vaddr;
@@ -949,12 +976,17 @@ Mir2Lir::Mir2Lir(CompilationUnit* cu, MIRGraph* mir_graph, ArenaAllocator* arena
       throw_launchpads_(arena, 2048, kGrowableArrayThrowLaunchPads),
       suspend_launchpads_(arena, 4, kGrowableArraySuspendLaunchPads),
       intrinsic_launchpads_(arena, 2048, kGrowableArrayMisc),
+      relative_calls_(arena, 4, kGrowableArrayMisc),
+      boundary_map_(arena->Adapter()),
+      pc2dex_mapping_table_(arena->Adapter()),
+      dex2pc_mapping_table_(arena->Adapter()),
       data_offset_(0),
       total_size_(0),
       block_label_list_(NULL),
       current_dalvik_offset_(0),
       reg_pool_(NULL),
       live_sreg_(0),
+      card_mark_pending_(false),
       num_core_spills_(0),
       num_fp_spills_(0),
       frame_size_(0),
@@ -973,7 +1005,8 @@ void Mir2Lir::Materialize() {
   /* Allocate Registers using simple local allocation scheme */
   SimpleRegAlloc();
 
-  if (mir_graph_->IsSpecialCase()) {
+  // The frameless code of the special cases has nowhere to call the method hooks from.
+  if (mir_graph_->IsSpecialCase() && !cu_->compiler_driver->GetMethodHooks()) {
       /*
        * Custom codegen for special cases.  If for any reason the
        * special codegen doesn't succeed, first_lir_insn_ will
@@ -992,6 +1025,10 @@ void Mir2Lir::Materialize() {
     // mark the targets of switch statement case labels
     ProcessSwitchTables();
 
+    if (!(cu_->disable_opt & (1 << kPeepholeOptimizations))) {
+      ApplyPeepholeOptimizations();
+    }
+
     /* Convert LIR into machine code. */
     AssembleLIR();
 
@@ -1001,6 +1038,16 @@ void Mir2Lir::Materialize() {
   }
 }
 
+size_t Mir2Lir::GetNumLIRs() const {
+  size_t num_lirs = 0;
+  for (const LIR* lir = first_lir_insn_; lir != NULL; lir = NEXT_LIR(lir)) {
+    if (!lir->flags.is_nop) {
+      num_lirs++;
+    }
+  }
+  return num_lirs;
+}
+
 CompiledMethod* Mir2Lir::GetCompiledMethod() {
   // Combine vmap tables - core regs, then fp regs - into vmap_table
   std::vector<uint16_t> raw_vmap_table;
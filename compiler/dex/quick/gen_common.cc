@@ -18,7 +18,9 @@
 #include "dex/compiler_internals.h"
 #include "dex/quick/mir_to_lir-inl.h"
 #include "entrypoints/quick/quick_entrypoints.h"
+#include "gc/space/dlmalloc_space.h"
 #include "mirror/array.h"
+#include "mirror/class.h"
 #include "verifier/method_verifier.h"
 
 namespace art {
@@ -29,6 +31,9 @@ namespace art {
  * and "op" calls may be used here.
  */
 
+// Largest instance size for which new-instance is bump allocated and zeroed inline.
+static constexpr size_t kMaxInlineNewInstanceSize = 64;
+
 /*
  * Generate an kPseudoBarrier marker to indicate the boundary of special
  * blocks.
@@ -72,6 +77,27 @@ LIR* Mir2Lir::GenNullCheck(int s_reg, int m_reg, int opt_flags) {
   return GenImmedCheck(kCondEq, m_reg, 0, kThrowNullPointer);
 }
 
+/*
+ * Whether an access at the given offset from an object may be its own null check. It faults in
+ * the unmapped first page when the object is null, and the fault handler throws the exception.
+ */
+bool Mir2Lir::ImplicitNullCheck(int offset) {
+  return cu_->compiler_driver->GetImplicitNullChecks() && offset >= 0 && offset < kPageSize;
+}
+
+/*
+ * Make the access just emitted in place of a null check a safepoint, so that the fault handler
+ * can throw from it as if the access had called the runtime.
+ */
+void Mir2Lir::MarkPossibleNullPointerException(LIR* access, int opt_flags) {
+  if (!(cu_->disable_opt & (1 << kNullCheckElimination)) &&
+    opt_flags & MIR_IGNORE_NULL_CHECK) {
+    return;
+  }
+  DCHECK_EQ(access, last_lir_insn_);
+  MarkSafepointPC(access);
+}
+
 /* Perform check on two registers */
 LIR* Mir2Lir::GenRegRegCheck(ConditionCode c_code, int reg1, int reg2,
                              ThrowKind kind) {
@@ -167,6 +193,40 @@ void Mir2Lir::GenCompareZeroAndBranch(Instruction::Code opcode, RegLocation rl_s
   OpUnconditionalBranch(fall_through);
 }
 
+/*
+ * Lower a sparse switch to a binary search over its keys, which the dex format keeps sorted,
+ * branching straight to the case blocks and falling through when no key matches.
+ */
+void Mir2Lir::GenSparseSwitchSearch(const uint16_t* table, RegLocation rl_src) {
+  int entries = table[1];
+  const int* keys = reinterpret_cast<const int*>(&table[2]);
+  const int* targets = &keys[entries];
+  rl_src = LoadValue(rl_src, kCoreReg);
+  LIR* done = RawLIR(current_dalvik_offset_, kPseudoTargetLabel);
+  GenSparseSwitchSearchRange(rl_src.low_reg, keys, targets, 0, entries, done);
+  AppendLIR(done);
+}
+
+// Search keys [low, high). Short ranges are compared in turn, longer ones split at the middle key.
+void Mir2Lir::GenSparseSwitchSearchRange(int reg, const int* keys, const int* targets, int low,
+                                         int high, LIR* done) {
+  if (high - low <= 3) {
+    for (int i = low; i < high; i++) {
+      BasicBlock* case_block = mir_graph_->FindBlock(current_dalvik_offset_ + targets[i]);
+      OpCmpImmBranch(kCondEq, reg, keys[i], &block_label_list_[case_block->id]);
+    }
+    return;
+  }
+  int mid = low + (high - low) / 2;
+  BasicBlock* case_block = mir_graph_->FindBlock(current_dalvik_offset_ + targets[mid]);
+  LIR* lower_branch = OpCmpImmBranch(kCondLt, reg, keys[mid], NULL);
+  OpCmpImmBranch(kCondEq, reg, keys[mid], &block_label_list_[case_block->id]);
+  GenSparseSwitchSearchRange(reg, keys, targets, mid + 1, high, done);
+  OpUnconditionalBranch(done);
+  lower_branch->target = NewLIR0(kPseudoTargetLabel);
+  GenSparseSwitchSearchRange(reg, keys, targets, low, mid, done);
+}
+
 void Mir2Lir::GenIntToLong(RegLocation rl_dest, RegLocation rl_src) {
   RegLocation rl_result = EvalLoc(rl_dest, kCoreReg, true);
   if (rl_src.location == kLocPhysReg) {
@@ -330,8 +390,8 @@ void Mir2Lir::GenFilledNewArray(CallInfo* info) {
   }
 }
 
-void Mir2Lir::GenSput(uint32_t field_idx, RegLocation rl_src, bool is_long_or_double,
-                      bool is_object) {
+void Mir2Lir::GenSput(uint32_t field_idx, int opt_flags, RegLocation rl_src,
+                      bool is_long_or_double, bool is_object) {
   int field_offset;
   int ssb_index;
   bool is_volatile;
@@ -339,7 +399,8 @@ void Mir2Lir::GenSput(uint32_t field_idx, RegLocation rl_src, bool is_long_or_do
   bool fast_path = cu_->compiler_driver->ComputeStaticFieldInfo(
       field_idx, mir_graph_->GetCurrentDexCompilationUnit(), field_offset, ssb_index,
       is_referrers_class, is_volatile, true);
-  if (fast_path && !SLOW_FIELD_PATH) {
+  if (fast_path && !SLOW_FIELD_PATH &&
+      (!is_long_or_double || !is_volatile || SupportsAtomicWide())) {
     DCHECK_GE(field_offset, 0);
     int rBase;
     if (is_referrers_class) {
@@ -351,6 +412,19 @@ void Mir2Lir::GenSput(uint32_t field_idx, RegLocation rl_src, bool is_long_or_do
       if (IsTemp(rl_method.low_reg)) {
         FreeTemp(rl_method.low_reg);
       }
+    } else if ((opt_flags & MIR_IGNORE_CLINIT_CHECK) != 0) {
+      // Medium path without the check, an earlier access on every path initialized the class.
+      RegLocation rl_method  = LoadCurrMethod();
+      rBase = AllocTemp();
+      LoadWordDisp(rl_method.low_reg,
+                   mirror::ArtMethod::DexCacheInitializedStaticStorageOffset().Int32Value(),
+                   rBase);
+      LoadWordDisp(rBase,
+                   mirror::Array::DataOffset(sizeof(mirror::Object*)).Int32Value() +
+                   sizeof(int32_t*) * ssb_index, rBase);
+      if (IsTemp(rl_method.low_reg)) {
+        FreeTemp(rl_method.low_reg);
+      }
     } else {
       // Medium path, static storage base in a different class which requires checks that the other
       // class is initialized.
@@ -385,6 +459,15 @@ void Mir2Lir::GenSput(uint32_t field_idx, RegLocation rl_src, bool is_long_or_do
       FreeTemp(r_method);
     }
     // rBase now holds static storage base
+    if (is_long_or_double && is_volatile) {
+      GenMemBarrier(kStoreStore);
+      // rBase is ours to point at the field, the exclusive accesses take no displacement.
+      OpRegImm(kOpAdd, rBase, field_offset);
+      GenAtomicWideStore(rBase, rl_src);
+      GenMemBarrier(kStoreLoad);
+      FreeTemp(rBase);
+      return;
+    }
     if (is_long_or_double) {
       rl_src = LoadValueWide(rl_src, kAnyReg);
     } else {
@@ -416,7 +499,7 @@ void Mir2Lir::GenSput(uint32_t field_idx, RegLocation rl_src, bool is_long_or_do
   }
 }
 
-void Mir2Lir::GenSget(uint32_t field_idx, RegLocation rl_dest,
+void Mir2Lir::GenSget(uint32_t field_idx, int opt_flags, RegLocation rl_dest,
                       bool is_long_or_double, bool is_object) {
   int field_offset;
   int ssb_index;
@@ -425,7 +508,8 @@ void Mir2Lir::GenSget(uint32_t field_idx, RegLocation rl_dest,
   bool fast_path = cu_->compiler_driver->ComputeStaticFieldInfo(
       field_idx, mir_graph_->GetCurrentDexCompilationUnit(), field_offset, ssb_index,
       is_referrers_class, is_volatile, false);
-  if (fast_path && !SLOW_FIELD_PATH) {
+  if (fast_path && !SLOW_FIELD_PATH &&
+      (!is_long_or_double || !is_volatile || SupportsAtomicWide())) {
     DCHECK_GE(field_offset, 0);
     int rBase;
     if (is_referrers_class) {
@@ -434,6 +518,15 @@ void Mir2Lir::GenSget(uint32_t field_idx, RegLocation rl_dest,
       rBase = AllocTemp();
       LoadWordDisp(rl_method.low_reg,
                    mirror::ArtMethod::DeclaringClassOffset().Int32Value(), rBase);
+    } else if ((opt_flags & MIR_IGNORE_CLINIT_CHECK) != 0) {
+      // Medium path without the check, an earlier access on every path initialized the class.
+      RegLocation rl_method  = LoadCurrMethod();
+      rBase = AllocTemp();
+      LoadWordDisp(rl_method.low_reg,
+                   mirror::ArtMethod::DexCacheInitializedStaticStorageOffset().Int32Value(),
+                   rBase);
+      LoadWordDisp(rBase, mirror::Array::DataOffset(sizeof(mirror::Object*)).Int32Value() +
+                   sizeof(int32_t*) * ssb_index, rBase);
     } else {
       // Medium path, static storage base in a different class which requires checks that the other
       // class is initialized
@@ -466,6 +559,14 @@ void Mir2Lir::GenSget(uint32_t field_idx, RegLocation rl_dest,
       FreeTemp(r_method);
     }
     // rBase now holds static storage base
+    if (is_long_or_double && is_volatile) {
+      OpRegImm(kOpAdd, rBase, field_offset);
+      RegLocation rl_result = GenAtomicWideLoad(rBase, rl_dest);
+      FreeTemp(rBase);
+      GenMemBarrier(kLoadLoad);
+      StoreValueWide(rl_dest, rl_result);
+      return;
+    }
     RegLocation rl_result = EvalLoc(rl_dest, kAnyReg, true);
     if (is_volatile) {
       GenMemBarrier(kLoadLoad);
@@ -628,7 +729,10 @@ void Mir2Lir::GenIGet(uint32_t field_idx, int opt_flags, OpSize size,
 
   bool fast_path = FastInstance(field_idx, field_offset, is_volatile, false);
 
-  if (fast_path && !SLOW_FIELD_PATH) {
+  // Volatile longs and doubles need a single-copy atomic access, without one the runtime's
+  // QuasiAtomic accesses them.
+  if (fast_path && !SLOW_FIELD_PATH &&
+      (!is_long_or_double || !is_volatile || SupportsAtomicWide())) {
     RegLocation rl_result;
     RegisterClass reg_class = oat_reg_class_by_size(size);
     DCHECK_GE(field_offset, 0);
@@ -636,30 +740,36 @@ void Mir2Lir::GenIGet(uint32_t field_idx, int opt_flags, OpSize size,
     if (is_long_or_double) {
       DCHECK(rl_dest.wide);
       GenNullCheck(rl_obj.s_reg_low, rl_obj.low_reg, opt_flags);
-      if (cu_->instruction_set == kX86) {
+      if (is_volatile) {
+        int reg_ptr = AllocTemp();
+        OpRegRegImm(kOpAdd, reg_ptr, rl_obj.low_reg, field_offset);
+        rl_result = GenAtomicWideLoad(reg_ptr, rl_dest);
+        GenMemBarrier(kLoadLoad);
+        FreeTemp(reg_ptr);
+      } else if (cu_->instruction_set == kX86) {
         rl_result = EvalLoc(rl_dest, reg_class, true);
         GenNullCheck(rl_obj.s_reg_low, rl_obj.low_reg, opt_flags);
         LoadBaseDispWide(rl_obj.low_reg, field_offset, rl_result.low_reg,
                          rl_result.high_reg, rl_obj.s_reg_low);
-        if (is_volatile) {
-          GenMemBarrier(kLoadLoad);
-        }
       } else {
         int reg_ptr = AllocTemp();
         OpRegRegImm(kOpAdd, reg_ptr, rl_obj.low_reg, field_offset);
         rl_result = EvalLoc(rl_dest, reg_class, true);
         LoadBaseDispWide(reg_ptr, 0, rl_result.low_reg, rl_result.high_reg, INVALID_SREG);
-        if (is_volatile) {
-          GenMemBarrier(kLoadLoad);
-        }
         FreeTemp(reg_ptr);
       }
       StoreValueWide(rl_dest, rl_result);
     } else {
       rl_result = EvalLoc(rl_dest, reg_class, true);
-      GenNullCheck(rl_obj.s_reg_low, rl_obj.low_reg, opt_flags);
-      LoadBaseDisp(rl_obj.low_reg, field_offset, rl_result.low_reg,
-                   kWord, rl_obj.s_reg_low);
+      bool implicit_null_check = ImplicitNullCheck(field_offset);
+      if (!implicit_null_check) {
+        GenNullCheck(rl_obj.s_reg_low, rl_obj.low_reg, opt_flags);
+      }
+      LIR* load = LoadBaseDisp(rl_obj.low_reg, field_offset, rl_result.low_reg,
+                               kWord, rl_obj.s_reg_low);
+      if (implicit_null_check) {
+        MarkPossibleNullPointerException(load, opt_flags);
+      }
       if (is_volatile) {
         GenMemBarrier(kLoadLoad);
       }
@@ -683,42 +793,61 @@ void Mir2Lir::GenIGet(uint32_t field_idx, int opt_flags, OpSize size,
 
 void Mir2Lir::GenIPut(uint32_t field_idx, int opt_flags, OpSize size,
                       RegLocation rl_src, RegLocation rl_obj, bool is_long_or_double,
-                      bool is_object) {
+                      bool is_object, bool defer_card_mark) {
   int field_offset;
   bool is_volatile;
 
   bool fast_path = FastInstance(field_idx, field_offset, is_volatile,
                  true);
-  if (fast_path && !SLOW_FIELD_PATH) {
+  if (fast_path && !SLOW_FIELD_PATH &&
+      (!is_long_or_double || !is_volatile || SupportsAtomicWide())) {
     RegisterClass reg_class = oat_reg_class_by_size(size);
     DCHECK_GE(field_offset, 0);
     rl_obj = LoadValue(rl_obj, kCoreReg);
-    if (is_long_or_double) {
+    if (is_long_or_double && is_volatile) {
+      GenNullCheck(rl_obj.s_reg_low, rl_obj.low_reg, opt_flags);
+      int reg_ptr = AllocTemp();
+      OpRegRegImm(kOpAdd, reg_ptr, rl_obj.low_reg, field_offset);
+      // Only the address is needed from here on, leave the temps to the store sequence.
+      ClobberSReg(rl_obj.s_reg_low);
+      FreeTemp(rl_obj.low_reg);
+      GenMemBarrier(kStoreStore);
+      GenAtomicWideStore(reg_ptr, rl_src);
+      GenMemBarrier(kLoadLoad);
+      FreeTemp(reg_ptr);
+    } else if (is_long_or_double) {
       int reg_ptr;
       rl_src = LoadValueWide(rl_src, kAnyReg);
       GenNullCheck(rl_obj.s_reg_low, rl_obj.low_reg, opt_flags);
       reg_ptr = AllocTemp();
       OpRegRegImm(kOpAdd, reg_ptr, rl_obj.low_reg, field_offset);
-      if (is_volatile) {
-        GenMemBarrier(kStoreStore);
-      }
       StoreBaseDispWide(reg_ptr, 0, rl_src.low_reg, rl_src.high_reg);
-      if (is_volatile) {
-        GenMemBarrier(kLoadLoad);
-      }
       FreeTemp(reg_ptr);
     } else {
       rl_src = LoadValue(rl_src, reg_class);
-      GenNullCheck(rl_obj.s_reg_low, rl_obj.low_reg, opt_flags);
+      bool implicit_null_check = ImplicitNullCheck(field_offset);
+      if (!implicit_null_check) {
+        GenNullCheck(rl_obj.s_reg_low, rl_obj.low_reg, opt_flags);
+      }
       if (is_volatile) {
         GenMemBarrier(kStoreStore);
       }
-      StoreBaseDisp(rl_obj.low_reg, field_offset, rl_src.low_reg, kWord);
+      LIR* store = StoreBaseDisp(rl_obj.low_reg, field_offset, rl_src.low_reg, kWord);
+      if (implicit_null_check) {
+        MarkPossibleNullPointerException(store, opt_flags);
+      }
       if (is_volatile) {
         GenMemBarrier(kLoadLoad);
       }
-      if (is_object && !mir_graph_->IsConstantNullRef(rl_src)) {
-        MarkGCCard(rl_src.low_reg, rl_obj.low_reg);
+      if (is_object) {
+        if (defer_card_mark) {
+          card_mark_pending_ |= !mir_graph_->IsConstantNullRef(rl_src);
+        } else if (card_mark_pending_) {
+          MarkGCCard(INVALID_REG, rl_obj.low_reg);
+          card_mark_pending_ = false;
+        } else if (!mir_graph_->IsConstantNullRef(rl_src)) {
+          MarkGCCard(rl_src.low_reg, rl_obj.low_reg);
+        }
       }
     }
   } else {
@@ -730,6 +859,22 @@ void Mir2Lir::GenIPut(uint32_t field_idx, int opt_flags, OpSize size,
   }
 }
 
+/*
+ * A reference store may leave its card mark to the store that follows it when that is a fast path
+ * store into the same object. Nothing between the two can suspend, so the GC never sees the first
+ * store without the card being dirtied after it.
+ */
+bool Mir2Lir::CanDeferCardMark(MIR* mir) {
+  MIR* next = mir->next;
+  if (next == NULL || next->dalvikInsn.opcode != Instruction::IPUT_OBJECT ||
+      next->ssa_rep->uses[1] != mir->ssa_rep->uses[1]) {
+    return false;
+  }
+  int field_offset;
+  bool is_volatile;
+  return FastInstance(next->dalvikInsn.vC, field_offset, is_volatile, true) && !SLOW_FIELD_PATH;
+}
+
 void Mir2Lir::GenConstClass(uint32_t type_idx, RegLocation rl_dest) {
   RegLocation rl_method = LoadCurrMethod();
   int res_reg = AllocTemp();
@@ -852,6 +997,12 @@ void Mir2Lir::GenNewInstance(uint32_t type_idx, RegLocation rl_dest) {
   ThreadOffset func_offset(-1);
   if (cu_->compiler_driver->CanAccessInstantiableTypeWithoutChecks(
       cu_->method_idx, *cu_->dex_file, type_idx)) {
+    size_t object_size;
+    if (cu_->compiler_driver->ComputeNewInstanceInfo(*cu_->dex_file, type_idx, &object_size) &&
+        object_size <= kMaxInlineNewInstanceSize && !SLOW_TYPE_PATH) {
+      GenNewInstanceInline(type_idx, object_size, rl_dest);
+      return;
+    }
     func_offset = QUICK_ENTRYPOINT_OFFSET(pAllocObject);
   } else {
     func_offset = QUICK_ENTRYPOINT_OFFSET(pAllocObjectWithAccessCheck);
@@ -861,6 +1012,81 @@ void Mir2Lir::GenNewInstance(uint32_t type_idx, RegLocation rl_dest) {
   StoreValue(rl_dest, rl_result);
 }
 
+/*
+ * Bump allocate an instance from the thread's allocation buffer, see
+ * gc::space::DlMallocSpace::AllocThreadLocal, and record it in the thread's segment of the
+ * allocation stack. Falls back to pAllocObject if the class isn't yet initialized or the buffer
+ * or stack segment are exhausted. The result is left in kRet0 on both paths.
+ */
+void Mir2Lir::GenNewInstanceInline(uint32_t type_idx, size_t object_size, RegLocation rl_dest) {
+  const size_t chunk_size = gc::space::DlMallocSpace::ThreadLocalChunkSize(object_size);
+  int r_obj = TargetReg(kRet0);
+  LockTemp(r_obj);
+  int r_class = AllocTemp();
+  int r_tmp1 = AllocTemp();
+  int r_tmp2 = AllocTemp();
+  // Load the class from the dex cache.
+  LoadCurrMethodDirect(r_class);
+  LoadWordDisp(r_class, mirror::ArtMethod::DexCacheResolvedTypesOffset().Int32Value(), r_class);
+  int32_t offset_of_type =
+      mirror::Array::DataOffset(sizeof(mirror::Class*)).Int32Value() + (sizeof(mirror::Class*)
+                        * type_idx);
+  LoadWordDisp(r_class, offset_of_type, r_class);
+  LIR* branch_unresolved = OpCmpImmBranch(kCondEq, r_class, 0, NULL);
+  LoadWordDisp(r_class, mirror::Class::StatusOffset().Int32Value(), r_tmp1);
+  LIR* branch_uninitialized =
+      OpCmpImmBranch(kCondNe, r_tmp1, mirror::Class::kStatusInitialized, NULL);
+  // Check there is room in the buffer, buffer position and end are NULL if there is no buffer.
+  LoadWordThreadMem(r_obj, Thread::ThreadLocalPosOffset());
+  LoadWordThreadMem(r_tmp2, Thread::ThreadLocalEndOffset());
+  OpRegRegImm(kOpAdd, r_tmp1, r_obj,
+              chunk_size + gc::space::DlMallocSpace::kThreadLocalBufferReserve);
+  LIR* branch_buffer_full = OpCmpBranch(kCondHi, r_tmp1, r_tmp2, NULL);
+  // Check there is a free slot in the allocation stack segment.
+  LoadWordThreadMem(r_tmp1, Thread::ThreadLocalAllocStackTopOffset());
+  LoadWordThreadMem(r_tmp2, Thread::ThreadLocalAllocStackEndOffset());
+  LIR* branch_stack_full = OpCmpBranch(kCondCs, r_tmp1, r_tmp2, NULL);
+  // Commit the allocation.
+  StoreWordDisp(r_tmp1, 0, r_obj);
+  OpRegImm(kOpAdd, r_tmp1, sizeof(mirror::Object*));
+  StoreWordThreadMem(Thread::ThreadLocalAllocStackTopOffset(), r_tmp1);
+  OpRegRegImm(kOpAdd, r_tmp1, r_obj, chunk_size);
+  StoreWordThreadMem(Thread::ThreadLocalPosOffset(), r_tmp1);
+  LoadWordThreadMem(r_tmp1, Thread::ThreadLocalObjectsOffset());
+  OpRegImm(kOpAdd, r_tmp1, 1);
+  StoreWordThreadMem(Thread::ThreadLocalObjectsOffset(), r_tmp1);
+  LoadConstant(r_tmp2, gc::space::DlMallocSpace::ThreadLocalChunkHeader(chunk_size));
+  StoreWordDisp(r_obj, gc::space::DlMallocSpace::kThreadLocalChunkHeaderOffset, r_tmp2);
+  // Zero the instance and install its class, the usable size of the chunk always covers the
+  // instance size rounded up to a word.
+  LoadConstant(r_tmp1, 0);
+  const int32_t class_offset = mirror::Object::ClassOffset().Int32Value();
+  for (size_t offset = 0; offset < object_size; offset += sizeof(uint32_t)) {
+    if (static_cast<int32_t>(offset) != class_offset) {
+      StoreWordDisp(r_obj, offset, r_tmp1);
+    }
+  }
+  StoreWordDisp(r_obj, class_offset, r_class);
+  // Make sure the class is visible before the object may be published to other threads.
+  GenMemBarrier(kStoreStore);
+  FreeTemp(r_class);
+  FreeTemp(r_tmp1);
+  FreeTemp(r_tmp2);
+  FreeTemp(r_obj);
+  LIR* branch_done = OpUnconditionalBranch(NULL);
+  // TUNING: move slow path to end & remove unconditional branch
+  LIR* slow_path_target = NewLIR0(kPseudoTargetLabel);
+  branch_unresolved->target = slow_path_target;
+  branch_uninitialized->target = slow_path_target;
+  branch_buffer_full->target = slow_path_target;
+  branch_stack_full->target = slow_path_target;
+  CallRuntimeHelperImmMethod(QUICK_ENTRYPOINT_OFFSET(pAllocObject), type_idx, true);
+  LIR* done_target = NewLIR0(kPseudoTargetLabel);
+  branch_done->target = done_target;
+  RegLocation rl_result = GetReturn(false);
+  StoreValue(rl_dest, rl_result);
+}
+
 void Mir2Lir::GenThrow(RegLocation rl_src) {
   FlushAllRegs();
   CallRuntimeHelperRegLocation(QUICK_ENTRYPOINT_OFFSET(pDeliverException), rl_src, true);
@@ -976,6 +1202,7 @@ void Mir2Lir::GenInstanceofCallingHelper(bool needs_access_check, bool type_know
   LoadWordDisp(TargetReg(kArg0),  mirror::Object::ClassOffset().Int32Value(), TargetReg(kArg1));
   /* kArg0 is ref, kArg1 is ref->klass_, kArg2 is class */
   LIR* branchover = NULL;
+  LIR* superclass_branch = NULL;
   if (type_known_final) {
     // rl_result == ref == null == 0.
     if (cu_->instruction_set == kThumb2) {
@@ -990,6 +1217,11 @@ void Mir2Lir::GenInstanceofCallingHelper(bool needs_access_check, bool type_know
     }
   } else {
     if (cu_->instruction_set == kThumb2) {
+      // A direct subclass is an instance without calling the helper. The ref in kArg0 is dead.
+      LoadWordDisp(TargetReg(kArg1), mirror::Class::SuperClassOffset().Int32Value(),
+                   TargetReg(kArg3));
+      LoadConstant(rl_result.low_reg, 1);
+      superclass_branch = OpCmpBranch(kCondEq, TargetReg(kArg3), TargetReg(kArg2), NULL);
       int r_tgt = LoadHelper(QUICK_ENTRYPOINT_OFFSET(pInstanceofNonTrivial));
       if (!type_known_abstract) {
       /* Uses conditional nullification */
@@ -1006,6 +1238,11 @@ void Mir2Lir::GenInstanceofCallingHelper(bool needs_access_check, bool type_know
         LoadConstant(rl_result.low_reg, 1);     // assume true
         branchover = OpCmpBranch(kCondEq, TargetReg(kArg1), TargetReg(kArg2), NULL);
       }
+      // A direct subclass is an instance without calling the helper.
+      LoadWordDisp(TargetReg(kArg1), mirror::Class::SuperClassOffset().Int32Value(),
+                   TargetReg(kArg3));
+      LoadConstant(rl_result.low_reg, 1);
+      superclass_branch = OpCmpBranch(kCondEq, TargetReg(kArg3), TargetReg(kArg2), NULL);
       if (cu_->instruction_set != kX86) {
         int r_tgt = LoadHelper(QUICK_ENTRYPOINT_OFFSET(pInstanceofNonTrivial));
         OpRegCopy(TargetReg(kArg0), TargetReg(kArg2));    // .ne case - arg0 <= class
@@ -1026,6 +1263,9 @@ void Mir2Lir::GenInstanceofCallingHelper(bool needs_access_check, bool type_know
   if (branchover != NULL) {
     branchover->target = target;
   }
+  if (superclass_branch != NULL) {
+    superclass_branch->target = target;
+  }
 }
 
 void Mir2Lir::GenInstanceof(uint32_t type_idx, RegLocation rl_dest, RegLocation rl_src) {
@@ -1113,6 +1353,11 @@ void Mir2Lir::GenCheckCast(uint32_t insn_idx, uint32_t type_idx, RegLocation rl_
   if (!type_known_abstract) {
     branch2 = OpCmpBranch(kCondEq, TargetReg(kArg1), class_reg, NULL);
   }
+  // Casting to the direct superclass, as when a collection of a base class holds subclass
+  // instances, succeeds without the hierarchy walk in the helper.
+  LoadWordDisp(TargetReg(kArg1), mirror::Class::SuperClassOffset().Int32Value(),
+               TargetReg(kArg3));
+  LIR* branch3 = OpCmpBranch(kCondEq, TargetReg(kArg3), class_reg, NULL);
   CallRuntimeHelperRegReg(QUICK_ENTRYPOINT_OFFSET(pCheckCast), TargetReg(kArg1),
                           TargetReg(kArg2), true);
   /* branch target here */
@@ -1121,6 +1366,7 @@ void Mir2Lir::GenCheckCast(uint32_t insn_idx, uint32_t type_idx, RegLocation rl_
   if (branch2 != NULL) {
     branch2->target = target;
   }
+  branch3->target = target;
 }
 
 void Mir2Lir::GenLong3Addr(OpKind first_op, OpKind second_op, RegLocation rl_dest,
@@ -1742,6 +1988,11 @@ void Mir2Lir::GenSuspendTest(int opt_flags) {
     return;
   }
   FlushAllRegs();
+  if (cu_->compiler_driver->GetImplicitSuspendChecks()) {
+    // The fault handler calls the suspend check and returns after the load.
+    MarkSafepointPC(CheckSuspendUsingLoad());
+    return;
+  }
   LIR* branch = OpTestSuspend(NULL);
   LIR* ret_lab = NewLIR0(kPseudoTargetLabel);
   LIR* target = RawLIR(current_dalvik_offset_, kPseudoSuspendTarget,
@@ -1756,6 +2007,12 @@ void Mir2Lir::GenSuspendTestAndBranch(int opt_flags, LIR* target) {
     OpUnconditionalBranch(target);
     return;
   }
+  if (cu_->compiler_driver->GetImplicitSuspendChecks()) {
+    FlushAllRegs();
+    MarkSafepointPC(CheckSuspendUsingLoad());
+    OpUnconditionalBranch(target);
+    return;
+  }
   OpTestSuspend(target);
   LIR* launch_pad =
       RawLIR(current_dalvik_offset_, kPseudoSuspendTarget,
@@ -17,8 +17,10 @@
 #include "dex/compiler_ir.h"
 #include "dex_file-inl.h"
 #include "entrypoints/quick/quick_entrypoints.h"
+#include "intrinsics.h"
 #include "invoke_type.h"
 #include "mirror/array.h"
+#include "mirror/class.h"
 #include "mirror/string.h"
 #include "mir_to_lir-inl.h"
 #include "x86/codegen_x86.h"
@@ -383,22 +385,9 @@ static int NextSDCallInsn(CompilationUnit* cu, CallInfo* info,
     case 1:  // Get method->dex_cache_resolved_methods_
       cg->LoadWordDisp(cg->TargetReg(kArg0),
         mirror::ArtMethod::DexCacheResolvedMethodsOffset().Int32Value(), cg->TargetReg(kArg0));
-      // Set up direct code if known.
-      if (direct_code != 0) {
-        if (direct_code != static_cast<unsigned int>(-1)) {
-          cg->LoadConstant(cg->TargetReg(kInvokeTgt), direct_code);
-        } else {
-          CHECK_EQ(cu->dex_file, target_method.dex_file);
-          LIR* data_target = cg->ScanLiteralPool(cg->code_literal_list_,
-                                                 target_method.dex_method_index, 0);
-          if (data_target == NULL) {
-            data_target = cg->AddWordData(&cg->code_literal_list_, target_method.dex_method_index);
-            data_target->operands[1] = type;
-          }
-          LIR* load_pc_rel = cg->OpPcRelLoad(cg->TargetReg(kInvokeTgt), data_target);
-          cg->AppendLIR(load_pc_rel);
-          DCHECK_EQ(cu->instruction_set, kThumb2) << reinterpret_cast<void*>(data_target);
-        }
+      // Set up direct code if known. -1 is a relative call, GenInvoke branches with a bl.
+      if (direct_code != 0 && direct_code != static_cast<unsigned int>(-1)) {
+        cg->LoadConstant(cg->TargetReg(kInvokeTgt), direct_code);
       }
       break;
     case 2:  // Grab target method*
@@ -476,6 +465,36 @@ static int NextVCallInsn(CompilationUnit* cu, CallInfo* info,
   return state + 1;
 }
 
+/*
+ * A virtual invoke of a boot image method that no loaded class overrides. The
+ * target Method* is loaded from the vtable as in NextVCallInsn and compared with
+ * the expected one, if they match the code address is a constant, otherwise it
+ * is loaded from the Method* as for any virtual call.
+ */
+static int NextGuardedVCallInsn(CompilationUnit* cu, CallInfo* info,
+                                int state, const MethodReference& target_method,
+                                uint32_t method_idx, uintptr_t direct_code,
+                                uintptr_t direct_method, InvokeType type) {
+  Mir2Lir* cg = static_cast<Mir2Lir*>(cu->cg.get());
+  DCHECK_EQ(cu->instruction_set, kThumb2);
+  if (state != 4) {
+    return NextVCallInsn(cu, info, state, target_method, method_idx, direct_code,
+                         direct_method, type);
+  }
+  // Is the target the expected method? [use kArg0, set kInvokeTgt]
+  cg->LoadConstant(cg->TargetReg(kInvokeTgt), direct_method);
+  LIR* overridden = cg->OpCmpBranch(kCondNe, cg->TargetReg(kArg0), cg->TargetReg(kInvokeTgt),
+                                    NULL);
+  cg->LoadConstant(cg->TargetReg(kInvokeTgt), direct_code);
+  LIR* done = cg->OpUnconditionalBranch(NULL);
+  overridden->target = cg->NewLIR0(kPseudoTargetLabel);
+  cg->LoadWordDisp(cg->TargetReg(kArg0),
+                   mirror::ArtMethod::GetEntryPointFromCompiledCodeOffset().Int32Value(),
+                   cg->TargetReg(kInvokeTgt));
+  done->target = cg->NewLIR0(kPseudoTargetLabel);
+  return state + 1;
+}
+
 /*
  * All invoke-interface calls bounce off of art_quick_invoke_interface_trampoline,
  * which will locate the target and continue on via a tail call.
@@ -548,6 +567,40 @@ static int NextInterfaceCallInsn(CompilationUnit* cu, CallInfo* info, int state,
   return state + 1;
 }
 
+/*
+ * Look the interface method up in the interface method table of the receiver's
+ * class before falling back to the trampoline NextInterfaceCallInsn loaded. On
+ * entry kArg0 holds the interface Method* and kArg1 the null checked "this".
+ * When the imt slot holds kArg0, kArg0 is replaced with the implementation and
+ * kInvokeTgt with its code, otherwise kInvokeTgt is the trampoline.
+ */
+static void GenImtLookup(CompilationUnit* cu, uint32_t imt_index) {
+  Mir2Lir* cg = static_cast<Mir2Lir*>(cu->cg.get());
+  DCHECK_EQ(cu->instruction_set, kThumb2);
+  DCHECK_LT(imt_index, mirror::Class::kImtSize);
+  int32_t key_offset = mirror::Array::DataOffset(sizeof(mirror::Object*)).Int32Value() +
+      (imt_index * 2 * sizeof(mirror::Object*));
+  int r_imt = cg->AllocTemp();
+  cg->LoadWordDisp(cg->TargetReg(kArg1), mirror::Object::ClassOffset().Int32Value(), r_imt);
+  cg->LoadWordDisp(r_imt, mirror::Class::ImTableOffset().Int32Value(), r_imt);
+  LIR* no_imt = cg->OpCmpImmBranch(kCondEq, r_imt, 0, NULL);
+  cg->LoadWordDisp(r_imt, key_offset, cg->TargetReg(kInvokeTgt));
+  LIR* miss = cg->OpCmpBranch(kCondNe, cg->TargetReg(kInvokeTgt), cg->TargetReg(kArg0), NULL);
+  cg->LoadWordDisp(r_imt, key_offset + sizeof(mirror::Object*), cg->TargetReg(kArg0));
+  cg->LoadWordDisp(cg->TargetReg(kArg0),
+                   mirror::ArtMethod::GetEntryPointFromCompiledCodeOffset().Int32Value(),
+                   cg->TargetReg(kInvokeTgt));
+  LIR* done = cg->OpUnconditionalBranch(NULL);
+  miss->target = cg->NewLIR0(kPseudoTargetLabel);
+  cg->LoadWordDisp(cg->TargetReg(kSelf),
+                   QUICK_ENTRYPOINT_OFFSET(pInvokeInterfaceTrampoline).Int32Value(),
+                   cg->TargetReg(kInvokeTgt));
+  LIR* target = cg->NewLIR0(kPseudoTargetLabel);
+  no_imt->target = target;
+  done->target = target;
+  cg->FreeTemp(r_imt);
+}
+
 static int NextInvokeInsnSP(CompilationUnit* cu, CallInfo* info, ThreadOffset trampoline,
                             int state, const MethodReference& target_method,
                             uint32_t method_idx) {
@@ -1125,6 +1178,34 @@ bool Mir2Lir::GenInlinedStringCompareTo(CallInfo* info) {
   return true;
 }
 
+/* Fast string.equals(Ljava/lang/Object;)Z. */
+bool Mir2Lir::GenInlinedStringEquals(CallInfo* info) {
+  ClobberCalleeSave();
+  LockCallTemps();  // Using fixed registers
+  int reg_this = TargetReg(kArg0);
+  int reg_other = TargetReg(kArg1);
+
+  RegLocation rl_this = info->args[0];
+  RegLocation rl_other = info->args[1];
+  LoadValueDirectFixed(rl_this, reg_this);
+  LoadValueDirectFixed(rl_other, reg_other);
+  int r_tgt = (cu_->instruction_set != kX86) ?
+      LoadHelper(QUICK_ENTRYPOINT_OFFSET(pStringEquals)) : 0;
+  GenNullCheck(rl_this.s_reg_low, reg_this, info->opt_flags);
+  // NOTE: not a safepoint
+  if (cu_->instruction_set != kX86) {
+    OpReg(kOpBlx, r_tgt);
+  } else {
+    OpThreadMem(kOpBlx, QUICK_ENTRYPOINT_OFFSET(pStringEquals));
+  }
+  // Record that we've already inlined & null checked
+  info->opt_flags |= (MIR_INLINED | MIR_IGNORE_NULL_CHECK);
+  RegLocation rl_return = GetReturn(false);
+  RegLocation rl_dest = InlineTarget(info);
+  StoreValue(rl_dest, rl_return);
+  return true;
+}
+
 bool Mir2Lir::GenInlinedCurrentThread(CallInfo* info) {
   RegLocation rl_dest = InlineTarget(info);
   RegLocation rl_result = EvalLoc(rl_dest, kCoreReg, true);
@@ -1155,12 +1236,17 @@ bool Mir2Lir::GenInlinedUnsafeGet(CallInfo* info,
   }
   RegLocation rl_object = LoadValue(rl_src_obj, kCoreReg);
   RegLocation rl_offset = LoadValue(rl_src_offset, kCoreReg);
-  RegLocation rl_result = EvalLoc(rl_dest, kCoreReg, true);
-  if (is_long) {
+  if (is_long && is_volatile) {
+    OpRegReg(kOpAdd, rl_object.low_reg, rl_offset.low_reg);
+    RegLocation rl_result = GenAtomicWideLoad(rl_object.low_reg, rl_dest);
+    StoreValueWide(rl_dest, rl_result);
+  } else if (is_long) {
+    RegLocation rl_result = EvalLoc(rl_dest, kCoreReg, true);
     OpRegReg(kOpAdd, rl_object.low_reg, rl_offset.low_reg);
     LoadBaseDispWide(rl_object.low_reg, 0, rl_result.low_reg, rl_result.high_reg, INVALID_SREG);
     StoreValueWide(rl_dest, rl_result);
   } else {
+    RegLocation rl_result = EvalLoc(rl_dest, kCoreReg, true);
     LoadBaseIndexed(rl_object.low_reg, rl_offset.low_reg, rl_result.low_reg, 0, kWord);
     StoreValue(rl_dest, rl_result);
   }
@@ -1188,7 +1274,12 @@ bool Mir2Lir::GenInlinedUnsafePut(CallInfo* info, bool is_long,
   RegLocation rl_object = LoadValue(rl_src_obj, kCoreReg);
   RegLocation rl_offset = LoadValue(rl_src_offset, kCoreReg);
   RegLocation rl_value;
-  if (is_long) {
+  if (is_long && is_volatile) {
+    OpRegReg(kOpAdd, rl_object.low_reg, rl_offset.low_reg);
+    ClobberSReg(rl_offset.s_reg_low);
+    FreeTemp(rl_offset.low_reg);
+    GenAtomicWideStore(rl_object.low_reg, rl_src_value);
+  } else if (is_long) {
     rl_value = LoadValueWide(rl_src_value, kCoreReg);
     OpRegReg(kOpAdd, rl_object.low_reg, rl_offset.low_reg);
     StoreBaseDispWide(rl_object.low_reg, 0, rl_value.low_reg, rl_value.high_reg);
@@ -1210,143 +1301,89 @@ bool Mir2Lir::GenIntrinsic(CallInfo* info) {
     return false;
   }
   /*
-   * TODO: move these to a target-specific structured constant array
-   * and use a generic match function.  The list of intrinsics may be
-   * slightly different depending on target.
+   * TODO: The list of intrinsics may be slightly different depending on target.
    * TODO: Fold this into a matching function that runs during
    * basic block building.  This should be part of the action for
    * small method inlining and recognition of the special object init
    * method.  By doing this during basic block construction, we can also
    * take advantage of/generate new useful dataflow info.
    */
-  StringPiece tgt_methods_declaring_class(
-      cu_->dex_file->GetMethodDeclaringClassDescriptor(cu_->dex_file->GetMethodId(info->index)));
-  if (tgt_methods_declaring_class.starts_with("Ljava/lang/Double;")) {
-    std::string tgt_method(PrettyMethod(info->index, *cu_->dex_file));
-    if (tgt_method == "long java.lang.Double.doubleToRawLongBits(double)") {
+  switch (FindIntrinsic(*cu_->dex_file, info->index)) {
+    case kIntrinsicDoubleToRawLongBits:
+    case kIntrinsicLongBitsToDouble:
       return GenInlinedDoubleCvt(info);
-    }
-    if (tgt_method == "double java.lang.Double.longBitsToDouble(long)") {
-      return GenInlinedDoubleCvt(info);
-    }
-  } else if (tgt_methods_declaring_class.starts_with("Ljava/lang/Float;")) {
-    std::string tgt_method(PrettyMethod(info->index, *cu_->dex_file));
-    if (tgt_method == "int java.lang.Float.float_to_raw_int_bits(float)") {
+    case kIntrinsicFloatToRawIntBits:
+    case kIntrinsicIntBitsToFloat:
       return GenInlinedFloatCvt(info);
-    }
-    if (tgt_method == "float java.lang.Float.intBitsToFloat(int)") {
-      return GenInlinedFloatCvt(info);
-    }
-  } else if (tgt_methods_declaring_class.starts_with("Ljava/lang/Math;") ||
-             tgt_methods_declaring_class.starts_with("Ljava/lang/StrictMath;")) {
-    std::string tgt_method(PrettyMethod(info->index, *cu_->dex_file));
-    if (tgt_method == "int java.lang.Math.abs(int)" ||
-        tgt_method == "int java.lang.StrictMath.abs(int)") {
+    case kIntrinsicAbsInt:
       return GenInlinedAbsInt(info);
-    }
-    if (tgt_method == "long java.lang.Math.abs(long)" ||
-        tgt_method == "long java.lang.StrictMath.abs(long)") {
+    case kIntrinsicAbsLong:
       return GenInlinedAbsLong(info);
-    }
-    if (tgt_method == "int java.lang.Math.max(int, int)" ||
-        tgt_method == "int java.lang.StrictMath.max(int, int)") {
+    case kIntrinsicMaxInt:
       return GenInlinedMinMaxInt(info, false /* is_min */);
-    }
-    if (tgt_method == "int java.lang.Math.min(int, int)" ||
-        tgt_method == "int java.lang.StrictMath.min(int, int)") {
+    case kIntrinsicMinInt:
       return GenInlinedMinMaxInt(info, true /* is_min */);
-    }
-    if (tgt_method == "double java.lang.Math.sqrt(double)" ||
-        tgt_method == "double java.lang.StrictMath.sqrt(double)") {
+    case kIntrinsicSqrt:
       return GenInlinedSqrt(info);
-    }
-  } else if (tgt_methods_declaring_class.starts_with("Ljava/lang/String;")) {
-    std::string tgt_method(PrettyMethod(info->index, *cu_->dex_file));
-    if (tgt_method == "char java.lang.String.charAt(int)") {
+    case kIntrinsicStringCharAt:
       return GenInlinedCharAt(info);
-    }
-    if (tgt_method == "int java.lang.String.compareTo(java.lang.String)") {
+    case kIntrinsicStringCompareTo:
       return GenInlinedStringCompareTo(info);
-    }
-    if (tgt_method == "boolean java.lang.String.is_empty()") {
+    case kIntrinsicStringEquals:
+      return GenInlinedStringEquals(info);
+    case kIntrinsicStringIsEmpty:
       return GenInlinedStringIsEmptyOrLength(info, true /* is_empty */);
-    }
-    if (tgt_method == "int java.lang.String.index_of(int, int)") {
+    case kIntrinsicStringIndexOfFrom:
       return GenInlinedIndexOf(info, false /* base 0 */);
-    }
-    if (tgt_method == "int java.lang.String.index_of(int)") {
+    case kIntrinsicStringIndexOf:
       return GenInlinedIndexOf(info, true /* base 0 */);
-    }
-    if (tgt_method == "int java.lang.String.length()") {
+    case kIntrinsicStringLength:
       return GenInlinedStringIsEmptyOrLength(info, false /* is_empty */);
-    }
-  } else if (tgt_methods_declaring_class.starts_with("Ljava/lang/Thread;")) {
-    std::string tgt_method(PrettyMethod(info->index, *cu_->dex_file));
-    if (tgt_method == "java.lang.Thread java.lang.Thread.currentThread()") {
+    case kIntrinsicCurrentThread:
       return GenInlinedCurrentThread(info);
-    }
-  } else if (tgt_methods_declaring_class.starts_with("Lsun/misc/Unsafe;")) {
-    std::string tgt_method(PrettyMethod(info->index, *cu_->dex_file));
-    if (tgt_method == "boolean sun.misc.Unsafe.compareAndSwapInt(java.lang.Object, long, int, int)") {
+    case kIntrinsicUnsafeCasInt:
       return GenInlinedCas32(info, false);
-    }
-    if (tgt_method == "boolean sun.misc.Unsafe.compareAndSwapObject(java.lang.Object, long, java.lang.Object, java.lang.Object)") {
+    case kIntrinsicUnsafeCasObject:
       return GenInlinedCas32(info, true);
-    }
-    if (tgt_method == "int sun.misc.Unsafe.getInt(java.lang.Object, long)") {
+    case kIntrinsicUnsafeGetInt:
+    case kIntrinsicUnsafeGetObject:
       return GenInlinedUnsafeGet(info, false /* is_long */, false /* is_volatile */);
-    }
-    if (tgt_method == "int sun.misc.Unsafe.getIntVolatile(java.lang.Object, long)") {
+    case kIntrinsicUnsafeGetIntVolatile:
+    case kIntrinsicUnsafeGetObjectVolatile:
       return GenInlinedUnsafeGet(info, false /* is_long */, true /* is_volatile */);
-    }
-    if (tgt_method == "void sun.misc.Unsafe.putInt(java.lang.Object, long, int)") {
+    case kIntrinsicUnsafePutInt:
       return GenInlinedUnsafePut(info, false /* is_long */, false /* is_object */,
                                  false /* is_volatile */, false /* is_ordered */);
-    }
-    if (tgt_method == "void sun.misc.Unsafe.putIntVolatile(java.lang.Object, long, int)") {
+    case kIntrinsicUnsafePutIntVolatile:
       return GenInlinedUnsafePut(info, false /* is_long */, false /* is_object */,
                                  true /* is_volatile */, false /* is_ordered */);
-    }
-    if (tgt_method == "void sun.misc.Unsafe.putOrderedInt(java.lang.Object, long, int)") {
+    case kIntrinsicUnsafePutOrderedInt:
       return GenInlinedUnsafePut(info, false /* is_long */, false /* is_object */,
                                  false /* is_volatile */, true /* is_ordered */);
-    }
-    if (tgt_method == "long sun.misc.Unsafe.getLong(java.lang.Object, long)") {
+    case kIntrinsicUnsafeGetLong:
       return GenInlinedUnsafeGet(info, true /* is_long */, false /* is_volatile */);
-    }
-    if (tgt_method == "long sun.misc.Unsafe.getLongVolatile(java.lang.Object, long)") {
+    case kIntrinsicUnsafeGetLongVolatile:
       return GenInlinedUnsafeGet(info, true /* is_long */, true /* is_volatile */);
-    }
-    if (tgt_method == "void sun.misc.Unsafe.putLong(java.lang.Object, long, long)") {
+    case kIntrinsicUnsafePutLong:
       return GenInlinedUnsafePut(info, true /* is_long */, false /* is_object */,
                                  false /* is_volatile */, false /* is_ordered */);
-    }
-    if (tgt_method == "void sun.misc.Unsafe.putLongVolatile(java.lang.Object, long, long)") {
+    case kIntrinsicUnsafePutLongVolatile:
       return GenInlinedUnsafePut(info, true /* is_long */, false /* is_object */,
                                  true /* is_volatile */, false /* is_ordered */);
-    }
-    if (tgt_method == "void sun.misc.Unsafe.putOrderedLong(java.lang.Object, long, long)") {
+    case kIntrinsicUnsafePutOrderedLong:
       return GenInlinedUnsafePut(info, true /* is_long */, false /* is_object */,
                                  false /* is_volatile */, true /* is_ordered */);
-    }
-    if (tgt_method == "java.lang.Object sun.misc.Unsafe.getObject(java.lang.Object, long)") {
-      return GenInlinedUnsafeGet(info, false /* is_long */, false /* is_volatile */);
-    }
-    if (tgt_method == "java.lang.Object sun.misc.Unsafe.getObjectVolatile(java.lang.Object, long)") {
-      return GenInlinedUnsafeGet(info, false /* is_long */, true /* is_volatile */);
-    }
-    if (tgt_method == "void sun.misc.Unsafe.putObject(java.lang.Object, long, java.lang.Object)") {
+    case kIntrinsicUnsafePutObject:
       return GenInlinedUnsafePut(info, false /* is_long */, true /* is_object */,
                                  false /* is_volatile */, false /* is_ordered */);
-    }
-    if (tgt_method == "void sun.misc.Unsafe.putObjectVolatile(java.lang.Object, long, java.lang.Object)") {
+    case kIntrinsicUnsafePutObjectVolatile:
       return GenInlinedUnsafePut(info, false /* is_long */, true /* is_object */,
                                  true /* is_volatile */, false /* is_ordered */);
-    }
-    if (tgt_method == "void sun.misc.Unsafe.putOrderedObject(java.lang.Object, long, java.lang.Object)") {
+    case kIntrinsicUnsafePutOrderedObject:
       return GenInlinedUnsafePut(info, false /* is_long */, true /* is_object */,
                                  false /* is_volatile */, true /* is_ordered */);
-    }
+    case kIntrinsicNone:
+      break;
   }
   return false;
 }
@@ -1400,6 +1437,11 @@ void Mir2Lir::GenInvoke(CallInfo* info) {
     DCHECK_EQ(info->type, kVirtual);
     next_call_insn = fast_path ? NextVCallInsn : NextVCallInsnSP;
     skip_this = fast_path;
+    if (fast_path && !(cu_->disable_opt & (1 << kDevirtualization)) &&
+        cu_->compiler_driver->ComputeGuardedDevirtualInfo(cUnit, target_method,
+                                                          direct_code, direct_method)) {
+      next_call_insn = NextGuardedVCallInsn;
+    }
   }
   if (!info->is_range) {
     call_state = GenDalvikArgsNoRange(info, call_state, p_null_ck,
@@ -1418,8 +1460,15 @@ void Mir2Lir::GenInvoke(CallInfo* info) {
                                 vtable_idx, direct_code, direct_method,
                                 original_type);
   }
+  if (fast_path && info->type == kInterface && cu_->instruction_set == kThumb2) {
+    GenImtLookup(cu_, vtable_idx);
+  }
   LIR* call_inst;
-  if (cu_->instruction_set != kX86) {
+  if (fast_path && (info->type == kDirect || info->type == kStatic) &&
+      direct_code == static_cast<unsigned int>(-1) && direct_method == 0) {
+    // A call to a method of this oat file, see CompilerDriver::CanCallRelative.
+    call_inst = OpRelativeCall(target_method, info->type);
+  } else if (cu_->instruction_set != kX86) {
     call_inst = OpReg(kOpBlx, TargetReg(kInvokeTgt));
   } else {
     if (fast_path && info->type != kInterface) {
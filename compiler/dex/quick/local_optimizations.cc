@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+
 #include "dex/compiler_internals.h"
 
 namespace art {
@@ -28,6 +30,11 @@ namespace art {
 #define MAX_HOIST_DISTANCE 20
 #define LDLD_DISTANCE 4
 #define LD_LATENCY 2
+#define MAX_SCHEDULE_REGION 32
+
+/* Peephole limits */
+#define MAX_COPY_DISTANCE 16
+#define MAX_BRANCH_CHAIN 8
 
 static bool IsDalvikRegisterClobbered(LIR* lir1, LIR* lir2) {
   int reg1Lo = DECODE_ALIAS_INFO_REG(lir1->alias_info);
@@ -459,6 +466,171 @@ void Mir2Lir::ApplyLoadHoisting(LIR* head_lir, LIR* tail_lir) {
   }
 }
 
+/* Whether the memory accesses of the two instructions may have to stay in order */
+static bool IsMemoryDependent(LIR* lir1, LIR* lir2) {
+  uint64_t mem_mask1 = (lir1->use_mask | lir1->def_mask) & ENCODE_MEM;
+  uint64_t mem_mask2 = (lir2->use_mask | lir2->def_mask) & ENCODE_MEM;
+  uint64_t alias_condition = mem_mask1 & mem_mask2;
+  /* Reads can always be reordered */
+  if ((alias_condition == 0) ||
+      !((lir1->def_mask | lir2->def_mask) & alias_condition)) {
+    return false;
+  }
+  /* We can fully disambiguate Dalvik references */
+  if ((alias_condition == ENCODE_DALVIK_REG) && (mem_mask1 == ENCODE_DALVIK_REG) &&
+      (mem_mask2 == ENCODE_DALVIK_REG)) {
+    return IsDalvikRegisterClobbered(lir1, lir2);
+  }
+  return true;
+}
+
+/*
+ * Reorder the instructions of a region without barriers with a list scheduler: the ready
+ * instruction that can issue first goes first, ties go to the longest latency path to the end of
+ * the region and then to the original order. Pseudo instructions and nops keep their places.
+ */
+void Mir2Lir::ScheduleRegion(LIR** region, int region_size) {
+  LIR* insns[MAX_SCHEDULE_REGION];
+  int num_insns = 0;
+  for (int i = 0; i < region_size; i++) {
+    if (!region[i]->flags.is_nop && !is_pseudo_opcode(region[i]->opcode)) {
+      insns[num_insns++] = region[i];
+    }
+  }
+  if (num_insns < 2) {
+    return;
+  }
+
+  /* latency[i][j] is the number of cycles j has to issue after i, or -1 if independent */
+  int latency[MAX_SCHEDULE_REGION][MAX_SCHEDULE_REGION];
+  int num_preds[MAX_SCHEDULE_REGION];
+  for (int j = 0; j < num_insns; j++) {
+    num_preds[j] = 0;
+    uint64_t use_mask = insns[j]->use_mask & ~ENCODE_MEM;
+    uint64_t def_mask = insns[j]->def_mask & ~ENCODE_MEM;
+    for (int i = 0; i < j; i++) {
+      uint64_t prev_use_mask = insns[i]->use_mask & ~ENCODE_MEM;
+      uint64_t prev_def_mask = insns[i]->def_mask & ~ENCODE_MEM;
+      int dep_latency = -1;
+      if (prev_def_mask & use_mask) {
+        /* RAW */
+        dep_latency = GetInsnLatency(insns[i]);
+      } else if ((prev_def_mask & def_mask) || IsMemoryDependent(insns[i], insns[j])) {
+        /* WAW, or conflicting memory accesses */
+        dep_latency = 1;
+      } else if (prev_use_mask & def_mask) {
+        /* WAR */
+        dep_latency = 0;
+      }
+      latency[i][j] = dep_latency;
+      if (dep_latency >= 0) {
+        num_preds[j]++;
+      }
+    }
+  }
+
+  /* Length of the longest latency path from each instruction to the end of the region */
+  int height[MAX_SCHEDULE_REGION];
+  for (int i = num_insns - 1; i >= 0; i--) {
+    height[i] = GetInsnLatency(insns[i]);
+    for (int j = i + 1; j < num_insns; j++) {
+      if ((latency[i][j] >= 0) && (latency[i][j] + height[j] > height[i])) {
+        height[i] = latency[i][j] + height[j];
+      }
+    }
+  }
+
+  int earliest[MAX_SCHEDULE_REGION];
+  bool scheduled[MAX_SCHEDULE_REGION];
+  for (int i = 0; i < num_insns; i++) {
+    earliest[i] = 0;
+    scheduled[i] = false;
+  }
+  LIR* order[MAX_SCHEDULE_REGION];
+  int cycle = 0;
+  for (int n = 0; n < num_insns; n++) {
+    int best = -1;
+    int best_cycle = 0;
+    for (int i = 0; i < num_insns; i++) {
+      if (scheduled[i] || (num_preds[i] != 0)) {
+        continue;
+      }
+      int issue_cycle = std::max(cycle, earliest[i]);
+      if ((best < 0) || (issue_cycle < best_cycle) ||
+          ((issue_cycle == best_cycle) && (height[i] > height[best]))) {
+        best = i;
+        best_cycle = issue_cycle;
+      }
+    }
+    DCHECK_GE(best, 0);
+    scheduled[best] = true;
+    order[n] = insns[best];
+    cycle = best_cycle + 1;
+    for (int j = best + 1; j < num_insns; j++) {
+      if (latency[best][j] >= 0) {
+        num_preds[j]--;
+        earliest[j] = std::max(earliest[j], best_cycle + latency[best][j]);
+      }
+    }
+  }
+
+  /* Relink the region with the instructions in their new order */
+  LIR* prev_lir = region[0]->prev;
+  LIR* next_lir = region[region_size - 1]->next;
+  int next_insn = 0;
+  for (int i = 0; i < region_size; i++) {
+    LIR* lir = region[i];
+    if (!lir->flags.is_nop && !is_pseudo_opcode(lir->opcode)) {
+      lir = order[next_insn++];
+    }
+    prev_lir->next = lir;
+    lir->prev = prev_lir;
+    prev_lir = lir;
+  }
+  prev_lir->next = next_lir;
+  next_lir->prev = prev_lir;
+}
+
+/*
+ * Split the superblock into regions between scheduling barriers - labels, branches, calls,
+ * safepoints and anything else that defines or uses all resources - and schedule each of them.
+ * Dalvik byte code boundaries don't end a region, so instructions can move to an earlier or
+ * later Dalvik instruction of the same block.
+ */
+void Mir2Lir::ApplyListScheduling(LIR* head_lir, LIR* tail_lir) {
+  LIR* region[MAX_SCHEDULE_REGION];
+  int region_size = 0;
+  int it_insns = 0;
+  for (LIR* this_lir = NEXT_LIR(head_lir); this_lir != tail_lir; ) {
+    /* The region may be relinked, find the next instruction first */
+    LIR* next_lir = NEXT_LIR(this_lir);
+    bool barrier;
+    if (is_pseudo_opcode(this_lir->opcode)) {
+      barrier = (this_lir->opcode != kPseudoDalvikByteCodeBoundary);
+    } else if (this_lir->flags.is_nop) {
+      barrier = false;
+    } else if (it_insns > 0) {
+      /* The instructions of an IT block stay right after it */
+      it_insns--;
+      barrier = true;
+    } else {
+      uint64_t flags = GetTargetInstFlags(this_lir->opcode);
+      barrier = (this_lir->def_mask == ENCODE_ALL) || (this_lir->use_mask == ENCODE_ALL) ||
+          ((flags & NEEDS_FIXUP) && !(flags & IS_LOAD));
+      it_insns = ITShadowSize(this_lir);
+    }
+    if (barrier || (region_size == MAX_SCHEDULE_REGION)) {
+      ScheduleRegion(region, region_size);
+      region_size = 0;
+    }
+    if (!barrier) {
+      region[region_size++] = this_lir;
+    }
+    this_lir = next_lir;
+  }
+  ScheduleRegion(region, region_size);
+}
+
 void Mir2Lir::ApplyLocalOptimizations(LIR* head_lir, LIR* tail_lir) {
   if (!(cu_->disable_opt & (1 << kLoadStoreElimination))) {
     ApplyLoadStoreElimination(head_lir, tail_lir);
@@ -466,6 +638,9 @@ void Mir2Lir::ApplyLocalOptimizations(LIR* head_lir, LIR* tail_lir) {
   if (!(cu_->disable_opt & (1 << kLoadHoisting))) {
     ApplyLoadHoisting(head_lir, tail_lir);
   }
+  if (!(cu_->disable_opt & (1 << kInstructionScheduling))) {
+    ApplyListScheduling(head_lir, tail_lir);
+  }
 }
 
 /*
@@ -505,4 +680,148 @@ void Mir2Lir::RemoveRedundantBranches() {
   }
 }
 
+/* The number of instructions an IT instruction makes conditional, 0 for anything else */
+int Mir2Lir::ITShadowSize(LIR* lir) {
+  if (is_pseudo_opcode(lir->opcode) || !(GetTargetInstFlags(lir->opcode) & IS_IT)) {
+    return 0;
+  }
+  /* The mask ends with a one after a bit for each instruction but the first */
+  int mask = lir->operands[1];
+  int size = 4;
+  while ((mask & 1) == 0) {
+    mask >>= 1;
+    size--;
+  }
+  return size;
+}
+
+/*
+ * Whether the condition codes lir leaves may be read by a later instruction. No code relies
+ * on the condition codes at a label, so the search stops at the first one.
+ */
+bool Mir2Lir::CCodesUsedAfter(LIR* lir) {
+  for (LIR* next_lir = NEXT_LIR(lir); next_lir != NULL; next_lir = NEXT_LIR(next_lir)) {
+    if (is_pseudo_opcode(next_lir->opcode)) {
+      if ((next_lir->opcode != kPseudoDalvikByteCodeBoundary) &&
+          (next_lir->opcode != kPseudoSafepointPC) &&
+          (next_lir->opcode != kPseudoExportedPC)) {
+        return false;
+      }
+      continue;
+    }
+    if (next_lir->flags.is_nop) {
+      continue;
+    }
+    uint64_t flags = GetTargetInstFlags(next_lir->opcode);
+    if (flags & USES_CCODES) {
+      return true;
+    }
+    if ((flags & SETS_CCODES) || IsUnconditionalBranch(next_lir)) {
+      return false;
+    }
+  }
+  return false;
+}
+
+/*
+ * Nop register copies whose destination already holds the source - a repeat of an earlier copy
+ * or the copy back of one - when neither register is written in between. The register
+ * allocator leaves these behind when a value it just copied into a temp is copied back to its
+ * home register. Only straight line code after the first copy is searched.
+ */
+void Mir2Lir::RemoveRedundantCopies() {
+  int it_insns = 0;
+  for (LIR* this_lir = first_lir_insn_; this_lir != NULL; this_lir = NEXT_LIR(this_lir)) {
+    if (is_pseudo_opcode(this_lir->opcode) || this_lir->flags.is_nop) {
+      continue;
+    }
+    /* A conditional copy says nothing about the registers after it */
+    if (it_insns > 0) {
+      it_insns--;
+      continue;
+    }
+    it_insns = ITShadowSize(this_lir);
+    if (!IsRegCopy(this_lir) || (this_lir->operands[0] == this_lir->operands[1])) {
+      continue;
+    }
+    int dest = this_lir->operands[0];
+    int src = this_lir->operands[1];
+    uint64_t copy_mask = GetRegMaskCommon(dest) | GetRegMaskCommon(src);
+    int distance = 0;
+    for (LIR* check_lir = NEXT_LIR(this_lir);
+         (check_lir != NULL) && (distance < MAX_COPY_DISTANCE);
+         check_lir = NEXT_LIR(check_lir)) {
+      if (is_pseudo_opcode(check_lir->opcode)) {
+        if (check_lir->opcode == kPseudoDalvikByteCodeBoundary) {
+          continue;
+        }
+        break;
+      }
+      if (check_lir->flags.is_nop) {
+        continue;
+      }
+      distance++;
+      uint64_t flags = GetTargetInstFlags(check_lir->opcode);
+      if (IsRegCopy(check_lir) &&
+          (((check_lir->operands[0] == dest) && (check_lir->operands[1] == src)) ||
+           ((check_lir->operands[0] == src) && (check_lir->operands[1] == dest)))) {
+        /* Some copies also set the condition codes */
+        if (!(flags & SETS_CCODES) || !CCodesUsedAfter(check_lir)) {
+          DEBUG_OPT(dump_dependent_insn_pair(this_lir, check_lir, "REG COPY"));
+          check_lir->flags.is_nop = true;
+        }
+        break;
+      }
+      if ((flags & (IS_BRANCH | IS_IT)) || (check_lir->def_mask & copy_mask)) {
+        break;
+      }
+    }
+  }
+}
+
+/*
+ * Retarget branches to unconditional branches at the final destination of the chain, so that
+ * the jump through the intermediate branches is skipped. The assembler widens the branches
+ * that no longer reach.
+ */
+void Mir2Lir::ChainBranches() {
+  for (LIR* this_lir = first_lir_insn_; this_lir != NULL; this_lir = NEXT_LIR(this_lir)) {
+    if (is_pseudo_opcode(this_lir->opcode) || this_lir->flags.is_nop ||
+        (this_lir->target == NULL)) {
+      continue;
+    }
+    /* Not branch and link, which computes an address from the target */
+    uint64_t flags = GetTargetInstFlags(this_lir->opcode);
+    if (!(flags & IS_BRANCH) || (flags & REG_DEF_LR)) {
+      continue;
+    }
+    for (int i = 0; i < MAX_BRANCH_CHAIN; i++) {
+      LIR* next_lir = this_lir->target;
+      while ((next_lir != NULL) &&
+             (is_pseudo_opcode(next_lir->opcode) || next_lir->flags.is_nop)) {
+        next_lir = NEXT_LIR(next_lir);
+      }
+      if ((next_lir == NULL) || (next_lir == this_lir) || !IsUnconditionalBranch(next_lir) ||
+          (next_lir->target == NULL) || (next_lir->target == this_lir->target)) {
+        break;
+      }
+      this_lir->target = next_lir->target;
+    }
+  }
+}
+
+/*
+ * Peephole optimizations of the finished LIR, just before it's assembled. Removing copies may
+ * bring a flag setting instruction next to a compare the target can fold, and chaining may
+ * leave new branches to the next instruction.
+ */
+void Mir2Lir::ApplyPeepholeOptimizations() {
+  RemoveRedundantCopies();
+  ApplyTargetPeepholeOptimizations();
+  ChainBranches();
+  if (!(cu_->disable_opt & (1 << kSafeOptimizations))) {
+    RemoveRedundantBranches();
+  }
+}
+
 }  // namespace art
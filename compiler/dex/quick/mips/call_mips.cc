@@ -65,6 +65,10 @@ void MipsMir2Lir::GenSparseSwitch(MIR* mir, uint32_t table_offset,
   if (cu_->verbose) {
     DumpSparseSwitchTable(table);
   }
+  if (table[1] <= kSmallSparseSwitchEntries) {
+    GenSparseSwitchSearch(table, rl_src);
+    return;
+  }
   // Add the table to the list - we'll process it later
   SwitchTable *tab_rec =
       static_cast<SwitchTable*>(arena_->Alloc(sizeof(SwitchTable), ArenaAllocator::kAllocData));
@@ -308,13 +312,18 @@ void MipsMir2Lir::GenMoveException(RegLocation rl_dest) {
 void MipsMir2Lir::MarkGCCard(int val_reg, int tgt_addr_reg) {
   int reg_card_base = AllocTemp();
   int reg_card_no = AllocTemp();
-  LIR* branch_over = OpCmpImmBranch(kCondEq, val_reg, 0, NULL);
+  LIR* branch_over = NULL;
+  if (val_reg != INVALID_REG) {
+    branch_over = OpCmpImmBranch(kCondEq, val_reg, 0, NULL);
+  }
   LoadWordDisp(rMIPS_SELF, Thread::CardTableOffset().Int32Value(), reg_card_base);
   OpRegRegImm(kOpLsr, reg_card_no, tgt_addr_reg, gc::accounting::CardTable::kCardShift);
   StoreBaseIndexed(reg_card_base, reg_card_no, reg_card_base, 0,
                    kUnsignedByte);
-  LIR* target = NewLIR0(kPseudoTargetLabel);
-  branch_over->target = target;
+  if (branch_over != NULL) {
+    LIR* target = NewLIR0(kPseudoTargetLabel);
+    branch_over->target = target;
+  }
   FreeTemp(reg_card_base);
   FreeTemp(reg_card_no);
 }
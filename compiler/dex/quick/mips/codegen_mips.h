@@ -30,6 +30,8 @@ class MipsMir2Lir : public Mir2Lir {
     bool SmallLiteralDivRem(Instruction::Code dalvik_opcode, bool is_div, RegLocation rl_src,
                                     RegLocation rl_dest, int lit);
     int LoadHelper(ThreadOffset offset);
+    LIR* LoadWordThreadMem(int r_dest, ThreadOffset thread_offset);
+    LIR* StoreWordThreadMem(ThreadOffset thread_offset, int r_src);
     LIR* LoadBaseDisp(int rBase, int displacement, int r_dest, OpSize size, int s_reg);
     LIR* LoadBaseDispWide(int rBase, int displacement, int r_dest_lo, int r_dest_hi,
                                   int s_reg);
@@ -81,7 +83,10 @@ class MipsMir2Lir : public Mir2Lir {
     uint64_t GetPCUseDefEncoding();
     uint64_t GetTargetInstFlags(int opcode);
     int GetInsnSize(LIR* lir);
+    int GetInsnLatency(LIR* lir);
     bool IsUnconditionalBranch(LIR* lir);
+    bool IsRegCopy(LIR* lir);
+    void ApplyTargetPeepholeOptimizations();
 
     // Required for target - Dalvik-level generators.
     void GenArithImmOpLong(Instruction::Code opcode, RegLocation rl_dest,
@@ -105,6 +110,9 @@ class MipsMir2Lir : public Mir2Lir {
                           RegLocation rl_src2);
     void GenConversion(Instruction::Code opcode, RegLocation rl_dest, RegLocation rl_src);
     bool GenInlinedCas32(CallInfo* info, bool need_write_barrier);
+    bool SupportsAtomicWide();
+    RegLocation GenAtomicWideLoad(int r_ptr, RegLocation rl_dest);
+    void GenAtomicWideStore(int r_ptr, RegLocation rl_src);
     bool GenInlinedMinMaxInt(CallInfo* info, bool is_min);
     bool GenInlinedSqrt(CallInfo* info);
     void GenNegLong(RegLocation rl_dest, RegLocation rl_src);
@@ -145,6 +153,7 @@ class MipsMir2Lir : public Mir2Lir {
     LIR* OpIT(ConditionCode cond, const char* guide);
     LIR* OpMem(OpKind op, int rBase, int disp);
     LIR* OpPcRelLoad(int reg, LIR* target);
+    LIR* OpRelativeCall(const MethodReference& target_method, InvokeType type);
     LIR* OpReg(OpKind op, int r_dest_src);
     LIR* OpRegCopy(int r_dest, int r_src);
     LIR* OpRegCopyNoInsert(int r_dest, int r_src);
@@ -154,6 +163,7 @@ class MipsMir2Lir : public Mir2Lir {
     LIR* OpRegRegImm(OpKind op, int r_dest, int r_src1, int value);
     LIR* OpRegRegReg(OpKind op, int r_dest, int r_src1, int r_src2);
     LIR* OpTestSuspend(LIR* target);
+    LIR* CheckSuspendUsingLoad();
     LIR* OpThreadMem(OpKind op, ThreadOffset thread_offset);
     LIR* OpVldm(int rBase, int count);
     LIR* OpVstm(int rBase, int count);
@@ -263,6 +263,20 @@ bool MipsMir2Lir::GenInlinedCas32(CallInfo* info, bool need_write_barrier) {
   return false;
 }
 
+bool MipsMir2Lir::SupportsAtomicWide() {
+  // Mips32 has no 64-bit ll/sc, volatile longs and doubles are left to the runtime.
+  return false;
+}
+
+RegLocation MipsMir2Lir::GenAtomicWideLoad(int r_ptr, RegLocation rl_dest) {
+  LOG(FATAL) << "Unexpected use of GenAtomicWideLoad for Mips";
+  return rl_dest;
+}
+
+void MipsMir2Lir::GenAtomicWideStore(int r_ptr, RegLocation rl_src) {
+  LOG(FATAL) << "Unexpected use of GenAtomicWideStore for Mips";
+}
+
 bool MipsMir2Lir::GenInlinedSqrt(CallInfo* info) {
   DCHECK_NE(cu_->instruction_set, kThumb2);
   return false;
@@ -273,6 +287,11 @@ LIR* MipsMir2Lir::OpPcRelLoad(int reg, LIR* target) {
   return NULL;
 }
 
+LIR* MipsMir2Lir::OpRelativeCall(const MethodReference& target_method, InvokeType type) {
+  LOG(FATAL) << "Unexpected use of OpRelativeCall for Mips";
+  return NULL;
+}
+
 LIR* MipsMir2Lir::OpVldm(int rBase, int count) {
   LOG(FATAL) << "Unexpected use of OpVldm for Mips";
   return NULL;
@@ -308,6 +327,11 @@ LIR* MipsMir2Lir::OpTestSuspend(LIR* target) {
   return OpCmpImmBranch((target == NULL) ? kCondEq : kCondNe, rMIPS_SUSPEND, 0, target);
 }
 
+LIR* MipsMir2Lir::CheckSuspendUsingLoad() {
+  LOG(FATAL) << "Unexpected use of CheckSuspendUsingLoad for Mips";
+  return NULL;
+}
+
 // Decrement register and branch on condition
 LIR* MipsMir2Lir::OpDecAndBranch(ConditionCode c_code, int reg, LIR* target) {
   OpRegImm(kOpSub, reg, 1);
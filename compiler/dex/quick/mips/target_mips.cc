@@ -508,6 +508,14 @@ int MipsMir2Lir::LoadHelper(ThreadOffset offset) {
   return r_T9;
 }
 
+LIR* MipsMir2Lir::LoadWordThreadMem(int r_dest, ThreadOffset thread_offset) {
+  return LoadWordDisp(rMIPS_SELF, thread_offset.Int32Value(), r_dest);
+}
+
+LIR* MipsMir2Lir::StoreWordThreadMem(ThreadOffset thread_offset, int r_src) {
+  return StoreWordDisp(rMIPS_SELF, thread_offset.Int32Value(), r_src);
+}
+
 void MipsMir2Lir::SpillCoreRegs() {
   if (num_core_spills_ == 0) {
     return;
@@ -542,6 +550,17 @@ bool MipsMir2Lir::IsUnconditionalBranch(LIR* lir) {
   return (lir->opcode == kMipsB);
 }
 
+bool MipsMir2Lir::IsRegCopy(LIR* lir) {
+  // Peephole optimizations are disabled for mips.
+  LOG(FATAL) << "Unexpected call to IsRegCopy for mips";
+  return false;
+}
+
+void MipsMir2Lir::ApplyTargetPeepholeOptimizations() {
+  // Peephole optimizations are disabled for mips.
+  LOG(FATAL) << "Unexpected call to ApplyTargetPeepholeOptimizations for mips";
+}
+
 MipsMir2Lir::MipsMir2Lir(CompilationUnit* cu, MIRGraph* mir_graph, ArenaAllocator* arena)
     : Mir2Lir(cu, mir_graph, arena) {
   for (int i = 0; i < kMipsLast; i++) {
@@ -562,6 +581,12 @@ uint64_t MipsMir2Lir::GetTargetInstFlags(int opcode) {
   return MipsMir2Lir::EncodingMap[opcode].flags;
 }
 
+int MipsMir2Lir::GetInsnLatency(LIR* lir) {
+  // Instruction scheduling is disabled for mips.
+  LOG(FATAL) << "Unexpected call to GetInsnLatency for mips";
+  return 1;
+}
+
 const char* MipsMir2Lir::GetTargetInstName(int opcode) {
   return MipsMir2Lir::EncodingMap[opcode].name;
 }
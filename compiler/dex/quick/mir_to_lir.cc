@@ -203,9 +203,15 @@ void Mir2Lir::CompileDalvikInstruction(MIR* mir, BasicBlock* bb, LIR* label_list
       int len_offset;
       len_offset = mirror::Array::LengthOffset().Int32Value();
       rl_src[0] = LoadValue(rl_src[0], kCoreReg);
-      GenNullCheck(rl_src[0].s_reg_low, rl_src[0].low_reg, opt_flags);
-      rl_result = EvalLoc(rl_dest, kCoreReg, true);
-      LoadWordDisp(rl_src[0].low_reg, len_offset, rl_result.low_reg);
+      if (ImplicitNullCheck(len_offset)) {
+        rl_result = EvalLoc(rl_dest, kCoreReg, true);
+        MarkPossibleNullPointerException(LoadWordDisp(rl_src[0].low_reg, len_offset,
+                                                      rl_result.low_reg), opt_flags);
+      } else {
+        GenNullCheck(rl_src[0].s_reg_low, rl_src[0].low_reg, opt_flags);
+        rl_result = EvalLoc(rl_dest, kCoreReg, true);
+        LoadWordDisp(rl_src[0].low_reg, len_offset, rl_result.low_reg);
+      }
       StoreValue(rl_dest, rl_result);
       break;
 
@@ -385,7 +391,7 @@ void Mir2Lir::CompileDalvikInstruction(MIR* mir, BasicBlock* bb, LIR* label_list
       break;
 
     case Instruction::IPUT_OBJECT:
-      GenIPut(vC, opt_flags, kWord, rl_src[0], rl_src[1], false, true);
+      GenIPut(vC, opt_flags, kWord, rl_src[0], rl_src[1], false, true, CanDeferCardMark(mir));
       break;
 
     case Instruction::IPUT:
@@ -406,22 +412,22 @@ void Mir2Lir::CompileDalvikInstruction(MIR* mir, BasicBlock* bb, LIR* label_list
       break;
 
     case Instruction::SGET_OBJECT:
-      GenSget(vB, rl_dest, false, true);
+      GenSget(vB, opt_flags, rl_dest, false, true);
       break;
     case Instruction::SGET:
     case Instruction::SGET_BOOLEAN:
     case Instruction::SGET_BYTE:
     case Instruction::SGET_CHAR:
     case Instruction::SGET_SHORT:
-      GenSget(vB, rl_dest, false, false);
+      GenSget(vB, opt_flags, rl_dest, false, false);
       break;
 
     case Instruction::SGET_WIDE:
-      GenSget(vB, rl_dest, true, false);
+      GenSget(vB, opt_flags, rl_dest, true, false);
       break;
 
     case Instruction::SPUT_OBJECT:
-      GenSput(vB, rl_src[0], false, true);
+      GenSput(vB, opt_flags, rl_src[0], false, true);
       break;
 
     case Instruction::SPUT:
@@ -429,11 +435,11 @@ void Mir2Lir::CompileDalvikInstruction(MIR* mir, BasicBlock* bb, LIR* label_list
     case Instruction::SPUT_BYTE:
     case Instruction::SPUT_CHAR:
     case Instruction::SPUT_SHORT:
-      GenSput(vB, rl_src[0], false, false);
+      GenSput(vB, opt_flags, rl_src[0], false, false);
       break;
 
     case Instruction::SPUT_WIDE:
-      GenSput(vB, rl_src[0], true, false);
+      GenSput(vB, opt_flags, rl_src[0], true, false);
       break;
 
     case Instruction::INVOKE_STATIC_RANGE:
@@ -33,6 +33,10 @@ namespace art {
 // Set to 1 to measure cost of suspend check.
 #define NO_SUSPEND 0
 
+// Sparse switches with at most this many cases are lowered to an inline binary search rather than
+// a loop over the key table.
+static const int kSmallSparseSwitchEntries = 16;
+
 #define IS_BINARY_OP         (1ULL << kIsBinaryOp)
 #define IS_BRANCH            (1ULL << kIsBranch)
 #define IS_IT                (1ULL << kIsIT)
@@ -249,6 +253,7 @@ class Mir2Lir : public Backend {
     int ComputeFrameSize();
     virtual void Materialize();
     virtual CompiledMethod* GetCompiledMethod();
+    virtual size_t GetNumLIRs() const;
     void MarkSafepointPC(LIR* inst);
     bool FastInstance(uint32_t field_idx, int& field_offset, bool& is_volatile, bool is_put);
     void SetupResourceMasks(LIR* lir);
@@ -281,12 +286,15 @@ class Mir2Lir : public Backend {
     ConditionCode FlipComparisonOrder(ConditionCode before);
     void DumpMappingTable(const char* table_name, const std::string& descriptor,
                           const std::string& name, const std::string& signature,
-                          const std::vector<uint32_t>& v);
+                          const ArenaVector<uint32_t>& v);
     void InstallLiteralPools();
     void InstallSwitchTables();
     void InstallFillArrayData();
+    void InstallRelativeCalls();
     bool VerifyCatchEntries();
     void CreateMappingTables();
+    // Appends (native offset, dex offset) pairs to the encoded mapping table as deltas.
+    void EncodeMappingTableDeltas(const ArenaVector<uint32_t>& table);
     void CreateNativeGcMap();
     int AssignLiteralOffset(int offset);
     int AssignSwitchTablesOffset(int offset);
@@ -301,8 +309,15 @@ class Mir2Lir : public Backend {
     void ConvertMemOpIntoMove(LIR* orig_lir, int dest, int src);
     void ApplyLoadStoreElimination(LIR* head_lir, LIR* tail_lir);
     void ApplyLoadHoisting(LIR* head_lir, LIR* tail_lir);
+    void ScheduleRegion(LIR** region, int region_size);
+    void ApplyListScheduling(LIR* head_lir, LIR* tail_lir);
     void ApplyLocalOptimizations(LIR* head_lir, LIR* tail_lir);
     void RemoveRedundantBranches();
+    int ITShadowSize(LIR* lir);
+    bool CCodesUsedAfter(LIR* lir);
+    void RemoveRedundantCopies();
+    void ChainBranches();
+    void ApplyPeepholeOptimizations();
 
     // Shared by all targets - implemented in ralloc_util.cc
     int GetSRegHi(int lowSreg);
@@ -387,29 +402,37 @@ class Mir2Lir : public Backend {
     LIR* GenImmedCheck(ConditionCode c_code, int reg, int imm_val,
                        ThrowKind kind);
     LIR* GenNullCheck(int s_reg, int m_reg, int opt_flags);
+    bool ImplicitNullCheck(int offset);
+    void MarkPossibleNullPointerException(LIR* access, int opt_flags);
     LIR* GenRegRegCheck(ConditionCode c_code, int reg1, int reg2,
                         ThrowKind kind);
     void GenCompareAndBranch(Instruction::Code opcode, RegLocation rl_src1,
                              RegLocation rl_src2, LIR* taken, LIR* fall_through);
     void GenCompareZeroAndBranch(Instruction::Code opcode, RegLocation rl_src,
                                  LIR* taken, LIR* fall_through);
+    void GenSparseSwitchSearch(const uint16_t* table, RegLocation rl_src);
+    void GenSparseSwitchSearchRange(int reg, const int* keys, const int* targets, int low,
+                                    int high, LIR* done);
     void GenIntToLong(RegLocation rl_dest, RegLocation rl_src);
     void GenIntNarrowing(Instruction::Code opcode, RegLocation rl_dest,
                          RegLocation rl_src);
     void GenNewArray(uint32_t type_idx, RegLocation rl_dest,
                      RegLocation rl_src);
     void GenFilledNewArray(CallInfo* info);
-    void GenSput(uint32_t field_idx, RegLocation rl_src,
+    void GenSput(uint32_t field_idx, int opt_flags, RegLocation rl_src,
                  bool is_long_or_double, bool is_object);
-    void GenSget(uint32_t field_idx, RegLocation rl_dest,
+    void GenSget(uint32_t field_idx, int opt_flags, RegLocation rl_dest,
                  bool is_long_or_double, bool is_object);
     void GenIGet(uint32_t field_idx, int opt_flags, OpSize size,
                  RegLocation rl_dest, RegLocation rl_obj, bool is_long_or_double, bool is_object);
     void GenIPut(uint32_t field_idx, int opt_flags, OpSize size,
-                 RegLocation rl_src, RegLocation rl_obj, bool is_long_or_double, bool is_object);
+                 RegLocation rl_src, RegLocation rl_obj, bool is_long_or_double, bool is_object,
+                 bool defer_card_mark = false);
+    bool CanDeferCardMark(MIR* mir);
     void GenConstClass(uint32_t type_idx, RegLocation rl_dest);
     void GenConstString(uint32_t string_idx, RegLocation rl_dest);
     void GenNewInstance(uint32_t type_idx, RegLocation rl_dest);
+    void GenNewInstanceInline(uint32_t type_idx, size_t object_size, RegLocation rl_dest);
     void GenThrow(RegLocation rl_src);
     void GenInstanceof(uint32_t type_idx, RegLocation rl_dest,
                        RegLocation rl_src);
@@ -488,6 +511,7 @@ class Mir2Lir : public Backend {
     bool GenInlinedDoubleCvt(CallInfo* info);
     bool GenInlinedIndexOf(CallInfo* info, bool zero_based);
     bool GenInlinedStringCompareTo(CallInfo* info);
+    bool GenInlinedStringEquals(CallInfo* info);
     bool GenInlinedCurrentThread(CallInfo* info);
     bool GenInlinedUnsafeGet(CallInfo* info, bool is_long, bool is_volatile);
     bool GenInlinedUnsafePut(CallInfo* info, bool is_long, bool is_object,
@@ -528,6 +552,8 @@ class Mir2Lir : public Backend {
     virtual bool SmallLiteralDivRem(Instruction::Code dalvik_opcode, bool is_div,
                                     RegLocation rl_src, RegLocation rl_dest, int lit) = 0;
     virtual int LoadHelper(ThreadOffset offset) = 0;
+    virtual LIR* LoadWordThreadMem(int r_dest, ThreadOffset thread_offset) = 0;
+    virtual LIR* StoreWordThreadMem(ThreadOffset thread_offset, int r_src) = 0;
     virtual LIR* LoadBaseDisp(int rBase, int displacement, int r_dest, OpSize size, int s_reg) = 0;
     virtual LIR* LoadBaseDispWide(int rBase, int displacement, int r_dest_lo, int r_dest_hi,
                                   int s_reg) = 0;
@@ -541,6 +567,8 @@ class Mir2Lir : public Backend {
     virtual LIR* StoreBaseIndexed(int rBase, int r_index, int r_src, int scale, OpSize size) = 0;
     virtual LIR* StoreBaseIndexedDisp(int rBase, int r_index, int scale, int displacement,
                                       int r_src, int r_src_hi, OpSize size, int s_reg) = 0;
+    // Dirty the card of tgt_addr_reg unless val_reg holds null. An INVALID_REG val_reg marks the
+    // card unconditionally.
     virtual void MarkGCCard(int val_reg, int tgt_addr_reg) = 0;
 
     // Required for target - register utilities.
@@ -579,7 +607,11 @@ class Mir2Lir : public Backend {
     virtual uint64_t GetPCUseDefEncoding() = 0;
     virtual uint64_t GetTargetInstFlags(int opcode) = 0;
     virtual int GetInsnSize(LIR* lir) = 0;
+    virtual int GetInsnLatency(LIR* lir) = 0;
     virtual bool IsUnconditionalBranch(LIR* lir) = 0;
+    // Whether lir copies the register in operands[1] to the register in operands[0].
+    virtual bool IsRegCopy(LIR* lir) = 0;
+    virtual void ApplyTargetPeepholeOptimizations() = 0;
 
     // Required for target - Dalvik-level generators.
     virtual void GenArithImmOpLong(Instruction::Code opcode, RegLocation rl_dest,
@@ -600,6 +632,11 @@ class Mir2Lir : public Backend {
     virtual void GenConversion(Instruction::Code opcode, RegLocation rl_dest,
                                RegLocation rl_src) = 0;
     virtual bool GenInlinedCas32(CallInfo* info, bool need_write_barrier) = 0;
+    // Single-copy atomic accesses of the long or double at r_ptr, for volatile fields. Where
+    // SupportsAtomicWide() is false they aren't generated and the runtime accesses the fields.
+    virtual bool SupportsAtomicWide() = 0;
+    virtual RegLocation GenAtomicWideLoad(int r_ptr, RegLocation rl_dest) = 0;
+    virtual void GenAtomicWideStore(int r_ptr, RegLocation rl_src) = 0;
     virtual bool GenInlinedMinMaxInt(CallInfo* info, bool is_min) = 0;
     virtual bool GenInlinedSqrt(CallInfo* info) = 0;
     virtual void GenNegLong(RegLocation rl_dest, RegLocation rl_src) = 0;
@@ -665,6 +702,8 @@ class Mir2Lir : public Backend {
     virtual LIR* OpIT(ConditionCode cond, const char* guide) = 0;
     virtual LIR* OpMem(OpKind op, int rBase, int disp) = 0;
     virtual LIR* OpPcRelLoad(int reg, LIR* target) = 0;
+    // Calls target_method with a branch the OatWriter patches, returning the last instruction.
+    virtual LIR* OpRelativeCall(const MethodReference& target_method, InvokeType type) = 0;
     virtual LIR* OpReg(OpKind op, int r_dest_src) = 0;
     virtual LIR* OpRegCopy(int r_dest, int r_src) = 0;
     virtual LIR* OpRegCopyNoInsert(int r_dest, int r_src) = 0;
@@ -675,6 +714,9 @@ class Mir2Lir : public Backend {
     virtual LIR* OpRegRegReg(OpKind op, int r_dest, int r_src1,
                              int r_src2) = 0;
     virtual LIR* OpTestSuspend(LIR* target) = 0;
+    // Loads through Thread::suspend_trigger_, faulting when a suspension is pending. Returns the
+    // faulting load, which is the safepoint.
+    virtual LIR* CheckSuspendUsingLoad() = 0;
     virtual LIR* OpThreadMem(OpKind op, ThreadOffset thread_offset) = 0;
     virtual LIR* OpVldm(int rBase, int count) = 0;
     virtual LIR* OpVstm(int rBase, int count) = 0;
@@ -727,18 +769,19 @@ class Mir2Lir : public Backend {
     GrowableArray<LIR*> throw_launchpads_;
     GrowableArray<LIR*> suspend_launchpads_;
     GrowableArray<LIR*> intrinsic_launchpads_;
-    SafeMap<unsigned int, LIR*> boundary_map_;  // boundary lookup cache.
+    GrowableArray<LIR*> relative_calls_;  // The first halves of bls requiring patching.
+    ArenaSafeMap<unsigned int, LIR*> boundary_map_;  // boundary lookup cache.
     /*
      * Holds mapping from native PC to dex PC for safepoints where we may deoptimize.
      * Native PC is on the return address of the safepointed operation.  Dex PC is for
      * the instruction being executed at the safepoint.
      */
-    std::vector<uint32_t> pc2dex_mapping_table_;
+    ArenaVector<uint32_t> pc2dex_mapping_table_;
     /*
      * Holds mapping from Dex PC to native PC for catch entry points.  Native PC and Dex PC
      * immediately preceed the instruction.
      */
-    std::vector<uint32_t> dex2pc_mapping_table_;
+    ArenaVector<uint32_t> dex2pc_mapping_table_;
     int data_offset_;                     // starting offset of literal pool.
     int total_size_;                      // header + code size.
     LIR* block_label_list_;
@@ -760,6 +803,9 @@ class Mir2Lir : public Backend {
      * instruction compilation.
      */
     int live_sreg_;
+    // A reference store into the same object as the next store skipped its card mark, which the
+    // next store must then make unconditionally.
+    bool card_mark_pending_;
     CodeBuffer code_buffer_;
     // The encoding mapping table data (dex -> pc offset and pc offset -> dex) with a size prefix.
     UnsignedLeb128EncodingVector encoded_mapping_table_;
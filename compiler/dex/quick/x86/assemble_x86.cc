@@ -281,6 +281,7 @@ ENCODING_MAP(Cmp, IS_LOAD, 0, 0,
   EXT_0F_ENCODING_MAP(Subss,     0xF3, 0x5C, REG_DEF0),
   EXT_0F_ENCODING_MAP(Divsd,     0xF2, 0x5E, REG_DEF0),
   EXT_0F_ENCODING_MAP(Divss,     0xF3, 0x5E, REG_DEF0),
+  EXT_0F_ENCODING_MAP(Sqrtsd,    0xF2, 0x51, REG_DEF0),
 
   { kX86PsrlqRI, kRegImm, IS_BINARY_OP | REG_DEF0_USE0, { 0x66, 0, 0x0F, 0x73, 0, 2, 0, 1 }, "PsrlqRI", "!0r,!1d" },
   { kX86PsllqRI, kRegImm, IS_BINARY_OP | REG_DEF0_USE0, { 0x66, 0, 0x0F, 0x73, 0, 6, 0, 1 }, "PsllqRI", "!0r,!1d" },
@@ -314,6 +315,19 @@ ENCODING_MAP(Cmp, IS_LOAD, 0, 0,
   EXT_0F_ENCODING_MAP(Movsx16, 0x00, 0xBF, REG_DEF0),
 #undef EXT_0F_ENCODING_MAP
 
+  // x87 operations, used where SSE2 has no equivalent. Memory forms encode the operation in the
+  // modrm opcode, nullary forms carry the second opcode byte as an extra opcode.
+  { kX86Fild64M,  kMem,     IS_LOAD  | IS_BINARY_OP | REG_USE0, { 0, 0, 0xDF, 0,    0, 5, 0, 0 }, "Fild64M",  "[!0r+!1d]" },
+  { kX86Fld32M,   kMem,     IS_LOAD  | IS_BINARY_OP | REG_USE0, { 0, 0, 0xD9, 0,    0, 0, 0, 0 }, "Fld32M",   "[!0r+!1d]" },
+  { kX86Fld64M,   kMem,     IS_LOAD  | IS_BINARY_OP | REG_USE0, { 0, 0, 0xDD, 0,    0, 0, 0, 0 }, "Fld64M",   "[!0r+!1d]" },
+  { kX86Fst32M,   kMem,     IS_STORE | IS_BINARY_OP | REG_USE0, { 0, 0, 0xD9, 0,    0, 2, 0, 0 }, "Fst32M",   "[!0r+!1d]" },
+  { kX86Fst64M,   kMem,     IS_STORE | IS_BINARY_OP | REG_USE0, { 0, 0, 0xDD, 0,    0, 2, 0, 0 }, "Fst64M",   "[!0r+!1d]" },
+  { kX86Fstp32M,  kMem,     IS_STORE | IS_BINARY_OP | REG_USE0, { 0, 0, 0xD9, 0,    0, 3, 0, 0 }, "Fstp32M",  "[!0r+!1d]" },
+  { kX86Fstp64M,  kMem,     IS_STORE | IS_BINARY_OP | REG_USE0, { 0, 0, 0xDD, 0,    0, 3, 0, 0 }, "Fstp64M",  "[!0r+!1d]" },
+  { kX86Fprem,    kNullary, NO_OPERAND,                         { 0, 0, 0xD9, 0xF8, 0, 0, 0, 0 }, "Fprem",    "" },
+  { kX86Fucompp,  kNullary, NO_OPERAND,                         { 0, 0, 0xDA, 0xE9, 0, 0, 0, 0 }, "Fucompp",  "" },
+  { kX86Fstsw16R, kNullary, NO_OPERAND | REG_DEFA,              { 0, 0, 0xDF, 0xE0, 0, 0, 0, 0 }, "Fstsw16R", "ax" },
+
   { kX86Jcc8,  kJcc,  IS_BINARY_OP | IS_BRANCH | NEEDS_FIXUP | USES_CCODES, { 0,             0, 0x70, 0,    0, 0, 0, 0 }, "Jcc8",  "!1c !0t" },
   { kX86Jcc32, kJcc,  IS_BINARY_OP | IS_BRANCH | NEEDS_FIXUP | USES_CCODES, { 0,             0, 0x0F, 0x80, 0, 0, 0, 0 }, "Jcc32", "!1c !0t" },
   { kX86Jmp8,  kJmp,  IS_UNARY_OP  | IS_BRANCH | NEEDS_FIXUP,               { 0,             0, 0xEB, 0,    0, 0, 0, 0 }, "Jmp8",  "!0t" },
@@ -369,7 +383,9 @@ int X86Mir2Lir::GetInsnSize(LIR* lir) {
     case kNop:
       return lir->operands[0];  // length of nop is sole operand
     case kNullary:
-      return 1;  // 1 byte of opcode
+      // 1 byte of opcode and up to 2 extra opcode bytes.
+      return 1 + (entry->skeleton.extra_opcode1 != 0 ? 1 : 0) +
+          (entry->skeleton.extra_opcode2 != 0 ? 1 : 0);
     case kReg:  // lir operands - 0: reg
       return ComputeSize(entry, 0, 0, false);
     case kMem:  // lir operands - 0: base, 1: disp
@@ -564,6 +580,10 @@ void X86Mir2Lir::EmitOpMem(const X86EncodingMap* entry, uint8_t base, int disp)
   DCHECK_LT(base, 8);
   uint8_t modrm = (ModrmForDisp(base, disp) << 6) | (entry->skeleton.modrm_opcode << 3) | base;
   code_buffer_.push_back(modrm);
+  if (base == rX86_SP) {
+    // Special SIB for SP base
+    code_buffer_.push_back(0 << 6 | (rX86_SP << 3) | rX86_SP);
+  }
   EmitDisp(base, disp);
   DCHECK_EQ(0, entry->skeleton.ax_opcode);
   DCHECK_EQ(0, entry->skeleton.immediate_bytes);
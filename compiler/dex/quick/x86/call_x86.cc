@@ -29,7 +29,7 @@ void X86Mir2Lir::GenSpecialCase(BasicBlock* bb, MIR* mir,
 
 /*
  * The sparse table in the literal pool is an array of <key,displacement>
- * pairs.
+ * pairs, searched inline.
  */
 void X86Mir2Lir::GenSparseSwitch(MIR* mir, uint32_t table_offset,
                                  RegLocation rl_src) {
@@ -37,17 +37,7 @@ void X86Mir2Lir::GenSparseSwitch(MIR* mir, uint32_t table_offset,
   if (cu_->verbose) {
     DumpSparseSwitchTable(table);
   }
-  int entries = table[1];
-  const int* keys = reinterpret_cast<const int*>(&table[2]);
-  const int* targets = &keys[entries];
-  rl_src = LoadValue(rl_src, kCoreReg);
-  for (int i = 0; i < entries; i++) {
-    int key = keys[i];
-    BasicBlock* case_block =
-        mir_graph_->FindBlock(current_dalvik_offset_ + targets[i]);
-    OpCmpImmBranch(kCondEq, rl_src.low_reg, key,
-                   &block_label_list_[case_block->id]);
-  }
+  GenSparseSwitchSearch(table, rl_src);
 }
 
 /*
@@ -201,13 +191,18 @@ void X86Mir2Lir::GenMoveException(RegLocation rl_dest) {
 void X86Mir2Lir::MarkGCCard(int val_reg, int tgt_addr_reg) {
   int reg_card_base = AllocTemp();
   int reg_card_no = AllocTemp();
-  LIR* branch_over = OpCmpImmBranch(kCondEq, val_reg, 0, NULL);
+  LIR* branch_over = NULL;
+  if (val_reg != INVALID_REG) {
+    branch_over = OpCmpImmBranch(kCondEq, val_reg, 0, NULL);
+  }
   NewLIR2(kX86Mov32RT, reg_card_base, Thread::CardTableOffset().Int32Value());
   OpRegRegImm(kOpLsr, reg_card_no, tgt_addr_reg, gc::accounting::CardTable::kCardShift);
   StoreBaseIndexed(reg_card_base, reg_card_no, reg_card_base, 0,
                    kUnsignedByte);
-  LIR* target = NewLIR0(kPseudoTargetLabel);
-  branch_over->target = target;
+  if (branch_over != NULL) {
+    LIR* target = NewLIR0(kPseudoTargetLabel);
+    branch_over->target = target;
+  }
   FreeTemp(reg_card_base);
   FreeTemp(reg_card_no);
 }
@@ -30,6 +30,8 @@ class X86Mir2Lir : public Mir2Lir {
     bool SmallLiteralDivRem(Instruction::Code dalvik_opcode, bool is_div, RegLocation rl_src,
                                     RegLocation rl_dest, int lit);
     int LoadHelper(ThreadOffset offset);
+    LIR* LoadWordThreadMem(int r_dest, ThreadOffset thread_offset);
+    LIR* StoreWordThreadMem(ThreadOffset thread_offset, int r_src);
     LIR* LoadBaseDisp(int rBase, int displacement, int r_dest, OpSize size, int s_reg);
     LIR* LoadBaseDispWide(int rBase, int displacement, int r_dest_lo, int r_dest_hi,
                                   int s_reg);
@@ -81,7 +83,10 @@ class X86Mir2Lir : public Mir2Lir {
     uint64_t GetPCUseDefEncoding();
     uint64_t GetTargetInstFlags(int opcode);
     int GetInsnSize(LIR* lir);
+    int GetInsnLatency(LIR* lir);
     bool IsUnconditionalBranch(LIR* lir);
+    bool IsRegCopy(LIR* lir);
+    void ApplyTargetPeepholeOptimizations();
 
     // Required for target - Dalvik-level generators.
     void GenArithImmOpLong(Instruction::Code opcode, RegLocation rl_dest,
@@ -105,6 +110,9 @@ class X86Mir2Lir : public Mir2Lir {
                           RegLocation rl_src2);
     void GenConversion(Instruction::Code opcode, RegLocation rl_dest, RegLocation rl_src);
     bool GenInlinedCas32(CallInfo* info, bool need_write_barrier);
+    bool SupportsAtomicWide();
+    RegLocation GenAtomicWideLoad(int r_ptr, RegLocation rl_dest);
+    void GenAtomicWideStore(int r_ptr, RegLocation rl_src);
     bool GenInlinedMinMaxInt(CallInfo* info, bool is_min);
     bool GenInlinedSqrt(CallInfo* info);
     void GenNegLong(RegLocation rl_dest, RegLocation rl_src);
@@ -122,6 +130,7 @@ class X86Mir2Lir : public Mir2Lir {
     void GenFillArrayData(uint32_t table_offset, RegLocation rl_src);
     void GenFusedFPCmpBranch(BasicBlock* bb, MIR* mir, bool gt_bias, bool is_double);
     void GenFusedLongCmpBranch(BasicBlock* bb, MIR* mir);
+    void GenLongToFP(RegLocation rl_dest, RegLocation rl_src, bool is_double);
     void GenSelect(BasicBlock* bb, MIR* mir);
     void GenMemBarrier(MemBarrierKind barrier_kind);
     void GenMonitorEnter(int opt_flags, RegLocation rl_src);
@@ -132,6 +141,7 @@ class X86Mir2Lir : public Mir2Lir {
     void GenNegDouble(RegLocation rl_dest, RegLocation rl_src);
     void GenNegFloat(RegLocation rl_dest, RegLocation rl_src);
     void GenPackedSwitch(MIR* mir, uint32_t table_offset, RegLocation rl_src);
+    void GenRemFP(RegLocation rl_dest, RegLocation rl_src1, RegLocation rl_src2, bool is_double);
     void GenSparseSwitch(MIR* mir, uint32_t table_offset, RegLocation rl_src);
     void GenSpecialCase(BasicBlock* bb, MIR* mir, SpecialCaseHandler special_case);
 
@@ -145,6 +155,7 @@ class X86Mir2Lir : public Mir2Lir {
     LIR* OpIT(ConditionCode cond, const char* guide);
     LIR* OpMem(OpKind op, int rBase, int disp);
     LIR* OpPcRelLoad(int reg, LIR* target);
+    LIR* OpRelativeCall(const MethodReference& target_method, InvokeType type);
     LIR* OpReg(OpKind op, int r_dest_src);
     LIR* OpRegCopy(int r_dest, int r_src);
     LIR* OpRegCopyNoInsert(int r_dest, int r_src);
@@ -154,6 +165,7 @@ class X86Mir2Lir : public Mir2Lir {
     LIR* OpRegRegImm(OpKind op, int r_dest, int r_src1, int value);
     LIR* OpRegRegReg(OpKind op, int r_dest, int r_src1, int r_src2);
     LIR* OpTestSuspend(LIR* target);
+    LIR* CheckSuspendUsingLoad();
     LIR* OpThreadMem(OpKind op, ThreadOffset thread_offset);
     LIR* OpVldm(int rBase, int count);
     LIR* OpVstm(int rBase, int count);
@@ -197,6 +209,9 @@ class X86Mir2Lir : public Mir2Lir {
                    int scale, int table_or_disp);
     void EmitMacro(const X86EncodingMap* entry, uint8_t reg, int offset);
     void EmitUnimplemented(const X86EncodingMap* entry, LIR* lir);
+
+    int StoreToHome(RegLocation rl_src);
+    void LoadFromHome(RegLocation rl_dest);
 };
 
 }  // namespace art
@@ -25,10 +25,6 @@ void X86Mir2Lir::GenArithOpFloat(Instruction::Code opcode,
   X86OpCode op = kX86Nop;
   RegLocation rl_result;
 
-  /*
-   * Don't attempt to optimize register usage since these opcodes call out to
-   * the handlers.
-   */
   switch (opcode) {
     case Instruction::ADD_FLOAT_2ADDR:
     case Instruction::ADD_FLOAT:
@@ -48,11 +44,7 @@ void X86Mir2Lir::GenArithOpFloat(Instruction::Code opcode,
       break;
     case Instruction::REM_FLOAT_2ADDR:
     case Instruction::REM_FLOAT:
-      FlushAllRegs();   // Send everything to home location
-      CallRuntimeHelperRegLocationRegLocation(QUICK_ENTRYPOINT_OFFSET(pFmodf), rl_src1, rl_src2,
-                                              false);
-      rl_result = GetReturn(true);
-      StoreValue(rl_dest, rl_result);
+      GenRemFP(rl_dest, rl_src1, rl_src2, false /* is_double */);
       return;
     case Instruction::NEG_FLOAT:
       GenNegFloat(rl_dest, rl_src1);
@@ -99,11 +91,7 @@ void X86Mir2Lir::GenArithOpDouble(Instruction::Code opcode,
       break;
     case Instruction::REM_DOUBLE_2ADDR:
     case Instruction::REM_DOUBLE:
-      FlushAllRegs();   // Send everything to home location
-      CallRuntimeHelperRegLocationRegLocation(QUICK_ENTRYPOINT_OFFSET(pFmod), rl_src1, rl_src2,
-                                              false);
-      rl_result = GetReturnWide(true);
-      StoreValueWide(rl_dest, rl_result);
+      GenRemFP(rl_dest, rl_src1, rl_src2, true /* is_double */);
       return;
     case Instruction::NEG_DOUBLE:
       GenNegDouble(rl_dest, rl_src1);
@@ -198,12 +186,13 @@ void X86Mir2Lir::GenConversion(Instruction::Code opcode, RegLocation rl_dest,
       return;
     }
     case Instruction::LONG_TO_DOUBLE:
-      GenConversionCall(QUICK_ENTRYPOINT_OFFSET(pL2d), rl_dest, rl_src);
+      GenLongToFP(rl_dest, rl_src, true /* is_double */);
       return;
     case Instruction::LONG_TO_FLOAT:
-      // TODO: inline by using memory as a 64-bit source. Be careful about promoted registers.
-      GenConversionCall(QUICK_ENTRYPOINT_OFFSET(pL2f), rl_dest, rl_src);
+      GenLongToFP(rl_dest, rl_src, false /* is_double */);
       return;
+    // The SSE2 truncating conversions produce 0x8000000000000000 for NaN and out of range values
+    // rather than Java's saturated results, so these stay in the helpers.
     case Instruction::FLOAT_TO_LONG:
       GenConversionCall(QUICK_ENTRYPOINT_OFFSET(pF2l), rl_dest, rl_src);
       return;
@@ -370,9 +359,102 @@ void X86Mir2Lir::GenNegDouble(RegLocation rl_dest, RegLocation rl_src) {
 
 bool X86Mir2Lir::GenInlinedSqrt(CallInfo* info) {
   DCHECK_NE(cu_->instruction_set, kThumb2);
-  return false;
+  // sqrtsd already yields NaN for negative and NaN inputs, so unlike ARM there is no slow path.
+  RegLocation rl_src = info->args[0];
+  RegLocation rl_dest = InlineTargetWide(info);  // double place for result
+  rl_src = LoadValueWide(rl_src, kFPReg);
+  RegLocation rl_result = EvalLoc(rl_dest, kFPReg, true);
+  NewLIR2(kX86SqrtsdRR, S2d(rl_result.low_reg, rl_result.high_reg),
+          S2d(rl_src.low_reg, rl_src.high_reg));
+  StoreValueWide(rl_dest, rl_result);
+  return true;
+}
+
+/*
+ * The x87 instructions only take memory operands, so their vregs go through the frame homes.
+ * Make the home of rl_src current, whether the value lives in a temp or a promoted register, and
+ * return its offset.
+ */
+int X86Mir2Lir::StoreToHome(RegLocation rl_src) {
+  int offset = SRegOffset(rl_src.s_reg_low);
+  if (rl_src.wide) {
+    rl_src = UpdateLocWide(rl_src);
+    if (rl_src.location == kLocPhysReg) {
+      StoreBaseDispWide(rX86_SP, offset, rl_src.low_reg, rl_src.high_reg);
+    }
+  } else {
+    rl_src = UpdateLoc(rl_src);
+    if (rl_src.location == kLocPhysReg) {
+      StoreBaseDisp(rX86_SP, offset, rl_src.low_reg, kWord);
+    }
+  }
+  return offset;
+}
+
+/*
+ * Called after an x87 store wrote the home of rl_dest behind the back of the register allocator.
+ * Temps holding the old value are dropped and a promoted register is reloaded.
+ */
+void X86Mir2Lir::LoadFromHome(RegLocation rl_dest) {
+  int offset = SRegOffset(rl_dest.s_reg_low);
+  ClobberSReg(rl_dest.s_reg_low);
+  if (rl_dest.wide) {
+    ClobberSReg(GetSRegHi(rl_dest.s_reg_low));
+    rl_dest = UpdateLocWide(rl_dest);
+    if (rl_dest.location == kLocPhysReg) {
+      LoadBaseDispWide(rX86_SP, offset, rl_dest.low_reg, rl_dest.high_reg, INVALID_SREG);
+    }
+  } else {
+    rl_dest = UpdateLoc(rl_dest);
+    if (rl_dest.location == kLocPhysReg) {
+      LoadWordDisp(rX86_SP, offset, rl_dest.low_reg);
+    }
+  }
+}
+
+void X86Mir2Lir::GenLongToFP(RegLocation rl_dest, RegLocation rl_src, bool is_double) {
+  // SSE2 only converts 32-bit integers, fild takes the 64-bit source from memory.
+  int src_v_reg_offset = StoreToHome(rl_src);
+  LIR* fild = NewLIR2(kX86Fild64M, rX86_SP, src_v_reg_offset);
+  AnnotateDalvikRegAccess(fild, src_v_reg_offset >> 2, true /* is_load */, true /* is64bit */);
+  int dest_v_reg_offset = SRegOffset(rl_dest.s_reg_low);
+  LIR* fstp = NewLIR2(is_double ? kX86Fstp64M : kX86Fstp32M, rX86_SP, dest_v_reg_offset);
+  AnnotateDalvikRegAccess(fstp, dest_v_reg_offset >> 2, false /* is_load */, is_double);
+  LoadFromHome(rl_dest);
 }
 
+void X86Mir2Lir::GenRemFP(RegLocation rl_dest, RegLocation rl_src1, RegLocation rl_src2,
+                          bool is_double) {
+  // fprem computes the truncating remainder Java requires, SSE2 has no equivalent.
+  int src1_v_reg_offset = StoreToHome(rl_src1);
+  int src2_v_reg_offset = StoreToHome(rl_src2);
+  X86OpCode fld_opcode = is_double ? kX86Fld64M : kX86Fld32M;
+  LIR* fld2 = NewLIR2(fld_opcode, rX86_SP, src2_v_reg_offset);
+  AnnotateDalvikRegAccess(fld2, src2_v_reg_offset >> 2, true /* is_load */, is_double);
+  LIR* fld1 = NewLIR2(fld_opcode, rX86_SP, src1_v_reg_offset);
+  AnnotateDalvikRegAccess(fld1, src1_v_reg_offset >> 2, true /* is_load */, is_double);
 
+  // fnstsw needs ax.
+  FlushReg(rAX);
+  Clobber(rAX);
+  LockTemp(rAX);
+
+  // fprem only reduces the exponent difference by up to 63 per step and sets C2 of the status
+  // word while the reduction is incomplete.
+  LIR* retry = NewLIR0(kPseudoTargetLabel);
+  NewLIR0(kX86Fprem);
+  NewLIR0(kX86Fstsw16R);
+  NewLIR2(kX86Test32RI, rAX, 0x400);
+  LIR* branch = NewLIR2(kX86Jcc8, 0, kX86CondNe);
+  branch->target = retry;
+  FreeTemp(rAX);
+
+  int dest_v_reg_offset = SRegOffset(rl_dest.s_reg_low);
+  LIR* fst = NewLIR2(is_double ? kX86Fst64M : kX86Fst32M, rX86_SP, dest_v_reg_offset);
+  AnnotateDalvikRegAccess(fst, dest_v_reg_offset >> 2, false /* is_load */, is_double);
+  // Pop both the remainder and the divisor off the x87 stack.
+  NewLIR0(kX86Fucompp);
+  LoadFromHome(rl_dest);
+}
 
 }  // namespace art
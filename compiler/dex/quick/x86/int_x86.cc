@@ -245,8 +245,68 @@ void X86Mir2Lir::OpTlsCmp(ThreadOffset offset, int val) {
 }
 
 bool X86Mir2Lir::GenInlinedCas32(CallInfo* info, bool need_write_barrier) {
-  DCHECK_NE(cu_->instruction_set, kThumb2);
-  return false;
+  DCHECK_EQ(cu_->instruction_set, kX86);
+  // Unused - RegLocation rl_src_unsafe = info->args[0];
+  RegLocation rl_src_obj = info->args[1];  // Object - known non-null
+  RegLocation rl_src_offset = info->args[2];  // long low
+  rl_src_offset.wide = 0;  // ignore high half in info->args[3]
+  RegLocation rl_src_expected = info->args[4];  // int or Object
+  RegLocation rl_src_new_value = info->args[5];  // int or Object
+  RegLocation rl_dest = InlineTarget(info);  // boolean place for result
+
+  // cmpxchg compares with and loads into eax, use explicit registers.
+  FlushAllRegs();
+  LockCallTemps();
+  int r_expected = rAX;
+  int r_object = rCX;
+  int r_offset = rDX;
+  int r_new_value = rBX;
+  LoadValueDirectFixed(rl_src_obj, r_object);
+  LoadValueDirectFixed(rl_src_new_value, r_new_value);
+
+  if (need_write_barrier && !mir_graph_->IsConstantNullRef(rl_src_new_value)) {
+    // Mark card for object assuming new value is stored, before the cmpxchg as the card mark
+    // clobbers the flags. Lend it the registers not loaded yet.
+    FreeTemp(r_expected);
+    FreeTemp(r_offset);
+    MarkGCCard(r_new_value, r_object);
+    LockTemp(r_expected);
+    LockTemp(r_offset);
+  }
+
+  LoadValueDirectFixed(rl_src_offset, r_offset);
+  LoadValueDirectFixed(rl_src_expected, r_expected);
+  // The locked instruction is a full barrier, no other barrier is needed.
+  NewLIR5(kX86LockCmpxchgAR, r_object, r_offset, 0, 0, r_new_value);
+  Clobber(r_expected);
+
+  // Offset is dead and edx has a byte form, use it for the result.
+  NewLIR2(kX86Set8R, r_offset, kX86CondZ);
+  NewLIR2(kX86Movzx8RR, r_offset, r_offset);
+  FreeTemp(r_expected);
+  FreeTemp(r_object);
+  FreeTemp(r_new_value);
+  RegLocation rl_result = EvalLoc(rl_dest, kCoreReg, true);
+  OpRegCopy(rl_result.low_reg, r_offset);
+  FreeTemp(r_offset);
+  StoreValue(rl_dest, rl_result);
+  return true;
+}
+
+bool X86Mir2Lir::SupportsAtomicWide() {
+  return true;
+}
+
+RegLocation X86Mir2Lir::GenAtomicWideLoad(int r_ptr, RegLocation rl_dest) {
+  // An aligned movsd is single-copy atomic, a pair of movs isn't.
+  RegLocation rl_result = EvalLoc(rl_dest, kFPReg, true);
+  LoadBaseDispWide(r_ptr, 0, rl_result.low_reg, rl_result.high_reg, INVALID_SREG);
+  return rl_result;
+}
+
+void X86Mir2Lir::GenAtomicWideStore(int r_ptr, RegLocation rl_src) {
+  rl_src = LoadValueWide(rl_src, kFPReg);
+  StoreBaseDispWide(r_ptr, 0, rl_src.low_reg, rl_src.high_reg);
 }
 
 LIR* X86Mir2Lir::OpPcRelLoad(int reg, LIR* target) {
@@ -254,6 +314,11 @@ LIR* X86Mir2Lir::OpPcRelLoad(int reg, LIR* target) {
   return NULL;
 }
 
+LIR* X86Mir2Lir::OpRelativeCall(const MethodReference& target_method, InvokeType type) {
+  LOG(FATAL) << "Unexpected use of OpRelativeCall for x86";
+  return NULL;
+}
+
 LIR* X86Mir2Lir::OpVldm(int rBase, int count) {
   LOG(FATAL) << "Unexpected use of OpVldm for x86";
   return NULL;
@@ -289,6 +354,11 @@ LIR* X86Mir2Lir::OpTestSuspend(LIR* target) {
   return OpCondBranch((target == NULL) ? kCondNe : kCondEq, target);
 }
 
+LIR* X86Mir2Lir::CheckSuspendUsingLoad() {
+  LOG(FATAL) << "Unexpected use of CheckSuspendUsingLoad for x86";
+  return NULL;
+}
+
 // Decrement register and branch on condition
 LIR* X86Mir2Lir::OpDecAndBranch(ConditionCode c_code, int reg, LIR* target) {
   OpRegImm(kOpSub, reg, 1);
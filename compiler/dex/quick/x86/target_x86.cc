@@ -507,6 +507,15 @@ bool X86Mir2Lir::IsUnconditionalBranch(LIR* lir) {
   return (lir->opcode == kX86Jmp8 || lir->opcode == kX86Jmp32);
 }
 
+bool X86Mir2Lir::IsRegCopy(LIR* lir) {
+  // Not movss, which keeps the upper bits of the destination.
+  return (lir->opcode == kX86Mov32RR || lir->opcode == kX86MovsdRR);
+}
+
+void X86Mir2Lir::ApplyTargetPeepholeOptimizations() {
+  // Nothing specific to x86 yet.
+}
+
 X86Mir2Lir::X86Mir2Lir(CompilationUnit* cu, MIRGraph* mir_graph, ArenaAllocator* arena)
     : Mir2Lir(cu, mir_graph, arena) {
   for (int i = 0; i < kX86Last; i++) {
@@ -529,10 +538,24 @@ int X86Mir2Lir::LoadHelper(ThreadOffset offset) {
   return INVALID_REG;
 }
 
+LIR* X86Mir2Lir::LoadWordThreadMem(int r_dest, ThreadOffset thread_offset) {
+  return NewLIR2(kX86Mov32RT, r_dest, thread_offset.Int32Value());
+}
+
+LIR* X86Mir2Lir::StoreWordThreadMem(ThreadOffset thread_offset, int r_src) {
+  return NewLIR2(kX86Mov32TR, thread_offset.Int32Value(), r_src);
+}
+
 uint64_t X86Mir2Lir::GetTargetInstFlags(int opcode) {
   return X86Mir2Lir::EncodingMap[opcode].flags;
 }
 
+int X86Mir2Lir::GetInsnLatency(LIR* lir) {
+  // Instruction scheduling is disabled for x86.
+  LOG(FATAL) << "Unexpected call to GetInsnLatency for x86";
+  return 1;
+}
+
 const char* X86Mir2Lir::GetTargetInstName(int opcode) {
   return X86Mir2Lir::EncodingMap[opcode].name;
 }
@@ -344,6 +344,7 @@ enum X86OpCode {
   Binary0fOpCode(kX86Subss),    // float subtract
   Binary0fOpCode(kX86Divsd),    // double divide
   Binary0fOpCode(kX86Divss),    // float divide
+  Binary0fOpCode(kX86Sqrtsd),   // double square root
   kX86PsrlqRI,                  // right shift of floating point registers
   kX86PsllqRI,                  // left shift of floating point registers
   Binary0fOpCode(kX86Movdxr),   // move into xmm from gpr
@@ -359,6 +360,14 @@ enum X86OpCode {
   Binary0fOpCode(kX86Movsx8),   // sign-extend 8-bit value
   Binary0fOpCode(kX86Movsx16),  // sign-extend 16-bit value
 #undef Binary0fOpCode
+  kX86Fild64M,                  // push 64-bit integer on x87 stack; lir operands - 0: base, 1: disp
+  kX86Fld32M, kX86Fld64M,       // push float/double on x87 stack; lir operands - 0: base, 1: disp
+  kX86Fst32M, kX86Fst64M,       // store x87 top as float/double; lir operands - 0: base, 1: disp
+  kX86Fstp32M, kX86Fstp64M,     // store and pop x87 top as float/double
+                                // lir operands - 0: base, 1: disp
+  kX86Fprem,                    // partial remainder of st(0) by st(1); no lir operands
+  kX86Fucompp,                  // compare st(0) with st(1) and pop both; no lir operands
+  kX86Fstsw16R,                 // store x87 status word in ax; no lir operands
   kX86Jcc8, kX86Jcc32,  // jCC rel8/32; lir operands - 0: rel, 1: CC, target assigned
   kX86Jmp8, kX86Jmp32,  // jmp rel8/32; lir operands - 0: rel, target assigned
   kX86JmpR,             // jmp reg; lir operands - 0: reg
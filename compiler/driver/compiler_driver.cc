@@ -19,6 +19,7 @@
 #define ATRACE_TAG ATRACE_TAG_DALVIK
 #include <utils/Trace.h>
 
+#include <algorithm>
 #include <vector>
 #include <unistd.h>
 
@@ -28,6 +29,7 @@
 #include "dex_compilation_unit.h"
 #include "dex_file-inl.h"
 #include "jni_internal.h"
+#include "oat_code_reuse.h"
 #include "object_utils.h"
 #include "runtime.h"
 #include "gc/accounting/card_table-inl.h"
@@ -46,6 +48,7 @@
 #include "thread.h"
 #include "thread_pool.h"
 #include "trampolines/trampoline_compiler.h"
+#include "transaction.h"
 #include "verifier/method_verifier.h"
 
 #if defined(ART_USE_PORTABLE_COMPILER)
@@ -337,12 +340,13 @@ extern "C" void compilerLLVMSetBitcodeFileName(art::CompilerDriver& driver,
 
 CompilerDriver::CompilerDriver(CompilerBackend compiler_backend, InstructionSet instruction_set,
                                bool image, DescriptorSet* image_classes, size_t thread_count,
-                               bool dump_stats)
+                               bool dump_stats, SwapSpace* swap_space)
     : compiler_backend_(compiler_backend),
       instruction_set_(instruction_set),
       freezing_constructor_lock_("freezing constructor lock"),
       compiled_classes_lock_("compiled classes lock"),
       compiled_methods_lock_("compiled method lock"),
+      overridden_methods_lock_("overridden methods lock"),
       image_(image),
       image_classes_(image_classes),
       thread_count_(thread_count),
@@ -355,7 +359,19 @@ CompilerDriver::CompilerDriver(CompilerBackend compiler_backend, InstructionSet
       jni_compiler_(NULL),
       compiler_enable_auto_elf_loading_(NULL),
       compiler_get_method_code_addr_(NULL),
-      support_boot_image_fixup_(true) {
+      support_boot_image_fixup_(true),
+      support_relative_calls_(false),
+      implicit_suspend_checks_(false),
+      implicit_null_checks_(false),
+      implicit_stack_overflow_checks_(false),
+      method_hooks_(false),
+      method_report_enabled_(false),
+      method_report_lock_("method report lock"),
+      swap_space_(swap_space),
+      dedupe_code_("dedupe code", SwapAllocator<uint8_t>(swap_space)),
+      dedupe_mapping_table_("dedupe mapping table", SwapAllocator<uint8_t>(swap_space)),
+      dedupe_vmap_table_("dedupe vmap table", SwapAllocator<uint8_t>(swap_space)),
+      dedupe_gc_map_("dedupe gc map", SwapAllocator<uint8_t>(swap_space)) {
 
   CHECK_PTHREAD_CALL(pthread_key_create, (&tls_key_, NULL), "compiler tls key");
 
@@ -394,19 +410,19 @@ CompilerDriver::CompilerDriver(CompilerBackend compiler_backend, InstructionSet
   }
 }
 
-std::vector<uint8_t>* CompilerDriver::DeduplicateCode(const std::vector<uint8_t>& code) {
+SwapVector<uint8_t>* CompilerDriver::DeduplicateCode(const std::vector<uint8_t>& code) {
   return dedupe_code_.Add(Thread::Current(), code);
 }
 
-std::vector<uint8_t>* CompilerDriver::DeduplicateMappingTable(const std::vector<uint8_t>& code) {
+SwapVector<uint8_t>* CompilerDriver::DeduplicateMappingTable(const std::vector<uint8_t>& code) {
   return dedupe_mapping_table_.Add(Thread::Current(), code);
 }
 
-std::vector<uint8_t>* CompilerDriver::DeduplicateVMapTable(const std::vector<uint8_t>& code) {
+SwapVector<uint8_t>* CompilerDriver::DeduplicateVMapTable(const std::vector<uint8_t>& code) {
   return dedupe_vmap_table_.Add(Thread::Current(), code);
 }
 
-std::vector<uint8_t>* CompilerDriver::DeduplicateGCMap(const std::vector<uint8_t>& code) {
+SwapVector<uint8_t>* CompilerDriver::DeduplicateGCMap(const std::vector<uint8_t>& code) {
   return dedupe_gc_map_.Add(Thread::Current(), code);
 }
 
@@ -428,6 +444,10 @@ CompilerDriver::~CompilerDriver() {
     MutexLock mu(self, compiled_methods_lock_);
     STLDeleteElements(&methods_to_patch_);
   }
+  {
+    MutexLock mu(self, compiled_methods_lock_);
+    STLDeleteElements(&relative_calls_to_patch_);
+  }
   CHECK_PTHREAD_CALL(pthread_key_delete, (tls_key_), "delete tls key");
   typedef void (*UninitCompilerContextFn)(CompilerDriver&);
   UninitCompilerContextFn uninit_compiler_context;
@@ -485,6 +505,22 @@ const std::vector<uint8_t>* CompilerDriver::CreateQuickToInterpreterBridge() con
                           QUICK_ENTRYPOINT_OFFSET(pQuickToInterpreterBridge));
 }
 
+const std::vector<uint8_t>* CompilerDriver::CreateRelativeCallThunk() const {
+  CHECK_EQ(instruction_set_, kThumb2);
+  // ldr.w pc, [r0, #entry_point_from_compiled_code]. The caller has put the callee's Method* in r0
+  // and its return address in lr, so this finishes the call the way an unpatched call would.
+  uint32_t entry_point_offset =
+      mirror::ArtMethod::GetEntryPointFromCompiledCodeOffset().Uint32Value();
+  CHECK_LT(entry_point_offset, 4096U);
+  const uint16_t insns[] = { 0xf8d0, static_cast<uint16_t>(0xf000 | entry_point_offset) };
+  std::vector<uint8_t>* thunk = new std::vector<uint8_t>;
+  for (size_t i = 0; i < arraysize(insns); ++i) {
+    thunk->push_back(insns[i] & 0xff);
+    thunk->push_back(insns[i] >> 8);
+  }
+  return thunk;
+}
+
 void CompilerDriver::CompileAll(jobject class_loader,
                                 const std::vector<const DexFile*>& dex_files,
                                 base::TimingLogger& timings) {
@@ -495,6 +531,10 @@ void CompilerDriver::CompileAll(jobject class_loader,
   if (dump_stats_) {
     stats_->Dump();
   }
+  if (swap_space_.get() != NULL) {
+    VLOG(compiler) << "Swap file holds " << PrettySize(swap_space_->GetSwapSize())
+                   << " of compiled code and tables";
+  }
 }
 
 static DexToDexCompilationLevel GetDexToDexCompilationlevel(mirror::ClassLoader* class_loader,
@@ -574,6 +614,39 @@ void CompilerDriver::CompileOne(const mirror::ArtMethod* method, base::TimingLog
   self->TransitionFromSuspendedToRunnable();
 }
 
+const CompiledMethod* CompilerDriver::CompileLoadedMethod(mirror::ArtMethod* method) {
+  Thread* self = Thread::Current();
+  jobject jclass_loader;
+  const DexFile* dex_file;
+  uint16_t class_def_idx;
+  const DexFile::CodeItem* code_item;
+  uint32_t access_flags;
+  InvokeType invoke_type;
+  uint32_t method_idx;
+  {
+    ScopedObjectAccess soa(self);
+    DCHECK(method->GetDeclaringClass()->IsVerified()) << PrettyMethod(method);
+    ScopedLocalRef<jobject>
+      local_class_loader(soa.Env(),
+                    soa.AddLocalReference<jobject>(method->GetDeclaringClass()->GetClassLoader()));
+    jclass_loader = soa.Env()->NewGlobalRef(local_class_loader.get());
+    MethodHelper mh(method);
+    dex_file = &mh.GetDexFile();
+    class_def_idx = mh.GetClassDefIndex();
+    code_item = mh.GetCodeItem();
+    access_flags = method->GetAccessFlags();
+    invoke_type = method->GetInvokeType();
+    method_idx = method->GetDexMethodIndex();
+  }
+
+  CompileMethod(code_item, access_flags, invoke_type, class_def_idx, method_idx, jclass_loader,
+                *dex_file, kDontDexToDexCompile);
+
+  self->GetJniEnv()->DeleteGlobalRef(jclass_loader);
+
+  return GetCompiledMethod(MethodReference(dex_file, method_idx));
+}
+
 void CompilerDriver::Resolve(jobject class_loader, const std::vector<const DexFile*>& dex_files,
                              ThreadPool& thread_pool, base::TimingLogger& timings) {
   for (size_t i = 0; i != dex_files.size(); ++i) {
@@ -886,6 +959,21 @@ bool CompilerDriver::CanAccessInstantiableTypeWithoutChecks(uint32_t referrer_id
   return result;
 }
 
+bool CompilerDriver::ComputeNewInstanceInfo(const DexFile& dex_file, uint32_t type_idx,
+                                            size_t* object_size) {
+  ScopedObjectAccess soa(Thread::Current());
+  mirror::DexCache* dex_cache = Runtime::Current()->GetClassLinker()->FindDexCache(dex_file);
+  mirror::Class* resolved_class = dex_cache->GetResolvedType(type_idx);
+  // Finalizable instances must be registered by the allocation entrypoint, and variably sized
+  // classes have no fixed instance size to compile in.
+  if (resolved_class == NULL || !resolved_class->IsInstantiable() ||
+      resolved_class->IsFinalizable() || resolved_class->IsVariableSize()) {
+    return false;
+  }
+  *object_size = resolved_class->GetObjectSize();
+  return true;
+}
+
 static mirror::Class* ComputeCompilingMethodsClass(ScopedObjectAccess& soa,
                                                    mirror::DexCache* dex_cache,
                                                    const DexCompilationUnit* mUnit)
@@ -1055,6 +1143,25 @@ bool CompilerDriver::ComputeStaticFieldInfo(uint32_t field_idx, const DexCompila
   return false;  // Incomplete knowledge needs slow path.
 }
 
+bool CompilerDriver::IsStaticFieldsClassInitializedInImage(uint32_t field_idx,
+                                                          const DexCompilationUnit* mUnit) {
+  ScopedObjectAccess soa(Thread::Current());
+  mirror::ArtField* resolved_field = ComputeFieldReferencedFromCompilingMethod(soa, mUnit, field_idx);
+  if (resolved_field == NULL || !resolved_field->IsStatic()) {
+    soa.Self()->ClearException();
+    return false;
+  }
+  mirror::Class* fields_class = resolved_field->GetDeclaringClass();
+  if (!fields_class->IsInitialized()) {
+    return false;
+  }
+  if (IsImage()) {
+    // The image classes initialized by InitializeClasses are written to the image initialized.
+    return IsImageClass(ClassHelper(fields_class).GetDescriptor());
+  }
+  return Runtime::Current()->GetHeap()->FindSpaceFromObject(fields_class, false)->IsImageSpace();
+}
+
 void CompilerDriver::GetCodeAndMethodForDirectCall(InvokeType type, InvokeType sharp_type,
                                                    mirror::Class* referrer_class,
                                                    mirror::ArtMethod* method,
@@ -1110,6 +1217,24 @@ void CompilerDriver::GetCodeAndMethodForDirectCall(InvokeType type, InvokeType s
   }
 }
 
+bool CompilerDriver::CanCallRelative(InvokeType invoke_type, mirror::Class* referrer_class,
+                                     mirror::ArtMethod* method,
+                                     const MethodReference& target_method) const {
+  if (!support_relative_calls_ || image_ || compiler_backend_ != kQuick ||
+      instruction_set_ != kThumb2) {
+    return false;
+  }
+  if (invoke_type != kDirect && invoke_type != kStatic) {
+    return false;
+  }
+  // The class linker only puts the direct methods of a class in the dex cache when the class is
+  // defined, at their own method ids, see ClassLinker::ResolveRelativeCallTargets. That the
+  // caller runs means its class is defined, and static callees of the same class need no class
+  // initialization check. JNI stubs are ARM code that a Thumb bl can't reach.
+  return method->GetDeclaringClass() == referrer_class && method->IsDirect() &&
+      !method->IsNative() && method->GetDexMethodIndex() == target_method.dex_method_index;
+}
+
 bool CompilerDriver::ComputeInvokeInfo(const DexCompilationUnit* mUnit, const uint32_t dex_pc,
                                        InvokeType& invoke_type,
                                        MethodReference& target_method,
@@ -1271,9 +1396,17 @@ bool CompilerDriver::ComputeInvokeInfo(const DexCompilationUnit* mUnit, const ui
           }
           if (invoke_type == kVirtual || invoke_type == kSuper) {
             vtable_idx = resolved_method->GetMethodIndex();
+          } else if (invoke_type == kInterface) {
+            vtable_idx = mirror::Class::ImTableIndex(resolved_method);
           }
           GetCodeAndMethodForDirectCall(invoke_type, invoke_type, referrer_class, resolved_method,
                                         direct_code, direct_method, update_stats);
+          if (direct_code == 0 && direct_method == 0 &&
+              CanCallRelative(invoke_type, referrer_class, resolved_method, target_method)) {
+            // The code branches with a bl the OatWriter patches, the Method* still comes from the
+            // dex cache. Boot image fixups set both to -1, so -1 alone means a relative call.
+            direct_code = -1;
+          }
           return true;
         }
       }
@@ -1289,6 +1422,125 @@ bool CompilerDriver::ComputeInvokeInfo(const DexCompilationUnit* mUnit, const ui
   return false;  // Incomplete knowledge needs slow path.
 }
 
+const DexFile::CodeItem* CompilerDriver::GetInlinableCodeItem(
+    const DexCompilationUnit* mUnit, const MethodReference& target_method, InvokeType type,
+    bool& is_referrers_class) {
+  is_referrers_class = false;
+  if (target_method.dex_file != mUnit->GetDexFile()) {
+    return NULL;
+  }
+  ScopedObjectAccess soa(Thread::Current());
+  mirror::ArtMethod* method =
+      ComputeMethodReferencedFromCompilingMethod(soa, mUnit, target_method.dex_method_index,
+                                                 type);
+  if (method == NULL) {
+    // Clean up any exception left by method resolution.
+    if (soa.Self()->IsExceptionPending()) {
+      soa.Self()->ClearException();
+    }
+    return NULL;
+  }
+  if (method->IsNative() || method->IsAbstract() || method->IsSynchronized()) {
+    return NULL;
+  }
+  MethodHelper mh(method);
+  if (&mh.GetDexFile() != mUnit->GetDexFile()) {
+    return NULL;
+  }
+  mirror::Class* referrer_class =
+      ComputeCompilingMethodsClass(soa, method->GetDeclaringClass()->GetDexCache(), mUnit);
+  if (referrer_class == NULL) {
+    if (soa.Self()->IsExceptionPending()) {
+      soa.Self()->ClearException();
+    }
+    return NULL;
+  }
+  is_referrers_class = (referrer_class == method->GetDeclaringClass());
+  return mh.GetCodeItem();
+}
+
+static bool RecordOverriddenMethods(mirror::Class* klass, void* arg)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  std::set<const mirror::ArtMethod*>* overridden_methods =
+      reinterpret_cast<std::set<const mirror::ArtMethod*>*>(arg);
+  mirror::Class* super_class = klass->GetSuperClass();
+  if (super_class == NULL) {
+    return true;
+  }
+  mirror::ObjectArray<mirror::ArtMethod>* vtable = klass->GetVTable();
+  mirror::ObjectArray<mirror::ArtMethod>* super_vtable = super_class->GetVTable();
+  if (vtable == NULL || super_vtable == NULL) {
+    // Not linked yet.
+    return true;
+  }
+  // Only the slots of the direct super class are compared, a method overriding a method of a more
+  // distant ancestor is found in the class that declares the method the super class inherits.
+  int32_t length = std::min(vtable->GetLength(), super_vtable->GetLength());
+  for (int32_t i = 0; i < length; ++i) {
+    mirror::ArtMethod* super_method = super_vtable->Get(i);
+    if (vtable->Get(i) != super_method) {
+      overridden_methods->insert(super_method);
+    }
+  }
+  return true;
+}
+
+bool CompilerDriver::IsOverridden(const mirror::ArtMethod* method) {
+  Thread* self = Thread::Current();
+  {
+    MutexLock mu(self, overridden_methods_lock_);
+    if (overridden_methods_.get() != NULL) {
+      return overridden_methods_->count(method) != 0;
+    }
+  }
+  // Walk the classes without holding overridden_methods_lock_, the classes lock is acquired after
+  // it. Threads racing here compute the same set.
+  UniquePtr<std::set<const mirror::ArtMethod*> > overridden_methods(
+      new std::set<const mirror::ArtMethod*>);
+  Runtime::Current()->GetClassLinker()->VisitClasses(RecordOverriddenMethods,
+                                                     overridden_methods.get());
+  MutexLock mu(self, overridden_methods_lock_);
+  if (overridden_methods_.get() == NULL) {
+    overridden_methods_.reset(overridden_methods.release());
+  }
+  return overridden_methods_->count(method) != 0;
+}
+
+bool CompilerDriver::ComputeGuardedDevirtualInfo(const DexCompilationUnit* mUnit,
+                                                 const MethodReference& target_method,
+                                                 uintptr_t& direct_code,
+                                                 uintptr_t& direct_method) {
+  direct_code = 0;
+  direct_method = 0;
+  // The guard compares against the address of the Method*, which is only known once the boot
+  // image is laid out, and quick only calls direct pointers on Thumb2.
+  bool compiling_boot = Runtime::Current()->GetHeap()->GetContinuousSpaces().size() == 1;
+  if (compiler_backend_ != kQuick || instruction_set_ != kThumb2 || compiling_boot) {
+    return false;
+  }
+  ScopedObjectAccess soa(Thread::Current());
+  mirror::ArtMethod* resolved_method =
+      ComputeMethodReferencedFromCompilingMethod(soa, mUnit, target_method.dex_method_index,
+                                                 kVirtual);
+  if (resolved_method == NULL) {
+    soa.Self()->ClearException();
+    return false;
+  }
+  if (resolved_method->IsAbstract() ||
+      resolved_method->GetDeclaringClass()->GetClassLoader() != NULL ||
+      !Runtime::Current()->GetHeap()->FindSpaceFromObject(resolved_method, false)->IsImageSpace()) {
+    return false;
+  }
+  const void* code = resolved_method->GetEntryPointFromCompiledCode();
+  if (code == NULL || IsOverridden(resolved_method)) {
+    return false;
+  }
+  stats_->VirtualMadeDirect(kVirtual);
+  direct_code = reinterpret_cast<uintptr_t>(code);
+  direct_method = reinterpret_cast<uintptr_t>(resolved_method);
+  return true;
+}
+
 bool CompilerDriver::IsSafeCast(const MethodReference& mr, uint32_t dex_pc) {
   bool result = verifier::MethodVerifier::IsSafeCast(mr, dex_pc);
   if (result) {
@@ -1316,6 +1568,7 @@ void CompilerDriver::AddCodePatch(const DexFile* dex_file,
                                                 target_invoke_type,
                                                 literal_offset));
 }
+
 void CompilerDriver::AddMethodPatch(const DexFile* dex_file,
                                     uint16_t referrer_class_def_idx,
                                     uint32_t referrer_method_idx,
@@ -1333,6 +1586,23 @@ void CompilerDriver::AddMethodPatch(const DexFile* dex_file,
                                                    literal_offset));
 }
 
+void CompilerDriver::AddRelativeCallPatch(const DexFile* dex_file,
+                                          uint16_t referrer_class_def_idx,
+                                          uint32_t referrer_method_idx,
+                                          InvokeType referrer_invoke_type,
+                                          uint32_t target_method_idx,
+                                          InvokeType target_invoke_type,
+                                          size_t literal_offset) {
+  MutexLock mu(Thread::Current(), compiled_methods_lock_);
+  relative_calls_to_patch_.push_back(new PatchInformation(dex_file,
+                                                          referrer_class_def_idx,
+                                                          referrer_method_idx,
+                                                          referrer_invoke_type,
+                                                          target_method_idx,
+                                                          target_invoke_type,
+                                                          literal_offset));
+}
+
 class ParallelCompilationManager {
  public:
   typedef void Callback(const ParallelCompilationManager* manager, size_t index);
@@ -1342,8 +1612,7 @@ class ParallelCompilationManager {
                              CompilerDriver* compiler,
                              const DexFile* dex_file,
                              ThreadPool& thread_pool)
-    : index_(0),
-      class_linker_(class_linker),
+    : class_linker_(class_linker),
       class_loader_(class_loader),
       compiler_(compiler),
       dex_file_(dex_file),
@@ -1368,15 +1637,19 @@ class ParallelCompilationManager {
     return dex_file_;
   }
 
-  void ForAll(size_t begin, size_t end, Callback callback, size_t work_units) {
+  // Calls the callback for every index in [begin, end) on work_units threads. The threads claim
+  // up to max_chunk_size indices at a time, a max_chunk_size of one keeps the order of the indices
+  // for callers that sort the work largest first.
+  void ForAll(size_t begin, size_t end, Callback callback, size_t work_units,
+              size_t max_chunk_size = kDefaultMaxChunkSize) {
     Thread* self = Thread::Current();
     self->AssertNoPendingException();
     CHECK_GT(work_units, 0U);
 
+    ParallelForRange range(begin, end, work_units, max_chunk_size);
     std::vector<ForAllClosure*> closures(work_units);
-    index_ = begin;
     for (size_t i = 0; i < work_units; ++i) {
-      closures[i] = new ForAllClosure(this, end, callback);
+      closures[i] = new ForAllClosure(this, &range, callback);
       thread_pool_->AddTask(self, closures[i]);
     }
     thread_pool_->StartWorkers(self);
@@ -1389,26 +1662,26 @@ class ParallelCompilationManager {
     thread_pool_->Wait(self, true, false);
   }
 
-  size_t NextIndex() {
-    return index_.fetch_add(1);
-  }
-
  private:
+  // Classes and types are cheap and about the same cost each, so claim them in chunks.
+  static const size_t kDefaultMaxChunkSize = 64;
+
   class ForAllClosure : public Task {
    public:
-    ForAllClosure(ParallelCompilationManager* manager, size_t end, Callback* callback)
+    ForAllClosure(ParallelCompilationManager* manager, ParallelForRange* range,
+                  Callback* callback)
         : manager_(manager),
-          end_(end),
+          range_(range),
           callback_(callback) {}
 
     virtual void Run(Thread* self) {
-      while (true) {
-        const size_t index = manager_->NextIndex();
-        if (UNLIKELY(index >= end_)) {
-          break;
+      size_t chunk_begin;
+      size_t chunk_end;
+      while (range_->Next(&chunk_begin, &chunk_end)) {
+        for (size_t index = chunk_begin; index != chunk_end; ++index) {
+          callback_(manager_, index);
+          self->AssertNoPendingException();
         }
-        callback_(manager_, index);
-        self->AssertNoPendingException();
       }
     }
 
@@ -1418,11 +1691,10 @@ class ParallelCompilationManager {
 
    private:
     ParallelCompilationManager* const manager_;
-    const size_t end_;
+    ParallelForRange* const range_;
     const Callback* const callback_;
   };
 
-  AtomicInteger index_;
   ClassLinker* const class_linker_;
   const jobject class_loader_;
   CompilerDriver* const compiler_;
@@ -1633,7 +1905,7 @@ static void VerifyClass(const ParallelCompilationManager* manager, size_t class_
     if (verifier::MethodVerifier::VerifyClass(dex_file,
                                               dex_cache,
                                               soa.Decode<mirror::ClassLoader*>(manager->GetClassLoader()),
-                                              class_def, true, &error_msg) ==
+                                              class_def, true, NULL, &error_msg) ==
                                                   verifier::MethodVerifier::kHardFailure) {
       const DexFile::ClassDef& class_def = manager->GetDexFile()->GetClassDef(class_def_index);
       LOG(ERROR) << "Verification failed on class "
@@ -2081,6 +2353,28 @@ static const char* class_initializer_black_list[] = {
   "Lorg/apache/http/conn/util/InetAddressUtils;",  // Calls regex.Pattern.compile -..-> regex.Pattern.compileImpl.
 };
 
+// Runs the initializer of an image class, undoing everything it did if it calls native code or
+// fails, in which case the class is left verified and is initialized at first use instead.
+static void InitializeClassInTransaction(Thread* self, ClassLinker* class_linker,
+                                         mirror::Class* klass, const char* descriptor)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  Transaction transaction;
+  self->SetTransaction(&transaction);
+  bool success = class_linker->EnsureInitialized(klass, true, true);
+  self->SetTransaction(NULL);
+  if (!success || transaction.IsAborted()) {
+    if (transaction.IsAborted()) {
+      VLOG(compiler) << "Not initializing " << descriptor << ": " << transaction.GetAbortMessage();
+    } else {
+      VLOG(compiler) << "Not initializing " << descriptor << ": "
+                     << self->GetException(NULL)->Dump();
+    }
+    transaction.Rollback();
+    self->ClearException();
+    CHECK(!klass->IsInitialized()) << descriptor;
+  }
+}
+
 static void InitializeClass(const ParallelCompilationManager* manager, size_t class_def_index)
     LOCKS_EXCLUDED(Locks::mutator_lock_) {
   ATRACE_CALL();
@@ -2134,22 +2428,15 @@ static void InitializeClass(const ParallelCompilationManager* manager, size_t cl
                 fields->Get(0)->SetObj(klass, manager->GetClassLinker()->FindPrimitiveClass('V'));
                 klass->SetStatus(mirror::Class::kStatusInitialized, soa.Self());
               } else {
-                manager->GetClassLinker()->EnsureInitialized(klass, true, true);
+                InitializeClassInTransaction(soa.Self(), manager->GetClassLinker(), klass,
+                                             descriptor);
               }
             }
           }
         }
         soa.Self()->AssertNoPendingException();
       }
-      // If successfully initialized place in SSB array.
-      if (klass->IsInitialized()) {
-        int32_t ssb_index = klass->GetDexTypeIndex();
-        klass->GetDexCache()->GetInitializedStaticStorage()->Set(ssb_index, klass);
-      }
     }
-    // Record the final class status if necessary.
-    ClassReference ref(manager->GetDexFile(), class_def_index);
-    manager->GetCompiler()->RecordClassStatus(ref, klass->GetStatus());
   }
   // Clear any class not found or verification exceptions.
   soa.Self()->ClearException();
@@ -2171,6 +2458,25 @@ void CompilerDriver::InitializeClasses(jobject jni_class_loader, const DexFile&
   ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
   ParallelCompilationManager context(class_linker, jni_class_loader, this, &dex_file, thread_pool);
   context.ForAll(0, dex_file.NumClassDefs(), InitializeClass, thread_count_);
+
+  // The statuses are recorded once every initializer has finished, since rolling back one can
+  // take back the initialization of classes that other threads have already seen initialized.
+  ScopedObjectAccess soa(Thread::Current());
+  mirror::ClassLoader* class_loader = soa.Decode<mirror::ClassLoader*>(jni_class_loader);
+  for (size_t class_def_index = 0; class_def_index < dex_file.NumClassDefs(); ++class_def_index) {
+    const char* descriptor = dex_file.GetClassDescriptor(dex_file.GetClassDef(class_def_index));
+    mirror::Class* klass = class_linker->LookupClass(descriptor, class_loader);
+    if (klass == NULL) {
+      continue;
+    }
+    // If successfully initialized place in SSB array.
+    if (klass->IsInitialized()) {
+      int32_t ssb_index = klass->GetDexTypeIndex();
+      klass->GetDexCache()->GetInitializedStaticStorage()->Set(ssb_index, klass);
+    }
+    ClassReference ref(&dex_file, class_def_index);
+    RecordClassStatus(ref, klass->GetStatus());
+  }
 }
 
 void CompilerDriver::InitializeClasses(jobject class_loader,
@@ -2192,7 +2498,8 @@ void CompilerDriver::Compile(jobject class_loader, const std::vector<const DexFi
   }
 }
 
-void CompilerDriver::CompileClass(const ParallelCompilationManager* manager, size_t class_def_index) {
+void CompilerDriver::CollectMethodsToCompile(const ParallelCompilationManager* manager,
+                                             size_t class_def_index) {
   ATRACE_CALL();
   jobject jclass_loader = manager->GetClassLoader();
   const DexFile& dex_file = *manager->GetDexFile();
@@ -2227,49 +2534,153 @@ void CompilerDriver::CompileClass(const ParallelCompilationManager* manager, siz
   while (it.HasNextInstanceField()) {
     it.Next();
   }
-  CompilerDriver* driver = manager->GetCompiler();
-  // Compile direct methods
-  int64_t previous_direct_method_idx = -1;
-  while (it.HasNextDirectMethod()) {
-    uint32_t method_idx = it.GetMemberIndex();
-    if (method_idx == previous_direct_method_idx) {
-      // smali can create dex files with two encoded_methods sharing the same method_idx
-      // http://code.google.com/p/smali/issues/detail?id=119
-      it.Next();
-      continue;
+  std::vector<MethodToCompile>& methods =
+      manager->GetCompiler()->class_methods_to_compile_[class_def_index];
+  // Direct methods come first, then virtual methods.
+  int64_t previous_method_idx = -1;
+  bool direct = true;
+  for (uint32_t class_def_method_index = 0; it.HasNextDirectMethod() || it.HasNextVirtualMethod();
+       ++class_def_method_index) {
+    if (direct && !it.HasNextDirectMethod()) {
+      direct = false;
+      previous_method_idx = -1;
     }
-    previous_direct_method_idx = method_idx;
-    driver->CompileMethod(it.GetMethodCodeItem(), it.GetMemberAccessFlags(),
-                          it.GetMethodInvokeType(class_def), class_def_index,
-                          method_idx, jclass_loader, dex_file, dex_to_dex_compilation_level);
-    it.Next();
-  }
-  // Compile virtual methods
-  int64_t previous_virtual_method_idx = -1;
-  while (it.HasNextVirtualMethod()) {
     uint32_t method_idx = it.GetMemberIndex();
-    if (method_idx == previous_virtual_method_idx) {
+    if (method_idx == previous_method_idx) {
       // smali can create dex files with two encoded_methods sharing the same method_idx
       // http://code.google.com/p/smali/issues/detail?id=119
       it.Next();
       continue;
     }
-    previous_virtual_method_idx = method_idx;
-    driver->CompileMethod(it.GetMethodCodeItem(), it.GetMemberAccessFlags(),
-                          it.GetMethodInvokeType(class_def), class_def_index,
-                          method_idx, jclass_loader, dex_file, dex_to_dex_compilation_level);
+    previous_method_idx = method_idx;
+    MethodToCompile method;
+    method.code_item = it.GetMethodCodeItem();
+    method.access_flags = it.GetMemberAccessFlags();
+    method.invoke_type = it.GetMethodInvokeType(class_def);
+    method.class_def_idx = class_def_index;
+    method.method_idx = method_idx;
+    method.class_def_method_index = class_def_method_index;
+    method.dex_to_dex_compilation_level = dex_to_dex_compilation_level;
+    methods.push_back(method);
     it.Next();
   }
   DCHECK(!it.HasNext());
 }
 
+void CompilerDriver::CompileMethodToCompile(const ParallelCompilationManager* manager,
+                                            size_t index) {
+  CompilerDriver* driver = manager->GetCompiler();
+  const MethodToCompile& method = driver->methods_to_compile_[index];
+  if (driver->oat_code_reuse_.get() != NULL &&
+      (method.access_flags & (kAccNative | kAccAbstract)) == 0) {
+    MethodReference method_ref(manager->GetDexFile(), method.method_idx);
+    if (verifier::MethodVerifier::IsCandidateForCompilation(method_ref, method.access_flags)) {
+      uint64_t start_ns = NanoTime();
+      CompiledMethod* compiled_method =
+          driver->oat_code_reuse_->GetReusableMethod(*driver, *manager->GetDexFile(),
+                                                     method.class_def_idx,
+                                                     method.class_def_method_index);
+      if (compiled_method != NULL) {
+        {
+          MutexLock mu(Thread::Current(), driver->compiled_methods_lock_);
+          driver->compiled_methods_.Put(method_ref, compiled_method);
+        }
+        if (driver->method_report_enabled_) {
+          driver->RecordMethodReport(*manager->GetDexFile(), method.method_idx, method.code_item,
+                                     "reused", NanoTime() - start_ns, MethodCompileStats(),
+                                     compiled_method);
+        }
+        return;
+      }
+    }
+  }
+  driver->CompileMethod(method.code_item, method.access_flags, method.invoke_type,
+                        method.class_def_idx, method.method_idx, manager->GetClassLoader(),
+                        *manager->GetDexFile(), method.dex_to_dex_compilation_level);
+}
+
+void CompilerDriver::RecordMethodReport(const DexFile& dex_file, uint32_t method_idx,
+                                        const DexFile::CodeItem* code_item, const char* outcome,
+                                        uint64_t duration_ns, const MethodCompileStats& stats,
+                                        const CompiledMethod* compiled_method) {
+  MethodReportEntry entry;
+  entry.dex_file = &dex_file;
+  entry.method_idx = method_idx;
+  entry.outcome = outcome;
+  entry.code_units = (code_item == NULL) ? 0 : code_item->insns_size_in_code_units_;
+  entry.duration_ns = duration_ns;
+  entry.stats = stats;
+  entry.code_bytes = (compiled_method == NULL) ? 0 : compiled_method->GetCode().size();
+  MutexLock mu(Thread::Current(), method_report_lock_);
+  method_report_.push_back(entry);
+}
+
+bool CompilerDriver::MethodReportEntry::SlowerFirst(const MethodReportEntry* lhs,
+                                                    const MethodReportEntry* rhs) {
+  return lhs->duration_ns > rhs->duration_ns;
+}
+
+void CompilerDriver::DumpMethodReport(std::ostream& os) const {
+  MutexLock mu(Thread::Current(), method_report_lock_);
+  std::vector<const MethodReportEntry*> entries;
+  for (size_t i = 0; i < method_report_.size(); ++i) {
+    entries.push_back(&method_report_[i]);
+  }
+  std::stable_sort(entries.begin(), entries.end(), MethodReportEntry::SlowerFirst);
+  os << "method,dex_file,outcome,code_units,time_ns,arena_bytes,blocks,mirs,lirs,code_bytes\n";
+  for (size_t i = 0; i < entries.size(); ++i) {
+    const MethodReportEntry& entry = *entries[i];
+    // Method signatures contain commas, quote them. Neither they nor locations contain quotes.
+    os << '"' << PrettyMethod(entry.method_idx, *entry.dex_file) << "\","
+       << '"' << entry.dex_file->GetLocation() << "\","
+       << entry.outcome << ","
+       << entry.code_units << ","
+       << entry.duration_ns << ","
+       << entry.stats.arena_bytes << ","
+       << entry.stats.num_blocks << ","
+       << entry.stats.num_mirs << ","
+       << entry.stats.num_lirs << ","
+       << entry.code_bytes << "\n";
+  }
+}
+
+bool CompilerDriver::MethodToCompile::CompileBefore(const MethodToCompile& lhs,
+                                                   const MethodToCompile& rhs) {
+  if (lhs.Cost() != rhs.Cost()) {
+    return lhs.Cost() > rhs.Cost();
+  }
+  if (lhs.class_def_idx != rhs.class_def_idx) {
+    return lhs.class_def_idx < rhs.class_def_idx;
+  }
+  return lhs.method_idx < rhs.method_idx;
+}
+
 void CompilerDriver::CompileDexFile(jobject class_loader, const DexFile& dex_file,
                                     ThreadPool& thread_pool, base::TimingLogger& timings) {
   // TODO: strdup memory leak.
   timings.NewSplit(strdup(("Compile " + dex_file.GetLocation()).c_str()));
   ParallelCompilationManager context(Runtime::Current()->GetClassLinker(), class_loader, this,
                                      &dex_file, thread_pool);
-  context.ForAll(0, dex_file.NumClassDefs(), CompilerDriver::CompileClass, thread_count_);
+  // Compile one method at a time rather than one class at a time, starting with the largest
+  // methods. A thread that finishes its method takes the next one, so threads only run out of
+  // work when the methods left are small, rather than one thread compiling a large class alone at
+  // the end.
+  if (oat_code_reuse_.get() != NULL) {
+    oat_code_reuse_->AddDexFile(dex_file, Runtime::Current()->GetClassLinker());
+  }
+  class_methods_to_compile_.resize(dex_file.NumClassDefs());
+  context.ForAll(0, dex_file.NumClassDefs(), CompilerDriver::CollectMethodsToCompile,
+                 thread_count_);
+  for (size_t i = 0; i < class_methods_to_compile_.size(); ++i) {
+    methods_to_compile_.insert(methods_to_compile_.end(), class_methods_to_compile_[i].begin(),
+                               class_methods_to_compile_[i].end());
+  }
+  class_methods_to_compile_.clear();
+  std::sort(methods_to_compile_.begin(), methods_to_compile_.end(),
+            MethodToCompile::CompileBefore);
+  context.ForAll(0, methods_to_compile_.size(), CompilerDriver::CompileMethodToCompile,
+                 thread_count_, 1);
+  methods_to_compile_.clear();
 }
 
 void CompilerDriver::CompileMethod(const DexFile::CodeItem* code_item, uint32_t access_flags,
@@ -2278,39 +2689,51 @@ void CompilerDriver::CompileMethod(const DexFile::CodeItem* code_item, uint32_t
                                    const DexFile& dex_file,
                                    DexToDexCompilationLevel dex_to_dex_compilation_level) {
   CompiledMethod* compiled_method = NULL;
+  const char* outcome = NULL;
+  MethodCompileStats* stats = GetTls()->GetMethodCompileStats();
+  stats->Reset();
   uint64_t start_ns = NanoTime();
 
   if ((access_flags & kAccNative) != 0) {
     compiled_method = (*jni_compiler_)(*this, access_flags, method_idx, dex_file);
     CHECK(compiled_method != NULL);
+    outcome = "jni";
   } else if ((access_flags & kAccAbstract) != 0) {
   } else {
     MethodReference method_ref(&dex_file, method_idx);
     bool compile = verifier::MethodVerifier::IsCandidateForCompilation(method_ref, access_flags);
 
     if (compile) {
-      CompilerFn compiler = compiler_;
 #ifdef ART_SEA_IR_MODE
-      bool use_sea = Runtime::Current()->IsSeaIRMode();
-      use_sea = use_sea &&
-          (std::string::npos != PrettyMethod(method_idx, dex_file).find("fibonacci"));
-      if (use_sea) {
-        compiler = sea_ir_compiler_;
-        LOG(INFO) << "Using SEA IR to compile..." << std::endl;
+      // Sea IR is the optimizing tier for the methods a profile found hot. It declines the
+      // methods it cannot handle, which then take the default backend.
+      if (Runtime::Current()->IsSeaIRMode() && IsHotMethod(method_idx, dex_file)) {
+        compiled_method = (*sea_ir_compiler_)(*this, code_item, access_flags, invoke_type,
+                                              class_def_idx, method_idx, class_loader, dex_file);
       }
 #endif
       // NOTE: if compiler declines to compile this method, it will return NULL.
-      compiled_method = (*compiler)(*this, code_item, access_flags, invoke_type, class_def_idx,
-                                    method_idx, class_loader, dex_file);
+      if (compiled_method == NULL) {
+        compiled_method = (*compiler_)(*this, code_item, access_flags, invoke_type, class_def_idx,
+                                       method_idx, class_loader, dex_file);
+      }
+      outcome = (compiled_method != NULL) ? "compiled" : "deferred";
     } else if (dex_to_dex_compilation_level != kDontDexToDexCompile) {
       // TODO: add a mode to disable DEX-to-DEX compilation ?
       (*dex_to_dex_compiler_)(*this, code_item, access_flags,
                               invoke_type, class_def_idx,
                               method_idx, class_loader, dex_file,
                               dex_to_dex_compilation_level);
+      outcome = "dex-to-dex";
+    } else {
+      outcome = "interpreted";
     }
   }
   uint64_t duration_ns = NanoTime() - start_ns;
+  if (method_report_enabled_ && outcome != NULL) {
+    RecordMethodReport(dex_file, method_idx, code_item, outcome, duration_ns, *stats,
+                       compiled_method);
+  }
 #ifdef ART_USE_PORTABLE_COMPILER
   const uint64_t kWarnMilliSeconds = 1000;
 #else
@@ -2385,6 +2808,10 @@ CompiledMethod* CompilerDriver::GetCompiledMethod(MethodReference ref) const {
   return it->second;
 }
 
+void CompilerDriver::SetInputOatFile(const OatFile* oat_file) {
+  oat_code_reuse_.reset(new OatCodeReuse(oat_file));
+}
+
 void CompilerDriver::SetBitcodeFileName(std::string const& filename) {
   typedef void (*SetBitcodeFileNameFn)(CompilerDriver&, std::string const&);
 
@@ -2394,6 +2821,46 @@ void CompilerDriver::SetBitcodeFileName(std::string const& filename) {
   set_bitcode_file_name(*this, filename);
 }
 
+void CompilerDriver::SetCodeOrder(const std::vector<std::string>& code_order) {
+  code_order_.clear();
+  for (size_t i = 0; i < code_order.size(); ++i) {
+    if (code_order_.find(code_order[i]) == code_order_.end()) {
+      code_order_.Put(code_order[i], i);
+    }
+  }
+}
+
+bool CompilerDriver::GetCodeOrder(uint32_t method_idx, const DexFile& dex_file,
+                                  size_t* position) const {
+  if (code_order_.empty()) {
+    return false;
+  }
+  SafeMap<std::string, size_t>::const_iterator it =
+      code_order_.find(PrettyMethod(method_idx, dex_file));
+  if (it == code_order_.end()) {
+    return false;
+  }
+  *position = it->second;
+  return true;
+}
+
+Runtime::CompilerFilter CompilerDriver::GetCompilerFilter(uint32_t method_idx,
+                                                          const DexFile& dex_file) const {
+  Runtime::CompilerFilter compiler_filter = Runtime::Current()->GetCompilerFilter();
+  if (hot_methods_.get() == NULL || compiler_filter == Runtime::kInterpretOnly) {
+    return compiler_filter;
+  }
+  if (IsHotMethod(method_idx, dex_file)) {
+    return Runtime::kSpeed;
+  }
+  return Runtime::kSpace;
+}
+
+bool CompilerDriver::IsHotMethod(uint32_t method_idx, const DexFile& dex_file) const {
+  return hot_methods_.get() != NULL &&
+      hot_methods_->find(PrettyMethod(method_idx, dex_file)) != hot_methods_->end();
+}
+
 
 void CompilerDriver::AddRequiresConstructorBarrier(Thread* self, const DexFile* dex_file,
                                                    uint16_t class_def_index) {
@@ -17,6 +17,7 @@
 #ifndef ART_COMPILER_DRIVER_COMPILER_DRIVER_H_
 #define ART_COMPILER_DRIVER_COMPILER_DRIVER_H_
 
+#include <iosfwd>
 #include <set>
 #include <string>
 #include <vector>
@@ -35,12 +36,15 @@
 #include "safe_map.h"
 #include "thread_pool.h"
 #include "utils/dedupe_set.h"
+#include "utils/swap_space.h"
 
 namespace art {
 
 class AOTCompilationStats;
 class ParallelCompilationManager;
 class DexCompilationUnit;
+class OatCodeReuse;
+class OatFile;
 class OatWriter;
 class TimingLogger;
 
@@ -68,6 +72,25 @@ enum DexToDexCompilationLevel {
 };
 
 // Thread-local storage compiler worker threads
+// What the compiler backend built for the last method it compiled on a thread, for the method
+// report. Counts the backend does not have are left zero.
+struct MethodCompileStats {
+  MethodCompileStats() { Reset(); }
+
+  void Reset() {
+    arena_bytes = 0;
+    num_blocks = 0;
+    num_mirs = 0;
+    num_lirs = 0;
+  }
+
+  // Arenas are only freed at the end of a method, so this is also the peak.
+  size_t arena_bytes;
+  size_t num_blocks;
+  size_t num_mirs;
+  size_t num_lirs;
+};
+
 class CompilerTls {
   public:
     CompilerTls() : llvm_info_(NULL) {}
@@ -77,8 +100,11 @@ class CompilerTls {
 
     void SetLLVMInfo(void* llvm_info) { llvm_info_ = llvm_info; }
 
+    MethodCompileStats* GetMethodCompileStats() { return &method_compile_stats_; }
+
   private:
     void* llvm_info_;
+    MethodCompileStats method_compile_stats_;
 };
 
 class CompilerDriver {
@@ -89,10 +115,12 @@ class CompilerDriver {
   // "image" should be true if image specific optimizations should be
   // enabled.  "image_classes" lets the compiler know what classes it
   // can assume will be in the image, with NULL implying all available
-  // classes.
+  // classes. "swap_space", if not NULL, is where the compiled code and tables are kept, the
+  // driver takes ownership of it.
   explicit CompilerDriver(CompilerBackend compiler_backend, InstructionSet instruction_set,
                           bool image, DescriptorSet* image_classes,
-                          size_t thread_count, bool dump_stats);
+                          size_t thread_count, bool dump_stats,
+                          SwapSpace* swap_space = NULL);
 
   ~CompilerDriver();
 
@@ -104,6 +132,12 @@ class CompilerDriver {
   void CompileOne(const mirror::ArtMethod* method, base::TimingLogger& timings)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Compile a single method of a class that the running runtime has already loaded and
+  // verified, skipping the passes over the whole dex file that CompileOne runs first. Returns
+  // NULL if the method isn't compiled.
+  const CompiledMethod* CompileLoadedMethod(mirror::ArtMethod* method)
+      LOCKS_EXCLUDED(Locks::mutator_lock_);
+
   InstructionSet GetInstructionSet() const {
     return instruction_set_;
   }
@@ -138,6 +172,8 @@ class CompilerDriver {
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   const std::vector<uint8_t>* CreateQuickToInterpreterBridge() const
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Generate the Thumb2 thunk that relative calls to methods without compiled code branch to.
+  const std::vector<uint8_t>* CreateRelativeCallThunk() const;
 
   CompiledClass* GetCompiledClass(ClassReference ref) const
       LOCKS_EXCLUDED(compiled_classes_lock_);
@@ -169,6 +205,10 @@ class CompilerDriver {
                                               uint32_t type_idx)
      LOCKS_EXCLUDED(Locks::mutator_lock_);
 
+  // Can new instances of the type be bump allocated by compiled code? Computes the instance size.
+  bool ComputeNewInstanceInfo(const DexFile& dex_file, uint32_t type_idx, size_t* object_size)
+      LOCKS_EXCLUDED(Locks::mutator_lock_);
+
   // Can we fast path instance field access? Computes field's offset and volatility.
   bool ComputeInstanceFieldInfo(uint32_t field_idx, const DexCompilationUnit* mUnit,
                                 int& field_offset, bool& is_volatile, bool is_put)
@@ -181,13 +221,34 @@ class CompilerDriver {
                               bool& is_referrers_class, bool& is_volatile, bool is_put)
       LOCKS_EXCLUDED(Locks::mutator_lock_);
 
+  // Is the class declaring the static field initialized whenever code compiled now runs? True for
+  // the classes initialized in the image, whose static fields need no initialization check.
+  bool IsStaticFieldsClassInitializedInImage(uint32_t field_idx, const DexCompilationUnit* mUnit)
+      LOCKS_EXCLUDED(Locks::mutator_lock_);
+
   // Can we fastpath a interface, super class or virtual method call? Computes method's vtable
-  // index.
+  // index, or its interface method table index for an interface call.
   bool ComputeInvokeInfo(const DexCompilationUnit* mUnit, const uint32_t dex_pc,
                          InvokeType& type, MethodReference& target_method, int& vtable_idx,
                          uintptr_t& direct_code, uintptr_t& direct_method, bool update_stats)
       LOCKS_EXCLUDED(Locks::mutator_lock_);
 
+  // Returns the code of the method called through target_method, resolved as type, if it is
+  // declared in the compiling method's dex file and isn't native, abstract or synchronized.
+  // Returns NULL otherwise. Sets is_referrers_class when the compiling method's class declares it.
+  const DexFile::CodeItem* GetInlinableCodeItem(const DexCompilationUnit* mUnit,
+                                                const MethodReference& target_method,
+                                                InvokeType type, bool& is_referrers_class)
+      LOCKS_EXCLUDED(Locks::mutator_lock_);
+
+  // Can a virtual call that ComputeInvokeInfo didn't sharpen be made a direct call, guarded by a
+  // check that the receiver's vtable entry is still the resolved method? True for boot image
+  // methods that no loaded class overrides. Computes the method's code and Method* addresses.
+  bool ComputeGuardedDevirtualInfo(const DexCompilationUnit* mUnit,
+                                   const MethodReference& target_method,
+                                   uintptr_t& direct_code, uintptr_t& direct_method)
+      LOCKS_EXCLUDED(Locks::mutator_lock_, overridden_methods_lock_);
+
   bool IsSafeCast(const MethodReference& mr, uint32_t dex_pc);
 
   // Record patch information for later fix up.
@@ -207,9 +268,54 @@ class CompilerDriver {
                       InvokeType target_invoke_type,
                       size_t literal_offset)
       LOCKS_EXCLUDED(compiled_methods_lock_);
+  // Records a bl at literal_offset whose displacement the OatWriter fills in.
+  void AddRelativeCallPatch(const DexFile* dex_file,
+                            uint16_t referrer_class_def_idx,
+                            uint32_t referrer_method_idx,
+                            InvokeType referrer_invoke_type,
+                            uint32_t target_method_idx,
+                            InvokeType target_invoke_type,
+                            size_t literal_offset)
+      LOCKS_EXCLUDED(compiled_methods_lock_);
 
   void SetBitcodeFileName(std::string const& filename);
 
+  // Takes ownership of the PrettyMethod names of the methods a profile found hot, see
+  // GetCompilerFilter.
+  void SetHotMethods(std::set<std::string>* hot_methods) {
+    hot_methods_.reset(hot_methods);
+  }
+
+  // Takes the PrettyMethod names of the methods whose code the OatWriter lays out first, in order,
+  // so that the code run most often shares pages and cache lines.
+  void SetCodeOrder(const std::vector<std::string>& code_order);
+
+  bool HasCodeOrder() const {
+    return !code_order_.empty();
+  }
+
+  // Returns whether the method is in the code order, and if so sets its position.
+  bool GetCodeOrder(uint32_t method_idx, const DexFile& dex_file, size_t* position) const;
+
+  // Returns the runtime's compiler filter, or with a profile kSpeed for the hot methods and
+  // kSpace for the others so that code the profile never saw stays small.
+  Runtime::CompilerFilter GetCompilerFilter(uint32_t method_idx, const DexFile& dex_file) const;
+
+  // Returns whether the method is among the hot methods of the profile, if there is one.
+  bool IsHotMethod(uint32_t method_idx, const DexFile& dex_file) const;
+
+  // Takes ownership of an oat file compiled from a previous version of the dex files against the
+  // current boot image. The code of its unchanged classes is reused instead of compiled again.
+  void SetInputOatFile(const OatFile* oat_file);
+
+  // Records the time, memory and size of the compilation of every method for DumpMethodReport.
+  void EnableMethodReport() {
+    method_report_enabled_ = true;
+  }
+
+  // Writes the method report as CSV with a header line, slowest method first.
+  void DumpMethodReport(std::ostream& os) const LOCKS_EXCLUDED(method_report_lock_);
+
   bool GetSupportBootImageFixup() const {
     return support_boot_image_fixup_;
   }
@@ -218,6 +324,59 @@ class CompilerDriver {
     support_boot_image_fixup_ = support_boot_image_fixup;
   }
 
+  // Whether the quick backend polls for suspension with a load that faults when a suspend is
+  // requested rather than with an explicit test and branch. Only Thumb2 code supports it.
+  bool GetImplicitSuspendChecks() const {
+    return implicit_suspend_checks_;
+  }
+
+  void SetImplicitSuspendChecks(bool implicit_suspend_checks) {
+    implicit_suspend_checks_ = implicit_suspend_checks;
+  }
+
+  // Whether the quick backend leaves the null checks of field and array length accesses to the
+  // accesses themselves, which fault in the unmapped first page. Only Thumb2 code supports it.
+  bool GetImplicitNullChecks() const {
+    return implicit_null_checks_;
+  }
+
+  void SetImplicitNullChecks(bool implicit_null_checks) {
+    implicit_null_checks_ = implicit_null_checks;
+  }
+
+  // Whether the quick backend checks for stack overflow in method prologues by probing below the
+  // new frame, which faults in the guard of the stack, rather than comparing against the stack
+  // end. Only Thumb2 code supports it.
+  bool GetImplicitStackOverflowChecks() const {
+    return implicit_stack_overflow_checks_;
+  }
+
+  void SetImplicitStackOverflowChecks(bool implicit_stack_overflow_checks) {
+    implicit_stack_overflow_checks_ = implicit_stack_overflow_checks;
+  }
+
+  // Whether the quick backend calls the method entry and exit hooks of the thread, when it has
+  // them, in method prologues and epilogues so that method tracing needs no entry and exit stubs.
+  // Only Thumb2 code supports it.
+  bool GetMethodHooks() const {
+    return method_hooks_;
+  }
+
+  void SetMethodHooks(bool method_hooks) {
+    method_hooks_ = method_hooks;
+  }
+
+  // Whether the quick backend calls the direct methods of the caller's own class with a bl that
+  // the OatWriter patches, rather than through the Method*'s entry point. Only Thumb2 code of
+  // an app's oat file supports it.
+  bool GetSupportRelativeCalls() const {
+    return support_relative_calls_;
+  }
+
+  void SetSupportRelativeCalls(bool support_relative_calls) {
+    support_relative_calls_ = support_relative_calls;
+  }
+
   ArenaPool& GetArenaPool() {
     return arena_pool_;
   }
@@ -306,6 +465,9 @@ class CompilerDriver {
   const std::vector<const PatchInformation*>& GetMethodsToPatch() const {
     return methods_to_patch_;
   }
+  const std::vector<const PatchInformation*>& GetRelativeCallsToPatch() const {
+    return relative_calls_to_patch_;
+  }
 
   // Checks if class specified by type_idx is one of the image_classes_
   bool IsImageClass(const char* descriptor) const;
@@ -313,12 +475,17 @@ class CompilerDriver {
   void RecordClassStatus(ClassReference ref, mirror::Class::Status status)
       LOCKS_EXCLUDED(compiled_classes_lock_);
 
-  std::vector<uint8_t>* DeduplicateCode(const std::vector<uint8_t>& code);
-  std::vector<uint8_t>* DeduplicateMappingTable(const std::vector<uint8_t>& code);
-  std::vector<uint8_t>* DeduplicateVMapTable(const std::vector<uint8_t>& code);
-  std::vector<uint8_t>* DeduplicateGCMap(const std::vector<uint8_t>& code);
+  SwapVector<uint8_t>* DeduplicateCode(const std::vector<uint8_t>& code);
+  SwapVector<uint8_t>* DeduplicateMappingTable(const std::vector<uint8_t>& code);
+  SwapVector<uint8_t>* DeduplicateVMapTable(const std::vector<uint8_t>& code);
+  SwapVector<uint8_t>* DeduplicateGCMap(const std::vector<uint8_t>& code);
 
  private:
+  // Whether a class that was loaded when first called overrides the virtual method.
+  bool IsOverridden(const mirror::ArtMethod* method)
+      LOCKS_EXCLUDED(overridden_methods_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   // Compute constant code and method pointers when possible
   void GetCodeAndMethodForDirectCall(InvokeType type, InvokeType sharp_type,
                                      mirror::Class* referrer_class,
@@ -327,6 +494,11 @@ class CompilerDriver {
                                      bool update_stats)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Whether a call to method can be a relative call, see GetSupportRelativeCalls.
+  bool CanCallRelative(InvokeType invoke_type, mirror::Class* referrer_class,
+                       mirror::ArtMethod* method, const MethodReference& target_method) const
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   void PreCompile(jobject class_loader, const std::vector<const DexFile*>& dex_files,
                   ThreadPool& thread_pool, base::TimingLogger& timings)
       LOCKS_EXCLUDED(Locks::mutator_lock_);
@@ -371,11 +543,51 @@ class CompilerDriver {
                      DexToDexCompilationLevel dex_to_dex_compilation_level)
       LOCKS_EXCLUDED(compiled_methods_lock_);
 
-  static void CompileClass(const ParallelCompilationManager* context, size_t class_def_index)
+  void RecordMethodReport(const DexFile& dex_file, uint32_t method_idx,
+                          const DexFile::CodeItem* code_item, const char* outcome,
+                          uint64_t duration_ns, const MethodCompileStats& stats,
+                          const CompiledMethod* compiled_method)
+      LOCKS_EXCLUDED(method_report_lock_);
+
+  // Records the methods of a class def that CompileDexFile compiles.
+  static void CollectMethodsToCompile(const ParallelCompilationManager* context,
+                                      size_t class_def_index)
+      LOCKS_EXCLUDED(Locks::mutator_lock_);
+
+  // Compiles the index-th method of methods_to_compile_.
+  static void CompileMethodToCompile(const ParallelCompilationManager* context, size_t index)
       LOCKS_EXCLUDED(Locks::mutator_lock_);
 
+  // A method of the dex file being compiled, with what CompileMethod needs to know about it.
+  struct MethodToCompile {
+    const DexFile::CodeItem* code_item;
+    uint32_t access_flags;
+    InvokeType invoke_type;
+    uint16_t class_def_idx;
+    uint32_t method_idx;
+    // The index of the method in its class def, direct methods first, as used by the oat file.
+    uint32_t class_def_method_index;
+    DexToDexCompilationLevel dex_to_dex_compilation_level;
+
+    // Estimated cost of compiling the method.
+    uint32_t Cost() const {
+      return code_item == NULL ? 0 : code_item->insns_size_in_code_units_;
+    }
+
+    // Orders methods most expensive first, and then in dex file order.
+    static bool CompileBefore(const MethodToCompile& lhs, const MethodToCompile& rhs);
+  };
+
+  // The methods of each class def of the dex file being compiled, each class def's entry is only
+  // written by the thread collecting its methods.
+  std::vector<std::vector<MethodToCompile> > class_methods_to_compile_;
+
+  // The methods of the dex file being compiled, most expensive first.
+  std::vector<MethodToCompile> methods_to_compile_;
+
   std::vector<const PatchInformation*> code_to_patch_;
   std::vector<const PatchInformation*> methods_to_patch_;
+  std::vector<const PatchInformation*> relative_calls_to_patch_;
 
   CompilerBackend compiler_backend_;
 
@@ -395,6 +607,11 @@ class CompilerDriver {
   mutable Mutex compiled_methods_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   MethodTable compiled_methods_ GUARDED_BY(compiled_methods_lock_);
 
+  // Methods that a loaded class overrides, computed on the first guarded devirtualization.
+  Mutex overridden_methods_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  UniquePtr<std::set<const mirror::ArtMethod*> > overridden_methods_
+      GUARDED_BY(overridden_methods_lock_);
+
   const bool image_;
 
   // If image_ is true, specifies the classes that will be included in
@@ -454,6 +671,43 @@ class CompilerDriver {
 
   bool support_boot_image_fixup_;
 
+  bool support_relative_calls_;
+
+  bool implicit_suspend_checks_;
+
+  bool implicit_null_checks_;
+
+  bool implicit_stack_overflow_checks_;
+
+  bool method_hooks_;
+
+  // NULL without a profile.
+  UniquePtr<std::set<std::string> > hot_methods_;
+
+  // The position of each method in the code order, empty without a profile.
+  SafeMap<std::string, size_t> code_order_;
+
+  // NULL without an input oat file.
+  UniquePtr<OatCodeReuse> oat_code_reuse_;
+
+  // A line of the method report.
+  struct MethodReportEntry {
+    const DexFile* dex_file;
+    uint32_t method_idx;
+    // How the method was handled: compiled, deferred, jni, reused, dex-to-dex or interpreted.
+    const char* outcome;
+    uint32_t code_units;
+    uint64_t duration_ns;
+    MethodCompileStats stats;
+    size_t code_bytes;
+
+    static bool SlowerFirst(const MethodReportEntry* lhs, const MethodReportEntry* rhs);
+  };
+
+  bool method_report_enabled_;
+  mutable Mutex method_report_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  std::vector<MethodReportEntry> method_report_ GUARDED_BY(method_report_lock_);
+
   // DeDuplication data structures, these own the corresponding byte arrays.
   class DedupeHashFunc {
    public:
@@ -475,10 +729,19 @@ class CompilerDriver {
       return hash;
     }
   };
-  DedupeSet<std::vector<uint8_t>, size_t, DedupeHashFunc> dedupe_code_;
-  DedupeSet<std::vector<uint8_t>, size_t, DedupeHashFunc> dedupe_mapping_table_;
-  DedupeSet<std::vector<uint8_t>, size_t, DedupeHashFunc> dedupe_vmap_table_;
-  DedupeSet<std::vector<uint8_t>, size_t, DedupeHashFunc> dedupe_gc_map_;
+  // NULL unless the compiled code and tables are kept in a swap file. Declared before the dedupe
+  // sets that allocate from it.
+  UniquePtr<SwapSpace> swap_space_;
+
+  // Every compiler thread adds to these, so they are sharded to keep the threads from queuing on
+  // a single lock.
+  static const size_t kDedupeShards = 16;
+  typedef DedupeSet<std::vector<uint8_t>, SwapVector<uint8_t>, size_t, DedupeHashFunc,
+                    kDedupeShards> ByteArrayDedupeSet;
+  ByteArrayDedupeSet dedupe_code_;
+  ByteArrayDedupeSet dedupe_mapping_table_;
+  ByteArrayDedupeSet dedupe_vmap_table_;
+  ByteArrayDedupeSet dedupe_gc_map_;
 
   DISALLOW_COPY_AND_ASSIGN(CompilerDriver);
 };
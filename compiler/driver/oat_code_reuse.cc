@@ -0,0 +1,479 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "oat_code_reuse.h"
+
+#include <string.h>
+
+#include <map>
+#include <string>
+
+#include "base/stl_util.h"
+#include "class_linker.h"
+#include "compiled_method.h"
+#include "driver/compiler_driver.h"
+#include "dex_instruction.h"
+#include "gc_map.h"
+#include "leb128.h"
+#include "thread.h"
+
+namespace art {
+
+enum TypeState {
+  kTypeUnchanged,
+  kTypeChanged,
+  kTypeInProgress,
+};
+
+static bool SameString(const DexFile& dex_file, const DexFile& old_dex_file, uint32_t string_idx) {
+  return strcmp(dex_file.StringDataByIdx(string_idx),
+                old_dex_file.StringDataByIdx(string_idx)) == 0;
+}
+
+static bool SameType(const DexFile& dex_file, uint32_t type_idx,
+                     const DexFile& old_dex_file, uint32_t old_type_idx) {
+  if (type_idx == DexFile::kDexNoIndex16 || old_type_idx == DexFile::kDexNoIndex16) {
+    return type_idx == old_type_idx;
+  }
+  return strcmp(dex_file.StringByTypeIdx(type_idx),
+                old_dex_file.StringByTypeIdx(old_type_idx)) == 0;
+}
+
+static bool SameField(const DexFile& dex_file, uint32_t field_idx,
+                      const DexFile& old_dex_file, uint32_t old_field_idx) {
+  const DexFile::FieldId& field_id = dex_file.GetFieldId(field_idx);
+  const DexFile::FieldId& old_field_id = old_dex_file.GetFieldId(old_field_idx);
+  return strcmp(dex_file.GetFieldName(field_id), old_dex_file.GetFieldName(old_field_id)) == 0 &&
+      strcmp(dex_file.GetFieldTypeDescriptor(field_id),
+             old_dex_file.GetFieldTypeDescriptor(old_field_id)) == 0 &&
+      strcmp(dex_file.GetFieldDeclaringClassDescriptor(field_id),
+             old_dex_file.GetFieldDeclaringClassDescriptor(old_field_id)) == 0;
+}
+
+static bool SameMethod(const DexFile& dex_file, uint32_t method_idx,
+                       const DexFile& old_dex_file, uint32_t old_method_idx) {
+  const DexFile::MethodId& method_id = dex_file.GetMethodId(method_idx);
+  const DexFile::MethodId& old_method_id = old_dex_file.GetMethodId(old_method_idx);
+  return strcmp(dex_file.GetMethodName(method_id),
+                old_dex_file.GetMethodName(old_method_id)) == 0 &&
+      dex_file.GetMethodSignature(method_id) == old_dex_file.GetMethodSignature(old_method_id) &&
+      strcmp(dex_file.GetMethodDeclaringClassDescriptor(method_id),
+             old_dex_file.GetMethodDeclaringClassDescriptor(old_method_id)) == 0;
+}
+
+// The code is unchanged if its instructions are identical and every index they use names the same
+// string, type, field or method in both dex files, so that the old code's dex cache accesses and
+// the dex pcs of its maps still hold.
+static bool IsCodeItemUnchanged(const DexFile& dex_file, const DexFile::CodeItem* code_item,
+                                const DexFile& old_dex_file,
+                                const DexFile::CodeItem* old_code_item) {
+  if (code_item == NULL || old_code_item == NULL) {
+    return code_item == old_code_item;
+  }
+  if (code_item->registers_size_ != old_code_item->registers_size_ ||
+      code_item->ins_size_ != old_code_item->ins_size_ ||
+      code_item->outs_size_ != old_code_item->outs_size_ ||
+      code_item->tries_size_ != old_code_item->tries_size_ ||
+      code_item->insns_size_in_code_units_ != old_code_item->insns_size_in_code_units_) {
+    return false;
+  }
+  if (memcmp(code_item->insns_, old_code_item->insns_,
+             code_item->insns_size_in_code_units_ * sizeof(uint16_t)) != 0) {
+    return false;
+  }
+  size_t dex_pc = 0;
+  while (dex_pc < code_item->insns_size_in_code_units_) {
+    const Instruction* inst = Instruction::At(code_item->insns_ + dex_pc);
+    switch (inst->GetVerifyTypeArgumentB()) {
+      case Instruction::kVerifyRegBString:
+        if (!SameString(dex_file, old_dex_file, inst->VRegB())) {
+          return false;
+        }
+        break;
+      case Instruction::kVerifyRegBType:
+      case Instruction::kVerifyRegBNewInstance:
+        if (!SameType(dex_file, inst->VRegB(), old_dex_file, inst->VRegB())) {
+          return false;
+        }
+        break;
+      case Instruction::kVerifyRegBField:
+        if (!SameField(dex_file, inst->VRegB(), old_dex_file, inst->VRegB())) {
+          return false;
+        }
+        break;
+      case Instruction::kVerifyRegBMethod:
+        if (!SameMethod(dex_file, inst->VRegB(), old_dex_file, inst->VRegB())) {
+          return false;
+        }
+        break;
+      default:
+        break;
+    }
+    switch (inst->GetVerifyTypeArgumentC()) {
+      case Instruction::kVerifyRegCType:
+      case Instruction::kVerifyRegCNewArray:
+        if (!SameType(dex_file, inst->VRegC(), old_dex_file, inst->VRegC())) {
+          return false;
+        }
+        break;
+      case Instruction::kVerifyRegCField:
+        if (!SameField(dex_file, inst->VRegC(), old_dex_file, inst->VRegC())) {
+          return false;
+        }
+        break;
+      default:
+        break;
+    }
+    dex_pc += inst->SizeInCodeUnits();
+  }
+  for (uint32_t i = 0; i < code_item->tries_size_; ++i) {
+    const DexFile::TryItem* try_item = DexFile::GetTryItems(*code_item, i);
+    const DexFile::TryItem* old_try_item = DexFile::GetTryItems(*old_code_item, i);
+    if (try_item->start_addr_ != old_try_item->start_addr_ ||
+        try_item->insn_count_ != old_try_item->insn_count_) {
+      return false;
+    }
+    CatchHandlerIterator it(*code_item, *try_item);
+    CatchHandlerIterator old_it(*old_code_item, *old_try_item);
+    for (; it.HasNext() && old_it.HasNext(); it.Next(), old_it.Next()) {
+      if (it.GetHandlerAddress() != old_it.GetHandlerAddress() ||
+          it.GetHandlerTypeIndex() != old_it.GetHandlerTypeIndex() ||
+          !SameType(dex_file, it.GetHandlerTypeIndex(),
+                    old_dex_file, old_it.GetHandlerTypeIndex())) {
+        return false;
+      }
+    }
+    if (it.HasNext() || old_it.HasNext()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool IsClassDefUnchanged(const DexFile& dex_file, const DexFile::ClassDef& class_def,
+                                const DexFile& old_dex_file,
+                                const DexFile::ClassDef& old_class_def) {
+  if (class_def.access_flags_ != old_class_def.access_flags_ ||
+      !SameType(dex_file, class_def.superclass_idx_, old_dex_file, old_class_def.superclass_idx_)) {
+    return false;
+  }
+  const DexFile::TypeList* interfaces = dex_file.GetInterfacesList(class_def);
+  const DexFile::TypeList* old_interfaces = old_dex_file.GetInterfacesList(old_class_def);
+  size_t num_interfaces = (interfaces == NULL) ? 0 : interfaces->Size();
+  size_t old_num_interfaces = (old_interfaces == NULL) ? 0 : old_interfaces->Size();
+  if (num_interfaces != old_num_interfaces) {
+    return false;
+  }
+  for (size_t i = 0; i < num_interfaces; ++i) {
+    if (!SameType(dex_file, interfaces->GetTypeItem(i).type_idx_,
+                  old_dex_file, old_interfaces->GetTypeItem(i).type_idx_)) {
+      return false;
+    }
+  }
+  const byte* class_data = dex_file.GetClassData(class_def);
+  const byte* old_class_data = old_dex_file.GetClassData(old_class_def);
+  if (class_data == NULL || old_class_data == NULL) {
+    return class_data == old_class_data;
+  }
+  ClassDataItemIterator it(dex_file, class_data);
+  ClassDataItemIterator old_it(old_dex_file, old_class_data);
+  for (; it.HasNext() || old_it.HasNext(); it.Next(), old_it.Next()) {
+    if (it.HasNextStaticField() != old_it.HasNextStaticField() ||
+        it.HasNextInstanceField() != old_it.HasNextInstanceField() ||
+        it.HasNextDirectMethod() != old_it.HasNextDirectMethod() ||
+        it.HasNextVirtualMethod() != old_it.HasNextVirtualMethod() ||
+        it.GetMemberAccessFlags() != old_it.GetMemberAccessFlags()) {
+      return false;
+    }
+    if (it.HasNextStaticField() || it.HasNextInstanceField()) {
+      if (!SameField(dex_file, it.GetMemberIndex(), old_dex_file, old_it.GetMemberIndex())) {
+        return false;
+      }
+    } else if (!SameMethod(dex_file, it.GetMemberIndex(), old_dex_file, old_it.GetMemberIndex()) ||
+               !IsCodeItemUnchanged(dex_file, it.GetMethodCodeItem(),
+                                    old_dex_file, old_it.GetMethodCodeItem())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void AddMethodTypes(const DexFile& dex_file, const DexFile::MethodId& method_id,
+                           std::vector<const char*>& descriptors) {
+  const DexFile::ProtoId& proto_id = dex_file.GetProtoId(method_id.proto_idx_);
+  descriptors.push_back(dex_file.GetMethodDeclaringClassDescriptor(method_id));
+  descriptors.push_back(dex_file.GetReturnTypeDescriptor(proto_id));
+  const DexFile::TypeList* parameters = dex_file.GetProtoParameters(proto_id);
+  if (parameters != NULL) {
+    for (size_t i = 0; i < parameters->Size(); ++i) {
+      descriptors.push_back(dex_file.StringByTypeIdx(parameters->GetTypeItem(i).type_idx_));
+    }
+  }
+}
+
+static void AddFieldTypes(const DexFile& dex_file, const DexFile::FieldId& field_id,
+                          std::vector<const char*>& descriptors) {
+  descriptors.push_back(dex_file.GetFieldDeclaringClassDescriptor(field_id));
+  descriptors.push_back(dex_file.GetFieldTypeDescriptor(field_id));
+}
+
+// Collects the types whose layout the code of the class may depend on.
+static void CollectReferencedTypes(const DexFile& dex_file, const DexFile::ClassDef& class_def,
+                                   std::vector<const char*>& descriptors) {
+  if (class_def.superclass_idx_ != DexFile::kDexNoIndex16) {
+    descriptors.push_back(dex_file.StringByTypeIdx(class_def.superclass_idx_));
+  }
+  const DexFile::TypeList* interfaces = dex_file.GetInterfacesList(class_def);
+  if (interfaces != NULL) {
+    for (size_t i = 0; i < interfaces->Size(); ++i) {
+      descriptors.push_back(dex_file.StringByTypeIdx(interfaces->GetTypeItem(i).type_idx_));
+    }
+  }
+  const byte* class_data = dex_file.GetClassData(class_def);
+  if (class_data == NULL) {
+    return;
+  }
+  for (ClassDataItemIterator it(dex_file, class_data); it.HasNext(); it.Next()) {
+    if (it.HasNextStaticField() || it.HasNextInstanceField()) {
+      AddFieldTypes(dex_file, dex_file.GetFieldId(it.GetMemberIndex()), descriptors);
+      continue;
+    }
+    AddMethodTypes(dex_file, dex_file.GetMethodId(it.GetMemberIndex()), descriptors);
+    const DexFile::CodeItem* code_item = it.GetMethodCodeItem();
+    if (code_item == NULL) {
+      continue;
+    }
+    size_t dex_pc = 0;
+    while (dex_pc < code_item->insns_size_in_code_units_) {
+      const Instruction* inst = Instruction::At(code_item->insns_ + dex_pc);
+      switch (inst->GetVerifyTypeArgumentB()) {
+        case Instruction::kVerifyRegBType:
+        case Instruction::kVerifyRegBNewInstance:
+          descriptors.push_back(dex_file.StringByTypeIdx(inst->VRegB()));
+          break;
+        case Instruction::kVerifyRegBField:
+          AddFieldTypes(dex_file, dex_file.GetFieldId(inst->VRegB()), descriptors);
+          break;
+        case Instruction::kVerifyRegBMethod:
+          AddMethodTypes(dex_file, dex_file.GetMethodId(inst->VRegB()), descriptors);
+          break;
+        default:
+          break;
+      }
+      switch (inst->GetVerifyTypeArgumentC()) {
+        case Instruction::kVerifyRegCType:
+        case Instruction::kVerifyRegCNewArray:
+          descriptors.push_back(dex_file.StringByTypeIdx(inst->VRegC()));
+          break;
+        case Instruction::kVerifyRegCField:
+          AddFieldTypes(dex_file, dex_file.GetFieldId(inst->VRegC()), descriptors);
+          break;
+        default:
+          break;
+      }
+      dex_pc += inst->SizeInCodeUnits();
+    }
+    for (uint32_t i = 0; i < code_item->tries_size_; ++i) {
+      const DexFile::TryItem* try_item = DexFile::GetTryItems(*code_item, i);
+      for (CatchHandlerIterator handlers(*code_item, *try_item); handlers.HasNext();
+           handlers.Next()) {
+        if (handlers.GetHandlerTypeIndex() != DexFile::kDexNoIndex16) {
+          descriptors.push_back(dex_file.StringByTypeIdx(handlers.GetHandlerTypeIndex()));
+        }
+      }
+    }
+  }
+}
+
+// A type has the same layout as when the old oat file was compiled if it is a primitive or boot
+// class, or a class of this dex file that is unchanged along with its superclasses and interfaces.
+static bool IsTypeUnchanged(const DexFile& dex_file, const std::vector<uint16_t>& old_class_def_idx,
+                            ClassLinker* class_linker, const char* descriptor,
+                            std::map<std::string, TypeState>& type_states) {
+  while (*descriptor == '[') {
+    ++descriptor;
+  }
+  if (*descriptor != 'L') {
+    return true;
+  }
+  std::map<std::string, TypeState>::const_iterator it = type_states.find(descriptor);
+  if (it != type_states.end()) {
+    // A class in progress is part of a circular hierarchy and will fail to link anyway.
+    return it->second == kTypeUnchanged;
+  }
+  if (class_linker->IsInBootClassPath(descriptor)) {
+    type_states[descriptor] = kTypeUnchanged;
+    return true;
+  }
+  const DexFile::ClassDef* class_def = dex_file.FindClassDef(descriptor);
+  if (class_def == NULL ||
+      old_class_def_idx[dex_file.GetIndexForClassDef(*class_def)] == DexFile::kDexNoIndex16) {
+    type_states[descriptor] = kTypeChanged;
+    return false;
+  }
+  type_states[descriptor] = kTypeInProgress;
+  bool unchanged = true;
+  if (class_def->superclass_idx_ != DexFile::kDexNoIndex16) {
+    unchanged = IsTypeUnchanged(dex_file, old_class_def_idx, class_linker,
+                                dex_file.StringByTypeIdx(class_def->superclass_idx_),
+                                type_states);
+  }
+  const DexFile::TypeList* interfaces = dex_file.GetInterfacesList(*class_def);
+  if (interfaces != NULL) {
+    for (size_t i = 0; unchanged && i < interfaces->Size(); ++i) {
+      unchanged = IsTypeUnchanged(dex_file, old_class_def_idx, class_linker,
+                                  dex_file.StringByTypeIdx(interfaces->GetTypeItem(i).type_idx_),
+                                  type_states);
+    }
+  }
+  type_states[descriptor] = unchanged ? kTypeUnchanged : kTypeChanged;
+  return unchanged;
+}
+
+OatCodeReuse::OatCodeReuse(const OatFile* oat_file)
+    : oat_file_(oat_file),
+      lock_("oat code reuse lock") {
+  CHECK(oat_file != NULL);
+}
+
+OatCodeReuse::~OatCodeReuse() {
+  MutexLock mu(Thread::Current(), lock_);
+  STLDeleteValues(&dex_files_);
+}
+
+void OatCodeReuse::AddDexFile(const DexFile& dex_file, ClassLinker* class_linker) {
+  UniquePtr<ReusableDexFile> reusable_dex_file(new ReusableDexFile);
+  reusable_dex_file->oat_dex_file = NULL;
+  std::vector<const OatFile::OatDexFile*> oat_dex_files = oat_file_->GetOatDexFiles();
+  for (size_t i = 0; i < oat_dex_files.size(); ++i) {
+    if (oat_dex_files[i]->GetDexFileLocation() == dex_file.GetLocation()) {
+      reusable_dex_file->oat_dex_file = oat_dex_files[i];
+      reusable_dex_file->old_dex_file.reset(oat_dex_files[i]->OpenDexFile());
+      break;
+    }
+  }
+  size_t num_class_defs = dex_file.NumClassDefs();
+  std::vector<uint16_t>& old_class_def_idx = reusable_dex_file->old_class_def_idx;
+  old_class_def_idx.assign(num_class_defs, DexFile::kDexNoIndex16);
+  reusable_dex_file->reusable.assign(num_class_defs, false);
+  size_t num_reusable = 0;
+  const DexFile* old_dex_file = reusable_dex_file->old_dex_file.get();
+  if (old_dex_file != NULL) {
+    for (size_t i = 0; i < num_class_defs; ++i) {
+      const DexFile::ClassDef& class_def = dex_file.GetClassDef(i);
+      const DexFile::ClassDef* old_class_def =
+          old_dex_file->FindClassDef(dex_file.GetClassDescriptor(class_def));
+      if (old_class_def != NULL &&
+          IsClassDefUnchanged(dex_file, class_def, *old_dex_file, *old_class_def)) {
+        old_class_def_idx[i] = old_dex_file->GetIndexForClassDef(*old_class_def);
+      }
+    }
+    std::map<std::string, TypeState> type_states;
+    std::vector<const char*> descriptors;
+    for (size_t i = 0; i < num_class_defs; ++i) {
+      if (old_class_def_idx[i] == DexFile::kDexNoIndex16) {
+        continue;
+      }
+      descriptors.clear();
+      CollectReferencedTypes(dex_file, dex_file.GetClassDef(i), descriptors);
+      bool reusable = true;
+      for (size_t j = 0; reusable && j < descriptors.size(); ++j) {
+        reusable = IsTypeUnchanged(dex_file, old_class_def_idx, class_linker, descriptors[j],
+                                   type_states);
+      }
+      if (reusable) {
+        reusable_dex_file->reusable[i] = true;
+        ++num_reusable;
+      }
+    }
+  }
+  VLOG(compiler) << "Reusing the code of " << num_reusable << " of " << num_class_defs
+                 << " classes of " << dex_file.GetLocation() << " from "
+                 << oat_file_->GetLocation();
+  MutexLock mu(Thread::Current(), lock_);
+  dex_files_.Put(&dex_file, reusable_dex_file.release());
+}
+
+static size_t MappingTableSize(const uint8_t* table) {
+  const uint8_t* end = table;
+  uint32_t total_size = DecodeUnsignedLeb128(&end);
+  DecodeUnsignedLeb128(&end);  // pc_to_dex_size, part of total_size.
+  for (uint32_t i = 0; i < total_size; ++i) {
+    DecodeUnsignedLeb128(&end);  // Native pc delta.
+    DecodeSignedLeb128(&end);  // Dex pc delta.
+  }
+  return end - table;
+}
+
+static size_t VmapTableSize(const uint8_t* table) {
+  const uint8_t* end = table;
+  uint32_t size = DecodeUnsignedLeb128(&end);
+  for (uint32_t i = 0; i < size; ++i) {
+    DecodeUnsignedLeb128(&end);
+  }
+  return end - table;
+}
+
+CompiledMethod* OatCodeReuse::GetReusableMethod(CompilerDriver& driver, const DexFile& dex_file,
+                                                uint16_t class_def_idx,
+                                                size_t class_def_method_index) const {
+  const ReusableDexFile* reusable_dex_file;
+  {
+    MutexLock mu(Thread::Current(), lock_);
+    SafeMap<const DexFile*, ReusableDexFile*>::const_iterator it = dex_files_.find(&dex_file);
+    if (it == dex_files_.end()) {
+      return NULL;
+    }
+    reusable_dex_file = it->second;
+  }
+  if (!reusable_dex_file->reusable[class_def_idx]) {
+    return NULL;
+  }
+  UniquePtr<const OatFile::OatClass> oat_class(
+      reusable_dex_file->oat_dex_file->GetOatClass(
+          reusable_dex_file->old_class_def_idx[class_def_idx]));
+  const OatFile::OatMethod oat_method = oat_class->GetOatMethod(class_def_method_index);
+  uint32_t code_size = oat_method.GetCodeSize();
+  if (code_size == 0) {
+    return NULL;
+  }
+  // TODO: make this Thumb2 specific
+  const uint8_t* code =
+      reinterpret_cast<const uint8_t*>(reinterpret_cast<uintptr_t>(oat_method.GetCode()) & ~0x1);
+  std::vector<uint8_t> mapping_table;
+  const uint8_t* mapping_table_data = oat_method.GetMappingTable();
+  if (mapping_table_data != NULL) {
+    mapping_table.assign(mapping_table_data,
+                         mapping_table_data + MappingTableSize(mapping_table_data));
+  }
+  std::vector<uint8_t> vmap_table;
+  const uint8_t* vmap_table_data = oat_method.GetVmapTable();
+  if (vmap_table_data != NULL) {
+    vmap_table.assign(vmap_table_data, vmap_table_data + VmapTableSize(vmap_table_data));
+  }
+  std::vector<uint8_t> gc_map;
+  const uint8_t* gc_map_data = oat_method.GetNativeGcMap();
+  if (gc_map_data != NULL) {
+    gc_map.assign(gc_map_data,
+                  gc_map_data + NativePcOffsetToReferenceMap(gc_map_data).Size());
+  }
+  return new CompiledMethod(driver, driver.GetInstructionSet(),
+                            std::vector<uint8_t>(code, code + code_size),
+                            oat_method.GetFrameSizeInBytes(), oat_method.GetCoreSpillMask(),
+                            oat_method.GetFpSpillMask(), mapping_table, vmap_table, gc_map);
+}
+
+}  // namespace art
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_COMPILER_DRIVER_OAT_CODE_REUSE_H_
+#define ART_COMPILER_DRIVER_OAT_CODE_REUSE_H_
+
+#include <vector>
+
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "dex_file.h"
+#include "oat_file.h"
+#include "safe_map.h"
+#include "UniquePtr.h"
+
+namespace art {
+
+class ClassLinker;
+class CompiledMethod;
+class CompilerDriver;
+
+// Finds the methods of an app whose code in a previous oat file of the same app is still valid, so
+// that recompiling the app after a small change only compiles the classes that changed.
+//
+// Compiled code refers to the dex file by index (strings, types, fields and methods through the
+// dex cache) and bakes in the layout of the classes it uses (field offsets, vtable indices). A
+// class's code is therefore only reused when the class is unchanged, bit for bit up to the
+// indices, and every class it refers to has the same layout. Boot classes have the same layout
+// when the boot image is the one the old oat file was compiled against. App classes have the same
+// layout when they and their superclasses and interfaces are unchanged. Classes of other dex
+// files of the app are conservatively considered changed.
+class OatCodeReuse {
+ public:
+  // Takes ownership of the oat file, which must have been compiled against the current boot image.
+  explicit OatCodeReuse(const OatFile* oat_file);
+  ~OatCodeReuse();
+
+  // Compares the classes of the dex file with those of its copy in the old oat file. Must be
+  // called before GetReusableMethod for the dex file.
+  void AddDexFile(const DexFile& dex_file, ClassLinker* class_linker);
+
+  // Returns the old code of the method at the given index into the class definition, direct
+  // methods first, or NULL if the method has to be compiled.
+  CompiledMethod* GetReusableMethod(CompilerDriver& driver, const DexFile& dex_file,
+                                    uint16_t class_def_idx, size_t class_def_method_index) const;
+
+ private:
+  struct ReusableDexFile {
+    UniquePtr<const DexFile> old_dex_file;
+    const OatFile::OatDexFile* oat_dex_file;
+    // The index of the identical class definition in the old dex file, or kDexNoIndex16 if the
+    // class is not identical.
+    std::vector<uint16_t> old_class_def_idx;
+    // The classes whose old code may be reused, indexed by class definition.
+    std::vector<bool> reusable;
+  };
+
+  UniquePtr<const OatFile> oat_file_;
+
+  mutable Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  SafeMap<const DexFile*, ReusableDexFile*> dex_files_ GUARDED_BY(lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(OatCodeReuse);
+};
+
+}  // namespace art
+
+#endif  // ART_COMPILER_DRIVER_OAT_CODE_REUSE_H_
@@ -621,7 +621,7 @@ bool ElfWriterQuick::Write(OatWriter& oat_writer,
     return false;
   }
   BufferedOutputStream output_stream(new FileOutputStream(elf_file_));
-  if (!oat_writer.Write(output_stream)) {
+  if (!oat_writer.Write(output_stream) || !output_stream.Flush()) {
     PLOG(ERROR) << "Failed to write .rodata and .text for " << elf_file_->GetPath();
     return false;
   }
@@ -90,6 +90,12 @@ TEST_F(ImageTest, WriteRead) {
     ASSERT_TRUE(image_header.IsValid());
     ASSERT_GE(image_header.GetImageBitmapOffset(), sizeof(image_header));
     ASSERT_NE(0U, image_header.GetImageBitmapSize());
+    ASSERT_NE(0U, image_header.GetNumImageRelocations());
+    ASSERT_GE(image_header.GetRelocationsOffset(),
+              image_header.GetImageBitmapOffset() + image_header.GetImageBitmapSize());
+    ASSERT_EQ(static_cast<int64_t>(image_header.GetRelocationsOffset() +
+                                   image_header.GetRelocationsSize()),
+              file->GetLength());
 
     gc::Heap* heap = Runtime::Current()->GetHeap();
     ASSERT_EQ(1U, heap->GetContinuousSpaces().size());
@@ -185,6 +191,12 @@ TEST_F(ImageTest, ImageHeaderIsValid) {
                              oat_file_end);
     ASSERT_TRUE(image_header.IsValid());
 
+    image_header.Relocate(-static_cast<int32_t>(kPageSize));
+    EXPECT_EQ(reinterpret_cast<byte*>(image_begin - kPageSize), image_header.GetImageBegin());
+    EXPECT_EQ(reinterpret_cast<byte*>(oat_data_begin - kPageSize),
+              image_header.GetOatDataBegin());
+    EXPECT_EQ(reinterpret_cast<byte*>(oat_file_end - kPageSize), image_header.GetOatFileEnd());
+
     char* magic = const_cast<char*>(image_header.GetMagic());
     strcpy(magic, "");  // bad magic
     ASSERT_FALSE(image_header.IsValid());
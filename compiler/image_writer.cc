@@ -18,6 +18,7 @@
 
 #include <sys/stat.h>
 
+#include <algorithm>
 #include <vector>
 
 #include "base/logging.h"
@@ -42,6 +43,7 @@
 #include "mirror/class-inl.h"
 #include "mirror/class_loader.h"
 #include "mirror/dex_cache-inl.h"
+#include "mirror/iftable-inl.h"
 #include "mirror/object-inl.h"
 #include "mirror/object_array-inl.h"
 #include "oat.h"
@@ -152,6 +154,15 @@ bool ImageWriter::Write(const std::string& image_filename,
     return EXIT_FAILURE;
   }
 
+  // The relocation table follows the bitmap, see ImageHeader::GetRelocationsOffset.
+  std::sort(image_relocations_.begin(), image_relocations_.end());
+  std::vector<uint32_t> relocations(image_relocations_);
+  relocations.insert(relocations.end(), oat_relocations_.begin(), oat_relocations_.end());
+  uint32_t relocations_offset = image_header->GetImageBitmapOffset() +
+      RoundUp(image_header->GetImageBitmapSize(), sizeof(uint32_t));
+  image_header->SetRelocations(relocations_offset, image_relocations_.size(),
+                               oat_relocations_.size());
+
   // Write out the image.
   CHECK_EQ(image_end_, image_header->GetImageSize());
   if (!image_file->WriteFully(image_->Begin(), image_end_)) {
@@ -168,6 +179,13 @@ bool ImageWriter::Write(const std::string& image_filename,
     return false;
   }
 
+  if (!relocations.empty() &&
+      !image_file->Write(reinterpret_cast<char*>(&relocations[0]),
+                         image_header->GetRelocationsSize(), relocations_offset)) {
+    PLOG(ERROR) << "Failed to write image file " << image_filename;
+    return false;
+  }
+
   return true;
 }
 
@@ -343,6 +361,9 @@ void ImageWriter::CalculateNewObjectOffsetsCallback(Object* obj, void* arg) {
   DCHECK(obj != NULL);
   DCHECK(arg != NULL);
   ImageWriter* image_writer = reinterpret_cast<ImageWriter*>(arg);
+  if (image_writer->GetImageBin(obj) != image_writer->current_bin_) {
+    return;
+  }
 
   // if it is a string, we want to intern it if its not interned.
   if (obj->GetClass()->IsStringClass()) {
@@ -367,6 +388,12 @@ void ImageWriter::CalculateNewObjectOffsetsCallback(Object* obj, void* arg) {
   image_writer->AssignImageOffset(obj);
 }
 
+void ImageWriter::InternImageStringsCallback(Object* obj, void* arg) {
+  if (obj->GetClass()->IsStringClass()) {
+    reinterpret_cast<std::set<String*>*>(arg)->insert(obj->AsString()->Intern());
+  }
+}
+
 ObjectArray<Object>* ImageWriter::CreateImageRoots() const {
   Runtime* runtime = Runtime::Current();
   ClassLinker* class_linker = runtime->GetClassLinker();
@@ -380,6 +407,52 @@ ObjectArray<Object>* ImageWriter::CreateImageRoots() const {
   for (DexCache* dex_cache : dex_caches_) {
     dex_caches->Set(i++, dex_cache);
   }
+  SirtRef<ObjectArray<Object> > dex_caches_ref(self, dex_caches);
+
+  // Serialize the class table so that the runtime can insert the image classes without hashing
+  // their descriptors.
+  std::vector<Class*> classes;
+  std::vector<uint32_t> hashes;
+  class_linker->GetClassTableEntries(&classes, &hashes);
+  Class* class_array_class = class_linker->FindSystemClass("[Ljava/lang/Class;");
+  SirtRef<ObjectArray<Class> > class_table(self,
+      ObjectArray<Class>::Alloc(self, class_array_class, classes.size()));
+  SirtRef<mirror::IntArray> class_table_hashes(self, mirror::IntArray::Alloc(self, hashes.size()));
+  for (size_t j = 0; j < classes.size(); ++j) {
+    CHECK(classes[j]->GetClassLoader() == NULL) << PrettyClass(classes[j]);
+    class_table->Set(static_cast<int32_t>(j), classes[j]);
+    class_table_hashes->Set(static_cast<int32_t>(j), static_cast<int32_t>(hashes[j]));
+  }
+
+  // Serialize the interned strings as a String[] hash set, probed by hash code like
+  // InternTable::LookupImageString, so that the runtime finds them without any setup. Interning
+  // every string now gives the same representatives that CalculateNewObjectOffsetsCallback will
+  // keep, the oat location is allocated first so that it is among them.
+  SirtRef<String> oat_location(self,
+                               String::AllocFromModifiedUtf8(self,
+                                                             oat_file_->GetLocation().c_str()));
+  std::set<String*> interned_strings;
+  {
+    gc::Heap* heap = runtime->GetHeap();
+    WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
+    heap->FlushAllocStack();
+    heap->GetLiveBitmap()->Walk(InternImageStringsCallback, &interned_strings);
+  }
+  size_t intern_table_capacity = 16;
+  while (intern_table_capacity < interned_strings.size() * 2) {
+    intern_table_capacity *= 2;
+  }
+  Class* string_array_class = class_linker->FindSystemClass("[Ljava/lang/String;");
+  SirtRef<ObjectArray<String> > intern_table(self,
+      ObjectArray<String>::Alloc(self, string_array_class, intern_table_capacity));
+  const uint32_t intern_table_mask = intern_table_capacity - 1;
+  for (String* s : interned_strings) {
+    uint32_t slot = static_cast<uint32_t>(s->GetHashCode()) & intern_table_mask;
+    while (intern_table->Get(slot) != NULL) {
+      slot = (slot + 1) & intern_table_mask;
+    }
+    intern_table->Set(slot, s);
+  }
 
   // build an Object[] of the roots needed to restore the runtime
   SirtRef<ObjectArray<Object> >
@@ -393,22 +466,96 @@ ObjectArray<Object>* ImageWriter::CreateImageRoots() const {
                    runtime->GetCalleeSaveMethod(Runtime::kRefsOnly));
   image_roots->Set(ImageHeader::kRefsAndArgsSaveMethod,
                    runtime->GetCalleeSaveMethod(Runtime::kRefsAndArgs));
-  image_roots->Set(ImageHeader::kOatLocation,
-                   String::AllocFromModifiedUtf8(self, oat_file_->GetLocation().c_str()));
+  image_roots->Set(ImageHeader::kOatLocation, oat_location.get());
   image_roots->Set(ImageHeader::kDexCaches,
                    dex_caches);
   image_roots->Set(ImageHeader::kClassRoots,
                    class_linker->GetClassRoots());
+  image_roots->Set(ImageHeader::kClassTable, class_table.get());
+  image_roots->Set(ImageHeader::kClassTableHashes, class_table_hashes.get());
+  image_roots->Set(ImageHeader::kInternTable, intern_table.get());
   for (int i = 0; i < ImageHeader::kImageRootsMax; i++) {
     CHECK(image_roots->Get(i) != NULL);
   }
   return image_roots.get();
 }
 
+template <typename T>
+void ImageWriter::SetImageBins(const ObjectArray<T>* array, ImageBin bin) {
+  if (array == NULL) {
+    return;
+  }
+  SetImageBin(array, bin);
+  for (int32_t i = 0; i < array->GetLength(); ++i) {
+    SetImageBin(array->Get(i), bin);
+  }
+}
+
+void ImageWriter::ComputeStartupStringsCallback(Object* obj, void* arg) {
+  if (!obj->GetClass()->IsStringClass()) {
+    return;
+  }
+  ImageWriter* image_writer = reinterpret_cast<ImageWriter*>(arg);
+  String* string = obj->AsString();
+  if (image_writer->startup_strings_->find(string->ToModifiedUtf8()) !=
+      image_writer->startup_strings_->end()) {
+    // Equal strings are all in the same bin, as only one of them is kept in the image.
+    image_writer->SetImageBin(string, kBinHotClean);
+    image_writer->SetImageBin(string->GetCharArray(), kBinHotClean);
+  }
+}
+
+void ImageWriter::ComputeImageBins() {
+  if (startup_classes_.get() != NULL) {
+    ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+    for (const std::string& descriptor : *startup_classes_) {
+      Class* klass = class_linker->LookupClass(descriptor.c_str(), NULL);
+      if (klass == NULL) {
+        // Not a boot class, or pruned from the image.
+        continue;
+      }
+      // Initialization, static fields and locking write to the class.
+      SetImageBin(klass, kBinHotDirty);
+      // Initializing the class points the entry points of its static methods to their code.
+      SetImageBins(klass->GetDirectMethods(), klass->IsInitialized() ? kBinHotClean : kBinHotDirty);
+      SetImageBins(klass->GetVirtualMethods(), kBinHotClean);
+      SetImageBins(klass->GetIFields(), kBinHotClean);
+      SetImageBins(klass->GetSFields(), kBinHotClean);
+      SetImageBin(klass->GetVTable(), kBinHotClean);
+      SetImageBin(klass->GetImTable(), kBinHotClean);
+      mirror::IfTable* iftable = klass->GetIfTable();
+      if (iftable != NULL) {
+        SetImageBin(iftable, kBinHotClean);
+        for (size_t i = 0; i < iftable->Count(); ++i) {
+          SetImageBin(iftable->GetMethodArray(i), kBinHotClean);
+        }
+      }
+      // Resolution at runtime fills in the dex cache arrays.
+      DexCache* dex_cache = klass->GetDexCache();
+      if (dex_cache != NULL) {
+        SetImageBin(dex_cache, kBinHotDirty);
+        SetImageBin(dex_cache->GetStrings(), kBinHotDirty);
+        SetImageBin(dex_cache->GetResolvedTypes(), kBinHotDirty);
+        SetImageBin(dex_cache->GetResolvedMethods(), kBinHotDirty);
+        SetImageBin(dex_cache->GetResolvedFields(), kBinHotDirty);
+        SetImageBin(dex_cache->GetInitializedStaticStorage(), kBinHotDirty);
+      }
+    }
+  }
+  if (startup_strings_.get() != NULL) {
+    Thread* self = Thread::Current();
+    gc::Heap* heap = Runtime::Current()->GetHeap();
+    WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
+    heap->FlushAllocStack();
+    heap->GetLiveBitmap()->Walk(ComputeStartupStringsCallback, this);
+  }
+}
+
 void ImageWriter::CalculateNewObjectOffsets(size_t oat_loaded_size, size_t oat_data_offset) {
   CHECK_NE(0U, oat_loaded_size);
   Thread* self = Thread::Current();
   SirtRef<ObjectArray<Object> > image_roots(self, CreateImageRoots());
+  ComputeImageBins();
 
   gc::Heap* heap = Runtime::Current()->GetHeap();
   const auto& spaces = heap->GetContinuousSpaces();
@@ -418,6 +565,7 @@ void ImageWriter::CalculateNewObjectOffsets(size_t oat_loaded_size, size_t oat_d
   // Leave space for the header, but do not write it yet, we need to
   // know where image_roots is going to end up
   image_end_ += RoundUp(sizeof(ImageHeader), 8);  // 64-bit-alignment
+  size_t hot_objects_end = 0;
 
   {
     WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
@@ -426,9 +574,22 @@ void ImageWriter::CalculateNewObjectOffsets(size_t oat_loaded_size, size_t oat_d
     // TODO: Add InOrderWalk to heap bitmap.
     const char* old = self->StartAssertNoThreadSuspension("ImageWriter");
     DCHECK(heap->GetLargeObjectsSpace()->GetLiveObjects()->IsEmpty());
-    for (const auto& space : spaces) {
-      space->GetLiveBitmap()->InOrderWalk(CalculateNewObjectOffsetsCallback, this);
-      DCHECK_LT(image_end_, image_->Size());
+    // Lay out one bin after the other, each in heap order.
+    for (int bin = 0; bin < kBinCount; ++bin) {
+      current_bin_ = static_cast<ImageBin>(bin);
+      if (current_bin_ == kBinCold && !image_bins_.empty()) {
+        hot_objects_end = image_end_;
+      }
+      if (current_bin_ != kBinCold && image_bins_.empty()) {
+        continue;
+      }
+      for (const auto& space : spaces) {
+        space->GetLiveBitmap()->InOrderWalk(CalculateNewObjectOffsetsCallback, this);
+        DCHECK_LT(image_end_, image_->Size());
+      }
+    }
+    if (!image_bins_.empty()) {
+      LOG(INFO) << "Image startup objects: " << image_bins_.size();
     }
     self->EndAssertNoThreadSuspension(old);
   }
@@ -453,6 +614,7 @@ void ImageWriter::CalculateNewObjectOffsets(size_t oat_loaded_size, size_t oat_d
                            reinterpret_cast<uint32_t>(oat_data_begin_),
                            reinterpret_cast<uint32_t>(oat_data_end),
                            reinterpret_cast<uint32_t>(oat_file_end));
+  image_header.SetHotObjectsEnd(hot_objects_end);
   memcpy(image_->Begin(), &image_header, sizeof(image_header));
 
   // Note that image_end_ is left at end of used space
@@ -494,6 +656,7 @@ void ImageWriter::FixupObject(const Object* orig, Object* copy) {
   DCHECK(orig != NULL);
   DCHECK(copy != NULL);
   copy->SetClass(down_cast<Class*>(GetImageAddress(orig->GetClass())));
+  AddImageRelocation(copy, Object::ClassOffset());
   // TODO: special case init of pointers to malloc data (or removal of these pointers)
   if (orig->IsClass()) {
     FixupClass(orig->AsClass(), down_cast<Class*>(copy));
@@ -544,6 +707,9 @@ void ImageWriter::FixupMethod(const ArtMethod* orig, ArtMethod* copy) {
       const byte* code = GetOatAddress(orig->GetOatCodeOffset());
       if (code != NULL) {
         copy->SetEntryPointFromCompiledCode(code);
+        if (compiler_driver_.GetMethodHooks() && !orig->IsNative()) {
+          copy->SetHasMethodHooks();
+        }
       } else {
 #if defined(ART_USE_PORTABLE_COMPILER)
         copy->SetEntryPointFromCompiledCode(GetOatAddress(portable_resolution_trampoline_offset_));
@@ -555,6 +721,7 @@ void ImageWriter::FixupMethod(const ArtMethod* orig, ArtMethod* copy) {
         // The native method's pointer is set to a stub to lookup via dlsym.
         // Note this is not the code_ pointer, that is handled above.
         copy->SetNativeMethod(GetOatAddress(jni_dlsym_lookup_offset_));
+        AddImageRelocation(copy, ArtMethod::NativeMethodOffset());
       } else {
         // Normal (non-abstract non-native) methods have various tables to relocate.
         uint32_t mapping_table_off = orig->GetOatMappingTableOffset();
@@ -568,15 +735,23 @@ void ImageWriter::FixupMethod(const ArtMethod* orig, ArtMethod* copy) {
         uint32_t native_gc_map_offset = orig->GetOatNativeGcMapOffset();
         const byte* native_gc_map = GetOatAddress(native_gc_map_offset);
         copy->SetNativeGcMap(reinterpret_cast<const uint8_t*>(native_gc_map));
+        AddImageRelocation(copy, ArtMethod::MappingTableOffset());
+        AddImageRelocation(copy, ArtMethod::VmapTableOffset());
+        AddImageRelocation(copy, ArtMethod::NativeGcMapOffset());
       }
     }
+    AddImageRelocation(copy, ArtMethod::EntryPointFromInterpreterOffset());
   }
+  // The interpreter entry point of the resolution method is not set above, so is not relocated.
+  AddImageRelocation(copy, ArtMethod::EntryPointFromCompiledCodeOffset());
 }
 
 void ImageWriter::FixupObjectArray(const ObjectArray<Object>* orig, ObjectArray<Object>* copy) {
+  const size_t data_offset = ObjectArray<Object>::DataOffset(sizeof(Object*)).Uint32Value();
   for (int32_t i = 0; i < orig->GetLength(); ++i) {
     const Object* element = orig->Get(i);
     copy->SetPtrWithoutChecks(i, GetImageAddress(element));
+    AddImageRelocation(copy, MemberOffset(data_offset + i * sizeof(Object*)));
   }
 }
 
@@ -612,6 +787,7 @@ void ImageWriter::FixupFields(const Object* orig,
       const Object* ref = orig->GetFieldObject<const Object*>(byte_offset, false);
       // Use SetFieldPtr to avoid card marking since we are writing to the image.
       copy->SetFieldPtr(byte_offset, GetImageAddress(ref), false);
+      AddImageRelocation(copy, byte_offset);
       ref_offsets &= ~(CLASS_HIGH_BIT >> right_shift);
     }
   } else {
@@ -633,6 +809,7 @@ void ImageWriter::FixupFields(const Object* orig,
         const Object* ref = orig->GetFieldObject<const Object*>(field_offset, false);
         // Use SetFieldPtr to avoid card marking since we are writing to the image.
         copy->SetFieldPtr(field_offset, GetImageAddress(ref), false);
+        AddImageRelocation(copy, field_offset);
       }
     }
   }
@@ -643,6 +820,14 @@ void ImageWriter::FixupFields(const Object* orig,
     const Object* ref = orig->GetFieldObject<const Object*>(field_offset, false);
     // Use SetFieldPtr to avoid card marking since we are writing to the image.
     copy->SetFieldPtr(field_offset, GetImageAddress(ref), false);
+    AddImageRelocation(copy, field_offset);
+  }
+}
+
+void ImageWriter::AddImageRelocation(const Object* copy, MemberOffset offset) {
+  const byte* location = reinterpret_cast<const byte*>(copy) + offset.Uint32Value();
+  if (*reinterpret_cast<const uint32_t*>(location) != 0) {
+    image_relocations_.push_back(location - image_->Begin());
   }
 }
 
@@ -716,6 +901,8 @@ void ImageWriter::SetPatchLocation(const CompilerDriver::PatchInformation* patch
 #endif
   *patch_location = value;
   oat_header.UpdateChecksum(patch_location, sizeof(value));
+  oat_relocations_.insert(reinterpret_cast<uint8_t*>(patch_location) -
+                          reinterpret_cast<uint8_t*>(&oat_header));
 }
 
 }  // namespace art
@@ -22,6 +22,7 @@
 #include <cstddef>
 #include <set>
 #include <string>
+#include <vector>
 
 #include "driver/compiler_driver.h"
 #include "mem_map.h"
@@ -41,10 +42,20 @@ class ImageWriter {
       : compiler_driver_(compiler_driver), oat_file_(NULL), image_end_(0), image_begin_(NULL),
         oat_data_begin_(NULL), interpreter_to_interpreter_bridge_offset_(0),
         interpreter_to_compiled_code_bridge_offset_(0), portable_resolution_trampoline_offset_(0),
-        quick_resolution_trampoline_offset_(0) {}
+        quick_resolution_trampoline_offset_(0), current_bin_(kBinCold) {}
 
   ~ImageWriter() {}
 
+  // Takes ownership of the descriptors of the classes and of the strings that processes use while
+  // they start, either may be NULL. Their objects are laid out at the start of the image, those
+  // rarely written before those likely written, so that a process touches and dirties fewer
+  // pages of the image.
+  void SetStartupProfile(CompilerDriver::DescriptorSet* startup_classes,
+                         std::set<std::string>* startup_strings) {
+    startup_classes_.reset(startup_classes);
+    startup_strings_.reset(startup_strings);
+  }
+
   bool Write(const std::string& image_filename,
              uintptr_t image_begin,
              const std::string& oat_filename,
@@ -141,11 +152,48 @@ class ImageWriter {
   static void CheckNonImageClassesRemovedCallback(mirror::Object* obj, void* arg)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // The regions of the image, in the order they are laid out.
+  enum ImageBin {
+    kBinHotClean,  // Used at startup and rarely written, like methods, fields and strings.
+    kBinHotDirty,  // Used at startup and likely written, like classes and dex cache arrays.
+    kBinCold,      // Everything else, and everything without a startup profile.
+    kBinCount,
+  };
+
+  // Sorts the objects reachable from the startup classes and strings into the hot bins.
+  void ComputeImageBins() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  static void ComputeStartupStringsCallback(mirror::Object* obj, void* arg)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  template <typename T>
+  void SetImageBins(const mirror::ObjectArray<T>* array, ImageBin bin)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // An object reachable from both hot bins goes to kBinHotDirty, so that the pages of
+  // kBinHotClean stay clean.
+  void SetImageBin(const mirror::Object* object, ImageBin bin) {
+    if (object == NULL) {
+      return;
+    }
+    auto it = image_bins_.find(object);
+    if (it == image_bins_.end()) {
+      image_bins_.Put(object, bin);
+    } else if (bin == kBinHotDirty) {
+      it->second = bin;
+    }
+  }
+
+  ImageBin GetImageBin(const mirror::Object* object) const {
+    auto it = image_bins_.find(object);
+    return (it == image_bins_.end()) ? kBinCold : it->second;
+  }
+
   // Lays out where the image objects will be at runtime.
   void CalculateNewObjectOffsets(size_t oat_loaded_size, size_t oat_data_offset)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   mirror::ObjectArray<mirror::Object>* CreateImageRoots() const
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  static void InternImageStringsCallback(mirror::Object* obj, void* arg)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   static void CalculateNewObjectOffsetsCallback(mirror::Object* obj, void* arg)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
@@ -170,6 +218,10 @@ class ImageWriter {
                    bool is_static)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Records that the word at the offset of the copy holds an address in the image or the oat file,
+  // unless it is null, so that the runtime can relocate the image.
+  void AddImageRelocation(const mirror::Object* copy, MemberOffset offset);
+
   // Patches references in OatFile to expect runtime addresses.
   void PatchOatCodeAndMethods()
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -209,8 +261,23 @@ class ImageWriter {
   uint32_t quick_resolution_trampoline_offset_;
   uint32_t quick_to_interpreter_bridge_offset_;
 
+  // Offsets into the image, and from the oat data begin, of the words holding addresses in the
+  // image or the oat file. Deduplicated code is patched once per method, hence the set.
+  std::vector<uint32_t> image_relocations_;
+  std::set<uint32_t> oat_relocations_;
+
   // DexCaches seen while scanning for fixing up CodeAndDirectMethods
   std::set<mirror::DexCache*> dex_caches_;
+
+  // NULL without a startup profile.
+  UniquePtr<CompilerDriver::DescriptorSet> startup_classes_;
+  UniquePtr<std::set<std::string> > startup_strings_;
+
+  // The bins of the objects not in kBinCold.
+  SafeMap<const mirror::Object*, ImageBin> image_bins_;
+
+  // The bin CalculateNewObjectOffsetsCallback is laying out.
+  ImageBin current_bin_;
 };
 
 }  // namespace art
@@ -0,0 +1,238 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jit_compiler.h"
+
+#include <string.h>
+#include <sys/mman.h>
+
+#include "base/logging.h"
+#include "compiled_method.h"
+#include "driver/compiler_driver.h"
+#include "entrypoints/entrypoint_utils.h"
+#include "instrumentation.h"
+#include "interpreter/interpreter.h"
+#include "mem_map.h"
+#include "mirror/art_method-inl.h"
+#include "mirror/class-inl.h"
+#include "object_utils.h"
+#include "runtime.h"
+#include "scoped_thread_state_change.h"
+#include "stack.h"
+#include "thread.h"
+#include "thread_list.h"
+#include "verifier/method_verifier.h"
+
+namespace art {
+
+class QuickFrameFinder : public StackVisitor {
+ public:
+  QuickFrameFinder(Thread* thread, mirror::ArtMethod* method)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_)
+      : StackVisitor(thread, NULL), method_(method), found_(false) {}
+
+  bool VisitFrame() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    if (GetCurrentQuickFrame() != NULL && GetMethod() == method_) {
+      found_ = true;
+      return false;
+    }
+    return true;
+  }
+
+  bool Found() const {
+    return found_;
+  }
+
+ private:
+  mirror::ArtMethod* const method_;
+  bool found_;
+};
+
+struct FindQuickFrameArgs {
+  mirror::ArtMethod* method;
+  bool found;
+};
+
+static void FindQuickFrameCallback(Thread* thread, void* arg)
+    EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  FindQuickFrameArgs* args = reinterpret_cast<FindQuickFrameArgs*>(arg);
+  if (!args->found) {
+    QuickFrameFinder finder(thread, args->method);
+    finder.WalkStack();
+    args->found = finder.Found();
+  }
+}
+
+JitCompiler* JitCompiler::Create() {
+#if defined(ART_USE_PORTABLE_COMPILER)
+  LOG(WARNING) << "Methods are only compiled at runtime with the quick compiler";
+  return NULL;
+#endif
+  InstructionSet instruction_set = kNone;
+#if defined(__arm__)
+  instruction_set = kThumb2;
+#elif defined(__mips__)
+  instruction_set = kMips;
+#elif defined(__i386__)
+  instruction_set = kX86;
+#endif
+  if (instruction_set == kNone) {
+    LOG(WARNING) << "Methods can't be compiled at runtime on this architecture";
+    return NULL;
+  }
+  UniquePtr<MemMap> code_cache(MemMap::MapAnonymous("jit code cache", NULL, kCodeCacheSize,
+                                                    PROT_READ | PROT_WRITE | PROT_EXEC));
+  if (code_cache.get() == NULL) {
+    LOG(WARNING) << "Failed to map the JIT code cache";
+    return NULL;
+  }
+  CompilerDriver* driver = new CompilerDriver(kQuick, instruction_set, false, NULL, 1, false);
+  // The image is mapped already, calls into it don't need patching.
+  driver->SetSupportBootImageFixup(false);
+  return new JitCompiler(driver, code_cache.release());
+}
+
+JitCompiler::JitCompiler(CompilerDriver* driver, MemMap* code_cache)
+    : driver_(driver), code_cache_(code_cache), code_cache_used_(0) {
+}
+
+JitCompiler::~JitCompiler() {
+}
+
+bool JitCompiler::PrepareMethod(mirror::ArtMethod* method) {
+  if (method->IsNative() || method->IsAbstract() || method->IsProxyMethod()) {
+    return false;
+  }
+  // Static methods of classes that aren't initialized go through the resolution trampoline.
+  if (!method->GetDeclaringClass()->IsInitialized() ||
+      method->GetEntryPointFromCompiledCode() != GetCompiledCodeToInterpreterBridge()) {
+    return false;
+  }
+  MethodHelper mh(method);
+  verifier::MethodVerifier verifier(&mh.GetDexFile(), mh.GetDexCache(), mh.GetClassLoader(),
+                                    &mh.GetClassDef(), mh.GetCodeItem(),
+                                    method->GetDexMethodIndex(), method, method->GetAccessFlags(),
+                                    false, true);
+  return verifier.Verify();
+}
+
+static uint8_t* CopyTable(const SwapVector<uint8_t>& table, uint8_t* dst) {
+  if (!table.empty()) {
+    memcpy(dst, &table[0], table.size());
+  }
+  return dst + table.size();
+}
+
+const void* JitCompiler::CopyToCodeCache(const CompiledMethod& compiled_method,
+                                         const uint8_t** mapping_table,
+                                         const uint8_t** vmap_table, const uint8_t** gc_map) {
+  const SwapVector<uint8_t>& code = compiled_method.GetCode();
+  const size_t tables_size = compiled_method.GetMappingTable().size() +
+      compiled_method.GetVmapTable().size() + compiled_method.GetGcMap().size();
+  // The code size is stored right before the code, see ArtMethod::GetCodeSize.
+  const size_t code_offset =
+      compiled_method.AlignCode(code_cache_used_ + tables_size + sizeof(uint32_t));
+  if (code_offset + code.size() > code_cache_->Size()) {
+    return NULL;
+  }
+  uint8_t* tables = code_cache_->Begin() + code_cache_used_;
+  *mapping_table = tables;
+  tables = CopyTable(compiled_method.GetMappingTable(), tables);
+  *vmap_table = tables;
+  tables = CopyTable(compiled_method.GetVmapTable(), tables);
+  *gc_map = tables;
+  CopyTable(compiled_method.GetGcMap(), tables);
+
+  uint8_t* code_begin = code_cache_->Begin() + code_offset;
+  reinterpret_cast<uint32_t*>(code_begin)[-1] = code.size();
+  memcpy(code_begin, &code[0], code.size());
+  __builtin___clear_cache(reinterpret_cast<char*>(code_begin),
+                          reinterpret_cast<char*>(code_begin + code.size()));
+  code_cache_used_ = code_offset + code.size();
+  return CompiledMethod::CodePointer(code_begin, compiled_method.GetInstructionSet());
+}
+
+bool JitCompiler::InstallCode(mirror::ArtMethod* method, const CompiledMethod& compiled_method,
+                              const void* code, const uint8_t* mapping_table,
+                              const uint8_t* vmap_table, const uint8_t* gc_map) {
+  Runtime* runtime = Runtime::Current();
+  const instrumentation::Instrumentation* instrumentation = runtime->GetInstrumentation();
+  // The debugger or the tracer may have started since the method was compiled.
+  if (instrumentation->InterpretOnly() || instrumentation->AreExitStubsInstalled() ||
+      method->GetEntryPointFromCompiledCode() != GetCompiledCodeToInterpreterBridge()) {
+    return false;
+  }
+  FindQuickFrameArgs args;
+  args.method = method;
+  args.found = false;
+  {
+    MutexLock mu(Thread::Current(), *Locks::thread_list_lock_);
+    runtime->GetThreadList()->ForEach(FindQuickFrameCallback, &args);
+  }
+  if (args.found) {
+    return false;
+  }
+  method->SetFrameSizeInBytes(compiled_method.GetFrameSizeInBytes());
+  method->SetCoreSpillMask(compiled_method.GetCoreSpillMask());
+  method->SetFpSpillMask(compiled_method.GetFpSpillMask());
+  method->SetMappingTable(mapping_table);
+  method->SetVmapTable(vmap_table);
+  method->SetNativeGcMap(gc_map);
+  instrumentation->UpdateMethodsCode(method, code);
+  method->SetEntryPointFromInterpreter(artInterpreterToCompiledCodeBridge);
+  return true;
+}
+
+bool JitCompiler::CompileMethod(Thread* self, mirror::ArtMethod* method) {
+  {
+    ScopedObjectAccess soa(self);
+    if (!PrepareMethod(method)) {
+      return false;
+    }
+  }
+  const CompiledMethod* compiled_method = driver_->CompileLoadedMethod(method);
+  if (compiled_method == NULL) {
+    return false;
+  }
+  const uint8_t* mapping_table;
+  const uint8_t* vmap_table;
+  const uint8_t* gc_map;
+  const void* code = CopyToCodeCache(*compiled_method, &mapping_table, &vmap_table, &gc_map);
+  if (code == NULL) {
+    LOG(WARNING) << "JIT code cache full";
+    return false;
+  }
+  ThreadList* thread_list = Runtime::Current()->GetThreadList();
+  thread_list->SuspendAll();
+  bool installed = InstallCode(method, *compiled_method, code, mapping_table, vmap_table, gc_map);
+  thread_list->ResumeAll();
+  return installed;
+}
+
+}  // namespace art
+
+extern "C" void* ArtJitCreateCompiler() {
+  return art::JitCompiler::Create();
+}
+
+extern "C" bool ArtJitCompileMethod(void* compiler, art::Thread* self,
+                                    art::mirror::ArtMethod* method) {
+  return reinterpret_cast<art::JitCompiler*>(compiler)->CompileMethod(self, method);
+}
+
+extern "C" void ArtJitDeleteCompiler(void* compiler) {
+  delete reinterpret_cast<art::JitCompiler*>(compiler);
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_COMPILER_JIT_JIT_COMPILER_H_
+#define ART_COMPILER_JIT_JIT_COMPILER_H_
+
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "globals.h"
+#include "UniquePtr.h"
+
+namespace art {
+
+namespace mirror {
+  class ArtMethod;
+}  // namespace mirror
+
+class CompiledMethod;
+class CompilerDriver;
+class MemMap;
+class Thread;
+
+// Compiles methods of the running runtime with the quick compiler for jit::Jit, which loads it
+// from libart-compiler.so. The code and its tables are copied into a code cache that is never
+// freed, methods aren't compiled once it is full. Used by the single compiler thread of the JIT.
+class JitCompiler {
+ public:
+  static const size_t kCodeCacheSize = 2 * MB;
+
+  // Returns NULL if the code cache can't be mapped.
+  static JitCompiler* Create();
+
+  ~JitCompiler();
+
+  // Compiles the method and switches its entry points to the code. Returns false if the method
+  // stays interpreted. Must be called without the mutator lock.
+  bool CompileMethod(Thread* self, mirror::ArtMethod* method)
+      LOCKS_EXCLUDED(Locks::mutator_lock_);
+
+ private:
+  JitCompiler(CompilerDriver* driver, MemMap* code_cache);
+
+  // Returns false if the method can't be compiled, otherwise verifies it again since the verifier
+  // only keeps what the compiler needs about the methods it verifies once there is a JIT.
+  bool PrepareMethod(mirror::ArtMethod* method) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Copies the code and its tables into the code cache, returns the entry point of the code or NULL
+  // if the cache is full.
+  const void* CopyToCodeCache(const CompiledMethod& compiled_method, const uint8_t** mapping_table,
+                              const uint8_t** vmap_table, const uint8_t** gc_map);
+
+  // Makes the method use the code unless its entry point changed or it is on a stack as a quick
+  // frame, whose layout depends on the frame size of the method. All threads must be suspended.
+  bool InstallCode(mirror::ArtMethod* method, const CompiledMethod& compiled_method,
+                   const void* code, const uint8_t* mapping_table, const uint8_t* vmap_table,
+                   const uint8_t* gc_map) EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  UniquePtr<CompilerDriver> driver_;
+  UniquePtr<MemMap> code_cache_;
+  size_t code_cache_used_;
+
+  DISALLOW_COPY_AND_ASSIGN(JitCompiler);
+};
+
+}  // namespace art
+
+#endif  // ART_COMPILER_JIT_JIT_COMPILER_H_
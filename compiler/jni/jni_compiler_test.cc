@@ -199,6 +199,33 @@ TEST_F(JniCompilerTest, CompileAndRunIntMethod) {
   EXPECT_EQ(2, gJava_MyClassNatives_fooI_calls);
 }
 
+int gJava_MyClassNatives_fastFooI_calls = 0;
+jint Java_MyClassNatives_fastFooI(JNIEnv* env, jobject thisObj, jint x) {
+  // A fast native is called without leaving the runnable state.
+  EXPECT_EQ(1U, Thread::Current()->NumStackReferences());
+  EXPECT_EQ(kRunnable, Thread::Current()->GetState());
+  Locks::mutator_lock_->AssertSharedHeld(Thread::Current());
+  EXPECT_TRUE(env->IsInstanceOf(thisObj, JniCompilerTest::jklass_));
+  gJava_MyClassNatives_fastFooI_calls++;
+  return x;
+}
+
+TEST_F(JniCompilerTest, CompileAndRunFastIntMethod) {
+  TEST_DISABLED_FOR_PORTABLE();
+  SetUpForTest(false, "fooI", "(I)I",
+               reinterpret_cast<void*>(&Java_MyClassNatives_fooI));
+  JNINativeMethod methods[] = {
+    { "fooI", "!(I)I", reinterpret_cast<void*>(&Java_MyClassNatives_fastFooI) }
+  };
+  ASSERT_EQ(JNI_OK, env_->RegisterNatives(jklass_, methods, 1));
+
+  EXPECT_EQ(0, gJava_MyClassNatives_fastFooI_calls);
+  jint result = env_->CallNonvirtualIntMethod(jobj_, jklass_, jmethod_, 42);
+  EXPECT_EQ(42, result);
+  EXPECT_EQ(1, gJava_MyClassNatives_fastFooI_calls);
+  EXPECT_EQ(kNative, Thread::Current()->GetState());
+}
+
 int gJava_MyClassNatives_fooII_calls = 0;
 jint Java_MyClassNatives_fooII(JNIEnv* env, jobject thisObj, jint x, jint y) {
   // 1 = thisObj
@@ -383,6 +410,28 @@ TEST_F(JniCompilerTest, CompileAndRunStaticIntIntMethod) {
   EXPECT_EQ(1, gJava_MyClassNatives_fooSII_calls);
 }
 
+int gJava_MyClassNatives_criticalSIJ_calls = 0;
+jlong Java_MyClassNatives_criticalSIJ(jint x, jlong y) {
+  // A critical native is passed neither the JNIEnv* nor the jclass and stays runnable.
+  EXPECT_EQ(0U, Thread::Current()->NumStackReferences());
+  EXPECT_EQ(kRunnable, Thread::Current()->GetState());
+  gJava_MyClassNatives_criticalSIJ_calls++;
+  return y - x;  // non-commutative operator
+}
+
+TEST_F(JniCompilerTest, CompileAndRunCriticalStaticIntLongMethod) {
+  TEST_DISABLED_FOR_PORTABLE();
+  SetUpForTest(true, "criticalSIJ", "(IJ)J",
+               reinterpret_cast<void*>(&Java_MyClassNatives_criticalSIJ));
+
+  EXPECT_EQ(0, gJava_MyClassNatives_criticalSIJ_calls);
+  jlong y = 0x1234567800000000ULL;
+  jlong result = env_->CallStaticLongMethod(jklass_, jmethod_, 7, y);
+  EXPECT_EQ(y - 7, result);
+  EXPECT_EQ(1, gJava_MyClassNatives_criticalSIJ_calls);
+  EXPECT_EQ(kNative, Thread::Current()->GetState());
+}
+
 int gJava_MyClassNatives_fooSDD_calls = 0;
 jdouble Java_MyClassNatives_fooSDD(JNIEnv* env, jclass klass, jdouble x, jdouble y) {
   // 1 = klass
@@ -86,15 +86,16 @@ bool ManagedRuntimeCallingConvention::IsCurrentParamAReference() {
 
 JniCallingConvention* JniCallingConvention::Create(bool is_static, bool is_synchronized,
                                                    const char* shorty,
-                                                   InstructionSet instruction_set) {
+                                                   InstructionSet instruction_set,
+                                                   bool is_critical) {
   switch (instruction_set) {
     case kArm:
     case kThumb2:
-      return new arm::ArmJniCallingConvention(is_static, is_synchronized, shorty);
+      return new arm::ArmJniCallingConvention(is_static, is_synchronized, shorty, is_critical);
     case kMips:
-      return new mips::MipsJniCallingConvention(is_static, is_synchronized, shorty);
+      return new mips::MipsJniCallingConvention(is_static, is_synchronized, shorty, is_critical);
     case kX86:
-      return new x86::X86JniCallingConvention(is_static, is_synchronized, shorty);
+      return new x86::X86JniCallingConvention(is_static, is_synchronized, shorty, is_critical);
     default:
       LOG(FATAL) << "Unknown InstructionSet: " << instruction_set;
       return NULL;
@@ -102,7 +103,7 @@ JniCallingConvention* JniCallingConvention::Create(bool is_static, bool is_synch
 }
 
 size_t JniCallingConvention::ReferenceCount() const {
-  return NumReferenceArgs() + (IsStatic() ? 1 : 0);
+  return NumReferenceArgs() + (IsStatic() && !IsCritical() ? 1 : 0);
 }
 
 FrameOffset JniCallingConvention::SavedLocalReferenceCookieOffset() const {
@@ -117,7 +118,7 @@ FrameOffset JniCallingConvention::ReturnValueSaveLocation() const {
 }
 
 bool JniCallingConvention::HasNext() {
-  if (itr_args_ <= kObjectOrClass) {
+  if (itr_args_ < NumberOfExtraArgumentsForJni()) {
     return true;
   } else {
     unsigned int arg_pos = itr_args_ - NumberOfExtraArgumentsForJni();
@@ -127,7 +128,7 @@ bool JniCallingConvention::HasNext() {
 
 void JniCallingConvention::Next() {
   CHECK(HasNext());
-  if (itr_args_ > kObjectOrClass) {
+  if (itr_args_ >= NumberOfExtraArgumentsForJni()) {
     int arg_pos = itr_args_ - NumberOfExtraArgumentsForJni();
     if (IsParamALongOrDouble(arg_pos)) {
       itr_longs_and_doubles_++;
@@ -142,16 +143,11 @@ void JniCallingConvention::Next() {
 }
 
 bool JniCallingConvention::IsCurrentParamAReference() {
-  switch (itr_args_) {
-    case kJniEnv:
-      return false;  // JNIEnv*
-    case kObjectOrClass:
-      return true;   // jobject or jclass
-    default: {
-      int arg_pos = itr_args_ - NumberOfExtraArgumentsForJni();
-      return IsParamAReference(arg_pos);
-    }
+  if (itr_args_ < NumberOfExtraArgumentsForJni()) {
+    return itr_args_ == kObjectOrClass;  // JNIEnv* or jclass
   }
+  int arg_pos = itr_args_ - NumberOfExtraArgumentsForJni();
+  return IsParamAReference(arg_pos);
 }
 
 // Return position of SIRT entry holding reference at the current iterator
@@ -167,17 +163,21 @@ FrameOffset JniCallingConvention::CurrentParamSirtEntryOffset() {
 }
 
 size_t JniCallingConvention::CurrentParamSize() {
-  if (itr_args_ <= kObjectOrClass) {
-    return kPointerSize;  // JNIEnv or jobject/jclass
+  if (itr_args_ < NumberOfExtraArgumentsForJni()) {
+    return kPointerSize;  // JNIEnv or jclass
   } else {
     int arg_pos = itr_args_ - NumberOfExtraArgumentsForJni();
     return ParamSize(arg_pos);
   }
 }
 
-size_t JniCallingConvention::NumberOfExtraArgumentsForJni() {
+size_t JniCallingConvention::NumberOfExtraArgumentsForJni() const {
   // The first argument is the JNIEnv*.
   // Static methods have an extra argument which is the jclass.
+  // Critical natives have neither.
+  if (IsCritical()) {
+    return 0;
+  }
   return IsStatic() ? 2 : 1;
 }
 
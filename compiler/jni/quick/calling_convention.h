@@ -208,8 +208,10 @@ class ManagedRuntimeCallingConvention : public CallingConvention {
 // callee saves for frames above this one.
 class JniCallingConvention : public CallingConvention {
  public:
+  // A critical native is static, not synchronized and takes and returns only primitives. It is
+  // passed neither the JNIEnv* nor the jclass.
   static JniCallingConvention* Create(bool is_static, bool is_synchronized, const char* shorty,
-                                      InstructionSet instruction_set);
+                                      InstructionSet instruction_set, bool is_critical = false);
 
   // Size of frame excluding space for outgoing args (its assumed Method* is
   // always at the bottom of a frame, but this doesn't work for outgoing
@@ -273,15 +275,23 @@ class JniCallingConvention : public CallingConvention {
     kObjectOrClass = 1
   };
 
-  explicit JniCallingConvention(bool is_static, bool is_synchronized, const char* shorty)
-      : CallingConvention(is_static, is_synchronized, shorty) {}
+  JniCallingConvention(bool is_static, bool is_synchronized, const char* shorty,
+                       bool is_critical)
+      : CallingConvention(is_static, is_synchronized, shorty), is_critical_(is_critical) {}
+
+  bool IsCritical() const {
+    return is_critical_;
+  }
 
   // Number of stack slots for outgoing arguments, above which the SIRT is
   // located
   virtual size_t NumberOfOutgoingStackArgs() = 0;
 
  protected:
-  size_t NumberOfExtraArgumentsForJni();
+  size_t NumberOfExtraArgumentsForJni() const;
+
+ private:
+  const bool is_critical_;
 };
 
 }  // namespace art
@@ -45,7 +45,8 @@ class MipsManagedRuntimeCallingConvention : public ManagedRuntimeCallingConventi
 
 class MipsJniCallingConvention : public JniCallingConvention {
  public:
-  explicit MipsJniCallingConvention(bool is_static, bool is_synchronized, const char* shorty);
+  MipsJniCallingConvention(bool is_static, bool is_synchronized, const char* shorty,
+                           bool is_critical);
   virtual ~MipsJniCallingConvention() {}
   // Calling convention
   virtual ManagedRegister ReturnRegister();
@@ -18,33 +18,48 @@
 #define ART_COMPILER_LEB128_ENCODER_H_
 
 #include "base/macros.h"
+#include "leb128.h"
 
 namespace art {
 
-// An encoder with an API similar to vector<uint32_t> where the data is captured in ULEB128 format.
+// An encoder with an API similar to vector<uint32_t> where the data is captured in ULEB128 format,
+// or in SLEB128 format for the values pushed with PushBackSigned.
 class UnsignedLeb128EncodingVector {
  public:
   UnsignedLeb128EncodingVector() {
   }
 
   void PushBack(uint32_t value) {
-    bool done = false;
-    do {
-      uint8_t out = value & 0x7f;
-      if (out != value) {
-        data_.push_back(out | 0x80);
-        value >>= 7;
-      } else {
-        data_.push_back(out);
-        done = true;
-      }
-    } while (!done);
+    size_t pos = data_.size();
+    data_.resize(pos + UnsignedLeb128Size(value));
+    EncodeUnsigned(value, &data_[pos]);
   }
 
+  void PushBackSigned(int32_t value) {
+    // The bits above the sign bit of each group of 7 must all equal the sign bit.
+    uint32_t extra_bits = static_cast<uint32_t>(value ^ (value >> 31)) >> 6;
+    uint8_t out = value & 0x7f;
+    while (extra_bits != 0u) {
+      data_.push_back(out | 0x80);
+      value >>= 7;
+      out = value & 0x7f;
+      extra_bits >>= 7;
+    }
+    data_.push_back(out);
+  }
+
+  // Sizes the data for all the values first so that it grows once.
   template<typename It>
   void InsertBack(It cur, It end) {
+    size_t size = 0;
+    for (It it = cur; it != end; ++it) {
+      size += UnsignedLeb128Size(*it);
+    }
+    size_t pos = data_.size();
+    data_.resize(pos + size);
+    uint8_t* out = &data_[0] + pos;
     for (; cur != end; ++cur) {
-      PushBack(*cur);
+      out = EncodeUnsigned(*cur, out);
     }
   }
 
@@ -53,6 +68,16 @@ class UnsignedLeb128EncodingVector {
   }
 
  private:
+  // Writes the value to out, which must have room for it, returning the end of the encoding.
+  static uint8_t* EncodeUnsigned(uint32_t value, uint8_t* out) {
+    while (value > 0x7f) {
+      *out++ = (value & 0x7f) | 0x80;
+      value >>= 7;
+    }
+    *out++ = value;
+    return out;
+  }
+
   std::vector<uint8_t> data_;
 
   DISALLOW_COPY_AND_ASSIGN(UnsignedLeb128EncodingVector);
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "common_test.h"
+#include "leb128.h"
+#include "leb128_encoder.h"
+#include "mapping_table.h"
+
+namespace art {
+
+class Leb128EncoderTest : public testing::Test {
+};
+
+TEST_F(Leb128EncoderTest, Unsigned) {
+  static const uint32_t kValues[] = {
+    0, 1, 0x7f, 0x80, 0x3fff, 0x4000, 0x1fffff, 0x200000, 0xfffffff, 0x10000000, 0xffffffff
+  };
+  static const size_t kSizes[] = { 1, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5 };
+  UnsignedLeb128EncodingVector batch;
+  batch.InsertBack(kValues, kValues + arraysize(kValues));
+  const uint8_t* batch_data = &batch.GetData()[0];
+  for (size_t i = 0; i < arraysize(kValues); ++i) {
+    UnsignedLeb128EncodingVector encoder;
+    encoder.PushBack(kValues[i]);
+    EXPECT_EQ(kSizes[i], encoder.GetData().size()) << kValues[i];
+    EXPECT_EQ(kSizes[i], UnsignedLeb128Size(kValues[i])) << kValues[i];
+    const uint8_t* data = &encoder.GetData()[0];
+    EXPECT_EQ(kValues[i], DecodeUnsignedLeb128(&data));
+    EXPECT_EQ(&encoder.GetData()[0] + encoder.GetData().size(), data);
+    EXPECT_EQ(kValues[i], DecodeUnsignedLeb128(&batch_data));
+  }
+  EXPECT_EQ(&batch.GetData()[0] + batch.GetData().size(), batch_data);
+}
+
+TEST_F(Leb128EncoderTest, Signed) {
+  static const int32_t kValues[] = {
+    0, 1, -1, 63, -64, 64, -65, 8191, -8192, 8192, -8193, 0x7fffffff,
+    static_cast<int32_t>(0x80000000)
+  };
+  static const size_t kSizes[] = { 1, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 5, 5 };
+  for (size_t i = 0; i < arraysize(kValues); ++i) {
+    UnsignedLeb128EncodingVector encoder;
+    encoder.PushBackSigned(kValues[i]);
+    EXPECT_EQ(kSizes[i], encoder.GetData().size()) << kValues[i];
+    const uint8_t* data = &encoder.GetData()[0];
+    EXPECT_EQ(kValues[i], DecodeSignedLeb128(&data));
+    EXPECT_EQ(&encoder.GetData()[0] + encoder.GetData().size(), data);
+  }
+}
+
+TEST_F(Leb128EncoderTest, MappingTableDeltas) {
+  // Two pc to dex entries, the second going back in the dex code, and one dex to pc entry.
+  UnsignedLeb128EncodingVector encoder;
+  encoder.PushBack(3);
+  encoder.PushBack(2);
+  encoder.PushBack(4);
+  encoder.PushBackSigned(10);
+  encoder.PushBack(200);
+  encoder.PushBackSigned(-6);
+  encoder.PushBack(8);
+  encoder.PushBackSigned(7);
+
+  MappingTable table(&encoder.GetData()[0]);
+  ASSERT_EQ(3U, table.TotalSize());
+  ASSERT_EQ(2U, table.PcToDexSize());
+  ASSERT_EQ(1U, table.DexToPcSize());
+  MappingTable::PcToDexIterator it = table.PcToDexBegin();
+  EXPECT_EQ(4U, it.NativePcOffset());
+  EXPECT_EQ(10U, it.DexPc());
+  ++it;
+  EXPECT_EQ(204U, it.NativePcOffset());
+  EXPECT_EQ(4U, it.DexPc());
+  ++it;
+  EXPECT_TRUE(it == table.PcToDexEnd());
+  MappingTable::DexToPcIterator it2 = table.DexToPcBegin();
+  EXPECT_EQ(8U, it2.NativePcOffset());
+  EXPECT_EQ(7U, it2.DexPc());
+}
+
+}  // namespace art
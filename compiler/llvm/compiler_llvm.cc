@@ -32,7 +32,9 @@
 #include <llvm/LinkAllPasses.h>
 #include <llvm/Support/ManagedStatic.h>
 #include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/TargetRegistry.h>
 #include <llvm/Support/Threading.h>
+#include <llvm/Target/TargetMachine.h>
 
 namespace art {
 void CompileOneMethod(CompilerDriver& driver,
@@ -108,14 +110,48 @@ namespace llvm {
 
 CompilerLLVM::CompilerLLVM(CompilerDriver* driver, InstructionSet insn_set)
     : compiler_driver_(driver), insn_set_(insn_set),
-      next_cunit_id_lock_("compilation unit id lock"), next_cunit_id_(1) {
+      next_cunit_id_lock_("compilation unit id lock"), next_cunit_id_(1),
+      target_machines_lock_("target machines lock") {
 
   // Initialize LLVM libraries
   pthread_once(&llvm_initialized, InitializeLLVM);
+
+  // Lookup the LLVM target
+  CompilerDriver::InstructionSetToLLVMTarget(insn_set_, target_triple_, target_cpu_,
+                                             target_attr_);
+  std::string errmsg;
+  target_ = ::llvm::TargetRegistry::lookupTarget(target_triple_, errmsg);
+  CHECK(target_ != NULL) << errmsg;
 }
 
 
 CompilerLLVM::~CompilerLLVM() {
+  STLDeleteValues(&target_machines_);
+}
+
+
+::llvm::TargetMachine* CompilerLLVM::GetTargetMachine() {
+  Thread* self = Thread::Current();
+  MutexLock mu(self, target_machines_lock_);
+  SafeMap<Thread*, ::llvm::TargetMachine*>::iterator it = target_machines_.find(self);
+  if (it != target_machines_.end()) {
+    return it->second;
+  }
+
+  // Target options
+  ::llvm::TargetOptions target_options;
+  target_options.FloatABIType = ::llvm::FloatABI::Soft;
+  target_options.NoFramePointerElim = true;
+  target_options.UseSoftFloat = false;
+  target_options.EnableFastISel = false;
+
+  ::llvm::TargetMachine* target_machine =
+      target_->createTargetMachine(target_triple_, target_cpu_, target_attr_, target_options,
+                                   ::llvm::Reloc::Static, ::llvm::CodeModel::Small,
+                                   ::llvm::CodeGenOpt::Aggressive);
+  CHECK(target_machine != NULL) << "Failed to create target machine";
+  target_machines_.Put(self, target_machine);
+  return target_machine;
 }
 
 
@@ -22,6 +22,7 @@
 #include "driver/compiler_driver.h"
 #include "instruction_set.h"
 #include "mirror/object.h"
+#include "safe_map.h"
 
 #include <UniquePtr.h>
 
@@ -43,6 +44,8 @@ namespace art {
 namespace llvm {
   class Function;
   class LLVMContext;
+  class Target;
+  class TargetMachine;
   class Module;
   class PointerType;
   class StructType;
@@ -81,6 +84,11 @@ class CompilerLLVM {
 
   CompiledMethod* CompileNativeMethod(DexCompilationUnit* dex_compilation_unit);
 
+  // Returns the target machine of the calling thread, creating it on first use. Creating a target
+  // machine is expensive and it is only ever used by one unit at a time on a given thread, so
+  // each compiler thread keeps its own for the whole compilation.
+  ::llvm::TargetMachine* GetTargetMachine() LOCKS_EXCLUDED(target_machines_lock_);
+
  private:
   LlvmCompilationUnit* AllocateCompilationUnit();
 
@@ -93,6 +101,15 @@ class CompilerLLVM {
 
   std::string bitcode_filename_;
 
+  // The target, looked up once for all units.
+  std::string target_triple_;
+  std::string target_cpu_;
+  std::string target_attr_;
+  const ::llvm::Target* target_;
+
+  Mutex target_machines_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  SafeMap<Thread*, ::llvm::TargetMachine*> target_machines_ GUARDED_BY(target_machines_lock_);
+
   DISALLOW_COPY_AND_ASSIGN(CompilerLLVM);
 };
 
@@ -1668,7 +1668,11 @@ llvm::Value* GBCExpanderPass::Expand_HLIGet(llvm::CallInst& call_inst,
     llvm::Value* field_addr =
       irb_.CreatePtrDisp(object_addr, field_offset_value, field_type);
 
-    field_value = irb_.CreateLoad(field_addr, kTBAAHeapInstance, field_jty);
+    if (is_volatile) {
+      field_value = irb_.CreateLoad(field_addr, kTBAAHeapInstance, field_jty);
+    } else {
+      field_value = irb_.CreateFieldLoad(field_addr, kTBAAHeapInstance, field_jty, field_offset);
+    }
     field_value = SignOrZeroExtendCat1Types(field_value, field_jty);
 
     if (is_volatile) {
@@ -1738,7 +1742,11 @@ void GBCExpanderPass::Expand_HLIPut(llvm::CallInst& call_inst,
       irb_.CreatePtrDisp(object_addr, field_offset_value, field_type);
 
     new_value = TruncateCat1Types(new_value, field_jty);
-    irb_.CreateStore(new_value, field_addr, kTBAAHeapInstance, field_jty);
+    if (is_volatile) {
+      irb_.CreateStore(new_value, field_addr, kTBAAHeapInstance, field_jty);
+    } else {
+      irb_.CreateFieldStore(new_value, field_addr, kTBAAHeapInstance, field_jty, field_offset);
+    }
 
     if (is_volatile) {
       irb_.CreateMemoryBarrier(art::kLoadLoad);
@@ -1954,7 +1962,12 @@ llvm::Value* GBCExpanderPass::Expand_HLSget(llvm::CallInst& call_inst,
       irb_.CreatePtrDisp(static_storage_addr, static_field_offset_value,
                          irb_.getJType(field_jty)->getPointerTo());
 
-    static_field_value = irb_.CreateLoad(static_field_addr, kTBAAHeapStatic, field_jty);
+    if (is_volatile) {
+      static_field_value = irb_.CreateLoad(static_field_addr, kTBAAHeapStatic, field_jty);
+    } else {
+      static_field_value = irb_.CreateFieldLoad(static_field_addr, kTBAAHeapStatic, field_jty,
+                                                field_offset);
+    }
     static_field_value = SignOrZeroExtendCat1Types(static_field_value, field_jty);
 
     if (is_volatile) {
@@ -2044,7 +2057,12 @@ void GBCExpanderPass::Expand_HLSput(llvm::CallInst& call_inst,
                          irb_.getJType(field_jty)->getPointerTo());
 
     new_value = TruncateCat1Types(new_value, field_jty);
-    irb_.CreateStore(new_value, static_field_addr, kTBAAHeapStatic, field_jty);
+    if (is_volatile) {
+      irb_.CreateStore(new_value, static_field_addr, kTBAAHeapStatic, field_jty);
+    } else {
+      irb_.CreateFieldStore(new_value, static_field_addr, kTBAAHeapStatic, field_jty,
+                            field_offset);
+    }
 
     if (is_volatile) {
       irb_.CreateMemoryBarrier(art::kStoreLoad);
@@ -131,6 +131,18 @@ class IRBuilder : public LLVMIRBuilder {
     return CreateStore(val, ptr, mdb_.GetTBAAMemoryJType(special_ty, j_ty));
   }
 
+  // Loads and stores of a non-volatile field, which only alias accesses of the same field.
+  ::llvm::LoadInst* CreateFieldLoad(::llvm::Value* ptr, TBAASpecialType special_ty, JType j_ty,
+                                    uint32_t field_offset) {
+    return CreateLoad(ptr, mdb_.GetTBAAField(special_ty, j_ty, field_offset));
+  }
+
+  ::llvm::StoreInst* CreateFieldStore(::llvm::Value* val, ::llvm::Value* ptr,
+                                      TBAASpecialType special_ty, JType j_ty,
+                                      uint32_t field_offset) {
+    return CreateStore(val, ptr, mdb_.GetTBAAField(special_ty, j_ty, field_offset));
+  }
+
   ::llvm::LoadInst* LoadFromObjectOffset(::llvm::Value* object_addr,
                                        int64_t offset,
                                        ::llvm::Type* type,
@@ -93,25 +93,18 @@ namespace llvm {
 CreateGBCExpanderPass(const IntrinsicHelper& intrinsic_helper, IRBuilder& irb,
                       CompilerDriver* compiler, const DexCompilationUnit* dex_compilation_unit);
 
-::llvm::Module* makeLLVMModuleContents(::llvm::Module* module);
-
-
-LlvmCompilationUnit::LlvmCompilationUnit(const CompilerLLVM* compiler_llvm, size_t cunit_id)
+LlvmCompilationUnit::LlvmCompilationUnit(CompilerLLVM* compiler_llvm, size_t cunit_id)
     : compiler_llvm_(compiler_llvm), cunit_id_(cunit_id) {
   driver_ = NULL;
   dex_compilation_unit_ = NULL;
   llvm_info_.reset(new LLVMInfo());
   context_.reset(llvm_info_->GetLLVMContext());
+  // The module already holds the runtime function declarations and the intrinsics, share them
+  // rather than declaring everything a second time.
   module_ = llvm_info_->GetLLVMModule();
 
-  // Include the runtime function declaration
-  makeLLVMModuleContents(module_);
-
-
-  intrinsic_helper_.reset(new IntrinsicHelper(*context_, *module_));
-
   // Create IRBuilder
-  irb_.reset(new IRBuilder(*context_, *module_, *intrinsic_helper_));
+  irb_.reset(new IRBuilder(*context_, *module_, *llvm_info_->GetIntrinsicHelper()));
 
   // We always need a switch case, so just use a normal function.
   switch (GetInstructionSet()) {
@@ -197,33 +190,45 @@ bool LlvmCompilationUnit::MaterializeToString(std::string& str_buffer) {
 }
 
 
-bool LlvmCompilationUnit::MaterializeToRawOStream(::llvm::raw_ostream& out_stream) {
-  // Lookup the LLVM target
-  std::string target_triple;
-  std::string target_cpu;
-  std::string target_attr;
-  CompilerDriver::InstructionSetToLLVMTarget(GetInstructionSet(), target_triple, target_cpu, target_attr);
-
-  std::string errmsg;
-  const ::llvm::Target* target =
-    ::llvm::TargetRegistry::lookupTarget(target_triple, errmsg);
+Runtime::CompilerFilter LlvmCompilationUnit::GetCompilerFilter() const {
+  if (driver_ == NULL || dex_compilation_unit_ == NULL) {
+    return Runtime::Current()->GetCompilerFilter();
+  }
+  return driver_->GetCompilerFilter(dex_compilation_unit_->GetDexMethodIndex(),
+                                    *dex_compilation_unit_->GetDexFile());
+}
 
-  CHECK(target != NULL) << errmsg;
 
-  // Target options
-  ::llvm::TargetOptions target_options;
-  target_options.FloatABIType = ::llvm::FloatABI::Soft;
-  target_options.NoFramePointerElim = true;
-  target_options.UseSoftFloat = false;
-  target_options.EnableFastISel = false;
+// Picks the optimization passes for the compiler filter: small code for kSpace, which with a
+// profile is the filter of the code it never saw, and the loop and straight line vectorizers on
+// top of the full pipeline for kSpeed, the filter of the hot code.
+static void SetUpOptimizationPipeline(Runtime::CompilerFilter compiler_filter,
+                                      ::llvm::PassManagerBuilder& pm_builder) {
+  switch (compiler_filter) {
+    case Runtime::kInterpretOnly:
+      pm_builder.OptLevel = 0;
+      break;
+    case Runtime::kSpace:
+      pm_builder.OptLevel = 2;
+      pm_builder.SizeLevel = 2;
+      pm_builder.DisableUnrollLoops = true;
+      break;
+    case Runtime::kBalanced:
+      pm_builder.OptLevel = 2;
+      break;
+    case Runtime::kSpeed:
+    case Runtime::kEverything:
+      pm_builder.OptLevel = 3;
+      pm_builder.LoopVectorize = true;
+      pm_builder.SLPVectorize = true;
+      break;
+  }
+}
 
-  // Create the ::llvm::TargetMachine
-  ::llvm::OwningPtr< ::llvm::TargetMachine> target_machine(
-    target->createTargetMachine(target_triple, target_cpu, target_attr, target_options,
-                                ::llvm::Reloc::Static, ::llvm::CodeModel::Small,
-                                ::llvm::CodeGenOpt::Aggressive));
 
-  CHECK(target_machine.get() != NULL) << "Failed to create target machine";
+bool LlvmCompilationUnit::MaterializeToRawOStream(::llvm::raw_ostream& out_stream) {
+  // The ::llvm::TargetMachine of this thread, reused across units
+  ::llvm::TargetMachine* target_machine = compiler_llvm_->GetTargetMachine();
 
   // Add target data
   const ::llvm::DataLayout* data_layout = target_machine->getDataLayout();
@@ -276,7 +281,7 @@ bool LlvmCompilationUnit::MaterializeToRawOStream(::llvm::raw_ostream& out_strea
   // pm_builder.Inliner = ::llvm::createFunctionInliningPass();
   // pm_builder.Inliner = ::llvm::createAlwaysInlinerPass();
   // pm_builder.Inliner = ::llvm::createPartialInliningPass();
-  pm_builder.OptLevel = 3;
+  SetUpOptimizationPipeline(GetCompilerFilter(), pm_builder);
   pm_builder.DisableUnitAtATime = 1;
   pm_builder.populateFunctionPassManager(fpm);
   pm_builder.populateModulePassManager(pm);
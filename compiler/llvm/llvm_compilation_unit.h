@@ -24,6 +24,7 @@
 #include "driver/dex_compilation_unit.h"
 #include "globals.h"
 #include "instruction_set.h"
+#include "runtime.h"
 #include "runtime_support_builder.h"
 #include "runtime_support_llvm_func.h"
 #include "safe_map.h"
@@ -100,17 +101,16 @@ class LlvmCompilationUnit {
   }
 
  private:
-  LlvmCompilationUnit(const CompilerLLVM* compiler_llvm,
+  LlvmCompilationUnit(CompilerLLVM* compiler_llvm,
                       uint32_t cunit_id);
 
-  const CompilerLLVM* compiler_llvm_;
+  CompilerLLVM* const compiler_llvm_;
   const uint32_t cunit_id_;
 
   UniquePtr< ::llvm::LLVMContext> context_;
   UniquePtr<IRBuilder> irb_;
   UniquePtr<RuntimeSupportBuilder> runtime_support_;
   ::llvm::Module* module_;  // Managed by context_
-  UniquePtr<IntrinsicHelper> intrinsic_helper_;
   UniquePtr<LLVMInfo> llvm_info_;
   CompilerDriver* driver_;
   DexCompilationUnit* dex_compilation_unit_;
@@ -123,6 +123,9 @@ class LlvmCompilationUnit {
 
   void CheckCodeAlign(uint32_t offset) const;
 
+  // The compiler filter of the method, the runtime's for units without one such as JNI stubs.
+  Runtime::CompilerFilter GetCompilerFilter() const;
+
   void DumpBitcodeToFile();
   void DumpBitcodeToString(std::string& str_buffer);
 
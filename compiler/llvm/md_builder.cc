@@ -21,6 +21,8 @@
 
 #include <string>
 
+#include "base/stringprintf.h"
+
 namespace art {
 namespace llvm {
 
@@ -112,6 +114,22 @@ namespace llvm {
   return spec_ty;
 }
 
+::llvm::MDNode* MDBuilder::GetTBAAField(TBAASpecialType sty_id, JType jty_id,
+                                        uint32_t field_offset) {
+  DCHECK(sty_id == kTBAAHeapInstance || sty_id == kTBAAHeapStatic)
+      << "SpecialType must be instance or static";
+  ::llvm::MDNode* jtype = GetTBAAMemoryJType(sty_id, jty_id);
+  std::pair< ::llvm::MDNode*, uint32_t> key(jtype, field_offset);
+  SafeMap<std::pair< ::llvm::MDNode*, uint32_t>, ::llvm::MDNode*>::iterator it =
+      tbaa_field_.find(key);
+  if (it != tbaa_field_.end()) {
+    return it->second;
+  }
+  ::llvm::MDNode* field_ty = createTBAANode(StringPrintf("Field %u", field_offset), jtype);
+  tbaa_field_.Put(key, field_ty);
+  return field_ty;
+}
+
 
 }  // namespace llvm
 }  // namespace art
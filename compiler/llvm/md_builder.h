@@ -22,6 +22,9 @@
 #include "llvm/IR/MDBuilder.h"
 
 #include <cstring>
+#include <utility>
+
+#include "safe_map.h"
 
 namespace llvm {
   class LLVMContext;
@@ -48,6 +51,9 @@ class MDBuilder : public LLVMMDBuilder {
 
   ::llvm::MDNode* GetTBAASpecialType(TBAASpecialType special_ty);
   ::llvm::MDNode* GetTBAAMemoryJType(TBAASpecialType special_ty, JType j_ty);
+  // A child of the memory type for the field at the given offset. Java fields never overlap, so
+  // fields at different offsets do not alias whatever the objects holding them.
+  ::llvm::MDNode* GetTBAAField(TBAASpecialType special_ty, JType j_ty, uint32_t field_offset);
 
   ::llvm::MDNode* GetBranchWeights(ExpectCond expect) {
     DCHECK_LT(expect, MAX_EXPECT) << "MAX_EXPECT is not for branch weight";
@@ -60,6 +66,8 @@ class MDBuilder : public LLVMMDBuilder {
   // There are 3 categories of memory types will not alias: array element, instance field, and
   // static field.
   ::llvm::MDNode* tbaa_memory_jtype_[3][MAX_JTYPE];
+  // The field nodes by memory type node and offset.
+  SafeMap<std::pair< ::llvm::MDNode*, uint32_t>, ::llvm::MDNode*> tbaa_field_;
 
   ::llvm::MDNode* expect_cond_[MAX_EXPECT];
 };
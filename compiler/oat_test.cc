@@ -50,7 +50,7 @@ class OatTest : public CommonTest {
       uintptr_t oat_code_aligned = RoundDown(reinterpret_cast<uintptr_t>(oat_code), 2);
       oat_code = reinterpret_cast<const void*>(oat_code_aligned);
 
-      const std::vector<uint8_t>& code = compiled_method->GetCode();
+      const SwapVector<uint8_t>& code = compiled_method->GetCode();
       size_t code_size = code.size() * sizeof(code[0]);
       EXPECT_EQ(0, memcmp(oat_code, &code[0], code_size))
           << PrettyMethod(method) << " " << code_size;
@@ -108,6 +108,7 @@ TEST_F(OatTest, WriteRead) {
   ASSERT_EQ(42U, oat_header.GetImageFileLocationOatChecksum());
   ASSERT_EQ(4096U, oat_header.GetImageFileLocationOatDataBegin());
   ASSERT_EQ("lue.art", oat_header.GetImageFileLocation());
+  ASSERT_EQ(0U, oat_header.GetHotCodeEndOffset());  // No code order.
 
   const DexFile* dex_file = java_lang_dex_file_;
   uint32_t dex_file_checksum = dex_file->GetLocationChecksum();
@@ -143,7 +144,7 @@ TEST_F(OatTest, WriteRead) {
 TEST_F(OatTest, OatHeaderSizeCheck) {
   // If this test is failing and you have to update these constants,
   // it is time to update OatHeader::kOatVersion
-  EXPECT_EQ(64U, sizeof(OatHeader));
+  EXPECT_EQ(76U, sizeof(OatHeader));
   EXPECT_EQ(28U, sizeof(OatMethodOffsets));
 }
 
@@ -46,11 +46,14 @@ OatWriter::OatWriter(const std::vector<const DexFile*>& dex_files,
     image_file_location_oat_begin_(image_file_location_oat_begin),
     image_file_location_(image_file_location),
     oat_header_(NULL),
+    relative_call_thunk_offset_(0),
     size_dex_file_alignment_(0),
     size_executable_offset_alignment_(0),
     size_oat_header_(0),
     size_oat_header_image_file_location_(0),
     size_dex_file_(0),
+    size_lookup_table_alignment_(0),
+    size_lookup_table_(0),
     size_interpreter_to_interpreter_bridge_(0),
     size_interpreter_to_compiled_code_bridge_(0),
     size_jni_dlsym_lookup_(0),
@@ -59,6 +62,7 @@ OatWriter::OatWriter(const std::vector<const DexFile*>& dex_files,
     size_quick_resolution_trampoline_(0),
     size_quick_to_interpreter_bridge_(0),
     size_trampoline_alignment_(0),
+    size_relative_call_thunk_(0),
     size_code_size_(0),
     size_code_(0),
     size_code_alignment_(0),
@@ -69,14 +73,18 @@ OatWriter::OatWriter(const std::vector<const DexFile*>& dex_files,
     size_oat_dex_file_location_data_(0),
     size_oat_dex_file_location_checksum_(0),
     size_oat_dex_file_offset_(0),
+    size_oat_dex_file_lookup_table_offset_(0),
     size_oat_dex_file_methods_offsets_(0),
     size_oat_class_status_(0),
+    size_oat_class_methods_to_verify_(0),
     size_oat_class_method_offsets_(0) {
   size_t offset = InitOatHeader();
   offset = InitOatDexFiles(offset);
   offset = InitDexFiles(offset);
+  offset = InitLookupTables(offset);
   offset = InitOatClasses(offset);
   offset = InitOatCode(offset);
+  InitHotMethods();
   offset = InitOatCodeDexFiles(offset);
   size_ = offset;
 
@@ -97,6 +105,23 @@ size_t OatWriter::InitOatHeader() {
                               image_file_location_oat_checksum_,
                               image_file_location_oat_begin_,
                               image_file_location_);
+  if (compiler_driver_->GetMethodHooks()) {
+    oat_header_->SetMethodHooks();
+  }
+  const RelativeCalls& relative_calls = compiler_driver_->GetRelativeCallsToPatch();
+  if (!relative_calls.empty()) {
+    oat_header_->SetRelativeCalls();
+    for (size_t i = 0; i != relative_calls.size(); ++i) {
+      const CompilerDriver::PatchInformation* patch = relative_calls[i];
+      MethodReference referrer(&patch->GetDexFile(), patch->GetReferrerMethodIdx());
+      RelativeCallTable::iterator it = relative_calls_.find(referrer);
+      if (it == relative_calls_.end()) {
+        relative_calls_.Put(referrer, RelativeCalls());
+        it = relative_calls_.find(referrer);
+      }
+      it->second.push_back(patch);
+    }
+  }
   size_t offset = sizeof(*oat_header_);
   offset += image_file_location_.size();
   return offset;
@@ -131,6 +156,21 @@ size_t OatWriter::InitDexFiles(size_t offset) {
   return offset;
 }
 
+size_t OatWriter::InitLookupTables(size_t offset) {
+  for (size_t i = 0; i != dex_files_->size(); ++i) {
+    // dex files may end unaligned, the tables are read as words
+    size_t original_offset = offset;
+    offset = RoundUp(offset, 4);
+    size_lookup_table_alignment_ += offset - original_offset;
+
+    OatDexFile* oat_dex_file = oat_dex_files_[i];
+    oat_dex_file->lookup_table_offset_ = offset;
+    oat_dex_file->lookup_table_.reset(DexFileLookupTable::Create(*(*dex_files_)[i], true));
+    offset += oat_dex_file->lookup_table_->Size();
+  }
+  return offset;
+}
+
 size_t OatWriter::InitOatClasses(size_t offset) {
   // create the OatClasses
   // calculate the offsets within OatDexFiles to OatClasses
@@ -161,7 +201,26 @@ size_t OatWriter::InitOatClasses(size_t offset) {
         status = mirror::Class::kStatusNotReady;
       }
 
-      OatClass* oat_class = new OatClass(offset, status, num_methods);
+      // Only the methods that soft failed at compile time need to be verified again at runtime.
+      std::vector<uint32_t> methods_to_verify;
+      if (status == mirror::Class::kStatusRetryVerificationAtRuntime && class_data != NULL) {
+        methods_to_verify.resize(RoundUp(num_methods, 32) / 32);
+        ClassDataItemIterator it(*dex_file, class_data);
+        while (it.HasNextStaticField() || it.HasNextInstanceField()) {
+          it.Next();
+        }
+        size_t class_def_method_index = 0;
+        while (it.HasNextDirectMethod() || it.HasNextVirtualMethod()) {
+          MethodReference method_ref(dex_file, it.GetMemberIndex());
+          if (verifier::MethodVerifier::IsMethodSoftFailed(method_ref)) {
+            methods_to_verify[class_def_method_index / 32] |= 1U << (class_def_method_index % 32);
+          }
+          class_def_method_index++;
+          it.Next();
+        }
+      }
+
+      OatClass* oat_class = new OatClass(offset, status, num_methods, methods_to_verify);
       oat_classes_.push_back(oat_class);
       offset += oat_class->SizeOf();
     }
@@ -204,10 +263,67 @@ size_t OatWriter::InitOatCode(size_t offset) {
     oat_header_->SetQuickResolutionTrampolineOffset(0);
     oat_header_->SetQuickToInterpreterBridgeOffset(0);
   }
+  if (!relative_calls_.empty()) {
+    // Placed first so that the calls from the start of the code can reach it.
+    offset = CompiledCode::AlignCode(offset, kThumb2);
+    relative_call_thunk_offset_ = offset;
+    relative_call_thunk_.reset(compiler_driver_->CreateRelativeCallThunk());
+    offset += relative_call_thunk_->size();
+  }
   return offset;
 }
 
+void OatWriter::InitHotMethods() {
+  if (!compiler_driver_->HasCodeOrder()) {
+    return;
+  }
+  size_t oat_class_index = 0;
+  for (size_t i = 0; i != dex_files_->size(); ++i) {
+    const DexFile* dex_file = (*dex_files_)[i];
+    for (size_t class_def_index = 0;
+         class_def_index < dex_file->NumClassDefs();
+         class_def_index++, oat_class_index++) {
+      const DexFile::ClassDef& class_def = dex_file->GetClassDef(class_def_index);
+      const byte* class_data = dex_file->GetClassData(class_def);
+      if (class_data == NULL) {
+        continue;
+      }
+      ClassDataItemIterator it(*dex_file, class_data);
+      while (it.HasNextStaticField() || it.HasNextInstanceField()) {
+        it.Next();
+      }
+      for (size_t class_def_method_index = 0; it.HasNext(); class_def_method_index++, it.Next()) {
+        HotMethod method;
+        if (!compiler_driver_->GetCodeOrder(it.GetMemberIndex(), *dex_file, &method.position)) {
+          continue;
+        }
+        method.dex_file = dex_file;
+        method.oat_class_index = oat_class_index;
+        method.class_def_index = class_def_index;
+        method.class_def_method_index = class_def_method_index;
+        method.is_native = (it.GetMemberAccessFlags() & kAccNative) != 0;
+        method.is_static = it.HasNextDirectMethod() &&
+            (it.GetMemberAccessFlags() & kAccStatic) != 0;
+        method.invoke_type = it.GetMethodInvokeType(class_def);
+        method.method_idx = it.GetMemberIndex();
+        hot_methods_.push_back(method);
+        hot_method_indexes_.insert(std::make_pair(oat_class_index, class_def_method_index));
+      }
+    }
+  }
+  std::stable_sort(hot_methods_.begin(), hot_methods_.end(), HotMethod::ComesBefore);
+  VLOG(compiler) << "Laying out the code of " << hot_methods_.size() << " hot methods first";
+}
+
 size_t OatWriter::InitOatCodeDexFiles(size_t offset) {
+  for (const HotMethod& method : hot_methods_) {
+    offset = InitOatCodeMethod(offset, method.oat_class_index, method.class_def_index,
+                               method.class_def_method_index, method.is_native,
+                               method.invoke_type, method.method_idx, method.dex_file);
+  }
+  if (!hot_methods_.empty()) {
+    oat_header_->SetHotCodeEndOffset(offset);
+  }
   size_t oat_class_index = 0;
   for (size_t i = 0; i != dex_files_->size(); ++i) {
     const DexFile* dex_file = (*dex_files_)[i];
@@ -253,17 +369,21 @@ size_t OatWriter::InitOatCodeClassDef(size_t offset,
   size_t class_def_method_index = 0;
   while (it.HasNextDirectMethod()) {
     bool is_native = (it.GetMemberAccessFlags() & kAccNative) != 0;
-    offset = InitOatCodeMethod(offset, oat_class_index, class_def_index, class_def_method_index,
-                               is_native, it.GetMethodInvokeType(class_def), it.GetMemberIndex(),
-                               &dex_file);
+    if (!IsHotMethod(oat_class_index, class_def_method_index)) {
+      offset = InitOatCodeMethod(offset, oat_class_index, class_def_index, class_def_method_index,
+                                 is_native, it.GetMethodInvokeType(class_def), it.GetMemberIndex(),
+                                 &dex_file);
+    }
     class_def_method_index++;
     it.Next();
   }
   while (it.HasNextVirtualMethod()) {
     bool is_native = (it.GetMemberAccessFlags() & kAccNative) != 0;
-    offset = InitOatCodeMethod(offset, oat_class_index, class_def_index, class_def_method_index,
-                               is_native, it.GetMethodInvokeType(class_def), it.GetMemberIndex(),
-                               &dex_file);
+    if (!IsHotMethod(oat_class_index, class_def_method_index)) {
+      offset = InitOatCodeMethod(offset, oat_class_index, class_def_index, class_def_method_index,
+                                 is_native, it.GetMethodInvokeType(class_def), it.GetMemberIndex(),
+                                 &dex_file);
+    }
     class_def_method_index++;
     it.Next();
   }
@@ -299,7 +419,7 @@ size_t OatWriter::InitOatCodeMethod(size_t offset, size_t oat_class_index,
     compiled_method->AddOatdataOffsetToCompliledCodeOffset(
         oat_method_offsets_offset + OFFSETOF_MEMBER(OatMethodOffsets, code_offset_));
 #else
-    const std::vector<uint8_t>& code = compiled_method->GetCode();
+    const SwapVector<uint8_t>& code = compiled_method->GetCode();
     offset = compiled_method->AlignCode(offset);
     DCHECK_ALIGNED(offset, kArmAlignment);
     uint32_t code_size = code.size() * sizeof(code[0]);
@@ -307,27 +427,34 @@ size_t OatWriter::InitOatCodeMethod(size_t offset, size_t oat_class_index,
     uint32_t thumb_offset = compiled_method->CodeDelta();
     code_offset = offset + sizeof(code_size) + thumb_offset;
 
-    // Deduplicate code arrays
-    SafeMap<const std::vector<uint8_t>*, uint32_t>::iterator code_iter = code_offsets_.find(&code);
+    // Deduplicate code arrays, except for code with relative calls which depends on where it is
+    bool has_relative_calls = GetRelativeCalls(MethodReference(dex_file, method_idx)) != NULL;
+    SafeMap<const SwapVector<uint8_t>*, uint32_t>::iterator code_iter =
+        has_relative_calls ? code_offsets_.end() : code_offsets_.find(&code);
     if (code_iter != code_offsets_.end()) {
       code_offset = code_iter->second;
     } else {
-      code_offsets_.Put(&code, code_offset);
+      if (!has_relative_calls) {
+        code_offsets_.Put(&code, code_offset);
+      }
       offset += sizeof(code_size);  // code size is prepended before code
       offset += code_size;
       oat_header_->UpdateChecksum(&code[0], code_size);
     }
+    if (!relative_calls_.empty()) {
+      method_code_offsets_.Put(MethodReference(dex_file, method_idx), code_offset);
+    }
 #endif
     frame_size_in_bytes = compiled_method->GetFrameSizeInBytes();
     core_spill_mask = compiled_method->GetCoreSpillMask();
     fp_spill_mask = compiled_method->GetFpSpillMask();
 
-    const std::vector<uint8_t>& mapping_table = compiled_method->GetMappingTable();
+    const SwapVector<uint8_t>& mapping_table = compiled_method->GetMappingTable();
     size_t mapping_table_size = mapping_table.size() * sizeof(mapping_table[0]);
     mapping_table_offset = (mapping_table_size == 0) ? 0 : offset;
 
     // Deduplicate mapping tables
-    SafeMap<const std::vector<uint8_t>*, uint32_t>::iterator mapping_iter =
+    SafeMap<const SwapVector<uint8_t>*, uint32_t>::iterator mapping_iter =
         mapping_table_offsets_.find(&mapping_table);
     if (mapping_iter != mapping_table_offsets_.end()) {
       mapping_table_offset = mapping_iter->second;
@@ -337,12 +464,12 @@ size_t OatWriter::InitOatCodeMethod(size_t offset, size_t oat_class_index,
       oat_header_->UpdateChecksum(&mapping_table[0], mapping_table_size);
     }
 
-    const std::vector<uint8_t>& vmap_table = compiled_method->GetVmapTable();
+    const SwapVector<uint8_t>& vmap_table = compiled_method->GetVmapTable();
     size_t vmap_table_size = vmap_table.size() * sizeof(vmap_table[0]);
     vmap_table_offset = (vmap_table_size == 0) ? 0 : offset;
 
     // Deduplicate vmap tables
-    SafeMap<const std::vector<uint8_t>*, uint32_t>::iterator vmap_iter =
+    SafeMap<const SwapVector<uint8_t>*, uint32_t>::iterator vmap_iter =
         vmap_table_offsets_.find(&vmap_table);
     if (vmap_iter != vmap_table_offsets_.end()) {
       vmap_table_offset = vmap_iter->second;
@@ -352,7 +479,7 @@ size_t OatWriter::InitOatCodeMethod(size_t offset, size_t oat_class_index,
       oat_header_->UpdateChecksum(&vmap_table[0], vmap_table_size);
     }
 
-    const std::vector<uint8_t>& gc_map = compiled_method->GetGcMap();
+    const SwapVector<uint8_t>& gc_map = compiled_method->GetGcMap();
     size_t gc_map_size = gc_map.size() * sizeof(gc_map[0]);
     gc_map_offset = (gc_map_size == 0) ? 0 : offset;
 
@@ -375,7 +502,7 @@ size_t OatWriter::InitOatCodeMethod(size_t offset, size_t oat_class_index,
 #endif
 
     // Deduplicate GC maps
-    SafeMap<const std::vector<uint8_t>*, uint32_t>::iterator gc_map_iter =
+    SafeMap<const SwapVector<uint8_t>*, uint32_t>::iterator gc_map_iter =
         gc_map_offsets_.find(&gc_map);
     if (gc_map_iter != gc_map_offsets_.end()) {
       gc_map_offset = gc_map_iter->second;
@@ -472,6 +599,8 @@ bool OatWriter::Write(OutputStream& out) {
     DO_STAT(size_oat_header_);
     DO_STAT(size_oat_header_image_file_location_);
     DO_STAT(size_dex_file_);
+    DO_STAT(size_lookup_table_alignment_);
+    DO_STAT(size_lookup_table_);
     DO_STAT(size_interpreter_to_interpreter_bridge_);
     DO_STAT(size_interpreter_to_compiled_code_bridge_);
     DO_STAT(size_jni_dlsym_lookup_);
@@ -480,6 +609,7 @@ bool OatWriter::Write(OutputStream& out) {
     DO_STAT(size_quick_resolution_trampoline_);
     DO_STAT(size_quick_to_interpreter_bridge_);
     DO_STAT(size_trampoline_alignment_);
+    DO_STAT(size_relative_call_thunk_);
     DO_STAT(size_code_size_);
     DO_STAT(size_code_);
     DO_STAT(size_code_alignment_);
@@ -490,8 +620,10 @@ bool OatWriter::Write(OutputStream& out) {
     DO_STAT(size_oat_dex_file_location_data_);
     DO_STAT(size_oat_dex_file_location_checksum_);
     DO_STAT(size_oat_dex_file_offset_);
+    DO_STAT(size_oat_dex_file_lookup_table_offset_);
     DO_STAT(size_oat_dex_file_methods_offsets_);
     DO_STAT(size_oat_class_status_);
+    DO_STAT(size_oat_class_methods_to_verify_);
     DO_STAT(size_oat_class_method_offsets_);
     #undef DO_STAT
 
@@ -530,6 +662,24 @@ bool OatWriter::WriteTables(OutputStream& out, const size_t file_offset) {
     }
     size_dex_file_ += dex_file->GetHeader().file_size_;
   }
+  for (size_t i = 0; i != oat_dex_files_.size(); ++i) {
+    const OatDexFile* oat_dex_file = oat_dex_files_[i];
+    uint32_t expected_offset = file_offset + oat_dex_file->lookup_table_offset_;
+    off_t actual_offset = out.Seek(expected_offset, kSeekSet);
+    if (static_cast<uint32_t>(actual_offset) != expected_offset) {
+      PLOG(ERROR) << "Failed to seek to lookup table section. Actual: " << actual_offset
+                  << " Expected: " << expected_offset
+                  << " File: " << (*dex_files_)[i]->GetLocation();
+      return false;
+    }
+    const DexFileLookupTable* lookup_table = oat_dex_file->lookup_table_.get();
+    if (!out.WriteFully(lookup_table->Data(), lookup_table->Size())) {
+      PLOG(ERROR) << "Failed to write lookup table for " << (*dex_files_)[i]->GetLocation()
+                  << " to " << out.GetLocation();
+      return false;
+    }
+    size_lookup_table_ += lookup_table->Size();
+  }
   for (size_t i = 0; i != oat_classes_.size(); ++i) {
     if (!oat_classes_[i]->Write(this, out, file_offset)) {
       PLOG(ERROR) << "Failed to write oat methods information to " << out.GetLocation();
@@ -576,12 +726,32 @@ size_t OatWriter::WriteCode(OutputStream& out, const size_t file_offset) {
     DO_TRAMPOLINE(quick_to_interpreter_bridge_);
     #undef DO_TRAMPOLINE
   }
+  if (relative_call_thunk_.get() != NULL) {
+    uint32_t alignment_padding = relative_call_thunk_offset_ - relative_offset;
+    out.Seek(alignment_padding, kSeekCurrent);
+    size_trampoline_alignment_ += alignment_padding;
+    if (!out.WriteFully(&(*relative_call_thunk_)[0], relative_call_thunk_->size())) {
+      PLOG(ERROR) << "Failed to write relative call thunk to " << out.GetLocation();
+      return 0;
+    }
+    size_relative_call_thunk_ += relative_call_thunk_->size();
+    relative_offset += alignment_padding + relative_call_thunk_->size();
+    DCHECK_OFFSET();
+  }
   return relative_offset;
 }
 
 size_t OatWriter::WriteCodeDexFiles(OutputStream& out,
                                     const size_t file_offset,
                                     size_t relative_offset) {
+  for (const HotMethod& method : hot_methods_) {
+    relative_offset = WriteCodeMethod(out, file_offset, relative_offset, method.oat_class_index,
+                                      method.class_def_method_index, method.is_static,
+                                      method.method_idx, *method.dex_file);
+    if (relative_offset == 0) {
+      return 0;
+    }
+  }
   size_t oat_class_index = 0;
   for (size_t i = 0; i != oat_dex_files_.size(); ++i) {
     const DexFile* dex_file = (*dex_files_)[i];
@@ -610,6 +780,40 @@ size_t OatWriter::WriteCodeDexFile(OutputStream& out, const size_t file_offset,
   return relative_offset;
 }
 
+void OatWriter::PatchRelativeCalls(std::vector<uint8_t>* code, uint32_t code_offset,
+                                   const RelativeCalls& relative_calls) const {
+  for (size_t i = 0; i != relative_calls.size(); ++i) {
+    const CompilerDriver::PatchInformation* patch = relative_calls[i];
+    MethodReference target(&patch->GetDexFile(), patch->GetTargetMethodIdx());
+    // Calls to methods without compiled code go through the thunk, which calls the entry point.
+    uint32_t target_offset = relative_call_thunk_offset_;
+    SafeMap<const MethodReference, uint32_t, MethodReferenceComparator>::const_iterator it =
+        method_code_offsets_.find(target);
+    if (it != method_code_offsets_.end()) {
+      target_offset = it->second & ~1U;
+    }
+    size_t literal_offset = patch->GetLiteralOffset();
+    uint8_t* insns = &(*code)[literal_offset];
+    DCHECK(insns[0] == 0x00 && insns[1] == 0xf0 && insns[2] == 0x00 && insns[3] == 0xf8)
+        << PrettyMethod(patch->GetReferrerMethodIdx(), patch->GetDexFile());
+    // The pc of a Thumb2 bl reads as its address plus 4, and the bl reaches +-16MB.
+    int32_t displacement = target_offset - (code_offset + literal_offset + 4);
+    CHECK(IsInt(25, displacement))
+        << "Relative call from " << PrettyMethod(patch->GetReferrerMethodIdx(), patch->GetDexFile())
+        << " to " << PrettyMethod(patch->GetTargetMethodIdx(), patch->GetDexFile())
+        << " is out of range, recompile without --relative-calls";
+    uint32_t s = (displacement >> 24) & 1;
+    uint32_t j1 = (~(displacement >> 23) ^ s) & 1;
+    uint32_t j2 = (~(displacement >> 22) ^ s) & 1;
+    uint16_t hi = 0xf000 | (s << 10) | ((displacement >> 12) & 0x3ff);
+    uint16_t lo = 0xd000 | (j1 << 13) | (j2 << 11) | ((displacement >> 1) & 0x7ff);
+    insns[0] = hi & 0xff;
+    insns[1] = hi >> 8;
+    insns[2] = lo & 0xff;
+    insns[3] = lo >> 8;
+  }
+}
+
 void OatWriter::ReportWriteFailure(const char* what, uint32_t method_idx,
                                    const DexFile& dex_file, OutputStream& out) const {
   PLOG(ERROR) << "Failed to write " << what << " for " << PrettyMethod(method_idx, dex_file)
@@ -639,9 +843,11 @@ size_t OatWriter::WriteCodeClassDef(OutputStream& out,
   size_t class_def_method_index = 0;
   while (it.HasNextDirectMethod()) {
     bool is_static = (it.GetMemberAccessFlags() & kAccStatic) != 0;
-    relative_offset = WriteCodeMethod(out, file_offset, relative_offset, oat_class_index,
-                                      class_def_method_index, is_static, it.GetMemberIndex(),
-                                      dex_file);
+    if (!IsHotMethod(oat_class_index, class_def_method_index)) {
+      relative_offset = WriteCodeMethod(out, file_offset, relative_offset, oat_class_index,
+                                        class_def_method_index, is_static, it.GetMemberIndex(),
+                                        dex_file);
+    }
     if (relative_offset == 0) {
       return 0;
     }
@@ -649,8 +855,11 @@ size_t OatWriter::WriteCodeClassDef(OutputStream& out,
     it.Next();
   }
   while (it.HasNextVirtualMethod()) {
-    relative_offset = WriteCodeMethod(out, file_offset, relative_offset, oat_class_index,
-                                      class_def_method_index, false, it.GetMemberIndex(), dex_file);
+    if (!IsHotMethod(oat_class_index, class_def_method_index)) {
+      relative_offset = WriteCodeMethod(out, file_offset, relative_offset, oat_class_index,
+                                        class_def_method_index, false, it.GetMemberIndex(),
+                                        dex_file);
+    }
     if (relative_offset == 0) {
       return 0;
     }
@@ -688,13 +897,15 @@ size_t OatWriter::WriteCodeMethod(OutputStream& out, const size_t file_offset,
       DCHECK_OFFSET();
     }
     DCHECK_ALIGNED(relative_offset, kArmAlignment);
-    const std::vector<uint8_t>& code = compiled_method->GetCode();
+    const SwapVector<uint8_t>& code = compiled_method->GetCode();
     uint32_t code_size = code.size() * sizeof(code[0]);
     CHECK_NE(code_size, 0U);
 
     // Deduplicate code arrays
     size_t code_offset = relative_offset + sizeof(code_size) + compiled_method->CodeDelta();
-    SafeMap<const std::vector<uint8_t>*, uint32_t>::iterator code_iter = code_offsets_.find(&code);
+    const RelativeCalls* relative_calls = GetRelativeCalls(MethodReference(&dex_file, method_idx));
+    SafeMap<const SwapVector<uint8_t>*, uint32_t>::iterator code_iter =
+        (relative_calls != NULL) ? code_offsets_.end() : code_offsets_.find(&code);
     if (code_iter != code_offsets_.end() && code_offset != method_offsets.code_offset_) {
       DCHECK(code_iter->second == method_offsets.code_offset_)
           << PrettyMethod(method_idx, dex_file);
@@ -707,7 +918,15 @@ size_t OatWriter::WriteCodeMethod(OutputStream& out, const size_t file_offset,
       size_code_size_ += sizeof(code_size);
       relative_offset += sizeof(code_size);
       DCHECK_OFFSET();
-      if (!out.WriteFully(&code[0], code_size)) {
+      bool written;
+      if (relative_calls != NULL) {
+        std::vector<uint8_t> patched_code(code.begin(), code.end());
+        PatchRelativeCalls(&patched_code, relative_offset, *relative_calls);
+        written = out.WriteFully(&patched_code[0], code_size);
+      } else {
+        written = out.WriteFully(&code[0], code_size);
+      }
+      if (!written) {
         ReportWriteFailure("method code", method_idx, dex_file, out);
         return 0;
       }
@@ -717,11 +936,11 @@ size_t OatWriter::WriteCodeMethod(OutputStream& out, const size_t file_offset,
     DCHECK_OFFSET();
 #endif
 
-    const std::vector<uint8_t>& mapping_table = compiled_method->GetMappingTable();
+    const SwapVector<uint8_t>& mapping_table = compiled_method->GetMappingTable();
     size_t mapping_table_size = mapping_table.size() * sizeof(mapping_table[0]);
 
     // Deduplicate mapping tables
-    SafeMap<const std::vector<uint8_t>*, uint32_t>::iterator mapping_iter =
+    SafeMap<const SwapVector<uint8_t>*, uint32_t>::iterator mapping_iter =
         mapping_table_offsets_.find(&mapping_table);
     if (mapping_iter != mapping_table_offsets_.end() &&
         relative_offset != method_offsets.mapping_table_offset_) {
@@ -741,11 +960,11 @@ size_t OatWriter::WriteCodeMethod(OutputStream& out, const size_t file_offset,
     }
     DCHECK_OFFSET();
 
-    const std::vector<uint8_t>& vmap_table = compiled_method->GetVmapTable();
+    const SwapVector<uint8_t>& vmap_table = compiled_method->GetVmapTable();
     size_t vmap_table_size = vmap_table.size() * sizeof(vmap_table[0]);
 
     // Deduplicate vmap tables
-    SafeMap<const std::vector<uint8_t>*, uint32_t>::iterator vmap_iter =
+    SafeMap<const SwapVector<uint8_t>*, uint32_t>::iterator vmap_iter =
         vmap_table_offsets_.find(&vmap_table);
     if (vmap_iter != vmap_table_offsets_.end() &&
         relative_offset != method_offsets.vmap_table_offset_) {
@@ -765,11 +984,11 @@ size_t OatWriter::WriteCodeMethod(OutputStream& out, const size_t file_offset,
     }
     DCHECK_OFFSET();
 
-    const std::vector<uint8_t>& gc_map = compiled_method->GetGcMap();
+    const SwapVector<uint8_t>& gc_map = compiled_method->GetGcMap();
     size_t gc_map_size = gc_map.size() * sizeof(gc_map[0]);
 
     // Deduplicate GC maps
-    SafeMap<const std::vector<uint8_t>*, uint32_t>::iterator gc_map_iter =
+    SafeMap<const SwapVector<uint8_t>*, uint32_t>::iterator gc_map_iter =
         gc_map_offsets_.find(&gc_map);
     if (gc_map_iter != gc_map_offsets_.end() &&
         relative_offset != method_offsets.gc_map_offset_) {
@@ -800,6 +1019,7 @@ OatWriter::OatDexFile::OatDexFile(size_t offset, const DexFile& dex_file) {
   dex_file_location_data_ = reinterpret_cast<const uint8_t*>(location.data());
   dex_file_location_checksum_ = dex_file.GetLocationChecksum();
   dex_file_offset_ = 0;
+  lookup_table_offset_ = 0;
   methods_offsets_.resize(dex_file.NumClassDefs());
 }
 
@@ -808,6 +1028,7 @@ size_t OatWriter::OatDexFile::SizeOf() const {
           + dex_file_location_size_
           + sizeof(dex_file_location_checksum_)
           + sizeof(dex_file_offset_)
+          + sizeof(lookup_table_offset_)
           + (sizeof(methods_offsets_[0]) * methods_offsets_.size());
 }
 
@@ -816,6 +1037,8 @@ void OatWriter::OatDexFile::UpdateChecksum(OatHeader& oat_header) const {
   oat_header.UpdateChecksum(dex_file_location_data_, dex_file_location_size_);
   oat_header.UpdateChecksum(&dex_file_location_checksum_, sizeof(dex_file_location_checksum_));
   oat_header.UpdateChecksum(&dex_file_offset_, sizeof(dex_file_offset_));
+  oat_header.UpdateChecksum(&lookup_table_offset_, sizeof(lookup_table_offset_));
+  oat_header.UpdateChecksum(lookup_table_->Data(), lookup_table_->Size());
   oat_header.UpdateChecksum(&methods_offsets_[0],
                             sizeof(methods_offsets_[0]) * methods_offsets_.size());
 }
@@ -844,6 +1067,11 @@ bool OatWriter::OatDexFile::Write(OatWriter* oat_writer,
     return false;
   }
   oat_writer->size_oat_dex_file_offset_ += sizeof(dex_file_offset_);
+  if (!out.WriteFully(&lookup_table_offset_, sizeof(lookup_table_offset_))) {
+    PLOG(ERROR) << "Failed to write lookup table offset to " << out.GetLocation();
+    return false;
+  }
+  oat_writer->size_oat_dex_file_lookup_table_offset_ += sizeof(lookup_table_offset_);
   if (!out.WriteFully(&methods_offsets_[0],
                       sizeof(methods_offsets_[0]) * methods_offsets_.size())) {
     PLOG(ERROR) << "Failed to write methods offsets to " << out.GetLocation();
@@ -854,10 +1082,14 @@ bool OatWriter::OatDexFile::Write(OatWriter* oat_writer,
   return true;
 }
 
-OatWriter::OatClass::OatClass(size_t offset, mirror::Class::Status status, uint32_t methods_count) {
+OatWriter::OatClass::OatClass(size_t offset, mirror::Class::Status status, uint32_t methods_count,
+                              const std::vector<uint32_t>& methods_to_verify)
+    : methods_to_verify_(methods_to_verify) {
   offset_ = offset;
   status_ = status;
   method_offsets_.resize(methods_count);
+  DCHECK(methods_to_verify_.empty() ||
+         status_ == mirror::Class::kStatusRetryVerificationAtRuntime);
 }
 
 size_t OatWriter::OatClass::GetOatMethodOffsetsOffsetFromOatHeader(
@@ -868,15 +1100,29 @@ size_t OatWriter::OatClass::GetOatMethodOffsetsOffsetFromOatHeader(
 size_t OatWriter::OatClass::GetOatMethodOffsetsOffsetFromOatClass(
     size_t class_def_method_index_) const {
   return sizeof(status_)
+          + GetMethodsToVerifySize()
           + (sizeof(method_offsets_[0]) * class_def_method_index_);
 }
 
+size_t OatWriter::OatClass::GetMethodsToVerifySize() const {
+  if (status_ != mirror::Class::kStatusRetryVerificationAtRuntime) {
+    return 0;
+  }
+  return sizeof(uint32_t) + (sizeof(methods_to_verify_[0]) * methods_to_verify_.size());
+}
+
 size_t OatWriter::OatClass::SizeOf() const {
   return GetOatMethodOffsetsOffsetFromOatClass(method_offsets_.size());
 }
 
 void OatWriter::OatClass::UpdateChecksum(OatHeader& oat_header) const {
   oat_header.UpdateChecksum(&status_, sizeof(status_));
+  if (status_ == mirror::Class::kStatusRetryVerificationAtRuntime) {
+    uint32_t methods_to_verify_size = methods_to_verify_.size();
+    oat_header.UpdateChecksum(&methods_to_verify_size, sizeof(methods_to_verify_size));
+    oat_header.UpdateChecksum(&methods_to_verify_[0],
+                              sizeof(methods_to_verify_[0]) * methods_to_verify_.size());
+  }
   oat_header.UpdateChecksum(&method_offsets_[0],
                             sizeof(method_offsets_[0]) * method_offsets_.size());
 }
@@ -890,6 +1136,19 @@ bool OatWriter::OatClass::Write(OatWriter* oat_writer,
     return false;
   }
   oat_writer->size_oat_class_status_ += sizeof(status_);
+  if (status_ == mirror::Class::kStatusRetryVerificationAtRuntime) {
+    uint32_t methods_to_verify_size = methods_to_verify_.size();
+    if (!out.WriteFully(&methods_to_verify_size, sizeof(methods_to_verify_size))) {
+      PLOG(ERROR) << "Failed to write methods to verify size to " << out.GetLocation();
+      return false;
+    }
+    if (!out.WriteFully(&methods_to_verify_[0],
+                        sizeof(methods_to_verify_[0]) * methods_to_verify_.size())) {
+      PLOG(ERROR) << "Failed to write methods to verify to " << out.GetLocation();
+      return false;
+    }
+    oat_writer->size_oat_class_methods_to_verify_ += GetMethodsToVerifySize();
+  }
   DCHECK_EQ(static_cast<off_t>(file_offset + GetOatMethodOffsetsOffsetFromOatHeader(0)),
             out.Seek(0, kSeekCurrent));
   if (!out.WriteFully(&method_offsets_[0],
@@ -20,8 +20,12 @@
 #include <stdint.h>
 
 #include <cstddef>
+#include <set>
+#include <utility>
+#include <vector>
 
 #include "driver/compiler_driver.h"
+#include "dex_file_lookup_table.h"
 #include "mem_map.h"
 #include "oat.h"
 #include "mirror/class.h"
@@ -44,15 +48,23 @@ class OutputStream;
 // ...
 // Dex[D]
 //
+// LookupTable[0]    one DexFileLookupTable for each DexFile, indexing class descriptors and
+// LookupTable[1]    strings.
+// ...
+// LookupTable[D]
+//
 // OatClass[0]       one variable sized OatClass for each of C DexFile::ClassDefs
 // OatClass[1]       contains OatClass entries with class status, offsets to code, etc.
+//                   classes to verify again at runtime also list the methods that need it.
 // ...
 // OatClass[C]
 //
 // padding           if necessary so that the following code will be page aligned
 //
-// CompiledMethod    one variable sized blob with the contents of each CompiledMethod
-// CompiledMethod
+// thunk             for relative calls to methods without code, only when there are any
+//
+// CompiledMethod    one variable sized blob with the contents of each CompiledMethod, the
+// CompiledMethod    methods of the compiler driver's code order first and in that order
 // CompiledMethod
 // CompiledMethod
 // CompiledMethod
@@ -84,9 +96,11 @@ class OatWriter {
   size_t InitOatHeader();
   size_t InitOatDexFiles(size_t offset);
   size_t InitDexFiles(size_t offset);
+  size_t InitLookupTables(size_t offset);
   size_t InitOatClasses(size_t offset);
   size_t InitOatCode(size_t offset)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  void InitHotMethods();
   size_t InitOatCodeDexFiles(size_t offset)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   size_t InitOatCodeDexFile(size_t offset,
@@ -115,15 +129,35 @@ class OatWriter {
                          size_t oat_class_index, size_t class_def_method_index, bool is_static,
                          uint32_t method_idx, const DexFile& dex_file);
 
+  bool IsHotMethod(size_t oat_class_index, size_t class_def_method_index) const {
+    return hot_method_indexes_.find(std::make_pair(oat_class_index, class_def_method_index)) !=
+        hot_method_indexes_.end();
+  }
+
   void ReportWriteFailure(const char* what, uint32_t method_idx, const DexFile& dex_file,
                           OutputStream& out) const;
 
+  typedef std::vector<const CompilerDriver::PatchInformation*> RelativeCalls;
+
+  // The relative calls the compiled code of the method makes, or NULL if it makes none.
+  const RelativeCalls* GetRelativeCalls(const MethodReference& ref) const {
+    RelativeCallTable::const_iterator it = relative_calls_.find(ref);
+    return (it != relative_calls_.end()) ? &it->second : NULL;
+  }
+
+  // Fills in the displacements of the relative calls of code that starts at code_offset.
+  void PatchRelativeCalls(std::vector<uint8_t>* code, uint32_t code_offset,
+                          const RelativeCalls& relative_calls) const;
+
   class OatDexFile {
    public:
     explicit OatDexFile(size_t offset, const DexFile& dex_file);
     size_t SizeOf() const;
     void UpdateChecksum(OatHeader& oat_header) const;
     bool Write(OatWriter* oat_writer, OutputStream& out, const size_t file_offset) const;
+    // Size of the word count and bitmap of methods to verify, only present for classes that
+    // have to be verified again at runtime.
+    size_t GetMethodsToVerifySize() const;
 
     // Offset of start of OatDexFile from beginning of OatHeader. It is
     // used to validate file position when writing.
@@ -134,20 +168,27 @@ class OatWriter {
     const uint8_t* dex_file_location_data_;
     uint32_t dex_file_location_checksum_;
     uint32_t dex_file_offset_;
+    uint32_t lookup_table_offset_;
     std::vector<uint32_t> methods_offsets_;
 
+    UniquePtr<const DexFileLookupTable> lookup_table_;
+
    private:
     DISALLOW_COPY_AND_ASSIGN(OatDexFile);
   };
 
   class OatClass {
    public:
-    explicit OatClass(size_t offset, mirror::Class::Status status, uint32_t methods_count);
+    OatClass(size_t offset, mirror::Class::Status status, uint32_t methods_count,
+             const std::vector<uint32_t>& methods_to_verify);
     size_t GetOatMethodOffsetsOffsetFromOatHeader(size_t class_def_method_index_) const;
     size_t GetOatMethodOffsetsOffsetFromOatClass(size_t class_def_method_index_) const;
     size_t SizeOf() const;
     void UpdateChecksum(OatHeader& oat_header) const;
     bool Write(OatWriter* oat_writer, OutputStream& out, const size_t file_offset) const;
+    // Size of the word count and bitmap of methods to verify, only present for classes that
+    // have to be verified again at runtime.
+    size_t GetMethodsToVerifySize() const;
 
     // Offset of start of OatClass from beginning of OatHeader. It is
     // used to validate file position when writing. For Portable, it
@@ -158,6 +199,8 @@ class OatWriter {
 
     // data to write
     mirror::Class::Status status_;
+    // Bit i is set if the method at class def method index i soft failed verification.
+    std::vector<uint32_t> methods_to_verify_;
     std::vector<OatMethodOffsets> method_offsets_;
 
    private:
@@ -188,6 +231,8 @@ class OatWriter {
   UniquePtr<const std::vector<uint8_t> > portable_to_interpreter_bridge_;
   UniquePtr<const std::vector<uint8_t> > quick_resolution_trampoline_;
   UniquePtr<const std::vector<uint8_t> > quick_to_interpreter_bridge_;
+  UniquePtr<const std::vector<uint8_t> > relative_call_thunk_;
+  uint32_t relative_call_thunk_offset_;
 
   // output stats
   uint32_t size_dex_file_alignment_;
@@ -195,6 +240,8 @@ class OatWriter {
   uint32_t size_oat_header_;
   uint32_t size_oat_header_image_file_location_;
   uint32_t size_dex_file_;
+  uint32_t size_lookup_table_alignment_;
+  uint32_t size_lookup_table_;
   uint32_t size_interpreter_to_interpreter_bridge_;
   uint32_t size_interpreter_to_compiled_code_bridge_;
   uint32_t size_jni_dlsym_lookup_;
@@ -203,6 +250,7 @@ class OatWriter {
   uint32_t size_quick_resolution_trampoline_;
   uint32_t size_quick_to_interpreter_bridge_;
   uint32_t size_trampoline_alignment_;
+  uint32_t size_relative_call_thunk_;
   uint32_t size_code_size_;
   uint32_t size_code_;
   uint32_t size_code_alignment_;
@@ -213,16 +261,46 @@ class OatWriter {
   uint32_t size_oat_dex_file_location_data_;
   uint32_t size_oat_dex_file_location_checksum_;
   uint32_t size_oat_dex_file_offset_;
+  uint32_t size_oat_dex_file_lookup_table_offset_;
   uint32_t size_oat_dex_file_methods_offsets_;
   uint32_t size_oat_class_status_;
+  uint32_t size_oat_class_methods_to_verify_;
   uint32_t size_oat_class_method_offsets_;
 
+  // A method in the compiler driver's code order, whose code is laid out before the others.
+  struct HotMethod {
+    size_t position;
+    const DexFile* dex_file;
+    size_t oat_class_index;
+    size_t class_def_index;
+    size_t class_def_method_index;
+    bool is_native;
+    bool is_static;
+    InvokeType invoke_type;
+    uint32_t method_idx;
+
+    static bool ComesBefore(const HotMethod& lhs, const HotMethod& rhs) {
+      return lhs.position < rhs.position;
+    }
+  };
+
+  // The relative calls of each method, and the code offset of every compiled method which the
+  // calls are patched to branch to.
+  typedef SafeMap<const MethodReference, RelativeCalls, MethodReferenceComparator>
+      RelativeCallTable;
+  RelativeCallTable relative_calls_;
+  SafeMap<const MethodReference, uint32_t, MethodReferenceComparator> method_code_offsets_;
+
+  // The hot methods in code order, and their oat class and class def method indexes.
+  std::vector<HotMethod> hot_methods_;
+  std::set<std::pair<size_t, size_t> > hot_method_indexes_;
+
   // Code mappings for deduplication. Deduplication is already done on a pointer basis by the
   // compiler driver, so we can simply compare the pointers to find out if things are duplicated.
-  SafeMap<const std::vector<uint8_t>*, uint32_t> code_offsets_;
-  SafeMap<const std::vector<uint8_t>*, uint32_t> vmap_table_offsets_;
-  SafeMap<const std::vector<uint8_t>*, uint32_t> mapping_table_offsets_;
-  SafeMap<const std::vector<uint8_t>*, uint32_t> gc_map_offsets_;
+  SafeMap<const SwapVector<uint8_t>*, uint32_t> code_offsets_;
+  SafeMap<const SwapVector<uint8_t>*, uint32_t> vmap_table_offsets_;
+  SafeMap<const SwapVector<uint8_t>*, uint32_t> mapping_table_offsets_;
+  SafeMap<const SwapVector<uint8_t>*, uint32_t> gc_map_offsets_;
 
   DISALLOW_COPY_AND_ASSIGN(OatWriter);
 };
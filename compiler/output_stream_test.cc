@@ -78,6 +78,7 @@ TEST_F(OutputStreamTest, Buffered) {
   BufferedOutputStream buffered_output_stream(file_output_stream.release());
   SetOutputStream(buffered_output_stream);
   GenerateTestOutput();
+  EXPECT_TRUE(buffered_output_stream.Flush());
   UniquePtr<File> in(OS::OpenFileForReading(tmp.GetFilename().c_str()));
   EXPECT_TRUE(in.get() != NULL);
   std::vector<uint8_t> actual(in->GetLength());
@@ -27,6 +27,11 @@
 namespace sea_ir {
 
 void CodeGenPrepassVisitor::Visit(PhiInstructionNode* phi) {
+  if (phi->IsFoldedConstant()) {
+    llvm_data_->AddValue(phi, llvm::ConstantInt::get(*llvm_data_->context_,
+        llvm::APInt(32, phi->GetFoldedConstant())));
+    return;
+  }
   Region* r = phi->GetRegion();
   const std::vector<Region*>* predecessors = r->GetPredecessors();
   DCHECK(NULL != predecessors);
@@ -116,6 +121,11 @@ void CodeGenVisitor::Visit(Region* region) {
 
 
 void CodeGenVisitor::Visit(InstructionNode* instruction) {
+  if (instruction->IsFoldedConstant()) {
+    llvm_data_->AddValue(instruction, llvm::ConstantInt::get(*llvm_data_->context_,
+        llvm::APInt(32, instruction->GetFoldedConstant())));
+    return;
+  }
   std::string instr = instruction->GetInstruction()->DumpString(NULL);
   DCHECK(0);  // This whole function is useful only during development.
 }
@@ -143,6 +153,13 @@ void CodeGenVisitor::Visit(ReturnInstructionNode* instruction) {
 void CodeGenVisitor::Visit(IfNeInstructionNode* instruction) {
   std::string instr = instruction->GetInstruction()->DumpString(NULL);
   std::cout << "3.Instruction: " << instr << std::endl;
+  DCHECK(instruction->GetRegion() != NULL);
+  if (instruction->GetRegion()->GetSuccessors()->size() == 1) {
+    // Constant propagation removed the edge that is never taken.
+    llvm_data_->builder_.CreateBr(
+        llvm_data_->GetBlock(instruction->GetRegion()->GetSuccessors()->at(0)));
+    return;
+  }
   std::vector<InstructionNode*> ssa_uses = instruction->GetSSAProducers();
   DCHECK_GT(ssa_uses.size(), 1u);
   InstructionNode* use_l = ssa_uses.at(0);
@@ -194,11 +211,11 @@ void CodeGenVisitor::Visit(MoveResultInstructionNode* instruction) {
 void CodeGenVisitor::Visit(InvokeStaticInstructionNode* invoke) {
   std::string instr = invoke->GetInstruction()->DumpString(NULL);
   std::cout << "6.Instruction: " << instr << std::endl;
-  // TODO: Build callee LLVM function name.
+  // SeaGraph::CanCompile only lets through invokes of the method itself, which is the only
+  // function of the module.
   std::string symbol = "dex_";
   symbol += art::MangleForJni(PrettyMethod(invoke->GetCalledMethodIndex(), dex_file_));
-  std::string function_name = "dex_int_00020Main_fibonacci_00028int_00029";
-  llvm::Function *callee = llvm_data_->module_.getFunction(function_name);
+  llvm::Function *callee = llvm_data_->module_.getFunction(symbol);
   // TODO: Add proper checking of the matching between formal and actual signature.
   DCHECK(NULL != callee);
   std::vector<llvm::Value*> parameter_values;
@@ -218,6 +235,11 @@ void CodeGenVisitor::Visit(InvokeStaticInstructionNode* invoke) {
 void CodeGenVisitor::Visit(AddIntInstructionNode* instruction) {
   std::string instr = instruction->GetInstruction()->DumpString(NULL);
   std::cout << "7.Instruction: " << instr << std::endl;
+  if (instruction->IsFoldedConstant()) {
+    llvm_data_->AddValue(instruction, llvm::ConstantInt::get(*llvm_data_->context_,
+        llvm::APInt(32, instruction->GetFoldedConstant())));
+    return;
+  }
   std::vector<InstructionNode*> ssa_uses = instruction->GetSSAProducers();
   DCHECK_GT(ssa_uses.size(), 1u);
   InstructionNode* use_l = ssa_uses.at(0);
@@ -238,6 +260,13 @@ void CodeGenVisitor::Visit(GotoInstructionNode* instruction) {
 void CodeGenVisitor::Visit(IfEqzInstructionNode* instruction) {
   std::string instr = instruction->GetInstruction()->DumpString(NULL);
   std::cout << "9. Instruction: " << instr << "; Id: " <<instruction << std::endl;
+  DCHECK(instruction->GetRegion() != NULL);
+  if (instruction->GetRegion()->GetSuccessors()->size() == 1) {
+    // Constant propagation removed the edge that is never taken.
+    llvm_data_->builder_.CreateBr(
+        llvm_data_->GetBlock(instruction->GetRegion()->GetSuccessors()->at(0)));
+    return;
+  }
   std::vector<InstructionNode*> ssa_uses = instruction->GetSSAProducers();
   DCHECK_GT(ssa_uses.size(), 0u);
   InstructionNode* use_l = ssa_uses.at(0);
@@ -255,6 +284,9 @@ void CodeGenVisitor::Visit(IfEqzInstructionNode* instruction) {
 
 void CodeGenPostpassVisitor::Visit(PhiInstructionNode* phi) {
   std::cout << "10. Instruction: Phi(" << phi->GetRegisterNumber() << ")" << std::endl;
+  if (phi->IsFoldedConstant()) {
+    return;
+  }
   Region* r = phi->GetRegion();
   const std::vector<Region*>* predecessors = r->GetPredecessors();
   DCHECK(NULL != predecessors);
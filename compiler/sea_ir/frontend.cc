@@ -47,20 +47,28 @@ static CompiledMethod* CompileMethodWithSeaIr(CompilerDriver& compiler,
                                      , llvm::LlvmCompilationUnit* llvm_compilation_unit
 #endif
 ) {
-  LOG(INFO) << "Compiling " << PrettyMethod(method_idx, dex_file) << ".";
+  if (!sea_ir::SeaGraph::CanCompile(code_item, method_idx, method_access_flags, dex_file)) {
+    return NULL;
+  }
+  VLOG(compiler) << "Compiling " << PrettyMethod(method_idx, dex_file) << " with Sea IR.";
   sea_ir::SeaGraph* ir_graph = sea_ir::SeaGraph::GetGraph(dex_file);
   std::string symbol = "dex_" + MangleForJni(PrettyMethod(method_idx, dex_file));
   sea_ir::CodeGenData* llvm_data = ir_graph->CompileMethod(symbol,
           code_item, class_def_idx, method_idx, method_access_flags, dex_file);
-  sea_ir::DotConversion dc;
-  SafeMap<int, const sea_ir::Type*>*  types = ir_graph->ti_->GetTypeMap();
-  dc.DumpSea(ir_graph, "/tmp/temp.dot", types);
+  if (llvm_data == NULL) {
+    return NULL;
+  }
+  const bool kDumpSeaGraph = false;
+  if (kDumpSeaGraph) {
+    sea_ir::DotConversion dc;
+    SafeMap<int, const sea_ir::Type*>*  types = ir_graph->ti_->GetTypeMap();
+    dc.DumpSea(ir_graph, "/tmp/temp.dot", types);
+  }
   MethodReference mref(&dex_file, method_idx);
   std::string llvm_code = llvm_data->GetElf(compiler.GetInstructionSet());
   CompiledMethod* compiled_method =
       new CompiledMethod(compiler, compiler.GetInstructionSet(), llvm_code,
                          *verifier::MethodVerifier::GetDexGcMap(mref), symbol);
-  LOG(INFO) << "Compiled SEA IR method " << PrettyMethod(method_idx, dex_file) << ".";
   return compiled_method;
 }
 
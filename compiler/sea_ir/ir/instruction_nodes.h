@@ -79,10 +79,34 @@ class InstructionNode: public SeaNode {
   virtual void AddSSAUse(InstructionNode* use) {
     used_in_.push_back(use);
   }
+  // Makes the operands defined by @old_definition refer to @new_definition instead.
+  virtual void ReplaceSSAProducer(InstructionNode* old_definition,
+                                  InstructionNode* new_definition) {
+    for (std::map<int, InstructionNode*>::iterator it = definition_edges_.begin();
+        it != definition_edges_.end(); ++it) {
+      if (it->second == old_definition) {
+        it->second = new_definition;
+        new_definition->AddSSAUse(this);
+      }
+    }
+  }
   void Accept(IRVisitor* v) {
     v->Visit(this);
     v->Traverse(this);
   }
+  // Records that constant propagation proved the result of this instruction to be @value,
+  // so that code generation can use the constant instead of computing it.
+  void SetFoldedConstant(int32_t value) {
+    is_folded_constant_ = true;
+    folded_constant_ = value;
+  }
+  bool IsFoldedConstant() const {
+    return is_folded_constant_;
+  }
+  int32_t GetFoldedConstant() const {
+    DCHECK(is_folded_constant_);
+    return folded_constant_;
+  }
   // Set the region to which this instruction belongs.
   Region* GetRegion() {
     DCHECK(NULL != region_);
@@ -95,7 +119,8 @@ class InstructionNode: public SeaNode {
 
  protected:
   explicit InstructionNode(const art::Instruction* in):
-      SeaNode(), instruction_(in), used_in_(), de_def_(false), region_(NULL) { }
+      SeaNode(), instruction_(in), used_in_(), de_def_(false), region_(NULL),
+      is_folded_constant_(false), folded_constant_(0) { }
 
  protected:
   const art::Instruction* const instruction_;
@@ -104,6 +129,8 @@ class InstructionNode: public SeaNode {
   std::vector<InstructionNode*> used_in_;
   bool de_def_;
   Region* region_;
+  bool is_folded_constant_;
+  int32_t folded_constant_;
 };
 
 class ConstInstructionNode: public InstructionNode {
@@ -234,6 +261,61 @@ class GotoInstructionNode: public InstructionNode {
   }
 };
 
+// The following instructions have no code generation of their own yet. They only reach code
+// generation when scalar replacement removed them, so they are visited as InstructionNode.
+
+class NewInstanceInstructionNode: public InstructionNode {
+ public:
+  explicit NewInstanceInstructionNode(const art::Instruction* inst): InstructionNode(inst) { }
+  std::vector<int> GetUses() const {
+    return std::vector<int>();  // vB is the type index.
+  }
+  uint32_t GetTypeIndex() const {
+    return GetInstruction()->VRegB_21c();
+  }
+};
+
+class IGetInstructionNode: public InstructionNode {
+ public:
+  explicit IGetInstructionNode(const art::Instruction* inst): InstructionNode(inst) { }
+  std::vector<int> GetUses() const {
+    std::vector<int> uses;  // vC is the field index.
+    uses.push_back(GetInstruction()->VRegB_22c());
+    return uses;
+  }
+  uint32_t GetFieldIndex() const {
+    return GetInstruction()->VRegC_22c();
+  }
+};
+
+class IPutInstructionNode: public InstructionNode {
+ public:
+  explicit IPutInstructionNode(const art::Instruction* inst): InstructionNode(inst) { }
+  // The value stored is the first operand, the object the second.
+  std::vector<int> GetUses() const {
+    std::vector<int> uses;  // vC is the field index.
+    uses.push_back(GetInstruction()->VRegA_22c());
+    uses.push_back(GetInstruction()->VRegB_22c());
+    return uses;
+  }
+  uint32_t GetFieldIndex() const {
+    return GetInstruction()->VRegC_22c();
+  }
+};
+
+class InvokeDirectInstructionNode: public InstructionNode {
+ public:
+  explicit InvokeDirectInstructionNode(const art::Instruction* inst): InstructionNode(inst) { }
+  std::vector<int> GetUses() const {
+    uint32_t args[5];
+    GetInstruction()->GetArgs(args);
+    return std::vector<int>(args, args + GetInstruction()->VRegA_35c());
+  }
+  uint32_t GetCalledMethodIndex() const {
+    return GetInstruction()->VRegB_35c();
+  }
+};
+
 class IfEqzInstructionNode: public InstructionNode {
  public:
   explicit IfEqzInstructionNode(const art::Instruction* inst): InstructionNode(inst) {
@@ -13,10 +13,18 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <algorithm>
+#include <sstream>
+
 #include "base/stringprintf.h"
+#include "modifiers.h"
+#include "utils.h"
 #include "sea_ir/ir/instruction_tools.h"
 #include "sea_ir/ir/sea.h"
 #include "sea_ir/code_gen/code_gen.h"
+#include "sea_ir/opt/dce.h"
+#include "sea_ir/opt/scalar_replacement.h"
+#include "sea_ir/opt/sccp.h"
 #include "sea_ir/types/type_inference.h"
 
 #define MAX_REACHING_DEF_ITERERATIONS (10)
@@ -49,15 +57,149 @@ void IRVisitor::Traverse(SeaGraph* graph) {
   }
 }
 
+IRPassManager::~IRPassManager() {
+  for (std::vector<std::pair<std::string, IRVisitor*> >::iterator it = passes_.begin();
+      it != passes_.end(); ++it) {
+    delete it->second;
+  }
+}
+
+void IRPassManager::Run(SeaGraph* graph) {
+  timings_ns_.clear();
+  for (std::vector<std::pair<std::string, IRVisitor*> >::const_iterator cit = passes_.begin();
+      cit != passes_.end(); ++cit) {
+    uint64_t start_ns = art::NanoTime();
+    graph->Accept(cit->second);
+    timings_ns_.push_back(art::NanoTime() - start_ns);
+  }
+}
+
+void IRPassManager::DumpTimings(std::ostream& os) const {
+  for (size_t i = 0; i < timings_ns_.size(); ++i) {
+    os << passes_[i].first << ": " << art::PrettyDuration(timings_ns_[i]) << "\n";
+  }
+}
+
 SeaGraph* SeaGraph::GetGraph(const art::DexFile& dex_file) {
   return new SeaGraph(dex_file);
 }
 
+bool SeaGraph::CanCompile(const art::DexFile::CodeItem* code_item, uint32_t method_idx,
+                          uint32_t method_access_flags, const art::DexFile& dex_file) {
+  if ((method_access_flags & art::kAccStatic) == 0 || code_item->tries_size_ != 0) {
+    return false;
+  }
+  uint32_t shorty_len;
+  const char* shorty = dex_file.GetMethodShorty(dex_file.GetMethodId(method_idx), &shorty_len);
+  for (uint32_t i = 0; i < shorty_len; i++) {
+    if (shorty[i] != 'I') {
+      return false;
+    }
+  }
+  const uint16_t* code = code_item->insns_;
+  for (uint32_t i = 0; i < code_item->insns_size_in_code_units_; ) {
+    const art::Instruction* inst = art::Instruction::At(&code[i]);
+    switch (inst->Opcode()) {
+      case art::Instruction::CONST_4:
+      case art::Instruction::RETURN:
+      case art::Instruction::IF_NE:
+      case art::Instruction::MOVE_RESULT:
+      case art::Instruction::ADD_INT:
+      case art::Instruction::GOTO:
+      case art::Instruction::IF_EQZ:
+        break;
+      case art::Instruction::INVOKE_STATIC:
+        if (inst->VRegB_35c() != method_idx) {
+          return false;
+        }
+        break;
+      case art::Instruction::NEW_INSTANCE:
+      case art::Instruction::IGET:
+      case art::Instruction::IPUT:
+      case art::Instruction::MONITOR_ENTER:
+      case art::Instruction::MONITOR_EXIT:
+        break;
+      case art::Instruction::INVOKE_DIRECT:
+        if (!IsObjectConstructor(dex_file, inst->VRegB_35c())) {
+          return false;
+        }
+        break;
+      default:
+        return false;
+    }
+    i += inst->SizeInCodeUnits();
+  }
+  return true;
+}
+
+bool SeaGraph::IsObjectConstructor(const art::DexFile& dex_file, uint32_t method_idx) {
+  const art::DexFile::MethodId& method_id = dex_file.GetMethodId(method_idx);
+  return strcmp(dex_file.GetMethodName(method_id), "<init>") == 0 &&
+      strcmp(dex_file.GetMethodDeclaringClassDescriptor(method_id), "Ljava/lang/Object;") == 0;
+}
+
+bool SeaGraph::HasCodeGenSupport() {
+  for (std::vector<Region*>::const_iterator region_it = regions_.begin();
+      region_it != regions_.end(); ++region_it) {
+    std::vector<InstructionNode*>* instructions = (*region_it)->GetInstructions();
+    for (std::vector<InstructionNode*>::const_iterator cit = instructions->begin();
+        cit != instructions->end(); ++cit) {
+      // Signature nodes have no instruction.
+      if ((*cit)->IsFoldedConstant() || (*cit)->GetInstruction() == NULL) {
+        continue;
+      }
+      switch ((*cit)->GetInstruction()->Opcode()) {
+        case art::Instruction::CONST_4:
+        case art::Instruction::RETURN:
+        case art::Instruction::IF_NE:
+        case art::Instruction::MOVE_RESULT:
+        case art::Instruction::ADD_INT:
+        case art::Instruction::GOTO:
+        case art::Instruction::IF_EQZ:
+        case art::Instruction::INVOKE_STATIC:
+          break;
+        default:
+          return false;
+      }
+    }
+  }
+  return true;
+}
+
 void SeaGraph::AddEdge(Region* src, Region* dst) const {
   src->AddSuccessor(dst);
   dst->AddPredecessor(src);
 }
 
+void SeaGraph::RemoveEdge(Region* src, size_t successor_pos) const {
+  std::vector<Region*>* successors = src->GetSuccessors();
+  DCHECK_LT(successor_pos, successors->size());
+  Region* dst = successors->at(successor_pos);
+  successors->erase(successors->begin() + successor_pos);
+  std::vector<Region*>* predecessors = dst->GetPredecessors();
+  std::vector<Region*>::iterator pred_it =
+      std::find(predecessors->begin(), predecessors->end(), src);
+  DCHECK(pred_it != predecessors->end());
+  size_t predecessor_pos = pred_it - predecessors->begin();
+  predecessors->erase(pred_it);
+  std::vector<PhiInstructionNode*>* phis = dst->GetPhiNodes();
+  for (std::vector<PhiInstructionNode*>::iterator phi_it = phis->begin();
+      phi_it != phis->end(); ++phi_it) {
+    (*phi_it)->RemovePredecessor(predecessor_pos);
+  }
+}
+
+void SeaGraph::RemoveRegion(Region* region) {
+  while (!region->GetSuccessors()->empty()) {
+    RemoveEdge(region, region->GetSuccessors()->size() - 1);
+  }
+  Region* idom = region->GetIDominator();
+  if (idom != NULL && idom != region) {
+    idom->RemoveFromIDominatedSet(region);
+  }
+  regions_.erase(std::remove(regions_.begin(), regions_.end(), region), regions_.end());
+}
+
 void SeaGraph::ComputeRPO(Region* current_region, int& current_rpo) {
   current_region->SetRPO(VISITING);
   std::vector<sea_ir::Region*>* succs = current_region->GetSuccessors();
@@ -427,6 +569,23 @@ CodeGenData* SeaGraph::CompileMethod(
   ConvertToSSA();
   // Pass: type inference
   ti_->ComputeTypes(this);
+  // Passes: scalar replacement, sparse conditional constant propagation, then dead code
+  // elimination.
+  IRPassManager pass_manager;
+  pass_manager.AddPass("scalar replacement", new ScalarReplacement());
+  pass_manager.AddPass("sparse conditional constant propagation",
+                       new SparseConditionalConstantPropagation());
+  pass_manager.AddPass("dead code elimination", new DeadCodeElimination());
+  pass_manager.Run(this);
+  if (VLOG_IS_ON(compiler)) {
+    std::ostringstream timings;
+    pass_manager.DumpTimings(timings);
+    LOG(INFO) << "Sea IR pass timings for " << art::PrettyMethod(method_idx, dex_file) << ":\n"
+              << timings.str();
+  }
+  if (!HasCodeGenSupport()) {
+    return NULL;
+  }
   // Pass: Generate LLVM IR.
   CodeGenData* cgd = GenerateLLVM(function_name, dex_file);
   return cgd;
@@ -631,6 +790,18 @@ std::vector<InstructionNode*> InstructionNode::Create(const art::Instruction* in
     case art::Instruction::IF_EQZ:
       sea_instructions.push_back(new IfEqzInstructionNode(in));
       break;
+    case art::Instruction::NEW_INSTANCE:
+      sea_instructions.push_back(new NewInstanceInstructionNode(in));
+      break;
+    case art::Instruction::IGET:
+      sea_instructions.push_back(new IGetInstructionNode(in));
+      break;
+    case art::Instruction::IPUT:
+      sea_instructions.push_back(new IPutInstructionNode(in));
+      break;
+    case art::Instruction::INVOKE_DIRECT:
+      sea_instructions.push_back(new InvokeDirectInstructionNode(in));
+      break;
     default:
       // Default, generic IR instruction node; default case should never be reached
       // when support for all instructions ahs been added.
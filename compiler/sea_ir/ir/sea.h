@@ -18,6 +18,7 @@
 #ifndef ART_COMPILER_SEA_IR_IR_SEA_H_
 #define ART_COMPILER_SEA_IR_IR_SEA_H_
 
+#include <algorithm>
 #include <set>
 #include <map>
 
@@ -123,6 +124,24 @@ class PhiInstructionNode: public InstructionNode {
     return definition_edges_.at(predecessor_pos);
   }
 
+  void ReplaceSSAProducer(InstructionNode* old_definition, InstructionNode* new_definition) {
+    for (std::vector<std::vector<InstructionNode*>*>::iterator
+        it = definition_edges_.begin(); it != definition_edges_.end(); ++it) {
+      if (std::find((*it)->begin(), (*it)->end(), old_definition) != (*it)->end()) {
+        std::replace((*it)->begin(), (*it)->end(), old_definition, new_definition);
+        new_definition->AddSSAUse(this);
+      }
+    }
+  }
+
+  // Drops the operand for the predecessor on position @predecessor_pos, after the edge from that
+  // predecessor has been removed. The operands of later predecessors move down by one.
+  void RemovePredecessor(size_t predecessor_pos) {
+    if (predecessor_pos < definition_edges_.size()) {
+      definition_edges_.erase(definition_edges_.begin() + predecessor_pos);
+    }
+  }
+
   void Accept(IRVisitor* v) {
     v->Visit(this);
     v->Traverse(this);
@@ -188,6 +207,10 @@ class Region : public SeaNode {
   const std::set<Region*>* GetIDominatedSet() {
     return &idominated_set_;
   }
+
+  void RemoveFromIDominatedSet(Region* dominated) {
+    idominated_set_.erase(dominated);
+  }
   // Adds @df_reg to the dominance frontier of the current region.
   void AddToDominanceFrontier(Region* df_reg) {
     df_.insert(df_reg);
@@ -261,6 +284,18 @@ class SeaGraph: IVisitable {
  public:
   static SeaGraph* GetGraph(const art::DexFile&);
 
+  // Returns whether code generation may handle the method: a static method taking and returning
+  // ints, without exception handlers, whose instructions either have code generation or may be
+  // removed by scalar replacement, and whose invokes only call the method itself or the
+  // constructor of java.lang.Object. CompileMethod declines the method if some of the latter
+  // remain.
+  static bool CanCompile(const art::DexFile::CodeItem* code_item, uint32_t method_idx,
+                         uint32_t method_access_flags, const art::DexFile& dex_file);
+  // Returns whether @method_idx is the constructor of java.lang.Object, which does nothing.
+  static bool IsObjectConstructor(const art::DexFile& dex_file, uint32_t method_idx);
+
+  // Returns the code for the method, or NULL if after optimization some instructions remain
+  // that code generation does not handle.
   CodeGenData* CompileMethod(const std::string& function_name,
       const art::DexFile::CodeItem* code_item, uint16_t class_def_idx,
       uint32_t method_idx, uint32_t method_access_flags, const art::DexFile& dex_file);
@@ -272,6 +307,11 @@ class SeaGraph: IVisitable {
   static void ComputeRPO(Region* crt_bb, int& crt_rpo);
   // Returns the "lowest common ancestor" of @i and @j in the dominator tree.
   static Region* Intersect(Region* i, Region* j);
+  // Removes the CFG edge from @src to its successor on position @successor_pos, together with
+  // the operands the phi-functions of the successor had for it.
+  void RemoveEdge(Region* src, size_t successor_pos) const;
+  // Removes the unreachable @region from the graph, with its outgoing edges.
+  void RemoveRegion(Region* region);
   // Returns the vector of parameters of the function.
   std::vector<SignatureNode*>* GetParameterNodes() {
     return &parameters_;
@@ -313,6 +353,8 @@ class SeaGraph: IVisitable {
   void BuildMethodSeaGraph(const art::DexFile::CodeItem* code_item,
       const art::DexFile& dex_file, uint16_t class_def_idx,
       uint32_t method_idx, uint32_t method_access_flags);
+  // Returns whether code generation handles all the remaining instructions.
+  bool HasCodeGenSupport();
   // Computes immediate dominators for each region.
   // Precondition: ComputeMethodSeaGraph()
   void ComputeIDominators();
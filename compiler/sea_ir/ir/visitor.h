@@ -17,6 +17,13 @@
 #ifndef ART_COMPILER_SEA_IR_IR_VISITOR_H_
 #define ART_COMPILER_SEA_IR_IR_VISITOR_H_
 
+#include <stdint.h>
+
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
 namespace sea_ir {
 
 class SeaGraph;
@@ -83,5 +90,25 @@ class IRVisitor {
  protected:
   std::vector<Region*> ordered_regions_;
 };
+
+// Runs visitors over a graph one after the other, each seeing the changes of the ones before,
+// and records how long each of them took.
+class IRPassManager {
+ public:
+  IRPassManager(): passes_(), timings_ns_() { }
+  ~IRPassManager();
+  // Adds @pass to run after the passes added before. Takes ownership of @pass.
+  void AddPass(const std::string& name, IRVisitor* pass) {
+    passes_.push_back(std::make_pair(name, pass));
+  }
+  // Runs all passes on @graph, in order.
+  void Run(SeaGraph* graph);
+  // Writes the time taken by each pass of the last run to @os.
+  void DumpTimings(std::ostream& os) const;
+
+ private:
+  std::vector<std::pair<std::string, IRVisitor*> > passes_;
+  std::vector<uint64_t> timings_ns_;
+};
 }  // namespace sea_ir
 #endif  // ART_COMPILER_SEA_IR_IR_VISITOR_H_
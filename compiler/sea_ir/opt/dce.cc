@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sea_ir/opt/dce.h"
+
+#include "sea_ir/ir/sea.h"
+
+namespace sea_ir {
+
+void DeadCodeElimination::Visit(SeaGraph* graph) {
+  std::vector<Region*>* regions = graph->GetRegions();
+  for (std::vector<Region*>::const_iterator cit = regions->begin(); cit != regions->end(); ++cit) {
+    std::vector<InstructionNode*>* instructions = (*cit)->GetInstructions();
+    for (std::vector<InstructionNode*>::const_iterator inst_it = instructions->begin();
+        inst_it != instructions->end(); ++inst_it) {
+      (*inst_it)->Accept(this);
+    }
+  }
+  while (!worklist_.empty()) {
+    InstructionNode* instruction = worklist_.back();
+    worklist_.pop_back();
+    std::vector<InstructionNode*> operands = instruction->GetSSAProducers();
+    for (std::vector<InstructionNode*>::const_iterator cit = operands.begin();
+        cit != operands.end(); ++cit) {
+      MarkLive(*cit);
+    }
+  }
+  for (std::vector<Region*>::const_iterator cit = regions->begin(); cit != regions->end(); ++cit) {
+    std::vector<PhiInstructionNode*>* phis = (*cit)->GetPhiNodes();
+    std::vector<PhiInstructionNode*> live_phis;
+    for (std::vector<PhiInstructionNode*>::const_iterator phi_it = phis->begin();
+        phi_it != phis->end(); ++phi_it) {
+      if (live_.find(*phi_it) != live_.end()) {
+        live_phis.push_back(*phi_it);
+      }
+    }
+    phis->swap(live_phis);
+    std::vector<InstructionNode*>* instructions = (*cit)->GetInstructions();
+    std::vector<InstructionNode*> live_instructions;
+    for (std::vector<InstructionNode*>::const_iterator inst_it = instructions->begin();
+        inst_it != instructions->end(); ++inst_it) {
+      if (live_.find(*inst_it) != live_.end()) {
+        live_instructions.push_back(*inst_it);
+      }
+    }
+    instructions->swap(live_instructions);
+  }
+}
+
+void DeadCodeElimination::MarkLive(InstructionNode* instruction) {
+  if (live_.insert(instruction).second && !instruction->IsFoldedConstant()) {
+    worklist_.push_back(instruction);
+  }
+}
+
+void DeadCodeElimination::MarkBranchLive(InstructionNode* branch) {
+  if (branch->GetRegion()->GetSuccessors()->size() < 2) {
+    // Constant propagation decided the branch, code generation emits a plain jump.
+    live_.insert(branch);
+  } else {
+    MarkLive(branch);
+  }
+}
+
+void DeadCodeElimination::Visit(SignatureNode* parameter) {
+  // Parameters are part of the function signature whether used or not.
+  MarkLive(parameter);
+}
+
+void DeadCodeElimination::Visit(InstructionNode* instruction) {
+  // Not modelled, so not known to be free of effects, unless folded by scalar replacement.
+  if (!instruction->IsFoldedConstant()) {
+    MarkLive(instruction);
+  }
+}
+
+void DeadCodeElimination::Visit(ReturnInstructionNode* instruction) {
+  MarkLive(instruction);
+}
+
+void DeadCodeElimination::Visit(IfNeInstructionNode* instruction) {
+  MarkBranchLive(instruction);
+}
+
+void DeadCodeElimination::Visit(InvokeStaticInstructionNode* instruction) {
+  MarkLive(instruction);
+}
+
+void DeadCodeElimination::Visit(GotoInstructionNode* instruction) {
+  MarkLive(instruction);
+}
+
+void DeadCodeElimination::Visit(IfEqzInstructionNode* instruction) {
+  MarkBranchLive(instruction);
+}
+
+}  // namespace sea_ir
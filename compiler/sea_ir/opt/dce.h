@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_COMPILER_SEA_IR_OPT_DCE_H_
+#define ART_COMPILER_SEA_IR_OPT_DCE_H_
+
+#include <set>
+#include <vector>
+
+#include "sea_ir/ir/visitor.h"
+
+namespace sea_ir {
+
+// Aggressive dead code elimination: only the instructions with effects beyond their result
+// (control flow, returns, calls) are assumed live, and then the instructions they use, so that
+// computations feeding only each other are removed too. Instructions folded to a constant and
+// branches left with a single successor do not need their operands.
+class DeadCodeElimination: public IRVisitor {
+ public:
+  DeadCodeElimination(): graph_(NULL), live_(), worklist_() { }
+  void Initialize(SeaGraph* graph) {
+    graph_ = graph;
+  }
+  // Marks the live instructions and removes the others.
+  void Visit(SeaGraph* graph);
+  void Visit(Region* region) { }
+  // The visits of instructions mark the ones that are live whether used or not.
+  void Visit(PhiInstructionNode* phi) { }
+  void Visit(SignatureNode* parameter);
+  void Visit(InstructionNode* instruction);
+  void Visit(ConstInstructionNode* instruction) { }
+  void Visit(UnnamedConstInstructionNode* instruction) { }
+  void Visit(ReturnInstructionNode* instruction);
+  void Visit(IfNeInstructionNode* instruction);
+  void Visit(MoveResultInstructionNode* instruction) { }
+  void Visit(InvokeStaticInstructionNode* instruction);
+  void Visit(AddIntInstructionNode* instruction) { }
+  void Visit(GotoInstructionNode* instruction);
+  void Visit(IfEqzInstructionNode* instruction);
+
+  // The regions are walked by Visit(SeaGraph*).
+  using IRVisitor::Traverse;
+  void Traverse(SeaGraph* graph) { }
+
+ private:
+  void MarkLive(InstructionNode* instruction);
+  void MarkBranchLive(InstructionNode* branch);
+
+  SeaGraph* graph_;
+  std::set<InstructionNode*> live_;
+  std::vector<InstructionNode*> worklist_;
+};
+
+}  // namespace sea_ir
+
+#endif  // ART_COMPILER_SEA_IR_OPT_DCE_H_
@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sea_ir/opt/scalar_replacement.h"
+
+#include <string.h>
+
+#include <set>
+
+#include "mirror/class.h"
+#include "safe_map.h"
+#include "sea_ir/ir/sea.h"
+
+namespace sea_ir {
+
+void ScalarReplacement::Visit(SeaGraph* graph) {
+  std::vector<NewInstanceInstructionNode*> allocations;
+  std::vector<Region*>* regions = graph->GetRegions();
+  for (std::vector<Region*>::const_iterator cit = regions->begin(); cit != regions->end(); ++cit) {
+    std::vector<InstructionNode*>* instructions = (*cit)->GetInstructions();
+    for (std::vector<InstructionNode*>::const_iterator inst_it = instructions->begin();
+        inst_it != instructions->end(); ++inst_it) {
+      const art::Instruction* instruction = (*inst_it)->GetInstruction();
+      if (instruction != NULL && instruction->Opcode() == art::Instruction::NEW_INSTANCE) {
+        allocations.push_back(static_cast<NewInstanceInstructionNode*>(*inst_it));
+      }
+    }
+  }
+  for (std::vector<NewInstanceInstructionNode*>::const_iterator cit = allocations.begin();
+      cit != allocations.end(); ++cit) {
+    if (DoesNotEscape(*cit)) {
+      Replace(*cit);
+    }
+  }
+}
+
+bool ScalarReplacement::DoesNotEscape(NewInstanceInstructionNode* allocation) const {
+  uint32_t type_idx = allocation->GetTypeIndex();
+  if (!IsReplaceableClass(type_idx)) {
+    return false;
+  }
+  const art::DexFile* dex_file = graph_->GetDexFile();
+  std::vector<InstructionNode*>* consumers = allocation->GetSSAConsumers();
+  for (std::vector<InstructionNode*>::const_iterator cit = consumers->begin();
+      cit != consumers->end(); ++cit) {
+    InstructionNode* consumer = *cit;
+    // Phi-functions and uses in other regions are not followed.
+    if (consumer->GetRegion() != allocation->GetRegion() || consumer->GetInstruction() == NULL) {
+      return false;
+    }
+    std::vector<InstructionNode*> operands = consumer->GetSSAProducers();
+    switch (consumer->GetInstruction()->Opcode()) {
+      case art::Instruction::IGET:
+        if (!IsReplaceableField(type_idx,
+                                static_cast<IGetInstructionNode*>(consumer)->GetFieldIndex())) {
+          return false;
+        }
+        break;
+      case art::Instruction::IPUT:
+        // Storing the object itself, in its own field or not, publishes it.
+        if (operands[0] == allocation ||
+            !IsReplaceableField(type_idx,
+                                static_cast<IPutInstructionNode*>(consumer)->GetFieldIndex())) {
+          return false;
+        }
+        break;
+      case art::Instruction::MONITOR_ENTER:
+      case art::Instruction::MONITOR_EXIT:
+        // No other thread can lock the object.
+        break;
+      case art::Instruction::INVOKE_DIRECT:
+        if (operands.size() != 1 || !SeaGraph::IsObjectConstructor(*dex_file,
+            static_cast<InvokeDirectInstructionNode*>(consumer)->GetCalledMethodIndex())) {
+          return false;
+        }
+        break;
+      default:
+        return false;
+    }
+  }
+  return true;
+}
+
+bool ScalarReplacement::IsReplaceableClass(uint32_t type_idx) const {
+  const art::DexFile* dex_file = graph_->GetDexFile();
+  const art::DexFile::ClassDef* class_def = dex_file->FindClassDef(type_idx);
+  if (class_def == NULL ||
+      (class_def->access_flags_ & (art::kAccInterface | art::kAccAbstract)) != 0 ||
+      class_def->superclass_idx_ == art::DexFile::kDexNoIndex16 ||
+      strcmp(dex_file->StringByTypeIdx(class_def->superclass_idx_), "Ljava/lang/Object;") != 0) {
+    return false;
+  }
+  if ((class_def->access_flags_ & art::kAccPublic) == 0) {
+    const art::DexFile::ClassDef& referrer = dex_file->GetClassDef(graph_->class_def_idx_);
+    if (!art::mirror::Class::IsInSamePackage(dex_file->StringByTypeIdx(type_idx),
+                                             dex_file->GetClassDescriptor(referrer))) {
+      return false;
+    }
+  }
+  const art::byte* class_data = dex_file->GetClassData(*class_def);
+  if (class_data == NULL) {
+    return true;
+  }
+  art::ClassDataItemIterator it(*dex_file, class_data);
+  while (it.HasNextStaticField() || it.HasNextInstanceField()) {
+    it.Next();
+  }
+  while (it.HasNextDirectMethod()) {
+    const art::DexFile::MethodId& method_id = dex_file->GetMethodId(it.GetMemberIndex());
+    if (strcmp(dex_file->GetMethodName(method_id), "<clinit>") == 0) {
+      return false;
+    }
+    it.Next();
+  }
+  while (it.HasNextVirtualMethod()) {
+    const art::DexFile::MethodId& method_id = dex_file->GetMethodId(it.GetMemberIndex());
+    if (strcmp(dex_file->GetMethodName(method_id), "finalize") == 0 &&
+        strcmp(dex_file->GetMethodShorty(method_id), "V") == 0) {
+      return false;
+    }
+    it.Next();
+  }
+  return true;
+}
+
+bool ScalarReplacement::IsReplaceableField(uint32_t type_idx, uint32_t field_idx) const {
+  const art::DexFile* dex_file = graph_->GetDexFile();
+  if (dex_file->GetFieldId(field_idx).class_idx_ != type_idx) {
+    return false;
+  }
+  const art::DexFile::ClassDef* class_def = dex_file->FindClassDef(type_idx);
+  const art::byte* class_data = dex_file->GetClassData(*class_def);
+  if (class_data == NULL) {
+    return false;
+  }
+  art::ClassDataItemIterator it(*dex_file, class_data);
+  while (it.HasNextStaticField()) {
+    it.Next();
+  }
+  while (it.HasNextInstanceField()) {
+    if (it.GetMemberIndex() == field_idx) {
+      return true;
+    }
+    it.Next();
+  }
+  return false;
+}
+
+void ScalarReplacement::Replace(NewInstanceInstructionNode* allocation) {
+  std::vector<InstructionNode*>* consumers = allocation->GetSSAConsumers();
+  std::set<InstructionNode*> removed(consumers->begin(), consumers->end());
+  removed.insert(allocation);
+  // The value last stored to each field, in program order.
+  art::SafeMap<uint32_t, InstructionNode*> field_values;
+  std::vector<InstructionNode*>* instructions = allocation->GetRegion()->GetInstructions();
+  for (std::vector<InstructionNode*>::const_iterator cit = instructions->begin();
+      cit != instructions->end(); ++cit) {
+    if (removed.find(*cit) == removed.end()) {
+      continue;
+    }
+    const art::Instruction::Code opcode = (*cit)->GetInstruction()->Opcode();
+    if (opcode == art::Instruction::IPUT) {
+      IPutInstructionNode* store = static_cast<IPutInstructionNode*>(*cit);
+      field_values.Overwrite(store->GetFieldIndex(), store->GetSSAProducers()[0]);
+    } else if (opcode == art::Instruction::IGET) {
+      IGetInstructionNode* load = static_cast<IGetInstructionNode*>(*cit);
+      art::SafeMap<uint32_t, InstructionNode*>::const_iterator value =
+          field_values.find(load->GetFieldIndex());
+      if (value == field_values.end()) {
+        // The field still has its default value.
+        load->SetFoldedConstant(0);
+        removed.erase(load);
+        continue;
+      }
+      std::vector<InstructionNode*> load_consumers = *load->GetSSAConsumers();
+      for (std::vector<InstructionNode*>::const_iterator consumer_it = load_consumers.begin();
+          consumer_it != load_consumers.end(); ++consumer_it) {
+        (*consumer_it)->ReplaceSSAProducer(load, value->second);
+      }
+    }
+  }
+  std::vector<InstructionNode*> remaining;
+  for (std::vector<InstructionNode*>::const_iterator cit = instructions->begin();
+      cit != instructions->end(); ++cit) {
+    if (removed.find(*cit) == removed.end()) {
+      remaining.push_back(*cit);
+    }
+  }
+  instructions->swap(remaining);
+}
+
+}  // namespace sea_ir
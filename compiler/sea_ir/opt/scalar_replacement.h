@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_COMPILER_SEA_IR_OPT_SCALAR_REPLACEMENT_H_
+#define ART_COMPILER_SEA_IR_OPT_SCALAR_REPLACEMENT_H_
+
+#include <stdint.h>
+
+#include "sea_ir/ir/visitor.h"
+
+namespace sea_ir {
+
+class NewInstanceInstructionNode;
+
+// Escape analysis and scalar replacement of short-lived allocations. An object allocated with
+// new-instance does not escape when it is only used, in the region that allocates it, as the
+// object of field accesses, by monitor instructions and by the constructor of java.lang.Object.
+// Such an object is never observed by anyone else, so the allocation, its constructor call and
+// its monitor operations are removed and its fields live in registers: reads of a field see
+// the value last stored, or zero before any store.
+class ScalarReplacement: public IRVisitor {
+ public:
+  ScalarReplacement(): graph_(NULL) { }
+  void Initialize(SeaGraph* graph) {
+    graph_ = graph;
+  }
+  // Finds the allocations that do not escape and replaces them.
+  void Visit(SeaGraph* graph);
+  void Visit(Region* region) { }
+  void Visit(PhiInstructionNode* phi) { }
+  void Visit(SignatureNode* parameter) { }
+  void Visit(InstructionNode* instruction) { }
+  void Visit(ConstInstructionNode* instruction) { }
+  void Visit(UnnamedConstInstructionNode* instruction) { }
+  void Visit(ReturnInstructionNode* instruction) { }
+  void Visit(IfNeInstructionNode* instruction) { }
+  void Visit(MoveResultInstructionNode* instruction) { }
+  void Visit(InvokeStaticInstructionNode* instruction) { }
+  void Visit(AddIntInstructionNode* instruction) { }
+  void Visit(GotoInstructionNode* instruction) { }
+  void Visit(IfEqzInstructionNode* instruction) { }
+
+  // The regions are walked by Visit(SeaGraph*).
+  using IRVisitor::Traverse;
+  void Traverse(SeaGraph* graph) { }
+
+ private:
+  // Returns whether the object allocated by @allocation is only used in ways that allow
+  // replacing its fields by registers.
+  bool DoesNotEscape(NewInstanceInstructionNode* allocation) const;
+  // Returns whether the class @type_idx is defined in the dex file of the method, accessible
+  // from it, and instantiated without observable effects: no class initializer, no finalizer
+  // and java.lang.Object as superclass.
+  bool IsReplaceableClass(uint32_t type_idx) const;
+  // Returns whether @field_idx refers to an instance field declared by the class @type_idx.
+  bool IsReplaceableField(uint32_t type_idx, uint32_t field_idx) const;
+  // Removes @allocation and the instructions using it, forwarding the stored field values.
+  void Replace(NewInstanceInstructionNode* allocation);
+
+  SeaGraph* graph_;
+};
+
+}  // namespace sea_ir
+
+#endif  // ART_COMPILER_SEA_IR_OPT_SCALAR_REPLACEMENT_H_
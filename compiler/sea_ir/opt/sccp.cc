@@ -0,0 +1,298 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sea_ir/opt/sccp.h"
+
+#include "sea_ir/ir/sea.h"
+
+namespace sea_ir {
+
+void SparseConditionalConstantPropagation::Visit(SeaGraph* graph) {
+  Region* root = NULL;
+  std::vector<Region*>* regions = graph->GetRegions();
+  for (std::vector<Region*>::const_iterator cit = regions->begin(); cit != regions->end(); ++cit) {
+    if ((*cit)->GetIDominator() == *cit) {
+      root = *cit;
+    }
+  }
+  DCHECK(root != NULL);
+  AddFlowEdge(NULL, root);
+  while (!flow_worklist_.empty() || !ssa_worklist_.empty()) {
+    while (!flow_worklist_.empty()) {
+      std::pair<Region*, Region*> edge = flow_worklist_.back();
+      flow_worklist_.pop_back();
+      Region* region = edge.second;
+      if (executable_regions_.insert(region).second) {
+        VisitRegion(region);
+      } else {
+        // A new way into a region already evaluated only changes its phi-functions.
+        std::vector<PhiInstructionNode*>* phis = region->GetPhiNodes();
+        for (std::vector<PhiInstructionNode*>::const_iterator cit = phis->begin();
+            cit != phis->end(); ++cit) {
+          (*cit)->Accept(this);
+        }
+      }
+    }
+    while (!ssa_worklist_.empty()) {
+      InstructionNode* instruction = ssa_worklist_.back();
+      ssa_worklist_.pop_back();
+      if (executable_regions_.find(instruction->GetRegion()) != executable_regions_.end()) {
+        instruction->Accept(this);
+      }
+    }
+  }
+  Rewrite();
+}
+
+void SparseConditionalConstantPropagation::VisitRegion(Region* region) {
+  std::vector<PhiInstructionNode*>* phis = region->GetPhiNodes();
+  for (std::vector<PhiInstructionNode*>::const_iterator cit = phis->begin();
+      cit != phis->end(); ++cit) {
+    (*cit)->Accept(this);
+  }
+  std::vector<InstructionNode*>* instructions = region->GetInstructions();
+  for (std::vector<InstructionNode*>::const_iterator cit = instructions->begin();
+      cit != instructions->end(); ++cit) {
+    visiting_control_ = false;
+    (*cit)->Accept(this);
+  }
+  if (!visiting_control_) {
+    // The region falls through to its successors.
+    std::vector<Region*>* successors = region->GetSuccessors();
+    for (std::vector<Region*>::const_iterator cit = successors->begin();
+        cit != successors->end(); ++cit) {
+      AddFlowEdge(region, *cit);
+    }
+  }
+}
+
+void SparseConditionalConstantPropagation::AddFlowEdge(Region* src, Region* dst) {
+  if (executable_edges_.insert(std::make_pair(src, dst)).second) {
+    flow_worklist_.push_back(std::make_pair(src, dst));
+  }
+}
+
+SparseConditionalConstantPropagation::LatticeValue
+SparseConditionalConstantPropagation::GetValue(InstructionNode* instruction) const {
+  std::map<int, LatticeValue>::const_iterator it = values_.find(instruction->Id());
+  if (it == values_.end()) {
+    return LatticeValue();
+  }
+  return it->second;
+}
+
+void SparseConditionalConstantPropagation::SetValue(InstructionNode* instruction,
+                                                    LatticeValue value) {
+  LatticeValue old_value = GetValue(instruction);
+  if (old_value.state == value.state &&
+      (value.state != kConstant || old_value.constant == value.constant)) {
+    return;
+  }
+  DCHECK_GT(value.state, old_value.state) << "Values only move down the lattice.";
+  values_[instruction->Id()] = value;
+  std::vector<InstructionNode*>* consumers = instruction->GetSSAConsumers();
+  ssa_worklist_.insert(ssa_worklist_.end(), consumers->begin(), consumers->end());
+}
+
+void SparseConditionalConstantPropagation::SetConstant(InstructionNode* instruction,
+                                                       int32_t constant) {
+  LatticeValue value;
+  value.state = kConstant;
+  value.constant = constant;
+  SetValue(instruction, value);
+}
+
+void SparseConditionalConstantPropagation::SetOverdefined(InstructionNode* instruction) {
+  LatticeValue value;
+  value.state = kOverdefined;
+  SetValue(instruction, value);
+}
+
+SparseConditionalConstantPropagation::LatticeValue
+SparseConditionalConstantPropagation::Meet(LatticeValue a, LatticeValue b) {
+  if (a.state == kUndefined) {
+    return b;
+  }
+  if (b.state == kUndefined) {
+    return a;
+  }
+  if (a.state == kConstant && b.state == kConstant && a.constant == b.constant) {
+    return a;
+  }
+  LatticeValue overdefined;
+  overdefined.state = kOverdefined;
+  return overdefined;
+}
+
+void SparseConditionalConstantPropagation::Visit(PhiInstructionNode* phi) {
+  Region* region = phi->GetRegion();
+  std::vector<Region*>* predecessors = region->GetPredecessors();
+  LatticeValue value;
+  for (size_t pos = 0; pos < predecessors->size(); ++pos) {
+    if (executable_edges_.find(std::make_pair(predecessors->at(pos), region)) !=
+        executable_edges_.end()) {
+      std::vector<InstructionNode*>* definitions = phi->GetSSAUses(pos);
+      DCHECK_EQ(definitions->size(), 1u);
+      value = Meet(value, GetValue(definitions->at(0)));
+    }
+  }
+  SetValue(phi, value);
+}
+
+void SparseConditionalConstantPropagation::Visit(SignatureNode* parameter) {
+  SetOverdefined(parameter);
+}
+
+void SparseConditionalConstantPropagation::Visit(InstructionNode* instruction) {
+  // Not modelled: the result is unknown and the instruction may go anywhere, which falling
+  // through to all successors covers. Scalar replacement may have folded reads of fields.
+  if (instruction->IsFoldedConstant()) {
+    SetConstant(instruction, instruction->GetFoldedConstant());
+  } else if (instruction->GetResultRegister() != NO_REGISTER) {
+    SetOverdefined(instruction);
+  }
+}
+
+void SparseConditionalConstantPropagation::Visit(ConstInstructionNode* instruction) {
+  SetConstant(instruction, instruction->GetConstValue());
+}
+
+void SparseConditionalConstantPropagation::Visit(UnnamedConstInstructionNode* instruction) {
+  SetConstant(instruction, instruction->GetConstValue());
+}
+
+void SparseConditionalConstantPropagation::Visit(ReturnInstructionNode* instruction) {
+  visiting_control_ = true;
+}
+
+void SparseConditionalConstantPropagation::Visit(IfNeInstructionNode* instruction) {
+  visiting_control_ = true;
+  std::vector<InstructionNode*> operands = instruction->GetSSAProducers();
+  DCHECK_EQ(operands.size(), 2u);
+  LatticeValue left = GetValue(operands[0]);
+  LatticeValue right = GetValue(operands[1]);
+  LatticeValue condition;
+  if (left.state == kOverdefined || right.state == kOverdefined) {
+    condition.state = kOverdefined;
+  } else if (left.state == kConstant && right.state == kConstant) {
+    condition.state = kConstant;
+    condition.constant = (left.constant != right.constant) ? 1 : 0;
+  }
+  EvaluateBranch(instruction, condition);
+}
+
+void SparseConditionalConstantPropagation::Visit(IfEqzInstructionNode* instruction) {
+  visiting_control_ = true;
+  std::vector<InstructionNode*> operands = instruction->GetSSAProducers();
+  DCHECK_EQ(operands.size(), 1u);
+  LatticeValue condition = GetValue(operands[0]);
+  if (condition.state == kConstant) {
+    condition.constant = (condition.constant == 0) ? 1 : 0;
+  }
+  EvaluateBranch(instruction, condition);
+}
+
+void SparseConditionalConstantPropagation::EvaluateBranch(InstructionNode* branch,
+                                                          LatticeValue condition) {
+  // The branch target is the first successor, the fall-through the second.
+  Region* region = branch->GetRegion();
+  std::vector<Region*>* successors = region->GetSuccessors();
+  if (condition.state == kOverdefined || successors->size() != 2) {
+    for (std::vector<Region*>::const_iterator cit = successors->begin();
+        cit != successors->end(); ++cit) {
+      AddFlowEdge(region, *cit);
+    }
+  } else if (condition.state == kConstant) {
+    AddFlowEdge(region, successors->at(condition.constant != 0 ? 0 : 1));
+  }
+}
+
+void SparseConditionalConstantPropagation::Visit(MoveResultInstructionNode* instruction) {
+  SetOverdefined(instruction);
+}
+
+void SparseConditionalConstantPropagation::Visit(InvokeStaticInstructionNode* instruction) {
+  SetOverdefined(instruction);
+}
+
+void SparseConditionalConstantPropagation::Visit(AddIntInstructionNode* instruction) {
+  if (instruction->GetInstruction()->Opcode() != art::Instruction::ADD_INT) {
+    // The literal forms do not have their operands modelled yet.
+    SetOverdefined(instruction);
+    return;
+  }
+  std::vector<InstructionNode*> operands = instruction->GetSSAProducers();
+  DCHECK_EQ(operands.size(), 2u);
+  LatticeValue left = GetValue(operands[0]);
+  LatticeValue right = GetValue(operands[1]);
+  if (left.state == kOverdefined || right.state == kOverdefined) {
+    SetOverdefined(instruction);
+  } else if (left.state == kConstant && right.state == kConstant) {
+    // Java int addition wraps around.
+    SetConstant(instruction, static_cast<int32_t>(static_cast<uint32_t>(left.constant) +
+                                                  static_cast<uint32_t>(right.constant)));
+  }
+}
+
+void SparseConditionalConstantPropagation::Visit(GotoInstructionNode* instruction) {
+  visiting_control_ = true;
+  std::vector<Region*>* successors = instruction->GetRegion()->GetSuccessors();
+  for (std::vector<Region*>::const_iterator cit = successors->begin();
+      cit != successors->end(); ++cit) {
+    AddFlowEdge(instruction->GetRegion(), *cit);
+  }
+}
+
+void SparseConditionalConstantPropagation::Rewrite() {
+  std::vector<Region*> regions(*graph_->GetRegions());
+  for (std::vector<Region*>::const_iterator cit = regions.begin(); cit != regions.end(); ++cit) {
+    Region* region = *cit;
+    if (executable_regions_.find(region) == executable_regions_.end()) {
+      continue;
+    }
+    std::vector<PhiInstructionNode*>* phis = region->GetPhiNodes();
+    for (std::vector<PhiInstructionNode*>::const_iterator phi_it = phis->begin();
+        phi_it != phis->end(); ++phi_it) {
+      LatticeValue value = GetValue(*phi_it);
+      if (value.state == kConstant) {
+        (*phi_it)->SetFoldedConstant(value.constant);
+      }
+    }
+    std::vector<InstructionNode*>* instructions = region->GetInstructions();
+    for (std::vector<InstructionNode*>::const_iterator inst_it = instructions->begin();
+        inst_it != instructions->end(); ++inst_it) {
+      LatticeValue value = GetValue(*inst_it);
+      if (value.state == kConstant) {
+        (*inst_it)->SetFoldedConstant(value.constant);
+      }
+    }
+    // Drop the edges of branches that are never taken.
+    std::vector<Region*>* successors = region->GetSuccessors();
+    for (size_t pos = successors->size(); pos > 0; --pos) {
+      if (executable_edges_.find(std::make_pair(region, successors->at(pos - 1))) ==
+          executable_edges_.end()) {
+        graph_->RemoveEdge(region, pos - 1);
+      }
+    }
+  }
+  for (std::vector<Region*>::const_iterator cit = regions.begin(); cit != regions.end(); ++cit) {
+    if (executable_regions_.find(*cit) == executable_regions_.end()) {
+      graph_->RemoveRegion(*cit);
+    }
+  }
+}
+
+}  // namespace sea_ir
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_COMPILER_SEA_IR_OPT_SCCP_H_
+#define ART_COMPILER_SEA_IR_OPT_SCCP_H_
+
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "sea_ir/ir/visitor.h"
+
+namespace sea_ir {
+
+// Sparse conditional constant propagation, following Wegman & Zadeck, "Constant propagation
+// with conditional branches", TOPLAS 1991. Only the regions reachable under the constants found
+// are evaluated, so constants flowing through phi-functions are not lost to edges that are never
+// taken. The instructions proven constant are marked with SetFoldedConstant, branches on
+// constant conditions lose the edges that are never taken and unreachable regions are removed.
+class SparseConditionalConstantPropagation: public IRVisitor {
+ public:
+  SparseConditionalConstantPropagation(): graph_(NULL), values_(), executable_regions_(),
+      executable_edges_(), flow_worklist_(), ssa_worklist_(), visiting_control_(false) { }
+  void Initialize(SeaGraph* graph) {
+    graph_ = graph;
+  }
+  // Runs the propagation to a fixed point, then rewrites the graph.
+  void Visit(SeaGraph* graph);
+  void Visit(Region* region) { }
+  void Visit(PhiInstructionNode* phi);
+  void Visit(SignatureNode* parameter);
+  void Visit(InstructionNode* instruction);
+  void Visit(ConstInstructionNode* instruction);
+  void Visit(UnnamedConstInstructionNode* instruction);
+  void Visit(ReturnInstructionNode* instruction);
+  void Visit(IfNeInstructionNode* instruction);
+  void Visit(MoveResultInstructionNode* instruction);
+  void Visit(InvokeStaticInstructionNode* instruction);
+  void Visit(AddIntInstructionNode* instruction);
+  void Visit(GotoInstructionNode* instruction);
+  void Visit(IfEqzInstructionNode* instruction);
+
+  // The order of the visits is given by the work lists, not by the graph.
+  using IRVisitor::Traverse;
+  void Traverse(SeaGraph* graph) { }
+
+ private:
+  // The lattice of values: undefined until shown otherwise, then a single constant,
+  // then overdefined.
+  enum LatticeState {
+    kUndefined,
+    kConstant,
+    kOverdefined
+  };
+  struct LatticeValue {
+    LatticeValue(): state(kUndefined), constant(0) { }
+    LatticeState state;
+    int32_t constant;
+  };
+
+  LatticeValue GetValue(InstructionNode* instruction) const;
+  void SetValue(InstructionNode* instruction, LatticeValue value);
+  void SetConstant(InstructionNode* instruction, int32_t constant);
+  void SetOverdefined(InstructionNode* instruction);
+  static LatticeValue Meet(LatticeValue a, LatticeValue b);
+  // Makes the edge from @src to @dst executable.
+  void AddFlowEdge(Region* src, Region* dst);
+  // Makes the edge to @region's successor taken when the condition has value @condition.
+  void EvaluateBranch(InstructionNode* branch, LatticeValue condition);
+  void VisitRegion(Region* region);
+  // Rewrites the graph with the results of the propagation.
+  void Rewrite();
+
+  SeaGraph* graph_;
+  std::map<int, LatticeValue> values_;  // By instruction id.
+  std::set<Region*> executable_regions_;
+  std::set<std::pair<Region*, Region*> > executable_edges_;
+  std::vector<std::pair<Region*, Region*> > flow_worklist_;
+  std::vector<InstructionNode*> ssa_worklist_;
+  // Whether the region visited last ended in an instruction deciding its successors.
+  bool visiting_control_;
+};
+
+}  // namespace sea_ir
+
+#endif  // ART_COMPILER_SEA_IR_OPT_SCCP_H_
@@ -17,63 +17,96 @@
 #ifndef ART_COMPILER_UTILS_DEDUPE_SET_H_
 #define ART_COMPILER_UTILS_DEDUPE_SET_H_
 
+#include <algorithm>
 #include <set>
+#include <string>
 
 #include "base/mutex.h"
-#include "base/stl_util.h"
+#include "base/stringprintf.h"
+#include "UniquePtr.h"
 
 namespace art {
 
-// A simple data structure to handle hashed deduplication. Add is thread safe.
-template <typename Key, typename HashType, typename HashFunc>
+// A simple data structure to handle hashed deduplication. Add is thread safe. The keys are spread
+// over kShard sets by hash, each with its own lock, so that threads adding different keys rarely
+// wait for each other. Keys are looked up as InKey and stored as StoreKey, a sequence container
+// built with the given allocator.
+template <typename InKey, typename StoreKey, typename HashType, typename HashFunc,
+          HashType kShard = 1>
 class DedupeSet {
-  typedef std::pair<HashType, Key*> HashedKey;
+  // Stored keys have store_key set, the key being looked up has in_key set.
+  struct HashedKey {
+    HashType hash;
+    const InKey* in_key;
+    StoreKey* store_key;
+  };
 
   class Comparator {
    public:
     bool operator()(const HashedKey& a, const HashedKey& b) const {
-      if (a.first < b.first) return true;
-      if (a.first > b.first) return true;
-      return *a.second < *b.second;
+      if (a.hash != b.hash) {
+        return a.hash < b.hash;
+      }
+      if (a.in_key != NULL) {
+        return Less(*a.in_key, b);
+      }
+      return Less(*a.store_key, b);
+    }
+
+   private:
+    template <typename Key>
+    static bool Less(const Key& a, const HashedKey& b) {
+      if (b.in_key != NULL) {
+        return std::lexicographical_compare(a.begin(), a.end(),
+                                            b.in_key->begin(), b.in_key->end());
+      }
+      return std::lexicographical_compare(a.begin(), a.end(),
+                                          b.store_key->begin(), b.store_key->end());
     }
   };
 
   typedef std::set<HashedKey, Comparator> Keys;
 
  public:
-  typedef typename Keys::iterator iterator;
-  typedef typename Keys::const_iterator const_iterator;
-  typedef typename Keys::size_type size_type;
-  typedef typename Keys::value_type value_type;
-
-  iterator begin() { return keys_.begin(); }
-  const_iterator begin() const { return keys_.begin(); }
-  iterator end() { return keys_.end(); }
-  const_iterator end() const { return keys_.end(); }
-
-  Key* Add(Thread* self, const Key& key) {
-    HashType hash = HashFunc()(key);
-    HashedKey hashed_key(hash, const_cast<Key*>(&key));
-    MutexLock lock(self, lock_);
-    auto it = keys_.find(hashed_key);
-    if (it != keys_.end()) {
-      return it->second;
+  StoreKey* Add(Thread* self, const InKey& key) {
+    HashType raw_hash = HashFunc()(key);
+    HashType shard_hash = raw_hash / kShard;
+    HashType shard_bin = raw_hash % kShard;
+    HashedKey hashed_key = { shard_hash, &key, NULL };
+    MutexLock lock(self, *lock_[shard_bin]);
+    auto it = keys_[shard_bin].find(hashed_key);
+    if (it != keys_[shard_bin].end()) {
+      return it->store_key;
     }
-    hashed_key.second = new Key(key);
-    keys_.insert(hashed_key);
-    return hashed_key.second;
+    hashed_key.in_key = NULL;
+    hashed_key.store_key = new StoreKey(key.begin(), key.end(), allocator_);
+    keys_[shard_bin].insert(hashed_key);
+    return hashed_key.store_key;
   }
 
-  DedupeSet() : lock_("dedupe lock") {
+  DedupeSet(const char* set_name, const typename StoreKey::allocator_type& allocator)
+      : allocator_(allocator) {
+    for (HashType i = 0; i < kShard; ++i) {
+      lock_name_[i] = StringPrintf("%s lock %zd", set_name, static_cast<size_t>(i));
+      lock_[i].reset(new Mutex(lock_name_[i].c_str()));
+    }
   }
 
   ~DedupeSet() {
-    STLDeleteValues(&keys_);
+    for (HashType i = 0; i < kShard; ++i) {
+      for (const HashedKey& hashed_key : keys_[i]) {
+        delete hashed_key.store_key;
+      }
+    }
   }
 
  private:
-  Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
-  Keys keys_;
+  const typename StoreKey::allocator_type allocator_;
+  // Mutex keeps a pointer to its name, so the names live as long as the locks.
+  std::string lock_name_[kShard];
+  UniquePtr<Mutex> lock_[kShard];
+  Keys keys_[kShard];
+
   DISALLOW_COPY_AND_ASSIGN(DedupeSet);
 };
 
@@ -38,7 +38,8 @@ class DedupeHashFunc {
 TEST_F(DedupeSetTest, Test) {
   Thread* self = Thread::Current();
   typedef std::vector<uint8_t> ByteArray;
-  DedupeSet<ByteArray, size_t, DedupeHashFunc> deduplicator;
+  DedupeSet<ByteArray, ByteArray, size_t, DedupeHashFunc> deduplicator("test",
+                                                                 std::allocator<uint8_t>());
   ByteArray* array1;
   {
     ByteArray test1;
@@ -75,4 +76,29 @@ TEST_F(DedupeSetTest, Test) {
   }
 }
 
+TEST_F(DedupeSetTest, Sharded) {
+  Thread* self = Thread::Current();
+  typedef std::vector<uint8_t> ByteArray;
+  DedupeSet<ByteArray, ByteArray, size_t, DedupeHashFunc, 4> deduplicator("test sharded",
+                                                                    std::allocator<uint8_t>());
+  std::vector<ByteArray*> arrays;
+  for (uint8_t i = 0; i < 32; ++i) {
+    ByteArray test;
+    test.push_back(i);
+    test.push_back(i * 3);
+    ByteArray* array = deduplicator.Add(self, test);
+    ASSERT_EQ(test, *array);
+    for (size_t j = 0; j < arrays.size(); ++j) {
+      ASSERT_NE(array, arrays[j]);
+    }
+    arrays.push_back(array);
+  }
+  for (uint8_t i = 0; i < 32; ++i) {
+    ByteArray test;
+    test.push_back(i);
+    test.push_back(i * 3);
+    ASSERT_EQ(arrays[i], deduplicator.Add(self, test));
+  }
+}
+
 }  // namespace art
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "swap_space.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "base/stl_util.h"
+#include "thread.h"
+#include "utils.h"
+
+namespace art {
+
+// Keeps every allocation aligned for the vectors of the compiler's output.
+static const size_t kSwapAlignment = 8;
+
+SwapSpace::SwapSpace(int fd, size_t budget)
+    : fd_(fd),
+      budget_(budget),
+      lock_("swap space lock", kAllocSpaceLock),
+      heap_size_(0),
+      file_size_(0),
+      swap_size_(0) {
+  CHECK_GE(fd, 0);
+}
+
+SwapSpace::~SwapSpace() {
+  MutexLock mu(Thread::Current(), lock_);
+  STLDeleteValues(&chunks_);
+  close(fd_);
+}
+
+void* SwapSpace::Alloc(size_t size) {
+  size = RoundUp(size, kSwapAlignment);
+  MutexLock mu(Thread::Current(), lock_);
+  if (heap_size_ + size <= budget_) {
+    void* result = malloc(size);
+    CHECK(result != NULL || size == 0) << "Failed to allocate " << size << " bytes";
+    heap_size_ += size;
+    return result;
+  }
+  return AllocFromFile(size);
+}
+
+void SwapSpace::Free(void* ptr, size_t size) {
+  if (ptr == NULL) {
+    return;
+  }
+  size = RoundUp(size, kSwapAlignment);
+  MutexLock mu(Thread::Current(), lock_);
+  if (IsInFile(reinterpret_cast<byte*>(ptr))) {
+    FreeToFile(reinterpret_cast<byte*>(ptr), size);
+  } else {
+    free(ptr);
+    DCHECK_GE(heap_size_, size);
+    heap_size_ -= size;
+  }
+}
+
+size_t SwapSpace::GetSwapSize() const {
+  MutexLock mu(Thread::Current(), lock_);
+  return swap_size_;
+}
+
+void* SwapSpace::AllocFromFile(size_t size) {
+  std::multimap<size_t, byte*>::iterator it = free_by_size_.lower_bound(size);
+  if (it == free_by_size_.end()) {
+    size_t chunk_size = RoundUp(std::max(size, kMinimumChunkSize), kPageSize);
+    if (TEMP_FAILURE_RETRY(ftruncate(fd_, file_size_ + chunk_size)) != 0) {
+      PLOG(FATAL) << "Failed to grow the swap file to " << file_size_ + chunk_size << " bytes";
+    }
+    MemMap* chunk = MemMap::MapFile(chunk_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_,
+                                    file_size_);
+    CHECK(chunk != NULL) << "Failed to map " << chunk_size << " bytes of the swap file";
+    file_size_ += chunk_size;
+    chunks_.insert(std::make_pair(chunk->Begin(), chunk));
+    InsertFreeRange(chunk->Begin(), chunk_size);
+    it = free_by_size_.lower_bound(size);
+    DCHECK(it != free_by_size_.end());
+  }
+  size_t free_size = it->first;
+  byte* result = it->second;
+  RemoveFreeRange(result, free_size);
+  if (free_size > size) {
+    InsertFreeRange(result + size, free_size - size);
+  }
+  swap_size_ += size;
+  return result;
+}
+
+void SwapSpace::FreeToFile(byte* ptr, size_t size) {
+  DCHECK_GE(swap_size_, size);
+  swap_size_ -= size;
+  // Merge with the free ranges on either side.
+  std::map<byte*, size_t>::iterator next = free_by_start_.find(ptr + size);
+  if (next != free_by_start_.end()) {
+    size_t next_size = next->second;
+    RemoveFreeRange(ptr + size, next_size);
+    size += next_size;
+  }
+  std::map<byte*, size_t>::iterator prev = free_by_start_.lower_bound(ptr);
+  if (prev != free_by_start_.begin()) {
+    --prev;
+    if (prev->first + prev->second == ptr) {
+      byte* prev_start = prev->first;
+      size_t prev_size = prev->second;
+      RemoveFreeRange(prev_start, prev_size);
+      ptr = prev_start;
+      size += prev_size;
+    }
+  }
+  InsertFreeRange(ptr, size);
+}
+
+bool SwapSpace::IsInFile(const byte* ptr) const {
+  std::map<const byte*, MemMap*>::const_iterator it = chunks_.upper_bound(ptr);
+  if (it == chunks_.begin()) {
+    return false;
+  }
+  --it;
+  return it->second->HasAddress(ptr);
+}
+
+void SwapSpace::InsertFreeRange(byte* start, size_t size) {
+  free_by_start_.insert(std::make_pair(start, size));
+  free_by_size_.insert(std::make_pair(size, start));
+}
+
+void SwapSpace::RemoveFreeRange(byte* start, size_t size) {
+  free_by_start_.erase(start);
+  typedef std::multimap<size_t, byte*>::iterator It;
+  std::pair<It, It> range = free_by_size_.equal_range(size);
+  for (It it = range.first; it != range.second; ++it) {
+    if (it->second == start) {
+      free_by_size_.erase(it);
+      return;
+    }
+  }
+  LOG(FATAL) << "Free range of " << size << " bytes at " << reinterpret_cast<void*>(start)
+             << " not found";
+}
+
+}  // namespace art
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_COMPILER_UTILS_SWAP_SPACE_H_
+#define ART_COMPILER_UTILS_SWAP_SPACE_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <map>
+#include <new>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "globals.h"
+#include "mem_map.h"
+
+namespace art {
+
+// Memory for the output of the compiler that may live in a file rather than in anonymous memory.
+// The first budget bytes are allocated from the heap, the rest from shared mappings of the file.
+// Under memory pressure the kernel writes those pages back to the file instead of the process
+// running out of memory. On devices without swap that is the difference between compiling a large
+// app slowly and not compiling it at all.
+class SwapSpace {
+ public:
+  // Takes ownership of the file descriptor. The file should be unlinked or otherwise private, it is
+  // grown as needed.
+  SwapSpace(int fd, size_t budget);
+  ~SwapSpace();
+
+  void* Alloc(size_t size) LOCKS_EXCLUDED(lock_);
+  void Free(void* ptr, size_t size) LOCKS_EXCLUDED(lock_);
+
+  // The number of bytes of the file in use, for statistics.
+  size_t GetSwapSize() const LOCKS_EXCLUDED(lock_);
+
+ private:
+  static const size_t kMinimumChunkSize = 16 * MB;
+
+  void* AllocFromFile(size_t size) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  void FreeToFile(byte* ptr, size_t size) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  bool IsInFile(const byte* ptr) const EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  void InsertFreeRange(byte* start, size_t size) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  void RemoveFreeRange(byte* start, size_t size) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  const int fd_;
+  const size_t budget_;
+
+  // Lower than the level of the DedupeSet locks, which are held while allocating.
+  mutable Mutex lock_;
+  size_t heap_size_ GUARDED_BY(lock_);
+  size_t file_size_ GUARDED_BY(lock_);
+  size_t swap_size_ GUARDED_BY(lock_);
+  // The mappings of the file by start address.
+  std::map<const byte*, MemMap*> chunks_ GUARDED_BY(lock_);
+  // The free ranges of the mappings by start address and by size.
+  std::map<byte*, size_t> free_by_start_ GUARDED_BY(lock_);
+  std::multimap<size_t, byte*> free_by_size_ GUARDED_BY(lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(SwapSpace);
+};
+
+// An STL allocator that takes its memory from a SwapSpace, or from the heap when there is none,
+// for example SwapVector<uint8_t>. Mirrors ArenaAllocatorAdapter.
+template <typename T>
+class SwapAllocator {
+ public:
+  typedef T value_type;
+  typedef T* pointer;
+  typedef const T* const_pointer;
+  typedef T& reference;
+  typedef const T& const_reference;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+
+  template <typename U>
+  struct rebind {
+    typedef SwapAllocator<U> other;
+  };
+
+  explicit SwapAllocator(SwapSpace* swap_space) : swap_space_(swap_space) {}
+
+  template <typename U>
+  SwapAllocator(const SwapAllocator<U>& other)  // NOLINT, implicit as required.
+      : swap_space_(other.swap_space_) {}
+
+  pointer address(reference x) const {
+    return &x;
+  }
+
+  const_pointer address(const_reference x) const {
+    return &x;
+  }
+
+  pointer allocate(size_type n, const void* /* hint */ = 0) {
+    if (swap_space_ == NULL) {
+      pointer result = static_cast<pointer>(malloc(n * sizeof(T)));
+      CHECK(result != NULL || n == 0) << "Failed to allocate " << n * sizeof(T) << " bytes";
+      return result;
+    }
+    return static_cast<pointer>(swap_space_->Alloc(n * sizeof(T)));
+  }
+
+  void deallocate(pointer p, size_type n) {
+    if (swap_space_ == NULL) {
+      free(p);
+    } else {
+      swap_space_->Free(p, n * sizeof(T));
+    }
+  }
+
+  size_type max_size() const {
+    return static_cast<size_type>(-1) / sizeof(T);
+  }
+
+  void construct(pointer p, const T& val) {
+    new (static_cast<void*>(p)) T(val);
+  }
+
+  void destroy(pointer p) {
+    p->~T();
+  }
+
+  bool operator==(const SwapAllocator& other) const {
+    return swap_space_ == other.swap_space_;
+  }
+
+  bool operator!=(const SwapAllocator& other) const {
+    return swap_space_ != other.swap_space_;
+  }
+
+ private:
+  SwapSpace* swap_space_;
+
+  template <typename U> friend class SwapAllocator;
+};
+
+template <typename T>
+using SwapVector = std::vector<T, SwapAllocator<T> >;
+
+}  // namespace art
+
+#endif  // ART_COMPILER_UTILS_SWAP_SPACE_H_
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "swap_space.h"
+
+#include <unistd.h>
+
+#include "common_test.h"
+
+namespace art {
+
+class SwapSpaceTest : public CommonTest {};
+
+TEST_F(SwapSpaceTest, BudgetThenFile) {
+  ScratchFile scratch;
+  SwapSpace swap_space(dup(scratch.GetFd()), 1 * KB);
+  SwapAllocator<uint8_t> allocator(&swap_space);
+
+  // The first kilobyte comes from the heap.
+  SwapVector<uint8_t> in_heap(1 * KB, 1, allocator);
+  EXPECT_EQ(0U, swap_space.GetSwapSize());
+
+  // The rest from the file.
+  SwapVector<uint8_t> in_file1(100, 2, allocator);
+  SwapVector<uint8_t> in_file2(3 * KB, 3, allocator);
+  EXPECT_EQ(RoundUp(100, 8) + 3 * KB, swap_space.GetSwapSize());
+  for (size_t i = 0; i < in_file2.size(); ++i) {
+    ASSERT_EQ(3, in_file2[i]);
+  }
+
+  // Freed ranges are merged and reused.
+  in_file1 = SwapVector<uint8_t>(allocator);
+  in_file2 = SwapVector<uint8_t>(allocator);
+  EXPECT_EQ(0U, swap_space.GetSwapSize());
+  SwapVector<uint8_t> in_file3(4 * KB, 4, allocator);
+  EXPECT_EQ(4 * KB, swap_space.GetSwapSize());
+  EXPECT_EQ(4, in_file3[4 * KB - 1]);
+  EXPECT_EQ(1, in_heap[1 * KB - 1]);
+}
+
+TEST_F(SwapSpaceTest, LargeAllocation) {
+  ScratchFile scratch;
+  SwapSpace swap_space(dup(scratch.GetFd()), 0);
+  SwapAllocator<uint8_t> allocator(&swap_space);
+  // Larger than a chunk of the file.
+  SwapVector<uint8_t> large(32 * MB, 5, allocator);
+  EXPECT_EQ(32 * MB, swap_space.GetSwapSize());
+  EXPECT_EQ(5, large[32 * MB - 1]);
+}
+
+}  // namespace art
@@ -15,6 +15,9 @@
  */
 
 #include <signal.h>
+#include <stdint.h>
+#include <sys/resource.h>
+#include <sys/time.h>
 
 #include <cstdio>
 #include <cstring>
@@ -28,6 +31,28 @@
 
 namespace art {
 
+// Set by -XXreport-startup, used by tools/startup-benchmark.
+static bool report_startup = false;
+static uint64_t start_us = 0;
+
+// gettimeofday rather than clock_gettime, which needs librt on older hosts.
+static uint64_t MicroTime() {
+  timeval now;
+  gettimeofday(&now, NULL);
+  return static_cast<uint64_t>(now.tv_sec) * 1000000LL + now.tv_usec;
+}
+
+// Prints the time since dalvikvm started and the page faults so far, when reporting startup.
+static void ReportStartup(const char* event) {
+  if (!report_startup) {
+    return;
+  }
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  fprintf(stderr, "dalvikvm startup: %s %.2f ms, %ld minor faults, %ld major faults\n", event,
+          (MicroTime() - start_us) / 1000.0, usage.ru_minflt, usage.ru_majflt);
+}
+
 // Determine whether or not the specified method is public.
 static bool IsMethodPublic(JNIEnv* env, jclass c, jmethodID method_id) {
   ScopedLocalRef<jobject> reflected(env, env->ToReflectedMethod(c, method_id, JNI_FALSE));
@@ -94,6 +119,7 @@ static int InvokeMain(JNIEnv* env, char** argv) {
   }
 
   // Invoke main().
+  ReportStartup("main");
   env->CallStaticVoidMethod(klass.get(), method, args.get());
 
   // Check whether there was an uncaught exception. We don't log any uncaught exception here;
@@ -105,6 +131,7 @@ static int InvokeMain(JNIEnv* env, char** argv) {
 // Parse arguments.  Most of it just gets passed through to the runtime.
 // The JNI spec defines a handful of standard arguments.
 static int dalvikvm(int argc, char** argv) {
+  start_us = MicroTime();
   setvbuf(stdout, NULL, _IONBF, 0);
 
   // Skip over argv[0].
@@ -135,6 +162,10 @@ static int dalvikvm(int argc, char** argv) {
       lib = argv[arg_idx] + strlen("-XXlib:");
       continue;
     }
+    if (strcmp(argv[arg_idx], "-XXreport-startup") == 0) {
+      report_startup = true;
+      continue;
+    }
 
     options[curr_opt++].optionString = argv[arg_idx];
 
@@ -185,6 +216,7 @@ static int dalvikvm(int argc, char** argv) {
     fprintf(stderr, "Failed to initialize runtime (check log for details)\n");
     return EXIT_FAILURE;
   }
+  ReportStartup("vm-created");
 
   int rc = InvokeMain(env, &argv[arg_idx]);
 
@@ -201,6 +233,7 @@ static int dalvikvm(int argc, char** argv) {
     fprintf(stderr, "Warning: runtime did not shut down cleanly\n");
     rc = EXIT_FAILURE;
   }
+  ReportStartup("exit");
 
   return rc;
 }
@@ -14,13 +14,18 @@
  * limitations under the License.
  */
 
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/stat.h>
+#include <unistd.h>
 #include <valgrind.h>
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <set>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -43,13 +48,16 @@
 #include "mirror/class_loader.h"
 #include "mirror/object-inl.h"
 #include "mirror/object_array-inl.h"
+#include "oat_file.h"
 #include "oat_writer.h"
 #include "object_utils.h"
 #include "os.h"
+#include "profile_file.h"
 #include "runtime.h"
 #include "ScopedLocalRef.h"
 #include "scoped_thread_state_change.h"
 #include "sirt_ref.h"
+#include "utils/swap_space.h"
 #include "vector_output_stream.h"
 #include "well_known_classes.h"
 #include "zip_archive.h"
@@ -110,6 +118,15 @@ static void Usage(const char* fmt, ...) {
   UsageError("  --image-classes=<classname-file>: specifies classes to include in an image.");
   UsageError("      Example: --image=frameworks/base/preloaded-classes");
   UsageError("");
+  UsageError("  --image-startup-classes=<classname-file>: specifies the classes processes use");
+  UsageError("      while they start. Their objects are laid out together at the start of the");
+  UsageError("      image so that processes touch and dirty fewer image pages.");
+  UsageError("      Example: --image-startup-classes=/data/local/tmp/startup-classes");
+  UsageError("");
+  UsageError("  --image-startup-strings=<file>: specifies the strings processes use while they");
+  UsageError("      start, one per line, laid out with the startup classes.");
+  UsageError("      Example: --image-startup-strings=/data/local/tmp/startup-strings");
+  UsageError("");
   UsageError("  --base=<hex-address>: specifies the base address when creating a boot image.");
   UsageError("      Example: --base=0x50000000");
   UsageError("");
@@ -134,12 +151,66 @@ static void Usage(const char* fmt, ...) {
   UsageError("  --compiler-backend=(Quick|QuickGBC|Portable): select compiler backend");
   UsageError("      set.");
   UsageError("      Example: --instruction-set=Portable");
+#ifdef ART_SEA_IR_MODE
+  UsageError("      SeaIr compiles the hot methods of --profile-file with Sea IR and the rest");
+  UsageError("      with Portable.");
+#endif
   UsageError("      Default: Quick");
   UsageError("");
   UsageError("  --host: used with Portable backend to link against host runtime libraries");
   UsageError("");
   UsageError("  --dump-timing: display a breakdown of where time was spent");
   UsageError("");
+  UsageError("  --implicit-suspend-checks: compiled code polls for suspension with a load that");
+  UsageError("      faults when a suspension is pending rather than with a test and branch.");
+  UsageError("      Only supported with --instruction-set=arm.");
+  UsageError("");
+  UsageError("  --implicit-null-checks: field and array length accesses of compiled code fault");
+  UsageError("      on null rather than being preceded by a compare and branch.");
+  UsageError("      Only supported with --instruction-set=arm.");
+  UsageError("");
+  UsageError("  --implicit-stack-overflow-checks: method prologues of compiled code probe below");
+  UsageError("      the new frame, faulting in the stack guard, rather than comparing against");
+  UsageError("      the stack end. Only supported with --instruction-set=arm.");
+  UsageError("");
+  UsageError("  --method-hooks: method prologues and epilogues of compiled code call the method");
+  UsageError("      entry and exit hooks of the thread while method tracing enables them, instead");
+  UsageError("      of the tracer installing entry and exit stubs.");
+  UsageError("      Only supported with --instruction-set=arm and the quick compiler.");
+  UsageError("");
+  UsageError("  --relative-calls: calls to private, static and constructor methods of the caller's");
+  UsageError("      own class branch to the callee's code directly instead of loading its entry");
+  UsageError("      point. The branches bypass instrumentation stubs, and the oat file can't be");
+  UsageError("      used as an --input-oat-file. Only supported with --instruction-set=arm, the");
+  UsageError("      quick compiler and without --image.");
+  UsageError("");
+  UsageError("  --method-report=<file.csv>: writes the compile time, arena memory, MIR and LIR");
+  UsageError("      counts and code size of every method, slowest first.");
+  UsageError("      Example: --method-report=/data/local/tmp/Calculator.csv");
+  UsageError("");
+  UsageError("  --profile-file=<filename>: specifies a profile written by the runtime with");
+  UsageError("      -XX:ProfileFile. Its hot methods are compiled for speed, the others for space.");
+  UsageError("      The code of the hot methods is laid out first, most sampled first.");
+  UsageError("      Example: --profile-file=/data/dalvik-cache/profiles/com.android.calculator2");
+  UsageError("");
+  UsageError("  --top-k-profile-threshold=<percent>: the hot methods of the profile are the most");
+  UsageError("      sampled methods that account for this percentage of the samples.");
+  UsageError("      Example: --top-k-profile-threshold=80");
+  UsageError("      Default: 90");
+  UsageError("");
+  UsageError("  --input-oat-file=<file.oat>: specifies an oat file compiled from a previous");
+  UsageError("      version of the dex files. The code of the unchanged classes is reused.");
+  UsageError("      Example: --input-oat-file=/data/local/tmp/Calculator.apk.oat");
+  UsageError("");
+  UsageError("  --memory-budget=<megabytes>: compiled code and tables beyond this size are kept");
+  UsageError("      in a swap file rather than in memory.");
+  UsageError("      Example: --memory-budget=64");
+  UsageError("");
+  UsageError("  --swap-file=<file>: specifies the swap file used with --memory-budget, which is");
+  UsageError("      deleted as soon as it is created.");
+  UsageError("      Example: --swap-file=/data/dalvik-cache/Calculator.apk.swap");
+  UsageError("      Default: <oat-file>.swap");
+  UsageError("");
   UsageError("  --runtime-arg <argument>: used to specify various arguments for the runtime,");
   UsageError("      such as initial heap size, maximum heap size, and verbose output.");
   UsageError("      Use a separate --runtime-arg switch for each argument.");
@@ -199,6 +270,23 @@ class Dex2Oat {
     return image_classes.release();
   }
 
+  // Reads a string per line, returns NULL if the file cannot be read.
+  std::set<std::string>* ReadImageStringsFromFile(const char* image_strings_filename) {
+    std::ifstream image_strings_file(image_strings_filename, std::ifstream::in);
+    if (!image_strings_file.good()) {
+      return NULL;
+    }
+    UniquePtr<std::set<std::string> > image_strings(new std::set<std::string>);
+    while (image_strings_file.good()) {
+      std::string line;
+      std::getline(image_strings_file, line);
+      if (!line.empty()) {
+        image_strings->insert(line);
+      }
+    }
+    return image_strings.release();
+  }
+
   // Reads the class names (java.lang.Object) and returns a set of descriptors (Ljava/lang/Object;)
   CompilerDriver::DescriptorSet* ReadImageClassesFromZip(const std::string& zip_filename,
                                                          const char* image_classes_filename) {
@@ -232,6 +320,16 @@ class Dex2Oat {
                                       const std::string& bitcode_filename,
                                       bool image,
                                       UniquePtr<CompilerDriver::DescriptorSet>& image_classes,
+                                      UniquePtr<std::set<std::string> >& hot_methods,
+                                      const std::vector<std::string>& code_order,
+                                      UniquePtr<const OatFile>& input_oat_file,
+                                      UniquePtr<SwapSpace>& swap_space,
+                                      bool method_report,
+                                      bool implicit_suspend_checks,
+                                      bool implicit_null_checks,
+                                      bool implicit_stack_overflow_checks,
+                                      bool method_hooks,
+                                      bool relative_calls,
                                       bool dump_stats,
                                       base::TimingLogger& timings) {
     // SirtRef and ClassLoader creation needs to come after Runtime::Create
@@ -257,7 +355,23 @@ class Dex2Oat {
                                                         image,
                                                         image_classes.release(),
                                                         thread_count_,
-                                                        dump_stats));
+                                                        dump_stats,
+                                                        swap_space.release()));
+    if (hot_methods.get() != NULL) {
+      driver->SetHotMethods(hot_methods.release());
+    }
+    driver->SetCodeOrder(code_order);
+    if (input_oat_file.get() != NULL) {
+      driver->SetInputOatFile(input_oat_file.release());
+    }
+    if (method_report) {
+      driver->EnableMethodReport();
+    }
+    driver->SetImplicitSuspendChecks(implicit_suspend_checks);
+    driver->SetImplicitNullChecks(implicit_null_checks);
+    driver->SetImplicitStackOverflowChecks(implicit_stack_overflow_checks);
+    driver->SetMethodHooks(method_hooks);
+    driver->SetSupportRelativeCalls(relative_calls);
 
     if (compiler_backend_ == kPortable) {
       driver->SetBitcodeFileName(bitcode_filename);
@@ -298,12 +412,15 @@ class Dex2Oat {
                        uintptr_t image_base,
                        const std::string& oat_filename,
                        const std::string& oat_location,
-                       const CompilerDriver& compiler)
+                       const CompilerDriver& compiler,
+                       UniquePtr<CompilerDriver::DescriptorSet>& startup_classes,
+                       UniquePtr<std::set<std::string> >& startup_strings)
       LOCKS_EXCLUDED(Locks::mutator_lock_) {
     uintptr_t oat_data_begin;
     {
       // ImageWriter is scoped so it can free memory before doing FixupElf
       ImageWriter image_writer(compiler);
+      image_writer.SetStartupProfile(startup_classes.release(), startup_strings.release());
       if (!image_writer.Write(image_filename, image_base, oat_filename, oat_location)) {
         LOG(ERROR) << "Failed to create image file " << image_filename;
         return false;
@@ -409,19 +526,56 @@ static bool ParseInt(const char* in, int* out) {
   return true;
 }
 
+struct OpenDexFilesArgs {
+  const std::vector<const char*>* dex_filenames;
+  const std::vector<const char*>* dex_locations;
+  std::vector<const DexFile*>* opened;
+  size_t first;
+  size_t stride;
+};
+
+static void* OpenDexFilesCallback(void* arg) {
+  OpenDexFilesArgs* args = reinterpret_cast<OpenDexFilesArgs*>(arg);
+  for (size_t i = args->first; i < args->dex_filenames->size(); i += args->stride) {
+    (*args->opened)[i] = DexFile::Open((*args->dex_filenames)[i], (*args->dex_locations)[i]);
+  }
+  return NULL;
+}
+
+// Opens the dex files on up to thread_count threads, so that extracting one dex file from its zip
+// overlaps with extracting and verifying the others. The runtime may not exist yet, so these are
+// plain pthreads rather than a ThreadPool. The dex files are returned in the order given.
 static size_t OpenDexFiles(const std::vector<const char*>& dex_filenames,
                            const std::vector<const char*>& dex_locations,
-                           std::vector<const DexFile*>& dex_files) {
+                           std::vector<const DexFile*>& dex_files,
+                           size_t thread_count) {
+  std::vector<const DexFile*> opened(dex_filenames.size(), NULL);
+  size_t num_threads = std::max<size_t>(1, std::min(thread_count, dex_filenames.size()));
+  std::vector<OpenDexFilesArgs> args(num_threads);
+  std::vector<pthread_t> pthreads(num_threads);
+  for (size_t i = 0; i < num_threads; ++i) {
+    args[i].dex_filenames = &dex_filenames;
+    args[i].dex_locations = &dex_locations;
+    args[i].opened = &opened;
+    args[i].first = i;
+    args[i].stride = num_threads;
+    if (i != 0) {
+      CHECK_PTHREAD_CALL(pthread_create, (&pthreads[i], NULL, OpenDexFilesCallback, &args[i]),
+                         "open dex files thread");
+    }
+  }
+  OpenDexFilesCallback(&args[0]);
+  for (size_t i = 1; i < num_threads; ++i) {
+    CHECK_PTHREAD_CALL(pthread_join, (pthreads[i], NULL), "open dex files thread");
+  }
+
   size_t failure_count = 0;
   for (size_t i = 0; i < dex_filenames.size(); i++) {
-    const char* dex_filename = dex_filenames[i];
-    const char* dex_location = dex_locations[i];
-    const DexFile* dex_file = DexFile::Open(dex_filename, dex_location);
-    if (dex_file == NULL) {
-      LOG(WARNING) << "Failed to open .dex from file '" << dex_filename << "'\n";
+    if (opened[i] == NULL) {
+      LOG(WARNING) << "Failed to open .dex from file '" << dex_filenames[i] << "'\n";
       ++failure_count;
     } else {
-      dex_files.push_back(dex_file);
+      dex_files.push_back(opened[i]);
     }
   }
   return failure_count;
@@ -582,6 +736,8 @@ static int dex2oat(int argc, char** argv) {
   std::string bitcode_filename;
   const char* image_classes_zip_filename = NULL;
   const char* image_classes_filename = NULL;
+  const char* image_startup_classes_filename = NULL;
+  const char* image_startup_strings_filename = NULL;
   std::string image_filename;
   std::string boot_image_filename;
   uintptr_t image_base = 0;
@@ -594,6 +750,7 @@ static int dex2oat(int argc, char** argv) {
 #else
   CompilerBackend compiler_backend = kQuick;
 #endif
+  bool use_sea_ir = false;
 #if defined(__arm__)
   InstructionSet instruction_set = kThumb2;
 #elif defined(__i386__)
@@ -606,8 +763,19 @@ static int dex2oat(int argc, char** argv) {
   bool is_host = false;
   bool dump_stats = kIsDebugBuild;
   bool dump_timing = false;
+  bool implicit_suspend_checks = false;
+  bool implicit_null_checks = false;
+  bool implicit_stack_overflow_checks = false;
+  bool method_hooks = false;
+  bool relative_calls = false;
+  std::string method_report_filename;
   bool dump_slow_timing = kIsDebugBuild;
   bool watch_dog_enabled = !kIsTargetBuild;
+  std::string profile_filename;
+  double top_k_profile_threshold = 90.0;
+  std::string input_oat_filename;
+  int memory_budget_mb = -1;
+  std::string swap_filename;
 
 
   for (int i = 0; i < argc; i++) {
@@ -653,6 +821,10 @@ static int dex2oat(int argc, char** argv) {
       image_filename = option.substr(strlen("--image=")).data();
     } else if (option.starts_with("--image-classes=")) {
       image_classes_filename = option.substr(strlen("--image-classes=")).data();
+    } else if (option.starts_with("--image-startup-classes=")) {
+      image_startup_classes_filename = option.substr(strlen("--image-startup-classes=")).data();
+    } else if (option.starts_with("--image-startup-strings=")) {
+      image_startup_strings_filename = option.substr(strlen("--image-startup-strings=")).data();
     } else if (option.starts_with("--image-classes-zip=")) {
       image_classes_zip_filename = option.substr(strlen("--image-classes-zip=")).data();
     } else if (option.starts_with("--base=")) {
@@ -683,6 +855,11 @@ static int dex2oat(int argc, char** argv) {
         compiler_backend = kQuick;
       } else if (backend_str == "Portable") {
         compiler_backend = kPortable;
+#ifdef ART_SEA_IR_MODE
+      } else if (backend_str == "SeaIr") {
+        compiler_backend = kPortable;
+        use_sea_ir = true;
+#endif
       }
     } else if (option == "--host") {
       is_host = true;
@@ -696,6 +873,38 @@ static int dex2oat(int argc, char** argv) {
       runtime_args.push_back(argv[i]);
     } else if (option == "--dump-timing") {
       dump_timing = true;
+    } else if (option == "--implicit-suspend-checks") {
+      implicit_suspend_checks = true;
+    } else if (option == "--implicit-null-checks") {
+      implicit_null_checks = true;
+    } else if (option == "--implicit-stack-overflow-checks") {
+      implicit_stack_overflow_checks = true;
+    } else if (option == "--method-hooks") {
+      method_hooks = true;
+    } else if (option == "--relative-calls") {
+      relative_calls = true;
+    } else if (option.starts_with("--method-report=")) {
+      method_report_filename = option.substr(strlen("--method-report=")).data();
+    } else if (option.starts_with("--profile-file=")) {
+      profile_filename = option.substr(strlen("--profile-file=")).data();
+    } else if (option.starts_with("--top-k-profile-threshold=")) {
+      const char* threshold_str = option.substr(strlen("--top-k-profile-threshold=")).data();
+      char* end;
+      top_k_profile_threshold = strtod(threshold_str, &end);
+      if (end == threshold_str || *end != '\0' || top_k_profile_threshold <= 0.0 ||
+          top_k_profile_threshold > 100.0) {
+        Usage("Failed to parse --top-k-profile-threshold '%s' as a percentage", threshold_str);
+      }
+    } else if (option.starts_with("--input-oat-file=")) {
+      input_oat_filename = option.substr(strlen("--input-oat-file=")).data();
+    } else if (option.starts_with("--memory-budget=")) {
+      const char* memory_budget_str = option.substr(strlen("--memory-budget=")).data();
+      if (!ParseInt(memory_budget_str, &memory_budget_mb) || memory_budget_mb < 0) {
+        Usage("Failed to parse --memory-budget argument '%s' as a size in megabytes",
+              memory_budget_str);
+      }
+    } else if (option.starts_with("--swap-file=")) {
+      swap_filename = option.substr(strlen("--swap-file=")).data();
     } else {
       Usage("Unknown argument %s", option.data());
     }
@@ -717,10 +926,53 @@ static int dex2oat(int argc, char** argv) {
     Usage("--oat-symbols should not be used with --host");
   }
 
+  if (implicit_suspend_checks && instruction_set != kThumb2) {
+    Usage("--implicit-suspend-checks is only supported with --instruction-set=arm");
+  }
+
+  if (implicit_null_checks && instruction_set != kThumb2) {
+    Usage("--implicit-null-checks is only supported with --instruction-set=arm");
+  }
+
+  if (implicit_stack_overflow_checks && instruction_set != kThumb2) {
+    Usage("--implicit-stack-overflow-checks is only supported with --instruction-set=arm");
+  }
+
+  if (method_hooks && (instruction_set != kThumb2 || compiler_backend == kPortable)) {
+    Usage("--method-hooks is only supported with --instruction-set=arm and the quick compiler");
+  }
+
+  if (relative_calls && (instruction_set != kThumb2 || compiler_backend == kPortable ||
+                         !image_filename.empty())) {
+    Usage("--relative-calls is only supported with --instruction-set=arm, the quick compiler and"
+          " without --image");
+  }
+
   if (oat_fd != -1 && !image_filename.empty()) {
     Usage("--oat-fd should not be used with --image");
   }
 
+  if (!input_oat_filename.empty() && !image_filename.empty()) {
+    Usage("--input-oat-file should not be used with --image");
+  }
+
+  if (!input_oat_filename.empty() &&
+      (input_oat_filename == oat_filename || input_oat_filename == oat_symbols)) {
+    Usage("--input-oat-file should not be the output oat file");
+  }
+
+  if (!input_oat_filename.empty() && compiler_backend == kPortable) {
+    Usage("--input-oat-file should not be used with --compiler-backend=Portable");
+  }
+
+  if (!swap_filename.empty() && memory_budget_mb == -1) {
+    Usage("--swap-file should be used with --memory-budget");
+  }
+
+  if (memory_budget_mb != -1 && swap_filename.empty() && oat_fd != -1) {
+    Usage("--memory-budget with --oat-fd should be used with --swap-file");
+  }
+
   if (host_prefix.get() == NULL) {
     const char* android_product_out = getenv("ANDROID_PRODUCT_OUT");
     if (android_product_out != NULL) {
@@ -764,6 +1016,11 @@ static int dex2oat(int argc, char** argv) {
     Usage("--image-classes-zip should be used with --image-classes");
   }
 
+  if ((image_startup_classes_filename != NULL || image_startup_strings_filename != NULL) &&
+      !image) {
+    Usage("--image-startup-classes and --image-startup-strings should only be used with --image");
+  }
+
   if (dex_filenames.empty() && zip_fd == -1) {
     Usage("Input must be supplied with either --dex-file or --zip-fd");
   }
@@ -826,6 +1083,21 @@ static int dex2oat(int argc, char** argv) {
     return EXIT_FAILURE;
   }
 
+  // The swap file is unlinked right away so that it goes away with the process, however it exits.
+  UniquePtr<SwapSpace> swap_space;
+  if (memory_budget_mb != -1) {
+    if (swap_filename.empty()) {
+      swap_filename = oat_unstripped + ".swap";
+    }
+    int swap_fd = open(swap_filename.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (swap_fd == -1) {
+      PLOG(ERROR) << "Failed to create swap file: " << swap_filename;
+      return EXIT_FAILURE;
+    }
+    unlink(swap_filename.c_str());
+    swap_space.reset(new SwapSpace(swap_fd, memory_budget_mb * MB));
+  }
+
   timings.StartSplit("dex2oat Setup");
   LOG(INFO) << "dex2oat: " << oat_location;
 
@@ -846,7 +1118,8 @@ static int dex2oat(int argc, char** argv) {
   options.push_back(std::make_pair("compiler", reinterpret_cast<void*>(NULL)));
   std::vector<const DexFile*> boot_class_path;
   if (boot_image_option.empty()) {
-    size_t failure_count = OpenDexFiles(dex_filenames, dex_locations, boot_class_path);
+    size_t failure_count = OpenDexFiles(dex_filenames, dex_locations, boot_class_path,
+                                        thread_count);
     if (failure_count > 0) {
       LOG(ERROR) << "Failed to open some dex files: " << failure_count;
       return EXIT_FAILURE;
@@ -862,9 +1135,9 @@ static int dex2oat(int argc, char** argv) {
     options.push_back(std::make_pair(runtime_args[i], reinterpret_cast<void*>(NULL)));
   }
 
-#ifdef ART_SEA_IR_MODE
-  options.push_back(std::make_pair("-sea_ir", reinterpret_cast<void*>(NULL)));
-#endif
+  if (use_sea_ir) {
+    options.push_back(std::make_pair("-sea_ir", reinterpret_cast<void*>(NULL)));
+  }
 
   Dex2Oat* p_dex2oat;
   if (!Dex2Oat::Create(&p_dex2oat, options, compiler_backend, instruction_set, thread_count)) {
@@ -897,6 +1170,71 @@ static int dex2oat(int argc, char** argv) {
     }
   }
 
+  // Like the method profile below, a missing startup profile only loses the image layout tuning.
+  UniquePtr<CompilerDriver::DescriptorSet> image_startup_classes(NULL);
+  if (image_startup_classes_filename != NULL) {
+    std::ifstream image_startup_classes_file(image_startup_classes_filename, std::ifstream::in);
+    if (image_startup_classes_file.good()) {
+      image_startup_classes.reset(dex2oat->ReadImageClasses(image_startup_classes_file));
+    } else {
+      LOG(WARNING) << "Failed to read image startup classes from "
+                   << image_startup_classes_filename;
+    }
+  }
+  UniquePtr<std::set<std::string> > image_startup_strings(NULL);
+  if (image_startup_strings_filename != NULL) {
+    image_startup_strings.reset(dex2oat->ReadImageStringsFromFile(image_startup_strings_filename));
+    if (image_startup_strings.get() == NULL) {
+      LOG(WARNING) << "Failed to read image startup strings from "
+                   << image_startup_strings_filename;
+    }
+  }
+
+  // A missing or stale profile only loses the tuning, the code is compiled either way. The hot
+  // methods are also laid out first in the oat file, most sampled first.
+  UniquePtr<std::set<std::string> > hot_methods(NULL);
+  std::vector<std::string> code_order;
+  if (!profile_filename.empty()) {
+    UniquePtr<ProfileFile> profile(ProfileFile::Read(profile_filename));
+    if (profile.get() != NULL) {
+      profile->GetHotMethodsBySamples(top_k_profile_threshold, &code_order);
+      hot_methods.reset(new std::set<std::string>(code_order.begin(), code_order.end()));
+      VLOG(compiler) << "Compiling " << hot_methods->size() << " hot methods of "
+                     << profile->GetMethods().size() << " in " << profile_filename << " for speed";
+    }
+  }
+
+  // Likewise a missing or stale input oat file only means everything is compiled again. Its code
+  // embeds addresses in the boot image, so it must have been compiled against the current one.
+  UniquePtr<const OatFile> input_oat_file(NULL);
+  if (!input_oat_filename.empty()) {
+    input_oat_file.reset(OatFile::Open(input_oat_filename, input_oat_filename, NULL, false));
+    if (input_oat_file.get() == NULL) {
+      LOG(WARNING) << "Failed to open input oat file " << input_oat_filename;
+    } else {
+      const OatHeader& oat_header = input_oat_file->GetOatHeader();
+      const ImageHeader& image_header =
+          Runtime::Current()->GetHeap()->GetImageSpace()->GetImageHeader();
+      if (oat_header.GetInstructionSet() != instruction_set ||
+          oat_header.GetImageFileLocationOatChecksum() != image_header.GetOatChecksum() ||
+          oat_header.GetImageFileLocationOatDataBegin() !=
+              reinterpret_cast<uint32_t>(image_header.GetOatDataBegin())) {
+        LOG(WARNING) << "Not reusing the code of " << input_oat_filename
+                     << " compiled for another instruction set or boot image";
+        input_oat_file.reset();
+      } else if (oat_header.HasMethodHooks() != method_hooks) {
+        LOG(WARNING) << "Not reusing the code of " << input_oat_filename
+                     << " compiled " << (method_hooks ? "without" : "with") << " method hooks";
+        input_oat_file.reset();
+      } else if (oat_header.HasRelativeCalls()) {
+        // The branches were patched for that file's code layout.
+        LOG(WARNING) << "Not reusing the code of " << input_oat_filename
+                     << " compiled with relative calls";
+        input_oat_file.reset();
+      }
+    }
+  }
+
   std::vector<const DexFile*> dex_files;
   if (boot_image_option.empty()) {
     dex_files = Runtime::Current()->GetClassLinker()->GetBootClassPath();
@@ -907,14 +1245,28 @@ static int dex2oat(int argc, char** argv) {
         LOG(ERROR) << "Failed to open zip from file descriptor for " << zip_location;
         return EXIT_FAILURE;
       }
-      const DexFile* dex_file = DexFile::Open(*zip_archive.get(), zip_location);
+      // A dex file the input oat file was compiled from was verified then, so only its header
+      // and map are checked again rather than paging in the whole file.
+      const uint32_t* trusted_checksum = NULL;
+      uint32_t input_checksum;
+      if (input_oat_file.get() != NULL) {
+        ScopedObjectAccess soa(Thread::Current());
+        const OatFile::OatDexFile* oat_dex_file =
+            input_oat_file->GetOatDexFile(zip_location, NULL, false);
+        if (oat_dex_file != NULL) {
+          input_checksum = oat_dex_file->GetDexFileLocationChecksum();
+          trusted_checksum = &input_checksum;
+        }
+      }
+      const DexFile* dex_file = DexFile::Open(*zip_archive.get(), zip_location, trusted_checksum);
       if (dex_file == NULL) {
         LOG(ERROR) << "Failed to open dex from file descriptor for zip file: " << zip_location;
         return EXIT_FAILURE;
       }
       dex_files.push_back(dex_file);
     } else {
-      size_t failure_count = OpenDexFiles(dex_filenames, dex_locations, dex_files);
+      size_t failure_count = OpenDexFiles(dex_filenames, dex_locations, dex_files,
+                                          thread_count);
       if (failure_count > 0) {
         LOG(ERROR) << "Failed to open some dex files: " << failure_count;
         return EXIT_FAILURE;
@@ -955,6 +1307,16 @@ static int dex2oat(int argc, char** argv) {
                                                                   bitcode_filename,
                                                                   image,
                                                                   image_classes,
+                                                                  hot_methods,
+                                                                  code_order,
+                                                                  input_oat_file,
+                                                                  swap_space,
+                                                                  !method_report_filename.empty(),
+                                                                  implicit_suspend_checks,
+                                                                  implicit_null_checks,
+                                                                  implicit_stack_overflow_checks,
+                                                                  method_hooks,
+                                                                  relative_calls,
                                                                   dump_stats,
                                                                   timings));
 
@@ -965,6 +1327,16 @@ static int dex2oat(int argc, char** argv) {
 
   VLOG(compiler) << "Oat file written successfully (unstripped): " << oat_location;
 
+  if (!method_report_filename.empty()) {
+    std::ostringstream method_report;
+    compiler->DumpMethodReport(method_report);
+    UniquePtr<File> method_report_file(OS::CreateEmptyFile(method_report_filename.c_str()));
+    if (method_report_file.get() == NULL ||
+        !method_report_file->WriteFully(method_report.str().data(), method_report.str().size())) {
+      PLOG(ERROR) << "Failed to write method report: " << method_report_filename;
+    }
+  }
+
   // Notes on the interleaving of creating the image and oat file to
   // ensure the references between the two are correct.
   //
@@ -1021,7 +1393,9 @@ static int dex2oat(int argc, char** argv) {
                                                            image_base,
                                                            oat_unstripped,
                                                            oat_location,
-                                                           *compiler.get());
+                                                           *compiler.get(),
+                                                           image_startup_classes,
+                                                           image_startup_strings);
     if (!image_creation_success) {
       return EXIT_FAILURE;
     }
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+
+#include "base/logging.h"
+#include "base/unix_file/fd_file.h"
+#include "hprof/hprof.h"
+#include "os.h"
+#include "UniquePtr.h"
+
+namespace art {
+
+static void usage() {
+  fprintf(stderr,
+          "Usage: hprofexpand <compact dump> <hprof output>\n"
+          "  Converts a heap dump written by VMDebug.dumpHprofDataCompact to a standard hprof\n"
+          "  file, which hprof-conv and other tools can read.\n");
+  exit(EXIT_FAILURE);
+}
+
+static int hprofexpand(int argc, char** argv) {
+  InitLogging(argv);
+
+  if (argc != 3) {
+    usage();
+  }
+
+  UniquePtr<File> in(OS::OpenFileForReading(argv[1]));
+  if (in.get() == NULL) {
+    fprintf(stderr, "Failed to open %s\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+  UniquePtr<File> out(OS::CreateEmptyFile(argv[2]));
+  if (out.get() == NULL) {
+    fprintf(stderr, "Failed to create %s\n", argv[2]);
+    return EXIT_FAILURE;
+  }
+  std::string error_msg;
+  if (!hprof::ExpandCompactDump(in.get(), out.get(), &error_msg)) {
+    fprintf(stderr, "%s\n", error_msg.c_str());
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+}  // namespace art
+
+int main(int argc, char** argv) {
+  return art::hprofexpand(argc, argv);
+}
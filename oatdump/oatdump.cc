@@ -17,8 +17,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -81,6 +84,11 @@ static void usage() {
           "  --output=<file> may be used to send the output to a file.\n"
           "      Example: --output=/tmp/oatdump.txt\n"
           "\n");
+  fprintf(stderr,
+          "  --stats: with --oat-file, print the oat bytes of code, mapping tables, vmap tables\n"
+          "      and GC maps per package instead of dumping every method. Image dumps always end\n"
+          "      with their statistics.\n"
+          "\n");
   exit(EXIT_FAILURE);
 }
 
@@ -92,6 +100,9 @@ const char* image_roots_descriptions_[] = {
   "kOatLocation",
   "kDexCaches",
   "kClassRoots",
+  "kClassTable",
+  "kClassTableHashes",
+  "kInternTable",
 };
 
 class OatDumper {
@@ -169,6 +180,83 @@ class OatDumper {
     return oat_file_.GetOatHeader().GetInstructionSet();
   }
 
+  // Attributes the bytes of the oat file to the packages of the methods they belong to. Code and
+  // tables shared by deduplication count once, for the first method using them, and the bytes
+  // the sharing saved are totalled separately.
+  void DumpStats(std::ostream& os) {
+    std::map<std::string, PackageStats> packages;
+    PackageStats total;
+    size_t deduplicated_bytes = 0;
+    std::set<const void*> seen;
+    for (size_t i = 0; i < oat_dex_files_.size(); i++) {
+      const OatFile::OatDexFile* oat_dex_file = oat_dex_files_[i];
+      CHECK(oat_dex_file != NULL);
+      UniquePtr<const DexFile> dex_file(oat_dex_file->OpenDexFile());
+      if (dex_file.get() == NULL) {
+        continue;
+      }
+      for (size_t class_def_index = 0; class_def_index < dex_file->NumClassDefs();
+           class_def_index++) {
+        const DexFile::ClassDef& class_def = dex_file->GetClassDef(class_def_index);
+        const byte* class_data = dex_file->GetClassData(class_def);
+        if (class_data == NULL) {
+          continue;
+        }
+        PackageStats& package =
+            packages[PackageOf(dex_file->GetClassDescriptor(class_def))];
+        UniquePtr<const OatFile::OatClass> oat_class(oat_dex_file->GetOatClass(class_def_index));
+        ClassDataItemIterator it(*dex_file, class_data);
+        SkipAllFields(it);
+        for (uint32_t class_method_index = 0; it.HasNext(); ++class_method_index, it.Next()) {
+          const OatFile::OatMethod oat_method = oat_class->GetOatMethod(class_method_index);
+          const size_t sizes[PackageStats::kNumKinds] = {
+            oat_method.GetCode() != NULL ? oat_method.GetCodeSize() : 0,
+            ComputeSize(oat_method.GetMappingTable()),
+            ComputeSize(oat_method.GetVmapTable()),
+            ComputeSize(oat_method.GetNativeGcMap()),
+          };
+          const void* const starts[PackageStats::kNumKinds] = {
+            oat_method.GetCode(),
+            oat_method.GetMappingTable(),
+            oat_method.GetVmapTable(),
+            oat_method.GetNativeGcMap(),
+          };
+          for (size_t kind = 0; kind < PackageStats::kNumKinds; ++kind) {
+            if (sizes[kind] == 0) {
+              continue;
+            }
+            if (!seen.insert(starts[kind]).second) {
+              deduplicated_bytes += sizes[kind];
+              continue;
+            }
+            package.bytes[kind] += sizes[kind];
+            total.bytes[kind] += sizes[kind];
+          }
+        }
+      }
+    }
+
+    std::vector<std::pair<size_t, std::string> > by_size;
+    typedef std::map<std::string, PackageStats>::const_iterator It;
+    for (It it = packages.begin(); it != packages.end(); ++it) {
+      by_size.push_back(std::make_pair(it->second.Total(), it->first));
+    }
+    std::sort(by_size.rbegin(), by_size.rend());
+    const size_t oat_file_bytes = oat_file_.Size();
+    os << StringPrintf("%10s %10s %10s %10s %10s  %s\n", "total", "code", "mapping", "vmap",
+                       "gc_map", "package");
+    for (size_t i = 0; i < by_size.size() && by_size[i].first != 0; ++i) {
+      packages[by_size[i].second].Dump(os, by_size[i].second);
+    }
+    total.Dump(os, "(all packages)");
+    os << "\n" << StringPrintf("oat_file_bytes     = %10zd\n"
+                               "other_bytes        = %10zd (headers, dex files, alignment)\n"
+                               "deduplicated_bytes = %10zd (saved by sharing code and tables)\n",
+                               oat_file_bytes,
+                               oat_file_bytes > total.Total() ? oat_file_bytes - total.Total() : 0,
+                               deduplicated_bytes);
+  }
+
   const void* GetOatCode(mirror::ArtMethod* m) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
     MethodHelper mh(m);
     for (size_t i = 0; i < oat_dex_files_.size(); i++) {
@@ -191,6 +279,36 @@ class OatDumper {
   }
 
  private:
+  struct PackageStats {
+    enum Kind { kCode, kMappingTable, kVmapTable, kGcMap, kNumKinds };
+
+    PackageStats() {
+      std::fill(bytes, bytes + kNumKinds, 0u);
+    }
+
+    size_t Total() const {
+      size_t total = 0;
+      for (size_t kind = 0; kind < kNumKinds; ++kind) {
+        total += bytes[kind];
+      }
+      return total;
+    }
+
+    void Dump(std::ostream& os, const std::string& name) const {
+      os << StringPrintf("%10zd %10zd %10zd %10zd %10zd  %s\n", Total(), bytes[kCode],
+                         bytes[kMappingTable], bytes[kVmapTable], bytes[kGcMap], name.c_str());
+    }
+
+    size_t bytes[kNumKinds];
+  };
+
+  // The package of a class descriptor in dotted form, such as java.lang for Ljava/lang/String;.
+  static std::string PackageOf(const char* descriptor) {
+    std::string name(PrettyDescriptor(descriptor));
+    size_t last_dot = name.rfind('.');
+    return last_dot == std::string::npos ? "(default package)" : name.substr(0, last_dot);
+  }
+
   void AddAllOffsets() {
     // We don't know the length of the code for each method, but we need to know where to stop
     // when disassembling. What we do know is that a region of code will be followed by some other
@@ -1363,6 +1481,7 @@ static int oatdump(int argc, char** argv) {
   const char* oat_filename = NULL;
   const char* image_filename = NULL;
   const char* boot_image_filename = NULL;
+  bool dump_stats = false;
   std::string elf_filename_prefix;
   UniquePtr<std::string> host_prefix;
   std::ostream* os = &std::cout;
@@ -1376,6 +1495,8 @@ static int oatdump(int argc, char** argv) {
       image_filename = option.substr(strlen("--image=")).data();
     } else if (option.starts_with("--boot-image=")) {
       boot_image_filename = option.substr(strlen("--boot-image=")).data();
+    } else if (option == "--stats") {
+      dump_stats = true;
     } else if (option.starts_with("--host-prefix=")) {
       host_prefix.reset(new std::string(option.substr(strlen("--host-prefix=")).data()));
     } else if (option.starts_with("--output=")) {
@@ -1419,7 +1540,11 @@ static int oatdump(int argc, char** argv) {
       return EXIT_FAILURE;
     }
     OatDumper oat_dumper(*host_prefix.get(), *oat_file);
-    oat_dumper.Dump(*os);
+    if (dump_stats) {
+      oat_dumper.DumpStats(*os);
+    } else {
+      oat_dumper.Dump(*os);
+    }
     return EXIT_SUCCESS;
   }
 
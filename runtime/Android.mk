@@ -19,8 +19,10 @@ LOCAL_PATH := $(call my-dir)
 include art/build/Android.common.mk
 
 LIBART_COMMON_SRC_FILES := \
+	alloc_profiler.cc \
 	atomic.cc.arm \
 	barrier.cc \
+	base/concurrent_histogram.cc \
 	base/logging.cc \
 	base/mutex.cc \
 	base/stringpiece.cc \
@@ -31,11 +33,14 @@ LIBART_COMMON_SRC_FILES := \
 	base/unix_file/null_file.cc \
 	base/unix_file/random_access_file_utils.cc \
 	base/unix_file/string_file.cc \
+	catch_handler_cache.cc \
 	check_jni.cc \
+	class_table.cc \
 	class_linker.cc \
 	common_throws.cc \
 	debugger.cc \
 	dex_file.cc \
+	dex_file_lookup_table.cc \
 	dex_file_verifier.cc \
 	dex_instruction.cc \
 	disassembler.cc \
@@ -63,7 +68,13 @@ LIBART_COMMON_SRC_FILES := \
 	indirect_reference_table.cc \
 	instrumentation.cc \
 	intern_table.cc \
+	intrinsics.cc \
+	interpreter/inline_cache.cc \
 	interpreter/interpreter.cc \
+	interpreter/interpreter_common.cc \
+	interpreter/interpreter_goto_table_impl.cc \
+	interpreter/interpreter_switch_impl.cc \
+	interpreter/quickening.cc \
 	jdwp/jdwp_event.cc \
 	jdwp/jdwp_expand_buf.cc \
 	jdwp/jdwp_handler.cc \
@@ -71,6 +82,7 @@ LIBART_COMMON_SRC_FILES := \
 	jdwp/jdwp_request.cc \
 	jdwp/jdwp_socket.cc \
 	jdwp/object_registry.cc \
+	jit/jit.cc \
 	jni_internal.cc \
 	jobject_comparator.cc \
 	locks.cc \
@@ -113,9 +125,14 @@ LIBART_COMMON_SRC_FILES := \
 	oat_file.cc \
 	offsets.cc \
 	os_linux.cc \
+	perf_counters.cc \
 	primitive.cc \
+	profile_file.cc \
+	proxy_invoke_cache.cc \
 	reference_table.cc \
 	reflection.cc \
+	reflective_field_cache.cc \
+	reflective_invoke_cache.cc \
 	runtime.cc \
 	signal_catcher.cc \
 	stack.cc \
@@ -124,6 +141,7 @@ LIBART_COMMON_SRC_FILES := \
 	thread_pool.cc \
 	throw_location.cc \
 	trace.cc \
+	transaction.cc \
 	utf.cc \
 	utils.cc \
 	verifier/dex_gc_map.cc \
@@ -137,8 +155,10 @@ LIBART_COMMON_SRC_FILES := \
 
 LIBART_COMMON_SRC_FILES += \
 	arch/context.cc \
+	arch/memcmp16.cc \
 	arch/arm/registers_arm.cc \
 	arch/x86/registers_x86.cc \
+	arch/x86_64/registers_x86_64.cc \
 	arch/mips/registers_mips.cc \
 	entrypoints/entrypoint_utils.cc \
 	entrypoints/interpreter/interpreter_entrypoints.cc \
@@ -166,6 +186,7 @@ LIBART_COMMON_SRC_FILES += \
 	entrypoints/quick/quick_jni_entrypoints.cc \
 	entrypoints/quick/quick_lock_entrypoints.cc \
 	entrypoints/quick/quick_math_entrypoints.cc \
+	entrypoints/quick/quick_string_entrypoints.cc \
 	entrypoints/quick/quick_thread_entrypoints.cc \
 	entrypoints/quick/quick_throw_entrypoints.cc \
 	entrypoints/quick/quick_trampoline_entrypoints.cc
@@ -183,6 +204,7 @@ LIBART_TARGET_SRC_FILES += \
 	arch/arm/context_arm.cc.arm \
 	arch/arm/entrypoints_init_arm.cc \
 	arch/arm/jni_entrypoints_arm.S \
+	arch/arm/mterp_arm.S \
 	arch/arm/portable_entrypoints_arm.S \
 	arch/arm/quick_entrypoints_arm.S \
 	arch/arm/thread_arm.cc
@@ -192,10 +214,20 @@ LIBART_TARGET_SRC_FILES += \
 	arch/x86/context_x86.cc \
 	arch/x86/entrypoints_init_x86.cc \
 	arch/x86/jni_entrypoints_x86.S \
+	arch/x86/mterp_x86.S \
 	arch/x86/portable_entrypoints_x86.S \
 	arch/x86/quick_entrypoints_x86.S \
 	arch/x86/thread_x86.cc
 else # TARGET_ARCH != x86
+ifeq ($(TARGET_ARCH),x86_64)
+LIBART_TARGET_SRC_FILES += \
+	arch/x86_64/context_x86_64.cc \
+	arch/x86_64/entrypoints_init_x86_64.cc \
+	arch/x86_64/jni_entrypoints_x86_64.S \
+	arch/x86_64/portable_entrypoints_x86_64.S \
+	arch/x86_64/quick_entrypoints_x86_64.S \
+	arch/x86_64/thread_x86_64.cc
+else # TARGET_ARCH != x86_64
 ifeq ($(TARGET_ARCH),mips)
 LIBART_TARGET_SRC_FILES += \
 	arch/mips/context_mips.cc \
@@ -207,6 +239,7 @@ LIBART_TARGET_SRC_FILES += \
 else # TARGET_ARCH != mips
 $(error unsupported TARGET_ARCH=$(TARGET_ARCH))
 endif # TARGET_ARCH != mips
+endif # TARGET_ARCH != x86_64
 endif # TARGET_ARCH != x86
 endif # TARGET_ARCH != arm
 
@@ -223,11 +256,22 @@ LIBART_HOST_SRC_FILES += \
 	arch/x86/context_x86.cc \
 	arch/x86/entrypoints_init_x86.cc \
 	arch/x86/jni_entrypoints_x86.S \
+	arch/x86/mterp_x86.S \
 	arch/x86/portable_entrypoints_x86.S \
 	arch/x86/quick_entrypoints_x86.S \
 	arch/x86/thread_x86.cc
 else # HOST_ARCH != x86
+ifeq ($(HOST_ARCH),x86_64)
+LIBART_HOST_SRC_FILES += \
+	arch/x86_64/context_x86_64.cc \
+	arch/x86_64/entrypoints_init_x86_64.cc \
+	arch/x86_64/jni_entrypoints_x86_64.S \
+	arch/x86_64/portable_entrypoints_x86_64.S \
+	arch/x86_64/quick_entrypoints_x86_64.S \
+	arch/x86_64/thread_x86_64.cc
+else # HOST_ARCH != x86_64
 $(error unsupported HOST_ARCH=$(HOST_ARCH))
+endif # HOST_ARCH != x86_64
 endif # HOST_ARCH != x86
 
 
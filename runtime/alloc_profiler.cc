@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "alloc_profiler.h"
+
+#include <math.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+#include "base/mutex.h"
+#include "base/stringprintf.h"
+#include "mirror/art_method-inl.h"
+#include "object_utils.h"
+#include "os.h"
+#include "safe_map.h"
+#include "stack.h"
+#include "thread.h"
+#include "UniquePtr.h"
+#include "utils.h"
+
+namespace art {
+
+static const size_t kMaxSampleStackDepth = 32;
+
+struct SampleFrame {
+  mirror::ArtMethod* method;
+  uint32_t dex_pc;
+
+  bool operator<(const SampleFrame& other) const {
+    return method != other.method ? method < other.method : dex_pc < other.dex_pc;
+  }
+};
+
+// A call site is keyed by the hash of its frames first so that lookups rarely have to compare
+// whole stacks.
+struct SampleCallSite {
+  uint32_t hash;
+  std::vector<SampleFrame> frames;
+
+  bool operator<(const SampleCallSite& other) const {
+    if (hash != other.hash) {
+      return hash < other.hash;
+    }
+    return std::lexicographical_compare(frames.begin(), frames.end(),
+                                        other.frames.begin(), other.frames.end());
+  }
+};
+
+struct SampleCounts {
+  SampleCounts() : count(0), bytes(0) {}
+
+  uint64_t count;
+  uint64_t bytes;
+};
+
+static Mutex gAllocProfilerLock DEFAULT_MUTEX_ACQUIRED_AFTER("AllocProfiler lock");
+static SafeMap<SampleCallSite, SampleCounts> gCallSites GUARDED_BY(gAllocProfilerLock);
+static size_t gSampleInterval GUARDED_BY(gAllocProfilerLock) = 0;
+static uint64_t gRandomState GUARDED_BY(gAllocProfilerLock) = 0;
+bool AllocProfiler::enabled_ = false;
+
+struct SampleStackVisitor : public StackVisitor {
+  SampleStackVisitor(Thread* thread, std::vector<SampleFrame>* frames)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_)
+      : StackVisitor(thread, NULL), frames(frames) {}
+
+  bool VisitFrame() NO_THREAD_SAFETY_ANALYSIS {
+    if (frames->size() >= kMaxSampleStackDepth) {
+      return false;
+    }
+    mirror::ArtMethod* m = GetMethod();
+    if (!m->IsRuntimeMethod()) {
+      SampleFrame frame;
+      frame.method = m;
+      frame.dex_pc = GetDexPc();
+      frames->push_back(frame);
+    }
+    return true;
+  }
+
+  std::vector<SampleFrame>* const frames;
+};
+
+void AllocProfiler::Start(size_t interval_bytes) {
+  CHECK_GT(interval_bytes, 0U);
+  MutexLock mu(Thread::Current(), gAllocProfilerLock);
+  gCallSites.clear();
+  gSampleInterval = interval_bytes;
+  gRandomState = NanoTime() | 1;
+  LOG(INFO) << "Starting allocation sampling every " << PrettySize(interval_bytes);
+  enabled_ = true;
+}
+
+void AllocProfiler::Stop() {
+  MutexLock mu(Thread::Current(), gAllocProfilerLock);
+  enabled_ = false;
+}
+
+// Draws the number of bytes until the next sample from an exponential distribution, which is what
+// pprof assumes when it scales heap_v2 samples back up.
+size_t AllocProfiler::NextSampleInterval() {
+  gAllocProfilerLock.AssertHeld(Thread::Current());
+  // Xorshift, good enough to decorrelate samples from allocation patterns.
+  gRandomState ^= gRandomState << 13;
+  gRandomState ^= gRandomState >> 7;
+  gRandomState ^= gRandomState << 17;
+  // Uniform in (0, 1].
+  const double uniform = static_cast<double>((gRandomState >> 11) + 1) / (1ULL << 53);
+  return static_cast<size_t>(-log(uniform) * gSampleInterval) + 1;
+}
+
+void AllocProfiler::RecordAllocation(Thread* self, mirror::Class* /* type */, size_t byte_count) {
+  size_t remaining = self->GetAllocProfilerBytesUntilSample();
+  if (LIKELY(remaining > byte_count)) {
+    self->SetAllocProfilerBytesUntilSample(remaining - byte_count);
+    return;
+  }
+  const bool initial = remaining == 0;
+  // Walk the stack before taking the lock since this is the expensive part.
+  SampleCallSite site;
+  if (!initial) {
+    SampleStackVisitor visitor(self, &site.frames);
+    visitor.WalkStack();
+    site.hash = 0;
+    for (const SampleFrame& frame : site.frames) {
+      site.hash = site.hash * 31 + static_cast<uint32_t>(reinterpret_cast<uintptr_t>(frame.method));
+      site.hash = site.hash * 31 + frame.dex_pc;
+    }
+  }
+  MutexLock mu(self, gAllocProfilerLock);
+  if (!enabled_) {
+    return;
+  }
+  if (!initial) {
+    auto it = gCallSites.find(site);
+    if (it == gCallSites.end()) {
+      gCallSites.Put(site, SampleCounts());
+      it = gCallSites.find(site);
+    }
+    ++it->second.count;
+    it->second.bytes += byte_count;
+  }
+  // A thread that has not allocated since sampling started only draws its first interval, this
+  // keeps every thread from sampling its first allocation.
+  self->SetAllocProfilerBytesUntilSample(NextSampleInterval());
+}
+
+void AllocProfiler::Dump(std::ostream& os) {
+  MutexLock mu(Thread::Current(), gAllocProfilerLock);
+  // pprof needs addresses, hand out a fake one per distinct frame and symbolize them up front.
+  SafeMap<SampleFrame, size_t> frame_addresses;
+  std::ostringstream heap;
+  uint64_t total_count = 0;
+  uint64_t total_bytes = 0;
+  for (const auto& it : gCallSites) {
+    const SampleCounts& counts = it.second;
+    total_count += counts.count;
+    total_bytes += counts.bytes;
+    heap << counts.count << ": " << counts.bytes << " [" << counts.count << ": " << counts.bytes
+         << "] @";
+    for (const SampleFrame& frame : it.first.frames) {
+      auto found = frame_addresses.find(frame);
+      size_t address;
+      if (found == frame_addresses.end()) {
+        address = frame_addresses.size() + 1;
+        frame_addresses.Put(frame, address);
+      } else {
+        address = found->second;
+      }
+      heap << StringPrintf(" 0x%zx", address);
+    }
+    heap << "\n";
+  }
+
+  os << "--- symbol\n";
+  os << "binary=" << GetThreadName(getpid()) << "\n";
+  MethodHelper mh;
+  for (const auto& it : frame_addresses) {
+    mh.ChangeMethod(it.first.method);
+    os << StringPrintf("0x%zx ", it.second) << PrettyMethod(it.first.method) << ":"
+       << mh.GetLineNumFromDexPC(it.first.dex_pc) << "\n";
+  }
+  os << "---\n";
+  os << "--- heap\n";
+  os << "heap profile: " << total_count << ": " << total_bytes << " [" << total_count << ": "
+     << total_bytes << "] @ heap_v2/" << gSampleInterval << "\n";
+  os << heap.str();
+}
+
+bool AllocProfiler::DumpToFile(const char* filename) {
+  std::ostringstream os;
+  Dump(os);
+  const std::string profile(os.str());
+  UniquePtr<File> file(OS::CreateEmptyFile(filename));
+  if (file.get() == NULL || !file->WriteFully(profile.c_str(), profile.size())) {
+    PLOG(ERROR) << "Unable to write allocation profile to '" << filename << "'";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace art
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_ALLOC_PROFILER_H_
+#define ART_RUNTIME_ALLOC_PROFILER_H_
+
+#include <ostream>
+
+#include "base/macros.h"
+#include "locks.h"
+
+namespace art {
+
+namespace mirror {
+  class Class;
+}  // namespace mirror
+class Thread;
+
+// Sampling allocation profiler. Unlike Dbg's allocation tracker, which walks the stack of every
+// allocation, each thread only records a stack trace once it has allocated a randomly chosen
+// number of bytes, with a mean of the sampling interval. Samples are aggregated by call site and
+// can be dumped in pprof's heap profile format.
+class AllocProfiler {
+ public:
+  // Starts sampling, discarding the samples of any previous run.
+  static void Start(size_t interval_bytes);
+  static void Stop();
+
+  static bool IsEnabled() {
+    return enabled_;
+  }
+
+  // Called by the heap for every allocation while the profiler is enabled.
+  static void RecordAllocation(Thread* self, mirror::Class* type, size_t byte_count)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Writes the samples as a symbolized pprof heap_v2 profile. Since frees are not tracked, the
+  // in-use and allocated totals are the same.
+  static void Dump(std::ostream& os) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Dumps to the given file, returns false if the file could not be written.
+  static bool DumpToFile(const char* filename) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+ private:
+  static size_t NextSampleInterval();
+
+  static bool enabled_;
+
+  DISALLOW_IMPLICIT_CONSTRUCTORS(AllocProfiler);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_ALLOC_PROFILER_H_
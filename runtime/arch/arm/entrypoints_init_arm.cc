@@ -110,6 +110,8 @@ extern "C" uint64_t art_quick_ushr_long(uint64_t, uint32_t);
 extern "C" int32_t __memcmp16(void*, void*, int32_t);
 extern "C" int32_t art_quick_indexof(void*, uint32_t, uint32_t, uint32_t);
 extern "C" int32_t art_quick_string_compareto(void*, void*);
+extern "C" uint32_t artStringEqualsFromCode(mirror::String* string,
+                                            mirror::Object* other);
 
 // Invoke entrypoints.
 extern "C" void art_quick_resolution_trampoline(mirror::ArtMethod*);
@@ -220,6 +222,7 @@ void InitEntryPoints(InterpreterEntryPoints* ipoints, JniEntryPoints* jpoints,
   qpoints->pIndexOf = art_quick_indexof;
   qpoints->pMemcmp16 = __memcmp16;
   qpoints->pStringCompareTo = art_quick_string_compareto;
+  qpoints->pStringEquals = artStringEqualsFromCode;
   qpoints->pMemcpy = memcpy;
 
   // Invocation
@@ -232,6 +235,10 @@ void InitEntryPoints(InterpreterEntryPoints* ipoints, JniEntryPoints* jpoints,
   qpoints->pInvokeSuperTrampolineWithAccessCheck = art_quick_invoke_super_trampoline_with_access_check;
   qpoints->pInvokeVirtualTrampolineWithAccessCheck = art_quick_invoke_virtual_trampoline_with_access_check;
 
+  // Instrumentation
+  qpoints->pMethodEntryHook = NULL;
+  qpoints->pMethodExitHook = NULL;
+
   // Thread
   qpoints->pCheckSuspend = CheckSuspendFromCode;
   qpoints->pTestSuspend = art_quick_test_suspend;
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "memcmp16.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+#include "utils.h"
+
+#ifdef HAVE__MEMCMP16
+// "count" is in 16-bit units.
+extern "C" uint32_t __memcmp16(const uint16_t* s0, const uint16_t* s1, size_t count);
+#endif
+
+namespace art {
+
+int32_t MemCmp16Scalar(const uint16_t* s0, const uint16_t* s1, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    if (s0[i] != s1[i]) {
+      return static_cast<int32_t>(s0[i]) - static_cast<int32_t>(s1[i]);
+    }
+  }
+  return 0;
+}
+
+int32_t MemChr16Scalar(const uint16_t* s, uint16_t ch, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    if (s[i] == ch) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// The vectorized loops look at eight code units at a time, with unaligned loads as string data
+// starts at any offset into the char array, and leave the tail and the search for the exact
+// position within a block to the scalar loops.
+
+int32_t MemCmp16(const uint16_t* s0, const uint16_t* s1, size_t count) {
+#if defined(HAVE__MEMCMP16)
+  // The C library's version is hand tuned for the target.
+  return __memcmp16(s0, s1, count);
+#elif defined(__SSE2__)
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s0 + i));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s1 + i));
+    uint32_t equal_bytes = _mm_movemask_epi8(_mm_cmpeq_epi16(a, b));
+    if (equal_bytes != 0xffff) {
+      size_t index = i + CTZ(~equal_bytes) / 2;
+      return static_cast<int32_t>(s0[index]) - static_cast<int32_t>(s1[index]);
+    }
+  }
+  return MemCmp16Scalar(s0 + i, s1 + i, count - i);
+#elif defined(__ARM_NEON__)
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    uint64x2_t equal = vreinterpretq_u64_u16(vceqq_u16(vld1q_u16(s0 + i), vld1q_u16(s1 + i)));
+    if ((vgetq_lane_u64(equal, 0) & vgetq_lane_u64(equal, 1)) != ~static_cast<uint64_t>(0)) {
+      return MemCmp16Scalar(s0 + i, s1 + i, 8);
+    }
+  }
+  return MemCmp16Scalar(s0 + i, s1 + i, count - i);
+#else
+  return MemCmp16Scalar(s0, s1, count);
+#endif
+}
+
+int32_t MemChr16(const uint16_t* s, uint16_t ch, size_t count) {
+#if defined(__SSE2__)
+  __m128i needle = _mm_set1_epi16(ch);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+    uint32_t equal_bytes = _mm_movemask_epi8(_mm_cmpeq_epi16(chars, needle));
+    if (equal_bytes != 0) {
+      return i + CTZ(equal_bytes) / 2;
+    }
+  }
+  int32_t index = MemChr16Scalar(s + i, ch, count - i);
+  return index < 0 ? index : i + index;
+#elif defined(__ARM_NEON__)
+  uint16x8_t needle = vdupq_n_u16(ch);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    uint64x2_t equal = vreinterpretq_u64_u16(vceqq_u16(vld1q_u16(s + i), needle));
+    if ((vgetq_lane_u64(equal, 0) | vgetq_lane_u64(equal, 1)) != 0) {
+      return i + MemChr16Scalar(s + i, ch, 8);
+    }
+  }
+  int32_t index = MemChr16Scalar(s + i, ch, count - i);
+  return index < 0 ? index : i + index;
+#else
+  return MemChr16Scalar(s, ch, count);
+#endif
+}
+
+}  // namespace art
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_ARCH_MEMCMP16_H_
+#define ART_RUNTIME_ARCH_MEMCMP16_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace art {
+
+// Compares count UTF-16 code units, returning the difference of the first pair that differs or 0
+// if they are all equal. This is what String.compareTo needs.
+int32_t MemCmp16(const uint16_t* s0, const uint16_t* s1, size_t count);
+
+// Returns the index of the first of count UTF-16 code units equal to ch, or -1 if there is none.
+// This is what String.indexOf needs.
+int32_t MemChr16(const uint16_t* s, uint16_t ch, size_t count);
+
+// The plain loops, for checking the vectorized versions against.
+int32_t MemCmp16Scalar(const uint16_t* s0, const uint16_t* s1, size_t count);
+int32_t MemChr16Scalar(const uint16_t* s, uint16_t ch, size_t count);
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_ARCH_MEMCMP16_H_
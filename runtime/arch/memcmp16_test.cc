@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "arch/memcmp16.h"
+
+#include <string.h>
+
+#include "gtest/gtest.h"
+
+namespace art {
+
+// Strings of all lengths up to a few vectors, at every offset within a vector, mismatching or
+// matching at every position, against the plain loops.
+TEST(MemCmp16Test, MatchesScalar) {
+  static const size_t kMaxLength = 40;
+  static const size_t kMaxOffset = 8;
+  uint16_t s0[kMaxOffset + kMaxLength];
+  uint16_t s1[kMaxOffset + kMaxLength];
+  for (size_t i = 0; i < kMaxOffset + kMaxLength; ++i) {
+    s0[i] = 'a' + (i % 7);
+  }
+  for (size_t offset = 0; offset < kMaxOffset; ++offset) {
+    for (size_t length = 0; length <= kMaxLength; ++length) {
+      for (size_t pos = 0; pos <= length; ++pos) {
+        memcpy(s1, s0, sizeof(s1));
+        if (pos < length) {
+          // Exercise both signs, and chars that are negative as int16_t.
+          s1[offset + pos] = (pos % 2 == 0) ? 0xffff : 'a' - 1;
+        }
+        EXPECT_EQ(MemCmp16Scalar(s0 + offset, s1 + offset, length),
+                  MemCmp16(s0 + offset, s1 + offset, length))
+            << offset << " " << length << " " << pos;
+        uint16_t ch = (pos < length) ? s1[offset + pos] : 0x1234;
+        EXPECT_EQ(MemChr16Scalar(s1 + offset, ch, length),
+                  MemChr16(s1 + offset, ch, length))
+            << offset << " " << length << " " << pos;
+      }
+    }
+  }
+}
+
+}  // namespace art
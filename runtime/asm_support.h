@@ -30,4 +30,8 @@
 // Offset of field Method::entry_point_from_compiled_code_
 #define METHOD_CODE_OFFSET 40
 
+// Offsets within ShadowFrame, the vregs are followed by one reference per vreg.
+#define SHADOWFRAME_NUMBER_OF_VREGS_OFFSET 0
+#define SHADOWFRAME_VREGS_OFFSET 16
+
 #endif  // ART_RUNTIME_ASM_SUPPORT_H_
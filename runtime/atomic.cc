@@ -16,7 +16,7 @@
 
 #include "atomic.h"
 
-#define NEED_SWAP_MUTEXES !defined(__arm__) && !defined(__i386__)
+#define NEED_SWAP_MUTEXES !defined(__arm__) && !defined(__i386__) && !defined(__x86_64__)
 
 #if NEED_SWAP_MUTEXES
 #include <vector>
@@ -71,6 +71,9 @@ int64_t QuasiAtomic::Read64(volatile const int64_t* addr) {
       "movq     %1, %0\n"
       : "=x" (value)
       : "m" (*addr));
+#elif defined(__x86_64__)
+  // Aligned 64-bit loads are atomic.
+  value = *addr;
 #else
 #error Unexpected architecture
 #endif
@@ -100,6 +103,9 @@ void QuasiAtomic::Write64(volatile int64_t* addr, int64_t value) {
       "movq     %1, %0"
       : "=m" (*addr)
       : "x" (value));
+#elif defined(__x86_64__)
+  // Aligned 64-bit stores are atomic.
+  *addr = value;
 #else
 #error Unexpected architecture
 #endif
@@ -129,7 +135,7 @@ bool QuasiAtomic::Cas64(int64_t old_value, int64_t new_value, volatile int64_t*
         : "cc");
   } while (__builtin_expect(status != 0, 0));
   return prev == old_value;
-#elif defined(__i386__)
+#elif defined(__i386__) || defined(__x86_64__)
   // The compiler does the right job and works better than inline assembly, especially with -O0
   // compilation.
   return __sync_bool_compare_and_swap(addr, old_value, new_value);
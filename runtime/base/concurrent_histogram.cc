@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "concurrent_histogram.h"
+
+#include <algorithm>
+
+#include "atomic.h"
+#include "base/logging.h"
+#include "cutils/atomic.h"
+#include "cutils/atomic-inline.h"
+#include "utils.h"
+
+namespace art {
+
+ConcurrentHistogram::ConcurrentHistogram(const std::string& name) : name_(name) {
+  Reset();
+}
+
+size_t ConcurrentHistogram::BucketIndex(uint64_t value) {
+  if (value < kSubBucketCount) {
+    return static_cast<size_t>(value);
+  }
+  const size_t exponent = 63 - __builtin_clzll(value);
+  const size_t sub_bucket = (value >> (exponent - kSubBucketBits)) & (kSubBucketCount - 1);
+  return (exponent - kSubBucketBits + 1) * kSubBucketCount + sub_bucket;
+}
+
+uint64_t ConcurrentHistogram::BucketLowerBound(size_t index) {
+  DCHECK_LT(index, kBucketCount);
+  if (index < kSubBucketCount) {
+    return index;
+  }
+  const size_t exponent = index / kSubBucketCount + kSubBucketBits - 1;
+  const uint64_t sub_bucket = index % kSubBucketCount;
+  return (kSubBucketCount + sub_bucket) << (exponent - kSubBucketBits);
+}
+
+void ConcurrentHistogram::AddValue(uint64_t value) {
+  android_atomic_inc(&buckets_[BucketIndex(value)]);
+  int64_t old_sum;
+  do {
+    old_sum = QuasiAtomic::Read64(&sum_);
+  } while (!QuasiAtomic::Cas64(old_sum, old_sum + static_cast<int64_t>(value), &sum_));
+  int64_t old_max;
+  do {
+    old_max = QuasiAtomic::Read64(&max_);
+    if (static_cast<uint64_t>(old_max) >= value) {
+      break;
+    }
+  } while (!QuasiAtomic::Cas64(old_max, static_cast<int64_t>(value), &max_));
+}
+
+void ConcurrentHistogram::Reset() {
+  for (size_t i = 0; i < kBucketCount; ++i) {
+    buckets_[i] = 0;
+  }
+  QuasiAtomic::Write64(&sum_, 0);
+  QuasiAtomic::Write64(&max_, 0);
+}
+
+uint64_t ConcurrentHistogram::SnapshotBuckets(uint32_t* counts) const {
+  uint64_t total = 0;
+  for (size_t i = 0; i < kBucketCount; ++i) {
+    counts[i] = static_cast<uint32_t>(buckets_[i]);
+    total += counts[i];
+  }
+  return total;
+}
+
+uint64_t ConcurrentHistogram::SampleSize() const {
+  uint64_t total = 0;
+  for (size_t i = 0; i < kBucketCount; ++i) {
+    total += static_cast<uint32_t>(buckets_[i]);
+  }
+  return total;
+}
+
+uint64_t ConcurrentHistogram::Sum() const {
+  return static_cast<uint64_t>(QuasiAtomic::Read64(&sum_));
+}
+
+uint64_t ConcurrentHistogram::Max() const {
+  return static_cast<uint64_t>(QuasiAtomic::Read64(&max_));
+}
+
+double ConcurrentHistogram::Mean() const {
+  const uint64_t sample_size = SampleSize();
+  DCHECK_GT(sample_size, 0ull);
+  return static_cast<double>(Sum()) / static_cast<double>(sample_size);
+}
+
+double ConcurrentHistogram::Percentile(double per) const {
+  DCHECK_GE(per, 0.0);
+  DCHECK_LE(per, 1.0);
+  uint32_t counts[kBucketCount];
+  const uint64_t total = SnapshotBuckets(counts);
+  DCHECK_GT(total, 0ull);
+  const double max_value = static_cast<double>(Max());
+  const double target = per * static_cast<double>(total);
+  uint64_t accumulated = 0;
+  for (size_t i = 0; i < kBucketCount; ++i) {
+    if (counts[i] == 0) {
+      continue;
+    }
+    if (static_cast<double>(accumulated + counts[i]) >= target) {
+      const double lower = static_cast<double>(BucketLowerBound(i));
+      const double upper = i + 1 < kBucketCount ? static_cast<double>(BucketLowerBound(i + 1))
+                                                : max_value;
+      const double fraction = (target - static_cast<double>(accumulated)) / counts[i];
+      return std::min(lower + (upper - lower) * fraction, max_value);
+    }
+    accumulated += counts[i];
+  }
+  return max_value;
+}
+
+void ConcurrentHistogram::PrintConfidenceIntervals(std::ostream& os, double interval) const {
+  DCHECK_GT(interval, 0);
+  DCHECK_LT(interval, 1.0);
+  // The values are in microseconds, the durations are formatted from nanoseconds.
+  static const double kAdjust = 1000;
+  const double per_0 = (1.0 - interval) / 2.0;
+  const double per_1 = per_0 + interval;
+  const double mean = Mean();
+  os << Name() << ":\t";
+  TimeUnit unit = GetAppropriateTimeUnit(mean * kAdjust);
+  os << (interval * 100) << "% C.I. " << FormatDuration(Percentile(per_0) * kAdjust, unit);
+  os << "-" << FormatDuration(Percentile(per_1) * kAdjust, unit) << " ";
+  os << "Avg: " << FormatDuration(mean * kAdjust, unit) << " Max: ";
+  os << FormatDuration(Max() * kAdjust, unit) << "\n";
+}
+
+}  // namespace art
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_BASE_CONCURRENT_HISTOGRAM_H_
+#define ART_RUNTIME_BASE_CONCURRENT_HISTOGRAM_H_
+
+#include <stdint.h>
+
+#include <ostream>
+#include <string>
+
+#include "base/macros.h"
+
+namespace art {
+
+// A histogram of non negative values that any number of threads may add to and read from at the
+// same time without a lock, for statistics that are recorded all the time such as GC pauses.
+//
+// Unlike Histogram the buckets are fixed: values below 2^kSubBucketBits have a bucket each, and
+// every power of two above that is split into 2^kSubBucketBits equally wide buckets, so that the
+// error of a percentile is bounded by 1/2^kSubBucketBits of the value. Adding a value is an atomic
+// increment of its bucket plus atomic updates of the sum and the maximum, and never allocates.
+// Readers see each counter atomically but not all of them at the same instant, so a percentile
+// read while values are added may be off by the values added during the read.
+class ConcurrentHistogram {
+ public:
+  static const size_t kSubBucketBits = 4;
+  static const size_t kSubBucketCount = 1 << kSubBucketBits;
+  static const size_t kBucketCount = (64 - kSubBucketBits + 1) * kSubBucketCount;
+
+  explicit ConcurrentHistogram(const std::string& name);
+
+  void AddValue(uint64_t value);
+
+  // Not atomic with respect to concurrent AddValue calls, the values added during the reset may be
+  // partially kept.
+  void Reset();
+
+  uint64_t SampleSize() const;
+  uint64_t Sum() const;
+  uint64_t Max() const;
+  double Mean() const;
+
+  // The value below which the fraction per of the values lie, interpolated within the bucket.
+  double Percentile(double per) const;
+
+  // Prints the interval and the mean and maximum, the values being microseconds.
+  void PrintConfidenceIntervals(std::ostream& os, double interval) const;
+
+  const std::string& Name() const {
+    return name_;
+  }
+
+  // The bucket holding the value, and the smallest value in a bucket.
+  static size_t BucketIndex(uint64_t value);
+  static uint64_t BucketLowerBound(size_t index);
+
+ private:
+  // Copies the bucket counts, returning their total.
+  uint64_t SnapshotBuckets(uint32_t* counts) const;
+
+  const std::string name_;
+  volatile int32_t buckets_[kBucketCount];
+  volatile int64_t sum_;
+  volatile int64_t max_;
+
+  DISALLOW_COPY_AND_ASSIGN(ConcurrentHistogram);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_BASE_CONCURRENT_HISTOGRAM_H_
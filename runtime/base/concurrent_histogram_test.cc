@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "concurrent_histogram.h"
+
+#include "gtest/gtest.h"
+
+namespace art {
+
+TEST(ConcurrentHistogramTest, Buckets) {
+  for (uint64_t value = 0; value < 4096; ++value) {
+    const size_t index = ConcurrentHistogram::BucketIndex(value);
+    EXPECT_LE(ConcurrentHistogram::BucketLowerBound(index), value);
+    EXPECT_GT(ConcurrentHistogram::BucketLowerBound(index + 1), value);
+  }
+  EXPECT_EQ(ConcurrentHistogram::kBucketCount - 1,
+            ConcurrentHistogram::BucketIndex(static_cast<uint64_t>(-1)));
+}
+
+TEST(ConcurrentHistogramTest, Stats) {
+  ConcurrentHistogram histogram("Stats");
+  for (uint64_t value = 1; value <= 1000; ++value) {
+    histogram.AddValue(value);
+  }
+  EXPECT_EQ(1000U, histogram.SampleSize());
+  EXPECT_EQ(500500U, histogram.Sum());
+  EXPECT_EQ(1000U, histogram.Max());
+  EXPECT_DOUBLE_EQ(500.5, histogram.Mean());
+  // The buckets are at most 1/16th of their values wide.
+  EXPECT_NEAR(500.0, histogram.Percentile(0.50), 500.0 / 16);
+  EXPECT_NEAR(990.0, histogram.Percentile(0.99), 990.0 / 16);
+  EXPECT_EQ(1000.0, histogram.Percentile(1.0));
+
+  histogram.Reset();
+  EXPECT_EQ(0U, histogram.SampleSize());
+  EXPECT_EQ(0U, histogram.Max());
+  histogram.AddValue(7);
+  EXPECT_EQ(7.0, histogram.Percentile(0.5));
+}
+
+}  // namespace art
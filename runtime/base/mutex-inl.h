@@ -44,10 +44,10 @@ static inline int futex(volatile int *uaddr, int op, int val, const struct times
 class ScopedContentionRecorder {
  public:
   ScopedContentionRecorder(BaseMutex* mutex, uint64_t blocked_tid, uint64_t owner_tid)
-      : mutex_(kLogLockContentions ? mutex : NULL),
-        blocked_tid_(kLogLockContentions ? blocked_tid : 0),
-        owner_tid_(kLogLockContentions ? owner_tid : 0),
-        start_nano_time_(kLogLockContentions ? NanoTime() : 0) {
+      : mutex_(BaseMutex::IsContentionLoggingEnabled() ? mutex : NULL),
+        blocked_tid_(mutex_ != NULL ? blocked_tid : 0),
+        owner_tid_(mutex_ != NULL ? owner_tid : 0),
+        start_nano_time_(mutex_ != NULL ? NanoTime() : 0) {
     std::string msg = StringPrintf("Lock contention on %s (owner tid: %llu)",
                                    mutex->GetName(), owner_tid);
     ATRACE_BEGIN(msg.c_str());
@@ -55,7 +55,7 @@ class ScopedContentionRecorder {
 
   ~ScopedContentionRecorder() {
     ATRACE_END();
-    if (kLogLockContentions) {
+    if (mutex_ != NULL) {
       uint64_t end_nano_time = NanoTime();
       mutex_->RecordContention(blocked_tid_, owner_tid_, end_nano_time - start_nano_time_);
     }
@@ -131,9 +131,36 @@ inline void BaseMutex::RegisterAsUnlocked(Thread* self) {
   }
 }
 
+#if ART_USE_FUTEXES
+inline volatile int32_t* ReaderWriterMutex::ReaderSlotFor(Thread* self) const {
+  return &reader_slots_[SafeGetTid(self) % kNumReaderSlots].count;
+}
+
+inline void ReaderWriterMutex::ReleaseReaderSlot(volatile int32_t* slot) {
+  android_atomic_dec(slot);
+  // Order the release before the check for a writer, which orders setting state_ before its
+  // scan of the slots.
+  ANDROID_MEMBAR_FULL();
+  if (UNLIKELY(state_ < 0)) {
+    WakeDrainingWriter();
+  }
+}
+#endif
+
 inline void ReaderWriterMutex::SharedLock(Thread* self) {
   DCHECK(self == NULL || self == Thread::Current());
 #if ART_USE_FUTEXES
+  if (reader_slots_ != NULL) {
+    volatile int32_t* slot = ReaderSlotFor(self);
+    android_atomic_inc(slot);
+    ANDROID_MEMBAR_FULL();
+    if (UNLIKELY(state_ < 0)) {
+      SharedLockSlowPath(self, slot);
+    }
+    RegisterAsLocked(self);
+    AssertSharedHeld(self);
+    return;
+  }
   bool done = false;
   do {
     int32_t cur_state = state_;
@@ -164,6 +191,10 @@ inline void ReaderWriterMutex::SharedUnlock(Thread* self) {
   AssertSharedHeld(self);
   RegisterAsUnlocked(self);
 #if ART_USE_FUTEXES
+  if (reader_slots_ != NULL) {
+    ReleaseReaderSlot(ReaderSlotFor(self));
+    return;
+  }
   bool done = false;
   do {
     int32_t cur_state = state_;
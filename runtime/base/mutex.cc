@@ -17,8 +17,14 @@
 #include "mutex.h"
 
 #include <errno.h>
+#include <string.h>
 #include <sys/time.h>
 
+#include <algorithm>
+#include <vector>
+
+#include <corkscrew/backtrace.h>
+
 #include "atomic.h"
 #include "base/logging.h"
 #include "cutils/atomic.h"
@@ -120,51 +126,74 @@ class ScopedAllMutexesLock {
   const BaseMutex* const mutex_;
 };
 
-BaseMutex::BaseMutex(const char* name, LockLevel level) : level_(level), name_(name) {
-  if (kLogLockContentions) {
-    ScopedAllMutexesLock mu(this);
-    std::set<BaseMutex*>** all_mutexes_ptr = &all_mutex_data->all_mutexes;
-    if (*all_mutexes_ptr == NULL) {
-      // We leak the global set of all mutexes to avoid ordering issues in global variable
-      // construction/destruction.
-      *all_mutexes_ptr = new std::set<BaseMutex*>();
+bool BaseMutex::contention_logging_enabled_ = false;
+
+BaseMutex::BaseMutex(const char* name, LockLevel level)
+    : level_(level), name_(name), contention_log_data_(NULL) {
+}
+
+BaseMutex::~BaseMutex() {
+  if (kLogLockContentions && contention_log_data_ != NULL) {
+    {
+      ScopedAllMutexesLock mu(this);
+      all_mutex_data->all_mutexes->erase(this);
     }
-    (*all_mutexes_ptr)->insert(this);
+    delete contention_log_data_;
   }
 }
 
-BaseMutex::~BaseMutex() {
+void BaseMutex::EnableContentionLogging() {
   if (kLogLockContentions) {
-    ScopedAllMutexesLock mu(this);
-    all_mutex_data->all_mutexes->erase(this);
+    contention_logging_enabled_ = true;
+  }
+}
+
+BaseMutex::ContentionLogData* BaseMutex::GetContentionLogData() {
+  ContentionLogData* data = contention_log_data_;
+  if (LIKELY(data != NULL)) {
+    return data;
   }
+  data = new ContentionLogData();
+  if (android_atomic_release_cas(0, reinterpret_cast<int32_t>(data),
+                                 reinterpret_cast<volatile int32_t*>(&contention_log_data_)) != 0) {
+    // Another contender installed the data first.
+    delete data;
+    ANDROID_MEMBAR_FULL();
+    return contention_log_data_;
+  }
+  ScopedAllMutexesLock mu(this);
+  std::set<BaseMutex*>** all_mutexes_ptr = &all_mutex_data->all_mutexes;
+  if (*all_mutexes_ptr == NULL) {
+    // We leak the global set of all mutexes to avoid ordering issues in global variable
+    // construction/destruction.
+    *all_mutexes_ptr = new std::set<BaseMutex*>();
+  }
+  (*all_mutexes_ptr)->insert(this);
+  return data;
+}
+
+static bool CompareTotalWaitTime(const BaseMutex* lhs, const BaseMutex* rhs) {
+  return lhs->GetTotalWaitTime() > rhs->GetTotalWaitTime();
 }
 
 void BaseMutex::DumpAll(std::ostream& os) {
-  if (kLogLockContentions) {
+  if (IsContentionLoggingEnabled()) {
+    static const size_t kMaxMutexesToDump = 20;
     os << "Mutex logging:\n";
     ScopedAllMutexesLock mu(reinterpret_cast<const BaseMutex*>(-1));
     std::set<BaseMutex*>* all_mutexes = all_mutex_data->all_mutexes;
     if (all_mutexes == NULL) {
-      // No mutexes have been created yet during at startup.
+      os << "(No contention)\n";
       return;
     }
-    typedef std::set<BaseMutex*>::const_iterator It;
-    os << "(Contented)\n";
-    for (It it = all_mutexes->begin(); it != all_mutexes->end(); ++it) {
-      BaseMutex* mutex = *it;
-      if (mutex->HasEverContended()) {
-        mutex->Dump(os);
-        os << "\n";
-      }
-    }
-    os << "(Never contented)\n";
-    for (It it = all_mutexes->begin(); it != all_mutexes->end(); ++it) {
-      BaseMutex* mutex = *it;
-      if (!mutex->HasEverContended()) {
-        mutex->Dump(os);
-        os << "\n";
-      }
+    std::vector<BaseMutex*> contended(all_mutexes->begin(), all_mutexes->end());
+    std::sort(contended.begin(), contended.end(), CompareTotalWaitTime);
+    size_t num_to_dump = std::min(contended.size(), kMaxMutexesToDump);
+    os << "(Contended, " << num_to_dump << " of " << contended.size()
+       << " by total wait time)\n";
+    for (size_t i = 0; i < num_to_dump; ++i) {
+      contended[i]->Dump(os);
+      os << "\n";
     }
   }
 }
@@ -202,6 +231,44 @@ inline void BaseMutex::ContentionLogData::AddToWaitTime(uint64_t value) {
       old_val = static_cast<uint64_t>(QuasiAtomic::Read64(caddr));
       new_val = old_val + value;
     } while (!QuasiAtomic::Cas64(static_cast<int64_t>(old_val), static_cast<int64_t>(new_val), addr));
+    size_t bucket = 0;
+    for (uint64_t limit = 1000; bucket < kWaitTimeBuckets - 1 && value >= limit; limit *= 10) {
+      ++bucket;
+    }
+    ++wait_time_histogram[bucket];
+  }
+}
+
+void BaseMutex::ContentionLogData::RecordCallSite() {
+  // Don't include unwind_backtrace, RecordCallSite or RecordContention.
+  const size_t kIgnoreCount = 3;
+  backtrace_frame_t frames[kCallSiteDepth];
+  ssize_t depth = unwind_backtrace(frames, kIgnoreCount, kCallSiteDepth);
+  if (depth <= 0) {
+    return;
+  }
+  uintptr_t pcs[kCallSiteDepth];
+  for (ssize_t i = 0; i < depth; ++i) {
+    pcs[i] = frames[i].absolute_pc;
+  }
+  // This code is intentionally racy as it is only used for diagnostics, two contenders may claim
+  // an entry for the same call site.
+  size_t num_entries = std::min(static_cast<size_t>(num_call_sites), kCallSiteLogSize);
+  for (size_t i = 0; i < num_entries; ++i) {
+    CallSiteEntry* entry = &call_sites[i];
+    if (entry->depth == static_cast<size_t>(depth) &&
+        memcmp(entry->pcs, pcs, depth * sizeof(pcs[0])) == 0) {
+      ++entry->count;
+      return;
+    }
+  }
+  int32_t index = num_call_sites++;
+  if (static_cast<size_t>(index) < kCallSiteLogSize) {
+    CallSiteEntry* entry = &call_sites[index];
+    memcpy(entry->pcs, pcs, depth * sizeof(pcs[0]));
+    entry->count = 1;
+    ANDROID_MEMBAR_STORE();
+    entry->depth = depth;
   }
 }
 
@@ -209,8 +276,8 @@ void BaseMutex::RecordContention(uint64_t blocked_tid,
                                  uint64_t owner_tid,
                                  uint64_t nano_time_blocked) {
   if (kLogLockContentions) {
-    ContentionLogData* data = contetion_log_data_;
-    ++(data->contention_count);
+    ContentionLogData* data = GetContentionLogData();
+    int32_t contention_count = ++(data->contention_count);
     data->AddToWaitTime(nano_time_blocked);
     ContentionLogEntry* log = data->contention_log;
     // This code is intentionally racy as it is only used for diagnostics.
@@ -228,65 +295,110 @@ void BaseMutex::RecordContention(uint64_t blocked_tid,
       log[new_slot].owner_tid = owner_tid;
       log[new_slot].count = 1;
     }
+    if (contention_count % kCallSiteSamplePeriod == 1) {
+      data->RecordCallSite();
+    }
   }
 }
 
+static bool CompareCallSiteCount(const std::pair<int32_t, size_t>& lhs,
+                                 const std::pair<int32_t, size_t>& rhs) {
+  return lhs.first > rhs.first;
+}
+
 void BaseMutex::DumpContention(std::ostream& os) const {
   if (kLogLockContentions) {
-    const ContentionLogData* data = contetion_log_data_;
+    const ContentionLogData* data = contention_log_data_;
+    if (data == NULL || data->contention_count == 0) {
+      os << "never contended";
+      return;
+    }
     const ContentionLogEntry* log = data->contention_log;
     uint64_t wait_time = data->wait_time;
     uint32_t contention_count = data->contention_count;
-    if (contention_count == 0) {
-      os << "never contended";
-    } else {
-      os << "contended " << contention_count
-         << " times, average wait of contender " << PrettyDuration(wait_time / contention_count);
-      SafeMap<uint64_t, size_t> most_common_blocker;
-      SafeMap<uint64_t, size_t> most_common_blocked;
-      typedef SafeMap<uint64_t, size_t>::const_iterator It;
-      for (size_t i = 0; i < kContentionLogSize; ++i) {
-        uint64_t blocked_tid = log[i].blocked_tid;
-        uint64_t owner_tid = log[i].owner_tid;
-        uint32_t count = log[i].count;
-        if (count > 0) {
-          It it = most_common_blocked.find(blocked_tid);
-          if (it != most_common_blocked.end()) {
-            most_common_blocked.Overwrite(blocked_tid, it->second + count);
-          } else {
-            most_common_blocked.Put(blocked_tid, count);
-          }
-          it = most_common_blocker.find(owner_tid);
-          if (it != most_common_blocker.end()) {
-            most_common_blocker.Overwrite(owner_tid, it->second + count);
-          } else {
-            most_common_blocker.Put(owner_tid, count);
-          }
+    os << "contended " << contention_count << " times, total wait " << PrettyDuration(wait_time)
+       << ", average wait of contender " << PrettyDuration(wait_time / contention_count);
+    SafeMap<uint64_t, size_t> most_common_blocker;
+    SafeMap<uint64_t, size_t> most_common_blocked;
+    typedef SafeMap<uint64_t, size_t>::const_iterator It;
+    for (size_t i = 0; i < kContentionLogSize; ++i) {
+      uint64_t blocked_tid = log[i].blocked_tid;
+      uint64_t owner_tid = log[i].owner_tid;
+      uint32_t count = log[i].count;
+      if (count > 0) {
+        It it = most_common_blocked.find(blocked_tid);
+        if (it != most_common_blocked.end()) {
+          most_common_blocked.Overwrite(blocked_tid, it->second + count);
+        } else {
+          most_common_blocked.Put(blocked_tid, count);
         }
-      }
-      uint64_t max_tid = 0;
-      size_t max_tid_count = 0;
-      for (It it = most_common_blocked.begin(); it != most_common_blocked.end(); ++it) {
-        if (it->second > max_tid_count) {
-          max_tid = it->first;
-          max_tid_count = it->second;
+        it = most_common_blocker.find(owner_tid);
+        if (it != most_common_blocker.end()) {
+          most_common_blocker.Overwrite(owner_tid, it->second + count);
+        } else {
+          most_common_blocker.Put(owner_tid, count);
         }
       }
-      if (max_tid != 0) {
-        os << " sample shows most blocked tid=" << max_tid;
+    }
+    uint64_t max_tid = 0;
+    size_t max_tid_count = 0;
+    for (It it = most_common_blocked.begin(); it != most_common_blocked.end(); ++it) {
+      if (it->second > max_tid_count) {
+        max_tid = it->first;
+        max_tid_count = it->second;
       }
-      max_tid = 0;
-      max_tid_count = 0;
-      for (It it = most_common_blocker.begin(); it != most_common_blocker.end(); ++it) {
-        if (it->second > max_tid_count) {
-          max_tid = it->first;
-          max_tid_count = it->second;
-        }
+    }
+    if (max_tid != 0) {
+      os << " sample shows most blocked tid=" << max_tid;
+    }
+    max_tid = 0;
+    max_tid_count = 0;
+    for (It it = most_common_blocker.begin(); it != most_common_blocker.end(); ++it) {
+      if (it->second > max_tid_count) {
+        max_tid = it->first;
+        max_tid_count = it->second;
       }
-      if (max_tid != 0) {
-        os << " sample shows tid=" << max_tid << " owning during this time";
+    }
+    if (max_tid != 0) {
+      os << " sample shows tid=" << max_tid << " owning during this time";
+    }
+    static const char* kBucketNames[kWaitTimeBuckets] = {
+      "<1us", "<10us", "<100us", "<1ms", "<10ms", "<100ms", ">=100ms"
+    };
+    os << "\n  waits:";
+    for (size_t i = 0; i < kWaitTimeBuckets; ++i) {
+      os << " " << kBucketNames[i] << "=" << data->wait_time_histogram[i];
+    }
+    // The sampled call sites, most frequent first.
+    std::vector<std::pair<int32_t, size_t> > call_sites;
+    size_t num_call_sites = std::min(static_cast<size_t>(data->num_call_sites), kCallSiteLogSize);
+    for (size_t i = 0; i < num_call_sites; ++i) {
+      if (data->call_sites[i].depth != 0) {
+        call_sites.push_back(std::make_pair(static_cast<int32_t>(data->call_sites[i].count), i));
       }
     }
+    std::sort(call_sites.begin(), call_sites.end(), CompareCallSiteCount);
+    // Ensure libcorkscrew doesn't use a stale cache of /proc/self/maps.
+    flush_my_map_info_list();
+    for (size_t i = 0; i < call_sites.size(); ++i) {
+      const CallSiteEntry& entry = data->call_sites[call_sites[i].second];
+      os << "\n  call site sampled " << call_sites[i].first << " times:";
+      backtrace_frame_t frames[kCallSiteDepth];
+      backtrace_symbol_t symbols[kCallSiteDepth];
+      for (size_t j = 0; j < entry.depth; ++j) {
+        frames[j].absolute_pc = entry.pcs[j];
+        frames[j].stack_top = 0;
+        frames[j].stack_size = 0;
+      }
+      get_backtrace_symbols(frames, entry.depth, symbols);
+      for (size_t j = 0; j < entry.depth; ++j) {
+        const char* name = symbols[j].demangled_name != NULL ? symbols[j].demangled_name
+                                                              : symbols[j].symbol_name;
+        os << "\n    " << (name != NULL ? name : "???")
+           << StringPrintf(" [%p]", reinterpret_cast<void*>(entry.pcs[j]));
+      }
+      free_backtrace_symbols(symbols, entry.depth);
+    }
   }
 }
 
@@ -510,13 +622,16 @@ std::ostream& operator<<(std::ostream& os, const Mutex& mu) {
   return os;
 }
 
-ReaderWriterMutex::ReaderWriterMutex(const char* name, LockLevel level)
+ReaderWriterMutex::ReaderWriterMutex(const char* name, LockLevel level, bool distributed_readers)
     : BaseMutex(name, level)
 #if ART_USE_FUTEXES
-    , state_(0), exclusive_owner_(0), num_pending_readers_(0), num_pending_writers_(0)
+    , state_(0), exclusive_owner_(0), num_pending_readers_(0), num_pending_writers_(0),
+      reader_slots_(distributed_readers ? new ReaderSlot[kNumReaderSlots]() : NULL),
+      reader_release_seq_(0)
 #endif
 {  // NOLINT(whitespace/braces)
 #if !ART_USE_FUTEXES
+  UNUSED(distributed_readers);
   CHECK_MUTEX_CALL(pthread_rwlock_init, (&rwlock_, NULL));
 #endif
 }
@@ -527,6 +642,12 @@ ReaderWriterMutex::~ReaderWriterMutex() {
   CHECK_EQ(exclusive_owner_, 0U);
   CHECK_EQ(num_pending_readers_, 0);
   CHECK_EQ(num_pending_writers_, 0);
+  if (reader_slots_ != NULL) {
+    for (size_t i = 0; i < kNumReaderSlots; ++i) {
+      CHECK_EQ(reader_slots_[i].count, 0);
+    }
+    delete[] reader_slots_;
+  }
 #else
   // We can't use CHECK_MUTEX_CALL here because on shutdown a suspended daemon thread
   // may still be using locks.
@@ -567,6 +688,9 @@ void ReaderWriterMutex::ExclusiveLock(Thread* self) {
     }
   } while (!done);
   DCHECK_EQ(state_, -1);
+  if (reader_slots_ != NULL) {
+    WaitForReaderSlotsToDrain(self, NULL);
+  }
   exclusive_owner_ = SafeGetTid(self);
 #else
   CHECK_MUTEX_CALL(pthread_rwlock_wrlock, (&rwlock_));
@@ -639,6 +763,14 @@ bool ReaderWriterMutex::ExclusiveLockWithTimeout(Thread* self, int64_t ms, int32
       android_atomic_dec(&num_pending_writers_);
     }
   } while (!done);
+  if (reader_slots_ != NULL && !WaitForReaderSlotsToDrain(self, &end_abs_ts)) {
+    // Give up the intent to acquire and let the readers that backed off in.
+    android_atomic_release_store(0, &state_);
+    if (num_pending_readers_ > 0 || num_pending_writers_ > 0) {
+      futex(&state_, FUTEX_WAKE, -1, NULL, NULL, 0);
+    }
+    return false;  // Timed out.
+  }
   exclusive_owner_ = SafeGetTid(self);
 #else
   timespec ts;
@@ -661,6 +793,18 @@ bool ReaderWriterMutex::ExclusiveLockWithTimeout(Thread* self, int64_t ms, int32
 bool ReaderWriterMutex::SharedTryLock(Thread* self) {
   DCHECK(self == NULL || self == Thread::Current());
 #if ART_USE_FUTEXES
+  if (reader_slots_ != NULL) {
+    volatile int32_t* slot = ReaderSlotFor(self);
+    android_atomic_inc(slot);
+    ANDROID_MEMBAR_FULL();
+    if (state_ < 0) {
+      ReleaseReaderSlot(slot);
+      return false;
+    }
+    RegisterAsLocked(self);
+    AssertSharedHeld(self);
+    return true;
+  }
   bool done = false;
   do {
     int32_t cur_state = state_;
@@ -687,6 +831,64 @@ bool ReaderWriterMutex::SharedTryLock(Thread* self) {
   return true;
 }
 
+#if ART_USE_FUTEXES
+void ReaderWriterMutex::SharedLockSlowPath(Thread* self, volatile int32_t* slot) {
+  // A writer holds the lock or waits for the slots to drain. Back off until it is done.
+  do {
+    ReleaseReaderSlot(slot);
+    int32_t cur_state = state_;
+    if (cur_state < 0) {
+      ScopedContentionRecorder scr(this, GetExclusiveOwnerTid(), SafeGetTid(self));
+      android_atomic_inc(&num_pending_readers_);
+      if (futex(&state_, FUTEX_WAIT, cur_state, NULL, NULL, 0) != 0) {
+        if ((errno != EAGAIN) && (errno != EINTR)) {
+          PLOG(FATAL) << "futex wait failed for " << name_;
+        }
+      }
+      android_atomic_dec(&num_pending_readers_);
+    }
+    android_atomic_inc(slot);
+    ANDROID_MEMBAR_FULL();
+  } while (state_ < 0);
+}
+
+void ReaderWriterMutex::WakeDrainingWriter() {
+  android_atomic_inc(&reader_release_seq_);
+  futex(&reader_release_seq_, FUTEX_WAKE, -1, NULL, NULL, 0);
+}
+
+bool ReaderWriterMutex::WaitForReaderSlotsToDrain(Thread* self, const timespec* end_abs_ts) {
+  // Order setting state_ before the scan, readers order their release before checking state_.
+  ANDROID_MEMBAR_FULL();
+  while (true) {
+    int32_t seq = reader_release_seq_;
+    ANDROID_MEMBAR_FULL();
+    size_t i = 0;
+    while (i < kNumReaderSlots && reader_slots_[i].count == 0) {
+      ++i;
+    }
+    if (i == kNumReaderSlots) {
+      return true;
+    }
+    timespec rel_ts;
+    if (end_abs_ts != NULL) {
+      timespec now_abs_ts;
+      InitTimeSpec(true, CLOCK_REALTIME, 0, 0, &now_abs_ts);
+      if (ComputeRelativeTimeSpec(&rel_ts, *end_abs_ts, now_abs_ts)) {
+        return false;  // Timed out.
+      }
+    }
+    ScopedContentionRecorder scr(this, SafeGetTid(self), GetExclusiveOwnerTid());
+    if (futex(&reader_release_seq_, FUTEX_WAIT, seq, end_abs_ts != NULL ? &rel_ts : NULL,
+              NULL, 0) != 0) {
+      if ((errno != EAGAIN) && (errno != EINTR) && (errno != ETIMEDOUT)) {
+        PLOG(FATAL) << "futex wait failed for " << name_;
+      }
+    }
+  }
+}
+#endif
+
 bool ReaderWriterMutex::IsExclusiveHeld(const Thread* self) const {
   DCHECK(self == NULL || self == Thread::Current());
   bool result = (GetExclusiveOwnerTid() == SafeGetTid(self));
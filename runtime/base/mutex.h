@@ -49,17 +49,17 @@ class Thread;
 
 const bool kDebugLocking = kIsDebugBuild;
 
-// Record Log contention information, dumpable via SIGQUIT.
-#ifdef ART_USE_FUTEXES
-// To enable lock contention logging, set this to true.
-const bool kLogLockContentions = false;
+// Record Log contention information, dumpable via SIGQUIT. Recording is off until enabled with
+// BaseMutex::EnableContentionLogging, mutexes that are never contended while it is on cost
+// nothing beyond a null pointer.
+#if ART_USE_FUTEXES
+const bool kLogLockContentions = true;
 #else
 // Keep this false as lock contention logging is supported only with
 // futex.
 const bool kLogLockContentions = false;
 #endif
 const size_t kContentionLogSize = 64;
-const size_t kContentionLogDataSize = kLogLockContentions ? 1 : 0;
 const size_t kAllMutexDataSize = kLogLockContentions ? 1 : 0;
 
 // Base class for all Mutex implementations
@@ -74,8 +74,16 @@ class BaseMutex {
 
   virtual void Dump(std::ostream& os) const = 0;
 
+  // Dumps the contention of the mutexes that have been contended, worst total wait first.
   static void DumpAll(std::ostream& os);
 
+  // Starts recording the contention of all mutexes, there is no way to stop.
+  static void EnableContentionLogging();
+
+  static bool IsContentionLoggingEnabled() {
+    return kLogLockContentions && contention_logging_enabled_;
+  }
+
  protected:
   friend class ConditionVariable;
 
@@ -93,6 +101,13 @@ class BaseMutex {
   const LockLevel level_;  // Support for lock hierarchy.
   const char* const name_;
 
+  // Waits are bucketed by decade, from under 1us to 100ms and above.
+  static const size_t kWaitTimeBuckets = 7;
+  // One in kCallSiteSamplePeriod contentions records the native call site of the waiter.
+  static const uint32_t kCallSiteSamplePeriod = 16;
+  static const size_t kCallSiteDepth = 4;
+  static const size_t kCallSiteLogSize = 16;
+
   // A log entry that records contention but makes no guarantee that either tid will be held live.
   struct ContentionLogEntry {
     ContentionLogEntry() : blocked_tid(0), owner_tid(0) {}
@@ -100,6 +115,13 @@ class BaseMutex {
     uint64_t owner_tid;
     AtomicInteger count;
   };
+  // The innermost return addresses of a sampled waiter, below the mutex's own frames.
+  struct CallSiteEntry {
+    CallSiteEntry() : depth(0) {}
+    uintptr_t pcs[kCallSiteDepth];
+    size_t depth;
+    AtomicInteger count;
+  };
   struct ContentionLogData {
     ContentionLogEntry contention_log[kContentionLogSize];
     // The next entry in the contention log to be updated. Value ranges from 0 to
@@ -109,18 +131,32 @@ class BaseMutex {
     AtomicInteger contention_count;
     // Sum of time waited by all contenders in ns.
     volatile uint64_t wait_time;
+    AtomicInteger wait_time_histogram[kWaitTimeBuckets];
+    CallSiteEntry call_sites[kCallSiteLogSize];
+    AtomicInteger num_call_sites;
     void AddToWaitTime(uint64_t value);
+    void RecordCallSite();
     ContentionLogData() : wait_time(0) {}
   };
-  ContentionLogData contetion_log_data_[kContentionLogDataSize];
+  // Allocated on the first contention after logging is enabled, the mutex is then registered for
+  // DumpAll.
+  ContentionLogData* volatile contention_log_data_;
+
+  ContentionLogData* GetContentionLogData();
+
+  static bool contention_logging_enabled_;
 
  public:
   bool HasEverContended() const {
     if (kLogLockContentions) {
-      return contetion_log_data_->contention_count > 0;
+      return contention_log_data_ != NULL && contention_log_data_->contention_count > 0;
     }
     return false;
   }
+
+  uint64_t GetTotalWaitTime() const {
+    return contention_log_data_ != NULL ? contention_log_data_->wait_time : 0;
+  }
 };
 
 // A Mutex is used to achieve mutual exclusion between threads. A Mutex can be used to gain
@@ -220,7 +256,12 @@ class LOCKABLE Mutex : public BaseMutex {
 std::ostream& operator<<(std::ostream& os, const ReaderWriterMutex& mu);
 class LOCKABLE ReaderWriterMutex : public BaseMutex {
  public:
-  explicit ReaderWriterMutex(const char* name, LockLevel level = kDefaultMutexLevel);
+  // With distributed readers, shared holders count themselves in one of several slots, each on
+  // its own cache line, rather than all in one word. Shared acquisition by threads on different
+  // cores then doesn't bounce a cache line between them, at the cost of exclusive acquisition
+  // scanning the slots.
+  explicit ReaderWriterMutex(const char* name, LockLevel level = kDefaultMutexLevel,
+                             bool distributed_readers = false);
   ~ReaderWriterMutex();
 
   virtual bool IsReaderWriterMutex() const { return true; }
@@ -297,7 +338,24 @@ class LOCKABLE ReaderWriterMutex : public BaseMutex {
 
  private:
 #if ART_USE_FUTEXES
-  // -1 implies held exclusive, +ve shared held by state_ many owners.
+  static const size_t kNumReaderSlots = 16;
+  static const size_t kReaderSlotSize = 64;  // A cache line.
+
+  struct ReaderSlot {
+    volatile int32_t count;
+    uint8_t padding[kReaderSlotSize - sizeof(int32_t)];
+  };
+
+  volatile int32_t* ReaderSlotFor(Thread* self) const;
+  void SharedLockSlowPath(Thread* self, volatile int32_t* slot);
+  void ReleaseReaderSlot(volatile int32_t* slot) ALWAYS_INLINE;
+  void WakeDrainingWriter();
+  // Waits, with state_ -1, for the shared holders counted in the reader slots to release. Returns
+  // false if the absolute timeout is reached first.
+  bool WaitForReaderSlotsToDrain(Thread* self, const timespec* end_abs_ts);
+
+  // -1 implies held exclusive, +ve shared held by state_ many owners. With distributed readers
+  // -1 implies held or being acquired exclusive, shared holders are counted in reader_slots_.
   volatile int32_t state_;
   // Exclusive owner.
   volatile uint64_t exclusive_owner_;
@@ -305,12 +363,41 @@ class LOCKABLE ReaderWriterMutex : public BaseMutex {
   volatile int32_t num_pending_readers_;
   // Pending writers.
   volatile int32_t num_pending_writers_;
+  // The shared holders by slot, NULL unless readers are distributed.
+  ReaderSlot* reader_slots_;
+  // Bumped by shared holders releasing while a writer waits for the slots to drain.
+  volatile int32_t reader_release_seq_;
 #else
   pthread_rwlock_t rwlock_;
 #endif
   DISALLOW_COPY_AND_ASSIGN(ReaderWriterMutex);
 };
 
+// The mutator lock. Besides being acquired like any ReaderWriterMutex, a share is held implicitly
+// by every thread in the Runnable state. Threads enter and leave that state with a CAS on their own
+// state and flags rather than on the lock, the exclusive owner first waits for them to leave it
+// (see ThreadList::SuspendAll).
+class LOCKABLE MutatorMutex : public ReaderWriterMutex {
+ public:
+  explicit MutatorMutex(const char* name, LockLevel level = kMutatorLock)
+      : ReaderWriterMutex(name, level) {}
+
+  // Record the implicit share of a thread that has just become Runnable.
+  void TransitionFromSuspendedToRunnable(Thread* self) SHARED_LOCK_FUNCTION() {
+    RegisterAsLocked(self);
+    AssertSharedHeld(self);
+  }
+
+  // Drop the implicit share of a thread that has just left the Runnable state.
+  void TransitionFromRunnableToSuspended(Thread* self) UNLOCK_FUNCTION() {
+    AssertSharedHeld(self);
+    RegisterAsUnlocked(self);
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(MutatorMutex);
+};
+
 // ConditionVariables allow threads to queue and sleep. Threads may then be resumed individually
 // (Signal) or all at once (Broadcast).
 class ConditionVariable {
@@ -86,6 +86,11 @@ void CumulativeLogger::AddLogger(const base::TimingLogger &logger) {
   }
 }
 
+void CumulativeLogger::AddSplit(const std::string& label, uint64_t delta_time) {
+  MutexLock mu(Thread::Current(), lock_);
+  AddPair(label, delta_time);
+}
+
 void CumulativeLogger::Dump(std::ostream &os) {
   MutexLock mu(Thread::Current(), lock_);
   DumpHistogram(os);
@@ -45,6 +45,8 @@ class CumulativeLogger {
   // parent class that is unable to determine the "name" of a sub-class.
   void SetName(const std::string& name);
   void AddLogger(const base::TimingLogger& logger) LOCKS_EXCLUDED(lock_);
+  // Adds a single timing, in nanoseconds, to the histogram with the given label.
+  void AddSplit(const std::string& label, uint64_t delta_time) LOCKS_EXCLUDED(lock_);
 
  private:
   typedef std::map<std::string, Histogram<uint64_t> *> Histograms;
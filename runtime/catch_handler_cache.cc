@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "catch_handler_cache.h"
+
+#include "dex_file.h"
+#include "mirror/art_method-inl.h"
+#include "mirror/class-inl.h"
+
+namespace art {
+
+bool CatchHandlerCache::Compute(const mirror::ArtMethod* method,
+                                const mirror::Class* exception_type, uintptr_t pc,
+                                CatchHandlerInfo* info) {
+  info->method = method;
+  info->exception_type = exception_type;
+  info->pc = pc;
+  info->handler_dex_pc = DexFile::kDexNoIndex;
+  info->handler_pc = 0;
+  info->has_no_move_exception = false;
+  uint32_t dex_pc = method->ToDexPc(pc);
+  if (dex_pc == DexFile::kDexNoIndex) {
+    return true;
+  }
+  bool types_resolved;
+  info->handler_dex_pc = method->FindCatchBlock(const_cast<mirror::Class*>(exception_type), dex_pc,
+                                                &info->has_no_move_exception, &types_resolved);
+  if (info->handler_dex_pc != DexFile::kDexNoIndex) {
+    info->handler_pc = method->ToNativePc(info->handler_dex_pc);
+  }
+  return types_resolved;
+}
+
+}  // namespace art
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_CATCH_HANDLER_CACHE_H_
+#define ART_RUNTIME_CATCH_HANDLER_CACHE_H_
+
+#include <stdint.h>
+
+#include "base/macros.h"
+#include "globals.h"
+#include "locks.h"
+
+namespace art {
+namespace mirror {
+  class ArtMethod;
+  class Class;
+}  // namespace mirror
+
+// Where an exception of a given type thrown at a native pc of a compiled method is caught in that
+// method, if it is.
+struct CatchHandlerInfo {
+  CatchHandlerInfo()
+      : method(NULL), exception_type(NULL), pc(0), handler_dex_pc(0), handler_pc(0),
+        has_no_move_exception(false) {}
+
+  const mirror::ArtMethod* method;
+  const mirror::Class* exception_type;
+  uintptr_t pc;
+  // The dex pc of the handler, DexFile::kDexNoIndex if the exception isn't caught in the method.
+  uint32_t handler_dex_pc;
+  uintptr_t handler_pc;
+  bool has_no_move_exception;
+};
+
+// A direct mapped cache of the catch handlers found by a thread's exception deliveries, so that an
+// exception repeatedly thrown and caught along the same path doesn't decode the mapping tables and
+// the try items, nor check the catch types, of every frame every time. Like the frame layouts of
+// the QuickFrameInfoCache, the code of a method that has run and the classes it refers to stay in
+// place, so only a result depending on an unresolved catch type could go stale. Such results are
+// not cached.
+class CatchHandlerCache {
+ public:
+  CatchHandlerCache() {}
+
+  CatchHandlerInfo Get(const mirror::ArtMethod* method, const mirror::Class* exception_type,
+                       uintptr_t pc)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    CatchHandlerInfo* info = &infos_[Index(method, exception_type, pc)];
+    if (UNLIKELY(info->method != method || info->exception_type != exception_type ||
+                 info->pc != pc)) {
+      if (UNLIKELY(!Compute(method, exception_type, pc, info))) {
+        CatchHandlerInfo result = *info;
+        info->method = NULL;
+        return result;
+      }
+    }
+    return *info;
+  }
+
+  // Fills in the handler, returning whether the result may be cached.
+  static bool Compute(const mirror::ArtMethod* method, const mirror::Class* exception_type,
+                      uintptr_t pc, CatchHandlerInfo* info)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+ private:
+  static const size_t kSize = 64;
+
+  static size_t Index(const mirror::ArtMethod* method, const mirror::Class* exception_type,
+                      uintptr_t pc) {
+    uintptr_t hash = (reinterpret_cast<uintptr_t>(method) / kObjectAlignment) ^
+        (reinterpret_cast<uintptr_t>(exception_type) / kObjectAlignment) ^ pc;
+    return (hash ^ (hash >> 6)) % kSize;
+  }
+
+  CatchHandlerInfo infos_[kSize];
+
+  DISALLOW_COPY_AND_ASSIGN(CatchHandlerCache);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_CATCH_HANDLER_CACHE_H_
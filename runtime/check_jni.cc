@@ -158,6 +158,10 @@ class ScopedCheck {
       SHARED_LOCK_FUNCTION(Locks::mutator_lock_)
       : soa_(env) {
     Init(flags, functionName, true);
+    JavaVMExt* vm = soa_.Vm();
+    if (vm->check_jni_lite) {
+      sampled_ = (++soa_.Env()->check_jni_calls % vm->check_jni_sample_period) == 0;
+    }
     CheckThread(flags);
   }
 
@@ -175,8 +179,36 @@ class ScopedCheck {
     return soa_;
   }
 
+  // Whether to hand out a guarded copy, which CheckJNI lite only does on its sampled calls.
   bool ForceCopy() {
-    return Runtime::Current()->GetJavaVM()->force_copy;
+    JavaVMExt* vm = soa_.Vm();
+    return vm->check_jni_lite ? sampled_ : vm->force_copy;
+  }
+
+  // Remembers a guarded copy handed out by CheckJNI lite for the call releasing it.
+  void AddGuardedCopy(const void* copy) {
+    JavaVMExt* vm = soa_.Vm();
+    if (vm->check_jni_lite) {
+      MutexLock mu(Thread::Current(), vm->guarded_copies_lock);
+      vm->guarded_copies.insert(copy);
+    }
+  }
+
+  // Whether the buffer being released is a guarded copy. It's forgotten if the release frees it.
+  bool IsGuardedCopy(const void* data, bool freed) {
+    JavaVMExt* vm = soa_.Vm();
+    if (!vm->check_jni_lite) {
+      return vm->force_copy;
+    }
+    MutexLock mu(Thread::Current(), vm->guarded_copies_lock);
+    std::set<const void*>::iterator it = vm->guarded_copies.find(data);
+    if (it == vm->guarded_copies.end()) {
+      return false;
+    }
+    if (freed) {
+      vm->guarded_copies.erase(it);
+    }
+    return true;
   }
 
   // Checks that 'class_name' is a valid "fully-qualified" JNI class name, like "java/lang/Thread"
@@ -667,6 +699,7 @@ class ScopedCheck {
     flags_ = flags;
     function_name_ = functionName;
     has_method_ = has_method;
+    sampled_ = true;
   }
 
   /*
@@ -825,6 +858,10 @@ class ScopedCheck {
       }
       return;
     }
+    // Walking the whole string is too slow for every call of CheckJNI lite.
+    if (!sampled_) {
+      return;
+    }
 
     const char* errorKind = NULL;
     uint8_t utf8 = CheckUtfBytes(bytes, &errorKind);
@@ -889,6 +926,8 @@ class ScopedCheck {
   const char* function_name_;
   int flags_;
   bool has_method_;
+  // False for the CheckJNI lite calls that skip the expensive checks.
+  bool sampled_;
   int indent_;
 
   DISALLOW_COPY_AND_ASSIGN(ScopedCheck);
@@ -1497,6 +1536,7 @@ CALL(void, Void, , , VOID_RETURN, "V");
       mirror::String* s = sc.soa().Decode<mirror::String*>(java_string);
       int byteCount = s->GetLength() * 2;
       result = (const jchar*) GuardedCopy::Create(result, byteCount, false);
+      sc.AddGuardedCopy(result);
       if (isCopy != NULL) {
         *isCopy = JNI_TRUE;
       }
@@ -1507,7 +1547,7 @@ CALL(void, Void, , , VOID_RETURN, "V");
   static void ReleaseStringChars(JNIEnv* env, jstring string, const jchar* chars) {
     CHECK_JNI_ENTRY(kFlag_Default | kFlag_ExcepOkay, "Esp", env, string, chars);
     sc.CheckNonNull(chars);
-    if (sc.ForceCopy()) {
+    if (sc.IsGuardedCopy(chars, true)) {
       GuardedCopy::Check(__FUNCTION__, chars, false);
       chars = reinterpret_cast<const jchar*>(GuardedCopy::Destroy(const_cast<jchar*>(chars)));
     }
@@ -1530,6 +1570,7 @@ CALL(void, Void, , , VOID_RETURN, "V");
     const char* result = baseEnv(env)->GetStringUTFChars(env, string, isCopy);
     if (sc.ForceCopy() && result != NULL) {
       result = (const char*) GuardedCopy::Create(result, strlen(result) + 1, false);
+      sc.AddGuardedCopy(result);
       if (isCopy != NULL) {
         *isCopy = JNI_TRUE;
       }
@@ -1539,7 +1580,7 @@ CALL(void, Void, , , VOID_RETURN, "V");
 
   static void ReleaseStringUTFChars(JNIEnv* env, jstring string, const char* utf) {
     CHECK_JNI_ENTRY(kFlag_ExcepOkay | kFlag_Release, "Esu", env, string, utf);  // TODO: show pointer and truncate string.
-    if (sc.ForceCopy()) {
+    if (sc.IsGuardedCopy(utf, true)) {
       GuardedCopy::Check(__FUNCTION__, utf, false);
       utf = reinterpret_cast<const char*>(GuardedCopy::Destroy(const_cast<char*>(utf)));
     }
@@ -1584,7 +1625,7 @@ NEW_PRIMITIVE_ARRAY(jdoubleArray, Double);
 
 struct ForceCopyGetChecker {
  public:
-  ForceCopyGetChecker(ScopedCheck& sc, jboolean* isCopy) {
+  ForceCopyGetChecker(ScopedCheck& sc, jboolean* isCopy) : sc(sc) {
     force_copy = sc.ForceCopy();
     no_copy = 0;
     if (force_copy && isCopy != NULL) {
@@ -1598,11 +1639,13 @@ struct ForceCopyGetChecker {
     if (force_copy && result != NULL) {
       if (no_copy != kNoCopyMagic) {
         result = reinterpret_cast<ResultT>(CreateGuardedPACopy(env, array, isCopy));
+        sc.AddGuardedCopy(result);
       }
     }
     return result;
   }
 
+  ScopedCheck& sc;
   uint32_t no_copy;
   bool force_copy;
 };
@@ -1618,7 +1661,7 @@ struct ForceCopyGetChecker {
   static void Release##_jname##ArrayElements(JNIEnv* env, _ctype##Array array, _ctype* elems, jint mode) { \
     CHECK_JNI_ENTRY(kFlag_Default | kFlag_ExcepOkay, "Eapr", env, array, elems, mode); \
     sc.CheckNonNull(elems); \
-    if (sc.ForceCopy()) { \
+    if (sc.IsGuardedCopy(elems, mode != JNI_COMMIT)) { \
       ReleaseGuardedPACopy(env, array, elems, mode); \
     } \
     baseEnv(env)->Release##_jname##ArrayElements(env, array, elems, mode); \
@@ -1703,6 +1746,7 @@ PRIMITIVE_ARRAY_FUNCTIONS(jdouble, Double, 'D');
     void* result = baseEnv(env)->GetPrimitiveArrayCritical(env, array, isCopy);
     if (sc.ForceCopy() && result != NULL) {
       result = CreateGuardedPACopy(env, array, isCopy);
+      sc.AddGuardedCopy(result);
     }
     return CHECK_JNI_EXIT("p", result);
   }
@@ -1710,7 +1754,7 @@ PRIMITIVE_ARRAY_FUNCTIONS(jdouble, Double, 'D');
   static void ReleasePrimitiveArrayCritical(JNIEnv* env, jarray array, void* carray, jint mode) {
     CHECK_JNI_ENTRY(kFlag_CritRelease | kFlag_ExcepOkay, "Eapr", env, array, carray, mode);
     sc.CheckNonNull(carray);
-    if (sc.ForceCopy()) {
+    if (sc.IsGuardedCopy(carray, mode != JNI_COMMIT)) {
       ReleaseGuardedPACopy(env, array, carray, mode);
     }
     baseEnv(env)->ReleasePrimitiveArrayCritical(env, array, carray, mode);
@@ -1724,6 +1768,7 @@ PRIMITIVE_ARRAY_FUNCTIONS(jdouble, Double, 'D');
       mirror::String* s = sc.soa().Decode<mirror::String*>(java_string);
       int byteCount = s->GetLength() * 2;
       result = (const jchar*) GuardedCopy::Create(result, byteCount, false);
+      sc.AddGuardedCopy(result);
       if (isCopy != NULL) {
         *isCopy = JNI_TRUE;
       }
@@ -1734,7 +1779,7 @@ PRIMITIVE_ARRAY_FUNCTIONS(jdouble, Double, 'D');
   static void ReleaseStringCritical(JNIEnv* env, jstring string, const jchar* carray) {
     CHECK_JNI_ENTRY(kFlag_CritRelease | kFlag_ExcepOkay, "Esp", env, string, carray);
     sc.CheckNonNull(carray);
-    if (sc.ForceCopy()) {
+    if (sc.IsGuardedCopy(carray, true)) {
       GuardedCopy::Check(__FUNCTION__, carray, false);
       carray = reinterpret_cast<const jchar*>(GuardedCopy::Destroy(const_cast<jchar*>(carray)));
     }
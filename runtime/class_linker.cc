@@ -22,6 +22,7 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 
+#include <algorithm>
 #include <deque>
 #include <string>
 #include <utility>
@@ -30,8 +31,10 @@
 #include "base/casts.h"
 #include "base/logging.h"
 #include "base/stl_util.h"
+#include "base/timing_logger.h"
 #include "base/unix_file/fd_file.h"
 #include "class_linker-inl.h"
+#include "cutils/atomic-inline.h"
 #include "debugger.h"
 #include "dex_file-inl.h"
 #include "gc/accounting/card_table-inl.h"
@@ -40,6 +43,7 @@
 #include "gc/space/image_space.h"
 #include "intern_table.h"
 #include "interpreter/interpreter.h"
+#include "intrinsics.h"
 #include "leb128.h"
 #include "oat.h"
 #include "oat_file.h"
@@ -63,6 +67,7 @@
 #include "sirt_ref.h"
 #include "stack_indirect_reference_table.h"
 #include "thread.h"
+#include "thread_pool.h"
 #include "UniquePtr.h"
 #include "utils.h"
 #include "verifier/method_verifier.h"
@@ -123,9 +128,10 @@ static void WrapExceptionInInitializer() SHARED_LOCKS_REQUIRED(Locks::mutator_lo
   }
 }
 
-static size_t Hash(const char* s) {
-  // This is the java.lang.String hashcode for convenience, not interoperability.
-  size_t hash = 0;
+static uint32_t Hash(const char* s) {
+  // This is the java.lang.String hashcode for convenience, not interoperability. It is 32-bit on
+  // all targets since the image serializes the hashes of its classes.
+  uint32_t hash = 0;
   for (; *s != '\0'; ++s) {
     hash = hash * 31 + *s;
   }
@@ -187,8 +193,13 @@ ClassLinker* ClassLinker::CreateFromImage(InternTable* intern_table) {
 ClassLinker::ClassLinker(InternTable* intern_table)
     // dex_lock_ is recursive as it may be used in stack dumping.
     : dex_lock_("ClassLinker dex lock", kDefaultMutexLevel),
-      dex_cache_image_class_lookup_required_(false),
-      failed_dex_cache_class_lookups_(0),
+      prelink_thread_count_(0),
+      prelink_lock_("prelink thread pool lock"),
+      prelink_cancelled_(false),
+      lazy_direct_methods_enabled_(false),
+      lazy_direct_methods_lock_("ClassLinker lazy direct methods lock"),
+      class_load_timing_enabled_(false),
+      class_load_timings_lock_("ClassLinker class load timings lock"),
       class_roots_(NULL),
       array_iftable_(NULL),
       init_done_(false),
@@ -588,6 +599,11 @@ bool ClassLinker::GenerateOatFile(const std::string& dex_filename,
   }
   const char* oat_compiler_filter_option = oat_compiler_filter_string.c_str();
 
+  // Empty when not profiling, dex2oat then ignores it.
+  std::string profile_file_option_string("--profile-file=");
+  profile_file_option_string += Runtime::Current()->GetProfileFile();
+  const char* profile_file_option = profile_file_option_string.c_str();
+
   // fork and exec dex2oat
   pid_t pid = fork();
   if (pid == 0) {
@@ -609,7 +625,8 @@ bool ClassLinker::GenerateOatFile(const std::string& dex_filename,
                        << " " << boot_image_option
                        << " " << dex_file_option
                        << " " << oat_fd_option
-                       << " " << oat_location_option;
+                       << " " << oat_location_option
+                       << " " << profile_file_option;
 
     execl(dex2oat, dex2oat,
           "--runtime-arg", "-Xms64m",
@@ -624,6 +641,7 @@ bool ClassLinker::GenerateOatFile(const std::string& dex_filename,
           dex_file_option,
           oat_fd_option,
           oat_location_option,
+          profile_file_option,
           NULL);
 
     PLOG(FATAL) << "execl(" << dex2oat << ") failed";
@@ -657,6 +675,11 @@ void ClassLinker::RegisterOatFileLocked(const OatFile& oat_file) {
     }
   }
   VLOG(class_linker) << "Registering " << oat_file.GetLocation();
+  const Runtime* runtime = Runtime::Current();
+  if (!runtime->IsCompiler()) {
+    oat_file.Madvise(runtime->GetOatTextMadvise(), runtime->GetOatDataMadvise(),
+                     runtime->IsHotPrefetchEnabled());
+  }
   oat_files_.push_back(&oat_file);
 }
 
@@ -1015,7 +1038,6 @@ void ClassLinker::InitFromImage() {
 
   gc::Heap* heap = Runtime::Current()->GetHeap();
   gc::space::ImageSpace* space = heap->GetImageSpace();
-  dex_cache_image_class_lookup_required_ = true;
   CHECK(space != NULL);
   OatFile& oat_file = GetImageOatFile(space);
   CHECK_EQ(oat_file.GetOatHeader().GetImageFileLocationOatChecksum(), 0U);
@@ -1054,6 +1076,31 @@ void ClassLinker::InitFromImage() {
     AppendToBootClassPath(*dex_file, dex_cache);
   }
 
+  // Insert the image classes with the hashes computed by the image writer, this avoids hashing
+  // their descriptors and searching the dex caches for them.
+  {
+    mirror::ObjectArray<mirror::Class>* image_classes =
+        space->GetImageHeader().GetImageRoot(ImageHeader::kClassTable)
+            ->AsObjectArray<mirror::Class>();
+    mirror::IntArray* image_class_hashes =
+        space->GetImageHeader().GetImageRoot(ImageHeader::kClassTableHashes)->AsIntArray();
+    CHECK_EQ(image_classes->GetLength(), image_class_hashes->GetLength());
+    WriterMutexLock mu(self, *Locks::classlinker_classes_lock_);
+    class_table_.Reserve(image_classes->GetLength());
+    for (int32_t i = 0; i < image_classes->GetLength(); ++i) {
+      mirror::Class* klass = image_classes->Get(i);
+      DCHECK(klass->GetClassLoader() == NULL);
+      DCHECK_EQ(static_cast<uint32_t>(image_class_hashes->Get(i)),
+                Hash(ClassHelper(klass, this).GetDescriptor()));
+      class_table_.Insert(klass, static_cast<uint32_t>(image_class_hashes->Get(i)));
+    }
+    class_table_dirty_ = true;
+  }
+
+  // The image interned strings are already laid out as a hash set.
+  intern_table_->SetImageStrings(space->GetImageHeader().GetImageRoot(ImageHeader::kInternTable)
+                                     ->AsObjectArray<mirror::String>());
+
   // Set classes on AbstractMethod early so that IsMethod tests can be performed during the live
   // bitmap walk.
   mirror::ArtMethod::SetClass(GetClassRoot(kJavaLangReflectArtMethod));
@@ -1111,9 +1158,7 @@ void ClassLinker::VisitRoots(RootVisitor* visitor, void* arg, bool only_dirty, b
   {
     ReaderMutexLock mu(self, *Locks::classlinker_classes_lock_);
     if (!only_dirty || class_table_dirty_) {
-      for (const std::pair<size_t, mirror::Class*>& it : class_table_) {
-        visitor(it.second, arg);
-      }
+      class_table_.VisitRoots(visitor, arg);
       if (clean_dirty) {
         class_table_dirty_ = false;
       }
@@ -1127,15 +1172,8 @@ void ClassLinker::VisitRoots(RootVisitor* visitor, void* arg, bool only_dirty, b
 }
 
 void ClassLinker::VisitClasses(ClassVisitor* visitor, void* arg) {
-  if (dex_cache_image_class_lookup_required_) {
-    MoveImageClassesToClassTable();
-  }
   ReaderMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
-  for (const std::pair<size_t, mirror::Class*>& it : class_table_) {
-    if (!visitor(it.second, arg)) {
-      return;
-    }
-  }
+  class_table_.Visit(visitor, arg);
 }
 
 static bool GetClassesVisitor(mirror::Class* c, void* arg) {
@@ -1172,6 +1210,96 @@ ClassLinker::~ClassLinker() {
   mirror::StackTraceElement::ResetClass();
   STLDeleteElements(&boot_class_path_);
   STLDeleteElements(&oat_files_);
+  STLDeleteValues(&class_load_timings_);
+}
+
+// Loads a batch of classes on a prelink thread. Each task holds its own global reference to the
+// class loader since it outlives the call which queued it.
+class PrelinkClassesTask : public Task {
+ public:
+  PrelinkClassesTask(jobject class_loader, const volatile bool* cancelled)
+      : class_loader_(class_loader), cancelled_(cancelled) {}
+
+  std::vector<std::string>& GetDescriptors() {
+    return descriptors_;
+  }
+
+  virtual void Run(Thread* self) {
+    ScopedObjectAccess soa(self);
+    ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+    mirror::ClassLoader* class_loader = soa.Decode<mirror::ClassLoader*>(class_loader_);
+    for (const std::string& descriptor : descriptors_) {
+      if (*cancelled_) {
+        break;
+      }
+      if (class_linker->FindClass(descriptor.c_str(), class_loader) == NULL) {
+        self->ClearException();
+      }
+    }
+  }
+
+  virtual void Finalize() {
+    if (class_loader_ != NULL) {
+      Thread::Current()->GetJniEnv()->DeleteGlobalRef(class_loader_);
+    }
+    delete this;
+  }
+
+ private:
+  const jobject class_loader_;
+  const volatile bool* const cancelled_;
+  std::vector<std::string> descriptors_;
+
+  DISALLOW_COPY_AND_ASSIGN(PrelinkClassesTask);
+};
+
+void ClassLinker::PrelinkClasses(JNIEnv* env, jobject class_loader,
+                                 const std::vector<std::string>& descriptors) {
+  if (prelink_thread_count_ == 0 || descriptors.empty()) {
+    return;
+  }
+  Thread* self = Thread::Current();
+  ThreadPool* thread_pool;
+  {
+    MutexLock mu(self, prelink_lock_);
+    thread_pool = prelink_thread_pool_.get();
+  }
+  if (thread_pool == NULL) {
+    // Started outside the lock, creating the workers takes locks of the default level. If another
+    // thread wins the race the extra pool shuts down without having run anything.
+    UniquePtr<ThreadPool> new_thread_pool(new ThreadPool(prelink_thread_count_));
+    new_thread_pool->StartWorkers(self);
+    MutexLock mu(self, prelink_lock_);
+    if (prelink_thread_pool_.get() == NULL) {
+      prelink_thread_pool_.reset(new_thread_pool.release());
+    }
+    thread_pool = prelink_thread_pool_.get();
+  }
+  // Small batches so that the threads stay busy till the end, large enough that queueing them
+  // isn't the bottleneck.
+  static const size_t kClassesPerTask = 32;
+  for (size_t i = 0; i < descriptors.size(); i += kClassesPerTask) {
+    jobject global_class_loader = class_loader != NULL ? env->NewGlobalRef(class_loader) : NULL;
+    PrelinkClassesTask* task = new PrelinkClassesTask(global_class_loader, &prelink_cancelled_);
+    const size_t end = std::min(descriptors.size(), i + kClassesPerTask);
+    task->GetDescriptors().assign(descriptors.begin() + i, descriptors.begin() + end);
+    thread_pool->AddTask(self, task);
+  }
+  VLOG(class_linker) << "Queued " << descriptors.size() << " classes for prelinking";
+}
+
+void ClassLinker::DeletePrelinkThreadPool() {
+  if (prelink_thread_pool_.get() == NULL) {
+    return;
+  }
+  Thread* self = Thread::Current();
+  prelink_cancelled_ = true;
+  {
+    // The remaining tasks return right away, the threads may still need to suspend for a GC.
+    ScopedThreadStateChange tsc(self, kNative);
+    prelink_thread_pool_->Wait(self, false, false);
+  }
+  prelink_thread_pool_.reset();
 }
 
 mirror::DexCache* ClassLinker::AllocDexCache(Thread* self, const DexFile& dex_file) {
@@ -1317,7 +1445,11 @@ mirror::Class* ClassLinker::FindClass(const char* descriptor, mirror::ClassLoade
     return CreateArrayClass(descriptor, class_loader);
 
   } else if (class_loader == NULL) {
-    DexFile::ClassPathEntry pair = DexFile::FindInClassPath(descriptor, boot_class_path_);
+    DexFile::ClassPathEntry pair;
+    {
+      ScopedClassLoadTimer timer(this, NULL, "DexLookup");
+      pair = DexFile::FindInClassPath(descriptor, boot_class_path_);
+    }
     if (pair.second != NULL) {
       return DefineClass(descriptor, NULL, *pair.first, *pair.second);
     }
@@ -1338,7 +1470,11 @@ mirror::Class* ClassLinker::FindClass(const char* descriptor, mirror::ClassLoade
       class_path = &Runtime::Current()->GetCompileTimeClassPath(jclass_loader.get());
     }
 
-    DexFile::ClassPathEntry pair = DexFile::FindInClassPath(descriptor, *class_path);
+    DexFile::ClassPathEntry pair;
+    {
+      ScopedClassLoadTimer timer(this, class_loader, "DexLookup");
+      pair = DexFile::FindInClassPath(descriptor, *class_path);
+    }
     if (pair.second != NULL) {
       return DefineClass(descriptor, class_loader, *pair.first, *pair.second);
     }
@@ -1384,6 +1520,7 @@ mirror::Class* ClassLinker::DefineClass(const char* descriptor,
                                         const DexFile& dex_file,
                                         const DexFile::ClassDef& dex_class_def) {
   Thread* self = Thread::Current();
+  ScopedPerfCounters spc(self, kPerfPhaseClassLoad);
   SirtRef<mirror::Class> klass(self, NULL);
   // Load the class from the dex file.
   if (UNLIKELY(!init_done_)) {
@@ -1411,7 +1548,10 @@ mirror::Class* ClassLinker::DefineClass(const char* descriptor,
     return NULL;
   }
   klass->SetDexCache(FindDexCache(dex_file));
-  LoadClass(dex_file, dex_class_def, klass, class_loader);
+  {
+    ScopedClassLoadTimer timer(this, class_loader, "LoadClass");
+    LoadClass(dex_file, dex_class_def, klass, class_loader);
+  }
   // Check for a pending exception during load
   if (self->IsExceptionPending()) {
     klass->SetStatus(mirror::Class::kStatusError, self);
@@ -1438,12 +1578,18 @@ mirror::Class* ClassLinker::DefineClass(const char* descriptor,
   CHECK(klass->IsLoaded());
   // Link the class (if necessary)
   CHECK(!klass->IsResolved());
-  if (!LinkClass(klass, NULL, self)) {
+  bool linked;
+  {
+    ScopedClassLoadTimer timer(this, class_loader, "LinkClass");
+    linked = LinkClass(klass, NULL, self);
+  }
+  if (!linked) {
     // Linking failed.
     klass->SetStatus(mirror::Class::kStatusError, self);
     return NULL;
   }
   CHECK(klass->IsResolved());
+  ResolveRelativeCallTargets(dex_file, klass.get());
 
   /*
    * We send CLASS_PREPARE events to the debugger from here.  The
@@ -1461,6 +1607,26 @@ mirror::Class* ClassLinker::DefineClass(const char* descriptor,
   return klass.get();
 }
 
+void ClassLinker::ResolveRelativeCallTargets(const DexFile& dex_file, mirror::Class* klass) {
+  Runtime* runtime = Runtime::Current();
+  if (!runtime->IsStarted() || runtime->UseCompileTimeClassPath()) {
+    return;
+  }
+  const OatFile* oat_file = FindOpenedOatFileForDexFile(dex_file);
+  if (oat_file == NULL || !oat_file->GetOatHeader().HasRelativeCalls()) {
+    return;
+  }
+  // The compiled code branches straight to the direct methods of its own class, passing the
+  // Method* it finds in the dex cache at the method's own index. Resolving that index finds the
+  // method in this class, so this stores what resolution would. It waits until the class is
+  // defined, as a class that lost a race to be inserted is never used.
+  mirror::DexCache* dex_cache = klass->GetDexCache();
+  for (size_t i = 0; i < klass->NumDirectMethods(); ++i) {
+    mirror::ArtMethod* method = klass->GetDirectMethod(i);
+    dex_cache->SetResolvedMethod(method->GetDexMethodIndex(), method);
+  }
+}
+
 // Precomputes size that will be needed for Class, matching LinkStaticFields
 size_t ClassLinker::SizeOfClass(const DexFile& dex_file,
                                 const DexFile::ClassDef& dex_class_def) {
@@ -1655,11 +1821,21 @@ void ClassLinker::FixupStaticTrampolines(mirror::Class* klass) {
   }
   // Link the code of methods skipped by LinkCode
   for (size_t method_index = 0; it.HasNextDirectMethod(); ++method_index, it.Next()) {
-    mirror::ArtMethod* method = klass->GetDirectMethod(method_index);
-    if (!method->IsStatic()) {
+    if ((it.GetMemberAccessFlags() & kAccStatic) == 0) {
       // Only update static methods.
       continue;
     }
+    // Lazy static methods are loaded now, as those loaded after the class is initialized would
+    // keep the trampoline.
+    mirror::ArtMethod* method = klass->GetLoadedDirectMethod(method_index);
+    if (method == NULL) {
+      method = LoadLazyDirectMethod(klass, dex_file, it, method_index);
+      if (UNLIKELY(method == NULL)) {
+        // Leave the method for LoadLazyDirectMethod to link once the class is initialized.
+        Thread::Current()->ClearException();
+        continue;
+      }
+    }
     const void* code = oat_class->GetOatMethod(method_index).GetCode();
     const bool enter_interpreter = NeedsInterpreter(method, code);
     if (enter_interpreter) {
@@ -1680,6 +1856,9 @@ static void LinkCode(SirtRef<mirror::ArtMethod>& method, const OatFile::OatClass
   // non-abstract methods also get their code pointers.
   const OatFile::OatMethod oat_method = oat_class->GetOatMethod(method_index);
   oat_method.LinkMethod(method.get());
+  if (oat_class->HasMethodHooks() && oat_method.GetCode() != NULL && !method->IsNative()) {
+    method->SetHasMethodHooks();
+  }
 
   // Install entry point from interpreter.
   Runtime* runtime = Runtime::Current();
@@ -1806,8 +1985,21 @@ void ClassLinker::LoadClass(const DexFile& dex_file,
     }
     klass->SetVirtualMethods(virtuals);
   }
+  // Without an oat class the methods can't be linked later, as when compiling. Code compiled with
+  // relative calls needs the direct methods in the dex cache once the class is defined.
+  const bool lazy_direct_methods = lazy_direct_methods_enabled_ && class_loader != NULL &&
+      oat_class.get() != NULL && !oat_class->HasRelativeCalls();
   size_t class_def_method_index = 0;
   for (size_t i = 0; it.HasNextDirectMethod(); i++, it.Next()) {
+    if (lazy_direct_methods) {
+      // LoadMethod makes classes declaring a finalize method finalizable, which can't wait.
+      const DexFile::MethodId& method_id = dex_file.GetMethodId(it.GetMemberIndex());
+      if (strcmp(dex_file.GetMethodName(method_id), "finalize") != 0) {
+        klass->SetHasLazyDirectMethods();
+        class_def_method_index++;
+        continue;
+      }
+    }
     SirtRef<mirror::ArtMethod> method(self, LoadMethod(self, dex_file, it, klass));
     if (UNLIKELY(method.get() == NULL)) {
       CHECK(self->IsExceptionPending());  // OOME.
@@ -1895,6 +2087,12 @@ mirror::ArtMethod* ClassLinker::LoadMethod(Thread* self, const DexFile& dex_file
   }
   dst->SetCodeItemOffset(it.GetMethodCodeItemOffset());
   dst->SetAccessFlags(it.GetMemberAccessFlags());
+  if (klass->GetClassLoader() == NULL) {
+    Intrinsic intrinsic = FindIntrinsic(dex_file, dex_method_idx);
+    if (intrinsic != kIntrinsicNone) {
+      dst->SetIntrinsic(intrinsic);
+    }
+  }
 
   dst->SetDexCacheStrings(klass->GetDexCache()->GetStrings());
   dst->SetDexCacheResolvedMethods(klass->GetDexCache()->GetResolvedMethods());
@@ -1907,6 +2105,95 @@ mirror::ArtMethod* ClassLinker::LoadMethod(Thread* self, const DexFile& dex_file
   return dst;
 }
 
+// Positions the iterator at the first direct method.
+static void SkipFields(ClassDataItemIterator* it) {
+  while (it->HasNextStaticField() || it->HasNextInstanceField()) {
+    it->Next();
+  }
+}
+
+mirror::ArtMethod* ClassLinker::LoadLazyDirectMethod(mirror::Class* klass, size_t index) {
+  ClassHelper kh(klass);
+  const DexFile& dex_file = kh.GetDexFile();
+  ClassDataItemIterator it(dex_file, dex_file.GetClassData(*kh.GetClassDef()));
+  SkipFields(&it);
+  for (size_t i = 0; i < index; ++i) {
+    it.Next();
+  }
+  CHECK(it.HasNextDirectMethod()) << PrettyClass(klass) << " " << index;
+  return LoadLazyDirectMethod(klass, dex_file, it, index);
+}
+
+mirror::ArtMethod* ClassLinker::FindLazyDirectMethod(mirror::Class* klass, const StringPiece& name,
+                                                     const StringPiece& signature) {
+  ClassHelper kh(klass);
+  const DexFile& dex_file = kh.GetDexFile();
+  ClassDataItemIterator it(dex_file, dex_file.GetClassData(*kh.GetClassDef()));
+  SkipFields(&it);
+  for (size_t i = 0; it.HasNextDirectMethod(); ++i, it.Next()) {
+    const DexFile::MethodId& method_id = dex_file.GetMethodId(it.GetMemberIndex());
+    if (name == dex_file.GetMethodName(method_id) &&
+        signature == dex_file.GetMethodSignature(method_id)) {
+      return LoadLazyDirectMethod(klass, dex_file, it, i);
+    }
+  }
+  return NULL;
+}
+
+mirror::ArtMethod* ClassLinker::FindLazyDirectMethod(mirror::Class* klass,
+                                                     uint32_t dex_method_idx) {
+  ClassHelper kh(klass);
+  const DexFile& dex_file = kh.GetDexFile();
+  ClassDataItemIterator it(dex_file, dex_file.GetClassData(*kh.GetClassDef()));
+  SkipFields(&it);
+  for (size_t i = 0; it.HasNextDirectMethod(); ++i, it.Next()) {
+    if (it.GetMemberIndex() == dex_method_idx) {
+      return LoadLazyDirectMethod(klass, dex_file, it, i);
+    }
+  }
+  return NULL;
+}
+
+mirror::ArtMethod* ClassLinker::LoadLazyDirectMethod(mirror::Class* klass,
+                                                     const DexFile& dex_file,
+                                                     const ClassDataItemIterator& it,
+                                                     size_t index) {
+  mirror::ArtMethod* loaded = klass->GetLoadedDirectMethod(index);
+  if (loaded != NULL) {
+    return loaded;
+  }
+  Thread* self = Thread::Current();
+  SirtRef<mirror::Class> sirt_klass(self, klass);
+  SirtRef<mirror::ArtMethod> method(self, LoadMethod(self, dex_file, it, sirt_klass));
+  if (UNLIKELY(method.get() == NULL)) {
+    CHECK(self->IsExceptionPending());  // OOME.
+    return NULL;
+  }
+  // Direct methods come first, so the index is also the class def method index.
+  UniquePtr<const OatFile::OatClass> oat_class(GetOatClass(dex_file, klass->GetDexClassDefIndex()));
+  CHECK(oat_class.get() != NULL);
+  LinkCode(method, oat_class.get(), index);
+  method->SetMethodIndex(index);
+  if (method->IsStatic() && !method->IsConstructor() && klass->IsInitialized()) {
+    // Only reached if FixupStaticTrampolines couldn't load the method.
+    const void* code = oat_class->GetOatMethod(index).GetCode();
+    if (NeedsInterpreter(method.get(), code)) {
+      code = GetCompiledCodeToInterpreterBridge();
+    }
+    Runtime::Current()->GetInstrumentation()->UpdateMethodsCode(method.get(), code);
+  }
+  MutexLock mu(self, lazy_direct_methods_lock_);
+  loaded = klass->GetLoadedDirectMethod(index);
+  if (loaded != NULL) {
+    // Another thread won the race, ours is garbage.
+    return loaded;
+  }
+  // Readers don't take the lock, the method must be complete before it is visible.
+  android_memory_barrier();
+  klass->SetDirectMethod(index, method.get());
+  return method.get();
+}
+
 void ClassLinker::AppendToBootClassPath(const DexFile& dex_file) {
   Thread* self = Thread::Current();
   SirtRef<mirror::DexCache> dex_cache(self, AllocDexCache(self, dex_file));
@@ -2202,200 +2489,38 @@ mirror::Class* ClassLinker::InsertClass(const char* descriptor, mirror::Class* k
     LOG(INFO) << "Loaded class " << descriptor << source;
   }
   WriterMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
-  mirror::Class* existing =
-      LookupClassFromTableLocked(descriptor, klass->GetClassLoader(), hash);
+  // Writers are serialized, so this lookup can't miss a class inserted concurrently.
+  mirror::Class* existing = class_table_.Lookup(descriptor, klass->GetClassLoader(), hash);
   if (existing != NULL) {
     return existing;
   }
-  if (kIsDebugBuild && klass->GetClassLoader() == NULL && dex_cache_image_class_lookup_required_) {
-    // Check a class loaded with the system class loader matches one in the image if the class
-    // is in the image.
-    existing = LookupClassFromImage(descriptor);
-    if (existing != NULL) {
-      CHECK(klass == existing);
-    }
-  }
   Runtime::Current()->GetHeap()->VerifyObject(klass);
-  class_table_.insert(std::make_pair(hash, klass));
+  class_table_.Insert(klass, hash);
   class_table_dirty_ = true;
   return NULL;
 }
 
 bool ClassLinker::RemoveClass(const char* descriptor, const mirror::ClassLoader* class_loader) {
-  size_t hash = Hash(descriptor);
   WriterMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
-  ClassHelper kh;
-  for (auto it = class_table_.lower_bound(hash), end = class_table_.end(); it != end && it->first == hash;
-       ++it) {
-    mirror::Class* klass = it->second;
-    kh.ChangeClass(klass);
-    if (strcmp(kh.GetDescriptor(), descriptor) == 0 && klass->GetClassLoader() == class_loader) {
-      class_table_.erase(it);
-      return true;
-    }
-  }
-  return false;
+  return class_table_.Remove(descriptor, class_loader, Hash(descriptor));
 }
 
 mirror::Class* ClassLinker::LookupClass(const char* descriptor,
                                         const mirror::ClassLoader* class_loader) {
-  size_t hash = Hash(descriptor);
-  {
-    ReaderMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
-    mirror::Class* result = LookupClassFromTableLocked(descriptor, class_loader, hash);
-    if (result != NULL) {
-      return result;
-    }
-  }
-  if (class_loader != NULL || !dex_cache_image_class_lookup_required_) {
-    return NULL;
-  } else {
-    // Lookup failed but need to search dex_caches_.
-    mirror::Class* result = LookupClassFromImage(descriptor);
-    if (result != NULL) {
-      InsertClass(descriptor, result, hash);
-    } else {
-      // Searching the image dex files/caches failed, we don't want to get into this situation
-      // often as map searches are faster, so after kMaxFailedDexCacheLookups move all image
-      // classes into the class table.
-      const int32_t kMaxFailedDexCacheLookups = 1000;
-      if (++failed_dex_cache_class_lookups_ > kMaxFailedDexCacheLookups) {
-        MoveImageClassesToClassTable();
-      }
-    }
-    return result;
-  }
-}
-
-mirror::Class* ClassLinker::LookupClassFromTableLocked(const char* descriptor,
-                                                       const mirror::ClassLoader* class_loader,
-                                                       size_t hash) {
-  ClassHelper kh(NULL, this);
-  auto end = class_table_.end();
-  for (auto it = class_table_.lower_bound(hash); it != end && it->first == hash; ++it) {
-    mirror::Class* klass = it->second;
-    kh.ChangeClass(klass);
-    if (klass->GetClassLoader() == class_loader && strcmp(descriptor, kh.GetDescriptor()) == 0) {
-      if (kIsDebugBuild) {
-        // Check for duplicates in the table.
-        for (++it; it != end && it->first == hash; ++it) {
-          mirror::Class* klass2 = it->second;
-          kh.ChangeClass(klass2);
-          CHECK(!(strcmp(descriptor, kh.GetDescriptor()) == 0 && klass2->GetClassLoader() == class_loader))
-          << PrettyClass(klass) << " " << klass << " " << klass->GetClassLoader() << " "
-          << PrettyClass(klass2) << " " << klass2 << " " << klass2->GetClassLoader();
-        }
-      }
-      return klass;
-    }
-  }
-  return NULL;
-}
-
-static mirror::ObjectArray<mirror::DexCache>* GetImageDexCaches()
-    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
-  gc::space::ImageSpace* image = Runtime::Current()->GetHeap()->GetImageSpace();
-  CHECK(image != NULL);
-  mirror::Object* root = image->GetImageHeader().GetImageRoot(ImageHeader::kDexCaches);
-  return root->AsObjectArray<mirror::DexCache>();
-}
-
-void ClassLinker::MoveImageClassesToClassTable() {
-  Thread* self = Thread::Current();
-  WriterMutexLock mu(self, *Locks::classlinker_classes_lock_);
-  if (!dex_cache_image_class_lookup_required_) {
-    return;  // All dex cache classes are already in the class table.
-  }
-  const char* old_no_suspend_cause =
-      self->StartAssertNoThreadSuspension("Moving image classes to class table");
-  mirror::ObjectArray<mirror::DexCache>* dex_caches = GetImageDexCaches();
-  ClassHelper kh(NULL, this);
-  for (int32_t i = 0; i < dex_caches->GetLength(); i++) {
-    mirror::DexCache* dex_cache = dex_caches->Get(i);
-    mirror::ObjectArray<mirror::Class>* types = dex_cache->GetResolvedTypes();
-    for (int32_t j = 0; j < types->GetLength(); j++) {
-      mirror::Class* klass = types->Get(j);
-      if (klass != NULL) {
-        kh.ChangeClass(klass);
-        DCHECK(klass->GetClassLoader() == NULL);
-        const char* descriptor = kh.GetDescriptor();
-        size_t hash = Hash(descriptor);
-        mirror::Class* existing = LookupClassFromTableLocked(descriptor, NULL, hash);
-        if (existing != NULL) {
-          CHECK(existing == klass) << PrettyClassAndClassLoader(existing) << " != "
-              << PrettyClassAndClassLoader(klass);
-        } else {
-          class_table_.insert(std::make_pair(hash, klass));
-        }
-      }
-    }
-  }
-  class_table_dirty_ = true;
-  dex_cache_image_class_lookup_required_ = false;
-  self->EndAssertNoThreadSuspension(old_no_suspend_cause);
-}
-
-mirror::Class* ClassLinker::LookupClassFromImage(const char* descriptor) {
-  Thread* self = Thread::Current();
-  const char* old_no_suspend_cause =
-      self->StartAssertNoThreadSuspension("Image class lookup");
-  mirror::ObjectArray<mirror::DexCache>* dex_caches = GetImageDexCaches();
-  for (int32_t i = 0; i < dex_caches->GetLength(); ++i) {
-    mirror::DexCache* dex_cache = dex_caches->Get(i);
-    const DexFile* dex_file = dex_cache->GetDexFile();
-    // First search using the class def map, but don't bother for non-class types.
-    if (descriptor[0] == 'L') {
-      const DexFile::StringId* descriptor_string_id = dex_file->FindStringId(descriptor);
-      if (descriptor_string_id != NULL) {
-        const DexFile::TypeId* type_id =
-            dex_file->FindTypeId(dex_file->GetIndexForStringId(*descriptor_string_id));
-        if (type_id != NULL) {
-          mirror::Class* klass = dex_cache->GetResolvedType(dex_file->GetIndexForTypeId(*type_id));
-          if (klass != NULL) {
-            self->EndAssertNoThreadSuspension(old_no_suspend_cause);
-            return klass;
-          }
-        }
-      }
-    }
-    // Now try binary searching the string/type index.
-    const DexFile::StringId* string_id = dex_file->FindStringId(descriptor);
-    if (string_id != NULL) {
-      const DexFile::TypeId* type_id =
-          dex_file->FindTypeId(dex_file->GetIndexForStringId(*string_id));
-      if (type_id != NULL) {
-        uint16_t type_idx = dex_file->GetIndexForTypeId(*type_id);
-        mirror::Class* klass = dex_cache->GetResolvedType(type_idx);
-        if (klass != NULL) {
-          self->EndAssertNoThreadSuspension(old_no_suspend_cause);
-          return klass;
-        }
-      }
-    }
-  }
-  self->EndAssertNoThreadSuspension(old_no_suspend_cause);
-  return NULL;
+  return class_table_.Lookup(descriptor, class_loader, Hash(descriptor));
 }
 
 void ClassLinker::LookupClasses(const char* descriptor, std::vector<mirror::Class*>& result) {
   result.clear();
-  if (dex_cache_image_class_lookup_required_) {
-    MoveImageClassesToClassTable();
-  }
-  size_t hash = Hash(descriptor);
-  ReaderMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
-  ClassHelper kh(NULL, this);
-  for (auto it = class_table_.lower_bound(hash), end = class_table_.end();
-      it != end && it->first == hash; ++it) {
-    mirror::Class* klass = it->second;
-    kh.ChangeClass(klass);
-    if (strcmp(descriptor, kh.GetDescriptor()) == 0) {
-      result.push_back(klass);
-    }
-  }
+  class_table_.LookupAll(descriptor, Hash(descriptor), &result);
 }
 
 void ClassLinker::VerifyClass(mirror::Class* klass) {
+  // A verified class stays verified. Checking without the lock keeps image classes from being
+  // locked, which would dirty their pages.
+  if (klass->IsVerified()) {
+    return;
+  }
   // TODO: assert that the monitor on the Class is held
   Thread* self = Thread::Current();
   ObjectLock lock(self, klass);
@@ -2413,6 +2538,8 @@ void ClassLinker::VerifyClass(mirror::Class* klass) {
     return;
   }
 
+  ScopedClassLoadTimer timer(this, klass->GetClassLoader(), "VerifyClass");
+
   if (klass->GetStatus() == mirror::Class::kStatusResolved) {
     klass->SetStatus(mirror::Class::kStatusVerifying, self);
   } else {
@@ -2425,11 +2552,14 @@ void ClassLinker::VerifyClass(mirror::Class* klass) {
   // Verify super class.
   SirtRef<mirror::Class> super(self, klass->GetSuperClass());
   if (super.get() != NULL) {
-    // Acquire lock to prevent races on verifying the super class.
-    ObjectLock lock(self, super.get());
+    // The super class is usually an image class that is verified already, only lock it otherwise.
+    if (!super->IsVerified()) {
+      // Acquire lock to prevent races on verifying the super class.
+      ObjectLock lock(self, super.get());
 
-    if (!super->IsVerified() && !super->IsErroneous()) {
-      VerifyClass(super.get());
+      if (!super->IsVerified() && !super->IsErroneous()) {
+        VerifyClass(super.get());
+      }
     }
     if (!super->IsCompileTimeVerified()) {
       std::string error_msg(StringPrintf("Rejecting class %s that attempts to sub-class erroneous class %s",
@@ -2452,7 +2582,9 @@ void ClassLinker::VerifyClass(mirror::Class* klass) {
   // Try to use verification information from the oat file, otherwise do runtime verification.
   const DexFile& dex_file = *klass->GetDexCache()->GetDexFile();
   mirror::Class::Status oat_file_class_status(mirror::Class::kStatusNotReady);
-  bool preverified = VerifyClassUsingOatFile(dex_file, klass, oat_file_class_status);
+  const uint32_t* methods_to_verify = NULL;
+  bool preverified = VerifyClassUsingOatFile(dex_file, klass, oat_file_class_status,
+                                             methods_to_verify);
   if (oat_file_class_status == mirror::Class::kStatusError) {
     VLOG(class_linker) << "Skipping runtime verification of erroneous class "
         << PrettyDescriptor(klass) << " in "
@@ -2467,6 +2599,7 @@ void ClassLinker::VerifyClass(mirror::Class* klass) {
   if (!preverified) {
     verifier_failure = verifier::MethodVerifier::VerifyClass(klass,
                                                              Runtime::Current()->IsCompiler(),
+                                                             methods_to_verify,
                                                              &error_msg);
   }
   if (preverified || verifier_failure != verifier::MethodVerifier::kHardFailure) {
@@ -2520,7 +2653,8 @@ void ClassLinker::VerifyClass(mirror::Class* klass) {
 }
 
 bool ClassLinker::VerifyClassUsingOatFile(const DexFile& dex_file, mirror::Class* klass,
-                                          mirror::Class::Status& oat_file_class_status) {
+                                          mirror::Class::Status& oat_file_class_status,
+                                          const uint32_t*& methods_to_verify) {
   // If we're compiling, we can only verify the class using the oat file if
   // we are not compiling the image or if the class we're verifying is not part of
   // the app.  In other words, we will only check for preverification of bootclasspath
@@ -2577,7 +2711,8 @@ bool ClassLinker::VerifyClassUsingOatFile(const DexFile& dex_file, mirror::Class
     // (see verifier::RegType::Merge) as we can't know the type of Bar and we could possibly be
     // allowing an unsafe assignment to the field x in the iput (javac may have compiled this as
     // it knew Bar was a sub-class of Foo, but for us this may have been moved into a separate apk
-    // at compile time).
+    // at compile time). Only the methods that had the soft failure need to be verified again.
+    methods_to_verify = oat_class->GetMethodsToVerify();
     return false;
   }
   if (oat_file_class_status == mirror::Class::kStatusError) {
@@ -2599,18 +2734,24 @@ bool ClassLinker::VerifyClassUsingOatFile(const DexFile& dex_file, mirror::Class
 }
 
 void ClassLinker::ResolveClassExceptionHandlerTypes(const DexFile& dex_file, mirror::Class* klass) {
-  for (size_t i = 0; i < klass->NumDirectMethods(); i++) {
-    ResolveMethodExceptionHandlerTypes(dex_file, klass->GetDirectMethod(i));
+  // Walk the class data rather than the methods, which may not be loaded yet.
+  const byte* class_data = dex_file.GetClassData(*ClassHelper(klass).GetClassDef());
+  if (class_data == NULL) {
+    return;  // no fields or methods - for example a marker interface
+  }
+  ClassDataItemIterator it(dex_file, class_data);
+  while (it.HasNextStaticField() || it.HasNextInstanceField()) {
+    it.Next();
   }
-  for (size_t i = 0; i < klass->NumVirtualMethods(); i++) {
-    ResolveMethodExceptionHandlerTypes(dex_file, klass->GetVirtualMethod(i));
+  for (; it.HasNextDirectMethod() || it.HasNextVirtualMethod(); it.Next()) {
+    ResolveMethodExceptionHandlerTypes(dex_file, it.GetMethodCodeItem(), klass);
   }
 }
 
 void ClassLinker::ResolveMethodExceptionHandlerTypes(const DexFile& dex_file,
-                                                     mirror::ArtMethod* method) {
+                                                     const DexFile::CodeItem* code_item,
+                                                     const mirror::Class* klass) {
   // similar to DexVerifier::ScanTryCatchBlocks and dex2oat's ResolveExceptionsForMethod.
-  const DexFile::CodeItem* code_item = dex_file.GetCodeItem(method->GetCodeItemOffset());
   if (code_item == NULL) {
     return;  // native or abstract method
   }
@@ -2619,14 +2760,13 @@ void ClassLinker::ResolveMethodExceptionHandlerTypes(const DexFile& dex_file,
   }
   const byte* handlers_ptr = DexFile::GetCatchHandlerData(*code_item, 0);
   uint32_t handlers_size = DecodeUnsignedLeb128(&handlers_ptr);
-  ClassLinker* linker = Runtime::Current()->GetClassLinker();
   for (uint32_t idx = 0; idx < handlers_size; idx++) {
     CatchHandlerIterator iterator(handlers_ptr);
     for (; iterator.HasNext(); iterator.Next()) {
       // Ensure exception types are resolved so that they don't need resolution to be delivered,
       // unresolved exception types will be ignored by exception delivery
       if (iterator.GetHandlerTypeIndex() != DexFile::kDexNoIndex16) {
-        mirror::Class* exception_type = linker->ResolveType(iterator.GetHandlerTypeIndex(), method);
+        mirror::Class* exception_type = ResolveType(dex_file, iterator.GetHandlerTypeIndex(), klass);
         if (exception_type == NULL) {
           DCHECK(Thread::Current()->IsExceptionPending());
           Thread::Current()->ClearException();
@@ -2947,6 +3087,7 @@ bool ClassLinker::InitializeClass(mirror::Class* klass, bool can_init_statics,
     return false;
   }
 
+  ScopedClassLoadTimer timer(this, klass->GetClassLoader(), "InitializeClass");
   Thread* self = Thread::Current();
   uint64_t t0;
   {
@@ -3371,6 +3512,71 @@ bool ClassLinker::LinkSuperClass(SirtRef<mirror::Class>& klass) {
   return true;
 }
 
+// Multimap from method name hashes to method indexes, used while linking to find the candidates
+// for HasSameNameAndSignature without comparing every pair of methods. Indexes with the same hash
+// are returned in the order they were inserted.
+class LinkMethodIndex {
+ public:
+  static const uint32_t kNoIndex = 0xFFFFFFFF;
+
+  explicit LinkMethodIndex(size_t max_count) {
+    size_t capacity = 16;
+    while (capacity < max_count * 2) {
+      capacity *= 2;
+    }
+    mask_ = capacity - 1;
+    Slot unused = { 0, kNoIndex };
+    slots_.resize(capacity, unused);
+  }
+
+  void Insert(const char* name, uint32_t index) {
+    const uint32_t hash = Hash(name);
+    size_t i = hash & mask_;
+    while (slots_[i].index != kNoIndex) {
+      i = (i + 1) & mask_;
+    }
+    slots_[i].hash = hash;
+    slots_[i].index = index;
+  }
+
+  // Iterates over the indexes inserted with the same name hash, there may be false positives.
+  class Iterator {
+   public:
+    Iterator(const LinkMethodIndex& index, const char* name)
+        : index_(index), hash_(Hash(name)), slot_(hash_ & index.mask_) {}
+
+    // Returns kNoIndex once there are no more candidates.
+    uint32_t Next() {
+      while (true) {
+        const Slot& slot = index_.slots_[slot_];
+        if (slot.index == kNoIndex) {
+          return kNoIndex;
+        }
+        slot_ = (slot_ + 1) & index_.mask_;
+        if (slot.hash == hash_) {
+          return slot.index;
+        }
+      }
+    }
+
+   private:
+    const LinkMethodIndex& index_;
+    const uint32_t hash_;
+    size_t slot_;
+  };
+
+ private:
+  struct Slot {
+    uint32_t hash;
+    uint32_t index;
+  };
+
+  size_t mask_;
+  std::vector<Slot> slots_;
+
+  DISALLOW_COPY_AND_ASSIGN(LinkMethodIndex);
+};
+
 // Populate the class vtable and itable. Compute return type indices.
 bool ClassLinker::LinkMethods(SirtRef<mirror::Class>& klass,
                               mirror::ObjectArray<mirror::Class>* interfaces) {
@@ -3409,11 +3615,20 @@ bool ClassLinker::LinkVirtualMethods(SirtRef<mirror::Class>& klass) {
     // See if any of our virtual methods override the superclass.
     MethodHelper local_mh(NULL, this);
     MethodHelper super_mh(NULL, this);
+    LinkMethodIndex vtable_index(klass->NumVirtualMethods() == 0 ? 0 : max_count);
+    if (klass->NumVirtualMethods() != 0) {
+      for (size_t j = 0; j < actual_count; ++j) {
+        super_mh.ChangeMethod(vtable->Get(j));
+        vtable_index.Insert(super_mh.GetName(), j);
+      }
+    }
     for (size_t i = 0; i < klass->NumVirtualMethods(); ++i) {
       mirror::ArtMethod* local_method = klass->GetVirtualMethodDuringLinking(i);
       local_mh.ChangeMethod(local_method);
-      size_t j = 0;
-      for (; j < actual_count; ++j) {
+      // The candidates come in increasing vtable order, so the first match still wins.
+      LinkMethodIndex::Iterator it(vtable_index, local_mh.GetName());
+      size_t j;
+      while ((j = it.Next()) != LinkMethodIndex::kNoIndex) {
         mirror::ArtMethod* super_method = vtable->Get(j);
         super_mh.ChangeMethod(super_method);
         if (local_mh.HasSameNameAndSignature(&super_mh)) {
@@ -3434,10 +3649,11 @@ bool ClassLinker::LinkVirtualMethods(SirtRef<mirror::Class>& klass) {
           }
         }
       }
-      if (j == actual_count) {
+      if (j == LinkMethodIndex::kNoIndex) {
         // Not overriding, append.
         vtable->Set(actual_count, local_method);
         local_method->SetMethodIndex(actual_count);
+        vtable_index.Insert(local_mh.GetName(), actual_count);
         actual_count += 1;
       }
     }
@@ -3590,6 +3806,20 @@ bool ClassLinker::LinkInterfaceMethods(SirtRef<mirror::Class>& klass,
   std::vector<mirror::ArtMethod*> miranda_list;
   MethodHelper vtable_mh(NULL, this);
   MethodHelper interface_mh(NULL, this);
+  // The vtable doesn't change until the miranda methods are appended below.
+  mirror::ObjectArray<mirror::ArtMethod>* linking_vtable = klass->GetVTableDuringLinking();
+  size_t num_interface_methods = 0;
+  for (size_t i = 0; i < ifcount; ++i) {
+    num_interface_methods += iftable->GetInterface(i)->NumVirtualMethods();
+  }
+  LinkMethodIndex vtable_index(num_interface_methods == 0 ? 0 : linking_vtable->GetLength());
+  if (num_interface_methods != 0) {
+    for (int32_t k = 0; k < linking_vtable->GetLength(); ++k) {
+      vtable_mh.ChangeMethod(linking_vtable->Get(k));
+      vtable_index.Insert(vtable_mh.GetName(), k);
+    }
+  }
+  LinkMethodIndex miranda_index(num_interface_methods);
   for (size_t i = 0; i < ifcount; ++i) {
     mirror::Class* interface = iftable->GetInterface(i);
     size_t num_methods = interface->NumVirtualMethods();
@@ -3601,11 +3831,10 @@ bool ClassLinker::LinkInterfaceMethods(SirtRef<mirror::Class>& klass,
         return false;
       }
       iftable->SetMethodArray(i, method_array);
-      mirror::ObjectArray<mirror::ArtMethod>* vtable = klass->GetVTableDuringLinking();
       for (size_t j = 0; j < num_methods; ++j) {
         mirror::ArtMethod* interface_method = interface->GetVirtualMethod(j);
         interface_mh.ChangeMethod(interface_method);
-        int32_t k;
+        int32_t k = -1;
         // For each method listed in the interface's method list, find the
         // matching method in our class's method list.  We want to favor the
         // subclass over the superclass, which just requires walking
@@ -3614,26 +3843,31 @@ bool ClassLinker::LinkInterfaceMethods(SirtRef<mirror::Class>& klass,
         // it -- otherwise it would use the same vtable slot.  In .dex files
         // those don't end up in the virtual method table, so it shouldn't
         // matter which direction we go.  We walk it backward anyway.)
-        for (k = vtable->GetLength() - 1; k >= 0; --k) {
-          mirror::ArtMethod* vtable_method = vtable->Get(k);
-          vtable_mh.ChangeMethod(vtable_method);
+        // The candidates come in increasing vtable order, so keep the last match.
+        LinkMethodIndex::Iterator it(vtable_index, interface_mh.GetName());
+        uint32_t candidate;
+        while ((candidate = it.Next()) != LinkMethodIndex::kNoIndex) {
+          vtable_mh.ChangeMethod(linking_vtable->Get(candidate));
           if (interface_mh.HasSameNameAndSignature(&vtable_mh)) {
-            if (!vtable_method->IsAbstract() && !vtable_method->IsPublic()) {
-              ThrowIllegalAccessError(klass.get(),
-                                      "Method '%s' implementing interface method '%s' is not public",
-                                      PrettyMethod(vtable_method).c_str(),
-                                      PrettyMethod(interface_method).c_str());
-              return false;
-            }
-            method_array->Set(j, vtable_method);
-            break;
+            k = candidate;
           }
         }
-        if (k < 0) {
+        if (k >= 0) {
+          mirror::ArtMethod* vtable_method = linking_vtable->Get(k);
+          if (!vtable_method->IsAbstract() && !vtable_method->IsPublic()) {
+            ThrowIllegalAccessError(klass.get(),
+                                    "Method '%s' implementing interface method '%s' is not public",
+                                    PrettyMethod(vtable_method).c_str(),
+                                    PrettyMethod(interface_method).c_str());
+            return false;
+          }
+          method_array->Set(j, vtable_method);
+        } else {
           SirtRef<mirror::ArtMethod> miranda_method(self, NULL);
-          for (size_t mir = 0; mir < miranda_list.size(); mir++) {
-            mirror::ArtMethod* mir_method = miranda_list[mir];
-            vtable_mh.ChangeMethod(mir_method);
+          LinkMethodIndex::Iterator mir_it(miranda_index, interface_mh.GetName());
+          uint32_t mir;
+          while ((mir = mir_it.Next()) != LinkMethodIndex::kNoIndex) {
+            vtable_mh.ChangeMethod(miranda_list[mir]);
             if (interface_mh.HasSameNameAndSignature(&vtable_mh)) {
               miranda_method.reset(miranda_list[mir]);
               break;
@@ -3650,6 +3884,7 @@ bool ClassLinker::LinkInterfaceMethods(SirtRef<mirror::Class>& klass,
             // TODO: If a methods move then the miranda_list may hold stale references.
             UNIMPLEMENTED(FATAL);
 #endif
+            miranda_index.Insert(interface_mh.GetName(), miranda_list.size());
             miranda_list.push_back(miranda_method.get());
           }
           method_array->Set(j, miranda_method.get());
@@ -3694,6 +3929,10 @@ bool ClassLinker::LinkInterfaceMethods(SirtRef<mirror::Class>& klass,
     klass->SetVTable(vtable.get());
   }
 
+  if (num_interface_methods != 0 && !LinkImTable(klass)) {
+    return false;
+  }
+
   mirror::ObjectArray<mirror::ArtMethod>* vtable = klass->GetVTableDuringLinking();
   for (int i = 0; i < vtable->GetLength(); ++i) {
     CHECK(vtable->Get(i) != NULL);
@@ -3704,6 +3943,69 @@ bool ClassLinker::LinkInterfaceMethods(SirtRef<mirror::Class>& klass,
   return true;
 }
 
+bool ClassLinker::LinkImTable(SirtRef<mirror::Class>& klass) {
+  const size_t imt_length = mirror::Class::kImtSize * 2;
+  std::vector<mirror::ArtMethod*> imt(imt_length, NULL);
+  std::vector<bool> conflicts(mirror::Class::kImtSize, false);
+  mirror::IfTable* iftable = klass->GetIfTable();
+  for (int32_t i = 0; i < klass->GetIfTableCount(); ++i) {
+    mirror::Class* interface = iftable->GetInterface(i);
+    size_t num_methods = interface->NumVirtualMethods();
+    for (size_t j = 0; j < num_methods; ++j) {
+      mirror::ArtMethod* interface_method = interface->GetVirtualMethod(j);
+      size_t slot = mirror::Class::ImTableIndex(interface_method);
+      if (conflicts[slot]) {
+        continue;
+      }
+      if (imt[slot * 2] == NULL) {
+        imt[slot * 2] = interface_method;
+        imt[slot * 2 + 1] = iftable->GetMethodArray(i)->Get(j);
+      } else {
+        // More than one interface method maps to this slot, leave them to the iftable search.
+        conflicts[slot] = true;
+        imt[slot * 2] = NULL;
+        imt[slot * 2 + 1] = NULL;
+      }
+    }
+  }
+  bool empty = true;
+  for (size_t i = 0; i < imt_length && empty; i += 2) {
+    empty = imt[i] == NULL;
+  }
+  if (empty) {
+    return true;
+  }
+  // A subclass that doesn't implement any interface method itself shares its superclass's table.
+  if (klass->HasSuperClass()) {
+    mirror::ObjectArray<mirror::ArtMethod>* super_imtable = klass->GetSuperClass()->GetImTable();
+    if (super_imtable != NULL) {
+      bool same = true;
+      for (size_t i = 0; i < imt_length && same; ++i) {
+        same = super_imtable->Get(i) == imt[i];
+      }
+      if (same) {
+        klass->SetImTable(super_imtable);
+        return true;
+      }
+    }
+  }
+  Thread* self = Thread::Current();
+#ifdef MOVING_GARBAGE_COLLECTOR
+  // TODO: If methods move then imt may hold stale references.
+  UNIMPLEMENTED(FATAL);
+#endif
+  mirror::ObjectArray<mirror::ArtMethod>* imtable = AllocArtMethodArray(self, imt_length);
+  if (UNLIKELY(imtable == NULL)) {
+    CHECK(self->IsExceptionPending());  // OOME.
+    return false;
+  }
+  for (size_t i = 0; i < imt_length; ++i) {
+    imtable->Set(i, imt[i]);
+  }
+  klass->SetImTable(imtable);
+  return true;
+}
+
 bool ClassLinker::LinkInstanceFields(SirtRef<mirror::Class>& klass) {
   CHECK(klass.get() != NULL);
   return LinkFields(klass, false);
@@ -4225,17 +4527,13 @@ const char* ClassLinker::MethodShorty(uint32_t method_idx, mirror::ArtMethod* re
 }
 
 void ClassLinker::DumpAllClasses(int flags) {
-  if (dex_cache_image_class_lookup_required_) {
-    MoveImageClassesToClassTable();
-  }
   // TODO: at the time this was written, it wasn't safe to call PrettyField with the ClassLinker
   // lock held, because it might need to resolve a field's type, which would try to take the lock.
   std::vector<mirror::Class*> all_classes;
   {
     ReaderMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
-    for (const std::pair<size_t, mirror::Class*>& it : class_table_) {
-      all_classes.push_back(it.second);
-    }
+    std::vector<uint32_t> hashes;
+    class_table_.GetEntries(&all_classes, &hashes);
   }
 
   for (size_t i = 0; i < all_classes.size(); ++i) {
@@ -4244,19 +4542,123 @@ void ClassLinker::DumpAllClasses(int flags) {
 }
 
 void ClassLinker::DumpForSigQuit(std::ostream& os) {
-  if (dex_cache_image_class_lookup_required_) {
-    MoveImageClassesToClassTable();
+  {
+    ReaderMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
+    os << "Loaded classes: " << class_table_.Size() << " allocated classes\n";
+  }
+  DumpDexCacheOccupancy(os);
+  if (class_load_timing_enabled_) {
+    DumpClassLoadTimings(os);
   }
-  ReaderMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
-  os << "Loaded classes: " << class_table_.size() << " allocated classes\n";
 }
 
-size_t ClassLinker::NumLoadedClasses() {
-  if (dex_cache_image_class_lookup_required_) {
-    MoveImageClassesToClassTable();
+template <typename T>
+static size_t CountResolvedEntries(const mirror::ObjectArray<T>* entries, const T* unresolved)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  size_t resolved = 0;
+  for (int32_t i = 0; i < entries->GetLength(); ++i) {
+    if (entries->Get(i) != unresolved) {
+      ++resolved;
+    }
   }
+  return resolved;
+}
+
+void ClassLinker::DumpDexCacheOccupancy(std::ostream& os) {
+  const mirror::ArtMethod* resolution_method = Runtime::Current()->GetResolutionMethod();
+  size_t num_entries = 0;
+  size_t num_resolved = 0;
+  size_t num_dex_caches;
+  {
+    ReaderMutexLock mu(Thread::Current(), dex_lock_);
+    num_dex_caches = dex_caches_.size();
+    for (size_t i = 0; i != dex_caches_.size(); ++i) {
+      const mirror::DexCache* dex_cache = dex_caches_[i];
+      num_entries += dex_cache->NumStrings() + dex_cache->NumResolvedTypes() +
+          dex_cache->NumResolvedMethods() + dex_cache->NumResolvedFields() +
+          dex_cache->NumInitializedStaticStorage();
+      num_resolved += CountResolvedEntries<mirror::String>(dex_cache->GetStrings(), NULL);
+      num_resolved += CountResolvedEntries<mirror::Class>(dex_cache->GetResolvedTypes(), NULL);
+      num_resolved += CountResolvedEntries(dex_cache->GetResolvedMethods(), resolution_method);
+      num_resolved += CountResolvedEntries<mirror::ArtField>(dex_cache->GetResolvedFields(), NULL);
+      num_resolved += CountResolvedEntries<mirror::StaticStorageBase>(
+          dex_cache->GetInitializedStaticStorage(), NULL);
+    }
+  }
+  os << "Dex caches: " << num_dex_caches << " dex files, " << num_resolved << " of "
+     << num_entries << " entries resolved, "
+     << PrettySize(num_entries * sizeof(mirror::Object*)) << " of entry arrays\n";
+}
+
+void ClassLinker::AddClassLoadTime(const mirror::ClassLoader* class_loader, const char* phase,
+                                   uint64_t start_ns) {
+  const uint64_t delta_ns = NanoTime() - start_ns;
+  Thread* self = Thread::Current();
+  CumulativeLogger* timings = NULL;
+  {
+    MutexLock mu(self, class_load_timings_lock_);
+    auto it = class_load_timings_.find(class_loader);
+    if (it != class_load_timings_.end()) {
+      timings = it->second;
+    }
+  }
+  if (timings == NULL) {
+    // Creating the logger takes its lock, which must not nest inside ours.
+    std::string name(class_loader == NULL ? "boot class loader"
+                                          : StringPrintf("%s %p",
+                                                         PrettyTypeOf(class_loader).c_str(),
+                                                         class_loader));
+    CumulativeLogger* new_timings = new CumulativeLogger(name);
+    MutexLock mu(self, class_load_timings_lock_);
+    auto it = class_load_timings_.find(class_loader);
+    if (it != class_load_timings_.end()) {
+      timings = it->second;
+      delete new_timings;
+    } else {
+      class_load_timings_.Put(class_loader, new_timings);
+      timings = new_timings;
+    }
+  }
+  timings->AddSplit(phase, delta_ns);
+}
+
+void ClassLinker::DumpClassLoadTimings(std::ostream& os) {
+  std::vector<CumulativeLogger*> timings;
+  {
+    MutexLock mu(Thread::Current(), class_load_timings_lock_);
+    for (const auto& entry : class_load_timings_) {
+      timings.push_back(entry.second);
+    }
+  }
+  // Loggers are never deleted before the class linker, so they can be dumped without our lock.
+  os << "Class load timings:\n";
+  for (CumulativeLogger* logger : timings) {
+    logger->Dump(os);
+  }
+}
+
+ScopedClassLoadTimer::ScopedClassLoadTimer(ClassLinker* class_linker,
+                                           const mirror::ClassLoader* class_loader,
+                                           const char* phase)
+    : class_linker_(class_linker), class_loader_(class_loader), phase_(phase),
+      start_ns_(class_linker->IsClassLoadTimingEnabled() ? NanoTime() : 0) {
+}
+
+ScopedClassLoadTimer::~ScopedClassLoadTimer() {
+  if (start_ns_ != 0) {
+    class_linker_->AddClassLoadTime(class_loader_, phase_, start_ns_);
+  }
+}
+
+size_t ClassLinker::NumLoadedClasses() {
+  ReaderMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
+  return class_table_.Size();
+}
+
+void ClassLinker::GetClassTableEntries(std::vector<mirror::Class*>* classes,
+                                       std::vector<uint32_t>* hashes) {
   ReaderMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
-  return class_table_.size();
+  class_table_.GetEntries(classes, hashes);
 }
 
 pid_t ClassLinker::GetClassesLockOwner() {
@@ -23,10 +23,13 @@
 
 #include "base/macros.h"
 #include "base/mutex.h"
+#include "class_table.h"
 #include "dex_file.h"
 #include "gtest/gtest.h"
 #include "root_visitor.h"
 #include "oat_file.h"
+#include "safe_map.h"
+#include "UniquePtr.h"
 
 namespace art {
 namespace gc {
@@ -43,11 +46,12 @@ namespace mirror {
   class StackTraceElement;
 }  // namespace mirror
 
+class CumulativeLogger;
 class InternTable;
 class ObjectLock;
 template<class T> class SirtRef;
-
-typedef bool (ClassVisitor)(mirror::Class* c, void* arg);
+class StringPiece;
+class ThreadPool;
 
 class ClassLinker {
  public:
@@ -72,6 +76,46 @@ class ClassLinker {
   mirror::Class* FindSystemClass(const char* descriptor)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Queues classes to be loaded and linked, but not initialized, by the prelink threads while the
+  // caller carries on, so that the classes are ready by the time the caller needs them. Does
+  // nothing unless there are prelink threads. Classes that fail to load are left for the thread
+  // which needs them to report.
+  void PrelinkClasses(JNIEnv* env, jobject class_loader,
+                      const std::vector<std::string>& descriptors)
+      LOCKS_EXCLUDED(Locks::mutator_lock_);
+
+  // Sets the number of threads which PrelinkClasses hands classes to, none if thread_count is 0.
+  // The threads are started by the first PrelinkClasses call.
+  void SetPrelinkThreadCount(size_t thread_count) {
+    prelink_thread_count_ = thread_count;
+  }
+
+  // Abandons the classes still queued for prelinking and stops the threads.
+  void DeletePrelinkThreadPool();
+
+  // When enabled with -XX:LazyDirectMethods, LoadClass leaves the direct methods of classes from
+  // app class loaders unallocated until they are first looked up. The static methods are loaded
+  // when the class is initialized.
+  void SetLazyDirectMethodsEnabled(bool enabled) {
+    lazy_direct_methods_enabled_ = enabled;
+  }
+
+  // Loads the direct method at the given index of a class with lazy direct methods, or returns
+  // the method if another thread loaded it first. Returns NULL with an OutOfMemoryError pending
+  // if the method can't be allocated.
+  mirror::ArtMethod* LoadLazyDirectMethod(mirror::Class* klass, size_t index)
+      LOCKS_EXCLUDED(lazy_direct_methods_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Finds a declared direct method of a class with lazy direct methods, loading only the match.
+  mirror::ArtMethod* FindLazyDirectMethod(mirror::Class* klass, const StringPiece& name,
+                                          const StringPiece& signature)
+      LOCKS_EXCLUDED(lazy_direct_methods_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  mirror::ArtMethod* FindLazyDirectMethod(mirror::Class* klass, uint32_t dex_method_idx)
+      LOCKS_EXCLUDED(lazy_direct_methods_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   // Define a new a class based on a ClassDef from a DexFile
   mirror::Class* DefineClass(const char* descriptor, mirror::ClassLoader* class_loader,
                              const DexFile& dex_file, const DexFile::ClassDef& dex_class_def)
@@ -104,10 +148,38 @@ class ClassLinker {
       LOCKS_EXCLUDED(Locks::classlinker_classes_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Prints how many of the dex cache entries are resolved and the size of the entry arrays.
+  void DumpDexCacheOccupancy(std::ostream& os)
+      LOCKS_EXCLUDED(dex_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   size_t NumLoadedClasses()
       LOCKS_EXCLUDED(Locks::classlinker_classes_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Class load timing records how long each phase of class loading takes, per class loader. Off
+  // unless enabled with -XX:ClassLoadTiming.
+  void SetClassLoadTimingEnabled(bool enabled) {
+    class_load_timing_enabled_ = enabled;
+  }
+
+  bool IsClassLoadTimingEnabled() const {
+    return class_load_timing_enabled_;
+  }
+
+  // Records the time since start_ns against the given phase of the class loader.
+  void AddClassLoadTime(const mirror::ClassLoader* class_loader, const char* phase,
+                        uint64_t start_ns)
+      LOCKS_EXCLUDED(class_load_timings_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  void DumpClassLoadTimings(std::ostream& os) LOCKS_EXCLUDED(class_load_timings_lock_);
+
+  // Returns the loaded classes and their descriptor hashes, for the image writer to serialize
+  // the class table.
+  void GetClassTableEntries(std::vector<mirror::Class*>* classes, std::vector<uint32_t>* hashes)
+      LOCKS_EXCLUDED(Locks::classlinker_classes_lock_);
+
   // Resolve a String with the given index from the DexFile, storing the
   // result in the DexCache. The referrer is used to identify the
   // target DexCache and ClassLoader to use for resolution.
@@ -307,12 +379,17 @@ class ClassLinker {
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   void VerifyClass(mirror::Class* klass) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Sets methods_to_verify to the methods that need runtime verification, see
+  // OatFile::OatClass::GetMethodsToVerify, when the class has to be verified again.
   bool VerifyClassUsingOatFile(const DexFile& dex_file, mirror::Class* klass,
-                               mirror::Class::Status& oat_file_class_status)
+                               mirror::Class::Status& oat_file_class_status,
+                               const uint32_t*& methods_to_verify)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   void ResolveClassExceptionHandlerTypes(const DexFile& dex_file, mirror::Class* klass)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
-  void ResolveMethodExceptionHandlerTypes(const DexFile& dex_file, mirror::ArtMethod* klass)
+  void ResolveMethodExceptionHandlerTypes(const DexFile& dex_file,
+                                          const DexFile::CodeItem* code_item,
+                                          const mirror::Class* klass)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   mirror::Class* CreateProxyClass(mirror::String* name, mirror::ObjectArray<mirror::Class>* interfaces,
@@ -424,8 +501,20 @@ class ClassLinker {
                                 SirtRef<mirror::Class>& klass)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Loads the lazy direct method it points at, the iterator must be at the index-th direct method.
+  mirror::ArtMethod* LoadLazyDirectMethod(mirror::Class* klass, const DexFile& dex_file,
+                                          const ClassDataItemIterator& it, size_t index)
+      LOCKS_EXCLUDED(lazy_direct_methods_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   void FixupStaticTrampolines(mirror::Class* klass) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Puts the direct methods of a newly defined class in the dex cache when its oat file was
+  // compiled with relative calls, see OatHeader::HasRelativeCalls.
+  void ResolveRelativeCallTargets(const DexFile& dex_file, mirror::Class* klass)
+      LOCKS_EXCLUDED(dex_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   // Finds the associated oat class for a dex_file and descriptor
   const OatFile::OatClass* GetOatClass(const DexFile& dex_file, uint16_t class_def_idx)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -473,6 +562,10 @@ class ClassLinker {
                             mirror::ObjectArray<mirror::Class>* interfaces)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Fills in the interface method table of a class from its iftable.
+  bool LinkImTable(SirtRef<mirror::Class>& klass)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   bool LinkStaticFields(SirtRef<mirror::Class>& klass)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   bool LinkInstanceFields(SirtRef<mirror::Class>& klass)
@@ -528,27 +621,29 @@ class ClassLinker {
   std::vector<const OatFile*> oat_files_ GUARDED_BY(dex_lock_);
 
 
-  // multimap from a string hash code of a class descriptor to
-  // mirror::Class* instances. Results should be compared for a matching
-  // Class::descriptor_ and Class::class_loader_.
-  typedef std::multimap<size_t, mirror::Class*> Table;
-  Table class_table_ GUARDED_BY(Locks::classlinker_classes_lock_);
+  // Hash set of the loaded classes keyed by the hash of their descriptor. Lookups are lock free,
+  // modifications hold the classlinker_classes_lock_. The image classes are inserted with their
+  // serialized hashes when initializing from an image.
+  ClassTable class_table_;
 
-  // Do we need to search dex caches to find image classes?
-  bool dex_cache_image_class_lookup_required_;
-  // Number of times we've searched dex caches for a class. After a certain number of misses we move
-  // the classes into the class_table_ to avoid dex cache based searches.
-  AtomicInteger failed_dex_cache_class_lookups_;
+  // Threads which load the classes given to PrelinkClasses, NULL until the first call and when
+  // prelinking is disabled. Installed under prelink_lock_.
+  size_t prelink_thread_count_;
+  Mutex prelink_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  UniquePtr<ThreadPool> prelink_thread_pool_;
+  // Set to make queued prelink tasks return without loading anything.
+  volatile bool prelink_cancelled_;
 
-  mirror::Class* LookupClassFromTableLocked(const char* descriptor,
-                                            const mirror::ClassLoader* class_loader,
-                                            size_t hash)
-      SHARED_LOCKS_REQUIRED(Locks::classlinker_classes_lock_, Locks::mutator_lock_);
+  bool lazy_direct_methods_enabled_;
+  // Serializes the publication of lazy direct methods so that each gets a single ArtMethod.
+  Mutex lazy_direct_methods_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
 
-  void MoveImageClassesToClassTable() LOCKS_EXCLUDED(Locks::classlinker_classes_lock_)
-      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
-  mirror::Class* LookupClassFromImage(const char* descriptor)
-      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  bool class_load_timing_enabled_;
+  Mutex class_load_timings_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  // Keyed by class loader, NULL for the boot class loader. The timings of collected class loaders
+  // are kept.
+  SafeMap<const mirror::ClassLoader*, CumulativeLogger*> class_load_timings_
+      GUARDED_BY(class_load_timings_lock_);
 
   // indexes into class_roots_.
   // needs to be kept in sync with class_roots_descriptors_.
@@ -629,6 +724,23 @@ class ClassLinker {
   DISALLOW_COPY_AND_ASSIGN(ClassLinker);
 };
 
+// Records the time spent in its scope against a class loading phase if class load timing is
+// enabled. Phases include the time spent loading other classes from within them.
+class ScopedClassLoadTimer {
+ public:
+  ScopedClassLoadTimer(ClassLinker* class_linker, const mirror::ClassLoader* class_loader,
+                       const char* phase);
+  ~ScopedClassLoadTimer() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+ private:
+  ClassLinker* const class_linker_;
+  const mirror::ClassLoader* const class_loader_;
+  const char* const phase_;
+  const uint64_t start_ns_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedClassLoadTimer);
+};
+
 }  // namespace art
 
 #endif  // ART_RUNTIME_CLASS_LINKER_H_
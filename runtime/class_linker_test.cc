@@ -223,6 +223,22 @@ class ClassLinkerTest : public CommonTest {
         EXPECT_EQ(interface->NumVirtualMethods(), iftable->GetMethodArrayCount(i));
       }
     }
+    const mirror::ObjectArray<mirror::ArtMethod>* imtable = klass->GetImTable();
+    if (klass->IsInterface()) {
+      EXPECT_TRUE(imtable == NULL);
+    } else if (imtable != NULL) {
+      ASSERT_EQ(static_cast<int32_t>(mirror::Class::kImtSize * 2), imtable->GetLength());
+      for (int i = 0; i < klass->GetIfTableCount(); i++) {
+        mirror::Class* interface = iftable->GetInterface(i);
+        for (size_t j = 0; j < interface->NumVirtualMethods(); j++) {
+          mirror::ArtMethod* interface_method = interface->GetVirtualMethod(j);
+          size_t slot = mirror::Class::ImTableIndex(interface_method) * 2;
+          if (imtable->Get(slot) == interface_method) {
+            EXPECT_EQ(iftable->GetMethodArray(i)->Get(j), imtable->Get(slot + 1));
+          }
+        }
+      }
+    }
     if (klass->IsAbstract()) {
       EXPECT_FALSE(klass->IsFinal());
     } else {
@@ -496,6 +512,7 @@ struct ClassOffsets : public CheckOffsets<mirror::Class> {
     offsets.push_back(CheckOffset(OFFSETOF_MEMBER(mirror::Class, direct_methods_),                "directMethods"));
     offsets.push_back(CheckOffset(OFFSETOF_MEMBER(mirror::Class, ifields_),                       "iFields"));
     offsets.push_back(CheckOffset(OFFSETOF_MEMBER(mirror::Class, iftable_),                       "ifTable"));
+    offsets.push_back(CheckOffset(OFFSETOF_MEMBER(mirror::Class, imtable_),                       "imTable"));
     offsets.push_back(CheckOffset(OFFSETOF_MEMBER(mirror::Class, name_),                          "name"));
     offsets.push_back(CheckOffset(OFFSETOF_MEMBER(mirror::Class, sfields_),                       "sFields"));
     offsets.push_back(CheckOffset(OFFSETOF_MEMBER(mirror::Class, super_class_),                   "superClass"));
@@ -1044,6 +1061,30 @@ TEST_F(ClassLinkerTest, FinalizableBit) {
   EXPECT_TRUE(c->IsFinalizable());
 }
 
+TEST_F(ClassLinkerTest, Intrinsics) {
+  ScopedObjectAccess soa(Thread::Current());
+  mirror::Class* string = class_linker_->FindSystemClass("Ljava/lang/String;");
+  mirror::ArtMethod* m = string->FindDeclaredVirtualMethod("charAt", "(I)C");
+  ASSERT_TRUE(m != NULL);
+  ASSERT_TRUE(m->IsIntrinsic());
+  EXPECT_EQ(kIntrinsicStringCharAt, m->GetIntrinsic());
+  EXPECT_TRUE(m->IsPublic());
+  m = string->FindDeclaredVirtualMethod("indexOf", "(II)I");
+  ASSERT_TRUE(m != NULL);
+  ASSERT_TRUE(m->IsIntrinsic());
+  EXPECT_EQ(kIntrinsicStringIndexOfFrom, m->GetIntrinsic());
+  m = string->FindDeclaredVirtualMethod("hashCode", "()I");
+  ASSERT_TRUE(m != NULL);
+  EXPECT_FALSE(m->IsIntrinsic());
+
+  mirror::Class* math = class_linker_->FindSystemClass("Ljava/lang/Math;");
+  m = math->FindDeclaredDirectMethod("abs", "(J)J");
+  ASSERT_TRUE(m != NULL);
+  ASSERT_TRUE(m->IsIntrinsic());
+  EXPECT_EQ(kIntrinsicAbsLong, m->GetIntrinsic());
+  EXPECT_TRUE(m->IsStatic());
+}
+
 TEST_F(ClassLinkerTest, ClassRootDescriptors) {
   ScopedObjectAccess soa(Thread::Current());
   ClassHelper kh;
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "class_table.h"
+
+#include <string.h>
+
+#include "base/stl_util.h"
+#include "cutils/atomic-inline.h"
+#include "mirror/class-inl.h"
+#include "object_utils.h"
+#include "utils.h"
+
+namespace art {
+
+static const size_t kMinClassTableCapacity = 256;
+
+ClassTable::Slots::Slots(size_t capacity) : mask(capacity - 1), slots(capacity) {
+  DCHECK(IsPowerOfTwo(capacity));
+  for (Slot& slot : slots) {
+    slot.hash = 0;
+    slot.klass = NULL;
+  }
+}
+
+ClassTable::ClassTable()
+    : slots_(new Slots(kMinClassTableCapacity)), num_classes_(0), num_removed_(0) {
+}
+
+ClassTable::~ClassTable() {
+  delete slots_;
+  STLDeleteElements(&retired_slots_);
+}
+
+mirror::Class* ClassTable::Lookup(const char* descriptor, const mirror::ClassLoader* class_loader,
+                                  uint32_t hash) const {
+  const Slots* slots = slots_;
+  ClassHelper kh;
+  // The table is never full, so the probe always ends on an unused slot.
+  for (size_t i = hash & slots->mask; ; i = (i + 1) & slots->mask) {
+    const Slot& slot = slots->slots[i];
+    mirror::Class* klass = slot.klass;
+    if (klass == NULL) {
+      return NULL;
+    }
+    if (!IsClass(klass)) {
+      continue;
+    }
+    // Pairs with the barrier in InsertInto, the hash must not be read before the class.
+    android_memory_barrier();
+    if (slot.hash == hash && klass->GetClassLoader() == class_loader) {
+      kh.ChangeClass(klass);
+      if (strcmp(descriptor, kh.GetDescriptor()) == 0) {
+        return klass;
+      }
+    }
+  }
+}
+
+void ClassTable::LookupAll(const char* descriptor, uint32_t hash,
+                           std::vector<mirror::Class*>* classes) const {
+  const Slots* slots = slots_;
+  ClassHelper kh;
+  for (size_t i = hash & slots->mask; ; i = (i + 1) & slots->mask) {
+    const Slot& slot = slots->slots[i];
+    mirror::Class* klass = slot.klass;
+    if (klass == NULL) {
+      return;
+    }
+    if (!IsClass(klass)) {
+      continue;
+    }
+    android_memory_barrier();
+    if (slot.hash == hash) {
+      kh.ChangeClass(klass);
+      if (strcmp(descriptor, kh.GetDescriptor()) == 0) {
+        classes->push_back(klass);
+      }
+    }
+  }
+}
+
+void ClassTable::InsertInto(Slots* slots, mirror::Class* klass, uint32_t hash) {
+  for (size_t i = hash & slots->mask; ; i = (i + 1) & slots->mask) {
+    Slot& slot = slots->slots[i];
+    if (slot.klass == NULL) {
+      slot.hash = hash;
+      // A reader which finds the class must also find its hash.
+      android_memory_barrier();
+      slot.klass = klass;
+      return;
+    }
+  }
+}
+
+void ClassTable::Insert(mirror::Class* klass, uint32_t hash) {
+  DCHECK(IsClass(klass));
+  // Tombstones lengthen probes just like classes, so they count towards the load.
+  if ((num_classes_ + num_removed_ + 1) * 4 > slots_->slots.size() * 3) {
+    Resize((num_classes_ + 1) * 2);
+  }
+  InsertInto(slots_, klass, hash);
+  ++num_classes_;
+}
+
+bool ClassTable::Remove(const char* descriptor, const mirror::ClassLoader* class_loader,
+                        uint32_t hash) {
+  Slots* slots = slots_;
+  ClassHelper kh;
+  for (size_t i = hash & slots->mask; ; i = (i + 1) & slots->mask) {
+    Slot& slot = slots->slots[i];
+    mirror::Class* klass = slot.klass;
+    if (klass == NULL) {
+      return false;
+    }
+    if (IsClass(klass) && slot.hash == hash && klass->GetClassLoader() == class_loader) {
+      kh.ChangeClass(klass);
+      if (strcmp(descriptor, kh.GetDescriptor()) == 0) {
+        // Readers only stop at unused slots, so the tombstone keeps later classes reachable.
+        slot.klass = reinterpret_cast<mirror::Class*>(kRemovedClass);
+        --num_classes_;
+        ++num_removed_;
+        return true;
+      }
+    }
+  }
+}
+
+void ClassTable::Reserve(size_t count) {
+  if ((count + num_removed_) * 4 > slots_->slots.size() * 3) {
+    Resize(count);
+  }
+}
+
+void ClassTable::Resize(size_t count) {
+  size_t capacity = kMinClassTableCapacity;
+  while (capacity * 3 < count * 4 + 4) {
+    capacity *= 2;
+  }
+  Slots* old_slots = slots_;
+  Slots* new_slots = new Slots(capacity);
+  for (const Slot& slot : old_slots->slots) {
+    if (IsClass(slot.klass)) {
+      InsertInto(new_slots, slot.klass, slot.hash);
+    }
+  }
+  // Publish the new array only once all of its slots are visible.
+  android_memory_barrier();
+  slots_ = new_slots;
+  retired_slots_.push_back(old_slots);
+  num_removed_ = 0;
+}
+
+void ClassTable::VisitRoots(RootVisitor* visitor, void* arg) const {
+  for (const Slot& slot : slots_->slots) {
+    if (IsClass(slot.klass)) {
+      visitor(slot.klass, arg);
+    }
+  }
+}
+
+bool ClassTable::Visit(ClassVisitor* visitor, void* arg) const {
+  for (const Slot& slot : slots_->slots) {
+    if (IsClass(slot.klass) && !visitor(slot.klass, arg)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void ClassTable::GetEntries(std::vector<mirror::Class*>* classes,
+                            std::vector<uint32_t>* hashes) const {
+  for (const Slot& slot : slots_->slots) {
+    if (IsClass(slot.klass)) {
+      classes->push_back(slot.klass);
+      hashes->push_back(slot.hash);
+    }
+  }
+}
+
+}  // namespace art
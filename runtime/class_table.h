@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_CLASS_TABLE_H_
+#define ART_RUNTIME_CLASS_TABLE_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "base/macros.h"
+#include "locks.h"
+#include "root_visitor.h"
+
+namespace art {
+
+namespace mirror {
+  class Class;
+  class ClassLoader;
+}  // namespace mirror
+
+typedef bool (ClassVisitor)(mirror::Class* c, void* arg);
+
+// Open addressing hash set of classes keyed by the hash of their descriptor, see
+// ClassLinker::Hash. Lookups are lock free, modifications must hold classlinker_classes_lock_
+// exclusively. A lookup racing with an insertion may miss the new class, callers that need to
+// know for sure look again with the lock held.
+//
+// Growing publishes a new slot array rather than rehashing in place. The old arrays are kept
+// until the table is destroyed since a reader may still be probing them, they add up to less
+// than the current array. Removed classes leave a tombstone which is dropped on the next growth.
+class ClassTable {
+ public:
+  ClassTable();
+  ~ClassTable();
+
+  mirror::Class* Lookup(const char* descriptor, const mirror::ClassLoader* class_loader,
+                        uint32_t hash) const
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Finds the classes with the given descriptor for any class loader.
+  void LookupAll(const char* descriptor, uint32_t hash, std::vector<mirror::Class*>* classes) const
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // The caller must make sure that the class is not already in the table.
+  void Insert(mirror::Class* klass, uint32_t hash)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::classlinker_classes_lock_);
+
+  bool Remove(const char* descriptor, const mirror::ClassLoader* class_loader, uint32_t hash)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::classlinker_classes_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Makes room for count classes in total so that inserting them doesn't grow the table.
+  void Reserve(size_t count) EXCLUSIVE_LOCKS_REQUIRED(Locks::classlinker_classes_lock_);
+
+  size_t Size() const {
+    return num_classes_;
+  }
+
+  void VisitRoots(RootVisitor* visitor, void* arg) const;
+
+  // Stops early and returns false if the visitor returns false.
+  bool Visit(ClassVisitor* visitor, void* arg) const;
+
+  // Appends every class along with its descriptor hash, used to serialize the table in the image.
+  void GetEntries(std::vector<mirror::Class*>* classes, std::vector<uint32_t>* hashes) const;
+
+ private:
+  struct Slot {
+    uint32_t hash;
+    // NULL if the slot was never used, kRemovedClass if it holds a tombstone. Published after hash.
+    mirror::Class* volatile klass;
+  };
+
+  struct Slots {
+    explicit Slots(size_t capacity);
+
+    const size_t mask;
+    std::vector<Slot> slots;
+  };
+
+  static bool IsClass(const mirror::Class* klass) {
+    return klass != NULL && reinterpret_cast<uintptr_t>(klass) != kRemovedClass;
+  }
+
+  // Rehashes the live classes into a new array with room for at least count classes.
+  void Resize(size_t count) EXCLUSIVE_LOCKS_REQUIRED(Locks::classlinker_classes_lock_);
+
+  // Stores into the first unused slot of the probe sequence, without publishing any barrier.
+  static void InsertInto(Slots* slots, mirror::Class* klass, uint32_t hash);
+
+  static const uintptr_t kRemovedClass = 1;
+
+  // The array readers probe, replaced as a whole when the table grows.
+  Slots* volatile slots_;
+  std::vector<Slots*> retired_slots_ GUARDED_BY(Locks::classlinker_classes_lock_);
+  size_t num_classes_;
+  size_t num_removed_ GUARDED_BY(Locks::classlinker_classes_lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(ClassTable);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_CLASS_TABLE_H_
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "class_table.h"
+
+#include "common_test.h"
+#include "mirror/class-inl.h"
+
+namespace art {
+
+class ClassTableTest : public CommonTest {};
+
+TEST_F(ClassTableTest, InsertLookupRemove) {
+  ScopedObjectAccess soa(Thread::Current());
+  mirror::Class* object_class = class_linker_->FindSystemClass("Ljava/lang/Object;");
+  mirror::Class* string_class = class_linker_->FindSystemClass("Ljava/lang/String;");
+  mirror::Class* int_array_class = class_linker_->FindSystemClass("[I");
+  ASSERT_TRUE(object_class != NULL);
+  ASSERT_TRUE(string_class != NULL);
+  ASSERT_TRUE(int_array_class != NULL);
+
+  ClassTable table;
+  WriterMutexLock mu(soa.Self(), *Locks::classlinker_classes_lock_);
+  // Give the classes colliding hashes so that lookups have to probe past each other.
+  table.Insert(object_class, 7);
+  table.Insert(string_class, 7);
+  table.Insert(int_array_class, 8);
+  EXPECT_EQ(3U, table.Size());
+  EXPECT_EQ(object_class, table.Lookup("Ljava/lang/Object;", NULL, 7));
+  EXPECT_EQ(string_class, table.Lookup("Ljava/lang/String;", NULL, 7));
+  EXPECT_EQ(int_array_class, table.Lookup("[I", NULL, 8));
+  EXPECT_TRUE(table.Lookup("Ljava/lang/String;", NULL, 8) == NULL);
+  EXPECT_TRUE(table.Lookup("[J", NULL, 8) == NULL);
+
+  std::vector<mirror::Class*> classes;
+  table.LookupAll("Ljava/lang/String;", 7, &classes);
+  ASSERT_EQ(1U, classes.size());
+  EXPECT_EQ(string_class, classes[0]);
+
+  // Removing a class must not hide the classes probed after it.
+  EXPECT_TRUE(table.Remove("Ljava/lang/Object;", NULL, 7));
+  EXPECT_FALSE(table.Remove("Ljava/lang/Object;", NULL, 7));
+  EXPECT_EQ(2U, table.Size());
+  EXPECT_TRUE(table.Lookup("Ljava/lang/Object;", NULL, 7) == NULL);
+  EXPECT_EQ(string_class, table.Lookup("Ljava/lang/String;", NULL, 7));
+
+  // Growing rehashes the remaining classes.
+  table.Reserve(4096);
+  EXPECT_EQ(2U, table.Size());
+  EXPECT_EQ(string_class, table.Lookup("Ljava/lang/String;", NULL, 7));
+  EXPECT_EQ(int_array_class, table.Lookup("[I", NULL, 8));
+
+  std::vector<mirror::Class*> entries;
+  std::vector<uint32_t> hashes;
+  table.GetEntries(&entries, &hashes);
+  ASSERT_EQ(2U, entries.size());
+  ASSERT_EQ(2U, hashes.size());
+  for (size_t i = 0; i < entries.size(); ++i) {
+    EXPECT_EQ(entries[i] == string_class ? 7U : 8U, hashes[i]);
+  }
+}
+
+}  // namespace art
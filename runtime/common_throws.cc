@@ -330,9 +330,11 @@ void ThrowNullPointerExceptionFromDexPC(const ThrowLocation& throw_location) {
   const Instruction* instr = Instruction::At(&code->insns_[throw_dex_pc]);
   switch (instr->Opcode()) {
     case Instruction::INVOKE_DIRECT:
+    case Instruction::INVOKE_DIRECT_QUICK:
       ThrowNullPointerExceptionForMethodAccess(throw_location, instr->VRegB_35c(), kDirect);
       break;
     case Instruction::INVOKE_DIRECT_RANGE:
+    case Instruction::INVOKE_DIRECT_RANGE_QUICK:
       ThrowNullPointerExceptionForMethodAccess(throw_location, instr->VRegB_3rc(), kDirect);
       break;
     case Instruction::INVOKE_VIRTUAL:
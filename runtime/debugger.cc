@@ -87,6 +87,12 @@ struct Breakpoint {
   mirror::ArtMethod* method;
   uint32_t dex_pc;
   Breakpoint(mirror::ArtMethod* method, uint32_t dex_pc) : method(method), dex_pc(dex_pc) {}
+  bool operator<(const Breakpoint& rhs) const {
+    if (method != rhs.method) {
+      return method < rhs.method;
+    }
+    return dex_pc < rhs.dex_pc;
+  }
 };
 
 static std::ostream& operator<<(std::ostream& os, const Breakpoint& rhs)
@@ -190,21 +196,55 @@ static size_t gAllocRecordMax GUARDED_BY(gAllocTrackerLock) = 0;
 static size_t gAllocRecordHead GUARDED_BY(gAllocTrackerLock) = 0;
 static size_t gAllocRecordCount GUARDED_BY(gAllocTrackerLock) = 0;
 
-// Breakpoints and single-stepping.
-static std::vector<Breakpoint> gBreakpoints GUARDED_BY(Locks::breakpoint_lock_);
+// Breakpoints and single-stepping. The breakpoints are sorted by method and dex pc as they are
+// looked up for every instruction interpreted while a debugger is attached.
+static std::multiset<Breakpoint> gBreakpoints GUARDED_BY(Locks::breakpoint_lock_);
 static SingleStepControl gSingleStepControl GUARDED_BY(Locks::breakpoint_lock_);
 
+// Only the methods with breakpoints run in the interpreter. Breakpoints are set and cleared with
+// the mutator lock shared, the methods are deoptimized and undeoptimized once the JDWP thread has
+// suspended all threads.
+struct DeoptimizationRequest {
+  mirror::ArtMethod* method;
+  bool deoptimize;
+};
+static std::vector<DeoptimizationRequest> gDeoptimizationRequests
+    GUARDED_BY(Locks::breakpoint_lock_);
+
+static bool HasBreakpointsIn(mirror::ArtMethod* m)
+    EXCLUSIVE_LOCKS_REQUIRED(Locks::breakpoint_lock_) {
+  std::multiset<Breakpoint>::const_iterator it = gBreakpoints.lower_bound(Breakpoint(m, 0));
+  return it != gBreakpoints.end() && it->method == m;
+}
+
+static void RequestDeoptimization(mirror::ArtMethod* m, bool deoptimize)
+    EXCLUSIVE_LOCKS_REQUIRED(Locks::breakpoint_lock_) {
+  DeoptimizationRequest request = { m, deoptimize };
+  gDeoptimizationRequests.push_back(request);
+}
+
+// Lets the thread that was single-stepped run compiled code again, unless it has exited since.
+static void ClearSteppingThread()
+    EXCLUSIVE_LOCKS_REQUIRED(Locks::thread_list_lock_, Locks::breakpoint_lock_) {
+  Thread* thread = gSingleStepControl.thread;
+  if (thread != NULL && Runtime::Current()->GetThreadList()->Contains(thread)) {
+    thread->SetInterpreterForced(false);
+  }
+}
+
 static bool IsBreakpoint(const mirror::ArtMethod* m, uint32_t dex_pc)
-    LOCKS_EXCLUDED(Locks::breakpoint_lock_)
+    EXCLUSIVE_LOCKS_REQUIRED(Locks::breakpoint_lock_)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
-  MutexLock mu(Thread::Current(), *Locks::breakpoint_lock_);
-  for (size_t i = 0; i < gBreakpoints.size(); ++i) {
-    if (gBreakpoints[i].method == m && gBreakpoints[i].dex_pc == dex_pc) {
-      VLOG(jdwp) << "Hit breakpoint #" << i << ": " << gBreakpoints[i];
-      return true;
-    }
+  if (gBreakpoints.empty()) {
+    return false;
+  }
+  std::multiset<Breakpoint>::const_iterator it =
+      gBreakpoints.find(Breakpoint(const_cast<mirror::ArtMethod*>(m), dex_pc));
+  if (it == gBreakpoints.end()) {
+    return false;
   }
-  return false;
+  VLOG(jdwp) << "Hit breakpoint: " << *it;
+  return true;
 }
 
 static bool IsSuspendedForDebugger(ScopedObjectAccessUnchecked& soa, Thread* thread) {
@@ -471,6 +511,24 @@ void Dbg::StopJdwp() {
   gRegistry = NULL;
 }
 
+void Dbg::SweepObjectRegistry(IsMarkedTester is_marked, void* arg) {
+  if (gRegistry != NULL) {
+    gRegistry->SweepObjectRegistry(is_marked, arg);
+  }
+}
+
+void Dbg::DisallowNewObjectRegistryObjects() {
+  if (gRegistry != NULL) {
+    gRegistry->DisallowNewObjects();
+  }
+}
+
+void Dbg::AllowNewObjectRegistryObjects() {
+  if (gRegistry != NULL) {
+    gRegistry->AllowNewObjects();
+  }
+}
+
 void Dbg::GcDidFinish() {
   if (gDdmHpifWhen != HPIF_WHEN_NEVER) {
     ScopedObjectAccess soa(Thread::Current());
@@ -563,6 +621,11 @@ void Dbg::Disconnected() {
   runtime->GetThreadList()->SuspendAll();
   Thread* self = Thread::Current();
   ThreadState old_state = self->SetStateUnsafe(kRunnable);
+  {
+    MutexLock mu(self, *Locks::breakpoint_lock_);
+    gDeoptimizationRequests.clear();
+  }
+  runtime->GetInstrumentation()->UndeoptimizeAll();
   runtime->GetInstrumentation()->RemoveListener(&gDebugInstrumentationListener,
                                                 instrumentation::Instrumentation::kMethodEntered |
                                                 instrumentation::Instrumentation::kMethodExited |
@@ -575,6 +638,33 @@ void Dbg::Disconnected() {
   runtime->GetThreadList()->ResumeAll();
 }
 
+void Dbg::ManageDeoptimization() {
+  Thread* self = Thread::Current();
+  std::vector<DeoptimizationRequest> requests;
+  {
+    MutexLock mu(self, *Locks::breakpoint_lock_);
+    requests.swap(gDeoptimizationRequests);
+  }
+  if (requests.empty()) {
+    return;
+  }
+  // Suspend all threads and exclusively acquire the mutator lock, as in GoActive, to change the
+  // code of the methods.
+  Runtime* runtime = Runtime::Current();
+  runtime->GetThreadList()->SuspendAll();
+  ThreadState old_state = self->SetStateUnsafe(kRunnable);
+  instrumentation::Instrumentation* instrumentation = runtime->GetInstrumentation();
+  for (size_t i = 0; i < requests.size(); ++i) {
+    if (requests[i].deoptimize) {
+      instrumentation->Deoptimize(requests[i].method);
+    } else {
+      instrumentation->Undeoptimize(requests[i].method);
+    }
+  }
+  CHECK_EQ(self->SetStateUnsafe(old_state), kRunnable);
+  runtime->GetThreadList()->ResumeAll();
+}
+
 bool Dbg::IsDebuggerActive() {
   return gDebuggerActive;
 }
@@ -664,15 +754,17 @@ JDWP::JdwpError Dbg::GetMonitorInfo(JDWP::ObjectId object_id, JDWP::ExpandBuf* r
     return JDWP::ERR_INVALID_OBJECT;
   }
 
-  // Ensure all threads are suspended while we read objects' lock words.
+  // Ensure all threads are suspended while we read objects' lock words. Runnable threads share
+  // the mutator lock implicitly, so acquiring it exclusively requires suspending them.
   Thread* self = Thread::Current();
-  Locks::mutator_lock_->SharedUnlock(self);
-  Locks::mutator_lock_->ExclusiveLock(self);
+  CHECK_EQ(self->GetState(), kRunnable);
+  self->TransitionFromRunnableToSuspended(kSuspended);
+  Runtime::Current()->GetThreadList()->SuspendAll();
 
   MonitorInfo monitor_info(o);
 
-  Locks::mutator_lock_->ExclusiveUnlock(self);
-  Locks::mutator_lock_->SharedLock(self);
+  Runtime::Current()->GetThreadList()->ResumeAll();
+  self->TransitionFromSuspendedToRunnable();
 
   if (monitor_info.owner != NULL) {
     expandBufAddObjectId(reply, gRegistry->Add(monitor_info.owner->GetPeer()));
@@ -2298,14 +2390,14 @@ void Dbg::UpdateDebugger(Thread* thread, mirror::Object* this_object,
 
   int event_flags = 0;
 
-  if (IsBreakpoint(m, dex_pc)) {
-    event_flags |= kBreakpoint;
-  }
-
   {
+    MutexLock mu(Thread::Current(), *Locks::breakpoint_lock_);
+    if (IsBreakpoint(m, dex_pc)) {
+      event_flags |= kBreakpoint;
+    }
+
     // If the debugger is single-stepping one of our threads, check to
     // see if we're that thread and we've reached a step point.
-    MutexLock mu(Thread::Current(), *Locks::breakpoint_lock_);
     if (gSingleStepControl.is_active && gSingleStepControl.thread == thread) {
       CHECK(!m->IsNative());
       if (gSingleStepControl.step_depth == JDWP::SD_INTO) {
@@ -2373,18 +2465,23 @@ void Dbg::UpdateDebugger(Thread* thread, mirror::Object* this_object,
 void Dbg::WatchLocation(const JDWP::JdwpLocation* location) {
   MutexLock mu(Thread::Current(), *Locks::breakpoint_lock_);
   mirror::ArtMethod* m = FromMethodId(location->method_id);
-  gBreakpoints.push_back(Breakpoint(m, location->dex_pc));
-  VLOG(jdwp) << "Set breakpoint #" << (gBreakpoints.size() - 1) << ": " << gBreakpoints[gBreakpoints.size() - 1];
+  if (!HasBreakpointsIn(m)) {
+    RequestDeoptimization(m, true);
+  }
+  std::multiset<Breakpoint>::const_iterator it =
+      gBreakpoints.insert(Breakpoint(m, location->dex_pc));
+  VLOG(jdwp) << "Set breakpoint: " << *it;
 }
 
 void Dbg::UnwatchLocation(const JDWP::JdwpLocation* location) {
   MutexLock mu(Thread::Current(), *Locks::breakpoint_lock_);
   mirror::ArtMethod* m = FromMethodId(location->method_id);
-  for (size_t i = 0; i < gBreakpoints.size(); ++i) {
-    if (gBreakpoints[i].method == m && gBreakpoints[i].dex_pc == location->dex_pc) {
-      VLOG(jdwp) << "Removed breakpoint #" << i << ": " << gBreakpoints[i];
-      gBreakpoints.erase(gBreakpoints.begin() + i);
-      return;
+  std::multiset<Breakpoint>::iterator it = gBreakpoints.find(Breakpoint(m, location->dex_pc));
+  if (it != gBreakpoints.end()) {
+    VLOG(jdwp) << "Removed breakpoint: " << *it;
+    gBreakpoints.erase(it);
+    if (!HasBreakpointsIn(m)) {
+      RequestDeoptimization(m, false);
     }
   }
 }
@@ -2453,12 +2550,14 @@ JDWP::JdwpError Dbg::ConfigureStep(JDWP::ObjectId thread_id, JDWP::JdwpStepSize
     return sts.GetError();
   }
 
+  MutexLock mu(self, *Locks::thread_list_lock_);
   MutexLock mu2(self, *Locks::breakpoint_lock_);
   // TODO: there's no theoretical reason why we couldn't support single-stepping
   // of multiple threads at once, but we never did so historically.
   if (gSingleStepControl.thread != NULL && sts.GetThread() != gSingleStepControl.thread) {
     LOG(WARNING) << "single-step already active for " << *gSingleStepControl.thread
                  << "; switching to " << *sts.GetThread();
+    ClearSteppingThread();
   }
 
   //
@@ -2563,7 +2662,10 @@ JDWP::JdwpError Dbg::ConfigureStep(JDWP::ObjectId thread_id, JDWP::JdwpStepSize
   // Everything else...
   //
 
+  // Only the stepping thread runs in the interpreter. Its compiled frames are deoptimized as they
+  // are returned to, and the methods it calls are interpreted.
   gSingleStepControl.thread = sts.GetThread();
+  gSingleStepControl.thread->SetInterpreterForced(true);
   gSingleStepControl.step_size = step_size;
   gSingleStepControl.step_depth = step_depth;
   gSingleStepControl.is_active = true;
@@ -2585,8 +2687,11 @@ JDWP::JdwpError Dbg::ConfigureStep(JDWP::ObjectId thread_id, JDWP::JdwpStepSize
 }
 
 void Dbg::UnconfigureStep(JDWP::ObjectId /*thread_id*/) {
-  MutexLock mu(Thread::Current(), *Locks::breakpoint_lock_);
+  Thread* self = Thread::Current();
+  MutexLock mu(self, *Locks::thread_list_lock_);
+  MutexLock mu2(self, *Locks::breakpoint_lock_);
 
+  ClearSteppingThread();
   gSingleStepControl.is_active = false;
   gSingleStepControl.thread = NULL;
   gSingleStepControl.dex_pcs.clear();
@@ -92,6 +92,12 @@ class Dbg {
   // Invoked by the GC in case we need to keep DDMS informed.
   static void GcDidFinish() LOCKS_EXCLUDED(Locks::mutator_lock_);
 
+  // Invoked by the GC to treat the objects known to the debugger as system weaks.
+  static void SweepObjectRegistry(IsMarkedTester is_marked, void* arg)
+      SHARED_LOCKS_REQUIRED(Locks::heap_bitmap_lock_);
+  static void DisallowNewObjectRegistryObjects() EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
+  static void AllowNewObjectRegistryObjects() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   // Return the DebugInvokeReq for the current thread.
   static DebugInvokeReq* GetInvokeReq();
 
@@ -353,9 +359,15 @@ class Dbg {
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   static JDWP::JdwpError ConfigureStep(JDWP::ObjectId thread_id, JDWP::JdwpStepSize size,
                                        JDWP::JdwpStepDepth depth)
-      LOCKS_EXCLUDED(Locks::breakpoint_lock_)
+      LOCKS_EXCLUDED(Locks::thread_list_lock_, Locks::breakpoint_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
-  static void UnconfigureStep(JDWP::ObjectId thread_id) LOCKS_EXCLUDED(Locks::breakpoint_lock_);
+  static void UnconfigureStep(JDWP::ObjectId thread_id)
+      LOCKS_EXCLUDED(Locks::thread_list_lock_, Locks::breakpoint_lock_);
+
+  // Deoptimizes the methods that have gained breakpoints and undeoptimizes those that lost them.
+  // Called by the JDWP thread after each request.
+  static void ManageDeoptimization()
+      LOCKS_EXCLUDED(Locks::breakpoint_lock_, Locks::mutator_lock_);
 
   static JDWP::JdwpError InvokeMethod(JDWP::ObjectId thread_id, JDWP::ObjectId object_id,
                                       JDWP::RefTypeId class_id, JDWP::MethodId method_id,
@@ -24,10 +24,13 @@
 #include <sys/file.h>
 #include <sys/stat.h>
 
+#include <algorithm>
+
 #include "base/logging.h"
 #include "base/stringprintf.h"
 #include "class_linker.h"
 #include "dex_file-inl.h"
+#include "dex_file_lookup_table.h"
 #include "dex_file_verifier.h"
 #include "globals.h"
 #include "leb128.h"
@@ -223,17 +226,23 @@ const DexFile* DexFile::OpenMemory(const std::string& location,
                     mem_map->Size(),
                     location,
                     location_checksum,
-                    mem_map);
+                    mem_map,
+                    NULL);
 }
 
-const DexFile* DexFile::Open(const ZipArchive& zip_archive, const std::string& location) {
+const DexFile* DexFile::Open(const ZipArchive& zip_archive, const std::string& location,
+                             const uint32_t* trusted_checksum) {
   CHECK(!location.empty());
   UniquePtr<ZipEntry> zip_entry(zip_archive.Find(kClassesDex));
   if (zip_entry.get() == NULL) {
     LOG(ERROR) << "Failed to find classes.dex within '" << location << "'";
     return NULL;
   }
-  UniquePtr<MemMap> map(zip_entry->ExtractToMemMap(kClassesDex));
+  // A stored classes.dex is used in place, various dex file structures must be word aligned.
+  UniquePtr<MemMap> map(zip_entry->MapDirectlyFromFile(kClassesDex, 4));
+  if (map.get() == NULL) {
+    map.reset(zip_entry->ExtractToMemMap(kClassesDex));
+  }
   if (map.get() == NULL) {
     LOG(ERROR) << "Failed to extract '" << kClassesDex << "' from '" << location << "'";
     return NULL;
@@ -243,7 +252,14 @@ const DexFile* DexFile::Open(const ZipArchive& zip_archive, const std::string& l
     LOG(ERROR) << "Failed to open dex file '" << location << "' from memory";
     return NULL;
   }
-  if (!DexFileVerifier::Verify(dex_file.get(), dex_file->Begin(), dex_file->Size())) {
+  bool verified;
+  if (trusted_checksum != NULL && *trusted_checksum == zip_entry->GetCrc32()) {
+    verified = DexFileVerifier::VerifyHeaderAndMap(dex_file.get(), dex_file->Begin(),
+                                                   dex_file->Size());
+  } else {
+    verified = DexFileVerifier::Verify(dex_file.get(), dex_file->Begin(), dex_file->Size());
+  }
+  if (!verified) {
     LOG(ERROR) << "Failed to verify dex file '" << location << "'";
     return NULL;
   }
@@ -259,14 +275,17 @@ const DexFile* DexFile::OpenMemory(const byte* base,
                                    size_t size,
                                    const std::string& location,
                                    uint32_t location_checksum,
-                                   MemMap* mem_map) {
+                                   MemMap* mem_map,
+                                   const uint8_t* lookup_table) {
   CHECK_ALIGNED(base, 4);  // various dex file structures must be word aligned
   UniquePtr<DexFile> dex_file(new DexFile(base, size, location, location_checksum, mem_map));
   if (!dex_file->Init()) {
     return NULL;
-  } else {
-    return dex_file.release();
   }
+  if (lookup_table != NULL) {
+    dex_file->lookup_table_ = DexFileLookupTable::Open(lookup_table);
+  }
+  return dex_file.release();
 }
 
 DexFile::~DexFile() {
@@ -274,6 +293,13 @@ DexFile::~DexFile() {
   // that's only called after DetachCurrentThread, which means there's no JNIEnv. We could
   // re-attach, but cleaning up these global references is not obviously useful. It's not as if
   // the global reference table is otherwise empty!
+  delete lookup_table_;
+  if (line_tables_ != NULL) {
+    for (size_t i = 0; i < kLineTableCacheSize; ++i) {
+      delete line_tables_[i];
+    }
+    delete[] line_tables_;
+  }
 }
 
 bool DexFile::Init() {
@@ -331,27 +357,31 @@ uint32_t DexFile::GetVersion() const {
   return atoi(version);
 }
 
-const DexFile::ClassDef* DexFile::FindClassDef(const char* descriptor) const {
-  size_t num_class_defs = NumClassDefs();
-  if (num_class_defs == 0) {
-    return NULL;
+const DexFileLookupTable* DexFile::GetLookupTable() const {
+  const DexFileLookupTable* table = lookup_table_;
+  if (LIKELY(table != NULL)) {
+    return table;
   }
-  const StringId* string_id = FindStringId(descriptor);
-  if (string_id == NULL) {
-    return NULL;
+  // Racing threads may build a table each, all but the first to publish throw theirs away. String
+  // ids keep using a binary search rather than spending memory in every process on them.
+  const DexFileLookupTable* new_table = DexFileLookupTable::Create(*this, false);
+  // The full barrier of the CAS publishes the entries along with the pointer.
+  if (!__sync_bool_compare_and_swap(&lookup_table_, static_cast<const DexFileLookupTable*>(NULL),
+                                    new_table)) {
+    delete new_table;
   }
-  const TypeId* type_id = FindTypeId(GetIndexForStringId(*string_id));
-  if (type_id == NULL) {
+  return lookup_table_;
+}
+
+const DexFile::ClassDef* DexFile::FindClassDef(const char* descriptor) const {
+  if (NumClassDefs() == 0) {
     return NULL;
   }
-  uint16_t type_idx = GetIndexForTypeId(*type_id);
-  for (size_t i = 0; i < num_class_defs; ++i) {
-    const ClassDef& class_def = GetClassDef(i);
-    if (class_def.class_idx_ == type_idx) {
-      return &class_def;
-    }
+  uint32_t class_def_idx = GetLookupTable()->FindClassDef(*this, descriptor);
+  if (class_def_idx == kDexNoIndex) {
+    return NULL;
   }
-  return NULL;
+  return &GetClassDef(class_def_idx);
 }
 
 const DexFile::ClassDef* DexFile::FindClassDef(uint16_t type_idx) const {
@@ -365,6 +395,37 @@ const DexFile::ClassDef* DexFile::FindClassDef(uint16_t type_idx) const {
   return NULL;
 }
 
+bool DexFile::IsMethodAnnotationPresent(const ClassDef& class_def, uint32_t method_idx,
+                                        const char* descriptor) const {
+  if (class_def.annotations_off_ == 0) {
+    return false;
+  }
+  const AnnotationsDirectoryItem* directory =
+      reinterpret_cast<const AnnotationsDirectoryItem*>(begin_ + class_def.annotations_off_);
+  const FieldAnnotationsItem* field_annotations =
+      reinterpret_cast<const FieldAnnotationsItem*>(directory + 1);
+  const MethodAnnotationsItem* method_annotations =
+      reinterpret_cast<const MethodAnnotationsItem*>(field_annotations + directory->fields_size_);
+  for (size_t i = 0; i < directory->methods_size_; ++i) {
+    if (method_annotations[i].method_idx_ != method_idx) {
+      continue;
+    }
+    const AnnotationSetItem* set = reinterpret_cast<const AnnotationSetItem*>(
+        begin_ + method_annotations[i].annotations_off_);
+    for (size_t j = 0; j < set->size_; ++j) {
+      const AnnotationItem* annotation =
+          reinterpret_cast<const AnnotationItem*>(begin_ + set->entries_[j]);
+      const byte* data = annotation->annotation_;
+      uint32_t type_idx = DecodeUnsignedLeb128(&data);
+      if (strcmp(StringByTypeIdx(type_idx), descriptor) == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+  return false;
+}
+
 const DexFile::FieldId* DexFile::FindFieldId(const DexFile::TypeId& declaring_klass,
                                               const DexFile::StringId& name,
                                               const DexFile::TypeId& type) const {
@@ -436,6 +497,12 @@ const DexFile::MethodId* DexFile::FindMethodId(const DexFile::TypeId& declaring_
 }
 
 const DexFile::StringId* DexFile::FindStringId(const char* string) const {
+  // Only tables from oat files index the strings.
+  const DexFileLookupTable* table = lookup_table_;
+  if (table != NULL && table->HasStringIds()) {
+    uint32_t string_idx = table->FindStringId(*this, string);
+    return string_idx == kDexNoIndex ? NULL : &GetStringId(string_idx);
+  }
   int32_t lo = 0;
   int32_t hi = NumStringIds() - 1;
   while (hi >= lo) {
@@ -623,6 +690,12 @@ int32_t DexFile::GetLineNumFromPC(const mirror::ArtMethod* method, uint32_t rel_
   const CodeItem* code_item = GetCodeItem(method->GetCodeItemOffset());
   DCHECK(code_item != NULL) << PrettyMethod(method) << " " << GetLocation();
 
+  const LineTable* table = GetLineTable(code_item, method->IsStatic(),
+                                        method->GetDexMethodIndex());
+  if (LIKELY(table != NULL)) {
+    return table->GetLineNum(rel_pc);
+  }
+
   // A method with no line number info should return -1
   LineNumFromPcContext context(rel_pc, -1);
   DecodeDebugInfo(code_item, method->IsStatic(), method->GetDexMethodIndex(), LineNumForPcCb,
@@ -630,6 +703,70 @@ int32_t DexFile::GetLineNumFromPC(const mirror::ArtMethod* method, uint32_t rel_
   return context.line_num_;
 }
 
+struct DexFile::LineTable {
+  explicit LineTable(uint32_t code_item_offset) : code_item_offset_(code_item_offset) {}
+
+  static bool AddPositionCb(void* context, uint32_t address, uint32_t line_num) {
+    reinterpret_cast<LineTable*>(context)->positions_.push_back(std::make_pair(address, line_num));
+    return false;
+  }
+
+  // The same answer as LineNumForPcCb: the line of the first position at the pc, else of the last
+  // position before it, else -1.
+  int32_t GetLineNum(uint32_t pc) const {
+    std::vector<std::pair<uint32_t, uint32_t> >::const_iterator it =
+        std::lower_bound(positions_.begin(), positions_.end(), std::make_pair(pc, 0u));
+    if (it != positions_.end() && it->first == pc) {
+      return it->second;
+    }
+    return it == positions_.begin() ? -1 : (it - 1)->second;
+  }
+
+  const uint32_t code_item_offset_;
+  // Address and line pairs in ascending address order.
+  std::vector<std::pair<uint32_t, uint32_t> > positions_;
+};
+
+const DexFile::LineTable* DexFile::GetLineTable(const CodeItem* code_item, bool is_static,
+                                                uint32_t method_idx) const {
+  const LineTable* volatile* slots = line_tables_;
+  if (UNLIKELY(slots == NULL)) {
+    const LineTable* volatile* new_slots = new const LineTable* volatile[kLineTableCacheSize]();
+    if (!__sync_bool_compare_and_swap(&line_tables_, static_cast<const LineTable* volatile*>(NULL),
+                                      new_slots)) {
+      delete[] new_slots;
+    }
+    slots = line_tables_;
+  }
+  const uint32_t code_item_offset = reinterpret_cast<const byte*>(code_item) - begin_;
+  // Code items are 4 byte aligned, spread their offsets over the slots.
+  const size_t start = ((code_item_offset >> 2) * 2654435761u) >> 16;
+  LineTable* new_table = NULL;
+  for (size_t i = 0; i < kLineTableCacheProbes; ++i) {
+    const size_t index = (start + i) % kLineTableCacheSize;
+    const LineTable* table = slots[index];
+    if (table == NULL) {
+      if (new_table == NULL) {
+        new_table = new LineTable(code_item_offset);
+        DecodeDebugInfo(code_item, is_static, method_idx, LineTable::AddPositionCb, NULL,
+                        new_table);
+      }
+      // The full barrier of the CAS publishes the positions along with the pointer.
+      if (__sync_bool_compare_and_swap(&slots[index], static_cast<const LineTable*>(NULL),
+                                       new_table)) {
+        return new_table;
+      }
+      table = slots[index];
+    }
+    if (table->code_item_offset_ == code_item_offset) {
+      delete new_table;
+      return table;
+    }
+  }
+  delete new_table;
+  return NULL;
+}
+
 int32_t DexFile::FindTryItem(const CodeItem &code_item, uint32_t address) {
   // Note: Signed type is important for max and min.
   int32_t min = 0;
@@ -40,6 +40,7 @@ namespace mirror {
   class DexCache;
 }  // namespace mirror
 class ClassLinker;
+class DexFileLookupTable;
 class ZipArchive;
 
 // TODO: move all of the macro functionality into the DexCache class.
@@ -353,15 +354,20 @@ class DexFile {
   static const DexFile* Open(const std::string& filename,
                              const std::string& location);
 
-  // Opens .dex file, backed by existing memory
+  // Opens .dex file, backed by existing memory. The lookup table, if any, is a
+  // DexFileLookupTable serialized next to the dex file in an oat file.
   static const DexFile* Open(const uint8_t* base, size_t size,
                              const std::string& location,
-                             uint32_t location_checksum) {
-    return OpenMemory(base, size, location, location_checksum, NULL);
+                             uint32_t location_checksum,
+                             const uint8_t* lookup_table = NULL) {
+    return OpenMemory(base, size, location, location_checksum, NULL, lookup_table);
   }
 
-  // Opens .dex file from the classes.dex in a zip archive
-  static const DexFile* Open(const ZipArchive& zip_archive, const std::string& location);
+  // Opens .dex file from the classes.dex in a zip archive. If the CRC32 of classes.dex equals the
+  // trusted checksum, only the header and map are verified: the file was fully verified when the
+  // checksum was recorded, for example by dex2oat in an oat file.
+  static const DexFile* Open(const ZipArchive& zip_archive, const std::string& location,
+                             const uint32_t* trusted_checksum = NULL);
 
   // Closes a .dex file.
   virtual ~DexFile();
@@ -596,7 +602,8 @@ class DexFile {
     return StringByTypeIdx(class_def.class_idx_);
   }
 
-  // Looks up a class definition by its class descriptor.
+  // Looks up a class definition by its class descriptor. This is a single hash probe, the first
+  // lookup builds the hash table unless it was mapped from the oat file.
   const ClassDef* FindClassDef(const char* descriptor) const;
 
   // Looks up a class definition by its type index.
@@ -611,6 +618,11 @@ class DexFile {
     }
   }
 
+  // Returns whether the method of the class definition is annotated with the annotation type of the
+  // given descriptor, whatever the annotation's visibility.
+  bool IsMethodAnnotationPresent(const ClassDef& class_def, uint32_t method_idx,
+                                 const char* descriptor) const;
+
   // Returns a pointer to the raw memory mapped class_data_item
   const byte* GetClassData(const ClassDef& class_def) const {
     if (class_def.class_data_off_ == 0) {
@@ -832,7 +844,8 @@ class DexFile {
                                    size_t size,
                                    const std::string& location,
                                    uint32_t location_checksum,
-                                   MemMap* mem_map);
+                                   MemMap* mem_map,
+                                   const uint8_t* lookup_table);
 
   DexFile(const byte* base, size_t size,
           const std::string& location,
@@ -850,7 +863,9 @@ class DexFile {
         field_ids_(0),
         method_ids_(0),
         proto_ids_(0),
-        class_defs_(0) {
+        class_defs_(0),
+        lookup_table_(NULL),
+        line_tables_(NULL) {
     CHECK(begin_ != NULL) << GetLocation();
     CHECK_GT(size_, 0U) << GetLocation();
   }
@@ -864,10 +879,22 @@ class DexFile {
   // Returns true if the header magic and version numbers are of the expected values.
   bool CheckMagicAndVersion() const;
 
+  // Returns the lookup table, building one the first time if the oat file didn't provide it.
+  const DexFileLookupTable* GetLookupTable() const;
+
   void DecodeDebugInfo0(const CodeItem* code_item, bool is_static, uint32_t method_idx,
       DexDebugNewPositionCb position_cb, DexDebugNewLocalCb local_cb,
       void* context, const byte* stream, LocalInfo* local_in_reg) const;
 
+  // The positions of a method's debug info, decoded on the first line number lookup.
+  struct LineTable;
+  static const size_t kLineTableCacheSize = 1024;
+  static const size_t kLineTableCacheProbes = 8;
+
+  // Returns the cached positions of the code item, or NULL if its slots in the cache are taken.
+  const LineTable* GetLineTable(const CodeItem* code_item, bool is_static,
+                                uint32_t method_idx) const;
+
   // The base address of the memory mapping.
   const byte* const begin_;
 
@@ -910,6 +937,16 @@ class DexFile {
 
   // Points to the base of the class definition list.
   const ClassDef* class_defs_;
+
+  // Hash tables of the class descriptors and possibly the strings, either mapped from the oat file
+  // or built on the first lookup by descriptor and published with a CAS since lookups don't take
+  // a lock.
+  mutable const DexFileLookupTable* volatile lookup_table_;
+
+  // Open addressed cache of line tables keyed by code item offset, allocated on first use. Tables
+  // are published with a CAS into empty slots and live as long as the dex file, so that stack
+  // traces look line numbers up without a lock.
+  mutable const LineTable* volatile* volatile line_tables_;
 };
 
 // Iterate over a dex file's ProtoId's paramters
@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "dex_file_lookup_table.h"
+
+#include <string.h>
+
+#include "base/logging.h"
+#include "dex_file-inl.h"
+#include "utils.h"
+
+namespace art {
+
+static uint32_t CapacityFor(size_t count) {
+  uint32_t capacity = 16;
+  while (capacity < count * 2) {
+    capacity *= 2;
+  }
+  return capacity;
+}
+
+DexFileLookupTable* DexFileLookupTable::Create(const DexFile& dex_file, bool index_string_ids) {
+  std::vector<uint32_t> class_def_hashes;
+  class_def_hashes.reserve(dex_file.NumClassDefs());
+  for (size_t i = 0; i < dex_file.NumClassDefs(); ++i) {
+    class_def_hashes.push_back(Hash(dex_file.GetClassDescriptor(dex_file.GetClassDef(i))));
+  }
+  std::vector<uint32_t> string_id_hashes;
+  if (index_string_ids) {
+    string_id_hashes.reserve(dex_file.NumStringIds());
+    for (size_t i = 0; i < dex_file.NumStringIds(); ++i) {
+      string_id_hashes.push_back(Hash(dex_file.GetStringData(dex_file.GetStringId(i))));
+    }
+  }
+  const uint32_t class_def_capacity = CapacityFor(class_def_hashes.size());
+  const uint32_t string_id_capacity = index_string_ids ? CapacityFor(string_id_hashes.size()) : 0;
+
+  DexFileLookupTable* table = new DexFileLookupTable(NULL);
+  std::vector<uint32_t>& storage = table->storage_;
+  storage.resize(SizeOf(class_def_capacity, string_id_capacity) / sizeof(uint32_t));
+  storage[0] = class_def_capacity;
+  storage[1] = string_id_capacity;
+  Fill(&storage[2], class_def_capacity, class_def_hashes);
+  if (index_string_ids) {
+    Fill(&storage[2 + 2 * class_def_capacity], string_id_capacity, string_id_hashes);
+  }
+  table->data_ = &storage[0];
+  return table;
+}
+
+void DexFileLookupTable::Fill(uint32_t* entries, uint32_t capacity,
+                              const std::vector<uint32_t>& hashes) {
+  const uint32_t mask = capacity - 1;
+  for (uint32_t i = 0; i < capacity; ++i) {
+    entries[2 * i] = 0;
+    entries[2 * i + 1] = DexFile::kDexNoIndex;
+  }
+  for (size_t i = 0; i < hashes.size(); ++i) {
+    uint32_t slot = hashes[i] & mask;
+    while (entries[2 * slot + 1] != DexFile::kDexNoIndex) {
+      slot = (slot + 1) & mask;
+    }
+    entries[2 * slot] = hashes[i];
+    entries[2 * slot + 1] = i;
+  }
+}
+
+DexFileLookupTable* DexFileLookupTable::Open(const uint8_t* data) {
+  CHECK_ALIGNED(data, sizeof(uint32_t));
+  return new DexFileLookupTable(reinterpret_cast<const uint32_t*>(data));
+}
+
+bool DexFileLookupTable::IsValid(const uint8_t* data, size_t size, uint32_t num_class_defs,
+                                 uint32_t num_string_ids) {
+  if (!IsAligned<sizeof(uint32_t)>(data) || size < SizeOf(0, 0)) {
+    return false;
+  }
+  const uint32_t* words = reinterpret_cast<const uint32_t*>(data);
+  const uint32_t class_def_capacity = words[0];
+  const uint32_t string_id_capacity = words[1];
+  // An unused entry must remain for probes to stop.
+  if (!IsPowerOfTwo(class_def_capacity) || class_def_capacity <= num_class_defs) {
+    return false;
+  }
+  if (string_id_capacity != 0 &&
+      (!IsPowerOfTwo(string_id_capacity) || string_id_capacity <= num_string_ids)) {
+    return false;
+  }
+  // In 64 bits so that corrupt capacities can't wrap around.
+  const uint64_t needed = (2 + 2 * (static_cast<uint64_t>(class_def_capacity) +
+                                    string_id_capacity)) * sizeof(uint32_t);
+  return needed <= size;
+}
+
+// Descriptors and strings are modified UTF-8 which has a single encoding per string, so comparing
+// the bytes is the same as comparing the code points.
+uint32_t DexFileLookupTable::FindClassDef(const DexFile& dex_file, const char* descriptor) const {
+  const uint32_t mask = data_[0] - 1;
+  const uint32_t* entries = &data_[2];
+  const uint32_t hash = Hash(descriptor);
+  for (uint32_t slot = hash & mask; ; slot = (slot + 1) & mask) {
+    const uint32_t class_def_idx = entries[2 * slot + 1];
+    if (class_def_idx == DexFile::kDexNoIndex) {
+      return DexFile::kDexNoIndex;
+    }
+    if (entries[2 * slot] == hash) {
+      DCHECK_LT(class_def_idx, dex_file.NumClassDefs());
+      const DexFile::ClassDef& class_def = dex_file.GetClassDef(class_def_idx);
+      if (strcmp(descriptor, dex_file.GetClassDescriptor(class_def)) == 0) {
+        return class_def_idx;
+      }
+    }
+  }
+}
+
+uint32_t DexFileLookupTable::FindStringId(const DexFile& dex_file, const char* string) const {
+  DCHECK(HasStringIds());
+  const uint32_t mask = data_[1] - 1;
+  const uint32_t* entries = &data_[2 + 2 * data_[0]];
+  const uint32_t hash = Hash(string);
+  for (uint32_t slot = hash & mask; ; slot = (slot + 1) & mask) {
+    const uint32_t string_idx = entries[2 * slot + 1];
+    if (string_idx == DexFile::kDexNoIndex) {
+      return DexFile::kDexNoIndex;
+    }
+    if (entries[2 * slot] == hash) {
+      DCHECK_LT(string_idx, dex_file.NumStringIds());
+      if (strcmp(string, dex_file.GetStringData(dex_file.GetStringId(string_idx))) == 0) {
+        return string_idx;
+      }
+    }
+  }
+}
+
+}  // namespace art
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_DEX_FILE_LOOKUP_TABLE_H_
+#define ART_RUNTIME_DEX_FILE_LOOKUP_TABLE_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "base/macros.h"
+
+namespace art {
+
+class DexFile;
+
+// Open addressing hash tables from class descriptors to class def indexes and from strings to
+// string id indexes of a dex file. The oat writer emits them next to each dex file so that they
+// are mapped clean from the oat file, otherwise the class def table is built on first use.
+//
+// Serialized as 32-bit words:
+//
+// class_def_capacity    power of two
+// string_id_capacity    power of two, or zero if strings are not indexed
+// (hash, class_def_idx) class_def_capacity entries
+// (hash, string_idx)    string_id_capacity entries
+//
+// Unused entries have an index of DexFile::kDexNoIndex. The tables are at most half full.
+class DexFileLookupTable {
+ public:
+  // Builds the tables for the given dex file.
+  static DexFileLookupTable* Create(const DexFile& dex_file, bool index_string_ids);
+
+  // Wraps serialized tables, such as those mapped from an oat file, without copying them.
+  static DexFileLookupTable* Open(const uint8_t* data);
+
+  // Returns false if the serialized tables at data don't fit in size bytes or can't index a dex
+  // file with the given number of class defs and string ids.
+  static bool IsValid(const uint8_t* data, size_t size, uint32_t num_class_defs,
+                      uint32_t num_string_ids);
+
+  static uint32_t Hash(const char* s) {
+    uint32_t hash = 0;
+    for (; *s != '\0'; ++s) {
+      hash = hash * 31 + static_cast<uint8_t>(*s);
+    }
+    return hash;
+  }
+
+  // Return DexFile::kDexNoIndex if there is no match.
+  uint32_t FindClassDef(const DexFile& dex_file, const char* descriptor) const;
+  uint32_t FindStringId(const DexFile& dex_file, const char* string) const;
+
+  bool HasStringIds() const {
+    return data_[1] != 0;
+  }
+
+  const uint8_t* Data() const {
+    return reinterpret_cast<const uint8_t*>(data_);
+  }
+
+  size_t Size() const {
+    return SizeOf(data_[0], data_[1]);
+  }
+
+ private:
+  explicit DexFileLookupTable(const uint32_t* data) : data_(data) {}
+
+  static size_t SizeOf(uint32_t class_def_capacity, uint32_t string_id_capacity) {
+    return (2 + 2 * (class_def_capacity + string_id_capacity)) * sizeof(uint32_t);
+  }
+
+  // Stores the indexes in order so that the first of duplicate entries is found first.
+  static void Fill(uint32_t* entries, uint32_t capacity, const std::vector<uint32_t>& hashes);
+
+  // Backs data_ unless the tables are mapped from elsewhere.
+  std::vector<uint32_t> storage_;
+  const uint32_t* data_;
+
+  DISALLOW_COPY_AND_ASSIGN(DexFileLookupTable);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_DEX_FILE_LOOKUP_TABLE_H_
@@ -16,8 +16,10 @@
 
 #include "dex_file.h"
 
+#include "dex_file_lookup_table.h"
 #include "UniquePtr.h"
 #include "common_test.h"
+#include "zip_archive.h"
 
 namespace art {
 
@@ -124,6 +126,24 @@ TEST_F(DexFileTest, GetChecksum) {
   EXPECT_EQ(java_lang_dex_file_->GetLocationChecksum(), checksum);
 }
 
+TEST_F(DexFileTest, OpenTrustedZip) {
+  ScopedObjectAccess soa(Thread::Current());
+  UniquePtr<ZipArchive> zip_archive(ZipArchive::Open(GetLibCoreDexFileName()));
+  ASSERT_TRUE(zip_archive.get() != NULL);
+  uint32_t checksum = java_lang_dex_file_->GetLocationChecksum();
+  UniquePtr<const DexFile> trusted(DexFile::Open(*zip_archive.get(), GetLibCoreDexFileName(),
+                                                 &checksum));
+  ASSERT_TRUE(trusted.get() != NULL);
+  EXPECT_EQ(java_lang_dex_file_->GetHeader().checksum_, trusted->GetHeader().checksum_);
+  EXPECT_EQ(java_lang_dex_file_->NumClassDefs(), trusted->NumClassDefs());
+
+  // A different checksum is fully verified.
+  checksum++;
+  UniquePtr<const DexFile> untrusted(DexFile::Open(*zip_archive.get(), GetLibCoreDexFileName(),
+                                                   &checksum));
+  ASSERT_TRUE(untrusted.get() != NULL);
+}
+
 TEST_F(DexFileTest, ClassDefs) {
   ScopedObjectAccess soa(Thread::Current());
   const DexFile* raw(OpenTestDexFile("Nested"));
@@ -221,6 +241,45 @@ TEST_F(DexFileTest, FindTypeId) {
   }
 }
 
+TEST_F(DexFileTest, FindClassDef) {
+  for (size_t i = 0; i < java_lang_dex_file_->NumClassDefs(); i++) {
+    const DexFile::ClassDef& class_def = java_lang_dex_file_->GetClassDef(i);
+    const char* descriptor = java_lang_dex_file_->GetClassDescriptor(class_def);
+    EXPECT_EQ(&class_def, java_lang_dex_file_->FindClassDef(descriptor)) << descriptor;
+  }
+  EXPECT_TRUE(java_lang_dex_file_->FindClassDef("Ljava/lang/NoSuchClass;") == NULL);
+  // Referenced but not defined in the dex file.
+  EXPECT_TRUE(java_lang_dex_file_->FindClassDef("[Ljava/lang/Object;") == NULL);
+}
+
+TEST_F(DexFileTest, LookupTable) {
+  UniquePtr<const DexFileLookupTable> table(DexFileLookupTable::Create(*java_lang_dex_file_, true));
+  ASSERT_TRUE(table->HasStringIds());
+  EXPECT_TRUE(DexFileLookupTable::IsValid(table->Data(), table->Size(),
+                                          java_lang_dex_file_->NumClassDefs(),
+                                          java_lang_dex_file_->NumStringIds()));
+  EXPECT_FALSE(DexFileLookupTable::IsValid(table->Data(), table->Size() - 4,
+                                           java_lang_dex_file_->NumClassDefs(),
+                                           java_lang_dex_file_->NumStringIds()));
+
+  // Open the dex file again with the table, as an oat file would.
+  UniquePtr<const DexFile> dex_file(DexFile::Open(java_lang_dex_file_->Begin(),
+                                                  java_lang_dex_file_->Size(),
+                                                  java_lang_dex_file_->GetLocation(),
+                                                  java_lang_dex_file_->GetLocationChecksum(),
+                                                  table->Data()));
+  ASSERT_TRUE(dex_file.get() != NULL);
+  for (size_t i = 0; i < dex_file->NumStringIds(); i++) {
+    const DexFile::StringId& string_id = dex_file->GetStringId(i);
+    EXPECT_EQ(&string_id, dex_file->FindStringId(dex_file->GetStringData(string_id)));
+  }
+  EXPECT_TRUE(dex_file->FindStringId("never used as a string in a dex file") == NULL);
+  for (size_t i = 0; i < dex_file->NumClassDefs(); i++) {
+    const DexFile::ClassDef& class_def = dex_file->GetClassDef(i);
+    EXPECT_EQ(&class_def, dex_file->FindClassDef(dex_file->GetClassDescriptor(class_def)));
+  }
+}
+
 TEST_F(DexFileTest, FindProtoId) {
   for (size_t i = 0; i < java_lang_dex_file_->NumProtoIds(); i++) {
     const DexFile::ProtoId& to_find = java_lang_dex_file_->GetProtoId(i);
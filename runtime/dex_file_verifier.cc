@@ -105,6 +105,11 @@ bool DexFileVerifier::Verify(const DexFile* dex_file, const byte* begin, size_t
   return verifier->Verify();
 }
 
+bool DexFileVerifier::VerifyHeaderAndMap(const DexFile* dex_file, const byte* begin, size_t size) {
+  UniquePtr<DexFileVerifier> verifier(new DexFileVerifier(dex_file, begin, size));
+  return verifier->CheckHeader(false) && verifier->CheckMap();
+}
+
 bool DexFileVerifier::CheckPointerRange(const void* start, const void* end, const char* label) const {
   uint32_t range_start = reinterpret_cast<uint32_t>(start);
   uint32_t range_end = reinterpret_cast<uint32_t>(end);
@@ -133,7 +138,7 @@ bool DexFileVerifier::CheckIndex(uint32_t field, uint32_t limit, const char* lab
   return true;
 }
 
-bool DexFileVerifier::CheckHeader() const {
+bool DexFileVerifier::CheckHeader(bool check_checksum) const {
   // Check file size from the header.
   uint32_t expected_size = header_->file_size_;
   if (size_ != expected_size) {
@@ -142,13 +147,16 @@ bool DexFileVerifier::CheckHeader() const {
   }
 
   // Compute and verify the checksum in the header.
-  uint32_t adler_checksum = adler32(0L, Z_NULL, 0);
-  const uint32_t non_sum = sizeof(header_->magic_) + sizeof(header_->checksum_);
-  const byte* non_sum_ptr = reinterpret_cast<const byte*>(header_) + non_sum;
-  adler_checksum = adler32(adler_checksum, non_sum_ptr, expected_size - non_sum);
-  if (adler_checksum != header_->checksum_) {
-    LOG(ERROR) << StringPrintf("Bad checksum (%08x, expected %08x)", adler_checksum, header_->checksum_);
-    return false;
+  if (check_checksum) {
+    uint32_t adler_checksum = adler32(0L, Z_NULL, 0);
+    const uint32_t non_sum = sizeof(header_->magic_) + sizeof(header_->checksum_);
+    const byte* non_sum_ptr = reinterpret_cast<const byte*>(header_) + non_sum;
+    adler_checksum = adler32(adler_checksum, non_sum_ptr, expected_size - non_sum);
+    if (adler_checksum != header_->checksum_) {
+      LOG(ERROR) << StringPrintf("Bad checksum (%08x, expected %08x)", adler_checksum,
+                                 header_->checksum_);
+      return false;
+    }
   }
 
   // Check the contents of the header.
@@ -1920,7 +1928,7 @@ bool DexFileVerifier::CheckInterSection() {
 
 bool DexFileVerifier::Verify() {
   // Check the header.
-  if (!CheckHeader()) {
+  if (!CheckHeader(true)) {
     return false;
   }
 
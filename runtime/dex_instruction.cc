@@ -432,6 +432,9 @@ std::string Instruction::DumpString(const DexFile* file) const {
         case SGET_BYTE:
         case SGET_CHAR:
         case SGET_SHORT:
+        case SGET_QUICK:
+        case SGET_WIDE_QUICK:
+        case SGET_OBJECT_QUICK:
           if (file != NULL) {
             uint32_t field_idx = VRegB_21c();
             os << opcode << "  v" << static_cast<int>(VRegA_21c()) << ", " << PrettyField(field_idx, *file, true)
@@ -445,6 +448,9 @@ std::string Instruction::DumpString(const DexFile* file) const {
         case SPUT_BYTE:
         case SPUT_CHAR:
         case SPUT_SHORT:
+        case SPUT_QUICK:
+        case SPUT_WIDE_QUICK:
+        case SPUT_OBJECT_QUICK:
           if (file != NULL) {
             uint32_t field_idx = VRegB_21c();
             os << opcode << " v" << static_cast<int>(VRegA_21c()) << ", " << PrettyField(field_idx, *file, true)
@@ -552,6 +558,8 @@ std::string Instruction::DumpString(const DexFile* file) const {
         case INVOKE_DIRECT:
         case INVOKE_STATIC:
         case INVOKE_INTERFACE:
+        case INVOKE_DIRECT_QUICK:
+        case INVOKE_STATIC_QUICK:
           if (file != NULL) {
             os << opcode << " {";
             uint32_t method_idx = VRegB_35c();
@@ -591,6 +599,8 @@ std::string Instruction::DumpString(const DexFile* file) const {
         case INVOKE_DIRECT_RANGE:
         case INVOKE_STATIC_RANGE:
         case INVOKE_INTERFACE_RANGE:
+        case INVOKE_DIRECT_RANGE_QUICK:
+        case INVOKE_STATIC_RANGE_QUICK:
           if (file != NULL) {
             uint32_t method_idx = VRegB_3rc();
             os << StringPrintf("%s, {v%d .. v%d}, ", opcode, VRegC_3rc(), (VRegC_3rc() + VRegA_3rc() - 1))
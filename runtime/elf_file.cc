@@ -16,6 +16,8 @@
 
 #include "elf_file.h"
 
+#include <sys/mman.h>
+
 #include "base/logging.h"
 #include "base/stl_util.h"
 #include "utils.h"
@@ -596,9 +598,10 @@ size_t ElfFile::GetLoadedSize() {
   return loaded_size;
 }
 
-bool ElfFile::Load(bool executable) {
+bool ElfFile::Load(bool executable, ptrdiff_t relocation_delta) {
   // TODO: actually return false error
   CHECK(program_header_only_) << file_->GetPath();
+  base_address_ = reinterpret_cast<byte*>(relocation_delta);
   for (llvm::ELF::Elf32_Word i = 0; i < GetProgramHeaderNum(); i++) {
     llvm::ELF::Elf32_Phdr& program_header = GetProgramHeader(i);
 
@@ -702,4 +705,23 @@ bool ElfFile::Load(bool executable) {
   return true;
 }
 
+bool ElfFile::SetLoadedSegmentsWritable(bool writable) {
+  for (MemMap* segment : segments_) {
+    int prot = segment->GetProtect();
+    if (prot == PROT_NONE) {
+      continue;  // The reservation segments are loaded into.
+    }
+    if (writable) {
+      prot |= PROT_WRITE;
+    }
+    uintptr_t begin = RoundDown(reinterpret_cast<uintptr_t>(segment->Begin()), kPageSize);
+    uintptr_t end = RoundUp(reinterpret_cast<uintptr_t>(segment->End()), kPageSize);
+    if (mprotect(reinterpret_cast<void*>(begin), end - begin, prot) != 0) {
+      PLOG(WARNING) << "Failed to mprotect segment of " << file_->GetPath();
+      return false;
+    }
+  }
+  return true;
+}
+
 }  // namespace art
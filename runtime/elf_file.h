@@ -115,7 +115,12 @@ class ElfFile {
 
   // Load segments into memory based on PT_LOAD program headers.
   // executable is true at run time, false at compile time.
-  bool Load(bool executable);
+  // A file linked at a fixed address is loaded relocation_delta bytes from it, the caller is
+  // responsible for that range being free and for patching absolute addresses.
+  bool Load(bool executable, ptrdiff_t relocation_delta = 0);
+
+  // Makes the loaded segments writable, or restores their protection, to patch them in place.
+  bool SetLoadedSegmentsWritable(bool writable);
 
  private:
   ElfFile();
@@ -181,7 +181,7 @@ mirror::ArtMethod* FindMethodFromCode(uint32_t method_idx, mirror::Object* this_
         return resolved_method;
       } else if (type == kInterface) {
         mirror::ArtMethod* interface_method =
-            this_object->GetClass()->FindVirtualMethodForInterface(resolved_method);
+            self->FindVirtualMethodForInterface(this_object->GetClass(), resolved_method);
         if (UNLIKELY(interface_method == NULL)) {
           ThrowIncompatibleClassChangeErrorClassForInterfaceDispatch(resolved_method, this_object,
                                                                      referrer);
@@ -233,7 +233,7 @@ mirror::ArtMethod* FindMethodFromCode(uint32_t method_idx, mirror::Object* this_
         return resolved_method;
       } else if (type == kInterface) {
         mirror::ArtMethod* interface_method =
-            this_object->GetClass()->FindVirtualMethodForInterface(resolved_method);
+            self->FindVirtualMethodForInterface(this_object->GetClass(), resolved_method);
         if (UNLIKELY(interface_method == NULL)) {
           ThrowIncompatibleClassChangeErrorClassForInterfaceDispatch(resolved_method, this_object,
                                                                      referrer);
@@ -313,20 +313,22 @@ JValue InvokeProxyInvocationHandler(ScopedObjectAccessUnchecked& soa, const char
       CHECK(soa.Self()->IsExceptionPending());
       return zero;
     }
+    // Store into the array directly rather than through JNI, which would check every element.
+    // Boxing may allocate, so the array is decoded again after each boxed argument.
     for (size_t i = 0; i < args.size(); ++i) {
+      mirror::Object* val;
       if (shorty[i + 1] == 'L') {
-        jobject val = args.at(i).l;
-        soa.Env()->SetObjectArrayElement(args_jobj, i, val);
+        val = soa.Decode<mirror::Object*>(args[i].l);
       } else {
         JValue jv;
-        jv.SetJ(args.at(i).j);
-        mirror::Object* val = BoxPrimitive(Primitive::GetType(shorty[i + 1]), jv);
+        jv.SetJ(args[i].j);
+        val = BoxPrimitive(Primitive::GetType(shorty[i + 1]), jv);
         if (val == NULL) {
           CHECK(soa.Self()->IsExceptionPending());
           return zero;
         }
-        soa.Decode<mirror::ObjectArray<mirror::Object>* >(args_jobj)->Set(i, val);
       }
+      soa.Decode<mirror::ObjectArray<mirror::Object>* >(args_jobj)->Set(i, val);
     }
   }
 
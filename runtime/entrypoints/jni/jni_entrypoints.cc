@@ -27,7 +27,10 @@ namespace art {
 // Used by the JNI dlsym stub to find the native method to invoke if none is registered.
 extern "C" void* artFindNativeMethod() {
   Thread* self = Thread::Current();
-  Locks::mutator_lock_->AssertNotHeld(self);  // We come here as Native.
+  // We come here as Native, or as Runnable for fast and critical natives which don't transition.
+  if (self->GetState() != kRunnable) {
+    Locks::mutator_lock_->AssertNotHeld(self);
+  }
   ScopedObjectAccess soa(self);
 
   mirror::ArtMethod* method = self->GetCurrentMethod(NULL);
@@ -47,6 +47,11 @@ class PortableArgumentVisitor {
 #define PORTABLE_CALLEE_SAVE_FRAME__REF_AND_ARGS__R1_OFFSET 0
 #define PORTABLE_CALLEE_SAVE_FRAME__REF_AND_ARGS__FRAME_SIZE 0
 #define PORTABLE_STACK_ARG_SKIP 4
+#elif defined(__x86_64__)
+// As on x86 the portable stubs pass no arguments in registers.
+#define PORTABLE_CALLEE_SAVE_FRAME__REF_AND_ARGS__R1_OFFSET 0
+#define PORTABLE_CALLEE_SAVE_FRAME__REF_AND_ARGS__FRAME_SIZE 0
+#define PORTABLE_STACK_ARG_SKIP 8
 #else
 #error "Unsupported architecture"
 #define PORTABLE_CALLEE_SAVE_FRAME__REF_AND_ARGS__R1_OFFSET 0
@@ -114,7 +119,7 @@ class PortableArgumentVisitor {
 
  private:
   static size_t ComputeArgsInRegs(MethodHelper& mh) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
-#if (defined(__i386__))
+#if defined(__i386__) || defined(__x86_64__)
     return 0;
 #else
     size_t args_in_regs = 0;
@@ -286,23 +291,25 @@ extern "C" uint64_t artPortableProxyInvokeHandler(mirror::ArtMethod* proxy_metho
   // Create local ref. copies of proxy method and the receiver.
   jobject rcvr_jobj = soa.AddLocalReference<jobject>(receiver);
 
+  // Look up the interface method and the shorty. The plan is copied as the invocation handler may
+  // call other proxy methods.
+  const ProxyInvokePlan plan = self->GetProxyInvokeCache()->Get(proxy_method);
+
   // Placing arguments into args vector and remove the receiver.
   MethodHelper proxy_mh(proxy_method);
   std::vector<jvalue> args;
+  args.reserve(plan.shorty_len);
   BuildPortableArgumentVisitor local_ref_visitor(proxy_mh, sp, soa, args);
   local_ref_visitor.VisitArguments();
   args.erase(args.begin());
 
   // Convert proxy method into expected interface method.
-  mirror::ArtMethod* interface_method = proxy_method->FindOverriddenMethod();
-  DCHECK(interface_method != NULL);
-  DCHECK(!interface_method->IsProxyMethod()) << PrettyMethod(interface_method);
-  jobject interface_method_jobj = soa.AddLocalReference<jobject>(interface_method);
+  jobject interface_method_jobj = soa.AddLocalReference<jobject>(plan.interface_method);
 
   // All naked Object*s should now be in jobjects, so its safe to go into the main invoke code
   // that performs allocations.
   self->EndAssertNoThreadSuspension(old_cause);
-  JValue result = InvokeProxyInvocationHandler(soa, proxy_mh.GetShorty(),
+  JValue result = InvokeProxyInvocationHandler(soa, plan.shorty,
                                                rcvr_jobj, interface_method_jobj, args);
   return result.GetJ();
 }
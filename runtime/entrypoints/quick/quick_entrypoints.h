@@ -32,6 +32,7 @@ namespace mirror {
 class ArtMethod;
 class Class;
 class Object;
+class String;
 }  // namespace mirror
 
 class Thread;
@@ -113,6 +114,7 @@ struct PACKED(4) QuickEntryPoints {
   int32_t (*pIndexOf)(void*, uint32_t, uint32_t, uint32_t);
   int32_t (*pMemcmp16)(void*, void*, int32_t);
   int32_t (*pStringCompareTo)(void*, void*);
+  uint32_t (*pStringEquals)(mirror::String*, mirror::Object*);
   void* (*pMemcpy)(void*, const void*, size_t);
 
   // Invocation
@@ -125,6 +127,12 @@ struct PACKED(4) QuickEntryPoints {
   void (*pInvokeSuperTrampolineWithAccessCheck)(uint32_t, void*);
   void (*pInvokeVirtualTrampolineWithAccessCheck)(uint32_t, void*);
 
+  // Instrumentation
+  // Called by the prologues and epilogues of code compiled with method hooks. NULL unless the
+  // thread's method hooks are enabled, see Thread::SetMethodHooksEnabled.
+  void (*pMethodEntryHook)(mirror::ArtMethod*, Thread*);
+  uint64_t (*pMethodExitHook)(mirror::ArtMethod*, Thread*, uint64_t);
+
   // Thread
   void (*pCheckSuspend)(Thread*);  // Stub that is called when the suspend count is non-zero
   void (*pTestSuspend)();  // Stub that is periodically called to test the suspend count
@@ -15,6 +15,7 @@
  */
 
 #include "callee_save_frame.h"
+#include "dex_file.h"
 #include "instrumentation.h"
 #include "mirror/art_method-inl.h"
 #include "mirror/object-inl.h"
@@ -31,7 +32,12 @@ extern "C" const void* artInstrumentationMethodEntryFromCode(mirror::ArtMethod*
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
   FinishCalleeSaveFrameSetup(self, sp, Runtime::kRefsAndArgs);
   instrumentation::Instrumentation* instrumentation = Runtime::Current()->GetInstrumentation();
-  const void* result = instrumentation->GetQuickCodeFor(method);
+  const void* result;
+  if (UNLIKELY(instrumentation->ShouldInterpret(self, method))) {
+    result = GetQuickToInterpreterBridge();
+  } else {
+    result = instrumentation->GetQuickCodeFor(method);
+  }
   bool interpreter_entry = (result == GetQuickToInterpreterBridge());
   instrumentation->PushInstrumentationStackFrame(self, method->IsStatic() ? NULL : this_object,
                                                  method, lr, interpreter_entry);
@@ -62,4 +68,25 @@ extern "C" uint64_t artInstrumentationMethodExitFromCode(Thread* self, mirror::A
   return return_or_deoptimize_pc;
 }
 
+// The method hooks are called by compiled code without setting up a callee save frame, so the
+// thread's stack can't be walked and the thread mustn't suspend while they run. The receiver isn't
+// passed, and like the exit stub the exit hook has no dex pc.
+extern "C" void artMethodEntryHook(mirror::ArtMethod* method, Thread* self)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  const char* old_cause = self->StartAssertNoThreadSuspension("Method entry hook");
+  Runtime::Current()->GetInstrumentation()->MethodEnterEvent(self, NULL, method, 0);
+  self->EndAssertNoThreadSuspension(old_cause);
+}
+
+extern "C" uint64_t artMethodExitHook(mirror::ArtMethod* method, Thread* self, uint64_t result)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  const char* old_cause = self->StartAssertNoThreadSuspension("Method exit hook");
+  JValue return_value;
+  return_value.SetJ(result);
+  Runtime::Current()->GetInstrumentation()->MethodExitEvent(self, NULL, method, DexFile::kDexNoIndex,
+                                                            return_value);
+  self->EndAssertNoThreadSuspension(old_cause);
+  return result;
+}
+
 }  // namespace art
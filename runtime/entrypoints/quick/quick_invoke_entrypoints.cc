@@ -25,7 +25,10 @@
 
 namespace art {
 
-// Determine target of interface dispatch. This object is known non-null.
+// Determine target of interface dispatch. This object is known non-null. Compiled code that looks
+// the method up in the receiver's interface method table first gets here when the method's slot is
+// shared with another interface method, when the method isn't resolved in the dex cache or when
+// the receiver doesn't implement it.
 extern "C" uint64_t artInvokeInterfaceTrampoline(mirror::ArtMethod* interface_method,
                                                  mirror::Object* this_object,
                                                  mirror::ArtMethod* caller_method,
@@ -33,7 +36,7 @@ extern "C" uint64_t artInvokeInterfaceTrampoline(mirror::ArtMethod* interface_me
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
   mirror::ArtMethod* method;
   if (LIKELY(interface_method->GetDexMethodIndex() != DexFile::kDexNoIndex)) {
-    method = this_object->GetClass()->FindVirtualMethodForInterface(interface_method);
+    method = self->FindVirtualMethodForInterface(this_object->GetClass(), interface_method);
     if (UNLIKELY(method == NULL)) {
       FinishCalleeSaveFrameSetup(self, sp, Runtime::kRefsAndArgs);
       ThrowIncompatibleClassChangeErrorClassForInterfaceDispatch(interface_method, this_object,
@@ -81,6 +84,25 @@ extern "C" uint64_t artInvokeInterfaceTrampoline(mirror::ArtMethod* interface_me
     DCHECK_EQ(32U, Runtime::Current()->GetCalleeSaveMethod(Runtime::kRefsAndArgs)->GetFrameSizeInBytes());
     uintptr_t* regs = reinterpret_cast<uintptr_t*>(reinterpret_cast<byte*>(sp));
     uintptr_t caller_pc = regs[7];
+#elif defined(__x86_64__)
+    // On entry the stack pointed by sp is:
+    // | argN            |  |
+    // | ...             |  |
+    // | arg4            |  |
+    // | arg3 spill      |  |  Caller's frame
+    // | arg2 spill      |  |
+    // | arg1 spill      |  |
+    // | Method*         | ---
+    // | Return          |
+    // | R15,R14,R13,R12 |    callee saves
+    // | RDI,RSI,RBP     |    callee saves
+    // | RBX             |    arg3
+    // | RDX             |    arg2
+    // | RCX             |    arg1
+    // | RAX/Method*     |  <- sp
+    DCHECK_EQ(96U, Runtime::Current()->GetCalleeSaveMethod(Runtime::kRefsAndArgs)->GetFrameSizeInBytes());
+    uintptr_t* regs = reinterpret_cast<uintptr_t*>(reinterpret_cast<byte*>(sp));
+    uintptr_t caller_pc = regs[11];
 #elif defined(__mips__)
     // On entry the stack pointed by sp is:
     // | argN       |  |
@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mirror/object-inl.h"
+#include "mirror/string.h"
+
+namespace art {
+
+// String.equals for code, won't throw or suspend. The receiver is already null checked.
+extern "C" uint32_t artStringEqualsFromCode(mirror::String* string,
+                                            mirror::Object* other)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  DCHECK(string != NULL);
+  // String is final, anything else of the same class is a string.
+  if (other == NULL || other->GetClass() != string->GetClass()) {
+    return 0;
+  }
+  return string->Equals(other->AsString()) ? 1 : 0;
+}
+
+}  // namespace art
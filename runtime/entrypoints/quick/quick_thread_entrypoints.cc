@@ -15,6 +15,7 @@
  */
 
 #include "callee_save_frame.h"
+#include "cutils/atomic-inline.h"
 #include "entrypoints/entrypoint_utils.h"
 #include "thread.h"
 #include "thread_list.h"
@@ -35,4 +36,14 @@ extern "C" void artTestSuspendFromCode(Thread* thread, mirror::ArtMethod** sp)
   CheckSuspend(thread);
 }
 
+extern "C" void artImplicitSuspendFromCode(Thread* thread, mirror::ArtMethod** sp)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  // Called when an implicit suspend check faulted. Re-arm the trigger before looking at the flags
+  // so that a request made meanwhile either is seen here or faults the next check.
+  FinishCalleeSaveFrameSetup(thread, sp, Runtime::kRefsOnly);
+  thread->RemoveSuspendTrigger();
+  ANDROID_MEMBAR_FULL();
+  CheckSuspend(thread);
+}
+
 }  // namespace art
@@ -96,6 +96,26 @@ class QuickArgumentVisitor {
 #define QUICK_CALLEE_SAVE_FRAME__REF_AND_ARGS__LR_OFFSET 28
 #define QUICK_CALLEE_SAVE_FRAME__REF_AND_ARGS__FRAME_SIZE 32
 #define QUICK_STACK_ARG_SKIP 16
+#elif defined(__x86_64__)
+  // The callee save frame is pointed to by SP.
+  // | argN            |  |
+  // | ...             |  |
+  // | arg4            |  |
+  // | arg3 spill      |  |  Caller's frame
+  // | arg2 spill      |  |
+  // | arg1 spill      |  |
+  // | Method*         | ---
+  // | Return          |
+  // | R15,R14,R13,R12 |    callee saves
+  // | RDI,RSI,RBP     |    callee saves
+  // | RBX             |    arg3
+  // | RDX             |    arg2
+  // | RCX             |    arg1
+  // | RAX/Method*     |  <- sp
+#define QUICK_CALLEE_SAVE_FRAME__REF_AND_ARGS__R1_OFFSET 8
+#define QUICK_CALLEE_SAVE_FRAME__REF_AND_ARGS__LR_OFFSET 88
+#define QUICK_CALLEE_SAVE_FRAME__REF_AND_ARGS__FRAME_SIZE 96
+#define QUICK_STACK_ARG_SKIP 32
 #else
 #error "Unsupported architecture"
 #define QUICK_CALLEE_SAVE_FRAME__REF_AND_ARGS__R1_OFFSET 0
@@ -388,27 +408,28 @@ extern "C" uint64_t artQuickProxyInvokeHandler(mirror::ArtMethod* proxy_method,
   // Create local ref. copies of proxy method and the receiver.
   jobject rcvr_jobj = soa.AddLocalReference<jobject>(receiver);
 
+  // Look up the interface method and the shorty. The plan is copied as the invocation handler may
+  // call other proxy methods.
+  DCHECK(!proxy_method->IsStatic()) << PrettyMethod(proxy_method);
+  const ProxyInvokePlan plan = self->GetProxyInvokeCache()->Get(proxy_method);
+
   // Placing arguments into args vector and remove the receiver.
-  MethodHelper proxy_mh(proxy_method);
-  DCHECK(!proxy_mh.IsStatic()) << PrettyMethod(proxy_method);
   std::vector<jvalue> args;
-  BuildQuickArgumentVisitor local_ref_visitor(sp, proxy_mh.IsStatic(), proxy_mh.GetShorty(),
-                                              proxy_mh.GetShortyLength(), &soa, &args);
+  args.reserve(plan.shorty_len);
+  BuildQuickArgumentVisitor local_ref_visitor(sp, false, plan.shorty, plan.shorty_len, &soa,
+                                              &args);
 
   local_ref_visitor.VisitArguments();
   DCHECK_GT(args.size(), 0U) << PrettyMethod(proxy_method);
   args.erase(args.begin());
 
   // Convert proxy method into expected interface method.
-  mirror::ArtMethod* interface_method = proxy_method->FindOverriddenMethod();
-  DCHECK(interface_method != NULL) << PrettyMethod(proxy_method);
-  DCHECK(!interface_method->IsProxyMethod()) << PrettyMethod(interface_method);
-  jobject interface_method_jobj = soa.AddLocalReference<jobject>(interface_method);
+  jobject interface_method_jobj = soa.AddLocalReference<jobject>(plan.interface_method);
 
   // All naked Object*s should now be in jobjects, so its safe to go into the main invoke code
   // that performs allocations.
   self->EndAssertNoThreadSuspension(old_cause);
-  JValue result = InvokeProxyInvocationHandler(soa, proxy_mh.GetShorty(),
+  JValue result = InvokeProxyInvocationHandler(soa, plan.shorty,
                                                rcvr_jobj, interface_method_jobj, args);
   return result.GetJ();
 }
@@ -57,12 +57,12 @@ class ExceptionTest : public CommonTest {
     fake_mapping_data_.PushBack(4);  // first element is count
     fake_mapping_data_.PushBack(4);  // total (non-length) elements
     fake_mapping_data_.PushBack(2);  // count of pc to dex elements
-                                      // ---  pc to dex table
+                                      // ---  pc to dex table, deltas from 0
     fake_mapping_data_.PushBack(3);  // offset 3
-    fake_mapping_data_.PushBack(3);  // maps to dex offset 3
-                                      // ---  dex to pc table
+    fake_mapping_data_.PushBackSigned(3);  // maps to dex offset 3
+                                      // ---  dex to pc table, deltas from 0
     fake_mapping_data_.PushBack(3);  // offset 3
-    fake_mapping_data_.PushBack(3);  // maps to dex offset 3
+    fake_mapping_data_.PushBackSigned(3);  // maps to dex offset 3
 
     fake_vmap_table_data_.PushBack(0);
 
@@ -217,6 +217,18 @@ TEST_F(ExceptionTest, StackTraceElement) {
   EXPECT_STREQ("f", trace_array->Get(1)->GetMethodName()->ToModifiedUtf8().c_str());
   EXPECT_EQ(22, trace_array->Get(1)->GetLineNumber());
 
+  // Capping the depth keeps the innermost frames.
+  jobject capped_internal = thread->CreateInternalStackTrace(soa, 1);
+  ASSERT_TRUE(capped_internal != NULL);
+  jobjectArray capped_ste_array =
+      Thread::InternalStackTraceToStackTraceElementArray(env, capped_internal);
+  ASSERT_TRUE(capped_ste_array != NULL);
+  mirror::ObjectArray<mirror::StackTraceElement>* capped_trace_array =
+      soa.Decode<mirror::ObjectArray<mirror::StackTraceElement>*>(capped_ste_array);
+  ASSERT_EQ(1, capped_trace_array->GetLength());
+  EXPECT_STREQ("g", capped_trace_array->Get(0)->GetMethodName()->ToModifiedUtf8().c_str());
+  EXPECT_EQ(37, capped_trace_array->Get(0)->GetLineNumber());
+
 #if !defined(ART_USE_PORTABLE_COMPILER)
   thread->SetTopOfStack(NULL, 0);  // Disarm the assertion that no code is running when we detach.
 #else
@@ -73,6 +73,27 @@ class AtomicStack {
     return true;
   }
 
+  // Atomically reserve num_slots consecutive slots, returning them as [*start_address,
+  // *end_address). Returns false if we overflowed the stack.
+  bool AtomicBumpBack(size_t num_slots, T** start_address, T** end_address) {
+    if (kIsDebugBuild) {
+      debug_is_sorted_ = false;
+    }
+    int32_t index;
+    int32_t new_index;
+    do {
+      index = back_index_;
+      new_index = index + num_slots;
+      if (UNLIKELY(static_cast<size_t>(new_index) >= capacity_)) {
+        // Stack overflow.
+        return false;
+      }
+    } while (!back_index_.compare_and_swap(index, new_index));
+    *start_address = &begin_[index];
+    *end_address = &begin_[new_index];
+    return true;
+  }
+
   void PushBack(const T& value) {
     if (kIsDebugBuild) {
       debug_is_sorted_ = false;
@@ -41,6 +41,20 @@ static inline bool byte_cas(byte old_value, byte new_value, byte* address) {
   return success;
 }
 
+// Returns the first word in [word_cur, word_end) which has a non clean card, or word_end. Most of
+// the card table is clean, so clean runs are skipped several words at a time.
+static inline uintptr_t* SkipCleanCardWords(uintptr_t* word_cur, uintptr_t* word_end) {
+  static constexpr size_t kWordsPerStep = 4;
+  while (static_cast<size_t>(word_end - word_cur) >= kWordsPerStep &&
+         (word_cur[0] | word_cur[1] | word_cur[2] | word_cur[3]) == 0) {
+    word_cur += kWordsPerStep;
+  }
+  while (word_cur < word_end && *word_cur == 0) {
+    ++word_cur;
+  }
+  return word_cur;
+}
+
 template <typename Visitor>
 inline size_t CardTable::Scan(SpaceBitmap* bitmap, byte* scan_begin, byte* scan_end,
                               const Visitor& visitor, const byte minimum_age) const {
@@ -66,15 +80,8 @@ inline size_t CardTable::Scan(SpaceBitmap* bitmap, byte* scan_begin, byte* scan_
       (reinterpret_cast<uintptr_t>(card_end) & (sizeof(uintptr_t) - 1));
 
   uintptr_t* word_end = reinterpret_cast<uintptr_t*>(aligned_end);
-  for (uintptr_t* word_cur = reinterpret_cast<uintptr_t*>(card_cur); word_cur < word_end;
-      ++word_cur) {
-    while (LIKELY(*word_cur == 0)) {
-      ++word_cur;
-      if (UNLIKELY(word_cur >= word_end)) {
-        goto exit_for;
-      }
-    }
-
+  for (uintptr_t* word_cur = SkipCleanCardWords(reinterpret_cast<uintptr_t*>(card_cur), word_end);
+       word_cur < word_end; word_cur = SkipCleanCardWords(word_cur + 1, word_end)) {
     // Find the first dirty card.
     uintptr_t start_word = *word_cur;
     uintptr_t start = reinterpret_cast<uintptr_t>(AddrFromCard(reinterpret_cast<byte*>(word_cur)));
@@ -92,7 +99,6 @@ inline size_t CardTable::Scan(SpaceBitmap* bitmap, byte* scan_begin, byte* scan_
       start += kCardSize;
     }
   }
-  exit_for:
 
   // Handle any unaligned cards at the end.
   card_cur = reinterpret_cast<byte*>(word_end);
@@ -146,7 +152,7 @@ inline void CardTable::ModifyCardsAtomic(byte* scan_begin, byte* scan_end, const
       new_value = visitor(expected);
     } while (expected != new_value && UNLIKELY(!byte_cas(expected, new_value, card_end)));
     if (expected != new_value) {
-      modified(card_cur, expected, new_value);
+      modified(card_end, expected, new_value);
     }
   }
 
@@ -156,8 +162,8 @@ inline void CardTable::ModifyCardsAtomic(byte* scan_begin, byte* scan_end, const
   uintptr_t expected_word;
   uintptr_t new_word;
 
-  // TODO: Parallelize.
-  while (word_cur < word_end) {
+  // Callers parallelize by splitting the range.
+  while ((word_cur = SkipCleanCardWords(word_cur, word_end)) < word_end) {
     while ((expected_word = *word_cur) != 0) {
       new_word =
           (visitor((expected_word >> 0) & 0xFF) << 0) |
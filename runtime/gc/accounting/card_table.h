@@ -124,6 +124,11 @@ class CardTable {
 
   bool AddrIsInCardTable(const void* addr) const;
 
+  // Bytes mapped for the card table.
+  size_t Size() const {
+    return mem_map_->Size();
+  }
+
  private:
   CardTable(MemMap* begin, byte* biased_begin, size_t offset);
 
@@ -16,6 +16,8 @@
 
 #include "mod_union_table.h"
 
+#include <algorithm>
+
 #include "base/stl_util.h"
 #include "card_table-inl.h"
 #include "heap_bitmap.h"
@@ -93,31 +95,35 @@ void ModUnionTableReferenceCache::ClearCards(space::ContinuousSpace* space) {
 class AddToReferenceArrayVisitor {
  public:
   explicit AddToReferenceArrayVisitor(ModUnionTableReferenceCache* mod_union_table,
-                                      std::vector<const Object*>* references)
+                                      const byte* card_begin, ModUnionTableReferenceCache::FieldOffsets* offsets)
     : mod_union_table_(mod_union_table),
-      references_(references) {
+      card_begin_(card_begin),
+      offsets_(offsets) {
   }
 
   // Extra parameters are required since we use this same visitor signature for checking objects.
-  void operator()(const Object* obj, const Object* ref, const MemberOffset& /* offset */,
+  void operator()(const Object* obj, const Object* ref, const MemberOffset& offset,
                   bool /* is_static */) const {
     // Only add the reference if it is non null and fits our criteria.
     if (ref != NULL && mod_union_table_->AddReference(obj, ref)) {
-      references_->push_back(ref);
+      const byte* field = reinterpret_cast<const byte*>(obj) + offset.Uint32Value();
+      offsets_->push_back(static_cast<uint32_t>(field - card_begin_));
     }
   }
 
  private:
   ModUnionTableReferenceCache* const mod_union_table_;
-  std::vector<const Object*>* const references_;
+  const byte* const card_begin_;
+  ModUnionTableReferenceCache::FieldOffsets* const offsets_;
 };
 
 class ModUnionReferenceVisitor {
  public:
   explicit ModUnionReferenceVisitor(ModUnionTableReferenceCache* const mod_union_table,
-                                    std::vector<const Object*>* references)
+                                    const byte* card_begin, ModUnionTableReferenceCache::FieldOffsets* offsets)
     : mod_union_table_(mod_union_table),
-      references_(references) {
+      card_begin_(card_begin),
+      offsets_(offsets) {
   }
 
   void operator()(const Object* obj) const
@@ -125,12 +131,13 @@ class ModUnionReferenceVisitor {
     DCHECK(obj != NULL);
     // We don't have an early exit since we use the visitor pattern, an early
     // exit should significantly speed this up.
-    AddToReferenceArrayVisitor visitor(mod_union_table_, references_);
+    AddToReferenceArrayVisitor visitor(mod_union_table_, card_begin_, offsets_);
     collector::MarkSweep::VisitObjectReferences(obj, visitor);
   }
  private:
   ModUnionTableReferenceCache* const mod_union_table_;
-  std::vector<const Object*>* const references_;
+  const byte* const card_begin_;
+  ModUnionTableReferenceCache::FieldOffsets* const offsets_;
 };
 
 class CheckReferenceVisitor {
@@ -189,18 +196,22 @@ class ModUnionCheckReferences {
 void ModUnionTableReferenceCache::Verify() {
   // Start by checking that everything in the mod union table is marked.
   Heap* heap = GetHeap();
-  for (const std::pair<const byte*, std::vector<const Object*> >& it : references_) {
-    for (const Object* ref : it.second) {
-      CHECK(heap->IsLiveObjectLocked(ref));
+  for (const std::pair<const byte*, FieldOffsetRange>& it : references_) {
+    for (size_t i = it.second.begin; i < it.second.begin + it.second.count; ++i) {
+      const Object* ref = *FieldAddress(it.first, field_offsets_[i]);
+      CHECK(ref == NULL || heap->IsLiveObjectLocked(ref));
     }
   }
 
   // Check the references of each clean card which is also in the mod union table.
   CardTable* card_table = heap->GetCardTable();
-  for (const std::pair<const byte*, std::vector<const Object*> > & it : references_) {
+  for (const std::pair<const byte*, FieldOffsetRange>& it : references_) {
     const byte* card = it.first;
     if (*card == CardTable::kCardClean) {
-      std::set<const Object*> reference_set(it.second.begin(), it.second.end());
+      std::set<const Object*> reference_set;
+      for (size_t i = it.second.begin; i < it.second.begin + it.second.count; ++i) {
+        reference_set.insert(*FieldAddress(card, field_offsets_[i]));
+      }
       ModUnionCheckReferences visitor(this, reference_set);
       uintptr_t start = reinterpret_cast<uintptr_t>(card_table->AddrFromCard(card));
       uintptr_t end = start + CardTable::kCardSize;
@@ -221,57 +232,112 @@ void ModUnionTableReferenceCache::Dump(std::ostream& os) {
     os << reinterpret_cast<void*>(start) << "-" << reinterpret_cast<void*>(end) << ",";
   }
   os << "]\nModUnionTable references: [";
-  for (const std::pair<const byte*, std::vector<const Object*> >& it : references_) {
+  for (const std::pair<const byte*, FieldOffsetRange>& it : references_) {
     const byte* card_addr = it.first;
     uintptr_t start = reinterpret_cast<uintptr_t>(card_table->AddrFromCard(card_addr));
     uintptr_t end = start + CardTable::kCardSize;
     os << reinterpret_cast<void*>(start) << "-" << reinterpret_cast<void*>(end) << "->{";
-    for (const mirror::Object* ref : it.second) {
-      os << reinterpret_cast<const void*>(ref) << ",";
+    for (size_t i = it.second.begin; i < it.second.begin + it.second.count; ++i) {
+      os << reinterpret_cast<const void*>(*FieldAddress(card_addr, field_offsets_[i])) << ",";
     }
     os << "},";
   }
 }
 
+const Object* const* ModUnionTableReferenceCache::FieldAddress(const byte* card,
+                                                               uint32_t offset) const {
+  const byte* card_begin = GetHeap()->GetCardTable()->AddrFromCard(card);
+  return reinterpret_cast<const Object* const*>(card_begin + offset);
+}
+
+void ModUnionTableReferenceCache::SetFieldOffsets(const byte* card,
+                                                  const FieldOffsets& offsets) {
+  auto found = references_.find(card);
+  if (found == references_.end()) {
+    if (offsets.empty()) {
+      // No reason to add an empty range.
+      return;
+    }
+    FieldOffsetRange range = { static_cast<uint32_t>(field_offsets_.size()),
+                               static_cast<uint32_t>(offsets.size()) };
+    field_offsets_.insert(field_offsets_.end(), offsets.begin(), offsets.end());
+    references_.Put(card, range);
+    return;
+  }
+  FieldOffsetRange& range = found->second;
+  if (offsets.empty()) {
+    unused_field_offsets_ += range.count;
+    references_.erase(found);
+  } else if (offsets.size() <= range.count) {
+    // Reuse the existing slots, this is the common case since cards rarely gain references.
+    std::copy(offsets.begin(), offsets.end(), field_offsets_.begin() + range.begin);
+    unused_field_offsets_ += range.count - offsets.size();
+    range.count = static_cast<uint32_t>(offsets.size());
+  } else {
+    unused_field_offsets_ += range.count;
+    range.begin = static_cast<uint32_t>(field_offsets_.size());
+    range.count = static_cast<uint32_t>(offsets.size());
+    field_offsets_.insert(field_offsets_.end(), offsets.begin(), offsets.end());
+  }
+}
+
+void ModUnionTableReferenceCache::MaybeCompactFieldOffsets() {
+  if (unused_field_offsets_ * 2 <= field_offsets_.size()) {
+    return;
+  }
+  FieldOffsets compacted;
+  compacted.reserve(field_offsets_.size() - unused_field_offsets_);
+  for (auto& it : references_) {
+    FieldOffsetRange& range = it.second;
+    const uint32_t begin = compacted.size();
+    compacted.insert(compacted.end(), field_offsets_.begin() + range.begin,
+                     field_offsets_.begin() + range.begin + range.count);
+    range.begin = begin;
+  }
+  field_offsets_.swap(compacted);
+  unused_field_offsets_ = 0;
+}
+
 void ModUnionTableReferenceCache::Update() {
   Heap* heap = GetHeap();
   CardTable* card_table = heap->GetCardTable();
 
-  std::vector<const Object*> cards_references;
-  ModUnionReferenceVisitor visitor(this, &cards_references);
-
+  FieldOffsets card_offsets;
+  space::ContinuousSpace* space = nullptr;
+  SpaceBitmap* live_bitmap = nullptr;
   for (const auto& card : cleared_cards_) {
     // Clear and re-compute alloc space references associated with this card.
-    cards_references.clear();
-    uintptr_t start = reinterpret_cast<uintptr_t>(card_table->AddrFromCard(card));
+    card_offsets.clear();
+    byte* card_begin = card_table->AddrFromCard(card);
+    uintptr_t start = reinterpret_cast<uintptr_t>(card_begin);
     uintptr_t end = start + CardTable::kCardSize;
-    auto* space = heap->FindContinuousSpaceFromObject(reinterpret_cast<Object*>(start), false);
-    DCHECK(space != nullptr);
-    SpaceBitmap* live_bitmap = space->GetLiveBitmap();
+    Object* obj_start = reinterpret_cast<Object*>(start);
+    if (UNLIKELY(space == nullptr || !space->Contains(obj_start))) {
+      space = heap->FindContinuousSpaceFromObject(obj_start, false);
+      DCHECK(space != nullptr);
+      live_bitmap = space->GetLiveBitmap();
+    }
+    ModUnionReferenceVisitor visitor(this, card_begin, &card_offsets);
     live_bitmap->VisitMarkedRange(start, end, visitor);
+    std::sort(card_offsets.begin(), card_offsets.end());
 
     // Update the corresponding references for the card.
-    auto found = references_.find(card);
-    if (found == references_.end()) {
-      if (cards_references.empty()) {
-        // No reason to add empty array.
-        continue;
-      }
-      references_.Put(card, cards_references);
-    } else {
-      found->second = cards_references;
-    }
+    SetFieldOffsets(card, card_offsets);
   }
   cleared_cards_.clear();
+  MaybeCompactFieldOffsets();
 }
 
 void ModUnionTableReferenceCache::MarkReferences(collector::MarkSweep* mark_sweep) {
   size_t count = 0;
 
-  for (const auto& ref : references_) {
-    for (const auto& obj : ref.second) {
-      mark_sweep->MarkRoot(obj);
-      ++count;
+  for (const auto& it : references_) {
+    for (size_t i = it.second.begin; i < it.second.begin + it.second.count; ++i) {
+      const Object* ref = *FieldAddress(it.first, field_offsets_[i]);
+      if (ref != NULL) {
+        mark_sweep->MarkRoot(ref);
+        ++count;
+      }
     }
   }
   if (VLOG_IS_ON(heap)) {
@@ -87,7 +87,10 @@ class ModUnionTable {
 // Reference caching implementation. Caches references pointing to alloc space(s) for each card.
 class ModUnionTableReferenceCache : public ModUnionTable {
  public:
-  explicit ModUnionTableReferenceCache(Heap* heap) : ModUnionTable(heap) {}
+  typedef std::vector<uint32_t, GCAllocator<uint32_t> > FieldOffsets;
+
+  explicit ModUnionTableReferenceCache(Heap* heap)
+      : ModUnionTable(heap), unused_field_offsets_(0) {}
   virtual ~ModUnionTableReferenceCache() {}
 
   // Clear and store cards for a space.
@@ -113,12 +116,36 @@ class ModUnionTableReferenceCache : public ModUnionTable {
   void Dump(std::ostream& os);
 
  protected:
+  // Where the field offsets of a card are stored in field_offsets_.
+  struct FieldOffsetRange {
+    uint32_t begin;
+    uint32_t count;
+  };
+
+  // Replaces the field offsets stored for a card.
+  void SetFieldOffsets(const byte* card, const FieldOffsets& offsets);
+
+  // Returns the address of the field at offset from the start of the card.
+  const mirror::Object* const* FieldAddress(const byte* card, uint32_t offset) const;
+
+  // Drops the unused entries of field_offsets_ once they make up more than half of it.
+  void MaybeCompactFieldOffsets();
+
   // Cleared card array, used to update the mod-union table.
   ModUnionTable::CardSet cleared_cards_;
 
-  // Maps from dirty cards to their corresponding alloc space references.
-  SafeMap<const byte*, std::vector<const mirror::Object*>, std::less<const byte*>,
-    GCAllocator<std::pair<const byte*, std::vector<const mirror::Object*> > > > references_;
+  // Maps from cards to the offsets, relative to the start of the card, of the fields of the objects
+  // on the card which reference the alloc space(s). Fields are read again when marking since a
+  // write to any of them dirties the card, which then is cleared and updated before we mark.
+  SafeMap<const byte*, FieldOffsetRange, std::less<const byte*>,
+    GCAllocator<std::pair<const byte*, FieldOffsetRange> > > references_;
+
+  // Sorted field offsets of all the cards in references_, packed into one array so that updating
+  // a card does not allocate unless it gained references.
+  FieldOffsets field_offsets_;
+
+  // How many entries of field_offsets_ are no longer used by any card.
+  size_t unused_field_offsets_;
 };
 
 // Card caching implementation. Keeps track of which cards we cleared and only this information.
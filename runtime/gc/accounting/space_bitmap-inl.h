@@ -70,7 +70,7 @@ void SpaceBitmap::VisitMarkedRange(uintptr_t visit_begin, uintptr_t visit_end,
   // Handle bits on the left first as a special case
   size_t left_bits = bit_index_start & (kBitsPerWord - 1);
   if (left_bits != 0) {
-    edge_word &= (1 << (kBitsPerWord - left_bits)) - 1;
+    edge_word &= (static_cast<size_t>(1) << (kBitsPerWord - left_bits)) - 1;
   }
 
   // If word_start == word_end then handle this case at the same place we handle the right edge.
@@ -85,17 +85,16 @@ void SpaceBitmap::VisitMarkedRange(uintptr_t visit_begin, uintptr_t visit_end,
   }
   word_start++;
 
-  for (size_t i = word_start; i < word_end; i++) {
+  for (size_t i = SkipZeroWords(bitmap_begin_, word_start, word_end); i < word_end;
+       i = SkipZeroWords(bitmap_begin_, i + 1, word_end)) {
     size_t w = bitmap_begin_[i];
-    if (w != 0) {
-      uintptr_t ptr_base = IndexToOffset(i) + heap_begin_;
-      do {
-        const size_t shift = CLZ(w);
-        mirror::Object* obj = reinterpret_cast<mirror::Object*>(ptr_base + shift * kAlignment);
-        visitor(obj);
-        w ^= static_cast<size_t>(kWordHighBitMask) >> shift;
-      } while (w != 0);
-    }
+    uintptr_t ptr_base = IndexToOffset(i) + heap_begin_;
+    do {
+      const size_t shift = CLZ(w);
+      mirror::Object* obj = reinterpret_cast<mirror::Object*>(ptr_base + shift * kAlignment);
+      visitor(obj);
+      w ^= static_cast<size_t>(kWordHighBitMask) >> shift;
+    } while (w != 0);
   }
 
   // Handle the right edge, and also the left edge if both edges are on the same word.
@@ -151,6 +151,11 @@ void SpaceBitmap::SweepWalk(const SpaceBitmap& live_bitmap,
   word* live = live_bitmap.bitmap_begin_;
   word* mark = mark_bitmap.bitmap_begin_;
   for (size_t i = start; i <= end; i++) {
+    // Skip words without live objects a few at a time, most of a sparse space is free.
+    i = SkipZeroWords(live, i, end + 1);
+    if (i > end) {
+      break;
+    }
     word garbage = live[i] & ~mark[i];
     if (UNLIKELY(garbage != 0)) {
       uintptr_t ptr_base = IndexToOffset(i) + live_bitmap.heap_begin_;
@@ -172,6 +177,23 @@ void SpaceBitmap::SweepWalk(const SpaceBitmap& live_bitmap,
   }
 }
 
+void SpaceBitmap::PartitionRange(uintptr_t begin, uintptr_t end, size_t count, size_t min_size,
+                                 std::vector<std::pair<uintptr_t, uintptr_t> >* ranges) const {
+  DCHECK_LE(begin, end);
+  DCHECK_GE(begin, heap_begin_);
+  const uintptr_t word_heap_size = IndexToOffset(1);
+  size_t chunk_size = (end - begin) / std::max(count, static_cast<size_t>(1));
+  chunk_size = RoundUp(std::max(chunk_size, min_size), word_heap_size);
+  while (begin < end) {
+    // Chunk ends are rounded down to the bitmap word containing begin + chunk_size, this is always
+    // past begin since chunk_size is at least a word.
+    uintptr_t chunk_end = RoundDown(begin - heap_begin_ + chunk_size, word_heap_size) + heap_begin_;
+    chunk_end = std::min(chunk_end, end);
+    ranges->push_back(std::make_pair(begin, chunk_end));
+    begin = chunk_end;
+  }
+}
+
 static void WalkFieldsInOrder(SpaceBitmap* visited, SpaceBitmap::Callback* callback, mirror::Object* obj,
                               void* arg);
 
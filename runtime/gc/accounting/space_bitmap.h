@@ -129,6 +129,12 @@ class SpaceBitmap {
       EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Splits [begin, end) into ranges of roughly (end - begin) / count bytes, but no smaller than
+  // min_size, for visiting in parallel. Ranges end on bitmap word boundaries so that no two ranges
+  // share a bitmap word.
+  void PartitionRange(uintptr_t begin, uintptr_t end, size_t count, size_t min_size,
+                      std::vector<std::pair<uintptr_t, uintptr_t> >* ranges) const;
+
   void Walk(Callback* callback, void* arg)
       SHARED_LOCKS_REQUIRED(Locks::heap_bitmap_lock_);
 
@@ -190,6 +196,19 @@ class SpaceBitmap {
 
   bool Modify(const mirror::Object* obj, bool do_set);
 
+  // Returns the index of the first non zero word in [index, end_index), or end_index. Sparse
+  // bitmaps are mostly zero so runs of zero words are skipped a few words at a time.
+  static size_t SkipZeroWords(const word* words, size_t index, size_t end_index) {
+    while (index + 4 <= end_index &&
+           (words[index] | words[index + 1] | words[index + 2] | words[index + 3]) == 0) {
+      index += 4;
+    }
+    while (index < end_index && words[index] == 0) {
+      ++index;
+    }
+    return index;
+  }
+
   // Backing storage for bitmap.
   UniquePtr<MemMap> mem_map_;
 
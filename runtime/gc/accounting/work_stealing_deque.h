@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_GC_ACCOUNTING_WORK_STEALING_DEQUE_H_
+#define ART_RUNTIME_GC_ACCOUNTING_WORK_STEALING_DEQUE_H_
+
+#include "atomic_integer.h"
+#include "base/logging.h"
+#include "base/macros.h"
+#include "cutils/atomic-inline.h"
+#include "utils.h"
+
+namespace art {
+namespace gc {
+namespace accounting {
+
+// Fixed capacity Chase-Lev deque. A single owner thread pushes and pops at the bottom while any
+// number of other threads may concurrently steal from the top. Since the capacity is fixed, the
+// owner must check IsFull and make room before pushing.
+template <typename T, size_t kCapacity>
+class WorkStealingDeque {
+ public:
+  WorkStealingDeque() : top_(0), bottom_(0) {
+    COMPILE_ASSERT((kCapacity & (kCapacity - 1)) == 0, deque_capacity_must_be_a_power_of_two);
+  }
+
+  // Approximate when called from a thread other than the owner.
+  size_t Size() const {
+    int32_t size = bottom_.load() - top_.load();
+    return size > 0 ? static_cast<size_t>(size) : 0;
+  }
+
+  bool IsEmpty() const {
+    return Size() == 0;
+  }
+
+  // Owner only.
+  bool IsFull() const {
+    return Size() >= kCapacity;
+  }
+
+  // Owner only. The caller must make sure that the deque is not full.
+  void PushBottom(const T& value) {
+    const int32_t bottom = bottom_.load();
+    DCHECK_LT(static_cast<size_t>(bottom - top_.load()), kCapacity);
+    elements_[bottom & kMask] = value;
+    // Publish the element before the new bottom.
+    android_memory_barrier();
+    bottom_.store(bottom + 1);
+  }
+
+  // Owner only. Returns false if the deque was empty or a thief took the last element.
+  bool PopBottom(T* value) {
+    const int32_t bottom = bottom_.load() - 1;
+    bottom_.store(bottom);
+    // The store of bottom must be visible before we read top, otherwise we may race with a thief
+    // for the last element without noticing.
+    android_memory_barrier();
+    const int32_t top = top_.load();
+    if (UNLIKELY(bottom < top)) {
+      // Empty, restore the canonical empty state.
+      bottom_.store(top);
+      return false;
+    }
+    *value = elements_[bottom & kMask];
+    if (bottom > top) {
+      // More than one element left, no thief can be racing for this one.
+      return true;
+    }
+    // Last element, race the thieves for it.
+    const bool won = top_.compare_and_swap(top, top + 1);
+    bottom_.store(top + 1);
+    return won;
+  }
+
+  // Any thread. Returns false if the deque was empty or we lost a race with another thread.
+  bool StealTop(T* value) {
+    const int32_t top = top_.load();
+    // Read top before bottom so that we never see a bottom older than top.
+    android_memory_barrier();
+    const int32_t bottom = bottom_.load();
+    if (bottom <= top) {
+      return false;
+    }
+    T element = elements_[top & kMask];
+    if (!top_.compare_and_swap(top, top + 1)) {
+      return false;
+    }
+    *value = element;
+    return true;
+  }
+
+ private:
+  static constexpr size_t kMask = kCapacity - 1;
+
+  // Index of the next element to be stolen.
+  AtomicInteger top_;
+  // Index of the next free slot at the owner's end.
+  AtomicInteger bottom_;
+  T elements_[kCapacity];
+
+  DISALLOW_COPY_AND_ASSIGN(WorkStealingDeque);
+};
+
+}  // namespace accounting
+}  // namespace gc
+}  // namespace art
+
+#endif  // ART_RUNTIME_GC_ACCOUNTING_WORK_STEALING_DEQUE_H_
@@ -37,6 +37,15 @@ static void art_heap_usage_error(const char* function, void* p);
 #pragma GCC diagnostic warning "-Wstrict-aliasing"
 #pragma GCC diagnostic warning "-Wempty-body"
 
+// Ensure the chunk layout mirrored in dlmalloc.h matches the configuration of malloc.c.
+COMPILE_ASSERT(!FOOTERS, dlmalloc_footers_unsupported);
+COMPILE_ASSERT(kDlmallocChunkOverhead == CHUNK_OVERHEAD, dlmalloc_chunk_overhead_mismatch);
+COMPILE_ASSERT(kDlmallocChunkAlignment == MALLOC_ALIGNMENT, dlmalloc_alignment_mismatch);
+COMPILE_ASSERT(kDlmallocMinChunkSize == MIN_CHUNK_SIZE, dlmalloc_min_chunk_size_mismatch);
+COMPILE_ASSERT(kDlmallocPrevInUseBit == PINUSE_BIT, dlmalloc_pinuse_bit_mismatch);
+COMPILE_ASSERT(kDlmallocCurrentInUseBit == CINUSE_BIT, dlmalloc_cinuse_bit_mismatch);
+COMPILE_ASSERT(kDlmallocFlagBits == FLAG_BITS, dlmalloc_flag_bits_mismatch);
+
 
 static void art_heap_corruption(const char* function) {
   LOG(FATAL) << "Corrupt heap detected in: " << function;
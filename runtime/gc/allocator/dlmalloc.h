@@ -33,6 +33,16 @@
 extern "C" void dlmalloc_inspect_all(void(*handler)(void*, void *, size_t, void*), void* arg);
 extern "C" int  dlmalloc_trim(size_t);
 
+// Mirrors of dlmalloc's private chunk layout constants from malloc.c, used by code that carves
+// chunks out of a larger allocation without calling back into dlmalloc (see
+// DlMallocSpace::AllocThreadLocal). Checked against the real definitions in dlmalloc.cc.
+static const size_t kDlmallocChunkOverhead = sizeof(size_t);
+static const size_t kDlmallocChunkAlignment = 2 * sizeof(void*);
+static const size_t kDlmallocMinChunkSize = 4 * sizeof(size_t);
+static const size_t kDlmallocPrevInUseBit = 1;
+static const size_t kDlmallocCurrentInUseBit = 2;
+static const size_t kDlmallocFlagBits = 7;
+
 // Callback for dlmalloc_inspect_all or mspace_inspect_all that will madvise(2) unused
 // pages back to the kernel.
 extern "C" void DlmallocMadviseCallback(void* start, void* end, size_t used_bytes, void* /*arg*/);
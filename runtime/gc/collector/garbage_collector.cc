@@ -39,7 +39,9 @@ GarbageCollector::GarbageCollector(Heap* heap, const std::string& name)
       verbose_(VLOG_IS_ON(heap)),
       duration_ns_(0),
       timings_(name_.c_str(), true, verbose_),
-      cumulative_timings_(name) {
+      cumulative_timings_(name),
+      pause_histogram_(name_ + " paused"),
+      duration_histogram_(name_ + " total") {
   ResetCumulativeStatistics();
 }
 
@@ -58,6 +60,8 @@ void GarbageCollector::ResetCumulativeStatistics() {
   total_paused_time_ns_ = 0;
   total_freed_objects_ = 0;
   total_freed_bytes_ = 0;
+  pause_histogram_.Reset();
+  duration_histogram_.Reset();
 }
 
 void GarbageCollector::Run() {
@@ -108,6 +112,10 @@ void GarbageCollector::Run() {
 
   uint64_t end_time = NanoTime();
   duration_ns_ = end_time - start_time;
+  for (uint64_t pause_time : pause_times_) {
+    pause_histogram_.AddValue(pause_time / 1000);
+  }
+  duration_histogram_.AddValue(duration_ns_ / 1000);
 
   FinishPhase();
 }
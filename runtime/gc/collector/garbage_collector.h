@@ -19,6 +19,7 @@
 
 #include "gc_type.h"
 #include "locks.h"
+#include "base/concurrent_histogram.h"
 #include "base/timing_logger.h"
 
 #include <stdint.h>
@@ -72,6 +73,16 @@ class GarbageCollector {
     return cumulative_timings_;
   }
 
+  // Distribution of the individual mutator pauses, in microseconds.
+  ConcurrentHistogram& GetPauseHistogram() {
+    return pause_histogram_;
+  }
+
+  // Distribution of the total GC durations, in microseconds.
+  ConcurrentHistogram& GetDurationHistogram() {
+    return duration_histogram_;
+  }
+
   void ResetCumulativeStatistics();
 
   // Swap the live and mark bitmaps of spaces that are active for the collector. For partial GC,
@@ -110,6 +121,8 @@ class GarbageCollector {
   uint64_t total_freed_bytes_;
 
   CumulativeLogger cumulative_timings_;
+  ConcurrentHistogram pause_histogram_;
+  ConcurrentHistogram duration_histogram_;
 
   std::vector<uint64_t> pause_times_;
 };
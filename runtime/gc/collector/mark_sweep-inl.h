@@ -132,17 +132,30 @@ inline void MarkSweep::VisitFieldsReferences(const mirror::Object* obj, uint32_t
     // There is no reference offset bitmap.  In the non-static case,
     // walk up the class inheritance hierarchy and find reference
     // offsets the hard way. In the static case, just consider this
-    // class.
+    // class. ClassLinker::LinkFields places the reference fields of a
+    // class in one run at the start of the fields that class adds, so
+    // the offsets follow from the field counts without reading fields.
     for (const mirror::Class* klass = is_static ? obj->AsClass() : obj->GetClass();
          klass != NULL;
          klass = is_static ? NULL : klass->GetSuperClass()) {
       size_t num_reference_fields = (is_static
                                      ? klass->NumReferenceStaticFields()
                                      : klass->NumReferenceInstanceFields());
-      for (size_t i = 0; i < num_reference_fields; ++i) {
-        mirror::ArtField* field = (is_static ? klass->GetStaticField(i)
-                                   : klass->GetInstanceField(i));
-        MemberOffset field_offset = field->GetOffset();
+      if (num_reference_fields == 0) {
+        continue;
+      }
+      uint32_t offset;
+      if (is_static) {
+        offset = mirror::Class::FieldsOffset().Uint32Value();
+      } else {
+        const mirror::Class* super_class = klass->GetSuperClass();
+        offset = super_class != NULL ? super_class->GetObjectSize() : 0;
+      }
+      for (size_t i = 0; i < num_reference_fields; ++i, offset += sizeof(uint32_t)) {
+        MemberOffset field_offset(offset);
+        DCHECK_EQ(field_offset.Uint32Value(),
+                  (is_static ? klass->GetStaticField(i)
+                   : klass->GetInstanceField(i))->GetOffset().Uint32Value());
         const mirror::Object* ref = obj->GetFieldObject<const mirror::Object*>(field_offset, false);
         visitor(obj, ref, field_offset, is_static);
       }
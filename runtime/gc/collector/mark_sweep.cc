@@ -16,19 +16,24 @@
 
 #include "mark_sweep.h"
 
+#include <algorithm>
 #include <functional>
 #include <numeric>
 #include <climits>
+#include <sched.h>
 #include <vector>
 
 #include "base/bounded_fifo.h"
 #include "base/logging.h"
 #include "base/macros.h"
 #include "base/mutex-inl.h"
+#include "base/stl_util.h"
 #include "base/timing_logger.h"
+#include "debugger.h"
 #include "gc/accounting/card_table-inl.h"
 #include "gc/accounting/heap_bitmap.h"
 #include "gc/accounting/space_bitmap-inl.h"
+#include "gc/accounting/work_stealing_deque.h"
 #include "gc/heap.h"
 #include "gc/space/image_space.h"
 #include "gc/space/large_object_space.h"
@@ -64,6 +69,9 @@ namespace collector {
 constexpr bool kUseRecursiveMark = false;
 constexpr bool kUseMarkStackPrefetch = true;
 constexpr size_t kSweepArrayChunkFreeSize = 1024;
+// Concurrent collections mark the thread roots a second time through a checkpoint before the
+// pause, so that the pause only marks what the mutators changed since.
+constexpr bool kPreCleanThreadRoots = true;
 
 // Parallelism options.
 constexpr bool kParallelCardScan = true;
@@ -74,6 +82,14 @@ constexpr bool kParallelRecursiveMark = true;
 // ProcessMarkStack with very small mark stacks.
 constexpr size_t kMinimumParallelMarkStackSize = 128;
 constexpr bool kParallelProcessMarkStack = true;
+// Don't split reference lists shorter than this across the GC threads.
+constexpr size_t kMinimumParallelReferenceListSize = 4 * KB;
+constexpr bool kParallelProcessReferences = true;
+constexpr bool kParallelSweep = true;
+// Minimum amount of heap, and minimum number of allocation stack entries, handed to a single sweep
+// task. Smaller ranges are not worth the overhead of a task.
+constexpr size_t kMinimumParallelSweepSize = 256 * KB;
+constexpr size_t kMinimumParallelSweepArraySize = 4 * kSweepArrayChunkFreeSize;
 
 // Profiling and information flags.
 constexpr bool kCountClassesMarked = false;
@@ -211,6 +227,7 @@ bool MarkSweep::HandleDirtyObjectsPhase() {
   // Only need to do this if we have the card mark verification on, and only during concurrent GC.
   if (GetHeap()->verify_missing_card_marks_ || GetHeap()->verify_pre_gc_heap_||
       GetHeap()->verify_post_gc_heap_) {
+    heap_->RevokeAllThreadLocalBuffers();
     WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
     // This second sweep makes sure that we don't have any objects in the live stack which point to
     // freed objects. These cause problems since their references may be previously freed objects.
@@ -245,7 +262,7 @@ void MarkSweep::MarkingPhase() {
   FindDefaultMarkBitmap();
 
   // Process dirty cards and add dirty cards to mod union tables.
-  heap_->ProcessCards(timings_);
+  heap_->ProcessCards(timings_, GetThreadCount(!IsConcurrent()));
 
   // Need to do this before the checkpoint since we don't want any threads to add references to
   // the live stack during the recursive mark.
@@ -255,6 +272,7 @@ void MarkSweep::MarkingPhase() {
   WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
   if (Locks::mutator_lock_->IsExclusiveHeld(self)) {
     // If we exclusively hold the mutator lock, all threads must be suspended.
+    heap_->RevokeAllThreadLocalBuffers();
     MarkRoots();
   } else {
     MarkThreadRoots(self);
@@ -266,6 +284,18 @@ void MarkSweep::MarkingPhase() {
 
   heap_->UpdateAndMarkModUnion(this, timings_, GetGcType());
   MarkReachableObjects();
+
+  if (kPreCleanThreadRoots && IsConcurrent()) {
+    PreCleanThreadRoots(self);
+  }
+}
+
+void MarkSweep::PreCleanThreadRoots(Thread* self) {
+  base::TimingLogger::ScopedSplit split("PreCleanThreadRoots", &timings_);
+  // Each thread marks its roots at its next suspend point, without stopping the others. Then
+  // trace from them and from the objects on the cards dirtied while marking.
+  MarkRootsCheckpoint(self);
+  RecursiveMarkDirtyObjects(false, accounting::CardTable::kCardDirty);
 }
 
 void MarkSweep::MarkThreadRoots(Thread* self) {
@@ -344,6 +374,8 @@ void MarkSweep::ReclaimPhase() {
     // Unbind the live and mark bitmaps.
     UnBindBitmaps();
   }
+
+  FreeLargeObjects();
 }
 
 void MarkSweep::SetImmuneRange(Object* begin, Object* end) {
@@ -626,19 +658,24 @@ class ScanObjectVisitor {
   MarkSweep* const mark_sweep_;
 };
 
+// Mark stack tasks keep their mark stack in a work stealing deque. Once a worker thread finishes
+// its own task it steals half of the mark stack of a task which is still running instead of going
+// idle. Stealing assumes that all of the tasks running on the thread pool at the same time are
+// mark stack tasks.
 template <bool kUseFinger = false>
-class MarkStackTask : public Task {
+class MarkStackTask : public WorkStealingTask {
  public:
   MarkStackTask(ThreadPool* thread_pool, MarkSweep* mark_sweep, size_t mark_stack_size,
                 const Object** mark_stack)
       : mark_sweep_(mark_sweep),
-        thread_pool_(thread_pool),
-        mark_stack_pos_(mark_stack_size) {
+        thread_pool_(thread_pool) {
     // We may have to copy part of an existing mark stack when another mark stack overflows.
     if (mark_stack_size != 0) {
       DCHECK(mark_stack != NULL);
-      // TODO: Check performance?
-      std::copy(mark_stack, mark_stack + mark_stack_size, mark_stack_);
+      DCHECK(mark_stack_size <= kMaxSize);
+      for (size_t i = 0; i < mark_stack_size; ++i) {
+        mark_stack_.PushBottom(mark_stack[i]);
+      }
     }
     if (kCountTasks) {
       ++mark_sweep_->work_chunks_created_;
@@ -677,7 +714,7 @@ class MarkStackTask : public Task {
 
   virtual ~MarkStackTask() {
     // Make sure that we have cleared our mark stack.
-    DCHECK_EQ(mark_stack_pos_, 0U);
+    DCHECK(mark_stack_.IsEmpty());
     if (kCountTasks) {
       ++mark_sweep_->work_chunks_deleted_;
     }
@@ -685,42 +722,64 @@ class MarkStackTask : public Task {
 
   MarkSweep* const mark_sweep_;
   ThreadPool* const thread_pool_;
-  // Thread local mark stack for this task.
-  const Object* mark_stack_[kMaxSize];
-  // Mark stack position.
-  size_t mark_stack_pos_;
+  // Thread local mark stack for this task, other workers may steal from the top of it.
+  accounting::WorkStealingDeque<const Object*, kMaxSize> mark_stack_;
 
   void MarkStackPush(const Object* obj) ALWAYS_INLINE {
-    if (UNLIKELY(mark_stack_pos_ == kMaxSize)) {
+    if (UNLIKELY(mark_stack_.IsFull())) {
       // Mark stack overflow, give 1/2 the stack to the thread pool as a new work task.
-      mark_stack_pos_ /= 2;
-      auto* task = new MarkStackTask(thread_pool_, mark_sweep_, kMaxSize - mark_stack_pos_,
-                                     mark_stack_ + mark_stack_pos_);
-      thread_pool_->AddTask(Thread::Current(), task);
+      const Object* overflow[kMaxSize / 2];
+      size_t overflow_count = 0;
+      while (overflow_count < kMaxSize / 2 && mark_stack_.PopBottom(&overflow[overflow_count])) {
+        ++overflow_count;
+      }
+      // The objects were just pushed and are likely still in the cache, so the next idle worker
+      // should pick them up before the tasks queued at the start of marking.
+      auto* task = new MarkStackTask(thread_pool_, mark_sweep_, overflow_count, overflow);
+      thread_pool_->AddTask(Thread::Current(), task, kTaskPriorityHigh);
     }
     DCHECK(obj != nullptr);
-    DCHECK(mark_stack_pos_ < kMaxSize);
-    mark_stack_[mark_stack_pos_++] = obj;
+    mark_stack_.PushBottom(obj);
   }
 
   virtual void Finalize() {
     delete this;
   }
 
+  // Steal half of the mark stack of a task which is still running and process it.
+  virtual void StealFrom(Thread* self, WorkStealingTask* source) {
+    auto* source_task = down_cast<MarkStackTask<kUseFinger>*>(source);
+    DCHECK(mark_stack_.IsEmpty());
+    const size_t steal_count = std::min(source_task->mark_stack_.Size() / 2 + 1,
+                                        static_cast<size_t>(kMaxSize));
+    size_t stolen = 0;
+    const Object* obj = NULL;
+    while (stolen < steal_count && source_task->mark_stack_.StealTop(&obj)) {
+      DCHECK(obj != NULL);
+      mark_stack_.PushBottom(obj);
+      ++stolen;
+    }
+    if (stolen == 0) {
+      // Nothing to steal right now, give the owner a chance to produce some work.
+      sched_yield();
+      return;
+    }
+    MarkStackTask::Run(self);
+  }
+
   // Scans all of the objects
   virtual void Run(Thread* self) {
     ScanObjectParallelVisitor visitor(this);
-    // TODO: Tune this.
-    static const size_t kFifoSize = 4;
-    BoundedFifoPowerOfTwo<const Object*, kFifoSize> prefetch_fifo;
+    const size_t prefetch_depth = mark_sweep_->GetHeap()->GetMarkStackPrefetchDepth();
+    BoundedFifoPowerOfTwo<const Object*, Heap::kMaxMarkStackPrefetchDepth> prefetch_fifo;
     for (;;) {
       const Object* obj = NULL;
-      if (kUseMarkStackPrefetch) {
-        while (mark_stack_pos_ != 0 && prefetch_fifo.size() < kFifoSize) {
-          const Object* obj = mark_stack_[--mark_stack_pos_];
-          DCHECK(obj != NULL);
-          __builtin_prefetch(obj);
-          prefetch_fifo.push_back(obj);
+      if (kUseMarkStackPrefetch && prefetch_depth != 0) {
+        const Object* prefetch_obj = NULL;
+        while (prefetch_fifo.size() < prefetch_depth && mark_stack_.PopBottom(&prefetch_obj)) {
+          DCHECK(prefetch_obj != NULL);
+          __builtin_prefetch(prefetch_obj);
+          prefetch_fifo.push_back(prefetch_obj);
         }
         if (UNLIKELY(prefetch_fifo.empty())) {
           break;
@@ -728,10 +787,9 @@ class MarkStackTask : public Task {
         obj = prefetch_fifo.front();
         prefetch_fifo.pop_front();
       } else {
-        if (UNLIKELY(mark_stack_pos_ == 0)) {
+        if (UNLIKELY(!mark_stack_.PopBottom(&obj))) {
           break;
         }
-        obj = mark_stack_[--mark_stack_pos_];
       }
       DCHECK(obj != NULL);
       visitor(obj);
@@ -963,15 +1021,11 @@ void MarkSweep::RecursiveMark() {
           atomic_finger_ = static_cast<int32_t>(0xFFFFFFFF);
 
           // Create a few worker tasks.
-          const size_t n = thread_count * 2;
-          while (begin != end) {
-            uintptr_t start = begin;
-            uintptr_t delta = (end - begin) / n;
-            delta = RoundUp(delta, KB);
-            if (delta < 16 * KB) delta = end - begin;
-            begin += delta;
-            auto* task = new RecursiveMarkTask(thread_pool, this, current_mark_bitmap_, start,
-                                               begin);
+          std::vector<std::pair<uintptr_t, uintptr_t> > ranges;
+          current_mark_bitmap_->PartitionRange(begin, end, thread_count * 2, 16 * KB, &ranges);
+          for (const auto& range : ranges) {
+            auto* task = new RecursiveMarkTask(thread_pool, this, current_mark_bitmap_,
+                                               range.first, range.second);
             thread_pool->AddTask(self, task);
           }
           thread_pool->SetMaxActiveWorkers(thread_count - 1);
@@ -1030,9 +1084,14 @@ bool MarkSweep::IsMarkedArrayCallback(const Object* object, void* arg) {
 void MarkSweep::SweepSystemWeaks() {
   Runtime* runtime = Runtime::Current();
   timings_.StartSplit("SweepSystemWeaks");
-  runtime->GetInternTable()->SweepInternTableWeaks(IsMarkedCallback, this);
-  runtime->GetMonitorList()->SweepMonitorList(IsMarkedCallback, this);
+  // The thread pool is idle while the GC sweeps, the shards can be swept in parallel.
+  runtime->GetInternTable()->SweepInternTableWeaks(IsMarkedCallback, this,
+                                                   GetHeap()->GetThreadPool());
+  // Idle monitors can only be deflated while the mutators are suspended.
+  bool deflate_idle = Locks::mutator_lock_->IsExclusiveHeld(Thread::Current());
+  runtime->GetMonitorList()->SweepMonitorList(IsMarkedCallback, this, deflate_idle);
   SweepJniWeakGlobals(IsMarkedCallback, this);
+  Dbg::SweepObjectRegistry(IsMarkedCallback, this);
   timings_.EndSplit();
 }
 
@@ -1061,14 +1120,17 @@ void MarkSweep::VerifySystemWeaks() {
   Runtime* runtime = Runtime::Current();
   // Verify system weaks, uses a special IsMarked callback which always returns true.
   runtime->GetInternTable()->SweepInternTableWeaks(VerifyIsLiveCallback, this);
-  runtime->GetMonitorList()->SweepMonitorList(VerifyIsLiveCallback, this);
+  runtime->GetMonitorList()->SweepMonitorList(VerifyIsLiveCallback, this, false);
   runtime->GetJavaVM()->SweepWeakGlobals(VerifyIsLiveCallback, this);
+  Dbg::SweepObjectRegistry(VerifyIsLiveCallback, this);
 }
 
 struct SweepCallbackContext {
   MarkSweep* mark_sweep;
   space::AllocSpace* space;
   Thread* self;
+  size_t freed_objects;
+  size_t freed_bytes;
 };
 
 class CheckpointMarkThreadRoots : public Closure {
@@ -1082,6 +1144,8 @@ class CheckpointMarkThreadRoots : public Closure {
     CHECK(thread == self || thread->IsSuspended() || thread->GetState() == kWaitingPerformingGc)
         << thread->GetState() << " thread " << thread << " self " << self;
     thread->VisitRoots(MarkSweep::MarkRootParallelCallback, mark_sweep_);
+    // Objects allocated before the stacks were swapped must be individually sweepable.
+    Runtime::Current()->GetHeap()->RevokeThreadLocalBuffers(thread);
     ATRACE_END();
     mark_sweep_->GetBarrier().Pass(self);
   }
@@ -1112,25 +1176,21 @@ void MarkSweep::MarkRootsCheckpoint(Thread* self) {
 
 void MarkSweep::SweepCallback(size_t num_ptrs, Object** ptrs, void* arg) {
   SweepCallbackContext* context = static_cast<SweepCallbackContext*>(arg);
-  MarkSweep* mark_sweep = context->mark_sweep;
-  Heap* heap = mark_sweep->GetHeap();
   space::AllocSpace* space = context->space;
-  Thread* self = context->self;
-  Locks::heap_bitmap_lock_->AssertExclusiveHeld(self);
   // Use a bulk free, that merges consecutive objects before freeing or free per object?
   // Documentation suggests better free performance with merging, but this may be at the expensive
   // of allocation.
   size_t freed_objects = num_ptrs;
   // AllocSpace::FreeList clears the value in ptrs, so perform after clearing the live bit
-  size_t freed_bytes = space->FreeList(self, num_ptrs, ptrs);
-  heap->RecordFree(freed_objects, freed_bytes);
-  mark_sweep->freed_objects_.fetch_add(freed_objects);
-  mark_sweep->freed_bytes_.fetch_add(freed_bytes);
+  size_t freed_bytes = space->FreeList(context->self, num_ptrs, ptrs);
+  // The frees are recorded by the GC thread once the sweep is done, RecordFree isn't thread safe
+  // when runtime stats are enabled.
+  context->freed_objects += freed_objects;
+  context->freed_bytes += freed_bytes;
 }
 
 void MarkSweep::ZygoteSweepCallback(size_t num_ptrs, Object** ptrs, void* arg) {
   SweepCallbackContext* context = static_cast<SweepCallbackContext*>(arg);
-  Locks::heap_bitmap_lock_->AssertExclusiveHeld(context->self);
   Heap* heap = context->mark_sweep->GetHeap();
   // We don't free any actual memory to avoid dirtying the shared zygote pages.
   for (size_t i = 0; i < num_ptrs; ++i) {
@@ -1140,9 +1200,143 @@ void MarkSweep::ZygoteSweepCallback(size_t num_ptrs, Object** ptrs, void* arg) {
   }
 }
 
+// Sweeps the garbage between begin and end of a continuous space. Ranges given to different tasks
+// must not share bitmap words since the zygote sweep clears live bits non atomically.
+class SweepTask : public UnsplittableTask {
+ public:
+  SweepTask(MarkSweep* mark_sweep, space::ContinuousSpace* space,
+            accounting::SpaceBitmap* live_bitmap, accounting::SpaceBitmap* mark_bitmap,
+            uintptr_t begin, uintptr_t end)
+      : live_bitmap_(live_bitmap),
+        mark_bitmap_(mark_bitmap),
+        begin_(begin),
+        end_(end),
+        callback_(space->IsZygoteSpace() ? &MarkSweep::ZygoteSweepCallback :
+            &MarkSweep::SweepCallback) {
+    context_.mark_sweep = mark_sweep;
+    context_.space = space->AsDlMallocSpace();
+    context_.self = NULL;
+    context_.freed_objects = 0;
+    context_.freed_bytes = 0;
+  }
+
+  size_t GetFreedObjects() const {
+    return context_.freed_objects;
+  }
+
+  size_t GetFreedBytes() const {
+    return context_.freed_bytes;
+  }
+
+  virtual void Run(Thread* self) NO_THREAD_SAFETY_ANALYSIS {
+    context_.self = self;
+    accounting::SpaceBitmap::SweepWalk(*live_bitmap_, *mark_bitmap_, begin_, end_, callback_,
+                                       reinterpret_cast<void*>(&context_));
+  }
+
+ private:
+  accounting::SpaceBitmap* const live_bitmap_;
+  accounting::SpaceBitmap* const mark_bitmap_;
+  const uintptr_t begin_;
+  const uintptr_t end_;
+  accounting::SpaceBitmap::SweepCallback* const callback_;
+  SweepCallbackContext context_;
+};
+
+// Sweeps the allocation stack entries between begin and end. Unmarked objects are compacted to the
+// front of the range and freed in chunks of kSweepArrayChunkFreeSize.
+class SweepArrayTask : public UnsplittableTask {
+ public:
+  SweepArrayTask(space::DlMallocSpace* space, accounting::SpaceBitmap* mark_bitmap,
+                 space::LargeObjectSpace* large_object_space,
+                 accounting::SpaceSetMap* large_mark_objects, Object** begin, Object** end)
+      : space_(space),
+        mark_bitmap_(mark_bitmap),
+        large_object_space_(large_object_space),
+        large_mark_objects_(large_mark_objects),
+        begin_(begin),
+        end_(end),
+        freed_objects_(0),
+        freed_bytes_(0),
+        freed_large_objects_(0),
+        freed_large_object_bytes_(0) {
+  }
+
+  size_t GetFreedObjects() const {
+    return freed_objects_;
+  }
+
+  size_t GetFreedBytes() const {
+    return freed_bytes_;
+  }
+
+  size_t GetFreedLargeObjects() const {
+    return freed_large_objects_;
+  }
+
+  size_t GetFreedLargeObjectBytes() const {
+    return freed_large_object_bytes_;
+  }
+
+  virtual void Run(Thread* self) NO_THREAD_SAFETY_ANALYSIS {
+    Object** out = begin_;
+    Object** objects_to_chunk_free = out;
+    for (Object** it = begin_; it != end_; ++it) {
+      Object* obj = *it;
+      if (UNLIKELY(obj == NULL)) {
+        // Unused slot of a revoked thread-local allocation stack segment.
+        continue;
+      }
+      // There should only be objects in the AllocSpace/LargeObjectSpace in the allocation stack.
+      if (LIKELY(mark_bitmap_->HasAddress(obj))) {
+        if (!mark_bitmap_->Test(obj)) {
+          // Don't bother un-marking since we clear the mark bitmap anyways.
+          *(out++) = obj;
+          // Free objects in chunks.
+          DCHECK_GE(out, objects_to_chunk_free);
+          DCHECK_LE(static_cast<size_t>(out - objects_to_chunk_free), kSweepArrayChunkFreeSize);
+          if (static_cast<size_t>(out - objects_to_chunk_free) == kSweepArrayChunkFreeSize) {
+            FreeChunk(self, objects_to_chunk_free, out);
+            objects_to_chunk_free = out;
+          }
+        }
+      } else if (!large_mark_objects_->Test(obj)) {
+        ++freed_large_objects_;
+        freed_large_object_bytes_ += large_object_space_->Free(self, obj);
+      }
+    }
+    // Free the remaining objects in chunks.
+    DCHECK_GE(out, objects_to_chunk_free);
+    DCHECK_LE(static_cast<size_t>(out - objects_to_chunk_free), kSweepArrayChunkFreeSize);
+    if (out - objects_to_chunk_free > 0) {
+      FreeChunk(self, objects_to_chunk_free, out);
+    }
+  }
+
+ private:
+  void FreeChunk(Thread* self, Object** begin, Object** end) {
+    size_t chunk_freed_objects = end - begin;
+    freed_objects_ += chunk_freed_objects;
+    freed_bytes_ += space_->FreeList(self, chunk_freed_objects, begin);
+  }
+
+  space::DlMallocSpace* const space_;
+  accounting::SpaceBitmap* const mark_bitmap_;
+  space::LargeObjectSpace* const large_object_space_;
+  accounting::SpaceSetMap* const large_mark_objects_;
+  Object** const begin_;
+  Object** const end_;
+  size_t freed_objects_;
+  size_t freed_bytes_;
+  size_t freed_large_objects_;
+  size_t freed_large_object_bytes_;
+};
+
 void MarkSweep::SweepArray(accounting::ObjectStack* allocations, bool swap_bitmaps) {
   space::DlMallocSpace* space = heap_->GetAllocSpace();
   timings_.StartSplit("SweepArray");
+  Thread* self = Thread::Current();
+  Locks::heap_bitmap_lock_->AssertExclusiveHeld(self);
   // Newly allocated objects MUST be in the alloc space and those are the only objects which we are
   // going to free.
   accounting::SpaceBitmap* live_bitmap = space->GetLiveBitmap();
@@ -1155,51 +1349,45 @@ void MarkSweep::SweepArray(accounting::ObjectStack* allocations, bool swap_bitma
     std::swap(large_live_objects, large_mark_objects);
   }
 
-  size_t freed_bytes = 0;
-  size_t freed_large_object_bytes = 0;
-  size_t freed_objects = 0;
-  size_t freed_large_objects = 0;
   size_t count = allocations->Size();
   Object** objects = const_cast<Object**>(allocations->Begin());
-  Object** out = objects;
-  Object** objects_to_chunk_free = out;
-
-  // Empty the allocation stack.
-  Thread* self = Thread::Current();
-  for (size_t i = 0; i < count; ++i) {
-    Object* obj = objects[i];
-    // There should only be objects in the AllocSpace/LargeObjectSpace in the allocation stack.
-    if (LIKELY(mark_bitmap->HasAddress(obj))) {
-      if (!mark_bitmap->Test(obj)) {
-        // Don't bother un-marking since we clear the mark bitmap anyways.
-        *(out++) = obj;
-        // Free objects in chunks.
-        DCHECK_GE(out, objects_to_chunk_free);
-        DCHECK_LE(static_cast<size_t>(out - objects_to_chunk_free), kSweepArrayChunkFreeSize);
-        if (static_cast<size_t>(out - objects_to_chunk_free) == kSweepArrayChunkFreeSize) {
-          timings_.StartSplit("FreeList");
-          size_t chunk_freed_objects = out - objects_to_chunk_free;
-          freed_objects += chunk_freed_objects;
-          freed_bytes += space->FreeList(self, chunk_freed_objects, objects_to_chunk_free);
-          objects_to_chunk_free = out;
-          timings_.EndSplit();
-        }
-      }
-    } else if (!large_mark_objects->Test(obj)) {
-      ++freed_large_objects;
-      freed_large_object_bytes += large_object_space->Free(self, obj);
+  Object** objects_end = objects + count;
+  ThreadPool* thread_pool = heap_->GetThreadPool();
+  const size_t thread_count = GetThreadCount(false);
+  const bool parallel = kParallelSweep && thread_count > 1 &&
+      count >= 2 * kMinimumParallelSweepArraySize;
+
+  // Empty the allocation stack. Each task compacts its garbage within its own slice so the slices
+  // can be swept independently.
+  std::vector<SweepArrayTask*> tasks;
+  if (parallel) {
+    const size_t delta = std::max(count / (thread_count * 2) + 1, kMinimumParallelSweepArraySize);
+    for (Object** begin = objects; begin < objects_end; begin += delta) {
+      Object** end = begin + std::min(delta, static_cast<size_t>(objects_end - begin));
+      tasks.push_back(new SweepArrayTask(space, mark_bitmap, large_object_space,
+                                         large_mark_objects, begin, end));
+      thread_pool->AddTask(self, tasks.back());
     }
+    thread_pool->SetMaxActiveWorkers(thread_count - 1);
+    thread_pool->StartWorkers(self);
+    thread_pool->Wait(self, true, true);
+    thread_pool->StopWorkers(self);
+  } else {
+    tasks.push_back(new SweepArrayTask(space, mark_bitmap, large_object_space, large_mark_objects,
+                                       objects, objects_end));
+    tasks.back()->Run(self);
   }
-  // Free the remaining objects in chunks.
-  DCHECK_GE(out, objects_to_chunk_free);
-  DCHECK_LE(static_cast<size_t>(out - objects_to_chunk_free), kSweepArrayChunkFreeSize);
-  if (out - objects_to_chunk_free > 0) {
-    timings_.StartSplit("FreeList");
-    size_t chunk_freed_objects = out - objects_to_chunk_free;
-    freed_objects += chunk_freed_objects;
-    freed_bytes += space->FreeList(self, chunk_freed_objects, objects_to_chunk_free);
-    timings_.EndSplit();
+  size_t freed_bytes = 0;
+  size_t freed_large_object_bytes = 0;
+  size_t freed_objects = 0;
+  size_t freed_large_objects = 0;
+  for (SweepArrayTask* task : tasks) {
+    freed_objects += task->GetFreedObjects();
+    freed_bytes += task->GetFreedBytes();
+    freed_large_objects += task->GetFreedLargeObjects();
+    freed_large_object_bytes += task->GetFreedLargeObjectBytes();
   }
+  STLDeleteElements(&tasks);
   CHECK_EQ(count, allocations->Size());
   timings_.EndSplit();
 
@@ -1221,11 +1409,14 @@ void MarkSweep::SweepArray(accounting::ObjectStack* allocations, bool swap_bitma
 void MarkSweep::Sweep(bool swap_bitmaps) {
   DCHECK(mark_stack_->IsEmpty());
   base::TimingLogger::ScopedSplit("Sweep", &timings_);
+  Thread* self = Thread::Current();
+  Locks::heap_bitmap_lock_->AssertExclusiveHeld(self);
 
   const bool partial = (GetGcType() == kGcTypePartial);
-  SweepCallbackContext scc;
-  scc.mark_sweep = this;
-  scc.self = Thread::Current();
+  ThreadPool* thread_pool = heap_->GetThreadPool();
+  const size_t thread_count = GetThreadCount(false);
+  const bool parallel = kParallelSweep && thread_count > 1;
+  std::vector<SweepTask*> tasks;
   for (const auto& space : GetHeap()->GetContinuousSpaces()) {
     // We always sweep always collect spaces.
     bool sweep_space = (space->GetGcRetentionPolicy() == space::kGcRetentionPolicyAlwaysCollect);
@@ -1236,32 +1427,55 @@ void MarkSweep::Sweep(bool swap_bitmaps) {
     if (sweep_space) {
       uintptr_t begin = reinterpret_cast<uintptr_t>(space->Begin());
       uintptr_t end = reinterpret_cast<uintptr_t>(space->End());
-      scc.space = space->AsDlMallocSpace();
       accounting::SpaceBitmap* live_bitmap = space->GetLiveBitmap();
       accounting::SpaceBitmap* mark_bitmap = space->GetMarkBitmap();
       if (swap_bitmaps) {
         std::swap(live_bitmap, mark_bitmap);
       }
-      if (!space->IsZygoteSpace()) {
-        base::TimingLogger::ScopedSplit split("SweepAllocSpace", &timings_);
-        // Bitmaps are pre-swapped for optimization which enables sweeping with the heap unlocked.
-        accounting::SpaceBitmap::SweepWalk(*live_bitmap, *mark_bitmap, begin, end,
-                                           &SweepCallback, reinterpret_cast<void*>(&scc));
+      // Bitmaps are pre-swapped for optimization which enables sweeping with the heap unlocked.
+      // Zygote sweep takes care of dirtying cards and clearing live bits, does not free actual
+      // memory.
+      if (parallel) {
+        // Page aligned ranges never share a bitmap word.
+        const size_t delta = std::max(RoundUp((end - begin) / (thread_count * 2) + 1, kPageSize),
+                                      kMinimumParallelSweepSize);
+        for (uintptr_t start = begin; start < end; start += delta) {
+          tasks.push_back(new SweepTask(this, space, live_bitmap, mark_bitmap, start,
+                                        std::min(start + delta, end)));
+          thread_pool->AddTask(self, tasks.back());
+        }
       } else {
-        base::TimingLogger::ScopedSplit split("SweepZygote", &timings_);
-        // Zygote sweep takes care of dirtying cards and clearing live bits, does not free actual
-        // memory.
-        accounting::SpaceBitmap::SweepWalk(*live_bitmap, *mark_bitmap, begin, end,
-                                           &ZygoteSweepCallback, reinterpret_cast<void*>(&scc));
+        base::TimingLogger::ScopedSplit split(
+            space->IsZygoteSpace() ? "SweepZygote" : "SweepAllocSpace", &timings_);
+        tasks.push_back(new SweepTask(this, space, live_bitmap, mark_bitmap, begin, end));
+        tasks.back()->Run(self);
       }
     }
   }
 
+  if (parallel) {
+    base::TimingLogger::ScopedSplit split("ParallelSweep", &timings_);
+    thread_pool->SetMaxActiveWorkers(thread_count - 1);
+    thread_pool->StartWorkers(self);
+    thread_pool->Wait(self, true, true);
+    thread_pool->StopWorkers(self);
+  }
+  size_t freed_objects = 0;
+  size_t freed_bytes = 0;
+  for (SweepTask* task : tasks) {
+    freed_objects += task->GetFreedObjects();
+    freed_bytes += task->GetFreedBytes();
+  }
+  STLDeleteElements(&tasks);
+  heap_->RecordFree(freed_objects, freed_bytes);
+  freed_objects_.fetch_add(freed_objects);
+  freed_bytes_.fetch_add(freed_bytes);
+
   SweepLargeObjects(swap_bitmaps);
 }
 
 void MarkSweep::SweepLargeObjects(bool swap_bitmaps) {
-  base::TimingLogger::ScopedSplit("SweepLargeObjects", &timings_);
+  base::TimingLogger::ScopedSplit split("SweepLargeObjects", &timings_);
   // Sweep large objects
   space::LargeObjectSpace* large_object_space = GetHeap()->GetLargeObjectsSpace();
   accounting::SpaceSetMap* large_live_objects = large_object_space->GetLiveObjects();
@@ -1270,15 +1484,24 @@ void MarkSweep::SweepLargeObjects(bool swap_bitmaps) {
     std::swap(large_live_objects, large_mark_objects);
   }
   // O(n*log(n)) but hopefully there are not too many large objects.
-  size_t freed_objects = 0;
-  size_t freed_bytes = 0;
-  Thread* self = Thread::Current();
+  DCHECK(large_objects_to_free_.empty());
   for (const Object* obj : large_live_objects->GetObjects()) {
     if (!large_mark_objects->Test(obj)) {
-      freed_bytes += large_object_space->Free(self, const_cast<Object*>(obj));
-      ++freed_objects;
+      large_objects_to_free_.push_back(const_cast<Object*>(obj));
     }
   }
+}
+
+void MarkSweep::FreeLargeObjects() {
+  if (large_objects_to_free_.empty()) {
+    return;
+  }
+  base::TimingLogger::ScopedSplit split("FreeLargeObjects", &timings_);
+  Thread* self = Thread::Current();
+  const size_t freed_objects = large_objects_to_free_.size();
+  const size_t freed_bytes = GetHeap()->GetLargeObjectsSpace()->FreeList(
+      self, freed_objects, &large_objects_to_free_[0]);
+  large_objects_to_free_.clear();
   freed_large_objects_.fetch_add(freed_objects);
   freed_large_object_bytes_.fetch_add(freed_bytes);
   GetHeap()->RecordFree(freed_objects, freed_bytes);
@@ -1428,13 +1651,12 @@ void MarkSweep::ProcessMarkStack(bool paused) {
       mark_stack_->Size() >= kMinimumParallelMarkStackSize) {
     ProcessMarkStackParallel(thread_count);
   } else {
-    // TODO: Tune this.
-    static const size_t kFifoSize = 4;
-    BoundedFifoPowerOfTwo<const Object*, kFifoSize> prefetch_fifo;
+    const size_t prefetch_depth = heap_->GetMarkStackPrefetchDepth();
+    BoundedFifoPowerOfTwo<const Object*, Heap::kMaxMarkStackPrefetchDepth> prefetch_fifo;
     for (;;) {
       const Object* obj = NULL;
-      if (kUseMarkStackPrefetch) {
-        while (!mark_stack_->IsEmpty() && prefetch_fifo.size() < kFifoSize) {
+      if (kUseMarkStackPrefetch && prefetch_depth != 0) {
+        while (!mark_stack_->IsEmpty() && prefetch_fifo.size() < prefetch_depth) {
           const Object* obj = mark_stack_->PopBack();
           DCHECK(obj != NULL);
           __builtin_prefetch(obj);
@@ -1507,22 +1729,100 @@ inline bool MarkSweep::IsMarked(const Object* object) const
   return heap_->GetMarkBitmap()->Test(object);
 }
 
+inline void MarkSweep::ClearWhiteReference(Object* ref, Object** cleared_references) {
+  Object* referent = heap_->GetReferenceReferent(ref);
+  if (referent != NULL && !IsMarked(referent)) {
+    // Referent is white, clear it.
+    heap_->ClearReferenceReferent(ref);
+    if (heap_->IsEnqueuable(ref)) {
+      heap_->EnqueueReference(ref, cleared_references);
+    }
+  }
+}
+
+// Clears the white referents of a slice of an unlinked reference list. The cleared references are
+// collected in a list of its own which the GC thread appends to the cleared reference list.
+class ClearWhiteReferencesTask : public UnsplittableTask {
+ public:
+  ClearWhiteReferencesTask(MarkSweep* mark_sweep, Object** begin, Object** end)
+      : mark_sweep_(mark_sweep),
+        begin_(begin),
+        end_(end),
+        cleared_references_(NULL) {
+  }
+
+  Object* GetClearedReferences() const {
+    return cleared_references_;
+  }
+
+  virtual void Run(Thread* /* self */) NO_THREAD_SAFETY_ANALYSIS {
+    for (Object** it = begin_; it != end_; ++it) {
+      mark_sweep_->ClearWhiteReference(*it, &cleared_references_);
+    }
+  }
+
+ private:
+  MarkSweep* const mark_sweep_;
+  Object** const begin_;
+  Object** const end_;
+  Object* cleared_references_;
+};
+
 // Unlink the reference list clearing references objects with white
 // referents.  Cleared references registered to a reference queue are
 // scheduled for appending by the heap worker thread.
 void MarkSweep::ClearWhiteReferences(Object** list) {
   DCHECK(list != NULL);
+  // References are only processed with the mutators suspended.
+  const size_t thread_count = GetThreadCount(true);
+  if (!kParallelProcessReferences || thread_count <= 1) {
+    while (*list != NULL) {
+      ClearWhiteReference(heap_->DequeuePendingReference(list), &cleared_reference_list_);
+    }
+    return;
+  }
+  // Unlink the whole list so that slices of it can be processed independently.
+  std::vector<Object*> references;
   while (*list != NULL) {
-    Object* ref = heap_->DequeuePendingReference(list);
-    Object* referent = heap_->GetReferenceReferent(ref);
-    if (referent != NULL && !IsMarked(referent)) {
-      // Referent is white, clear it.
-      heap_->ClearReferenceReferent(ref);
-      if (heap_->IsEnqueuable(ref)) {
-        heap_->EnqueueReference(ref, &cleared_reference_list_);
-      }
+    references.push_back(heap_->DequeuePendingReference(list));
+  }
+  if (references.size() < kMinimumParallelReferenceListSize) {
+    for (Object* ref : references) {
+      ClearWhiteReference(ref, &cleared_reference_list_);
+    }
+    return;
+  }
+  Thread* self = Thread::Current();
+  ThreadPool* thread_pool = heap_->GetThreadPool();
+  const size_t delta = references.size() / thread_count + 1;
+  std::vector<ClearWhiteReferencesTask*> tasks;
+  Object** const references_end = &references[0] + references.size();
+  for (Object** begin = &references[0]; begin < references_end; begin += delta) {
+    Object** end = begin + std::min(delta, static_cast<size_t>(references_end - begin));
+    tasks.push_back(new ClearWhiteReferencesTask(this, begin, end));
+    thread_pool->AddTask(self, tasks.back());
+  }
+  thread_pool->SetMaxActiveWorkers(thread_count - 1);
+  thread_pool->StartWorkers(self);
+  thread_pool->Wait(self, true, true);
+  thread_pool->StopWorkers(self);
+  const MemberOffset pending_next_offset = heap_->GetReferencePendingNextOffset();
+  for (ClearWhiteReferencesTask* task : tasks) {
+    Object* cleared = task->GetClearedReferences();
+    if (cleared == NULL) {
+      continue;
+    }
+    if (cleared_reference_list_ == NULL) {
+      cleared_reference_list_ = cleared;
+    } else {
+      // Splice the two cyclic lists by swapping the successors of their heads.
+      Object* next = cleared_reference_list_->GetFieldObject<Object*>(pending_next_offset, false);
+      Object* cleared_next = cleared->GetFieldObject<Object*>(pending_next_offset, false);
+      cleared_reference_list_->SetFieldObject(pending_next_offset, cleared_next, false);
+      cleared->SetFieldObject(pending_next_offset, next, false);
     }
   }
+  STLDeleteElements(&tasks);
   DCHECK(*list == NULL);
 }
 
@@ -1628,7 +1928,10 @@ void MarkSweep::FinishPhase() {
   heap->PostGcVerification(this);
 
   timings_.NewSplit("GrowForUtilization");
-  heap->GrowForUtilization(GetGcType(), GetDurationNs());
+  const std::vector<uint64_t>& pause_times = GetPauseTimes();
+  heap->GrowForUtilization(GetGcType(), GetDurationNs(),
+                           pause_times.empty() ? 0 :
+                               *std::max_element(pause_times.begin(), pause_times.end()));
 
   timings_.NewSplit("RequestHeapTrim");
   heap->RequestHeapTrim();
@@ -98,6 +98,13 @@ class MarkSweep : public GarbageCollector {
       EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Marks the thread roots again during a concurrent collection, each thread at its own suspend
+  // point, and traces from them and from the dirty cards. What this marks no longer has to be
+  // marked during the pause.
+  void PreCleanThreadRoots(Thread* self)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   // Verify that image roots point to only marked objects within the alloc space.
   void VerifyImageRoots()
       EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_)
@@ -140,9 +147,15 @@ class MarkSweep : public GarbageCollector {
   // Sweeps unmarked objects to complete the garbage collection.
   virtual void Sweep(bool swap_bitmaps) EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_);
 
-  // Sweeps unmarked objects to complete the garbage collection.
+  // Finds the unmarked large objects, which FreeLargeObjects frees once the heap bitmap lock is
+  // released.
   void SweepLargeObjects(bool swap_bitmaps) EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_);
 
+  // Frees the large objects found by SweepLargeObjects. Unmapping large objects is slow, so this
+  // is done without holding the heap bitmap lock. Safe since the objects are unreachable and no
+  // longer in the live set.
+  void FreeLargeObjects() LOCKS_EXCLUDED(Locks::heap_bitmap_lock_);
+
   // Sweep only pointers within an array. WARNING: Trashes objects.
   void SweepArray(accounting::ObjectStack* allocation_stack_, bool swap_bitmaps)
       EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_);
@@ -383,6 +396,11 @@ class MarkSweep : public GarbageCollector {
   void ClearWhiteReferences(mirror::Object** list)
       SHARED_LOCKS_REQUIRED(Locks::heap_bitmap_lock_, Locks::mutator_lock_);
 
+  // Clears the referent of a reference if it is white, adding the reference to cleared_references
+  // if it is enqueuable. Safe to call from multiple threads for different references.
+  void ClearWhiteReference(mirror::Object* ref, mirror::Object** cleared_references)
+      SHARED_LOCKS_REQUIRED(Locks::heap_bitmap_lock_, Locks::mutator_lock_);
+
   void ProcessReferences(mirror::Object** soft_references, bool clear_soft_references,
                          mirror::Object** weak_references,
                          mirror::Object** finalizer_references,
@@ -405,6 +423,9 @@ class MarkSweep : public GarbageCollector {
 
   accounting::ObjectStack* mark_stack_;
 
+  // Unmarked large objects waiting to be freed by FreeLargeObjects.
+  std::vector<mirror::Object*> large_objects_to_free_;
+
   // Immune range, every object inside the immune range is assumed to be marked.
   mirror::Object* immune_begin_;
   mirror::Object* immune_end_;
@@ -455,6 +476,7 @@ class MarkSweep : public GarbageCollector {
   friend class AddIfReachesAllocSpaceVisitor;  // Used by mod-union table.
   friend class CardScanTask;
   friend class CheckBitmapVisitor;
+  friend class ClearWhiteReferencesTask;
   friend class CheckReferenceVisitor;
   friend class art::gc::Heap;
   friend class InternTableEntryIsUnmarked;
@@ -468,6 +490,7 @@ class MarkSweep : public GarbageCollector {
   friend class ModUnionScanImageRootVisitor;
   friend class ScanBitmapVisitor;
   friend class ScanImageRootVisitor;
+  friend class SweepTask;
   template<bool kUseFinger> friend class MarkStackTask;
   friend class FifoMarkStackChunk;
 
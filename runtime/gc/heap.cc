@@ -19,10 +19,12 @@
 #define ATRACE_TAG ATRACE_TAG_DALVIK
 #include <cutils/trace.h>
 
+#include <algorithm>
 #include <limits>
 #include <vector>
 #include <valgrind.h>
 
+#include "alloc_profiler.h"
 #include "base/stl_util.h"
 #include "common_throws.h"
 #include "cutils/sched_policy.h"
@@ -65,21 +67,32 @@ static constexpr bool kDumpGcPerformanceOnShutdown = false;
 static constexpr size_t kMinConcurrentRemainingBytes = 128 * KB;
 // If true, measure the total allocation time.
 static constexpr bool kMeasureAllocationTime = false;
+// Bounds on how far the throughput and pause goals may scale the free space and the concurrent GC
+// headroom away from the configured values.
+static constexpr double kMinFreeScale = 0.25;
+static constexpr double kMaxFreeScale = 8.0;
+static constexpr double kMaxConcurrentHeadroomScale = 8.0;
 
 Heap::Heap(size_t initial_size, size_t growth_limit, size_t min_free, size_t max_free,
            double target_utilization, size_t capacity, const std::string& original_image_file_name,
            bool concurrent_gc, size_t parallel_gc_threads, size_t conc_gc_threads,
            bool low_memory_mode, size_t long_pause_log_threshold, size_t long_gc_log_threshold,
-           bool ignore_max_footprint)
+           bool ignore_max_footprint, size_t tlab_size, size_t mark_stack_prefetch_depth,
+           double gc_throughput_goal, uint64_t gc_pause_goal, bool verify_gc_heap,
+           double heap_verification_fraction, bool use_huge_pages)
     : alloc_space_(NULL),
       card_table_(NULL),
       concurrent_gc_(concurrent_gc),
       parallel_gc_threads_(parallel_gc_threads),
       conc_gc_threads_(conc_gc_threads),
       low_memory_mode_(low_memory_mode),
+      use_huge_pages_(use_huge_pages),
       long_pause_log_threshold_(long_pause_log_threshold),
       long_gc_log_threshold_(long_gc_log_threshold),
       ignore_max_footprint_(ignore_max_footprint),
+      tlab_size_(tlab_size),
+      mark_stack_prefetch_depth_(std::min(mark_stack_prefetch_depth,
+                                          static_cast<size_t>(kMaxMarkStackPrefetchDepth))),
       have_zygote_space_(false),
       soft_ref_queue_lock_(NULL),
       weak_ref_queue_lock_(NULL),
@@ -101,6 +114,7 @@ Heap::Heap(size_t initial_size, size_t growth_limit, size_t min_free, size_t max
       // Initially care about pauses in case we never get notified of process states, or if the JNI
       // code becomes broken.
       care_about_pause_times_(true),
+      full_gc_before_trim_(false),
       concurrent_start_bytes_(concurrent_gc_ ? initial_size - kMinConcurrentRemainingBytes
           :  std::numeric_limits<size_t>::max()),
       total_bytes_freed_ever_(0),
@@ -108,12 +122,16 @@ Heap::Heap(size_t initial_size, size_t growth_limit, size_t min_free, size_t max
       large_object_threshold_(3 * kPageSize),
       num_bytes_allocated_(0),
       native_bytes_allocated_(0),
+      native_blocking_gc_in_progress_(0),
       gc_memory_overhead_(0),
-      verify_missing_card_marks_(false),
+      verify_missing_card_marks_(verify_gc_heap),
       verify_system_weaks_(false),
-      verify_pre_gc_heap_(false),
-      verify_post_gc_heap_(false),
+      verify_pre_gc_heap_(verify_gc_heap),
+      verify_post_gc_heap_(verify_gc_heap),
       verify_mod_union_table_(false),
+      heap_verification_fraction_(heap_verification_fraction),
+      heap_verification_cursor_(0),
+      thread_pool_enabled_(false),
       min_alloc_space_size_for_sticky_gc_(2 * MB),
       min_remaining_space_for_sticky_gc_(1 * MB),
       last_trim_time_ms_(0),
@@ -133,6 +151,11 @@ Heap::Heap(size_t initial_size, size_t growth_limit, size_t min_free, size_t max
       min_free_(min_free),
       max_free_(max_free),
       target_utilization_(target_utilization),
+      gc_throughput_goal_(gc_throughput_goal),
+      gc_pause_goal_(gc_pause_goal),
+      gc_time_fraction_(0.0),
+      free_scale_(1.0),
+      concurrent_headroom_scale_(1.0),
       total_wait_time_(0),
       total_allocation_time_(0),
       verify_object_mode_(kHeapVerificationNotPermitted),
@@ -168,6 +191,9 @@ Heap::Heap(size_t initial_size, size_t growth_limit, size_t min_free, size_t max
                                               requested_alloc_space_begin);
   CHECK(alloc_space_ != NULL) << "Failed to create alloc space";
   alloc_space_->SetFootprintLimit(alloc_space_->Capacity());
+  if (use_huge_pages_) {
+    alloc_space_->GetMemMap()->AdviseHugePages();
+  }
   AddContinuousSpace(alloc_space_);
 
   // Allocate the large object space.
@@ -194,7 +220,7 @@ Heap::Heap(size_t initial_size, size_t growth_limit, size_t min_free, size_t max
   image_mod_union_table_.reset(new accounting::ModUnionTableToZygoteAllocspace(this));
   CHECK(image_mod_union_table_.get() != NULL) << "Failed to create image mod-union table";
 
-  zygote_mod_union_table_.reset(new accounting::ModUnionTableCardCache(this));
+  zygote_mod_union_table_.reset(new accounting::ModUnionTableToAllocspace(this));
   CHECK(zygote_mod_union_table_.get() != NULL) << "Failed to create Zygote mod-union table";
 
   // TODO: Count objects in the image space here.
@@ -243,10 +269,14 @@ Heap::Heap(size_t initial_size, size_t growth_limit, size_t min_free, size_t max
   }
 }
 
+void Heap::EnableThreadPool() {
+  thread_pool_enabled_ = true;
+}
+
 void Heap::CreateThreadPool() {
   const size_t num_threads = std::max(parallel_gc_threads_, conc_gc_threads_);
   if (num_threads != 0) {
-    thread_pool_.reset(new ThreadPool(num_threads));
+    thread_pool_.reset(new WorkStealingThreadPool(num_threads));
   }
 }
 
@@ -364,8 +394,13 @@ void Heap::ListenForProcessStateChange() {
     int process_state = env->GetIntField(application_thread_, last_process_state_id_);
     env->ExceptionClear();
 
-    care_about_pause_times_ = process_state_cares_about_pause_time_.find(process_state) !=
+    bool care_about_pause_times = process_state_cares_about_pause_time_.find(process_state) !=
         process_state_cares_about_pause_time_.end();
+    if (care_about_pause_times_ && !care_about_pause_times) {
+      // Moved to the background, have the next trim collect everything before returning pages.
+      full_gc_before_trim_ = true;
+    }
+    care_about_pause_times_ = care_about_pause_times;
 
     VLOG(heap) << "New process state " << process_state
                << " care about pauses " << care_about_pause_times_;
@@ -450,6 +485,11 @@ void Heap::DumpGcPerformanceInfo(std::ostream& os) {
          << " objects with total size " << PrettySize(freed_bytes) << "\n"
          << collector->GetName() << " throughput: " << freed_objects / seconds << "/s / "
          << PrettySize(freed_bytes / seconds) << "/s\n";
+      const ConcurrentHistogram& pause_histogram = collector->GetPauseHistogram();
+      if (pause_histogram.SampleSize() != 0) {
+        os << collector->GetName() << " pauses: ";
+        pause_histogram.PrintConfidenceIntervals(os, 0.99);
+      }
       total_duration += total_ns;
       total_paused_time += total_pause_ns;
     }
@@ -477,6 +517,47 @@ void Heap::DumpGcPerformanceInfo(std::ostream& os) {
   os << "Approximate GC data structures memory overhead: " << gc_memory_overhead_;
 }
 
+// Writes the median, 90th and 99th percentile and maximum of a microsecond histogram to out in
+// nanoseconds.
+static void GetHistogramStats(const ConcurrentHistogram& histogram, uint64_t* out) {
+  if (histogram.SampleSize() == 0) {
+    std::fill(out, out + 4, 0);
+    return;
+  }
+  out[0] = static_cast<uint64_t>(histogram.Percentile(0.50) * 1000);
+  out[1] = static_cast<uint64_t>(histogram.Percentile(0.90) * 1000);
+  out[2] = static_cast<uint64_t>(histogram.Percentile(0.99) * 1000);
+  out[3] = histogram.Max() * 1000;
+}
+
+void Heap::GetGcCollectorNames(std::vector<std::string>* names) const {
+  for (const auto& collector : mark_sweep_collectors_) {
+    names->push_back(collector->GetName());
+  }
+}
+
+bool Heap::GetGcStats(Thread* self, size_t collector_index, uint64_t stats[kGcStatCount]) {
+  if (collector_index >= mark_sweep_collectors_.size()) {
+    return false;
+  }
+  collector::MarkSweep* collector = mark_sweep_collectors_[collector_index];
+  // The histograms are only updated by a running GC, keep it from starting while we read them.
+  BlockGc(self);
+  const uint64_t total_ns = collector->GetTotalTimeNs();
+  const uint64_t freed_bytes = collector->GetTotalFreedBytes();
+  stats[kGcStatIterations] = collector->GetDurationHistogram().SampleSize();
+  stats[kGcStatTotalTimeNs] = total_ns;
+  stats[kGcStatPausedTimeNs] = collector->GetTotalPausedTimeNs();
+  stats[kGcStatFreedObjects] = collector->GetTotalFreedObjects();
+  stats[kGcStatFreedBytes] = freed_bytes;
+  stats[kGcStatThroughputBytesPerSecond] =
+      total_ns != 0 ? static_cast<uint64_t>(freed_bytes / (total_ns / 1e9)) : 0;
+  GetHistogramStats(collector->GetPauseHistogram(), &stats[kGcStatPauseMedianNs]);
+  GetHistogramStats(collector->GetDurationHistogram(), &stats[kGcStatDurationMedianNs]);
+  UnblockGc(self);
+  return true;
+}
+
 Heap::~Heap() {
   if (kDumpGcPerformanceOnShutdown) {
     DumpGcPerformanceInfo(LOG(INFO));
@@ -562,6 +643,7 @@ mirror::Object* Heap::AllocObject(Thread* self, mirror::Class* c, size_t byte_co
 
   mirror::Object* obj = NULL;
   size_t bytes_allocated = 0;
+  bool thread_local_allocation = false;
   uint64_t allocation_start = 0;
   if (UNLIKELY(kMeasureAllocationTime)) {
     allocation_start = NanoTime() / kTimeAdjust;
@@ -581,7 +663,13 @@ mirror::Object* Heap::AllocObject(Thread* self, mirror::Class* c, size_t byte_co
            reinterpret_cast<byte*>(obj) < continuous_spaces_.front()->Begin() ||
            reinterpret_cast<byte*>(obj) >= continuous_spaces_.back()->End());
   } else {
-    obj = Allocate(self, alloc_space_, byte_count, &bytes_allocated);
+    if (tlab_size_ != 0 && LIKELY(!running_on_valgrind_)) {
+      obj = AllocateThreadLocal(self, byte_count, &bytes_allocated);
+      thread_local_allocation = obj != NULL;
+    }
+    if (!thread_local_allocation) {
+      obj = Allocate(self, alloc_space_, byte_count, &bytes_allocated);
+    }
     // Ensure that we did not allocate into a zygote space.
     DCHECK(obj == NULL || !have_zygote_space_ || !FindSpaceFromObject(obj, false)->IsZygoteSpace());
   }
@@ -589,13 +677,22 @@ mirror::Object* Heap::AllocObject(Thread* self, mirror::Class* c, size_t byte_co
   if (LIKELY(obj != NULL)) {
     obj->SetClass(c);
 
-    // Record allocation after since we want to use the atomic add for the atomic fence to guard
-    // the SetClass since we do not want the class to appear NULL in another thread.
-    RecordAllocation(bytes_allocated, obj);
+    if (thread_local_allocation) {
+      // Bytes were accounted for when the buffer was handed out, and the allocation stack segment
+      // is only read by the GC after the buffer has been revoked.
+      RecordThreadLocalAllocation(self, obj);
+    } else {
+      // Record allocation after since we want to use the atomic add for the atomic fence to guard
+      // the SetClass since we do not want the class to appear NULL in another thread.
+      RecordAllocation(self, bytes_allocated, obj);
+    }
 
     if (Dbg::IsAllocTrackingEnabled()) {
       Dbg::RecordAllocation(c, byte_count);
     }
+    if (UNLIKELY(AllocProfiler::IsEnabled())) {
+      AllocProfiler::RecordAllocation(self, c, byte_count);
+    }
     if (UNLIKELY(static_cast<size_t>(num_bytes_allocated_) >= concurrent_start_bytes_)) {
       // The SirtRef is necessary since the calls in RequestConcurrentGC are a safepoint.
       SirtRef<mirror::Object> ref(self, obj);
@@ -771,13 +868,13 @@ void Heap::VerifyHeap() {
   GetLiveBitmap()->Walk(Heap::VerificationCallback, this);
 }
 
-inline void Heap::RecordAllocation(size_t size, mirror::Object* obj) {
+inline void Heap::RecordAllocation(Thread* self, size_t size, mirror::Object* obj) {
   DCHECK(obj != NULL);
   DCHECK_GT(size, 0u);
   num_bytes_allocated_.fetch_add(size);
 
   if (Runtime::Current()->HasStatsEnabled()) {
-    RuntimeStats* thread_stats = Thread::Current()->GetStats();
+    RuntimeStats* thread_stats = self->GetStats();
     ++thread_stats->allocated_objects;
     thread_stats->allocated_bytes += size;
 
@@ -787,11 +884,9 @@ inline void Heap::RecordAllocation(size_t size, mirror::Object* obj) {
     global_stats->allocated_bytes += size;
   }
 
-  // This is safe to do since the GC will never free objects which are neither in the allocation
-  // stack or the live bitmap.
-  while (!allocation_stack_->AtomicPushBack(obj)) {
-    CollectGarbageInternal(collector::kGcTypeSticky, kGcCauseForAlloc, false);
-  }
+  // Push onto this thread's segment of the allocation stack so that only one allocation in
+  // kThreadLocalAllocationStackSize touches the shared stack top.
+  RecordThreadLocalAllocation(self, obj);
 }
 
 void Heap::RecordFree(size_t freed_objects, size_t freed_bytes) {
@@ -810,6 +905,43 @@ void Heap::RecordFree(size_t freed_objects, size_t freed_bytes) {
   }
 }
 
+inline mirror::Object* Heap::AllocateThreadLocal(Thread* self, size_t alloc_size,
+                                                 size_t* bytes_allocated) {
+  mirror::Object* obj = alloc_space_->AllocThreadLocal(self, alloc_size, bytes_allocated);
+  if (LIKELY(obj != NULL)) {
+    return obj;
+  }
+  // Only hand out a new buffer if the heap has room for all of it, otherwise let the regular
+  // allocation path decide whether to GC or grow. Allocation tracking needs to see every
+  // allocation so compiled code must take the slow path while it is enabled.
+  if (alloc_size > tlab_size_ / 4 || IsOutOfMemoryOnAllocation(tlab_size_, false) ||
+      Dbg::IsAllocTrackingEnabled()) {
+    return NULL;
+  }
+  RevokeThreadLocalBuffers(self);
+  if (!alloc_space_->AllocThreadLocalBuffer(self, tlab_size_)) {
+    return NULL;
+  }
+  // The whole buffer counts as allocated until it is revoked.
+  num_bytes_allocated_.fetch_add(self->GetThreadLocalEnd() - self->GetThreadLocalStart());
+  return alloc_space_->AllocThreadLocal(self, alloc_size, bytes_allocated);
+}
+
+inline void Heap::RecordThreadLocalAllocation(Thread* self, mirror::Object* obj) {
+  while (!self->PushOnThreadLocalAllocationStack(obj)) {
+    // This is safe to do since the GC will never free objects which are neither in the
+    // allocation stack or the live bitmap, and obj is in neither yet.
+    RevokeThreadLocalAllocationStack(self);
+    mirror::Object** start;
+    mirror::Object** end;
+    if (allocation_stack_->AtomicBumpBack(kThreadLocalAllocationStackSize, &start, &end)) {
+      self->SetThreadLocalAllocationStack(start, end);
+    } else {
+      CollectGarbageInternal(collector::kGcTypeSticky, kGcCauseForAlloc, false);
+    }
+  }
+}
+
 inline bool Heap::IsOutOfMemoryOnAllocation(size_t alloc_size, bool grow) {
   size_t new_footprint = num_bytes_allocated_ + alloc_size;
   if (UNLIKELY(new_footprint > max_allowed_footprint_)) {
@@ -1021,18 +1153,90 @@ class InstanceCounter {
   DISALLOW_COPY_AND_ASSIGN(InstanceCounter);
 };
 
+// Counts the instances in one range of a continuous space live bitmap.
+class CountInstancesTask : public UnsplittableTask {
+ public:
+  CountInstancesTask(accounting::SpaceBitmap* bitmap, uintptr_t begin, uintptr_t end,
+                     const std::vector<mirror::Class*>& classes, bool use_is_assignable_from)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_)
+      : bitmap_(bitmap),
+        begin_(begin),
+        end_(end),
+        counts_(classes.size(), 0),
+        counter_(classes, use_is_assignable_from, &counts_[0]) {
+  }
+
+  // The thread which started the walk holds the mutator lock and heap bitmap lock on our behalf.
+  virtual void Run(Thread* /* self */) NO_THREAD_SAFETY_ANALYSIS {
+    bitmap_->VisitMarkedRange(begin_, end_, counter_);
+  }
+
+  const std::vector<uint64_t>& GetCounts() const {
+    return counts_;
+  }
+
+ private:
+  accounting::SpaceBitmap* const bitmap_;
+  const uintptr_t begin_;
+  const uintptr_t end_;
+  std::vector<uint64_t> counts_;
+  InstanceCounter counter_;
+
+  DISALLOW_COPY_AND_ASSIGN(CountInstancesTask);
+};
+
 void Heap::CountInstances(const std::vector<mirror::Class*>& classes, bool use_is_assignable_from,
                           uint64_t* counts) {
   // We only want reachable instances, so do a GC. This also ensures that the alloc stack
   // is empty, so the live bitmap is the only place we need to look.
   Thread* self = Thread::Current();
+  const bool parallel = thread_pool_.get() != NULL && !classes.empty();
   self->TransitionFromRunnableToSuspended(kNative);
   CollectGarbage(false);
+  if (parallel) {
+    // The walk uses the thread pool, which the GC must not use at the same time.
+    BlockGc(self);
+  }
   self->TransitionFromSuspendedToRunnable();
 
   InstanceCounter counter(classes, use_is_assignable_from, counts);
-  ReaderMutexLock mu(self, *Locks::heap_bitmap_lock_);
-  GetLiveBitmap()->Visit(counter);
+  {
+    ReaderMutexLock mu(self, *Locks::heap_bitmap_lock_);
+    if (!parallel) {
+      GetLiveBitmap()->Visit(counter);
+    } else {
+      const size_t thread_count = parallel_gc_threads_ + 1;
+      std::vector<CountInstancesTask*> tasks;
+      for (const auto& bitmap : GetLiveBitmap()->continuous_space_bitmaps_) {
+        std::vector<std::pair<uintptr_t, uintptr_t> > ranges;
+        bitmap->PartitionRange(bitmap->HeapBegin(), bitmap->HeapLimit(), thread_count * 2,
+                               256 * KB, &ranges);
+        for (const auto& range : ranges) {
+          CountInstancesTask* task = new CountInstancesTask(bitmap, range.first, range.second,
+                                                            classes, use_is_assignable_from);
+          tasks.push_back(task);
+          thread_pool_->AddTask(self, task);
+        }
+      }
+      thread_pool_->SetMaxActiveWorkers(thread_count - 1);
+      thread_pool_->StartWorkers(self);
+      thread_pool_->Wait(self, true, true);
+      thread_pool_->StopWorkers(self);
+      for (CountInstancesTask* task : tasks) {
+        for (size_t i = 0; i < classes.size(); ++i) {
+          counts[i] += task->GetCounts()[i];
+        }
+      }
+      STLDeleteElements(&tasks);
+      // Large objects are few, count them here.
+      for (const auto& space_set : GetLiveBitmap()->discontinuous_space_sets_) {
+        space_set->Visit(counter);
+      }
+    }
+  }
+  if (parallel) {
+    UnblockGc(self);
+  }
 }
 
 class InstanceCollector {
@@ -1126,6 +1330,52 @@ void Heap::CollectGarbage(bool clear_soft_references) {
   CollectGarbageInternal(collector::kGcTypeFull, kGcCauseExplicit, clear_soft_references);
 }
 
+void Heap::RevokeThreadLocalBuffers(Thread* thread) {
+  RevokeThreadLocalAllocationStack(thread);
+  byte* start = thread->GetThreadLocalStart();
+  if (start == NULL) {
+    return;
+  }
+  size_t buffer_size = thread->GetThreadLocalEnd() - start;
+  size_t num_objects = thread->GetThreadLocalObjectsAllocated();
+  // Look the space up rather than assuming the current alloc space, since spaces may have been
+  // added since the buffer was handed out.
+  space::ContinuousSpace* space =
+      FindContinuousSpaceFromObject(reinterpret_cast<mirror::Object*>(start), false);
+  size_t unused_bytes = space->AsDlMallocSpace()->RevokeThreadLocalBuffer(thread);
+  if (unused_bytes == 0) {
+    // Raced with another revocation of the same buffer.
+    return;
+  }
+  DCHECK_LE(unused_bytes, static_cast<size_t>(num_bytes_allocated_));
+  num_bytes_allocated_.fetch_sub(unused_bytes);
+  if (Runtime::Current()->HasStatsEnabled()) {
+    size_t allocated_bytes = buffer_size - unused_bytes;
+    RuntimeStats* thread_stats = thread->GetStats();
+    thread_stats->allocated_objects += num_objects;
+    thread_stats->allocated_bytes += allocated_bytes;
+    RuntimeStats* global_stats = Runtime::Current()->GetStats();
+    global_stats->allocated_objects += num_objects;
+    global_stats->allocated_bytes += allocated_bytes;
+  }
+}
+
+void Heap::RevokeThreadLocalAllocationStack(Thread* thread) {
+  mirror::Object** top = thread->GetThreadLocalAllocationStackTop();
+  if (top != NULL) {
+    // Readers of the allocation stacks skip the unused slots.
+    std::fill(top, thread->GetThreadLocalAllocationStackEnd(), static_cast<mirror::Object*>(NULL));
+    thread->SetThreadLocalAllocationStack(NULL, NULL);
+  }
+}
+
+void Heap::RevokeAllThreadLocalBuffers() {
+  MutexLock mu(Thread::Current(), *Locks::thread_list_lock_);
+  for (Thread* thread : Runtime::Current()->GetThreadList()->GetList()) {
+    RevokeThreadLocalBuffers(thread);
+  }
+}
+
 void Heap::PreZygoteFork() {
   static Mutex zygote_creation_lock_("zygote creation lock", kZygoteCreationLock);
   // Do this before acquiring the zygote creation lock so that we don't get lock order violations.
@@ -1151,6 +1401,9 @@ void Heap::PreZygoteFork() {
   space::DlMallocSpace* zygote_space = alloc_space_;
   alloc_space_ = zygote_space->CreateZygoteSpace("alloc space");
   alloc_space_->SetFootprintLimit(alloc_space_->Capacity());
+  if (use_huge_pages_) {
+    alloc_space_->GetMemMap()->AdviseHugePages();
+  }
 
   // Change the GC retention policy of the zygote space to only collect when full.
   zygote_space->SetGcRetentionPolicy(space::kGcRetentionPolicyFullCollect);
@@ -1164,6 +1417,8 @@ void Heap::PreZygoteFork() {
 }
 
 void Heap::FlushAllocStack() {
+  // Objects in allocation buffers are not all recorded in the allocation stack until revoked.
+  RevokeAllThreadLocalBuffers();
   MarkAllocStack(alloc_space_->GetLiveBitmap(), large_object_space_->GetLiveObjects(),
                  allocation_stack_.get());
   allocation_stack_->Reset();
@@ -1174,7 +1429,10 @@ void Heap::MarkAllocStack(accounting::SpaceBitmap* bitmap, accounting::SpaceSetM
   mirror::Object** limit = stack->End();
   for (mirror::Object** it = stack->Begin(); it != limit; ++it) {
     const mirror::Object* obj = *it;
-    DCHECK(obj != NULL);
+    if (UNLIKELY(obj == NULL)) {
+      // Unused slot of a revoked thread-local allocation stack segment.
+      continue;
+    }
     if (LIKELY(bitmap->HasAddress(obj))) {
       bitmap->Set(obj);
     } else {
@@ -1201,24 +1459,15 @@ collector::GcType Heap::CollectGarbageInternal(collector::GcType gc_type, GcCaus
   }
 
   // Ensure there is only one GC at a time.
-  bool start_collect = false;
-  while (!start_collect) {
-    {
-      MutexLock mu(self, *gc_complete_lock_);
-      if (!is_gc_running_) {
-        is_gc_running_ = true;
-        start_collect = true;
-      }
-    }
-    if (!start_collect) {
-      // TODO: timinglog this.
-      WaitForConcurrentGcToComplete(self);
+  // TODO: if another thread beat this one to do the GC, perhaps we should just return here?
+  //       Not doing at the moment to ensure soft references are cleared.
+  BlockGc(self);
+  gc_complete_lock_->AssertNotHeld(self);
 
-      // TODO: if another thread beat this one to do the GC, perhaps we should just return here?
-      //       Not doing at the moment to ensure soft references are cleared.
-    }
+  if (UNLIKELY(thread_pool_enabled_ && thread_pool_.get() == NULL)) {
+    // Deferred from DidForkFromZygote. The workers attach while no threads are suspended.
+    CreateThreadPool();
   }
-  gc_complete_lock_->AssertNotHeld(self);
 
   if (gc_cause == kGcCauseForAlloc && Runtime::Current()->HasStatsEnabled()) {
     ++Runtime::Current()->GetStats()->gc_for_alloc_count;
@@ -1260,7 +1509,10 @@ collector::GcType Heap::CollectGarbageInternal(collector::GcType gc_type, GcCaus
       << " and type=" << gc_type;
 
   collector->clear_soft_references_ = clear_soft_references;
-  collector->Run();
+  {
+    ScopedPerfCounters spc(self, kPerfPhaseGc);
+    collector->Run();
+  }
   total_objects_freed_ever_ += collector->GetFreedObjects();
   total_bytes_freed_ever_ += collector->GetFreedBytes();
   if (care_about_pause_times_) {
@@ -1494,25 +1746,103 @@ class VerifyObjectVisitor {
   mutable bool failed_;
 };
 
+// Verifies the objects of a chunk of a live bitmap on the heap thread pool.
+template <typename Visitor>
+class VerifyLiveBitmapTask : public UnsplittableTask {
+ public:
+  VerifyLiveBitmapTask(Heap* heap, accounting::SpaceBitmap* bitmap, uintptr_t begin, uintptr_t end)
+      : bitmap_(bitmap), begin_(begin), end_(end), visitor_(heap) {}
+
+  // The thread which started the verification holds the mutator lock and heap bitmap lock on our
+  // behalf.
+  virtual void Run(Thread* /* self */) NO_THREAD_SAFETY_ANALYSIS {
+    bitmap_->VisitMarkedRange(begin_, end_, visitor_);
+  }
+
+  bool Failed() const {
+    return visitor_.Failed();
+  }
+
+ private:
+  accounting::SpaceBitmap* const bitmap_;
+  const uintptr_t begin_;
+  const uintptr_t end_;
+  const Visitor visitor_;
+
+  DISALLOW_COPY_AND_ASSIGN(VerifyLiveBitmapTask);
+};
+
+template <typename Visitor>
+bool Heap::VerifyLiveBitmap(const Visitor& large_object_visitor) {
+  // Fixed size chunks so that the fraction sampled does not depend on the number of threads.
+  static const size_t kVerificationChunkSize = 256 * KB;
+  std::vector<VerifyLiveBitmapTask<Visitor>*> tasks;
+  for (const auto& bitmap : GetLiveBitmap()->continuous_space_bitmaps_) {
+    std::vector<std::pair<uintptr_t, uintptr_t> > ranges;
+    const size_t size = bitmap->HeapLimit() - bitmap->HeapBegin();
+    bitmap->PartitionRange(bitmap->HeapBegin(), bitmap->HeapLimit(),
+                           size / kVerificationChunkSize + 1, kVerificationChunkSize, &ranges);
+    for (const auto& range : ranges) {
+      tasks.push_back(new VerifyLiveBitmapTask<Visitor>(this, bitmap, range.first, range.second));
+    }
+  }
+  const size_t num_tasks = tasks.size();
+  size_t num_verified = num_tasks;
+  if (heap_verification_fraction_ < 1.0) {
+    num_verified = std::min(num_tasks,
+        static_cast<size_t>(num_tasks * heap_verification_fraction_) + 1);
+  }
+  Thread* self = Thread::Current();
+  const size_t first = num_tasks != 0 ? heap_verification_cursor_ % num_tasks : 0;
+  heap_verification_cursor_ = first + num_verified;
+  if (thread_pool_.get() == NULL) {
+    for (size_t i = 0; i < num_verified; ++i) {
+      tasks[(first + i) % num_tasks]->Run(self);
+    }
+  } else {
+    for (size_t i = 0; i < num_verified; ++i) {
+      thread_pool_->AddTask(self, tasks[(first + i) % num_tasks]);
+    }
+    thread_pool_->SetMaxActiveWorkers(parallel_gc_threads_);
+    thread_pool_->StartWorkers(self);
+    thread_pool_->Wait(self, true, true);
+    thread_pool_->StopWorkers(self);
+  }
+  bool failed = false;
+  for (VerifyLiveBitmapTask<Visitor>* task : tasks) {
+    failed = failed || task->Failed();
+  }
+  STLDeleteElements(&tasks);
+  // Large objects are few, verify them here.
+  for (const auto& space_set : GetLiveBitmap()->discontinuous_space_sets_) {
+    space_set->Visit(large_object_visitor);
+  }
+  return !failed && !large_object_visitor.Failed();
+}
+
 // Must do this with mutators suspended since we are directly accessing the allocation stacks.
 bool Heap::VerifyHeapReferences() {
   Locks::mutator_lock_->AssertExclusiveHeld(Thread::Current());
+  // Threads must not keep appending to their segments of the stacks we are about to sort.
+  RevokeAllThreadLocalBuffers();
   // Lets sort our allocation stacks so that we can efficiently binary search them.
   allocation_stack_->Sort();
   live_stack_->Sort();
   // Perform the verification.
   VerifyObjectVisitor visitor(this);
   Runtime::Current()->VisitRoots(VerifyReferenceVisitor::VerifyRoots, &visitor, false, false);
-  GetLiveBitmap()->Visit(visitor);
+  const bool bitmap_failed = !VerifyLiveBitmap(visitor);
   // Verify objects in the allocation stack since these will be objects which were:
   // 1. Allocated prior to the GC (pre GC verification).
   // 2. Allocated during the GC (pre sweep GC verification).
   for (mirror::Object** it = allocation_stack_->Begin(); it != allocation_stack_->End(); ++it) {
-    visitor(*it);
+    if (*it != NULL) {
+      visitor(*it);
+    }
   }
   // We don't want to verify the objects in the live stack since they themselves may be
   // pointing to dead objects if they are not reachable.
-  if (visitor.Failed()) {
+  if (bitmap_failed || visitor.Failed()) {
     // Dump mod-union tables.
     image_mod_union_table_->Dump(LOG(ERROR) << "Image mod-union table: ");
     zygote_mod_union_table_->Dump(LOG(ERROR) << "Zygote mod-union table: ");
@@ -1617,17 +1947,21 @@ class VerifyLiveStackReferences {
 bool Heap::VerifyMissingCardMarks() {
   Locks::mutator_lock_->AssertExclusiveHeld(Thread::Current());
 
+  // Threads must not keep appending to their segments of the stack we are about to sort.
+  RevokeAllThreadLocalBuffers();
   // We need to sort the live stack since we binary search it.
   live_stack_->Sort();
   VerifyLiveStackReferences visitor(this);
-  GetLiveBitmap()->Visit(visitor);
+  const bool bitmap_failed = !VerifyLiveBitmap(visitor);
 
   // We can verify objects in the live stack since none of these should reference dead objects.
   for (mirror::Object** it = live_stack_->Begin(); it != live_stack_->End(); ++it) {
-    visitor(*it);
+    if (*it != NULL) {
+      visitor(*it);
+    }
   }
 
-  if (visitor.Failed()) {
+  if (bitmap_failed || visitor.Failed()) {
     DumpSpaces();
     return false;
   }
@@ -1638,7 +1972,50 @@ void Heap::SwapStacks() {
   allocation_stack_.swap(live_stack_);
 }
 
-void Heap::ProcessCards(base::TimingLogger& timings) {
+// Ages the cards covering [begin, end) of an alloc space.
+class AgeCardsTask : public UnsplittableTask {
+ public:
+  AgeCardsTask(accounting::CardTable* card_table, byte* begin, byte* end)
+      : card_table_(card_table), begin_(begin), end_(end) {}
+
+  virtual void Run(Thread* /* self */) {
+    card_table_->ModifyCardsAtomic(begin_, end_, AgeCardVisitor(), VoidFunctor());
+  }
+
+ private:
+  accounting::CardTable* const card_table_;
+  byte* const begin_;
+  byte* const end_;
+};
+
+void Heap::AgeCards(space::ContinuousSpace* space, size_t thread_count) {
+  byte* begin = space->Begin();
+  byte* end = space->End();
+  const size_t size = end - begin;
+  // Each chunk covers a whole number of pages of cards so that tasks never share a card word.
+  const size_t chunk_size = thread_count <= 1 ? size :
+      RoundUp(size / thread_count, accounting::CardTable::kCardSize * kPageSize);
+  if (size <= chunk_size) {
+    card_table_->ModifyCardsAtomic(begin, end, AgeCardVisitor(), VoidFunctor());
+    return;
+  }
+  Thread* self = Thread::Current();
+  ThreadPool* thread_pool = GetThreadPool();
+  std::vector<AgeCardsTask*> tasks;
+  for (byte* chunk_begin = begin; chunk_begin < end; chunk_begin += chunk_size) {
+    byte* chunk_end = std::min(chunk_begin + chunk_size, end);
+    AgeCardsTask* task = new AgeCardsTask(card_table_.get(), chunk_begin, chunk_end);
+    tasks.push_back(task);
+    thread_pool->AddTask(self, task);
+  }
+  thread_pool->SetMaxActiveWorkers(thread_count - 1);
+  thread_pool->StartWorkers(self);
+  thread_pool->Wait(self, true, true);
+  thread_pool->StopWorkers(self);
+  STLDeleteElements(&tasks);
+}
+
+void Heap::ProcessCards(base::TimingLogger& timings, size_t thread_count) {
   // Clear cards and keep track of cards cleared in the mod-union table.
   for (const auto& space : continuous_spaces_) {
     if (space->IsImageSpace()) {
@@ -1651,7 +2028,7 @@ void Heap::ProcessCards(base::TimingLogger& timings) {
       base::TimingLogger::ScopedSplit split("AllocSpaceClearCards", &timings);
       // No mod union table for the AllocSpace. Age the cards so that the GC knows that these cards
       // were dirty before the GC started.
-      card_table_->ModifyCardsAtomic(space->Begin(), space->End(), AgeCardVisitor(), VoidFunctor());
+      AgeCards(space, thread_count);
     }
   }
 }
@@ -1724,6 +2101,30 @@ void Heap::PostGcVerification(collector::GarbageCollector* gc) {
   }
 }
 
+void Heap::BlockGc(Thread* self) {
+  bool blocked = false;
+  while (!blocked) {
+    {
+      MutexLock mu(self, *gc_complete_lock_);
+      if (!is_gc_running_) {
+        is_gc_running_ = true;
+        blocked = true;
+      }
+    }
+    if (!blocked) {
+      // TODO: timinglog this.
+      WaitForConcurrentGcToComplete(self);
+    }
+  }
+}
+
+void Heap::UnblockGc(Thread* self) {
+  MutexLock mu(self, *gc_complete_lock_);
+  is_gc_running_ = false;
+  // Wake anyone who may have been waiting for the GC to complete.
+  gc_complete_cond_->Broadcast(self);
+}
+
 collector::GcType Heap::WaitForConcurrentGcToComplete(Thread* self) {
   collector::GcType last_gc_type = collector::kGcTypeNone;
   if (concurrent_gc_) {
@@ -1760,9 +2161,46 @@ collector::GcType Heap::WaitForConcurrentGcToComplete(Thread* self) {
 void Heap::DumpForSigQuit(std::ostream& os) {
   os << "Heap: " << GetPercentFree() << "% free, " << PrettySize(GetBytesAllocated()) << "/"
      << PrettySize(GetTotalMemory()) << "; " << GetObjectsAllocated() << " objects\n";
+  DumpSpaceUsage(os);
   DumpGcPerformanceInfo(os);
 }
 
+void Heap::DumpSpaceUsage(std::ostream& os) {
+  size_t bitmap_bytes = 0;
+  for (const auto& space : continuous_spaces_) {
+    accounting::SpaceBitmap* live_bitmap = space->GetLiveBitmap();
+    accounting::SpaceBitmap* mark_bitmap = space->GetMarkBitmap();
+    size_t space_bitmap_bytes = live_bitmap->Size();
+    if (mark_bitmap != live_bitmap) {
+      space_bitmap_bytes += mark_bitmap->Size();
+    }
+    bitmap_bytes += space_bitmap_bytes;
+    os << "  " << space->GetName() << ": ";
+    if (space->IsDlMallocSpace()) {
+      space::DlMallocSpace* alloc_space = space->AsDlMallocSpace();
+      const size_t allocated = alloc_space->GetBytesAllocated();
+      const size_t footprint = alloc_space->GetFootprint();
+      // Free bytes within the footprint include dlmalloc's free chunks and fragmentation.
+      os << PrettySize(allocated) << " in " << alloc_space->GetObjectsAllocated()
+         << " objects, " << PrettySize(footprint > allocated ? footprint - allocated : 0)
+         << " free of " << PrettySize(footprint) << " footprint, "
+         << PrettySize(alloc_space->Capacity()) << " capacity";
+    } else {
+      os << PrettySize(space->Size()) << " mapped";
+    }
+    os << ", " << PrettySize(space_bitmap_bytes) << " bitmaps\n";
+  }
+  for (const auto& space : discontinuous_spaces_) {
+    if (space->IsLargeObjectSpace()) {
+      space::LargeObjectSpace* los = space->AsLargeObjectSpace();
+      os << "  " << los->GetName() << ": " << PrettySize(los->GetBytesAllocated()) << " in "
+         << los->GetObjectsAllocated() << " objects\n";
+    }
+  }
+  os << "  Bitmaps " << PrettySize(bitmap_bytes) << ", card table "
+     << PrettySize(card_table_->Size()) << "\n";
+}
+
 size_t Heap::GetPercentFree() {
   return static_cast<size_t>(100.0f * static_cast<float>(GetFreeMemory()) / GetTotalMemory());
 }
@@ -1789,19 +2227,51 @@ void Heap::UpdateMaxNativeFootprint() {
   native_footprint_limit_ = 2 * target_size - native_size;
 }
 
-void Heap::GrowForUtilization(collector::GcType gc_type, uint64_t gc_duration) {
+void Heap::UpdateGrowthScales(uint64_t gc_duration, uint64_t max_pause) {
+  const uint64_t now = NanoTime();
+  if (gc_throughput_goal_ != 0.0 && last_gc_time_ns_ != 0 && now > last_gc_time_ns_) {
+    const double fraction = std::min(1.0, static_cast<double>(gc_duration) /
+                                     static_cast<double>(now - last_gc_time_ns_));
+    gc_time_fraction_ = 0.7 * gc_time_fraction_ + 0.3 * fraction;
+    const double allowed_fraction = 1.0 - gc_throughput_goal_;
+    if (gc_time_fraction_ > allowed_fraction) {
+      // Collecting too often, give the application more room between GCs.
+      free_scale_ = std::min(free_scale_ * 1.5, kMaxFreeScale);
+    } else if (gc_time_fraction_ < allowed_fraction / 2) {
+      // Well within the goal, give memory back.
+      free_scale_ = std::max(free_scale_ / 1.25, kMinFreeScale);
+    }
+  }
+  if (gc_pause_goal_ != 0) {
+    if (max_pause > gc_pause_goal_) {
+      concurrent_headroom_scale_ = std::min(concurrent_headroom_scale_ * 2,
+                                            kMaxConcurrentHeadroomScale);
+    } else {
+      concurrent_headroom_scale_ = std::max(concurrent_headroom_scale_ / 1.25, 1.0);
+    }
+  }
+  VLOG(heap) << "GC time fraction " << gc_time_fraction_ << " free scale " << free_scale_
+             << " concurrent headroom scale " << concurrent_headroom_scale_;
+}
+
+void Heap::GrowForUtilization(collector::GcType gc_type, uint64_t gc_duration,
+                              uint64_t max_pause) {
+  UpdateGrowthScales(gc_duration, max_pause);
+
   // We know what our utilization is at this moment.
   // This doesn't actually resize any memory. It just lets the heap grow more when necessary.
   const size_t bytes_allocated = GetBytesAllocated();
   last_gc_size_ = bytes_allocated;
   last_gc_time_ns_ = NanoTime();
 
+  const size_t max_free = GetScaledMaxFree();
   size_t target_size;
   if (gc_type != collector::kGcTypeSticky) {
     // Grow the heap for non sticky GC.
     target_size = bytes_allocated / GetTargetHeapUtilization();
-    if (target_size > bytes_allocated + max_free_) {
-      target_size = bytes_allocated + max_free_;
+    target_size = bytes_allocated + (target_size - bytes_allocated) * free_scale_;
+    if (target_size > bytes_allocated + max_free) {
+      target_size = bytes_allocated + max_free;
     } else if (target_size < bytes_allocated + min_free_) {
       target_size = bytes_allocated + min_free_;
     }
@@ -1816,8 +2286,8 @@ void Heap::GrowForUtilization(collector::GcType gc_type, uint64_t gc_duration) {
     }
 
     // If we have freed enough memory, shrink the heap back down.
-    if (bytes_allocated + max_free_ < max_allowed_footprint_) {
-      target_size = bytes_allocated + max_free_;
+    if (bytes_allocated + max_free < max_allowed_footprint_) {
+      target_size = bytes_allocated + max_free;
     } else {
       target_size = std::max(bytes_allocated, max_allowed_footprint_);
     }
@@ -1832,7 +2302,7 @@ void Heap::GrowForUtilization(collector::GcType gc_type, uint64_t gc_duration) {
       // Calculate the estimated GC duration.
       double gc_duration_seconds = NsToMs(gc_duration) / 1000.0;
       // Estimate how many remaining bytes we will have when we need to start the next GC.
-      size_t remaining_bytes = allocation_rate_ * gc_duration_seconds;
+      size_t remaining_bytes = allocation_rate_ * gc_duration_seconds * concurrent_headroom_scale_;
       remaining_bytes = std::max(remaining_bytes, kMinConcurrentRemainingBytes);
       if (UNLIKELY(remaining_bytes > max_allowed_footprint_)) {
         // A never going to happen situation that from the estimated allocation rate we will exceed
@@ -2066,6 +2536,15 @@ void Heap::RequestHeapTrim() {
 
 size_t Heap::Trim() {
   // Handle a requested heap trim on a thread outside of the main GC thread.
+  if (full_gc_before_trim_) {
+    full_gc_before_trim_ = false;
+    // The mark sweep collectors can't compact the alloc space, the best we can do for a process
+    // which went to the background is a full collection so that the trim below can advise away the
+    // pages of everything that died since the last full GC. Pause times don't matter here.
+    Thread* self = Thread::Current();
+    WaitForConcurrentGcToComplete(self);
+    CollectGarbageInternal(collector::kGcTypeFull, kGcCauseBackground, false);
+  }
   return alloc_space_->Trim();
 }
 
@@ -2075,43 +2554,45 @@ bool Heap::IsGCRequestPending() const {
 
 void Heap::RegisterNativeAllocation(int bytes) {
   // Total number of native bytes allocated.
-  native_bytes_allocated_.fetch_add(bytes);
+  const size_t native_size = static_cast<size_t>(native_bytes_allocated_.fetch_add(bytes) + bytes);
+  if (LIKELY(native_size <= native_footprint_gc_watermark_)) {
+    return;
+  }
   Thread* self = Thread::Current();
-  if (static_cast<size_t>(native_bytes_allocated_) > native_footprint_gc_watermark_) {
-    // The second watermark is higher than the gc watermark. If you hit this it means you are
-    // allocating native objects faster than the GC can keep up with.
+  // The second watermark is higher than the gc watermark. If you hit this it means you are
+  // allocating native objects faster than the GC can keep up with. One thread at a time is slowed
+  // down to let the GC and finalizers catch up, the others carry on.
+  if (native_size > native_footprint_limit_ &&
+      native_blocking_gc_in_progress_.compare_and_swap(0, 1)) {
+    JNIEnv* env = self->GetJniEnv();
+    // Can't do this in WellKnownClasses::Init since System is not properly set up at that
+    // point.
+    if (WellKnownClasses::java_lang_System_runFinalization == NULL) {
+      DCHECK(WellKnownClasses::java_lang_System != NULL);
+      WellKnownClasses::java_lang_System_runFinalization =
+          CacheMethod(env, WellKnownClasses::java_lang_System, true, "runFinalization", "()V");
+      assert(WellKnownClasses::java_lang_System_runFinalization != NULL);
+    }
+    if (WaitForConcurrentGcToComplete(self) != collector::kGcTypeNone) {
+      // Just finished a GC, attempt to run finalizers.
+      env->CallStaticVoidMethod(WellKnownClasses::java_lang_System,
+                                WellKnownClasses::java_lang_System_runFinalization);
+      CHECK(!env->ExceptionCheck());
+    }
+
+    // If we still are over the watermark, attempt a GC for alloc and run finalizers.
     if (static_cast<size_t>(native_bytes_allocated_) > native_footprint_limit_) {
-        JNIEnv* env = self->GetJniEnv();
-        // Can't do this in WellKnownClasses::Init since System is not properly set up at that
-        // point.
-        if (WellKnownClasses::java_lang_System_runFinalization == NULL) {
-          DCHECK(WellKnownClasses::java_lang_System != NULL);
-          WellKnownClasses::java_lang_System_runFinalization =
-              CacheMethod(env, WellKnownClasses::java_lang_System, true, "runFinalization", "()V");
-          assert(WellKnownClasses::java_lang_System_runFinalization != NULL);
-        }
-        if (WaitForConcurrentGcToComplete(self) != collector::kGcTypeNone) {
-          // Just finished a GC, attempt to run finalizers.
-          env->CallStaticVoidMethod(WellKnownClasses::java_lang_System,
-                                    WellKnownClasses::java_lang_System_runFinalization);
-          CHECK(!env->ExceptionCheck());
-        }
-
-        // If we still are over the watermark, attempt a GC for alloc and run finalizers.
-        if (static_cast<size_t>(native_bytes_allocated_) > native_footprint_limit_) {
-          CollectGarbageInternal(collector::kGcTypePartial, kGcCauseForAlloc, false);
-          env->CallStaticVoidMethod(WellKnownClasses::java_lang_System,
-                                    WellKnownClasses::java_lang_System_runFinalization);
-          CHECK(!env->ExceptionCheck());
-        }
-        // We have just run finalizers, update the native watermark since it is very likely that
-        // finalizers released native managed allocations.
-        UpdateMaxNativeFootprint();
-    } else {
-      if (!IsGCRequestPending()) {
-        RequestConcurrentGC(self);
-      }
-    }
+      CollectGarbageInternal(collector::kGcTypePartial, kGcCauseForAlloc, false);
+      env->CallStaticVoidMethod(WellKnownClasses::java_lang_System,
+                                WellKnownClasses::java_lang_System_runFinalization);
+      CHECK(!env->ExceptionCheck());
+    }
+    // We have just run finalizers, update the native watermark since it is very likely that
+    // finalizers released native managed allocations.
+    UpdateMaxNativeFootprint();
+    native_blocking_gc_in_progress_ = 0;
+  } else if (!IsGCRequestPending()) {
+    RequestConcurrentGC(self);
   }
 }
 
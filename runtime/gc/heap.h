@@ -92,6 +92,25 @@ enum GcCause {
 };
 std::ostream& operator<<(std::ostream& os, const GcCause& policy);
 
+// Layout of the per-collector statistics returned by Heap::GetGcStats. Times are in nanoseconds.
+enum GcStat {
+  kGcStatIterations,
+  kGcStatTotalTimeNs,
+  kGcStatPausedTimeNs,
+  kGcStatFreedObjects,
+  kGcStatFreedBytes,
+  kGcStatThroughputBytesPerSecond,
+  kGcStatPauseMedianNs,
+  kGcStatPause90thNs,
+  kGcStatPause99thNs,
+  kGcStatPauseMaxNs,
+  kGcStatDurationMedianNs,
+  kGcStatDuration90thNs,
+  kGcStatDuration99thNs,
+  kGcStatDurationMaxNs,
+  kGcStatCount  // Number of statistics, keep last.
+};
+
 // How we want to sanity check the heap's correctness.
 enum HeapVerificationMode {
   kHeapVerificationNotPermitted,  // Too early in runtime start-up for heap to be verified.
@@ -109,6 +128,16 @@ class Heap {
   static constexpr size_t kDefaultMinFree = kDefaultMaxFree / 4;
   static constexpr size_t kDefaultLongPauseLogThreshold = MsToNs(5);
   static constexpr size_t kDefaultLongGCLogThreshold = MsToNs(100);
+  static constexpr size_t kDefaultTLABSize = 16 * KB;
+
+  // How many mark stack entries the collectors prefetch ahead of the object being scanned. The
+  // prefetch depth can be set at runtime, up to the maximum.
+  static constexpr size_t kDefaultMarkStackPrefetchDepth = 4;
+  static constexpr size_t kMaxMarkStackPrefetchDepth = 32;
+
+  // Number of allocation stack slots handed to a thread at a time for recording the objects it
+  // bump allocates from its allocation buffer.
+  static constexpr size_t kThreadLocalAllocationStackSize = 128;
 
   // Default target utilization.
   static constexpr double kDefaultTargetUtilization = 0.5;
@@ -123,7 +152,10 @@ class Heap {
                 size_t max_free, double target_utilization, size_t capacity,
                 const std::string& original_image_file_name, bool concurrent_gc,
                 size_t parallel_gc_threads, size_t conc_gc_threads, bool low_memory_mode,
-                size_t long_pause_threshold, size_t long_gc_threshold, bool ignore_max_footprint);
+                size_t long_pause_threshold, size_t long_gc_threshold, bool ignore_max_footprint,
+                size_t tlab_size, size_t mark_stack_prefetch_depth, double gc_throughput_goal,
+                uint64_t gc_pause_goal, bool verify_gc_heap, double heap_verification_fraction,
+                bool use_huge_pages);
 
   ~Heap();
 
@@ -211,6 +243,11 @@ class Heap {
   // true if we waited for the GC to complete.
   collector::GcType WaitForConcurrentGcToComplete(Thread* self) LOCKS_EXCLUDED(gc_complete_lock_);
 
+  // Waits until no GC is running and then keeps any other GC from starting until UnblockGc. The
+  // collector itself uses this to ensure there is only one GC at a time.
+  void BlockGc(Thread* self) LOCKS_EXCLUDED(gc_complete_lock_);
+  void UnblockGc(Thread* self) LOCKS_EXCLUDED(gc_complete_lock_);
+
   const std::vector<space::ContinuousSpace*>& GetContinuousSpaces() const {
     return continuous_spaces_;
   }
@@ -343,7 +380,13 @@ class Heap {
 
   void DumpForSigQuit(std::ostream& os);
 
-  size_t Trim();
+  // Prints the allocated and free bytes of each space and the memory used by the bitmaps and the
+  // card table that track them.
+  void DumpSpaceUsage(std::ostream& os);
+
+  // Advises unused alloc space pages back to the kernel. Does a full GC first if the process went to
+  // the background since the last trim.
+  size_t Trim() LOCKS_EXCLUDED(Locks::mutator_lock_);
 
   accounting::HeapBitmap* GetLiveBitmap() SHARED_LOCKS_REQUIRED(Locks::heap_bitmap_lock_) {
     return live_bitmap_.get();
@@ -359,7 +402,17 @@ class Heap {
 
   void PreZygoteFork() LOCKS_EXCLUDED(Locks::heap_bitmap_lock_);
 
-  // Mark and empty stack.
+  // Return the unused part of a thread's allocation buffer to the space it came from. The thread
+  // must either be the caller or be suspended.
+  void RevokeThreadLocalBuffers(Thread* thread);
+
+  // Revoke the allocation buffers of all threads, which must all be suspended.
+  void RevokeAllThreadLocalBuffers() LOCKS_EXCLUDED(Locks::thread_list_lock_);
+
+  // Hand back the unused part of a thread's allocation stack segment, filling it with NULLs.
+  void RevokeThreadLocalAllocationStack(Thread* thread);
+
+  // Mark and empty stack, revoking all allocation buffers. Other threads must be suspended.
   void FlushAllocStack()
       EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_);
 
@@ -409,17 +462,30 @@ class Heap {
   // GC performance measuring
   void DumpGcPerformanceInfo(std::ostream& os);
 
+  // Implements VMDebug.getGcCollectorNames, collectors are indexed in the returned order.
+  void GetGcCollectorNames(std::vector<std::string>* names) const;
+
+  // Implements VMDebug.getGcStats. Fills stats, indexed by GcStat, with the cumulative statistics
+  // of the given collector. Returns false if there is no such collector.
+  bool GetGcStats(Thread* self, size_t collector_index, uint64_t stats[kGcStatCount])
+      LOCKS_EXCLUDED(gc_complete_lock_);
+
   // Returns true if we currently care about pause times.
   bool CareAboutPauseTimes() const {
     return care_about_pause_times_;
   }
 
-  // Thread pool.
+  // Thread pool. After EnableThreadPool the pool is created by the next GC, rather than on the
+  // critical path of an app launch.
+  void EnableThreadPool();
   void CreateThreadPool();
   void DeleteThreadPool();
   ThreadPool* GetThreadPool() {
     return thread_pool_.get();
   }
+  size_t GetMarkStackPrefetchDepth() const {
+    return mark_stack_prefetch_depth_;
+  }
   size_t GetParallelGCThreadCount() const {
     return parallel_gc_threads_;
   }
@@ -455,6 +521,17 @@ class Heap {
 
   bool IsOutOfMemoryOnAllocation(size_t alloc_size, bool grow);
 
+  // Bump allocate from the calling thread's allocation buffer, refilling it if needed. Never GCs,
+  // returns NULL if the regular allocation path should be used instead.
+  mirror::Object* AllocateThreadLocal(Thread* self, size_t alloc_size, size_t* bytes_allocated)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Record an object allocated by the calling thread in its allocation stack segment, may run a
+  // GC to make room in the allocation stack.
+  void RecordThreadLocalAllocation(Thread* self, mirror::Object* obj)
+      LOCKS_EXCLUDED(Locks::thread_suspend_count_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   // Pushes a list of cleared references out to the managed heap.
   void EnqueueClearedReferences(mirror::Object** cleared_references);
 
@@ -462,7 +539,7 @@ class Heap {
   void RequestConcurrentGC(Thread* self) LOCKS_EXCLUDED(Locks::runtime_shutdown_lock_);
   bool IsGCRequestPending() const;
 
-  void RecordAllocation(size_t size, mirror::Object* object)
+  void RecordAllocation(Thread* self, size_t size, mirror::Object* object)
       LOCKS_EXCLUDED(GlobalSynchronization::heap_bitmap_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
@@ -486,7 +563,16 @@ class Heap {
   // Given the current contents of the alloc space, increase the allowed heap footprint to match
   // the target utilization ratio.  This should only be called immediately after a full garbage
   // collection.
-  void GrowForUtilization(collector::GcType gc_type, uint64_t gc_duration);
+  void GrowForUtilization(collector::GcType gc_type, uint64_t gc_duration, uint64_t max_pause);
+
+  // Adapt the free space and concurrent GC headroom scales to the throughput and pause goals,
+  // given the duration and longest pause of the GC which just finished.
+  void UpdateGrowthScales(uint64_t gc_duration, uint64_t max_pause);
+
+  // The ideal maximum free size after scaling for the throughput goal.
+  size_t GetScaledMaxFree() const {
+    return static_cast<size_t>(max_free_ * free_scale_);
+  }
 
   size_t GetPercentFree();
 
@@ -504,8 +590,19 @@ class Heap {
   // Swap the allocation stack with the live stack.
   void SwapStacks();
 
-  // Clear cards and update the mod union table.
-  void ProcessCards(base::TimingLogger& timings);
+  // Runs a verification visitor over heap_verification_fraction_ of the continuous space live
+  // bitmaps, in chunks on the heap thread pool, and over all of the large objects. Each call
+  // continues where the previous one stopped. Returns false if any visitor failed.
+  template <typename Visitor>
+  bool VerifyLiveBitmap(const Visitor& large_object_visitor)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_, Locks::heap_bitmap_lock_);
+
+  // Clear cards and update the mod union table. Alloc space cards are aged on up to thread_count
+  // threads of the heap thread pool.
+  void ProcessCards(base::TimingLogger& timings, size_t thread_count);
+
+  // Age the cards of an alloc space so that the GC knows which cards were dirty before it started.
+  void AgeCards(space::ContinuousSpace* space, size_t thread_count);
 
   // All-known continuous spaces, where objects lie within fixed bounds.
   std::vector<space::ContinuousSpace*> continuous_spaces_;
@@ -542,6 +639,10 @@ class Heap {
   // Boolean for if we are in low memory mode.
   const bool low_memory_mode_;
 
+  // Whether the alloc space is backed by transparent huge pages, to cut TLB misses when marking
+  // and sweeping large heaps.
+  const bool use_huge_pages_;
+
   // If we get a pause longer than long pause log threshold, then we print out the GC after it
   // finishes.
   const size_t long_pause_log_threshold_;
@@ -553,6 +654,12 @@ class Heap {
   // useful for benchmarking since it reduces time spent in GC to a low %.
   const bool ignore_max_footprint_;
 
+  // Size of the thread-local allocation buffers handed out from the alloc space, 0 if disabled.
+  const size_t tlab_size_;
+
+  // Number of mark stack entries prefetched ahead of scanning, 0 if disabled.
+  const size_t mark_stack_prefetch_depth_;
+
   // If we have a zygote space.
   bool have_zygote_space_;
 
@@ -605,6 +712,9 @@ class Heap {
   // Whether or not we currently care about pause times.
   bool care_about_pause_times_;
 
+  // Set when the process stops caring about pause times, the next Trim first does a full GC.
+  bool full_gc_before_trim_;
+
   // When num_bytes_allocated_ exceeds this amount then a concurrent GC should be requested so that
   // it completes ahead of an allocation failing.
   size_t concurrent_start_bytes_;
@@ -624,6 +734,10 @@ class Heap {
   // Bytes which are allocated and managed by native code but still need to be accounted for.
   AtomicInteger native_bytes_allocated_;
 
+  // Set while a thread over the native footprint limit waits for a GC and finalizers, other
+  // threads over the limit only request a concurrent GC rather than queueing up behind it.
+  AtomicInteger native_blocking_gc_in_progress_;
+
   // Data structure GC overhead.
   AtomicInteger gc_memory_overhead_;
 
@@ -634,8 +748,15 @@ class Heap {
   const bool verify_post_gc_heap_;
   const bool verify_mod_union_table_;
 
+  // Fraction of the live bitmaps checked by each verification pass, and the position in the heap
+  // where the next pass continues.
+  const double heap_verification_fraction_;
+  size_t heap_verification_cursor_;
+
   // Parallel GC data structures.
   UniquePtr<ThreadPool> thread_pool_;
+  // Set once the process may start GC threads, that is not in the zygote.
+  bool thread_pool_enabled_;
 
   // Sticky mark bits GC has some overhead, so if we have less a few megabytes of AllocSpace then
   // it's probably better to just do a partial GC.
@@ -699,6 +820,24 @@ class Heap {
   // Target ideal heap utilization ratio
   double target_utilization_;
 
+  // Fraction of time the application should spend outside of the GC, 0 if there is no goal.
+  const double gc_throughput_goal_;
+
+  // Longest GC pause in nanoseconds we aim for, 0 if there is no goal.
+  const uint64_t gc_pause_goal_;
+
+  // Moving average of the fraction of time spent in GC, measured from the end of one GC to the
+  // end of the next.
+  double gc_time_fraction_;
+
+  // Scales the free space we leave after a GC, grows when we spend too long in GC and shrinks
+  // back when we are well within the throughput goal.
+  double free_scale_;
+
+  // Scales the estimated bytes allocated during a concurrent GC, grows when pauses exceed the
+  // pause goal so that concurrent GCs start early enough to avoid blocking allocations.
+  double concurrent_headroom_scale_;
+
   // Total time which mutators are paused or waiting for GC to complete.
   uint64_t total_wait_time_;
 
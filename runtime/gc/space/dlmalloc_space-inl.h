@@ -18,6 +18,7 @@
 #define ART_RUNTIME_GC_SPACE_DLMALLOC_SPACE_INL_H_
 
 #include "dlmalloc_space.h"
+#include "thread.h"
 
 namespace art {
 namespace gc {
@@ -37,6 +38,24 @@ inline mirror::Object* DlMallocSpace::AllocNonvirtual(Thread* self, size_t num_b
   return obj;
 }
 
+inline mirror::Object* DlMallocSpace::AllocThreadLocal(Thread* self, size_t num_bytes,
+                                                       size_t* bytes_allocated) {
+  size_t chunk_size = ThreadLocalChunkSize(num_bytes);
+  byte* pos = self->GetThreadLocalPos();
+  if (UNLIKELY(pos == NULL ||
+               pos + chunk_size + kThreadLocalBufferReserve > self->GetThreadLocalEnd())) {
+    return NULL;
+  }
+  *reinterpret_cast<size_t*>(pos + kThreadLocalChunkHeaderOffset) =
+      ThreadLocalChunkHeader(chunk_size);
+  self->BumpThreadLocalPos(chunk_size);
+  mirror::Object* obj = reinterpret_cast<mirror::Object*>(pos);
+  memset(obj, 0, num_bytes);
+  DCHECK_EQ(AllocationSizeNonvirtual(obj), chunk_size);
+  *bytes_allocated = chunk_size;
+  return obj;
+}
+
 inline mirror::Object* DlMallocSpace::AllocWithoutGrowthLocked(size_t num_bytes, size_t* bytes_allocated) {
   mirror::Object* result = reinterpret_cast<mirror::Object*>(mspace_malloc(mspace_, num_bytes));
   if (result != NULL) {
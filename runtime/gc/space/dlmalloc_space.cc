@@ -22,6 +22,7 @@
 #include "thread.h"
 #include "utils.h"
 
+#include <sched.h>
 #include <valgrind.h>
 #include <../memcheck/memcheck.h>
 
@@ -41,6 +42,9 @@ namespace space {
 
 static const bool kPrefetchDuringDlMallocFreeList = true;
 
+// How long Trim holds the space lock at a time while advising free pages back to the kernel.
+static const uint64_t kTrimSliceNs = MsToNs(1);
+
 // Number of bytes to use as a red zone (rdz). A red zone of this size will be placed before and
 // after each allocation. 8 bytes provides long/double alignment.
 const size_t kValgrindRedZoneBytes = 8;
@@ -286,7 +290,7 @@ DlMallocSpace* DlMallocSpace::CreateZygoteSpace(const char* alloc_space_name) {
   DCHECK(IsAligned<kPageSize>(end_));
   size_t size = RoundUp(Size(), kPageSize);
   // Trim the heap so that we minimize the size of the Zygote space.
-  Trim();
+  const size_t reclaimed = Trim();
   // Trim our mem-map to free unused pages.
   GetMemMap()->UnMapAtEnd(end_);
   // TODO: Not hardcode these in?
@@ -298,6 +302,8 @@ DlMallocSpace* DlMallocSpace::CreateZygoteSpace(const char* alloc_space_name) {
   VLOG(heap) << "Begin " << reinterpret_cast<const void*>(begin_) << "\n"
              << "End " << reinterpret_cast<const void*>(end_) << "\n"
              << "Size " << size << "\n"
+             << "Allocated " << GetBytesAllocated() << "\n"
+             << "Reclaimed by trim " << reclaimed << "\n"
              << "GrowthLimit " << growth_limit_ << "\n"
              << "Capacity " << Capacity();
   SetGrowthLimit(RoundUp(size, kPageSize));
@@ -407,6 +413,55 @@ size_t DlMallocSpace::FreeList(Thread* self, size_t num_ptrs, mirror::Object** p
   }
 }
 
+bool DlMallocSpace::AllocThreadLocalBuffer(Thread* self, size_t buffer_size) {
+  DCHECK(!self->HasThreadLocalAllocationBuffer());
+  size_t chunk_size;
+  byte* start;
+  {
+    MutexLock mu(self, lock_);
+    start = reinterpret_cast<byte*>(AllocWithoutGrowthLocked(buffer_size, &chunk_size));
+  }
+  if (start == NULL) {
+    return false;
+  }
+  // The buffer's own chunk header must stay valid until revocation, so the first object is placed
+  // after a minimum sized placeholder chunk which is freed again when the buffer is revoked. The
+  // buffer ends at the start of the following chunk.
+  self->SetThreadLocalAllocationBuffer(start, start + kDlmallocMinChunkSize, start + chunk_size);
+  return true;
+}
+
+size_t DlMallocSpace::RevokeThreadLocalBuffer(Thread* thread) {
+  MutexLock mu(Thread::Current(), lock_);
+  // Re-read under the lock as a detaching thread may race with the GC revoking on its behalf.
+  byte* start = thread->GetThreadLocalStart();
+  if (start == NULL) {
+    return 0;
+  }
+  DCHECK(Contains(reinterpret_cast<mirror::Object*>(start)));
+  byte* pos = thread->GetThreadLocalPos();
+  const size_t remainder_size = thread->GetThreadLocalEnd() - pos;
+  const size_t num_objects = thread->GetThreadLocalObjectsAllocated();
+  DCHECK_GE(remainder_size, kThreadLocalBufferReserve);
+  // Shrink the buffer's chunk to the placeholder ahead of the first object and turn what is left
+  // after the last object into a chunk of its own, then free both. The objects in between already
+  // carry their own chunk headers.
+  size_t* start_head = reinterpret_cast<size_t*>(start - kDlmallocChunkOverhead);
+  *start_head = (*start_head & kDlmallocFlagBits) | kDlmallocMinChunkSize;
+  *reinterpret_cast<size_t*>(pos - kDlmallocChunkOverhead) =
+      remainder_size | kDlmallocPrevInUseBit | kDlmallocCurrentInUseBit;
+  mspace_free(mspace_, start);
+  mspace_free(mspace_, pos);
+  // The buffer was accounted as a single allocation, replace it by the objects carved from it.
+  const size_t unused_bytes = kDlmallocMinChunkSize + remainder_size;
+  num_bytes_allocated_ -= unused_bytes;
+  total_bytes_allocated_ -= unused_bytes;
+  num_objects_allocated_ = num_objects_allocated_ - 1 + num_objects;
+  total_objects_allocated_ = total_objects_allocated_ - 1 + num_objects;
+  thread->SetThreadLocalAllocationBuffer(NULL, NULL, NULL);
+  return unused_bytes;
+}
+
 // Callback from dlmalloc when it needs to increase the footprint
 extern "C" void* art_heap_morecore(void* mspace, intptr_t increment) {
   Heap* heap = Runtime::Current()->GetHeap();
@@ -453,14 +508,63 @@ size_t DlMallocSpace::AllocationSize(const mirror::Object* obj) {
   return InternalAllocationSize(obj);
 }
 
+struct IncrementalTrimContext {
+  // Chunks ending at or before this address were handled by an earlier slice.
+  uintptr_t resume;
+  uint64_t deadline_ns;
+  bool out_of_time;
+  // Whether this slice made progress, each slice advises at least one free chunk.
+  bool advised;
+  size_t reclaimed;
+};
+
+static void IncrementalTrimCallback(void* start, void* end, size_t used_bytes, void* arg) {
+  IncrementalTrimContext* context = reinterpret_cast<IncrementalTrimContext*>(arg);
+  uintptr_t chunk_end = reinterpret_cast<uintptr_t>(end);
+  if (context->out_of_time || chunk_end <= context->resume) {
+    return;
+  }
+  if (used_bytes == 0) {
+    // Only check the time for free chunks, the madvise calls are what the time is spent on.
+    if (context->advised && NanoTime() >= context->deadline_ns) {
+      context->out_of_time = true;
+      return;
+    }
+    // Chunks may have been coalesced since the last slice, skip what we already advised.
+    void* advise_start = reinterpret_cast<void*>(
+        std::max(reinterpret_cast<uintptr_t>(start), context->resume));
+    DlmallocMadviseCallback(advise_start, end, used_bytes, &context->reclaimed);
+    context->advised = true;
+  }
+  context->resume = chunk_end;
+}
+
 size_t DlMallocSpace::Trim() {
-  MutexLock mu(Thread::Current(), lock_);
-  // Trim to release memory at the end of the space.
-  mspace_trim(mspace_, 0);
-  // Visit space looking for page-sized holes to advise the kernel we don't need.
-  size_t reclaimed = 0;
-  mspace_inspect_all(mspace_, DlmallocMadviseCallback, &reclaimed);
-  return reclaimed;
+  Thread* self = Thread::Current();
+  {
+    MutexLock mu(self, lock_);
+    // Trim to release memory at the end of the space.
+    mspace_trim(mspace_, 0);
+  }
+  // Visit space looking for page-sized holes to advise the kernel we don't need. Every slice
+  // walks the chunks from the start, but only advises for kTrimSliceNs before dropping the lock so
+  // that allocating threads never wait long for us.
+  IncrementalTrimContext context;
+  context.resume = 0;
+  context.reclaimed = 0;
+  do {
+    {
+      MutexLock mu(self, lock_);
+      context.deadline_ns = NanoTime() + kTrimSliceNs;
+      context.out_of_time = false;
+      context.advised = false;
+      mspace_inspect_all(mspace_, IncrementalTrimCallback, &context);
+    }
+    if (context.out_of_time) {
+      sched_yield();
+    }
+  } while (context.out_of_time);
+  return context.reclaimed;
 }
 
 void DlMallocSpace::Walk(void(*callback)(void *start, void *end, size_t num_bytes, void* callback_arg),
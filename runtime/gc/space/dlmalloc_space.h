@@ -19,6 +19,7 @@
 
 #include "gc/allocator/dlmalloc.h"
 #include "space.h"
+#include "utils.h"
 
 namespace art {
 namespace gc {
@@ -63,6 +64,40 @@ class DlMallocSpace : public MemMapSpace, public AllocSpace {
 
   mirror::Object* AllocNonvirtual(Thread* self, size_t num_bytes, size_t* bytes_allocated);
 
+  // Bump allocate num_bytes from the calling thread's allocation buffer without taking the space's
+  // lock. Each object gets a proper dlmalloc chunk header so that it can later be freed
+  // individually. Returns NULL if the thread has no buffer or the buffer is exhausted.
+  mirror::Object* AllocThreadLocal(Thread* self, size_t num_bytes, size_t* bytes_allocated);
+
+  // Give the calling thread, which must not already own one, a new allocation buffer of at least
+  // buffer_size bytes. Returns false if the space cannot satisfy the request without growing.
+  bool AllocThreadLocalBuffer(Thread* self, size_t buffer_size) LOCKS_EXCLUDED(lock_);
+
+  // Split the thread's allocation buffer back into the individual chunks of the objects that were
+  // allocated from it, freeing the unused remainder. The thread must either be the caller or be
+  // suspended. Returns the number of unused bytes given back, 0 if the thread had no buffer.
+  size_t RevokeThreadLocalBuffer(Thread* thread) LOCKS_EXCLUDED(lock_);
+
+  // Size of the chunk AllocThreadLocal carves out for a num_bytes allocation, this is the same
+  // rounding as dlmalloc's request2size.
+  static size_t ThreadLocalChunkSize(size_t num_bytes) {
+    return std::max(RoundUp(num_bytes + kDlmallocChunkOverhead, kDlmallocChunkAlignment),
+                    kDlmallocMinChunkSize);
+  }
+
+  // The chunk header word AllocThreadLocal writes just before each object, the previous chunk is
+  // always in use.
+  static size_t ThreadLocalChunkHeader(size_t chunk_size) {
+    return chunk_size | kDlmallocPrevInUseBit | kDlmallocCurrentInUseBit;
+  }
+
+  // Offset from an object to the chunk header word written by AllocThreadLocal.
+  static constexpr int kThreadLocalChunkHeaderOffset = -static_cast<int>(kDlmallocChunkOverhead);
+
+  // Space that must remain at the end of an allocation buffer after any allocation so that the
+  // remainder can become a chunk of its own on revocation.
+  static constexpr size_t kThreadLocalBufferReserve = kDlmallocMinChunkSize;
+
   size_t AllocationSizeNonvirtual(const mirror::Object* obj) {
     return mspace_usable_size(const_cast<void*>(reinterpret_cast<const void*>(obj))) +
         kChunkOverhead;
@@ -74,8 +109,9 @@ class DlMallocSpace : public MemMapSpace, public AllocSpace {
     return mspace_;
   }
 
-  // Hands unused pages back to the system.
-  size_t Trim();
+  // Hands unused pages back to the system. Free pages are advised away in short time slices so
+  // that the space lock is never held for long.
+  size_t Trim() LOCKS_EXCLUDED(lock_);
 
   // Perform a mspace_inspect_all which calls back for each allocation chunk. The chunk may not be
   // in use, indicated by num_bytes equaling zero.
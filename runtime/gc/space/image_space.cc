@@ -16,9 +16,12 @@
 
 #include "image_space.h"
 
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 
+#include <algorithm>
+
 #include "base/stl_util.h"
 #include "base/unix_file/fd_file.h"
 #include "gc/accounting/space_bitmap-inl.h"
@@ -130,23 +133,36 @@ static bool GenerateImage(const std::string& image_file_name) {
   return true;
 }
 
+ImageSpace* ImageSpace::InitMaybeRelocated(const std::string& image_file_name,
+                                           bool validate_oat_file) {
+  // Relocation is an optimization, if it fails the image is mapped where it was linked instead.
+  if (Runtime::Current()->IsImageRelocationEnabled()) {
+    ImageSpace* image_space = Init(image_file_name, validate_oat_file, true);
+    if (image_space != NULL) {
+      return image_space;
+    }
+    LOG(WARNING) << "Failed to relocate " << image_file_name << ", mapping it at its base";
+  }
+  return Init(image_file_name, validate_oat_file, false);
+}
+
 ImageSpace* ImageSpace::Create(const std::string& original_image_file_name) {
   if (OS::FileExists(original_image_file_name.c_str())) {
     // If the /system file exists, it should be up-to-date, don't try to generate
-    return space::ImageSpace::Init(original_image_file_name, false);
+    return InitMaybeRelocated(original_image_file_name, false);
   }
   // If the /system file didn't exist, we need to use one from the dalvik-cache.
   // If the cache file exists, try to open, but if it fails, regenerate.
   // If it does not exist, generate.
   std::string image_file_name(GetDalvikCacheFilenameOrDie(original_image_file_name));
   if (OS::FileExists(image_file_name.c_str())) {
-    space::ImageSpace* image_space = space::ImageSpace::Init(image_file_name, true);
+    space::ImageSpace* image_space = InitMaybeRelocated(image_file_name, true);
     if (image_space != NULL) {
       return image_space;
     }
   }
   CHECK(GenerateImage(image_file_name)) << "Failed to generate image: " << image_file_name;
-  return space::ImageSpace::Init(image_file_name, true);
+  return InitMaybeRelocated(image_file_name, true);
 }
 
 void ImageSpace::VerifyImageAllocations() {
@@ -160,7 +176,8 @@ void ImageSpace::VerifyImageAllocations() {
   }
 }
 
-ImageSpace* ImageSpace::Init(const std::string& image_file_name, bool validate_oat_file) {
+ImageSpace* ImageSpace::Init(const std::string& image_file_name, bool validate_oat_file,
+                             bool relocate) {
   CHECK(!image_file_name.empty());
 
   uint64_t start_time = 0;
@@ -181,8 +198,22 @@ ImageSpace* ImageSpace::Init(const std::string& image_file_name, bool validate_o
     return NULL;
   }
 
+  // To relocate, find room for the image and its oat file together. The reservation is released
+  // straight away so that both can be mapped at fixed addresses in its place.
+  int32_t relocation_delta = 0;
+  if (relocate) {
+    size_t reservation_size = image_header.GetOatFileEnd() - image_header.GetImageBegin();
+    UniquePtr<MemMap> reservation(MemMap::MapAnonymous("image reservation", NULL,
+                                                       reservation_size, PROT_NONE));
+    if (reservation.get() == NULL) {
+      LOG(ERROR) << "Failed to reserve space to relocate " << image_file_name;
+      return NULL;
+    }
+    relocation_delta = reservation->Begin() - image_header.GetImageBegin();
+  }
+
   // Note: The image header is part of the image due to mmap page alignment required of offset.
-  UniquePtr<MemMap> map(MemMap::MapFileAtAddress(image_header.GetImageBegin(),
+  UniquePtr<MemMap> map(MemMap::MapFileAtAddress(image_header.GetImageBegin() + relocation_delta,
                                                  image_header.GetImageSize(),
                                                  PROT_READ | PROT_WRITE,
                                                  MAP_PRIVATE | MAP_FIXED,
@@ -193,9 +224,43 @@ ImageSpace* ImageSpace::Init(const std::string& image_file_name, bool validate_o
     LOG(ERROR) << "Failed to map " << image_file_name;
     return NULL;
   }
-  CHECK_EQ(image_header.GetImageBegin(), map->Begin());
   DCHECK_EQ(0, memcmp(&image_header, map->Begin(), sizeof(ImageHeader)));
 
+  // Pass on the access pattern hint. MADV_WILLNEED only schedules the read ahead, so the startup
+  // objects, which are laid out first, are read in while the rest of the runtime starts.
+  Runtime* runtime = Runtime::Current();
+  if (runtime->GetImageMadvise() != MADV_NORMAL &&
+      madvise(map->Begin(), map->Size(), runtime->GetImageMadvise()) == -1) {
+    PLOG(WARNING) << "madvise failed for " << image_file_name;
+  }
+  if (runtime->IsHotPrefetchEnabled() && image_header.GetHotObjectsEnd() != 0) {
+    size_t hot_size = std::min(RoundUp(image_header.GetHotObjectsEnd(), kPageSize), map->Size());
+    if (madvise(map->Begin(), hot_size, MADV_WILLNEED) == -1) {
+      PLOG(WARNING) << "madvise failed for " << image_file_name;
+    }
+  }
+
+  // The image is private, so adding the delta to every address in it only dirties this process's
+  // copy. The oat file is fixed up the same way once it is loaded.
+  UniquePtr<MemMap> relocations;
+  if (relocation_delta != 0) {
+    relocations.reset(MemMap::MapFileAtAddress(NULL, image_header.GetRelocationsSize(), PROT_READ,
+                                               MAP_PRIVATE, file->Fd(),
+                                               image_header.GetRelocationsOffset(), false));
+    if (relocations.get() == NULL) {
+      LOG(ERROR) << "Failed to map the relocations of " << image_file_name;
+      return NULL;
+    }
+    const uint32_t* image_relocations = reinterpret_cast<const uint32_t*>(relocations->Begin());
+    for (size_t i = 0; i < image_header.GetNumImageRelocations(); ++i) {
+      CHECK_LE(image_relocations[i] + sizeof(uint32_t), map->Size()) << image_file_name;
+      *reinterpret_cast<uint32_t*>(map->Begin() + image_relocations[i]) += relocation_delta;
+    }
+    reinterpret_cast<ImageHeader*>(map->Begin())->Relocate(relocation_delta);
+    image_header = *reinterpret_cast<ImageHeader*>(map->Begin());
+  }
+  CHECK_EQ(image_header.GetImageBegin(), map->Begin());
+
   UniquePtr<MemMap> image_map(MemMap::MapFileAtAddress(nullptr, image_header.GetImageBitmapSize(),
                                                        PROT_READ, MAP_PRIVATE,
                                                        file->Fd(), image_header.GetBitmapOffset(),
@@ -210,7 +275,6 @@ ImageSpace* ImageSpace::Init(const std::string& image_file_name, bool validate_o
                                                 map->Size()));
   CHECK(bitmap.get() != nullptr) << "could not create " << bitmap_name;
 
-  Runtime* runtime = Runtime::Current();
   mirror::Object* resolution_method = image_header.GetImageRoot(ImageHeader::kResolutionMethod);
   runtime->SetResolutionMethod(down_cast<mirror::ArtMethod*>(resolution_method));
 
@@ -226,12 +290,24 @@ ImageSpace* ImageSpace::Init(const std::string& image_file_name, bool validate_o
     space->VerifyImageAllocations();
   }
 
-  space->oat_file_.reset(space->OpenOatFile());
+  space->oat_file_.reset(space->OpenOatFile(relocation_delta));
   if (space->oat_file_.get() == NULL) {
     LOG(ERROR) << "Failed to open oat file for image: " << image_file_name;
     return NULL;
   }
 
+  if (relocation_delta != 0) {
+    const uint32_t* oat_relocations =
+        reinterpret_cast<const uint32_t*>(relocations->Begin()) +
+        image_header.GetNumImageRelocations();
+    if (!space->oat_file_->Relocate(oat_relocations, image_header.GetNumOatRelocations(),
+                                    relocation_delta)) {
+      LOG(ERROR) << "Failed to relocate oat file for image: " << image_file_name;
+      return NULL;
+    }
+    VLOG(startup) << "Relocated " << image_file_name << " by " << relocation_delta << " bytes";
+  }
+
   if (validate_oat_file && !space->ValidateOatFile()) {
     LOG(WARNING) << "Failed to validate oat file for image: " << image_file_name;
     return NULL;
@@ -244,7 +320,7 @@ ImageSpace* ImageSpace::Init(const std::string& image_file_name, bool validate_o
   return space.release();
 }
 
-OatFile* ImageSpace::OpenOatFile() const {
+OatFile* ImageSpace::OpenOatFile(int32_t relocation_delta) const {
   const Runtime* runtime = Runtime::Current();
   const ImageHeader& image_header = GetImageHeader();
   // Grab location but don't use Object::AsString as we haven't yet initialized the roots to
@@ -255,7 +331,7 @@ OatFile* ImageSpace::OpenOatFile() const {
   oat_filename += runtime->GetHostPrefix();
   oat_filename += oat_location->ToModifiedUtf8();
   OatFile* oat_file = OatFile::Open(oat_filename, oat_filename, image_header.GetOatDataBegin(),
-                                    !Runtime::Current()->IsCompiler());
+                                    !Runtime::Current()->IsCompiler(), relocation_delta);
   if (oat_file == NULL) {
     LOG(ERROR) << "Failed to open oat file " << oat_filename << " referenced from image.";
     return NULL;
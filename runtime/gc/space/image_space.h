@@ -84,10 +84,17 @@ class ImageSpace : public MemMapSpace {
   // image's OatFile is up-to-date relative to its DexFile
   // inputs. Otherwise (for /data), validate the inputs and generate
   // the OatFile in /data/dalvik-cache if necessary.
-  static ImageSpace* Init(const std::string& image, bool validate_oat_file)
+  //
+  // If relocate is true, the image and its oat file are mapped together wherever the kernel finds
+  // room for them and their addresses are fixed up from the relocation table of the image, rather
+  // than mapped where they were linked.
+  static ImageSpace* Init(const std::string& image, bool validate_oat_file, bool relocate)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  static ImageSpace* InitMaybeRelocated(const std::string& image, bool validate_oat_file)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
-  OatFile* OpenOatFile() const
+  OatFile* OpenOatFile(int32_t relocation_delta) const
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   bool ValidateOatFile() const
@@ -160,13 +160,19 @@ void FreeListSpace::Walk(DlMallocSpace::WalkCallback callback, void* arg) {
   }
 }
 
+void FreeListSpace::InsertFreePrev(AllocationHeader* header) {
+  DCHECK(!header->IsFree());
+  DCHECK_GT(header->GetPrevFree(), size_t(0));
+  free_blocks_[GetFreeBin(header->GetPrevFree())].insert(header);
+}
+
 void FreeListSpace::RemoveFreePrev(AllocationHeader* header) {
   CHECK(!header->IsFree());
   CHECK_GT(header->GetPrevFree(), size_t(0));
-  FreeBlocks::iterator found = free_blocks_.lower_bound(header);
-  CHECK(found != free_blocks_.end());
-  CHECK_EQ(*found, header);
-  free_blocks_.erase(found);
+  FreeBlocks& bin = free_blocks_[GetFreeBin(header->GetPrevFree())];
+  FreeBlocks::iterator found = bin.find(header);
+  CHECK(found != bin.end());
+  bin.erase(found);
 }
 
 FreeListSpace::AllocationHeader* FreeListSpace::GetAllocationHeader(const mirror::Object* obj) {
@@ -222,7 +228,7 @@ size_t FreeListSpace::Free(Thread* self, mirror::Object* obj) {
       new_free_header = next_header;
     }
     new_free_header->prev_free_ = new_free_size;
-    free_blocks_.insert(new_free_header);
+    InsertFreePrev(new_free_header);
   }
   --num_objects_allocated_;
   DCHECK_LE(allocation_size, num_bytes_allocated_);
@@ -249,15 +255,24 @@ size_t FreeListSpace::AllocationSize(const mirror::Object* obj) {
 mirror::Object* FreeListSpace::Alloc(Thread* self, size_t num_bytes, size_t* bytes_allocated) {
   MutexLock mu(self, lock_);
   size_t allocation_size = RoundUp(num_bytes + sizeof(AllocationHeader), kAlignment);
-  AllocationHeader temp;
-  temp.SetPrevFree(allocation_size);
-  temp.SetAllocationSize(0);
   AllocationHeader* new_header;
-  // Find the smallest chunk at least num_bytes in size.
-  FreeBlocks::iterator found = free_blocks_.lower_bound(&temp);
-  if (found != free_blocks_.end()) {
-    AllocationHeader* header = *found;
-    free_blocks_.erase(found);
+  // Blocks in the smallest bin which can hold the allocation may still be too small, take the
+  // lowest addressed one which fits. Any block in a larger bin fits.
+  AllocationHeader* header = NULL;
+  const size_t min_bin = GetFreeBin(allocation_size);
+  for (AllocationHeader* candidate : free_blocks_[min_bin]) {
+    if (candidate->GetPrevFree() >= allocation_size) {
+      header = candidate;
+      break;
+    }
+  }
+  for (size_t bin = min_bin + 1; header == NULL && bin < kNumFreeBins; ++bin) {
+    if (!free_blocks_[bin].empty()) {
+      header = *free_blocks_[bin].begin();
+    }
+  }
+  if (header != NULL) {
+    RemoveFreePrev(header);
 
     // Fit our object in the previous free header space.
     new_header = header->GetPrevFreeAllocationHeader();
@@ -266,7 +281,7 @@ mirror::Object* FreeListSpace::Alloc(Thread* self, size_t num_bytes, size_t* byt
     header->prev_free_ -= allocation_size;
     if (header->prev_free_ > 0) {
       // If there is remaining space, insert back into the free set.
-      free_blocks_.insert(header);
+      InsertFreePrev(header);
     }
   } else {
     // Try to steal some memory from the free space at the end of the space.
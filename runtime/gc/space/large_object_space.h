@@ -22,6 +22,7 @@
 #include "safe_map.h"
 #include "space.h"
 
+#include <algorithm>
 #include <set>
 #include <vector>
 
@@ -102,7 +103,9 @@ class LargeObjectMapSpace : public LargeObjectSpace {
   MemMaps mem_maps_ GUARDED_BY(lock_);
 };
 
-// A continuous large object space with a free-list to handle holes.
+// A continuous large object space with a free-list to handle holes. Free blocks are binned by the
+// power of two of their size in pages, and allocation takes the lowest addressed block that fits
+// from the smallest bin that can hold the request.
 class FreeListSpace : public LargeObjectSpace {
  public:
   virtual ~FreeListSpace();
@@ -134,6 +137,9 @@ class FreeListSpace : public LargeObjectSpace {
  private:
   static const size_t kAlignment = kPageSize;
 
+  // Bin i holds free blocks of [2^i, 2^(i+1)) pages, the last bin also holds everything larger.
+  static const size_t kNumFreeBins = 20;
+
   class AllocationHeader {
    public:
     // Returns the allocation size, includes the header.
@@ -183,20 +189,6 @@ class FreeListSpace : public LargeObjectSpace {
     // TODO: Optimize, currently O(n) for n free following pages.
     AllocationHeader* GetNextNonFree();
 
-    // Used to implement best fit object allocation. Each allocation has an AllocationHeader which
-    // contains the size of the previous free block preceding it. Implemented in such a way that we
-    // can also find the iterator for any allocation header pointer.
-    class SortByPrevFree {
-     public:
-      bool operator()(const AllocationHeader* a, const AllocationHeader* b) const {
-        if (a->GetPrevFree() < b->GetPrevFree()) return true;
-        if (a->GetPrevFree() > b->GetPrevFree()) return false;
-        if (a->AllocationSize() < b->AllocationSize()) return true;
-        if (a->AllocationSize() > b->AllocationSize()) return false;
-        return reinterpret_cast<uintptr_t>(a) < reinterpret_cast<uintptr_t>(b);
-      }
-    };
-
    private:
     // Contains the size of the previous free block, if 0 then the memory preceding us is an
     // allocation.
@@ -210,13 +202,24 @@ class FreeListSpace : public LargeObjectSpace {
 
   FreeListSpace(const std::string& name, MemMap* mem_map, byte* begin, byte* end);
 
-  // Removes header from the free blocks set by finding the corresponding iterator and erasing it.
+  // Returns the bin for a free block of free_size bytes.
+  static size_t GetFreeBin(size_t free_size) {
+    DCHECK_GE(free_size, kAlignment);
+    const size_t pages = free_size / kAlignment;
+    return std::min(static_cast<size_t>(kBitsPerWord - 1 - CLZ(pages)), kNumFreeBins - 1);
+  }
+
+  // Adds the free block preceding header to its bin, header's prev free must be set.
+  void InsertFreePrev(AllocationHeader* header) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Removes the free block preceding header from its bin.
   void RemoveFreePrev(AllocationHeader* header) EXCLUSIVE_LOCKS_REQUIRED(lock_);
 
   // Finds the allocation header corresponding to obj.
   AllocationHeader* GetAllocationHeader(const mirror::Object* obj);
 
-  typedef std::set<AllocationHeader*, AllocationHeader::SortByPrevFree,
+  // Free blocks are represented by the allocation header following them, sorted by address.
+  typedef std::set<AllocationHeader*, std::less<AllocationHeader*>,
                    accounting::GCAllocator<AllocationHeader*> > FreeBlocks;
 
   byte* const begin_;
@@ -227,7 +230,7 @@ class FreeListSpace : public LargeObjectSpace {
   UniquePtr<MemMap> mem_map_;
   Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   size_t free_end_ GUARDED_BY(lock_);
-  FreeBlocks free_blocks_ GUARDED_BY(lock_);
+  FreeBlocks free_blocks_[kNumFreeBins] GUARDED_BY(lock_);
 };
 
 }  // namespace space
@@ -15,6 +15,7 @@
  */
 
 #include "dlmalloc_space.h"
+#include "dlmalloc_space-inl.h"
 #include "large_object_space.h"
 
 #include "common_test.h"
@@ -303,6 +304,61 @@ TEST_F(SpaceTest, AllocAndFreeList) {
   }
 }
 
+TEST_F(SpaceTest, ThreadLocalAllocationBuffer) {
+  DlMallocSpace* space(DlMallocSpace::Create("test", 4 * MB, 16 * MB, 16 * MB, NULL));
+  ASSERT_TRUE(space != NULL);
+
+  // Make space findable to the heap, will also delete space when runtime is cleaned up
+  AddContinuousSpace(space);
+  Thread* self = Thread::Current();
+
+  // Give back any buffer the runtime handed out to this thread during start up.
+  Runtime::Current()->GetHeap()->RevokeThreadLocalBuffers(self);
+  size_t dummy = 0;
+  EXPECT_TRUE(space->AllocThreadLocal(self, 16, &dummy) == NULL);
+
+  ASSERT_TRUE(space->AllocThreadLocalBuffer(self, 16 * KB));
+  EXPECT_EQ(1U, space->GetObjectsAllocated());
+
+  // Bump allocate until the buffer is exhausted, each object must be a valid dlmalloc chunk.
+  mirror::Object* lots_of_objects[1024];
+  size_t num_objects = 0;
+  size_t bytes_allocated = 0;
+  size_t seed = 123456789;
+  while (num_objects < arraysize(lots_of_objects)) {
+    size_t allocation_size = 0;
+    size_t request_size = 8 + test_rand(&seed) % 256;
+    mirror::Object* obj = space->AllocThreadLocal(self, request_size, &allocation_size);
+    if (obj == NULL) {
+      break;
+    }
+    EXPECT_EQ(allocation_size, space->AllocationSize(obj));
+    EXPECT_LE(request_size, allocation_size);
+    if (num_objects > 0) {
+      EXPECT_LT(reinterpret_cast<byte*>(lots_of_objects[num_objects - 1]),
+                reinterpret_cast<byte*>(obj));
+    }
+    memset(obj, 0xEF, request_size);
+    lots_of_objects[num_objects++] = obj;
+    bytes_allocated += allocation_size;
+  }
+  EXPECT_LT(0U, num_objects);
+
+  // Revoking leaves exactly the carved out objects allocated.
+  space->RevokeThreadLocalBuffer(self);
+  EXPECT_FALSE(self->HasThreadLocalAllocationBuffer());
+  EXPECT_EQ(num_objects, space->GetObjectsAllocated());
+  EXPECT_EQ(bytes_allocated, space->GetBytesAllocated());
+  for (size_t i = 0; i < num_objects; ++i) {
+    EXPECT_TRUE(space->Contains(lots_of_objects[i]));
+  }
+
+  // The objects can be freed like any other.
+  space->FreeList(self, num_objects, lots_of_objects);
+  EXPECT_EQ(0U, space->GetObjectsAllocated());
+  EXPECT_EQ(0U, space->GetBytesAllocated());
+}
+
 void SpaceTest::SizeFootPrintGrowthLimitAndTrimBody(DlMallocSpace* space, intptr_t object_size,
                                                     int round, size_t growth_limit) {
   if (((object_size > 0 && object_size >= static_cast<intptr_t>(growth_limit))) ||
@@ -24,7 +24,9 @@
 
 namespace art {
 
-// Lightweight wrapper for native PC offset to reference bit maps.
+// Lightweight wrapper for native PC offset to reference bit maps. After a 4 byte header with the
+// widths and the number of entries, each entry is a native PC offset followed by the bitmap of
+// the registers holding references, in native PC offset order.
 class NativePcOffsetToReferenceMap {
  public:
   explicit NativePcOffsetToReferenceMap(const uint8_t* data) : data_(data) {
@@ -62,24 +64,24 @@ class NativePcOffsetToReferenceMap {
     return false;
   }
 
-  // Finds the bitmap associated with the native pc offset.
+  // Finds the bitmap associated with the native pc offset. The entries are sorted by native pc
+  // offset, so this is a binary search.
   const uint8_t* FindBitMap(uintptr_t native_pc_offset) {
-    size_t num_entries = NumEntries();
-    size_t index = Hash(native_pc_offset) % num_entries;
-    size_t misses = 0;
-    while (GetNativePcOffset(index) != native_pc_offset) {
-      index = (index + 1) % num_entries;
-      misses++;
-      DCHECK_LT(misses, num_entries) << "Failed to find offset: " << native_pc_offset;
+    size_t low = 0;
+    size_t high = NumEntries();
+    while (low < high) {
+      size_t mid = low + (high - low) / 2;
+      uintptr_t mid_offset = GetNativePcOffset(mid);
+      if (mid_offset < native_pc_offset) {
+        low = mid + 1;
+      } else if (mid_offset > native_pc_offset) {
+        high = mid;
+      } else {
+        return GetBitMap(mid);
+      }
     }
-    return GetBitMap(index);
-  }
-
-  static uint32_t Hash(uint32_t native_offset) {
-    uint32_t hash = native_offset;
-    hash ^= (hash >> 20) ^ (hash >> 12);
-    hash ^= (hash >> 7) ^ (hash >> 4);
-    return hash;
+    LOG(FATAL) << "Failed to find offset: " << native_pc_offset;
+    return NULL;
   }
 
   // The number of bytes used to encode registers.
@@ -87,6 +89,11 @@ class NativePcOffsetToReferenceMap {
     return (static_cast<size_t>(data_[0]) | (static_cast<size_t>(data_[1]) << 8)) >> 3;
   }
 
+  // The number of bytes of the header and table.
+  size_t Size() const {
+    return 4 + NumEntries() * EntryWidth();
+  }
+
  private:
   // Skip the size information at the beginning of data.
   const uint8_t* Table() const {
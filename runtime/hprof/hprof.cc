@@ -16,17 +16,17 @@
 
 /*
  * Preparation and completion of hprof data generation.  The output is
- * written into two files and then combined.  This is necessary because
- * we generate some of the data (strings and classes) while we dump the
- * heap, and some analysis tools require that the class and string data
- * appear first.
+ * streamed to the file as the heap is walked.  Some of the data (strings
+ * and classes) is generated while we dump the heap, and some analysis
+ * tools require that the class and string data appear first, so those
+ * records are held back until just before the segment that refers to them.
  */
 
 #include "hprof.h"
 
-#include <cutils/open_memstream.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/time.h>
@@ -35,9 +35,16 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <zlib.h>
+
+#include <deque>
+#include <map>
 #include <set>
+#include <vector>
 
 #include "base/logging.h"
+#include "base/mutex.h"
+#include "base/stl_util.h"
 #include "base/stringprintf.h"
 #include "base/unix_file/fd_file.h"
 #include "class_linker.h"
@@ -45,6 +52,7 @@
 #include "debugger.h"
 #include "dex_file-inl.h"
 #include "gc/accounting/heap_bitmap.h"
+#include "gc/accounting/space_bitmap-inl.h"
 #include "gc/heap.h"
 #include "gc/space/space.h"
 #include "globals.h"
@@ -57,6 +65,7 @@
 #include "safe_map.h"
 #include "scoped_thread_state_change.h"
 #include "thread_list.h"
+#include "thread_pool.h"
 
 namespace art {
 
@@ -68,6 +77,9 @@ namespace hprof {
 #define HPROF_NULL_STACK_TRACE   0
 #define HPROF_NULL_THREAD        0
 
+// The start of a compact dump, which is followed by the zlib stream.
+static const char kCompactMagic[] = "ART COMPACT HPROF 1";
+
 #define U2_TO_BUF_BE(buf, offset, value) \
     do { \
       unsigned char* buf_ = (unsigned char*)(buf); \
@@ -147,6 +159,10 @@ enum HprofHeapTag {
   HPROF_ROOT_JNI_MONITOR = 0x8e,
   HPROF_UNREACHABLE = 0x90,  // Obsolete.
   HPROF_PRIMITIVE_ARRAY_NODATA_DUMP = 0xc3,  // Obsolete.
+
+  // Compact dumps only, see ExpandCompactDump.
+  HPROF_PRIMITIVE_ARRAY_DUPLICATE = 0xc4,
+  HPROF_INSTANCE_DUMP_SPARSE = 0xc5,
 };
 
 enum HprofHeapId {
@@ -176,6 +192,197 @@ typedef std::set<mirror::Class*>::iterator ClassSetIterator;
 typedef SafeMap<std::string, size_t> StringMap;
 typedef SafeMap<std::string, size_t>::iterator StringMapIterator;
 
+// Where the records of a heap dump go. When writing to a file the data goes through a fixed size
+// buffer, so the dump never holds more than that in memory. Otherwise, for DDMS which takes the
+// whole dump as one chunk and for records which have to wait their turn, the data accumulates in
+// memory. Compressed output is deflated and written by a background thread, so that compression
+// overlaps with walking the heap.
+class HprofOutput {
+ public:
+  static const size_t kBufferSize = 64 * KB;
+  // The number of buffers waiting to be compressed before the writers wait.
+  static const size_t kMaxQueuedBuffers = 4;
+
+  // Doesn't take ownership of the file, which may be NULL. Compressing requires a file.
+  HprofOutput(File* file, bool compress)
+      : file_(file),
+        size_(0),
+        error_(false),
+        compress_(compress),
+        queue_lock_("hprof compression queue lock"),
+        queue_cond_("hprof compression queue condition variable", queue_lock_),
+        finishing_(false),
+        compression_failed_(false) {
+    if (file_ != NULL) {
+      buffer_.reserve(kBufferSize);
+    }
+    if (compress_) {
+      CHECK(file_ != NULL);
+      memset(&zstream_, 0, sizeof(zstream_));
+      CHECK_EQ(deflateInit(&zstream_, Z_DEFAULT_COMPRESSION), Z_OK);
+      CHECK_PTHREAD_CALL(pthread_create, (&compression_pthread_, NULL, &RunCompressionThread, this),
+                         "hprof compression thread");
+    }
+  }
+
+  ~HprofOutput() {
+    if (compress_) {
+      Finish();
+      deflateEnd(&zstream_);
+    }
+  }
+
+  int Write(const void* data, size_t length) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    size_ += length;
+    if (file_ != NULL && buffer_.size() + length > kBufferSize) {
+      if (!Flush()) {
+        return UNIQUE_ERROR;
+      }
+      if (length >= kBufferSize) {
+        return WriteToFile(bytes, length) ? 0 : UNIQUE_ERROR;
+      }
+    }
+    buffer_.insert(buffer_.end(), bytes, bytes + length);
+    return 0;
+  }
+
+  // Appends the data of an in-memory output, and empties it.
+  int Append(HprofOutput* other) {
+    DCHECK(other->file_ == NULL);
+    int err = other->buffer_.empty() ? 0 : Write(&other->buffer_[0], other->buffer_.size());
+    other->buffer_.clear();
+    return err;
+  }
+
+  // Writes out the buffered data, if there is a file.
+  bool Flush() {
+    if (file_ != NULL && !buffer_.empty()) {
+      WriteToFile(&buffer_[0], buffer_.size());
+      buffer_.clear();
+    }
+    return !error_;
+  }
+
+  // Flushes the output and, when compressing, waits for the compressed data to be written.
+  bool Finish() {
+    Flush();
+    if (compress_) {
+      Thread* self = Thread::Current();
+      {
+        MutexLock mu(self, queue_lock_);
+        if (finishing_) {
+          return !error_;
+        }
+        finishing_ = true;
+        queue_cond_.Broadcast(self);
+      }
+      CHECK_PTHREAD_CALL(pthread_join, (compression_pthread_, NULL), "hprof compression thread");
+      if (compression_failed_) {
+        error_ = true;
+      }
+    }
+    return !error_;
+  }
+
+  // The data of an in-memory output.
+  std::vector<uint8_t>& GetData() {
+    return buffer_;
+  }
+
+  // The number of bytes written so far, before compression.
+  size_t Size() const {
+    return size_;
+  }
+
+  bool HasError() const {
+    return error_;
+  }
+
+ private:
+  bool WriteToFile(const uint8_t* data, size_t length) {
+    if (compress_) {
+      Thread* self = Thread::Current();
+      MutexLock mu(self, queue_lock_);
+      while (queue_.size() >= kMaxQueuedBuffers) {
+        // The compression thread doesn't take any other lock, it will make room.
+        queue_cond_.WaitHoldingLocks(self);
+      }
+      queue_.push_back(new std::vector<uint8_t>(data, data + length));
+      queue_cond_.Broadcast(self);
+    } else if (!file_->WriteFully(data, length)) {
+      error_ = true;
+    }
+    return !error_;
+  }
+
+  static void* RunCompressionThread(void* arg) LOCKS_EXCLUDED(queue_lock_) {
+    // The thread isn't attached to the runtime, it only moves bytes and is never suspended.
+    HprofOutput* output = reinterpret_cast<HprofOutput*>(arg);
+    while (true) {
+      std::vector<uint8_t>* buffer;
+      {
+        MutexLock mu(NULL, output->queue_lock_);
+        while (output->queue_.empty() && !output->finishing_) {
+          output->queue_cond_.Wait(NULL);
+        }
+        if (output->queue_.empty()) {
+          break;
+        }
+        buffer = output->queue_.front();
+        output->queue_.pop_front();
+        output->queue_cond_.Broadcast(NULL);
+      }
+      output->Deflate(&(*buffer)[0], buffer->size(), Z_NO_FLUSH);
+      delete buffer;
+    }
+    output->Deflate(NULL, 0, Z_FINISH);
+    return NULL;
+  }
+
+  // Only called by the compression thread.
+  void Deflate(const uint8_t* data, size_t length, int flush) {
+    uint8_t out[kBufferSize];
+    zstream_.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(data));
+    zstream_.avail_in = length;
+    int zerr;
+    do {
+      zstream_.next_out = reinterpret_cast<Bytef*>(out);
+      zstream_.avail_out = sizeof(out);
+      zerr = deflate(&zstream_, flush);
+      if (zerr == Z_STREAM_ERROR) {
+        LOG(ERROR) << "hprof: deflate failed";
+        compression_failed_ = true;
+        return;
+      }
+      size_t out_length = sizeof(out) - zstream_.avail_out;
+      if (!compression_failed_ && out_length != 0 && !file_->WriteFully(out, out_length)) {
+        PLOG(ERROR) << "hprof: writing compressed data failed";
+        compression_failed_ = true;
+      }
+    } while (zstream_.avail_out == 0 || (flush == Z_FINISH && zerr != Z_STREAM_END));
+  }
+
+  File* const file_;
+  std::vector<uint8_t> buffer_;
+  size_t size_;
+  bool error_;
+
+  const bool compress_;
+  // Buffers waiting to be compressed. A default level lock since the compression thread isn't
+  // attached.
+  Mutex queue_lock_;
+  ConditionVariable queue_cond_ GUARDED_BY(queue_lock_);
+  std::deque<std::vector<uint8_t>*> queue_ GUARDED_BY(queue_lock_);
+  bool finishing_ GUARDED_BY(queue_lock_);
+  pthread_t compression_pthread_;
+  // Only used by the compression thread, then by Finish once it has been joined.
+  z_stream zstream_;
+  bool compression_failed_;
+
+  DISALLOW_COPY_AND_ASSIGN(HprofOutput);
+};
+
 // Represents a top-level hprof record, whose serialized format is:
 // U1  TAG: denoting the type of the record
 // U4  TIME: number of microseconds since the time stamp in the header
@@ -187,20 +394,20 @@ class HprofRecord {
     dirty_ = false;
     alloc_length_ = 128;
     body_ = reinterpret_cast<unsigned char*>(malloc(alloc_length_));
-    fp_ = NULL;
+    out_ = NULL;
   }
 
   ~HprofRecord() {
     free(body_);
   }
 
-  int StartNewRecord(FILE* fp, uint8_t tag, uint32_t time) {
+  int StartNewRecord(HprofOutput* out, uint8_t tag, uint32_t time) {
     int rc = Flush();
     if (rc != 0) {
       return rc;
     }
 
-    fp_ = fp;
+    out_ = out;
     tag_ = tag;
     time_ = time;
     length_ = 0;
@@ -216,13 +423,13 @@ class HprofRecord {
       U4_TO_BUF_BE(headBuf, 1, time_);
       U4_TO_BUF_BE(headBuf, 5, length_);
 
-      int nb = fwrite(headBuf, 1, sizeof(headBuf), fp_);
-      if (nb != sizeof(headBuf)) {
-        return UNIQUE_ERROR;
+      int err = out_->Write(headBuf, sizeof(headBuf));
+      if (err != 0) {
+        return err;
       }
-      nb = fwrite(body_, 1, length_, fp_);
-      if (nb != static_cast<int>(length_)) {
-        return UNIQUE_ERROR;
+      err = out_->Write(body_, length_);
+      if (err != 0) {
+        return err;
       }
 
       dirty_ = false;
@@ -330,6 +537,16 @@ class HprofRecord {
     return length_;
   }
 
+  const unsigned char* Body() const {
+    return body_;
+  }
+
+  // Drops the data after the first length bytes of the body.
+  void Truncate(size_t length) {
+    CHECK_LE(length, length_);
+    length_ = length;
+  }
+
  private:
   int GuaranteeRecordAppend(size_t nmore) {
     size_t minSize = length_ + nmore;
@@ -355,7 +572,7 @@ class HprofRecord {
   size_t alloc_length_;
   unsigned char* body_;
 
-  FILE* fp_;
+  HprofOutput* out_;
   uint8_t tag_;
   uint32_t time_;
   size_t length_;
@@ -364,253 +581,69 @@ class HprofRecord {
   DISALLOW_COPY_AND_ASSIGN(HprofRecord);
 };
 
+// A heap dump, written while all other threads are suspended. The heap is walked in parallel by
+// the heap's thread pool, each worker building its own heap dump segments, which are merged into
+// the output as they fill up. The string and class records that a segment refers to are written
+// just before it, since some analysis tools require that they appear first.
 class Hprof {
  public:
-  Hprof(const char* output_filename, int fd, bool direct_to_ddms)
+  Hprof(const char* output_filename, int fd, bool direct_to_ddms, bool compact)
       : filename_(output_filename),
         fd_(fd),
         direct_to_ddms_(direct_to_ddms),
+        compact_(compact && !direct_to_ddms),
         start_ns_(NanoTime()),
-        current_record_(),
-        gc_thread_serial_number_(0),
-        gc_scan_state_(0),
-        current_heap_(HPROF_HEAP_DEFAULT),
-        objects_in_segment_(0),
-        header_fp_(NULL),
-        header_data_ptr_(NULL),
-        header_data_size_(0),
-        body_fp_(NULL),
-        body_data_ptr_(NULL),
-        body_data_size_(0),
+        lock_("hprof lock", kHprofLock),
+        pending_records_(NULL, false),
+        next_class_serial_number_(1),
         next_string_id_(0x400000) {
     LOG(INFO) << "hprof: heap dump \"" << filename_ << "\" starting...";
-
-    header_fp_ = open_memstream(&header_data_ptr_, &header_data_size_);
-    if (header_fp_ == NULL) {
-      PLOG(FATAL) << "header open_memstream failed";
-    }
-
-    body_fp_ = open_memstream(&body_data_ptr_, &body_data_size_);
-    if (body_fp_ == NULL) {
-      PLOG(FATAL) << "body open_memstream failed";
-    }
-  }
-
-  ~Hprof() {
-    if (header_fp_ != NULL) {
-      fclose(header_fp_);
-    }
-    if (body_fp_ != NULL) {
-      fclose(body_fp_);
-    }
-    free(header_data_ptr_);
-    free(body_data_ptr_);
   }
 
   void Dump()
       EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_)
-      LOCKS_EXCLUDED(Locks::heap_bitmap_lock_) {
-    // Walk the roots and the heap.
-    current_record_.StartNewRecord(body_fp_, HPROF_TAG_HEAP_DUMP_SEGMENT, HPROF_TIME);
-    Runtime::Current()->VisitRoots(RootVisitor, this, false, false);
-    Thread* self = Thread::Current();
-    {
-      WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
-      Runtime::Current()->GetHeap()->FlushAllocStack();
-    }
-    {
-      ReaderMutexLock mu(self, *Locks::heap_bitmap_lock_);
-      Runtime::Current()->GetHeap()->GetLiveBitmap()->Walk(HeapBitmapCallback, this);
-    }
-    current_record_.StartNewRecord(body_fp_, HPROF_TAG_HEAP_DUMP_END, HPROF_TIME);
-    current_record_.Flush();
-    fflush(body_fp_);
-
-    // Write the header.
-    WriteFixedHeader();
-    // Write the string and class tables, and any stack traces, to the header.
-    // (jhat requires that these appear before any of the data in the body that refers to them.)
-    WriteStringTable();
-    WriteClassTable();
-    WriteStackTraces();
-    current_record_.Flush();
-    fflush(header_fp_);
-
-    bool okay = true;
-    if (direct_to_ddms_) {
-      // Send the data off to DDMS.
-      iovec iov[2];
-      iov[0].iov_base = header_data_ptr_;
-      iov[0].iov_len = header_data_size_;
-      iov[1].iov_base = body_data_ptr_;
-      iov[1].iov_len = body_data_size_;
-      Dbg::DdmSendChunkV(CHUNK_TYPE("HPDS"), iov, 2);
-    } else {
-      // Where exactly are we writing to?
-      int out_fd;
-      if (fd_ >= 0) {
-        out_fd = dup(fd_);
-        if (out_fd < 0) {
-          ThrowRuntimeException("Couldn't dump heap; dup(%d) failed: %s", fd_, strerror(errno));
-          return;
-        }
-      } else {
-        out_fd = open(filename_.c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0644);
-        if (out_fd < 0) {
-          ThrowRuntimeException("Couldn't dump heap; open(\"%s\") failed: %s", filename_.c_str(),
-                                strerror(errno));
-          return;
-        }
-      }
-
-      UniquePtr<File> file(new File(out_fd, filename_));
-      okay = file->WriteFully(header_data_ptr_, header_data_size_) &&
-          file->WriteFully(body_data_ptr_, body_data_size_);
-      if (!okay) {
-        std::string msg(StringPrintf("Couldn't dump heap; writing \"%s\" failed: %s",
-                                     filename_.c_str(), strerror(errno)));
-        ThrowRuntimeException("%s", msg.c_str());
-        LOG(ERROR) << msg;
-      }
-    }
+      LOCKS_EXCLUDED(Locks::heap_bitmap_lock_, lock_);
 
-    // Throw out a log message for the benefit of "runhat".
-    if (okay) {
-      uint64_t duration = NanoTime() - start_ns_;
-      LOG(INFO) << "hprof: heap dump completed ("
-          << PrettySize(header_data_size_ + body_data_size_ + 1023)
-          << ") in " << PrettyDuration(duration);
-    }
+  HprofOutput* GetOutput() {
+    return output_.get();
   }
 
- private:
-  static void RootVisitor(const mirror::Object* obj, void* arg)
-      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
-    CHECK(arg != NULL);
-    Hprof* hprof = reinterpret_cast<Hprof*>(arg);
-    hprof->VisitRoot(obj);
+  bool IsCompact() const {
+    return compact_;
   }
 
-  static void HeapBitmapCallback(mirror::Object* obj, void* arg)
-      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
-    CHECK(obj != NULL);
-    CHECK(arg != NULL);
-    Hprof* hprof = reinterpret_cast<Hprof*>(arg);
-    hprof->DumpHeapObject(obj);
-  }
-
-  void VisitRoot(const mirror::Object* obj) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
-
-  int DumpHeapObject(mirror::Object* obj) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
-
-  void Finish() {
-  }
-
-  int WriteClassTable() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
-    HprofRecord* rec = &current_record_;
-    uint32_t nextSerialNumber = 1;
-
-    for (ClassSetIterator it = classes_.begin(); it != classes_.end(); ++it) {
-      const mirror::Class* c = *it;
-      CHECK(c != NULL);
-
-      int err = current_record_.StartNewRecord(header_fp_, HPROF_TAG_LOAD_CLASS, HPROF_TIME);
-      if (err != 0) {
-        return err;
-      }
-
-      // LOAD CLASS format:
-      // U4: class serial number (always > 0)
-      // ID: class object ID. We use the address of the class object structure as its ID.
-      // U4: stack trace serial number
-      // ID: class name string ID
-      rec->AddU4(nextSerialNumber++);
-      rec->AddId((HprofClassObjectId) c);
-      rec->AddU4(HPROF_NULL_STACK_TRACE);
-      rec->AddId(LookupClassNameId(c));
-    }
-
-    return 0;
-  }
-
-  int WriteStringTable() {
-    HprofRecord* rec = &current_record_;
-
-    for (StringMapIterator it = strings_.begin(); it != strings_.end(); ++it) {
-      std::string string((*it).first);
-      size_t id = (*it).second;
-
-      int err = current_record_.StartNewRecord(header_fp_, HPROF_TAG_STRING, HPROF_TIME);
-      if (err != 0) {
-        return err;
-      }
-
-      // STRING format:
-      // ID:  ID for this string
-      // U1*: UTF8 characters for string (NOT NULL terminated)
-      //      (the record format encodes the length)
-      err = rec->AddU4(id);
-      if (err != 0) {
-        return err;
-      }
-      err = rec->AddUtf8String(string.c_str());
-      if (err != 0) {
-        return err;
-      }
-    }
-
-    return 0;
-  }
-
-  void StartNewHeapDumpSegment() {
-    // This flushes the old segment and starts a new one.
-    current_record_.StartNewRecord(body_fp_, HPROF_TAG_HEAP_DUMP_SEGMENT, HPROF_TIME);
-    objects_in_segment_ = 0;
-
-    // Starting a new HEAP_DUMP resets the heap to default.
-    current_heap_ = HPROF_HEAP_DEFAULT;
+  // Writes a heap dump segment, preceded by the string and class records it refers to.
+  int WriteSegment(HprofRecord* segment) LOCKS_EXCLUDED(lock_) {
+    MutexLock mu(Thread::Current(), lock_);
+    int err = output_->Append(&pending_records_);
+    int segment_err = segment->Flush();
+    return err != 0 ? err : segment_err;
   }
 
-  int MarkRootObject(const mirror::Object* obj, jobject jniObj);
-
   HprofClassObjectId LookupClassId(mirror::Class* c)
-      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
-    if (c == NULL) {
-      // c is the superclass of java.lang.Object or a primitive
-      return (HprofClassObjectId)0;
-    }
-
-    std::pair<ClassSetIterator, bool> result = classes_.insert(c);
-    const mirror::Class* present = *result.first;
-
-    // Make sure that we've assigned a string ID for this class' name
-    LookupClassNameId(c);
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) LOCKS_EXCLUDED(lock_);
 
-    CHECK_EQ(present, c);
-    return (HprofStringId) present;
-  }
-
-  HprofStringId LookupStringId(mirror::String* string) {
+  HprofStringId LookupStringId(mirror::String* string) LOCKS_EXCLUDED(lock_) {
     return LookupStringId(string->ToModifiedUtf8());
   }
 
-  HprofStringId LookupStringId(const char* string) {
+  HprofStringId LookupStringId(const char* string) LOCKS_EXCLUDED(lock_) {
     return LookupStringId(std::string(string));
   }
 
-  HprofStringId LookupStringId(const std::string& string) {
-    StringMapIterator it = strings_.find(string);
-    if (it != strings_.end()) {
-      return it->second;
-    }
-    HprofStringId id = next_string_id_++;
-    strings_.Put(string, id);
-    return id;
+  HprofStringId LookupStringId(const std::string& string) LOCKS_EXCLUDED(lock_) {
+    MutexLock mu(Thread::Current(), lock_);
+    return LookupStringIdLocked(string);
   }
 
-  HprofStringId LookupClassNameId(const mirror::Class* c)
-      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
-    return LookupStringId(PrettyDescriptor(c));
+ private:
+  bool OpenOutput();
+
+  HprofStringId LookupStringIdLocked(const std::string& string) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  HprofStringId LookupClassNameIdLocked(const mirror::Class* c)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) EXCLUSIVE_LOCKS_REQUIRED(lock_) {
+    return LookupStringIdLocked(PrettyDescriptor(c));
   }
 
   void WriteFixedHeader() {
@@ -619,11 +652,11 @@ class Hprof {
 
     // Write the file header.
     // U1: NUL-terminated magic string.
-    fwrite(magic, 1, sizeof(magic), header_fp_);
+    output_->Write(magic, sizeof(magic));
 
     // U4: size of identifiers.  We're using addresses as IDs, so make sure a pointer fits.
     U4_TO_BUF_BE(buf, 0, sizeof(void*));
-    fwrite(buf, 1, sizeof(uint32_t), header_fp_);
+    output_->Write(buf, sizeof(uint32_t));
 
     // The current time, in milliseconds since 0:00 GMT, 1/1/70.
     timeval now;
@@ -636,19 +669,21 @@ class Hprof {
 
     // U4: high word of the 64-bit time.
     U4_TO_BUF_BE(buf, 0, (uint32_t)(nowMs >> 32));
-    fwrite(buf, 1, sizeof(uint32_t), header_fp_);
+    output_->Write(buf, sizeof(uint32_t));
 
     // U4: low word of the 64-bit time.
     U4_TO_BUF_BE(buf, 0, (uint32_t)(nowMs & 0xffffffffULL));
-    fwrite(buf, 1, sizeof(uint32_t), header_fp_);  // xxx fix the time
+    output_->Write(buf, sizeof(uint32_t));  // xxx fix the time
   }
 
   void WriteStackTraces() {
     // Write a dummy stack trace record so the analysis tools don't freak out.
-    current_record_.StartNewRecord(header_fp_, HPROF_TAG_STACK_TRACE, HPROF_TIME);
-    current_record_.AddU4(HPROF_NULL_STACK_TRACE);
-    current_record_.AddU4(HPROF_NULL_THREAD);
-    current_record_.AddU4(0);    // no frames
+    HprofRecord rec;
+    rec.StartNewRecord(output_.get(), HPROF_TAG_STACK_TRACE, HPROF_TIME);
+    rec.AddU4(HPROF_NULL_STACK_TRACE);
+    rec.AddU4(HPROF_NULL_THREAD);
+    rec.AddU4(0);    // no frames
+    rec.Flush();
   }
 
   // If direct_to_ddms_ is set, "filename_" and "fd" will be ignored.
@@ -657,9 +692,164 @@ class Hprof {
   std::string filename_;
   int fd_;
   bool direct_to_ddms_;
+  bool compact_;
 
   uint64_t start_ns_;
 
+  UniquePtr<File> file_;
+  UniquePtr<HprofOutput> output_;
+
+  // Guards the output and the string and class tables, which are shared by the workers.
+  Mutex lock_;
+  // String and class records which have yet to be written, because the segment being written by
+  // the worker that created them may not be the one that refers to them.
+  HprofOutput pending_records_ GUARDED_BY(lock_);
+  HprofRecord pending_record_ GUARDED_BY(lock_);
+
+  ClassSet classes_ GUARDED_BY(lock_);
+  uint32_t next_class_serial_number_ GUARDED_BY(lock_);
+  size_t next_string_id_ GUARDED_BY(lock_);
+  StringMap strings_ GUARDED_BY(lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(Hprof);
+};
+
+// Writes the roots or a part of the heap as heap dump segments, one per thread.
+class HprofHeapDumper {
+ public:
+  explicit HprofHeapDumper(Hprof* hprof)
+      : hprof_(hprof),
+        compact_(hprof->IsCompact()),
+        gc_thread_serial_number_(0),
+        gc_scan_state_(0),
+        current_heap_(HPROF_HEAP_DEFAULT),
+        objects_in_segment_(0) {
+    current_record_.StartNewRecord(hprof_->GetOutput(), HPROF_TAG_HEAP_DUMP_SEGMENT, HPROF_TIME);
+  }
+
+  static void RootVisitor(const mirror::Object* obj, void* arg)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    CHECK(arg != NULL);
+    HprofHeapDumper* dumper = reinterpret_cast<HprofHeapDumper*>(arg);
+    dumper->VisitRoot(obj);
+  }
+
+  static void HeapBitmapCallback(mirror::Object* obj, void* arg)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    CHECK(obj != NULL);
+    CHECK(arg != NULL);
+    HprofHeapDumper* dumper = reinterpret_cast<HprofHeapDumper*>(arg);
+    dumper->DumpHeapObject(obj);
+  }
+
+  void VisitRoot(const mirror::Object* obj) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  int DumpHeapObject(mirror::Object* obj) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Writes the last segment.
+  int Finish() {
+    return objects_in_segment_ != 0 ? hprof_->WriteSegment(&current_record_) : 0;
+  }
+
+ private:
+  void StartNewHeapDumpSegment() {
+    // This flushes the old segment and starts a new one.
+    hprof_->WriteSegment(&current_record_);
+    current_record_.StartNewRecord(hprof_->GetOutput(), HPROF_TAG_HEAP_DUMP_SEGMENT, HPROF_TIME);
+    objects_in_segment_ = 0;
+
+    // Starting a new HEAP_DUMP resets the heap to default.
+    current_heap_ = HPROF_HEAP_DEFAULT;
+  }
+
+  int MarkRootObject(const mirror::Object* obj, jobject jniObj);
+
+  HprofClassObjectId LookupClassId(mirror::Class* c)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    if (c == NULL) {
+      // c is the superclass of java.lang.Object or a primitive
+      return (HprofClassObjectId)0;
+    }
+    // Only go to the shared class table the first time this thread sees the class.
+    if (known_classes_.insert(c).second) {
+      return hprof_->LookupClassId(c);
+    }
+    return (HprofClassObjectId) c;
+  }
+
+  HprofStringId LookupStringId(const char* string) {
+    return hprof_->LookupStringId(string);
+  }
+
+  // Returns a primitive array with the same class and elements that this thread dumped before, or
+  // NULL after remembering the array for the ones to come. Arrays are only compared with those of
+  // the same thread so that the original is always written first.
+  const mirror::Array* FindIdenticalArray(const mirror::Array* array, size_t component_size)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    size_t byte_count = array->GetLength() * component_size;
+    if (byte_count < kMinDuplicateArrayBytes) {
+      return NULL;
+    }
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(array->GetRawData(component_size));
+    uint32_t hash = 0;
+    for (size_t i = 0; i < byte_count; ++i) {
+      hash = hash * 31 + data[i];
+    }
+    typedef std::multimap<uint32_t, const mirror::Array*>::const_iterator It;
+    std::pair<It, It> range = arrays_by_hash_.equal_range(hash);
+    for (It it = range.first; it != range.second; ++it) {
+      const mirror::Array* other = it->second;
+      if (other->GetClass() == array->GetClass() && other->GetLength() == array->GetLength() &&
+          memcmp(other->GetRawData(component_size), data, byte_count) == 0) {
+        return other;
+      }
+    }
+    arrays_by_hash_.insert(std::make_pair(hash, array));
+    return NULL;
+  }
+
+  // Replaces the instance dump at the end of the current segment, whose field data starts at
+  // data_offset, with a sparse one if that is smaller. The field data is encoded as a sequence of
+  // U1 number of zero bytes, U1 number of literal bytes and the literal bytes.
+  void MakeInstanceDumpSparse(size_t record_offset, size_t data_offset) {
+    const unsigned char* data = current_record_.Body() + data_offset;
+    const size_t length = current_record_.Size() - data_offset;
+    std::vector<uint8_t> runs;
+    size_t i = 0;
+    while (i < length) {
+      size_t zeros = 0;
+      while (i < length && data[i] == 0 && zeros < 255) {
+        ++i;
+        ++zeros;
+      }
+      size_t literal_start = i;
+      while (i < length && data[i] != 0 && i - literal_start < 255) {
+        ++i;
+      }
+      runs.push_back(zeros);
+      runs.push_back(i - literal_start);
+      runs.insert(runs.end(), data + literal_start, data + i);
+    }
+    if (runs.size() >= length) {
+      return;
+    }
+    // The object ID, stack trace serial number and class ID stay the same.
+    std::vector<uint8_t> ids(current_record_.Body() + record_offset + 1,
+                             current_record_.Body() + data_offset - 4);
+    current_record_.Truncate(record_offset);
+    current_record_.AddU1(HPROF_INSTANCE_DUMP_SPARSE);
+    current_record_.AddU1List(&ids[0], ids.size());
+    current_record_.AddU4(length);
+    current_record_.AddU1List(&runs[0], runs.size());
+  }
+
+  // Smaller arrays take less space than a reference to an identical one.
+  static const size_t kMinDuplicateArrayBytes = 8;
+
+  Hprof* const hprof_;
+  const bool compact_;
+
+  // The current segment, only written to the output by Hprof::WriteSegment.
   HprofRecord current_record_;
 
   uint32_t gc_thread_serial_number_;
@@ -667,19 +857,12 @@ class Hprof {
   HprofHeapId current_heap_;  // Which heap we're currently dumping.
   size_t objects_in_segment_;
 
-  FILE* header_fp_;
-  char* header_data_ptr_;
-  size_t header_data_size_;
-
-  FILE* body_fp_;
-  char* body_data_ptr_;
-  size_t body_data_size_;
-
-  ClassSet classes_;
-  size_t next_string_id_;
-  StringMap strings_;
+  // The classes this thread has registered with the Hprof.
+  ClassSet known_classes_;
+  // The primitive arrays this thread dumped in full, by hash of their elements, when compact.
+  std::multimap<uint32_t, const mirror::Array*> arrays_by_hash_;
 
-  DISALLOW_COPY_AND_ASSIGN(Hprof);
+  DISALLOW_COPY_AND_ASSIGN(HprofHeapDumper);
 };
 
 #define OBJECTS_PER_SEGMENT     ((size_t)128)
@@ -744,7 +927,7 @@ static HprofBasicType PrimitiveToBasicTypeAndSize(Primitive::Type prim, size_t*
 // something when ctx->gc_scan_state_ is non-zero, which is usually
 // only true when marking the root set or unreachable
 // objects.  Used to add rootset references to obj.
-int Hprof::MarkRootObject(const mirror::Object* obj, jobject jniObj) {
+int HprofHeapDumper::MarkRootObject(const mirror::Object* obj, jobject jniObj) {
   HprofRecord* rec = &current_record_;
   HprofHeapTag heapTag = (HprofHeapTag)gc_scan_state_;
 
@@ -831,7 +1014,7 @@ static int StackTraceSerialNumber(const mirror::Object* /*obj*/) {
   return HPROF_NULL_STACK_TRACE;
 }
 
-int Hprof::DumpHeapObject(mirror::Object* obj) {
+int HprofHeapDumper::DumpHeapObject(mirror::Object* obj) {
   HprofRecord* rec = &current_record_;
   HprofHeapId desiredHeap = false ? HPROF_HEAP_ZYGOTE : HPROF_HEAP_APP;  // TODO: zygote objects?
 
@@ -972,26 +1155,36 @@ int Hprof::DumpHeapObject(mirror::Object* obj) {
         HprofBasicType t = PrimitiveToBasicTypeAndSize(c->GetComponentType()->GetPrimitiveType(), &size);
 
         // obj is a primitive array.
-        rec->AddU1(HPROF_PRIMITIVE_ARRAY_DUMP);
-
-        rec->AddId((HprofObjectId)obj);
-        rec->AddU4(StackTraceSerialNumber(obj));
-        rec->AddU4(length);
-        rec->AddU1(t);
+        const mirror::Array* original = compact_ ? FindIdenticalArray(aobj, size) : NULL;
+        if (original != NULL) {
+          // Refer to the identical array this thread dumped before.
+          rec->AddU1(HPROF_PRIMITIVE_ARRAY_DUPLICATE);
+          rec->AddId((HprofObjectId)obj);
+          rec->AddU4(StackTraceSerialNumber(obj));
+          rec->AddId((HprofObjectId)original);
+        } else {
+          rec->AddU1(HPROF_PRIMITIVE_ARRAY_DUMP);
+
+          rec->AddId((HprofObjectId)obj);
+          rec->AddU4(StackTraceSerialNumber(obj));
+          rec->AddU4(length);
+          rec->AddU1(t);
 
-        // Dump the raw, packed element values.
-        if (size == 1) {
-          rec->AddU1List((const uint8_t*)aobj->GetRawData(sizeof(uint8_t)), length);
-        } else if (size == 2) {
-          rec->AddU2List((const uint16_t*)aobj->GetRawData(sizeof(uint16_t)), length);
-        } else if (size == 4) {
-          rec->AddU4List((const uint32_t*)aobj->GetRawData(sizeof(uint32_t)), length);
-        } else if (size == 8) {
-          rec->AddU8List((const uint64_t*)aobj->GetRawData(sizeof(uint64_t)), length);
+          // Dump the raw, packed element values.
+          if (size == 1) {
+            rec->AddU1List((const uint8_t*)aobj->GetRawData(sizeof(uint8_t)), length);
+          } else if (size == 2) {
+            rec->AddU2List((const uint16_t*)aobj->GetRawData(sizeof(uint16_t)), length);
+          } else if (size == 4) {
+            rec->AddU4List((const uint32_t*)aobj->GetRawData(sizeof(uint32_t)), length);
+          } else if (size == 8) {
+            rec->AddU8List((const uint64_t*)aobj->GetRawData(sizeof(uint64_t)), length);
+          }
         }
       }
     } else {
       // obj is an instance object.
+      size_t record_offset = rec->Size();
       rec->AddU1(HPROF_INSTANCE_DUMP);
       rec->AddId((HprofObjectId)obj);
       rec->AddU4(StackTraceSerialNumber(obj));
@@ -1031,6 +1224,9 @@ int Hprof::DumpHeapObject(mirror::Object* obj) {
 
       // Patch the instance field length.
       rec->UpdateU4(size_patch_offset, rec->Size() - (size_patch_offset + 4));
+      if (compact_) {
+        MakeInstanceDumpSparse(record_offset, size_patch_offset + 4);
+      }
     }
   }
 
@@ -1038,7 +1234,7 @@ int Hprof::DumpHeapObject(mirror::Object* obj) {
   return 0;
 }
 
-void Hprof::VisitRoot(const mirror::Object* obj) {
+void HprofHeapDumper::VisitRoot(const mirror::Object* obj) {
   uint32_t threadId = 0;  // TODO
   /*RootType*/ size_t type = 0;  // TODO
 
@@ -1071,17 +1267,546 @@ void Hprof::VisitRoot(const mirror::Object* obj) {
   gc_thread_serial_number_ = 0;
 }
 
+HprofClassObjectId Hprof::LookupClassId(mirror::Class* c) {
+  MutexLock mu(Thread::Current(), lock_);
+  if (classes_.insert(c).second) {
+    // LOAD CLASS format:
+    // U4: class serial number (always > 0)
+    // ID: class object ID. We use the address of the class object structure as its ID.
+    // U4: stack trace serial number
+    // ID: class name string ID
+    HprofStringId name_id = LookupClassNameIdLocked(c);
+    pending_record_.StartNewRecord(&pending_records_, HPROF_TAG_LOAD_CLASS, HPROF_TIME);
+    pending_record_.AddU4(next_class_serial_number_++);
+    pending_record_.AddId((HprofClassObjectId) c);
+    pending_record_.AddU4(HPROF_NULL_STACK_TRACE);
+    pending_record_.AddId(name_id);
+    pending_record_.Flush();
+  }
+  return (HprofClassObjectId) c;
+}
+
+HprofStringId Hprof::LookupStringIdLocked(const std::string& string) {
+  StringMapIterator it = strings_.find(string);
+  if (it != strings_.end()) {
+    return it->second;
+  }
+  HprofStringId id = next_string_id_++;
+  strings_.Put(string, id);
+
+  // STRING format:
+  // ID:  ID for this string
+  // U1*: UTF8 characters for string (NOT NULL terminated)
+  //      (the record format encodes the length)
+  pending_record_.StartNewRecord(&pending_records_, HPROF_TAG_STRING, HPROF_TIME);
+  pending_record_.AddU4(id);
+  pending_record_.AddUtf8String(string.c_str());
+  pending_record_.Flush();
+  return id;
+}
+
+bool Hprof::OpenOutput() {
+  if (direct_to_ddms_) {
+    // DDMS takes the dump as a single chunk, so it is built in memory.
+    output_.reset(new HprofOutput(NULL, false));
+    return true;
+  }
+  // Where exactly are we writing to?
+  int out_fd;
+  if (fd_ >= 0) {
+    out_fd = dup(fd_);
+    if (out_fd < 0) {
+      ThrowRuntimeException("Couldn't dump heap; dup(%d) failed: %s", fd_, strerror(errno));
+      return false;
+    }
+  } else {
+    out_fd = open(filename_.c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0644);
+    if (out_fd < 0) {
+      ThrowRuntimeException("Couldn't dump heap; open(\"%s\") failed: %s", filename_.c_str(),
+                            strerror(errno));
+      return false;
+    }
+  }
+  file_.reset(new File(out_fd, filename_));
+  if (compact_ && !file_->WriteFully(kCompactMagic, sizeof(kCompactMagic))) {
+    ThrowRuntimeException("Couldn't dump heap; writing \"%s\" failed: %s", filename_.c_str(),
+                          strerror(errno));
+    return false;
+  }
+  output_.reset(new HprofOutput(file_.get(), compact_));
+  return true;
+}
+
+// Dumps the objects in one range of a continuous space live bitmap.
+class HprofDumpTask : public UnsplittableTask {
+ public:
+  HprofDumpTask(Hprof* hprof, gc::accounting::SpaceBitmap* bitmap, uintptr_t begin,
+                uintptr_t end)
+      : dumper_(hprof), bitmap_(bitmap), begin_(begin), end_(end) {
+  }
+
+  // The thread which started the dump holds the mutator lock and heap bitmap lock on our behalf.
+  virtual void Run(Thread* /* self */) NO_THREAD_SAFETY_ANALYSIS {
+    bitmap_->VisitMarkedRange(begin_, end_, *this);
+    dumper_.Finish();
+  }
+
+  void operator()(mirror::Object* obj) const NO_THREAD_SAFETY_ANALYSIS {
+    dumper_.DumpHeapObject(obj);
+  }
+
+ private:
+  // Mutable since bitmap visitors are const.
+  mutable HprofHeapDumper dumper_;
+  gc::accounting::SpaceBitmap* const bitmap_;
+  const uintptr_t begin_;
+  const uintptr_t end_;
+
+  DISALLOW_COPY_AND_ASSIGN(HprofDumpTask);
+};
+
+void Hprof::Dump() {
+  if (!OpenOutput()) {
+    return;
+  }
+  // Write the header. The string and class records are written as they are first needed, before
+  // the heap dump segment which refers to them.
+  WriteFixedHeader();
+  WriteStackTraces();
+
+  // Walk the roots and the heap.
+  Thread* self = Thread::Current();
+  gc::Heap* heap = Runtime::Current()->GetHeap();
+  HprofHeapDumper dumper(this);
+  Runtime::Current()->VisitRoots(HprofHeapDumper::RootVisitor, &dumper, false, false);
+  {
+    WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
+    heap->FlushAllocStack();
+  }
+  {
+    ReaderMutexLock mu(self, *Locks::heap_bitmap_lock_);
+    ThreadPool* thread_pool = heap->GetThreadPool();
+    if (thread_pool == NULL) {
+      heap->GetLiveBitmap()->Walk(HprofHeapDumper::HeapBitmapCallback, &dumper);
+    } else {
+      const size_t thread_count = heap->GetParallelGCThreadCount() + 1;
+      std::vector<HprofDumpTask*> tasks;
+      for (const auto& space : heap->GetContinuousSpaces()) {
+        gc::accounting::SpaceBitmap* bitmap = space->GetLiveBitmap();
+        std::vector<std::pair<uintptr_t, uintptr_t> > ranges;
+        bitmap->PartitionRange(bitmap->HeapBegin(), bitmap->HeapLimit(), thread_count * 2,
+                               256 * KB, &ranges);
+        for (const auto& range : ranges) {
+          HprofDumpTask* task = new HprofDumpTask(this, bitmap, range.first, range.second);
+          tasks.push_back(task);
+          thread_pool->AddTask(self, task);
+        }
+      }
+      thread_pool->SetMaxActiveWorkers(thread_count - 1);
+      thread_pool->StartWorkers(self);
+      thread_pool->Wait(self, true, true);
+      thread_pool->StopWorkers(self);
+      STLDeleteElements(&tasks);
+      // Large objects are few, dump them here.
+      for (const auto& space : heap->GetDiscontinuousSpaces()) {
+        space->GetLiveObjects()->Walk(HprofHeapDumper::HeapBitmapCallback, &dumper);
+      }
+    }
+  }
+  dumper.Finish();
+  {
+    MutexLock mu(self, lock_);
+    output_->Append(&pending_records_);
+    HprofRecord end_record;
+    end_record.StartNewRecord(output_.get(), HPROF_TAG_HEAP_DUMP_END, HPROF_TIME);
+    end_record.Flush();
+  }
+
+  bool okay = output_->Finish();
+  if (direct_to_ddms_) {
+    // Send the data off to DDMS.
+    std::vector<uint8_t>& data = output_->GetData();
+    iovec iov[1];
+    iov[0].iov_base = &data[0];
+    iov[0].iov_len = data.size();
+    Dbg::DdmSendChunkV(CHUNK_TYPE("HPDS"), iov, 1);
+  } else if (!okay) {
+    std::string msg(StringPrintf("Couldn't dump heap; writing \"%s\" failed: %s",
+                                 filename_.c_str(), strerror(errno)));
+    ThrowRuntimeException("%s", msg.c_str());
+    LOG(ERROR) << msg;
+  }
+
+  // Throw out a log message for the benefit of "runhat".
+  if (okay) {
+    uint64_t duration = NanoTime() - start_ns_;
+    LOG(INFO) << "hprof: heap dump completed (" << PrettySize(output_->Size() + 1023)
+        << ") in " << PrettyDuration(duration);
+  }
+}
+
 // If "direct_to_ddms" is true, the other arguments are ignored, and data is
 // sent directly to DDMS.
 // If "fd" is >= 0, the output will be written to that file descriptor.
 // Otherwise, "filename" is used to create an output file.
-void DumpHeap(const char* filename, int fd, bool direct_to_ddms) {
+void DumpHeap(const char* filename, int fd, bool direct_to_ddms, bool compact) {
   CHECK(filename != NULL);
 
+  Thread* self = Thread::Current();
+  gc::Heap* heap = Runtime::Current()->GetHeap();
+  // The dump uses the heap's thread pool, which the GC must not use at the same time.
+  heap->BlockGc(self);
   Runtime::Current()->GetThreadList()->SuspendAll();
-  Hprof hprof(filename, fd, direct_to_ddms);
-  hprof.Dump();
+  {
+    Hprof hprof(filename, fd, direct_to_ddms, compact);
+    hprof.Dump();
+  }
   Runtime::Current()->GetThreadList()->ResumeAll();
+  heap->UnblockGc(self);
+}
+
+// Reads a compact dump, inflated, and rewrites it as a standard HPROF dump.
+class CompactDumpExpander {
+ public:
+  CompactDumpExpander(const std::vector<uint8_t>& in, std::vector<uint8_t>* out,
+                      std::string* error_msg)
+      : in_(in), out_(out), error_msg_(error_msg), id_size_(0) {
+  }
+
+  bool Expand() {
+    // The header is the NUL-terminated magic string, the U4 identifier size and the U8 time.
+    if (in_.empty()) {
+      *error_msg_ = "empty dump";
+      return false;
+    }
+    const uint8_t* end = &in_[0] + in_.size();
+    const uint8_t* magic_end =
+        reinterpret_cast<const uint8_t*>(memchr(&in_[0], 0, in_.size()));
+    if (magic_end == NULL || end - (magic_end + 1) < 12) {
+      *error_msg_ = "truncated header";
+      return false;
+    }
+    const uint8_t* records = magic_end + 1 + 12;
+    id_size_ = ReadU4(magic_end + 1);
+    if (id_size_ != 4 && id_size_ != 8) {
+      *error_msg_ = StringPrintf("unsupported identifier size %zd", id_size_);
+      return false;
+    }
+    // The first pass finds the arrays which are referred to by duplicates, the second writes the
+    // dump, remembering those arrays.
+    if (!ExpandRecords(records, end, false)) {
+      return false;
+    }
+    out_->insert(out_->end(), &in_[0], records);
+    return ExpandRecords(records, end, true);
+  }
+
+ private:
+  bool ExpandRecords(const uint8_t* p, const uint8_t* end, bool write) {
+    while (p != end) {
+      if (end - p < 9) {
+        *error_msg_ = "truncated record";
+        return false;
+      }
+      uint8_t tag = p[0];
+      size_t length = ReadU4(p + 5);
+      const uint8_t* body = p + 9;
+      if (static_cast<size_t>(end - body) < length) {
+        *error_msg_ = "truncated record";
+        return false;
+      }
+      if (tag == HPROF_TAG_HEAP_DUMP || tag == HPROF_TAG_HEAP_DUMP_SEGMENT) {
+        std::vector<uint8_t> segment;
+        if (!ExpandSegment(body, body + length, write ? &segment : NULL)) {
+          return false;
+        }
+        if (write) {
+          uint8_t header[9];
+          memcpy(header, p, 5);
+          U4_TO_BUF_BE(header, 5, segment.size());
+          out_->insert(out_->end(), header, header + sizeof(header));
+          out_->insert(out_->end(), segment.begin(), segment.end());
+        }
+      } else if (write) {
+        out_->insert(out_->end(), p, body + length);
+      }
+      p = body + length;
+    }
+    return true;
+  }
+
+  // Expands the sub-records of a heap dump segment into out, or only looks for duplicate arrays if
+  // out is NULL.
+  bool ExpandSegment(const uint8_t* p, const uint8_t* end, std::vector<uint8_t>* out) {
+    while (p != end) {
+      const uint8_t* start = p;
+      uint8_t tag = *p++;
+      size_t length;
+      switch (tag) {
+      case HPROF_ROOT_UNKNOWN:
+      case HPROF_ROOT_STICKY_CLASS:
+      case HPROF_ROOT_MONITOR_USED:
+      case HPROF_ROOT_INTERNED_STRING:
+      case HPROF_ROOT_DEBUGGER:
+      case HPROF_ROOT_VM_INTERNAL:
+        length = id_size_;
+        break;
+      case HPROF_ROOT_JNI_GLOBAL:
+        length = 2 * id_size_;
+        break;
+      case HPROF_ROOT_JNI_LOCAL:
+      case HPROF_ROOT_JNI_MONITOR:
+      case HPROF_ROOT_JAVA_FRAME:
+      case HPROF_ROOT_THREAD_OBJECT:
+        length = id_size_ + 8;
+        break;
+      case HPROF_ROOT_NATIVE_STACK:
+      case HPROF_ROOT_THREAD_BLOCK:
+        length = id_size_ + 4;
+        break;
+      case HPROF_HEAP_DUMP_INFO:
+        length = 4 + id_size_;
+        break;
+      case HPROF_CLASS_DUMP:
+        if (!ClassDumpLength(p, end, &length)) {
+          return false;
+        }
+        break;
+      case HPROF_INSTANCE_DUMP:
+        if (!Check(p, end, 2 * id_size_ + 8)) {
+          return false;
+        }
+        length = 2 * id_size_ + 8 + ReadU4(p + 2 * id_size_ + 4);
+        break;
+      case HPROF_OBJECT_ARRAY_DUMP:
+        if (!Check(p, end, id_size_ + 8)) {
+          return false;
+        }
+        length = 2 * id_size_ + 8 + ReadU4(p + id_size_ + 4) * id_size_;
+        break;
+      case HPROF_PRIMITIVE_ARRAY_DUMP: {
+        if (!Check(p, end, id_size_ + 9)) {
+          return false;
+        }
+        size_t element_size = BasicTypeSize(p[id_size_ + 8]);
+        if (element_size == 0) {
+          *error_msg_ = StringPrintf("bad array element type %d", p[id_size_ + 8]);
+          return false;
+        }
+        length = id_size_ + 9 + ReadU4(p + id_size_ + 4) * element_size;
+        if (out != NULL && Check(p, end, length) && duplicated_.count(ReadId(p)) != 0) {
+          originals_.Put(ReadId(p), p + id_size_ + 4);
+        }
+        break;
+      }
+      case HPROF_PRIMITIVE_ARRAY_DUPLICATE: {
+        if (!Check(p, end, 2 * id_size_ + 4)) {
+          return false;
+        }
+        uint64_t original_id = ReadId(p + id_size_ + 4);
+        if (out == NULL) {
+          duplicated_.insert(original_id);
+        } else {
+          // The original's length, element type and elements follow the new ID and serial number.
+          SafeMap<uint64_t, const uint8_t*>::const_iterator it = originals_.find(original_id);
+          if (it == originals_.end()) {
+            *error_msg_ = "duplicate of an unknown array";
+            return false;
+          }
+          const uint8_t* original = it->second;
+          size_t element_size = BasicTypeSize(original[4]);
+          size_t data_length = 5 + ReadU4(original) * element_size;
+          out->push_back(HPROF_PRIMITIVE_ARRAY_DUMP);
+          out->insert(out->end(), p, p + id_size_ + 4);
+          out->insert(out->end(), original, original + data_length);
+        }
+        p += 2 * id_size_ + 4;
+        continue;
+      }
+      case HPROF_INSTANCE_DUMP_SPARSE: {
+        if (!Check(p, end, 2 * id_size_ + 8)) {
+          return false;
+        }
+        const uint8_t* ids_end = p + 2 * id_size_ + 4;
+        size_t data_length = ReadU4(ids_end);
+        std::vector<uint8_t> data;
+        const uint8_t* runs = ids_end + 4;
+        while (data.size() < data_length) {
+          if (end - runs < 2 || static_cast<size_t>(end - runs - 2) < runs[1]) {
+            *error_msg_ = "truncated sparse instance dump";
+            return false;
+          }
+          data.insert(data.end(), static_cast<size_t>(runs[0]), static_cast<uint8_t>(0));
+          data.insert(data.end(), runs + 2, runs + 2 + runs[1]);
+          runs += 2 + runs[1];
+        }
+        if (data.size() != data_length) {
+          *error_msg_ = "bad sparse instance dump";
+          return false;
+        }
+        if (out != NULL) {
+          uint8_t length_buf[4];
+          U4_TO_BUF_BE(length_buf, 0, data_length);
+          out->push_back(HPROF_INSTANCE_DUMP);
+          out->insert(out->end(), p, ids_end);
+          out->insert(out->end(), length_buf, length_buf + sizeof(length_buf));
+          out->insert(out->end(), data.begin(), data.end());
+        }
+        p = runs;
+        continue;
+      }
+      default:
+        *error_msg_ = StringPrintf("unknown heap dump record 0x%x", tag);
+        return false;
+      }
+      if (!Check(p, end, length)) {
+        return false;
+      }
+      p += length;
+      if (out != NULL) {
+        out->insert(out->end(), start, p);
+      }
+    }
+    return true;
+  }
+
+  bool ClassDumpLength(const uint8_t* begin, const uint8_t* end, size_t* length) {
+    // Class ID, U4 stack trace serial number, six IDs and U4 instance size.
+    const uint8_t* p = begin + 7 * id_size_ + 8;
+    // The constant pool entries: U2 index, U1 type and the value.
+    if (!Check(p, end, 2)) {
+      return false;
+    }
+    size_t count = ReadU2(p);
+    p += 2;
+    for (size_t i = 0; i < count; ++i) {
+      if (!Check(p, end, 3)) {
+        return false;
+      }
+      p += 3 + BasicTypeSize(p[2]);
+    }
+    // The static fields: name ID, U1 type and the value.
+    if (!Check(p, end, 2)) {
+      return false;
+    }
+    count = ReadU2(p);
+    p += 2;
+    for (size_t i = 0; i < count; ++i) {
+      if (!Check(p, end, id_size_ + 1)) {
+        return false;
+      }
+      p += id_size_ + 1 + BasicTypeSize(p[id_size_]);
+    }
+    // The instance fields: name ID and U1 type.
+    if (!Check(p, end, 2)) {
+      return false;
+    }
+    count = ReadU2(p);
+    p += 2 + count * (id_size_ + 1);
+    if (p > end) {
+      *error_msg_ = "truncated class dump";
+      return false;
+    }
+    *length = p - begin;
+    return true;
+  }
+
+  size_t BasicTypeSize(uint8_t type) const {
+    switch (type) {
+      case hprof_basic_object: return id_size_;
+      case hprof_basic_boolean: return 1;
+      case hprof_basic_char: return 2;
+      case hprof_basic_float: return 4;
+      case hprof_basic_double: return 8;
+      case hprof_basic_byte: return 1;
+      case hprof_basic_short: return 2;
+      case hprof_basic_int: return 4;
+      case hprof_basic_long: return 8;
+      default: return 0;
+    }
+  }
+
+  bool Check(const uint8_t* p, const uint8_t* end, size_t length) {
+    if (p > end || static_cast<size_t>(end - p) < length) {
+      *error_msg_ = "truncated heap dump record";
+      return false;
+    }
+    return true;
+  }
+
+  static size_t ReadU2(const uint8_t* p) {
+    return (p[0] << 8) | p[1];
+  }
+
+  static size_t ReadU4(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+  }
+
+  uint64_t ReadId(const uint8_t* p) const {
+    return id_size_ == 4 ? ReadU4(p) : (static_cast<uint64_t>(ReadU4(p)) << 32) | ReadU4(p + 4);
+  }
+
+  const std::vector<uint8_t>& in_;
+  std::vector<uint8_t>* const out_;
+  std::string* const error_msg_;
+  size_t id_size_;
+  // The IDs of the arrays which have duplicates.
+  std::set<uint64_t> duplicated_;
+  // The length, element type and elements of those arrays.
+  SafeMap<uint64_t, const uint8_t*> originals_;
+
+  DISALLOW_COPY_AND_ASSIGN(CompactDumpExpander);
+};
+
+bool ExpandCompactDump(File* in, File* out, std::string* error_msg) {
+  int64_t length = in->GetLength();
+  if (length < 0) {
+    *error_msg = StringPrintf("Failed to get the length of %s", in->GetPath().c_str());
+    return false;
+  }
+  std::vector<uint8_t> compact(length);
+  if (length < static_cast<int64_t>(sizeof(kCompactMagic)) ||
+      !in->ReadFully(&compact[0], length) ||
+      memcmp(&compact[0], kCompactMagic, sizeof(kCompactMagic)) != 0) {
+    *error_msg = StringPrintf("%s is not a compact heap dump", in->GetPath().c_str());
+    return false;
+  }
+
+  z_stream zstream;
+  memset(&zstream, 0, sizeof(zstream));
+  if (inflateInit(&zstream) != Z_OK) {
+    *error_msg = "inflateInit failed";
+    return false;
+  }
+  zstream.next_in = &compact[sizeof(kCompactMagic)];
+  zstream.avail_in = length - sizeof(kCompactMagic);
+  std::vector<uint8_t> dump;
+  uint8_t buffer[HprofOutput::kBufferSize];
+  int zerr;
+  do {
+    zstream.next_out = buffer;
+    zstream.avail_out = sizeof(buffer);
+    zerr = inflate(&zstream, Z_NO_FLUSH);
+    dump.insert(dump.end(), buffer, buffer + sizeof(buffer) - zstream.avail_out);
+  } while (zerr == Z_OK);
+  inflateEnd(&zstream);
+  if (zerr != Z_STREAM_END) {
+    *error_msg = StringPrintf("Failed to inflate %s: %d", in->GetPath().c_str(), zerr);
+    return false;
+  }
+
+  std::vector<uint8_t> hprof;
+  CompactDumpExpander expander(dump, &hprof, error_msg);
+  if (!expander.Expand()) {
+    *error_msg = StringPrintf("Bad compact heap dump %s: %s", in->GetPath().c_str(),
+                              error_msg->c_str());
+    return false;
+  }
+  if (!out->WriteFully(&hprof[0], hprof.size())) {
+    *error_msg = StringPrintf("Failed to write %s: %s", out->GetPath().c_str(), strerror(errno));
+    return false;
+  }
+  return true;
 }
 
 }  // namespace hprof
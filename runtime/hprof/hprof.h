@@ -17,11 +17,24 @@
 #ifndef ART_RUNTIME_HPROF_HPROF_H_
 #define ART_RUNTIME_HPROF_HPROF_H_
 
+#include <string>
+
+#include "os.h"
+
 namespace art {
 
 namespace hprof {
 
-void DumpHeap(const char* filename, int fd, bool direct_to_ddms);
+// If "compact" is true the dump is written in the compact format, which ExpandCompactDump turns
+// back into a standard HPROF dump. Compact dumps can't be sent to DDMS.
+void DumpHeap(const char* filename, int fd, bool direct_to_ddms, bool compact);
+
+// Converts a compact heap dump to a standard HPROF dump. A compact dump is a magic string followed
+// by a zlib stream of an HPROF dump which, within heap dump segments, may use two more record
+// types: primitive arrays identical to an earlier one refer to it instead of repeating its
+// elements, and instances whose field data is mostly zero encode it as runs of zero bytes and of
+// literal bytes.
+bool ExpandCompactDump(File* in, File* out, std::string* error_msg);
 
 }  // namespace hprof
 
@@ -88,6 +88,46 @@ class PACKED(4) ImageHeader {
     return RoundUp(image_size_, kPageSize);
   }
 
+  // The relocation table follows the bitmap. It is the offsets into the image of the words that
+  // hold addresses in the image or its oat file, then the offsets from the oat data begin of the
+  // words of the oat file that hold such addresses, each sorted.
+  size_t GetRelocationsOffset() const {
+    return relocations_offset_;
+  }
+
+  size_t GetNumImageRelocations() const {
+    return num_image_relocations_;
+  }
+
+  size_t GetNumOatRelocations() const {
+    return num_oat_relocations_;
+  }
+
+  size_t GetRelocationsSize() const {
+    return (num_image_relocations_ + num_oat_relocations_) * sizeof(uint32_t);
+  }
+
+  void SetRelocations(uint32_t relocations_offset, uint32_t num_image_relocations,
+                      uint32_t num_oat_relocations) {
+    relocations_offset_ = relocations_offset;
+    num_image_relocations_ = num_image_relocations;
+    num_oat_relocations_ = num_oat_relocations;
+  }
+
+  // The offset of the end of the objects used at startup, which are laid out first, or 0 if the
+  // image was written without a startup profile.
+  size_t GetHotObjectsEnd() const {
+    return hot_objects_end_;
+  }
+
+  void SetHotObjectsEnd(uint32_t hot_objects_end) {
+    hot_objects_end_ = hot_objects_end;
+  }
+
+  // Moves the addresses in the header by delta, for an image and oat file mapped delta bytes from
+  // where they were laid out.
+  void Relocate(int32_t delta);
+
   enum ImageRoot {
     kResolutionMethod,
     kCalleeSaveMethod,
@@ -96,6 +136,9 @@ class PACKED(4) ImageHeader {
     kOatLocation,
     kDexCaches,
     kClassRoots,
+    kClassTable,  // Class[] of the classes in the class table.
+    kClassTableHashes,  // int[] of their descriptor hashes.
+    kInternTable,  // String[] hash set of the interned strings, see InternTable.
     kImageRootsMax,
   };
 
@@ -142,6 +185,14 @@ class PACKED(4) ImageHeader {
   // Absolute address of an Object[] of objects needed to reinitialize from an image.
   uint32_t image_roots_;
 
+  // File offset and lengths of the relocation table.
+  uint32_t relocations_offset_;
+  uint32_t num_image_relocations_;
+  uint32_t num_oat_relocations_;
+
+  // Image offset of the end of the startup objects.
+  uint32_t hot_objects_end_;
+
   friend class ImageWriter;
   friend class ImageDumper;  // For GetImageRoots()
 };
@@ -35,22 +35,30 @@ static void AbortMaybe() {
 }
 
 IndirectReferenceTable::IndirectReferenceTable(size_t initialCount,
-                                               size_t maxCount, IndirectRefKind desiredKind) {
+                                               size_t maxCount, IndirectRefKind desiredKind,
+                                               size_t shard) {
   CHECK_GT(initialCount, 0U);
   CHECK_LE(initialCount, maxCount);
   CHECK_NE(desiredKind, kSirtOrInvalid);
+  CHECK_LT(shard, kIRTMaxShards);
 
   table_ = reinterpret_cast<const mirror::Object**>(malloc(initialCount * sizeof(const mirror::Object*)));
   CHECK(table_ != NULL);
   memset(table_, 0xd1, initialCount * sizeof(const mirror::Object*));
 
-  slot_data_ = reinterpret_cast<IndirectRefSlot*>(calloc(initialCount, sizeof(IndirectRefSlot)));
-  CHECK(slot_data_ != NULL);
+  // Local references are created and dropped on every JNI call, so they only pay for serial
+  // numbers once CheckJNI asks for them.
+  slot_data_ = NULL;
+  if (desiredKind != kLocal) {
+    slot_data_ = reinterpret_cast<IndirectRefSlot*>(calloc(initialCount, sizeof(IndirectRefSlot)));
+    CHECK(slot_data_ != NULL);
+  }
 
   segment_state_.all = IRT_FIRST_SEGMENT;
   alloc_entries_ = initialCount;
   max_entries_ = maxCount;
   kind_ = desiredKind;
+  shard_ = shard;
 }
 
 IndirectReferenceTable::~IndirectReferenceTable() {
@@ -61,6 +69,15 @@ IndirectReferenceTable::~IndirectReferenceTable() {
   alloc_entries_ = max_entries_ = -1;
 }
 
+void IndirectReferenceTable::EnableSerialChecks() {
+  if (slot_data_ != NULL) {
+    return;
+  }
+  // Outstanding references were handed out with serial number 0, which is what calloc gives them.
+  slot_data_ = reinterpret_cast<IndirectRefSlot*>(calloc(alloc_entries_, sizeof(IndirectRefSlot)));
+  CHECK(slot_data_ != NULL);
+}
+
 // Make sure that the entry at "idx" is correctly paired with "iref".
 bool IndirectReferenceTable::CheckEntry(const char* what, IndirectRef iref, int idx) const {
   const mirror::Object* obj = table_[idx];
@@ -87,7 +104,13 @@ IndirectRef IndirectReferenceTable::Add(uint32_t cookie, const mirror::Object* o
   DCHECK_LE(alloc_entries_, max_entries_);
   DCHECK_GE(segment_state_.parts.numHoles, prevState.parts.numHoles);
 
-  if (topIndex == alloc_entries_) {
+  // Local references are bump allocated: their holes are reclaimed when the segment is popped or
+  // the entries above them are removed, and only filled here rather than growing the table.
+  // Other tables fill their holes first.
+  int numHoles = segment_state_.parts.numHoles - prevState.parts.numHoles;
+  bool fillHole = numHoles > 0 && (kind_ != kLocal || topIndex == alloc_entries_);
+
+  if (topIndex == alloc_entries_ && !fillHole) {
     // reached end of allocated space; did we hit buffer max?
     if (topIndex == max_entries_) {
       LOG(FATAL) << "JNI ERROR (app bug): " << kind_ << " table overflow "
@@ -102,9 +125,12 @@ IndirectRef IndirectReferenceTable::Add(uint32_t cookie, const mirror::Object* o
     DCHECK_GT(newSize, alloc_entries_);
 
     table_ = reinterpret_cast<const mirror::Object**>(realloc(table_, newSize * sizeof(const mirror::Object*)));
-    slot_data_ = reinterpret_cast<IndirectRefSlot*>(realloc(slot_data_,
-                                                            newSize * sizeof(IndirectRefSlot)));
-    if (table_ == NULL || slot_data_ == NULL) {
+    bool had_slot_data = slot_data_ != NULL;
+    if (had_slot_data) {
+      slot_data_ = reinterpret_cast<IndirectRefSlot*>(realloc(slot_data_,
+                                                              newSize * sizeof(IndirectRefSlot)));
+    }
+    if (table_ == NULL || (had_slot_data && slot_data_ == NULL)) {
       LOG(FATAL) << "JNI ERROR (app bug): unable to expand "
                  << kind_ << " table (from "
                  << alloc_entries_ << " to " << newSize
@@ -113,17 +139,18 @@ IndirectRef IndirectReferenceTable::Add(uint32_t cookie, const mirror::Object* o
     }
 
     // Clear the newly-allocated slot_data_ elements.
-    memset(slot_data_ + alloc_entries_, 0, (newSize - alloc_entries_) * sizeof(IndirectRefSlot));
+    if (had_slot_data) {
+      memset(slot_data_ + alloc_entries_, 0, (newSize - alloc_entries_) * sizeof(IndirectRefSlot));
+    }
 
     alloc_entries_ = newSize;
   }
 
   // We know there's enough room in the table.  Now we just need to find
-  // the right spot.  If there's a hole, find it and fill it; otherwise,
+  // the right spot.  If there's a hole to fill, find it and fill it; otherwise,
   // add to the end of the list.
   IndirectRef result;
-  int numHoles = segment_state_.parts.numHoles - prevState.parts.numHoles;
-  if (numHoles > 0) {
+  if (fillHole) {
     DCHECK_GT(topIndex, 1U);
     // Find the first hole; likely to be near the end of the list.
     const mirror::Object** pScan = &table_[topIndex - 1];
@@ -123,6 +123,16 @@ static inline IndirectRefKind GetIndirectRefKind(IndirectRef iref) {
   return static_cast<IndirectRefKind>(reinterpret_cast<uintptr_t>(iref) & 0x03);
 }
 
+/*
+ * Tables of the same kind may be split into shards, up to kIRTMaxShards, whose
+ * number is kept in bits 18 and 19 of the references they hand out.
+ */
+static const size_t kIRTMaxShards = 4;
+
+static inline size_t GetIndirectRefShard(IndirectRef iref) {
+  return (reinterpret_cast<uintptr_t>(iref) >> 18) & (kIRTMaxShards - 1);
+}
+
 /*
  * Extended debugging structure.  We keep a parallel array of these, one
  * per slot in the table.
@@ -248,7 +258,8 @@ bool inline operator!=(const IrtIterator& lhs, const IrtIterator& rhs) {
 
 class IndirectReferenceTable {
  public:
-  IndirectReferenceTable(size_t initialCount, size_t maxCount, IndirectRefKind kind);
+  IndirectReferenceTable(size_t initialCount, size_t maxCount, IndirectRefKind kind,
+                         size_t shard = 0);
 
   ~IndirectReferenceTable();
 
@@ -289,6 +300,14 @@ class IndirectReferenceTable {
 
   void AssertEmpty();
 
+  /*
+   * Start tracking serial numbers so that stale references to reused slots
+   * are detected. Tables of local references don't until CheckJNI is
+   * enabled, others always do. There's no going back as the outstanding
+   * references carry their serial number.
+   */
+  void EnableSerialChecks();
+
   void Dump(std::ostream& os) const SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   /*
@@ -336,8 +355,8 @@ class IndirectReferenceTable {
    */
   IndirectRef ToIndirectRef(const mirror::Object* /*o*/, uint32_t tableIndex) const {
     DCHECK_LT(tableIndex, 65536U);
-    uint32_t serialChunk = slot_data_[tableIndex].serial;
-    uint32_t uref = serialChunk << 20 | (tableIndex << 2) | kind_;
+    uint32_t serialChunk = (slot_data_ != NULL) ? slot_data_[tableIndex].serial : 0;
+    uint32_t uref = serialChunk << 20 | shard_ << 18 | (tableIndex << 2) | kind_;
     return (IndirectRef) uref;
   }
 
@@ -366,7 +385,9 @@ class IndirectReferenceTable {
   const mirror::Object** table_;
   /* bit mask, ORed into all irefs */
   IndirectRefKind kind_;
-  /* extended debugging info */
+  /* shard number, shifted into all irefs */
+  uint32_t shard_;
+  /* extended debugging info, NULL for locals without CheckJNI */
   IndirectRefSlot* slot_data_;
   /* #of entries we have space for */
   size_t alloc_entries_;
@@ -249,4 +249,57 @@ TEST_F(IndirectReferenceTableTest, BasicTest) {
   CheckDump(&irt, 0, 0);
 }
 
+TEST_F(IndirectReferenceTableTest, LocalHoles) {
+  ScopedObjectAccess soa(Thread::Current());
+  static const size_t kTableInitial = 4;
+  static const size_t kTableMax = 8;
+  IndirectReferenceTable irt(kTableInitial, kTableMax, kLocal);
+
+  mirror::Class* c = class_linker_->FindSystemClass("Ljava/lang/Object;");
+  ASSERT_TRUE(c != NULL);
+  mirror::Object* obj0 = c->AllocObject(soa.Self());
+  ASSERT_TRUE(obj0 != NULL);
+  mirror::Object* obj1 = c->AllocObject(soa.Self());
+  ASSERT_TRUE(obj1 != NULL);
+
+  const uint32_t cookie = IRT_FIRST_SEGMENT;
+
+  IndirectRef iref0 = irt.Add(cookie, obj0);
+  IndirectRef iref1 = irt.Add(cookie, obj0);
+  IndirectRef iref2 = irt.Add(cookie, obj0);
+  ASSERT_TRUE(irt.Remove(cookie, iref1));
+
+  // Local references are appended while there is room, leaving the hole.
+  IndirectRef iref3 = irt.Add(cookie, obj1);
+  EXPECT_EQ(4U, irt.Capacity());
+  EXPECT_EQ(obj1, irt.Get(iref3));
+
+  // The hole is filled rather than growing the table.
+  IndirectRef iref4 = irt.Add(cookie, obj1);
+  EXPECT_EQ(4U, irt.Capacity());
+  EXPECT_EQ(obj1, irt.Get(iref4));
+
+  ASSERT_TRUE(irt.Remove(cookie, iref0));
+  ASSERT_TRUE(irt.Remove(cookie, iref2));
+  ASSERT_TRUE(irt.Remove(cookie, iref3));
+  ASSERT_TRUE(irt.Remove(cookie, iref4));
+  ASSERT_EQ(0U, irt.Capacity());
+}
+
+TEST_F(IndirectReferenceTableTest, Shards) {
+  ScopedObjectAccess soa(Thread::Current());
+  IndirectReferenceTable irt(4, 8, kGlobal, 2);
+
+  mirror::Class* c = class_linker_->FindSystemClass("Ljava/lang/Object;");
+  ASSERT_TRUE(c != NULL);
+  mirror::Object* obj0 = c->AllocObject(soa.Self());
+  ASSERT_TRUE(obj0 != NULL);
+
+  IndirectRef iref0 = irt.Add(IRT_FIRST_SEGMENT, obj0);
+  EXPECT_EQ(kGlobal, GetIndirectRefKind(iref0));
+  EXPECT_EQ(2U, GetIndirectRefShard(iref0));
+  EXPECT_EQ(obj0, irt.Get(iref0));
+  ASSERT_TRUE(irt.Remove(IRT_FIRST_SEGMENT, iref0));
+}
+
 }  // namespace art
@@ -48,17 +48,17 @@ static bool InstallStubsClassVisitor(mirror::Class* klass, void* arg)
 }
 
 bool Instrumentation::InstallStubsForClass(mirror::Class* klass) {
-  bool uninstall = !entry_exit_stubs_installed_ && !interpreter_stubs_installed_;
-  ClassLinker* class_linker = NULL;
-  if (uninstall) {
-    class_linker = Runtime::Current()->GetClassLinker();
-  }
+  // Classes outside the method filter keep their code unless everything has to be interpreted.
+  bool uninstall = !interpreter_stubs_installed_ &&
+      (!entry_exit_stubs_installed_ || !IsClassInstrumented(klass));
+  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
   bool is_initialized = klass->IsInitialized();
   for (size_t i = 0; i < klass->NumDirectMethods(); i++) {
-    mirror::ArtMethod* method = klass->GetDirectMethod(i);
-    if (!method->IsAbstract()) {
+    // Threads are suspended so lazy methods can't be loaded, they get their stubs when they are.
+    mirror::ArtMethod* method = klass->GetLoadedDirectMethod(i);
+    if (method != NULL && !method->IsAbstract()) {
       const void* new_code;
-      if (uninstall) {
+      if (uninstall || IsHookedMethod(method)) {
         if (forced_interpret_only_ && !method->IsNative() && !method->IsProxyMethod()) {
           new_code = GetCompiledCodeToInterpreterBridge();
         } else if (is_initialized || !method->IsStatic() || method->IsConstructor()) {
@@ -73,6 +73,9 @@ bool Instrumentation::InstallStubsForClass(mirror::Class* klass) {
           new_code = GetCompiledCodeToInterpreterBridge();
         }
       }
+      if (UNLIKELY(IsDeoptimized(method))) {
+        new_code = GetCompiledCodeToInterpreterBridge();
+      }
       method->SetEntryPointFromCompiledCode(new_code);
     }
   }
@@ -80,7 +83,7 @@ bool Instrumentation::InstallStubsForClass(mirror::Class* klass) {
     mirror::ArtMethod* method = klass->GetVirtualMethod(i);
     if (!method->IsAbstract()) {
       const void* new_code;
-      if (uninstall) {
+      if (uninstall || IsHookedMethod(method)) {
         if (forced_interpret_only_ && !method->IsNative() && !method->IsProxyMethod()) {
           new_code = GetCompiledCodeToInterpreterBridge();
         } else {
@@ -93,20 +96,26 @@ bool Instrumentation::InstallStubsForClass(mirror::Class* klass) {
           new_code = GetCompiledCodeToInterpreterBridge();
         }
       }
+      if (UNLIKELY(IsDeoptimized(method))) {
+        new_code = GetCompiledCodeToInterpreterBridge();
+      }
       method->SetEntryPointFromCompiledCode(new_code);
     }
   }
   return true;
 }
 
-// Places the instrumentation exit pc as the return PC for every quick frame. This also allows
-// deoptimization of quick frames to interpreter frames.
+// Places the instrumentation exit pc as the return PC for every quick frame, except those of
+// methods reporting their exits through the method hooks. This also allows deoptimization of
+// quick frames to interpreter frames.
 static void InstrumentationInstallStack(Thread* thread, void* arg)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
   struct InstallStackVisitor : public StackVisitor {
-    InstallStackVisitor(Thread* thread, Context* context, uintptr_t instrumentation_exit_pc)
+    InstallStackVisitor(Thread* thread, Context* context, uintptr_t instrumentation_exit_pc,
+                        Instrumentation* instrumentation)
         : StackVisitor(thread, context),  instrumentation_stack_(thread->GetInstrumentationStack()),
-          instrumentation_exit_pc_(instrumentation_exit_pc), last_return_pc_(0) {}
+          instrumentation_exit_pc_(instrumentation_exit_pc), instrumentation_(instrumentation),
+          last_return_pc_(0) {}
 
     virtual bool VisitFrame() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
       mirror::ArtMethod* m = GetMethod();
@@ -131,6 +140,24 @@ static void InstrumentationInstallStack(Thread* thread, void* arg)
         last_return_pc_ = GetReturnPc();
         return true;  // Ignore unresolved methods since they will be instrumented after resolution.
       }
+      if (!instrumentation_->IsMethodInstrumented(m)) {
+        if (kVerboseInstrumentation) {
+          LOG(INFO) << "  Skipping filtered method. Frame " << GetFrameId();
+        }
+        last_return_pc_ = GetReturnPc();
+        return true;  // Ignore methods outside the method filter, they have no stubs.
+      }
+      if (instrumentation_->IsHookedMethod(m)) {
+        if (kVerboseInstrumentation) {
+          LOG(INFO) << "  Skipping method with hooks. Frame " << GetFrameId();
+        }
+        // The exit hook reports the exit, only the entry is reported here.
+        entered_frames_.push_back(InstrumentationStackFrame(GetThisObject(), m, 0, GetFrameId(),
+                                                            false));
+        dex_pcs_.push_back(m->ToDexPc(last_return_pc_));
+        last_return_pc_ = GetReturnPc();
+        return true;
+      }
       if (kVerboseInstrumentation) {
         LOG(INFO) << "  Installing exit stub in " << DescribeLocation();
       }
@@ -143,14 +170,18 @@ static void InstrumentationInstallStack(Thread* thread, void* arg)
         LOG(INFO) << "Pushing frame " << instrumentation_frame.Dump();
       }
       instrumentation_stack_->push_back(instrumentation_frame);
+      entered_frames_.push_back(instrumentation_frame);
       dex_pcs_.push_back(m->ToDexPc(last_return_pc_));
       SetReturnPc(instrumentation_exit_pc_);
       last_return_pc_ = return_pc;
       return true;  // Continue.
     }
     std::deque<InstrumentationStackFrame>* const instrumentation_stack_;
+    // The frames to report the entry of, innermost first, and their dex pcs.
+    std::vector<InstrumentationStackFrame> entered_frames_;
     std::vector<uint32_t> dex_pcs_;
     const uintptr_t instrumentation_exit_pc_;
+    const Instrumentation* const instrumentation_;
     uintptr_t last_return_pc_;
   };
   if (kVerboseInstrumentation) {
@@ -158,39 +189,37 @@ static void InstrumentationInstallStack(Thread* thread, void* arg)
     thread->GetThreadName(thread_name);
     LOG(INFO) << "Installing exit stubs in " << thread_name;
   }
+  Instrumentation* instrumentation = reinterpret_cast<Instrumentation*>(arg);
+  thread->SetMethodHooksEnabled(instrumentation->AreMethodHooksEnabled());
   UniquePtr<Context> context(Context::Create());
   uintptr_t instrumentation_exit_pc = GetQuickInstrumentationExitPc();
-  InstallStackVisitor visitor(thread, context.get(), instrumentation_exit_pc);
+  InstallStackVisitor visitor(thread, context.get(), instrumentation_exit_pc, instrumentation);
   visitor.WalkStack(true);
 
   // Create method enter events for all methods current on the thread's stack.
-  Instrumentation* instrumentation = reinterpret_cast<Instrumentation*>(arg);
-  typedef std::deque<InstrumentationStackFrame>::const_reverse_iterator It;
-  for (It it = thread->GetInstrumentationStack()->rbegin(),
-       end = thread->GetInstrumentationStack()->rend(); it != end; ++it) {
-    mirror::Object* this_object = (*it).this_object_;
-    mirror::ArtMethod* method = (*it).method_;
-    uint32_t dex_pc = visitor.dex_pcs_.back();
-    visitor.dex_pcs_.pop_back();
-    instrumentation->MethodEnterEvent(thread, this_object, method, dex_pc);
+  for (size_t i = visitor.entered_frames_.size(); i != 0; --i) {
+    const InstrumentationStackFrame& frame = visitor.entered_frames_[i - 1];
+    instrumentation->MethodEnterEvent(thread, frame.this_object_, frame.method_,
+                                      visitor.dex_pcs_[i - 1]);
   }
   thread->VerifyStack();
 }
 
-// Removes the instrumentation exit pc as the return PC for every quick frame.
+// Removes the instrumentation exit pc as the return PC for every quick frame, and disables the
+// method hooks.
 static void InstrumentationRestoreStack(Thread* thread, void* arg)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
   struct RestoreStackVisitor : public StackVisitor {
     RestoreStackVisitor(Thread* thread, uintptr_t instrumentation_exit_pc,
-                        Instrumentation* instrumentation)
+                        Instrumentation* instrumentation, bool method_hooks)
         : StackVisitor(thread, NULL), thread_(thread),
           instrumentation_exit_pc_(instrumentation_exit_pc),
           instrumentation_(instrumentation),
           instrumentation_stack_(thread->GetInstrumentationStack()),
-          frames_removed_(0) {}
+          method_hooks_(method_hooks), frames_removed_(0) {}
 
     virtual bool VisitFrame() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
-      if (instrumentation_stack_->size() == 0) {
+      if (instrumentation_stack_->size() == 0 && !method_hooks_) {
         return false;  // Stop.
       }
       mirror::ArtMethod* m = GetMethod();
@@ -228,7 +257,11 @@ static void InstrumentationRestoreStack(Thread* thread, void* arg)
         }
       }
       if (!removed_stub) {
-        if (kVerboseInstrumentation) {
+        if (method_hooks_ && m->HasMethodHooks()) {
+          // The disabled exit hook won't report the exit of the method. Like the hooks, don't
+          // bother with the receiver.
+          instrumentation_->MethodExitEvent(thread_, NULL, m, GetDexPc(), JValue());
+        } else if (kVerboseInstrumentation) {
           LOG(INFO) << "  No exit stub in " << DescribeLocation();
         }
       }
@@ -238,6 +271,8 @@ static void InstrumentationRestoreStack(Thread* thread, void* arg)
     const uintptr_t instrumentation_exit_pc_;
     Instrumentation* const instrumentation_;
     std::deque<instrumentation::InstrumentationStackFrame>* const instrumentation_stack_;
+    // Were the method hooks of the thread enabled?
+    const bool method_hooks_;
     size_t frames_removed_;
   };
   if (kVerboseInstrumentation) {
@@ -245,11 +280,13 @@ static void InstrumentationRestoreStack(Thread* thread, void* arg)
     thread->GetThreadName(thread_name);
     LOG(INFO) << "Removing exit stubs in " << thread_name;
   }
+  bool method_hooks = thread->AreMethodHooksEnabled();
+  thread->SetMethodHooksEnabled(false);
   std::deque<instrumentation::InstrumentationStackFrame>* stack = thread->GetInstrumentationStack();
-  if (stack->size() > 0) {
+  if (stack->size() > 0 || method_hooks) {
     Instrumentation* instrumentation = reinterpret_cast<Instrumentation*>(arg);
     uintptr_t instrumentation_exit_pc = GetQuickInstrumentationExitPc();
-    RestoreStackVisitor visitor(thread, instrumentation_exit_pc, instrumentation);
+    RestoreStackVisitor visitor(thread, instrumentation_exit_pc, instrumentation, method_hooks);
     visitor.WalkStack(true);
     CHECK_EQ(visitor.frames_removed_, stack->size());
     while (stack->size() > 0) {
@@ -260,8 +297,13 @@ static void InstrumentationRestoreStack(Thread* thread, void* arg)
 
 void Instrumentation::AddListener(InstrumentationListener* listener, uint32_t events) {
   Locks::mutator_lock_->AssertExclusiveHeld(Thread::Current());
+  if (method_hooks_enabled_ && (events & (kMethodEntered | kMethodExited | kDexPcMoved)) != 0) {
+    // The new listener may suspend, need the receiver or deoptimize, switch to the stubs for
+    // everything.
+    ConfigureStubs(false, false);
+    use_method_hooks_ = false;
+  }
   bool require_entry_exit_stubs = false;
-  bool require_interpreter = false;
   if ((events & kMethodEntered) != 0) {
     method_entry_listeners_.push_back(listener);
     require_entry_exit_stubs = true;
@@ -277,21 +319,22 @@ void Instrumentation::AddListener(InstrumentationListener* listener, uint32_t ev
     have_method_unwind_listeners_ = true;
   }
   if ((events & kDexPcMoved) != 0) {
+    // Dex pc events come from the methods deoptimized for them, the exit stubs switch the frames
+    // of those methods to the interpreter.
     dex_pc_listeners_.push_back(listener);
-    require_interpreter = true;
+    require_entry_exit_stubs = true;
     have_dex_pc_listeners_ = true;
   }
   if ((events & kExceptionCaught) != 0) {
     exception_caught_listeners_.push_back(listener);
     have_exception_caught_listeners_ = true;
   }
-  ConfigureStubs(require_entry_exit_stubs, require_interpreter);
+  ConfigureStubs(require_entry_exit_stubs, false);
 }
 
 void Instrumentation::RemoveListener(InstrumentationListener* listener, uint32_t events) {
   Locks::mutator_lock_->AssertExclusiveHeld(Thread::Current());
   bool require_entry_exit_stubs = false;
-  bool require_interpreter = false;
 
   if ((events & kMethodEntered) != 0) {
     bool contains = std::find(method_entry_listeners_.begin(), method_entry_listeners_.end(),
@@ -321,13 +364,13 @@ void Instrumentation::RemoveListener(InstrumentationListener* listener, uint32_t
       dex_pc_listeners_.remove(listener);
     }
     have_dex_pc_listeners_ = dex_pc_listeners_.size() > 0;
-    require_interpreter |= have_dex_pc_listeners_;
   }
+  require_entry_exit_stubs |= have_dex_pc_listeners_;
   if ((events & kExceptionCaught) != 0) {
     exception_caught_listeners_.remove(listener);
     have_exception_caught_listeners_ = exception_caught_listeners_.size() > 0;
   }
-  ConfigureStubs(require_entry_exit_stubs, require_interpreter);
+  ConfigureStubs(require_entry_exit_stubs, false);
 }
 
 void Instrumentation::ConfigureStubs(bool require_entry_exit_stubs, bool require_interpreter) {
@@ -362,6 +405,11 @@ void Instrumentation::ConfigureStubs(bool require_entry_exit_stubs, bool require
       CHECK(require_entry_exit_stubs);
       entry_exit_stubs_installed_ = true;
     }
+    {
+      // Registering threads read it to enable their method hooks.
+      MutexLock mu(self, *Locks::thread_list_lock_);
+      method_hooks_enabled_ = use_method_hooks_ && !interpreter_stubs_installed_;
+    }
     runtime->GetClassLinker()->VisitClasses(InstallStubsClassVisitor, this);
     instrumentation_stubs_installed_ = true;
     MutexLock mu(Thread::Current(), *Locks::thread_list_lock_);
@@ -369,6 +417,10 @@ void Instrumentation::ConfigureStubs(bool require_entry_exit_stubs, bool require
   } else {
     interpreter_stubs_installed_ = false;
     entry_exit_stubs_installed_ = false;
+    {
+      MutexLock mu(self, *Locks::thread_list_lock_);
+      method_hooks_enabled_ = false;
+    }
     runtime->GetClassLinker()->VisitClasses(InstallStubsClassVisitor, this);
     instrumentation_stubs_installed_ = false;
     MutexLock mu(self, *Locks::thread_list_lock_);
@@ -376,8 +428,107 @@ void Instrumentation::ConfigureStubs(bool require_entry_exit_stubs, bool require
   }
 }
 
+bool Instrumentation::SetMethodFilter(const std::vector<std::string>& class_descriptor_prefixes) {
+  Locks::mutator_lock_->AssertExclusiveHeld(Thread::Current());
+  if (have_method_entry_listeners_ || have_method_exit_listeners_) {
+    // The stubs of the existing listeners were installed with the old filter.
+    return false;
+  }
+  method_filter_ = class_descriptor_prefixes;
+  return true;
+}
+
+bool Instrumentation::IsClassInstrumented(const mirror::Class* klass) const {
+  if (LIKELY(method_filter_.empty())) {
+    return true;
+  }
+  const char* descriptor = ClassHelper(klass).GetDescriptor();
+  for (const std::string& prefix : method_filter_) {
+    if (strncmp(descriptor, prefix.c_str(), prefix.size()) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Instrumentation::IsMethodInstrumented(const mirror::ArtMethod* method) const {
+  return LIKELY(method_filter_.empty()) || IsClassInstrumented(method->GetDeclaringClass());
+}
+
+bool Instrumentation::SetUseMethodHooks(bool use_method_hooks) {
+  Locks::mutator_lock_->AssertExclusiveHeld(Thread::Current());
+  if (have_method_entry_listeners_ || have_method_exit_listeners_) {
+    // The stubs or hooks of the existing listeners are installed.
+    return false;
+  }
+  use_method_hooks_ = use_method_hooks;
+  return true;
+}
+
+bool Instrumentation::IsHookedMethod(const mirror::ArtMethod* method) const {
+  return method_hooks_enabled_ && method->HasMethodHooks();
+}
+
+void Instrumentation::Deoptimize(mirror::ArtMethod* method) {
+  Locks::mutator_lock_->AssertExclusiveHeld(Thread::Current());
+  CHECK(!method->IsNative() && !method->IsProxyMethod() && !method->IsAbstract())
+      << PrettyMethod(method);
+  if (!deoptimized_methods_.insert(method).second) {
+    return;
+  }
+  if (kVerboseInstrumentation) {
+    LOG(INFO) << "Deoptimizing " << PrettyMethod(method);
+  }
+  if (!forced_interpret_only_) {
+    method->SetEntryPointFromCompiledCode(GetCompiledCodeToInterpreterBridge());
+  }
+}
+
+void Instrumentation::Undeoptimize(mirror::ArtMethod* method) {
+  Locks::mutator_lock_->AssertExclusiveHeld(Thread::Current());
+  if (deoptimized_methods_.erase(method) == 0) {
+    return;
+  }
+  if (kVerboseInstrumentation) {
+    LOG(INFO) << "Undeoptimizing " << PrettyMethod(method);
+  }
+  if (!forced_interpret_only_) {
+    ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+    if (method->IsStatic() && !method->IsConstructor() &&
+        !method->GetDeclaringClass()->IsInitialized()) {
+      UpdateMethodsCode(method, GetResolutionTrampoline(class_linker));
+    } else {
+      UpdateMethodsCode(method, class_linker->GetOatCodeFor(method));
+    }
+  }
+}
+
+void Instrumentation::UndeoptimizeAll() {
+  Locks::mutator_lock_->AssertExclusiveHeld(Thread::Current());
+  while (!deoptimized_methods_.empty()) {
+    Undeoptimize(const_cast<mirror::ArtMethod*>(*deoptimized_methods_.begin()));
+  }
+}
+
+bool Instrumentation::IsDeoptimized(const mirror::ArtMethod* method) const {
+  return UNLIKELY(!deoptimized_methods_.empty()) &&
+      deoptimized_methods_.find(method) != deoptimized_methods_.end();
+}
+
+bool Instrumentation::ShouldInterpret(Thread* self, const mirror::ArtMethod* method) const {
+  if (method->IsNative() || method->IsProxyMethod()) {
+    return false;
+  }
+  return self->IsInterpreterForced() || IsDeoptimized(method);
+}
+
 void Instrumentation::UpdateMethodsCode(mirror::ArtMethod* method, const void* code) const {
-  if (LIKELY(!instrumentation_stubs_installed_)) {
+  if (UNLIKELY(IsDeoptimized(method)) && !forced_interpret_only_) {
+    // Stays in the interpreter until undeoptimized.
+    method->SetEntryPointFromCompiledCode(GetCompiledCodeToInterpreterBridge());
+  } else if (LIKELY(!instrumentation_stubs_installed_) ||
+      (!interpreter_stubs_installed_ && !IsMethodInstrumented(method)) ||
+      IsHookedMethod(method)) {
     method->SetEntryPointFromCompiledCode(code);
   } else {
     if (!interpreter_stubs_installed_ || method->IsNative()) {
@@ -404,6 +555,10 @@ const void* Instrumentation::GetQuickCodeFor(const mirror::ArtMethod* method) co
 void Instrumentation::MethodEnterEventImpl(Thread* thread, mirror::Object* this_object,
                                            const mirror::ArtMethod* method,
                                            uint32_t dex_pc) const {
+  // The interpreter reports the methods it runs whether or not they pass the filter.
+  if (!IsMethodInstrumented(method)) {
+    return;
+  }
   auto it = method_entry_listeners_.begin();
   bool is_end = (it == method_entry_listeners_.end());
   // Implemented this way to prevent problems caused by modification of the list while iterating.
@@ -418,6 +573,9 @@ void Instrumentation::MethodEnterEventImpl(Thread* thread, mirror::Object* this_
 void Instrumentation::MethodExitEventImpl(Thread* thread, mirror::Object* this_object,
                                           const mirror::ArtMethod* method,
                                           uint32_t dex_pc, const JValue& return_value) const {
+  if (!IsMethodInstrumented(method)) {
+    return;
+  }
   auto it = method_exit_listeners_.begin();
   bool is_end = (it == method_exit_listeners_.end());
   // Implemented this way to prevent problems caused by modification of the list while iterating.
@@ -432,7 +590,7 @@ void Instrumentation::MethodExitEventImpl(Thread* thread, mirror::Object* this_o
 void Instrumentation::MethodUnwindEvent(Thread* thread, mirror::Object* this_object,
                                         const mirror::ArtMethod* method,
                                         uint32_t dex_pc) const {
-  if (have_method_unwind_listeners_) {
+  if (have_method_unwind_listeners_ && IsMethodInstrumented(method)) {
     for (InstrumentationListener* listener : method_unwind_listeners_) {
       listener->MethodUnwind(thread, method, dex_pc);
     }
@@ -523,7 +681,7 @@ uint64_t Instrumentation::PopInstrumentationStackFrame(Thread* self, uintptr_t*
   MethodExitEvent(self, this_object, instrumentation_frame.method_, dex_pc, return_value);
 
   bool deoptimize = false;
-  if (interpreter_stubs_installed_) {
+  if (interpreter_stubs_installed_ || self->IsInterpreterForced()) {
     // Deoptimize unless we're returning to an upcall.
     NthCallerVisitor visitor(self, 1, true);
     visitor.WalkStack(true);
@@ -531,6 +689,14 @@ uint64_t Instrumentation::PopInstrumentationStackFrame(Thread* self, uintptr_t*
     if (deoptimize && kVerboseInstrumentation) {
       LOG(INFO) << "Deoptimizing into " << PrettyMethod(visitor.caller);
     }
+  } else if (UNLIKELY(!deoptimized_methods_.empty())) {
+    // Deoptimize when returning to a compiled frame of a deoptimized method.
+    NthCallerVisitor visitor(self, 1, true);
+    visitor.WalkStack(true);
+    deoptimize = visitor.caller != NULL && IsDeoptimized(visitor.caller);
+    if (deoptimize && kVerboseInstrumentation) {
+      LOG(INFO) << "Deoptimizing into " << PrettyMethod(visitor.caller);
+    }
   }
   if (deoptimize) {
     if (kVerboseInstrumentation) {
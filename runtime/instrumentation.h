@@ -22,6 +22,9 @@
 
 #include <stdint.h>
 #include <list>
+#include <set>
+#include <string>
+#include <vector>
 
 namespace art {
 namespace mirror {
@@ -91,7 +94,7 @@ class Instrumentation {
 
   Instrumentation() :
       instrumentation_stubs_installed_(false), entry_exit_stubs_installed_(false),
-      interpreter_stubs_installed_(false),
+      interpreter_stubs_installed_(false), use_method_hooks_(false), method_hooks_enabled_(false),
       interpret_only_(false), forced_interpret_only_(false),
       have_method_entry_listeners_(false), have_method_exit_listeners_(false),
       have_method_unwind_listeners_(false), have_dex_pc_listeners_(false),
@@ -110,8 +113,53 @@ class Instrumentation {
       EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_)
       LOCKS_EXCLUDED(Locks::thread_list_lock_, Locks::classlinker_classes_lock_);
 
+  // Restrict the entry and exit stubs, and the method entry, exit and unwind events, to the methods
+  // of the classes whose descriptors start with one of the given prefixes. The other methods keep
+  // running their own code. An empty list removes the restriction. Must be set before adding the
+  // listeners it applies to, fails if there are already method entry or exit listeners.
+  bool SetMethodFilter(const std::vector<std::string>& class_descriptor_prefixes)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Is the method one that gets method entry, exit and unwind events?
+  bool IsMethodInstrumented(const mirror::ArtMethod* method) const
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Let the methods whose compiled code calls the method hooks report their entries and exits
+  // through the hooks rather than through entry and exit stubs. The hooks don't pass the receiver
+  // and don't allow the listeners to suspend or walk the stack. Must be set before adding the
+  // listeners it applies to, fails if there are already method entry or exit listeners.
+  bool SetUseMethodHooks(bool use_method_hooks) EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Are the method hooks of the threads enabled? Written with the thread list lock held.
+  bool AreMethodHooksEnabled() const {
+    return method_hooks_enabled_;
+  }
+
+  // Does the method report its entries and exits through the method hooks?
+  bool IsHookedMethod(const mirror::ArtMethod* method) const
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Make calls of the method run it in the interpreter, which reports its dex pc events, while the
+  // other methods keep their compiled code. Frames of the method already on a stack switch to the
+  // interpreter when a callee returns to them, which requires the exit stubs to be installed.
+  void Deoptimize(mirror::ArtMethod* method) EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Give a deoptimized method its code back.
+  void Undeoptimize(mirror::ArtMethod* method) EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Give all deoptimized methods their code back.
+  void UndeoptimizeAll() EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  bool IsDeoptimized(const mirror::ArtMethod* method) const
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Should the method, called by the thread through the entry stub, run in the interpreter?
+  bool ShouldInterpret(Thread* self, const mirror::ArtMethod* method) const
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   // Update the code of a method respecting any installed stubs.
-  void UpdateMethodsCode(mirror::ArtMethod* method, const void* code) const;
+  void UpdateMethodsCode(mirror::ArtMethod* method, const void* code) const
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   // Get the quick code for the given method. More efficient than asking the class linker as it
   // will short-cut to GetCode if instrumentation and static method resolution stubs aren't
@@ -215,6 +263,10 @@ class Instrumentation {
       EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_)
       LOCKS_EXCLUDED(Locks::thread_list_lock_, Locks::classlinker_classes_lock_);
 
+  // Does the class pass the method filter?
+  bool IsClassInstrumented(const mirror::Class* klass) const
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   void MethodEnterEventImpl(Thread* thread, mirror::Object* this_object,
                             const mirror::ArtMethod* method, uint32_t dex_pc) const
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -235,6 +287,12 @@ class Instrumentation {
   // Have we hijacked ArtMethod::code_ to reference the enter interpreter stub?
   bool interpreter_stubs_installed_;
 
+  // May compiled code with method hooks report entries and exits instead of stubs?
+  bool use_method_hooks_;
+
+  // Are the method hooks of the threads set, leaving the methods with hooks their code?
+  bool method_hooks_enabled_;
+
   // Do we need the fidelity of events that we only get from running within the interpreter?
   bool interpret_only_;
 
@@ -260,6 +318,12 @@ class Instrumentation {
   // Do we have any exception caught listeners? Short-cut to avoid taking the instrumentation_lock_.
   bool have_exception_caught_listeners_;
 
+  // The methods that run in the interpreter while the others keep their compiled code.
+  std::set<const mirror::ArtMethod*> deoptimized_methods_ GUARDED_BY(Locks::mutator_lock_);
+
+  // The descriptor prefixes of the classes with entry and exit stubs, empty for all classes.
+  std::vector<std::string> method_filter_ GUARDED_BY(Locks::mutator_lock_);
+
   // The event listeners, written to with the mutator_lock_ exclusively held.
   std::list<InstrumentationListener*> method_entry_listeners_ GUARDED_BY(Locks::mutator_lock_);
   std::list<InstrumentationListener*> method_exit_listeners_ GUARDED_BY(Locks::mutator_lock_);
@@ -16,177 +16,355 @@
 
 #include "intern_table.h"
 
-#include "gc/space/image_space.h"
-#include "mirror/dex_cache.h"
+#include "base/stl_util.h"
+#include "cutils/atomic-inline.h"
 #include "mirror/object_array-inl.h"
 #include "mirror/object-inl.h"
 #include "mirror/string.h"
 #include "thread.h"
+#include "thread_pool.h"
 #include "UniquePtr.h"
 #include "utf.h"
+#include "utils.h"
 
 namespace art {
 
-InternTable::InternTable()
-    : intern_table_lock_("InternTable lock"), is_dirty_(false), allow_new_interns_(true),
-      new_intern_condition_("New intern condition", intern_table_lock_) {
+static const size_t kMinStringSetCapacity = 16;
+
+InternTable::StringSet::Slots::Slots(size_t capacity) : mask(capacity - 1), slots(capacity) {
+  DCHECK(IsPowerOfTwo(capacity));
+  for (Slot& slot : slots) {
+    slot.hash = 0;
+    slot.string = NULL;
+  }
 }
 
-size_t InternTable::Size() const {
-  MutexLock mu(Thread::Current(), intern_table_lock_);
-  return strong_interns_.size() + weak_interns_.size();
+InternTable::StringSet::StringSet()
+    : slots_(new Slots(kMinStringSetCapacity)), num_strings_(0), num_removed_(0) {
 }
 
-void InternTable::DumpForSigQuit(std::ostream& os) const {
-  MutexLock mu(Thread::Current(), intern_table_lock_);
-  os << "Intern table: " << strong_interns_.size() << " strong; "
-     << weak_interns_.size() << " weak\n";
+InternTable::StringSet::~StringSet() {
+  delete slots_;
+  STLDeleteElements(&retired_slots_);
 }
 
-void InternTable::VisitRoots(RootVisitor* visitor, void* arg,
-                             bool only_dirty, bool clean_dirty) {
-  MutexLock mu(Thread::Current(), intern_table_lock_);
-  if (!only_dirty || is_dirty_) {
-    for (const auto& strong_intern : strong_interns_) {
-      visitor(strong_intern.second, arg);
+template <typename Matcher>
+const InternTable::StringSet::Slot* InternTable::StringSet::Find(uint32_t hash,
+                                                                 const Matcher& matcher) const {
+  const Slots* slots = slots_;
+  // The set is never full, so the probe always ends on an unused slot.
+  for (size_t i = hash & slots->mask; ; i = (i + 1) & slots->mask) {
+    const Slot& slot = slots->slots[i];
+    mirror::String* s = slot.string;
+    if (s == NULL) {
+      return NULL;
     }
-    if (clean_dirty) {
-      is_dirty_ = false;
+    if (!IsString(s)) {
+      continue;
+    }
+    // Pairs with the barrier in InsertInto, the hash must not be read before the string.
+    android_memory_barrier();
+    if (slot.hash == hash && matcher(s)) {
+      return &slot;
     }
   }
-  // Note: we deliberately don't visit the weak_interns_ table and the immutable
-  // image roots.
 }
 
-mirror::String* InternTable::Lookup(Table& table, mirror::String* s,
-                                    uint32_t hash_code) {
-  intern_table_lock_.AssertHeld(Thread::Current());
-  for (auto it = table.find(hash_code), end = table.end(); it != end; ++it) {
-    mirror::String* existing_string = it->second;
-    if (existing_string->Equals(s)) {
-      return existing_string;
+struct StringMatcher {
+  explicit StringMatcher(mirror::String* s) : s(s) {}
+
+  bool operator()(mirror::String* other) const SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    return other->Equals(s);
+  }
+
+  mirror::String* const s;
+};
+
+struct Utf8Matcher {
+  Utf8Matcher(const char* utf8_data, int32_t utf16_length)
+      : utf8_data(utf8_data), utf16_length(utf16_length) {}
+
+  bool operator()(mirror::String* other) const SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    return other->GetLength() == utf16_length && other->Equals(utf8_data);
+  }
+
+  const char* const utf8_data;
+  const int32_t utf16_length;
+};
+
+mirror::String* InternTable::StringSet::Lookup(mirror::String* s, uint32_t hash) const {
+  const Slot* slot = Find(hash, StringMatcher(s));
+  return slot != NULL ? slot->string : NULL;
+}
+
+mirror::String* InternTable::StringSet::Lookup(const char* utf8_data, int32_t utf16_length,
+                                               uint32_t hash) const {
+  const Slot* slot = Find(hash, Utf8Matcher(utf8_data, utf16_length));
+  return slot != NULL ? slot->string : NULL;
+}
+
+void InternTable::StringSet::InsertInto(Slots* slots, mirror::String* s, uint32_t hash) {
+  for (size_t i = hash & slots->mask; ; i = (i + 1) & slots->mask) {
+    Slot& slot = slots->slots[i];
+    if (slot.string == NULL) {
+      slot.hash = hash;
+      // A reader which finds the string must also find its hash.
+      android_memory_barrier();
+      slot.string = s;
+      return;
     }
   }
-  return NULL;
 }
 
-mirror::String* InternTable::Insert(Table& table, mirror::String* s,
-                                    uint32_t hash_code) {
-  intern_table_lock_.AssertHeld(Thread::Current());
-  table.insert(std::make_pair(hash_code, s));
-  return s;
+void InternTable::StringSet::Insert(mirror::String* s, uint32_t hash) {
+  // Tombstones lengthen probes just like strings, so they count towards the load.
+  if ((num_strings_ + num_removed_ + 1) * 4 > slots_->slots.size() * 3) {
+    Resize((num_strings_ + 1) * 2);
+  }
+  InsertInto(slots_, s, hash);
+  ++num_strings_;
 }
 
-void InternTable::Remove(Table& table, const mirror::String* s,
-                         uint32_t hash_code) {
-  intern_table_lock_.AssertHeld(Thread::Current());
-  for (auto it = table.find(hash_code), end = table.end(); it != end; ++it) {
-    if (it->second == s) {
-      table.erase(it);
+void InternTable::StringSet::Remove(const mirror::String* s, uint32_t hash) {
+  Slots* slots = slots_;
+  for (size_t i = hash & slots->mask; ; i = (i + 1) & slots->mask) {
+    Slot& slot = slots->slots[i];
+    if (slot.string == NULL) {
+      return;
+    }
+    if (slot.string == s) {
+      // Readers only stop at unused slots, so the tombstone keeps later strings reachable.
+      slot.string = reinterpret_cast<mirror::String*>(kRemovedString);
+      --num_strings_;
+      ++num_removed_;
       return;
     }
   }
 }
 
-static mirror::String* LookupStringFromImage(mirror::String* s)
-    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
-  gc::space::ImageSpace* image = Runtime::Current()->GetHeap()->GetImageSpace();
-  if (image == NULL) {
-    return NULL;  // No image present.
-  }
-  mirror::Object* root = image->GetImageHeader().GetImageRoot(ImageHeader::kDexCaches);
-  mirror::ObjectArray<mirror::DexCache>* dex_caches = root->AsObjectArray<mirror::DexCache>();
-  const std::string utf8 = s->ToModifiedUtf8();
-  for (int32_t i = 0; i < dex_caches->GetLength(); ++i) {
-    mirror::DexCache* dex_cache = dex_caches->Get(i);
-    const DexFile* dex_file = dex_cache->GetDexFile();
-    // Binary search the dex file for the string index.
-    const DexFile::StringId* string_id = dex_file->FindStringId(utf8.c_str());
-    if (string_id != NULL) {
-      uint32_t string_idx = dex_file->GetIndexForStringId(*string_id);
-      mirror::String* image = dex_cache->GetResolvedString(string_idx);
-      if (image != NULL) {
-        return image;
+void InternTable::StringSet::Sweep(IsMarkedTester is_marked, void* arg) {
+  for (Slot& slot : slots_->slots) {
+    if (IsString(slot.string) && !is_marked(slot.string, arg)) {
+      slot.string = reinterpret_cast<mirror::String*>(kRemovedString);
+      --num_strings_;
+      ++num_removed_;
+    }
+  }
+}
+
+void InternTable::StringSet::Resize(size_t count) {
+  size_t capacity = kMinStringSetCapacity;
+  while (capacity * 3 < count * 4 + 4) {
+    capacity *= 2;
+  }
+  Slots* old_slots = slots_;
+  Slots* new_slots = new Slots(capacity);
+  for (const Slot& slot : old_slots->slots) {
+    if (IsString(slot.string)) {
+      InsertInto(new_slots, slot.string, slot.hash);
+    }
+  }
+  // Publish the new array only once all of its slots are visible.
+  android_memory_barrier();
+  slots_ = new_slots;
+  retired_slots_.push_back(old_slots);
+  num_removed_ = 0;
+}
+
+void InternTable::StringSet::VisitRoots(RootVisitor* visitor, void* arg) const {
+  for (const Slot& slot : slots_->slots) {
+    if (IsString(slot.string)) {
+      visitor(slot.string, arg);
+    }
+  }
+}
+
+void InternTable::StringSet::FreeRetiredSlots() {
+  STLDeleteElements(&retired_slots_);
+}
+
+InternTable::Shard::Shard()
+    : lock("InternTable shard lock"), is_dirty(false), allow_new_interns(true),
+      new_intern_condition("New intern condition", lock) {
+}
+
+InternTable::InternTable() : image_strings_(NULL) {
+  for (size_t i = 0; i < kShardCount; ++i) {
+    shards_[i] = new Shard;
+  }
+}
+
+InternTable::~InternTable() {
+  for (size_t i = 0; i < kShardCount; ++i) {
+    delete shards_[i];
+  }
+}
+
+size_t InternTable::Size() const {
+  Thread* self = Thread::Current();
+  size_t size = 0;
+  for (size_t i = 0; i < kShardCount; ++i) {
+    MutexLock mu(self, shards_[i]->lock);
+    size += shards_[i]->strong_interns.Size() + shards_[i]->weak_interns.Size();
+  }
+  return size;
+}
+
+void InternTable::DumpForSigQuit(std::ostream& os) const {
+  Thread* self = Thread::Current();
+  size_t strong = 0;
+  size_t weak = 0;
+  for (size_t i = 0; i < kShardCount; ++i) {
+    MutexLock mu(self, shards_[i]->lock);
+    strong += shards_[i]->strong_interns.Size();
+    weak += shards_[i]->weak_interns.Size();
+  }
+  os << "Intern table: " << strong << " strong; " << weak << " weak\n";
+}
+
+void InternTable::VisitRoots(RootVisitor* visitor, void* arg,
+                             bool only_dirty, bool clean_dirty) {
+  Thread* self = Thread::Current();
+  for (size_t i = 0; i < kShardCount; ++i) {
+    Shard* shard = shards_[i];
+    MutexLock mu(self, shard->lock);
+    if (!only_dirty || shard->is_dirty) {
+      shard->strong_interns.VisitRoots(visitor, arg);
+      if (clean_dirty) {
+        shard->is_dirty = false;
       }
     }
   }
-  return NULL;
+  // Note: we deliberately don't visit the weak_interns table and the immutable
+  // image roots.
+}
+
+void InternTable::SetImageStrings(mirror::ObjectArray<mirror::String>* image_strings) {
+  CHECK(IsPowerOfTwo(image_strings->GetLength())) << image_strings->GetLength();
+  image_strings_ = image_strings;
+}
+
+template <typename Matcher>
+mirror::String* InternTable::LookupImageString(uint32_t hash, const Matcher& matcher) const {
+  if (image_strings_ == NULL) {
+    return NULL;
+  }
+  // Compare the contents rather than the hash codes, an image string whose hash code isn't cached
+  // would dirty its page when computing it.
+  const uint32_t mask = image_strings_->GetLength() - 1;
+  for (uint32_t i = hash & mask; ; i = (i + 1) & mask) {
+    mirror::String* image_string = image_strings_->GetWithoutChecks(i);
+    if (image_string == NULL) {
+      return NULL;
+    }
+    if (matcher(image_string)) {
+      return image_string;
+    }
+  }
 }
 
 void InternTable::AllowNewInterns() {
   Thread* self = Thread::Current();
-  MutexLock mu(self, intern_table_lock_);
-  allow_new_interns_ = true;
-  new_intern_condition_.Broadcast(self);
+  for (size_t i = 0; i < kShardCount; ++i) {
+    Shard* shard = shards_[i];
+    MutexLock mu(self, shard->lock);
+    shard->allow_new_interns = true;
+    shard->new_intern_condition.Broadcast(self);
+  }
 }
 
 void InternTable::DisallowNewInterns() {
   Thread* self = Thread::Current();
-  MutexLock mu(self, intern_table_lock_);
-  allow_new_interns_ = false;
+  for (size_t i = 0; i < kShardCount; ++i) {
+    Shard* shard = shards_[i];
+    MutexLock mu(self, shard->lock);
+    shard->allow_new_interns = false;
+    // The mutators are suspended, so no lock free lookup is probing the old arrays.
+    shard->strong_interns.FreeRetiredSlots();
+    shard->weak_interns.FreeRetiredSlots();
+  }
 }
 
-mirror::String* InternTable::Insert(mirror::String* s, bool is_strong) {
-  Thread* self = Thread::Current();
-  MutexLock mu(self, intern_table_lock_);
+// Same as String::GetHashCode, without having to allocate the string.
+static uint32_t ComputeModifiedUtf8Hash(const char* utf8_data) {
+  uint32_t hash = 0;
+  while (*utf8_data != '\0') {
+    hash = hash * 31 + GetUtf16FromUtf8(&utf8_data);
+  }
+  return hash;
+}
 
+mirror::String* InternTable::Insert(mirror::String* s, bool is_strong) {
   DCHECK(s != NULL);
   uint32_t hash_code = s->GetHashCode();
+  Shard* shard = ShardFor(hash_code);
 
-  while (UNLIKELY(!allow_new_interns_)) {
-    new_intern_condition_.WaitHoldingLocks(self);
+  // Image strings and strong interns are never swept, so a match can be returned without the lock.
+  mirror::String* image = LookupImageString(hash_code, StringMatcher(s));
+  if (image != NULL) {
+    return image;
+  }
+  mirror::String* strong = shard->strong_interns.Lookup(s, hash_code);
+  if (strong != NULL) {
+    return strong;
   }
 
-  if (is_strong) {
-    // Check the strong table for a match.
-    mirror::String* strong = Lookup(strong_interns_, s, hash_code);
-    if (strong != NULL) {
-      return strong;
-    }
+  Thread* self = Thread::Current();
+  MutexLock mu(self, shard->lock);
 
-    // Mark as dirty so that we rescan the roots.
-    is_dirty_ = true;
+  while (UNLIKELY(!shard->allow_new_interns)) {
+    shard->new_intern_condition.WaitHoldingLocks(self);
+  }
 
-    // Check the image for a match.
-    mirror::String* image = LookupStringFromImage(s);
-    if (image != NULL) {
-      return Insert(strong_interns_, image, hash_code);
-    }
+  // Check the strong table again, another thread may have inserted the string.
+  strong = shard->strong_interns.Lookup(s, hash_code);
+  if (strong != NULL) {
+    return strong;
+  }
+
+  if (is_strong) {
+    // Mark as dirty so that we rescan the roots.
+    shard->is_dirty = true;
 
     // There is no match in the strong table, check the weak table.
-    mirror::String* weak = Lookup(weak_interns_, s, hash_code);
+    mirror::String* weak = shard->weak_interns.Lookup(s, hash_code);
     if (weak != NULL) {
       // A match was found in the weak table. Promote to the strong table.
-      Remove(weak_interns_, weak, hash_code);
-      return Insert(strong_interns_, weak, hash_code);
+      shard->weak_interns.Remove(weak, hash_code);
+      shard->strong_interns.Insert(weak, hash_code);
+      return weak;
     }
 
     // No match in the strong table or the weak table. Insert into the strong
     // table.
-    return Insert(strong_interns_, s, hash_code);
+    shard->strong_interns.Insert(s, hash_code);
+    return s;
   }
 
-  // Check the strong table for a match.
-  mirror::String* strong = Lookup(strong_interns_, s, hash_code);
-  if (strong != NULL) {
-    return strong;
-  }
-  // Check the image for a match.
-  mirror::String* image = LookupStringFromImage(s);
-  if (image != NULL) {
-    return Insert(weak_interns_, image, hash_code);
-  }
   // Check the weak table for a match.
-  mirror::String* weak = Lookup(weak_interns_, s, hash_code);
+  mirror::String* weak = shard->weak_interns.Lookup(s, hash_code);
   if (weak != NULL) {
     return weak;
   }
   // Insert into the weak table.
-  return Insert(weak_interns_, s, hash_code);
+  shard->weak_interns.Insert(s, hash_code);
+  return s;
 }
 
 mirror::String* InternTable::InternStrong(int32_t utf16_length,
                                           const char* utf8_data) {
+  // Resolving a string constant usually finds it already interned, don't allocate for that.
+  uint32_t hash_code = ComputeModifiedUtf8Hash(utf8_data);
+  Utf8Matcher matcher(utf8_data, utf16_length);
+  mirror::String* image = LookupImageString(hash_code, matcher);
+  if (image != NULL) {
+    return image;
+  }
+  mirror::String* strong = ShardFor(hash_code)->strong_interns.Lookup(utf8_data, utf16_length,
+                                                                      hash_code);
+  if (strong != NULL) {
+    return strong;
+  }
   return InternStrong(mirror::String::AllocFromModifiedUtf8(
       Thread::Current(), utf16_length, utf8_data));
 }
@@ -211,22 +389,61 @@ mirror::String* InternTable::InternWeak(mirror::String* s) {
 }
 
 bool InternTable::ContainsWeak(mirror::String* s) {
-  MutexLock mu(Thread::Current(), intern_table_lock_);
-  const mirror::String* found = Lookup(weak_interns_, s, s->GetHashCode());
+  uint32_t hash_code = s->GetHashCode();
+  Shard* shard = ShardFor(hash_code);
+  MutexLock mu(Thread::Current(), shard->lock);
+  const mirror::String* found = shard->weak_interns.Lookup(s, hash_code);
   return found == s;
 }
 
-void InternTable::SweepInternTableWeaks(IsMarkedTester is_marked, void* arg) {
-  MutexLock mu(Thread::Current(), intern_table_lock_);
-  // TODO: std::remove_if + lambda.
-  for (auto it = weak_interns_.begin(), end = weak_interns_.end(); it != end;) {
-    mirror::Object* object = it->second;
-    if (!is_marked(object, arg)) {
-      weak_interns_.erase(it++);
-    } else {
-      ++it;
+void InternTable::SweepShard(Thread* self, size_t shard_index, IsMarkedTester is_marked,
+                             void* arg) {
+  Shard* shard = shards_[shard_index];
+  MutexLock mu(self, shard->lock);
+  shard->weak_interns.Sweep(is_marked, arg);
+}
+
+// Sweeps the weak interns of one shard on a GC thread.
+class SweepInternShardTask : public UnsplittableTask {
+ public:
+  SweepInternShardTask(InternTable* intern_table, size_t shard_index, IsMarkedTester is_marked,
+                       void* arg)
+      : intern_table_(intern_table), shard_index_(shard_index), is_marked_(is_marked), arg_(arg) {}
+
+  // The thread which started the sweep holds the heap bitmap lock on our behalf.
+  virtual void Run(Thread* self) NO_THREAD_SAFETY_ANALYSIS {
+    intern_table_->SweepShard(self, shard_index_, is_marked_, arg_);
+  }
+
+ private:
+  InternTable* const intern_table_;
+  const size_t shard_index_;
+  const IsMarkedTester is_marked_;
+  void* const arg_;
+
+  DISALLOW_COPY_AND_ASSIGN(SweepInternShardTask);
+};
+
+void InternTable::SweepInternTableWeaks(IsMarkedTester is_marked, void* arg,
+                                        ThreadPool* thread_pool) {
+  Thread* self = Thread::Current();
+  if (thread_pool == NULL) {
+    for (size_t i = 0; i < kShardCount; ++i) {
+      SweepShard(self, i, is_marked, arg);
     }
+    return;
+  }
+  std::vector<SweepInternShardTask*> tasks;
+  for (size_t i = 0; i < kShardCount; ++i) {
+    SweepInternShardTask* task = new SweepInternShardTask(this, i, is_marked, arg);
+    tasks.push_back(task);
+    thread_pool->AddTask(self, task);
   }
+  thread_pool->SetMaxActiveWorkers(thread_pool->GetThreadCount());
+  thread_pool->StartWorkers(self);
+  thread_pool->Wait(self, true, true);
+  thread_pool->StopWorkers(self);
+  STLDeleteElements(&tasks);
 }
 
 }  // namespace art
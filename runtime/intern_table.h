@@ -20,12 +20,15 @@
 #include "base/mutex.h"
 #include "root_visitor.h"
 
-#include <map>
+#include <vector>
 
 namespace art {
 namespace mirror {
+template<class T> class ObjectArray;
 class String;
 }  // namespace mirror
+class Thread;
+class ThreadPool;
 
 /**
  * Used to intern strings.
@@ -36,12 +39,21 @@ class String;
  * String.intern. Some code (XML parsers being a prime example) relies on being able to intern
  * arbitrarily many strings for the duration of a parse without permanently increasing the memory
  * footprint.
+ *
+ * The tables are split into shards by hash code, each with its own lock. Strong interns are never
+ * removed, so finding an already interned strong string doesn't take a lock at all. Weak lookups
+ * lock their shard since the GC may be about to sweep the string they would return.
+ *
+ * The interned strings of the boot image are looked up first, in a hash set which ImageWriter
+ * serializes into the image. They are neither added to the tables nor swept.
  */
 class InternTable {
  public:
   InternTable();
+  ~InternTable();
 
-  // Interns a potentially new string in the 'strong' table. (See above.)
+  // Interns a potentially new string in the 'strong' table. (See above.) Doesn't allocate if the
+  // string is already a strong intern.
   mirror::String* InternStrong(int32_t utf16_length, const char* utf8_data)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
@@ -55,7 +67,9 @@ class InternTable {
   // Interns a potentially new string in the 'weak' table. (See above.)
   mirror::String* InternWeak(mirror::String* s) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
-  void SweepInternTableWeaks(IsMarkedTester is_marked, void* arg)
+  // Sweeps the shards in parallel if given a thread pool, the is_marked tester must then be
+  // thread safe.
+  void SweepInternTableWeaks(IsMarkedTester is_marked, void* arg, ThreadPool* thread_pool = NULL)
       SHARED_LOCKS_REQUIRED(Locks::heap_bitmap_lock_);
 
   bool ContainsWeak(mirror::String* s) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -69,23 +83,118 @@ class InternTable {
   void DisallowNewInterns() EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
   void AllowNewInterns() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Sets the image's String[] of interned strings. Each string is at the first free slot from its
+  // hash code modulo the length, which is a power of two.
+  void SetImageStrings(mirror::ObjectArray<mirror::String>* image_strings)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
  private:
-  typedef std::multimap<int32_t, mirror::String*> Table;
+  // Open addressing hash set of strings keyed by their hash code. Lookups may run without the
+  // owning shard's lock, modifications must hold it. Growing publishes a new slot array, the old
+  // arrays are kept until FreeRetiredSlots since a reader may still be probing them. Removed
+  // strings leave a tombstone which is dropped when the set is rehashed.
+  class StringSet {
+   public:
+    StringSet();
+    ~StringSet();
+
+    mirror::String* Lookup(mirror::String* s, uint32_t hash) const
+        SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+    mirror::String* Lookup(const char* utf8_data, int32_t utf16_length, uint32_t hash) const
+        SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+    void Insert(mirror::String* s, uint32_t hash);
+    void Remove(const mirror::String* s, uint32_t hash);
+
+    // Removes the strings which aren't marked.
+    void Sweep(IsMarkedTester is_marked, void* arg);
+
+    void VisitRoots(RootVisitor* visitor, void* arg) const;
+
+    // Only safe when no lock free lookup can be in progress, such as with the mutators suspended.
+    void FreeRetiredSlots();
+
+    size_t Size() const {
+      return num_strings_;
+    }
+
+   private:
+    struct Slot {
+      uint32_t hash;
+      // NULL if the slot was never used, kRemovedString if it holds a tombstone. Published after
+      // hash.
+      mirror::String* volatile string;
+    };
+
+    struct Slots {
+      explicit Slots(size_t capacity);
+
+      const size_t mask;
+      std::vector<Slot> slots;
+    };
+
+    static const uintptr_t kRemovedString = 1;
+
+    static bool IsString(const mirror::String* s) {
+      return s != NULL && reinterpret_cast<uintptr_t>(s) != kRemovedString;
+    }
+
+    // Returns the slot holding a string for which the matcher returns true, or NULL.
+    template <typename Matcher>
+    const Slot* Find(uint32_t hash, const Matcher& matcher) const;
+
+    // Stores into the first unused slot of the probe sequence.
+    static void InsertInto(Slots* slots, mirror::String* s, uint32_t hash);
+
+    // Rehashes the live strings into a new array with room for at least count strings.
+    void Resize(size_t count);
+
+    Slots* volatile slots_;
+    std::vector<Slots*> retired_slots_;
+    size_t num_strings_;
+    size_t num_removed_;
+
+    DISALLOW_COPY_AND_ASSIGN(StringSet);
+  };
+
+  struct Shard {
+    Shard();
+
+    Mutex lock;
+    bool is_dirty GUARDED_BY(lock);
+    bool allow_new_interns GUARDED_BY(lock);
+    ConditionVariable new_intern_condition GUARDED_BY(lock);
+    // Readable without the lock.
+    StringSet strong_interns;
+    StringSet weak_interns GUARDED_BY(lock);
+  };
+
+  static const size_t kShardCount = 16;
+
+  Shard* ShardFor(uint32_t hash) const {
+    // Short strings have small hash codes, mix the bits so that they still spread over the shards.
+    return shards_[(hash * 0x9E3779B1U) >> 28];
+  }
 
   mirror::String* Insert(mirror::String* s, bool is_strong)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
-  mirror::String* Lookup(Table& table, mirror::String* s, uint32_t hash_code)
+  // Returns the image string for which the matcher returns true, or NULL.
+  template <typename Matcher>
+  mirror::String* LookupImageString(uint32_t hash, const Matcher& matcher) const
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
-  mirror::String* Insert(Table& table, mirror::String* s, uint32_t hash_code);
-  void Remove(Table& table, const mirror::String* s, uint32_t hash_code);
-
-  mutable Mutex intern_table_lock_;
-  bool is_dirty_ GUARDED_BY(intern_table_lock_);
-  bool allow_new_interns_ GUARDED_BY(intern_table_lock_);
-  ConditionVariable new_intern_condition_ GUARDED_BY(intern_table_lock_);
-  Table strong_interns_ GUARDED_BY(intern_table_lock_);
-  Table weak_interns_ GUARDED_BY(intern_table_lock_);
+
+  void SweepShard(Thread* self, size_t shard_index, IsMarkedTester is_marked, void* arg)
+      SHARED_LOCKS_REQUIRED(Locks::heap_bitmap_lock_);
+
+  Shard* shards_[kShardCount];
+
+  // Immutable, NULL without an image.
+  mirror::ObjectArray<mirror::String>* image_strings_;
+
+  friend class SweepInternShardTask;
+
+  DISALLOW_COPY_AND_ASSIGN(InternTable);
 };
 
 }  // namespace art
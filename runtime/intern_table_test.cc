@@ -54,6 +54,23 @@ TEST_F(InternTableTest, Size) {
   EXPECT_EQ(2U, t.Size());
 }
 
+TEST_F(InternTableTest, InternMany) {
+  ScopedObjectAccess soa(Thread::Current());
+  InternTable t;
+  // Enough strings that every shard has to grow.
+  std::vector<mirror::String*> interned;
+  for (size_t i = 0; i < 2000; ++i) {
+    const std::string s(StringPrintf("string %zd", i));
+    interned.push_back(t.InternStrong(s.size(), s.c_str()));
+  }
+  EXPECT_EQ(2000U, t.Size());
+  for (size_t i = 0; i < 2000; ++i) {
+    const std::string s(StringPrintf("string %zd", i));
+    EXPECT_EQ(interned[i], t.InternStrong(s.size(), s.c_str()));
+  }
+  EXPECT_EQ(2000U, t.Size());
+}
+
 class TestPredicate {
  public:
   bool IsMarked(const mirror::Object* s) const {
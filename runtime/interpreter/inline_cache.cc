@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "inline_cache.h"
+
+#include <string.h>
+
+#include "base/logging.h"
+#include "cutils/atomic-inline.h"
+#include "thread.h"
+
+namespace art {
+namespace interpreter {
+
+InlineCacheTable::InlineCacheTable()
+    : lock_("interpreter inline cache lock"), entries_(NULL) {
+  COMPILE_ASSERT((kCapacity & (kCapacity - 1)) == 0, capacity_must_be_a_power_of_two);
+}
+
+InlineCacheTable::~InlineCacheTable() {
+  delete[] entries_;
+}
+
+mirror::ArtMethod* InlineCacheTable::Lookup(const mirror::ArtMethod* caller, uint32_t dex_pc,
+                                            const mirror::Class* klass) const {
+  const Entry* entries = entries_;
+  if (entries == NULL) {
+    return NULL;
+  }
+  // Pairs with the barrier publishing entries_.
+  android_memory_barrier();
+  size_t index = Hash(caller, dex_pc);
+  for (size_t probe = 0; probe < kMaxProbes; ++probe, ++index) {
+    const Entry& entry = entries[index & (kCapacity - 1)];
+    const mirror::ArtMethod* entry_caller = entry.caller;
+    if (entry_caller == NULL) {
+      return NULL;
+    }
+    if (entry_caller != caller) {
+      continue;
+    }
+    android_memory_barrier();
+    if (entry.dex_pc != dex_pc) {
+      continue;
+    }
+    for (size_t i = 0; i < kMaxReceiverClasses; ++i) {
+      const mirror::Class* entry_class = entry.classes[i];
+      if (entry_class == NULL) {
+        return NULL;
+      }
+      if (entry_class == klass) {
+        android_memory_barrier();
+        return entry.targets[i];
+      }
+    }
+    return NULL;
+  }
+  return NULL;
+}
+
+void InlineCacheTable::Update(Thread* self, const mirror::ArtMethod* caller, uint32_t dex_pc,
+                              mirror::Class* klass, mirror::ArtMethod* target) {
+  MutexLock mu(self, lock_);
+  Entry* entries = entries_;
+  if (entries == NULL) {
+    entries = new Entry[kCapacity];
+    memset(entries, 0, sizeof(Entry) * kCapacity);
+    // Readers must see the cleared entries before the array.
+    android_memory_barrier();
+    entries_ = entries;
+  }
+  size_t index = Hash(caller, dex_pc);
+  for (size_t probe = 0; probe < kMaxProbes; ++probe, ++index) {
+    Entry& entry = entries[index & (kCapacity - 1)];
+    if (entry.caller == NULL) {
+      entry.dex_pc = dex_pc;
+      android_memory_barrier();
+      entry.caller = caller;
+    } else if (entry.caller != caller || entry.dex_pc != dex_pc) {
+      continue;
+    }
+    for (size_t i = 0; i < kMaxReceiverClasses; ++i) {
+      if (entry.classes[i] == klass) {
+        // Another thread got here first.
+        DCHECK_EQ(entry.targets[i], target);
+        return;
+      }
+      if (entry.classes[i] == NULL) {
+        entry.targets[i] = target;
+        android_memory_barrier();
+        entry.classes[i] = klass;
+        return;
+      }
+    }
+    // Megamorphic.
+    return;
+  }
+}
+
+void InlineCacheTable::VisitCallSites(CallSiteVisitor visitor, void* arg) const {
+  const Entry* entries = entries_;
+  if (entries == NULL) {
+    return;
+  }
+  android_memory_barrier();
+  for (size_t i = 0; i < kCapacity; ++i) {
+    const Entry& entry = entries[i];
+    const mirror::ArtMethod* caller = entry.caller;
+    if (caller == NULL) {
+      continue;
+    }
+    android_memory_barrier();
+    mirror::Class* classes[kMaxReceiverClasses];
+    size_t num_classes = 0;
+    while (num_classes < kMaxReceiverClasses && entry.classes[num_classes] != NULL) {
+      classes[num_classes] = entry.classes[num_classes];
+      ++num_classes;
+    }
+    if (num_classes != 0) {
+      visitor(caller, entry.dex_pc, classes, num_classes, arg);
+    }
+  }
+}
+
+}  // namespace interpreter
+}  // namespace art
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_INTERPRETER_INLINE_CACHE_H_
+#define ART_RUNTIME_INTERPRETER_INLINE_CACHE_H_
+
+#include <stdint.h>
+
+#include "base/macros.h"
+#include "base/mutex.h"
+
+namespace art {
+
+namespace mirror {
+  class ArtMethod;
+  class Class;
+}  // namespace mirror
+
+class Thread;
+
+namespace interpreter {
+
+// Receiver class to target method caches for the invoke-virtual and invoke-interface instructions
+// run by the interpreter, keyed by the calling method and the dex pc of the invoke. Each cache
+// holds up to kMaxReceiverClasses classes, call sites that see more stay on the slow path.
+//
+// The caches of all methods share one fixed size open addressing table, allocated on first use,
+// so that they don't change the layout of ArtMethod. Lookups are lock free, updates hold lock_.
+// Classes and methods are neither moved nor unloaded, so the entries don't need to be visited by
+// the GC nor invalidated.
+class InlineCacheTable {
+ public:
+  static const size_t kMaxReceiverClasses = 4;
+
+  typedef void (*CallSiteVisitor)(const mirror::ArtMethod* caller, uint32_t dex_pc,
+                                  mirror::Class* const* classes, size_t num_classes, void* arg);
+
+  InlineCacheTable();
+  ~InlineCacheTable();
+
+  // Returns the method an earlier call from the same instruction dispatched to for the class, or
+  // NULL if there is none.
+  mirror::ArtMethod* Lookup(const mirror::ArtMethod* caller, uint32_t dex_pc,
+                            const mirror::Class* klass) const;
+
+  // Records the target of a successful dispatch. Does nothing when the table or the cache of the
+  // instruction is full.
+  void Update(Thread* self, const mirror::ArtMethod* caller, uint32_t dex_pc,
+              mirror::Class* klass, mirror::ArtMethod* target) LOCKS_EXCLUDED(lock_);
+
+  // Calls the visitor with the receiver classes of each cached call site. Caches updated
+  // concurrently may be missed or seen with fewer classes.
+  void VisitCallSites(CallSiteVisitor visitor, void* arg) const;
+
+ private:
+  struct Entry {
+    // NULL while unused, published after dex_pc.
+    const mirror::ArtMethod* volatile caller;
+    uint32_t dex_pc;
+    // Filled in order, each class is published after its target.
+    mirror::Class* volatile classes[kMaxReceiverClasses];
+    mirror::ArtMethod* targets[kMaxReceiverClasses];
+  };
+
+  static const size_t kCapacity = 1024;
+  // Probes stop after this many entries, a full neighbourhood means the call site isn't cached.
+  static const size_t kMaxProbes = 8;
+
+  static size_t Hash(const mirror::ArtMethod* caller, uint32_t dex_pc) {
+    return (reinterpret_cast<uintptr_t>(caller) >> 3) * 31 + dex_pc;
+  }
+
+  Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  Entry* volatile entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(InlineCacheTable);
+};
+
+}  // namespace interpreter
+}  // namespace art
+
+#endif  // ART_RUNTIME_INTERPRETER_INLINE_CACHE_H_
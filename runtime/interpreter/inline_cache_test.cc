@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "inline_cache.h"
+
+#include "common_test.h"
+#include "mirror/art_method-inl.h"
+#include "mirror/class-inl.h"
+
+namespace art {
+namespace interpreter {
+
+class InlineCacheTableTest : public CommonTest {};
+
+static void CountReceivers(const mirror::ArtMethod*, uint32_t, mirror::Class* const*,
+                           size_t num_classes, void* arg) {
+  *reinterpret_cast<size_t*>(arg) += num_classes;
+}
+
+TEST_F(InlineCacheTableTest, LookupUpdate) {
+  ScopedObjectAccess soa(Thread::Current());
+  const char* descriptors[] = {
+    "Ljava/lang/Object;", "Ljava/lang/String;", "[I", "[J", "[Ljava/lang/Object;"
+  };
+  const size_t num_classes = arraysize(descriptors);
+  ASSERT_GT(num_classes, InlineCacheTable::kMaxReceiverClasses);
+  mirror::Class* classes[num_classes];
+  for (size_t i = 0; i < num_classes; ++i) {
+    classes[i] = class_linker_->FindSystemClass(descriptors[i]);
+    ASSERT_TRUE(classes[i] != NULL);
+  }
+  mirror::ArtMethod* caller = classes[0]->GetVirtualMethod(0);
+  mirror::ArtMethod* other_caller = classes[0]->GetVirtualMethod(1);
+  mirror::ArtMethod* target = classes[1]->GetVirtualMethod(0);
+
+  InlineCacheTable table;
+  EXPECT_TRUE(table.Lookup(caller, 4, classes[0]) == NULL);
+
+  for (size_t i = 0; i < num_classes; ++i) {
+    table.Update(soa.Self(), caller, 4, classes[i], target);
+  }
+  for (size_t i = 0; i < InlineCacheTable::kMaxReceiverClasses; ++i) {
+    EXPECT_EQ(target, table.Lookup(caller, 4, classes[i]));
+  }
+  // The other classes don't fit in the cache of the instruction.
+  for (size_t i = InlineCacheTable::kMaxReceiverClasses; i < num_classes; ++i) {
+    EXPECT_TRUE(table.Lookup(caller, 4, classes[i]) == NULL);
+  }
+
+  // Caches are per instruction.
+  EXPECT_TRUE(table.Lookup(caller, 6, classes[0]) == NULL);
+  EXPECT_TRUE(table.Lookup(other_caller, 4, classes[0]) == NULL);
+  table.Update(soa.Self(), other_caller, 4, classes[0], caller);
+  EXPECT_EQ(caller, table.Lookup(other_caller, 4, classes[0]));
+  EXPECT_EQ(target, table.Lookup(caller, 4, classes[0]));
+
+  size_t num_receivers = 0;
+  table.VisitCallSites(CountReceivers, &num_receivers);
+  EXPECT_EQ(InlineCacheTable::kMaxReceiverClasses + 1, num_receivers);
+}
+
+}  // namespace interpreter
+}  // namespace art
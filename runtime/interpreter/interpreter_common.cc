@@ -0,0 +1,513 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "interpreter_common.h"
+
+#include <algorithm>
+
+#include "base/stringprintf.h"
+#include "inline_cache.h"
+
+namespace art {
+namespace interpreter {
+
+static void UnstartedRuntimeInvoke(Thread* self, MethodHelper& mh,
+                                   const DexFile::CodeItem* code_item, ShadowFrame* shadow_frame,
+                                   JValue* result, size_t arg_offset)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  // In a runtime that's not started we intercept certain methods to avoid complicated dependency
+  // problems in core libraries.
+  std::string name(PrettyMethod(shadow_frame->GetMethod()));
+  if (name == "java.lang.Class java.lang.Class.forName(java.lang.String)") {
+    std::string descriptor(DotToDescriptor(shadow_frame->GetVRegReference(arg_offset)->AsString()->ToModifiedUtf8().c_str()));
+    ClassLoader* class_loader = NULL;  // shadow_frame.GetMethod()->GetDeclaringClass()->GetClassLoader();
+    Class* found = Runtime::Current()->GetClassLinker()->FindClass(descriptor.c_str(),
+                                                                   class_loader);
+    CHECK(found != NULL) << "Class.forName failed in un-started runtime for class: "
+        << PrettyDescriptor(descriptor);
+    result->SetL(found);
+  } else if (name == "java.lang.Object java.lang.Class.newInstance()") {
+    Class* klass = shadow_frame->GetVRegReference(arg_offset)->AsClass();
+    ArtMethod* c = klass->FindDeclaredDirectMethod("<init>", "()V");
+    CHECK(c != NULL);
+    SirtRef<Object> obj(self, klass->AllocObject(self));
+    CHECK(obj.get() != NULL);
+    EnterInterpreterFromInvoke(self, c, obj.get(), NULL, NULL);
+    result->SetL(obj.get());
+  } else if (name == "java.lang.reflect.Field java.lang.Class.getDeclaredField(java.lang.String)") {
+    // Special managed code cut-out to allow field lookup in a un-started runtime that'd fail
+    // going the reflective Dex way.
+    Class* klass = shadow_frame->GetVRegReference(arg_offset)->AsClass();
+    String* name = shadow_frame->GetVRegReference(arg_offset + 1)->AsString();
+    ArtField* found = NULL;
+    FieldHelper fh;
+    ObjectArray<ArtField>* fields = klass->GetIFields();
+    for (int32_t i = 0; i < fields->GetLength() && found == NULL; ++i) {
+      ArtField* f = fields->Get(i);
+      fh.ChangeField(f);
+      if (name->Equals(fh.GetName())) {
+        found = f;
+      }
+    }
+    if (found == NULL) {
+      fields = klass->GetSFields();
+      for (int32_t i = 0; i < fields->GetLength() && found == NULL; ++i) {
+        ArtField* f = fields->Get(i);
+        fh.ChangeField(f);
+        if (name->Equals(fh.GetName())) {
+          found = f;
+        }
+      }
+    }
+    CHECK(found != NULL)
+      << "Failed to find field in Class.getDeclaredField in un-started runtime. name="
+      << name->ToModifiedUtf8() << " class=" << PrettyDescriptor(klass);
+    // TODO: getDeclaredField calls GetType once the field is found to ensure a
+    //       NoClassDefFoundError is thrown if the field's type cannot be resolved.
+    Class* jlr_Field = self->DecodeJObject(WellKnownClasses::java_lang_reflect_Field)->AsClass();
+    SirtRef<Object> field(self, jlr_Field->AllocObject(self));
+    CHECK(field.get() != NULL);
+    ArtMethod* c = jlr_Field->FindDeclaredDirectMethod("<init>", "(Ljava/lang/reflect/ArtField;)V");
+    uint32_t args[1];
+    args[0] = reinterpret_cast<uint32_t>(found);
+    EnterInterpreterFromInvoke(self, c, field.get(), args, NULL);
+    result->SetL(field.get());
+  } else if (name == "void java.lang.System.arraycopy(java.lang.Object, int, java.lang.Object, int, int)" ||
+             name == "void java.lang.System.arraycopy(char[], int, char[], int, int)") {
+    // Special case array copying without initializing System.
+    Class* ctype = shadow_frame->GetVRegReference(arg_offset)->GetClass()->GetComponentType();
+    jint srcPos = shadow_frame->GetVReg(arg_offset + 1);
+    jint dstPos = shadow_frame->GetVReg(arg_offset + 3);
+    jint length = shadow_frame->GetVReg(arg_offset + 4);
+    if (!ctype->IsPrimitive()) {
+      ObjectArray<Object>* src = shadow_frame->GetVRegReference(arg_offset)->AsObjectArray<Object>();
+      ObjectArray<Object>* dst = shadow_frame->GetVRegReference(arg_offset + 2)->AsObjectArray<Object>();
+      for (jint i = 0; i < length; ++i) {
+        RecordArrayWriteInTransaction(self, dst, dstPos + i, 1, sizeof(Object*), true);
+        dst->Set(dstPos + i, src->Get(srcPos + i));
+      }
+    } else if (ctype->IsPrimitiveChar()) {
+      CharArray* src = shadow_frame->GetVRegReference(arg_offset)->AsCharArray();
+      CharArray* dst = shadow_frame->GetVRegReference(arg_offset + 2)->AsCharArray();
+      RecordArrayWriteInTransaction(self, dst, dstPos, length, sizeof(uint16_t), false);
+      for (jint i = 0; i < length; ++i) {
+        dst->Set(dstPos + i, src->Get(srcPos + i));
+      }
+    } else if (ctype->IsPrimitiveInt()) {
+      IntArray* src = shadow_frame->GetVRegReference(arg_offset)->AsIntArray();
+      IntArray* dst = shadow_frame->GetVRegReference(arg_offset + 2)->AsIntArray();
+      RecordArrayWriteInTransaction(self, dst, dstPos, length, sizeof(int32_t), false);
+      for (jint i = 0; i < length; ++i) {
+        dst->Set(dstPos + i, src->Get(srcPos + i));
+      }
+    } else {
+      UNIMPLEMENTED(FATAL) << "System.arraycopy of unexpected type: " << PrettyDescriptor(ctype);
+    }
+  } else {
+    // Not special, continue with regular interpreter execution.
+    artInterpreterToInterpreterBridge(self, mh, code_item, shadow_frame, result);
+  }
+}
+
+// Runs the intrinsic on the arguments in the caller's registers, the first one being the receiver
+// of instance methods. Returns false when the call has to go through the method instead, for the
+// intrinsics that aren't implemented here and for arguments that throw or need the slow path.
+static bool DoIntrinsic(Thread* self, Intrinsic intrinsic, const ShadowFrame& shadow_frame,
+                        const uint32_t* arg_regs, JValue* result)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  switch (intrinsic) {
+    case kIntrinsicDoubleToRawLongBits:
+    case kIntrinsicLongBitsToDouble:
+      result->SetJ(shadow_frame.GetVRegLong(arg_regs[0]));
+      return true;
+    case kIntrinsicFloatToRawIntBits:
+    case kIntrinsicIntBitsToFloat:
+      result->SetI(shadow_frame.GetVReg(arg_regs[0]));
+      return true;
+    case kIntrinsicAbsInt: {
+      // Computed unsigned so that the absolute value of Integer.MIN_VALUE wraps around.
+      uint32_t value = shadow_frame.GetVReg(arg_regs[0]);
+      result->SetI(static_cast<int32_t>(value) < 0 ? 0 - value : value);
+      return true;
+    }
+    case kIntrinsicAbsLong: {
+      uint64_t value = shadow_frame.GetVRegLong(arg_regs[0]);
+      result->SetJ(static_cast<int64_t>(value) < 0 ? 0 - value : value);
+      return true;
+    }
+    case kIntrinsicMaxInt:
+      result->SetI(std::max(shadow_frame.GetVReg(arg_regs[0]), shadow_frame.GetVReg(arg_regs[1])));
+      return true;
+    case kIntrinsicMinInt:
+      result->SetI(std::min(shadow_frame.GetVReg(arg_regs[0]), shadow_frame.GetVReg(arg_regs[1])));
+      return true;
+    case kIntrinsicSqrt:
+      result->SetD(sqrt(shadow_frame.GetVRegDouble(arg_regs[0])));
+      return true;
+    case kIntrinsicStringCharAt:
+    case kIntrinsicStringCompareTo:
+    case kIntrinsicStringEquals:
+    case kIntrinsicStringIsEmpty:
+    case kIntrinsicStringIndexOfFrom:
+    case kIntrinsicStringIndexOf:
+    case kIntrinsicStringLength: {
+      Object* receiver = shadow_frame.GetVRegReference(arg_regs[0]);
+      if (UNLIKELY(receiver == NULL)) {
+        return false;
+      }
+      String* string = receiver->AsString();
+      if (intrinsic == kIntrinsicStringCharAt) {
+        int32_t index = shadow_frame.GetVReg(arg_regs[1]);
+        if (UNLIKELY(index < 0 || index >= string->GetLength())) {
+          return false;
+        }
+        result->SetC(string->CharAt(index));
+      } else if (intrinsic == kIntrinsicStringCompareTo) {
+        Object* other = shadow_frame.GetVRegReference(arg_regs[1]);
+        if (UNLIKELY(other == NULL)) {
+          return false;
+        }
+        result->SetI(string->CompareTo(other->AsString()));
+      } else if (intrinsic == kIntrinsicStringEquals) {
+        // String is final, anything else of the same class is a string.
+        Object* other = shadow_frame.GetVRegReference(arg_regs[1]);
+        result->SetZ(other != NULL && other->GetClass() == string->GetClass() &&
+                     string->Equals(other->AsString()));
+      } else if (intrinsic == kIntrinsicStringIsEmpty) {
+        result->SetZ(string->GetLength() == 0);
+      } else if (intrinsic == kIntrinsicStringLength) {
+        result->SetI(string->GetLength());
+      } else {
+        // Supplementary code points are searched as surrogate pairs by the method.
+        int32_t ch = shadow_frame.GetVReg(arg_regs[1]);
+        if (UNLIKELY(ch < 0 || ch > 0xFFFF)) {
+          return false;
+        }
+        int32_t start = 0;
+        if (intrinsic == kIntrinsicStringIndexOfFrom) {
+          start = shadow_frame.GetVReg(arg_regs[2]);
+        }
+        result->SetI(string->FastIndexOf(ch, start));
+      }
+      return true;
+    }
+    case kIntrinsicCurrentThread:
+      result->SetL(self->GetPeer());
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Calls the method with the arguments of the invoke, which are copied along with their references
+// so that they keep their kinds without going through the shorty. The callee's frame comes from
+// the thread's interpreter stack, or from the native stack once that is full.
+template<bool is_range>
+static bool DoCall(Thread* self, ShadowFrame& shadow_frame, ArtMethod* method, MethodHelper& mh,
+                   const DexFile::CodeItem* code_item, uint16_t num_regs, uint16_t num_ins,
+                   uint32_t vregC, const uint32_t* arg, JValue* result)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  // Listeners of method entry and exit have to see the call.
+  if (UNLIKELY(method->IsIntrinsic()) &&
+      !Runtime::Current()->GetInstrumentation()->HasMethodEntryListeners() &&
+      !Runtime::Current()->GetInstrumentation()->HasMethodExitListeners()) {
+    // The intrinsics implemented here take at most 3 argument registers.
+    uint32_t range_arg[3];
+    const uint32_t* arg_regs = arg;
+    if (is_range && num_ins <= arraysize(range_arg)) {
+      for (size_t i = 0; i < num_ins; ++i) {
+        range_arg[i] = vregC + i;
+      }
+      arg_regs = range_arg;
+    }
+    if ((!is_range || num_ins <= arraysize(range_arg)) &&
+        DoIntrinsic(self, method->GetIntrinsic(), shadow_frame, arg_regs, result)) {
+      return true;
+    }
+  }
+  const size_t frame_size = ShadowFrame::ComputeSize(num_regs);
+  void* memory = self->PushInterpreterFrame(frame_size);
+  if (UNLIKELY(memory == NULL)) {
+    memory = alloca(frame_size);
+  }
+  ShadowFrame* new_shadow_frame(ShadowFrame::CreateForInvoke(num_regs, num_ins, &shadow_frame,
+                                                             method, memory));
+  const size_t first_arg_reg = num_regs - num_ins;
+  if (is_range) {
+    new_shadow_frame->CopyVRegsFrom(first_arg_reg, shadow_frame, vregC, num_ins);
+  } else {
+    for (size_t i = 0; i < num_ins; ++i) {
+      new_shadow_frame->CopyVRegFrom(first_arg_reg + i, shadow_frame, arg[i]);
+    }
+  }
+
+  if (LIKELY(Runtime::Current()->IsStarted())) {
+    (method->GetEntryPointFromInterpreter())(self, mh, code_item, new_shadow_frame, result);
+  } else {
+    UnstartedRuntimeInvoke(self, mh, code_item, new_shadow_frame, result, first_arg_reg);
+  }
+  self->PopInterpreterFrame(memory);
+  return !self->IsExceptionPending();
+}
+
+template<InvokeType type, bool is_range, bool do_access_check>
+bool DoInvoke(Thread* self, ShadowFrame& shadow_frame,
+              const Instruction* inst, JValue* result) {
+  bool do_assignability_check = do_access_check;
+  uint32_t method_idx = (is_range) ? inst->VRegB_3rc() : inst->VRegB_35c();
+  uint32_t vregC = (is_range) ? inst->VRegC_3rc() : inst->VRegC_35c();
+  Object* receiver = (type == kStatic) ? NULL : shadow_frame.GetVRegReference(vregC);
+  // Virtual and interface dispatch only depend on the receiver class once the checks made by
+  // FindMethodFromCode have passed for the instruction.
+  const bool use_inline_cache = (type == kVirtual || type == kInterface) && receiver != NULL;
+  InlineCacheTable* inline_caches = Runtime::Current()->GetInterpreterInlineCaches();
+  ArtMethod* method = NULL;
+  if (use_inline_cache) {
+    method = inline_caches->Lookup(shadow_frame.GetMethod(), shadow_frame.GetDexPC(),
+                                   receiver->GetClass());
+  }
+  if (method == NULL) {
+    method = FindMethodFromCode(method_idx, receiver, shadow_frame.GetMethod(), self,
+                                do_access_check, type);
+    if (use_inline_cache && method != NULL && !method->IsAbstract()) {
+      inline_caches->Update(self, shadow_frame.GetMethod(), shadow_frame.GetDexPC(),
+                            receiver->GetClass(), method);
+    }
+  }
+  if (UNLIKELY(method == NULL)) {
+    CHECK(self->IsExceptionPending());
+    result->SetJ(0);
+    return false;
+  } else if (UNLIKELY(method->IsAbstract())) {
+    ThrowAbstractMethodError(method);
+    result->SetJ(0);
+    return false;
+  }
+  // Overriding methods share the vtable index of the method they override.
+  if (type == kVirtual && !do_access_check && receiver != NULL &&
+      IsUint(16, method->GetMethodIndex()) && IsAligned<4>(inst)) {
+    Runtime::Current()->GetInterpreterQuickenedCode()->Quicken(self, shadow_frame.GetMethod(),
+                                                               shadow_frame.GetDexPC(),
+                                                               method->GetMethodIndex());
+  }
+
+  MethodHelper mh(method);
+  const DexFile::CodeItem* code_item = mh.GetCodeItem();
+  uint16_t num_regs;
+  uint16_t num_ins;
+  if (LIKELY(code_item != NULL)) {
+    num_regs = code_item->registers_size_;
+    num_ins = code_item->ins_size_;
+  } else {
+    DCHECK(method->IsNative() || method->IsProxyMethod());
+    num_regs = num_ins = ArtMethod::NumArgRegisters(mh.GetShorty());
+    if (!method->IsStatic()) {
+      num_regs++;
+      num_ins++;
+    }
+  }
+
+  uint32_t arg[5];
+  if (!is_range) {
+    inst->GetArgs(arg);
+  }
+  if (do_assignability_check) {
+    const DexFile::TypeList* params = mh.GetParameterTypeList();
+    const char* shorty = mh.GetShorty();
+    size_t arg_offset = (receiver == NULL) ? 0 : 1;
+    for (size_t shorty_pos = 0; arg_offset < num_ins; ++shorty_pos, arg_offset++) {
+      DCHECK_LT(shorty_pos + 1, mh.GetShortyLength());
+      const char shorty_char = shorty[shorty_pos + 1];
+      if (shorty_char == 'J' || shorty_char == 'D') {
+        arg_offset++;
+        continue;
+      }
+      if (shorty_char != 'L') {
+        continue;
+      }
+      size_t arg_pos = is_range ? vregC + arg_offset : arg[arg_offset];
+      Object* o = shadow_frame.GetVRegReference(arg_pos);
+      if (o == NULL) {
+        continue;
+      }
+      Class* arg_type = mh.GetClassFromTypeIdx(params->GetTypeItem(shorty_pos).type_idx_);
+      if (arg_type == NULL) {
+        CHECK(self->IsExceptionPending());
+        return false;
+      }
+      if (!o->VerifierInstanceOf(arg_type)) {
+        // This should never happen.
+        self->ThrowNewExceptionF(self->GetCurrentLocationForThrow(),
+                                 "Ljava/lang/VirtualMachineError;",
+                                 "Invoking %s with bad arg %d, type '%s' not instance of '%s'",
+                                 mh.GetName(), shorty_pos,
+                                 ClassHelper(o->GetClass()).GetDescriptor(),
+                                 ClassHelper(arg_type).GetDescriptor());
+        return false;
+      }
+    }
+  }
+  return DoCall<is_range>(self, shadow_frame, method, mh, code_item, num_regs, num_ins, vregC,
+                          arg, result);
+}
+
+template<bool is_range>
+bool DoInvokeVirtualQuick(Thread* self, ShadowFrame& shadow_frame,
+                          const Instruction* inst, JValue* result) {
+  uint32_t vregC = (is_range) ? inst->VRegC_3rc() : inst->VRegC_35c();
+  Object* receiver = shadow_frame.GetVRegReference(vregC);
+  if (UNLIKELY(receiver == NULL)) {
+    // We lost the reference to the method index so we cannot get a more
+    // precised exception message.
+    ThrowNullPointerExceptionFromDexPC(shadow_frame.GetCurrentLocationForThrow());
+    return false;
+  }
+  uint32_t vtable_idx = (is_range) ? inst->VRegB_3rc() : inst->VRegB_35c();
+  // TODO: use ObjectArray<T>::GetWithoutChecks ?
+  ArtMethod* method = receiver->GetClass()->GetVTable()->Get(vtable_idx);
+  if (UNLIKELY(method == NULL)) {
+    CHECK(self->IsExceptionPending());
+    result->SetJ(0);
+    return false;
+  } else if (UNLIKELY(method->IsAbstract())) {
+    ThrowAbstractMethodError(method);
+    result->SetJ(0);
+    return false;
+  }
+
+  MethodHelper mh(method);
+  const DexFile::CodeItem* code_item = mh.GetCodeItem();
+  uint16_t num_regs;
+  uint16_t num_ins;
+  if (code_item != NULL) {
+    num_regs = code_item->registers_size_;
+    num_ins = code_item->ins_size_;
+  } else {
+    DCHECK(method->IsNative() || method->IsProxyMethod());
+    num_regs = num_ins = ArtMethod::NumArgRegisters(mh.GetShorty());
+    if (!method->IsStatic()) {
+      num_regs++;
+      num_ins++;
+    }
+  }
+
+  uint32_t arg[5];
+  if (!is_range) {
+    inst->GetArgs(arg);
+  }
+  return DoCall<is_range>(self, shadow_frame, method, mh, code_item, num_regs, num_ins, vregC,
+                          arg, result);
+}
+
+template<InvokeType type, bool is_range>
+bool DoInvokeDirectQuick(Thread* self, ShadowFrame& shadow_frame,
+                         const Instruction* inst, JValue* result) {
+  uint32_t method_idx = (is_range) ? inst->VRegB_3rc() : inst->VRegB_35c();
+  ArtMethod* method = shadow_frame.GetMethod()->GetDexCacheResolvedMethods()->Get(method_idx);
+  if (UNLIKELY(method == NULL || method->IsRuntimeMethod())) {
+    // Not resolved in this dex cache yet, the regular path resolves it once.
+    return DoInvoke<type, is_range, false>(self, shadow_frame, inst, result);
+  }
+  uint32_t vregC = (is_range) ? inst->VRegC_3rc() : inst->VRegC_35c();
+  if (type == kDirect && UNLIKELY(shadow_frame.GetVRegReference(vregC) == NULL)) {
+    ThrowNullPointerExceptionForMethodAccess(shadow_frame.GetCurrentLocationForThrow(), method,
+                                             kDirect);
+    result->SetJ(0);
+    return false;
+  }
+
+  MethodHelper mh(method);
+  const DexFile::CodeItem* code_item = mh.GetCodeItem();
+  uint16_t num_regs;
+  uint16_t num_ins;
+  if (code_item != NULL) {
+    num_regs = code_item->registers_size_;
+    num_ins = code_item->ins_size_;
+  } else {
+    DCHECK(method->IsNative() || method->IsProxyMethod());
+    num_regs = num_ins = ArtMethod::NumArgRegisters(mh.GetShorty());
+    if (!method->IsStatic()) {
+      num_regs++;
+      num_ins++;
+    }
+  }
+
+  uint32_t arg[5];
+  if (!is_range) {
+    inst->GetArgs(arg);
+  }
+  return DoCall<is_range>(self, shadow_frame, method, mh, code_item, num_regs, num_ins, vregC,
+                          arg, result);
+}
+
+void UnexpectedOpcode(const Instruction* inst, MethodHelper& mh)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  LOG(FATAL) << "Unexpected instruction: " << inst->DumpString(&mh.GetDexFile());
+  exit(0);  // Unreachable, keep GCC happy.
+}
+
+void AbortTransaction(Thread* self, const char* fmt, ...) {
+  Transaction* transaction = self->GetTransaction();
+  CHECK(transaction != NULL);
+  va_list args;
+  va_start(args, fmt);
+  std::string message;
+  StringAppendV(&message, fmt, args);
+  va_end(args);
+  transaction->Abort(message);
+  self->ThrowNewException(self->GetCurrentLocationForThrow(), "Ljava/lang/InternalError;",
+                          message.c_str());
+}
+
+// Explicit DoInvoke template function declarations.
+#define EXPLICIT_DO_INVOKE_TEMPLATE_DECL(_type, _is_range, _do_check)                          \
+  template bool DoInvoke<_type, _is_range, _do_check>(Thread* self, ShadowFrame& shadow_frame, \
+                                                      const Instruction* inst, JValue* result)
+
+#define EXPLICIT_DO_INVOKE_ALL_TEMPLATE_DECL(_type)       \
+  EXPLICIT_DO_INVOKE_TEMPLATE_DECL(_type, false, false);  \
+  EXPLICIT_DO_INVOKE_TEMPLATE_DECL(_type, false, true);   \
+  EXPLICIT_DO_INVOKE_TEMPLATE_DECL(_type, true, false);   \
+  EXPLICIT_DO_INVOKE_TEMPLATE_DECL(_type, true, true)
+
+EXPLICIT_DO_INVOKE_ALL_TEMPLATE_DECL(kStatic);
+EXPLICIT_DO_INVOKE_ALL_TEMPLATE_DECL(kDirect);
+EXPLICIT_DO_INVOKE_ALL_TEMPLATE_DECL(kVirtual);
+EXPLICIT_DO_INVOKE_ALL_TEMPLATE_DECL(kSuper);
+EXPLICIT_DO_INVOKE_ALL_TEMPLATE_DECL(kInterface);
+#undef EXPLICIT_DO_INVOKE_ALL_TEMPLATE_DECL
+#undef EXPLICIT_DO_INVOKE_TEMPLATE_DECL
+
+// Explicit DoInvokeVirtualQuick template function declarations.
+template bool DoInvokeVirtualQuick<false>(Thread* self, ShadowFrame& shadow_frame,
+                                          const Instruction* inst, JValue* result);
+template bool DoInvokeVirtualQuick<true>(Thread* self, ShadowFrame& shadow_frame,
+                                         const Instruction* inst, JValue* result);
+
+// Explicit DoInvokeDirectQuick template function declarations.
+#define EXPLICIT_DO_INVOKE_DIRECT_QUICK_TEMPLATE_DECL(_type, _is_range)                   \
+  template bool DoInvokeDirectQuick<_type, _is_range>(Thread* self,                       \
+                                                      ShadowFrame& shadow_frame,          \
+                                                      const Instruction* inst, JValue* result)
+
+EXPLICIT_DO_INVOKE_DIRECT_QUICK_TEMPLATE_DECL(kDirect, false);
+EXPLICIT_DO_INVOKE_DIRECT_QUICK_TEMPLATE_DECL(kDirect, true);
+EXPLICIT_DO_INVOKE_DIRECT_QUICK_TEMPLATE_DECL(kStatic, false);
+EXPLICIT_DO_INVOKE_DIRECT_QUICK_TEMPLATE_DECL(kStatic, true);
+#undef EXPLICIT_DO_INVOKE_DIRECT_QUICK_TEMPLATE_DECL
+
+}  // namespace interpreter
+}  // namespace art
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "quickening.h"
+
+#include <string.h>
+
+#include "base/logging.h"
+#include "cutils/atomic-inline.h"
+#include "dex_file-inl.h"
+#include "leb128.h"
+#include "mirror/art_method-inl.h"
+#include "object_utils.h"
+#include "thread.h"
+#include "utils.h"
+
+namespace art {
+namespace interpreter {
+
+// The try items and the handlers follow the instructions and are copied with them.
+static size_t CodeItemSize(const DexFile::CodeItem* code_item) {
+  const byte* end;
+  if (code_item->tries_size_ == 0) {
+    end = reinterpret_cast<const byte*>(&code_item->insns_[code_item->insns_size_in_code_units_]);
+  } else {
+    end = DexFile::GetCatchHandlerData(*code_item, 0);
+    uint32_t handlers_size = DecodeUnsignedLeb128(&end);
+    for (uint32_t i = 0; i < handlers_size; ++i) {
+      CatchHandlerIterator iterator(end);
+      for (; iterator.HasNext(); iterator.Next()) {
+      }
+      end = iterator.EndDataPointer();
+    }
+  }
+  return end - reinterpret_cast<const byte*>(code_item);
+}
+
+QuickenedCodeTable::QuickenedCodeTable()
+    : lock_("interpreter quickened code lock"), entries_(NULL) {
+  COMPILE_ASSERT((kCapacity & (kCapacity - 1)) == 0, capacity_must_be_a_power_of_two);
+}
+
+QuickenedCodeTable::~QuickenedCodeTable() {
+  Entry* entries = entries_;
+  if (entries != NULL) {
+    for (size_t i = 0; i < kCapacity; ++i) {
+      delete[] reinterpret_cast<uint32_t*>(entries[i].code_item);
+    }
+    delete[] entries;
+  }
+}
+
+const DexFile::CodeItem* QuickenedCodeTable::Lookup(const mirror::ArtMethod* method) const {
+  const Entry* entries = entries_;
+  if (entries == NULL) {
+    return NULL;
+  }
+  // Pairs with the barrier publishing entries_.
+  android_memory_barrier();
+  size_t index = Hash(method);
+  for (size_t probe = 0; probe < kMaxProbes; ++probe, ++index) {
+    const Entry& entry = entries[index & (kCapacity - 1)];
+    const mirror::ArtMethod* entry_method = entry.method;
+    if (entry_method == NULL) {
+      return NULL;
+    }
+    if (entry_method == method) {
+      android_memory_barrier();
+      return entry.code_item;
+    }
+  }
+  return NULL;
+}
+
+DexFile::CodeItem* QuickenedCodeTable::FindOrCreateCopy(const mirror::ArtMethod* method) {
+  Entry* entries = entries_;
+  if (entries == NULL) {
+    entries = new Entry[kCapacity];
+    memset(entries, 0, sizeof(Entry) * kCapacity);
+    // Readers must see the cleared entries before the array.
+    android_memory_barrier();
+    entries_ = entries;
+  }
+  size_t index = Hash(method);
+  for (size_t probe = 0; probe < kMaxProbes; ++probe, ++index) {
+    Entry& entry = entries[index & (kCapacity - 1)];
+    if (entry.method == method) {
+      return entry.code_item;
+    }
+    if (entry.method == NULL) {
+      const DexFile::CodeItem* code_item = MethodHelper(method).GetCodeItem();
+      DCHECK(code_item != NULL);
+      size_t size = CodeItemSize(code_item);
+      // Allocated as words so that the instructions keep the alignment they have in the dex file.
+      uint32_t* copy = new uint32_t[RoundUp(size, sizeof(uint32_t)) / sizeof(uint32_t)];
+      memcpy(copy, code_item, size);
+      entry.code_item = reinterpret_cast<DexFile::CodeItem*>(copy);
+      android_memory_barrier();
+      entry.method = method;
+      return entry.code_item;
+    }
+  }
+  return NULL;
+}
+
+void QuickenedCodeTable::Quicken(Thread* self, const mirror::ArtMethod* method, uint32_t dex_pc,
+                                 uint16_t operand) {
+  // Invocations that started before the copy existed keep running the original code, don't take
+  // the lock again for each of their executions of the instruction.
+  const DexFile::CodeItem* quickened = Lookup(method);
+  if (quickened != NULL &&
+      GetQuickOpcode(Instruction::At(&quickened->insns_[dex_pc])->Opcode()) == Instruction::NOP) {
+    return;
+  }
+  MutexLock mu(self, lock_);
+  DexFile::CodeItem* code_item = FindOrCreateCopy(method);
+  if (code_item == NULL) {
+    return;
+  }
+  uint16_t* insns = &code_item->insns_[dex_pc];
+  DCHECK_ALIGNED(insns, sizeof(uint32_t));
+  Instruction::Code quick_opcode = GetQuickOpcode(Instruction::At(insns)->Opcode());
+  if (quick_opcode == Instruction::NOP) {
+    // Already quickened.
+    return;
+  }
+  const Instruction* next = Instruction::At(insns)->Next();
+  if (next->GetDexPc(code_item->insns_) < code_item->insns_size_in_code_units_) {
+    Instruction::Code fused_opcode = GetFusedOpcode(quick_opcode, next->Opcode());
+    if (fused_opcode != Instruction::NOP) {
+      quick_opcode = fused_opcode;
+    }
+  }
+  uint32_t units = (insns[0] & 0xff00) | quick_opcode | (static_cast<uint32_t>(operand) << 16);
+  *reinterpret_cast<volatile uint32_t*>(insns) = units;
+}
+
+}  // namespace interpreter
+}  // namespace art
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_INTERPRETER_QUICKENING_H_
+#define ART_RUNTIME_INTERPRETER_QUICKENING_H_
+
+#include <stdint.h>
+
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "dex_file.h"
+#include "dex_instruction.h"
+
+namespace art {
+
+namespace mirror {
+  class ArtMethod;
+}  // namespace mirror
+
+class Thread;
+
+namespace interpreter {
+
+// Writable copies of the code of interpreted methods in which the interpreter rewrites field
+// accesses and virtual invokes into their quick forms once they resolved, like the dex to dex
+// compiler does ahead of time. Only preverified methods are quickened since the quick forms skip
+// the checks. The interpreter switches to the copy on the next invocation of the method.
+//
+// A quickened instruction that is followed by an instruction it is often paired with becomes a
+// fused instruction instead, see GetFusedOpcode. The fused instruction keeps the format of the
+// first one and the second one is left as is, so it can still be a branch target. The interpreter
+// runs both with a single dispatch.
+//
+// Other threads may be executing a copy while it is rewritten, so only instructions aligned on 4
+// bytes are quickened, their opcode and operand are replaced with a single store. The copies of
+// all methods are found through one fixed size table, methods that don't fit are not quickened.
+// Lookups are lock free, quickening holds lock_.
+class QuickenedCodeTable {
+ public:
+  QuickenedCodeTable();
+  ~QuickenedCodeTable();
+
+  // Returns the quickened copy of the code of the method, or NULL if nothing was quickened yet.
+  const DexFile::CodeItem* Lookup(const mirror::ArtMethod* method) const;
+
+  // Rewrites the instruction at dex_pc in the copy of the code of the method into its quick form
+  // with the given field offset or vtable index. The instruction must have a quick form, see
+  // GetQuickOpcode, and be aligned on 4 bytes. Does nothing if it is already quickened.
+  // Fuses the instruction with the next one if GetFusedOpcode allows it.
+  void Quicken(Thread* self, const mirror::ArtMethod* method, uint32_t dex_pc, uint16_t operand)
+      LOCKS_EXCLUDED(lock_) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Returns the quick form of the opcode, or NOP if it has none.
+  static Instruction::Code GetQuickOpcode(Instruction::Code opcode) {
+    switch (opcode) {
+      case Instruction::IGET:
+        return Instruction::IGET_QUICK;
+      case Instruction::IGET_WIDE:
+        return Instruction::IGET_WIDE_QUICK;
+      case Instruction::IGET_OBJECT:
+        return Instruction::IGET_OBJECT_QUICK;
+      case Instruction::IPUT:
+      case Instruction::IPUT_BOOLEAN:
+      case Instruction::IPUT_BYTE:
+      case Instruction::IPUT_CHAR:
+      case Instruction::IPUT_SHORT:
+        // These have the same implementation in the interpreter.
+        return Instruction::IPUT_QUICK;
+      case Instruction::IPUT_WIDE:
+        return Instruction::IPUT_WIDE_QUICK;
+      case Instruction::IPUT_OBJECT:
+        return Instruction::IPUT_OBJECT_QUICK;
+      case Instruction::INVOKE_VIRTUAL:
+        return Instruction::INVOKE_VIRTUAL_QUICK;
+      case Instruction::INVOKE_VIRTUAL_RANGE:
+        return Instruction::INVOKE_VIRTUAL_RANGE_QUICK;
+      default:
+        return Instruction::NOP;
+    }
+  }
+
+  // Returns the fused form of a quick opcode followed by next_opcode, or NOP if there is none.
+  // Only pairs whose second instruction can't throw are fused, so a fused instruction throws
+  // from the dex pc of its first instruction.
+  static Instruction::Code GetFusedOpcode(Instruction::Code quick_opcode,
+                                          Instruction::Code next_opcode) {
+    switch (quick_opcode) {
+      case Instruction::IGET_QUICK:
+      case Instruction::IGET_OBJECT_QUICK:
+        if (next_opcode < Instruction::IF_EQZ || next_opcode > Instruction::IF_LEZ) {
+          return Instruction::NOP;
+        }
+        return quick_opcode == Instruction::IGET_QUICK ? Instruction::IGET_QUICK_IF_TESTZ
+                                                       : Instruction::IGET_OBJECT_QUICK_IF_TESTZ;
+      case Instruction::INVOKE_VIRTUAL_QUICK:
+      case Instruction::INVOKE_VIRTUAL_RANGE_QUICK:
+        if (next_opcode != Instruction::MOVE_RESULT &&
+            next_opcode != Instruction::MOVE_RESULT_WIDE &&
+            next_opcode != Instruction::MOVE_RESULT_OBJECT) {
+          return Instruction::NOP;
+        }
+        return quick_opcode == Instruction::INVOKE_VIRTUAL_QUICK
+            ? Instruction::INVOKE_VIRTUAL_QUICK_MOVE_RESULT
+            : Instruction::INVOKE_VIRTUAL_RANGE_QUICK_MOVE_RESULT;
+      default:
+        return Instruction::NOP;
+    }
+  }
+
+ private:
+  struct Entry {
+    // NULL while unused, published after code_item.
+    const mirror::ArtMethod* volatile method;
+    DexFile::CodeItem* code_item;
+  };
+
+  static const size_t kCapacity = 4096;
+  static const size_t kMaxProbes = 16;
+
+  static size_t Hash(const mirror::ArtMethod* method) {
+    return reinterpret_cast<uintptr_t>(method) >> 3;
+  }
+
+  // Returns the copy of the code of the method, creating it if needed. Returns NULL if the table
+  // is full.
+  DexFile::CodeItem* FindOrCreateCopy(const mirror::ArtMethod* method)
+      EXCLUSIVE_LOCKS_REQUIRED(lock_) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  Entry* volatile entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(QuickenedCodeTable);
+};
+
+}  // namespace interpreter
+}  // namespace art
+
+#endif  // ART_RUNTIME_INTERPRETER_QUICKENING_H_
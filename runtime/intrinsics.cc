@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "intrinsics.h"
+
+#include <string.h>
+
+#include <string>
+
+#include "base/macros.h"
+#include "dex_file-inl.h"
+
+namespace art {
+
+struct IntrinsicMethod {
+  const char* class_descriptor;
+  const char* name;
+  const char* signature;
+  Intrinsic intrinsic;
+};
+
+static const IntrinsicMethod kIntrinsicMethods[] = {
+  { "Ljava/lang/Double;", "doubleToRawLongBits", "(D)J", kIntrinsicDoubleToRawLongBits },
+  { "Ljava/lang/Double;", "longBitsToDouble", "(J)D", kIntrinsicLongBitsToDouble },
+  { "Ljava/lang/Float;", "floatToRawIntBits", "(F)I", kIntrinsicFloatToRawIntBits },
+  { "Ljava/lang/Float;", "intBitsToFloat", "(I)F", kIntrinsicIntBitsToFloat },
+  { "Ljava/lang/Math;", "abs", "(I)I", kIntrinsicAbsInt },
+  { "Ljava/lang/Math;", "abs", "(J)J", kIntrinsicAbsLong },
+  { "Ljava/lang/Math;", "max", "(II)I", kIntrinsicMaxInt },
+  { "Ljava/lang/Math;", "min", "(II)I", kIntrinsicMinInt },
+  { "Ljava/lang/Math;", "sqrt", "(D)D", kIntrinsicSqrt },
+  { "Ljava/lang/StrictMath;", "abs", "(I)I", kIntrinsicAbsInt },
+  { "Ljava/lang/StrictMath;", "abs", "(J)J", kIntrinsicAbsLong },
+  { "Ljava/lang/StrictMath;", "max", "(II)I", kIntrinsicMaxInt },
+  { "Ljava/lang/StrictMath;", "min", "(II)I", kIntrinsicMinInt },
+  { "Ljava/lang/StrictMath;", "sqrt", "(D)D", kIntrinsicSqrt },
+  { "Ljava/lang/String;", "charAt", "(I)C", kIntrinsicStringCharAt },
+  { "Ljava/lang/String;", "compareTo", "(Ljava/lang/String;)I", kIntrinsicStringCompareTo },
+  { "Ljava/lang/String;", "equals", "(Ljava/lang/Object;)Z", kIntrinsicStringEquals },
+  { "Ljava/lang/String;", "isEmpty", "()Z", kIntrinsicStringIsEmpty },
+  { "Ljava/lang/String;", "indexOf", "(II)I", kIntrinsicStringIndexOfFrom },
+  { "Ljava/lang/String;", "indexOf", "(I)I", kIntrinsicStringIndexOf },
+  { "Ljava/lang/String;", "length", "()I", kIntrinsicStringLength },
+  { "Ljava/lang/Thread;", "currentThread", "()Ljava/lang/Thread;", kIntrinsicCurrentThread },
+  { "Lsun/misc/Unsafe;", "compareAndSwapInt", "(Ljava/lang/Object;JII)Z",
+    kIntrinsicUnsafeCasInt },
+  { "Lsun/misc/Unsafe;", "compareAndSwapObject",
+    "(Ljava/lang/Object;JLjava/lang/Object;Ljava/lang/Object;)Z", kIntrinsicUnsafeCasObject },
+  { "Lsun/misc/Unsafe;", "getInt", "(Ljava/lang/Object;J)I", kIntrinsicUnsafeGetInt },
+  { "Lsun/misc/Unsafe;", "getIntVolatile", "(Ljava/lang/Object;J)I",
+    kIntrinsicUnsafeGetIntVolatile },
+  { "Lsun/misc/Unsafe;", "putInt", "(Ljava/lang/Object;JI)V", kIntrinsicUnsafePutInt },
+  { "Lsun/misc/Unsafe;", "putIntVolatile", "(Ljava/lang/Object;JI)V",
+    kIntrinsicUnsafePutIntVolatile },
+  { "Lsun/misc/Unsafe;", "putOrderedInt", "(Ljava/lang/Object;JI)V",
+    kIntrinsicUnsafePutOrderedInt },
+  { "Lsun/misc/Unsafe;", "getLong", "(Ljava/lang/Object;J)J", kIntrinsicUnsafeGetLong },
+  { "Lsun/misc/Unsafe;", "getLongVolatile", "(Ljava/lang/Object;J)J",
+    kIntrinsicUnsafeGetLongVolatile },
+  { "Lsun/misc/Unsafe;", "putLong", "(Ljava/lang/Object;JJ)V", kIntrinsicUnsafePutLong },
+  { "Lsun/misc/Unsafe;", "putLongVolatile", "(Ljava/lang/Object;JJ)V",
+    kIntrinsicUnsafePutLongVolatile },
+  { "Lsun/misc/Unsafe;", "putOrderedLong", "(Ljava/lang/Object;JJ)V",
+    kIntrinsicUnsafePutOrderedLong },
+  { "Lsun/misc/Unsafe;", "getObject", "(Ljava/lang/Object;J)Ljava/lang/Object;",
+    kIntrinsicUnsafeGetObject },
+  { "Lsun/misc/Unsafe;", "getObjectVolatile", "(Ljava/lang/Object;J)Ljava/lang/Object;",
+    kIntrinsicUnsafeGetObjectVolatile },
+  { "Lsun/misc/Unsafe;", "putObject", "(Ljava/lang/Object;JLjava/lang/Object;)V",
+    kIntrinsicUnsafePutObject },
+  { "Lsun/misc/Unsafe;", "putObjectVolatile", "(Ljava/lang/Object;JLjava/lang/Object;)V",
+    kIntrinsicUnsafePutObjectVolatile },
+  { "Lsun/misc/Unsafe;", "putOrderedObject", "(Ljava/lang/Object;JLjava/lang/Object;)V",
+    kIntrinsicUnsafePutOrderedObject },
+};
+
+Intrinsic FindIntrinsic(const DexFile& dex_file, uint32_t method_idx) {
+  const DexFile::MethodId& method_id = dex_file.GetMethodId(method_idx);
+  const char* class_descriptor = dex_file.GetMethodDeclaringClassDescriptor(method_id);
+  // The name and signature are only looked at for the classes in the table.
+  const char* name = NULL;
+  std::string signature;
+  for (size_t i = 0; i < arraysize(kIntrinsicMethods); ++i) {
+    const IntrinsicMethod& method = kIntrinsicMethods[i];
+    if (strcmp(class_descriptor, method.class_descriptor) != 0) {
+      continue;
+    }
+    if (name == NULL) {
+      name = dex_file.GetMethodName(method_id);
+      signature = dex_file.GetMethodSignature(method_id);
+    }
+    if (strcmp(name, method.name) == 0 && signature == method.signature) {
+      return method.intrinsic;
+    }
+  }
+  return kIntrinsicNone;
+}
+
+}  // namespace art
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_INTRINSICS_H_
+#define ART_RUNTIME_INTRINSICS_H_
+
+#include <stdint.h>
+
+namespace art {
+
+class DexFile;
+
+// Core library methods that the quick backends (Mir2Lir::GenIntrinsic) and the interpreter
+// implement inline rather than calling. Boot class methods are tagged with theirs when loaded,
+// see mirror::ArtMethod::GetIntrinsic. Must fit in kAccIntrinsicBits.
+enum Intrinsic {
+  kIntrinsicNone = 0,
+  kIntrinsicDoubleToRawLongBits,
+  kIntrinsicLongBitsToDouble,
+  kIntrinsicFloatToRawIntBits,
+  kIntrinsicIntBitsToFloat,
+  kIntrinsicAbsInt,
+  kIntrinsicAbsLong,
+  kIntrinsicMaxInt,
+  kIntrinsicMinInt,
+  kIntrinsicSqrt,
+  kIntrinsicStringCharAt,
+  kIntrinsicStringCompareTo,
+  kIntrinsicStringEquals,
+  kIntrinsicStringIsEmpty,
+  kIntrinsicStringIndexOfFrom,
+  kIntrinsicStringIndexOf,
+  kIntrinsicStringLength,
+  kIntrinsicCurrentThread,
+  kIntrinsicUnsafeCasInt,
+  kIntrinsicUnsafeCasObject,
+  kIntrinsicUnsafeGetInt,
+  kIntrinsicUnsafeGetIntVolatile,
+  kIntrinsicUnsafePutInt,
+  kIntrinsicUnsafePutIntVolatile,
+  kIntrinsicUnsafePutOrderedInt,
+  kIntrinsicUnsafeGetLong,
+  kIntrinsicUnsafeGetLongVolatile,
+  kIntrinsicUnsafePutLong,
+  kIntrinsicUnsafePutLongVolatile,
+  kIntrinsicUnsafePutOrderedLong,
+  kIntrinsicUnsafeGetObject,
+  kIntrinsicUnsafeGetObjectVolatile,
+  kIntrinsicUnsafePutObject,
+  kIntrinsicUnsafePutObjectVolatile,
+  kIntrinsicUnsafePutOrderedObject,
+  kIntrinsicLast = kIntrinsicUnsafePutOrderedObject,
+};
+
+// Returns the intrinsic implementing the method, which doesn't need to be resolved, or
+// kIntrinsicNone. Cheap for methods of classes without intrinsics.
+Intrinsic FindIntrinsic(const DexFile& dex_file, uint32_t method_idx);
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_INTRINSICS_H_
@@ -28,6 +28,8 @@
 #include <stdint.h>
 #include <string.h>
 
+#include <map>
+
 struct iovec;
 
 namespace art {
@@ -289,6 +291,8 @@ struct JdwpState {
   void UnregisterEvent(JdwpEvent* pEvent)
       EXCLUSIVE_LOCKS_REQUIRED(event_list_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  void IndexEvent(JdwpEvent* pEvent) EXCLUSIVE_LOCKS_REQUIRED(event_list_lock_);
+  void UnindexEvent(JdwpEvent* pEvent) EXCLUSIVE_LOCKS_REQUIRED(event_list_lock_);
   void SendBufferedRequest(uint32_t type, const std::vector<iovec>& iov);
 
  public:  // TODO: fix privacy
@@ -328,6 +332,28 @@ struct JdwpState {
   JdwpEvent* event_list_ GUARDED_BY(event_list_lock_);
   int event_list_size_ GUARDED_BY(event_list_lock_);  // Number of elements in event_list_.
 
+  // The events of event_list_ indexed so that posting an event only looks at candidates. Events
+  // whose LocationOnly mod can be checked first are found by kind, method and dex pc, all others
+  // by kind alone.
+  struct EventLocationKey {
+    EventLocationKey(JdwpEventKind kind, const JdwpLocation& loc)
+        : kind(kind), method_id(loc.method_id), dex_pc(loc.dex_pc) {}
+    bool operator<(const EventLocationKey& rhs) const {
+      if (kind != rhs.kind) {
+        return kind < rhs.kind;
+      }
+      if (method_id != rhs.method_id) {
+        return method_id < rhs.method_id;
+      }
+      return dex_pc < rhs.dex_pc;
+    }
+    JdwpEventKind kind;
+    MethodId method_id;
+    uint64_t dex_pc;
+  };
+  std::multimap<JdwpEventKind, JdwpEvent*> events_by_kind_ GUARDED_BY(event_list_lock_);
+  std::multimap<EventLocationKey, JdwpEvent*> events_by_location_ GUARDED_BY(event_list_lock_);
+
   // Used to synchronize suspension of the event thread (to avoid receiving "resume"
   // events before the thread has finished suspending itself).
   Mutex event_thread_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
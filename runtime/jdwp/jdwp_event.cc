@@ -21,6 +21,8 @@
 #include <string.h>
 #include <unistd.h>
 
+#include <map>
+
 #include "base/logging.h"
 #include "base/stringprintf.h"
 #include "debugger.h"
@@ -180,10 +182,71 @@ JdwpError JdwpState::RegisterEvent(JdwpEvent* pEvent) {
   }
   event_list_ = pEvent;
   ++event_list_size_;
+  IndexEvent(pEvent);
 
   return ERR_NONE;
 }
 
+/*
+ * Returns the location events must be at to match, if that can be checked
+ * before any of the event's other mods.  A Count mod in front of the
+ * LocationOnly mod is decremented for events at any location, so such an
+ * event has to be seen for every location.
+ */
+static const JdwpLocation* GetIndexedLocation(const JdwpEvent* pEvent) {
+  for (int i = 0; i < pEvent->modCount; i++) {
+    const JdwpEventMod* pMod = &pEvent->mods[i];
+    if (pMod->modKind == MK_COUNT) {
+      return NULL;
+    }
+    if (pMod->modKind == MK_LOCATION_ONLY) {
+      return &pMod->locationOnly.loc;
+    }
+  }
+  return NULL;
+}
+
+/*
+ * Add an event to the index used by FindMatchingEvents.
+ */
+void JdwpState::IndexEvent(JdwpEvent* pEvent) {
+  const JdwpLocation* pLoc = GetIndexedLocation(pEvent);
+  if (pLoc != NULL) {
+    EventLocationKey key(pEvent->eventKind, *pLoc);
+    events_by_location_.insert(std::make_pair(key, pEvent));
+  } else {
+    events_by_kind_.insert(std::make_pair(pEvent->eventKind, pEvent));
+  }
+}
+
+/*
+ * Remove an event from the index used by FindMatchingEvents.
+ */
+void JdwpState::UnindexEvent(JdwpEvent* pEvent) {
+  const JdwpLocation* pLoc = GetIndexedLocation(pEvent);
+  if (pLoc != NULL) {
+    EventLocationKey key(pEvent->eventKind, *pLoc);
+    typedef std::multimap<EventLocationKey, JdwpEvent*>::iterator It;
+    std::pair<It, It> range = events_by_location_.equal_range(key);
+    for (It it = range.first; it != range.second; ++it) {
+      if (it->second == pEvent) {
+        events_by_location_.erase(it);
+        return;
+      }
+    }
+  } else {
+    typedef std::multimap<JdwpEventKind, JdwpEvent*>::iterator It;
+    std::pair<It, It> range = events_by_kind_.equal_range(pEvent->eventKind);
+    for (It it = range.first; it != range.second; ++it) {
+      if (it->second == pEvent) {
+        events_by_kind_.erase(it);
+        return;
+      }
+    }
+  }
+  LOG(FATAL) << "Event " << pEvent->requestId << " missing from the index";
+}
+
 /*
  * Remove an event from the list.  This will also remove the event from
  * any optimization tables, e.g. breakpoints.
@@ -193,6 +256,8 @@ JdwpError JdwpState::RegisterEvent(JdwpEvent* pEvent) {
  * Grab the eventLock before calling here.
  */
 void JdwpState::UnregisterEvent(JdwpEvent* pEvent) {
+  UnindexEvent(pEvent);
+
   if (pEvent->prev == NULL) {
     /* head of the list */
     CHECK(event_list_ == pEvent);
@@ -225,6 +290,7 @@ void JdwpState::UnregisterEvent(JdwpEvent* pEvent) {
 
   --event_list_size_;
   CHECK(event_list_size_ != 0 || event_list_ == NULL);
+  CHECK(event_list_size_ != 0 || (events_by_kind_.empty() && events_by_location_.empty()));
 }
 
 /*
@@ -451,6 +517,10 @@ static bool ModsMatch(JdwpEvent* pEvent, ModBasket* basket)
  * Found events are appended to "match_list", and "*pMatchCount" is advanced,
  * so this may be called multiple times for grouped events.
  *
+ * Only the events of the right kind are looked at, and of those that must be
+ * at a particular location only the ones at the basket's location, so the
+ * cost doesn't grow with the number of breakpoints set elsewhere.
+ *
  * DO NOT call this multiple times for the same eventKind, as Count mods are
  * decremented during the scan.
  */
@@ -459,14 +529,27 @@ void JdwpState::FindMatchingEvents(JdwpEventKind eventKind, ModBasket* basket,
   /* start after the existing entries */
   match_list += *pMatchCount;
 
-  JdwpEvent* pEvent = event_list_;
-  while (pEvent != NULL) {
-    if (pEvent->eventKind == eventKind && ModsMatch(pEvent, basket)) {
+  typedef std::multimap<JdwpEventKind, JdwpEvent*>::iterator KindIt;
+  std::pair<KindIt, KindIt> kind_range = events_by_kind_.equal_range(eventKind);
+  for (KindIt it = kind_range.first; it != kind_range.second; ++it) {
+    JdwpEvent* pEvent = it->second;
+    if (ModsMatch(pEvent, basket)) {
       *match_list++ = pEvent;
       (*pMatchCount)++;
     }
+  }
 
-    pEvent = pEvent->next;
+  if (basket->pLoc != NULL) {
+    typedef std::multimap<EventLocationKey, JdwpEvent*>::iterator LocationIt;
+    std::pair<LocationIt, LocationIt> location_range =
+        events_by_location_.equal_range(EventLocationKey(eventKind, *basket->pLoc));
+    for (LocationIt it = location_range.first; it != location_range.second; ++it) {
+      JdwpEvent* pEvent = it->second;
+      if (ModsMatch(pEvent, basket)) {
+        *match_list++ = pEvent;
+        (*pMatchCount)++;
+      }
+    }
   }
 }
 
@@ -1741,6 +1741,9 @@ void JdwpState::ProcessRequest(Request& request, ExpandBuf* pReply) {
 
   /* tell the VM that GC is okay again */
   self->TransitionFromRunnableToSuspended(old_state);
+
+  /* switch the methods that gained or lost breakpoints */
+  Dbg::ManageDeoptimization();
 }
 
 }  // namespace JDWP
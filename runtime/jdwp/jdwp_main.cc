@@ -326,6 +326,8 @@ void JdwpState::ResetState() {
   {
     MutexLock mu(Thread::Current(), event_list_lock_);
     CHECK(event_list_ == NULL);
+    CHECK(events_by_kind_.empty());
+    CHECK(events_by_location_.empty());
   }
 
   /*
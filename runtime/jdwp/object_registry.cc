@@ -16,6 +16,9 @@
 
 #include "object_registry.h"
 
+#include "base/stl_util.h"
+#include "jni_internal.h"
+#include "runtime.h"
 #include "scoped_thread_state_change.h"
 
 namespace art {
@@ -26,12 +29,18 @@ std::ostream& operator<<(std::ostream& os, const ObjectRegistryEntry& rhs) {
   os << "ObjectRegistryEntry[" << rhs.jni_reference_type
      << ",reference=" << rhs.jni_reference
      << ",count=" << rhs.reference_count
-     << ",id=" << rhs.id << "]";
+     << ",id=" << rhs.id
+     << ",hash=" << rhs.identity_hash_code << "]";
   return os;
 }
 
 ObjectRegistry::ObjectRegistry()
-    : lock_("ObjectRegistry lock", kJdwpObjectRegistryLock), next_id_(1) {
+    : lock_("ObjectRegistry lock", kJdwpObjectRegistryLock), allow_new_objects_(true),
+      new_object_condition_("ObjectRegistry disallow condition", lock_), next_id_(1) {
+}
+
+ObjectRegistry::~ObjectRegistry() {
+  STLDeleteValues(&id_to_entry_);
 }
 
 JDWP::RefTypeId ObjectRegistry::AddRefType(mirror::Class* c) {
@@ -42,68 +51,90 @@ JDWP::ObjectId ObjectRegistry::Add(mirror::Object* o) {
   return InternalAdd(o);
 }
 
+void ObjectRegistry::WaitForNewObjectsAllowed(Thread* self) {
+  while (UNLIKELY(!allow_new_objects_)) {
+    new_object_condition_.WaitHoldingLocks(self);
+  }
+}
+
+ObjectRegistryEntry* ObjectRegistry::FindEntry(mirror::Object* o) {
+  std::pair<object_iterator, object_iterator> range =
+      object_to_entry_.equal_range(o->IdentityHashCode());
+  for (object_iterator it = range.first; it != range.second; ++it) {
+    if (it->second->object == o) {
+      return it->second;
+    }
+  }
+  return NULL;
+}
+
+void ObjectRegistry::RemoveFromObjectIndex(ObjectRegistryEntry* entry) {
+  std::pair<object_iterator, object_iterator> range =
+      object_to_entry_.equal_range(entry->identity_hash_code);
+  for (object_iterator it = range.first; it != range.second; ++it) {
+    if (it->second == entry) {
+      object_to_entry_.erase(it);
+      return;
+    }
+  }
+}
+
 JDWP::ObjectId ObjectRegistry::InternalAdd(mirror::Object* o) {
   if (o == NULL) {
     return 0;
   }
 
-  ScopedObjectAccessUnchecked soa(Thread::Current());
-  MutexLock mu(soa.Self(), lock_);
-  ObjectRegistryEntry dummy;
-  dummy.jni_reference_type = JNIWeakGlobalRefType;
-  dummy.jni_reference = NULL;
-  dummy.reference_count = 0;
-  dummy.id = 0;
-  std::pair<object_iterator, bool> result = object_to_entry_.insert(std::make_pair(o, dummy));
-  ObjectRegistryEntry& entry = result.first->second;
-  if (!result.second) {
+  Thread* self = Thread::Current();
+  MutexLock mu(self, lock_);
+  WaitForNewObjectsAllowed(self);
+  ObjectRegistryEntry* entry = FindEntry(o);
+  if (entry != NULL) {
     // This object was already in our map.
-    entry.reference_count += 1;
-    return entry.id;
+    entry->reference_count += 1;
+    return entry->id;
   }
 
-  // This object isn't in the registry yet, so add it.
-  JNIEnv* env = soa.Env();
-
-  jobject local_reference = soa.AddLocalReference<jobject>(o);
-
-  entry.jni_reference_type = JNIWeakGlobalRefType;
-  entry.jni_reference = env->NewWeakGlobalRef(local_reference);
-  entry.reference_count = 1;
-  entry.id = next_id_++;
+  // This object isn't in the registry yet, so add it. The weak global reference is made
+  // directly rather than through a local reference and JNI.
+  entry = new ObjectRegistryEntry;
+  entry->jni_reference_type = JNIWeakGlobalRefType;
+  entry->jni_reference = Runtime::Current()->GetJavaVM()->AddWeakGlobalReference(self, o);
+  entry->reference_count = 1;
+  entry->id = next_id_++;
+  entry->object = o;
+  entry->identity_hash_code = o->IdentityHashCode();
 
-  id_to_entry_.Put(entry.id, &entry);
+  object_to_entry_.insert(std::make_pair(entry->identity_hash_code, entry));
+  id_to_entry_.Put(entry->id, entry);
 
-  env->DeleteLocalRef(local_reference);
-
-  return entry.id;
+  return entry->id;
 }
 
 bool ObjectRegistry::Contains(mirror::Object* o) {
   Thread* self = Thread::Current();
   MutexLock mu(self, lock_);
-  return (object_to_entry_.find(o) != object_to_entry_.end());
+  return FindEntry(o) != NULL;
 }
 
 void ObjectRegistry::Clear() {
   Thread* self = Thread::Current();
   MutexLock mu(self, lock_);
-  VLOG(jdwp) << "Object registry contained " << object_to_entry_.size() << " entries";
+  VLOG(jdwp) << "Object registry contained " << id_to_entry_.size() << " entries";
 
   // Delete all the JNI references.
-  JNIEnv* env = self->GetJniEnv();
-  for (object_iterator it = object_to_entry_.begin(); it != object_to_entry_.end(); ++it) {
-    ObjectRegistryEntry& entry = (it->second);
-    if (entry.jni_reference_type == JNIWeakGlobalRefType) {
-      env->DeleteWeakGlobalRef(entry.jni_reference);
+  JavaVMExt* vm = Runtime::Current()->GetJavaVM();
+  for (id_iterator it = id_to_entry_.begin(); it != id_to_entry_.end(); ++it) {
+    ObjectRegistryEntry* entry = it->second;
+    if (entry->jni_reference_type == JNIWeakGlobalRefType) {
+      vm->DeleteWeakGlobalRef(self, entry->jni_reference);
     } else {
-      env->DeleteGlobalRef(entry.jni_reference);
+      vm->DeleteGlobalRef(self, entry->jni_reference);
     }
   }
 
   // Clear the maps.
   object_to_entry_.clear();
-  id_to_entry_.clear();
+  STLDeleteValues(&id_to_entry_);
 }
 
 mirror::Object* ObjectRegistry::InternalGet(JDWP::ObjectId id) {
@@ -113,8 +144,9 @@ mirror::Object* ObjectRegistry::InternalGet(JDWP::ObjectId id) {
   if (it == id_to_entry_.end()) {
     return kInvalidObject;
   }
-  ObjectRegistryEntry& entry = *(it->second);
-  return self->DecodeJObject(entry.jni_reference);
+  // Objects don't move and swept entries have no object, so there's no reference to decode.
+  WaitForNewObjectsAllowed(self);
+  return it->second->object;
 }
 
 jobject ObjectRegistry::GetJObject(JDWP::ObjectId id) {
@@ -133,6 +165,7 @@ void ObjectRegistry::DisableCollection(JDWP::ObjectId id) {
   if (it == id_to_entry_.end()) {
     return;
   }
+  WaitForNewObjectsAllowed(self);
   Promote(*(it->second));
 }
 
@@ -143,28 +176,30 @@ void ObjectRegistry::EnableCollection(JDWP::ObjectId id) {
   if (it == id_to_entry_.end()) {
     return;
   }
+  WaitForNewObjectsAllowed(self);
   Demote(*(it->second));
 }
 
 void ObjectRegistry::Demote(ObjectRegistryEntry& entry) {
   if (entry.jni_reference_type == JNIGlobalRefType) {
     Thread* self = Thread::Current();
-    JNIEnv* env = self->GetJniEnv();
+    JavaVMExt* vm = Runtime::Current()->GetJavaVM();
     jobject global = entry.jni_reference;
-    entry.jni_reference = env->NewWeakGlobalRef(entry.jni_reference);
+    entry.jni_reference = vm->AddWeakGlobalReference(self, entry.object);
     entry.jni_reference_type = JNIWeakGlobalRefType;
-    env->DeleteGlobalRef(global);
+    vm->DeleteGlobalRef(self, global);
   }
 }
 
 void ObjectRegistry::Promote(ObjectRegistryEntry& entry) {
-  if (entry.jni_reference_type == JNIWeakGlobalRefType) {
+  // A collected object stays collected.
+  if (entry.jni_reference_type == JNIWeakGlobalRefType && entry.object != NULL) {
     Thread* self = Thread::Current();
-    JNIEnv* env = self->GetJniEnv();
+    JavaVMExt* vm = Runtime::Current()->GetJavaVM();
     jobject weak = entry.jni_reference;
-    entry.jni_reference = env->NewGlobalRef(entry.jni_reference);
+    entry.jni_reference = vm->AddGlobalReference(self, entry.object);
     entry.jni_reference_type = JNIGlobalRefType;
-    env->DeleteWeakGlobalRef(weak);
+    vm->DeleteWeakGlobalRef(self, weak);
   }
 }
 
@@ -176,13 +211,8 @@ bool ObjectRegistry::IsCollected(JDWP::ObjectId id) {
     return true;  // TODO: can we report that this was an invalid id?
   }
 
-  ObjectRegistryEntry& entry = *(it->second);
-  if (entry.jni_reference_type == JNIWeakGlobalRefType) {
-    JNIEnv* env = self->GetJniEnv();
-    return env->IsSameObject(entry.jni_reference, NULL);  // Has the jweak been collected?
-  } else {
-    return false;  // We hold a strong reference, so we know this is live.
-  }
+  // Weak entries lose their object when the GC sweeps it; strong entries keep theirs live.
+  return it->second->object == NULL;
 }
 
 void ObjectRegistry::DisposeObject(JDWP::ObjectId id, uint32_t reference_count) {
@@ -193,19 +223,49 @@ void ObjectRegistry::DisposeObject(JDWP::ObjectId id, uint32_t reference_count)
     return;
   }
 
-  ObjectRegistryEntry& entry = *(it->second);
-  entry.reference_count -= reference_count;
-  if (entry.reference_count <= 0) {
-    JNIEnv* env = self->GetJniEnv();
-    mirror::Object* object = self->DecodeJObject(entry.jni_reference);
-    if (entry.jni_reference_type == JNIWeakGlobalRefType) {
-      env->DeleteWeakGlobalRef(entry.jni_reference);
+  ObjectRegistryEntry* entry = it->second;
+  entry->reference_count -= reference_count;
+  if (entry->reference_count <= 0) {
+    JavaVMExt* vm = Runtime::Current()->GetJavaVM();
+    if (entry->jni_reference_type == JNIWeakGlobalRefType) {
+      vm->DeleteWeakGlobalRef(self, entry->jni_reference);
     } else {
-      env->DeleteGlobalRef(entry.jni_reference);
+      vm->DeleteGlobalRef(self, entry->jni_reference);
     }
-    object_to_entry_.erase(object);
-    id_to_entry_.erase(id);
+    // Swept entries already left the object index.
+    if (entry->object != NULL) {
+      RemoveFromObjectIndex(entry);
+    }
+    id_to_entry_.erase(it);
+    delete entry;
   }
 }
 
+void ObjectRegistry::SweepObjectRegistry(IsMarkedTester is_marked, void* arg) {
+  MutexLock mu(Thread::Current(), lock_);
+  object_iterator it = object_to_entry_.begin();
+  while (it != object_to_entry_.end()) {
+    ObjectRegistryEntry* entry = it->second;
+    if (entry->jni_reference_type == JNIWeakGlobalRefType && !is_marked(entry->object, arg)) {
+      // The entry keeps its id until the debugger disposes of it, but the object is gone.
+      entry->object = NULL;
+      object_to_entry_.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void ObjectRegistry::DisallowNewObjects() {
+  MutexLock mu(Thread::Current(), lock_);
+  allow_new_objects_ = false;
+}
+
+void ObjectRegistry::AllowNewObjects() {
+  Thread* self = Thread::Current();
+  MutexLock mu(self, lock_);
+  allow_new_objects_ = true;
+  new_object_condition_.Broadcast(self);
+}
+
 }  // namespace art
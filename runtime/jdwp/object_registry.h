@@ -26,6 +26,7 @@
 #include "mirror/class.h"
 #include "mirror/class-inl.h"
 #include "mirror/object-inl.h"
+#include "root_visitor.h"
 #include "safe_map.h"
 
 namespace art {
@@ -42,6 +43,13 @@ struct ObjectRegistryEntry {
 
   // The corresponding id, so we only need one map lookup in Add.
   JDWP::ObjectId id;
+
+  // The object, or NULL once the GC has swept it. Objects don't move, so the object can be
+  // compared against without decoding jni_reference.
+  mirror::Object* object;
+
+  // The identity hash code of the object, the key of the entry in object_to_entry_.
+  int32_t identity_hash_code;
 };
 std::ostream& operator<<(std::ostream& os, const ObjectRegistryEntry& rhs);
 
@@ -53,6 +61,7 @@ std::ostream& operator<<(std::ostream& os, const ObjectRegistryEntry& rhs);
 class ObjectRegistry {
  public:
   ObjectRegistry();
+  ~ObjectRegistry();
 
   JDWP::ObjectId Add(mirror::Object* o) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   JDWP::RefTypeId AddRefType(mirror::Class* c) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -76,6 +85,15 @@ class ObjectRegistry {
   void DisposeObject(JDWP::ObjectId id, uint32_t reference_count)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Drops the entries of the weakly held objects that the GC didn't mark from the object index,
+  // so that Add and Contains never see them and IsCollected needn't decode their references.
+  void SweepObjectRegistry(IsMarkedTester is_marked, void* arg)
+      SHARED_LOCKS_REQUIRED(Locks::heap_bitmap_lock_);
+  // Between marking and sweeping, objects can't be registered or decoded: an unmarked object
+  // found in the registry could be resurrected, and a new entry could be swept.
+  void DisallowNewObjects() EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
+  void AllowNewObjects() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   // Returned by Get when passed an invalid object id.
   static mirror::Object* const kInvalidObject;
 
@@ -89,11 +107,21 @@ class ObjectRegistry {
   void Demote(ObjectRegistryEntry& entry) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_, lock_);
   void Promote(ObjectRegistryEntry& entry) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_, lock_);
 
+  ObjectRegistryEntry* FindEntry(mirror::Object* o) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  void RemoveFromObjectIndex(ObjectRegistryEntry* entry) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  void WaitForNewObjectsAllowed(Thread* self) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
   Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  bool allow_new_objects_ GUARDED_BY(lock_);
+  ConditionVariable new_object_condition_ GUARDED_BY(lock_);
 
-  typedef std::map<mirror::Object*, ObjectRegistryEntry>::iterator object_iterator;
-  std::map<mirror::Object*, ObjectRegistryEntry> object_to_entry_ GUARDED_BY(lock_);
+  // The entries of the live objects, keyed by identity hash code. Entries with equal hash codes
+  // are told apart by their object.
+  typedef std::multimap<int32_t, ObjectRegistryEntry*>::iterator object_iterator;
+  std::multimap<int32_t, ObjectRegistryEntry*> object_to_entry_ GUARDED_BY(lock_);
 
+  // Every entry, including those of collected objects until the debugger disposes of them. The
+  // entries are owned by this map.
   typedef SafeMap<JDWP::ObjectId, ObjectRegistryEntry*>::iterator id_iterator;
   SafeMap<JDWP::ObjectId, ObjectRegistryEntry*> id_to_entry_ GUARDED_BY(lock_);
 
@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jit.h"
+
+#include <dlfcn.h>
+#include <string.h>
+
+#include "base/logging.h"
+#include "cutils/atomic-inline.h"
+#include "interpreter/inline_cache.h"
+#include "mirror/art_method-inl.h"
+#include "object_utils.h"
+#include "profile_file.h"
+#include "runtime.h"
+#include "scoped_thread_state_change.h"
+#include "thread.h"
+#include "thread_list.h"
+#include "thread_pool.h"
+#include "utils.h"
+
+namespace art {
+namespace jit {
+
+class JitCompileTask : public Task {
+ public:
+  JitCompileTask(Jit* jit, mirror::ArtMethod* method) : jit_(jit), method_(method) {}
+
+  virtual void Run(Thread* self) {
+    if (!jit_->compilation_cancelled_) {
+      jit_->CompileMethod(self, method_);
+    }
+  }
+
+  virtual void Finalize() {
+    delete this;
+  }
+
+ private:
+  Jit* const jit_;
+  mirror::ArtMethod* const method_;
+};
+
+// Owns the profile thread until the thread pool is deleted.
+class JitProfileTask : public Task {
+ public:
+  explicit JitProfileTask(Jit* jit) : jit_(jit) {}
+
+  virtual void Run(Thread* self) {
+    jit_->SaveProfilePeriodically(self);
+  }
+
+  virtual void Finalize() {
+    delete this;
+  }
+
+ private:
+  Jit* const jit_;
+};
+
+void* Jit::LoadCompiler(CompileMethodFn* compile_method, DeleteCompilerFn* delete_compiler) {
+  const char* library = kIsDebugBuild ? "libartd-compiler.so" : "libart-compiler.so";
+  // Like the libraries loaded by System.loadLibrary the compiler is never unloaded.
+  void* handle = dlopen(library, RTLD_NOW);
+  if (handle == NULL) {
+    LOG(WARNING) << "Not compiling hot methods, failed to load " << library << ": " << dlerror();
+    return NULL;
+  }
+  CreateCompilerFn create_compiler =
+      reinterpret_cast<CreateCompilerFn>(dlsym(handle, "ArtJitCreateCompiler"));
+  CompileMethodFn compile_method_fn =
+      reinterpret_cast<CompileMethodFn>(dlsym(handle, "ArtJitCompileMethod"));
+  DeleteCompilerFn delete_compiler_fn =
+      reinterpret_cast<DeleteCompilerFn>(dlsym(handle, "ArtJitDeleteCompiler"));
+  if (create_compiler == NULL || compile_method_fn == NULL || delete_compiler_fn == NULL) {
+    LOG(WARNING) << "Not compiling hot methods, " << library << " has no JIT entry points";
+    return NULL;
+  }
+  void* compiler = create_compiler();
+  if (compiler == NULL) {
+    LOG(WARNING) << "Not compiling hot methods, failed to create the compiler";
+    return NULL;
+  }
+  *compile_method = compile_method_fn;
+  *delete_compiler = delete_compiler_fn;
+  return compiler;
+}
+
+Jit* Jit::Create(size_t compile_threshold, const std::string& profile_file,
+                 uint32_t profile_period_s) {
+  void* compiler = NULL;
+  CompileMethodFn compile_method = NULL;
+  DeleteCompilerFn delete_compiler = NULL;
+  if (compile_threshold != 0) {
+    compiler = LoadCompiler(&compile_method, &delete_compiler);
+    if (compiler == NULL && profile_file.empty()) {
+      return NULL;
+    }
+  }
+  return new Jit(compile_threshold, compiler, compile_method, delete_compiler, profile_file,
+                 profile_period_s);
+}
+
+Jit::Jit(size_t compile_threshold, void* compiler, CompileMethodFn compile_method,
+         DeleteCompilerFn delete_compiler, const std::string& profile_file,
+         uint32_t profile_period_s)
+    : compile_threshold_(compile_threshold),
+      compiler_(compiler),
+      compile_method_(compile_method),
+      delete_compiler_(delete_compiler),
+      profile_file_(profile_file),
+      profile_period_s_(profile_period_s),
+      lock_("jit lock"),
+      compilation_cancelled_(false),
+      profile_lock_("jit profile lock"),
+      profile_cond_("jit profile condition variable", profile_lock_) {
+  COMPILE_ASSERT((kCapacity & (kCapacity - 1)) == 0, capacity_must_be_a_power_of_two);
+  CHECK(compiler_ != NULL || !profile_file_.empty());
+  CHECK(compiler_ == NULL || compile_threshold_ > 0);
+  CHECK_GT(profile_period_s_, 0U);
+  memset(entries_, 0, sizeof(entries_));
+}
+
+Jit::~Jit() {
+  CHECK(thread_pool_.get() == NULL);
+  if (compiler_ != NULL) {
+    delete_compiler_(compiler_);
+  }
+}
+
+void Jit::CreateThreadPool() {
+  Thread* self = Thread::Current();
+  CHECK(thread_pool_.get() == NULL);
+  const bool profiling = !profile_file_.empty();
+  // One thread compiles and one writes the profile, which sleeps most of the time.
+  ThreadPool* thread_pool = new ThreadPool((CanCompile() ? 1 : 0) + (profiling ? 1 : 0));
+  if (profiling) {
+    thread_pool->AddTask(self, new JitProfileTask(this));
+  }
+  thread_pool->StartWorkers(self);
+  thread_pool_.reset(thread_pool);
+}
+
+void Jit::DeleteThreadPool() {
+  if (thread_pool_.get() == NULL) {
+    return;
+  }
+  Thread* self = Thread::Current();
+  compilation_cancelled_ = true;
+  ScopedThreadStateChange tsc(self, kNative);
+  {
+    MutexLock mu(self, profile_lock_);
+    profile_cond_.Signal(self);
+  }
+  // The queued methods return right away, the profile thread returns once it wrote the profile.
+  thread_pool_->Wait(self, false, false);
+  // Methods are queued with a share of the mutator lock, once all threads are suspended none of
+  // them is about to use the thread pool.
+  ThreadList* thread_list = Runtime::Current()->GetThreadList();
+  thread_list->SuspendAll();
+  UniquePtr<ThreadPool> thread_pool(thread_pool_.release());
+  thread_list->ResumeAll();
+}
+
+Jit::Entry* Jit::FindOrCreateEntry(Thread* self, mirror::ArtMethod* method) {
+  size_t index = Hash(method);
+  for (size_t probe = 0; probe < kMaxProbes; ++probe, ++index) {
+    Entry& entry = entries_[index & (kCapacity - 1)];
+    mirror::ArtMethod* entry_method = entry.method;
+    if (entry_method == method) {
+      return &entry;
+    }
+    if (entry_method == NULL) {
+      MutexLock mu(self, lock_);
+      // Another thread may have claimed the entry, for this method or another.
+      if (entry.method == NULL) {
+        entry.method = method;
+      }
+      if (entry.method == method) {
+        return &entry;
+      }
+    }
+  }
+  return NULL;
+}
+
+void Jit::AddSamples(Thread* self, mirror::ArtMethod* method, uint32_t count) {
+  ThreadPool* thread_pool = thread_pool_.get();
+  if (thread_pool == NULL) {
+    return;
+  }
+  Entry* entry = FindOrCreateEntry(self, method);
+  if (entry == NULL || entry->samples >= kMaxSamples) {
+    return;
+  }
+  int32_t samples = android_atomic_add(count, &entry->samples);
+  // Only the thread that crosses the threshold queues the method.
+  if (CanCompile() && samples < compile_threshold_ &&
+      samples + static_cast<int32_t>(count) >= compile_threshold_) {
+    thread_pool->AddTask(self, new JitCompileTask(this, method));
+  }
+}
+
+void Jit::CompileMethod(Thread* self, mirror::ArtMethod* method) {
+  uint64_t start_ns = NanoTime();
+  bool compiled;
+  {
+    ScopedPerfCounters spc(self, kPerfPhaseCompile);
+    compiled = compile_method_(compiler_, self, method);
+  }
+  if (VLOG_IS_ON(compiler)) {
+    ScopedObjectAccess soa(self);
+    VLOG(compiler) << (compiled ? "Compiled " : "Failed to compile ") << PrettyMethod(method)
+                   << " in " << PrettyDuration(NanoTime() - start_ns);
+  }
+}
+
+void Jit::SaveProfilePeriodically(Thread* self) {
+  while (!compilation_cancelled_) {
+    {
+      MutexLock mu(self, profile_lock_);
+      if (!compilation_cancelled_) {
+        profile_cond_.TimedWait(self, static_cast<int64_t>(profile_period_s_) * 1000, 0);
+      }
+    }
+    SaveProfile(self);
+  }
+}
+
+static void AddCallSite(const mirror::ArtMethod* caller, uint32_t dex_pc,
+                        mirror::Class* const* classes, size_t num_classes, void* arg)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  ProfileFile* profile = reinterpret_cast<ProfileFile*>(arg);
+  std::vector<std::string> descriptors;
+  for (size_t i = 0; i < num_classes; ++i) {
+    descriptors.push_back(ClassHelper(classes[i]).GetDescriptor());
+  }
+  profile->AddReceivers(PrettyMethod(caller), dex_pc, descriptors);
+}
+
+void Jit::SaveProfile(Thread* self) {
+  uint64_t start_ns = NanoTime();
+  ProfileFile profile;
+  {
+    ScopedObjectAccess soa(self);
+    for (size_t i = 0; i < kCapacity; ++i) {
+      mirror::ArtMethod* method = entries_[i].method;
+      int32_t samples = entries_[i].samples;
+      if (method == NULL || samples == 0) {
+        continue;
+      }
+      profile.AddMethod(PrettyMethod(method), samples);
+      profile.AddClass(ClassHelper(method->GetDeclaringClass()).GetDescriptor());
+    }
+    Runtime::Current()->GetInterpreterInlineCaches()->VisitCallSites(AddCallSite, &profile);
+  }
+  if (profile.Write(profile_file_)) {
+    VLOG(compiler) << "Wrote profile " << profile_file_ << " in "
+                   << PrettyDuration(NanoTime() - start_ns);
+  }
+}
+
+}  // namespace jit
+}  // namespace art
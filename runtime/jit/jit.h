@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_JIT_JIT_H_
+#define ART_RUNTIME_JIT_JIT_H_
+
+#include <stdint.h>
+
+#include <string>
+
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "UniquePtr.h"
+
+namespace art {
+
+namespace mirror {
+  class ArtMethod;
+}  // namespace mirror
+
+class Thread;
+class ThreadPool;
+
+namespace jit {
+
+// Compiles the methods the interpreter spends its time in with the quick compiler, loaded from
+// libart-compiler.so, so that they stop being interpreted. The interpreter adds a sample for each
+// invocation and backward branch of a method, once the samples of a method reach the threshold it
+// is compiled on a background thread and its entry points are switched to the code.
+//
+// With a profile file, the samples and the receiver classes of the interpreter's inline caches
+// are also written there periodically for dex2oat, see ProfileFile. The compiler is only loaded
+// when the compile threshold isn't zero.
+//
+// Samples are counted in a fixed size table, methods that don't fit are never compiled. Counting
+// is lock free, claiming an entry for a method holds lock_.
+class Jit {
+ public:
+  // Returns NULL if the compiler is needed but can't be loaded.
+  static Jit* Create(size_t compile_threshold, const std::string& profile_file,
+                     uint32_t profile_period_s);
+
+  ~Jit();
+
+  size_t GetCompileThreshold() const {
+    return compile_threshold_;
+  }
+
+  // Whether methods are compiled, as opposed to only profiled.
+  bool CanCompile() const {
+    return compiler_ != NULL;
+  }
+
+  // Adds count samples to the method, queuing it for compilation when they reach the threshold.
+  // Does nothing until the thread pool is created.
+  void AddSamples(Thread* self, mirror::ArtMethod* method, uint32_t count)
+      LOCKS_EXCLUDED(lock_) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Starts the compiler and profile threads, not done in the zygote which has to stay single
+  // threaded.
+  void CreateThreadPool() LOCKS_EXCLUDED(lock_);
+
+  // Stops the threads once the compilation in progress, if any, finishes and the profile is
+  // written a last time. Queued methods are dropped.
+  void DeleteThreadPool() LOCKS_EXCLUDED(lock_, profile_lock_);
+
+ private:
+  typedef void* (*CreateCompilerFn)();
+  typedef bool (*CompileMethodFn)(void* compiler, Thread* self, mirror::ArtMethod* method);
+  typedef void (*DeleteCompilerFn)(void* compiler);
+
+  struct Entry {
+    // NULL while unused.
+    mirror::ArtMethod* volatile method;
+    volatile int32_t samples;
+  };
+
+  static const size_t kCapacity = 4096;
+  static const size_t kMaxProbes = 16;
+  // Counting stops there so that the samples don't wrap around.
+  static const int32_t kMaxSamples = 1 << 30;
+
+  Jit(size_t compile_threshold, void* compiler, CompileMethodFn compile_method,
+      DeleteCompilerFn delete_compiler, const std::string& profile_file,
+      uint32_t profile_period_s);
+
+  // Returns the compiler state or NULL if the compiler can't be loaded.
+  static void* LoadCompiler(CompileMethodFn* compile_method, DeleteCompilerFn* delete_compiler);
+
+  static size_t Hash(const mirror::ArtMethod* method) {
+    return reinterpret_cast<uintptr_t>(method) >> 3;
+  }
+
+  // Returns the entry of the method, claiming one if needed. Returns NULL if the table is full.
+  Entry* FindOrCreateEntry(Thread* self, mirror::ArtMethod* method) LOCKS_EXCLUDED(lock_);
+
+  // Called on the compiler thread.
+  void CompileMethod(Thread* self, mirror::ArtMethod* method) LOCKS_EXCLUDED(lock_);
+
+  // Runs on the profile thread until the thread pool is deleted.
+  void SaveProfilePeriodically(Thread* self) LOCKS_EXCLUDED(profile_lock_);
+  void SaveProfile(Thread* self) LOCKS_EXCLUDED(Locks::mutator_lock_);
+
+  const int32_t compile_threshold_;
+
+  // Opaque state of the compiler library and its entry points, NULL when only profiling.
+  void* const compiler_;
+  const CompileMethodFn compile_method_;
+  const DeleteCompilerFn delete_compiler_;
+
+  // Empty when not profiling.
+  const std::string profile_file_;
+  const uint32_t profile_period_s_;
+
+  Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  UniquePtr<ThreadPool> thread_pool_;
+  // Set while the thread pool is deleted so that the queued methods aren't compiled and the
+  // profile thread stops.
+  volatile bool compilation_cancelled_;
+
+  Mutex profile_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  ConditionVariable profile_cond_ GUARDED_BY(profile_lock_);
+
+  Entry entries_[kCapacity];
+
+  friend class JitCompileTask;
+  friend class JitProfileTask;
+
+  DISALLOW_COPY_AND_ASSIGN(Jit);
+};
+
+}  // namespace jit
+}  // namespace art
+
+#endif  // ART_RUNTIME_JIT_JIT_H_
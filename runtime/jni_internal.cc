@@ -28,6 +28,7 @@
 #include "base/stringpiece.h"
 #include "class_linker.h"
 #include "dex_file-inl.h"
+#include "elf_file.h"
 #include "gc/accounting/card_table-inl.h"
 #include "interpreter/interpreter.h"
 #include "invoke_arg_array_builder.h"
@@ -40,6 +41,7 @@
 #include "mirror/object_array-inl.h"
 #include "mirror/throwable.h"
 #include "object_utils.h"
+#include "os.h"
 #include "runtime.h"
 #include "safe_map.h"
 #include "scoped_thread_state_change.h"
@@ -78,6 +80,9 @@ static const size_t kLocalsMax = 512;  // Arbitrary sanity check.
 static const size_t kPinTableInitial = 16;  // Arbitrary.
 static const size_t kPinTableMax = 1024;  // Arbitrary sanity check.
 
+static const size_t kCriticalPinsInitial = 4;  // Arbitrary.
+static const size_t kCriticalPinsMax = 1024;  // Arbitrary sanity check.
+
 static size_t gGlobalsInitial = 512;  // Arbitrary.
 static size_t gGlobalsMax = 51200;  // Arbitrary sanity check. (Must fit in 16 bits.)
 
@@ -452,6 +457,7 @@ class SharedLibrary {
         jni_on_load_cond_("JNI_OnLoad condition variable", jni_on_load_lock_),
         jni_on_load_thread_id_(Thread::Current()->GetThinLockId()),
         jni_on_load_result_(kPending) {
+    IndexJniSymbols();
   }
 
   Object* GetClassLoader() {
@@ -510,6 +516,13 @@ class SharedLibrary {
     return dlsym(handle_, symbol_name.c_str());
   }
 
+  // Looks the JNI function up in the index of the library's own exports. Returns NULL if it isn't
+  // there, FindSymbol may still find it in one of the library's dependencies.
+  void* FindIndexedJniSymbol(const std::string& symbol_name) {
+    auto it = jni_symbols_.find(symbol_name);
+    return (it == jni_symbols_.end()) ? NULL : it->second;
+  }
+
  private:
   enum JNI_OnLoadState {
     kPending,
@@ -517,6 +530,49 @@ class SharedLibrary {
     kOkay,
   };
 
+  // Reads the dynamic symbol table of the library once, recording the address of every exported
+  // "Java_" function, so that resolving native methods doesn't dlsym each candidate name in each
+  // library. The load address comes from a dlsym of the first such function. Leaves the index
+  // empty if the file can't be read.
+  void IndexJniSymbols() {
+    UniquePtr<File> file(OS::OpenFileForReading(path_.c_str()));
+    if (file.get() == NULL) {
+      return;
+    }
+    UniquePtr<ElfFile> elf_file(ElfFile::Open(file.get(), false, false));
+    if (elf_file.get() == NULL) {
+      return;
+    }
+    llvm::ELF::Elf32_Shdr* dynsym = elf_file->FindSectionByType(llvm::ELF::SHT_DYNSYM);
+    if (dynsym == NULL) {
+      return;
+    }
+    llvm::ELF::Elf32_Shdr& dynstr = elf_file->GetSectionHeader(dynsym->sh_link);
+    uintptr_t load_bias = 0;
+    bool have_load_bias = false;
+    for (uint32_t i = 0; i < elf_file->GetSymbolNum(*dynsym); ++i) {
+      llvm::ELF::Elf32_Sym& symbol = elf_file->GetSymbol(llvm::ELF::SHT_DYNSYM, i);
+      if (symbol.st_shndx == llvm::ELF::SHN_UNDEF || symbol.getType() != llvm::ELF::STT_FUNC) {
+        continue;
+      }
+      const char* name = elf_file->GetString(dynstr, symbol.st_name);
+      if (name == NULL || strncmp(name, "Java_", 5) != 0) {
+        continue;
+      }
+      if (!have_load_bias) {
+        void* address = dlsym(handle_, name);
+        if (address == NULL) {
+          jni_symbols_.clear();
+          return;
+        }
+        load_bias = reinterpret_cast<uintptr_t>(address) - symbol.st_value;
+        have_load_bias = true;
+      }
+      jni_symbols_.Put(name, reinterpret_cast<void*>(load_bias + symbol.st_value));
+    }
+    VLOG(jni) << "[Indexed " << jni_symbols_.size() << " JNI functions of \"" << path_ << "\"]";
+  }
+
   // Path to library "/system/lib/libjni.so".
   std::string path_;
 
@@ -534,6 +590,9 @@ class SharedLibrary {
   uint32_t jni_on_load_thread_id_ GUARDED_BY(jni_on_load_lock_);
   // Result of earlier JNI_OnLoad call.
   JNI_OnLoadState jni_on_load_result_ GUARDED_BY(jni_on_load_lock_);
+
+  // The exported JNI functions of the library by name, filled in by the constructor.
+  SafeMap<std::string, void*> jni_symbols_;
 };
 
 // This exists mainly to keep implementation details out of the header file.
@@ -576,6 +635,23 @@ class Libraries {
     std::string jni_short_name(JniShortName(m));
     std::string jni_long_name(JniLongName(m));
     const ClassLoader* declaring_class_loader = m->GetDeclaringClass()->GetClassLoader();
+    // Look in the indexes of the libraries' own exports first, a map lookup each.
+    for (const auto& lib : libraries_) {
+      SharedLibrary* library = lib.second;
+      if (library->GetClassLoader() != declaring_class_loader) {
+        continue;
+      }
+      void* fn = library->FindIndexedJniSymbol(jni_short_name);
+      if (fn == NULL) {
+        fn = library->FindIndexedJniSymbol(jni_long_name);
+      }
+      if (fn != NULL) {
+        VLOG(jni) << "[Found native code for " << PrettyMethod(m)
+                  << " in \"" << library->GetPath() << "\"]";
+        return fn;
+      }
+    }
+    // Then let dlsym search the libraries and their dependencies.
     for (const auto& lib : libraries_) {
       SharedLibrary* library = lib.second;
       if (library->GetClassLoader() != declaring_class_loader) {
@@ -835,12 +911,7 @@ class JNI {
       return NULL;
     }
     ScopedObjectAccess soa(env);
-    JavaVMExt* vm = soa.Vm();
-    IndirectReferenceTable& globals = vm->globals;
-    Object* decoded_obj = soa.Decode<Object*>(obj);
-    WriterMutexLock mu(soa.Self(), vm->globals_lock);
-    IndirectRef ref = globals.Add(IRT_FIRST_SEGMENT, decoded_obj);
-    return reinterpret_cast<jobject>(ref);
+    return soa.Vm()->AddGlobalReference(soa.Self(), soa.Decode<Object*>(obj));
   }
 
   static void DeleteGlobalRef(JNIEnv* env, jobject obj) {
@@ -848,14 +919,7 @@ class JNI {
       return;
     }
     JavaVMExt* vm = reinterpret_cast<JNIEnvExt*>(env)->vm;
-    IndirectReferenceTable& globals = vm->globals;
-    Thread* self = reinterpret_cast<JNIEnvExt*>(env)->self;
-    WriterMutexLock mu(self, vm->globals_lock);
-
-    if (!globals.Remove(IRT_FIRST_SEGMENT, obj)) {
-      LOG(WARNING) << "JNI WARNING: DeleteGlobalRef(" << obj << ") "
-                   << "failed to find entry";
-    }
+    vm->DeleteGlobalRef(reinterpret_cast<JNIEnvExt*>(env)->self, obj);
   }
 
   static jweak NewWeakGlobalRef(JNIEnv* env, jobject obj) {
@@ -2014,11 +2078,21 @@ class JNI {
   }
 
   static const jchar* GetStringCritical(JNIEnv* env, jstring java_string, jboolean* is_copy) {
-    return GetStringChars(env, java_string, is_copy);
+    CHECK_NON_NULL_ARGUMENT(GetStringCritical, java_string);
+    ScopedObjectAccess soa(env);
+    String* s = soa.Decode<String*>(java_string);
+    const CharArray* chars = s->GetCharArray();
+    soa.Env()->critical_pins.Add(chars);
+    if (is_copy != NULL) {
+      *is_copy = JNI_FALSE;
+    }
+    return chars->GetData() + s->GetOffset();
   }
 
-  static void ReleaseStringCritical(JNIEnv* env, jstring java_string, const jchar* chars) {
-    return ReleaseStringChars(env, java_string, chars);
+  static void ReleaseStringCritical(JNIEnv* env, jstring java_string, const jchar*) {
+    CHECK_NON_NULL_ARGUMENT(ReleaseStringCritical, java_string);
+    ScopedObjectAccess soa(env);
+    soa.Env()->critical_pins.Remove(soa.Decode<String*>(java_string)->GetCharArray());
   }
 
   static const char* GetStringUTFChars(JNIEnv* env, jstring java_string, jboolean* is_copy) {
@@ -2145,16 +2219,19 @@ class JNI {
     CHECK_NON_NULL_ARGUMENT(GetPrimitiveArrayCritical, java_array);
     ScopedObjectAccess soa(env);
     Array* array = soa.Decode<Array*>(java_array);
-    PinPrimitiveArray(soa, array);
+    soa.Env()->critical_pins.Add(array);
     if (is_copy != NULL) {
       *is_copy = JNI_FALSE;
     }
     return array->GetRawData(array->GetClass()->GetComponentSize());
   }
 
-  static void ReleasePrimitiveArrayCritical(JNIEnv* env, jarray array, void*, jint mode) {
-    CHECK_NON_NULL_ARGUMENT(ReleasePrimitiveArrayCritical, array);
-    ReleasePrimitiveArray(env, array, mode);
+  static void ReleasePrimitiveArrayCritical(JNIEnv* env, jarray java_array, void*, jint mode) {
+    CHECK_NON_NULL_ARGUMENT(ReleasePrimitiveArrayCritical, java_array);
+    if (mode != JNI_COMMIT) {
+      ScopedObjectAccess soa(env);
+      soa.Env()->critical_pins.Remove(soa.Decode<Array*>(java_array));
+    }
   }
 
   static jboolean* GetBooleanArrayElements(JNIEnv* env, jbooleanArray array, jboolean* is_copy) {
@@ -2357,8 +2434,10 @@ class JNI {
       const char* name = methods[i].name;
       const char* sig = methods[i].signature;
 
+      // A leading '!' marks a fast native, see ArtMethod::IsFastNative.
+      bool is_fast = false;
       if (*sig == '!') {
-        // TODO: fast jni. it's too noisy to log all these.
+        is_fast = true;
         ++sig;
       }
 
@@ -2379,8 +2458,14 @@ class JNI {
         return JNI_ERR;
       }
 
-      VLOG(jni) << "[Registering JNI native method " << PrettyMethod(m) << "]";
+      VLOG(jni) << "[Registering JNI " << (is_fast ? "fast " : "") << "native method "
+                << PrettyMethod(m) << "]";
 
+      if (is_fast) {
+        m->SetAccessFlags(m->GetAccessFlags() | kAccFastNative);
+      } else {
+        m->SetAccessFlags(m->GetAccessFlags() & ~kAccFastNative);
+      }
       m->RegisterNative(soa.Self(), methods[i].fnPtr);
     }
     return JNI_OK;
@@ -2394,8 +2479,9 @@ class JNI {
     VLOG(jni) << "[Unregistering JNI native methods for " << PrettyClass(c) << "]";
 
     for (size_t i = 0; i < c->NumDirectMethods(); ++i) {
-      ArtMethod* m = c->GetDirectMethod(i);
-      if (m->IsNative()) {
+      // A lazy method that isn't loaded yet has nothing registered.
+      ArtMethod* m = c->GetLoadedDirectMethod(i);
+      if (m != NULL && m->IsNative()) {
         m->UnregisterNative(soa.Self());
       }
     }
@@ -2838,8 +2924,10 @@ JNIEnvExt::JNIEnvExt(Thread* self, JavaVMExt* vm)
       local_ref_cookie(IRT_FIRST_SEGMENT),
       locals(kLocalsInitial, kLocalsMax, kLocal),
       check_jni(false),
+      check_jni_calls(0),
       critical(false),
-      monitors("monitors", kMonitorsInitial, kMonitorsMax) {
+      monitors("monitors", kMonitorsInitial, kMonitorsMax),
+      critical_pins("critical pins", kCriticalPinsInitial, kCriticalPinsMax) {
   functions = unchecked_functions = &gJniNativeInterface;
   if (vm->check_jni) {
     SetCheckJniEnabled(true);
@@ -2855,12 +2943,16 @@ JNIEnvExt::~JNIEnvExt() {
 
 void JNIEnvExt::SetCheckJniEnabled(bool enabled) {
   check_jni = enabled;
+  if (enabled) {
+    locals.EnableSerialChecks();
+  }
   functions = enabled ? GetCheckJniNativeInterface() : &gJniNativeInterface;
 }
 
 void JNIEnvExt::DumpReferenceTables(std::ostream& os) {
   locals.Dump(os);
   monitors.Dump(os);
+  critical_pins.Dump(os);
 }
 
 void JNIEnvExt::PushFrame(int /*capacity*/) {
@@ -2993,12 +3085,13 @@ JavaVMExt::JavaVMExt(Runtime* runtime, Runtime::ParsedOptions* options)
       check_jni_abort_hook_data(NULL),
       check_jni(false),
       force_copy(false),  // TODO: add a way to enable this
+      check_jni_lite(options->check_jni_lite_),
+      check_jni_sample_period(options->check_jni_sample_period_),
+      guarded_copies_lock("CheckJNI guarded copies lock"),
       trace(options->jni_trace_),
       work_around_app_jni_bugs(false),
       pins_lock("JNI pin table lock", kPinTableLock),
       pin_table("pin table", kPinTableInitial, kPinTableMax),
-      globals_lock("JNI global reference table lock"),
-      globals(gGlobalsInitial, gGlobalsMax, kGlobal),
       libraries_lock("JNI shared libraries map lock", kLoadLibraryLock),
       libraries(new Libraries),
       weak_globals_lock_("JNI weak global reference table lock"),
@@ -3009,12 +3102,40 @@ JavaVMExt::JavaVMExt(Runtime* runtime, Runtime::ParsedOptions* options)
   if (options->check_jni_) {
     SetCheckJniEnabled(true);
   }
+  for (size_t i = 0; i < kGlobalsShards; ++i) {
+    globals_locks_[i].reset(new ReaderWriterMutex("JNI global reference table lock"));
+    globals_[i].reset(new IndirectReferenceTable(gGlobalsInitial / kGlobalsShards, gGlobalsMax,
+                                                 kGlobal, i));
+  }
 }
 
 JavaVMExt::~JavaVMExt() {
   delete libraries;
 }
 
+jobject JavaVMExt::AddGlobalReference(Thread* self, mirror::Object* obj) {
+  size_t shard = self->GetThinLockId() % kGlobalsShards;
+  WriterMutexLock mu(self, *globals_locks_[shard]);
+  IndirectRef ref = globals_[shard]->Add(IRT_FIRST_SEGMENT, obj);
+  return reinterpret_cast<jobject>(ref);
+}
+
+void JavaVMExt::DeleteGlobalRef(Thread* self, jobject obj) {
+  // Any thread may delete the reference, the shard is the one of the thread that added it.
+  size_t shard = GetIndirectRefShard(obj);
+  WriterMutexLock mu(self, *globals_locks_[shard]);
+  if (!globals_[shard]->Remove(IRT_FIRST_SEGMENT, obj)) {
+    LOG(WARNING) << "JNI WARNING: DeleteGlobalRef(" << obj << ") "
+                 << "failed to find entry";
+  }
+}
+
+mirror::Object* JavaVMExt::DecodeGlobal(Thread* self, IndirectRef ref) {
+  size_t shard = GetIndirectRefShard(ref);
+  ReaderMutexLock mu(self, *globals_locks_[shard]);
+  return const_cast<mirror::Object*>(globals_[shard]->Get(ref));
+}
+
 jweak JavaVMExt::AddWeakGlobalReference(Thread* self, mirror::Object* obj) {
   if (obj == nullptr) {
     return nullptr;
@@ -3042,7 +3163,9 @@ void JavaVMExt::SetCheckJniEnabled(bool enabled) {
 
 void JavaVMExt::DumpForSigQuit(std::ostream& os) {
   os << "JNI: CheckJNI is " << (check_jni ? "on" : "off");
-  if (force_copy) {
+  if (check_jni && check_jni_lite) {
+    os << " (lite, sampling 1 in " << check_jni_sample_period << " calls)";
+  } else if (force_copy) {
     os << " (with forcecopy)";
   }
   os << "; workarounds are " << (work_around_app_jni_bugs ? "on" : "off");
@@ -3052,8 +3175,12 @@ void JavaVMExt::DumpForSigQuit(std::ostream& os) {
     os << "; pins=" << pin_table.Size();
   }
   {
-    ReaderMutexLock mu(self, globals_lock);
-    os << "; globals=" << globals.Capacity();
+    size_t globals_capacity = 0;
+    for (size_t i = 0; i < kGlobalsShards; ++i) {
+      ReaderMutexLock mu(self, *globals_locks_[i]);
+      globals_capacity += globals_[i]->Capacity();
+    }
+    os << "; globals=" << globals_capacity;
   }
   {
     MutexLock mu(self, weak_globals_lock_);
@@ -3100,9 +3227,9 @@ mirror::Object* JavaVMExt::DecodeWeakGlobal(Thread* self, IndirectRef ref) {
 
 void JavaVMExt::DumpReferenceTables(std::ostream& os) {
   Thread* self = Thread::Current();
-  {
-    ReaderMutexLock mu(self, globals_lock);
-    globals.Dump(os);
+  for (size_t i = 0; i < kGlobalsShards; ++i) {
+    ReaderMutexLock mu(self, *globals_locks_[i]);
+    globals_[i]->Dump(os);
   }
   {
     MutexLock mu(self, weak_globals_lock_);
@@ -3273,9 +3400,9 @@ void* JavaVMExt::FindCodeForNativeMethod(ArtMethod* m) {
 
 void JavaVMExt::VisitRoots(RootVisitor* visitor, void* arg) {
   Thread* self = Thread::Current();
-  {
-    ReaderMutexLock mu(self, globals_lock);
-    globals.VisitRoots(visitor, arg);
+  for (size_t i = 0; i < kGlobalsShards; ++i) {
+    ReaderMutexLock mu(self, *globals_locks_[i]);
+    globals_[i]->VisitRoots(visitor, arg);
   }
   {
     MutexLock mu(self, pins_lock);
@@ -3293,6 +3420,110 @@ void RegisterNativeMethods(JNIEnv* env, const char* jni_class_name, const JNINat
   JNI::RegisterNativeMethods(env, c.get(), methods, method_count, false);
 }
 
+JniFieldBatch* JniFieldBatch::Create(JNIEnv* env, jclass java_class, const char* const* names,
+                                     const char* const* sigs, size_t count, bool is_static) {
+  CHECK_NON_NULL_ARGUMENT(JniFieldBatch::Create, java_class);
+  ScopedObjectAccess soa(env);
+  UniquePtr<JniFieldBatch> batch(new JniFieldBatch(is_static));
+  batch->fields_.reserve(count);
+  batch->types_.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    jfieldID fid = FindFieldID(soa, java_class, names[i], sigs[i], is_static);
+    if (fid == NULL) {
+      return NULL;
+    }
+    batch->fields_.push_back(fid);
+    batch->types_.push_back(Primitive::GetType(sigs[i][0]));
+  }
+  return batch.release();
+}
+
+void JniFieldBatch::Get(JNIEnv* env, jobject java_object, jvalue* values) const {
+  if (!is_static_) {
+    CHECK_NON_NULL_ARGUMENT(JniFieldBatch::Get, java_object);
+  }
+  ScopedObjectAccess soa(env);
+  Object* o = is_static_ ? NULL : soa.Decode<Object*>(java_object);
+  for (size_t i = 0; i < fields_.size(); ++i) {
+    ArtField* f = soa.DecodeField(fields_[i]);
+    Object* holder = is_static_ ? f->GetDeclaringClass() : o;
+    switch (types_[i]) {
+      case Primitive::kPrimBoolean:
+        values[i].z = f->GetBoolean(holder);
+        break;
+      case Primitive::kPrimByte:
+        values[i].b = f->GetByte(holder);
+        break;
+      case Primitive::kPrimChar:
+        values[i].c = f->GetChar(holder);
+        break;
+      case Primitive::kPrimShort:
+        values[i].s = f->GetShort(holder);
+        break;
+      case Primitive::kPrimInt:
+        values[i].i = f->GetInt(holder);
+        break;
+      case Primitive::kPrimLong:
+        values[i].j = f->GetLong(holder);
+        break;
+      case Primitive::kPrimFloat:
+        values[i].f = f->GetFloat(holder);
+        break;
+      case Primitive::kPrimDouble:
+        values[i].d = f->GetDouble(holder);
+        break;
+      case Primitive::kPrimNot:
+        values[i].l = soa.AddLocalReference<jobject>(f->GetObject(holder));
+        break;
+      default:
+        LOG(FATAL) << "Unexpected field type " << types_[i];
+    }
+  }
+}
+
+void JniFieldBatch::Set(JNIEnv* env, jobject java_object, const jvalue* values) const {
+  if (!is_static_) {
+    CHECK_NON_NULL_ARGUMENT(JniFieldBatch::Set, java_object);
+  }
+  ScopedObjectAccess soa(env);
+  Object* o = is_static_ ? NULL : soa.Decode<Object*>(java_object);
+  for (size_t i = 0; i < fields_.size(); ++i) {
+    ArtField* f = soa.DecodeField(fields_[i]);
+    Object* holder = is_static_ ? f->GetDeclaringClass() : o;
+    switch (types_[i]) {
+      case Primitive::kPrimBoolean:
+        f->SetBoolean(holder, values[i].z);
+        break;
+      case Primitive::kPrimByte:
+        f->SetByte(holder, values[i].b);
+        break;
+      case Primitive::kPrimChar:
+        f->SetChar(holder, values[i].c);
+        break;
+      case Primitive::kPrimShort:
+        f->SetShort(holder, values[i].s);
+        break;
+      case Primitive::kPrimInt:
+        f->SetInt(holder, values[i].i);
+        break;
+      case Primitive::kPrimLong:
+        f->SetLong(holder, values[i].j);
+        break;
+      case Primitive::kPrimFloat:
+        f->SetFloat(holder, values[i].f);
+        break;
+      case Primitive::kPrimDouble:
+        f->SetDouble(holder, values[i].d);
+        break;
+      case Primitive::kPrimNot:
+        f->SetObject(holder, soa.Decode<Object*>(values[i].l));
+        break;
+      default:
+        LOG(FATAL) << "Unexpected field type " << types_[i];
+    }
+  }
+}
+
 }  // namespace art
 
 std::ostream& operator<<(std::ostream& os, const jobjectRefType& rhs) {
@@ -22,12 +22,16 @@
 #include "base/macros.h"
 #include "base/mutex.h"
 #include "indirect_reference_table.h"
+#include "primitive.h"
 #include "reference_table.h"
 #include "root_visitor.h"
 #include "runtime.h"
+#include "UniquePtr.h"
 
 #include <iosfwd>
+#include <set>
 #include <string>
+#include <vector>
 
 #ifndef NATIVE_METHOD
 #define NATIVE_METHOD(className, functionName, signature) \
@@ -59,6 +63,38 @@ void InvokeWithArgArray(const ScopedObjectAccess& soa, mirror::ArtMethod* method
                         ArgArray *arg_array, JValue* result, char result_type)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+// ART extension for natives copying many fields of an object at once, such as serializers. The
+// fields are looked up once, then each Get or Set copies all of them between an object and an
+// array of jvalues, in order, with one decode of the object and one thread state transition
+// instead of one per field.
+class JniFieldBatch {
+ public:
+  // Looks up the fields of the class as GetFieldID, or GetStaticFieldID, would. Returns NULL with
+  // an exception pending if one of them doesn't exist.
+  static JniFieldBatch* Create(JNIEnv* env, jclass java_class, const char* const* names,
+                               const char* const* sigs, size_t count, bool is_static);
+
+  // Reads the fields of the object, ignored for static fields, into values. Object fields are
+  // returned as local references.
+  void Get(JNIEnv* env, jobject java_object, jvalue* values) const;
+
+  // Writes values into the fields of the object, ignored for static fields.
+  void Set(JNIEnv* env, jobject java_object, const jvalue* values) const;
+
+  size_t Size() const {
+    return fields_.size();
+  }
+
+ private:
+  explicit JniFieldBatch(bool is_static) : is_static_(is_static) {}
+
+  const bool is_static_;
+  std::vector<jfieldID> fields_;
+  std::vector<Primitive::Type> types_;
+
+  DISALLOW_COPY_AND_ASSIGN(JniFieldBatch);
+};
+
 int ThrowNewException(JNIEnv* env, jclass exception_class, const char* msg, jobject cause);
 
 class JavaVMExt : public JavaVM {
@@ -92,6 +128,11 @@ class JavaVMExt : public JavaVM {
 
   void VisitRoots(RootVisitor*, void*);
 
+  jobject AddGlobalReference(Thread* self, mirror::Object* obj)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  void DeleteGlobalRef(Thread* self, jobject obj);
+  mirror::Object* DecodeGlobal(Thread* self, IndirectRef ref);
+
   void DisallowNewWeakGlobals() EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
   void AllowNewWeakGlobals() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   jweak AddWeakGlobalReference(Thread* self, mirror::Object* obj)
@@ -111,6 +152,17 @@ class JavaVMExt : public JavaVM {
   bool check_jni;
   bool force_copy;
 
+  // With check_jni, the cheap checks of references, threads and pending exceptions run on every
+  // call, but the expensive ones - guarded copies of arrays and strings and the validation of
+  // Modified UTF-8 strings - only on one in check_jni_sample_period calls of each thread.
+  bool check_jni_lite;
+  size_t check_jni_sample_period;
+
+  // The guarded copies made by sampled CheckJNI lite calls, which may be released by an
+  // unsampled call.
+  Mutex guarded_copies_lock DEFAULT_MUTEX_ACQUIRED_AFTER;
+  std::set<const void*> guarded_copies GUARDED_BY(guarded_copies_lock);
+
   // Extra diagnostics.
   std::string trace;
 
@@ -121,10 +173,6 @@ class JavaVMExt : public JavaVM {
   Mutex pins_lock DEFAULT_MUTEX_ACQUIRED_AFTER;
   ReferenceTable pin_table GUARDED_BY(pins_lock);
 
-  // JNI global references.
-  ReaderWriterMutex globals_lock DEFAULT_MUTEX_ACQUIRED_AFTER;
-  IndirectReferenceTable globals GUARDED_BY(globals_lock);
-
   Mutex libraries_lock DEFAULT_MUTEX_ACQUIRED_AFTER;
   Libraries* libraries GUARDED_BY(libraries_lock);
 
@@ -133,6 +181,13 @@ class JavaVMExt : public JavaVM {
 
  private:
   // TODO: Make the other members of this class also private.
+  // JNI global references, sharded by the thread adding them so that threads creating and deleting
+  // global references don't all serialize on one lock. Each table is guarded by the lock of the
+  // same index, the shard of a reference is encoded in it.
+  static const size_t kGlobalsShards = kIRTMaxShards;
+  UniquePtr<ReaderWriterMutex> globals_locks_[kGlobalsShards];
+  UniquePtr<IndirectReferenceTable> globals_[kGlobalsShards];
+
   // JNI weak global references.
   Mutex weak_globals_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   IndirectReferenceTable weak_globals_ GUARDED_BY(weak_globals_lock_);
@@ -179,12 +234,20 @@ struct JNIEnvExt : public JNIEnv {
   // Frequently-accessed fields cached from JavaVM.
   bool check_jni;
 
+  // The CheckJNI lite calls made on this thread, to pick the sampled ones.
+  uint32_t check_jni_calls;
+
   // How many nested "critical" JNI calls are we in?
   int critical;
 
   // Entered JNI monitors, for bulk exit on thread detach.
   ReferenceTable monitors;
 
+  // Arrays pinned by GetPrimitiveArrayCritical and GetStringCritical. Critical sections are
+  // released on the thread that entered them, in reverse order, so pinning is an append and
+  // unpinning a pop without any lock.
+  ReferenceTable critical_pins;
+
   // Used by -Xcheck:jni.
   const JNINativeInterface* unchecked_functions;
 };
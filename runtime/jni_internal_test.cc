@@ -1291,6 +1291,59 @@ TEST_F(JniInternalTest, GetStringUTFChars_ReleaseStringUTFChars) {
   env_->ReleaseStringUTFChars(s, utf);
 }
 
+TEST_F(JniInternalTest, CheckJniLite) {
+  bool check_jni_lite = vm_->check_jni_lite;
+  size_t check_jni_sample_period = vm_->check_jni_sample_period;
+  vm_->check_jni_lite = true;
+  reinterpret_cast<JNIEnvExt*>(env_)->check_jni_calls = 0;
+
+  // Unsampled calls still check references, but don't validate strings or copy buffers.
+  vm_->check_jni_sample_period = 1000000;
+  {
+    CheckJniAbortCatcher check_jni_abort_catcher;
+    EXPECT_TRUE(env_->GetStringUTFChars(NULL, NULL) == NULL);
+    check_jni_abort_catcher.Check("GetStringUTFChars received null jstring");
+  }
+  EXPECT_TRUE(env_->NewStringUTF("\x80" "abc") != NULL);
+  jintArray array = env_->NewIntArray(4);
+  ASSERT_TRUE(array != NULL);
+  jboolean is_copy = JNI_TRUE;
+  jint* elements = env_->GetIntArrayElements(array, &is_copy);
+  EXPECT_EQ(JNI_FALSE, is_copy);
+  env_->ReleaseIntArrayElements(array, elements, JNI_ABORT);
+
+  // Sampled calls do, and their guarded copies are recognized when unsampled calls release them.
+  vm_->check_jni_sample_period = 1;
+  {
+    CheckJniAbortCatcher check_jni_abort_catcher;
+    env_->NewStringUTF("\x80" "abc");
+    check_jni_abort_catcher.Check("illegal start byte 0x80");
+  }
+  jstring s = env_->NewStringUTF("hello");
+  ASSERT_TRUE(s != NULL);
+  is_copy = JNI_FALSE;
+  const char* utf = env_->GetStringUTFChars(s, &is_copy);
+  EXPECT_EQ(JNI_TRUE, is_copy);
+  EXPECT_STREQ("hello", utf);
+  is_copy = JNI_FALSE;
+  elements = env_->GetIntArrayElements(array, &is_copy);
+  EXPECT_EQ(JNI_TRUE, is_copy);
+  elements[0] = 42;
+  vm_->check_jni_sample_period = 1000000;
+  env_->ReleaseStringUTFChars(s, utf);
+  env_->ReleaseIntArrayElements(array, elements, 0);
+  {
+    MutexLock mu(Thread::Current(), vm_->guarded_copies_lock);
+    EXPECT_TRUE(vm_->guarded_copies.empty());
+  }
+  jint value = 0;
+  env_->GetIntArrayRegion(array, 0, 1, &value);
+  EXPECT_EQ(42, value);
+
+  vm_->check_jni_lite = check_jni_lite;
+  vm_->check_jni_sample_period = check_jni_sample_period;
+}
+
 TEST_F(JniInternalTest, GetStringChars_ReleaseStringChars) {
   jstring s = env_->NewStringUTF("hello");
   ASSERT_TRUE(s != NULL);
@@ -1320,13 +1373,16 @@ TEST_F(JniInternalTest, GetStringCritical_ReleaseStringCritical) {
   ASSERT_TRUE(s != NULL);
 
   jchar expected[] = { 'h', 'e', 'l', 'l', 'o' };
+  ReferenceTable& critical_pins = reinterpret_cast<JNIEnvExt*>(env_)->critical_pins;
   const jchar* chars = env_->GetStringCritical(s, NULL);
+  EXPECT_EQ(1U, critical_pins.Size());
   EXPECT_EQ(expected[0], chars[0]);
   EXPECT_EQ(expected[1], chars[1]);
   EXPECT_EQ(expected[2], chars[2]);
   EXPECT_EQ(expected[3], chars[3]);
   EXPECT_EQ(expected[4], chars[4]);
   env_->ReleaseStringCritical(s, chars);
+  EXPECT_EQ(0U, critical_pins.Size());
 
   jboolean is_copy = JNI_FALSE;
   chars = env_->GetStringCritical(s, &is_copy);
@@ -1414,6 +1470,49 @@ TEST_F(JniInternalTest, GetPrimitiveField_SetPrimitiveField) {
   EXPECT_PRIMITIVE_FIELD(o, Short, "iS", "S", 1, 2);
 }
 
+TEST_F(JniInternalTest, JniFieldBatch) {
+  Thread::Current()->TransitionFromSuspendedToRunnable();
+  LoadDex("AllFields");
+  runtime_->Start();
+
+  jclass c = env_->FindClass("AllFields");
+  ASSERT_TRUE(c != NULL);
+  jobject o = env_->AllocObject(c);
+  ASSERT_TRUE(o != NULL);
+
+  const char* names[] = { "iZ", "iI", "iJ", "iD", "iObject" };
+  const char* sigs[] = { "Z", "I", "J", "D", "Ljava/lang/Object;" };
+  UniquePtr<JniFieldBatch> batch(JniFieldBatch::Create(env_, c, names, sigs, 5, false));
+  ASSERT_TRUE(batch.get() != NULL);
+  EXPECT_EQ(5U, batch->Size());
+
+  jstring s = env_->NewStringUTF("hello");
+  jvalue values[5];
+  values[0].z = JNI_TRUE;
+  values[1].i = 42;
+  values[2].j = 0x123456789LL;
+  values[3].d = 2.5;
+  values[4].l = s;
+  batch->Set(env_, o, values);
+  EXPECT_EQ(42, env_->GetIntField(o, env_->GetFieldID(c, "iI", "I")));
+
+  jvalue read_values[5];
+  batch->Get(env_, o, read_values);
+  EXPECT_EQ(JNI_TRUE, read_values[0].z);
+  EXPECT_EQ(42, read_values[1].i);
+  EXPECT_EQ(0x123456789LL, read_values[2].j);
+  EXPECT_EQ(2.5, read_values[3].d);
+  EXPECT_TRUE(env_->IsSameObject(s, read_values[4].l));
+
+  // A missing field fails the whole batch.
+  jclass jlnsfe = env_->FindClass("java/lang/NoSuchFieldError");
+  ASSERT_TRUE(jlnsfe != NULL);
+  const char* bad_names[] = { "iI", "missing" };
+  const char* bad_sigs[] = { "I", "I" };
+  EXPECT_TRUE(JniFieldBatch::Create(env_, c, bad_names, bad_sigs, 2, false) == NULL);
+  EXPECT_EXCEPTION(jlnsfe);
+}
+
 TEST_F(JniInternalTest, GetObjectField_SetObjectField) {
   Thread::Current()->TransitionFromSuspendedToRunnable();
   LoadDex("AllFields");
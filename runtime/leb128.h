@@ -17,6 +17,7 @@
 #ifndef ART_RUNTIME_LEB128_H_
 #define ART_RUNTIME_LEB128_H_
 
+#include "base/macros.h"
 #include "globals.h"
 
 namespace art {
@@ -27,7 +28,8 @@ namespace art {
 static inline uint32_t DecodeUnsignedLeb128(const uint8_t** data) {
   const uint8_t* ptr = *data;
   int result = *(ptr++);
-  if (result > 0x7f) {
+  // Most values in dex files, such as index deltas and access flags, fit in one byte.
+  if (UNLIKELY(result > 0x7f)) {
     int cur = *(ptr++);
     result = (result & 0x7f) | ((cur & 0x7f) << 7);
     if (cur > 0x7f) {
@@ -63,7 +65,7 @@ static inline int32_t DecodeUnsignedLeb128P1(const uint8_t** data) {
 static inline int32_t DecodeSignedLeb128(const uint8_t** data) {
   const uint8_t* ptr = *data;
   int32_t result = *(ptr++);
-  if (result <= 0x7f) {
+  if (LIKELY(result <= 0x7f)) {
     result = (result << 25) >> 25;
   } else {
     int cur = *(ptr++);
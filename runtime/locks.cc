@@ -25,7 +25,7 @@ Mutex* Locks::breakpoint_lock_ = NULL;
 ReaderWriterMutex* Locks::classlinker_classes_lock_ = NULL;
 ReaderWriterMutex* Locks::heap_bitmap_lock_ = NULL;
 Mutex* Locks::logging_lock_ = NULL;
-ReaderWriterMutex* Locks::mutator_lock_ = NULL;
+MutatorMutex* Locks::mutator_lock_ = NULL;
 Mutex* Locks::runtime_shutdown_lock_ = NULL;
 Mutex* Locks::thread_list_lock_ = NULL;
 Mutex* Locks::thread_suspend_count_lock_ = NULL;
@@ -57,7 +57,7 @@ void Locks::Init() {
     DCHECK(heap_bitmap_lock_ == NULL);
     heap_bitmap_lock_ = new ReaderWriterMutex("heap bitmap lock", kHeapBitmapLock);
     DCHECK(mutator_lock_ == NULL);
-    mutator_lock_ = new ReaderWriterMutex("mutator lock", kMutatorLock);
+    mutator_lock_ = new MutatorMutex("mutator lock");
     DCHECK(runtime_shutdown_lock_ == NULL);
     runtime_shutdown_lock_ = new Mutex("runtime shutdown lock", kRuntimeShutdownLock);
     DCHECK(thread_list_lock_ == NULL);
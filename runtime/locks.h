@@ -24,6 +24,7 @@
 namespace art {
 
 class LOCKABLE Mutex;
+class LOCKABLE MutatorMutex;
 class LOCKABLE ReaderWriterMutex;
 
 // LockLevel is used to impose a lock hierarchy [1] where acquisition of a Mutex at a higher or
@@ -40,6 +41,7 @@ enum LockLevel {
   kAllocSpaceLock,
   kMarkSweepMarkStackLock,
   kDefaultMutexLevel,
+  kHprofLock,
   kMarkSweepLargeObjectLock,
   kPinTableLock,
   kLoadLibraryLock,
@@ -69,30 +71,35 @@ class Locks {
 
   // The mutator_lock_ is used to allow mutators to execute in a shared (reader) mode or to block
   // mutators by having an exclusive (writer) owner. In normal execution each mutator thread holds
-  // a share on the mutator_lock_. The garbage collector may also execute with shared access but
-  // at times requires exclusive access to the heap (not to be confused with the heap meta-data
-  // guarded by the heap_lock_ below). When the garbage collector requires exclusive access it asks
-  // the mutators to suspend themselves which also involves usage of the thread_suspend_count_lock_
-  // to cover weaknesses in using ReaderWriterMutexes with ConditionVariables. We use a condition
-  // variable to wait upon in the suspension logic as releasing and then re-acquiring a share on
-  // the mutator lock doesn't necessarily allow the exclusive user (e.g the garbage collector)
-  // chance to acquire the lock.
+  // a share on the mutator_lock_, implicitly by being in the kRunnable state: changing to and from
+  // kRunnable is a single CAS on the thread's state and flags and doesn't touch the lock. The
+  // garbage collector may also execute with explicit shared access but at times requires
+  // exclusive access to the heap (not to be confused with the heap meta-data guarded by the
+  // heap_lock_ below). When the garbage collector requires exclusive access it asks the mutators
+  // to suspend themselves which also involves usage of the thread_suspend_count_lock_. Setting
+  // the suspend request flag and changing to kRunnable are both atomic updates of the same word,
+  // so once the flag is set a thread either was already kRunnable, and will be waited for, or
+  // cannot become kRunnable until resumed.
   //
   // Thread suspension:
   // Shared users                                  | Exclusive user
-  // (holding mutator lock and in kRunnable state) |   .. running ..
+  // (in kRunnable state)                          |   .. running ..
   //   .. running ..                               | Request thread suspension by:
   //   .. running ..                               |   - acquiring thread_suspend_count_lock_
   //   .. running ..                               |   - incrementing Thread::suspend_count_ on
-  //   .. running ..                               |     all mutator threads
+  //   .. running ..                               |     all mutator threads, setting their
+  //   .. running ..                               |     suspend request flag
+  //   .. running ..                               |   - noting the threads that are kRunnable
   //   .. running ..                               |   - releasing thread_suspend_count_lock_
-  //   .. running ..                               | Block trying to acquire exclusive mutator lock
-  // Poll Thread::suspend_count_ and enter full    |   .. blocked ..
+  //   .. running ..                               | Wait on Thread::suspended_cond_ until the
+  // Poll Thread::suspend_count_ and enter full    | noted threads have left kRunnable
   // suspend code.                                 |   .. blocked ..
-  // Change state to kSuspended                    |   .. blocked ..
-  // x: Release share on mutator_lock_             | Carry out exclusive access
-  // Acquire thread_suspend_count_lock_            |   .. exclusive ..
-  // while Thread::suspend_count_ > 0              |   .. exclusive ..
+  // CAS state from kRunnable to kSuspended,       |   .. blocked ..
+  // releasing the implicit share                  |   .. blocked ..
+  // Seeing the suspend request flag, notify on    |   .. blocked ..
+  // Thread::suspended_cond_                       | Acquire exclusive mutator lock, waiting for
+  // x: Acquire thread_suspend_count_lock_         | explicit shared users
+  // while Thread::suspend_count_ > 0              | Carry out exclusive access
   //   - wait on Thread::resume_cond_              |   .. exclusive ..
   //     (releases thread_suspend_count_lock_)     |   .. exclusive ..
   //   .. waiting ..                               | Release mutator_lock_
@@ -103,29 +110,13 @@ class Locks {
   //   .. waiting ..                               |   - notifying on Thread::resume_cond_
   //    - re-acquire thread_suspend_count_lock_    |   - releasing thread_suspend_count_lock_
   // Release thread_suspend_count_lock_            |  .. running ..
-  // Acquire share on mutator_lock_                |  .. running ..
-  //  - This could block but the thread still      |  .. running ..
-  //    has a state of kSuspended and so this      |  .. running ..
-  //    isn't an issue.                            |  .. running ..
-  // Acquire thread_suspend_count_lock_            |  .. running ..
-  //  - we poll here as we're transitioning into   |  .. running ..
-  //    kRunnable and an individual thread suspend |  .. running ..
-  //    request (e.g for debugging) won't try      |  .. running ..
-  //    to acquire the mutator lock (which would   |  .. running ..
-  //    block as we hold the mutator lock). This   |  .. running ..
-  //    poll ensures that if the suspender thought |  .. running ..
-  //    we were suspended by incrementing our      |  .. running ..
-  //    Thread::suspend_count_ and then reading    |  .. running ..
-  //    our state we go back to waiting on         |  .. running ..
-  //    Thread::resume_cond_.                      |  .. running ..
-  // can_go_runnable = Thread::suspend_count_ == 0 |  .. running ..
-  // Release thread_suspend_count_lock_            |  .. running ..
-  // if can_go_runnable                            |  .. running ..
-  //   Change state to kRunnable                   |  .. running ..
-  // else                                          |  .. running ..
+  // CAS state from kSuspended to kRunnable if the |  .. running ..
+  // suspend request flag is clear, acquiring the  |  .. running ..
+  // implicit share                                |  .. running ..
+  // if the CAS failed                             |  .. running ..
   //   Goto x                                      |  .. running ..
   //  .. running ..                                |  .. running ..
-  static ReaderWriterMutex* mutator_lock_;
+  static MutatorMutex* mutator_lock_;
 
   // Allow reader-writer mutual exclusion on the mark and live bitmaps of the heap.
   static ReaderWriterMutex* heap_bitmap_lock_ ACQUIRED_AFTER(mutator_lock_);
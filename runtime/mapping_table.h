@@ -22,7 +22,11 @@
 
 namespace art {
 
-// A utility for processing the raw uleb128 encoded mapping table created by the quick compiler.
+// A utility for processing the encoded mapping table created by the quick compiler. After the
+// ULEB128 total and pc to dex entry counts come the pc to dex entries, then the dex to pc entries.
+// Each entry is the ULEB128 native pc offset and the SLEB128 dex pc, both as deltas from the
+// previous entry of its table, which makes most entries two bytes. The entries of each table are
+// in native pc order, so the native pc deltas are never negative.
 class MappingTable {
  public:
   explicit MappingTable(const uint8_t* encoded_map) : encoded_table_(encoded_map) {
@@ -54,8 +58,8 @@ class MappingTable {
       DecodeUnsignedLeb128(&table);  // Total_size, unused.
       uint32_t pc_to_dex_size = DecodeUnsignedLeb128(&table);
       for (uint32_t i = 0; i < pc_to_dex_size; ++i) {
-        DecodeUnsignedLeb128(&table);  // Move ptr past native PC.
-        DecodeUnsignedLeb128(&table);  // Move ptr past dex PC.
+        DecodeUnsignedLeb128(&table);  // Move ptr past native PC delta.
+        DecodeSignedLeb128(&table);  // Move ptr past dex PC delta.
       }
     }
     return table;
@@ -68,8 +72,8 @@ class MappingTable {
         native_pc_offset_(0), dex_pc_(0) {
       if (element == 0) {
         encoded_table_ptr_ = table_->FirstDexToPcPtr();
-        native_pc_offset_ = DecodeUnsignedLeb128(&encoded_table_ptr_);
-        dex_pc_ = DecodeUnsignedLeb128(&encoded_table_ptr_);
+        native_pc_offset_ += DecodeUnsignedLeb128(&encoded_table_ptr_);
+        dex_pc_ += DecodeSignedLeb128(&encoded_table_ptr_);
       } else {
         DCHECK_EQ(table_->DexToPcSize(), element);
       }
@@ -83,8 +87,8 @@ class MappingTable {
     void operator++() {
       ++element_;
       if (element_ != end_) {  // Avoid reading beyond the end of the table.
-        native_pc_offset_ = DecodeUnsignedLeb128(&encoded_table_ptr_);
-        dex_pc_ = DecodeUnsignedLeb128(&encoded_table_ptr_);
+        native_pc_offset_ += DecodeUnsignedLeb128(&encoded_table_ptr_);
+        dex_pc_ += DecodeSignedLeb128(&encoded_table_ptr_);
       }
     }
     bool operator==(const DexToPcIterator& rhs) const {
@@ -141,8 +145,8 @@ class MappingTable {
         native_pc_offset_(0), dex_pc_(0) {
       if (element == 0) {
         encoded_table_ptr_ = table_->FirstPcToDexPtr();
-        native_pc_offset_ = DecodeUnsignedLeb128(&encoded_table_ptr_);
-        dex_pc_ = DecodeUnsignedLeb128(&encoded_table_ptr_);
+        native_pc_offset_ += DecodeUnsignedLeb128(&encoded_table_ptr_);
+        dex_pc_ += DecodeSignedLeb128(&encoded_table_ptr_);
       } else {
         DCHECK_EQ(table_->PcToDexSize(), element);
       }
@@ -156,8 +160,8 @@ class MappingTable {
     void operator++() {
       ++element_;
       if (element_ != end_) {  // Avoid reading beyond the end of the table.
-        native_pc_offset_ = DecodeUnsignedLeb128(&encoded_table_ptr_);
-        dex_pc_ = DecodeUnsignedLeb128(&encoded_table_ptr_);
+        native_pc_offset_ += DecodeUnsignedLeb128(&encoded_table_ptr_);
+        dex_pc_ += DecodeSignedLeb128(&encoded_table_ptr_);
       }
     }
     bool operator==(const PcToDexIterator& rhs) const {
@@ -22,7 +22,10 @@
 #include "ScopedFd.h"
 #include "utils.h"
 
+// Off device ashmem regions are files in /tmp, which transparent huge pages do not apply to.
+#if defined(HAVE_ANDROID_OS)
 #define USE_ASHMEM 1
+#endif
 
 #ifdef USE_ASHMEM
 #include <cutils/ashmem.h>
@@ -192,4 +195,18 @@ bool MemMap::Protect(int prot) {
   return false;
 }
 
+bool MemMap::AdviseHugePages() {
+  if (base_begin_ == NULL && base_size_ == 0) {
+    return false;
+  }
+#if defined(MADV_HUGEPAGE)
+  if (madvise(base_begin_, base_size_, MADV_HUGEPAGE) == 0) {
+    return true;
+  }
+  PLOG(WARNING) << "madvise(" << reinterpret_cast<void*>(base_begin_) << ", " << base_size_
+                << ", MADV_HUGEPAGE) failed for " << name_;
+#endif
+  return false;
+}
+
 }  // namespace art
@@ -61,6 +61,10 @@ class MemMap {
 
   bool Protect(int prot);
 
+  // Asks the kernel to back the map with transparent huge pages. Only anonymous maps qualify, and
+  // kernels without transparent huge page support always fail.
+  bool AdviseHugePages();
+
   int GetProtect() const {
     return prot_;
   }
@@ -152,35 +152,43 @@ uintptr_t ArtMethod::NativePcOffset(const uintptr_t pc) const {
 
 uint32_t ArtMethod::ToDexPc(const uintptr_t pc) const {
 #if !defined(ART_USE_PORTABLE_COMPILER)
+  return NativePcOffsetToDexPc(NativePcOffset(pc));
+#else
+  // Compiler LLVM doesn't use the machine pc, we just use dex pc instead.
+  return static_cast<uint32_t>(pc);
+#endif
+}
+
+uint32_t ArtMethod::NativePcOffsetToDexPc(const uint32_t native_pc_offset) const {
   MappingTable table(GetMappingTable());
   if (table.TotalSize() == 0) {
     DCHECK(IsNative() || IsCalleeSaveMethod() || IsProxyMethod()) << PrettyMethod(this);
     return DexFile::kDexNoIndex;   // Special no mapping case
   }
-  const void* code = Runtime::Current()->GetInstrumentation()->GetQuickCodeFor(this);
-  uint32_t sought_offset = pc - reinterpret_cast<uintptr_t>(code);
-  // Assume the caller wants a pc-to-dex mapping so check here first.
+  // Assume the caller wants a pc-to-dex mapping so check here first. Both tables are in native pc
+  // order, so the search of each stops at the first entry past the sought offset.
   typedef MappingTable::PcToDexIterator It;
   for (It cur = table.PcToDexBegin(), end = table.PcToDexEnd(); cur != end; ++cur) {
-    if (cur.NativePcOffset() == sought_offset) {
+    if (cur.NativePcOffset() == native_pc_offset) {
       return cur.DexPc();
     }
+    if (cur.NativePcOffset() > native_pc_offset) {
+      break;
+    }
   }
   // Now check dex-to-pc mappings.
   typedef MappingTable::DexToPcIterator It2;
   for (It2 cur = table.DexToPcBegin(), end = table.DexToPcEnd(); cur != end; ++cur) {
-    if (cur.NativePcOffset() == sought_offset) {
+    if (cur.NativePcOffset() == native_pc_offset) {
       return cur.DexPc();
     }
+    if (cur.NativePcOffset() > native_pc_offset) {
+      break;
+    }
   }
-  LOG(FATAL) << "Failed to find Dex offset for PC offset " << reinterpret_cast<void*>(sought_offset)
-             << "(PC " << reinterpret_cast<void*>(pc) << ", code=" << code
-             << ") in " << PrettyMethod(this);
+  LOG(FATAL) << "Failed to find Dex offset for PC offset "
+             << reinterpret_cast<void*>(native_pc_offset) << " in " << PrettyMethod(this);
   return DexFile::kDexNoIndex;
-#else
-  // Compiler LLVM doesn't use the machine pc, we just use dex pc instead.
-  return static_cast<uint32_t>(pc);
-#endif
 }
 
 uintptr_t ArtMethod::ToNativePc(const uint32_t dex_pc) const {
@@ -211,11 +219,14 @@ uintptr_t ArtMethod::ToNativePc(const uint32_t dex_pc) const {
 }
 
 uint32_t ArtMethod::FindCatchBlock(Class* exception_type, uint32_t dex_pc,
-                                   bool* has_no_move_exception) const {
+                                   bool* has_no_move_exception, bool* types_resolved) const {
   MethodHelper mh(this);
   const DexFile::CodeItem* code_item = mh.GetCodeItem();
   // Default to handler not found.
   uint32_t found_dex_pc = DexFile::kDexNoIndex;
+  if (types_resolved != NULL) {
+    *types_resolved = true;
+  }
   // Iterate over the catch handlers associated with dex_pc.
   for (CatchHandlerIterator it(*code_item, dex_pc); it.HasNext(); it.Next()) {
     uint16_t iter_type_idx = it.GetHandlerTypeIndex();
@@ -230,6 +241,9 @@ uint32_t ArtMethod::FindCatchBlock(Class* exception_type, uint32_t dex_pc,
       // The verifier should take care of resolving all exception classes early
       LOG(WARNING) << "Unresolved exception class when finding catch block: "
         << mh.GetTypeDescriptorFromTypeIdx(iter_type_idx);
+      if (types_resolved != NULL) {
+        *types_resolved = false;
+      }
     } else if (iter_exception_type->IsAssignableFrom(exception_type)) {
       found_dex_pc = it.GetHandlerAddress();
       break;
@@ -317,7 +331,7 @@ void ArtMethod::RegisterNative(Thread* self, const void* native_method) {
     // around JNI bugs, that include not giving Object** SIRT references to native methods. Direct
     // the native method to runtime support and store the target somewhere runtime support will
     // find it.
-#if defined(__i386__)
+#if defined(__i386__) || defined(__x86_64__)
     UNIMPLEMENTED(FATAL);
 #else
     SetNativeMethod(reinterpret_cast<void*>(art_work_around_app_jni_bugs));
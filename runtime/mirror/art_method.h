@@ -19,6 +19,7 @@
 
 #include "class.h"
 #include "dex_file.h"
+#include "intrinsics.h"
 #include "invoke_type.h"
 #include "locks.h"
 #include "modifiers.h"
@@ -112,6 +113,11 @@ class MANAGED ArtMethod : public Object {
     return (GetAccessFlags() & kAccNative) != 0;
   }
 
+  // A native that is short and never blocks, which is called without leaving the runnable state.
+  bool IsFastNative() const {
+    return (GetAccessFlags() & kAccFastNative) != 0;
+  }
+
   bool IsAbstract() const {
     return (GetAccessFlags() & kAccAbstract) != 0;
   }
@@ -130,6 +136,32 @@ class MANAGED ArtMethod : public Object {
     SetAccessFlags(GetAccessFlags() | kAccPreverified);
   }
 
+  // Does the compiled code of the method call the method entry and exit hooks of the thread?
+  bool HasMethodHooks() const {
+    return (GetAccessFlags() & kAccMethodHooks) != 0;
+  }
+
+  void SetHasMethodHooks() {
+    SetAccessFlags(GetAccessFlags() | kAccMethodHooks);
+  }
+
+  bool IsIntrinsic() const {
+    return (GetAccessFlags() & kAccIntrinsic) != 0;
+  }
+
+  Intrinsic GetIntrinsic() const {
+    DCHECK(IsIntrinsic());
+    return static_cast<Intrinsic>((GetAccessFlags() & kAccIntrinsicBits) >> kAccIntrinsicShift);
+  }
+
+  void SetIntrinsic(Intrinsic intrinsic) {
+    COMPILE_ASSERT(kIntrinsicLast <= (kAccIntrinsicBits >> kAccIntrinsicShift),
+                   intrinsics_must_fit_in_access_flags);
+    DCHECK_NE(intrinsic, kIntrinsicNone);
+    SetAccessFlags((GetAccessFlags() & ~kAccIntrinsicBits) | kAccIntrinsic |
+                   (static_cast<uint32_t>(intrinsic) << kAccIntrinsicShift));
+  }
+
   bool CheckIncompatibleClassChange(InvokeType type) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   uint16_t GetMethodIndex() const;
@@ -206,6 +238,10 @@ class MANAGED ArtMethod : public Object {
     return GetFieldPtr<EntryPointFromInterpreter*>(OFFSET_OF_OBJECT_MEMBER(ArtMethod, entry_point_from_interpreter_), false);
   }
 
+  static MemberOffset EntryPointFromInterpreterOffset() {
+    return OFFSET_OF_OBJECT_MEMBER(ArtMethod, entry_point_from_interpreter_);
+  }
+
   void SetEntryPointFromInterpreter(EntryPointFromInterpreter* entry_point_from_interpreter) {
     SetFieldPtr<EntryPointFromInterpreter*>(OFFSET_OF_OBJECT_MEMBER(ArtMethod, entry_point_from_interpreter_), entry_point_from_interpreter, false);
   }
@@ -255,6 +291,10 @@ class MANAGED ArtMethod : public Object {
                                  mapping_table, false);
   }
 
+  static MemberOffset MappingTableOffset() {
+    return OFFSET_OF_OBJECT_MEMBER(ArtMethod, mapping_table_);
+  }
+
   uint32_t GetOatMappingTableOffset() const;
 
   void SetOatMappingTableOffset(uint32_t mapping_table_offset);
@@ -268,6 +308,10 @@ class MANAGED ArtMethod : public Object {
     SetFieldPtr<const uint8_t*>(OFFSET_OF_OBJECT_MEMBER(ArtMethod, vmap_table_), vmap_table, false);
   }
 
+  static MemberOffset VmapTableOffset() {
+    return OFFSET_OF_OBJECT_MEMBER(ArtMethod, vmap_table_);
+  }
+
   uint32_t GetOatVmapTableOffset() const;
 
   void SetOatVmapTableOffset(uint32_t vmap_table_offset);
@@ -279,6 +323,10 @@ class MANAGED ArtMethod : public Object {
     SetFieldPtr<const uint8_t*>(OFFSET_OF_OBJECT_MEMBER(ArtMethod, gc_map_), data, false);
   }
 
+  static MemberOffset NativeGcMapOffset() {
+    return OFFSET_OF_OBJECT_MEMBER(ArtMethod, gc_map_);
+  }
+
   // When building the oat need a convenient place to stuff the offset of the native GC map.
   void SetOatNativeGcMapOffset(uint32_t gc_map_offset);
   uint32_t GetOatNativeGcMapOffset() const;
@@ -358,13 +406,20 @@ class MANAGED ArtMethod : public Object {
   // Converts a native PC to a dex PC.
   uint32_t ToDexPc(const uintptr_t pc) const SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Converts an offset into the quick code of the method, as returned by NativePcOffset, to a dex
+  // PC.
+  uint32_t NativePcOffsetToDexPc(const uint32_t native_pc_offset) const
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   // Converts a dex PC to a native PC.
   uintptr_t ToNativePc(const uint32_t dex_pc) const SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   // Find the catch block for the given exception type and dex_pc. When a catch block is found,
   // indicates whether the found catch block is responsible for clearing the exception or whether
-  // a move-exception instruction is present.
-  uint32_t FindCatchBlock(Class* exception_type, uint32_t dex_pc, bool* has_no_move_exception) const
+  // a move-exception instruction is present. If types_resolved is non-NULL, it is set to whether
+  // every catch type looked at was resolved, that is whether the result can't change later.
+  uint32_t FindCatchBlock(Class* exception_type, uint32_t dex_pc, bool* has_no_move_exception,
+                          bool* types_resolved = NULL) const
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   static void SetClass(Class* java_lang_reflect_ArtMethod);
@@ -71,6 +71,15 @@ inline void Class::SetDirectMethods(ObjectArray<ArtMethod>* new_direct_methods)
 
 inline ArtMethod* Class::GetDirectMethod(int32_t i) const
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  ArtMethod* method = GetDirectMethods()->Get(i);
+  if (UNLIKELY(method == NULL)) {
+    method = LoadLazyDirectMethod(i);
+  }
+  return method;
+}
+
+inline ArtMethod* Class::GetLoadedDirectMethod(int32_t i) const
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
   return GetDirectMethods()->Get(i);
 }
 
@@ -140,6 +149,18 @@ inline void Class::SetVTable(ObjectArray<ArtMethod>* new_vtable)
   SetFieldObject(OFFSET_OF_OBJECT_MEMBER(Class, vtable_), new_vtable, false);
 }
 
+inline size_t Class::ImTableIndex(const ArtMethod* interface_method) {
+  return interface_method->GetDexMethodIndex() % kImtSize;
+}
+
+inline ObjectArray<ArtMethod>* Class::GetImTable() const {
+  return GetFieldObject<ObjectArray<ArtMethod>*>(OFFSET_OF_OBJECT_MEMBER(Class, imtable_), false);
+}
+
+inline void Class::SetImTable(ObjectArray<ArtMethod>* new_imtable) {
+  SetFieldObject(OFFSET_OF_OBJECT_MEMBER(Class, imtable_), new_imtable, false);
+}
+
 inline bool Class::Implements(const Class* klass) const {
   DCHECK(klass != NULL);
   DCHECK(klass->IsInterface()) << PrettyClass(this);
@@ -212,7 +233,13 @@ inline ArtMethod* Class::FindVirtualMethodForInterface(ArtMethod* method) const
   Class* declaring_class = method->GetDeclaringClass();
   DCHECK(declaring_class != NULL) << PrettyClass(this);
   DCHECK(declaring_class->IsInterface()) << PrettyMethod(method);
-  // TODO cache to improve lookup speed
+  ObjectArray<ArtMethod>* imtable = GetImTable();
+  if (imtable != NULL) {
+    size_t slot = ImTableIndex(method) * 2;
+    if (imtable->GetWithoutChecks(slot) == method) {
+      return imtable->GetWithoutChecks(slot + 1);
+    }
+  }
   int32_t iftable_count = GetIfTableCount();
   IfTable* iftable = GetIfTable();
   for (int32_t i = 0; i < iftable_count; i++) {
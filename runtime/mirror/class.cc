@@ -31,6 +31,7 @@
 #include "sirt_ref.h"
 #include "thread.h"
 #include "throwable.h"
+#include "transaction.h"
 #include "utils.h"
 #include "well_known_classes.h"
 
@@ -95,6 +96,11 @@ void Class::SetStatus(Status new_status, Thread* self) {
     // This is to ensure that ThrowEarlierClassFailure will throw NoClassDefFoundError in that case.
     Class* exception_class = old_exception->GetClass();
     if (!eiie_class->IsAssignableFrom(exception_class)) {
+      if (UNLIKELY(self->GetTransaction() != NULL && old_status >= kStatusVerified)) {
+        self->GetTransaction()->RecordWrite(this,
+                                            OFFSET_OF_OBJECT_MEMBER(Class, verify_error_class_),
+                                            sizeof(Class*), true);
+      }
       SetVerifyErrorClass(exception_class);
     }
 
@@ -105,6 +111,12 @@ void Class::SetStatus(Status new_status, Thread* self) {
     self->SetException(gc_safe_throw_location, old_exception.get());
   }
   CHECK(sizeof(Status) == sizeof(uint32_t)) << PrettyClass(this);
+  // A class initialized at compile time goes back to verified if its initializer is rolled back.
+  // Loading, linking and verification are kept, they don't depend on what initializers do.
+  if (UNLIKELY(self != NULL && self->GetTransaction() != NULL && old_status >= kStatusVerified)) {
+    self->GetTransaction()->RecordWrite(this, OFFSET_OF_OBJECT_MEMBER(Class, status_),
+                                        sizeof(Status), false);
+  }
   SetField32(OFFSET_OF_OBJECT_MEMBER(Class, status_), new_status, false);
   // Classes that are being resolved or initialized need to notify waiters that the class status
   // changed. See ClassLinker::EnsureResolved and ClassLinker::WaitForInitializeClass.
@@ -371,7 +383,17 @@ ArtMethod* Class::FindInterfaceMethod(const DexCache* dex_cache, uint32_t dex_me
 }
 
 
+ArtMethod* Class::LoadLazyDirectMethod(int32_t i) const {
+  DCHECK(HasLazyDirectMethods()) << PrettyClass(this);
+  return Runtime::Current()->GetClassLinker()->LoadLazyDirectMethod(const_cast<Class*>(this), i);
+}
+
 ArtMethod* Class::FindDeclaredDirectMethod(const StringPiece& name, const StringPiece& signature) const {
+  if (HasLazyDirectMethods()) {
+    // Only load the method that matches.
+    return Runtime::Current()->GetClassLinker()->FindLazyDirectMethod(const_cast<Class*>(this),
+                                                                      name, signature);
+  }
   MethodHelper mh;
   for (size_t i = 0; i < NumDirectMethods(); ++i) {
     ArtMethod* method = GetDirectMethod(i);
@@ -385,6 +407,10 @@ ArtMethod* Class::FindDeclaredDirectMethod(const StringPiece& name, const String
 
 ArtMethod* Class::FindDeclaredDirectMethod(const DexCache* dex_cache, uint32_t dex_method_idx) const {
   if (GetDexCache() == dex_cache) {
+    if (HasLazyDirectMethods()) {
+      return Runtime::Current()->GetClassLinker()->FindLazyDirectMethod(const_cast<Class*>(this),
+                                                                        dex_method_idx);
+    }
     for (size_t i = 0; i < NumDirectMethods(); ++i) {
       ArtMethod* method = GetDirectMethod(i);
       if (method->GetDexMethodIndex() == dex_method_idx) {
@@ -610,8 +636,10 @@ static void SetPreverifiedFlagOnMethods(mirror::ObjectArray<mirror::ArtMethod>*
   if (methods != NULL) {
     for (int32_t index = 0, end = methods->GetLength(); index < end; ++index) {
       mirror::ArtMethod* method = methods->GetWithoutChecks(index);
-      DCHECK(method != NULL);
-      method->SetPreverified();
+      // Lazy direct methods are loaded without the flag, they keep their access checks.
+      if (method != NULL) {
+        method->SetPreverified();
+      }
     }
   }
 }
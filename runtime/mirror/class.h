@@ -130,6 +130,10 @@ class MANAGED Class : public StaticStorageBase {
 
   void SetStatus(Status new_status, Thread* self) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  static MemberOffset StatusOffset() {
+    return OFFSET_OF_OBJECT_MEMBER(Class, status_);
+  }
+
   // Returns true if the class has failed to link.
   bool IsErroneous() const {
     return GetStatus() == kStatusError;
@@ -200,6 +204,16 @@ class MANAGED Class : public StaticStorageBase {
     SetAccessFlags(flags | kAccClassIsFinalizable);
   }
 
+  // Returns true if some direct methods were left for ClassLinker to load on first use.
+  bool HasLazyDirectMethods() const {
+    return (GetAccessFlags() & kAccClassHasLazyDirectMethods) != 0;
+  }
+
+  void SetHasLazyDirectMethods() {
+    uint32_t flags = GetField32(OFFSET_OF_OBJECT_MEMBER(Class, access_flags_), false);
+    SetAccessFlags(flags | kAccClassHasLazyDirectMethods);
+  }
+
   // Returns true if the class is abstract.
   bool IsAbstract() const {
     return (GetAccessFlags() & kAccAbstract) != 0;
@@ -507,8 +521,15 @@ class MANAGED Class : public StaticStorageBase {
   void SetDirectMethods(ObjectArray<ArtMethod>* new_direct_methods)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Loads the method first if it is lazy, in which case this may suspend and returns NULL with
+  // an OutOfMemoryError pending if the method can't be allocated.
   ArtMethod* GetDirectMethod(int32_t i) const SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Returns NULL rather than loading a lazy method.
+  ArtMethod* GetLoadedDirectMethod(int32_t i) const SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  ArtMethod* LoadLazyDirectMethod(int32_t i) const SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   void SetDirectMethod(uint32_t i, ArtMethod* f)  // TODO: uint16_t
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
@@ -544,6 +565,23 @@ class MANAGED Class : public StaticStorageBase {
     return OFFSET_OF_OBJECT_MEMBER(Class, vtable_);
   }
 
+  // Number of slots in the interface method table. Each slot is a pair of an interface method and
+  // the method of this class implementing it, see imtable_.
+  static const size_t kImtSize = 64;
+
+  // Slot of the interface method table an interface method is looked up in.
+  static size_t ImTableIndex(const ArtMethod* interface_method)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  ObjectArray<ArtMethod>* GetImTable() const SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  void SetImTable(ObjectArray<ArtMethod>* new_imtable)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  static MemberOffset ImTableOffset() {
+    return OFFSET_OF_OBJECT_MEMBER(Class, imtable_);
+  }
+
   // Given a method implemented by this class but potentially from a super class, return the
   // specific implementation method for this class.
   ArtMethod* FindVirtualMethodForVirtual(ArtMethod* method) const
@@ -803,6 +841,13 @@ class MANAGED Class : public StaticStorageBase {
   // methods for the methods in the interface.
   IfTable* iftable_;
 
+  // Interface method table (imt), for "invoke-interface". Holds kImtSize pairs of an interface
+  // method and its implementation in this class, the pair for an interface method is at
+  // ImTableIndex(method). Slots that no interface method maps to, or that more than one does, hold
+  // a pair of nulls and the method is found through the iftable_. Null if the class implements no
+  // interface methods.
+  ObjectArray<ArtMethod>* imtable_;
+
   // descriptor for the class such as "java.lang.Class" or "[C". Lazily initialized by ComputeName
   String* name_;
 
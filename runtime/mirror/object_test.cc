@@ -35,6 +35,7 @@
 #include "object-inl.h"
 #include "object_array-inl.h"
 #include "sirt_ref.h"
+#include "stack.h"
 #include "UniquePtr.h"
 
 namespace art {
@@ -77,6 +78,10 @@ TEST_F(ObjectTest, AsmConstants) {
   ASSERT_EQ(STRING_DATA_OFFSET, Array::DataOffset(sizeof(uint16_t)).Int32Value());
 
   ASSERT_EQ(METHOD_CODE_OFFSET, ArtMethod::EntryPointFromCompiledCodeOffset().Int32Value());
+
+  ASSERT_EQ(SHADOWFRAME_NUMBER_OF_VREGS_OFFSET,
+            static_cast<int>(ShadowFrame::NumberOfVRegsOffset()));
+  ASSERT_EQ(SHADOWFRAME_VREGS_OFFSET, static_cast<int>(ShadowFrame::VRegsOffset()));
 }
 
 TEST_F(ObjectTest, IsInSamePackage) {
@@ -16,6 +16,7 @@
 
 #include "string.h"
 
+#include "arch/memcmp16.h"
 #include "array.h"
 #include "gc/accounting/card_table-inl.h"
 #include "intern_table.h"
@@ -47,15 +48,12 @@ int32_t String::FastIndexOf(int32_t ch, int32_t start) const {
   } else if (start > count) {
     start = count;
   }
-  const uint16_t* chars = GetCharArray()->GetData() + GetOffset();
-  const uint16_t* p = chars + start;
-  const uint16_t* end = chars + count;
-  while (p < end) {
-    if (*p++ == ch) {
-      return (p - 1) - chars;
-    }
+  if (static_cast<uint32_t>(ch) > 0xffff) {
+    return -1;
   }
-  return -1;
+  const uint16_t* chars = GetCharArray()->GetData() + GetOffset();
+  int32_t index = MemChr16(chars + start, ch, count - start);
+  return index < 0 ? index : start + index;
 }
 
 void String::SetArray(CharArray* new_array) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
@@ -191,12 +189,9 @@ bool String::Equals(const String* that) const {
   } else {
     // Note: don't short circuit on hash code as we're presumably here as the
     // hash code was already equal
-    for (int32_t i = 0; i < that->GetLength(); ++i) {
-      if (this->CharAt(i) != that->CharAt(i)) {
-        return false;
-      }
-    }
-    return true;
+    return memcmp(this->GetCharArray()->GetData() + this->GetOffset(),
+                  that->GetCharArray()->GetData() + that->GetOffset(),
+                  that->GetLength() * sizeof(uint16_t)) == 0;
   }
 }
 
@@ -204,12 +199,8 @@ bool String::Equals(const uint16_t* that_chars, int32_t that_offset, int32_t tha
   if (this->GetLength() != that_length) {
     return false;
   } else {
-    for (int32_t i = 0; i < that_length; ++i) {
-      if (this->CharAt(i) != that_chars[that_offset + i]) {
-        return false;
-      }
-    }
-    return true;
+    return memcmp(this->GetCharArray()->GetData() + this->GetOffset(),
+                  that_chars + that_offset, that_length * sizeof(uint16_t)) == 0;
   }
 }
 
@@ -243,21 +234,6 @@ std::string String::ToModifiedUtf8() const {
   return result;
 }
 
-#ifdef HAVE__MEMCMP16
-// "count" is in 16-bit units.
-extern "C" uint32_t __memcmp16(const uint16_t* s0, const uint16_t* s1, size_t count);
-#define MemCmp16 __memcmp16
-#else
-static uint32_t MemCmp16(const uint16_t* s0, const uint16_t* s1, size_t count) {
-  for (size_t i = 0; i < count; i++) {
-    if (s0[i] != s1[i]) {
-      return static_cast<int32_t>(s0[i]) - static_cast<int32_t>(s1[i]);
-    }
-  }
-  return 0;
-}
-#endif
-
 int32_t String::CompareTo(String* rhs) const {
   // Quick test for comparison of a string with itself.
   const String* lhs = this;
@@ -47,6 +47,13 @@ static const uint32_t kAccDeclaredSynchronized = 0x00020000;  // method (dex onl
 static const uint32_t kAccClassIsProxy = 0x00040000;  // class (dex only)
 static const uint32_t kAccPreverified = 0x00080000;  // method (dex only)
 
+// Special runtime-only method flags, sharing the bits of the class flags below.
+static const uint32_t kAccIntrinsic = 0x80000000;  // method is an intrinsic
+static const uint32_t kAccIntrinsicBits = 0x7f000000;  // method, which Intrinsic it is
+static const uint32_t kAccIntrinsicShift = 24;
+static const uint32_t kAccFastNative = 0x00100000;  // method registered with a '!' signature
+static const uint32_t kAccMethodHooks = 0x00200000;  // method's compiled code calls method hooks
+
 // Special runtime-only flags.
 // Note: if only kAccClassIsReference is set, we have a soft reference.
 static const uint32_t kAccClassIsFinalizable        = 0x80000000;  // class/ancestor overrides finalize()
@@ -54,6 +61,7 @@ static const uint32_t kAccClassIsReference          = 0x08000000;  // class is a
 static const uint32_t kAccClassIsWeakReference      = 0x04000000;  // class is a weak reference
 static const uint32_t kAccClassIsFinalizerReference = 0x02000000;  // class is a finalizer reference
 static const uint32_t kAccClassIsPhantomReference   = 0x01000000;  // class is a phantom reference
+static const uint32_t kAccClassHasLazyDirectMethods = 0x00800000;  // direct methods loaded on use
 
 static const uint32_t kAccReferenceFlagsMask = (kAccClassIsReference
                                                 | kAccClassIsWeakReference
@@ -16,11 +16,17 @@
 
 #include "monitor.h"
 
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
 #include <vector>
 
+#include "barrier.h"
 #include "base/mutex.h"
 #include "base/stl_util.h"
 #include "class_linker.h"
+#include "closure.h"
 #include "dex_file-inl.h"
 #include "dex_instruction.h"
 #include "mirror/art_method-inl.h"
@@ -56,8 +62,22 @@ namespace art {
  * lock encodes its state.  When cleared, the lock is in the "thin"
  * state and its bits are formatted as follows:
  *
- *    [31 ---- 19] [18 ---- 3] [2 ---- 1] [0]
- *     lock count   thread id  hash state  0
+ *    [31]  [30 ---- 19] [18 ---- 3] [2 ---- 1] [0]
+ *   reserved  lock count   thread id  hash state  0
+ *
+ * A thin lock is either plain or reserved. A plain thin lock with a
+ * thread id is held by that thread and the lock count is the number of
+ * recursive acquisitions. A reserved thin lock belongs to the thread
+ * whose id it holds, whether or not that thread currently holds it, and
+ * the lock count is the number of times it is held. The reserving
+ * thread is the only one that writes a reserved lock word, so it enters
+ * and exits with plain loads and stores instead of a CAS. Another
+ * thread that wants the lock revokes the reservation by running a
+ * checkpoint on the reserving thread, which turns the lock back into a
+ * plain thin lock. Locks are reserved by the first thread to lock them
+ * in the runtime. A lock whose reservation has been revoked is inflated
+ * rather than reserved again. Compiled code only locks plain thin locks inline and
+ * calls the runtime for reserved ones.
  *
  * When set, the lock is in the "fat" state and its bits are formatted
  * as follows:
@@ -96,12 +116,166 @@ namespace art {
  * Lock recursion count field.  Contains a count of the number of times
  * a lock has been recursively acquired.
  */
-#define LW_LOCK_COUNT_MASK 0x1fff
+#define LW_LOCK_COUNT_MASK 0xfff
 #define LW_LOCK_COUNT_SHIFT 19
 #define LW_LOCK_COUNT(x) (((x) >> LW_LOCK_COUNT_SHIFT) & LW_LOCK_COUNT_MASK)
 
+/*
+ * Lock reservation bit. Set when a thin lock is reserved by the thread
+ * in its owner field.
+ */
+#define LW_LOCK_RESERVED 0x80000000
+#define LW_IS_RESERVED(x) (((x) & LW_LOCK_RESERVED) != 0)
+
+// Whether the runtime reserves thin locks for the first thread that locks them.
+static const bool kUseLockReservation = true;
+
+// Bounds of the number of rounds a contended fat lock is spun on before blocking. Each monitor
+// adapts its own number of rounds: it doubles when spinning got the lock, which means the lock is
+// held for short stretches, and halves when it did not.
+static const uint32_t kMinSpinRounds = 4;
+static const uint32_t kMaxSpinRounds = 128;
+// The most pause instructions between two attempts to take a contended lock.
+static const uint32_t kMaxSpinBackoff = 64;
+// The number of rounds a contended thin lock is spun on before yielding.
+static const uint32_t kThinLockSpinRounds = 16;
+
+// Tells the CPU that this is a spin-wait loop, to save power and let a hyper-thread sibling run.
+static inline void CpuRelax() {
+#if defined(__i386__) || defined(__x86_64__)
+  __asm__ __volatile__("pause" : : : "memory");
+#elif defined(__ARM_ARCH_7A__)
+  __asm__ __volatile__("yield" : : : "memory");
+#else
+  __asm__ __volatile__("" : : : "memory");
+#endif
+}
+
+static void SpinFor(uint32_t pauses) {
+  for (uint32_t i = 0; i < pauses; ++i) {
+    CpuRelax();
+  }
+}
+
+// Contended lock acquisitions aggregated by the call sites of the owner and of the waiter. The
+// table has a fixed size, acquisitions at call sites that don't fit are only counted in total.
+class MonitorContentionStats {
+ public:
+  MonitorContentionStats()
+      : lock_("monitor contention stats lock"), size_(0), dropped_count_(0), dropped_wait_ns_(0) {
+    memset(entries_, 0, sizeof(entries_));
+  }
+
+  void Record(const mirror::ArtMethod* owner_method, uint32_t owner_dex_pc,
+              const mirror::ArtMethod* waiter_method, uint32_t waiter_dex_pc, uint64_t wait_ns)
+      LOCKS_EXCLUDED(lock_) {
+    size_t hash = reinterpret_cast<uintptr_t>(owner_method) ^ (owner_dex_pc * 31) ^
+        (reinterpret_cast<uintptr_t>(waiter_method) * 17) ^ (waiter_dex_pc * 7);
+    MutexLock mu(Thread::Current(), lock_);
+    for (size_t i = 0; i < kMaxProbes; ++i) {
+      Entry& entry = entries_[(hash + i) & (kCapacity - 1)];
+      if (entry.count == 0) {
+        if (size_ == kMaxSize) {
+          break;
+        }
+        entry.owner_method = owner_method;
+        entry.owner_dex_pc = owner_dex_pc;
+        entry.waiter_method = waiter_method;
+        entry.waiter_dex_pc = waiter_dex_pc;
+        ++size_;
+      } else if (entry.owner_method != owner_method || entry.owner_dex_pc != owner_dex_pc ||
+                 entry.waiter_method != waiter_method || entry.waiter_dex_pc != waiter_dex_pc) {
+        continue;
+      }
+      ++entry.count;
+      entry.wait_ns += wait_ns;
+      return;
+    }
+    ++dropped_count_;
+    dropped_wait_ns_ += wait_ns;
+  }
+
+  void Dump(std::ostream& os) LOCKS_EXCLUDED(lock_) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+ private:
+  struct Entry {
+    const mirror::ArtMethod* owner_method;
+    uint32_t owner_dex_pc;
+    const mirror::ArtMethod* waiter_method;
+    uint32_t waiter_dex_pc;
+    uint64_t count;
+    uint64_t wait_ns;
+  };
+
+  static bool CompareWaitNs(const Entry& lhs, const Entry& rhs) {
+    return lhs.wait_ns > rhs.wait_ns;
+  }
+
+  static const size_t kCapacity = 1024;  // Must be a power of two.
+  static const size_t kMaxSize = kCapacity * 3 / 4;
+  static const size_t kMaxProbes = 16;
+  static const size_t kDumpedEntries = 20;
+
+  Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  Entry entries_[kCapacity] GUARDED_BY(lock_);
+  size_t size_ GUARDED_BY(lock_);
+  uint64_t dropped_count_ GUARDED_BY(lock_);
+  uint64_t dropped_wait_ns_ GUARDED_BY(lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(MonitorContentionStats);
+};
+
+void MonitorContentionStats::Dump(std::ostream& os) {
+  std::vector<Entry> entries;
+  uint64_t dropped_count;
+  uint64_t dropped_wait_ns;
+  uint64_t total_count;
+  uint64_t total_wait_ns;
+  {
+    MutexLock mu(Thread::Current(), lock_);
+    dropped_count = dropped_count_;
+    dropped_wait_ns = dropped_wait_ns_;
+    total_count = dropped_count_;
+    total_wait_ns = dropped_wait_ns_;
+    for (size_t i = 0; i < kCapacity; ++i) {
+      if (entries_[i].count != 0) {
+        entries.push_back(entries_[i]);
+        total_count += entries_[i].count;
+        total_wait_ns += entries_[i].wait_ns;
+      }
+    }
+  }
+  std::sort(entries.begin(), entries.end(), CompareWaitNs);
+  os << "Monitor contention: " << total_count << " contended acquisitions, "
+     << PrettyDuration(total_wait_ns) << " waited, " << entries.size() << " call sites\n";
+  for (size_t i = 0; i < entries.size() && i < kDumpedEntries; ++i) {
+    const Entry& entry = entries[i];
+    os << "  " << PrettyDuration(entry.wait_ns) << " in " << entry.count << " waits\n";
+    const char* names[] = { "owner", "waiter" };
+    const mirror::ArtMethod* methods[] = { entry.owner_method, entry.waiter_method };
+    uint32_t dex_pcs[] = { entry.owner_dex_pc, entry.waiter_dex_pc };
+    for (size_t j = 0; j < 2; ++j) {
+      os << "    " << names[j] << ": ";
+      if (methods[j] == NULL) {
+        os << "unknown\n";
+        continue;
+      }
+      const char* source_file;
+      uint32_t line_number;
+      Monitor::TranslateLocation(methods[j], dex_pcs[j], source_file, line_number);
+      os << PrettyMethod(methods[j]) << " (" << source_file << ":" << line_number << ")\n";
+    }
+  }
+  if (dropped_count != 0) {
+    os << "  " << PrettyDuration(dropped_wait_ns) << " in " << dropped_count
+       << " waits at call sites that did not fit the table\n";
+  }
+}
+
 bool (*Monitor::is_sensitive_thread_hook_)() = NULL;
 uint32_t Monitor::lock_profiling_threshold_ = 0;
+bool Monitor::spin_on_contention_ = false;
+MonitorContentionStats* Monitor::contention_stats_ = NULL;
 
 bool Monitor::IsSensitiveThread() {
   if (is_sensitive_thread_hook_ != NULL) {
@@ -110,9 +284,102 @@ bool Monitor::IsSensitiveThread() {
   return false;
 }
 
-void Monitor::Init(uint32_t lock_profiling_threshold, bool (*is_sensitive_thread_hook)()) {
+void Monitor::Init(uint32_t lock_profiling_threshold, bool (*is_sensitive_thread_hook)(),
+                   bool contention_stats) {
   lock_profiling_threshold_ = lock_profiling_threshold;
   is_sensitive_thread_hook_ = is_sensitive_thread_hook;
+  if (contention_stats && contention_stats_ == NULL) {
+    contention_stats_ = new MonitorContentionStats;
+  }
+  // Spinning only helps if the lock owner can run at the same time.
+  spin_on_contention_ = sysconf(_SC_NPROCESSORS_CONF) > 1;
+}
+
+// Is the thin lock reserved by the given thread?
+static bool IsReservedBy(uint32_t thin, uint32_t thread_id) {
+  return LW_SHAPE(thin) == LW_SHAPE_THIN && LW_IS_RESERVED(thin) &&
+      LW_LOCK_OWNER(thin) == thread_id;
+}
+
+// Is the thin lock held by the given thread? A reserved lock is only held while its count is not
+// zero.
+static bool IsThinLockHeldBy(uint32_t thin, uint32_t thread_id) {
+  return LW_LOCK_OWNER(thin) == thread_id && (!LW_IS_RESERVED(thin) || LW_LOCK_COUNT(thin) != 0);
+}
+
+// Turns a lock reserved by the given thread into the equivalent plain thin lock. Called by the
+// reserving thread, or on its behalf while it is suspended or after it has exited.
+static void UnreserveLock(volatile int32_t* thinp, uint32_t thread_id) {
+  for (;;) {
+    uint32_t thin = *thinp;
+    if (!IsReservedBy(thin, thread_id)) {
+      return;
+    }
+    uint32_t count = LW_LOCK_COUNT(thin);
+    uint32_t new_thin;
+    if (count == 0) {
+      new_thin = thin & (LW_HASH_STATE_MASK << LW_HASH_STATE_SHIFT);
+    } else {
+      new_thin = thin & ~(LW_LOCK_RESERVED | (LW_LOCK_COUNT_MASK << LW_LOCK_COUNT_SHIFT));
+      new_thin |= (count - 1) << LW_LOCK_COUNT_SHIFT;
+    }
+    if (android_atomic_release_cas(thin, new_thin, thinp) == 0) {
+      return;
+    }
+  }
+}
+
+// Checkpoint run on every thread to revoke a lock reservation. Only the reserving thread acts.
+class RevokeReservationCheckpoint : public Closure {
+ public:
+  RevokeReservationCheckpoint(volatile int32_t* thinp, uint32_t owner_id, Barrier* barrier)
+      : thinp_(thinp), owner_id_(owner_id), barrier_(barrier) {}
+
+  virtual void Run(Thread* thread) NO_THREAD_SAFETY_ANALYSIS {
+    // Note: thread is not necessarily the current thread, it may be suspended.
+    if (thread->GetThinLockId() == owner_id_) {
+      UnreserveLock(thinp_, owner_id_);
+    }
+    barrier_->Pass(Thread::Current());
+  }
+
+ private:
+  volatile int32_t* const thinp_;
+  const uint32_t owner_id_;
+  Barrier* const barrier_;
+};
+
+static void FindThreadCallback(Thread* thread, void* arg) {
+  std::pair<uint32_t, bool>* owner = reinterpret_cast<std::pair<uint32_t, bool>*>(arg);
+  if (thread->GetThinLockId() == owner->first) {
+    owner->second = true;
+  }
+}
+
+void Monitor::RevokeReservation(Thread* self, mirror::Object* obj, uint32_t owner_id) {
+  volatile int32_t* thinp = obj->GetRawLockWordAddress();
+  VLOG(monitor) << StringPrintf("monitor: thread %d revoking reservation of lock %p by %d",
+                                self->GetThinLockId(), thinp, owner_id);
+  ThreadList* thread_list = Runtime::Current()->GetThreadList();
+  // Checkpoints can't be run from a runnable thread. Let the runtime know what we are waiting for.
+  self->monitor_enter_object_ = obj;
+  self->TransitionFromRunnableToSuspended(kBlocked);
+  while (IsReservedBy(*thinp, owner_id)) {
+    Barrier barrier(0);
+    RevokeReservationCheckpoint checkpoint(thinp, owner_id, &barrier);
+    size_t barrier_count = thread_list->RunCheckpoint(&checkpoint);
+    barrier.Increment(self, barrier_count);
+    // A thread that exited may leave reservations behind. Revoke them with the thread list locked,
+    // so that no new thread with the same id starts using them.
+    MutexLock mu(self, *Locks::thread_list_lock_);
+    std::pair<uint32_t, bool> owner(owner_id, false);
+    thread_list->ForEach(FindThreadCallback, &owner);
+    if (!owner.second) {
+      UnreserveLock(thinp, owner_id);
+    }
+  }
+  self->monitor_enter_object_ = NULL;
+  self->TransitionFromSuspendedToRunnable();
 }
 
 Monitor::Monitor(Thread* owner, mirror::Object* obj)
@@ -121,8 +388,13 @@ Monitor::Monitor(Thread* owner, mirror::Object* obj)
       lock_count_(0),
       obj_(obj),
       wait_set_(NULL),
+      wait_set_tail_(NULL),
+      notified_(NULL),
+      notified_tail_(NULL),
       locking_method_(NULL),
-      locking_dex_pc_(0) {
+      locking_dex_pc_(0),
+      spin_rounds_(kMinSpinRounds),
+      num_waiters_(0) {
   monitor_lock_.Lock(owner);
   // Propagate the lock state.
   uint32_t thin = *obj->GetRawLockWordAddress();
@@ -132,7 +404,7 @@ Monitor::Monitor(Thread* owner, mirror::Object* obj)
   // Publish the updated lock word.
   android_atomic_release_store(thin, obj->GetRawLockWordAddress());
   // Lock profiling.
-  if (lock_profiling_threshold_ != 0) {
+  if (IsLockProfilingEnabled()) {
     locking_method_ = owner->GetCurrentMethod(&locking_dex_pc_);
   }
 }
@@ -143,51 +415,57 @@ Monitor::~Monitor() {
 }
 
 /*
- * Links a thread into a monitor's wait set.  The monitor lock must be
- * held by the caller of this routine.
+ * Links a thread to the end of a monitor's wait set.  The monitor lock
+ * must be held by the caller of this routine.
  */
 void Monitor::AppendToWaitSet(Thread* thread) {
   DCHECK(owner_ == Thread::Current());
   DCHECK(thread != NULL);
   DCHECK(thread->wait_next_ == NULL) << thread->wait_next_;
-  if (wait_set_ == NULL) {
+  DCHECK(thread->wait_prev_ == NULL) << thread->wait_prev_;
+  thread->wait_prev_ = wait_set_tail_;
+  if (wait_set_tail_ == NULL) {
     wait_set_ = thread;
-    return;
-  }
-
-  // push_back.
-  Thread* t = wait_set_;
-  while (t->wait_next_ != NULL) {
-    t = t->wait_next_;
+  } else {
+    wait_set_tail_->wait_next_ = thread;
   }
-  t->wait_next_ = thread;
+  wait_set_tail_ = thread;
 }
 
 /*
- * Unlinks a thread from a monitor's wait set.  The monitor lock must
- * be held by the caller of this routine.
+ * Unlinks a thread from a monitor's wait set, if a notify hasn't already
+ * done so.  The monitor lock must be held by the caller of this routine.
  */
 void Monitor::RemoveFromWaitSet(Thread *thread) {
   DCHECK(owner_ == Thread::Current());
   DCHECK(thread != NULL);
-  if (wait_set_ == NULL) {
+  if (thread->wait_prev_ == NULL && wait_set_ != thread) {
+    DCHECK(thread->wait_next_ == NULL) << thread->wait_next_;
     return;
   }
-  if (wait_set_ == thread) {
+  if (thread->wait_prev_ == NULL) {
     wait_set_ = thread->wait_next_;
-    thread->wait_next_ = NULL;
-    return;
+  } else {
+    thread->wait_prev_->wait_next_ = thread->wait_next_;
+  }
+  if (thread->wait_next_ == NULL) {
+    wait_set_tail_ = thread->wait_prev_;
+  } else {
+    thread->wait_next_->wait_prev_ = thread->wait_prev_;
   }
+  thread->wait_next_ = NULL;
+  thread->wait_prev_ = NULL;
+}
 
-  Thread* t = wait_set_;
-  while (t->wait_next_ != NULL) {
-    if (t->wait_next_ == thread) {
-      t->wait_next_ = thread->wait_next_;
-      thread->wait_next_ = NULL;
-      return;
-    }
-    t = t->wait_next_;
+void Monitor::SignalNotifiedThreads() {
+  while (notified_ != NULL) {
+    Thread* thread = notified_;
+    notified_ = thread->wait_next_;
+    thread->wait_next_ = NULL;
+    thread->wait_prev_ = NULL;
+    thread->Notify();
   }
+  notified_tail_ = NULL;
 }
 
 mirror::Object* Monitor::GetObject() {
@@ -200,26 +478,38 @@ void Monitor::Lock(Thread* self) {
     return;
   }
 
-  if (!monitor_lock_.TryLock(self)) {
+  bool blocked = false;
+  if (!monitor_lock_.TryLock(self) && !SpinLock(self)) {
+    // We hold on to the monitor while blocked, it must not be deflated under us.
+    android_atomic_inc(&num_waiters_);
+    blocked = true;
     uint64_t waitStart = 0;
     uint64_t waitEnd = 0;
     uint32_t wait_threshold = lock_profiling_threshold_;
+    bool timed = IsLockProfilingEnabled();
     const mirror::ArtMethod* current_locking_method = NULL;
     uint32_t current_locking_dex_pc = 0;
     {
       ScopedThreadStateChange tsc(self, kBlocked);
-      if (wait_threshold != 0) {
+      if (timed) {
         waitStart = NanoTime() / 1000;
       }
       current_locking_method = locking_method_;
       current_locking_dex_pc = locking_dex_pc_;
 
       monitor_lock_.Lock(self);
-      if (wait_threshold != 0) {
+      if (timed) {
         waitEnd = NanoTime() / 1000;
       }
     }
 
+    if (contention_stats_ != NULL) {
+      uint32_t dex_pc;
+      const mirror::ArtMethod* m = self->GetCurrentMethod(&dex_pc);
+      contention_stats_->Record(current_locking_method, current_locking_dex_pc, m, dex_pc,
+                                (waitEnd - waitStart) * 1000);
+    }
+
     if (wait_threshold != 0) {
       uint64_t wait_ms = (waitEnd - waitStart) / 1000;
       uint32_t sample_percent;
@@ -239,14 +529,39 @@ void Monitor::Lock(Thread* self) {
   }
   owner_ = self;
   DCHECK_EQ(lock_count_, 0);
+  if (blocked) {
+    android_atomic_dec(&num_waiters_);
+  }
 
   // When debugging, save the current monitor holder for future
   // acquisition failures to use in sampled logging.
-  if (lock_profiling_threshold_ != 0) {
+  if (IsLockProfilingEnabled()) {
     locking_method_ = self->GetCurrentMethod(&locking_dex_pc_);
   }
 }
 
+bool Monitor::SpinLock(Thread* self) {
+  if (!spin_on_contention_) {
+    return false;
+  }
+  uint32_t rounds = spin_rounds_;
+  uint32_t backoff = 1;
+  for (uint32_t i = 0; i < rounds; ++i) {
+    SpinFor(backoff);
+    backoff = std::min(backoff * 2, kMaxSpinBackoff);
+    if (self->TestAllFlags()) {
+      // Don't keep a suspension or checkpoint request waiting, block instead.
+      break;
+    }
+    if (owner_ == NULL && monitor_lock_.TryLock(self)) {
+      spin_rounds_ = std::min(rounds * 2, kMaxSpinRounds);
+      return true;
+    }
+  }
+  spin_rounds_ = std::max(rounds / 2, kMinSpinRounds);
+  return false;
+}
+
 static void ThrowIllegalMonitorStateExceptionF(const char* fmt, ...)
                                               __attribute__((format(printf, 1, 2)));
 
@@ -344,6 +659,7 @@ bool Monitor::Unlock(Thread* self, bool for_wait) {
       owner_ = NULL;
       locking_method_ = NULL;
       locking_dex_pc_ = 0;
+      SignalNotifiedThreads();
       monitor_lock_.Unlock(self);
     } else {
       --lock_count_;
@@ -354,6 +670,7 @@ bool Monitor::Unlock(Thread* self, bool for_wait) {
     DCHECK(owner == NULL);
     DCHECK(locking_method_ == NULL);
     DCHECK_EQ(locking_dex_pc_, 0u);
+    DCHECK(notified_ == NULL);
     monitor_lock_.Unlock(self);
   } else {
     // We don't own this, so we're not allowed to unlock it.
@@ -430,6 +747,10 @@ void Monitor::WaitWithLock(Thread* self, int64_t ms, int32_t ns,
    * not order sensitive as we hold the pthread mutex.
    */
   AppendToWaitSet(self);
+  android_atomic_inc(&num_waiters_);
+  // We're about to release the monitor, so wake the threads we notified. They can't be woken
+  // once we hold our own wait_mutex_.
+  SignalNotifiedThreads();
   int prev_lock_count = lock_count_;
   lock_count_ = 0;
   owner_ = NULL;
@@ -506,6 +827,7 @@ void Monitor::WaitWithLock(Thread* self, int64_t ms, int32_t ns,
   locking_method_ = saved_method;
   locking_dex_pc_ = saved_dex_pc;
   RemoveFromWaitSet(self);
+  android_atomic_dec(&num_waiters_);
 
   if (was_interrupted) {
     /*
@@ -538,16 +860,25 @@ void Monitor::Notify(Thread* self) {
 }
 
 void Monitor::NotifyWithLock(Thread* self) {
-  // Signal the first waiting thread in the wait set.
+  // Move the first thread still waiting to the notified threads, which are woken when the monitor
+  // is released.
   while (wait_set_ != NULL) {
     Thread* thread = wait_set_;
-    wait_set_ = thread->wait_next_;
-    thread->wait_next_ = NULL;
+    RemoveFromWaitSet(thread);
 
     // Check to see if the thread is still waiting.
-    MutexLock mu(self, *thread->wait_mutex_);
-    if (thread->wait_monitor_ != NULL) {
-      thread->wait_cond_->Signal(self);
+    bool waiting;
+    {
+      MutexLock mu(self, *thread->wait_mutex_);
+      waiting = thread->wait_monitor_ != NULL;
+    }
+    if (waiting) {
+      if (notified_tail_ == NULL) {
+        notified_ = thread;
+      } else {
+        notified_tail_->wait_next_ = thread;
+      }
+      notified_tail_ = thread;
       return;
     }
   }
@@ -565,13 +896,19 @@ void Monitor::NotifyAll(Thread* self) {
 }
 
 void Monitor::NotifyAllWithLock() {
-  // Signal all threads in the wait set.
-  while (wait_set_ != NULL) {
-    Thread* thread = wait_set_;
-    wait_set_ = thread->wait_next_;
-    thread->wait_next_ = NULL;
-    thread->Notify();
+  // Move the whole wait set to the notified threads. The stale wait_prev_ links are cleared when
+  // the threads are woken.
+  if (wait_set_ == NULL) {
+    return;
+  }
+  if (notified_tail_ == NULL) {
+    notified_ = wait_set_;
+  } else {
+    notified_tail_->wait_next_ = wait_set_;
   }
+  notified_tail_ = wait_set_tail_;
+  wait_set_ = NULL;
+  wait_set_tail_ = NULL;
 }
 
 /*
@@ -582,7 +919,10 @@ void Monitor::Inflate(Thread* self, mirror::Object* obj) {
   DCHECK(self != NULL);
   DCHECK(obj != NULL);
   DCHECK_EQ(LW_SHAPE(*obj->GetRawLockWordAddress()), LW_SHAPE_THIN);
-  DCHECK_EQ(LW_LOCK_OWNER(*obj->GetRawLockWordAddress()), static_cast<int32_t>(self->GetThinLockId()));
+  DCHECK(IsThinLockHeldBy(*obj->GetRawLockWordAddress(), self->GetThinLockId()));
+
+  // The monitor takes the count of a plain thin lock.
+  UnreserveLock(obj->GetRawLockWordAddress(), self->GetThinLockId());
 
   // Allocate and acquire a new monitor.
   Monitor* m = new Monitor(self, obj);
@@ -601,6 +941,7 @@ void Monitor::MonitorEnter(Thread* self, mirror::Object* obj) {
   DCHECK(self != NULL);
   DCHECK(obj != NULL);
   uint32_t threadId = self->GetThinLockId();
+  bool revoked = false;
  retry:
   thin = *thinp;
   if (LW_SHAPE(thin) == LW_SHAPE_THIN) {
@@ -608,7 +949,23 @@ void Monitor::MonitorEnter(Thread* self, mirror::Object* obj) {
      * The lock is a thin lock.  The owner field is used to
      * determine the acquire method, ordered by cost.
      */
-    if (LW_LOCK_OWNER(thin) == threadId) {
+    if (LW_IS_RESERVED(thin)) {
+      if (LW_LOCK_OWNER(thin) == threadId) {
+        // The calling thread reserved the lock and is the only writer of the lock word.
+        if (LIKELY(LW_LOCK_COUNT(thin) < LW_LOCK_COUNT_MASK - 1)) {
+          *thinp = thin + (1 << LW_LOCK_COUNT_SHIFT);
+        } else {
+          // Give up the reservation so the plain path inflates the lock before the count overflows.
+          UnreserveLock(thinp, threadId);
+          goto retry;
+        }
+      } else {
+        // The lock is reserved by another thread. Revoke the reservation and try again.
+        RevokeReservation(self, obj, LW_LOCK_OWNER(thin));
+        revoked = true;
+        goto retry;
+      }
+    } else if (LW_LOCK_OWNER(thin) == threadId) {
       /*
        * The calling thread owns the lock.  Increment the
        * value of the recursion count field.
@@ -625,25 +982,37 @@ void Monitor::MonitorEnter(Thread* self, mirror::Object* obj) {
     } else if (LW_LOCK_OWNER(thin) == 0) {
       // The lock is unowned. Install the thread id of the calling thread into the owner field.
       // This is the common case: compiled code will have tried this before calling back into
-      // the runtime.
+      // the runtime. Reserve the lock for the calling thread unless it has been shared before.
+      // Class locks are taken by every thread that initializes the class, so they are not
+      // reserved.
+      bool reserve = kUseLockReservation && !revoked && !obj->IsClass();
       newThin = thin | (threadId << LW_LOCK_OWNER_SHIFT);
+      if (reserve) {
+        newThin |= LW_LOCK_RESERVED | (1 << LW_LOCK_COUNT_SHIFT);
+      }
       if (android_atomic_acquire_cas(thin, newThin, thinp) != 0) {
         // The acquire failed. Try again.
         goto retry;
       }
+      if (revoked) {
+        // Inflate the lock so that it is not reserved again.
+        Inflate(self, obj);
+      }
     } else {
       VLOG(monitor) << StringPrintf("monitor: thread %d spin on lock %p (a %s) owned by %d",
                                     threadId, thinp, PrettyTypeOf(obj).c_str(), LW_LOCK_OWNER(thin));
       // The lock is owned by another thread. Notify the runtime that we are about to wait.
       self->monitor_enter_object_ = obj;
       self->TransitionFromRunnableToSuspended(kBlocked);
+      uint64_t wait_start_ns = (contention_stats_ != NULL) ? NanoTime() : 0;
       // Spin until the thin lock is released or inflated.
       sleepDelayNs = 0;
+      uint32_t spins = 0;
       for (;;) {
         thin = *thinp;
         // Check the shape of the lock word. Another thread
         // may have inflated the lock while we were waiting.
-        if (LW_SHAPE(thin) == LW_SHAPE_THIN) {
+        if (LW_SHAPE(thin) == LW_SHAPE_THIN && !LW_IS_RESERVED(thin)) {
           if (LW_LOCK_OWNER(thin) == 0) {
             // The lock has been released. Install the thread id of the
             // calling thread into the owner field.
@@ -653,8 +1022,12 @@ void Monitor::MonitorEnter(Thread* self, mirror::Object* obj) {
               break;
             }
           } else {
-            // The lock has not been released. Yield so the owning thread can run.
-            if (sleepDelayNs == 0) {
+            // The lock has not been released. Spin for a while in case it is about to be, then
+            // yield so the owning thread can run.
+            if (spin_on_contention_ && spins < kThinLockSpinRounds) {
+              SpinFor(std::min(1U << spins, kMaxSpinBackoff));
+              ++spins;
+            } else if (sleepDelayNs == 0) {
               sched_yield();
               sleepDelayNs = minSleepDelayNs;
             } else {
@@ -668,8 +1041,8 @@ void Monitor::MonitorEnter(Thread* self, mirror::Object* obj) {
             }
           }
         } else {
-          // The thin lock was inflated by another thread. Let the runtime know we are no longer
-          // waiting and try again.
+          // The thin lock was inflated or reserved by another thread. Let the runtime know we are
+          // no longer waiting and try again.
           VLOG(monitor) << StringPrintf("monitor: thread %d found lock %p surprise-fattened by another thread", threadId, thinp);
           self->monitor_enter_object_ = NULL;
           self->TransitionFromSuspendedToRunnable();
@@ -680,6 +1053,12 @@ void Monitor::MonitorEnter(Thread* self, mirror::Object* obj) {
       // We have acquired the thin lock. Let the runtime know that we are no longer waiting.
       self->monitor_enter_object_ = NULL;
       self->TransitionFromSuspendedToRunnable();
+      if (contention_stats_ != NULL) {
+        // Thin locks don't track where they were acquired, so the owner is unknown.
+        uint32_t dex_pc;
+        const mirror::ArtMethod* m = self->GetCurrentMethod(&dex_pc);
+        contention_stats_->Record(NULL, 0, m, dex_pc, NanoTime() - wait_start_ns);
+      }
       // Fatten the lock.
       Inflate(self, obj);
       VLOG(monitor) << StringPrintf("monitor: thread %d fattened lock %p", threadId, thinp);
@@ -711,7 +1090,15 @@ bool Monitor::MonitorExit(Thread* self, mirror::Object* obj) {
      * The lock is thin.  We must ensure that the lock is owned
      * by the given thread before unlocking it.
      */
-    if (LW_LOCK_OWNER(thin) == self->GetThinLockId()) {
+    if (LW_IS_RESERVED(thin)) {
+      if (!IsThinLockHeldBy(thin, self->GetThinLockId())) {
+        FailedUnlock(obj, self, NULL, NULL);
+        return false;
+      }
+      // The calling thread reserved the lock and is the only writer of the lock word. The lock
+      // stays reserved when the count drops to zero.
+      *thinp = thin - (1 << LW_LOCK_COUNT_SHIFT);
+    } else if (LW_LOCK_OWNER(thin) == self->GetThinLockId()) {
       /*
        * We are the lock owner.  It is safe to update the lock
        * without CAS as lock ownership guards the lock itself.
@@ -764,7 +1151,7 @@ void Monitor::Wait(Thread* self, mirror::Object *obj, int64_t ms, int32_t ns,
   uint32_t thin = *thinp;
   if (LW_SHAPE(thin) == LW_SHAPE_THIN) {
     // Make sure that 'self' holds the lock.
-    if (LW_LOCK_OWNER(thin) != self->GetThinLockId()) {
+    if (!IsThinLockHeldBy(thin, self->GetThinLockId())) {
       ThrowIllegalMonitorStateExceptionF("object not locked by thread before wait()");
       return;
     }
@@ -787,7 +1174,7 @@ void Monitor::Notify(Thread* self, mirror::Object *obj) {
   // waiting on an object forces lock fattening.
   if (LW_SHAPE(thin) == LW_SHAPE_THIN) {
     // Make sure that 'self' holds the lock.
-    if (LW_LOCK_OWNER(thin) != self->GetThinLockId()) {
+    if (!IsThinLockHeldBy(thin, self->GetThinLockId())) {
       ThrowIllegalMonitorStateExceptionF("object not locked by thread before notify()");
       return;
     }
@@ -808,7 +1195,7 @@ void Monitor::NotifyAll(Thread* self, mirror::Object *obj) {
   // waiting on an object forces lock fattening.
   if (LW_SHAPE(thin) == LW_SHAPE_THIN) {
     // Make sure that 'self' holds the lock.
-    if (LW_LOCK_OWNER(thin) != self->GetThinLockId()) {
+    if (!IsThinLockHeldBy(thin, self->GetThinLockId())) {
       ThrowIllegalMonitorStateExceptionF("object not locked by thread before notifyAll()");
       return;
     }
@@ -824,6 +1211,9 @@ void Monitor::NotifyAll(Thread* self, mirror::Object *obj) {
 
 uint32_t Monitor::GetThinLockId(uint32_t raw_lock_word) {
   if (LW_SHAPE(raw_lock_word) == LW_SHAPE_THIN) {
+    if (LW_IS_RESERVED(raw_lock_word) && LW_LOCK_COUNT(raw_lock_word) == 0) {
+      return 0;  // Reserved but not held.
+    }
     return LW_LOCK_OWNER(raw_lock_word);
   } else {
     Thread* owner = LW_MONITOR(raw_lock_word)->owner_;
@@ -974,7 +1364,7 @@ bool Monitor::IsValidLockWord(int32_t lock_word) {
 }
 
 void Monitor::TranslateLocation(const mirror::ArtMethod* method, uint32_t dex_pc,
-                                const char*& source_file, uint32_t& line_number) const {
+                                const char*& source_file, uint32_t& line_number) {
   // If method is null, location is unknown
   if (method == NULL) {
     source_file = "";
@@ -989,6 +1379,16 @@ void Monitor::TranslateLocation(const mirror::ArtMethod* method, uint32_t dex_pc
   line_number = mh.GetLineNumFromDexPC(dex_pc);
 }
 
+bool Monitor::IsContentionStatsEnabled() {
+  return contention_stats_ != NULL;
+}
+
+void Monitor::DumpContentionStats(std::ostream& os) {
+  if (contention_stats_ != NULL) {
+    contention_stats_->Dump(os);
+  }
+}
+
 MonitorList::MonitorList()
     : allow_new_monitors_(true), monitor_list_lock_("MonitorList lock"),
       monitor_add_condition_("MonitorList disallow condition", monitor_list_lock_) {
@@ -1020,14 +1420,30 @@ void MonitorList::Add(Monitor* m) {
   list_.push_front(m);
 }
 
-void MonitorList::SweepMonitorList(IsMarkedTester is_marked, void* arg) {
-  MutexLock mu(Thread::Current(), monitor_list_lock_);
+void MonitorList::SweepMonitorList(IsMarkedTester is_marked, void* arg, bool deflate_idle) {
+  Thread* self = Thread::Current();
+  MutexLock mu(self, monitor_list_lock_);
+  if (deflate_idle) {
+    // Threads may hold on to a monitor they read from a lock word until they lock it.
+    Locks::mutator_lock_->AssertExclusiveHeld(self);
+  }
   for (auto it = list_.begin(); it != list_.end(); ) {
     Monitor* m = *it;
     if (!is_marked(m->GetObject(), arg)) {
       VLOG(monitor) << "freeing monitor " << m << " belonging to unmarked object " << m->GetObject();
       delete m;
       it = list_.erase(it);
+    } else if (deflate_idle && m->owner_ == NULL && m->num_waiters_ == 0) {
+      // Nobody holds or waits for the monitor, turn the lock back into an unowned thin lock.
+      DCHECK(m->wait_set_ == NULL);
+      DCHECK(m->notified_ == NULL);
+      mirror::Object* obj = m->GetObject();
+      VLOG(monitor) << "deflating monitor " << m << " of object " << obj;
+      uint32_t hash_state = *obj->GetRawLockWordAddress() &
+          (LW_HASH_STATE_MASK << LW_HASH_STATE_SHIFT);
+      delete m;
+      *obj->GetRawLockWordAddress() = hash_state;
+      it = list_.erase(it);
     } else {
       ++it;
     }
@@ -1037,10 +1453,11 @@ void MonitorList::SweepMonitorList(IsMarkedTester is_marked, void* arg) {
 MonitorInfo::MonitorInfo(mirror::Object* o) : owner(NULL), entry_count(0) {
   uint32_t lock_word = *o->GetRawLockWordAddress();
   if (LW_SHAPE(lock_word) == LW_SHAPE_THIN) {
-    uint32_t owner_thin_lock_id = LW_LOCK_OWNER(lock_word);
+    uint32_t owner_thin_lock_id = Monitor::GetThinLockId(lock_word);
     if (owner_thin_lock_id != 0) {
       owner = Runtime::Current()->GetThreadList()->FindThreadByThinLockId(owner_thin_lock_id);
-      entry_count = 1 + LW_LOCK_COUNT(lock_word);
+      // A reserved lock counts the holds, a plain one the recursive acquisitions.
+      entry_count = LW_LOCK_COUNT(lock_word) + (LW_IS_RESERVED(lock_word) ? 0 : 1);
     }
     // Thin locks have no waiters.
   } else {
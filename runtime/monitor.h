@@ -59,6 +59,7 @@ namespace mirror {
   class ArtMethod;
   class Object;
 }  // namespace mirror
+class MonitorContentionStats;
 class Thread;
 class StackVisitor;
 
@@ -67,7 +68,13 @@ class Monitor {
   ~Monitor();
 
   static bool IsSensitiveThread();
-  static void Init(uint32_t lock_profiling_threshold, bool (*is_sensitive_thread_hook)());
+  static void Init(uint32_t lock_profiling_threshold, bool (*is_sensitive_thread_hook)(),
+                   bool contention_stats);
+
+  // Aggregated contention by call site, collected when run with -XX:LockContentionStats.
+  static bool IsContentionStatsEnabled();
+  static void DumpContentionStats(std::ostream& os)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   static uint32_t GetThinLockId(uint32_t raw_lock_word)
       NO_THREAD_SAFETY_ANALYSIS;  // Reading lock owner without holding lock is racy.
@@ -110,10 +117,16 @@ class Monitor {
 
   void AppendToWaitSet(Thread* thread) EXCLUSIVE_LOCKS_REQUIRED(monitor_lock_);
   void RemoveFromWaitSet(Thread* thread) EXCLUSIVE_LOCKS_REQUIRED(monitor_lock_);
+  // Wakes the threads notified while the monitor was held, just before it's released.
+  void SignalNotifiedThreads() EXCLUSIVE_LOCKS_REQUIRED(monitor_lock_);
 
   static void Inflate(Thread* self, mirror::Object* obj)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Revokes the reservation of the object's lock by another thread, running a checkpoint on it.
+  static void RevokeReservation(Thread* self, mirror::Object* obj, uint32_t owner_id)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   void LogContentionEvent(Thread* self, uint32_t wait_ms, uint32_t sample_percent,
                           const char* owner_filename, uint32_t owner_line_number)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -123,6 +136,8 @@ class Monitor {
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   void Lock(Thread* self) EXCLUSIVE_LOCK_FUNCTION(monitor_lock_);
+  // Spins on the monitor lock while it is held by a running thread, returns whether it got it.
+  bool SpinLock(Thread* self) NO_THREAD_SAFETY_ANALYSIS;
   bool Unlock(Thread* thread, bool for_wait) UNLOCK_FUNCTION(monitor_lock_);
 
   void Notify(Thread* self) NO_THREAD_SAFETY_ANALYSIS;
@@ -143,12 +158,19 @@ class Monitor {
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   // Translates the provided method and pc into its declaring class' source file and line number.
-  void TranslateLocation(const mirror::ArtMethod* method, uint32_t pc,
-                         const char*& source_file, uint32_t& line_number) const
+  static void TranslateLocation(const mirror::ArtMethod* method, uint32_t pc,
+                                const char*& source_file, uint32_t& line_number)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Whether lock owners and wait times are tracked, for sampled logging or contention stats.
+  static bool IsLockProfilingEnabled() {
+    return lock_profiling_threshold_ != 0 || contention_stats_ != NULL;
+  }
+
   static bool (*is_sensitive_thread_hook_)();
   static uint32_t lock_profiling_threshold_;
+  static bool spin_on_contention_;
+  static MonitorContentionStats* contention_stats_;
 
   Mutex monitor_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
 
@@ -161,8 +183,14 @@ class Monitor {
   // What object are we part of (for debugging).
   mirror::Object* const obj_;
 
-  // Threads currently waiting on this monitor.
+  // Threads currently waiting on this monitor, in the order they started waiting.
   Thread* wait_set_ GUARDED_BY(monitor_lock_);
+  Thread* wait_set_tail_ GUARDED_BY(monitor_lock_);
+
+  // Threads taken off the wait set by notify and notifyAll. They're only woken when the monitor is
+  // released, so that they don't wake up just to block on the monitor again.
+  Thread* notified_ GUARDED_BY(monitor_lock_);
+  Thread* notified_tail_ GUARDED_BY(monitor_lock_);
 
   // Method and dex pc where the lock owner acquired the lock, used when lock
   // sampling is enabled. locking_method_ may be null if the lock is currently
@@ -170,6 +198,13 @@ class Monitor {
   const mirror::ArtMethod* locking_method_ GUARDED_BY(monitor_lock_);
   uint32_t locking_dex_pc_ GUARDED_BY(monitor_lock_);
 
+  // How many rounds a contending thread spins before blocking.
+  volatile uint32_t spin_rounds_;
+
+  // Threads blocked on or waiting on the monitor. The monitor isn't deflated while there are any.
+  volatile int32_t num_waiters_;
+
+  friend class MonitorContentionStats;
   friend class MonitorInfo;
   friend class MonitorList;
   friend class mirror::Object;
@@ -182,7 +217,10 @@ class MonitorList {
   ~MonitorList();
 
   void Add(Monitor* m);
-  void SweepMonitorList(IsMarkedTester is_marked, void* arg)
+  // Frees the monitors of unmarked objects. If deflate_idle is set, which requires all other
+  // threads to be suspended, the monitors nobody holds or waits for are also freed and their
+  // objects get a thin lock again.
+  void SweepMonitorList(IsMarkedTester is_marked, void* arg, bool deflate_idle)
       SHARED_LOCKS_REQUIRED(Locks::heap_bitmap_lock_);
   void DisallowNewMonitors();
   void AllowNewMonitors();
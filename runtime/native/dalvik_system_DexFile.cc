@@ -160,14 +160,18 @@ static jclass DexFile_defineClassNative(JNIEnv* env, jclass, jstring javaName, j
     return NULL;
   }
   const std::string descriptor(DotToDescriptor(class_name.c_str()));
-  const DexFile::ClassDef* dex_class_def = dex_file->FindClassDef(descriptor.c_str());
+  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+  mirror::ClassLoader* class_loader = soa.Decode<mirror::ClassLoader*>(javaLoader);
+  const DexFile::ClassDef* dex_class_def;
+  {
+    ScopedClassLoadTimer timer(class_linker, class_loader, "DexLookup");
+    dex_class_def = dex_file->FindClassDef(descriptor.c_str());
+  }
   if (dex_class_def == NULL) {
     VLOG(class_linker) << "Failed to find dex_class_def";
     return NULL;
   }
-  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
   class_linker->RegisterDexFile(*dex_file);
-  mirror::ClassLoader* class_loader = soa.Decode<mirror::ClassLoader*>(javaLoader);
   mirror::Class* result = class_linker->DefineClass(descriptor.c_str(), class_loader, *dex_file,
                                                     *dex_class_def);
   VLOG(class_linker) << "DexFile_defineClassNative returning " << result;
@@ -193,6 +197,42 @@ static jobjectArray DexFile_getClassNameList(JNIEnv* env, jclass, jint cookie) {
   return toStringArray(env, class_names);
 }
 
+// Hands the named classes, or all of the dex file's classes if javaClassNames is null, to the
+// class linker's prelink threads so that they are linked before the app gets to them.
+static void DexFile_prelinkClasses(JNIEnv* env, jclass, jint cookie, jobject javaLoader,
+                                   jobjectArray javaClassNames) {
+  const DexFile* dex_file;
+  {
+    ScopedObjectAccess soa(env);
+    dex_file = toDexFile(cookie);
+  }
+  if (dex_file == NULL) {
+    return;
+  }
+
+  std::vector<std::string> descriptors;
+  if (javaClassNames == NULL) {
+    for (size_t i = 0; i < dex_file->NumClassDefs(); ++i) {
+      const DexFile::ClassDef& class_def = dex_file->GetClassDef(i);
+      descriptors.push_back(dex_file->GetClassDescriptor(class_def));
+    }
+  } else {
+    const jsize count = env->GetArrayLength(javaClassNames);
+    for (jsize i = 0; i < count; ++i) {
+      ScopedLocalRef<jstring> javaName(env,
+          reinterpret_cast<jstring>(env->GetObjectArrayElement(javaClassNames, i)));
+      NullableScopedUtfChars name(env, javaName.get());
+      if (env->ExceptionCheck()) {
+        return;
+      }
+      if (name.c_str() != NULL) {
+        descriptors.push_back(DotToDescriptor(name.c_str()));
+      }
+    }
+  }
+  Runtime::Current()->GetClassLinker()->PrelinkClasses(env, javaLoader, descriptors);
+}
+
 static jboolean DexFile_isDexOptNeeded(JNIEnv* env, jclass, jstring javaFilename) {
   bool debug_logging = false;
 
@@ -311,6 +351,7 @@ static JNINativeMethod gMethods[] = {
   NATIVE_METHOD(DexFile, defineClassNative, "(Ljava/lang/String;Ljava/lang/ClassLoader;I)Ljava/lang/Class;"),
   NATIVE_METHOD(DexFile, getClassNameList, "(I)[Ljava/lang/String;"),
   NATIVE_METHOD(DexFile, isDexOptNeeded, "(Ljava/lang/String;)Z"),
+  NATIVE_METHOD(DexFile, prelinkClasses, "(ILjava/lang/ClassLoader;[Ljava/lang/String;)V"),
   NATIVE_METHOD(DexFile, openDexFileNative, "(Ljava/lang/String;Ljava/lang/String;I)I"),
 };
 
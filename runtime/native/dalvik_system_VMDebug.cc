@@ -17,15 +17,19 @@
 #include <string.h>
 #include <unistd.h>
 
+#include "alloc_profiler.h"
+#include "base/stringprintf.h"
 #include "class_linker.h"
 #include "common_throws.h"
 #include "debugger.h"
+#include "gc/heap.h"
 #include "gc/space/dlmalloc_space.h"
 #include "gc/space/large_object_space.h"
 #include "gc/space/space-inl.h"
 #include "hprof/hprof.h"
 #include "jni_internal.h"
 #include "mirror/class.h"
+#include "monitor.h"
 #include "ScopedUtfChars.h"
 #include "scoped_thread_state_change.h"
 #include "toStringArray.h"
@@ -55,6 +59,33 @@ static jint VMDebug_getAllocCount(JNIEnv*, jclass, jint kind) {
   return Runtime::Current()->GetStat(kind);
 }
 
+// The hardware performance counters sampled around GC, class loading and JIT compilation when the
+// runtime runs with -Xperf-counters. kind is KIND_GLOBAL_PERF_COUNTERS or KIND_THREAD_PERF_COUNTERS,
+// the layout of data is given by PerfPhase and PerfCounter. They are reset by resetAllocCount.
+static jboolean VMDebug_getPerfCounters(JNIEnv* env, jclass, jint kind, jlongArray data) {
+  const size_t count = kPerfPhaseCount * kPerfCounterCount;
+  if (!Runtime::Current()->HasPerfCountersEnabled() || data == NULL ||
+      env->GetArrayLength(data) < static_cast<jsize>(count)) {
+    return JNI_FALSE;
+  }
+  RuntimeStats* stats;
+  if (kind == KIND_GLOBAL_PERF_COUNTERS) {
+    stats = Runtime::Current()->GetStats();
+  } else if (kind == KIND_THREAD_PERF_COUNTERS) {
+    stats = Thread::Current()->GetStats();
+  } else {
+    return JNI_FALSE;
+  }
+  jlong values[count];
+  for (size_t i = 0; i < kPerfPhaseCount; ++i) {
+    for (size_t j = 0; j < kPerfCounterCount; ++j) {
+      values[i * kPerfCounterCount + j] = static_cast<jlong>(stats->perf_counts[i][j]);
+    }
+  }
+  env->SetLongArrayRegion(data, 0, count, values);
+  return JNI_TRUE;
+}
+
 static void VMDebug_resetAllocCount(JNIEnv*, jclass, jint kinds) {
   Runtime::Current()->ResetStats(kinds);
 }
@@ -166,13 +197,7 @@ static jlong VMDebug_threadCpuTimeNanos(JNIEnv*, jclass) {
   return ThreadCpuNanoTime();
 }
 
-/*
- * static void dumpHprofData(String fileName, FileDescriptor fd)
- *
- * Cause "hprof" data to be dumped.  We can throw an IOException if an
- * error occurs during file handling.
- */
-static void VMDebug_dumpHprofData(JNIEnv* env, jclass, jstring javaFilename, jobject javaFd) {
+static void DumpHprofData(JNIEnv* env, jstring javaFilename, jobject javaFd, bool compact) {
   // Only one of these may be NULL.
   if (javaFilename == NULL && javaFd == NULL) {
     ScopedObjectAccess soa(env);
@@ -201,11 +226,62 @@ static void VMDebug_dumpHprofData(JNIEnv* env, jclass, jstring javaFilename, job
     }
   }
 
-  hprof::DumpHeap(filename.c_str(), fd, false);
+  hprof::DumpHeap(filename.c_str(), fd, false, compact);
+}
+
+/*
+ * static void dumpHprofData(String fileName, FileDescriptor fd)
+ *
+ * Cause "hprof" data to be dumped.  We can throw an IOException if an
+ * error occurs during file handling.
+ */
+static void VMDebug_dumpHprofData(JNIEnv* env, jclass, jstring javaFilename, jobject javaFd) {
+  DumpHprofData(env, javaFilename, javaFd, false);
+}
+
+/*
+ * static void dumpHprofDataCompact(String fileName, FileDescriptor fd)
+ *
+ * Like dumpHprofData, but in the smaller compact format, which hprofexpand
+ * converts to a standard hprof file.
+ */
+static void VMDebug_dumpHprofDataCompact(JNIEnv* env, jclass, jstring javaFilename,
+                                         jobject javaFd) {
+  DumpHprofData(env, javaFilename, javaFd, true);
+}
+
+static void VMDebug_startAllocSampling(JNIEnv* env, jclass, jint intervalBytes) {
+  if (intervalBytes <= 0) {
+    ScopedObjectAccess soa(env);
+    ThrowIllegalArgumentException(NULL, StringPrintf("Invalid sampling interval: %d",
+                                                     intervalBytes).c_str());
+    return;
+  }
+  AllocProfiler::Start(intervalBytes);
+}
+
+static void VMDebug_stopAllocSampling(JNIEnv*, jclass) {
+  AllocProfiler::Stop();
+}
+
+/*
+ * static void dumpAllocSamples(String fileName)
+ *
+ * Write the allocation samples to a file in pprof's heap profile format.
+ */
+static void VMDebug_dumpAllocSamples(JNIEnv* env, jclass, jstring javaFilename) {
+  ScopedUtfChars filename(env, javaFilename);
+  if (filename.c_str() == NULL) {
+    return;
+  }
+  ScopedObjectAccess soa(env);
+  if (!AllocProfiler::DumpToFile(filename.c_str())) {
+    ThrowRuntimeException("Unable to write allocation samples to '%s'", filename.c_str());
+  }
 }
 
 static void VMDebug_dumpHprofDataDdms(JNIEnv*, jclass) {
-  hprof::DumpHeap("[DDMS]", -1, true);
+  hprof::DumpHeap("[DDMS]", -1, true, false);
 }
 
 static void VMDebug_dumpReferenceTables(JNIEnv* env, jclass) {
@@ -218,6 +294,25 @@ static void VMDebug_dumpReferenceTables(JNIEnv* env, jclass) {
   LOG(INFO) << "---";
 }
 
+static void VMDebug_dumpClassLoadTimings(JNIEnv* env, jclass) {
+  ScopedObjectAccess soa(env);
+  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+  if (!class_linker->IsClassLoadTimingEnabled()) {
+    LOG(INFO) << "Class load timing is disabled, run with -XX:ClassLoadTiming";
+    return;
+  }
+  class_linker->DumpClassLoadTimings(LOG(INFO));
+}
+
+static void VMDebug_dumpLockContentionStats(JNIEnv* env, jclass) {
+  ScopedObjectAccess soa(env);
+  if (!Monitor::IsContentionStatsEnabled()) {
+    LOG(INFO) << "Lock contention stats are disabled, run with -XX:LockContentionStats";
+    return;
+  }
+  Monitor::DumpContentionStats(LOG(INFO));
+}
+
 static void VMDebug_crash(JNIEnv*, jclass) {
   LOG(FATAL) << "Crashing runtime on request";
 }
@@ -303,16 +398,48 @@ static void VMDebug_getHeapSpaceStats(JNIEnv* env, jclass, jlongArray data) {
   env->ReleasePrimitiveArrayCritical(data, arr, 0);
 }
 
+// Cumulative per-collector GC metrics (iterations, total and paused time, freed objects and
+// bytes, throughput and pause/duration percentiles) so that they can be monitored without
+// parsing the SIGQUIT dump. The layout of data is given by gc::GcStat.
+static jobjectArray VMDebug_getGcCollectorNames(JNIEnv* env, jclass) {
+  std::vector<std::string> names;
+  Runtime::Current()->GetHeap()->GetGcCollectorNames(&names);
+  return toStringArray(env, names);
+}
+
+static jboolean VMDebug_getGcStats(JNIEnv* env, jclass, jint collector, jlongArray data) {
+  if (collector < 0 || data == NULL || env->GetArrayLength(data) < gc::kGcStatCount) {
+    return JNI_FALSE;
+  }
+  uint64_t stats[gc::kGcStatCount];
+  if (!Runtime::Current()->GetHeap()->GetGcStats(Thread::Current(), collector, stats)) {
+    return JNI_FALSE;
+  }
+  jlong values[gc::kGcStatCount];
+  for (size_t i = 0; i < gc::kGcStatCount; ++i) {
+    values[i] = static_cast<jlong>(stats[i]);
+  }
+  env->SetLongArrayRegion(data, 0, gc::kGcStatCount, values);
+  return JNI_TRUE;
+}
+
 static JNINativeMethod gMethods[] = {
   NATIVE_METHOD(VMDebug, countInstancesOfClass, "(Ljava/lang/Class;Z)J"),
   NATIVE_METHOD(VMDebug, crash, "()V"),
+  NATIVE_METHOD(VMDebug, dumpAllocSamples, "(Ljava/lang/String;)V"),
+  NATIVE_METHOD(VMDebug, dumpClassLoadTimings, "()V"),
   NATIVE_METHOD(VMDebug, dumpHprofData, "(Ljava/lang/String;Ljava/io/FileDescriptor;)V"),
+  NATIVE_METHOD(VMDebug, dumpHprofDataCompact, "(Ljava/lang/String;Ljava/io/FileDescriptor;)V"),
   NATIVE_METHOD(VMDebug, dumpHprofDataDdms, "()V"),
+  NATIVE_METHOD(VMDebug, dumpLockContentionStats, "()V"),
   NATIVE_METHOD(VMDebug, dumpReferenceTables, "()V"),
   NATIVE_METHOD(VMDebug, getAllocCount, "(I)I"),
+  NATIVE_METHOD(VMDebug, getGcCollectorNames, "()[Ljava/lang/String;"),
+  NATIVE_METHOD(VMDebug, getGcStats, "(I[J)Z"),
   NATIVE_METHOD(VMDebug, getHeapSpaceStats, "([J)V"),
   NATIVE_METHOD(VMDebug, getInstructionCount, "([I)V"),
   NATIVE_METHOD(VMDebug, getLoadedClassCount, "()I"),
+  NATIVE_METHOD(VMDebug, getPerfCounters, "(I[J)Z"),
   NATIVE_METHOD(VMDebug, getVmFeatureList, "()[Ljava/lang/String;"),
   NATIVE_METHOD(VMDebug, infopoint, "(I)V"),
   NATIVE_METHOD(VMDebug, isDebuggerConnected, "()Z"),
@@ -323,12 +450,14 @@ static JNINativeMethod gMethods[] = {
   NATIVE_METHOD(VMDebug, resetAllocCount, "(I)V"),
   NATIVE_METHOD(VMDebug, resetInstructionCount, "()V"),
   NATIVE_METHOD(VMDebug, startAllocCounting, "()V"),
+  NATIVE_METHOD(VMDebug, startAllocSampling, "(I)V"),
   NATIVE_METHOD(VMDebug, startEmulatorTracing, "()V"),
   NATIVE_METHOD(VMDebug, startInstructionCounting, "()V"),
   NATIVE_METHOD(VMDebug, startMethodTracingDdmsImpl, "(IIZI)V"),
   NATIVE_METHOD(VMDebug, startMethodTracingFd, "(Ljava/lang/String;Ljava/io/FileDescriptor;II)V"),
   NATIVE_METHOD(VMDebug, startMethodTracingFilename, "(Ljava/lang/String;II)V"),
   NATIVE_METHOD(VMDebug, stopAllocCounting, "()V"),
+  NATIVE_METHOD(VMDebug, stopAllocSampling, "()V"),
   NATIVE_METHOD(VMDebug, stopEmulatorTracing, "()V"),
   NATIVE_METHOD(VMDebug, stopInstructionCounting, "()V"),
   NATIVE_METHOD(VMDebug, stopMethodTracing, "()V"),
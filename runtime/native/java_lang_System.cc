@@ -61,7 +61,6 @@
  * testing for unaligned values and punting to memmove(), but that's
  * not currently useful.)
  *
- * TODO: add loop for 64-bit alignment
  * TODO: use __builtin_prefetch
  * TODO: write ARM/MIPS/x86 optimized versions
  */
@@ -113,6 +112,26 @@ void MemmoveWords(void* dst, const void* src, size_t n) {
       }
     }
 
+    // Copy 64-bit aligned double words if the buffers are congruent, aligning them with one
+    // word first if needed. The compiler may use paired or SIMD loads and stores for them, all
+    // of which access each aligned word atomically.
+    if ((((reinterpret_cast<uintptr_t>(d) ^ reinterpret_cast<uintptr_t>(s)) & 0x07) == 0) &&
+        (n >= 2 * sizeof(uint64_t))) {
+      if ((reinterpret_cast<uintptr_t>(d) & 0x07) != 0) {
+        *reinterpret_cast<uint32_t*>(d) = *reinterpret_cast<const uint32_t*>(s);
+        d += sizeof(uint32_t);
+        s += sizeof(uint32_t);
+        n -= sizeof(uint32_t);
+      }
+      copyCount = n / sizeof(uint64_t);
+      n -= copyCount * sizeof(uint64_t);
+      while (copyCount--) {
+        *reinterpret_cast<uint64_t*>(d) = *reinterpret_cast<const uint64_t*>(s);
+        d += sizeof(uint64_t);
+        s += sizeof(uint64_t);
+      }
+    }
+
     // Copy 32-bit aligned words.
     copyCount = n / sizeof(uint32_t);
     while (copyCount--) {
@@ -147,6 +166,24 @@ void MemmoveWords(void* dst, const void* src, size_t n) {
       }
     }
 
+    // Copy 64-bit aligned double words, as above.
+    if ((((reinterpret_cast<uintptr_t>(d) ^ reinterpret_cast<uintptr_t>(s)) & 0x07) == 0) &&
+        (n >= 2 * sizeof(uint64_t))) {
+      if ((reinterpret_cast<uintptr_t>(d) & 0x07) != 0) {
+        d -= sizeof(uint32_t);
+        s -= sizeof(uint32_t);
+        n -= sizeof(uint32_t);
+        *reinterpret_cast<uint32_t*>(d) = *reinterpret_cast<const uint32_t*>(s);
+      }
+      copyCount = n / sizeof(uint64_t);
+      n -= copyCount * sizeof(uint64_t);
+      while (copyCount--) {
+        d -= sizeof(uint64_t);
+        s -= sizeof(uint64_t);
+        *reinterpret_cast<uint64_t*>(d) = *reinterpret_cast<const uint64_t*>(s);
+      }
+    }
+
     // Copy 32-bit aligned words.
     copyCount = n / sizeof(uint32_t);
     while (copyCount--) {
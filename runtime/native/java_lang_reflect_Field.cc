@@ -21,48 +21,56 @@
 #include "jni_internal.h"
 #include "mirror/art_field-inl.h"
 #include "mirror/class-inl.h"
+#include "mirror/object-inl.h"
 #include "object_utils.h"
 #include "reflection.h"
+#include "reflective_field_cache.h"
 #include "scoped_thread_state_change.h"
 
 namespace art {
 
-static bool GetFieldValue(const ScopedObjectAccess& soa, mirror::Object* o, mirror::ArtField* f,
-                          JValue& value, bool allow_references)
+// Makes sure the declaring class of the field is initialized. Checking the class first keeps the
+// common case to a load.
+static bool EnsureDeclaringClassInitialized(const ReflectiveFieldInfo& info)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  if (LIKELY(info.declaring_class->IsInitialized())) {
+    return true;
+  }
+  return Runtime::Current()->GetClassLinker()->EnsureInitialized(info.declaring_class, true, true);
+}
+
+static bool GetFieldValue(const ScopedObjectAccess& soa, mirror::Object* o,
+                          const ReflectiveFieldInfo& info, JValue& value, bool allow_references)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
   DCHECK_EQ(value.GetJ(), 0LL);
-  if (!Runtime::Current()->GetClassLinker()->EnsureInitialized(f->GetDeclaringClass(),
-                                                               true, true)) {
+  if (!EnsureDeclaringClassInitialized(info)) {
     return false;
   }
-  switch (FieldHelper(f).GetTypeAsPrimitiveType()) {
+  MemberOffset offset(info.offset);
+  switch (info.type) {
   case Primitive::kPrimBoolean:
-    value.SetZ(f->GetBoolean(o));
+    value.SetZ(o->GetField32(offset, info.is_volatile));
     return true;
   case Primitive::kPrimByte:
-    value.SetB(f->GetByte(o));
+    value.SetB(o->GetField32(offset, info.is_volatile));
     return true;
   case Primitive::kPrimChar:
-    value.SetC(f->GetChar(o));
-    return true;
-  case Primitive::kPrimDouble:
-    value.SetD(f->GetDouble(o));
+    value.SetC(o->GetField32(offset, info.is_volatile));
     return true;
-  case Primitive::kPrimFloat:
-    value.SetF(f->GetFloat(o));
+  case Primitive::kPrimShort:
+    value.SetS(o->GetField32(offset, info.is_volatile));
     return true;
   case Primitive::kPrimInt:
-    value.SetI(f->GetInt(o));
+  case Primitive::kPrimFloat:
+    value.SetI(o->GetField32(offset, info.is_volatile));
     return true;
   case Primitive::kPrimLong:
-    value.SetJ(f->GetLong(o));
-    return true;
-  case Primitive::kPrimShort:
-    value.SetS(f->GetShort(o));
+  case Primitive::kPrimDouble:
+    value.SetJ(o->GetField64(offset, info.is_volatile));
     return true;
   case Primitive::kPrimNot:
     if (allow_references) {
-      value.SetL(f->GetObject(o));
+      value.SetL(o->GetFieldObject<mirror::Object*>(offset, info.is_volatile));
       return true;
     }
     // Else break to report an error.
@@ -73,246 +81,250 @@ static bool GetFieldValue(const ScopedObjectAccess& soa, mirror::Object* o, mirr
   }
   ThrowIllegalArgumentException(NULL,
                                 StringPrintf("Not a primitive field: %s",
-                                             PrettyField(f).c_str()).c_str());
+                                             PrettyField(info.field).c_str()).c_str());
   return false;
 }
 
-static bool CheckReceiver(const ScopedObjectAccess& soa, jobject j_rcvr, mirror::ArtField* f,
-                          mirror::Object*& class_or_rcvr)
+static bool CheckReceiver(const ScopedObjectAccess& soa, jobject j_rcvr,
+                          const ReflectiveFieldInfo& info, mirror::Object*& class_or_rcvr)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
-  if (f->IsStatic()) {
-    class_or_rcvr = f->GetDeclaringClass();
+  if (info.is_static) {
+    class_or_rcvr = info.declaring_class;
     return true;
   }
 
   class_or_rcvr = soa.Decode<mirror::Object*>(j_rcvr);
-  mirror::Class* declaringClass = f->GetDeclaringClass();
-  if (!VerifyObjectInClass(class_or_rcvr, declaringClass)) {
+  if (!VerifyObjectInClass(class_or_rcvr, info.declaring_class)) {
     return false;
   }
   return true;
 }
 
+static const ReflectiveFieldInfo& GetFieldInfo(const ScopedObjectAccess& soa, jobject javaField)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  mirror::ArtField* f = soa.DecodeField(soa.Env()->FromReflectedField(javaField));
+  return soa.Self()->GetReflectiveFieldCache()->Get(f);
+}
+
 static jobject Field_get(JNIEnv* env, jobject javaField, jobject javaObj) {
   ScopedObjectAccess soa(env);
-  mirror::ArtField* f = soa.DecodeField(env->FromReflectedField(javaField));
+  const ReflectiveFieldInfo& info = GetFieldInfo(soa, javaField);
   mirror::Object* o = NULL;
-  if (!CheckReceiver(soa, javaObj, f, o)) {
+  if (!CheckReceiver(soa, javaObj, info, o)) {
     return NULL;
   }
 
   // Get the field's value, boxing if necessary.
   JValue value;
-  if (!GetFieldValue(soa, o, f, value, true)) {
+  if (!GetFieldValue(soa, o, info, value, true)) {
     return NULL;
   }
-  return
-      soa.AddLocalReference<jobject>(BoxPrimitive(FieldHelper(f).GetTypeAsPrimitiveType(), value));
+  return soa.AddLocalReference<jobject>(BoxPrimitive(info.type, value));
 }
 
 static JValue GetPrimitiveField(JNIEnv* env, jobject javaField, jobject javaObj,
-                                char dst_descriptor) {
+                                Primitive::Type dst_type) {
   ScopedObjectAccess soa(env);
-  mirror::ArtField* f = soa.DecodeField(env->FromReflectedField(javaField));
+  const ReflectiveFieldInfo& info = GetFieldInfo(soa, javaField);
   mirror::Object* o = NULL;
-  if (!CheckReceiver(soa, javaObj, f, o)) {
+  if (!CheckReceiver(soa, javaObj, info, o)) {
     return JValue();
   }
 
   // Read the value.
   JValue field_value;
-  if (!GetFieldValue(soa, o, f, field_value, false)) {
+  if (!GetFieldValue(soa, o, info, field_value, false)) {
     return JValue();
   }
 
   // Widen it if necessary (and possible).
+  if (LIKELY(info.type == dst_type)) {
+    return field_value;
+  }
   JValue wide_value;
-  mirror::Class* dst_type =
-      Runtime::Current()->GetClassLinker()->FindPrimitiveClass(dst_descriptor);
-  if (!ConvertPrimitiveValue(NULL, false, FieldHelper(f).GetTypeAsPrimitiveType(),
-                             dst_type->GetPrimitiveType(), field_value, wide_value)) {
+  if (!ConvertPrimitiveValue(NULL, false, info.type, dst_type, field_value, wide_value)) {
     return JValue();
   }
   return wide_value;
 }
 
 static jboolean Field_getBoolean(JNIEnv* env, jobject javaField, jobject javaObj) {
-  return GetPrimitiveField(env, javaField, javaObj, 'Z').GetZ();
+  return GetPrimitiveField(env, javaField, javaObj, Primitive::kPrimBoolean).GetZ();
 }
 
 static jbyte Field_getByte(JNIEnv* env, jobject javaField, jobject javaObj) {
-  return GetPrimitiveField(env, javaField, javaObj, 'B').GetB();
+  return GetPrimitiveField(env, javaField, javaObj, Primitive::kPrimByte).GetB();
 }
 
 static jchar Field_getChar(JNIEnv* env, jobject javaField, jobject javaObj) {
-  return GetPrimitiveField(env, javaField, javaObj, 'C').GetC();
+  return GetPrimitiveField(env, javaField, javaObj, Primitive::kPrimChar).GetC();
 }
 
 static jdouble Field_getDouble(JNIEnv* env, jobject javaField, jobject javaObj) {
-  return GetPrimitiveField(env, javaField, javaObj, 'D').GetD();
+  return GetPrimitiveField(env, javaField, javaObj, Primitive::kPrimDouble).GetD();
 }
 
 static jfloat Field_getFloat(JNIEnv* env, jobject javaField, jobject javaObj) {
-  return GetPrimitiveField(env, javaField, javaObj, 'F').GetF();
+  return GetPrimitiveField(env, javaField, javaObj, Primitive::kPrimFloat).GetF();
 }
 
 static jint Field_getInt(JNIEnv* env, jobject javaField, jobject javaObj) {
-  return GetPrimitiveField(env, javaField, javaObj, 'I').GetI();
+  return GetPrimitiveField(env, javaField, javaObj, Primitive::kPrimInt).GetI();
 }
 
 static jlong Field_getLong(JNIEnv* env, jobject javaField, jobject javaObj) {
-  return GetPrimitiveField(env, javaField, javaObj, 'J').GetJ();
+  return GetPrimitiveField(env, javaField, javaObj, Primitive::kPrimLong).GetJ();
 }
 
 static jshort Field_getShort(JNIEnv* env, jobject javaField, jobject javaObj) {
-  return GetPrimitiveField(env, javaField, javaObj, 'S').GetS();
+  return GetPrimitiveField(env, javaField, javaObj, Primitive::kPrimShort).GetS();
 }
 
-static void SetFieldValue(mirror::Object* o, mirror::ArtField* f, const JValue& new_value,
-                          bool allow_references)
+static void SetFieldValue(mirror::Object* o, const ReflectiveFieldInfo& info,
+                          const JValue& new_value, bool allow_references)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
-  if (!Runtime::Current()->GetClassLinker()->EnsureInitialized(f->GetDeclaringClass(),
-                                                               true, true)) {
+  if (!EnsureDeclaringClassInitialized(info)) {
     return;
   }
-  switch (FieldHelper(f).GetTypeAsPrimitiveType()) {
+  MemberOffset offset(info.offset);
+  switch (info.type) {
   case Primitive::kPrimBoolean:
-    f->SetBoolean(o, new_value.GetZ());
+    o->SetField32(offset, new_value.GetZ(), info.is_volatile);
     break;
   case Primitive::kPrimByte:
-    f->SetByte(o, new_value.GetB());
+    o->SetField32(offset, new_value.GetB(), info.is_volatile);
     break;
   case Primitive::kPrimChar:
-    f->SetChar(o, new_value.GetC());
+    o->SetField32(offset, new_value.GetC(), info.is_volatile);
     break;
-  case Primitive::kPrimDouble:
-    f->SetDouble(o, new_value.GetD());
-    break;
-  case Primitive::kPrimFloat:
-    f->SetFloat(o, new_value.GetF());
+  case Primitive::kPrimShort:
+    o->SetField32(offset, new_value.GetS(), info.is_volatile);
     break;
   case Primitive::kPrimInt:
-    f->SetInt(o, new_value.GetI());
+  case Primitive::kPrimFloat:
+    o->SetField32(offset, new_value.GetI(), info.is_volatile);
     break;
   case Primitive::kPrimLong:
-    f->SetLong(o, new_value.GetJ());
-    break;
-  case Primitive::kPrimShort:
-    f->SetShort(o, new_value.GetS());
+  case Primitive::kPrimDouble:
+    o->SetField64(offset, new_value.GetJ(), info.is_volatile);
     break;
   case Primitive::kPrimNot:
     if (allow_references) {
-      f->SetObject(o, new_value.GetL());
+      o->SetFieldObject(offset, new_value.GetL(), info.is_volatile);
       break;
     }
     // Else fall through to report an error.
   case Primitive::kPrimVoid:
     // Never okay.
     ThrowIllegalArgumentException(NULL, StringPrintf("Not a primitive field: %s",
-                                                     PrettyField(f).c_str()).c_str());
+                                                     PrettyField(info.field).c_str()).c_str());
     return;
   }
 
   // Special handling for final fields on SMP systems.
   // We need a store/store barrier here (JMM requirement).
-  if (f->IsFinal()) {
+  if (info.is_final) {
     ANDROID_MEMBAR_STORE();
   }
 }
 
 static void Field_set(JNIEnv* env, jobject javaField, jobject javaObj, jobject javaValue) {
   ScopedObjectAccess soa(env);
-  mirror::ArtField* f = soa.DecodeField(env->FromReflectedField(javaField));
+  const ReflectiveFieldInfo& info = GetFieldInfo(soa, javaField);
 
   // Unbox the value, if necessary.
+  mirror::Class* type_class = info.type_class;
+  if (UNLIKELY(type_class == NULL)) {
+    type_class = FieldHelper(info.field).GetType();
+    if (type_class == NULL) {
+      return;
+    }
+  }
   mirror::Object* boxed_value = soa.Decode<mirror::Object*>(javaValue);
   JValue unboxed_value;
-  if (!UnboxPrimitiveForField(boxed_value, FieldHelper(f).GetType(), unboxed_value, f)) {
+  if (!UnboxPrimitiveForField(boxed_value, type_class, unboxed_value, info.field)) {
     return;
   }
 
   // Check that the receiver is non-null and an instance of the field's declaring class.
   mirror::Object* o = NULL;
-  if (!CheckReceiver(soa, javaObj, f, o)) {
+  if (!CheckReceiver(soa, javaObj, info, o)) {
     return;
   }
 
-  SetFieldValue(o, f, unboxed_value, true);
+  SetFieldValue(o, info, unboxed_value, true);
 }
 
-static void SetPrimitiveField(JNIEnv* env, jobject javaField, jobject javaObj, char src_descriptor,
-                              const JValue& new_value) {
+static void SetPrimitiveField(JNIEnv* env, jobject javaField, jobject javaObj,
+                              Primitive::Type src_type, const JValue& new_value) {
   ScopedObjectAccess soa(env);
-  mirror::ArtField* f = soa.DecodeField(env->FromReflectedField(javaField));
+  const ReflectiveFieldInfo& info = GetFieldInfo(soa, javaField);
   mirror::Object* o = NULL;
-  if (!CheckReceiver(soa, javaObj, f, o)) {
+  if (!CheckReceiver(soa, javaObj, info, o)) {
     return;
   }
-  FieldHelper fh(f);
-  if (!fh.IsPrimitiveType()) {
+  if (info.type == Primitive::kPrimNot) {
     ThrowIllegalArgumentException(NULL, StringPrintf("Not a primitive field: %s",
-                                                     PrettyField(f).c_str()).c_str());
+                                                     PrettyField(info.field).c_str()).c_str());
     return;
   }
 
   // Widen the value if necessary (and possible).
   JValue wide_value;
-  mirror::Class* src_type = Runtime::Current()->GetClassLinker()->FindPrimitiveClass(src_descriptor);
-  if (!ConvertPrimitiveValue(NULL, false, src_type->GetPrimitiveType(), fh.GetTypeAsPrimitiveType(),
-                             new_value, wide_value)) {
+  if (!ConvertPrimitiveValue(NULL, false, src_type, info.type, new_value, wide_value)) {
     return;
   }
 
   // Write the value.
-  SetFieldValue(o, f, wide_value, false);
+  SetFieldValue(o, info, wide_value, false);
 }
 
 static void Field_setBoolean(JNIEnv* env, jobject javaField, jobject javaObj, jboolean z) {
   JValue value;
   value.SetZ(z);
-  SetPrimitiveField(env, javaField, javaObj, 'Z', value);
+  SetPrimitiveField(env, javaField, javaObj, Primitive::kPrimBoolean, value);
 }
 
 static void Field_setByte(JNIEnv* env, jobject javaField, jobject javaObj, jbyte b) {
   JValue value;
   value.SetB(b);
-  SetPrimitiveField(env, javaField, javaObj, 'B', value);
+  SetPrimitiveField(env, javaField, javaObj, Primitive::kPrimByte, value);
 }
 
 static void Field_setChar(JNIEnv* env, jobject javaField, jobject javaObj, jchar c) {
   JValue value;
   value.SetC(c);
-  SetPrimitiveField(env, javaField, javaObj, 'C', value);
+  SetPrimitiveField(env, javaField, javaObj, Primitive::kPrimChar, value);
 }
 
 static void Field_setDouble(JNIEnv* env, jobject javaField, jobject javaObj, jdouble d) {
   JValue value;
   value.SetD(d);
-  SetPrimitiveField(env, javaField, javaObj, 'D', value);
+  SetPrimitiveField(env, javaField, javaObj, Primitive::kPrimDouble, value);
 }
 
 static void Field_setFloat(JNIEnv* env, jobject javaField, jobject javaObj, jfloat f) {
   JValue value;
   value.SetF(f);
-  SetPrimitiveField(env, javaField, javaObj, 'F', value);
+  SetPrimitiveField(env, javaField, javaObj, Primitive::kPrimFloat, value);
 }
 
 static void Field_setInt(JNIEnv* env, jobject javaField, jobject javaObj, jint i) {
   JValue value;
   value.SetI(i);
-  SetPrimitiveField(env, javaField, javaObj, 'I', value);
+  SetPrimitiveField(env, javaField, javaObj, Primitive::kPrimInt, value);
 }
 
 static void Field_setLong(JNIEnv* env, jobject javaField, jobject javaObj, jlong j) {
   JValue value;
   value.SetJ(j);
-  SetPrimitiveField(env, javaField, javaObj, 'J', value);
+  SetPrimitiveField(env, javaField, javaObj, Primitive::kPrimLong, value);
 }
 
 static void Field_setShort(JNIEnv* env, jobject javaField, jobject javaObj, jshort s) {
   JValue value;
   value.SetS(s);
-  SetPrimitiveField(env, javaField, javaObj, 'S', value);
+  SetPrimitiveField(env, javaField, javaObj, Primitive::kPrimShort, value);
 }
 
 static JNINativeMethod gMethods[] = {
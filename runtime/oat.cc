@@ -22,7 +22,7 @@
 namespace art {
 
 const uint8_t OatHeader::kOatMagic[] = { 'o', 'a', 't', '\n' };
-const uint8_t OatHeader::kOatVersion[] = { '0', '0', '7', '\0' };
+const uint8_t OatHeader::kOatVersion[] = { '0', '1', '7', '\0' };
 
 OatHeader::OatHeader() {
   memset(this, 0, sizeof(*this));
@@ -57,6 +57,9 @@ OatHeader::OatHeader(InstructionSet instruction_set,
   UpdateChecksum(image_file_location.data(), image_file_location_size_);
 
   executable_offset_ = 0;
+  hot_code_end_offset_ = 0;
+  method_hooks_ = 0;
+  relative_calls_ = 0;
   interpreter_to_interpreter_bridge_offset_ = 0;
   interpreter_to_compiled_code_bridge_offset_ = 0;
   jni_dlsym_lookup_offset_ = 0;
@@ -114,6 +117,46 @@ void OatHeader::SetExecutableOffset(uint32_t executable_offset) {
   UpdateChecksum(&executable_offset_, sizeof(executable_offset));
 }
 
+uint32_t OatHeader::GetHotCodeEndOffset() const {
+  DCHECK(IsValid());
+  return hot_code_end_offset_;
+}
+
+void OatHeader::SetHotCodeEndOffset(uint32_t offset) {
+  CHECK_GE(offset, executable_offset_);
+  DCHECK(IsValid());
+  DCHECK_EQ(hot_code_end_offset_, 0U);
+
+  hot_code_end_offset_ = offset;
+  UpdateChecksum(&hot_code_end_offset_, sizeof(offset));
+}
+
+bool OatHeader::HasMethodHooks() const {
+  DCHECK(IsValid());
+  return method_hooks_ != 0;
+}
+
+void OatHeader::SetMethodHooks() {
+  DCHECK(IsValid());
+  DCHECK_EQ(method_hooks_, 0U);
+
+  method_hooks_ = 1;
+  UpdateChecksum(&method_hooks_, sizeof(method_hooks_));
+}
+
+bool OatHeader::HasRelativeCalls() const {
+  DCHECK(IsValid());
+  return relative_calls_ != 0;
+}
+
+void OatHeader::SetRelativeCalls() {
+  DCHECK(IsValid());
+  DCHECK_EQ(relative_calls_, 0U);
+
+  relative_calls_ = 1;
+  UpdateChecksum(&relative_calls_, sizeof(relative_calls_));
+}
+
 const void* OatHeader::GetInterpreterToInterpreterBridge() const {
   return reinterpret_cast<const uint8_t*>(this) + GetInterpreterToInterpreterBridgeOffset();
 }
@@ -47,6 +47,17 @@ class PACKED(4) OatHeader {
   }
   uint32_t GetExecutableOffset() const;
   void SetExecutableOffset(uint32_t executable_offset);
+  // The end of the code of the hot methods, which follows the trampolines at the executable
+  // offset, or 0 if the compiler had no code order.
+  uint32_t GetHotCodeEndOffset() const;
+  void SetHotCodeEndOffset(uint32_t offset);
+  // Whether the compiled code calls the method entry and exit hooks of the thread.
+  bool HasMethodHooks() const;
+  void SetMethodHooks();
+  // Whether the compiled code calls direct methods of its own class with PC-relative branches,
+  // passing the callee's Method* from the dex cache, see ClassLinker::LoadClass.
+  bool HasRelativeCalls() const;
+  void SetRelativeCalls();
 
   const void* GetInterpreterToInterpreterBridge() const;
   uint32_t GetInterpreterToInterpreterBridgeOffset() const;
@@ -88,6 +99,9 @@ class PACKED(4) OatHeader {
   InstructionSet instruction_set_;
   uint32_t dex_file_count_;
   uint32_t executable_offset_;
+  uint32_t hot_code_end_offset_;
+  uint32_t method_hooks_;
+  uint32_t relative_calls_;
   uint32_t interpreter_to_interpreter_bridge_offset_;
   uint32_t interpreter_to_compiled_code_bridge_offset_;
   uint32_t jni_dlsym_lookup_offset_;
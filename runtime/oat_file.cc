@@ -17,9 +17,11 @@
 #include "oat_file.h"
 
 #include <dlfcn.h>
+#include <sys/mman.h>
 
 #include "base/stl_util.h"
 #include "base/unix_file/fd_file.h"
+#include "dex_file_lookup_table.h"
 #include "elf_file.h"
 #include "oat.h"
 #include "mirror/art_method.h"
@@ -60,7 +62,8 @@ OatFile* OatFile::OpenMemory(std::vector<uint8_t>& oat_contents,
 OatFile* OatFile::Open(const std::string& filename,
                        const std::string& location,
                        byte* requested_base,
-                       bool executable) {
+                       bool executable,
+                       ptrdiff_t relocation_delta) {
   CHECK(!filename.empty()) << location;
   CheckLocation(filename);
 #ifdef ART_USE_PORTABLE_COMPILER
@@ -70,6 +73,10 @@ OatFile* OatFile::Open(const std::string& filename,
   // open a generated dex file by name, remove the file, then open
   // another generated dex file with the same name. http://b/10614658
   if (executable) {
+    if (relocation_delta != 0) {
+      LOG(WARNING) << "Cannot relocate " << filename << " loaded with dlopen";
+      return NULL;
+    }
     return OpenDlopen(filename, location, requested_base);
   }
 #endif
@@ -83,12 +90,12 @@ OatFile* OatFile::Open(const std::string& filename,
   if (file.get() == NULL) {
     return NULL;
   }
-  return OpenElfFile(file.get(), location, requested_base, false, executable);
+  return OpenElfFile(file.get(), location, requested_base, false, executable, relocation_delta);
 }
 
 OatFile* OatFile::OpenWritable(File* file, const std::string& location) {
   CheckLocation(location);
-  return OpenElfFile(file, location, NULL, true, false);
+  return OpenElfFile(file, location, NULL, true, false, 0);
 }
 
 OatFile* OatFile::OpenDlopen(const std::string& elf_filename,
@@ -106,9 +113,11 @@ OatFile* OatFile::OpenElfFile(File* file,
                               const std::string& location,
                               byte* requested_base,
                               bool writable,
-                              bool executable) {
+                              bool executable,
+                              ptrdiff_t relocation_delta) {
   UniquePtr<OatFile> oat_file(new OatFile(location));
-  bool success = oat_file->ElfFileOpen(file, requested_base, writable, executable);
+  bool success = oat_file->ElfFileOpen(file, requested_base, writable, executable,
+                                       relocation_delta);
   if (!success) {
     return NULL;
   }
@@ -163,7 +172,8 @@ bool OatFile::Dlopen(const std::string& elf_filename, byte* requested_base) {
   return Setup();
 }
 
-bool OatFile::ElfFileOpen(File* file, byte* requested_base, bool writable, bool executable) {
+bool OatFile::ElfFileOpen(File* file, byte* requested_base, bool writable, bool executable,
+                          ptrdiff_t relocation_delta) {
   elf_file_.reset(ElfFile::Open(file, writable, true));
   if (elf_file_.get() == NULL) {
     if (writable) {
@@ -171,7 +181,7 @@ bool OatFile::ElfFileOpen(File* file, byte* requested_base, bool writable, bool
     }
     return false;
   }
-  bool loaded = elf_file_->Load(executable);
+  bool loaded = elf_file_->Load(executable, relocation_delta);
   if (!loaded) {
     LOG(WARNING) << "Failed to load ELF file " << file->GetPath();
     return false;
@@ -290,6 +300,30 @@ bool OatFile::Setup() {
       return false;
     }
     const DexFile::Header* header = reinterpret_cast<const DexFile::Header*>(dex_file_pointer);
+
+    uint32_t lookup_table_offset = *reinterpret_cast<const uint32_t*>(oat);
+    if (lookup_table_offset == 0U || lookup_table_offset > Size()) {
+      LOG(ERROR) << "In oat file " << GetLocation() << " found OatDexFile # " << i
+                 << " for "<< dex_file_location
+                 << " with invalid lookup table offset " << lookup_table_offset;
+      return false;
+    }
+    oat += sizeof(lookup_table_offset);
+    if (oat > End()) {
+      LOG(ERROR) << "In oat file " << GetLocation() << " found OatDexFile # " << i
+                 << " for "<< dex_file_location
+                 << " truncated after lookup table offset";
+      return false;
+    }
+    const uint8_t* lookup_table_pointer = Begin() + lookup_table_offset;
+    if (!DexFileLookupTable::IsValid(lookup_table_pointer, Size() - lookup_table_offset,
+                                     header->class_defs_size_, header->string_ids_size_)) {
+      LOG(ERROR) << "In oat file " << GetLocation() << " found OatDexFile # " << i
+                 << " for "<< dex_file_location
+                 << " with invalid lookup table";
+      return false;
+    }
+
     const uint32_t* methods_offsets_pointer = reinterpret_cast<const uint32_t*>(oat);
 
     oat += (sizeof(*methods_offsets_pointer) * header->class_defs_size_);
@@ -304,6 +338,7 @@ bool OatFile::Setup() {
                                                          dex_file_location,
                                                          dex_file_checksum,
                                                          dex_file_pointer,
+                                                         lookup_table_pointer,
                                                          methods_offsets_pointer));
   }
   return true;
@@ -313,6 +348,46 @@ const OatHeader& OatFile::GetOatHeader() const {
   return *reinterpret_cast<const OatHeader*>(Begin());
 }
 
+bool OatFile::Relocate(const uint32_t* offsets, size_t count, int32_t delta) {
+  CHECK(elf_file_.get() != NULL) << location_;
+  if (!elf_file_->SetLoadedSegmentsWritable(true)) {
+    return false;
+  }
+  byte* begin = const_cast<byte*>(begin_);
+  for (size_t i = 0; i < count; ++i) {
+    CHECK_LE(offsets[i] + sizeof(uint32_t), Size()) << location_;
+    *reinterpret_cast<uint32_t*>(begin + offsets[i]) += delta;
+  }
+  __builtin___clear_cache(reinterpret_cast<char*>(begin), reinterpret_cast<char*>(begin + Size()));
+  return elf_file_->SetLoadedSegmentsWritable(false);
+}
+
+static void MadviseRange(const byte* begin, const byte* end, int advice,
+                         const std::string& location) {
+  uintptr_t page_begin = RoundDown(reinterpret_cast<uintptr_t>(begin), kPageSize);
+  uintptr_t page_end = RoundUp(reinterpret_cast<uintptr_t>(end), kPageSize);
+  if (page_begin < page_end &&
+      madvise(reinterpret_cast<void*>(page_begin), page_end - page_begin, advice) == -1) {
+    PLOG(WARNING) << "madvise failed for " << location;
+  }
+}
+
+void OatFile::Madvise(int text_advice, int data_advice, bool prefetch_hot_code) const {
+  const OatHeader& oat_header = GetOatHeader();
+  const byte* text_begin = Begin() + oat_header.GetExecutableOffset();
+  if (data_advice != MADV_NORMAL) {
+    MadviseRange(Begin(), text_begin, data_advice, location_);
+  }
+  if (text_advice != MADV_NORMAL) {
+    MadviseRange(text_begin, End(), text_advice, location_);
+  }
+  // MADV_WILLNEED only schedules the read ahead, it does not wait for it.
+  if (prefetch_hot_code && oat_header.GetHotCodeEndOffset() != 0) {
+    MadviseRange(text_begin, Begin() + oat_header.GetHotCodeEndOffset(), MADV_WILLNEED,
+                 location_);
+  }
+}
+
 const byte* OatFile::Begin() const {
   CHECK(begin_ != NULL);
   return begin_;
@@ -360,11 +435,13 @@ OatFile::OatDexFile::OatDexFile(const OatFile* oat_file,
                                 const std::string& dex_file_location,
                                 uint32_t dex_file_location_checksum,
                                 const byte* dex_file_pointer,
+                                const byte* lookup_table_pointer,
                                 const uint32_t* oat_class_offsets_pointer)
     : oat_file_(oat_file),
       dex_file_location_(dex_file_location),
       dex_file_location_checksum_(dex_file_location_checksum),
       dex_file_pointer_(dex_file_pointer),
+      lookup_table_pointer_(lookup_table_pointer),
       oat_class_offsets_pointer_(oat_class_offsets_pointer) {}
 
 OatFile::OatDexFile::~OatDexFile() {}
@@ -375,7 +452,7 @@ size_t OatFile::OatDexFile::FileSize() const {
 
 const DexFile* OatFile::OatDexFile::OpenDexFile() const {
   return DexFile::Open(dex_file_pointer_, FileSize(), dex_file_location_,
-                       dex_file_location_checksum_);
+                       dex_file_location_checksum_, lookup_table_pointer_);
 }
 
 const OatFile::OatClass* OatFile::OatDexFile::GetOatClass(uint16_t class_def_index) const {
@@ -386,17 +463,27 @@ const OatFile::OatClass* OatFile::OatDexFile::GetOatClass(uint16_t class_def_ind
   mirror::Class::Status status = *reinterpret_cast<const mirror::Class::Status*>(oat_class_pointer);
 
   const byte* methods_pointer = oat_class_pointer + sizeof(status);
+  const uint32_t* methods_to_verify = NULL;
+  if (status == mirror::Class::kStatusRetryVerificationAtRuntime) {
+    // The word count and bitmap of the methods that soft failed verification at compile time.
+    const uint32_t* methods_to_verify_size = reinterpret_cast<const uint32_t*>(methods_pointer);
+    methods_to_verify = methods_to_verify_size + 1;
+    methods_pointer = reinterpret_cast<const byte*>(methods_to_verify + *methods_to_verify_size);
+  }
   CHECK_LT(methods_pointer, oat_file_->End()) << oat_file_->GetLocation();
 
   return new OatClass(oat_file_,
                       status,
+                      methods_to_verify,
                       reinterpret_cast<const OatMethodOffsets*>(methods_pointer));
 }
 
 OatFile::OatClass::OatClass(const OatFile* oat_file,
                             mirror::Class::Status status,
+                            const uint32_t* methods_to_verify,
                             const OatMethodOffsets* methods_pointer)
-    : oat_file_(oat_file), status_(status), methods_pointer_(methods_pointer) {}
+    : oat_file_(oat_file), status_(status), methods_to_verify_(methods_to_verify),
+      methods_pointer_(methods_pointer) {}
 
 OatFile::OatClass::~OatClass() {}
 
@@ -417,6 +504,14 @@ const OatFile::OatMethod OatFile::OatClass::GetOatMethod(uint32_t method_index)
       oat_method_offsets.gc_map_offset_);
 }
 
+bool OatFile::OatClass::HasMethodHooks() const {
+  return oat_file_->GetOatHeader().HasMethodHooks();
+}
+
+bool OatFile::OatClass::HasRelativeCalls() const {
+  return oat_file_->GetOatHeader().HasRelativeCalls();
+}
+
 OatFile::OatMethod::OatMethod(const byte* base,
                               const uint32_t code_offset,
                               const size_t frame_size_in_bytes,
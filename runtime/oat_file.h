@@ -42,10 +42,13 @@ class OatFile {
 
   // Open an oat file. Returns NULL on failure.  Requested base can
   // optionally be used to request where the file should be loaded.
+  // A non-zero relocation delta loads a fixed address file that many
+  // bytes from where it was linked, see Relocate.
   static OatFile* Open(const std::string& filename,
                        const std::string& location,
                        byte* requested_base,
-                       bool executable);
+                       bool executable,
+                       ptrdiff_t relocation_delta = 0);
 
   // Open an oat file from an already opened File.
   // Does not use dlopen underneath so cannot be used for runtime use
@@ -66,6 +69,14 @@ class OatFile {
 
   const OatHeader& GetOatHeader() const;
 
+  // Adds delta to the words at the given offsets from the oat header, the absolute addresses in the
+  // code of a file opened with a relocation delta.
+  bool Relocate(const uint32_t* offsets, size_t count, int32_t delta);
+
+  // Passes access pattern hints for the code and the data of the oat file to madvise(2), and
+  // optionally starts reading in the code of the hot methods in the background.
+  void Madvise(int text_advice, int data_advice, bool prefetch_hot_code) const;
+
   class OatDexFile;
 
   class OatMethod {
@@ -145,20 +156,37 @@ class OatFile {
    public:
     mirror::Class::Status GetStatus() const;
 
+    // Returns a bitmap indexed like GetOatMethod with the bits of the methods that soft failed
+    // verification at compile time set, only those have to be verified at runtime. NULL unless
+    // the status is kStatusRetryVerificationAtRuntime.
+    const uint32_t* GetMethodsToVerify() const {
+      return methods_to_verify_;
+    }
+
     // get the OatMethod entry based on its index into the class
     // defintion. direct methods come first, followed by virtual
     // methods. note that runtime created methods such as miranda
     // methods are not included.
     const OatMethod GetOatMethod(uint32_t method_index) const;
+
+    // Whether the compiled code of the methods calls the method entry and exit hooks.
+    bool HasMethodHooks() const;
+
+    // Whether the compiled code of the methods branches directly to the direct methods of the
+    // class, which then have to be in the dex cache before any of the code runs.
+    bool HasRelativeCalls() const;
+
     ~OatClass();
 
    private:
     OatClass(const OatFile* oat_file,
              mirror::Class::Status status,
+             const uint32_t* methods_to_verify,
              const OatMethodOffsets* methods_pointer);
 
     const OatFile* oat_file_;
     const mirror::Class::Status status_;
+    const uint32_t* methods_to_verify_;
     const OatMethodOffsets* methods_pointer_;
 
     friend class OatDexFile;
@@ -192,12 +220,15 @@ class OatFile {
                const std::string& dex_file_location,
                uint32_t dex_file_checksum,
                const byte* dex_file_pointer,
+               const byte* lookup_table_pointer,
                const uint32_t* oat_class_offsets_pointer);
 
     const OatFile* oat_file_;
     std::string dex_file_location_;
     uint32_t dex_file_location_checksum_;
     const byte* dex_file_pointer_;
+    // The DexFileLookupTable serialized for the dex file.
+    const byte* lookup_table_pointer_;
     const uint32_t* oat_class_offsets_pointer_;
 
     friend class OatFile;
@@ -225,11 +256,13 @@ class OatFile {
                               const std::string& location,
                               byte* requested_base,
                               bool writable,
-                              bool executable);
+                              bool executable,
+                              ptrdiff_t relocation_delta);
 
   explicit OatFile(const std::string& filename);
   bool Dlopen(const std::string& elf_filename, byte* requested_base);
-  bool ElfFileOpen(File* file, byte* requested_base, bool writable, bool executable);
+  bool ElfFileOpen(File* file, byte* requested_base, bool writable, bool executable,
+                   ptrdiff_t relocation_delta);
   bool Setup();
 
   const byte* Begin() const;
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "perf_counters.h"
+
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+#include "base/logging.h"
+#include "runtime.h"
+#include "thread.h"
+
+namespace art {
+
+PerfCounters::PerfCounters() : opened_(false) {
+  for (size_t i = 0; i < kPerfCounterCount; ++i) {
+    fds_[i] = -1;
+  }
+  for (size_t i = 0; i < kPerfPhaseCount; ++i) {
+    depth_[i] = 0;
+  }
+}
+
+PerfCounters::~PerfCounters() {
+  for (size_t i = 0; i < kPerfCounterCount; ++i) {
+    if (fds_[i] != -1) {
+      close(fds_[i]);
+    }
+  }
+}
+
+void PerfCounters::Open() {
+  opened_ = true;
+#if defined(__linux__)
+  static const uint64_t kConfigs[kPerfCounterCount] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+  };
+  for (size_t i = 0; i < kPerfCounterCount; ++i) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = kConfigs[i];
+    // Unprivileged processes are usually not allowed to count kernel events.
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // Count the calling thread on any CPU.
+    fds_[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fds_[i] == -1) {
+      PLOG(WARNING) << "Failed to open hardware performance counter " << i;
+    }
+  }
+#endif
+}
+
+void PerfCounters::Read(uint64_t values[kPerfCounterCount]) {
+  if (!opened_) {
+    Open();
+  }
+  for (size_t i = 0; i < kPerfCounterCount; ++i) {
+    values[i] = 0;
+    if (fds_[i] != -1 && read(fds_[i], &values[i], sizeof(values[i])) != sizeof(values[i])) {
+      values[i] = 0;
+    }
+  }
+}
+
+ScopedPerfCounters::ScopedPerfCounters(Thread* self, PerfPhase phase)
+    : self_(self), phase_(phase), counters_(NULL), outermost_(false) {
+  Runtime* runtime = Runtime::Current();
+  if (LIKELY(!runtime->HasPerfCountersEnabled() || !runtime->HasStatsEnabled())) {
+    return;
+  }
+  counters_ = self->GetPerfCounters();
+  if (counters_->depth_[phase]++ == 0) {
+    outermost_ = true;
+    counters_->Read(start_);
+  }
+}
+
+ScopedPerfCounters::~ScopedPerfCounters() {
+  if (LIKELY(counters_ == NULL)) {
+    return;
+  }
+  --counters_->depth_[phase_];
+  if (!outermost_) {
+    return;
+  }
+  uint64_t end[kPerfCounterCount];
+  counters_->Read(end);
+  // Like the other global stats, the global counts are updated without synchronization.
+  uint64_t* global_counts = Runtime::Current()->GetStats()->perf_counts[phase_];
+  uint64_t* thread_counts = self_->GetStats()->perf_counts[phase_];
+  for (size_t i = 0; i < kPerfCounterCount; ++i) {
+    uint64_t delta = end[i] - start_[i];
+    global_counts[i] += delta;
+    thread_counts[i] += delta;
+  }
+}
+
+}  // namespace art
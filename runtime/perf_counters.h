@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_PERF_COUNTERS_H_
+#define ART_RUNTIME_PERF_COUNTERS_H_
+
+#include <stdint.h>
+
+#include "base/macros.h"
+#include "runtime_stats.h"
+
+namespace art {
+
+class Thread;
+
+// The hardware performance counters of a thread, opened with perf_event_open the first time they
+// are read. Counters the kernel or the CPU don't support read as zero.
+class PerfCounters {
+ public:
+  PerfCounters();
+  ~PerfCounters();
+
+  // Reads the current value of every counter into values, opening the counters if necessary. Must
+  // be called on the thread the counters belong to.
+  void Read(uint64_t values[kPerfCounterCount]);
+
+ private:
+  void Open();
+
+  bool opened_;
+  int fds_[kPerfCounterCount];
+  // The number of active ScopedPerfCounters of each phase, only the outermost one is counted.
+  uint32_t depth_[kPerfPhaseCount];
+
+  friend class ScopedPerfCounters;
+
+  DISALLOW_COPY_AND_ASSIGN(PerfCounters);
+};
+
+// Adds the counter deltas of the current thread over the scope to the phase's thread and global
+// RuntimeStats, when stats are enabled and the runtime was started with -Xperf-counters. Phases may
+// nest, a GC during class loading counts towards both.
+class ScopedPerfCounters {
+ public:
+  ScopedPerfCounters(Thread* self, PerfPhase phase);
+  ~ScopedPerfCounters();
+
+ private:
+  Thread* const self_;
+  const PerfPhase phase_;
+  // The counters of the thread, or NULL if sampling is disabled.
+  PerfCounters* counters_;
+  // Whether this is the outermost scope of the phase on the thread.
+  bool outermost_;
+  uint64_t start_[kPerfCounterCount];
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedPerfCounters);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_PERF_COUNTERS_H_
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "profile_file.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "base/logging.h"
+#include "base/stringprintf.h"
+#include "base/unix_file/fd_file.h"
+#include "os.h"
+#include "UniquePtr.h"
+#include "utils.h"
+
+namespace art {
+
+const char ProfileFile::kHeader[] = "art profile 1";
+
+void ProfileFile::AddMethod(const std::string& method, uint32_t samples) {
+  SafeMap<std::string, uint64_t>::iterator it = methods_.find(method);
+  if (it == methods_.end()) {
+    methods_.Put(method, samples);
+  } else {
+    it->second += samples;
+  }
+}
+
+void ProfileFile::AddClass(const std::string& descriptor) {
+  classes_.insert(descriptor);
+}
+
+void ProfileFile::AddReceivers(const std::string& caller, uint32_t dex_pc,
+                               const std::vector<std::string>& descriptors) {
+  receivers_.Overwrite(CallSite(caller, dex_pc), descriptors);
+}
+
+bool ProfileFile::Write(const std::string& filename) const {
+  std::string contents(kHeader);
+  contents += '\n';
+  typedef SafeMap<std::string, uint64_t>::const_iterator MethodIt;
+  for (MethodIt it = methods_.begin(); it != methods_.end(); ++it) {
+    StringAppendF(&contents, "M\t%llu\t%s\n", it->second, it->first.c_str());
+  }
+  for (std::set<std::string>::const_iterator it = classes_.begin(); it != classes_.end(); ++it) {
+    StringAppendF(&contents, "C\t%s\n", it->c_str());
+  }
+  typedef SafeMap<CallSite, std::vector<std::string> >::const_iterator ReceiversIt;
+  for (ReceiversIt it = receivers_.begin(); it != receivers_.end(); ++it) {
+    StringAppendF(&contents, "R\t%s\t%u", it->first.first.c_str(), it->first.second);
+    for (size_t i = 0; i < it->second.size(); ++i) {
+      contents += '\t';
+      contents += it->second[i];
+    }
+    contents += '\n';
+  }
+
+  std::string temp_filename(filename + ".tmp");
+  UniquePtr<File> file(OS::CreateEmptyFile(temp_filename.c_str()));
+  if (file.get() == NULL) {
+    PLOG(WARNING) << "Failed to create profile file " << temp_filename;
+    return false;
+  }
+  if (!file->WriteFully(contents.data(), contents.size()) || file->Close() != 0) {
+    PLOG(WARNING) << "Failed to write profile file " << temp_filename;
+    unlink(temp_filename.c_str());
+    return false;
+  }
+  if (rename(temp_filename.c_str(), filename.c_str()) != 0) {
+    PLOG(WARNING) << "Failed to rename " << temp_filename << " to " << filename;
+    unlink(temp_filename.c_str());
+    return false;
+  }
+  return true;
+}
+
+ProfileFile* ProfileFile::Read(const std::string& filename) {
+  std::string contents;
+  if (!ReadFileToString(filename, &contents)) {
+    PLOG(WARNING) << "Failed to read profile file " << filename;
+    return NULL;
+  }
+  std::vector<std::string> lines;
+  Split(contents, '\n', lines);
+  if (lines.empty() || lines[0] != kHeader) {
+    LOG(WARNING) << filename << " is not a profile";
+    return NULL;
+  }
+  UniquePtr<ProfileFile> profile(new ProfileFile);
+  for (size_t i = 1; i < lines.size(); ++i) {
+    std::vector<std::string> fields;
+    Split(lines[i], '\t', fields);
+    if (fields.size() == 3 && fields[0] == "M") {
+      profile->AddMethod(fields[2], strtoul(fields[1].c_str(), NULL, 10));
+    } else if (fields.size() == 2 && fields[0] == "C") {
+      profile->AddClass(fields[1]);
+    } else if (fields.size() >= 3 && fields[0] == "R") {
+      std::vector<std::string> descriptors(fields.begin() + 3, fields.end());
+      profile->AddReceivers(fields[1], strtoul(fields[2].c_str(), NULL, 10), descriptors);
+    }
+  }
+  return profile.release();
+}
+
+static bool CompareSamples(const std::pair<uint64_t, std::string>& lhs,
+                           const std::pair<uint64_t, std::string>& rhs) {
+  return lhs.first > rhs.first;
+}
+
+void ProfileFile::GetHotMethods(double top_k_percent, std::set<std::string>* hot_methods) const {
+  std::vector<std::string> methods;
+  GetHotMethodsBySamples(top_k_percent, &methods);
+  hot_methods->insert(methods.begin(), methods.end());
+}
+
+void ProfileFile::GetHotMethodsBySamples(double top_k_percent,
+                                         std::vector<std::string>* hot_methods) const {
+  std::vector<std::pair<uint64_t, std::string> > methods;
+  uint64_t total_samples = 0;
+  typedef SafeMap<std::string, uint64_t>::const_iterator MethodIt;
+  for (MethodIt it = methods_.begin(); it != methods_.end(); ++it) {
+    methods.push_back(std::make_pair(it->second, it->first));
+    total_samples += it->second;
+  }
+  std::stable_sort(methods.begin(), methods.end(), CompareSamples);
+  const double hot_samples = total_samples * top_k_percent / 100.0;
+  uint64_t samples = 0;
+  for (size_t i = 0; i < methods.size() && samples < hot_samples; ++i) {
+    hot_methods->push_back(methods[i].second);
+    samples += methods[i].first;
+  }
+}
+
+}  // namespace art
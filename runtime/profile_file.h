@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_PROFILE_FILE_H_
+#define ART_RUNTIME_PROFILE_FILE_H_
+
+#include <stdint.h>
+
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/macros.h"
+#include "safe_map.h"
+
+namespace art {
+
+// The hot methods, hot classes and receiver types of call sites that the runtime saw, written
+// with -XX:ProfileFile and read by dex2oat --profile-file. Methods are named by PrettyMethod so
+// that a profile applies to any build of the same code.
+//
+// The file is text, one tab separated record per line after the header:
+//
+// M <samples> <method>                          samples of an interpreted method
+// C <descriptor>                                class of a sampled method
+// R <caller> <dex pc> <descriptor>...           receiver classes seen by an invoke
+//
+// Unknown records are skipped so that the format can grow.
+class ProfileFile {
+ public:
+  typedef std::pair<std::string, uint32_t> CallSite;
+
+  ProfileFile() {}
+
+  // Adds to the samples of the method.
+  void AddMethod(const std::string& method, uint32_t samples);
+  void AddClass(const std::string& descriptor);
+  void AddReceivers(const std::string& caller, uint32_t dex_pc,
+                    const std::vector<std::string>& descriptors);
+
+  // Writes a temporary file renamed over filename so that dex2oat never reads a partial profile.
+  bool Write(const std::string& filename) const;
+
+  // Returns NULL if the file can't be read or isn't a profile.
+  static ProfileFile* Read(const std::string& filename);
+
+  // Returns the most sampled methods that together account for top_k_percent of all samples.
+  void GetHotMethods(double top_k_percent, std::set<std::string>* hot_methods) const;
+
+  // Likewise, most sampled first.
+  void GetHotMethodsBySamples(double top_k_percent, std::vector<std::string>* hot_methods) const;
+
+  const SafeMap<std::string, uint64_t>& GetMethods() const {
+    return methods_;
+  }
+
+  const std::set<std::string>& GetClasses() const {
+    return classes_;
+  }
+
+  const SafeMap<CallSite, std::vector<std::string> >& GetReceivers() const {
+    return receivers_;
+  }
+
+ private:
+  static const char kHeader[];
+
+  SafeMap<std::string, uint64_t> methods_;
+  std::set<std::string> classes_;
+  SafeMap<CallSite, std::vector<std::string> > receivers_;
+
+  DISALLOW_COPY_AND_ASSIGN(ProfileFile);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_PROFILE_FILE_H_
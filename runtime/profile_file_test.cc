@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "profile_file.h"
+
+#include "common_test.h"
+
+namespace art {
+
+class ProfileFileTest : public CommonTest {};
+
+TEST_F(ProfileFileTest, WriteRead) {
+  ProfileFile profile;
+  profile.AddMethod("int Foo.hot(int)", 60);
+  profile.AddMethod("void Foo.warm()", 30);
+  profile.AddMethod("int Foo.hot(int)", 10);
+  profile.AddMethod("void Foo.cold()", 5);
+  profile.AddClass("LFoo;");
+  std::vector<std::string> receivers;
+  receivers.push_back("LBar;");
+  receivers.push_back("LBaz;");
+  profile.AddReceivers("void Foo.warm()", 4, receivers);
+
+  ScratchFile file;
+  ASSERT_TRUE(profile.Write(file.GetFilename()));
+  UniquePtr<ProfileFile> read(ProfileFile::Read(file.GetFilename()));
+  ASSERT_TRUE(read.get() != NULL);
+  ASSERT_EQ(3U, read->GetMethods().size());
+  EXPECT_EQ(70U, read->GetMethods().Get("int Foo.hot(int)"));
+  EXPECT_EQ(30U, read->GetMethods().Get("void Foo.warm()"));
+  ASSERT_EQ(1U, read->GetClasses().size());
+  EXPECT_EQ("LFoo;", *read->GetClasses().begin());
+  ASSERT_EQ(1U, read->GetReceivers().size());
+  EXPECT_TRUE(read->GetReceivers().Get(ProfileFile::CallSite("void Foo.warm()", 4)) == receivers);
+
+  // The hot method alone has 67% of the samples, the warm one takes the total to 95%.
+  std::set<std::string> hot_methods;
+  read->GetHotMethods(60.0, &hot_methods);
+  ASSERT_EQ(1U, hot_methods.size());
+  EXPECT_EQ(1U, hot_methods.count("int Foo.hot(int)"));
+  hot_methods.clear();
+  read->GetHotMethods(90.0, &hot_methods);
+  EXPECT_EQ(2U, hot_methods.size());
+  EXPECT_EQ(0U, hot_methods.count("void Foo.cold()"));
+
+  std::vector<std::string> hot_methods_by_samples;
+  read->GetHotMethodsBySamples(100.0, &hot_methods_by_samples);
+  ASSERT_EQ(3U, hot_methods_by_samples.size());
+  EXPECT_EQ("int Foo.hot(int)", hot_methods_by_samples[0]);
+  EXPECT_EQ("void Foo.warm()", hot_methods_by_samples[1]);
+  EXPECT_EQ("void Foo.cold()", hot_methods_by_samples[2]);
+}
+
+TEST_F(ProfileFileTest, NotAProfile) {
+  ScratchFile file;
+  ASSERT_TRUE(file.GetFile()->WriteFully("M\t1\tvoid Foo.bar()\n", 19));
+  EXPECT_TRUE(ProfileFile::Read(file.GetFilename()) == NULL);
+}
+
+}  // namespace art
@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "proxy_invoke_cache.h"
+
+#include "mirror/art_method-inl.h"
+#include "object_utils.h"
+
+namespace art {
+
+void ProxyInvokeCache::Compute(mirror::ArtMethod* proxy_method, ProxyInvokePlan* plan) {
+  DCHECK(proxy_method->IsProxyMethod()) << PrettyMethod(proxy_method);
+  MethodHelper proxy_mh(proxy_method);
+  plan->proxy_method = proxy_method;
+  plan->interface_method = proxy_method->FindOverriddenMethod();
+  DCHECK(plan->interface_method != NULL) << PrettyMethod(proxy_method);
+  DCHECK(!plan->interface_method->IsProxyMethod()) << PrettyMethod(plan->interface_method);
+  plan->shorty = proxy_mh.GetShorty();
+  plan->shorty_len = proxy_mh.GetShortyLength();
+}
+
+}  // namespace art
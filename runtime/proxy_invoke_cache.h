@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_PROXY_INVOKE_CACHE_H_
+#define ART_RUNTIME_PROXY_INVOKE_CACHE_H_
+
+#include <stdint.h>
+
+#include "base/macros.h"
+#include "globals.h"
+#include "locks.h"
+
+namespace art {
+namespace mirror {
+  class ArtMethod;
+}  // namespace mirror
+
+// What the proxy invoke handlers need to know about a proxy method: the interface method it
+// implements, which is passed to the InvocationHandler, and the shorty used to box the arguments
+// and unbox the result.
+struct ProxyInvokePlan {
+  ProxyInvokePlan() : proxy_method(NULL), interface_method(NULL), shorty(NULL), shorty_len(0) {}
+
+  const mirror::ArtMethod* proxy_method;
+  mirror::ArtMethod* interface_method;
+  const char* shorty;
+  uint32_t shorty_len;
+};
+
+// A direct mapped cache of the plans of the proxy methods a thread calls, so that a call through a
+// proxy doesn't look for the overridden interface method, which checks it against a search of the
+// proxy class's methods, nor decode the shorty every time. Proxy classes are never unloaded.
+class ProxyInvokeCache {
+ public:
+  ProxyInvokeCache() {}
+
+  const ProxyInvokePlan& Get(mirror::ArtMethod* proxy_method)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    ProxyInvokePlan* plan = &plans_[Index(proxy_method)];
+    if (UNLIKELY(plan->proxy_method != proxy_method)) {
+      Compute(proxy_method, plan);
+    }
+    return *plan;
+  }
+
+  static void Compute(mirror::ArtMethod* proxy_method, ProxyInvokePlan* plan)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+ private:
+  static const size_t kSize = 32;
+
+  static size_t Index(const mirror::ArtMethod* method) {
+    uintptr_t hash = reinterpret_cast<uintptr_t>(method) / kObjectAlignment;
+    return (hash ^ (hash >> 5)) % kSize;
+  }
+
+  ProxyInvokePlan plans_[kSize];
+
+  DISALLOW_COPY_AND_ASSIGN(ProxyInvokeCache);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_PROXY_INVOKE_CACHE_H_
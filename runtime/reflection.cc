@@ -28,6 +28,7 @@
 #include "mirror/object_array.h"
 #include "mirror/object_array-inl.h"
 #include "object_utils.h"
+#include "reflective_invoke_cache.h"
 #include "scoped_thread_state_change.h"
 #include "well_known_classes.h"
 
@@ -53,39 +54,72 @@ jobject InvokeMethod(const ScopedObjectAccess& soa, jobject javaMethod, jobject
 
     // Find the actual implementation of the virtual method.
     m = receiver->GetClass()->FindVirtualMethodForVirtualOrInterface(m);
-    mid = soa.EncodeMethod(m);
   }
 
   // Get our arrays of arguments and their types, and check they're the same size.
+  const ReflectiveInvokePlan* plan = soa.Self()->GetReflectiveInvokeCache()->Get(m);
+  if (plan == NULL) {
+    return NULL;
+  }
   mirror::ObjectArray<mirror::Object>* objects =
       soa.Decode<mirror::ObjectArray<mirror::Object>*>(javaArgs);
-  MethodHelper mh(m);
-  const DexFile::TypeList* classes = mh.GetParameterTypeList();
-  uint32_t classes_size = classes == NULL ? 0 : classes->Size();
   uint32_t arg_count = (objects != NULL) ? objects->GetLength() : 0;
-  if (arg_count != classes_size) {
+  if (arg_count != plan->num_parameters) {
     ThrowIllegalArgumentException(NULL,
                                   StringPrintf("Wrong number of arguments; expected %d, got %d",
-                                               classes_size, arg_count).c_str());
+                                               plan->num_parameters, arg_count).c_str());
     return NULL;
   }
 
-  // Translate javaArgs to a jvalue[].
-  UniquePtr<jvalue[]> args(new jvalue[arg_count]);
-  JValue* decoded_args = reinterpret_cast<JValue*>(args.get());
+  // Unbox javaArgs straight into the arguments of the call.
+  MethodHelper mh(m);
+  const DexFile::TypeList* classes =
+      plan->has_parameter_classes ? NULL : mh.GetParameterTypeList();
+  ArgArray arg_array(plan->shorty, plan->shorty_len);
+  if (receiver != NULL) {
+    arg_array.Append(reinterpret_cast<int32_t>(receiver));
+  }
   for (uint32_t i = 0; i < arg_count; ++i) {
     mirror::Object* arg = objects->Get(i);
-    mirror::Class* dst_class = mh.GetClassFromTypeIdx(classes->GetTypeItem(i).type_idx_);
-    if (!UnboxPrimitiveForArgument(arg, dst_class, decoded_args[i], m, i)) {
+    mirror::Class* dst_class = plan->has_parameter_classes ? plan->parameter_classes[i] :
+        mh.GetClassFromTypeIdx(classes->GetTypeItem(i).type_idx_);
+    if (dst_class == NULL) {
+      return NULL;
+    }
+    JValue decoded_arg;
+    if (!UnboxPrimitiveForArgument(arg, dst_class, decoded_arg, m, i)) {
       return NULL;
     }
-    if (!dst_class->IsPrimitive()) {
-      args[i].l = soa.AddLocalReference<jobject>(arg);
+    switch (plan->shorty[i + 1]) {
+      case 'Z':
+        arg_array.Append(decoded_arg.GetZ());
+        break;
+      case 'B':
+        arg_array.Append(decoded_arg.GetB());
+        break;
+      case 'C':
+        arg_array.Append(decoded_arg.GetC());
+        break;
+      case 'S':
+        arg_array.Append(decoded_arg.GetS());
+        break;
+      case 'I':
+      case 'F':
+        arg_array.Append(decoded_arg.GetI());
+        break;
+      case 'L':
+        arg_array.Append(reinterpret_cast<int32_t>(decoded_arg.GetL()));
+        break;
+      case 'D':
+      case 'J':
+        arg_array.AppendWide(decoded_arg.GetJ());
+        break;
     }
   }
 
   // Invoke the method.
-  JValue value(InvokeWithJValues(soa, javaReceiver, mid, args.get()));
+  JValue value;
+  InvokeWithArgArray(soa, m, &arg_array, &value, plan->shorty[0]);
 
   // Wrap any exception with "Ljava/lang/reflect/InvocationTargetException;" and return early.
   if (soa.Self()->IsExceptionPending()) {
@@ -99,7 +133,7 @@ jobject InvokeMethod(const ScopedObjectAccess& soa, jobject javaMethod, jobject
   }
 
   // Box if necessary and return.
-  return soa.AddLocalReference<jobject>(BoxPrimitive(mh.GetReturnType()->GetPrimitiveType(), value));
+  return soa.AddLocalReference<jobject>(BoxPrimitive(Primitive::GetType(plan->shorty[0]), value));
 }
 
 bool VerifyObjectInClass(mirror::Object* o, mirror::Class* c) {
@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "reflective_field_cache.h"
+
+#include "mirror/art_field-inl.h"
+#include "mirror/class-inl.h"
+#include "object_utils.h"
+
+namespace art {
+
+void ReflectiveFieldCache::Compute(mirror::ArtField* field, ReflectiveFieldInfo* info) {
+  FieldHelper fh(field);
+  info->field = field;
+  info->declaring_class = field->GetDeclaringClass();
+  info->type = fh.GetTypeAsPrimitiveType();
+  // Don't resolve here, reading a reference field doesn't need its type.
+  info->type_class = fh.GetType(false);
+  info->offset = field->GetOffset().Uint32Value();
+  info->is_static = field->IsStatic();
+  info->is_volatile = field->IsVolatile();
+  info->is_final = field->IsFinal();
+}
+
+}  // namespace art
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_REFLECTIVE_FIELD_CACHE_H_
+#define ART_RUNTIME_REFLECTIVE_FIELD_CACHE_H_
+
+#include <stdint.h>
+
+#include "base/macros.h"
+#include "globals.h"
+#include "locks.h"
+#include "primitive.h"
+
+namespace art {
+namespace mirror {
+  class ArtField;
+  class Class;
+}  // namespace mirror
+
+// What the Field natives need to know to read or write a field: where it is, how it is accessed
+// and its type. The type class is NULL for a reference field whose type isn't resolved yet.
+struct ReflectiveFieldInfo {
+  ReflectiveFieldInfo()
+      : field(NULL), declaring_class(NULL), type_class(NULL), offset(0),
+        type(Primitive::kPrimVoid), is_static(false), is_volatile(false), is_final(false) {}
+
+  mirror::ArtField* field;
+  mirror::Class* declaring_class;
+  mirror::Class* type_class;
+  uint32_t offset;
+  Primitive::Type type;
+  bool is_static;
+  bool is_volatile;
+  bool is_final;
+};
+
+// A direct mapped cache of the fields a thread accesses through reflection, so that repeatedly
+// reading or writing the same Field doesn't look up the type descriptor in the dex file every
+// time. Like the ReflectiveInvokeCache, this relies on fields and classes never moving nor being
+// unloaded.
+class ReflectiveFieldCache {
+ public:
+  ReflectiveFieldCache() {}
+
+  const ReflectiveFieldInfo& Get(mirror::ArtField* field)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    ReflectiveFieldInfo* info = &infos_[Index(field)];
+    if (UNLIKELY(info->field != field)) {
+      Compute(field, info);
+    }
+    return *info;
+  }
+
+  static void Compute(mirror::ArtField* field, ReflectiveFieldInfo* info)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+ private:
+  static const size_t kSize = 64;
+
+  static size_t Index(const mirror::ArtField* field) {
+    uintptr_t hash = reinterpret_cast<uintptr_t>(field) / kObjectAlignment;
+    return (hash ^ (hash >> 6)) % kSize;
+  }
+
+  ReflectiveFieldInfo infos_[kSize];
+
+  DISALLOW_COPY_AND_ASSIGN(ReflectiveFieldCache);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_REFLECTIVE_FIELD_CACHE_H_
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "reflective_invoke_cache.h"
+
+#include "dex_file-inl.h"
+#include "mirror/art_method-inl.h"
+#include "mirror/class-inl.h"
+#include "object_utils.h"
+
+namespace art {
+
+bool ReflectiveInvokeCache::Compute(mirror::ArtMethod* method, ReflectiveInvokePlan* plan) {
+  MethodHelper mh(method);
+  plan->method = method;
+  plan->shorty = mh.GetShorty();
+  plan->shorty_len = mh.GetShortyLength();
+  const DexFile::TypeList* classes = mh.GetParameterTypeList();
+  plan->num_parameters = classes == NULL ? 0 : classes->Size();
+  plan->has_parameter_classes = plan->num_parameters <= ReflectiveInvokePlan::kMaxParameters;
+  if (plan->has_parameter_classes) {
+    for (uint32_t i = 0; i < plan->num_parameters; ++i) {
+      mirror::Class* klass = mh.GetClassFromTypeIdx(classes->GetTypeItem(i).type_idx_);
+      if (klass == NULL) {
+        return false;
+      }
+      plan->parameter_classes[i] = klass;
+    }
+  }
+  return true;
+}
+
+}  // namespace art
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_REFLECTIVE_INVOKE_CACHE_H_
+#define ART_RUNTIME_REFLECTIVE_INVOKE_CACHE_H_
+
+#include <stdint.h>
+
+#include "base/macros.h"
+#include "globals.h"
+#include "locks.h"
+
+namespace art {
+namespace mirror {
+  class ArtMethod;
+  class Class;
+}  // namespace mirror
+
+// What Method.invoke needs to know about a method to convert its arguments and result: the shorty
+// and the resolved parameter classes. The classes of methods with more than kMaxParameters
+// parameters are looked up on every call.
+struct ReflectiveInvokePlan {
+  static const size_t kMaxParameters = 8;
+
+  ReflectiveInvokePlan()
+      : method(NULL), shorty(NULL), shorty_len(0), num_parameters(0),
+        has_parameter_classes(false) {}
+
+  const mirror::ArtMethod* method;
+  const char* shorty;
+  uint32_t shorty_len;
+  uint32_t num_parameters;
+  bool has_parameter_classes;
+  mirror::Class* parameter_classes[kMaxParameters];
+};
+
+// A direct mapped cache of the invocation plans of the methods a thread calls through reflection,
+// so that repeatedly invoking the same Method doesn't walk the prototype and resolve the parameter
+// types every time. Like the CatchHandlerCache, this relies on methods and the classes they refer
+// to never moving nor being unloaded.
+class ReflectiveInvokeCache {
+ public:
+  ReflectiveInvokeCache() {}
+
+  // Returns the plan of the method, or NULL with an exception pending if a parameter type can't be
+  // resolved.
+  const ReflectiveInvokePlan* Get(mirror::ArtMethod* method)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    ReflectiveInvokePlan* plan = &plans_[Index(method)];
+    if (UNLIKELY(plan->method != method)) {
+      if (UNLIKELY(!Compute(method, plan))) {
+        plan->method = NULL;
+        return NULL;
+      }
+    }
+    return plan;
+  }
+
+  // Fills in the plan, returning false with an exception pending on failure.
+  static bool Compute(mirror::ArtMethod* method, ReflectiveInvokePlan* plan)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+ private:
+  static const size_t kSize = 32;
+
+  static size_t Index(const mirror::ArtMethod* method) {
+    uintptr_t hash = reinterpret_cast<uintptr_t>(method) / kObjectAlignment;
+    return (hash ^ (hash >> 5)) % kSize;
+  }
+
+  ReflectiveInvokePlan plans_[kSize];
+
+  DISALLOW_COPY_AND_ASSIGN(ReflectiveInvokeCache);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_REFLECTIVE_INVOKE_CACHE_H_
@@ -21,16 +21,20 @@
 #include <linux/fs.h>
 
 #include <signal.h>
+#include <sys/mman.h>
 #include <sys/syscall.h>
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <limits>
+#include <sstream>
 #include <vector>
 
 #include "arch/arm/registers_arm.h"
 #include "arch/mips/registers_mips.h"
 #include "arch/x86/registers_x86.h"
+#include "arch/x86_64/registers_x86_64.h"
 #include "atomic.h"
 #include "class_linker.h"
 #include "debugger.h"
@@ -40,7 +44,10 @@
 #include "image.h"
 #include "instrumentation.h"
 #include "intern_table.h"
+#include "interpreter/inline_cache.h"
+#include "interpreter/quickening.h"
 #include "invoke_arg_array_builder.h"
+#include "jit/jit.h"
 #include "jni_internal.h"
 #include "mirror/art_field-inl.h"
 #include "mirror/art_method-inl.h"
@@ -73,11 +80,21 @@ Runtime::Runtime()
       is_zygote_(false),
       is_concurrent_gc_enabled_(true),
       is_explicit_gc_disabled_(false),
+      relocate_image_(false),
+      image_madvise_(MADV_NORMAL),
+      oat_text_madvise_(MADV_NORMAL),
+      oat_data_madvise_(MADV_NORMAL),
+      prefetch_hot_(false),
+      stack_trace_depth_limit_(0),
       default_stack_size_(0),
+      class_prelink_threads_(0),
       heap_(NULL),
       monitor_list_(NULL),
       thread_list_(NULL),
       intern_table_(NULL),
+      interpreter_inline_caches_(NULL),
+      interpreter_quickened_code_(NULL),
+      jit_(NULL),
       class_linker_(NULL),
       signal_catcher_(NULL),
       java_vm_(NULL),
@@ -89,10 +106,13 @@ Runtime::Runtime()
       shutting_down_started_(false),
       started_(false),
       finished_starting_(false),
+      startup_timings_("Runtime startup", true, false),
+      dump_startup_timings_(false),
       vfprintf_(NULL),
       exit_(NULL),
       abort_(NULL),
       stats_enabled_(false),
+      perf_counters_(false),
       method_trace_(0),
       method_trace_file_size_(0),
       instrumentation_(),
@@ -120,6 +140,10 @@ Runtime::~Runtime() {
   // Make sure to let the GC complete if it is running.
   heap_->WaitForConcurrentGcToComplete(self);
   heap_->DeleteThreadPool();
+  class_linker_->DeletePrelinkThreadPool();
+  if (jit_ != NULL) {
+    jit_->DeleteThreadPool();
+  }
 
   // Make sure our internal threads are dead before we start tearing down things they're using.
   Dbg::StopJdwp();
@@ -131,6 +155,9 @@ Runtime::~Runtime() {
   delete class_linker_;
   delete heap_;
   delete intern_table_;
+  delete interpreter_inline_caches_;
+  delete interpreter_quickened_code_;
+  delete jit_;
   delete java_vm_;
   Thread::Shutdown();
   QuasiAtomic::Shutdown();
@@ -319,6 +346,22 @@ size_t ParseIntegerOrDie(const std::string& s) {
   return result;
 }
 
+// Parses an madvise(2) access pattern hint by name.
+static bool ParseMadviseOption(const std::string& s, int* advice) {
+  if (s == "normal") {
+    *advice = MADV_NORMAL;
+  } else if (s == "random") {
+    *advice = MADV_RANDOM;
+  } else if (s == "sequential") {
+    *advice = MADV_SEQUENTIAL;
+  } else if (s == "willneed") {
+    *advice = MADV_WILLNEED;
+  } else {
+    return false;
+  }
+  return true;
+}
+
 Runtime::ParsedOptions* Runtime::ParsedOptions::Create(const Options& options, bool ignore_unrecognized) {
   UniquePtr<ParsedOptions> parsed(new ParsedOptions());
   const char* boot_class_path_string = getenv("BOOTCLASSPATH");
@@ -331,6 +374,8 @@ Runtime::ParsedOptions* Runtime::ParsedOptions::Create(const Options& options, b
   }
   // -Xcheck:jni is off by default for regular builds but on by default in debug builds.
   parsed->check_jni_ = kIsDebugBuild;
+  parsed->check_jni_lite_ = false;
+  parsed->check_jni_sample_period_ = 64;
 
   parsed->heap_initial_size_ = gc::Heap::kDefaultInitialSize;
   parsed->heap_maximum_size_ = gc::Heap::kDefaultMaximumSize;
@@ -344,6 +389,7 @@ Runtime::ParsedOptions* Runtime::ParsedOptions::Create(const Options& options, b
   parsed->conc_gc_threads_ = 0;
   parsed->stack_size_ = 0;  // 0 means default.
   parsed->low_memory_mode_ = false;
+  parsed->use_huge_pages_ = false;
 
   parsed->is_compiler_ = false;
   parsed->is_zygote_ = false;
@@ -354,6 +400,25 @@ Runtime::ParsedOptions* Runtime::ParsedOptions::Create(const Options& options, b
   parsed->long_pause_log_threshold_ = gc::Heap::kDefaultLongPauseLogThreshold;
   parsed->long_gc_log_threshold_ = gc::Heap::kDefaultLongGCLogThreshold;
   parsed->ignore_max_footprint_ = false;
+  parsed->tlab_size_ = gc::Heap::kDefaultTLABSize;
+  parsed->mark_stack_prefetch_depth_ = gc::Heap::kDefaultMarkStackPrefetchDepth;
+  parsed->gc_throughput_goal_ = 0.0;  // 0 means no throughput goal.
+  parsed->gc_pause_goal_ms_ = 0;  // 0 means no pause goal.
+  parsed->verify_gc_heap_ = false;
+  parsed->heap_verification_fraction_ = 1.0;
+  parsed->class_prelink_threads_ = 0;  // 0 disables class prelinking.
+  parsed->class_load_timing_ = false;
+  parsed->lock_contention_stats_ = false;
+  parsed->startup_timing_ = false;
+  parsed->jit_compile_threshold_ = 0;  // 0 disables compiling at runtime.
+  parsed->profile_period_s_ = 60;
+  parsed->lazy_direct_methods_ = false;
+  parsed->relocate_image_ = false;
+  parsed->image_madvise_ = MADV_NORMAL;
+  parsed->oat_text_madvise_ = MADV_NORMAL;
+  parsed->oat_data_madvise_ = MADV_NORMAL;
+  parsed->prefetch_hot_ = false;
+  parsed->stack_trace_depth_limit_ = 0;  // 0 captures every frame.
 
   parsed->lock_profiling_threshold_ = 0;
   parsed->hook_is_sensitive_thread_ = NULL;
@@ -385,6 +450,8 @@ Runtime::ParsedOptions* Runtime::ParsedOptions::Create(const Options& options, b
   parsed->method_trace_ = false;
   parsed->method_trace_file_ = "/data/method-trace-file.bin";
   parsed->method_trace_file_size_ = 10 * MB;
+  parsed->method_trace_stream_ = false;
+  parsed->perf_counters_ = false;
 
   for (size_t i = 0; i < options.size(); ++i) {
     const std::string option(options[i].first);
@@ -408,8 +475,18 @@ Runtime::ParsedOptions* Runtime::ParsedOptions::Create(const Options& options, b
           = reinterpret_cast<const std::vector<const DexFile*>*>(options[i].second);
     } else if (StartsWith(option, "-Ximage:")) {
       parsed->image_ = option.substr(strlen("-Ximage:")).data();
+    } else if (option == "-Xcheck:jni:lite") {
+      parsed->check_jni_ = true;
+      parsed->check_jni_lite_ = true;
     } else if (StartsWith(option, "-Xcheck:jni")) {
       parsed->check_jni_ = true;
+      parsed->check_jni_lite_ = false;
+    } else if (StartsWith(option, "-Xjnisampleperiod:")) {
+      parsed->check_jni_sample_period_ = ParseIntegerOrDie(option);
+      if (parsed->check_jni_sample_period_ == 0) {
+        LOG(FATAL) << "Invalid sample period in " << option;
+        return NULL;
+      }
     } else if (StartsWith(option, "-Xrunjdwp:") || StartsWith(option, "-agentlib:jdwp=")) {
       std::string tail(option.substr(option[1] == 'X' ? 10 : 15));
       if (tail == "help" || !Dbg::ParseJdwpOptions(tail)) {
@@ -511,8 +588,101 @@ Runtime::ParsedOptions* Runtime::ParsedOptions::Create(const Options& options, b
               ParseMemoryOption(option.substr(strlen("-XX:LongGCLogThreshold")).c_str(), 1024);
     } else if (option == "-XX:IgnoreMaxFootprint") {
       parsed->ignore_max_footprint_ = true;
+    } else if (StartsWith(option, "-XX:TLABSize=")) {
+      // A size of 0 disables thread-local allocation buffers.
+      parsed->tlab_size_ =
+          ParseMemoryOption(option.substr(strlen("-XX:TLABSize=")).c_str(), 1024);
+    } else if (StartsWith(option, "-XX:MarkStackPrefetchDepth=")) {
+      // A depth of 0 disables mark stack prefetching.
+      parsed->mark_stack_prefetch_depth_ =
+          ParseMemoryOption(option.substr(strlen("-XX:MarkStackPrefetchDepth=")).c_str(), 1);
+    } else if (StartsWith(option, "-XX:GcThroughputGoal=")) {
+      // The fraction of time the application should run outside of the GC, 0 disables the goal.
+      std::istringstream iss(option.substr(strlen("-XX:GcThroughputGoal=")));
+      double value;
+      iss >> value;
+      const bool sane_val = iss.eof() && (value == 0.0 || (value >= 0.5 && value < 1.0));
+      if (!sane_val) {
+        if (ignore_unrecognized) {
+          continue;
+        }
+        LOG(FATAL) << "Invalid option '" << option << "'";
+        return NULL;
+      }
+      parsed->gc_throughput_goal_ = value;
+    } else if (StartsWith(option, "-XX:GcPauseGoal=")) {
+      // Pause goal in milliseconds, 0 disables the goal.
+      parsed->gc_pause_goal_ms_ =
+          ParseMemoryOption(option.substr(strlen("-XX:GcPauseGoal=")).c_str(), 1);
+    } else if (option == "-XX:VerifyGcHeap") {
+      parsed->verify_gc_heap_ = true;
+    } else if (StartsWith(option, "-XX:HeapVerificationFraction=")) {
+      // The fraction of the heap that each verification pass checks, the passes rotate through
+      // the heap so that all of it is eventually covered.
+      std::istringstream iss(option.substr(strlen("-XX:HeapVerificationFraction=")));
+      double value;
+      iss >> value;
+      const bool sane_val = iss.eof() && value > 0.0 && value <= 1.0;
+      if (!sane_val) {
+        if (ignore_unrecognized) {
+          continue;
+        }
+        LOG(FATAL) << "Invalid option '" << option << "'";
+        return NULL;
+      }
+      parsed->heap_verification_fraction_ = value;
+    } else if (StartsWith(option, "-XX:ClassPrelinkThreads=")) {
+      parsed->class_prelink_threads_ =
+          ParseMemoryOption(option.substr(strlen("-XX:ClassPrelinkThreads=")).c_str(), 1024);
+    } else if (StartsWith(option, "-XX:JitThreshold=")) {
+      parsed->jit_compile_threshold_ =
+          ParseMemoryOption(option.substr(strlen("-XX:JitThreshold=")).c_str(), 1);
+    } else if (StartsWith(option, "-XX:ProfileFile=")) {
+      parsed->profile_file_ = option.substr(strlen("-XX:ProfileFile="));
+    } else if (StartsWith(option, "-XX:ProfilePeriod=")) {
+      parsed->profile_period_s_ =
+          ParseMemoryOption(option.substr(strlen("-XX:ProfilePeriod=")).c_str(), 1);
+      if (parsed->profile_period_s_ == 0) {
+        if (ignore_unrecognized) {
+          continue;
+        }
+        LOG(FATAL) << "Invalid option '" << option << "'";
+        return NULL;
+      }
+    } else if (option == "-XX:LazyDirectMethods") {
+      parsed->lazy_direct_methods_ = true;
+    } else if (option == "-Xrelocate-image") {
+      parsed->relocate_image_ = true;
+    } else if (StartsWith(option, "-XX:StackTraceDepthLimit=")) {
+      parsed->stack_trace_depth_limit_ =
+          ParseMemoryOption(option.substr(strlen("-XX:StackTraceDepthLimit=")).c_str(), 1);
+    } else if (StartsWith(option, "-XX:MadviseImage=") ||
+               StartsWith(option, "-XX:MadviseOatText=") ||
+               StartsWith(option, "-XX:MadviseOatData=")) {
+      // Access pattern hints for the mappings of the boot image and of the oat files' code and
+      // data: normal, random, sequential or willneed.
+      int* advice = StartsWith(option, "-XX:MadviseImage=") ? &parsed->image_madvise_
+          : StartsWith(option, "-XX:MadviseOatText=") ? &parsed->oat_text_madvise_
+          : &parsed->oat_data_madvise_;
+      if (!ParseMadviseOption(option.substr(option.find('=') + 1), advice)) {
+        if (ignore_unrecognized) {
+          continue;
+        }
+        LOG(FATAL) << "Invalid option '" << option << "'";
+        return NULL;
+      }
+    } else if (option == "-XX:PrefetchHot") {
+      parsed->prefetch_hot_ = true;
+    } else if (option == "-XX:ClassLoadTiming") {
+      parsed->class_load_timing_ = true;
+    } else if (option == "-XX:LockContentionStats") {
+      parsed->lock_contention_stats_ = true;
+    } else if (option == "-XX:StartupTiming") {
+      parsed->startup_timing_ = true;
     } else if (option == "-XX:LowMemoryMode") {
       parsed->low_memory_mode_ = true;
+    } else if (option == "-XX:UseHugePages") {
+      parsed->use_huge_pages_ = true;
     } else if (StartsWith(option, "-D")) {
       parsed->properties_.push_back(option.substr(strlen("-D")));
     } else if (StartsWith(option, "-Xjnitrace:")) {
@@ -592,6 +762,19 @@ Runtime::ParsedOptions* Runtime::ParsedOptions::Create(const Options& options, b
       parsed->method_trace_file_ = option.substr(strlen("-Xmethod-trace-file:"));
     } else if (StartsWith(option, "-Xmethod-trace-file-size:")) {
       parsed->method_trace_file_size_ = ParseIntegerOrDie(option);
+    } else if (option == "-Xmethod-trace-stream") {
+      parsed->method_trace_stream_ = true;
+    } else if (StartsWith(option, "-Xmethod-trace-filter:")) {
+      // A comma separated list of class name prefixes, such as "java.util.,com.example.Foo".
+      std::vector<std::string> names;
+      Split(option.substr(strlen("-Xmethod-trace-filter:")), ',', names);
+      for (size_t j = 0; j < names.size(); ++j) {
+        std::string prefix("L" + names[j]);
+        std::replace(prefix.begin(), prefix.end(), '.', '/');
+        parsed->method_trace_filter_.push_back(prefix);
+      }
+    } else if (option == "-Xperf-counters") {
+      parsed->perf_counters_ = true;
     } else if (option == "-Xprofile:threadcpuclock") {
       Trace::SetDefaultClockSource(kProfilerClockSourceThreadCpu);
     } else if (option == "-Xprofile:wallclock") {
@@ -718,24 +901,33 @@ bool Runtime::Start() {
 
   // InitNativeMethods needs to be after started_ so that the classes
   // it touches will have methods linked to the oat file if necessary.
+  startup_timings_.StartSplit("InitNativeMethods");
   InitNativeMethods();
 
   // Initialize well known thread group values that may be accessed threads while attaching.
+  startup_timings_.NewSplit("InitThreadGroups");
   InitThreadGroups(self);
 
   Thread::FinishStartup();
 
   if (is_zygote_) {
+    startup_timings_.NewSplit("InitZygote");
     if (!InitZygote()) {
+      startup_timings_.EndSplit();
       return false;
     }
   } else {
+    startup_timings_.NewSplit("DidForkFromZygote");
     DidForkFromZygote();
   }
 
+  startup_timings_.NewSplit("StartDaemonThreads");
   StartDaemonThreads();
 
+  startup_timings_.NewSplit("CreateSystemClassLoader");
   system_class_loader_ = CreateSystemClassLoader();
+  startup_timings_.EndSplit();
+  DumpStartupTimings();
 
   self->GetJniEnv()->locals.AssertEmpty();
 
@@ -791,8 +983,12 @@ bool Runtime::InitZygote() {
 void Runtime::DidForkFromZygote() {
   is_zygote_ = false;
 
-  // Create the thread pool.
-  heap_->CreateThreadPool();
+  // The GC and prelink threads are started on first use, app code runs sooner without them.
+  heap_->EnableThreadPool();
+  class_linker_->SetPrelinkThreadCount(class_prelink_threads_);
+  if (jit_ != NULL) {
+    jit_->CreateThreadPool();
+  }
 
   StartSignalCatcher();
 
@@ -826,19 +1022,35 @@ void Runtime::StartDaemonThreads() {
   VLOG(startup) << "Runtime::StartDaemonThreads exiting";
 }
 
+void Runtime::DumpStartupTimings() {
+  if (dump_startup_timings_) {
+    std::ostringstream os;
+    startup_timings_.Dump(os);
+    LOG(INFO) << os.str();
+  }
+  startup_timings_.Reset();
+}
+
 bool Runtime::Init(const Options& raw_options, bool ignore_unrecognized) {
   CHECK_EQ(sysconf(_SC_PAGE_SIZE), kPageSize);
 
+  startup_timings_.StartSplit("ParseOptions");
   UniquePtr<ParsedOptions> options(ParsedOptions::Create(raw_options, ignore_unrecognized));
   if (options.get() == NULL) {
+    startup_timings_.EndSplit();
     LOG(ERROR) << "Failed to parse options";
     return false;
   }
   VLOG(startup) << "Runtime::Init -verbose:startup enabled";
+  dump_startup_timings_ = options->startup_timing_ || VLOG_IS_ON(startup);
 
   QuasiAtomic::Startup();
 
-  Monitor::Init(options->lock_profiling_threshold_, options->hook_is_sensitive_thread_);
+  Monitor::Init(options->lock_profiling_threshold_, options->hook_is_sensitive_thread_,
+                options->lock_contention_stats_);
+  if (options->lock_contention_stats_) {
+    BaseMutex::EnableContentionLogging();
+  }
 
   host_prefix_ = options->host_prefix_;
   boot_class_path_string_ = options->boot_class_path_string_;
@@ -849,6 +1061,14 @@ bool Runtime::Init(const Options& raw_options, bool ignore_unrecognized) {
   is_zygote_ = options->is_zygote_;
   is_concurrent_gc_enabled_ = options->is_concurrent_gc_enabled_;
   is_explicit_gc_disabled_ = options->is_explicit_gc_disabled_;
+  // The code of oat files compiled against the image embeds its addresses, so the compiler must
+  // see the image where it was linked.
+  relocate_image_ = options->relocate_image_ && !options->is_compiler_;
+  image_madvise_ = options->image_madvise_;
+  oat_text_madvise_ = options->oat_text_madvise_;
+  oat_data_madvise_ = options->oat_data_madvise_;
+  prefetch_hot_ = options->prefetch_hot_;
+  stack_trace_depth_limit_ = options->stack_trace_depth_limit_;
 
   compiler_filter_ = options->compiler_filter_;
   huge_method_threshold_ = options->huge_method_threshold_;
@@ -863,17 +1083,22 @@ bool Runtime::Init(const Options& raw_options, bool ignore_unrecognized) {
   abort_ = options->hook_abort_;
 
   default_stack_size_ = options->stack_size_;
+  class_prelink_threads_ = options->class_prelink_threads_;
   stack_trace_file_ = options->stack_trace_file_;
 
   monitor_list_ = new MonitorList;
   thread_list_ = new ThreadList;
   intern_table_ = new InternTable;
+  interpreter_inline_caches_ = new interpreter::InlineCacheTable;
+  interpreter_quickened_code_ = new interpreter::QuickenedCodeTable;
 
 
   if (options->interpreter_only_) {
     GetInstrumentation()->ForceInterpretOnly();
   }
 
+  // Includes mapping the boot image and its oat file.
+  startup_timings_.NewSplit("CreateHeap");
   heap_ = new gc::Heap(options->heap_initial_size_,
                        options->heap_growth_limit_,
                        options->heap_min_free_,
@@ -887,8 +1112,16 @@ bool Runtime::Init(const Options& raw_options, bool ignore_unrecognized) {
                        options->low_memory_mode_,
                        options->long_pause_log_threshold_,
                        options->long_gc_log_threshold_,
-                       options->ignore_max_footprint_);
-
+                       options->ignore_max_footprint_,
+                       options->tlab_size_,
+                       options->mark_stack_prefetch_depth_,
+                       options->gc_throughput_goal_,
+                       MsToNs(options->gc_pause_goal_ms_),
+                       options->verify_gc_heap_,
+                       options->heap_verification_fraction_,
+                       options->use_huge_pages_);
+
+  startup_timings_.NewSplit("AttachMainThread");
   BlockSignals();
   InitPlatformSignalHandlers();
 
@@ -909,6 +1142,7 @@ bool Runtime::Init(const Options& raw_options, bool ignore_unrecognized) {
   // Now we're attached, we can take the heap locks and validate the heap.
   GetHeap()->EnableObjectValidation();
 
+  startup_timings_.NewSplit("CreateClassLinker");
   CHECK_GE(GetHeap()->GetContinuousSpaces().size(), 1U);
   if (GetHeap()->GetContinuousSpaces()[0]->IsImageSpace()) {
     class_linker_ = ClassLinker::CreateFromImage(intern_table_);
@@ -918,15 +1152,28 @@ bool Runtime::Init(const Options& raw_options, bool ignore_unrecognized) {
     class_linker_ = ClassLinker::CreateFromCompiler(*options->boot_class_path_, intern_table_);
   }
   CHECK(class_linker_ != NULL);
+  class_linker_->SetClassLoadTimingEnabled(options->class_load_timing_);
+  class_linker_->SetLazyDirectMethodsEnabled(options->lazy_direct_methods_);
+  startup_timings_.NewSplit("InitVerifierAndJit");
+  // Before the verifier initializes, it keeps what the compiler needs when there is a JIT.
+  if (!IsCompiler()) {
+    profile_file_ = options->profile_file_;
+    size_t compile_threshold = options->interpreter_only_ ? 0 : options->jit_compile_threshold_;
+    if (compile_threshold != 0 || !profile_file_.empty()) {
+      jit_ = jit::Jit::Create(compile_threshold, profile_file_, options->profile_period_s_);
+    }
+  }
   verifier::MethodVerifier::Init();
 
   method_trace_ = options->method_trace_;
   method_trace_file_ = options->method_trace_file_;
   method_trace_file_size_ = options->method_trace_file_size_;
+  method_trace_filter_ = options->method_trace_filter_;
+  perf_counters_ = options->perf_counters_;
 
   if (options->method_trace_) {
-    Trace::Start(options->method_trace_file_.c_str(), -1, options->method_trace_file_size_, 0,
-                 false, false, 0);
+    Trace::Start(options->method_trace_file_.c_str(), -1, options->method_trace_file_size_,
+                 options->method_trace_stream_ ? Trace::kTraceStreaming : 0, false, false, 0);
   }
 
   // Pre-allocate an OutOfMemoryError for the double-OOME case.
@@ -934,6 +1181,8 @@ bool Runtime::Init(const Options& raw_options, bool ignore_unrecognized) {
                           "OutOfMemoryError thrown while trying to throw OutOfMemoryError; no stack available");
   pre_allocated_OutOfMemoryError_ = self->GetException(NULL);
   self->ClearException();
+  startup_timings_.EndSplit();
+  DumpStartupTimings();
 
   VLOG(startup) << "Runtime::Init exiting";
   return true;
@@ -1032,12 +1281,21 @@ void Runtime::RegisterRuntimeNativeMethods(JNIEnv* env) {
 }
 
 void Runtime::DumpForSigQuit(std::ostream& os) {
-  GetClassLinker()->DumpForSigQuit(os);
-  GetInternTable()->DumpForSigQuit(os);
-  GetJavaVM()->DumpForSigQuit(os);
-  GetHeap()->DumpForSigQuit(os);
-  os << "\n";
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    GetClassLinker()->DumpForSigQuit(os);
+    GetInternTable()->DumpForSigQuit(os);
+    GetJavaVM()->DumpForSigQuit(os);
+    GetHeap()->DumpForSigQuit(os);
+    os << "\n";
+
+    if (Monitor::IsContentionStatsEnabled()) {
+      Monitor::DumpContentionStats(os);
+      os << "\n";
+    }
+  }
 
+  // The threads dump themselves at a checkpoint, which can't be requested while runnable.
   thread_list_->DumpForSigQuit(os);
   BaseMutex::DumpAll(os);
 }
@@ -1094,6 +1352,8 @@ int32_t Runtime::GetStat(int kind) {
   case KIND_CLASS_INIT_TIME:
     // Convert ns to us, reduce to 32 bits.
     return static_cast<int>(stats->class_init_time_ns / 1000);
+  case KIND_PERF_COUNTERS:
+    return 0;  // 64 bit values, see VMDebug.getPerfCounters.
   case KIND_EXT_ALLOCATED_OBJECTS:
   case KIND_EXT_ALLOCATED_BYTES:
   case KIND_EXT_FREED_OBJECTS:
@@ -1243,6 +1503,21 @@ mirror::ArtMethod* Runtime::CreateCalleeSaveMethod(InstructionSet instruction_se
     method->SetFrameSizeInBytes(frame_size);
     method->SetCoreSpillMask(core_spills);
     method->SetFpSpillMask(0);
+  } else if (instruction_set == kX86_64) {
+    uint32_t ref_spills = (1 << art::x86_64::RBP) | (1 << art::x86_64::RSI) |
+                          (1 << art::x86_64::RDI) | (1 << art::x86_64::R12) |
+                          (1 << art::x86_64::R13) | (1 << art::x86_64::R14) |
+                          (1 << art::x86_64::R15);
+    uint32_t arg_spills = (1 << art::x86_64::RCX) | (1 << art::x86_64::RDX) |
+                          (1 << art::x86_64::RBX);
+    // Include a fake return address callee save.
+    uint32_t core_spills = ref_spills | (type == kRefsAndArgs ? arg_spills : 0) |
+                           (1 << art::x86_64::kNumberOfCpuRegisters);
+    size_t frame_size = RoundUp((__builtin_popcount(core_spills) /* gprs */ +
+                                 1 /* Method* */) * kPointerSize, kStackAlignment);
+    method->SetFrameSizeInBytes(frame_size);
+    method->SetCoreSpillMask(core_spills);
+    method->SetFpSpillMask(0);
   } else {
     UNIMPLEMENTED(FATAL);
   }
@@ -1253,12 +1528,14 @@ void Runtime::DisallowNewSystemWeaks() {
   monitor_list_->DisallowNewMonitors();
   intern_table_->DisallowNewInterns();
   java_vm_->DisallowNewWeakGlobals();
+  Dbg::DisallowNewObjectRegistryObjects();
 }
 
 void Runtime::AllowNewSystemWeaks() {
   monitor_list_->AllowNewMonitors();
   intern_table_->AllowNewInterns();
   java_vm_->AllowNewWeakGlobals();
+  Dbg::AllowNewObjectRegistryObjects();
 }
 
 void Runtime::SetCalleeSaveMethod(mirror::ArtMethod* method, CalleeSaveType type) {
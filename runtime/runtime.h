@@ -27,6 +27,7 @@
 
 #include "base/macros.h"
 #include "base/stringpiece.h"
+#include "base/timing_logger.h"
 #include "gc/heap.h"
 #include "globals.h"
 #include "instruction_set.h"
@@ -42,6 +43,13 @@ namespace art {
 namespace gc {
   class Heap;
 }
+namespace interpreter {
+  class InlineCacheTable;
+  class QuickenedCodeTable;
+}  // namespace interpreter
+namespace jit {
+  class Jit;
+}  // namespace jit
 namespace mirror {
   class ArtMethod;
   class ClassLoader;
@@ -94,6 +102,8 @@ class Runtime {
     std::string host_prefix_;
     std::string image_;
     bool check_jni_;
+    bool check_jni_lite_;
+    size_t check_jni_sample_period_;
     std::string jni_trace_;
     bool is_compiler_;
     bool is_zygote_;
@@ -103,6 +113,26 @@ class Runtime {
     size_t long_pause_log_threshold_;
     size_t long_gc_log_threshold_;
     bool ignore_max_footprint_;
+    size_t tlab_size_;
+    size_t mark_stack_prefetch_depth_;
+    double gc_throughput_goal_;
+    size_t gc_pause_goal_ms_;
+    bool verify_gc_heap_;
+    double heap_verification_fraction_;
+    size_t class_prelink_threads_;
+    bool class_load_timing_;
+    bool lock_contention_stats_;
+    bool startup_timing_;
+    size_t jit_compile_threshold_;
+    std::string profile_file_;
+    uint32_t profile_period_s_;
+    bool lazy_direct_methods_;
+    bool relocate_image_;
+    int image_madvise_;
+    int oat_text_madvise_;
+    int oat_data_madvise_;
+    bool prefetch_hot_;
+    size_t stack_trace_depth_limit_;
     size_t heap_initial_size_;
     size_t heap_maximum_size_;
     size_t heap_growth_limit_;
@@ -113,11 +143,15 @@ class Runtime {
     size_t conc_gc_threads_;
     size_t stack_size_;
     bool low_memory_mode_;
+    bool use_huge_pages_;
     size_t lock_profiling_threshold_;
     std::string stack_trace_file_;
     bool method_trace_;
     std::string method_trace_file_;
     size_t method_trace_file_size_;
+    bool method_trace_stream_;
+    std::vector<std::string> method_trace_filter_;
+    bool perf_counters_;
     bool (*hook_is_sensitive_thread_)();
     jint (*hook_vfprintf_)(FILE* stream, const char* format, va_list ap);
     void (*hook_exit_)(jint status);
@@ -155,6 +189,42 @@ class Runtime {
     return is_explicit_gc_disabled_;
   }
 
+  // Whether the boot image and its oat file are moved from their linked address when mapped.
+  bool IsImageRelocationEnabled() const {
+    return relocate_image_;
+  }
+
+  // The madvise(2) hints for the mapping of the boot image and for the code and the data of the
+  // oat files, MADV_NORMAL by default.
+  int GetImageMadvise() const {
+    return image_madvise_;
+  }
+
+  int GetOatTextMadvise() const {
+    return oat_text_madvise_;
+  }
+
+  int GetOatDataMadvise() const {
+    return oat_data_madvise_;
+  }
+
+  // The maximum number of frames captured in the stack trace of an exception, 0 for no limit.
+  size_t GetStackTraceDepthLimit() const {
+    return stack_trace_depth_limit_;
+  }
+
+  // The descriptor prefixes of the classes whose methods method tracing is restricted to, empty to
+  // trace every method.
+  const std::vector<std::string>& GetMethodTraceFilter() const {
+    return method_trace_filter_;
+  }
+
+  // Whether to start reading in the startup objects of the image and the hot code of the oat
+  // files, which the compiler lays out first, as soon as they are mapped.
+  bool IsHotPrefetchEnabled() const {
+    return prefetch_hot_;
+  }
+
 #ifdef ART_SEA_IR_MODE
   bool IsSeaIRMode() const {
     return sea_ir_mode_;
@@ -253,7 +323,7 @@ class Runtime {
   void DetachCurrentThread() LOCKS_EXCLUDED(Locks::mutator_lock_);
 
   void DumpForSigQuit(std::ostream& os)
-      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+      LOCKS_EXCLUDED(Locks::mutator_lock_);
   void DumpLockHolders(std::ostream& os);
 
   ~Runtime();
@@ -282,6 +352,24 @@ class Runtime {
     return intern_table_;
   }
 
+  interpreter::InlineCacheTable* GetInterpreterInlineCaches() const {
+    return interpreter_inline_caches_;
+  }
+
+  interpreter::QuickenedCodeTable* GetInterpreterQuickenedCode() const {
+    return interpreter_quickened_code_;
+  }
+
+  // Returns NULL unless hot methods are compiled or profiled at runtime.
+  jit::Jit* GetJit() const {
+    return jit_;
+  }
+
+  // The profile written for dex2oat, empty when not profiling.
+  const std::string& GetProfileFile() const {
+    return profile_file_;
+  }
+
   JavaVMExt* GetJavaVM() const {
     return java_vm_;
   }
@@ -378,6 +466,11 @@ class Runtime {
     return stats_enabled_;
   }
 
+  // Whether hardware performance counters are sampled around runtime work while stats are enabled.
+  bool HasPerfCountersEnabled() const {
+    return perf_counters_;
+  }
+
   void ResetStats(int kinds);
 
   void SetStatsEnabled(bool new_state);
@@ -412,6 +505,8 @@ class Runtime {
 
   void StartDaemonThreads();
   void StartSignalCatcher();
+  // Logs the startup timings recorded so far if enabled, and clears them.
+  void DumpStartupTimings();
 
   // A pointer to the active runtime or NULL.
   static Runtime* instance_;
@@ -420,6 +515,12 @@ class Runtime {
   bool is_zygote_;
   bool is_concurrent_gc_enabled_;
   bool is_explicit_gc_disabled_;
+  bool relocate_image_;
+  int image_madvise_;
+  int oat_text_madvise_;
+  int oat_data_madvise_;
+  bool prefetch_hot_;
+  size_t stack_trace_depth_limit_;
 
   CompilerFilter compiler_filter_;
   size_t huge_method_threshold_;
@@ -448,6 +549,8 @@ class Runtime {
 
   // The default stack size for managed threads created by the runtime.
   size_t default_stack_size_;
+  // Threads the class linker uses to prelink classes, see ClassLinker::PrelinkClasses.
+  size_t class_prelink_threads_;
 
   gc::Heap* heap_;
 
@@ -457,6 +560,13 @@ class Runtime {
 
   InternTable* intern_table_;
 
+  interpreter::InlineCacheTable* interpreter_inline_caches_;
+
+  interpreter::QuickenedCodeTable* interpreter_quickened_code_;
+
+  jit::Jit* jit_;
+  std::string profile_file_;
+
   ClassLinker* class_linker_;
 
   SignalCatcher* signal_catcher_;
@@ -490,6 +600,11 @@ class Runtime {
   // is created. This flag is needed for knowing if its safe to request CMS.
   bool finished_starting_;
 
+  // Timings of the phases of Init and Start, logged at the end of each with -XX:StartupTiming or
+  // -verbose:startup.
+  base::TimingLogger startup_timings_;
+  bool dump_startup_timings_;
+
   // Hooks supported by JNI_CreateJavaVM
   jint (*vfprintf_)(FILE* stream, const char* format, va_list ap);
   void (*exit_)(jint status);
@@ -497,10 +612,12 @@ class Runtime {
 
   bool stats_enabled_;
   RuntimeStats stats_;
+  bool perf_counters_;
 
   bool method_trace_;
   std::string method_trace_file_;
   size_t method_trace_file_size_;
+  std::vector<std::string> method_trace_filter_;
   instrumentation::Instrumentation instrumentation_;
 
   typedef SafeMap<jobject, std::vector<const DexFile*>, JobjectComparator> CompileTimeClassPaths;
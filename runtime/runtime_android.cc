@@ -16,10 +16,123 @@
 
 #include "runtime.h"
 
+#include <signal.h>
+#include <string.h>
+#include <sys/ucontext.h>
+
+#include "base/logging.h"
+#include "gc/heap.h"
+#include "instrumentation.h"
+#include "mirror/art_method-inl.h"
+#include "mirror/object-inl.h"
+#include "thread.h"
+
 namespace art {
 
+#if defined(__arm__)
+
+extern "C" void art_quick_implicit_suspend();
+extern "C" void art_quick_throw_null_pointer_exception();
+extern "C" void art_quick_throw_stack_overflow();
+
+static struct sigaction old_segv_action;
+
+// Whether pc is the second load of an implicit suspend check emitted by the quick compiler for
+// Thumb2: "ldr.w rX, [r9, #suspend_trigger_offset]; ldr.w rX, [rX, #0]".
+static bool IsImplicitSuspendCheck(uintptr_t pc) {
+  const uint16_t* insn = reinterpret_cast<const uint16_t*>(pc);
+  if ((insn[0] & 0xfff0) != 0xf8d0) {
+    return false;
+  }
+  uint16_t rn = insn[0] & 0xf;
+  uint16_t rt = insn[1] >> 12;
+  if (rn != rt || (insn[1] & 0xfff) != 0) {
+    return false;
+  }
+  uint16_t trigger_offset = Thread::SuspendTriggerOffset().Int32Value();
+  return insn[-2] == (0xf8d0 | 9) && insn[-1] == ((rt << 12) | trigger_offset);
+}
+
+// Whether pc is the stack probe of an implicit stack overflow check: "ldr.w r12, [r12, #0]".
+static bool IsImplicitStackOverflowCheck(uintptr_t pc) {
+  const uint16_t* insn = reinterpret_cast<const uint16_t*>(pc);
+  return insn[0] == 0xf8dc && insn[1] == 0xc000;
+}
+
+// Whether pc is in the compiled code of the method whose frame is at sp. Quick frames keep the
+// method at the bottom.
+static bool IsInQuickCodeOfFrame(uintptr_t pc, uintptr_t sp)
+    NO_THREAD_SAFETY_ANALYSIS {
+  mirror::ArtMethod* method = *reinterpret_cast<mirror::ArtMethod**>(sp);
+  Runtime* runtime = Runtime::Current();
+  if (method == NULL || !runtime->GetHeap()->IsHeapAddress(method) ||
+      method->GetClass() != mirror::ArtMethod::GetJavaLangReflectArtMethod() ||
+      method->IsNative() || method->IsRuntimeMethod() || method->IsProxyMethod()) {
+    return false;
+  }
+  uintptr_t code = reinterpret_cast<uintptr_t>(
+      runtime->GetInstrumentation()->GetQuickCodeFor(method)) & ~1U;
+  uint32_t code_size = reinterpret_cast<const uint32_t*>(code)[-1];
+  return code <= pc && pc < code + code_size;
+}
+
+static void HandleSegv(int signal_number, siginfo_t* info, void* raw_context) {
+  struct ucontext* uc = reinterpret_cast<struct ucontext*>(raw_context);
+  struct sigcontext* sc = reinterpret_cast<struct sigcontext*>(&uc->uc_mcontext);
+  // Faults of compiled code happen in Thumb state, in a runnable thread whose managed code holds
+  // Thread::Current() in r9.
+  Thread* self = (sc->arm_cpsr & (1 << 5)) != 0 ? Thread::Current() : NULL;
+  if (self != NULL && sc->arm_r9 == reinterpret_cast<uintptr_t>(self) &&
+      self->GetState() == kRunnable) {
+    uintptr_t fault_addr = reinterpret_cast<uintptr_t>(info->si_addr);
+    if (fault_addr == 0 && IsImplicitSuspendCheck(sc->arm_pc)) {
+      // Call the suspend check as if from the instruction after the load, where the compiler put
+      // the safepoint.
+      sc->arm_lr = (sc->arm_pc + 4) | 1;
+      sc->arm_pc = reinterpret_cast<uintptr_t>(art_quick_implicit_suspend) & ~1U;
+      return;
+    }
+    if (self->IsInStackGuard(fault_addr) && IsImplicitStackOverflowCheck(sc->arm_pc)) {
+      // The probe precedes the pushes of the prologue, so lr still returns to the caller. Throw
+      // as if the caller had called the runtime instead of the method.
+      sc->arm_pc = reinterpret_cast<uintptr_t>(art_quick_throw_stack_overflow) & ~1U;
+      return;
+    }
+    if (fault_addr < static_cast<uintptr_t>(kPageSize) &&
+        IsInQuickCodeOfFrame(sc->arm_pc, sc->arm_sp)) {
+      // An access of compiled code through a null reference, the compiler put a safepoint after
+      // it. Throw as if the access had called the runtime.
+      const uint16_t* insn = reinterpret_cast<const uint16_t*>(sc->arm_pc);
+      uintptr_t insn_size = (insn[0] >> 11) >= 0x1d ? 4 : 2;
+      sc->arm_lr = (sc->arm_pc + insn_size) | 1;
+      sc->arm_pc = reinterpret_cast<uintptr_t>(art_quick_throw_null_pointer_exception) & ~1U;
+      return;
+    }
+  }
+  // Not ours. Restore the previous handler, debuggerd's or the default, and let the access fault
+  // again.
+  sigaction(signal_number, &old_segv_action, NULL);
+}
+
+#endif
+
 void Runtime::InitPlatformSignalHandlers() {
-  // On a device, debuggerd will give us a stack trace. Nothing to do here.
+  // On a device, debuggerd will give us a stack trace for unexpected signals. On ARM compiled code
+  // may poll for suspension with loads that fault, see Thread::suspend_trigger_, leave null
+  // checks to its field and array length accesses and probe the stack guard for overflows.
+#if defined(__arm__)
+  static bool segv_handler_installed = false;
+  if (segv_handler_installed) {
+    return;  // A runtime created after another would chain to our own handler.
+  }
+  segv_handler_installed = true;
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  sigemptyset(&action.sa_mask);
+  action.sa_sigaction = HandleSegv;
+  action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+  CHECK_EQ(sigaction(SIGSEGV, &action, &old_segv_action), 0);
+#endif
 }
 
 }  // namespace art
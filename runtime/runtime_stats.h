@@ -17,6 +17,7 @@
 #ifndef ART_RUNTIME_RUNTIME_STATS_H_
 #define ART_RUNTIME_RUNTIME_STATS_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
 namespace art {
@@ -30,6 +31,7 @@ enum StatKinds {
   KIND_GC_INVOCATIONS         = 1<<4,
   KIND_CLASS_INIT_COUNT       = 1<<5,
   KIND_CLASS_INIT_TIME        = 1<<6,
+  KIND_PERF_COUNTERS          = 1<<7,
 
   // These values exist for backward compatibility.
   KIND_EXT_ALLOCATED_OBJECTS = 1<<12,
@@ -44,6 +46,7 @@ enum StatKinds {
   KIND_GLOBAL_GC_INVOCATIONS      = KIND_GC_INVOCATIONS,
   KIND_GLOBAL_CLASS_INIT_COUNT    = KIND_CLASS_INIT_COUNT,
   KIND_GLOBAL_CLASS_INIT_TIME     = KIND_CLASS_INIT_TIME,
+  KIND_GLOBAL_PERF_COUNTERS       = KIND_PERF_COUNTERS,
 
   KIND_THREAD_ALLOCATED_OBJECTS   = KIND_ALLOCATED_OBJECTS << 16,
   KIND_THREAD_ALLOCATED_BYTES     = KIND_ALLOCATED_BYTES << 16,
@@ -52,9 +55,28 @@ enum StatKinds {
 
   KIND_THREAD_GC_INVOCATIONS      = KIND_GC_INVOCATIONS << 16,
 
+  KIND_THREAD_PERF_COUNTERS       = KIND_PERF_COUNTERS << 16,
+
   // TODO: failedAllocCount, failedAllocSize
 };
 
+// The runtime work that hardware performance counters are sampled around, see ScopedPerfCounters.
+enum PerfPhase {
+  kPerfPhaseGc,
+  kPerfPhaseClassLoad,
+  kPerfPhaseCompile,
+  kPerfPhaseCount
+};
+
+// The hardware performance counters sampled for each phase. Together with PerfPhase this gives the
+// layout of the array filled in by VMDebug.getPerfCounters.
+enum PerfCounter {
+  kPerfCounterCycles,
+  kPerfCounterInstructions,
+  kPerfCounterCacheMisses,
+  kPerfCounterCount
+};
+
 /*
  * Memory allocation profiler state.  This is used both globally and
  * per-thread.
@@ -86,6 +108,13 @@ struct PACKED(4) RuntimeStats {
     if ((flags & KIND_CLASS_INIT_TIME) != 0) {
       class_init_time_ns = 0;
     }
+    if ((flags & KIND_PERF_COUNTERS) != 0) {
+      for (size_t i = 0; i < kPerfPhaseCount; ++i) {
+        for (size_t j = 0; j < kPerfCounterCount; ++j) {
+          perf_counts[i][j] = 0;
+        }
+      }
+    }
   }
 
   // Number of objects allocated.
@@ -106,6 +135,9 @@ struct PACKED(4) RuntimeStats {
   // Cumulative time spent in class initialization.
   uint64_t class_init_time_ns;
 
+  // Cumulative hardware performance counter values by phase, when enabled by -Xperf-counters.
+  uint64_t perf_counts[kPerfPhaseCount][kPerfCounterCount];
+
   DISALLOW_COPY_AND_ASSIGN(RuntimeStats);
 };
 
@@ -43,6 +43,7 @@ TEST_F(RuntimeTest, ParsedOptions) {
   options.push_back(std::make_pair(lib_core.c_str(), null));
   options.push_back(std::make_pair("-Ximage:boot_image", null));
   options.push_back(std::make_pair("-Xcheck:jni", null));
+  options.push_back(std::make_pair("-Xjnisampleperiod:16", null));
   options.push_back(std::make_pair("-Xms2048", null));
   options.push_back(std::make_pair("-Xmx4k", null));
   options.push_back(std::make_pair("-Xss1m", null));
@@ -61,6 +62,8 @@ TEST_F(RuntimeTest, ParsedOptions) {
   EXPECT_EQ(lib_core, parsed->class_path_string_);
   EXPECT_EQ(std::string("boot_image"), parsed->image_);
   EXPECT_EQ(true, parsed->check_jni_);
+  EXPECT_FALSE(parsed->check_jni_lite_);
+  EXPECT_EQ(16U, parsed->check_jni_sample_period_);
   EXPECT_EQ(2048U, parsed->heap_initial_size_);
   EXPECT_EQ(4 * KB, parsed->heap_maximum_size_);
   EXPECT_EQ(1 * MB, parsed->stack_size_);
@@ -116,17 +116,6 @@ void SignalCatcher::Output(const std::string& s) {
 
 void SignalCatcher::HandleSigQuit() {
   Runtime* runtime = Runtime::Current();
-  ThreadList* thread_list = runtime->GetThreadList();
-
-  // Grab exclusively the mutator lock, set state to Runnable without checking for a pending
-  // suspend request as we're going to suspend soon anyway. We set the state to Runnable to avoid
-  // giving away the mutator lock.
-  thread_list->SuspendAll();
-  Thread* self = Thread::Current();
-  Locks::mutator_lock_->AssertExclusiveHeld(self);
-  const char* old_cause = self->StartAssertNoThreadSuspension("Handling SIGQUIT");
-  ThreadState old_state = self->SetStateUnsafe(kRunnable);
-
   std::ostringstream os;
   os << "\n"
       << "----- pid " << getpid() << " at " << GetIsoDate() << " -----\n";
@@ -135,6 +124,8 @@ void SignalCatcher::HandleSigQuit() {
 
   os << "Build type: " << (kIsDebugBuild ? "debug" : "optimized") << "\n";
 
+  // Threads are only stopped for as long as it takes to dump their own stack, see
+  // ThreadList::DumpForSigQuit.
   runtime->DumpForSigQuit(os);
 
   if (false) {
@@ -144,14 +135,6 @@ void SignalCatcher::HandleSigQuit() {
     }
   }
   os << "----- end " << getpid() << " -----\n";
-  CHECK_EQ(self->SetStateUnsafe(old_state), kRunnable);
-  if (self->ReadFlag(kCheckpointRequest)) {
-    self->RunCheckpointFunction();
-    self->AtomicClearFlag(kCheckpointRequest);
-  }
-  self->EndAssertNoThreadSuspension(old_cause);
-  thread_list->ResumeAll();
-
   Output(os.str());
 }
 
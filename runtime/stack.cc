@@ -83,9 +83,29 @@ bool ManagedStack::ShadowFramesContain(mirror::Object** shadow_frame_entry) cons
   return false;
 }
 
+void QuickFrameInfoCache::Compute(const mirror::ArtMethod* method, QuickFrameInfo* info) {
+  info->method = method;
+  info->frame_size = method->GetFrameSizeInBytes();
+  info->core_spill_mask = method->GetCoreSpillMask();
+  info->fp_spill_mask = method->GetFpSpillMask();
+  info->vmap_table = method->GetVmapTable();
+  info->num_locals = 0;
+  info->num_ins = 0;
+  if (!method->IsNative() && !method->IsRuntimeMethod() && !method->IsProxyMethod()) {
+    const DexFile::CodeItem* code_item =
+        MethodHelper(const_cast<mirror::ArtMethod*>(method)).GetCodeItem();
+    if (code_item != NULL) {
+      info->num_locals = code_item->registers_size_ - code_item->ins_size_;
+      info->num_ins = code_item->ins_size_;
+    }
+  }
+}
+
 StackVisitor::StackVisitor(Thread* thread, Context* context)
     : thread_(thread), cur_shadow_frame_(NULL),
       cur_quick_frame_(NULL), cur_quick_frame_pc_(0), num_frames_(0), cur_depth_(0),
+      frame_info_cache_(Thread::Current() != NULL ?
+                        Thread::Current()->GetQuickFrameInfoCache() : NULL),
       context_(context) {
   DCHECK(thread == Thread::Current() || thread->IsSuspended()) << *thread;
 }
@@ -136,20 +156,16 @@ uint32_t StackVisitor::GetVReg(mirror::ArtMethod* m, uint16_t vreg, VRegKind kin
   if (cur_quick_frame_ != NULL) {
     DCHECK(context_ != NULL);  // You can't reliably read registers without a context.
     DCHECK(m == GetMethod());
-    const VmapTable vmap_table(m->GetVmapTable());
+    const QuickFrameInfo& info = GetCurrentQuickFrameInfo();
+    const VmapTable vmap_table(info.vmap_table);
     uint32_t vmap_offset;
     // TODO: IsInContext stops before spotting floating point registers.
     if (vmap_table.IsInContext(vreg, kind, &vmap_offset)) {
       bool is_float = (kind == kFloatVReg) || (kind == kDoubleLoVReg) || (kind == kDoubleHiVReg);
-      uint32_t spill_mask = is_float ? m->GetFpSpillMask()
-                                     : m->GetCoreSpillMask();
+      uint32_t spill_mask = is_float ? info.fp_spill_mask : info.core_spill_mask;
       return GetGPR(vmap_table.ComputeRegister(spill_mask, vmap_offset, kind));
     } else {
-      const DexFile::CodeItem* code_item = MethodHelper(m).GetCodeItem();
-      DCHECK(code_item != NULL) << PrettyMethod(m);  // Can't be NULL or how would we compile its instructions?
-      size_t frame_size = m->GetFrameSizeInBytes();
-      return GetVReg(cur_quick_frame_, code_item, m->GetCoreSpillMask(), m->GetFpSpillMask(),
-                     frame_size, vreg);
+      return GetVReg(cur_quick_frame_, GetCurrentQuickFrameInfo(), vreg);
     }
   } else {
     return cur_shadow_frame_->GetVReg(vreg);
@@ -161,21 +177,18 @@ void StackVisitor::SetVReg(mirror::ArtMethod* m, uint16_t vreg, uint32_t new_val
   if (cur_quick_frame_ != NULL) {
     DCHECK(context_ != NULL);  // You can't reliably write registers without a context.
     DCHECK(m == GetMethod());
-    const VmapTable vmap_table(m->GetVmapTable());
+    const QuickFrameInfo& info = GetCurrentQuickFrameInfo();
+    const VmapTable vmap_table(info.vmap_table);
     uint32_t vmap_offset;
     // TODO: IsInContext stops before spotting floating point registers.
     if (vmap_table.IsInContext(vreg, kind, &vmap_offset)) {
       bool is_float = (kind == kFloatVReg) || (kind == kDoubleLoVReg) || (kind == kDoubleHiVReg);
-      uint32_t spill_mask = is_float ? m->GetFpSpillMask() : m->GetCoreSpillMask();
+      uint32_t spill_mask = is_float ? info.fp_spill_mask : info.core_spill_mask;
       const uint32_t reg = vmap_table.ComputeRegister(spill_mask, vmap_offset, kReferenceVReg);
       SetGPR(reg, new_value);
     } else {
-      const DexFile::CodeItem* code_item = MethodHelper(m).GetCodeItem();
-      DCHECK(code_item != NULL) << PrettyMethod(m);  // Can't be NULL or how would we compile its instructions?
-      uint32_t core_spills = m->GetCoreSpillMask();
-      uint32_t fp_spills = m->GetFpSpillMask();
-      size_t frame_size = m->GetFrameSizeInBytes();
-      int offset = GetVRegOffset(code_item, core_spills, fp_spills, frame_size, vreg);
+      int offset = GetVRegOffset(info.num_locals, info.core_spill_mask, info.fp_spill_mask,
+                                 info.frame_size, vreg);
       byte* vreg_addr = reinterpret_cast<byte*>(GetCurrentQuickFrame()) + offset;
       *reinterpret_cast<uint32_t*>(vreg_addr) = new_value;
     }
@@ -300,9 +313,10 @@ void StackVisitor::WalkStack(bool include_transitions) {
         if (context_ != NULL) {
           context_->FillCalleeSaves(*this);
         }
-        size_t frame_size = method->GetFrameSizeInBytes();
+        const QuickFrameInfo& frame_info = GetCurrentQuickFrameInfo();
+        size_t frame_size = frame_info.frame_size;
         // Compute PC for next stack frame from return PC.
-        size_t return_pc_offset = method->GetReturnPcOffsetInBytes();
+        size_t return_pc_offset = frame_info.GetReturnPcOffset();
         byte* return_pc_addr = reinterpret_cast<byte*>(cur_quick_frame_) + return_pc_offset;
         uintptr_t return_pc = *reinterpret_cast<uintptr_t*>(return_pc_addr);
         if (UNLIKELY(exit_stubs_installed)) {
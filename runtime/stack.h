@@ -78,6 +78,14 @@ class ShadowFrame {
     ShadowFrame* sf = new (memory) ShadowFrame(num_vregs, link, method, dex_pc, true);
     return sf;
   }
+
+  // Create ShadowFrame for an interpreted call using provided memory. Only the registers below
+  // the last num_ins are cleared, the caller copies the arguments into the others.
+  static ShadowFrame* CreateForInvoke(uint32_t num_vregs, uint32_t num_ins, ShadowFrame* link,
+                                      mirror::ArtMethod* method, void* memory) {
+    ShadowFrame* sf = new (memory) ShadowFrame(num_vregs, num_ins, link, method);
+    return sf;
+  }
   ~ShadowFrame() {}
 
   bool HasReferenceArray() const {
@@ -195,6 +203,23 @@ class ShadowFrame {
     }
   }
 
+  // Copies a vreg and its reference from another frame with a reference array, which keeps the
+  // kind of the value so that arguments can be passed without looking at the shorty.
+  void CopyVRegFrom(size_t i, const ShadowFrame& src, size_t src_i) {
+    DCHECK_LT(i, NumberOfVRegs());
+    DCHECK_LT(src_i, src.NumberOfVRegs());
+    vregs_[i] = src.vregs_[src_i];
+    References()[i] = src.References()[src_i];
+  }
+
+  // Same as CopyVRegFrom for count consecutive vregs.
+  void CopyVRegsFrom(size_t i, const ShadowFrame& src, size_t src_i, size_t count) {
+    DCHECK_LE(i + count, NumberOfVRegs());
+    DCHECK_LE(src_i + count, src.NumberOfVRegs());
+    memcpy(&vregs_[i], &src.vregs_[src_i], count * sizeof(uint32_t));
+    memcpy(&References()[i], &src.References()[src_i], count * sizeof(mirror::Object*));
+  }
+
   mirror::ArtMethod* GetMethod() const {
     DCHECK_NE(method_, static_cast<void*>(NULL));
     return method_;
@@ -262,6 +287,18 @@ class ShadowFrame {
     }
   }
 
+  ShadowFrame(uint32_t num_vregs, uint32_t num_ins, ShadowFrame* link, mirror::ArtMethod* method)
+      : number_of_vregs_(num_vregs), link_(link), method_(method), dex_pc_(0) {
+#if defined(ART_USE_PORTABLE_COMPILER)
+    CHECK_LT(num_vregs, static_cast<uint32_t>(kHasReferenceArray));
+    number_of_vregs_ |= kHasReferenceArray;
+#endif
+    DCHECK_LE(num_ins, num_vregs);
+    const size_t num_locals = num_vregs - num_ins;
+    memset(vregs_, 0, num_locals * sizeof(uint32_t));
+    memset(References(), 0, num_locals * sizeof(mirror::Object*));
+  }
+
   mirror::Object* const* References() const {
     DCHECK(HasReferenceArray());
     const uint32_t* vreg_end = &vregs_[NumberOfVRegs()];
@@ -389,6 +426,55 @@ class PACKED(4) ManagedStack {
   uintptr_t top_quick_frame_pc_;
 };
 
+// The layout of a method's quick frames: what a stack walk needs to step over a frame and to find
+// the callee saves and the dex registers in it. Computed from the method and its code item.
+struct QuickFrameInfo {
+  QuickFrameInfo()
+      : method(NULL), frame_size(0), core_spill_mask(0), fp_spill_mask(0), num_locals(0),
+        num_ins(0), vmap_table(NULL) {}
+
+  const mirror::ArtMethod* method;
+  size_t frame_size;
+  uint32_t core_spill_mask;
+  uint32_t fp_spill_mask;
+  // The dex registers that aren't ins, and the ins. Zero for methods without a code item.
+  uint16_t num_locals;
+  uint16_t num_ins;
+  const uint8_t* vmap_table;
+
+  size_t GetReturnPcOffset() const {
+    return frame_size - kPointerSize;
+  }
+};
+
+// A direct mapped cache of the QuickFrameInfo of the methods met by a thread's stack walks, so that
+// walks don't go to the dex file for every frame. A method with a frame on a stack has run, its
+// class is linked and, as classes aren't unloaded, the method is never freed nor its frame layout
+// changed. Entries therefore never go stale.
+class QuickFrameInfoCache {
+ public:
+  QuickFrameInfoCache() {}
+
+  const QuickFrameInfo& Get(const mirror::ArtMethod* method)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    QuickFrameInfo* info = &infos_[(reinterpret_cast<uintptr_t>(method) / kObjectAlignment) % kSize];
+    if (UNLIKELY(info->method != method)) {
+      Compute(method, info);
+    }
+    return *info;
+  }
+
+  static void Compute(const mirror::ArtMethod* method, QuickFrameInfo* info)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+ private:
+  static const size_t kSize = 128;
+
+  QuickFrameInfo infos_[kSize];
+
+  DISALLOW_COPY_AND_ASSIGN(QuickFrameInfoCache);
+};
+
 class StackVisitor {
  protected:
   StackVisitor(Thread* thread, Context* context) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -427,7 +513,7 @@ class StackVisitor {
     DCHECK(GetMethod() != NULL);
     byte* save_addr =
         reinterpret_cast<byte*>(cur_quick_frame_) + frame_size - ((num + 1) * kPointerSize);
-#if defined(__i386__)
+#if defined(__i386__) || defined(__x86_64__)
     save_addr -= kPointerSize;  // account for return address
 #endif
     return reinterpret_cast<uintptr_t*>(save_addr);
@@ -459,10 +545,10 @@ class StackVisitor {
   uintptr_t GetGPR(uint32_t reg) const;
   void SetGPR(uint32_t reg, uintptr_t value);
 
-  uint32_t GetVReg(mirror::ArtMethod** cur_quick_frame, const DexFile::CodeItem* code_item,
-                   uint32_t core_spills, uint32_t fp_spills, size_t frame_size,
+  uint32_t GetVReg(mirror::ArtMethod** cur_quick_frame, const QuickFrameInfo& info,
                    uint16_t vreg) const {
-    int offset = GetVRegOffset(code_item, core_spills, fp_spills, frame_size, vreg);
+    int offset = GetVRegOffset(info.num_locals, info.core_spill_mask, info.fp_spill_mask,
+                               info.frame_size, vreg);
     DCHECK_EQ(cur_quick_frame, GetCurrentQuickFrame());
     byte* vreg_addr = reinterpret_cast<byte*>(cur_quick_frame) + offset;
     return *reinterpret_cast<uint32_t*>(vreg_addr);
@@ -513,10 +599,16 @@ class StackVisitor {
   static int GetVRegOffset(const DexFile::CodeItem* code_item,
                            uint32_t core_spills, uint32_t fp_spills,
                            size_t frame_size, int reg) {
+    return GetVRegOffset(code_item->registers_size_ - code_item->ins_size_, core_spills,
+                         fp_spills, frame_size, reg);
+  }
+
+  // As above, given the number of dex registers that aren't ins.
+  static int GetVRegOffset(size_t num_locals, uint32_t core_spills, uint32_t fp_spills,
+                           size_t frame_size, int reg) {
     DCHECK_EQ(frame_size & (kStackAlignment - 1), 0U);
     int num_spills = __builtin_popcount(core_spills) + __builtin_popcount(fp_spills) + 1;  // Filler.
-    int num_ins = code_item->ins_size_;
-    int num_regs = code_item->registers_size_ - num_ins;
+    int num_regs = num_locals;
     int locals_start = frame_size - ((num_spills + num_regs) * sizeof(uint32_t));
     if (reg == -2) {
       return 0;  // Method*
@@ -541,6 +633,22 @@ class StackVisitor {
     return cur_shadow_frame_;
   }
 
+  // The frame layout of the current quick frame's method.
+  const QuickFrameInfo& GetCurrentQuickFrameInfo() const
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    DCHECK(cur_quick_frame_ != NULL);
+    const mirror::ArtMethod* method = *cur_quick_frame_;
+    if (cur_frame_info_.method != method) {
+      // Copied out of the cache, as walks nested in VisitFrame may evict the entry.
+      if (frame_info_cache_ != NULL) {
+        cur_frame_info_ = frame_info_cache_->Get(method);
+      } else {
+        QuickFrameInfoCache::Compute(method, &cur_frame_info_);
+      }
+    }
+    return cur_frame_info_;
+  }
+
   StackIndirectReferenceTable* GetCurrentSirt() const {
     mirror::ArtMethod** sp = GetCurrentQuickFrame();
     ++sp;  // Skip Method*; SIRT comes next;
@@ -566,6 +674,10 @@ class StackVisitor {
   size_t num_frames_;
   // Depth of the frame we're currently at.
   size_t cur_depth_;
+  // The walking thread's cache, NULL when walking from an unattached thread.
+  QuickFrameInfoCache* const frame_info_cache_;
+  // The frame layout of the last quick frame's method asked for.
+  mutable QuickFrameInfo cur_frame_info_;
 
  protected:
   Context* const context_;
@@ -65,21 +65,28 @@ inline void Thread::TransitionFromRunnableToSuspended(ThreadState new_state) {
   DCHECK_EQ(GetState(), kRunnable);
   union StateAndFlags old_state_and_flags;
   union StateAndFlags new_state_and_flags;
-  do {
+  while (true) {
     old_state_and_flags = state_and_flags_;
-    // Copy over flags and try to clear the checkpoint bit if it is set.
-    new_state_and_flags.as_struct.flags = old_state_and_flags.as_struct.flags & ~kCheckpointRequest;
+    if (UNLIKELY((old_state_and_flags.as_struct.flags & kCheckpointRequest) != 0)) {
+      // Run the checkpoint while still Runnable, and so still sharing the mutator lock.
+      RunCheckpointFunction();
+      AtomicClearFlag(kCheckpointRequest);
+      continue;
+    }
+    new_state_and_flags.as_struct.flags = old_state_and_flags.as_struct.flags;
     new_state_and_flags.as_struct.state = new_state;
-    // CAS the value without a memory barrier, that will occur in the unlock below.
-  } while (UNLIKELY(android_atomic_cas(old_state_and_flags.as_int, new_state_and_flags.as_int,
-                                       &state_and_flags_.as_int) != 0));
-  // If we toggled the checkpoint flag we must have cleared it.
-  uint16_t flag_change = new_state_and_flags.as_struct.flags ^ old_state_and_flags.as_struct.flags;
-  if (UNLIKELY((flag_change & kCheckpointRequest) != 0)) {
-    RunCheckpointFunction();
+    // Leaving Runnable releases the implicit share on mutator_lock_, so the CAS has release
+    // semantics.
+    if (LIKELY(android_atomic_release_cas(old_state_and_flags.as_int, new_state_and_flags.as_int,
+                                          &state_and_flags_.as_int) == 0)) {
+      break;
+    }
+  }
+  Locks::mutator_lock_->TransitionFromRunnableToSuspended(this);
+  if (UNLIKELY((new_state_and_flags.as_struct.flags & kSuspendRequest) != 0)) {
+    // A SuspendAll may be waiting for us to leave Runnable.
+    SignalSuspended();
   }
-  // Release share on mutator_lock_.
-  Locks::mutator_lock_->SharedUnlock(this);
 }
 
 inline ThreadState Thread::TransitionFromSuspendedToRunnable() {
@@ -87,8 +94,8 @@ inline ThreadState Thread::TransitionFromSuspendedToRunnable() {
   union StateAndFlags old_state_and_flags = state_and_flags_;
   int16_t old_state = old_state_and_flags.as_struct.state;
   DCHECK_NE(static_cast<ThreadState>(old_state), kRunnable);
+  Locks::mutator_lock_->AssertNotHeld(this);  // Otherwise we starve GC..
   do {
-    Locks::mutator_lock_->AssertNotHeld(this);  // Otherwise we starve GC..
     old_state_and_flags = state_and_flags_;
     DCHECK_EQ(old_state_and_flags.as_struct.state, old_state);
     if (UNLIKELY((old_state_and_flags.as_struct.flags & kSuspendRequest) != 0)) {
@@ -104,23 +111,18 @@ inline ThreadState Thread::TransitionFromSuspendedToRunnable() {
       }
       DCHECK_EQ(GetSuspendCount(), 0);
     }
-    // Re-acquire shared mutator_lock_ access.
-    Locks::mutator_lock_->SharedLock(this);
-    // Atomically change from suspended to runnable if no suspend request pending.
+    // Atomically change from suspended to runnable if no suspend request pending. Becoming
+    // Runnable acquires the implicit share on mutator_lock_, so the CAS has acquire semantics.
     old_state_and_flags = state_and_flags_;
     DCHECK_EQ(old_state_and_flags.as_struct.state, old_state);
     if (LIKELY((old_state_and_flags.as_struct.flags & kSuspendRequest) == 0)) {
       union StateAndFlags new_state_and_flags = old_state_and_flags;
       new_state_and_flags.as_struct.state = kRunnable;
-      // CAS the value without a memory barrier, that occurred in the lock above.
-      done = android_atomic_cas(old_state_and_flags.as_int, new_state_and_flags.as_int,
-                                &state_and_flags_.as_int) == 0;
-    }
-    if (UNLIKELY(!done)) {
-      // Failed to transition to Runnable. Release shared mutator_lock_ access and try again.
-      Locks::mutator_lock_->SharedUnlock(this);
+      done = android_atomic_acquire_cas(old_state_and_flags.as_int, new_state_and_flags.as_int,
+                                        &state_and_flags_.as_int) == 0;
     }
   } while (UNLIKELY(!done));
+  Locks::mutator_lock_->TransitionFromSuspendedToRunnable(this);
   return static_cast<ThreadState>(old_state);
 }
 
@@ -45,6 +45,7 @@
 #include "gc/space/space.h"
 #include "invoke_arg_array_builder.h"
 #include "jni_internal.h"
+#include "mem_map.h"
 #include "mirror/art_field-inl.h"
 #include "mirror/art_method-inl.h"
 #include "mirror/class-inl.h"
@@ -63,6 +64,8 @@
 #include "stack_indirect_reference_table.h"
 #include "thread-inl.h"
 #include "thread_list.h"
+#include "trace.h"
+#include "transaction.h"
 #include "utils.h"
 #include "verifier/dex_gc_map.h"
 #include "verifier/method_verifier.h"
@@ -74,6 +77,7 @@ namespace art {
 bool Thread::is_started_ = false;
 pthread_key_t Thread::pthread_key_self_;
 ConditionVariable* Thread::resume_cond_ = NULL;
+ConditionVariable* Thread::suspended_cond_ = NULL;
 
 static const char* kThreadNameDuringStartup = "<native thread without managed peer>";
 
@@ -90,6 +94,14 @@ static void UnimplementedEntryPoint() {
 void InitEntryPoints(InterpreterEntryPoints* ipoints, JniEntryPoints* jpoints,
                      PortableEntryPoints* ppoints, QuickEntryPoints* qpoints);
 
+extern "C" void artMethodEntryHook(mirror::ArtMethod* method, Thread* self);
+extern "C" uint64_t artMethodExitHook(mirror::ArtMethod* method, Thread* self, uint64_t result);
+
+void Thread::SetMethodHooksEnabled(bool enabled) {
+  quick_entrypoints_.pMethodEntryHook = enabled ? artMethodEntryHook : NULL;
+  quick_entrypoints_.pMethodExitHook = enabled ? artMethodExitHook : NULL;
+}
+
 void Thread::InitTlsEntryPoints() {
 #if !defined(__APPLE__)  // The Mac GCC is too old to accept this code.
   // Insert a placeholder so we can easily tell if we call an unimplemented entry point.
@@ -218,7 +230,7 @@ static size_t FixStackSize(size_t stack_size) {
   // It's likely that callers are trying to ensure they have at least a certain amount of
   // stack space, so we should add our reserved space on top of what they requested, rather
   // than implicitly take it away from them.
-  stack_size += Thread::kStackOverflowReservedBytes;
+  stack_size += Thread::kStackOverflowReservedBytes + Thread::kStackOverflowProtectedSize;
 
   // Some systems require the stack size to be a multiple of the system page size, so round up.
   stack_size = RoundUp(stack_size, kPageSize);
@@ -307,6 +319,7 @@ void Thread::Init(ThreadList* thread_list, JavaVMExt* java_vm) {
 
   thin_lock_id_ = thread_list->AllocThreadId(this);
   InitStackHwm();
+  ProtectStackGuard();
 
   jni_env_ = new JNIEnvExt(this, java_vm);
   thread_list->Register(this);
@@ -560,7 +573,27 @@ void Thread::ModifySuspendCount(Thread* self, int delta, bool for_debugger) {
     AtomicClearFlag(kSuspendRequest);
   } else {
     AtomicSetFlag(kSuspendRequest);
+    TriggerSuspend();
+  }
+}
+
+void Thread::SignalSuspended() {
+  MutexLock mu(this, *Locks::thread_suspend_count_lock_);
+  suspended_cond_->Broadcast(this);
+}
+
+ThreadState Thread::SetStateUnsafe(ThreadState new_state) {
+  ThreadState old_state = GetState();
+  state_and_flags_.as_struct.state = new_state;
+  if (old_state == kRunnable && new_state != kRunnable) {
+    // As in TransitionFromRunnableToSuspended, a SuspendAll may have seen us Runnable. Order the
+    // store of the state before the read of the flags.
+    ANDROID_MEMBAR_FULL();
+    if (ReadFlag(kSuspendRequest)) {
+      SignalSuspended();
+    }
   }
+  return old_state;
 }
 
 void Thread::RunCheckpointFunction() {
@@ -580,6 +613,9 @@ bool Thread::RequestCheckpoint(Closure* function) {
   new_state_and_flags.as_struct.flags |= kCheckpointRequest;
   int succeeded = android_atomic_cmpxchg(old_state_and_flags.as_int, new_state_and_flags.as_int,
                                          &state_and_flags_.as_int);
+  if (succeeded == 0) {
+    TriggerSuspend();
+  }
   return succeeded == 0;
 }
 
@@ -917,6 +953,8 @@ void Thread::Startup() {
     MutexLock mu(NULL, *Locks::thread_suspend_count_lock_);
     resume_cond_ = new ConditionVariable("Thread resumption condition variable",
                                          *Locks::thread_suspend_count_lock_);
+    suspended_cond_ = new ConditionVariable("Thread suspension condition variable",
+                                            *Locks::thread_suspend_count_lock_);
   }
 
   // Allocate a TLS slot.
@@ -948,6 +986,10 @@ void Thread::Shutdown() {
     delete resume_cond_;
     resume_cond_ = NULL;
   }
+  if (suspended_cond_ != NULL) {
+    delete suspended_cond_;
+    suspended_cond_ = NULL;
+  }
 }
 
 Thread::Thread(bool daemon)
@@ -971,15 +1013,18 @@ Thread::Thread(bool daemon)
       wait_monitor_(NULL),
       interrupted_(false),
       wait_next_(NULL),
+      wait_prev_(NULL),
       monitor_enter_object_(NULL),
       top_sirt_(NULL),
       runtime_(NULL),
       class_loader_override_(NULL),
+      transaction_(NULL),
       long_jump_context_(NULL),
       throwing_OutOfMemoryError_(false),
       debug_suspend_count_(0),
       debug_invoke_req_(new DebugInvokeReq),
       deoptimization_shadow_frame_(NULL),
+      interpreter_forced_(false),
       instrumentation_stack_(new std::deque<instrumentation::InstrumentationStackFrame>),
       name_(new std::string(kThreadNameDuringStartup)),
       daemon_(daemon),
@@ -987,11 +1032,52 @@ Thread::Thread(bool daemon)
       no_thread_suspension_(0),
       last_no_thread_suspension_cause_(NULL),
       checkpoint_function_(0),
-      thread_exit_check_count_(0) {
+      suspend_trigger_(NULL),
+      stack_guard_(NULL),
+      stack_guard_is_mapping_(false),
+      thread_local_start_(NULL),
+      thread_local_pos_(NULL),
+      thread_local_end_(NULL),
+      thread_local_objects_(0),
+      thread_local_alloc_stack_top_(NULL),
+      thread_local_alloc_stack_end_(NULL),
+      alloc_profiler_bytes_until_sample_(0),
+      interpreter_stack_(NULL),
+      interpreter_stack_begin_(NULL),
+      interpreter_stack_top_(NULL),
+      interpreter_stack_end_(NULL),
+      thread_exit_check_count_(0),
+      quick_frame_info_cache_(NULL),
+      catch_handler_cache_(NULL),
+      proxy_invoke_cache_(NULL),
+      reflective_invoke_cache_(NULL),
+      reflective_field_cache_(NULL),
+      trace_buffer_(NULL),
+      trace_buffer_offset_(0) {
   CHECK_EQ((sizeof(Thread) % 4), 0U) << sizeof(Thread);
   state_and_flags_.as_struct.flags = 0;
   state_and_flags_.as_struct.state = kNative;
   memset(&held_mutexes_[0], 0, sizeof(held_mutexes_));
+  memset(&interface_cache_[0], 0, sizeof(interface_cache_));
+  RemoveSuspendTrigger();
+}
+
+mirror::ArtMethod* Thread::FindVirtualMethodForInterface(mirror::Class* klass,
+                                                         mirror::ArtMethod* interface_method) {
+  uintptr_t hash = (reinterpret_cast<uintptr_t>(klass) >> 3) ^
+      (reinterpret_cast<uintptr_t>(interface_method) >> 4);
+  InterfaceCacheEntry& entry = interface_cache_[hash & (kInterfaceCacheSize - 1)];
+  if (LIKELY(entry.klass == klass && entry.interface_method == interface_method)) {
+    DCHECK_EQ(entry.method, klass->FindVirtualMethodForInterface(interface_method));
+    return entry.method;
+  }
+  mirror::ArtMethod* method = klass->FindVirtualMethodForInterface(interface_method);
+  if (method != NULL) {
+    entry.klass = klass;
+    entry.interface_method = interface_method;
+    entry.method = method;
+  }
+  return method;
 }
 
 bool Thread::IsStillStarting() const {
@@ -1053,6 +1139,12 @@ void Thread::Destroy() {
   if (jni_env_ != NULL) {
     jni_env_->monitors.VisitRoots(MonitorExitVisitor, self);
   }
+
+  // Hand any unused part of our allocation buffer back to the heap.
+  Runtime::Current()->GetHeap()->RevokeThreadLocalBuffers(self);
+
+  // Hand the method trace records we buffered to the trace.
+  Trace::ThreadExiting(self);
 }
 
 Thread::~Thread() {
@@ -1081,10 +1173,37 @@ Thread::~Thread() {
   delete instrumentation_stack_;
   delete name_;
   delete stack_trace_sample_;
-
+  delete interpreter_stack_;
+  delete quick_frame_info_cache_;
+  delete catch_handler_cache_;
+  delete proxy_invoke_cache_;
+  delete reflective_invoke_cache_;
+  delete reflective_field_cache_;
+
+  UnprotectStackGuard();
   TearDownAlternateSignalStack();
 }
 
+void* Thread::PushInterpreterFrameSlowPath(size_t size) {
+  if (interpreter_stack_ == NULL) {
+    // Pages are only touched by the frames that use them.
+    interpreter_stack_ = MemMap::MapAnonymous("interpreter stack", NULL, kInterpreterStackSize,
+                                              PROT_READ | PROT_WRITE);
+    if (interpreter_stack_ == NULL) {
+      return NULL;
+    }
+    interpreter_stack_begin_ = interpreter_stack_->Begin();
+    interpreter_stack_top_ = interpreter_stack_begin_;
+    interpreter_stack_end_ = interpreter_stack_->End();
+  }
+  if (static_cast<size_t>(interpreter_stack_end_ - interpreter_stack_top_) < size) {
+    return NULL;
+  }
+  void* frame = interpreter_stack_top_;
+  interpreter_stack_top_ += size;
+  return frame;
+}
+
 void Thread::HandleUncaughtExceptions(ScopedObjectAccess& soa) {
   if (!IsExceptionPending()) {
     return;
@@ -1182,10 +1301,7 @@ mirror::Object* Thread::DecodeJObject(jobject obj) const {
       result = kInvalidIndirectRefObject;
     }
   } else if (kind == kGlobal) {
-    JavaVMExt* vm = Runtime::Current()->GetJavaVM();
-    IndirectReferenceTable& globals = vm->globals;
-    ReaderMutexLock mu(const_cast<Thread*>(this), vm->globals_lock);
-    result = const_cast<mirror::Object*>(globals.Get(ref));
+    result = Runtime::Current()->GetJavaVM()->DecodeGlobal(const_cast<Thread*>(this), ref);
   } else {
     DCHECK_EQ(kind, kWeakGlobal);
     result = Runtime::Current()->GetJavaVM()->DecodeWeakGlobal(const_cast<Thread*>(this), ref);
@@ -1243,10 +1359,10 @@ void Thread::NotifyLocked(Thread* self) {
 
 class CountStackDepthVisitor : public StackVisitor {
  public:
-  explicit CountStackDepthVisitor(Thread* thread)
+  CountStackDepthVisitor(Thread* thread, size_t max_depth)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_)
       : StackVisitor(thread, NULL),
-        depth_(0), skip_depth_(0), skipping_(true) {}
+        depth_(0), skip_depth_(0), max_depth_(max_depth), skipping_(true) {}
 
   bool VisitFrame() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
     // We want to skip frames up to and including the exception's constructor.
@@ -1260,6 +1376,9 @@ class CountStackDepthVisitor : public StackVisitor {
     if (!skipping_) {
       if (!m->IsRuntimeMethod()) {  // Ignore runtime frames (in particular callee save).
         ++depth_;
+        if (depth_ == max_depth_) {
+          return false;  // No need to walk the frames that won't be captured.
+        }
       }
     } else {
       ++skip_depth_;
@@ -1278,14 +1397,20 @@ class CountStackDepthVisitor : public StackVisitor {
  private:
   uint32_t depth_;
   uint32_t skip_depth_;
+  // The number of frames at which to stop counting, 0 for no limit.
+  const uint32_t max_depth_;
   bool skipping_;
 };
 
+// Pc trace entries of quick frames hold the offset of the native pc into the code of the method
+// with this bit set. Entries of shadow frames hold their dex pc, which is known without a lookup.
+static const uint32_t kInternalStackTraceNativePcOffsetFlag = 0x80000000;
+
 class BuildInternalStackTraceVisitor : public StackVisitor {
  public:
   explicit BuildInternalStackTraceVisitor(Thread* self, Thread* thread, int skip_depth)
       : StackVisitor(thread, NULL), self_(self),
-        skip_depth_(skip_depth), count_(0), dex_pc_trace_(NULL), method_trace_(NULL) {}
+        skip_depth_(skip_depth), count_(0), depth_(0), pc_trace_(NULL), method_trace_(NULL) {}
 
   bool Init(int depth)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
@@ -1297,19 +1422,20 @@ class BuildInternalStackTraceVisitor : public StackVisitor {
     if (method_trace.get() == NULL) {
       return false;
     }
-    mirror::IntArray* dex_pc_trace = mirror::IntArray::Alloc(self_, depth);
-    if (dex_pc_trace == NULL) {
+    mirror::IntArray* pc_trace = mirror::IntArray::Alloc(self_, depth);
+    if (pc_trace == NULL) {
       return false;
     }
     // Save PC trace in last element of method trace, also places it into the
     // object graph.
-    method_trace->Set(depth, dex_pc_trace);
+    method_trace->Set(depth, pc_trace);
     // Set the Object*s and assert that no thread suspension is now possible.
     const char* last_no_suspend_cause =
         self_->StartAssertNoThreadSuspension("Building internal stack trace");
     CHECK(last_no_suspend_cause == NULL) << last_no_suspend_cause;
     method_trace_ = method_trace.get();
-    dex_pc_trace_ = dex_pc_trace;
+    pc_trace_ = pc_trace;
+    depth_ = depth;
     return true;
   }
 
@@ -1320,9 +1446,12 @@ class BuildInternalStackTraceVisitor : public StackVisitor {
   }
 
   bool VisitFrame() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
-    if (method_trace_ == NULL || dex_pc_trace_ == NULL) {
+    if (method_trace_ == NULL || pc_trace_ == NULL) {
       return true;  // We're probably trying to fillInStackTrace for an OutOfMemoryError.
     }
+    if (count_ == depth_) {
+      return false;  // The trace is full.
+    }
     if (skip_depth_ > 0) {
       skip_depth_--;
       return true;
@@ -1332,7 +1461,16 @@ class BuildInternalStackTraceVisitor : public StackVisitor {
       return true;  // Ignore runtime frames (in particular callee save).
     }
     method_trace_->Set(count_, m);
-    dex_pc_trace_->Set(count_, GetDexPc());
+#if !defined(ART_USE_PORTABLE_COMPILER)
+    if (!IsShadowFrame()) {
+      // Defer the search of the mapping table to when the trace is converted, if ever.
+      pc_trace_->Set(count_, GetNativePcOffset() | kInternalStackTraceNativePcOffsetFlag);
+    } else {
+      pc_trace_->Set(count_, GetDexPc());
+    }
+#else
+    pc_trace_->Set(count_, GetDexPc());
+#endif
     ++count_;
     return true;
   }
@@ -1347,15 +1485,18 @@ class BuildInternalStackTraceVisitor : public StackVisitor {
   int32_t skip_depth_;
   // Current position down stack trace.
   uint32_t count_;
-  // Array of dex PC values.
-  mirror::IntArray* dex_pc_trace_;
+  // The number of frames the trace has room for.
+  uint32_t depth_;
+  // Array of encoded PC values, see DecodeInternalStackTracePc.
+  mirror::IntArray* pc_trace_;
   // An array of the methods on the stack, the last entry is a reference to the PC trace.
   mirror::ObjectArray<mirror::Object>* method_trace_;
 };
 
-jobject Thread::CreateInternalStackTrace(const ScopedObjectAccessUnchecked& soa) const {
+jobject Thread::CreateInternalStackTrace(const ScopedObjectAccessUnchecked& soa,
+                                         size_t max_depth) const {
   // Compute depth of stack
-  CountStackDepthVisitor count_visitor(const_cast<Thread*>(this));
+  CountStackDepthVisitor count_visitor(const_cast<Thread*>(this), max_depth);
   count_visitor.WalkStack();
   int32_t depth = count_visitor.GetDepth();
   int32_t skip_depth = count_visitor.GetSkipDepth();
@@ -1376,6 +1517,14 @@ jobject Thread::CreateInternalStackTrace(const ScopedObjectAccessUnchecked& soa)
   return soa.AddLocalReference<jobjectArray>(trace);
 }
 
+uint32_t Thread::DecodeInternalStackTracePc(const mirror::ArtMethod* method, int32_t pc) {
+  uint32_t value = static_cast<uint32_t>(pc);
+  if ((value & kInternalStackTraceNativePcOffsetFlag) != 0) {
+    return method->NativePcOffsetToDexPc(value & ~kInternalStackTraceNativePcOffsetFlag);
+  }
+  return value;
+}
+
 jobjectArray Thread::InternalStackTraceToStackTraceElementArray(JNIEnv* env, jobject internal,
     jobjectArray output_array, int* stack_depth) {
   // Transition into runnable state to work on Object*/Array*
@@ -1414,7 +1563,7 @@ jobjectArray Thread::InternalStackTraceToStackTraceElementArray(JNIEnv* env, job
     // Prepare parameters for StackTraceElement(String cls, String method, String file, int line)
     mirror::ArtMethod* method = down_cast<mirror::ArtMethod*>(method_trace->Get(i));
     mh.ChangeMethod(method);
-    uint32_t dex_pc = pc_trace->Get(i);
+    uint32_t dex_pc = DecodeInternalStackTracePc(method, pc_trace->Get(i));
     int32_t line_number = mh.GetLineNumFromDexPC(dex_pc);
     // Allocate element, potentially triggering GC
     // TODO: reuse class_name_object via Class::name_?
@@ -1673,6 +1822,7 @@ static const EntryPointInfo gThreadEntryPointInfo[] = {
   QUICK_ENTRY_POINT_INFO(pIndexOf),
   QUICK_ENTRY_POINT_INFO(pMemcmp16),
   QUICK_ENTRY_POINT_INFO(pStringCompareTo),
+  QUICK_ENTRY_POINT_INFO(pStringEquals),
   QUICK_ENTRY_POINT_INFO(pMemcpy),
   QUICK_ENTRY_POINT_INFO(pQuickResolutionTrampoline),
   QUICK_ENTRY_POINT_INFO(pQuickToInterpreterBridge),
@@ -1682,6 +1832,8 @@ static const EntryPointInfo gThreadEntryPointInfo[] = {
   QUICK_ENTRY_POINT_INFO(pInvokeStaticTrampolineWithAccessCheck),
   QUICK_ENTRY_POINT_INFO(pInvokeSuperTrampolineWithAccessCheck),
   QUICK_ENTRY_POINT_INFO(pInvokeVirtualTrampolineWithAccessCheck),
+  QUICK_ENTRY_POINT_INFO(pMethodEntryHook),
+  QUICK_ENTRY_POINT_INFO(pMethodExitHook),
   QUICK_ENTRY_POINT_INFO(pCheckSuspend),
   QUICK_ENTRY_POINT_INFO(pTestSuspend),
   QUICK_ENTRY_POINT_INFO(pDeliverException),
@@ -1713,6 +1865,11 @@ void Thread::DumpThreadOffset(std::ostream& os, uint32_t offset, size_t size_of_
   // DO_THREAD_OFFSET(top_of_managed_stack_);
   // DO_THREAD_OFFSET(top_of_managed_stack_pc_);
   DO_THREAD_OFFSET(top_sirt_);
+  DO_THREAD_OFFSET(thread_local_pos_);
+  DO_THREAD_OFFSET(thread_local_end_);
+  DO_THREAD_OFFSET(thread_local_objects_);
+  DO_THREAD_OFFSET(thread_local_alloc_stack_top_);
+  DO_THREAD_OFFSET(thread_local_alloc_stack_end_);
 #undef DO_THREAD_OFFSET
 
   size_t entry_point_count = arraysize(gThreadEntryPointInfo);
@@ -1744,6 +1901,7 @@ class CatchBlockStackVisitor : public StackVisitor {
         native_method_count_(0), clear_exception_(false),
         method_tracing_active_(is_deoptimization ||
                                Runtime::Current()->GetInstrumentation()->AreExitStubsInstalled()),
+        method_hooks_active_(!is_deoptimization && self->AreMethodHooksEnabled()),
         instrumentation_frames_to_pop_(0), top_shadow_frame_(NULL), prev_shadow_frame_(NULL) {
     // Exception not in root sets, can't allow GC.
     last_no_assert_suspension_cause_ = self->StartAssertNoThreadSuspension("Finding catch block");
@@ -1779,21 +1937,32 @@ class CatchBlockStackVisitor : public StackVisitor {
   }
 
   bool HandleTryItems(mirror::ArtMethod* method) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
-    uint32_t dex_pc = DexFile::kDexNoIndex;
     if (method->IsNative()) {
       native_method_count_++;
+      return true;  // Continue stack walk.
+    }
+    CatchHandlerInfo info;
+    if (!IsShadowFrame()) {
+      info = self_->GetCatchHandlerCache()->Get(method, to_find_, GetCurrentQuickFramePc());
     } else {
-      dex_pc = GetDexPc();
-    }
-    if (dex_pc != DexFile::kDexNoIndex) {
-      uint32_t found_dex_pc = method->FindCatchBlock(to_find_, dex_pc, &clear_exception_);
-      if (found_dex_pc != DexFile::kDexNoIndex) {
-        handler_dex_pc_ = found_dex_pc;
-        handler_quick_frame_pc_ = method->ToNativePc(found_dex_pc);
-        handler_quick_frame_ = GetCurrentQuickFrame();
-        return false;  // End stack walk.
+      info.handler_dex_pc = method->FindCatchBlock(to_find_, GetDexPc(),
+                                                   &info.has_no_move_exception);
+      if (info.handler_dex_pc != DexFile::kDexNoIndex) {
+        info.handler_pc = method->ToNativePc(info.handler_dex_pc);
       }
     }
+    if (info.handler_dex_pc != DexFile::kDexNoIndex) {
+      clear_exception_ = info.has_no_move_exception;
+      handler_dex_pc_ = info.handler_dex_pc;
+      handler_quick_frame_pc_ = info.handler_pc;
+      handler_quick_frame_ = GetCurrentQuickFrame();
+      return false;  // End stack walk.
+    }
+    if (UNLIKELY(method_hooks_active_) && !IsShadowFrame() && method->HasMethodHooks()) {
+      // The exit hook of the method won't run, report the unwind instead.
+      HookedFrame frame = { GetThisObject(), method, GetDexPc(), instrumentation_frames_to_pop_ };
+      hooked_frames_.push_back(frame);
+    }
     return true;  // Continue stack walk.
   }
 
@@ -1862,13 +2031,18 @@ class CatchBlockStackVisitor : public StackVisitor {
     self_->EndAssertNoThreadSuspension(last_no_assert_suspension_cause_);
     // Do instrumentation events after allowing thread suspension again.
     instrumentation::Instrumentation* instrumentation = Runtime::Current()->GetInstrumentation();
+    size_t hooked_frame_index = 0;
     for (size_t i = 0; i < instrumentation_frames_to_pop_; ++i) {
+      hooked_frame_index = UnwindHookedFrames(instrumentation, hooked_frame_index, i);
       // We pop the instrumentation stack here so as not to corrupt it during the stack walk.
       if (i != instrumentation_frames_to_pop_ - 1 || self_->GetInstrumentationStack()->front().method_ != catch_method) {
         // Don't pop the instrumentation frame of the catch handler.
         instrumentation->PopMethodForUnwind(self_, is_deoptimization_);
       }
     }
+    UnwindHookedFrames(instrumentation, hooked_frame_index, instrumentation_frames_to_pop_);
+    // The long jump skips the destructor.
+    std::vector<HookedFrame>().swap(hooked_frames_);
     if (!is_deoptimization_) {
       instrumentation->ExceptionCaughtEvent(self_, throw_location_, catch_method, handler_dex_pc_,
                                             exception_);
@@ -1886,6 +2060,30 @@ class CatchBlockStackVisitor : public StackVisitor {
   }
 
  private:
+  // A frame of code compiled with method hooks that the exception unwinds.
+  struct HookedFrame {
+    mirror::Object* this_object;
+    mirror::ArtMethod* method;
+    uint32_t dex_pc;
+    // The number of frames with instrumentation exit stubs inside this one.
+    size_t instrumentation_frames_inside;
+  };
+
+  // Reports the unwinds of the hooked frames from the given index that are inside the same
+  // number of frames with exit stubs, returning the index of the next one, so that the unwinds of
+  // both kinds of frames are reported innermost first.
+  size_t UnwindHookedFrames(instrumentation::Instrumentation* instrumentation, size_t index,
+                            size_t instrumentation_frames_inside)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    for (; index < hooked_frames_.size() &&
+         hooked_frames_[index].instrumentation_frames_inside == instrumentation_frames_inside;
+         ++index) {
+      const HookedFrame& frame = hooked_frames_[index];
+      instrumentation->MethodUnwindEvent(self_, frame.this_object, frame.method, frame.dex_pc);
+    }
+    return index;
+  }
+
   Thread* const self_;
   mirror::Throwable* const exception_;
   const bool is_deoptimization_;
@@ -1905,10 +2103,14 @@ class CatchBlockStackVisitor : public StackVisitor {
   bool clear_exception_;
   // Is method tracing active?
   const bool method_tracing_active_;
+  // Does compiled code call the method hooks of the thread?
+  const bool method_hooks_active_;
   // Support for nesting no thread suspension checks.
   const char* last_no_assert_suspension_cause_;
   // Number of frames to pop in long jump.
   size_t instrumentation_frames_to_pop_;
+  // The unwound frames of code compiled with method hooks, innermost first.
+  std::vector<HookedFrame> hooked_frames_;
   ShadowFrame* top_shadow_frame_;
   ShadowFrame* prev_shadow_frame_;
 };
@@ -2049,19 +2251,14 @@ class ReferenceMapVisitor : public StackVisitor {
       if (!m->IsNative() && !m->IsRuntimeMethod() && !m->IsProxyMethod()) {
         const uint8_t* native_gc_map = m->GetNativeGcMap();
         CHECK(native_gc_map != NULL) << PrettyMethod(m);
-        mh_.ChangeMethod(m);
-        const DexFile::CodeItem* code_item = mh_.GetCodeItem();
-        DCHECK(code_item != NULL) << PrettyMethod(m);  // Can't be NULL or how would we compile its instructions?
+        const QuickFrameInfo& frame_info = GetCurrentQuickFrameInfo();
         NativePcOffsetToReferenceMap map(native_gc_map);
         size_t num_regs = std::min(map.RegWidth() * 8,
-                                   static_cast<size_t>(code_item->registers_size_));
+                                   static_cast<size_t>(frame_info.num_locals + frame_info.num_ins));
         if (num_regs > 0) {
           const uint8_t* reg_bitmap = map.FindBitMap(GetNativePcOffset());
           DCHECK(reg_bitmap != NULL);
-          const VmapTable vmap_table(m->GetVmapTable());
-          uint32_t core_spills = m->GetCoreSpillMask();
-          uint32_t fp_spills = m->GetFpSpillMask();
-          size_t frame_size = m->GetFrameSizeInBytes();
+          const VmapTable vmap_table(frame_info.vmap_table);
           // For all dex registers in the bitmap
           mirror::ArtMethod** cur_quick_frame = GetCurrentQuickFrame();
           DCHECK(cur_quick_frame != NULL);
@@ -2071,13 +2268,11 @@ class ReferenceMapVisitor : public StackVisitor {
               uint32_t vmap_offset;
               mirror::Object* ref;
               if (vmap_table.IsInContext(reg, kReferenceVReg, &vmap_offset)) {
-                uintptr_t val = GetGPR(vmap_table.ComputeRegister(core_spills, vmap_offset,
-                                                                  kReferenceVReg));
+                uintptr_t val = GetGPR(vmap_table.ComputeRegister(frame_info.core_spill_mask,
+                                                                  vmap_offset, kReferenceVReg));
                 ref = reinterpret_cast<mirror::Object*>(val);
               } else {
-                ref = reinterpret_cast<mirror::Object*>(GetVReg(cur_quick_frame, code_item,
-                                                                core_spills, fp_spills, frame_size,
-                                                                reg));
+                ref = reinterpret_cast<mirror::Object*>(GetVReg(cur_quick_frame, frame_info, reg));
               }
 
               if (ref != NULL) {
@@ -2098,9 +2293,6 @@ class ReferenceMapVisitor : public StackVisitor {
 
   // Visitor for when we visit a root.
   const RootVisitor& visitor_;
-
-  // A method helper we keep around to avoid dex file/cache re-computations.
-  MethodHelper mh_;
 };
 
 class RootCallbackVisitor {
@@ -2159,8 +2351,12 @@ void Thread::VerifyRoots(VerifyRootVisitor* visitor, void* arg) {
   if (class_loader_override_ != NULL) {
     VerifyRootWrapperCallback(class_loader_override_, &wrapperArg);
   }
+  if (transaction_ != NULL) {
+    transaction_->VisitRoots(VerifyRootWrapperCallback, &wrapperArg);
+  }
   jni_env_->locals.VisitRoots(VerifyRootWrapperCallback, &wrapperArg);
   jni_env_->monitors.VisitRoots(VerifyRootWrapperCallback, &wrapperArg);
+  jni_env_->critical_pins.VisitRoots(VerifyRootWrapperCallback, &wrapperArg);
 
   SirtVisitRoots(VerifyRootWrapperCallback, &wrapperArg);
 
@@ -2194,8 +2390,12 @@ void Thread::VisitRoots(RootVisitor* visitor, void* arg) {
   if (class_loader_override_ != NULL) {
     visitor(class_loader_override_, arg);
   }
+  if (transaction_ != NULL) {
+    transaction_->VisitRoots(visitor, arg);
+  }
   jni_env_->locals.VisitRoots(visitor, arg);
   jni_env_->monitors.VisitRoots(visitor, arg);
+  jni_env_->critical_pins.VisitRoots(visitor, arg);
 
   SirtVisitRoots(visitor, arg);
 
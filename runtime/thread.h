@@ -26,6 +26,7 @@
 #include <string>
 
 #include "base/macros.h"
+#include "catch_handler_cache.h"
 #include "entrypoints/interpreter/interpreter_entrypoints.h"
 #include "entrypoints/jni/jni_entrypoints.h"
 #include "entrypoints/portable/portable_entrypoints.h"
@@ -34,6 +35,10 @@
 #include "jvalue.h"
 #include "locks.h"
 #include "offsets.h"
+#include "perf_counters.h"
+#include "proxy_invoke_cache.h"
+#include "reflective_field_cache.h"
+#include "reflective_invoke_cache.h"
 #include "root_visitor.h"
 #include "runtime_stats.h"
 #include "stack.h"
@@ -65,6 +70,7 @@ struct DebugInvokeReq;
 class DexFile;
 struct JavaVMExt;
 struct JNIEnvExt;
+class MemMap;
 class Monitor;
 class Runtime;
 class ScopedObjectAccess;
@@ -72,6 +78,7 @@ class ScopedObjectAccessUnchecked;
 class ShadowFrame;
 class Thread;
 class ThreadList;
+class Transaction;
 
 // Thread priorities. These must match the Thread.MIN_PRIORITY,
 // Thread.NORM_PRIORITY, and Thread.MAX_PRIORITY constants.
@@ -92,6 +99,11 @@ class PACKED(4) Thread {
   // Space to throw a StackOverflowError in.
   static const size_t kStackOverflowReservedBytes = 16 * KB;
 
+  // Inaccessible pages below the usable stack. The implicit stack overflow checks of compiled
+  // code probe kStackOverflowReservedBytes below the new frame, which faults here when the frame
+  // would go past the reserved space.
+  static const size_t kStackOverflowProtectedSize = 8 * KB;
+
   // Creates a new native thread corresponding to the given managed peer.
   // Used to implement Thread.start.
   static void CreateNativeThread(JNIEnv* env, jobject peer, size_t stack_size, bool daemon);
@@ -167,20 +179,31 @@ class PACKED(4) Thread {
 
   bool RequestCheckpoint(Closure* function);
 
+  // Makes the next implicit suspend check of compiled code fault, see suspend_trigger_.
+  void TriggerSuspend() {
+    suspend_trigger_ = NULL;
+  }
+
+  // Re-arms the implicit suspend checks once the thread has seen the request.
+  void RemoveSuspendTrigger() {
+    suspend_trigger_ = reinterpret_cast<uintptr_t*>(&suspend_trigger_);
+  }
+
   // Called when thread detected that the thread_suspend_count_ was non-zero. Gives up share of
   // mutator_lock_ and waits until it is resumed and thread_suspend_count_ is zero.
   void FullSuspendCheck()
       LOCKS_EXCLUDED(Locks::thread_suspend_count_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
-  // Transition from non-runnable to runnable state acquiring share on mutator_lock_.
+  // Transition from non-runnable to runnable state acquiring share on mutator_lock_. The share is
+  // implicit in the state, so this is a CAS of the state and flags unless suspension is pending.
   ThreadState TransitionFromSuspendedToRunnable()
       LOCKS_EXCLUDED(Locks::thread_suspend_count_lock_)
       SHARED_LOCK_FUNCTION(Locks::mutator_lock_)
       ALWAYS_INLINE;
 
   // Transition from runnable into a state where mutator privileges are denied. Releases share of
-  // mutator lock.
+  // mutator lock, implicit in the state.
   void TransitionFromRunnableToSuspended(ThreadState new_state)
       LOCKS_EXCLUDED(Locks::thread_suspend_count_lock_)
       UNLOCK_FUNCTION(Locks::mutator_lock_)
@@ -283,6 +306,10 @@ class PACKED(4) Thread {
     return &stats_;
   }
 
+  PerfCounters* GetPerfCounters() {
+    return &perf_counters_;
+  }
+
   bool IsStillStarting() const;
 
   bool IsExceptionPending() const {
@@ -392,9 +419,27 @@ class PACKED(4) Thread {
     class_loader_override_ = class_loader_override;
   }
 
+  // The transaction recording the stores of the class initializer this thread runs at compile
+  // time, or NULL.
+  Transaction* GetTransaction() const {
+    return transaction_;
+  }
+
+  void SetTransaction(Transaction* transaction) {
+    transaction_ = transaction;
+  }
+
   // Create the internal representation of a stack trace, that is more time
-  // and space efficient to compute than the StackTraceElement[]
-  jobject CreateInternalStackTrace(const ScopedObjectAccessUnchecked& soa) const
+  // and space efficient to compute than the StackTraceElement[]. Only the methods and their
+  // raw pcs are captured, the dex pcs are resolved when the trace is converted. At most max_depth
+  // frames are captured, 0 meaning all of them.
+  jobject CreateInternalStackTrace(const ScopedObjectAccessUnchecked& soa,
+                                   size_t max_depth = 0) const
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Returns the dex pc of an entry of the pc trace of an internal stack trace for the method of
+  // the entry.
+  static uint32_t DecodeInternalStackTracePc(const mirror::ArtMethod* method, int32_t pc)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   // Convert an internal stack trace representation (returned by CreateInternalStackTrace) to a
@@ -439,6 +484,30 @@ class PACKED(4) Thread {
     return ThreadOffset(OFFSETOF_MEMBER(Thread, state_and_flags_));
   }
 
+  static ThreadOffset SuspendTriggerOffset() {
+    return ThreadOffset(OFFSETOF_MEMBER(Thread, suspend_trigger_));
+  }
+
+  static ThreadOffset ThreadLocalPosOffset() {
+    return ThreadOffset(OFFSETOF_MEMBER(Thread, thread_local_pos_));
+  }
+
+  static ThreadOffset ThreadLocalEndOffset() {
+    return ThreadOffset(OFFSETOF_MEMBER(Thread, thread_local_end_));
+  }
+
+  static ThreadOffset ThreadLocalObjectsOffset() {
+    return ThreadOffset(OFFSETOF_MEMBER(Thread, thread_local_objects_));
+  }
+
+  static ThreadOffset ThreadLocalAllocStackTopOffset() {
+    return ThreadOffset(OFFSETOF_MEMBER(Thread, thread_local_alloc_stack_top_));
+  }
+
+  static ThreadOffset ThreadLocalAllocStackEndOffset() {
+    return ThreadOffset(OFFSETOF_MEMBER(Thread, thread_local_alloc_stack_end_));
+  }
+
   // Size of stack less any space reserved for stack overflow
   size_t GetStackSize() const {
     return stack_size_ - (stack_end_ - stack_begin_);
@@ -462,6 +531,13 @@ class PACKED(4) Thread {
     return stack_end_ == stack_begin_;
   }
 
+  // Whether addr is in the protected pages below the stack, or in the pthread guard page below
+  // the stack of a thread whose pages couldn't be protected.
+  bool IsInStackGuard(uintptr_t addr) const {
+    uintptr_t begin = reinterpret_cast<uintptr_t>(stack_begin_);
+    return addr < begin && begin - addr <= kStackOverflowProtectedSize + kPageSize;
+  }
+
   static ThreadOffset StackEndOffset() {
     return ThreadOffset(OFFSETOF_MEMBER(Thread, stack_end_));
   }
@@ -548,10 +624,67 @@ class PACKED(4) Thread {
 
   ShadowFrame* GetAndClearDeoptimizationShadowFrame(JValue* ret_val);
 
+  // Does the thread run every method it calls in the interpreter, deoptimizing its compiled frames
+  // as they are returned to? Set by the debugger for the thread being single-stepped.
+  bool IsInterpreterForced() const {
+    return interpreter_forced_;
+  }
+
+  void SetInterpreterForced(bool forced) {
+    interpreter_forced_ = forced;
+  }
+
   std::deque<instrumentation::InstrumentationStackFrame>* GetInstrumentationStack() {
     return instrumentation_stack_;
   }
 
+  // Sets or clears the method entry and exit hooks that code compiled with method hooks calls.
+  void SetMethodHooksEnabled(bool enabled);
+
+  bool AreMethodHooksEnabled() const {
+    return quick_entrypoints_.pMethodEntryHook != NULL;
+  }
+
+  // The frame layouts of the methods met by the stack walks this thread does.
+  QuickFrameInfoCache* GetQuickFrameInfoCache() {
+    if (UNLIKELY(quick_frame_info_cache_ == NULL)) {
+      quick_frame_info_cache_ = new QuickFrameInfoCache();
+    }
+    return quick_frame_info_cache_;
+  }
+
+  // The catch handlers found by the exception deliveries of this thread.
+  CatchHandlerCache* GetCatchHandlerCache() {
+    if (UNLIKELY(catch_handler_cache_ == NULL)) {
+      catch_handler_cache_ = new CatchHandlerCache();
+    }
+    return catch_handler_cache_;
+  }
+
+  // The plans of the proxy methods this thread calls.
+  ProxyInvokeCache* GetProxyInvokeCache() {
+    if (UNLIKELY(proxy_invoke_cache_ == NULL)) {
+      proxy_invoke_cache_ = new ProxyInvokeCache();
+    }
+    return proxy_invoke_cache_;
+  }
+
+  // The plans of the methods this thread invokes through reflection.
+  ReflectiveInvokeCache* GetReflectiveInvokeCache() {
+    if (UNLIKELY(reflective_invoke_cache_ == NULL)) {
+      reflective_invoke_cache_ = new ReflectiveInvokeCache();
+    }
+    return reflective_invoke_cache_;
+  }
+
+  // The fields this thread reads and writes through reflection.
+  ReflectiveFieldCache* GetReflectiveFieldCache() {
+    if (UNLIKELY(reflective_field_cache_ == NULL)) {
+      reflective_field_cache_ = new ReflectiveFieldCache();
+    }
+    return reflective_field_cache_;
+  }
+
   std::vector<mirror::ArtMethod*>* GetStackTraceSample() const {
     return stack_trace_sample_;
   }
@@ -568,6 +701,20 @@ class PACKED(4) Thread {
     trace_clock_base_ = clock_base;
   }
 
+  // The method trace records of this thread not yet copied to the trace, see Trace.
+  uint8_t* GetTraceBuffer() const {
+    return trace_buffer_;
+  }
+
+  size_t GetTraceBufferOffset() const {
+    return trace_buffer_offset_;
+  }
+
+  void SetTraceBuffer(uint8_t* buffer, size_t offset) {
+    trace_buffer_ = buffer;
+    trace_buffer_offset_ = offset;
+  }
+
   BaseMutex* GetHeldMutex(LockLevel level) const {
     return held_mutexes_[level];
   }
@@ -590,6 +737,100 @@ class PACKED(4) Thread {
 
   void AtomicClearFlag(ThreadFlag flag);
 
+  // Thread-local allocation buffer, owned and carved up by gc::space::DlMallocSpace.
+  bool HasThreadLocalAllocationBuffer() const {
+    return thread_local_start_ != NULL;
+  }
+
+  byte* GetThreadLocalStart() const {
+    return thread_local_start_;
+  }
+
+  byte* GetThreadLocalPos() const {
+    return thread_local_pos_;
+  }
+
+  byte* GetThreadLocalEnd() const {
+    return thread_local_end_;
+  }
+
+  size_t GetThreadLocalObjectsAllocated() const {
+    return thread_local_objects_;
+  }
+
+  void SetThreadLocalAllocationBuffer(byte* start, byte* pos, byte* end) {
+    thread_local_start_ = start;
+    thread_local_pos_ = pos;
+    thread_local_end_ = end;
+    thread_local_objects_ = 0;
+  }
+
+  void BumpThreadLocalPos(size_t bytes) {
+    thread_local_pos_ += bytes;
+    ++thread_local_objects_;
+  }
+
+  // Segment of the heap's allocation stack reserved for this thread's buffer allocations.
+  mirror::Object** GetThreadLocalAllocationStackTop() const {
+    return thread_local_alloc_stack_top_;
+  }
+
+  mirror::Object** GetThreadLocalAllocationStackEnd() const {
+    return thread_local_alloc_stack_end_;
+  }
+
+  void SetThreadLocalAllocationStack(mirror::Object** start, mirror::Object** end) {
+    thread_local_alloc_stack_top_ = start;
+    thread_local_alloc_stack_end_ = end;
+  }
+
+  // Returns false if the segment is exhausted.
+  bool PushOnThreadLocalAllocationStack(mirror::Object* obj) {
+    if (UNLIKELY(thread_local_alloc_stack_top_ >= thread_local_alloc_stack_end_)) {
+      return false;
+    }
+    *thread_local_alloc_stack_top_++ = obj;
+    return true;
+  }
+
+  // Bytes left before AllocProfiler samples an allocation of this thread.
+  size_t GetAllocProfilerBytesUntilSample() const {
+    return alloc_profiler_bytes_until_sample_;
+  }
+
+  void SetAllocProfilerBytesUntilSample(size_t bytes) {
+    alloc_profiler_bytes_until_sample_ = bytes;
+  }
+
+  // Returns the method that klass implements interface_method with, or NULL if klass doesn't
+  // implement the interface. Recent lookups are cached so that an interface call site that keeps
+  // seeing the same receiver class doesn't search the class's iftable each time.
+  mirror::ArtMethod* FindVirtualMethodForInterface(mirror::Class* klass,
+                                                   mirror::ArtMethod* interface_method)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Returns memory for the shadow frame of an interpreted callee from this thread's interpreter
+  // stack, or NULL when it is full and the frame has to go on the native stack. Frames must be
+  // popped in the reverse order.
+  void* PushInterpreterFrame(size_t size) {
+    size = (size + kInterpreterFrameAlignment - 1) & ~(kInterpreterFrameAlignment - 1);
+    if (UNLIKELY(static_cast<size_t>(interpreter_stack_end_ - interpreter_stack_top_) < size)) {
+      return PushInterpreterFrameSlowPath(size);
+    }
+    void* frame = interpreter_stack_top_;
+    interpreter_stack_top_ += size;
+    return frame;
+  }
+
+  // Frees the frame and all the frames pushed after it. Does nothing for frames that aren't on
+  // the interpreter stack.
+  void PopInterpreterFrame(void* frame) {
+    byte* frame_begin = reinterpret_cast<byte*>(frame);
+    if (frame_begin >= interpreter_stack_begin_ && frame_begin < interpreter_stack_end_) {
+      interpreter_stack_top_ = frame_begin;
+    }
+  }
+
  private:
   // We have no control over the size of 'bool', but want our boolean fields
   // to be 4-byte quantities.
@@ -606,11 +847,10 @@ class PACKED(4) Thread {
 
   // Avoid use, callers should use SetState. Used only by SignalCatcher::HandleSigQuit, ~Thread and
   // Dbg::Disconnected.
-  ThreadState SetStateUnsafe(ThreadState new_state) {
-    ThreadState old_state = GetState();
-    state_and_flags_.as_struct.state = new_state;
-    return old_state;
-  }
+  ThreadState SetStateUnsafe(ThreadState new_state);
+
+  // Notify suspended_cond_ after leaving the runnable state with a suspend request pending.
+  void SignalSuspended() LOCKS_EXCLUDED(Locks::thread_suspend_count_lock_);
   friend class SignalCatcher;  // For SetStateUnsafe.
   friend class Dbg;  // F or SetStateUnsafe.
 
@@ -639,6 +879,8 @@ class PACKED(4) Thread {
   void InitTid();
   void InitPthreadKeySelf();
   void InitStackHwm();
+  void ProtectStackGuard();
+  void UnprotectStackGuard();
 
   void SetUpAlternateSignalStack();
   void TearDownAlternateSignalStack();
@@ -647,6 +889,9 @@ class PACKED(4) Thread {
 
   static void ThreadExitCallback(void* arg);
 
+  // Maps the interpreter stack on first use.
+  void* PushInterpreterFrameSlowPath(size_t size);
+
   // Has Thread::Startup been called?
   static bool is_started_;
 
@@ -657,6 +902,10 @@ class PACKED(4) Thread {
   // their suspend count is > 0.
   static ConditionVariable* resume_cond_ GUARDED_BY(Locks::thread_suspend_count_lock_);
 
+  // Used to notify a SuspendAll that threads which were runnable when asked to suspend have left
+  // the runnable state.
+  static ConditionVariable* suspended_cond_ GUARDED_BY(Locks::thread_suspend_count_lock_);
+
   // --- Frequently accessed fields first for short offsets ---
 
   // 32 bits of atomically changed state and flags. Keeping as 32 bits allows and atomic CAS to
@@ -739,8 +988,10 @@ class PACKED(4) Thread {
   Monitor* wait_monitor_ GUARDED_BY(wait_mutex_);
   // Thread "interrupted" status; stays raised until queried or thrown.
   bool32_t interrupted_ GUARDED_BY(wait_mutex_);
-  // The next thread in the wait set this thread is part of.
+  // The next and previous threads in the wait set this thread is part of. Once notified, the
+  // thread is kept on the monitor's notified list through wait_next_ until it is woken.
   Thread* wait_next_;
+  Thread* wait_prev_;
   // If we're blocked in MonitorEnter, this is the object we're trying to lock.
   mirror::Object* monitor_enter_object_;
 
@@ -754,10 +1005,16 @@ class PACKED(4) Thread {
 
   RuntimeStats stats_;
 
+  // Hardware performance counters of this thread, opened on first use.
+  PerfCounters perf_counters_;
+
   // Needed to get the right ClassLoader in JNI_OnLoad, but also
   // useful for testing.
   mirror::ClassLoader* class_loader_override_;
 
+  // Set while a class is initialized at compile time, see Transaction.
+  Transaction* transaction_;
+
   // Thread local, lazily allocated, long jump context. Used to deliver exceptions.
   Context* long_jump_context_;
 
@@ -775,6 +1032,9 @@ class PACKED(4) Thread {
   ShadowFrame* deoptimization_shadow_frame_;
   JValue deoptimization_return_value_;
 
+  // Whether the thread runs its methods in the interpreter regardless of their code.
+  bool interpreter_forced_;
+
   // Additional stack used by method instrumentation to store method and return pc values.
   // Stored as a pointer since std::deque is not PACKED.
   std::deque<instrumentation::InstrumentationStackFrame>* instrumentation_stack_;
@@ -800,6 +1060,40 @@ class PACKED(4) Thread {
   // Pending checkpoint functions.
   Closure* checkpoint_function_;
 
+  // Compiled code with implicit suspend checks loads through this pointer at its suspend points.
+  // It points to itself, and is cleared to make the load fault when a suspend or checkpoint is
+  // requested. The fault handler then diverts the thread to the suspend check.
+  uintptr_t* suspend_trigger_;
+
+  // The kStackOverflowProtectedSize bytes below stack_begin_ when they are protected, and whether
+  // they are a mapping of their own rather than pages of the stack.
+  byte* stack_guard_;
+  bool stack_guard_is_mapping_;
+
+  // Thread-local allocation buffer: the dlmalloc chunk backing the buffer, the next free byte and
+  // the end of the buffer, along with the number of objects bump allocated from it.
+  byte* thread_local_start_;
+  byte* thread_local_pos_;
+  byte* thread_local_end_;
+  size_t thread_local_objects_;
+
+  // Next free slot and end of this thread's segment of the allocation stack, objects bump
+  // allocated from the buffer above are recorded here rather than with an atomic push.
+  mirror::Object** thread_local_alloc_stack_top_;
+  mirror::Object** thread_local_alloc_stack_end_;
+
+  // Countdown to the next allocation sample, zero until the thread draws its first interval.
+  size_t alloc_profiler_bytes_until_sample_;
+
+  // Shadow frames of interpreter to interpreter calls are bump allocated from this region rather
+  // than with alloca, so deep interpreted call chains don't use up the native stack.
+  static const size_t kInterpreterStackSize = 256 * KB;
+  static const size_t kInterpreterFrameAlignment = 8;
+  MemMap* interpreter_stack_;
+  byte* interpreter_stack_begin_;
+  byte* interpreter_stack_top_;
+  byte* interpreter_stack_end_;
+
  public:
   // Entrypoint function pointers
   // TODO: move this near the top, since changing its offset requires all oats to be recompiled!
@@ -812,6 +1106,35 @@ class PACKED(4) Thread {
   // How many times has our pthread key's destructor been called?
   uint32_t thread_exit_check_count_;
 
+  // Interface dispatch results of this thread, indexed by a hash of the receiver class and the
+  // interface method. Only read and written by the thread itself, classes are never unloaded.
+  struct InterfaceCacheEntry {
+    mirror::Class* klass;
+    mirror::ArtMethod* interface_method;
+    mirror::ArtMethod* method;
+  };
+  static const size_t kInterfaceCacheSize = 64;
+  InterfaceCacheEntry interface_cache_[kInterfaceCacheSize];
+
+  // Allocated on the first stack walk this thread does.
+  QuickFrameInfoCache* quick_frame_info_cache_;
+
+  // Allocated on the first exception delivered through compiled code by this thread.
+  CatchHandlerCache* catch_handler_cache_;
+
+  // Allocated on the first call of a proxy method by this thread.
+  ProxyInvokeCache* proxy_invoke_cache_;
+
+  // Allocated on the first Method.invoke or Constructor.newInstance of this thread.
+  ReflectiveInvokeCache* reflective_invoke_cache_;
+
+  // Allocated on the first Field.get or Field.set of this thread.
+  ReflectiveFieldCache* reflective_field_cache_;
+
+  // Allocated by the first method trace event of this thread, freed when tracing stops.
+  uint8_t* trace_buffer_;
+  size_t trace_buffer_offset_;
+
   friend class ScopedThreadStateChange;
 
   DISALLOW_COPY_AND_ASSIGN(Thread);
@@ -16,15 +16,18 @@
 
 #include "thread.h"
 
+#include <sys/mman.h>
 #include <sys/time.h>
 #include <sys/resource.h>
 #include <limits.h>
 #include <errno.h>
+#include <pthread.h>
 
 #include <cutils/sched_policy.h>
 #include <utils/threads.h>
 
 #include "base/macros.h"
+#include "utils.h"
 
 namespace art {
 
@@ -87,6 +90,54 @@ int Thread::GetNativePriority() {
   return managed_priority;
 }
 
+void Thread::ProtectStackGuard() {
+#if defined(__arm__)
+  // The stack reported by pthreads includes its guard page, which is already inaccessible.
+  pthread_attr_t attributes;
+  size_t pthread_guard_size;
+  CHECK_PTHREAD_CALL(pthread_getattr_np, (pthread_self_, &attributes), __FUNCTION__);
+  CHECK_PTHREAD_CALL(pthread_attr_getguardsize, (&attributes, &pthread_guard_size), __FUNCTION__);
+  CHECK_PTHREAD_CALL(pthread_attr_destroy, (&attributes), __FUNCTION__);
+  if (stack_size_ <= pthread_guard_size + kStackOverflowProtectedSize + kStackOverflowReservedBytes) {
+    LOG(WARNING) << "Stack of " << PrettySize(stack_size_) << " too small for a guard";
+    return;
+  }
+  byte* guard = stack_begin_ + pthread_guard_size;
+  if (mprotect(guard, kStackOverflowProtectedSize, PROT_NONE) == 0) {
+    stack_guard_is_mapping_ = false;
+  } else {
+    // The main thread's stack is only mapped as it grows. Reserve the pages instead, the stack
+    // stops growing when it reaches them.
+    void* mapping = mmap(guard, kStackOverflowProtectedSize, PROT_NONE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mapping != guard) {
+      PLOG(WARNING) << "Failed to protect the stack guard at " << reinterpret_cast<void*>(guard);
+      if (mapping != MAP_FAILED) {
+        munmap(mapping, kStackOverflowProtectedSize);
+      }
+      return;
+    }
+    stack_guard_is_mapping_ = true;
+  }
+  stack_guard_ = guard;
+  stack_size_ -= guard + kStackOverflowProtectedSize - stack_begin_;
+  stack_begin_ = guard + kStackOverflowProtectedSize;
+  ResetDefaultStackEnd();
+#endif
+}
+
+void Thread::UnprotectStackGuard() {
+  if (stack_guard_ == NULL) {
+    return;
+  }
+  if (stack_guard_is_mapping_) {
+    munmap(stack_guard_, kStackOverflowProtectedSize);
+  } else {
+    mprotect(stack_guard_, kStackOverflowProtectedSize, PROT_READ | PROT_WRITE);
+  }
+  stack_guard_ = NULL;
+}
+
 void Thread::SetUpAlternateSignalStack() {
   // Bionic does this for us.
 }
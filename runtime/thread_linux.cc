@@ -32,6 +32,13 @@ static void SigAltStack(stack_t* new_stack, stack_t* old_stack) {
   }
 }
 
+void Thread::ProtectStackGuard() {
+  // Only ARM code has implicit stack overflow checks.
+}
+
+void Thread::UnprotectStackGuard() {
+}
+
 void Thread::SetUpAlternateSignalStack() {
   // Create and set an alternate signal stack.
   stack_t ss;
@@ -20,9 +20,15 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <sstream>
+
+#include "barrier.h"
 #include "base/mutex.h"
 #include "base/timing_logger.h"
 #include "debugger.h"
+#include "instrumentation.h"
+#include "runtime.h"
+#include "scoped_thread_state_change.h"
 #include "thread.h"
 #include "utils.h"
 
@@ -65,11 +71,46 @@ pid_t ThreadList::GetLockOwner() {
   return Locks::thread_list_lock_->GetExclusiveOwnerTid();
 }
 
+// Has each thread dump its own stack, so that a dump doesn't stop every thread until the last one
+// is written out.
+class DumpCheckpoint : public Closure {
+ public:
+  explicit DumpCheckpoint(std::ostream* os) : os_(os), barrier_(0) {}
+
+  virtual void Run(Thread* thread) NO_THREAD_SAFETY_ANALYSIS {
+    // Note: self is not necessarily equal to thread since thread may be suspended.
+    Thread* self = Thread::Current();
+    std::ostringstream local_os;
+    {
+      ScopedObjectAccess soa(self);
+      thread->Dump(local_os);
+    }
+    local_os << "\n";
+    {
+      // Threads finish in any order, only keep their dumps from interleaving.
+      MutexLock mu(self, *Locks::logging_lock_);
+      *os_ << local_os.str();
+    }
+    barrier_.Pass(self);
+  }
+
+  void WaitForThreadsToRunThroughCheckpoint(size_t threads_running_checkpoint) {
+    barrier_.Increment(Thread::Current(), threads_running_checkpoint);
+  }
+
+ private:
+  std::ostream* const os_;
+  Barrier barrier_;
+};
+
 void ThreadList::DumpForSigQuit(std::ostream& os) {
   {
     MutexLock mu(Thread::Current(), *Locks::thread_list_lock_);
-    DumpLocked(os);
+    os << "DALVIK THREADS (" << list_.size() << "):\n";
   }
+  DumpCheckpoint checkpoint(&os);
+  size_t threads_running_checkpoint = RunCheckpoint(&checkpoint);
+  checkpoint.WaitForThreadsToRunThroughCheckpoint(threads_running_checkpoint);
   DumpUnattachedThreads(os);
 }
 
@@ -131,7 +172,6 @@ void ThreadList::AssertThreadsAreSuspended(Thread* self, Thread* ignore1, Thread
   }
 }
 
-#if HAVE_TIMED_RWLOCK
 // Attempt to rectify locks so that we dump thread list with required locks before exiting.
 static void UnsafeLogFatalForThreadSuspendAllTimeout(Thread* self) NO_THREAD_SAFETY_ANALYSIS {
   Runtime* runtime = Runtime::Current();
@@ -142,7 +182,39 @@ static void UnsafeLogFatalForThreadSuspendAllTimeout(Thread* self) NO_THREAD_SAF
   runtime->GetThreadList()->DumpLocked(ss);
   LOG(FATAL) << ss.str();
 }
-#endif
+
+void ThreadList::WaitForRunnableThreadsToSuspend(Thread* self, std::vector<Thread*>* threads) {
+  // The threads have a suspend request pending, so they can neither become Runnable again nor
+  // unregister and the pointers stay valid.
+  const uint64_t kTimeoutMs = 30 * 1000;
+  uint64_t start = NanoTime();
+  bool timed_out = false;
+  {
+    MutexLock mu(self, *Locks::thread_suspend_count_lock_);
+    while (true) {
+      for (size_t i = 0; i < threads->size();) {
+        if ((*threads)[i]->GetState() != kRunnable) {
+          (*threads)[i] = threads->back();
+          threads->pop_back();
+        } else {
+          ++i;
+        }
+      }
+      if (threads->empty()) {
+        break;
+      }
+      uint64_t waited_ms = NsToMs(NanoTime() - start);
+      if (UNLIKELY(waited_ms >= kTimeoutMs)) {
+        timed_out = true;
+        break;
+      }
+      Thread::suspended_cond_->TimedWait(self, kTimeoutMs - waited_ms, 0);
+    }
+  }
+  if (UNLIKELY(timed_out)) {
+    UnsafeLogFatalForThreadSuspendAllTimeout(self);
+  }
+}
 
 size_t ThreadList::RunCheckpoint(Closure* checkpoint_function) {
   Thread* self = Thread::Current();
@@ -232,6 +304,7 @@ void ThreadList::SuspendAll() {
     Locks::thread_suspend_count_lock_->AssertNotHeld(self);
     CHECK_NE(self->GetState(), kRunnable);
   }
+  std::vector<Thread*> runnable_threads;
   {
     MutexLock mu(self, *Locks::thread_list_lock_);
     {
@@ -245,11 +318,18 @@ void ThreadList::SuspendAll() {
         }
         VLOG(threads) << "requesting thread suspend: " << *thread;
         thread->ModifySuspendCount(self, +1, false);
+        // With the request pending the thread can't become Runnable, wait for it if it is.
+        if (thread->GetState() == kRunnable) {
+          runnable_threads.push_back(thread);
+        }
       }
     }
   }
 
-  // Block on the mutator lock until all Runnable threads release their share of access.
+  // Runnable threads share the mutator lock implicitly, wait for them to leave the Runnable state.
+  WaitForRunnableThreadsToSuspend(self, &runnable_threads);
+
+  // Block on the mutator lock until all explicit shared holders release their share of access.
 #if HAVE_TIMED_RWLOCK
   // Timeout if we wait more than 30 seconds.
   if (UNLIKELY(!Locks::mutator_lock_->ExclusiveLockWithTimeout(self, 30 * 1000, 0))) {
@@ -327,6 +407,7 @@ void ThreadList::SuspendAllForDebugger() {
 
   VLOG(threads) << *self << " SuspendAllForDebugger starting...";
 
+  std::vector<Thread*> runnable_threads;
   {
     MutexLock mu(self, *Locks::thread_list_lock_);
     {
@@ -341,12 +422,17 @@ void ThreadList::SuspendAllForDebugger() {
         }
         VLOG(threads) << "requesting thread suspend: " << *thread;
         thread->ModifySuspendCount(self, +1, true);
+        if (thread->GetState() == kRunnable) {
+          runnable_threads.push_back(thread);
+        }
       }
     }
   }
 
-  // Block on the mutator lock until all Runnable threads release their share of access then
-  // immediately unlock again.
+  WaitForRunnableThreadsToSuspend(self, &runnable_threads);
+
+  // Block on the mutator lock until all explicit shared holders release their share of access
+  // then immediately unlock again.
 #if HAVE_TIMED_RWLOCK
   // Timeout if we wait more than 30 seconds.
   if (!Locks::mutator_lock_->ExclusiveLockWithTimeout(self, 30 * 1000, 0)) {
@@ -514,6 +600,10 @@ void ThreadList::Register(Thread* self) {
   if (self->suspend_count_ > 0) {
     self->AtomicSetFlag(kSuspendRequest);
   }
+  // Method tracing enables the method hooks of the registered threads with the list lock held.
+  if (Runtime::Current()->GetInstrumentation()->AreMethodHooksEnabled()) {
+    self->SetMethodHooksEnabled(true);
+  }
   CHECK(!Contains(self));
   list_.push_back(self);
 }
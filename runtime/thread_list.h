@@ -22,6 +22,7 @@
 
 #include <bitset>
 #include <list>
+#include <vector>
 
 namespace art {
 class Closure;
@@ -37,9 +38,9 @@ class ThreadList {
   explicit ThreadList();
   ~ThreadList();
 
+  // Dumps the threads at a checkpoint, so the caller must not be runnable.
   void DumpForSigQuit(std::ostream& os)
-      LOCKS_EXCLUDED(Locks::thread_list_lock_)
-      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+      LOCKS_EXCLUDED(Locks::thread_list_lock_, Locks::mutator_lock_);
   void DumpLocked(std::ostream& os)  // For thread suspend timeout dumps.
       EXCLUSIVE_LOCKS_REQUIRED(Locks::thread_list_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -122,6 +123,12 @@ class ThreadList {
       LOCKS_EXCLUDED(Locks::thread_list_lock_,
                      Locks::thread_suspend_count_lock_);
 
+  // Wait for the threads, Runnable when their suspend count was raised, to leave the Runnable
+  // state and with it their implicit share of the mutator lock.
+  void WaitForRunnableThreadsToSuspend(Thread* self, std::vector<Thread*>* threads)
+      LOCKS_EXCLUDED(Locks::thread_list_lock_,
+                     Locks::thread_suspend_count_lock_);
+
   mutable Mutex allocated_ids_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   std::bitset<kMaxThreadId> allocated_ids_ GUARDED_BY(allocated_ids_lock_);
 
@@ -16,6 +16,8 @@
 
 #include "thread_pool.h"
 
+#include <sched.h>
+
 #include "base/casts.h"
 #include "base/stl_util.h"
 #include "runtime.h"
@@ -62,9 +64,13 @@ void* ThreadPoolWorker::Callback(void* arg) {
   return NULL;
 }
 
-void ThreadPool::AddTask(Thread* self, Task* task) {
+void ThreadPool::AddTask(Thread* self, Task* task, TaskPriority priority) {
   MutexLock mu(self, task_queue_lock_);
-  tasks_.push_back(task);
+  if (priority == kTaskPriorityHigh) {
+    tasks_.push_front(task);
+  } else {
+    tasks_.push_back(task);
+  }
   // If we have any waiters, signal one.
   if (started_ && waiting_count_ != 0) {
     task_queue_condition_.Signal(self);
@@ -203,6 +209,7 @@ void WorkStealingWorker::Run() {
   Thread* self = Thread::Current();
   Task* task = NULL;
   WorkStealingThreadPool* thread_pool = down_cast<WorkStealingThreadPool*>(thread_pool_);
+  thread_pool_->creation_barier_.Wait(self);
   while ((task = thread_pool_->GetTask(self)) != NULL) {
     WorkStealingTask* stealing_task = down_cast<WorkStealingTask*>(task);
 
@@ -270,26 +277,41 @@ void WorkStealingWorker::Run() {
 
 WorkStealingWorker::~WorkStealingWorker() {}
 
+void UnsplittableTask::StealFrom(Thread* /* self */, WorkStealingTask* /* source */) {
+  sched_yield();
+}
+
 WorkStealingThreadPool::WorkStealingThreadPool(size_t num_threads)
     : ThreadPool(0),
       work_steal_lock_("work stealing lock"),
-      steal_index_(0) {
+      steal_seed_(static_cast<uint32_t>(NanoTime()) | 1) {
+  Thread* self = Thread::Current();
+  // The base constructor didn't create any workers, add one since we wait on the barrier too.
+  creation_barier_.Init(self, num_threads + 1);
   while (GetThreadCount() < num_threads) {
     const std::string name = StringPrintf("Work stealing worker %zu", GetThreadCount());
     threads_.push_back(new WorkStealingWorker(this, name, ThreadPoolWorker::kDefaultStackSize));
   }
+  SetMaxActiveWorkers(num_threads);
+  // Wait for all of the threads to attach.
+  creation_barier_.Wait(self);
 }
 
 WorkStealingTask* WorkStealingThreadPool::FindTaskToStealFrom(Thread* self) {
   const size_t thread_count = GetThreadCount();
+  // Xorshift, the quality of the numbers doesn't matter.
+  steal_seed_ ^= steal_seed_ << 13;
+  steal_seed_ ^= steal_seed_ >> 17;
+  steal_seed_ ^= steal_seed_ << 5;
+  const size_t first = steal_seed_ % thread_count;
   for (size_t i = 0; i < thread_count; ++i) {
     // TODO: Use CAS instead of lock.
-    ++steal_index_;
-    if (steal_index_ >= thread_count) {
-      steal_index_-= thread_count;
+    size_t steal_index = first + i;
+    if (steal_index >= thread_count) {
+      steal_index -= thread_count;
     }
 
-    WorkStealingWorker* worker = down_cast<WorkStealingWorker*>(threads_[steal_index_]);
+    WorkStealingWorker* worker = down_cast<WorkStealingWorker*>(threads_[steal_index]);
     WorkStealingTask* task = worker->task_;
     if (task) {
       // Not null, we can probably steal from this worker.
@@ -17,9 +17,11 @@
 #ifndef ART_RUNTIME_THREAD_POOL_H_
 #define ART_RUNTIME_THREAD_POOL_H_
 
+#include <algorithm>
 #include <deque>
 #include <vector>
 
+#include "atomic_integer.h"
 #include "barrier.h"
 #include "base/mutex.h"
 #include "closure.h"
@@ -29,6 +31,13 @@ namespace art {
 
 class ThreadPool;
 
+enum TaskPriority {
+  kTaskPriorityNormal,
+  // Run before the normal priority tasks already queued, for example work split off a running task
+  // whose data is still in the cache.
+  kTaskPriorityHigh,
+};
+
 class Task : public Closure {
  public:
   // Called when references reaches 0.
@@ -75,7 +84,7 @@ class ThreadPool {
 
   // Add a new task, the first available started worker will process it. Does not delete the task
   // after running it, it is the caller's responsibility.
-  void AddTask(Thread* self, Task* task);
+  void AddTask(Thread* self, Task* task, TaskPriority priority = kTaskPriorityNormal);
 
   explicit ThreadPool(size_t num_threads);
   virtual ~ThreadPool();
@@ -129,6 +138,45 @@ class ThreadPool {
   DISALLOW_COPY_AND_ASSIGN(ThreadPool);
 };
 
+// Hands out the indices of a range to the threads of a parallel for loop in chunks, so that the
+// threads don't contend on the counter for every index. Chunks shrink as the range runs out, up to
+// max_chunk_size indices and down to one, so that the threads still finish at about the same time.
+// A max_chunk_size of one hands out the indices in order, one at a time.
+class ParallelForRange {
+ public:
+  ParallelForRange(size_t begin, size_t end, size_t num_threads, size_t max_chunk_size)
+      : index_(begin), end_(end), divisor_(4 * std::max<size_t>(num_threads, 1)),
+        max_chunk_size_(max_chunk_size) {
+    DCHECK_GE(max_chunk_size, 1U);
+  }
+
+  // Claims the next chunk, returning false once the range is exhausted.
+  bool Next(size_t* chunk_begin, size_t* chunk_end) {
+    size_t chunk_size = 1;
+    if (max_chunk_size_ > 1) {
+      // A stale index only makes the chunk larger or smaller, the claim below is atomic.
+      const size_t current = static_cast<size_t>(index_.load());
+      const size_t remaining = current < end_ ? end_ - current : 0;
+      chunk_size = std::min(std::max<size_t>(remaining / divisor_, 1), max_chunk_size_);
+    }
+    const size_t begin = static_cast<size_t>(index_.fetch_add(chunk_size));
+    if (begin >= end_) {
+      return false;
+    }
+    *chunk_begin = begin;
+    *chunk_end = std::min(begin + chunk_size, end_);
+    return true;
+  }
+
+ private:
+  AtomicInteger index_;
+  const size_t end_;
+  const size_t divisor_;
+  const size_t max_chunk_size_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelForRange);
+};
+
 class WorkStealingTask : public Task {
  public:
   WorkStealingTask() : ref_count_(0) {}
@@ -146,6 +194,13 @@ class WorkStealingTask : public Task {
   friend class WorkStealingWorker;
 };
 
+// A work stealing task whose work is too small to be worth splitting. Workers which try to steal
+// from it just yield until it finishes.
+class UnsplittableTask : public WorkStealingTask {
+ public:
+  virtual void StealFrom(Thread* self, WorkStealingTask* source);
+};
+
 class WorkStealingWorker : public ThreadPoolWorker {
  public:
   virtual ~WorkStealingWorker();
@@ -172,8 +227,9 @@ class WorkStealingThreadPool : public ThreadPool {
 
  private:
   Mutex work_steal_lock_;
-  // Which thread we are stealing from (round robin).
-  size_t steal_index_;
+  // Random state picking the first worker to try stealing from, so that idle workers spread out
+  // over the busy ones rather than all stealing from the same one.
+  uint32_t steal_seed_ GUARDED_BY(work_steal_lock_);
 
   // Find a task to steal from
   WorkStealingTask* FindTaskToStealFrom(Thread* self) EXCLUSIVE_LOCKS_REQUIRED(work_steal_lock_);
@@ -19,6 +19,7 @@
 
 #include "atomic_integer.h"
 #include "common_test.h"
+#include "gc/accounting/work_stealing_deque.h"
 #include "thread_pool.h"
 
 namespace art {
@@ -138,4 +139,84 @@ TEST_F(ThreadPoolTest, RecursiveTest) {
   EXPECT_EQ((1 << depth) - 1, count);
 }
 
+class StealableCountTask : public WorkStealingTask {
+ public:
+  static const size_t kMaxWork = 64;
+
+  StealableCountTask(AtomicInteger* count, size_t work) : count_(count) {
+    for (size_t i = 0; i < work; ++i) {
+      work_.PushBottom(i);
+    }
+  }
+
+  void Run(Thread* self) {
+    size_t unit;
+    while (work_.PopBottom(&unit)) {
+      // Simulate doing some work.
+      usleep(100);
+      ++*count_;
+    }
+  }
+
+  void StealFrom(Thread* self, WorkStealingTask* source) {
+    StealableCountTask* source_task = down_cast<StealableCountTask*>(source);
+    size_t unit;
+    size_t steal_count = source_task->work_.Size() / 2 + 1;
+    while (steal_count-- != 0 && source_task->work_.StealTop(&unit)) {
+      work_.PushBottom(unit);
+    }
+    Run(self);
+  }
+
+  void Finalize() {
+    delete this;
+  }
+
+ private:
+  AtomicInteger* const count_;
+  gc::accounting::WorkStealingDeque<size_t, kMaxWork> work_;
+};
+
+// Check that work is neither lost nor done twice when idle workers steal from busy ones.
+TEST_F(ThreadPoolTest, WorkStealing) {
+  Thread* self = Thread::Current();
+  WorkStealingThreadPool thread_pool(num_threads);
+  AtomicInteger count(0);
+  // Fewer tasks than threads so that some of the workers have to steal.
+  static const int32_t num_tasks = num_threads / 2;
+  for (int32_t i = 0; i < num_tasks; ++i) {
+    thread_pool.AddTask(self, new StealableCountTask(&count, StealableCountTask::kMaxWork));
+  }
+  thread_pool.StartWorkers(self);
+  thread_pool.Wait(self, false, false);
+  EXPECT_EQ(num_tasks * static_cast<int32_t>(StealableCountTask::kMaxWork), count);
+}
+
+// Check that the chunks of a parallel for range cover it exactly, in order, and shrink at the end.
+TEST_F(ThreadPoolTest, ParallelForRange) {
+  ParallelForRange range(10, 1000, num_threads, 32);
+  size_t expected_begin = 10;
+  size_t last_size = 32;
+  size_t chunk_begin;
+  size_t chunk_end;
+  while (range.Next(&chunk_begin, &chunk_end)) {
+    EXPECT_EQ(expected_begin, chunk_begin);
+    ASSERT_LT(chunk_begin, chunk_end);
+    EXPECT_LE(chunk_end - chunk_begin, last_size);
+    last_size = chunk_end - chunk_begin;
+    expected_begin = chunk_end;
+  }
+  EXPECT_EQ(1000U, expected_begin);
+  EXPECT_EQ(1U, last_size);
+  EXPECT_FALSE(range.Next(&chunk_begin, &chunk_end));
+
+  ParallelForRange in_order(0, 5, num_threads, 1);
+  for (size_t i = 0; i < 5; ++i) {
+    ASSERT_TRUE(in_order.Next(&chunk_begin, &chunk_end));
+    EXPECT_EQ(i, chunk_begin);
+    EXPECT_EQ(i + 1, chunk_end);
+  }
+  EXPECT_FALSE(in_order.Next(&chunk_begin, &chunk_end));
+}
+
 }  // namespace art
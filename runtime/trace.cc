@@ -18,9 +18,13 @@
 
 #include <sys/uio.h>
 
+#include <algorithm>
+
+#include "barrier.h"
 #include "base/stl_util.h"
 #include "base/unix_file/fd_file.h"
 #include "class_linker.h"
+#include "closure.h"
 #include "common_throws.h"
 #include "debugger.h"
 #include "dex_file-inl.h"
@@ -75,6 +79,22 @@ namespace art {
 // 32 bits of microseconds is 70 minutes.
 //
 // All values are stored in little-endian order.
+//
+// Threads buffer their records and append them in chunks, so the records of a thread are in order
+// but those of different threads are interleaved by chunk rather than by time.
+//
+// Streaming format (kTraceStreaming):
+//     header
+//     record 0
+//     ...
+//     record N
+//     u2  0, in place of a thread ID
+//     u1  kTraceStreamingOpSummary
+//     u4  summary length
+//     ... summary, the text otherwise written before the header ("*version" to "*end")
+//
+// The summary is only known when tracing stops, so it follows the records instead of preceding
+// them. A streamed trace therefore starts with the binary magic rather than with "*version".
 
 enum TraceAction {
     kTraceMethodEnter = 0x00,       // method entry
@@ -87,7 +107,7 @@ enum TraceAction {
 class BuildStackTraceVisitor : public StackVisitor {
  public:
   explicit BuildStackTraceVisitor(Thread* thread) : StackVisitor(thread, NULL),
-      method_trace_(Trace::AllocStackTrace()) {}
+      method_trace_(new std::vector<mirror::ArtMethod*>()) {}
 
   bool VisitFrame() {
     mirror::ArtMethod* m = GetMethod();
@@ -114,6 +134,8 @@ static const uint16_t kTraceVersionSingleClock    = 2;
 static const uint16_t kTraceVersionDualClock      = 3;
 static const uint16_t kTraceRecordSizeSingleClock = 10;  // using v2
 static const uint16_t kTraceRecordSizeDualClock   = 14;  // using v3 with two timestamps
+static const size_t   kTraceThreadBufferSize      = 4 * KB;
+static const uint8_t  kTraceStreamingOpSummary    = 3;
 
 #if defined(HAVE_POSIX_CLOCKS)
 ProfilerClockSource Trace::default_clock_source_ = kProfilerClockSourceDual;
@@ -123,7 +145,6 @@ ProfilerClockSource Trace::default_clock_source_ = kProfilerClockSourceWall;
 
 Trace* volatile Trace::the_trace_ = NULL;
 pthread_t Trace::sampling_pthread_ = 0U;
-UniquePtr<std::vector<mirror::ArtMethod*> > Trace::temp_stack_trace_;
 
 static mirror::ArtMethod* DecodeTraceMethodId(uint32_t tmid) {
   return reinterpret_cast<mirror::ArtMethod*>(tmid & ~kTraceMethodActionMask);
@@ -140,19 +161,6 @@ static uint32_t EncodeTraceMethodAndAction(const mirror::ArtMethod* method,
   return tmid;
 }
 
-std::vector<mirror::ArtMethod*>* Trace::AllocStackTrace() {
-  if (temp_stack_trace_.get() != NULL) {
-    return temp_stack_trace_.release();
-  } else {
-    return new std::vector<mirror::ArtMethod*>();
-  }
-}
-
-void Trace::FreeStackTrace(std::vector<mirror::ArtMethod*>* stack_trace) {
-  stack_trace->clear();
-  temp_stack_trace_.reset(stack_trace);
-}
-
 void Trace::SetDefaultClockSource(ProfilerClockSource clock_source) {
 #if defined(HAVE_POSIX_CLOCKS)
   default_clock_source_ = clock_source;
@@ -238,13 +246,38 @@ static void Append8LE(uint8_t* buf, uint64_t val) {
   *buf++ = static_cast<uint8_t>(val >> 56);
 }
 
-static void GetSample(Thread* thread, void* arg) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
-  BuildStackTraceVisitor build_trace_visitor(thread);
-  build_trace_visitor.WalkStack();
-  std::vector<mirror::ArtMethod*>* stack_trace = build_trace_visitor.GetStackTrace();
-  Trace* the_trace = reinterpret_cast<Trace*>(arg);
-  the_trace->CompareAndUpdateStackTrace(thread, stack_trace);
-}
+// Samples the stack of each thread. Runnable threads run the checkpoint themselves at their next
+// suspend check, the sampling thread runs it for the others while they stay suspended, so no
+// thread waits for the others to be sampled.
+class SampleCheckpoint : public Closure {
+ public:
+  SampleCheckpoint(Trace* trace, Thread* sampling_thread, Barrier* barrier)
+      : trace_(trace), sampling_thread_(sampling_thread), barrier_(barrier) {}
+
+  virtual void Run(Thread* thread) NO_THREAD_SAFETY_ANALYSIS {
+    // Note: self is not necessarily equal to thread since thread may be suspended.
+    Thread* self = Thread::Current();
+    if (thread != sampling_thread_) {
+      bool is_runnable = thread->GetState() == kRunnable;
+      if (!trace_->IsFoldedStacksOutput()) {
+        BuildStackTraceVisitor build_trace_visitor(thread);
+        build_trace_visitor.WalkStack();
+        trace_->CompareAndUpdateStackTrace(thread, build_trace_visitor.GetStackTrace());
+      } else if (is_runnable) {
+        // Only runnable threads are using the CPU in managed code.
+        BuildStackTraceVisitor build_trace_visitor(thread);
+        build_trace_visitor.WalkStack();
+        trace_->AddSample(thread, build_trace_visitor.GetStackTrace());
+      }
+    }
+    barrier_->Pass(self);
+  }
+
+ private:
+  Trace* const trace_;
+  Thread* const sampling_thread_;
+  Barrier* const barrier_;
+};
 
 static void ClearThreadStackTraceAndClockBase(Thread* thread, void* arg) {
   thread->SetTraceClockBase(0);
@@ -255,7 +288,7 @@ static void ClearThreadStackTraceAndClockBase(Thread* thread, void* arg) {
 
 void Trace::CompareAndUpdateStackTrace(Thread* thread,
                                        std::vector<mirror::ArtMethod*>* stack_trace) {
-  CHECK_EQ(pthread_self(), sampling_pthread_);
+  // Runs on the sampled thread or, while it is suspended, on the sampling thread.
   std::vector<mirror::ArtMethod*>* old_stack_trace = thread->GetStackTraceSample();
   // Update the thread's stack trace sample.
   thread->SetStackTraceSample(stack_trace);
@@ -292,7 +325,39 @@ void Trace::CompareAndUpdateStackTrace(Thread* thread,
       LogMethodTraceEvent(thread, *rit, instrumentation::Instrumentation::kMethodEntered,
                           thread_clock_diff, wall_clock_diff);
     }
-    FreeStackTrace(old_stack_trace);
+    delete old_stack_trace;
+  }
+}
+
+void Trace::AddSample(Thread* thread, std::vector<mirror::ArtMethod*>* stack_trace) {
+  {
+    MutexLock mu(Thread::Current(), sample_lock_);
+    CallTreeNode* node = &call_tree_;
+    for (std::vector<mirror::ArtMethod*>::reverse_iterator rit = stack_trace->rbegin();
+         rit != stack_trace->rend(); ++rit) {
+      SafeMap<mirror::ArtMethod*, CallTreeNode*>::iterator it = node->children.find(*rit);
+      if (it == node->children.end()) {
+        it = node->children.Put(*rit, new CallTreeNode());
+      }
+      node = it->second;
+    }
+    node->num_samples++;
+  }
+  delete stack_trace;
+}
+
+Trace::CallTreeNode::~CallTreeNode() {
+  STLDeleteValues(&children);
+}
+
+void Trace::DumpFoldedStacks(std::ostream& os, const std::string& prefix,
+                             const CallTreeNode& node) {
+  if (node.num_samples != 0) {
+    os << prefix << " " << node.num_samples << "\n";
+  }
+  for (const auto& child : node.children) {
+    std::string frame(PrettyMethod(child.first, false));
+    DumpFoldedStacks(os, prefix.empty() ? frame : prefix + ";" + frame, *child.second);
   }
 }
 
@@ -310,17 +375,17 @@ void* Trace::RunSamplingThread(void* arg) {
     {
       MutexLock mu(self, *Locks::trace_lock_);
       the_trace = the_trace_;
-      if (the_trace == NULL) {
+      if (the_trace == NULL || the_trace->sampling_stopping_) {
         break;
       }
     }
 
-    runtime->GetThreadList()->SuspendAll();
-    {
-      MutexLock mu(self, *Locks::thread_list_lock_);
-      runtime->GetThreadList()->ForEach(GetSample, the_trace);
-    }
-    runtime->GetThreadList()->ResumeAll();
+    // The sampling thread is attached but never runs managed code, it stays in the native state
+    // as RunCheckpoint requires.
+    Barrier barrier(0);
+    SampleCheckpoint checkpoint(the_trace, self, &barrier);
+    size_t barrier_count = runtime->GetThreadList()->RunCheckpoint(&checkpoint);
+    barrier.Increment(self, barrier_count);
     ATRACE_END();
   }
 
@@ -338,6 +403,14 @@ void Trace::Start(const char* trace_filename, int trace_fd, int buffer_size, int
       return;
     }
   }
+  if ((flags & kTraceStreaming) != 0 && (direct_to_ddms || sampling_enabled)) {
+    LOG(WARNING) << "Trace streaming is only supported when method tracing to a file";
+    flags &= ~kTraceStreaming;
+  }
+  if ((flags & kTraceFoldedStacks) != 0 && (direct_to_ddms || !sampling_enabled)) {
+    LOG(WARNING) << "Folded stacks are only supported when sample profiling to a file";
+    flags &= ~kTraceFoldedStacks;
+  }
   Runtime* runtime = Runtime::Current();
   runtime->GetThreadList()->SuspendAll();
 
@@ -366,6 +439,9 @@ void Trace::Start(const char* trace_filename, int trace_fd, int buffer_size, int
       LOG(ERROR) << "Trace already in progress, ignoring this request";
     } else {
       the_trace_ = new Trace(trace_file.release(), buffer_size, flags, sampling_enabled);
+      if (the_trace_->streaming_) {
+        the_trace_->StartStreaming();
+      }
 
       // Enable count of allocs if specified in the flags.
       if ((flags && kTraceCountAllocs) != 0) {
@@ -379,6 +455,13 @@ void Trace::Start(const char* trace_filename, int trace_fd, int buffer_size, int
                                             reinterpret_cast<void*>(interval_us)),
                                             "Sampling profiler thread");
       } else {
+        // Only the methods of the classes in the filter get entry and exit stubs.
+        if (!runtime->GetInstrumentation()->SetMethodFilter(runtime->GetMethodTraceFilter())) {
+          LOG(WARNING) << "Ignoring the method trace filter while other method listeners exist";
+        }
+        // Tracing neither suspends nor needs the receiver, so code compiled with method hooks
+        // can report its entries and exits without stubs.
+        runtime->GetInstrumentation()->SetUseMethodHooks(true);
         runtime->GetInstrumentation()->AddListener(the_trace_,
                                                    instrumentation::Instrumentation::kMethodEntered |
                                                    instrumentation::Instrumentation::kMethodExited |
@@ -391,18 +474,35 @@ void Trace::Start(const char* trace_filename, int trace_fd, int buffer_size, int
 
 void Trace::Stop() {
   Runtime* runtime = Runtime::Current();
+  // Stop the sampling thread first. It samples suspended threads itself, which must not overlap
+  // with finishing the trace.
+  pthread_t sampling_pthread = 0U;
+  {
+    MutexLock mu(Thread::Current(), *Locks::trace_lock_);
+    if (the_trace_ != NULL && the_trace_->sampling_enabled_) {
+      the_trace_->sampling_stopping_ = true;
+      sampling_pthread = sampling_pthread_;
+      sampling_pthread_ = 0U;
+    }
+  }
+  if (sampling_pthread != 0U) {
+    CHECK_PTHREAD_CALL(pthread_join, (sampling_pthread, NULL), "sampling thread shutdown");
+  }
+
   runtime->GetThreadList()->SuspendAll();
   Trace* the_trace = NULL;
-  pthread_t sampling_pthread = 0U;
   {
     MutexLock mu(Thread::Current(), *Locks::trace_lock_);
     if (the_trace_ == NULL) {
       LOG(ERROR) << "Trace stop requested, but no trace currently running";
     } else {
       the_trace = the_trace_;
+      {
+        // Collect the records the suspended threads have buffered.
+        MutexLock thread_list_mu(Thread::Current(), *Locks::thread_list_lock_);
+        runtime->GetThreadList()->ForEach(FlushThreadBufferCallback, the_trace);
+      }
       the_trace_ = NULL;
-      sampling_pthread = sampling_pthread_;
-      sampling_pthread_ = 0U;
     }
   }
   if (the_trace != NULL) {
@@ -416,14 +516,12 @@ void Trace::Stop() {
                                                     instrumentation::Instrumentation::kMethodEntered |
                                                     instrumentation::Instrumentation::kMethodExited |
                                                     instrumentation::Instrumentation::kMethodUnwind);
+      runtime->GetInstrumentation()->SetMethodFilter(std::vector<std::string>());
+      runtime->GetInstrumentation()->SetUseMethodHooks(false);
     }
     delete the_trace;
   }
   runtime->GetThreadList()->ResumeAll();
-
-  if (sampling_pthread != 0U) {
-    CHECK_PTHREAD_CALL(pthread_join, (sampling_pthread, NULL), "sampling thread shutdown");
-  }
 }
 
 void Trace::Shutdown() {
@@ -432,6 +530,11 @@ void Trace::Shutdown() {
   }
 }
 
+void Trace::ThreadExiting(Thread* thread) {
+  MutexLock mu(Thread::Current(), *Locks::trace_lock_);
+  FlushThreadBufferCallback(thread, the_trace_);
+}
+
 TracingMode Trace::GetMethodTracingMode() {
   MutexLock mu(Thread::Current(), *Locks::trace_lock_);
   if (the_trace_ == NULL) {
@@ -444,9 +547,21 @@ TracingMode Trace::GetMethodTracingMode() {
 }
 
 Trace::Trace(File* trace_file, int buffer_size, int flags, bool sampling_enabled)
-    : trace_file_(trace_file), buf_(new uint8_t[buffer_size]()), flags_(flags),
-      sampling_enabled_(sampling_enabled), clock_source_(default_clock_source_),
-      buffer_size_(buffer_size), start_time_(MicroTime()), cur_offset_(0),  overflow_(false) {
+    : trace_file_(trace_file),
+      buf_(new uint8_t[(flags & kTraceStreaming) != 0 ? kTraceHeaderLength : buffer_size]()),
+      flags_(flags), sampling_enabled_(sampling_enabled), clock_source_(default_clock_source_),
+      buffer_size_((flags & kTraceStreaming) != 0 ? kTraceHeaderLength : buffer_size),
+      thread_buffer_size_(kTraceThreadBufferSize / GetRecordSize(clock_source_) *
+                          GetRecordSize(clock_source_)),
+      start_time_(MicroTime()), cur_offset_(0),  overflow_(false),
+      streaming_((flags & kTraceStreaming) != 0),
+      streaming_lock_("trace streaming lock"),
+      streaming_cond_("trace streaming condition", streaming_lock_),
+      // The buffer size bounds the memory taken by the records waiting to be written.
+      max_streaming_queue_size_(std::max(buffer_size / kTraceThreadBufferSize,
+                                         static_cast<size_t>(2))),
+      streaming_stopping_(false), streaming_pthread_(0U), sampling_stopping_(false),
+      sample_lock_("trace sample lock"), num_streamed_records_(0), streaming_failed_(false) {
   // Set up the beginning of the trace.
   uint16_t trace_version = GetTraceVersion(clock_source_);
   memset(buf_.get(), 0, kTraceHeaderLength);
@@ -488,8 +603,31 @@ void Trace::FinishTracing() {
     Runtime::Current()->SetStatsEnabled(false);
   }
 
+  if (IsFoldedStacksOutput()) {
+    std::ostringstream os;
+    {
+      MutexLock mu(Thread::Current(), sample_lock_);
+      DumpFoldedStacks(os, "", call_tree_);
+    }
+    std::string folded_stacks(os.str());
+    if (!trace_file_->WriteFully(folded_stacks.c_str(), folded_stacks.length())) {
+      std::string detail(StringPrintf("Trace data write failed: %s", strerror(errno)));
+      PLOG(ERROR) << detail;
+      ThrowRuntimeException("%s", detail.c_str());
+    }
+    return;
+  }
+
   std::set<mirror::ArtMethod*> visited_methods;
-  GetVisitedMethods(final_offset, &visited_methods);
+  size_t num_records;
+  if (streaming_) {
+    StopStreaming();
+    visited_methods.swap(streamed_methods_);
+    num_records = num_streamed_records_;
+  } else {
+    GetVisitedMethods(final_offset, &visited_methods);
+    num_records = (final_offset - kTraceHeaderLength) / GetRecordSize(clock_source_);
+  }
 
   std::ostringstream os;
 
@@ -506,7 +644,6 @@ void Trace::FinishTracing() {
     os << StringPrintf("clock=wall\n");
   }
   os << StringPrintf("elapsed-time-usec=%llu\n", elapsed);
-  size_t num_records = (final_offset - kTraceHeaderLength) / GetRecordSize(clock_source_);
   os << StringPrintf("num-method-calls=%zd\n", num_records);
   os << StringPrintf("clock-call-overhead-nsec=%d\n", clock_overhead_ns);
   os << StringPrintf("vm=art\n");
@@ -522,7 +659,18 @@ void Trace::FinishTracing() {
   os << StringPrintf("%cend\n", kTraceTokenChar);
 
   std::string header(os.str());
-  if (trace_file_.get() == NULL) {
+  if (streaming_) {
+    uint8_t summary_op[7];
+    Append2LE(summary_op, 0);
+    summary_op[2] = kTraceStreamingOpSummary;
+    Append4LE(summary_op + 3, header.length());
+    if (streaming_failed_ || !trace_file_->WriteFully(summary_op, sizeof(summary_op)) ||
+        !trace_file_->WriteFully(header.c_str(), header.length())) {
+      std::string detail(StringPrintf("Trace data write failed: %s", strerror(errno)));
+      PLOG(ERROR) << detail;
+      ThrowRuntimeException("%s", detail.c_str());
+    }
+  } else if (trace_file_.get() == NULL) {
     iovec iov[2];
     iov[0].iov_base = reinterpret_cast<void*>(const_cast<char*>(header.c_str()));
     iov[0].iov_len = header.length();
@@ -601,20 +749,148 @@ void Trace::ReadClocks(Thread* thread, uint32_t* thread_clock_diff, uint32_t* wa
   }
 }
 
-void Trace::LogMethodTraceEvent(Thread* thread, const mirror::ArtMethod* method,
-                                instrumentation::Instrumentation::InstrumentationEvent event,
-                                uint32_t thread_clock_diff, uint32_t wall_clock_diff) {
+int32_t Trace::ReserveRecords(size_t size, size_t* reserved_size) {
+  size_t record_size = GetRecordSize(clock_source_);
   // Advance cur_offset_ atomically.
   int32_t new_offset;
   int32_t old_offset;
   do {
     old_offset = cur_offset_;
-    new_offset = old_offset + GetRecordSize(clock_source_);
-    if (new_offset > buffer_size_) {
+    size_t available = (buffer_size_ - old_offset) / record_size * record_size;
+    if (available < size) {
       overflow_ = true;
-      return;
+      if (available == 0) {
+        return -1;
+      }
+      size = available;
     }
+    new_offset = old_offset + size;
   } while (android_atomic_release_cas(old_offset, new_offset, &cur_offset_) != 0);
+  *reserved_size = size;
+  return old_offset;
+}
+
+void Trace::FlushThreadBuffer(Thread* thread) {
+  size_t size = thread->GetTraceBufferOffset();
+  if (size != 0) {
+    size_t reserved_size;
+    int32_t offset = ReserveRecords(size, &reserved_size);
+    if (offset >= 0) {
+      memcpy(buf_.get() + offset, thread->GetTraceBuffer(), reserved_size);
+    }
+  }
+  thread->SetTraceBuffer(thread->GetTraceBuffer(), 0);
+}
+
+void Trace::FlushThreadBufferCallback(Thread* thread, void* arg) {
+  uint8_t* buffer = thread->GetTraceBuffer();
+  if (buffer == NULL) {
+    return;
+  }
+  Trace* trace = reinterpret_cast<Trace*>(arg);
+  if (trace != NULL && trace->streaming_) {
+    trace->StreamBuffer(buffer, thread->GetTraceBufferOffset());
+  } else {
+    if (trace != NULL) {
+      trace->FlushThreadBuffer(thread);
+    }
+    delete[] buffer;
+  }
+  thread->SetTraceBuffer(NULL, 0);
+}
+
+void Trace::StartStreaming() {
+  if (!trace_file_->WriteFully(buf_.get(), kTraceHeaderLength)) {
+    PLOG(ERROR) << "Trace data write failed";
+    streaming_failed_ = true;
+  }
+  CHECK_PTHREAD_CALL(pthread_create, (&streaming_pthread_, NULL, &RunStreamingThread, this),
+                     "Trace streaming thread");
+}
+
+void Trace::StopStreaming() {
+  {
+    MutexLock mu(Thread::Current(), streaming_lock_);
+    streaming_stopping_ = true;
+    streaming_cond_.Broadcast(Thread::Current());
+  }
+  CHECK_PTHREAD_CALL(pthread_join, (streaming_pthread_, NULL), "trace streaming thread shutdown");
+}
+
+void Trace::StreamBuffer(uint8_t* buffer, size_t size) {
+  Thread* self = Thread::Current();
+  MutexLock mu(self, streaming_lock_);
+  while (streaming_queue_.size() >= max_streaming_queue_size_) {
+    // The streaming thread doesn't take any other lock, it will make room.
+    streaming_cond_.WaitHoldingLocks(self);
+  }
+  streaming_queue_.push_back(std::make_pair(buffer, size));
+  streaming_cond_.Broadcast(self);
+}
+
+void* Trace::RunStreamingThread(void* arg) {
+  // The thread isn't attached to the runtime, it only moves bytes and is never suspended.
+  Trace* trace = reinterpret_cast<Trace*>(arg);
+  size_t record_size = GetRecordSize(trace->clock_source_);
+  while (true) {
+    std::pair<uint8_t*, size_t> buffer;
+    {
+      MutexLock mu(NULL, trace->streaming_lock_);
+      while (trace->streaming_queue_.empty() && !trace->streaming_stopping_) {
+        trace->streaming_cond_.Wait(NULL);
+      }
+      if (trace->streaming_queue_.empty()) {
+        break;
+      }
+      buffer = trace->streaming_queue_.front();
+      trace->streaming_queue_.pop_front();
+      trace->streaming_cond_.Broadcast(NULL);
+    }
+    for (uint8_t* ptr = buffer.first; ptr < buffer.first + buffer.second; ptr += record_size) {
+      uint32_t tmid = ptr[2] | (ptr[3] << 8) | (ptr[4] << 16) | (ptr[5] << 24);
+      trace->streamed_methods_.insert(DecodeTraceMethodId(tmid));
+      trace->num_streamed_records_++;
+    }
+    if (!trace->streaming_failed_ && !trace->trace_file_->WriteFully(buffer.first, buffer.second)) {
+      PLOG(ERROR) << "Trace data write failed";
+      trace->streaming_failed_ = true;
+    }
+    delete[] buffer.first;
+  }
+  return NULL;
+}
+
+void Trace::LogMethodTraceEvent(Thread* thread, const mirror::ArtMethod* method,
+                                instrumentation::Instrumentation::InstrumentationEvent event,
+                                uint32_t thread_clock_diff, uint32_t wall_clock_diff) {
+  size_t record_size = GetRecordSize(clock_source_);
+  uint8_t* ptr;
+  if (sampling_enabled_) {
+    // Only the sampling thread logs events, on behalf of the suspended threads, and some of these
+    // may be exiting. Write straight to buf_.
+    size_t reserved_size;
+    int32_t offset = ReserveRecords(record_size, &reserved_size);
+    if (offset < 0) {
+      return;
+    }
+    ptr = buf_.get() + offset;
+  } else {
+    // The thread logs its own events. Buffer them, to copy a buffer full at once to buf_.
+    DCHECK_EQ(thread, Thread::Current());
+    if (UNLIKELY(thread->GetTraceBuffer() == NULL)) {
+      thread->SetTraceBuffer(new uint8_t[thread_buffer_size_], 0);
+    } else if (UNLIKELY(thread->GetTraceBufferOffset() == thread_buffer_size_)) {
+      if (streaming_) {
+        StreamBuffer(thread->GetTraceBuffer(), thread_buffer_size_);
+        thread->SetTraceBuffer(new uint8_t[thread_buffer_size_], 0);
+      } else {
+        FlushThreadBuffer(thread);
+      }
+    }
+    size_t offset = thread->GetTraceBufferOffset();
+    ptr = thread->GetTraceBuffer() + offset;
+    thread->SetTraceBuffer(thread->GetTraceBuffer(), offset + record_size);
+  }
 
   TraceAction action = kTraceMethodEnter;
   switch (event) {
@@ -634,7 +910,6 @@ void Trace::LogMethodTraceEvent(Thread* thread, const mirror::ArtMethod* method,
   uint32_t method_value = EncodeTraceMethodAndAction(method, action);
 
   // Write data
-  uint8_t* ptr = buf_.get() + old_offset;
   Append2LE(ptr, thread->GetTid());
   Append4LE(ptr + 2, method_value);
   ptr += 6;
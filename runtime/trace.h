@@ -17,12 +17,15 @@
 #ifndef ART_RUNTIME_TRACE_H_
 #define ART_RUNTIME_TRACE_H_
 
+#include <deque>
 #include <ostream>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/macros.h"
+#include "base/mutex.h"
 #include "globals.h"
 #include "instrumentation.h"
 #include "os.h"
@@ -52,6 +55,13 @@ class Trace : public instrumentation::InstrumentationListener {
  public:
   enum TraceFlag {
     kTraceCountAllocs = 1,
+    // Write the records to the trace file as they are collected rather than when tracing stops,
+    // in the streaming format. Not supported when sampling or sending the trace to DDMS.
+    kTraceStreaming = 2,
+    // When sample profiling, write the samples of runnable threads aggregated as folded stacks,
+    // one "outermost;...;innermost count" line per distinct stack, rather than in the traceview
+    // format. Not supported when sending the trace to DDMS.
+    kTraceFoldedStacks = 4,
   };
 
   static void SetDefaultClockSource(ProfilerClockSource clock_source);
@@ -66,12 +76,19 @@ class Trace : public instrumentation::InstrumentationListener {
   static void Shutdown() LOCKS_EXCLUDED(Locks::trace_lock_);
   static TracingMode GetMethodTracingMode() LOCKS_EXCLUDED(Locks::trace_lock_);
 
+  // Copies the records buffered by the exiting thread to the trace, if any.
+  static void ThreadExiting(Thread* thread) LOCKS_EXCLUDED(Locks::trace_lock_);
+
   bool UseWallClock();
   bool UseThreadCpuClock();
 
   void CompareAndUpdateStackTrace(Thread* thread, std::vector<mirror::ArtMethod*>* stack_trace)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Records a sample of the stack of the thread, innermost frame first.
+  void AddSample(Thread* thread, std::vector<mirror::ArtMethod*>* stack_trace)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) LOCKS_EXCLUDED(sample_lock_);
+
   virtual void MethodEntered(Thread* thread, mirror::Object* this_object,
                              const mirror::ArtMethod* method, uint32_t dex_pc)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -89,12 +106,21 @@ class Trace : public instrumentation::InstrumentationListener {
                                mirror::Throwable* exception_object)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
-  // Reuse an old stack trace if it exists, otherwise allocate a new one.
-  static std::vector<mirror::ArtMethod*>* AllocStackTrace();
-  // Clear and store an old stack trace for later use.
-  static void FreeStackTrace(std::vector<mirror::ArtMethod*>* stack_trace);
+  bool IsFoldedStacksOutput() const {
+    return (flags_ & kTraceFoldedStacks) != 0;
+  }
 
  private:
+  // A node of the call tree aggregating the samples, for the folded stacks output. The children
+  // are the methods called from the node's method.
+  struct CallTreeNode {
+    CallTreeNode() : num_samples(0) {}
+    ~CallTreeNode();
+
+    // The number of samples with the node's method innermost.
+    size_t num_samples;
+    SafeMap<mirror::ArtMethod*, CallTreeNode*> children;
+  };
   explicit Trace(File* trace_file, int buffer_size, int flags, bool sampling_enabled);
 
   // The sampling interval in microseconds is passed as an argument.
@@ -102,12 +128,35 @@ class Trace : public instrumentation::InstrumentationListener {
 
   void FinishTracing() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Writes the stacks of the call tree below node, with prefix being the path to node.
+  static void DumpFoldedStacks(std::ostream& os, const std::string& prefix,
+                               const CallTreeNode& node)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Writes the header of a streamed trace and starts the thread writing the records.
+  void StartStreaming() LOCKS_EXCLUDED(streaming_lock_);
+  // Waits for the streaming thread to write the queued records and stops it.
+  void StopStreaming() LOCKS_EXCLUDED(streaming_lock_);
+  static void* RunStreamingThread(void* arg) LOCKS_EXCLUDED(streaming_lock_);
+  // Queues a buffer of records for the streaming thread, which frees it once written. Waits while
+  // the queue is full.
+  void StreamBuffer(uint8_t* buffer, size_t size) LOCKS_EXCLUDED(streaming_lock_);
+
   void ReadClocks(Thread* thread, uint32_t* thread_clock_diff, uint32_t* wall_clock_diff);
 
   void LogMethodTraceEvent(Thread* thread, const mirror::ArtMethod* method,
                            instrumentation::Instrumentation::InstrumentationEvent event,
                            uint32_t thread_clock_diff, uint32_t wall_clock_diff);
 
+  // Reserves up to size bytes, a whole number of records, at the end of buf_. Returns the offset
+  // of the reserved bytes and sets *reserved_size, or returns -1 if buf_ is full.
+  int32_t ReserveRecords(size_t size, size_t* reserved_size);
+
+  // Copies the records buffered by the thread to buf_, dropping those that don't fit, and frees
+  // the thread's buffer.
+  void FlushThreadBuffer(Thread* thread);
+  static void FlushThreadBufferCallback(Thread* thread, void* arg);
+
   // Methods to output traced methods and threads.
   void GetVisitedMethods(size_t end_offset, std::set<mirror::ArtMethod*>* visited_methods);
   void DumpMethodList(std::ostream& os, const std::set<mirror::ArtMethod*>& visited_methods)
@@ -123,9 +172,6 @@ class Trace : public instrumentation::InstrumentationListener {
   // Sampling thread, non-zero when sampling.
   static pthread_t sampling_pthread_;
 
-  // Used to remember an unused stack trace to avoid re-allocation during sampling.
-  static UniquePtr<std::vector<mirror::ArtMethod*> > temp_stack_trace_;
-
   // File to write trace data out to, NULL if direct to ddms.
   UniquePtr<File> trace_file_;
 
@@ -143,6 +189,10 @@ class Trace : public instrumentation::InstrumentationListener {
   // Size of buf_.
   const int buffer_size_;
 
+  // Size of the buffers in which threads collect their records before copying them to buf_, so
+  // that threads don't contend on cur_offset_ for every record. A whole number of records.
+  const size_t thread_buffer_size_;
+
   // Time trace was created.
   const uint64_t start_time_;
 
@@ -152,6 +202,29 @@ class Trace : public instrumentation::InstrumentationListener {
   // Did we overflow the buffer recording traces?
   bool overflow_;
 
+  // Whether the records are written to trace_file_ as they are collected. buf_ then only holds the
+  // header, and memory is bounded by the queue of buffers waiting to be written.
+  const bool streaming_;
+  Mutex streaming_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  // Signalled when a buffer is queued or dequeued, and when streaming stops.
+  ConditionVariable streaming_cond_ GUARDED_BY(streaming_lock_);
+  std::deque<std::pair<uint8_t*, size_t> > streaming_queue_ GUARDED_BY(streaming_lock_);
+  const size_t max_streaming_queue_size_;
+  bool streaming_stopping_ GUARDED_BY(streaming_lock_);
+  pthread_t streaming_pthread_;
+
+  // Set to stop the sampling thread.
+  bool sampling_stopping_ GUARDED_BY(Locks::trace_lock_);
+
+  // The samples aggregated for the folded stacks output. The root has no method.
+  Mutex sample_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  CallTreeNode call_tree_ GUARDED_BY(sample_lock_);
+
+  // Only used by the streaming thread, then by FinishTracing once it has been joined.
+  std::set<mirror::ArtMethod*> streamed_methods_;
+  size_t num_streamed_records_;
+  bool streaming_failed_;
+
   DISALLOW_COPY_AND_ASSIGN(Trace);
 };
 
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "transaction.h"
+
+#include <string.h>
+
+#include "base/logging.h"
+#include "gc/heap.h"
+#include "mirror/array.h"
+#include "mirror/object-inl.h"
+#include "runtime.h"
+
+namespace art {
+
+Transaction::Transaction() : aborted_(false) {
+}
+
+Transaction::~Transaction() {
+}
+
+void Transaction::RecordWrite(mirror::Object* obj, MemberOffset offset, size_t size,
+                              bool is_reference) {
+  DCHECK(obj != NULL);
+  DCHECK(!is_reference || size == sizeof(mirror::Object*));
+  const uint8_t* location = reinterpret_cast<const uint8_t*>(obj) + offset.Uint32Value();
+  Write write;
+  write.object = obj;
+  write.offset = offset.Uint32Value();
+  write.size = size;
+  write.is_reference = is_reference;
+  write.value = 0;
+  write.large_value_index = 0;
+  if (size <= sizeof(write.value)) {
+    memcpy(&write.value, location, size);
+  } else {
+    write.large_value_index = large_values_.size();
+    large_values_.push_back(std::vector<uint8_t>(location, location + size));
+  }
+  writes_.push_back(write);
+}
+
+void Transaction::RecordArrayWrite(mirror::Array* array, int32_t index, size_t count,
+                                   size_t component_size, bool is_reference) {
+  DCHECK(!is_reference || count == 1);
+  MemberOffset offset(mirror::Array::DataOffset(component_size).Uint32Value() +
+                      index * component_size);
+  RecordWrite(array, offset, count * component_size, is_reference);
+}
+
+void Transaction::Abort(const std::string& reason) {
+  // Keep the first reason, later ones are usually caused by the unwinding of the first.
+  if (!aborted_) {
+    aborted_ = true;
+    abort_message_ = reason;
+  }
+}
+
+void Transaction::Rollback() {
+  gc::Heap* heap = Runtime::Current()->GetHeap();
+  for (std::vector<Write>::reverse_iterator it = writes_.rbegin(); it != writes_.rend(); ++it) {
+    uint8_t* location = reinterpret_cast<uint8_t*>(it->object) + it->offset;
+    if (it->size <= sizeof(it->value)) {
+      memcpy(location, &it->value, it->size);
+    } else {
+      const std::vector<uint8_t>& old_value = large_values_[it->large_value_index];
+      memcpy(location, &old_value[0], it->size);
+    }
+    if (it->is_reference) {
+      heap->WriteBarrierField(it->object, MemberOffset(it->offset),
+                              reinterpret_cast<mirror::Object*>(it->value));
+    }
+  }
+  writes_.clear();
+  large_values_.clear();
+}
+
+void Transaction::VisitRoots(RootVisitor* visitor, void* arg) {
+  for (std::vector<Write>::iterator it = writes_.begin(); it != writes_.end(); ++it) {
+    visitor(it->object, arg);
+    if (it->is_reference && it->value != 0) {
+      visitor(reinterpret_cast<mirror::Object*>(it->value), arg);
+    }
+  }
+}
+
+}  // namespace art
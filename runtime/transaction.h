@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_TRANSACTION_H_
+#define ART_RUNTIME_TRANSACTION_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "offsets.h"
+#include "root_visitor.h"
+
+namespace art {
+namespace mirror {
+class Array;
+class Object;
+}  // namespace mirror
+
+/**
+ * Records the heap stores made while running class initializers at compile time, so that an
+ * initializer which does something that can't be preserved in the image, such as calling native
+ * code, can be undone rather than aborting the compilation or leaving half initialized state in
+ * the image.
+ *
+ * A transaction belongs to the thread running the initializer (see Thread::GetTransaction), and
+ * only that thread's interpreted stores and class status changes are recorded. Objects allocated
+ * inside the transaction are not tracked: once the stores are undone nothing refers to them.
+ */
+class Transaction {
+ public:
+  Transaction();
+  ~Transaction();
+
+  // Records the size bytes at offset in obj before a store overwrites them. Reference stores keep
+  // the old reference live until the transaction ends.
+  void RecordWrite(mirror::Object* obj, MemberOffset offset, size_t size, bool is_reference)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Records count elements of component_size bytes from index in array before they're stored to.
+  void RecordArrayWrite(mirror::Array* array, int32_t index, size_t count, size_t component_size,
+                        bool is_reference)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Marks the transaction as failed. The caller throws an exception to unwind the initializer, but
+  // as the initializer may catch it the transaction stays aborted and is rolled back regardless.
+  void Abort(const std::string& reason);
+  bool IsAborted() const {
+    return aborted_;
+  }
+  const std::string& GetAbortMessage() const {
+    return abort_message_;
+  }
+
+  // Restores every recorded location, most recent store first.
+  void Rollback() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // The stored to objects and the overwritten references are roots until the transaction ends.
+  void VisitRoots(RootVisitor* visitor, void* arg);
+
+ private:
+  struct Write {
+    mirror::Object* object;
+    uint32_t offset;
+    uint32_t size;
+    bool is_reference;
+    // The old contents when at most 8 bytes, otherwise they are in large_values_.
+    uint64_t value;
+    size_t large_value_index;
+  };
+
+  std::vector<Write> writes_;
+  std::vector<std::vector<uint8_t> > large_values_;
+  bool aborted_;
+  std::string abort_message_;
+
+  DISALLOW_COPY_AND_ASSIGN(Transaction);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_TRANSACTION_H_
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "transaction.h"
+
+#include "common_test.h"
+#include "mirror/array-inl.h"
+#include "mirror/object_array-inl.h"
+#include "sirt_ref.h"
+
+namespace art {
+
+class TransactionTest : public CommonTest {};
+
+TEST_F(TransactionTest, PrimitiveArrayRollback) {
+  ScopedObjectAccess soa(Thread::Current());
+  SirtRef<mirror::IntArray> array(soa.Self(), mirror::IntArray::Alloc(soa.Self(), 4));
+  for (int32_t i = 0; i < 4; ++i) {
+    array->Set(i, i + 1);
+  }
+  Transaction transaction;
+  transaction.RecordArrayWrite(array.get(), 1, 1, sizeof(int32_t), false);
+  array->Set(1, 42);
+  // A fill-array-data sized store over the element already stored to.
+  transaction.RecordArrayWrite(array.get(), 0, 4, sizeof(int32_t), false);
+  for (int32_t i = 0; i < 4; ++i) {
+    array->Set(i, -1);
+  }
+  transaction.Rollback();
+  for (int32_t i = 0; i < 4; ++i) {
+    EXPECT_EQ(i + 1, array->Get(i));
+  }
+}
+
+TEST_F(TransactionTest, ReferenceRollback) {
+  ScopedObjectAccess soa(Thread::Current());
+  SirtRef<mirror::ObjectArray<mirror::Object> > array(soa.Self(),
+      class_linker_->AllocObjectArray<mirror::Object>(soa.Self(), 2));
+  SirtRef<mirror::String> foo(soa.Self(), mirror::String::AllocFromModifiedUtf8(soa.Self(), "foo"));
+  SirtRef<mirror::String> bar(soa.Self(), mirror::String::AllocFromModifiedUtf8(soa.Self(), "bar"));
+  array->Set(1, foo.get());
+  Transaction transaction;
+  transaction.RecordArrayWrite(array.get(), 0, 1, sizeof(mirror::Object*), true);
+  array->Set(0, bar.get());
+  transaction.RecordArrayWrite(array.get(), 1, 1, sizeof(mirror::Object*), true);
+  array->Set(1, bar.get());
+  transaction.Rollback();
+  EXPECT_TRUE(array->Get(0) == NULL);
+  EXPECT_EQ(foo.get(), array->Get(1));
+}
+
+TEST_F(TransactionTest, Abort) {
+  Transaction transaction;
+  EXPECT_FALSE(transaction.IsAborted());
+  transaction.Abort("native call");
+  transaction.Abort("caused by the first");
+  EXPECT_TRUE(transaction.IsAborted());
+  EXPECT_EQ("native call", transaction.GetAbortMessage());
+}
+
+}  // namespace art
@@ -22,10 +22,36 @@
 
 namespace art {
 
+// The ASCII fast paths read a word at a time. The words are aligned, so reading a word that holds
+// the terminating NUL never reads from the next page.
+typedef uintptr_t __attribute__((__may_alias__)) AliasedWord;
+
+static const uintptr_t kLowBits = ~static_cast<uintptr_t>(0) / 0xff;  // 0x0101...
+static const uintptr_t kHighBits = kLowBits * 0x80;  // 0x8080...
+
+// Whether the word holds neither a NUL nor a byte with its high bit set, i.e. sizeof(uintptr_t)
+// one-byte encodings.
+static inline bool IsAsciiWord(uintptr_t word) {
+  return (((word - kLowBits) | word) & kHighBits) == 0;
+}
+
+static inline bool IsWordAligned(const char* p) {
+  return (reinterpret_cast<uintptr_t>(p) & (sizeof(uintptr_t) - 1)) == 0;
+}
+
 size_t CountModifiedUtf8Chars(const char* utf8) {
   size_t len = 0;
   int ic;
-  while ((ic = *utf8++) != '\0') {
+  for (;;) {
+    if (IsWordAligned(utf8)) {
+      while (IsAsciiWord(*reinterpret_cast<const AliasedWord*>(utf8))) {
+        utf8 += sizeof(uintptr_t);
+        len += sizeof(uintptr_t);
+      }
+    }
+    if ((ic = *utf8++) == '\0') {
+      break;
+    }
     len++;
     if ((ic & 0x80) == 0) {
       // one-byte encoding
@@ -44,7 +70,22 @@ size_t CountModifiedUtf8Chars(const char* utf8) {
 }
 
 void ConvertModifiedUtf8ToUtf16(uint16_t* utf16_data_out, const char* utf8_data_in) {
-  while (*utf8_data_in != '\0') {
+  for (;;) {
+    if (IsWordAligned(utf8_data_in)) {
+      uintptr_t word;
+      while (IsAsciiWord(word = *reinterpret_cast<const AliasedWord*>(utf8_data_in))) {
+        // Copy the bytes in memory order, which is what the loads below do.
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(utf8_data_in);
+        for (size_t i = 0; i < sizeof(uintptr_t); ++i) {
+          utf16_data_out[i] = bytes[i];
+        }
+        utf8_data_in += sizeof(uintptr_t);
+        utf16_data_out += sizeof(uintptr_t);
+      }
+    }
+    if (*utf8_data_in == '\0') {
+      break;
+    }
     *utf16_data_out++ = GetUtf16FromUtf8(&utf8_data_in);
   }
 }
@@ -69,15 +110,17 @@ void ConvertUtf16ToModifiedUtf8(char* utf8_out, const uint16_t* utf16_in, size_t
 
 int32_t ComputeUtf16Hash(const mirror::CharArray* chars, int32_t offset,
                          size_t char_count) {
-  int32_t hash = 0;
-  for (size_t i = 0; i < char_count; i++) {
-    hash = hash * 31 + chars->Get(offset + i);
-  }
-  return hash;
+  return ComputeUtf16Hash(chars->GetData() + offset, char_count);
 }
 
 int32_t ComputeUtf16Hash(const uint16_t* chars, size_t char_count) {
-  int32_t hash = 0;
+  // Four chars at a time, hash * 31^4 + c0 * 31^3 + c1 * 31^2 + c2 * 31 + c3, so that the
+  // multiplications don't all wait for the previous one. Unsigned to wrap around like Java does.
+  uint32_t hash = 0;
+  for (; char_count >= 4; char_count -= 4, chars += 4) {
+    hash = hash * (31 * 31 * 31 * 31) + chars[0] * (31 * 31 * 31) + chars[1] * (31 * 31) +
+        chars[2] * 31 + chars[3];
+  }
   while (char_count--) {
     hash = hash * 31 + *chars++;
   }
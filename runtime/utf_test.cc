@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "utf.h"
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace art {
+
+// Decodes one char at a time, which is what the word at a time fast paths must match.
+static std::vector<uint16_t> SlowConvert(const char* utf8) {
+  std::vector<uint16_t> result;
+  while (*utf8 != '\0') {
+    result.push_back(GetUtf16FromUtf8(&utf8));
+  }
+  return result;
+}
+
+TEST(UtfTest, ModifiedUtf8ToUtf16) {
+  // ASCII runs longer than a word around two- and three-byte encodings, including the encoding
+  // of NUL, at every alignment.
+  static const char* kPieces[] = {
+    "abcdefghijklmnopq", "\xc3\xa9", "0123456789", "\xe2\x82\xac", "", "\xc0\x80", "xyz",
+  };
+  std::string utf8;
+  for (size_t i = 0; i < arraysize(kPieces); ++i) {
+    utf8 += kPieces[i];
+  }
+  char buffer[64];
+  ASSERT_LT(utf8.size() + 16, sizeof(buffer));
+  for (size_t offset = 0; offset < 8; ++offset) {
+    for (size_t start = 0; start < utf8.size(); ++start) {
+      // Don't start in the middle of an encoding.
+      if ((utf8[start] & 0xc0) == 0x80) {
+        continue;
+      }
+      char* in = buffer + offset;
+      strcpy(in, utf8.c_str() + start);
+      std::vector<uint16_t> expected = SlowConvert(in);
+      ASSERT_EQ(expected.size(), CountModifiedUtf8Chars(in)) << offset << " " << start;
+      std::vector<uint16_t> actual(expected.size() + 1, 0xffff);
+      ConvertModifiedUtf8ToUtf16(&actual[0], in);
+      EXPECT_EQ(0xffff, actual[expected.size()]) << offset << " " << start;
+      actual.pop_back();
+      EXPECT_TRUE(expected == actual) << offset << " " << start;
+    }
+  }
+}
+
+TEST(UtfTest, ComputeUtf16Hash) {
+  uint16_t chars[] = { 'h', 'e', 'l', 'l', 'o', 0xffff, 0x20ac, ' ', 'w', 'o', 'r', 'l', 'd' };
+  for (size_t count = 0; count <= arraysize(chars); ++count) {
+    int32_t expected = 0;
+    for (size_t i = 0; i < count; ++i) {
+      expected = static_cast<int32_t>(static_cast<uint32_t>(expected) * 31 + chars[i]);
+    }
+    EXPECT_EQ(expected, ComputeUtf16Hash(chars, count)) << count;
+  }
+}
+
+}  // namespace art
@@ -16,6 +16,7 @@
 
 #include "method_verifier.h"
 
+#include <algorithm>
 #include <iostream>
 
 #include "base/logging.h"
@@ -28,6 +29,7 @@
 #include "gc/accounting/card_table-inl.h"
 #include "indenter.h"
 #include "intern_table.h"
+#include "jit/jit.h"
 #include "leb128.h"
 #include "mirror/art_field-inl.h"
 #include "mirror/art_method-inl.h"
@@ -52,6 +54,8 @@ void PcToRegisterLineTable::Init(RegisterTrackingMode mode, InstructionFlags* fl
                                  MethodVerifier* verifier) {
   DCHECK_GT(insns_size, 0U);
 
+  // The lines share their registers until they are first reached.
+  RegisterLine* first_line = NULL;
   for (uint32_t i = 0; i < insns_size; i++) {
     bool interesting = false;
     switch (mode) {
@@ -68,13 +72,20 @@ void PcToRegisterLineTable::Init(RegisterTrackingMode mode, InstructionFlags* fl
         break;
     }
     if (interesting) {
-      pc_to_register_line_.Put(i, new RegisterLine(registers_size, verifier));
+      RegisterLine* line = new RegisterLine(registers_size, verifier);
+      if (first_line == NULL) {
+        first_line = line;
+      } else {
+        line->CopyFromLine(first_line);
+      }
+      pc_to_register_line_.Put(i, line);
     }
   }
 }
 
 MethodVerifier::FailureKind MethodVerifier::VerifyClass(const mirror::Class* klass,
                                                         bool allow_soft_failures,
+                                                        const uint32_t* methods_to_verify,
                                                         std::string* error) {
   if (klass->IsVerified()) {
     return kNoFailure;
@@ -108,6 +119,7 @@ MethodVerifier::FailureKind MethodVerifier::VerifyClass(const mirror::Class* kla
                      klass->GetClassLoader(),
                      class_def,
                      allow_soft_failures,
+                     methods_to_verify,
                      error);
 }
 
@@ -116,6 +128,7 @@ MethodVerifier::FailureKind MethodVerifier::VerifyClass(const DexFile* dex_file,
                                                         mirror::ClassLoader* class_loader,
                                                         const DexFile::ClassDef* class_def,
                                                         bool allow_soft_failures,
+                                                        const uint32_t* methods_to_verify,
                                                         std::string* error) {
   DCHECK(class_def != nullptr);
   const byte* class_data = dex_file->GetClassData(*class_def);
@@ -130,9 +143,15 @@ MethodVerifier::FailureKind MethodVerifier::VerifyClass(const DexFile* dex_file,
   size_t error_count = 0;
   bool hard_fail = false;
   ClassLinker* linker = Runtime::Current()->GetClassLinker();
+  bool record_soft_failures = record_compiler_info_ && Runtime::Current()->IsCompiler();
+  size_t class_def_method_index = 0;
   int64_t previous_direct_method_idx = -1;
   while (it.HasNextDirectMethod()) {
     uint32_t method_idx = it.GetMemberIndex();
+    bool verify = (methods_to_verify == NULL) ||
+        ((methods_to_verify[class_def_method_index / 32] &
+          (1U << (class_def_method_index % 32))) != 0);
+    class_def_method_index++;
     if (method_idx == previous_direct_method_idx) {
       // smali can create dex files with two encoded_methods sharing the same method_idx
       // http://code.google.com/p/smali/issues/detail?id=119
@@ -140,6 +159,11 @@ MethodVerifier::FailureKind MethodVerifier::VerifyClass(const DexFile* dex_file,
       continue;
     }
     previous_direct_method_idx = method_idx;
+    if (!verify) {
+      // Passed verification at compile time.
+      it.Next();
+      continue;
+    }
     InvokeType type = it.GetMethodInvokeType(*class_def);
     mirror::ArtMethod* method =
         linker->ResolveMethod(*dex_file, method_idx, dex_cache, class_loader, NULL, type);
@@ -157,6 +181,9 @@ MethodVerifier::FailureKind MethodVerifier::VerifyClass(const DexFile* dex_file,
                                                       method,
                                                       it.GetMemberAccessFlags(),
                                                       allow_soft_failures);
+    if (result == kSoftFailure && record_soft_failures) {
+      AddSoftFailedMethod(MethodReference(dex_file, method_idx));
+    }
     if (result != kNoFailure) {
       if (result == kHardFailure) {
         hard_fail = true;
@@ -175,6 +202,10 @@ MethodVerifier::FailureKind MethodVerifier::VerifyClass(const DexFile* dex_file,
   int64_t previous_virtual_method_idx = -1;
   while (it.HasNextVirtualMethod()) {
     uint32_t method_idx = it.GetMemberIndex();
+    bool verify = (methods_to_verify == NULL) ||
+        ((methods_to_verify[class_def_method_index / 32] &
+          (1U << (class_def_method_index % 32))) != 0);
+    class_def_method_index++;
     if (method_idx == previous_virtual_method_idx) {
       // smali can create dex files with two encoded_methods sharing the same method_idx
       // http://code.google.com/p/smali/issues/detail?id=119
@@ -182,6 +213,11 @@ MethodVerifier::FailureKind MethodVerifier::VerifyClass(const DexFile* dex_file,
       continue;
     }
     previous_virtual_method_idx = method_idx;
+    if (!verify) {
+      // Passed verification at compile time.
+      it.Next();
+      continue;
+    }
     InvokeType type = it.GetMethodInvokeType(*class_def);
     mirror::ArtMethod* method =
         linker->ResolveMethod(*dex_file, method_idx, dex_cache, class_loader, NULL, type);
@@ -199,6 +235,9 @@ MethodVerifier::FailureKind MethodVerifier::VerifyClass(const DexFile* dex_file,
                                                       method,
                                                       it.GetMemberAccessFlags(),
                                                       allow_soft_failures);
+    if (result == kSoftFailure && record_soft_failures) {
+      AddSoftFailedMethod(MethodReference(dex_file, method_idx));
+    }
     if (result != kNoFailure) {
       if (result == kHardFailure) {
         hard_fail = true;
@@ -1052,7 +1091,7 @@ bool MethodVerifier::VerifyCodeFlow() {
   }
 
   // Compute information for compiler.
-  if (Runtime::Current()->IsCompiler()) {
+  if (record_compiler_info_) {
     MethodReference ref(dex_file_, dex_method_idx_);
     bool compile = IsCandidateForCompilation(ref, method_access_flags_);
     if (compile) {
@@ -1069,15 +1108,13 @@ bool MethodVerifier::VerifyCodeFlow() {
       verifier::MethodVerifier::SetDexGcMap(ref, *dex_gc_map);
     }
 
-    if (has_check_casts_) {
-      MethodVerifier::MethodSafeCastSet* method_to_safe_casts = GenerateSafeCastSet();
-      if (method_to_safe_casts != NULL) {
-        SetSafeCastMap(ref, method_to_safe_casts);
+    if (has_check_casts_ || has_virtual_or_interface_invokes_) {
+      MethodSafeCastSet* safe_casts;
+      PcToConcreteMethodMap* pc_to_concrete_method;
+      GenerateSafeCastsAndDevirtMap(&safe_casts, &pc_to_concrete_method);
+      if (safe_casts != NULL) {
+        SetSafeCastMap(ref, safe_casts);
       }
-    }
-
-    if (has_virtual_or_interface_invokes_) {
-      MethodVerifier::PcToConcreteMethodMap* pc_to_concrete_method = GenerateDevirtMap();
       if (pc_to_concrete_method != NULL) {
         SetDevirtMap(ref, pc_to_concrete_method);
       }
@@ -2077,6 +2114,8 @@ bool MethodVerifier::CodeFlowVerifyInstruction(uint32_t* start_guess) {
       VerifyISPut(inst, reg_types_.JavaLangObject(false), false, false);
       break;
 
+    // The quickened forms of direct and static invokes and static field accesses keep their
+    // indices, they are verified like the instructions they replace.
     case Instruction::SGET_BOOLEAN:
       VerifyISGet(inst, reg_types_.Boolean(), true, true);
       break;
@@ -2090,12 +2129,15 @@ bool MethodVerifier::CodeFlowVerifyInstruction(uint32_t* start_guess) {
       VerifyISGet(inst, reg_types_.Short(), true, true);
       break;
     case Instruction::SGET:
+    case Instruction::SGET_QUICK:
       VerifyISGet(inst, reg_types_.Integer(), true, true);
       break;
     case Instruction::SGET_WIDE:
+    case Instruction::SGET_WIDE_QUICK:
       VerifyISGet(inst, reg_types_.LongLo(), true, true);
       break;
     case Instruction::SGET_OBJECT:
+    case Instruction::SGET_OBJECT_QUICK:
       VerifyISGet(inst, reg_types_.JavaLangObject(false), false, true);
       break;
 
@@ -2112,12 +2154,15 @@ bool MethodVerifier::CodeFlowVerifyInstruction(uint32_t* start_guess) {
       VerifyISPut(inst, reg_types_.Short(), true, true);
       break;
     case Instruction::SPUT:
+    case Instruction::SPUT_QUICK:
       VerifyISPut(inst, reg_types_.Integer(), true, true);
       break;
     case Instruction::SPUT_WIDE:
+    case Instruction::SPUT_WIDE_QUICK:
       VerifyISPut(inst, reg_types_.LongLo(), true, true);
       break;
     case Instruction::SPUT_OBJECT:
+    case Instruction::SPUT_OBJECT_QUICK:
       VerifyISPut(inst, reg_types_.JavaLangObject(false), false, true);
       break;
 
@@ -2150,8 +2195,11 @@ bool MethodVerifier::CodeFlowVerifyInstruction(uint32_t* start_guess) {
       break;
     }
     case Instruction::INVOKE_DIRECT:
-    case Instruction::INVOKE_DIRECT_RANGE: {
-      bool is_range = (inst->Opcode() == Instruction::INVOKE_DIRECT_RANGE);
+    case Instruction::INVOKE_DIRECT_RANGE:
+    case Instruction::INVOKE_DIRECT_QUICK:
+    case Instruction::INVOKE_DIRECT_RANGE_QUICK: {
+      bool is_range = (inst->Opcode() == Instruction::INVOKE_DIRECT_RANGE ||
+                       inst->Opcode() == Instruction::INVOKE_DIRECT_RANGE_QUICK);
       mirror::ArtMethod* called_method = VerifyInvocationArgs(inst, METHOD_DIRECT,
                                                                    is_range, false);
       const char* return_type_descriptor;
@@ -2217,8 +2265,11 @@ bool MethodVerifier::CodeFlowVerifyInstruction(uint32_t* start_guess) {
       break;
     }
     case Instruction::INVOKE_STATIC:
-    case Instruction::INVOKE_STATIC_RANGE: {
-        bool is_range = (inst->Opcode() == Instruction::INVOKE_STATIC_RANGE);
+    case Instruction::INVOKE_STATIC_RANGE:
+    case Instruction::INVOKE_STATIC_QUICK:
+    case Instruction::INVOKE_STATIC_RANGE_QUICK: {
+        bool is_range = (inst->Opcode() == Instruction::INVOKE_STATIC_RANGE ||
+                         inst->Opcode() == Instruction::INVOKE_STATIC_RANGE_QUICK);
         mirror::ArtMethod* called_method = VerifyInvocationArgs(inst,
                                                                      METHOD_STATIC,
                                                                      is_range,
@@ -2566,7 +2617,8 @@ bool MethodVerifier::CodeFlowVerifyInstruction(uint32_t* start_guess) {
       break;
     }
 
-    /* These should never appear during verification. */
+    /* These should never appear during verification, the fused instructions only exist in the
+     * code the interpreter quickens. */
     case Instruction::UNUSED_3E:
     case Instruction::UNUSED_3F:
     case Instruction::UNUSED_40:
@@ -2575,20 +2627,10 @@ bool MethodVerifier::CodeFlowVerifyInstruction(uint32_t* start_guess) {
     case Instruction::UNUSED_43:
     case Instruction::UNUSED_79:
     case Instruction::UNUSED_7A:
-    case Instruction::UNUSED_EB:
-    case Instruction::UNUSED_EC:
-    case Instruction::UNUSED_ED:
-    case Instruction::UNUSED_EE:
-    case Instruction::UNUSED_EF:
-    case Instruction::UNUSED_F0:
-    case Instruction::UNUSED_F1:
-    case Instruction::UNUSED_F2:
-    case Instruction::UNUSED_F3:
-    case Instruction::UNUSED_F4:
-    case Instruction::UNUSED_F5:
-    case Instruction::UNUSED_F6:
-    case Instruction::UNUSED_F7:
-    case Instruction::UNUSED_F8:
+    case Instruction::IGET_QUICK_IF_TESTZ:
+    case Instruction::IGET_OBJECT_QUICK_IF_TESTZ:
+    case Instruction::INVOKE_VIRTUAL_QUICK_MOVE_RESULT:
+    case Instruction::INVOKE_VIRTUAL_RANGE_QUICK_MOVE_RESULT:
     case Instruction::UNUSED_F9:
     case Instruction::UNUSED_FA:
     case Instruction::UNUSED_FB:
@@ -3874,113 +3916,116 @@ void MethodVerifier::ComputeGcMapSizes(size_t* gc_points, size_t* ref_bitmap_bit
   *log2_max_gc_pc = i;
 }
 
-MethodVerifier::MethodSafeCastSet* MethodVerifier::GenerateSafeCastSet() {
-  /*
-   * Walks over the method code and adds any cast instructions in which
-   * the type cast is implicit to a set, which is used in the code generation
-   * to elide these casts.
-   */
-  if (!failure_messages_.empty()) {
-    return NULL;
-  }
-  UniquePtr<MethodSafeCastSet> mscs;
-  const Instruction* inst = Instruction::At(code_item_->insns_);
-  const Instruction* end = Instruction::At(code_item_->insns_ +
-                                           code_item_->insns_size_in_code_units_);
-
-  for (; inst < end; inst = inst->Next()) {
-    if (Instruction::CHECK_CAST != inst->Opcode()) {
-      continue;
-    }
-    uint32_t dex_pc = inst->GetDexPc(code_item_->insns_);
-    RegisterLine* line = reg_table_.GetLine(dex_pc);
-    const RegType& reg_type(line->GetRegisterType(inst->VRegA_21c()));
-    const RegType& cast_type = ResolveClassAndCheckAccess(inst->VRegB_21c());
-    if (cast_type.IsStrictlyAssignableFrom(reg_type)) {
-      if (mscs.get() == NULL) {
-        mscs.reset(new MethodSafeCastSet());
-      }
-      mscs->insert(dex_pc);
-    }
-  }
-  return mscs.release();
-}
-
-MethodVerifier::PcToConcreteMethodMap* MethodVerifier::GenerateDevirtMap() {
-  // It is risky to rely on reg_types for sharpening in cases of soft
+void MethodVerifier::GenerateSafeCastsAndDevirtMap(MethodSafeCastSet** safe_casts,
+                                                   PcToConcreteMethodMap** pc_to_concrete_method) {
+  *safe_casts = NULL;
+  *pc_to_concrete_method = NULL;
+  // It is risky to rely on reg_types for cast elision or sharpening in cases of soft
   // verification, we might end up sharpening to a wrong implementation. Just abort.
   if (!failure_messages_.empty()) {
-    return NULL;
+    return;
   }
 
+  // A single walk over the method code finds both the cast instructions in which the type cast
+  // is implicit, which the code generation elides, and the invokes with a known target. Both
+  // tables are filled in dex pc order, so they are sorted for the lookups.
+  UniquePtr<MethodSafeCastSet> mscs;
   UniquePtr<PcToConcreteMethodMap> pc_to_concrete_method_map;
   const uint16_t* insns = code_item_->insns_;
   const Instruction* inst = Instruction::At(insns);
   const Instruction* end = Instruction::At(insns + code_item_->insns_size_in_code_units_);
-
   for (; inst < end; inst = inst->Next()) {
-    bool is_virtual   = (inst->Opcode() == Instruction::INVOKE_VIRTUAL) ||
-        (inst->Opcode() ==  Instruction::INVOKE_VIRTUAL_RANGE);
-    bool is_interface = (inst->Opcode() == Instruction::INVOKE_INTERFACE) ||
-        (inst->Opcode() == Instruction::INVOKE_INTERFACE_RANGE);
-
-    if (!is_interface && !is_virtual) {
-      continue;
-    }
-    // Get reg type for register holding the reference to the object that will be dispatched upon.
-    uint32_t dex_pc = inst->GetDexPc(insns);
-    RegisterLine* line = reg_table_.GetLine(dex_pc);
-    bool is_range = (inst->Opcode() ==  Instruction::INVOKE_VIRTUAL_RANGE) ||
-        (inst->Opcode() ==  Instruction::INVOKE_INTERFACE_RANGE);
-    const RegType&
-        reg_type(line->GetRegisterType(is_range ? inst->VRegC_3rc() : inst->VRegC_35c()));
-
-    if (!reg_type.HasClass()) {
-      // We will compute devirtualization information only when we know the Class of the reg type.
-      continue;
-    }
-    mirror::Class* reg_class = reg_type.GetClass();
-    if (reg_class->IsInterface()) {
-      // We can't devirtualize when the known type of the register is an interface.
-      continue;
-    }
-    if (reg_class->IsAbstract() && !reg_class->IsArrayClass()) {
-      // We can't devirtualize abstract classes except on arrays of abstract classes.
-      continue;
-    }
-    mirror::ArtMethod* abstract_method =
-        dex_cache_->GetResolvedMethod(is_range ? inst->VRegB_3rc() : inst->VRegB_35c());
-    if (abstract_method == NULL) {
-      // If the method is not found in the cache this means that it was never found
-      // by ResolveMethodAndCheckAccess() called when verifying invoke_*.
-      continue;
-    }
-    // Find the concrete method.
-    mirror::ArtMethod* concrete_method = NULL;
-    if (is_interface) {
-      concrete_method = reg_type.GetClass()->FindVirtualMethodForInterface(abstract_method);
-    }
-    if (is_virtual) {
-      concrete_method = reg_type.GetClass()->FindVirtualMethodForVirtual(abstract_method);
-    }
-    if (concrete_method == NULL || concrete_method->IsAbstract()) {
-      // In cases where concrete_method is not found, or is abstract, continue to the next invoke.
-      continue;
-    }
-    if (reg_type.IsPreciseReference() || concrete_method->IsFinal() ||
-        concrete_method->GetDeclaringClass()->IsFinal()) {
-      // If we knew exactly the class being dispatched upon, or if the target method cannot be
-      // overridden record the target to be used in the compiler driver.
-      if (pc_to_concrete_method_map.get() == NULL) {
-        pc_to_concrete_method_map.reset(new PcToConcreteMethodMap());
+    switch (inst->Opcode()) {
+      case Instruction::CHECK_CAST: {
+        uint32_t dex_pc = inst->GetDexPc(insns);
+        if (IsImplicitCast(inst, dex_pc)) {
+          if (mscs.get() == NULL) {
+            mscs.reset(new MethodSafeCastSet());
+          }
+          mscs->push_back(dex_pc);
+        }
+        break;
+      }
+      case Instruction::INVOKE_VIRTUAL:
+      case Instruction::INVOKE_VIRTUAL_RANGE:
+      case Instruction::INVOKE_INTERFACE:
+      case Instruction::INVOKE_INTERFACE_RANGE: {
+        uint32_t dex_pc = inst->GetDexPc(insns);
+        mirror::ArtMethod* concrete_method = FindConcreteMethod(inst, dex_pc);
+        if (concrete_method != NULL) {
+          if (pc_to_concrete_method_map.get() == NULL) {
+            pc_to_concrete_method_map.reset(new PcToConcreteMethodMap());
+          }
+          MethodReference concrete_ref(
+              concrete_method->GetDeclaringClass()->GetDexCache()->GetDexFile(),
+              concrete_method->GetDexMethodIndex());
+          pc_to_concrete_method_map->push_back(std::make_pair(dex_pc, concrete_ref));
+        }
+        break;
       }
-      MethodReference concrete_ref(
-          concrete_method->GetDeclaringClass()->GetDexCache()->GetDexFile(),
-          concrete_method->GetDexMethodIndex());
-      pc_to_concrete_method_map->Put(dex_pc, concrete_ref);
+      default:
+        break;
     }
   }
-  return pc_to_concrete_method_map.release();
+  *safe_casts = mscs.release();
+  *pc_to_concrete_method = pc_to_concrete_method_map.release();
+}
+
+bool MethodVerifier::IsImplicitCast(const Instruction* inst, uint32_t dex_pc) {
+  RegisterLine* line = reg_table_.GetLine(dex_pc);
+  const RegType& reg_type(line->GetRegisterType(inst->VRegA_21c()));
+  const RegType& cast_type = ResolveClassAndCheckAccess(inst->VRegB_21c());
+  return cast_type.IsStrictlyAssignableFrom(reg_type);
+}
+
+mirror::ArtMethod* MethodVerifier::FindConcreteMethod(const Instruction* inst, uint32_t dex_pc) {
+  bool is_interface = (inst->Opcode() == Instruction::INVOKE_INTERFACE) ||
+      (inst->Opcode() == Instruction::INVOKE_INTERFACE_RANGE);
+  // Get reg type for register holding the reference to the object that will be dispatched upon.
+  RegisterLine* line = reg_table_.GetLine(dex_pc);
+  bool is_range = (inst->Opcode() ==  Instruction::INVOKE_VIRTUAL_RANGE) ||
+      (inst->Opcode() ==  Instruction::INVOKE_INTERFACE_RANGE);
+  const RegType&
+      reg_type(line->GetRegisterType(is_range ? inst->VRegC_3rc() : inst->VRegC_35c()));
+
+  if (!reg_type.HasClass()) {
+    // We will compute devirtualization information only when we know the Class of the reg type.
+    return NULL;
+  }
+  mirror::Class* reg_class = reg_type.GetClass();
+  if (reg_class->IsInterface()) {
+    // We can't devirtualize when the known type of the register is an interface.
+    return NULL;
+  }
+  if (reg_class->IsAbstract() && !reg_class->IsArrayClass()) {
+    // We can't devirtualize abstract classes except on arrays of abstract classes.
+    return NULL;
+  }
+  mirror::ArtMethod* abstract_method =
+      dex_cache_->GetResolvedMethod(is_range ? inst->VRegB_3rc() : inst->VRegB_35c());
+  if (abstract_method == NULL) {
+    // If the method is not found in the cache this means that it was never found
+    // by ResolveMethodAndCheckAccess() called when verifying invoke_*.
+    return NULL;
+  }
+  // Find the concrete method.
+  mirror::ArtMethod* concrete_method;
+  if (is_interface) {
+    concrete_method = reg_class->FindVirtualMethodForInterface(abstract_method);
+  } else {
+    concrete_method = reg_class->FindVirtualMethodForVirtual(abstract_method);
+  }
+  if (concrete_method == NULL || concrete_method->IsAbstract()) {
+    // In cases where concrete_method is not found, or is abstract, there is nothing to record.
+    return NULL;
+  }
+  if (reg_type.IsPreciseReference() || concrete_method->IsFinal() ||
+      concrete_method->GetDeclaringClass()->IsFinal()) {
+    // If we knew exactly the class being dispatched upon, or if the target method cannot be
+    // overridden record the target to be used in the compiler driver.
+    return concrete_method;
+  }
+  return NULL;
 }
 
 const std::vector<uint8_t>* MethodVerifier::GenerateGcMap() {
@@ -4073,7 +4118,7 @@ void MethodVerifier::VerifyGcMap(const std::vector<uint8_t>& data) {
 }
 
 void MethodVerifier::SetDexGcMap(MethodReference ref, const std::vector<uint8_t>& gc_map) {
-  DCHECK(Runtime::Current()->IsCompiler());
+  DCHECK(record_compiler_info_);
   {
     WriterMutexLock mu(Thread::Current(), *dex_gc_maps_lock_);
     DexGcMapTable::iterator it = dex_gc_maps_->find(ref);
@@ -4088,7 +4133,7 @@ void MethodVerifier::SetDexGcMap(MethodReference ref, const std::vector<uint8_t>
 
 
 void  MethodVerifier::SetSafeCastMap(MethodReference ref, const MethodSafeCastSet* cast_set) {
-  DCHECK(Runtime::Current()->IsCompiler());
+  DCHECK(record_compiler_info_);
   WriterMutexLock mu(Thread::Current(), *safecast_map_lock_);
   SafeCastMap::iterator it = safecast_map_->find(ref);
   if (it != safecast_map_->end()) {
@@ -4100,20 +4145,19 @@ void  MethodVerifier::SetSafeCastMap(MethodReference ref, const MethodSafeCastSe
 }
 
 bool MethodVerifier::IsSafeCast(MethodReference ref, uint32_t pc) {
-  DCHECK(Runtime::Current()->IsCompiler());
+  DCHECK(record_compiler_info_);
   ReaderMutexLock mu(Thread::Current(), *safecast_map_lock_);
   SafeCastMap::const_iterator it = safecast_map_->find(ref);
   if (it == safecast_map_->end()) {
     return false;
   }
 
-  // Look up the cast address in the set of safe casts
-  MethodVerifier::MethodSafeCastSet::const_iterator cast_it = it->second->find(pc);
-  return cast_it != it->second->end();
+  // Look up the cast address in the sorted safe casts
+  return std::binary_search(it->second->begin(), it->second->end(), pc);
 }
 
 const std::vector<uint8_t>* MethodVerifier::GetDexGcMap(MethodReference ref) {
-  DCHECK(Runtime::Current()->IsCompiler());
+  DCHECK(record_compiler_info_);
   ReaderMutexLock mu(Thread::Current(), *dex_gc_maps_lock_);
   DexGcMapTable::const_iterator it = dex_gc_maps_->find(ref);
   CHECK(it != dex_gc_maps_->end())
@@ -4124,7 +4168,7 @@ const std::vector<uint8_t>* MethodVerifier::GetDexGcMap(MethodReference ref) {
 
 void  MethodVerifier::SetDevirtMap(MethodReference ref,
                                    const PcToConcreteMethodMap* devirt_map) {
-  DCHECK(Runtime::Current()->IsCompiler());
+  DCHECK(record_compiler_info_);
   WriterMutexLock mu(Thread::Current(), *devirt_maps_lock_);
   DevirtualizationMapTable::iterator it = devirt_maps_->find(ref);
   if (it != devirt_maps_->end()) {
@@ -4136,19 +4180,24 @@ void  MethodVerifier::SetDevirtMap(MethodReference ref,
   DCHECK(devirt_maps_->find(ref) != devirt_maps_->end());
 }
 
+static bool ComparePcToConcreteMethod(const std::pair<uint32_t, MethodReference>& entry,
+                                      uint32_t dex_pc) {
+  return entry.first < dex_pc;
+}
+
 const MethodReference* MethodVerifier::GetDevirtMap(const MethodReference& ref,
                                                                     uint32_t dex_pc) {
-  DCHECK(Runtime::Current()->IsCompiler());
+  DCHECK(record_compiler_info_);
   ReaderMutexLock mu(Thread::Current(), *devirt_maps_lock_);
   DevirtualizationMapTable::const_iterator it = devirt_maps_->find(ref);
   if (it == devirt_maps_->end()) {
     return NULL;
   }
 
-  // Look up the PC in the map, get the concrete method to execute and return its reference.
-  MethodVerifier::PcToConcreteMethodMap::const_iterator pc_to_concrete_method
-      = it->second->find(dex_pc);
-  if (pc_to_concrete_method != it->second->end()) {
+  // Look up the PC in the sorted map, get the concrete method to execute and return its reference.
+  MethodVerifier::PcToConcreteMethodMap::const_iterator pc_to_concrete_method =
+      std::lower_bound(it->second->begin(), it->second->end(), dex_pc, ComparePcToConcreteMethod);
+  if (pc_to_concrete_method != it->second->end() && pc_to_concrete_method->first == dex_pc) {
     return &(pc_to_concrete_method->second);
   } else {
     return NULL;
@@ -4214,6 +4263,8 @@ bool MethodVerifier::IsCandidateForCompilation(MethodReference& method_ref,
   return (Runtime::Current()->GetCompilerFilter() != Runtime::kInterpretOnly);
 }
 
+bool MethodVerifier::record_compiler_info_ = false;
+
 ReaderWriterMutex* MethodVerifier::dex_gc_maps_lock_ = NULL;
 MethodVerifier::DexGcMapTable* MethodVerifier::dex_gc_maps_ = NULL;
 
@@ -4226,8 +4277,14 @@ MethodVerifier::DevirtualizationMapTable* MethodVerifier::devirt_maps_ = NULL;
 ReaderWriterMutex* MethodVerifier::rejected_classes_lock_ = NULL;
 MethodVerifier::RejectedClassesTable* MethodVerifier::rejected_classes_ = NULL;
 
+ReaderWriterMutex* MethodVerifier::soft_failed_methods_lock_ = NULL;
+MethodVerifier::SoftFailedMethodsTable* MethodVerifier::soft_failed_methods_ = NULL;
+
 void MethodVerifier::Init() {
-  if (Runtime::Current()->IsCompiler()) {
+  Runtime* runtime = Runtime::Current();
+  record_compiler_info_ =
+      runtime->IsCompiler() || (runtime->GetJit() != NULL && runtime->GetJit()->CanCompile());
+  if (record_compiler_info_) {
     dex_gc_maps_lock_ = new ReaderWriterMutex("verifier GC maps lock");
     Thread* self = Thread::Current();
     {
@@ -4253,12 +4310,18 @@ void MethodVerifier::Init() {
       WriterMutexLock mu(self, *rejected_classes_lock_);
       rejected_classes_ = new MethodVerifier::RejectedClassesTable;
     }
+
+    soft_failed_methods_lock_ = new ReaderWriterMutex("verifier soft failed methods lock");
+    {
+      WriterMutexLock mu(self, *soft_failed_methods_lock_);
+      soft_failed_methods_ = new MethodVerifier::SoftFailedMethodsTable;
+    }
   }
   art::verifier::RegTypeCache::Init();
 }
 
 void MethodVerifier::Shutdown() {
-  if (Runtime::Current()->IsCompiler()) {
+  if (record_compiler_info_) {
     Thread* self = Thread::Current();
     {
       WriterMutexLock mu(self, *dex_gc_maps_lock_);
@@ -4294,12 +4357,20 @@ void MethodVerifier::Shutdown() {
     }
     delete rejected_classes_lock_;
     rejected_classes_lock_ = NULL;
+
+    {
+      WriterMutexLock mu(self, *soft_failed_methods_lock_);
+      delete soft_failed_methods_;
+      soft_failed_methods_ = NULL;
+    }
+    delete soft_failed_methods_lock_;
+    soft_failed_methods_lock_ = NULL;
   }
   verifier::RegTypeCache::ShutDown();
 }
 
 void MethodVerifier::AddRejectedClass(ClassReference ref) {
-  DCHECK(Runtime::Current()->IsCompiler());
+  DCHECK(record_compiler_info_);
   {
     WriterMutexLock mu(Thread::Current(), *rejected_classes_lock_);
     rejected_classes_->insert(ref);
@@ -4308,10 +4379,22 @@ void MethodVerifier::AddRejectedClass(ClassReference ref) {
 }
 
 bool MethodVerifier::IsClassRejected(ClassReference ref) {
-  DCHECK(Runtime::Current()->IsCompiler());
+  DCHECK(record_compiler_info_);
   ReaderMutexLock mu(Thread::Current(), *rejected_classes_lock_);
   return (rejected_classes_->find(ref) != rejected_classes_->end());
 }
 
+void MethodVerifier::AddSoftFailedMethod(MethodReference ref) {
+  DCHECK(record_compiler_info_);
+  WriterMutexLock mu(Thread::Current(), *soft_failed_methods_lock_);
+  soft_failed_methods_->insert(ref);
+}
+
+bool MethodVerifier::IsMethodSoftFailed(MethodReference ref) {
+  DCHECK(record_compiler_info_);
+  ReaderMutexLock mu(Thread::Current(), *soft_failed_methods_lock_);
+  return (soft_failed_methods_->find(ref) != soft_failed_methods_->end());
+}
+
 }  // namespace verifier
 }  // namespace art
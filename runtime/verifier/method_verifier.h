@@ -145,13 +145,17 @@ class MethodVerifier {
   };
 
   /* Verify a class. Returns "kNoFailure" on success. */
+  // methods_to_verify is NULL or a bitmap indexed by class def method index, direct methods
+  // first, of the methods to verify, see OatFile::OatClass::GetMethodsToVerify. The other methods
+  // are taken to have passed verification.
   static FailureKind VerifyClass(const mirror::Class* klass, bool allow_soft_failures,
-                                 std::string* error)
+                                 const uint32_t* methods_to_verify, std::string* error)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   static FailureKind VerifyClass(const DexFile* dex_file, mirror::DexCache* dex_cache,
                                  mirror::ClassLoader* class_loader,
                                  const DexFile::ClassDef* class_def,
-                                 bool allow_soft_failures, std::string* error)
+                                 bool allow_soft_failures, const uint32_t* methods_to_verify,
+                                 std::string* error)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   static void VerifyMethodAndDump(std::ostream& os, uint32_t method_idx, const DexFile* dex_file,
@@ -219,6 +223,11 @@ class MethodVerifier {
   static bool IsClassRejected(ClassReference ref)
       LOCKS_EXCLUDED(rejected_classes_lock_);
 
+  // Whether the method had a soft failure when verified by the compiler, the oat file records
+  // those so that only they are verified again at runtime.
+  static bool IsMethodSoftFailed(MethodReference ref)
+      LOCKS_EXCLUDED(soft_failed_methods_lock_);
+
   bool CanLoadClasses() const {
     return can_load_classes_;
   }
@@ -631,6 +640,10 @@ class MethodVerifier {
 
   InstructionFlags* CurrentInsnFlags();
 
+  // Set when the compiler runs, ahead of time or in the runtime, so that the tables below are
+  // kept for it.
+  static bool record_compiler_info_;
+
   // All the GC maps that the verifier has created
   typedef SafeMap<const MethodReference, const std::vector<uint8_t>*,
       MethodReferenceComparator> DexGcMapTable;
@@ -640,22 +653,30 @@ class MethodVerifier {
       LOCKS_EXCLUDED(dex_gc_maps_lock_);
 
 
-  // Cast elision types.
-  typedef std::set<uint32_t> MethodSafeCastSet;
+  // Cast elision types. The dex pcs of the safe casts, sorted.
+  typedef std::vector<uint32_t> MethodSafeCastSet;
   typedef SafeMap<const MethodReference, const MethodSafeCastSet*,
       MethodReferenceComparator> SafeCastMap;
-  MethodVerifier::MethodSafeCastSet* GenerateSafeCastSet()
-      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   static void SetSafeCastMap(MethodReference ref, const MethodSafeCastSet* mscs);
       LOCKS_EXCLUDED(safecast_map_lock_);
   static ReaderWriterMutex* safecast_map_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   static SafeCastMap* safecast_map_ GUARDED_BY(safecast_map_lock_);
 
-  // Devirtualization map.
-  typedef SafeMap<const uint32_t, MethodReference> PcToConcreteMethodMap;
+  // Devirtualization map, sorted by dex pc.
+  typedef std::vector<std::pair<uint32_t, MethodReference> > PcToConcreteMethodMap;
   typedef SafeMap<const MethodReference, const PcToConcreteMethodMap*,
       MethodReferenceComparator> DevirtualizationMapTable;
-  MethodVerifier::PcToConcreteMethodMap* GenerateDevirtMap()
+
+  // Computes the safe casts and the devirtualization map of the verified method in one walk over
+  // its instructions. Sets either to NULL when it would be empty.
+  void GenerateSafeCastsAndDevirtMap(MethodSafeCastSet** safe_casts,
+                                     PcToConcreteMethodMap** pc_to_concrete_method)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Whether the check-cast at dex_pc always succeeds.
+  bool IsImplicitCast(const Instruction* inst, uint32_t dex_pc)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Returns the method the invoke at dex_pc always calls, or NULL if it isn't known.
+  mirror::ArtMethod* FindConcreteMethod(const Instruction* inst, uint32_t dex_pc)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   static ReaderWriterMutex* devirt_maps_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
@@ -670,6 +691,13 @@ class MethodVerifier {
   static void AddRejectedClass(ClassReference ref)
       LOCKS_EXCLUDED(rejected_classes_lock_);
 
+  typedef std::set<MethodReference, MethodReferenceComparator> SoftFailedMethodsTable;
+  static ReaderWriterMutex* soft_failed_methods_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  static SoftFailedMethodsTable* soft_failed_methods_ GUARDED_BY(soft_failed_methods_lock_);
+
+  static void AddSoftFailedMethod(MethodReference ref)
+      LOCKS_EXCLUDED(soft_failed_methods_lock_);
+
   RegTypeCache reg_types_;
 
   PcToRegisterLineTable reg_table_;
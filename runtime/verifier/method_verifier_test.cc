@@ -34,7 +34,7 @@ class MethodVerifierTest : public CommonTest {
 
     // Verify the class
     std::string error_msg;
-    ASSERT_TRUE(MethodVerifier::VerifyClass(klass, true, &error_msg) == MethodVerifier::kNoFailure)
+    ASSERT_TRUE(MethodVerifier::VerifyClass(klass, true, NULL, &error_msg) == MethodVerifier::kNoFailure)
         << error_msg;
   }
 
@@ -28,6 +28,8 @@ namespace verifier {
 bool RegTypeCache::primitive_initialized_ = false;
 uint16_t RegTypeCache::primitive_start_ = 0;
 uint16_t RegTypeCache::primitive_count_ = 0;
+RegType* RegTypeCache::common_types_[kNumCommonTypes];
+uint32_t RegTypeCache::common_type_hashes_[kNumCommonTypes];
 
 static bool MatchingPrecisionForClass(RegType* entry, bool precise)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
@@ -58,6 +60,27 @@ void RegTypeCache::FillPrimitiveTypes() {
   entries_.push_back(DoubleLoType::GetInstance());
   entries_.push_back(DoubleHiType::GetInstance());
   DCHECK_EQ(entries_.size(), primitive_count_);
+  entries_.insert(entries_.end(), common_types_, common_types_ + kNumCommonTypes);
+}
+
+uint32_t RegTypeCache::HashDescriptor(const char* descriptor) {
+  uint32_t hash = 0;
+  for (; *descriptor != '\0'; ++descriptor) {
+    hash = hash * 31 + *descriptor;
+  }
+  return hash;
+}
+
+void RegTypeCache::AddEntry(RegType* entry) {
+  DCHECK_EQ(entry->GetId(), entries_.size());
+  entries_.push_back(entry);
+  if (!entry->descriptor_.empty()) {
+    descriptor_index_.insert(std::make_pair(HashDescriptor(entry->descriptor_.c_str()),
+                                            entry->GetId()));
+  }
+  if (entry->klass_ != NULL) {
+    class_index_.insert(std::make_pair(entry->klass_, entry->GetId()));
+  }
 }
 
 const RegType& RegTypeCache::FromDescriptor(mirror::ClassLoader* loader, const char* descriptor,
@@ -159,10 +182,18 @@ void RegTypeCache::ClearException() {
 
 const RegType& RegTypeCache::From(mirror::ClassLoader* loader, const char* descriptor,
                                   bool precise) {
-  // Try looking up the class in the cache first.
-  for (size_t i = primitive_count_; i < entries_.size(); i++) {
-    if (MatchDescriptor(i, descriptor, precise)) {
-      return *(entries_[i]);
+  // Try looking up the class in the cache first, the shared types have the lowest ids.
+  const uint32_t hash = HashDescriptor(descriptor);
+  for (size_t i = 0; i < kNumCommonTypes; i++) {
+    if (common_type_hashes_[i] == hash && MatchDescriptor(kNumPrimitives + i, descriptor, precise)) {
+      return *common_types_[i];
+    }
+  }
+  typedef std::multimap<uint32_t, uint16_t>::const_iterator It;
+  std::pair<It, It> range = descriptor_index_.equal_range(hash);
+  for (It it = range.first; it != range.second; ++it) {
+    if (MatchDescriptor(it->second, descriptor, precise)) {
+      return *(entries_[it->second]);
     }
   }
   // Class not found in the cache, will create a new type for that.
@@ -186,7 +217,7 @@ const RegType& RegTypeCache::From(mirror::ClassLoader* loader, const char* descr
     } else {
       entry = new ReferenceType(klass, descriptor, entries_.size());
     }
-    entries_.push_back(entry);
+    AddEntry(entry);
     return *entry;
   } else {  // Class not resolved.
     // We tried loading the class and failed, this might get an exception raised
@@ -194,7 +225,7 @@ const RegType& RegTypeCache::From(mirror::ClassLoader* loader, const char* descr
     ClearException();
     if (IsValidDescriptor(descriptor)) {
       RegType* entry = new UnresolvedReferenceType(descriptor, entries_.size());
-      entries_.push_back(entry);
+      AddEntry(entry);
       return *entry;
     } else {
       // The descriptor is broken return the unknown type as there's nothing sensible that
@@ -211,12 +242,20 @@ const RegType& RegTypeCache::FromClass(const char* descriptor, mirror::Class* kl
     return RegTypeFromPrimitiveType(klass->GetPrimitiveType());
   } else {
     // Look for the reference in the list of entries to have.
-    for (size_t i = primitive_count_; i < entries_.size(); i++) {
-      RegType* cur_entry = entries_[i];
+    for (size_t i = 0; i < kNumCommonTypes; i++) {
+      RegType* cur_entry = common_types_[i];
       if (cur_entry->klass_ == klass && MatchingPrecisionForClass(cur_entry, precise)) {
         return *cur_entry;
       }
     }
+    typedef std::multimap<const mirror::Class*, uint16_t>::const_iterator It;
+    std::pair<It, It> range = class_index_.equal_range(klass);
+    for (It it = range.first; it != range.second; ++it) {
+      RegType* cur_entry = entries_[it->second];
+      if (MatchingPrecisionForClass(cur_entry, precise)) {
+        return *cur_entry;
+      }
+    }
     // No reference to the class was found, create new reference.
     RegType* entry;
     if (precise) {
@@ -224,21 +263,21 @@ const RegType& RegTypeCache::FromClass(const char* descriptor, mirror::Class* kl
     } else {
       entry = new ReferenceType(klass, descriptor, entries_.size());
     }
-    entries_.push_back(entry);
+    AddEntry(entry);
     return *entry;
   }
 }
 
 RegTypeCache::~RegTypeCache() {
-  CHECK_LE(primitive_count_, entries_.size());
-  // Delete only the non primitive types.
-  if (entries_.size() == kNumPrimitives) {
-    // All entries are primitive, nothing to delete.
+  CHECK_LE(kNumSharedTypes, entries_.size());
+  // Delete only the types that aren't shared.
+  if (entries_.size() == kNumSharedTypes) {
+    // All entries are shared, nothing to delete.
     return;
   }
-  std::vector<RegType*>::iterator non_primitive_begin = entries_.begin();
-  std::advance(non_primitive_begin, kNumPrimitives);
-  STLDeleteContainerPointers(non_primitive_begin, entries_.end());
+  std::vector<RegType*>::iterator non_shared_begin = entries_.begin();
+  std::advance(non_shared_begin, kNumSharedTypes);
+  STLDeleteContainerPointers(non_shared_begin, entries_.end());
 }
 
 void RegTypeCache::ShutDown() {
@@ -255,6 +294,7 @@ void RegTypeCache::ShutDown() {
     FloatType::Destroy();
     DoubleLoType::Destroy();
     DoubleHiType::Destroy();
+    STLDeleteContainerPointers(common_types_, common_types_ + kNumCommonTypes);
     RegTypeCache::primitive_initialized_ = false;
     RegTypeCache::primitive_count_ = 0;
   }
@@ -275,6 +315,30 @@ void RegTypeCache::CreatePrimitiveTypes() {
   CreatePrimitiveTypeInstance<DoubleHiType>("D");
 }
 
+void RegTypeCache::CreateCommonTypes() {
+  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+  mirror::Class* object_class = class_linker->FindSystemClass("Ljava/lang/Object;");
+  mirror::Class* string_class = class_linker->FindSystemClass("Ljava/lang/String;");
+  mirror::Class* class_class = class_linker->FindSystemClass("Ljava/lang/Class;");
+  mirror::Class* throwable_class = class_linker->FindSystemClass("Ljava/lang/Throwable;");
+  CHECK(object_class != NULL && string_class != NULL && class_class != NULL &&
+        throwable_class != NULL);
+  // These are the types From would create for the descriptors, String and Class are final and
+  // therefore always precise.
+  uint16_t id = kNumPrimitives;
+  common_types_[0] = new ReferenceType(object_class, "Ljava/lang/Object;", id++);
+  common_types_[1] = new PreciseReferenceType(object_class, "Ljava/lang/Object;", id++);
+  common_types_[2] = new PreciseReferenceType(string_class, "Ljava/lang/String;", id++);
+  common_types_[3] = new PreciseReferenceType(class_class, "Ljava/lang/Class;", id++);
+  common_types_[4] = new ReferenceType(throwable_class, "Ljava/lang/Throwable;", id++);
+  common_types_[5] = new PreciseReferenceType(throwable_class, "Ljava/lang/Throwable;", id++);
+  common_types_[6] = new PreciseConstType(0, id++);
+  CHECK_EQ(id, kNumSharedTypes);
+  for (size_t i = 0; i < kNumCommonTypes; i++) {
+    common_type_hashes_[i] = HashDescriptor(common_types_[i]->descriptor_.c_str());
+  }
+}
+
 const RegType& RegTypeCache::FromUnresolvedMerge(const RegType& left, const RegType& right) {
   std::set<uint16_t> types;
   if (left.IsUnresolvedMergedReference()) {
@@ -303,7 +367,7 @@ const RegType& RegTypeCache::FromUnresolvedMerge(const RegType& left, const RegT
   }
   // Create entry.
   RegType* entry = new UnresolvedMergedType(left.GetId(), right.GetId(), this, entries_.size());
-  entries_.push_back(entry);
+  AddEntry(entry);
   if (kIsDebugBuild) {
     UnresolvedMergedType* tmp_entry = down_cast<UnresolvedMergedType*>(entry);
     std::set<uint16_t> check_types = tmp_entry->GetMergedTypes();
@@ -327,7 +391,7 @@ const RegType& RegTypeCache::FromUnresolvedSuperClass(const RegType& child) {
     }
   }
   RegType* entry = new UnresolvedSuperClass(child.GetId(), this, entries_.size());
-  entries_.push_back(entry);
+  AddEntry(entry);
   return *entry;
 }
 
@@ -358,7 +422,7 @@ const RegType& RegTypeCache::Uninitialized(const RegType& type, uint32_t allocat
     }
     entry = new UninitializedReferenceType(klass, descriptor, allocation_pc, entries_.size());
   }
-  entries_.push_back(entry);
+  AddEntry(entry);
   return *entry;
 }
 
@@ -400,7 +464,7 @@ const RegType& RegTypeCache::FromUninitialized(const RegType& uninit_type) {
       return Conflict();
     }
   }
-  entries_.push_back(entry);
+  AddEntry(entry);
   return *entry;
 }
 
@@ -438,7 +502,7 @@ const RegType& RegTypeCache::UninitializedThisArgument(const RegType& type) {
     }
     entry = new UninitializedThisReferenceType(klass, descriptor, entries_.size());
   }
-  entries_.push_back(entry);
+  AddEntry(entry);
   return *entry;
 }
 
@@ -457,7 +521,7 @@ const RegType& RegTypeCache::FromCat1Const(int32_t value, bool precise) {
   } else {
     entry = new ImpreciseConstType(value, entries_.size());
   }
-  entries_.push_back(entry);
+  AddEntry(entry);
   return *entry;
 }
 
@@ -475,7 +539,7 @@ const RegType& RegTypeCache::FromCat2ConstLo(int32_t value, bool precise) {
   } else {
     entry = new ImpreciseConstLoType(value, entries_.size());
   }
-  entries_.push_back(entry);
+  AddEntry(entry);
   return *entry;
 }
 
@@ -493,7 +557,7 @@ const RegType& RegTypeCache::FromCat2ConstHi(int32_t value, bool precise) {
   } else {
     entry = new ImpreciseConstHiType(value, entries_.size());
   }
-  entries_.push_back(entry);
+  AddEntry(entry);
   return *entry;
 }
 
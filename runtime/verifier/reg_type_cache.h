@@ -24,6 +24,7 @@
 #include "runtime.h"
 
 #include <stdint.h>
+#include <map>
 #include <vector>
 
 namespace art {
@@ -36,6 +37,13 @@ namespace verifier {
 class RegType;
 
 const size_t kNumPrimitives = 12;
+// Reference and constant types that most methods use, created once and shared by all caches
+// after the primitive types: Object, String, Class and Throwable, and the zero constant.
+const size_t kNumCommonTypes = 7;
+const size_t kNumSharedTypes = kNumPrimitives + kNumCommonTypes;
+
+// The types of one method verifier. Types are looked up by descriptor and by class through hash
+// indexes. The shared types are immutable and read concurrently by all verifiers.
 class RegTypeCache {
  public:
   explicit RegTypeCache(bool can_load_classes) : can_load_classes_(can_load_classes) {
@@ -48,6 +56,7 @@ class RegTypeCache {
       CHECK_EQ(RegTypeCache::primitive_count_, 0);
       CreatePrimitiveTypes();
       CHECK_EQ(RegTypeCache::primitive_count_, kNumPrimitives);
+      CreateCommonTypes();
       RegTypeCache::primitive_initialized_ = true;
     }
   }
@@ -146,10 +155,20 @@ class RegTypeCache {
 
  private:
   std::vector<RegType*> entries_;
+  // Ids of the entries that aren't shared, by hash of their descriptor and by class. Entries with
+  // the same key are in id order.
+  std::multimap<uint32_t, uint16_t> descriptor_index_;
+  std::multimap<const mirror::Class*, uint16_t> class_index_;
   static bool primitive_initialized_;
   static uint16_t primitive_start_;
   static uint16_t primitive_count_;
+  static RegType* common_types_[kNumCommonTypes];
+  static uint32_t common_type_hashes_[kNumCommonTypes];
   static void CreatePrimitiveTypes() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  static void CreateCommonTypes() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  static uint32_t HashDescriptor(const char* descriptor);
+  // Appends a new type, whose id must be its index, and indexes it.
+  void AddEntry(RegType* entry);
   // Whether or not we're allowed to load classes.
   const bool can_load_classes_;
   mirror::Class* ResolveClass(const char* descriptor, mirror::ClassLoader* loader)
@@ -448,6 +448,31 @@ TEST_F(RegTypeReferenceTest, JavalangObject) {
   EXPECT_TRUE(ref_type_3.Equals(ref_type_2));
   EXPECT_EQ(ref_type.GetId(), ref_type_3.GetId());
 }
+
+TEST_F(RegTypeReferenceTest, SharedTypes) {
+  // The common types are the same objects in all caches, other types belong to one cache.
+  ScopedObjectAccess soa(Thread::Current());
+  RegTypeCache cache_1(true);
+  RegTypeCache cache_2(true);
+  EXPECT_EQ(&cache_1.JavaLangObject(false), &cache_2.JavaLangObject(false));
+  EXPECT_EQ(&cache_1.JavaLangObject(true), &cache_2.JavaLangObject(true));
+  EXPECT_FALSE(cache_1.JavaLangObject(false).Equals(cache_1.JavaLangObject(true)));
+  EXPECT_EQ(&cache_1.JavaLangString(), &cache_2.JavaLangString());
+  EXPECT_EQ(&cache_1.JavaLangClass(false), &cache_2.JavaLangClass(true));
+  EXPECT_EQ(&cache_1.Zero(), &cache_2.Zero());
+  EXPECT_EQ(kNumSharedTypes, cache_1.GetCacheSize());
+
+  mirror::Class* string_class = cache_1.JavaLangString().GetClass();
+  EXPECT_TRUE(cache_1.FromClass("Ljava/lang/String;", string_class, true).Equals(
+      cache_1.JavaLangString()));
+  const RegType& integer_1 = cache_1.From(NULL, "Ljava/lang/Integer;", false);
+  const RegType& integer_2 = cache_2.From(NULL, "Ljava/lang/Integer;", false);
+  EXPECT_NE(&integer_1, &integer_2);
+  EXPECT_TRUE(integer_1.Equals(cache_1.FromClass("Ljava/lang/Integer;", integer_1.GetClass(),
+                                                 false)));
+  EXPECT_EQ(kNumSharedTypes + 1, cache_1.GetCacheSize());
+}
+
 TEST_F(RegTypeReferenceTest, Merging) {
   // Tests merging logic
   // String and object , LUB is object.
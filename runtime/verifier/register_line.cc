@@ -45,7 +45,7 @@ bool RegisterLine::SetRegisterType(uint32_t vdst, const RegType& new_type) {
     verifier_->Fail(VERIFY_ERROR_BAD_CLASS_SOFT) << "Set register to unknown type " << new_type;
     return false;
   } else {
-    line_[vdst] = new_type.GetId();
+    SetRegisterTypeId(vdst, new_type.GetId());
   }
   // Clear the monitor entry bits for this register.
   ClearAllRegToLockDepths(vdst);
@@ -60,8 +60,8 @@ bool RegisterLine::SetRegisterTypeWide(uint32_t vdst, const RegType& new_type1,
         << new_type1 << "' '" << new_type2 << "'";
     return false;
   } else {
-    line_[vdst] = new_type1.GetId();
-    line_[vdst + 1] = new_type2.GetId();
+    SetRegisterTypeId(vdst, new_type1.GetId());
+    SetRegisterTypeId(vdst + 1, new_type2.GetId());
   }
   // Clear the monitor entry bits for this register.
   ClearAllRegToLockDepths(vdst);
@@ -167,7 +167,7 @@ void RegisterLine::MarkRefsAsInitialized(const RegType& uninit_type) {
   size_t changed = 0;
   for (uint32_t i = 0; i < num_regs_; i++) {
     if (GetRegisterType(i).Equals(uninit_type)) {
-      line_[i] = init_type.GetId();
+      SetRegisterTypeId(i, init_type.GetId());
       changed++;
     }
   }
@@ -176,25 +176,28 @@ void RegisterLine::MarkRefsAsInitialized(const RegType& uninit_type) {
 
 void RegisterLine::MarkAllRegistersAsConflicts() {
   uint16_t conflict_type_id = verifier_->GetRegTypeCache()->Conflict().GetId();
+  uint16_t* types = GetMutableTypes();
   for (uint32_t i = 0; i < num_regs_; i++) {
-    line_[i] = conflict_type_id;
+    types[i] = conflict_type_id;
   }
 }
 
 void RegisterLine::MarkAllRegistersAsConflictsExcept(uint32_t vsrc) {
   uint16_t conflict_type_id = verifier_->GetRegTypeCache()->Conflict().GetId();
+  uint16_t* types = GetMutableTypes();
   for (uint32_t i = 0; i < num_regs_; i++) {
     if (i != vsrc) {
-      line_[i] = conflict_type_id;
+      types[i] = conflict_type_id;
     }
   }
 }
 
 void RegisterLine::MarkAllRegistersAsConflictsExceptWide(uint32_t vsrc) {
   uint16_t conflict_type_id = verifier_->GetRegTypeCache()->Conflict().GetId();
+  uint16_t* types = GetMutableTypes();
   for (uint32_t i = 0; i < num_regs_; i++) {
     if ((i != vsrc) && (i != (vsrc + 1))) {
-      line_[i] = conflict_type_id;
+      types[i] = conflict_type_id;
     }
   }
 }
@@ -215,7 +218,7 @@ std::string RegisterLine::Dump() const {
 void RegisterLine::MarkUninitRefsAsInvalid(const RegType& uninit_type) {
   for (size_t i = 0; i < num_regs_; i++) {
     if (GetRegisterType(i).Equals(uninit_type)) {
-      line_[i] = verifier_->GetRegTypeCache()->Conflict().GetId();
+      SetRegisterTypeId(i, verifier_->GetRegTypeCache()->Conflict().GetId());
       ClearAllRegToLockDepths(i);
     }
   }
@@ -458,14 +461,18 @@ bool RegisterLine::VerifyMonitorStackEmpty() const {
 bool RegisterLine::MergeRegisters(const RegisterLine* incoming_line) {
   bool changed = false;
   CHECK(NULL != incoming_line);
-  CHECK(NULL != line_.get());
-  for (size_t idx = 0; idx < num_regs_; idx++) {
-    if (line_[idx] != incoming_line->line_[idx]) {
-      const RegType& incoming_reg_type = incoming_line->GetRegisterType(idx);
-      const RegType& cur_type = GetRegisterType(idx);
-      const RegType& new_type = cur_type.Merge(incoming_reg_type, verifier_->GetRegTypeCache());
-      changed = changed || !cur_type.Equals(new_type);
-      line_[idx] = new_type.GetId();
+  CHECK(NULL != line_);
+  if (line_ != incoming_line->line_) {
+    for (size_t idx = 0; idx < num_regs_; idx++) {
+      if (line_->types[idx] != incoming_line->line_->types[idx]) {
+        const RegType& incoming_reg_type = incoming_line->GetRegisterType(idx);
+        const RegType& cur_type = GetRegisterType(idx);
+        const RegType& new_type = cur_type.Merge(incoming_reg_type, verifier_->GetRegTypeCache());
+        if (!cur_type.Equals(new_type)) {
+          changed = true;
+          SetRegisterTypeId(idx, new_type.GetId());
+        }
+      }
     }
   }
   //if (monitors_.size() != incoming_line->monitors_.size()) {
@@ -17,13 +17,12 @@
 #ifndef ART_RUNTIME_VERIFIER_REGISTER_LINE_H_
 #define ART_RUNTIME_VERIFIER_REGISTER_LINE_H_
 
-#include <deque>
 #include <vector>
 
+#include "base/macros.h"
 #include "dex_instruction.h"
 #include "reg_type.h"
 #include "safe_map.h"
-#include "UniquePtr.h"
 
 namespace art {
 namespace verifier {
@@ -49,16 +48,24 @@ enum TypeCategory {
 // During verification, we associate one of these with every "interesting" instruction. We track
 // the status of all registers, and (if the method has any monitor-enter instructions) maintain a
 // stack of entered monitors (identified by code unit offset).
+//
+// Lines copied from each other share their register types until one of them changes a register,
+// so copying a line into a branch target and merging or comparing identical lines is cheap, and
+// the lines of instructions that haven't been reached take no space for their registers.
 class RegisterLine {
  public:
   RegisterLine(size_t num_regs, MethodVerifier* verifier)
-      : line_(new uint16_t[num_regs]),
+      : line_(AllocateRegisters(num_regs)),
         verifier_(verifier),
         num_regs_(num_regs) {
-    memset(line_.get(), 0, num_regs_ * sizeof(uint16_t));
+    memset(line_->types, 0, num_regs_ * sizeof(uint16_t));
     SetResultTypeToUnknown();
   }
 
+  ~RegisterLine() {
+    ReleaseRegisters(line_);
+  }
+
   // Implement category-1 "move" instructions. Copy a 32-bit value from "vsrc" to "vdst".
   void CopyRegister1(uint32_t vdst, uint32_t vsrc, TypeCategory cat)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -108,7 +115,11 @@ class RegisterLine {
 
   void CopyFromLine(const RegisterLine* src) {
     DCHECK_EQ(num_regs_, src->num_regs_);
-    memcpy(line_.get(), src->line_.get(), num_regs_ * sizeof(uint16_t));
+    if (line_ != src->line_) {
+      src->line_->ref_count++;
+      ReleaseRegisters(line_);
+      line_ = src->line_;
+    }
     monitors_ = src->monitors_;
     reg_to_lock_depths_ = src->reg_to_lock_depths_;
   }
@@ -116,10 +127,8 @@ class RegisterLine {
   std::string Dump() const SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   void FillWithGarbage() {
-    memset(line_.get(), 0xf1, num_regs_ * sizeof(uint16_t));
-    while (!monitors_.empty()) {
-      monitors_.pop_back();
-    }
+    memset(GetMutableTypes(), 0xf1, num_regs_ * sizeof(uint16_t));
+    monitors_.clear();
     reg_to_lock_depths_.clear();
   }
 
@@ -161,7 +170,10 @@ class RegisterLine {
   int CompareLine(const RegisterLine* line2) const {
     DCHECK(monitors_ == line2->monitors_);
     // TODO: DCHECK(reg_to_lock_depths_ == line2->reg_to_lock_depths_);
-    return memcmp(line_.get(), line2->line_.get(), num_regs_ * sizeof(uint16_t));
+    if (line_ == line2->line_) {
+      return 0;
+    }
+    return memcmp(line_->types, line2->line_->types, num_regs_ * sizeof(uint16_t));
   }
 
   size_t NumRegs() const {
@@ -295,6 +307,41 @@ class RegisterLine {
   }
 
  private:
+  // The type ids of the registers, reference counted by the lines sharing them.
+  struct Registers {
+    size_t ref_count;
+    uint16_t types[0];
+  };
+
+  static Registers* AllocateRegisters(size_t num_regs) {
+    Registers* registers = reinterpret_cast<Registers*>(
+        new uint8_t[sizeof(Registers) + num_regs * sizeof(uint16_t)]);
+    registers->ref_count = 1;
+    return registers;
+  }
+
+  static void ReleaseRegisters(Registers* registers) {
+    DCHECK_GT(registers->ref_count, 0U);
+    if (--registers->ref_count == 0) {
+      delete[] reinterpret_cast<uint8_t*>(registers);
+    }
+  }
+
+  // Returns the register types to write, copying them first if another line shares them.
+  uint16_t* GetMutableTypes() {
+    if (UNLIKELY(line_->ref_count != 1)) {
+      Registers* copy = AllocateRegisters(num_regs_);
+      memcpy(copy->types, line_->types, num_regs_ * sizeof(uint16_t));
+      ReleaseRegisters(line_);
+      line_ = copy;
+    }
+    return line_->types;
+  }
+
+  void SetRegisterTypeId(uint32_t reg, uint16_t type_id) {
+    GetMutableTypes()[reg] = type_id;
+  }
+
   void CopyRegToLockDepth(size_t dst, size_t src) {
     SafeMap<uint32_t, uint32_t>::iterator it = reg_to_lock_depths_.find(src);
     if (it != reg_to_lock_depths_.end()) {
@@ -342,20 +389,23 @@ class RegisterLine {
   // Storage for the result register's type, valid after an invocation
   uint16_t result_[2];
 
-  // An array of RegType Ids associated with each dex register
-  UniquePtr<uint16_t[]> line_;
+  // The RegType Ids associated with each dex register, possibly shared with other lines
+  Registers* line_;
 
   // Back link to the verifier
   MethodVerifier* verifier_;
 
   // Length of reg_types_
   const uint32_t num_regs_;
-  // A stack of monitor enter locations
-  std::deque<uint32_t> monitors_;
+  // A stack of monitor enter locations. A vector, unlike a deque, takes no space while empty,
+  // which it is in all but a few lines.
+  std::vector<uint32_t> monitors_;
   // A map from register to a bit vector of indices into the monitors_ stack. As we pop the monitor
   // stack we verify that monitor-enter/exit are correctly nested. That is, if there was a
   // monitor-enter on v5 and then on v6, we expect the monitor-exit to be on v6 then on v5
   SafeMap<uint32_t, uint32_t> reg_to_lock_depths_;
+
+  DISALLOW_COPY_AND_ASSIGN(RegisterLine);
 };
 std::ostream& operator<<(std::ostream& os, const RegisterLine& rhs);
 
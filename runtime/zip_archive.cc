@@ -76,13 +76,9 @@ off64_t ZipEntry::GetDataOffset() {
     return -1;
   }
 
-  if (lseek64(zip_archive_->fd_, lfh_offset, SEEK_SET) != lfh_offset) {
-    PLOG(WARNING) << "Zip: failed seeking to LFH at offset " << lfh_offset;
-    return -1;
-  }
-
   uint8_t lfh_buf[ZipArchive::kLFHLen];
-  ssize_t actual = TEMP_FAILURE_RETRY(read(zip_archive_->fd_, lfh_buf, sizeof(lfh_buf)));
+  ssize_t actual = TEMP_FAILURE_RETRY(pread64(zip_archive_->fd_, lfh_buf, sizeof(lfh_buf),
+                                              lfh_offset));
   if (actual != sizeof(lfh_buf)) {
     LOG(WARNING) << "Zip: failed reading LFH from offset " << lfh_offset;
     return -1;
@@ -127,19 +123,20 @@ off64_t ZipEntry::GetDataOffset() {
   return data_offset;
 }
 
-static bool CopyFdToMemory(uint8_t* begin, size_t size, int in, size_t count) {
+// Reads with pread64 rather than seeking the shared file descriptor, so that several entries of an
+// archive can be extracted at the same time from different threads.
+static bool CopyFdToMemory(uint8_t* begin, size_t size, int in, off64_t offset, size_t count) {
+  DCHECK_EQ(size, count);
   uint8_t* dst = begin;
-  std::vector<uint8_t> buf(kBufSize);
   while (count != 0) {
-    size_t bytes_to_read = (count > kBufSize) ? kBufSize : count;
-    ssize_t actual = TEMP_FAILURE_RETRY(read(in, &buf[0], bytes_to_read));
-    if (actual != static_cast<ssize_t>(bytes_to_read)) {
+    ssize_t actual = TEMP_FAILURE_RETRY(pread64(in, dst, count, offset));
+    if (actual <= 0) {
       PLOG(WARNING) << "Zip: short read";
       return false;
     }
-    memcpy(dst, &buf[0], bytes_to_read);
-    dst += bytes_to_read;
-    count -= bytes_to_read;
+    dst += actual;
+    offset += actual;
+    count -= actual;
   }
   DCHECK_EQ(dst, begin + size);
   return true;
@@ -171,17 +168,17 @@ class ZStream {
   z_stream zstream_;
 };
 
-static bool InflateToMemory(uint8_t* begin, size_t size,
-                            int in, size_t uncompressed_length, size_t compressed_length) {
-  uint8_t* dst = begin;
+// Inflates straight into the destination, which is the size of the uncompressed data, so only the
+// compressed input is buffered.
+static bool InflateToMemory(uint8_t* begin, size_t size, int in, off64_t offset,
+                            size_t uncompressed_length, size_t compressed_length) {
   UniquePtr<uint8_t[]> read_buf(new uint8_t[kBufSize]);
-  UniquePtr<uint8_t[]> write_buf(new uint8_t[kBufSize]);
-  if (read_buf.get() == NULL || write_buf.get() == NULL) {
+  if (read_buf.get() == NULL) {
     LOG(WARNING) << "Zip: failed to allocate buffer to inflate";
     return false;
   }
 
-  UniquePtr<ZStream> zstream(new ZStream(write_buf.get(), kBufSize));
+  UniquePtr<ZStream> zstream(new ZStream(begin, size));
 
   // Use the undocumented "negative window bits" feature to tell zlib
   // that there's no zlib header waiting for it.
@@ -200,15 +197,15 @@ static bool InflateToMemory(uint8_t* begin, size_t size,
     // read as much as we can
     if (zstream->Get().avail_in == 0) {
       size_t bytes_to_read = (remaining > kBufSize) ? kBufSize : remaining;
-
-        ssize_t actual = TEMP_FAILURE_RETRY(read(in, read_buf.get(), bytes_to_read));
-        if (actual != static_cast<ssize_t>(bytes_to_read)) {
-          LOG(WARNING) << "Zip: inflate read failed (" << actual << " vs " << bytes_to_read << ")";
-          return false;
-        }
-        remaining -= bytes_to_read;
-        zstream->Get().next_in = read_buf.get();
-        zstream->Get().avail_in = bytes_to_read;
+      ssize_t actual = TEMP_FAILURE_RETRY(pread64(in, read_buf.get(), bytes_to_read, offset));
+      if (actual != static_cast<ssize_t>(bytes_to_read)) {
+        LOG(WARNING) << "Zip: inflate read failed (" << actual << " vs " << bytes_to_read << ")";
+        return false;
+      }
+      offset += bytes_to_read;
+      remaining -= bytes_to_read;
+      zstream->Get().next_in = read_buf.get();
+      zstream->Get().avail_in = bytes_to_read;
     }
 
     // uncompress the data
@@ -222,16 +219,6 @@ static bool InflateToMemory(uint8_t* begin, size_t size,
                    << ")";
       return false;
     }
-
-    // write when we're full or when we're done
-    if (zstream->Get().avail_out == 0 ||
-        (zerr == Z_STREAM_END && zstream->Get().avail_out != kBufSize)) {
-      size_t bytes_to_write = zstream->Get().next_out - write_buf.get();
-      memcpy(dst, write_buf.get(), bytes_to_write);
-      dst += bytes_to_write;
-      zstream->Get().next_out = write_buf.get();
-      zstream->Get().avail_out = kBufSize;
-    }
   } while (zerr == Z_OK);
 
   DCHECK_EQ(zerr, Z_STREAM_END);  // other errors should've been caught
@@ -243,7 +230,7 @@ static bool InflateToMemory(uint8_t* begin, size_t size,
     return false;
   }
 
-  DCHECK_EQ(dst, begin + size);
+  DCHECK_EQ(zstream->Get().next_out, begin + size);
   return true;
 }
 
@@ -274,18 +261,13 @@ bool ZipEntry::ExtractToMemory(uint8_t* begin, size_t size) {
     LOG(WARNING) << "Zip: data_offset=" << data_offset;
     return false;
   }
-  if (lseek64(zip_archive_->fd_, data_offset, SEEK_SET) != data_offset) {
-    PLOG(WARNING) << "Zip: lseek to data at " << data_offset << " failed";
-    return false;
-  }
-
   // TODO: this doesn't verify the data's CRC, but probably should (especially
   // for uncompressed data).
   switch (GetCompressionMethod()) {
     case kCompressStored:
-      return CopyFdToMemory(begin, size, zip_archive_->fd_, GetUncompressedLength());
+      return CopyFdToMemory(begin, size, zip_archive_->fd_, data_offset, GetUncompressedLength());
     case kCompressDeflated:
-      return InflateToMemory(begin, size, zip_archive_->fd_,
+      return InflateToMemory(begin, size, zip_archive_->fd_, data_offset,
                              GetUncompressedLength(), GetCompressedLength());
     default:
       LOG(WARNING) << "Zip: unknown compression method " << std::hex << GetCompressionMethod();
@@ -315,6 +297,25 @@ MemMap* ZipEntry::ExtractToMemMap(const char* entry_filename) {
   return map.release();
 }
 
+MemMap* ZipEntry::MapDirectlyFromFile(const char* entry_filename, size_t alignment) {
+  if (GetCompressionMethod() != kCompressStored ||
+      GetCompressedLength() != GetUncompressedLength() || GetUncompressedLength() == 0) {
+    return NULL;
+  }
+  off64_t data_offset = GetDataOffset();
+  if (data_offset == -1 || data_offset % alignment != 0) {
+    return NULL;
+  }
+  // Private so that a later EnableWrite, as for dex-to-dex compilation, never writes the file.
+  UniquePtr<MemMap> map(MemMap::MapFile(GetUncompressedLength(), PROT_READ, MAP_PRIVATE,
+                                        zip_archive_->fd_, data_offset));
+  if (map.get() == NULL) {
+    LOG(WARNING) << "Zip: failed to map '" << entry_filename << "' from the zip file";
+    return NULL;
+  }
+  return map.release();
+}
+
 static void SetCloseOnExec(int fd) {
   // This dance is more portable than Linux's O_CLOEXEC open(2) flag.
   int flags = fcntl(fd, F_GETFD);
@@ -40,6 +40,11 @@ class ZipEntry {
   bool ExtractToMemory(uint8_t* begin, size_t size);
   MemMap* ExtractToMemMap(const char* entry_filename);
 
+  // Maps a stored entry read only from the zip file itself, so that the pages are shared with
+  // other processes and nothing is copied. Returns NULL if the entry is compressed or its data is
+  // not aligned to the given alignment, callers then fall back to ExtractToMemMap.
+  MemMap* MapDirectlyFromFile(const char* entry_filename, size_t alignment);
+
   uint32_t GetUncompressedLength();
   uint32_t GetCrc32();
 
@@ -57,4 +57,20 @@ TEST_F(ZipArchiveTest, FindAndExtract) {
   EXPECT_EQ(zip_entry->GetCrc32(), computed_crc);
 }
 
+TEST_F(ZipArchiveTest, MapDirectlyFromFile) {
+  UniquePtr<ZipArchive> zip_archive(ZipArchive::Open(GetLibCoreDexFileName()));
+  ASSERT_TRUE(zip_archive.get() != NULL);
+  UniquePtr<ZipEntry> zip_entry(zip_archive->Find("classes.dex"));
+  ASSERT_TRUE(zip_entry.get() != NULL);
+  UniquePtr<MemMap> extracted(zip_entry->ExtractToMemMap("classes.dex"));
+  ASSERT_TRUE(extracted.get() != NULL);
+
+  // Only stored entries can be mapped, when they are the mapping has the same contents.
+  UniquePtr<MemMap> mapped(zip_entry->MapDirectlyFromFile("classes.dex", 4));
+  if (mapped.get() != NULL) {
+    ASSERT_EQ(extracted->Size(), mapped->Size());
+    EXPECT_EQ(0, memcmp(extracted->Begin(), mapped->Begin(), mapped->Size()));
+  }
+}
+
 }  // namespace art
@@ -0,0 +1,306 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Interpreter microbenchmarks. Without arguments every benchmark runs a few iterations and
+ * prints its result so that the test also checks the instructions it measures. With --timing
+ * each benchmark is warmed up and then timed, and the time per operation is printed as
+ * "<name>: <time> ns/op".
+ */
+public class Main {
+    static final int CHECK_ITERATIONS = 1000;
+    static final int WARMUP_ITERATIONS = 10000;
+    /** Timed runs last at least this long so that the clock resolution doesn't matter. */
+    static final long MIN_TIME_NS = 500L * 1000 * 1000;
+
+    static abstract class Benchmark {
+        final String name;
+
+        Benchmark(String name) {
+            this.name = name;
+        }
+
+        /** Performs the operation iterations times and returns a checksum of the results. */
+        abstract int run(int iterations);
+    }
+
+    static final Benchmark[] BENCHMARKS = {
+        new Benchmark("IntArithmetic") {
+            int run(int iterations) {
+                int sum = 0;
+                for (int i = 0; i < iterations; i++) {
+                    sum += (i * 3) ^ (i >> 2);
+                    sum -= i & 0xff;
+                }
+                return sum;
+            }
+        },
+        new Benchmark("LongArithmetic") {
+            int run(int iterations) {
+                long sum = 0;
+                for (long i = 0; i < iterations; i++) {
+                    sum += (i * 3) ^ (i >> 2);
+                    sum -= i & 0xff;
+                }
+                return (int) (sum ^ (sum >>> 32));
+            }
+        },
+        new Benchmark("DoubleArithmetic") {
+            int run(int iterations) {
+                double sum = 0;
+                for (int i = 0; i < iterations; i++) {
+                    sum += i * 0.5;
+                    sum /= 1.0001;
+                }
+                return (int) sum;
+            }
+        },
+        new Benchmark("InstanceFields") {
+            int run(int iterations) {
+                Point p = new Point();
+                for (int i = 0; i < iterations; i++) {
+                    p.x += i;
+                    p.y = p.x - p.y;
+                }
+                return p.x ^ p.y;
+            }
+        },
+        new Benchmark("StaticFields") {
+            int run(int iterations) {
+                Point.count = 0;
+                for (int i = 0; i < iterations; i++) {
+                    Point.count += i;
+                }
+                return Point.count;
+            }
+        },
+        new Benchmark("ObjectFieldNullCheck") {
+            int run(int iterations) {
+                Node list = null;
+                for (int i = 0; i < 16; i++) {
+                    list = new Node(i, list);
+                }
+                int sum = 0;
+                for (int i = 0; i < iterations; i += 16) {
+                    for (Node n = list; n != null; n = n.next) {
+                        sum += n.value;
+                    }
+                }
+                return sum;
+            }
+        },
+        new Benchmark("StaticInvoke") {
+            int run(int iterations) {
+                int sum = 0;
+                for (int i = 0; i < iterations; i++) {
+                    sum = add(sum, i);
+                }
+                return sum;
+            }
+        },
+        new Benchmark("VirtualInvoke") {
+            int run(int iterations) {
+                Shape shape = new Square(3);
+                int sum = 0;
+                for (int i = 0; i < iterations; i++) {
+                    sum += shape.area();
+                }
+                return sum;
+            }
+        },
+        new Benchmark("PolymorphicVirtualInvoke") {
+            int run(int iterations) {
+                Shape[] shapes = { new Square(3), new Rectangle(2, 5), new Square(4) };
+                int sum = 0;
+                for (int i = 0; i < iterations; i++) {
+                    sum += shapes[i % 3].area();
+                }
+                return sum;
+            }
+        },
+        new Benchmark("InterfaceInvoke") {
+            int run(int iterations) {
+                Counter counter = new SimpleCounter();
+                for (int i = 0; i < iterations; i++) {
+                    counter.increment(i);
+                }
+                return counter.get();
+            }
+        },
+        new Benchmark("IntArray") {
+            int run(int iterations) {
+                int[] array = new int[64];
+                int sum = 0;
+                for (int i = 0; i < iterations; i++) {
+                    int index = i & 63;
+                    array[index] += i;
+                    sum += array[index];
+                }
+                return sum;
+            }
+        },
+        new Benchmark("ObjectArray") {
+            int run(int iterations) {
+                Object[] array = new Object[64];
+                Object o = new Object();
+                int count = 0;
+                for (int i = 0; i < iterations; i++) {
+                    int index = i & 63;
+                    if (array[index] == null) {
+                        array[index] = o;
+                        count++;
+                    } else {
+                        array[index] = null;
+                    }
+                }
+                return count;
+            }
+        },
+        new Benchmark("ArrayLength") {
+            int run(int iterations) {
+                char[] chars = new char[100];
+                int sum = 0;
+                for (int i = 0; i < iterations; i++) {
+                    sum += chars.length;
+                }
+                return sum;
+            }
+        },
+        new Benchmark("Exceptions") {
+            int run(int iterations) {
+                int count = 0;
+                for (int i = 0; i < iterations; i++) {
+                    try {
+                        throwIfOdd(i);
+                    } catch (IllegalStateException expected) {
+                        count++;
+                    }
+                }
+                return count;
+            }
+        },
+        new Benchmark("StringCharAt") {
+            int run(int iterations) {
+                String s = "interpreter benchmarks";
+                int sum = 0;
+                for (int i = 0; i < iterations; i++) {
+                    sum += s.charAt(i % s.length());
+                }
+                return sum;
+            }
+        },
+    };
+
+    public static void main(String[] args) {
+        boolean timing = (args.length >= 1) && args[0].equals("--timing");
+        for (Benchmark benchmark : BENCHMARKS) {
+            if (timing) {
+                time(benchmark);
+            } else {
+                System.out.println(benchmark.name + ": " + benchmark.run(CHECK_ITERATIONS));
+            }
+        }
+    }
+
+    /** Runs the benchmark with more iterations until it lasts long enough to be timed. */
+    static void time(Benchmark benchmark) {
+        benchmark.run(WARMUP_ITERATIONS);
+        int iterations = WARMUP_ITERATIONS;
+        while (true) {
+            long start = System.nanoTime();
+            benchmark.run(iterations);
+            long elapsed = System.nanoTime() - start;
+            if (elapsed >= MIN_TIME_NS || iterations > Integer.MAX_VALUE / 2) {
+                System.out.printf("%s: %.2f ns/op\n", benchmark.name, elapsed / (double) iterations);
+                return;
+            }
+            iterations *= 2;
+        }
+    }
+
+    static int add(int a, int b) {
+        return a + b;
+    }
+
+    static void throwIfOdd(int i) {
+        if ((i & 1) != 0) {
+            throw new IllegalStateException();
+        }
+    }
+
+    static class Point {
+        static int count;
+        int x;
+        int y;
+    }
+
+    static class Node {
+        final int value;
+        final Node next;
+
+        Node(int value, Node next) {
+            this.value = value;
+            this.next = next;
+        }
+    }
+
+    static abstract class Shape {
+        abstract int area();
+    }
+
+    static class Square extends Shape {
+        final int side;
+
+        Square(int side) {
+            this.side = side;
+        }
+
+        int area() {
+            return side * side;
+        }
+    }
+
+    static class Rectangle extends Shape {
+        final int width;
+        final int height;
+
+        Rectangle(int width, int height) {
+            this.width = width;
+            this.height = height;
+        }
+
+        int area() {
+            return width * height;
+        }
+    }
+
+    interface Counter {
+        void increment(int amount);
+        int get();
+    }
+
+    static class SimpleCounter implements Counter {
+        private int value;
+
+        public void increment(int amount) {
+            value += amount;
+        }
+
+        public int get() {
+            return value;
+        }
+    }
+}
@@ -0,0 +1,305 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+import java.io.BufferedReader;
+import java.io.FileReader;
+import java.io.IOException;
+import java.lang.ref.ReferenceQueue;
+import java.lang.ref.SoftReference;
+import java.lang.ref.WeakReference;
+import java.lang.reflect.Method;
+import java.util.Random;
+
+/**
+ * Allocation and GC benchmarks. Without arguments every workload runs a few operations and
+ * checks its result, so that the test also runs with the other run-tests. With --timing each
+ * workload is warmed up and then timed, printing
+ * "<name>: <ops>/s <MB>/s" where the allocated bytes are counted by VMDebug in a separate
+ * calibration run, so that counting doesn't slow down the timed run. The timed runs end with the
+ * pause percentiles of each collector and the peak RSS of the process.
+ */
+public class Main {
+    static final int CHECK_OPERATIONS = 1000;
+    static final int WARMUP_OPERATIONS = 10000;
+    /** Timed runs last at least this long so that the collectors run many times. */
+    static final long MIN_TIME_NS = 2000L * 1000 * 1000;
+    static final int THREADS = 8;
+
+    static abstract class Workload {
+        final String name;
+
+        Workload(String name) {
+            this.name = name;
+        }
+
+        /** Sets up the data the operations work on, outside of the timed runs. */
+        void setUp() {
+        }
+
+        /** Drops the data so that the next workload starts from an empty heap. */
+        void tearDown() {
+        }
+
+        /** Performs operations operations and returns a checksum of the results. */
+        abstract long run(int operations) throws Exception;
+    }
+
+    static final Workload[] WORKLOADS = {
+        new Workload("ShortLivedGarbage") {
+            long run(int operations) {
+                long sum = 0;
+                for (int i = 0; i < operations; i++) {
+                    Node list = null;
+                    for (int j = 0; j < 16; j++) {
+                        list = new Node(j, list);
+                    }
+                    sum += list.value;
+                }
+                return sum;
+            }
+        },
+        new Workload("LargeLiveSet") {
+            // 64k trees of 15 nodes, a few megabytes that survive every collection.
+            Node[] live;
+            Random random;
+
+            void setUp() {
+                live = new Node[64 * 1024];
+                random = new Random(42);
+                for (int i = 0; i < live.length; i++) {
+                    live[i] = tree(4, i);
+                }
+            }
+
+            void tearDown() {
+                live = null;
+            }
+
+            long run(int operations) {
+                if (live == null) {
+                    setUp();
+                }
+                long sum = 0;
+                for (int i = 0; i < operations; i++) {
+                    int index = random.nextInt(live.length);
+                    sum += live[index].value;
+                    live[index] = tree(4, i);
+                }
+                return sum;
+            }
+        },
+        new Workload("ReferenceChurn") {
+            ReferenceQueue<Object> queue = new ReferenceQueue<Object>();
+            Object[] references = new Object[1024];
+
+            long run(int operations) {
+                long sum = 0;
+                for (int i = 0; i < operations; i++) {
+                    Object referent = new Node(i, null);
+                    references[i & (references.length - 1)] = (i & 1) == 0
+                        ? new WeakReference<Object>(referent, queue)
+                        : new SoftReference<Object>(referent, queue);
+                    while (queue.poll() != null) {
+                        sum++;
+                    }
+                }
+                return sum >= 0 ? operations : -1;
+            }
+        },
+        new Workload("Finalizers") {
+            long run(int operations) {
+                for (int i = 0; i < operations; i++) {
+                    new Finalizable();
+                }
+                return operations;
+            }
+        },
+        new Workload("LargeArrays") {
+            long run(int operations) {
+                long sum = 0;
+                for (int i = 0; i < operations; i++) {
+                    // Above the large object threshold, so each one is a separate mapping.
+                    int[] array = new int[16 * 1024];
+                    array[i & (array.length - 1)] = i;
+                    sum += array[i & (array.length - 1)] + array.length;
+                }
+                return sum;
+            }
+        },
+        new Workload("ManyThreads") {
+            long run(final int operations) throws Exception {
+                final long[] sums = new long[THREADS];
+                Thread[] threads = new Thread[THREADS];
+                for (int t = 0; t < THREADS; t++) {
+                    final int index = t;
+                    threads[t] = new Thread() {
+                        public void run() {
+                            long sum = 0;
+                            for (int i = index; i < operations; i += THREADS) {
+                                Node list = null;
+                                for (int j = 0; j < 16; j++) {
+                                    list = new Node(j, list);
+                                }
+                                sum += list.value;
+                            }
+                            sums[index] = sum;
+                        }
+                    };
+                    threads[t].start();
+                }
+                long sum = 0;
+                for (int t = 0; t < THREADS; t++) {
+                    threads[t].join();
+                    sum += sums[t];
+                }
+                return sum;
+            }
+        },
+    };
+
+    public static void main(String[] args) throws Exception {
+        boolean timing = args.length > 0 && args[0].equals("--timing");
+        for (Workload workload : WORKLOADS) {
+            if (timing) {
+                time(workload);
+            } else {
+                workload.setUp();
+                System.out.println(workload.name + ": " + workload.run(CHECK_OPERATIONS));
+                workload.tearDown();
+            }
+        }
+        if (timing) {
+            printGcStats();
+            System.out.println("PeakRSS: " + peakRssKb() + " kB");
+        }
+    }
+
+    /** Runs the workload with more operations until it lasts long enough to be timed. */
+    static void time(Workload workload) throws Exception {
+        workload.setUp();
+        workload.run(WARMUP_OPERATIONS);
+        double bytesPerOperation = allocatedBytes(workload, WARMUP_OPERATIONS) / WARMUP_OPERATIONS;
+        int operations = WARMUP_OPERATIONS;
+        while (true) {
+            long start = System.nanoTime();
+            workload.run(operations);
+            long elapsed = System.nanoTime() - start;
+            if (elapsed >= MIN_TIME_NS || operations > Integer.MAX_VALUE / 2) {
+                double seconds = elapsed / 1e9;
+                System.out.printf("%s: %.0f ops/s %.1f MB/s\n", workload.name,
+                                  operations / seconds,
+                                  operations * bytesPerOperation / seconds / (1024 * 1024));
+                break;
+            }
+            operations *= 2;
+        }
+        workload.tearDown();
+        Runtime.getRuntime().gc();
+    }
+
+    /** The bytes allocated by the operations, or 0 where VMDebug can't count them. */
+    static double allocatedBytes(Workload workload, int operations) throws Exception {
+        Class<?> vmDebug;
+        try {
+            vmDebug = Class.forName("dalvik.system.VMDebug");
+        } catch (ClassNotFoundException e) {
+            return 0;
+        }
+        // KIND_GLOBAL_ALLOCATED_BYTES and KIND_ALL_COUNTS of VMDebug.
+        final int allocatedBytes = 2;
+        final int allCounts = 0xffffffff;
+        vmDebug.getMethod("resetAllocCount", int.class).invoke(null, allCounts);
+        vmDebug.getMethod("startAllocCounting").invoke(null);
+        workload.run(operations);
+        vmDebug.getMethod("stopAllocCounting").invoke(null);
+        int bytes = (Integer) vmDebug.getMethod("getAllocCount", int.class)
+            .invoke(null, allocatedBytes);
+        // The global count includes the allocations of every thread, so ManyThreads is counted.
+        return bytes & 0xffffffffL;
+    }
+
+    /** Prints the pause percentiles of each collector that ran. */
+    static void printGcStats() throws Exception {
+        Class<?> vmDebug;
+        try {
+            vmDebug = Class.forName("dalvik.system.VMDebug");
+        } catch (ClassNotFoundException e) {
+            return;
+        }
+        Method getNames = vmDebug.getMethod("getGcCollectorNames");
+        Method getStats = vmDebug.getMethod("getGcStats", int.class, long[].class);
+        String[] names = (String[]) getNames.invoke(null);
+        // Laid out as gc::GcStat: iterations, total, paused time, freed objects and bytes,
+        // throughput, then the median, 90th, 99th percentile and maximum pause.
+        long[] stats = new long[14];
+        for (int i = 0; i < names.length; i++) {
+            if (!(Boolean) getStats.invoke(null, i, stats) || stats[0] == 0) {
+                continue;
+            }
+            System.out.printf("GC_%s: %d collections, pauses p50 %d us p90 %d us p99 %d us"
+                              + " max %d us\n", names[i].replace(' ', '_'), stats[0],
+                              stats[6] / 1000, stats[7] / 1000, stats[8] / 1000, stats[9] / 1000);
+        }
+    }
+
+    /** The high water mark of the resident set, or 0 where /proc isn't there. */
+    static long peakRssKb() {
+        try {
+            BufferedReader reader = new BufferedReader(new FileReader("/proc/self/status"));
+            try {
+                String line;
+                while ((line = reader.readLine()) != null) {
+                    if (line.startsWith("VmHWM:")) {
+                        return Long.parseLong(line.substring(6).replace("kB", "").trim());
+                    }
+                }
+            } finally {
+                reader.close();
+            }
+        } catch (IOException e) {
+        }
+        return 0;
+    }
+
+    static Node tree(int depth, int value) {
+        if (depth == 1) {
+            return new Node(value, null);
+        }
+        Node node = new Node(value, tree(depth - 1, value + 1));
+        node.other = tree(depth - 1, value + 2);
+        return node;
+    }
+
+    static class Node {
+        final int value;
+        final Node next;
+        Node other;
+
+        Node(int value, Node next) {
+            this.value = value;
+            this.next = next;
+        }
+    }
+
+    static class Finalizable {
+        static volatile int finalized;
+        final long[] payload = new long[4];
+
+        protected void finalize() {
+            finalized++;
+        }
+    }
+}
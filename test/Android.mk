@@ -44,6 +44,8 @@ TEST_OAT_DIRECTORIES := \
 	Main \
 	HelloWorld \
 	\
+	CoreLibraryStartup \
+	JniBenchmark \
 	JniTest \
 	NativeAllocations \
 	ParallelGC \
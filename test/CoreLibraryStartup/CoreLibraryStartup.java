@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+import java.lang.reflect.Method;
+import java.math.BigDecimal;
+import java.math.BigInteger;
+import java.security.MessageDigest;
+import java.text.SimpleDateFormat;
+import java.util.ArrayList;
+import java.util.Calendar;
+import java.util.Collections;
+import java.util.HashMap;
+import java.util.List;
+import java.util.Locale;
+import java.util.Map;
+import java.util.TimeZone;
+import java.util.TreeMap;
+import java.util.concurrent.Callable;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.Future;
+import java.util.regex.Matcher;
+import java.util.regex.Pattern;
+import java.util.zip.CRC32;
+import java.util.zip.Deflater;
+import org.json.JSONObject;
+
+/**
+ * A short program touching a broad part of the core libraries once, like an app starting up does:
+ * collections, regular expressions, formatting, dates, big numbers, reflection, threads, digests,
+ * compression and JSON. tools/startup-benchmark uses it as its largest default program, HelloWorld
+ * as its smallest.
+ */
+class CoreLibraryStartup {
+    public static void main(String[] args) throws Exception {
+        Map<String, Integer> counts = new HashMap<String, Integer>();
+        Pattern word = Pattern.compile("[a-z]+");
+        Matcher matcher = word.matcher("the quick brown fox jumps over the lazy dog the end");
+        while (matcher.find()) {
+            Integer count = counts.get(matcher.group());
+            counts.put(matcher.group(), (count == null) ? 1 : count + 1);
+        }
+        TreeMap<String, Integer> sorted = new TreeMap<String, Integer>(counts);
+        List<String> words = new ArrayList<String>(sorted.keySet());
+        Collections.sort(words, Collections.reverseOrder());
+        check(sorted.get("the") == 3 && words.get(0).equals("the"), "collections");
+
+        check(String.format(Locale.US, "%08.3f|%x", Math.PI, 255).equals("0003.142|ff"), "format");
+
+        SimpleDateFormat format = new SimpleDateFormat("yyyy-MM-dd HH:mm", Locale.US);
+        format.setTimeZone(TimeZone.getTimeZone("UTC"));
+        Calendar calendar = Calendar.getInstance(TimeZone.getTimeZone("UTC"), Locale.US);
+        calendar.clear();
+        calendar.set(2013, Calendar.OCTOBER, 15, 12, 30);
+        check(format.format(calendar.getTime()).equals("2013-10-15 12:30"), "dates");
+
+        BigInteger factorial = BigInteger.ONE;
+        for (int i = 2; i <= 30; i++) {
+            factorial = factorial.multiply(BigInteger.valueOf(i));
+        }
+        BigDecimal ratio = new BigDecimal(factorial).divide(new BigDecimal("1e30"));
+        check(ratio.toPlainString().startsWith("265.2528598121910586363084800"), "big numbers");
+
+        Method method = Class.forName("java.lang.String").getMethod("toUpperCase", Locale.class);
+        check(method.invoke("startup", Locale.US).equals("STARTUP"), "reflection");
+
+        ExecutorService executor = Executors.newFixedThreadPool(2);
+        Future<Integer> future = executor.submit(new Callable<Integer>() {
+            public Integer call() {
+                return 42;
+            }
+        });
+        check(future.get() == 42, "threads");
+        executor.shutdown();
+
+        byte[] bytes = "A string to digest and compress".getBytes("UTF-8");
+        byte[] digest = MessageDigest.getInstance("SHA-1").digest(bytes);
+        check(digest.length == 20, "digests");
+        CRC32 crc = new CRC32();
+        crc.update(bytes);
+        Deflater deflater = new Deflater();
+        deflater.setInput(bytes);
+        deflater.finish();
+        byte[] compressed = new byte[128];
+        int compressedLength = deflater.deflate(compressed);
+        deflater.end();
+        check(crc.getValue() != 0 && compressedLength > 0, "compression");
+
+        JSONObject json = new JSONObject("{\"name\": \"startup\", \"values\": [1, 2, 3]}");
+        check(json.getJSONArray("values").getInt(2) == 3, "json");
+
+        System.out.println("CoreLibraryStartup: " + counts.size() + " words");
+    }
+
+    static void check(boolean condition, String what) {
+        if (!condition) {
+            throw new AssertionError(what);
+        }
+    }
+}
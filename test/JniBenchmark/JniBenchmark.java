@@ -0,0 +1,226 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * JNI call overhead microbenchmarks. Without arguments every benchmark runs a few iterations and
+ * prints its result. With --timing each benchmark is warmed up and then timed, and the time per
+ * operation is printed as "<name>: <time> ns/op". With --fast the natives are registered as fast
+ * natives. ../run-jni-benchmarks compares the default, CheckJNI and fast native modes.
+ *
+ * The native calls are made from Java, the JNI functions are called in a loop in native code so
+ * that their time doesn't include a native call.
+ */
+class JniBenchmark {
+    static final int CHECK_ITERATIONS = 1000;
+    static final int WARMUP_ITERATIONS = 10000;
+    /** Timed runs last at least this long so that the clock resolution doesn't matter. */
+    static final long MIN_TIME_NS = 500L * 1000 * 1000;
+
+    static abstract class Benchmark {
+        final String name;
+
+        Benchmark(String name) {
+            this.name = name;
+        }
+
+        /** Performs the operation iterations times and returns a checksum of the results. */
+        abstract int run(int iterations);
+    }
+
+    static final JniBenchmark instance = new JniBenchmark("benchmark");
+    static final Object[] objects = new Object[64];
+    static final int[] ints = new int[256];
+    static final String string = "A string of about the length of a typical name";
+
+    static final Benchmark[] BENCHMARKS = {
+        new Benchmark("StaticNop") {
+            int run(int iterations) {
+                for (int i = 0; i < iterations; i++) {
+                    staticNop();
+                }
+                return iterations;
+            }
+        },
+        new Benchmark("StaticArgs") {
+            int run(int iterations) {
+                int sum = 0;
+                for (int i = 0; i < iterations; i++) {
+                    sum += staticArgs(i, 2L, 3.0, instance);
+                }
+                return sum;
+            }
+        },
+        new Benchmark("InstanceNop") {
+            int run(int iterations) {
+                for (int i = 0; i < iterations; i++) {
+                    instance.instanceNop();
+                }
+                return iterations;
+            }
+        },
+        new Benchmark("InstanceArgs") {
+            int run(int iterations) {
+                int sum = 0;
+                for (int i = 0; i < iterations; i++) {
+                    sum += instance.instanceArgs(i, 2L, 3.0f, 4.0, string);
+                }
+                return sum;
+            }
+        },
+        new Benchmark("CallStaticIntMethod") {
+            int run(int iterations) {
+                return callStaticIntMethod(iterations);
+            }
+        },
+        new Benchmark("CallIntMethod") {
+            int run(int iterations) {
+                return instance.callIntMethod(iterations);
+            }
+        },
+        new Benchmark("CallObjectMethod") {
+            int run(int iterations) {
+                return instance.callObjectMethod(iterations);
+            }
+        },
+        new Benchmark("LocalRefs") {
+            int run(int iterations) {
+                return localRefs(objects, iterations);
+            }
+        },
+        new Benchmark("LocalFrames") {
+            int run(int iterations) {
+                return localFrames(objects, iterations);
+            }
+        },
+        new Benchmark("GetIntArrayElements") {
+            int run(int iterations) {
+                return getIntArrayElements(ints, iterations);
+            }
+        },
+        new Benchmark("GetIntArrayRegion") {
+            int run(int iterations) {
+                return getIntArrayRegion(ints, iterations);
+            }
+        },
+        new Benchmark("GetPrimitiveArrayCritical") {
+            int run(int iterations) {
+                return getPrimitiveArrayCritical(ints, iterations);
+            }
+        },
+        new Benchmark("GetStringUTFChars") {
+            int run(int iterations) {
+                return getStringUTFChars(string, iterations);
+            }
+        },
+        new Benchmark("GetStringChars") {
+            int run(int iterations) {
+                return getStringChars(string, iterations);
+            }
+        },
+        new Benchmark("NewStringUTF") {
+            int run(int iterations) {
+                return newStringUTF(iterations);
+            }
+        },
+    };
+
+    public static void main(String[] args) {
+        boolean timing = false;
+        boolean fast = false;
+        for (String arg : args) {
+            if (arg.equals("--timing")) {
+                timing = true;
+            } else if (arg.equals("--fast")) {
+                fast = true;
+            } else {
+                throw new IllegalArgumentException("unknown argument " + arg);
+            }
+        }
+        System.loadLibrary("arttest");
+        registerNatives(fast);
+        for (int i = 0; i < objects.length; i++) {
+            objects[i] = (i % 4 == 0) ? null : Integer.valueOf(i);
+        }
+        for (int i = 0; i < ints.length; i++) {
+            ints[i] = i;
+        }
+        for (Benchmark benchmark : BENCHMARKS) {
+            if (timing) {
+                time(benchmark);
+            } else {
+                System.out.println(benchmark.name + ": " + benchmark.run(CHECK_ITERATIONS));
+            }
+        }
+    }
+
+    /** Runs the benchmark with more iterations until it lasts long enough to be timed. */
+    static void time(Benchmark benchmark) {
+        benchmark.run(WARMUP_ITERATIONS);
+        int iterations = WARMUP_ITERATIONS;
+        while (true) {
+            long start = System.nanoTime();
+            benchmark.run(iterations);
+            long elapsed = System.nanoTime() - start;
+            if (elapsed >= MIN_TIME_NS || iterations > Integer.MAX_VALUE / 2) {
+                System.out.printf("%s: %.2f ns/op\n", benchmark.name, elapsed / (double) iterations);
+                return;
+            }
+            iterations *= 2;
+        }
+    }
+
+    final String name;
+    int count;
+
+    JniBenchmark(String name) {
+        this.name = name;
+    }
+
+    /** Called back by CallStaticIntMethod. */
+    static int addOne(int value) {
+        return value + 1;
+    }
+
+    /** Called back by CallIntMethod. */
+    int increment(int amount) {
+        count += amount;
+        return count;
+    }
+
+    /** Called back by CallObjectMethod. */
+    String getName() {
+        return name;
+    }
+
+    /** Registers the natives below, with a "!" signature prefix when fast is true. */
+    private static native void registerNatives(boolean fast);
+
+    private static native void staticNop();
+    private static native int staticArgs(int i, long l, double d, Object o);
+    private native void instanceNop();
+    private native int instanceArgs(int i, long l, float f, double d, String s);
+    private static native int callStaticIntMethod(int iterations);
+    private native int callIntMethod(int iterations);
+    private native int callObjectMethod(int iterations);
+    private static native int localRefs(Object[] array, int iterations);
+    private static native int localFrames(Object[] array, int iterations);
+    private static native int getIntArrayElements(int[] array, int iterations);
+    private static native int getIntArrayRegion(int[] array, int iterations);
+    private static native int getPrimitiveArrayCritical(int[] array, int iterations);
+    private static native int getStringUTFChars(String s, int iterations);
+    private static native int getStringChars(String s, int iterations);
+    private static native int newStringUTF(int iterations);
+}
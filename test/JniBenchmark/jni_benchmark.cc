@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+
+#include "jni.h"
+
+#if defined(NDEBUG)
+#error test code compiled without NDEBUG
+#endif
+
+// Natives of JniBenchmark. Those that take an iteration count call a JNI function that many times,
+// the others are the native calls being measured.
+
+static jmethodID add_one = NULL;
+static jmethodID increment = NULL;
+static jmethodID get_name = NULL;
+
+// Local references made by LocalFrames between pushing and popping a frame.
+static const jint kFrameSize = 16;
+
+static void staticNop(JNIEnv*, jclass) {
+}
+
+static jint staticArgs(JNIEnv*, jclass, jint i, jlong l, jdouble d, jobject o) {
+  return i + static_cast<jint>(l) + static_cast<jint>(d) + (o != NULL ? 1 : 0);
+}
+
+static void instanceNop(JNIEnv*, jobject) {
+}
+
+static jint instanceArgs(JNIEnv*, jobject, jint i, jlong l, jfloat f, jdouble d, jstring s) {
+  return i + static_cast<jint>(l) + static_cast<jint>(f) + static_cast<jint>(d) +
+      (s != NULL ? 1 : 0);
+}
+
+static jint callStaticIntMethod(JNIEnv* env, jclass klass, jint iterations) {
+  jint sum = 0;
+  for (jint i = 0; i < iterations; ++i) {
+    sum = env->CallStaticIntMethod(klass, add_one, sum);
+  }
+  return sum;
+}
+
+static jint callIntMethod(JNIEnv* env, jobject thiz, jint iterations) {
+  jint sum = 0;
+  for (jint i = 0; i < iterations; ++i) {
+    sum = env->CallIntMethod(thiz, increment, 1);
+  }
+  return sum;
+}
+
+static jint callObjectMethod(JNIEnv* env, jobject thiz, jint iterations) {
+  jint count = 0;
+  for (jint i = 0; i < iterations; ++i) {
+    jobject name = env->CallObjectMethod(thiz, get_name);
+    count += (name != NULL) ? 1 : 0;
+    env->DeleteLocalRef(name);
+  }
+  return count;
+}
+
+static jint localRefs(JNIEnv* env, jclass, jobjectArray array, jint iterations) {
+  jint length = env->GetArrayLength(array);
+  jint count = 0;
+  for (jint i = 0; i < iterations; ++i) {
+    jobject element = env->GetObjectArrayElement(array, i % length);
+    count += (element != NULL) ? 1 : 0;
+    env->DeleteLocalRef(element);
+  }
+  return count;
+}
+
+static jint localFrames(JNIEnv* env, jclass, jobjectArray array, jint iterations) {
+  jint length = env->GetArrayLength(array);
+  jint count = 0;
+  for (jint i = 0; i < iterations; i += kFrameSize) {
+    env->PushLocalFrame(kFrameSize);
+    for (jint j = 0; j < kFrameSize; ++j) {
+      count += (env->GetObjectArrayElement(array, (i + j) % length) != NULL) ? 1 : 0;
+    }
+    env->PopLocalFrame(NULL);
+  }
+  return count;
+}
+
+static jint getIntArrayElements(JNIEnv* env, jclass, jintArray array, jint iterations) {
+  jint length = env->GetArrayLength(array);
+  jint sum = 0;
+  for (jint i = 0; i < iterations; ++i) {
+    jint* elements = env->GetIntArrayElements(array, NULL);
+    sum += elements[i % length];
+    env->ReleaseIntArrayElements(array, elements, JNI_ABORT);
+  }
+  return sum;
+}
+
+static jint getIntArrayRegion(JNIEnv* env, jclass, jintArray array, jint iterations) {
+  jint buffer[16];
+  jint sum = 0;
+  for (jint i = 0; i < iterations; ++i) {
+    env->GetIntArrayRegion(array, 0, 16, buffer);
+    sum += buffer[i & 15];
+  }
+  return sum;
+}
+
+static jint getPrimitiveArrayCritical(JNIEnv* env, jclass, jintArray array, jint iterations) {
+  jint length = env->GetArrayLength(array);
+  jint sum = 0;
+  for (jint i = 0; i < iterations; ++i) {
+    jint* elements = static_cast<jint*>(env->GetPrimitiveArrayCritical(array, NULL));
+    sum += elements[i % length];
+    env->ReleasePrimitiveArrayCritical(array, elements, JNI_ABORT);
+  }
+  return sum;
+}
+
+static jint getStringUTFChars(JNIEnv* env, jclass, jstring s, jint iterations) {
+  jint sum = 0;
+  for (jint i = 0; i < iterations; ++i) {
+    const char* chars = env->GetStringUTFChars(s, NULL);
+    sum += chars[0];
+    env->ReleaseStringUTFChars(s, chars);
+  }
+  return sum;
+}
+
+static jint getStringChars(JNIEnv* env, jclass, jstring s, jint iterations) {
+  jint sum = 0;
+  for (jint i = 0; i < iterations; ++i) {
+    const jchar* chars = env->GetStringChars(s, NULL);
+    sum += chars[0];
+    env->ReleaseStringChars(s, chars);
+  }
+  return sum;
+}
+
+static jint newStringUTF(JNIEnv* env, jclass, jint iterations) {
+  jint count = 0;
+  for (jint i = 0; i < iterations; ++i) {
+    jstring s = env->NewStringUTF("A string of about the length of a typical name");
+    count += (s != NULL) ? 1 : 0;
+    env->DeleteLocalRef(s);
+  }
+  return count;
+}
+
+static const JNINativeMethod methods[] = {
+  { "staticNop", "()V", reinterpret_cast<void*>(staticNop) },
+  { "staticArgs", "(IJDLjava/lang/Object;)I", reinterpret_cast<void*>(staticArgs) },
+  { "instanceNop", "()V", reinterpret_cast<void*>(instanceNop) },
+  { "instanceArgs", "(IJFDLjava/lang/String;)I", reinterpret_cast<void*>(instanceArgs) },
+  { "callStaticIntMethod", "(I)I", reinterpret_cast<void*>(callStaticIntMethod) },
+  { "callIntMethod", "(I)I", reinterpret_cast<void*>(callIntMethod) },
+  { "callObjectMethod", "(I)I", reinterpret_cast<void*>(callObjectMethod) },
+  { "localRefs", "([Ljava/lang/Object;I)I", reinterpret_cast<void*>(localRefs) },
+  { "localFrames", "([Ljava/lang/Object;I)I", reinterpret_cast<void*>(localFrames) },
+  { "getIntArrayElements", "([II)I", reinterpret_cast<void*>(getIntArrayElements) },
+  { "getIntArrayRegion", "([II)I", reinterpret_cast<void*>(getIntArrayRegion) },
+  { "getPrimitiveArrayCritical", "([II)I", reinterpret_cast<void*>(getPrimitiveArrayCritical) },
+  { "getStringUTFChars", "(Ljava/lang/String;I)I", reinterpret_cast<void*>(getStringUTFChars) },
+  { "getStringChars", "(Ljava/lang/String;I)I", reinterpret_cast<void*>(getStringChars) },
+  { "newStringUTF", "(I)I", reinterpret_cast<void*>(newStringUTF) },
+};
+
+extern "C" JNIEXPORT void JNICALL Java_JniBenchmark_registerNatives(JNIEnv* env, jclass klass,
+                                                                   jboolean fast) {
+  static const size_t kMethodCount = sizeof(methods) / sizeof(methods[0]);
+  // A leading '!' in the signature registers a fast native.
+  char signatures[kMethodCount][64];
+  JNINativeMethod registered[kMethodCount];
+  for (size_t i = 0; i < kMethodCount; ++i) {
+    snprintf(signatures[i], sizeof(signatures[i]), "%s%s", fast ? "!" : "",
+             methods[i].signature);
+    registered[i] = methods[i];
+    registered[i].signature = signatures[i];
+  }
+  int register_result = env->RegisterNatives(klass, registered, kMethodCount);
+  assert(register_result == JNI_OK);
+
+  add_one = env->GetStaticMethodID(klass, "addOne", "(I)I");
+  assert(add_one != NULL);
+  increment = env->GetMethodID(klass, "increment", "(I)I");
+  assert(increment != NULL);
+  get_name = env->GetMethodID(klass, "getName", "()Ljava/lang/String;");
+  assert(get_name != NULL);
+}
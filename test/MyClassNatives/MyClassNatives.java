@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+import dalvik.annotation.optimization.CriticalNative;
+
 class MyClassNatives {
     native void throwException();
     native void foo();
@@ -28,6 +30,7 @@ class MyClassNatives {
     native Object fooIOO(int x, Object y, Object z);
     static native Object fooSIOO(int x, Object y, Object z);
     static native int fooSII(int x, int y);
+    @CriticalNative static native long criticalSIJ(int x, long y);
     static native double fooSDD(double x, double y);
     static synchronized native Object fooSSIOO(int x, Object y, Object z);
     static native void arraycopy(Object src, int src_pos, Object dst, int dst_pos, int length);